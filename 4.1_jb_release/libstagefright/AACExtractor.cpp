@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "include/AACExtractor.h"
+#include "include/BackgroundScanner.h"
 #include "include/avc_utils.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
@@ -31,14 +32,76 @@
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
 #include <utils/String8.h>
+#include <utils/threads.h>
 
 namespace android {
 
+// Offsets of the ADTS frames, built front to back in large reads as far as
+// somebody needs it: seeks extend it on demand, sequential playback reports
+// the frames it reads and local files get scanned in the background.
+// It also holds the track format, whose duration is exact once the index
+// is complete.
+class AACFrameIndex : public BackgroundScanner {
+public:
+    AACFrameIndex(const sp<DataSource> &source, off64_t firstFrameOffset,
+            const sp<MetaData> &meta, int64_t frameDurationUs);
+
+    // Returns ERROR_END_OF_STREAM if the stream has no such frame.
+    status_t findFrame(int64_t frame, off64_t *offset);
+    void addFrame(int64_t frame, off64_t offset, size_t frameSize);
+
+    // Indexes the first numFrames frames and, unless that was the whole
+    // stream, estimates the duration from their size.
+    void estimateDuration(size_t numFrames, off64_t streamSize);
+
+    // A new MetaData replaces the old one when the duration changes, those
+    // handed out are never modified.
+    sp<MetaData> getFormat();
+
+    void startScan();
+
+protected:
+    virtual ~AACFrameIndex();
+
+private:
+    static const size_t kChunkSize;
+    static const size_t kNumResyncFrames;
+
+    sp<DataSource> mDataSource;
+    off64_t mFirstFrameOffset;
+    int64_t mFrameDurationUs;
+
+    // serializes scanChunk() callers, mLock guards the rest
+    Mutex mScanLock;
+    uint8_t *mBuffer;
+    Vector<off64_t> mFound;
+    // of the first frame, every other one has to match it
+    uint8_t mFixedHeader[4];
+    bool mHaveFixedHeader;
+
+    Mutex mLock;
+    sp<MetaData> mMeta;
+    Vector<off64_t> mOffsets;
+    off64_t mScanOffset;
+    // whether a frame is known to start at mScanOffset
+    bool mScanSynced;
+    bool mComplete;
+    bool mScanning;
+
+    void setDuration_l(int64_t durationUs);
+    status_t scanChunk();
+
+    virtual bool scanStep();
+
+    AACFrameIndex(const AACFrameIndex &);
+    AACFrameIndex &operator=(const AACFrameIndex &);
+};
+
 class AACSource : public MediaSource {
 public:
     AACSource(const sp<DataSource> &source,
-              const sp<MetaData> &meta,
-              const Vector<uint64_t> &offset_vector,
+              const sp<AACFrameIndex> &frameIndex,
+              off64_t firstFrameOffset,
               int64_t frame_duration_us);
 
     virtual status_t start(MetaData *params = NULL);
@@ -55,14 +118,15 @@ protected:
 private:
     static const size_t kMaxFrameSize;
     sp<DataSource> mDataSource;
-    sp<MetaData> mMeta;
 
     off64_t mOffset;
     int64_t mCurrentTimeUs;
     bool mStarted;
     MediaBufferGroup *mGroup;
 
-    Vector<uint64_t> mOffsetVector;
+    sp<AACFrameIndex> mFrameIndex;
+    off64_t mFirstFrameOffset;
+    int64_t mFrame;
     int64_t mFrameDurationUs;
 
     AACSource(const AACSource &);
@@ -170,10 +234,272 @@ find_sync:
     return frameSize;
 }
 
+// Same as getAdtsFrameLength() for a header already in memory, which must
+// hold at least 6 bytes starting at a syncword.
+static size_t parseAdtsFrameLength(const uint8_t *header, size_t *headerSize) {
+    size_t frameSize =
+        (header[3] & 0x3) << 11 | header[4] << 3 | header[5] >> 5;
+    size_t headSize = (header[1] & 0x1) ? 7 : 9;
+    if (headSize > frameSize) {
+        return 0;
+    }
+    *headerSize = headSize;
+    return frameSize;
+}
+
+// Whether header starts with an ADTS syncword and has the fixed header of
+// ref: same MPEG version, layer, profile, sampling frequency and channel
+// configuration.
+static bool matchesAdtsFixedHeader(const uint8_t *header, const uint8_t *ref) {
+    return header[0] == 0xff && (header[1] & 0xf6) == 0xf0
+        && (header[1] & 0xfe) == (ref[1] & 0xfe)
+        && (header[2] & 0xfd) == (ref[2] & 0xfd)
+        && (header[3] & 0xc0) == (ref[3] & 0xc0);
+}
+
+// Counts the ADTS frames with the fixed header of ref that follow one
+// another from data on, up to maxFrames. Sets *truncated if the data ends
+// before a mismatch or maxFrames.
+static size_t countAdtsFrameChain(
+        const uint8_t *data, size_t size, const uint8_t *ref,
+        size_t maxFrames, bool *truncated) {
+    *truncated = false;
+
+    size_t numFrames = 0;
+    size_t pos = 0;
+    while (numFrames < maxFrames) {
+        if (pos + 6 > size) {
+            *truncated = true;
+            break;
+        }
+        const uint8_t *header = data + pos;
+        size_t frameSize, headerSize;
+        if (!matchesAdtsFixedHeader(header, ref)
+                || (frameSize = parseAdtsFrameLength(header, &headerSize)) == 0) {
+            break;
+        }
+        ++numFrames;
+        pos += frameSize;
+    }
+    return numFrames;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Enough for a hundred frames or so at common bitrates.
+const size_t AACFrameIndex::kChunkSize = 64 * 1024;
+
+// A syncword turns up in random data every few KB, after losing sync a
+// header only counts if this many frames follow one another from it.
+// Their 24 KB at most always fit in a chunk.
+const size_t AACFrameIndex::kNumResyncFrames = 3;
+
+AACFrameIndex::AACFrameIndex(
+        const sp<DataSource> &source, off64_t firstFrameOffset,
+        const sp<MetaData> &meta, int64_t frameDurationUs)
+    : mDataSource(source),
+      mFirstFrameOffset(firstFrameOffset),
+      mFrameDurationUs(frameDurationUs),
+      mBuffer(new uint8_t[kChunkSize]),
+      mHaveFixedHeader(false),
+      mMeta(meta),
+      mScanOffset(firstFrameOffset),
+      // SniffAAC() found the first one, the format comes from it
+      mScanSynced(true),
+      mComplete(false),
+      mScanning(false) {
+}
+
+AACFrameIndex::~AACFrameIndex() {
+    delete[] mBuffer;
+    mBuffer = NULL;
+}
+
+status_t AACFrameIndex::findFrame(int64_t frame, off64_t *offset) {
+    for (;;) {
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (frame < (int64_t)mOffsets.size()) {
+                *offset = mOffsets.itemAt(frame);
+                return OK;
+            }
+            if (mComplete) {
+                return ERROR_END_OF_STREAM;
+            }
+        }
+
+        status_t err = scanChunk();
+        if (err != OK && err != ERROR_END_OF_STREAM) {
+            return err;
+        }
+    }
+}
+
+void AACFrameIndex::addFrame(int64_t frame, off64_t offset, size_t frameSize) {
+    Mutex::Autolock autoLock(mLock);
+    if (frame != (int64_t)mOffsets.size() || mComplete) {
+        return;
+    }
+    mOffsets.push(offset);
+    mScanOffset = offset + frameSize;
+    mScanSynced = true;
+}
+
+void AACFrameIndex::estimateDuration(size_t numFrames, off64_t streamSize) {
+    for (;;) {
+        {
+            Mutex::Autolock autoLock(mLock);
+            if (mComplete) {
+                // scanChunk() set the exact duration
+                return;
+            }
+            if (mOffsets.size() >= numFrames) {
+                break;
+            }
+        }
+
+        status_t err = scanChunk();
+        if (err != OK && err != ERROR_END_OF_STREAM) {
+            break;
+        }
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    if (mComplete) {
+        return;
+    }
+    int64_t numScanned = mOffsets.size();
+    off64_t scannedBytes = mScanOffset - mFirstFrameOffset;
+    int64_t estimatedFrames = numScanned;
+    if (numScanned > 0 && scannedBytes > 0
+            && streamSize > mFirstFrameOffset + scannedBytes) {
+        estimatedFrames += (streamSize - mFirstFrameOffset - scannedBytes)
+                * numScanned / scannedBytes;
+    }
+    setDuration_l(estimatedFrames * mFrameDurationUs);
+}
+
+sp<MetaData> AACFrameIndex::getFormat() {
+    Mutex::Autolock autoLock(mLock);
+    return mMeta;
+}
+
+void AACFrameIndex::setDuration_l(int64_t durationUs) {
+    sp<MetaData> meta = new MetaData(*mMeta);
+    meta->setInt64(kKeyDuration, durationUs);
+    mMeta = meta;
+}
+
+// Indexes the frames whose headers lie in the next chunk after the last
+// known frame. Garbage in between is skipped over, see kNumResyncFrames.
+status_t AACFrameIndex::scanChunk() {
+    Mutex::Autolock scanLock(mScanLock);
+
+    off64_t offset;
+    size_t startFrame;
+    bool synced;
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mComplete) {
+            return ERROR_END_OF_STREAM;
+        }
+        offset = mScanOffset;
+        startFrame = mOffsets.size();
+        synced = mScanSynced;
+    }
+
+    ssize_t n = mDataSource->readAt(offset, mBuffer, kChunkSize);
+    if (n < 0) {
+        return n;
+    }
+
+    mFound.clear();
+    size_t pos = 0;
+    while (pos + 6 <= (size_t)n) {
+        const uint8_t *header = mBuffer + pos;
+        const uint8_t *ref = mHaveFixedHeader ? mFixedHeader : header;
+        size_t frameSize, headerSize;
+        if (!matchesAdtsFixedHeader(header, ref)
+                || (frameSize = parseAdtsFrameLength(header, &headerSize)) == 0) {
+            synced = false;
+            ++pos;
+            continue;
+        }
+        if (!synced) {
+            bool truncated;
+            size_t numFrames = countAdtsFrameChain(
+                    header, n - pos, ref, kNumResyncFrames, &truncated);
+            if (truncated && (size_t)n == kChunkSize && pos > 0) {
+                // the next chunk starts here and has all of the chain
+                break;
+            }
+            if (numFrames < kNumResyncFrames && !truncated) {
+                ++pos;
+                continue;
+            }
+            synced = true;
+        }
+        if (!mHaveFixedHeader) {
+            memcpy(mFixedHeader, header, sizeof(mFixedHeader));
+            mHaveFixedHeader = true;
+        }
+        mFound.push(offset + pos);
+        pos += frameSize;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    // sequential playback may have reported some of these meanwhile
+    for (size_t i = mOffsets.size() - startFrame; i < mFound.size(); ++i) {
+        mOffsets.push(mFound.itemAt(i));
+    }
+    if (offset + (off64_t)pos > mScanOffset) {
+        mScanOffset = offset + pos;
+        mScanSynced = synced;
+    }
+    // less than a header left, ID3v1 and APE tags are skipped the same way
+    if (n < 6) {
+        mComplete = true;
+        setDuration_l(mOffsets.size() * mFrameDurationUs);
+        ALOGV("indexed %d frames", mOffsets.size());
+        return ERROR_END_OF_STREAM;
+    }
+    return OK;
+}
+
+void AACFrameIndex::startScan() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mComplete || mScanning) {
+            return;
+        }
+        mScanning = true;
+    }
+
+    if (startScanThread("AACFrameIndex") != OK) {
+        Mutex::Autolock autoLock(mLock);
+        mScanning = false;
+    }
+}
+
+bool AACFrameIndex::scanStep() {
+    status_t err = scanChunk();
+    if (err == OK) {
+        return true;
+    }
+
+    ALOGV("AACFrameIndex scan ended, err %d", err);
+    Mutex::Autolock autoLock(mLock);
+    mScanning = false;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 AACExtractor::AACExtractor(
         const sp<DataSource> &source, const sp<AMessage> &_meta)
     : mDataSource(source),
       mInitCheck(NO_INIT),
+      mFirstFrameOffset(0),
       mFrameDurationUs(0) {
     sp<AMessage> meta = _meta;
 
@@ -203,39 +529,25 @@ AACExtractor::AACExtractor(
     }
     channel = (header[0] & 0x1) << 2 | (header[1] >> 6);
 
-    mMeta = MakeAACCodecSpecificData(profile, sf_index, channel);
-
-    off64_t streamSize, numFrames = 0;
-    size_t frameSize = 0;
-    int64_t duration = 0;
+    // Round up and get the frame duration
+    mFrameDurationUs = (1024 * 1000000ll + (sr - 1)) / sr;
+    mFirstFrameOffset = offset;
+    mFrameIndex = new AACFrameIndex(
+            mDataSource, offset,
+            MakeAACCodecSpecificData(profile, sf_index, channel),
+            mFrameDurationUs);
 
+    off64_t streamSize;
     if (mDataSource->getSize(&streamSize) == OK) {
-         while (offset < streamSize) {
-            if ((frameSize = getAdtsFrameLength(source, offset, NULL)) == 0) {
-				
-				char id3Header[6];
-				if(mDataSource->readAt(offset, id3Header, 6) < 6)
-				{
-					//if the left data len less than 6 ,we think it is normal
-					break;
-				}
-				//ID3V1 ''TAG"      APETAG
-				if((id3Header[0]== 'T'&&id3Header[1] == 'A'&&id3Header[2] =='G')||
-					(id3Header[3]== 'T'&&id3Header[4] == 'A'&&id3Header[5] =='G'))
-					break;
-                return;
-            }
-
-            mOffsetVector.push(offset);
-
-            offset += frameSize;
-            numFrames ++;
+        // Walking the whole file here made opening take as long as reading
+        // it, the duration is estimated from the first frames instead and
+        // becomes exact once the scan below or seeking reaches the end.
+        mFrameIndex->estimateDuration(kNumEstimateFrames, streamSize);
+
+        // a second reader would keep dragging a cache away from playback
+        if (!(mDataSource->flags() & DataSource::kIsCachingDataSource)) {
+            mFrameIndex->startScan();
         }
-
-        // Round up and get the duration
-        mFrameDurationUs = (1024 * 1000000ll + (sr - 1)) / sr;
-        duration = numFrames * mFrameDurationUs;
-        mMeta->setInt64(kKeyDuration, duration);
     }
 
     mInitCheck = OK;
@@ -265,7 +577,8 @@ sp<MediaSource> AACExtractor::getTrack(size_t index) {
         return NULL;
     }
 
-    return new AACSource(mDataSource, mMeta, mOffsetVector, mFrameDurationUs);
+    return new AACSource(
+            mDataSource, mFrameIndex, mFirstFrameOffset, mFrameDurationUs);
 }
 
 sp<MetaData> AACExtractor::getTrackMetaData(size_t index, uint32_t flags) {
@@ -273,7 +586,7 @@ sp<MetaData> AACExtractor::getTrackMetaData(size_t index, uint32_t flags) {
         return NULL;
     }
 
-    return mMeta;
+    return mFrameIndex->getFormat();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -282,16 +595,18 @@ sp<MetaData> AACExtractor::getTrackMetaData(size_t index, uint32_t flags) {
 const size_t AACSource::kMaxFrameSize = 8192;
 
 AACSource::AACSource(
-        const sp<DataSource> &source, const sp<MetaData> &meta,
-        const Vector<uint64_t> &offset_vector,
+        const sp<DataSource> &source,
+        const sp<AACFrameIndex> &frameIndex,
+        off64_t firstFrameOffset,
         int64_t frame_duration_us)
     : mDataSource(source),
-      mMeta(meta),
       mOffset(0),
       mCurrentTimeUs(0),
       mStarted(false),
       mGroup(NULL),
-      mOffsetVector(offset_vector),
+      mFrameIndex(frameIndex),
+      mFirstFrameOffset(firstFrameOffset),
+      mFrame(0),
       mFrameDurationUs(frame_duration_us) {
 }
 
@@ -304,12 +619,8 @@ AACSource::~AACSource() {
 status_t AACSource::start(MetaData *params) {
     CHECK(!mStarted);
 
-    if (mOffsetVector.empty()) {
-        mOffset = 0;
-    } else {
-        mOffset = mOffsetVector.itemAt(0);
-    }
-
+    mOffset = mFirstFrameOffset;
+    mFrame = 0;
     mCurrentTimeUs = 0;
     mGroup = new MediaBufferGroup;
     mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
@@ -329,7 +640,7 @@ status_t AACSource::stop() {
 }
 
 sp<MetaData> AACSource::getFormat() {
-    return mMeta;
+    return mFrameIndex->getFormat();
 }
 
 status_t AACSource::read(
@@ -340,10 +651,18 @@ status_t AACSource::read(
     ReadOptions::SeekMode mode;
     if (options && options->getSeekTo(&seekTimeUs, &mode)) {
         if (mFrameDurationUs > 0) {
-            int64_t seekFrame = seekTimeUs / mFrameDurationUs;
-            mCurrentTimeUs = seekFrame * mFrameDurationUs;
+            int64_t seekFrame =
+                seekTimeUs > 0 ? seekTimeUs / mFrameDurationUs : 0;
 
-            mOffset = mOffsetVector.itemAt(seekFrame);
+            off64_t offset;
+            status_t err = mFrameIndex->findFrame(seekFrame, &offset);
+            if (err != OK) {
+                return err;
+            }
+
+            mOffset = offset;
+            mFrame = seekFrame;
+            mCurrentTimeUs = seekFrame * mFrameDurationUs;
         }
     }
 
@@ -371,7 +690,11 @@ status_t AACSource::read(
     buffer->meta_data()->setInt64(kKeyTime, mCurrentTimeUs);
     buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
 
+    // keeps the index growing when nothing scans ahead of playback
+    mFrameIndex->addFrame(mFrame, mOffset, frameSize);
+
     mOffset += frameSize;
+    mFrame++;
     mCurrentTimeUs += mFrameDurationUs;
 
     *out = buffer;
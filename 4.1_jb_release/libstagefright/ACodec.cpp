@@ -911,7 +911,7 @@ status_t ACodec::configureCodec(
             err = setupG711Codec(encoder, numChannels);
         }
     } else if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_FLAC)) {
-        int32_t numChannels, sampleRate, compressionLevel = -1;
+        int32_t numChannels, sampleRate, compressionLevel = -1, numThreads = -1;
         if (encoder &&
                 (!msg->findInt32("channel-count", &numChannels)
                         || !msg->findInt32("sample-rate", &sampleRate))) {
@@ -928,8 +928,14 @@ status_t ACodec::configureCodec(
                     ALOGW("compression level %d outside [0..8] range, using 8", compressionLevel);
                     compressionLevel = 8;
                 }
+                // 0 is one thread per CPU, only encoders that support
+                // parallel encoding take it.
+                if (!msg->findInt32("flac-encoder-threads", &numThreads)) {
+                    numThreads = -1;
+                }
             }
-            err = setupFlacCodec(encoder, numChannels, sampleRate, compressionLevel);
+            err = setupFlacCodec(
+                    encoder, numChannels, sampleRate, compressionLevel, numThreads);
         }
     } else if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_RAW)) {
         int32_t numChannels, sampleRate;
@@ -1213,7 +1219,8 @@ status_t ACodec::setupG711Codec(bool encoder, int32_t numChannels) {
 }
 
 status_t ACodec::setupFlacCodec(
-        bool encoder, int32_t numChannels, int32_t sampleRate, int32_t compressionLevel) {
+        bool encoder, int32_t numChannels, int32_t sampleRate, int32_t compressionLevel,
+        int32_t numThreads) {
 
     if (encoder) {
         OMX_AUDIO_PARAM_FLACTYPE def;
@@ -1232,6 +1239,28 @@ status_t ACodec::setupFlacCodec(
             ALOGE("setupFlacCodec(): Error %d setting OMX_IndexParamAudioFlac parameter", err);
             return err;
         }
+
+        if (numThreads >= 0) {
+            OMX_INDEXTYPE index;
+            err = mOMX->getExtensionIndex(
+                    mNode, "OMX.google.android.index.flacEncoderThreads", &index);
+            if (err != OK) {
+                ALOGE("setupFlacCodec(): %s has no encoder threads extension",
+                        mComponentName.c_str());
+                return err;
+            }
+
+            OMX_PARAM_U32TYPE threads;
+            InitOMXParams(&threads);
+            threads.nPortIndex = kPortIndexOutput;
+            threads.nU32 = numThreads;
+            err = mOMX->setParameter(mNode, index, &threads, sizeof(threads));
+            if (err != OK) {
+                ALOGE("setupFlacCodec(): Error %d setting %d encoder threads",
+                        err, numThreads);
+                return err;
+            }
+        }
     }
 
     return setupRawAudioFormat(
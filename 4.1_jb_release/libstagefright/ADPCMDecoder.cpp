@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ADPCMDecoder"
+#include <utils/Log.h>
+
+#include "include/ADPCMDecoder.h"
+
+#include <limits.h>
+
+namespace android {
+
+static inline int16_t S16_LE_AT(const uint8_t *ptr) {
+    return (int16_t)(ptr[1] << 8 | ptr[0]);
+}
+
+static inline int16_t clamp16(int32_t x) {
+    if (x > 32767) {
+        return 32767;
+    }
+    if (x < -32768) {
+        return -32768;
+    }
+    return x;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The standard coefficient sets, the "fmt " chunk carries the same seven.
+static const int32_t kMSCoef1[7] = { 256, 512, 0, 192, 240, 460, 392 };
+static const int32_t kMSCoef2[7] = { 0, -256, 0, 64, 0, -208, -232 };
+
+static const int32_t kMSAdaptation[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+struct MSADPCMChannel {
+    int32_t mCoef1;
+    int32_t mCoef2;
+    int32_t mDelta;
+    int32_t mSample1;
+    int32_t mSample2;
+
+    inline int16_t expand(uint32_t nibble) {
+        int32_t predictor = (mSample1 * mCoef1 + mSample2 * mCoef2) >> 8;
+        int32_t sample = clamp16(
+                predictor + ((int32_t)(nibble << 28) >> 28) * mDelta);
+
+        mDelta = (kMSAdaptation[nibble] * mDelta) >> 8;
+        if (mDelta < 16) {
+            mDelta = 16;
+        } else if (mDelta > INT_MAX / 768) {
+            // only a broken stream gets here, keep it from overflowing
+            mDelta = INT_MAX / 768;
+        }
+
+        mSample2 = mSample1;
+        mSample1 = sample;
+
+        return sample;
+    }
+};
+
+size_t MSADPCMMaxSamplesPerBlock(size_t blockAlign, size_t numChannels) {
+    if (numChannels == 0 || blockAlign < 7 * numChannels) {
+        return 0;
+    }
+    return (blockAlign - 7 * numChannels) * 2 / numChannels + 2;
+}
+
+// Block header: a predictor index, the initial delta and the two most
+// recent samples for each channel, oldest sample first in the output.
+// The nibbles follow, high nibble first, channels interleaved.
+void DecodeMSADPCMBlocks(
+        int16_t *dst, const uint8_t *src, size_t numBlocks,
+        size_t blockAlign, size_t samplesPerBlock, size_t numChannels) {
+    MSADPCMChannel state[2];
+
+    for (size_t b = 0; b < numBlocks; ++b) {
+        const uint8_t *p = src + b * blockAlign;
+        int16_t *out = dst + b * samplesPerBlock * numChannels;
+
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            uint32_t predictor = p[ch];
+            if (predictor > 6) {
+                predictor = 0;
+            }
+            state[ch].mCoef1 = kMSCoef1[predictor];
+            state[ch].mCoef2 = kMSCoef2[predictor];
+            state[ch].mDelta = S16_LE_AT(p + numChannels + 2 * ch);
+            state[ch].mSample1 = S16_LE_AT(p + 3 * numChannels + 2 * ch);
+            state[ch].mSample2 = S16_LE_AT(p + 5 * numChannels + 2 * ch);
+
+            out[ch] = state[ch].mSample2;
+            if (samplesPerBlock > 1) {
+                out[numChannels + ch] = state[ch].mSample1;
+            }
+        }
+
+        if (samplesPerBlock <= 2) {
+            continue;
+        }
+
+        const uint8_t *data = p + 7 * numChannels;
+        out += 2 * numChannels;
+        size_t numNibbles = (samplesPerBlock - 2) * numChannels;
+
+        if (numChannels == 2) {
+            MSADPCMChannel &left = state[0];
+            MSADPCMChannel &right = state[1];
+            for (size_t i = 0; i < numNibbles; i += 2) {
+                uint32_t x = *data++;
+                out[i] = left.expand(x >> 4);
+                out[i + 1] = right.expand(x & 0x0f);
+            }
+        } else {
+            MSADPCMChannel &mono = state[0];
+            size_t i = 0;
+            for (; i + 2 <= numNibbles; i += 2) {
+                uint32_t x = *data++;
+                out[i] = mono.expand(x >> 4);
+                out[i + 1] = mono.expand(x & 0x0f);
+            }
+            if (i < numNibbles) {
+                out[i] = mono.expand(*data >> 4);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const int32_t kIMAStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int32_t kIMAIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline int32_t imaExpand(
+        uint32_t nibble, int32_t *predictor, int32_t *index) {
+    int32_t step = kIMAStepTable[*index];
+
+    int32_t diff = step >> 3;
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+
+    *predictor = clamp16((nibble & 8) ? *predictor - diff : *predictor + diff);
+
+    *index += kIMAIndexTable[nibble];
+    if (*index < 0) {
+        *index = 0;
+    } else if (*index > 88) {
+        *index = 88;
+    }
+
+    return *predictor;
+}
+
+size_t IMAADPCMMaxSamplesPerBlock(size_t blockAlign, size_t numChannels) {
+    if (numChannels == 0 || blockAlign < 4 * numChannels) {
+        return 0;
+    }
+    return (blockAlign - 4 * numChannels) * 2 / numChannels + 1;
+}
+
+// Block header: the first sample and the step index for each channel.
+// The nibbles follow in groups of eight samples, 4 bytes per channel in
+// turn, low nibble first.
+void DecodeIMAADPCMBlocks(
+        int16_t *dst, const uint8_t *src, size_t numBlocks,
+        size_t blockAlign, size_t samplesPerBlock, size_t numChannels) {
+    for (size_t b = 0; b < numBlocks; ++b) {
+        const uint8_t *p = src + b * blockAlign;
+        int16_t *out = dst + b * samplesPerBlock * numChannels;
+
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            int32_t predictor = S16_LE_AT(p + 4 * ch);
+            int32_t index = p[4 * ch + 2];
+            if (index > 88) {
+                index = 88;
+            }
+
+            int16_t *o = out + ch;
+            *o = predictor;
+            o += numChannels;
+
+            const uint8_t *data = p + 4 * numChannels + 4 * ch;
+            size_t remaining = samplesPerBlock - 1;
+            while (remaining >= 8) {
+                for (size_t i = 0; i < 4; ++i) {
+                    uint32_t x = data[i];
+                    o[0] = imaExpand(x & 0x0f, &predictor, &index);
+                    o[numChannels] = imaExpand(x >> 4, &predictor, &index);
+                    o += 2 * numChannels;
+                }
+                data += 4 * numChannels;
+                remaining -= 8;
+            }
+            for (size_t i = 0; i < remaining; ++i) {
+                uint32_t x = data[i / 2];
+                *o = imaExpand((i & 1) ? x >> 4 : x & 0x0f, &predictor, &index);
+                o += numChannels;
+            }
+        }
+    }
+}
+
+}  // namespace android
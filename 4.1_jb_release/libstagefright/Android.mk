@@ -23,11 +23,13 @@ LOCAL_SRC_FILES:=                         \
         ACodec.cpp                        \
         AACExtractor.cpp                  \
         AACWriter.cpp                     \
+        ADPCMDecoder.cpp                  \
         AMRExtractor.cpp                  \
         AMRWriter.cpp                     \
         AudioPlayer.cpp                   \
         AudioSource.cpp                   \
         AwesomePlayer.cpp                 \
+        BackgroundScanner.cpp             \
         CameraSource.cpp                  \
         CameraSourceTimeLapse.cpp         \
         DataSource.cpp                    \
@@ -54,12 +56,16 @@ LOCAL_SRC_FILES:=                         \
         OMXClient.cpp                     \
         OMXCodec.cpp                      \
         OggExtractor.cpp                  \
+        PCMCaptureDSP.cpp                 \
+        PCMConversion.cpp                 \
+        PCMRingBuffer.cpp                 \
         SkipCutBuffer.cpp                 \
         StagefrightMediaScanner.cpp       \
         StagefrightMetadataRetriever.cpp  \
         SurfaceMediaSource.cpp            \
         ThrottledSource.cpp               \
         TimeSource.cpp                    \
+        TimeStretcher.cpp                 \
         TimedEventQueue.cpp               \
         Utils.cpp                         \
         VBRISeeker.cpp                    \
@@ -130,14 +136,36 @@ LOCAL_STATIC_LIBRARIES := \
 	libstagefright_id3 \
         libFLAC \
         libstagefright_version
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_avcenc_avx2 \
+        libstagefright_m4vh263dec_avx2 \
+        libstagefright_aacenc_avx2 \
+        libstagefright_mp3dec_sse41 \
+        libstagefright_mp3dec_avx2 \
+        libstagefright_aacdec_sse41 \
+        libstagefright_aacdec_avx2 \
+        libstagefright_x86_cpu
+endif
+
+# ATSParser and friends are built from source, the prebuilt archive below
+# only carries MPEG2TSExtractor which must be resolved against them.
+LOCAL_WHOLE_STATIC_LIBRARIES := \
+        libstagefright_mpeg2ts \
+        libstagefright_mp4 \
+        libstagefright_matroska \
+        libstagefright_httplive
       
+# matroska/libstagefright_matroska_prebuilt.a is the former vendor Matroska
+# extractor with every symbol it defines renamed by
+#   llvm-objcopy --redefine-syms=matroska/prebuilt_symbols.map
+# (the map is made by matroska/prebuilt_symbols.sh) so it links next to the
+# source one, which falls back to it for the tracks it does not handle.
 LOCAL_LDFLAGS :=  \
-							$(LOCAL_PATH)/matroska/libstagefright_matroska.a \
-							$(LOCAL_PATH)/mpeg2ts/libstagefright_mpeg2ts.a \
-							$(LOCAL_PATH)/httplive/libstagefright_httplive.a \
+							$(LOCAL_PATH)/mpeg2ts/libstagefright_mpeg2tsextractor.a \
+							$(LOCAL_PATH)/matroska/libstagefright_matroska_prebuilt.a \
 							$(LOCAL_PATH)/ffmpg/libstagefright_ffmpg.a \
 							$(LOCAL_PATH)/libstagefright_framemanage.a \
-							$(LOCAL_PATH)/mpeg4/libstagefright_mp4.a \
 							$(LOCAL_PATH)/codecs/ac3dec/libstagefright_ac3dec.a \
 							$(LOCAL_PATH)/codecs/radec/libstagefright_radec.a \
 							$(LOCAL_PATH)/codecs/dtsdec/libstagefright_dtsdec.a \
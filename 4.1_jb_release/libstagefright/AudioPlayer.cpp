@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include <binder/IPCThreadState.h>
+#include <cutils/atomic.h>
 #include <media/AudioTrack.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
@@ -27,35 +28,62 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MetaData.h>
+#include <sys/prctl.h>
 
 #include "include/AwesomePlayer.h"
+#include "include/PCMRingBuffer.h"
+#include "include/TimeStretcher.h"
 
 namespace android {
 
+// How far the decode thread keeps ahead of the audio callback, at least.
+static const int64_t kRingDurationUs = 400000ll;
+static const size_t kNumRingTags = 256;
+
 AudioPlayer::AudioPlayer(
         const sp<MediaPlayerBase::AudioSink> &audioSink,
         bool allowDeepBuffering,
         AwesomePlayer *observer)
     : mAudioTrack(NULL),
-      mInputBuffer(NULL),
       mSampleRate(0),
-      mLatencyUs(0),
       mFrameSize(0),
+      mRing(NULL),
+      mInputBuffer(NULL),
+      mInputBufferTagged(false),
+      mDecodeEpoch(0),
+      mDecodeReachedEnd(false),
+      mDecodeThreadStarted(false),
+      mDecodeThreadExit(false),
+      mDecodeWakeups(0),
+      mSeekEpoch(0),
+      mFlushEpoch(0),
+      mFlushSysTimeUs(0),
+      mPausedSysTimeUs(-1ll),
+      mCallbackSeekEpoch(0),
+      mCallbackFlushEpoch(0),
+      mCallbackSynced(false),
+      mCallbackAtEnd(false),
+      mLatencyUs(0),
       mNumFramesPlayed(0),
       mNumFramesPlayedSysTimeUs(ALooper::GetNowUs()),
+      mMediaFramesPlayedPermille(0),
+      mTimeStretcher(NULL),
+      mCallbackRatePermille(1000),
       mPositionTimeMediaUs(-1),
       mPositionTimeRealUs(-1),
-      mSeeking(false),
+      mPinnedTimeUs(-1ll),
       mReachedEOS(false),
       mFinalStatus(OK),
+      mTimeMappingSeq(0),
+      mTimeStretchRatePermille(1000),
+      mSinkRatePermille(1000),
+      mSeeking(false),
+      mSeekTimeUs(0),
       mStarted(false),
-      mIsFirstBuffer(false),
-      mFirstBufferResult(OK),
-      mFirstBuffer(NULL),
       mAudioSink(audioSink),
       mAllowDeepBuffering(allowDeepBuffering),
-      mObserver(observer),
-      mPinnedTimeUs(-1ll) {
+      mObserver(observer) {
+    publishTimeMapping();
 }
 
 AudioPlayer::~AudioPlayer() {
@@ -85,9 +113,9 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
     // We allow an optional INFO_FORMAT_CHANGED at the very beginning
     // of playback, if there is one, getFormat below will retrieve the
     // updated format, if there isn't, we'll stash away the valid buffer
-    // of data to be used on the first audio callback.
+    // of data to be queued ahead of the first audio callback.
 
-    CHECK(mFirstBuffer == NULL);
+    CHECK(mInputBuffer == NULL);
 
     MediaSource::ReadOptions options;
     if (mSeeking) {
@@ -95,15 +123,13 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
         mSeeking = false;
     }
 
-    mFirstBufferResult = mSource->read(&mFirstBuffer, &options);
-    if (mFirstBufferResult == INFO_FORMAT_CHANGED) {
+    MediaBuffer *firstBuffer;
+    status_t firstBufferResult = mSource->read(&firstBuffer, &options);
+    if (firstBufferResult == INFO_FORMAT_CHANGED) {
         ALOGV("INFO_FORMAT_CHANGED!!!");
 
-        CHECK(mFirstBuffer == NULL);
-        mFirstBufferResult = OK;
-        mIsFirstBuffer = false;
-    } else {
-        mIsFirstBuffer = true;
+        CHECK(firstBuffer == NULL);
+        firstBufferResult = OK;
     }
 
     sp<MetaData> format = mSource->getFormat();
@@ -126,6 +152,7 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
         channelMask = CHANNEL_MASK_USE_CHANNEL_ORDER;
     }
 
+    size_t sinkBufferSize;
     if (mAudioSink.get() != NULL) {
 
         status_t err = mAudioSink->open(
@@ -137,9 +164,9 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
                             AUDIO_OUTPUT_FLAG_DEEP_BUFFER :
                             AUDIO_OUTPUT_FLAG_NONE));
         if (err != OK) {
-            if (mFirstBuffer != NULL) {
-                mFirstBuffer->release();
-                mFirstBuffer = NULL;
+            if (firstBuffer != NULL) {
+                firstBuffer->release();
+                firstBuffer = NULL;
             }
 
             if (!sourceAlreadyStarted) {
@@ -151,8 +178,7 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
 
         mLatencyUs = (int64_t)mAudioSink->latency() * 1000;
         mFrameSize = mAudioSink->frameSize();
-
-        mAudioSink->start();
+        sinkBufferSize = mAudioSink->bufferSize();
     } else {
         // playing to an AudioTrack, set up mask if necessary
         audio_channel_mask_t audioMask = channelMask == CHANNEL_MASK_USE_CHANNEL_ORDER ?
@@ -169,9 +195,9 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
             delete mAudioTrack;
             mAudioTrack = NULL;
 
-            if (mFirstBuffer != NULL) {
-                mFirstBuffer->release();
-                mFirstBuffer = NULL;
+            if (firstBuffer != NULL) {
+                firstBuffer->release();
+                firstBuffer = NULL;
             }
 
             if (!sourceAlreadyStarted) {
@@ -183,12 +209,60 @@ status_t AudioPlayer::start(bool sourceAlreadyStarted) {
 
         mLatencyUs = (int64_t)mAudioTrack->latency() * 1000;
         mFrameSize = mAudioTrack->frameSize();
+        sinkBufferSize = mAudioTrack->frameCount() * mFrameSize;
+    }
+
+    if (numChannels <= 2) {
+        mTimeStretcher = new TimeStretcher(mSampleRate, numChannels);
+    }
 
+    // Deep enough to ride out a slow decode or a seek, and to always
+    // have more than the sink asks for in one go.
+    size_t ringSize = mSampleRate * mFrameSize * kRingDurationUs / 1000000ll;
+    if (ringSize < 2 * sinkBufferSize) {
+        ringSize = 2 * sinkBufferSize;
+    }
+    mRing = new PCMRingBuffer(ringSize, kNumRingTags);
+
+    mDecodeEpoch = mSeekEpoch;
+    mCallbackSeekEpoch = mSeekEpoch;
+    mCallbackFlushEpoch = mFlushEpoch;
+    mCallbackSynced = false;
+    mCallbackAtEnd = false;
+    publishTimeMapping();
+
+    // The first buffer is queued right away so that the first callback
+    // finds it.
+    if (firstBufferResult != OK) {
+        PCMRingBuffer::Tag tag;
+        tag.mEpoch = mDecodeEpoch;
+        tag.mTimeUs = 0;
+        tag.mStatus = firstBufferResult;
+        mRing->writeTag(tag);
+
+        mDecodeReachedEnd = true;
+    } else if (firstBuffer != NULL) {
+        mInputBuffer = firstBuffer;
+        mInputBufferTagged = false;
+        queueInputBuffer();
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    mDecodeThreadExit = false;
+    pthread_create(&mDecodeThread, &attr, DecodeThreadWrapper, this);
+    pthread_attr_destroy(&attr);
+    mDecodeThreadStarted = true;
+
+    if (mAudioSink.get() != NULL) {
+        mAudioSink->start();
+    } else {
         mAudioTrack->start();
     }
 
     mStarted = true;
-    mPinnedTimeUs = -1ll;
 
     return OK;
 }
@@ -203,8 +277,9 @@ void AudioPlayer::pause(bool playPendingSamples) {
             mAudioTrack->stop();
         }
 
-        mNumFramesPlayed = 0;
-        mNumFramesPlayedSysTimeUs = ALooper::GetNowUs();
+        Mutex::Autolock autoLock(mLock);
+        android_atomic_inc(&mFlushEpoch);
+        mFlushSysTimeUs = ALooper::GetNowUs();
     } else {
         if (mAudioSink.get() != NULL) {
             mAudioSink->pause();
@@ -212,7 +287,8 @@ void AudioPlayer::pause(bool playPendingSamples) {
             mAudioTrack->pause();
         }
 
-        mPinnedTimeUs = ALooper::GetNowUs();
+        Mutex::Autolock autoLock(mLock);
+        mPausedSysTimeUs = ALooper::GetNowUs();
     }
 }
 
@@ -239,14 +315,17 @@ void AudioPlayer::reset() {
         mAudioTrack = NULL;
     }
 
+    stopDecodeThread();
+
+    delete mTimeStretcher;
+    mTimeStretcher = NULL;
+
+    delete mRing;
+    mRing = NULL;
+
     // Make sure to release any buffer we hold onto so that the
     // source is able to stop().
 
-    if (mFirstBuffer != NULL) {
-        mFirstBuffer->release();
-        mFirstBuffer = NULL;
-    }
-
     if (mInputBuffer != NULL) {
         ALOGV("AudioPlayer releasing input buffer.");
 
@@ -266,13 +345,23 @@ void AudioPlayer::reset() {
     }
     IPCThreadState::self()->flushCommands();
 
+    // Neither the callback nor the decode thread runs anymore.
+    mDecodeReachedEnd = false;
+    mCallbackSeekEpoch = mSeekEpoch;
+    mCallbackFlushEpoch = mFlushEpoch;
     mNumFramesPlayed = 0;
     mNumFramesPlayedSysTimeUs = ALooper::GetNowUs();
+    mMediaFramesPlayedPermille = 0;
     mPositionTimeMediaUs = -1;
     mPositionTimeRealUs = -1;
-    mSeeking = false;
+    mPinnedTimeUs = -1ll;
     mReachedEOS = false;
     mFinalStatus = OK;
+    publishTimeMapping();
+
+    mPausedSysTimeUs = -1ll;
+    mSeeking = false;
+    mSeekTimeUs = 0;
     mStarted = false;
 }
 
@@ -290,18 +379,49 @@ bool AudioPlayer::reachedEOS(status_t *finalStatus) {
     *finalStatus = OK;
 
     Mutex::Autolock autoLock(mLock);
-    *finalStatus = mFinalStatus;
-    return mReachedEOS;
+
+    TimeMapping mapping;
+    getTimeMappingLocked(&mapping);
+
+    *finalStatus = mapping.mFinalStatus;
+    return mapping.mReachedEOS;
 }
 
 status_t AudioPlayer::setPlaybackRatePermille(int32_t ratePermille) {
+    if (mTimeStretcher != NULL
+            && ratePermille >= TimeStretcher::kMinRatePermille
+            && ratePermille <= TimeStretcher::kMaxRatePermille) {
+        if (mSinkRatePermille != 1000) {
+            status_t err = setSinkPlaybackRatePermille(1000);
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        android_atomic_release_store(ratePermille, &mTimeStretchRatePermille);
+        return OK;
+    }
+
+    android_atomic_release_store(1000, &mTimeStretchRatePermille);
+
+    return setSinkPlaybackRatePermille(ratePermille);
+}
+
+status_t AudioPlayer::setSinkPlaybackRatePermille(int32_t ratePermille) {
+    status_t err;
     if (mAudioSink.get() != NULL) {
-        return mAudioSink->setPlaybackRatePermille(ratePermille);
+        err = mAudioSink->setPlaybackRatePermille(ratePermille);
     } else if (mAudioTrack != NULL){
-        return mAudioTrack->setSampleRate(ratePermille * mSampleRate / 1000);
+        err = mAudioTrack->setSampleRate(ratePermille * mSampleRate / 1000);
     } else {
         return NO_INIT;
     }
+
+    if (err == OK) {
+        mSinkRatePermille = ratePermille;
+    }
+
+    return err;
 }
 
 // static
@@ -324,7 +444,7 @@ void AudioPlayer::AudioCallback(int event, void *info) {
     buffer->size = numBytesWritten;
 }
 
-uint32_t AudioPlayer::getNumFramesPendingPlayout() const {
+uint32_t AudioPlayer::getNumFramesPendingPlayout(int64_t numFramesPlayed) const {
     uint32_t numFramesPlayedOut;
     status_t err;
 
@@ -334,118 +454,305 @@ uint32_t AudioPlayer::getNumFramesPendingPlayout() const {
         err = mAudioTrack->getPosition(&numFramesPlayedOut);
     }
 
-    if (err != OK || mNumFramesPlayed < numFramesPlayedOut) {
+    if (err != OK || numFramesPlayed < numFramesPlayedOut) {
         return 0;
     }
 
-    // mNumFramesPlayed is the number of frames submitted
+    // numFramesPlayed is the number of frames submitted
     // to the audio sink for playback, but not all of them
     // may have played out by now.
-    return mNumFramesPlayed - numFramesPlayedOut;
+    return numFramesPlayed - numFramesPlayedOut;
 }
 
-size_t AudioPlayer::fillBuffer(void *data, size_t size) {
-    if (mNumFramesPlayed == 0) {
-        ALOGV("AudioCallback");
-    }
+// static
+void *AudioPlayer::DecodeThreadWrapper(void *me) {
+    static_cast<AudioPlayer *>(me)->decodeThread();
 
-    if (mReachedEOS) {
-        return 0;
-    }
+    return NULL;
+}
 
-    bool postSeekComplete = false;
-    bool postEOS = false;
-    int64_t postEOSDelayUs = 0;
+// Keeps mRing topped up from the source, and tells the observer about
+// seeks and the end of the stream so that the callback doesn't have to.
+void AudioPlayer::decodeThread() {
+    prctl(PR_SET_NAME, (unsigned long)"AudioPlayerDecode", 0, 0, 0);
+    androidSetThreadPriority(0, ANDROID_PRIORITY_AUDIO);
 
-    size_t size_done = 0;
-    size_t size_remaining = size;
-    while (size_remaining > 0) {
-        MediaSource::ReadOptions options;
+    bool seekPending = false;
+    int64_t seekTimeUs = 0;
+    bool eosPosted = false;
+
+    for (;;) {
+        bool postEOS = false;
+        int64_t postEOSDelayUs = 0;
 
         {
             Mutex::Autolock autoLock(mLock);
 
-            if (mSeeking) {
-                if (mIsFirstBuffer) {
-                    if (mFirstBuffer != NULL) {
-                        mFirstBuffer->release();
-                        mFirstBuffer = NULL;
+            for (;;) {
+                // Taken before looking at anything that changes without
+                // mLock, a wakeup in between makes the wait below return.
+                int32_t wakeups;
+                {
+                    Mutex::Autolock wakeLock(mDecodeWakeLock);
+                    wakeups = mDecodeWakeups;
+                }
+
+                if (mDecodeThreadExit) {
+                    return;
+                }
+
+                if (mSeekEpoch != mDecodeEpoch) {
+                    mDecodeEpoch = mSeekEpoch;
+                    seekPending = true;
+                    seekTimeUs = mSeekTimeUs;
+
+                    if (mInputBuffer != NULL) {
+                        mInputBuffer->release();
+                        mInputBuffer = NULL;
                     }
-                    mIsFirstBuffer = false;
+                    mDecodeReachedEnd = false;
+                    eosPosted = false;
                 }
 
-                options.setSeekTo(mSeekTimeUs);
+                TimeMapping mapping;
+                getTimeMappingLocked(&mapping);
+
+                if (mapping.mReachedEOS && !eosPosted) {
+                    eosPosted = true;
+
+                    if (mObserver) {
+                        // We don't want to post EOS right away but only
+                        // after all frames have actually been played out.
+
+                        // These are the number of frames submitted to the
+                        // AudioTrack that you haven't heard yet.
+                        uint32_t numFramesPendingPlayout =
+                            getNumFramesPendingPlayout(mapping.mNumFramesPlayed);
+
+                        int64_t timeToCompletionUs =
+                            (1000000ll * numFramesPendingPlayout) / mSampleRate;
+
+                        ALOGV("total number of frames played: %lld (%lld us)",
+                                mapping.mNumFramesPlayed,
+                                1000000ll * mapping.mNumFramesPlayed / mSampleRate);
+
+                        ALOGV("%d frames left to play, %lld us (%.2f secs)",
+                             numFramesPendingPlayout,
+                             timeToCompletionUs, timeToCompletionUs / 1E6);
+
+                        postEOS = true;
+                        if (mAudioSink->needsTrailingPadding()) {
+                            postEOSDelayUs = timeToCompletionUs + mapping.mLatencyUs;
+                        } else {
+                            postEOSDelayUs = 0;
+                        }
+                        break;
+                    }
+                }
 
                 if (mInputBuffer != NULL) {
-                    mInputBuffer->release();
-                    mInputBuffer = NULL;
+                    if (mRing->getWritableBytes() > 0) {
+                        break;
+                    }
+                } else if (!mDecodeReachedEnd && mRing->canWriteTag()) {
+                    break;
                 }
 
-                mSeeking = false;
-                if (mObserver) {
-                    postSeekComplete = true;
+                // Nothing to do until the callback makes room or reaches
+                // the end, or seekTo() or stopDecodeThread() come along.
+                mLock.unlock();
+                {
+                    Mutex::Autolock wakeLock(mDecodeWakeLock);
+                    while (mDecodeWakeups == wakeups) {
+                        mDecodeCondition.wait(mDecodeWakeLock);
+                    }
                 }
+                mLock.lock();
             }
         }
 
-        if (mInputBuffer == NULL) {
-            status_t err;
-
-            if (mIsFirstBuffer) {
-                mInputBuffer = mFirstBuffer;
-                mFirstBuffer = NULL;
-                err = mFirstBufferResult;
+        if (postEOS) {
+            mObserver->postAudioEOS(postEOSDelayUs);
+            continue;
+        }
 
-                mIsFirstBuffer = false;
-            } else {
-                err = mSource->read(&mInputBuffer, &options);
+        if (mInputBuffer == NULL) {
+            MediaSource::ReadOptions options;
+            bool seeking = seekPending;
+            if (seekPending) {
+                options.setSeekTo(seekTimeUs);
+                seekPending = false;
             }
 
+            status_t err = mSource->read(&mInputBuffer, &options);
+
             CHECK((err == OK && mInputBuffer != NULL)
                    || (err != OK && mInputBuffer == NULL));
 
-            Mutex::Autolock autoLock(mLock);
-
-            if (err != OK) {
-                if (mObserver && !mReachedEOS) {
-                    // We don't want to post EOS right away but only
-                    // after all frames have actually been played out.
-
-                    // These are the number of frames submitted to the
-                    // AudioTrack that you haven't heard yet.
-                    uint32_t numFramesPendingPlayout =
-                        getNumFramesPendingPlayout();
-
-                    // These are the number of frames we're going to
-                    // submit to the AudioTrack by returning from this
-                    // callback.
-                    uint32_t numAdditionalFrames = size_done / mFrameSize;
-
-                    numFramesPendingPlayout += numAdditionalFrames;
-
-                    int64_t timeToCompletionUs =
-                        (1000000ll * numFramesPendingPlayout) / mSampleRate;
-
-                    ALOGV("total number of frames played: %lld (%lld us)",
-                            (mNumFramesPlayed + numAdditionalFrames),
-                            1000000ll * (mNumFramesPlayed + numAdditionalFrames)
-                                / mSampleRate);
-
-                    ALOGV("%d frames left to play, %lld us (%.2f secs)",
-                         numFramesPendingPlayout,
-                         timeToCompletionUs, timeToCompletionUs / 1E6);
-
-                    postEOS = true;
-                    if (mAudioSink->needsTrailingPadding()) {
-                        postEOSDelayUs = timeToCompletionUs + mLatencyUs;
-                    } else {
-                        postEOSDelayUs = 0;
+            if (seeking) {
+                // The seek is done once the source is there, as far as
+                // no later one has come in meanwhile, which completes in
+                // its turn.
+                bool postSeekComplete = false;
+                {
+                    Mutex::Autolock autoLock(mLock);
+                    if (mSeekEpoch == mDecodeEpoch) {
+                        mSeeking = false;
+                        postSeekComplete = mObserver != NULL;
                     }
                 }
 
-                mReachedEOS = true;
-                mFinalStatus = err;
-                break;
+                if (postSeekComplete) {
+                    mObserver->postAudioSeekComplete();
+                }
+            }
+
+            if (err != OK) {
+                PCMRingBuffer::Tag tag;
+                tag.mEpoch = mDecodeEpoch;
+                tag.mTimeUs = 0;
+                tag.mStatus = err;
+                CHECK(mRing->writeTag(tag));
+
+                mDecodeReachedEnd = true;
+                continue;
+            }
+
+            mInputBufferTagged = false;
+        }
+
+        queueInputBuffer();
+    }
+}
+
+// Copies what there is room for, tagging the buffer with its timestamp
+// before any of it goes in.
+void AudioPlayer::queueInputBuffer() {
+    if (!mInputBufferTagged) {
+        PCMRingBuffer::Tag tag;
+        tag.mEpoch = mDecodeEpoch;
+        tag.mStatus = OK;
+        CHECK(mInputBuffer->meta_data()->findInt64(kKeyTime, &tag.mTimeUs));
+        CHECK(mRing->writeTag(tag));
+
+        // A partial frame would throw every frame after it off.
+        mInputBuffer->set_range(
+                mInputBuffer->range_offset(),
+                mInputBuffer->range_length()
+                    - mInputBuffer->range_length() % mFrameSize);
+
+        mInputBufferTagged = true;
+    }
+
+    size_t n = mRing->write(
+            (const uint8_t *)mInputBuffer->data() + mInputBuffer->range_offset(),
+            mInputBuffer->range_length());
+
+    mInputBuffer->set_range(mInputBuffer->range_offset() + n,
+                            mInputBuffer->range_length() - n);
+
+    if (mInputBuffer->range_length() == 0) {
+        mInputBuffer->release();
+        mInputBuffer = NULL;
+    }
+}
+
+void AudioPlayer::stopDecodeThread() {
+    if (!mDecodeThreadStarted) {
+        return;
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mDecodeThreadExit = true;
+        wakeDecodeThread();
+    }
+
+    void *dummy;
+    pthread_join(mDecodeThread, &dummy);
+    mDecodeThreadStarted = false;
+}
+
+// mDecodeWakeLock is only ever held for a moment and around nothing else,
+// the callback may take it.
+void AudioPlayer::wakeDecodeThread() {
+    Mutex::Autolock wakeLock(mDecodeWakeLock);
+    ++mDecodeWakeups;
+    mDecodeCondition.signal();
+}
+
+// Runs on the sink's realtime thread: it only reads from mRing, never
+// waits for the source or takes mLock, and hands its clock to everybody
+// else through publishTimeMapping(). Seeks and flushes reach it through
+// the epoch counters. Having made room it wakes the decode thread.
+size_t AudioPlayer::fillBuffer(void *data, size_t size) {
+    if (mNumFramesPlayed == 0) {
+        ALOGV("AudioCallback");
+    }
+
+    int32_t flushEpoch = android_atomic_acquire_load(&mFlushEpoch);
+    if (flushEpoch != mCallbackFlushEpoch) {
+        // The sink starts counting from 0 again.
+        mCallbackFlushEpoch = flushEpoch;
+        mNumFramesPlayed = 0;
+        mMediaFramesPlayedPermille = 0;
+    }
+
+    int32_t seekEpoch = android_atomic_acquire_load(&mSeekEpoch);
+    if (seekEpoch != mCallbackSeekEpoch) {
+        mCallbackSeekEpoch = seekEpoch;
+        mCallbackSynced = false;
+        mCallbackAtEnd = false;
+        mPositionTimeMediaUs = -1;
+        mPositionTimeRealUs = -1;
+        mReachedEOS = false;
+        mFinalStatus = OK;
+
+        if (mTimeStretcher != NULL) {
+            mTimeStretcher->reset();
+        }
+    }
+
+    if (mReachedEOS) {
+        return 0;
+    }
+
+    // set once there is room in mRing, or the end is reached
+    bool wakeDecoder = false;
+
+    if (!mCallbackSynced) {
+        // Whatever was decoded before the seek is of no use anymore.
+        mCallbackSynced = mRing->skipToEpoch(seekEpoch);
+        wakeDecoder = true;
+    }
+
+    int32_t ratePermille =
+        android_atomic_acquire_load(&mTimeStretchRatePermille);
+
+    // Once back at the normal rate the stretcher plays out what it holds,
+    // after that the buffers are copied as they are.
+    bool stretching = false;
+    if (mTimeStretcher != NULL) {
+        mTimeStretcher->setRatePermille(ratePermille);
+        stretching = !mTimeStretcher->isPassThrough();
+    }
+
+    size_t size_done = 0;
+    size_t size_remaining = size;
+    int64_t framesDonePermille = 0;
+    if (stretching) {
+        size_remaining -= size_remaining % mFrameSize;
+    }
+    while (size_remaining > 0 && mCallbackSynced) {
+        PCMRingBuffer::Tag tag;
+        if (mRing->getDueTag(&tag)) {
+            mRing->popTag();
+            wakeDecoder = true;
+
+            if (tag.mStatus != OK) {
+                mCallbackAtEnd = true;
+                mFinalStatus = tag.mStatus;
+                continue;
             }
 
             if (mAudioSink != NULL) {
@@ -454,130 +761,261 @@ size_t AudioPlayer::fillBuffer(void *data, size_t size) {
                 mLatencyUs = (int64_t)mAudioTrack->latency() * 1000;
             }
 
-            CHECK(mInputBuffer->meta_data()->findInt64(
-                        kKeyTime, &mPositionTimeMediaUs));
+            mPositionTimeMediaUs = tag.mTimeUs;
+
+            if (stretching) {
+                // The stretcher's backlog comes out ahead of this buffer.
+                mPositionTimeMediaUs -= mTimeStretcher->getBufferedDurationUs();
+                if (mPositionTimeMediaUs < 0) {
+                    mPositionTimeMediaUs = 0;
+                }
+            } else {
+                framesDonePermille = (size_done / mFrameSize) * 1000ll;
+            }
 
             mPositionTimeRealUs =
-                ((mNumFramesPlayed + size_done / mFrameSize) * 1000000)
+                ((mMediaFramesPlayedPermille + framesDonePermille) * 1000)
                     / mSampleRate;
 
-            ALOGV("buffer->size() = %d, "
-                 "mPositionTimeMediaUs=%.2f mPositionTimeRealUs=%.2f",
-                 mInputBuffer->range_length(),
+            ALOGV("mPositionTimeMediaUs=%.2f mPositionTimeRealUs=%.2f",
                  mPositionTimeMediaUs / 1E6, mPositionTimeRealUs / 1E6);
+
+            continue;
+        }
+
+        if (mCallbackAtEnd) {
+            if (stretching) {
+                // What the stretcher still holds has to be played before
+                // the end, if it doesn't all fit the rest comes next time.
+                size_t n = mTimeStretcher->flush(
+                        (int16_t *)((char *)data + size_done),
+                        size_remaining / mFrameSize);
+
+                size_done += n * mFrameSize;
+                size_remaining -= n * mFrameSize;
+                framesDonePermille += n * 1000ll;
+
+                if (!mTimeStretcher->isEmpty()) {
+                    break;
+                }
+            }
+
+            mReachedEOS = true;
+            wakeDecoder = true;
+            break;
         }
 
-        if (mInputBuffer->range_length() == 0) {
-            mInputBuffer->release();
-            mInputBuffer = NULL;
+        const uint8_t *in;
+        size_t available = mRing->getReadRegion(&in);
+
+        if (stretching) {
+            size_t numFrames = available / mFrameSize;
+            if (numFrames == 0) {
+                break;
+            }
+
+            size_t numFramesTaken = numFrames;
+            size_t numFramesOut = mTimeStretcher->process(
+                    (int16_t *)((char *)data + size_done),
+                    size_remaining / mFrameSize,
+                    (const int16_t *)in, &numFramesTaken);
+
+            mRing->advanceRead(numFramesTaken * mFrameSize);
+            wakeDecoder = true;
+
+            size_done += numFramesOut * mFrameSize;
+            size_remaining -= numFramesOut * mFrameSize;
+            framesDonePermille += (int64_t)numFramesOut * ratePermille;
 
             continue;
         }
 
-        size_t copy = size_remaining;
-        if (copy > mInputBuffer->range_length()) {
-            copy = mInputBuffer->range_length();
+        if (available == 0) {
+            break;
         }
 
-        memcpy((char *)data + size_done,
-               (const char *)mInputBuffer->data() + mInputBuffer->range_offset(),
-               copy);
+        size_t copy = size_remaining;
+        if (copy > available) {
+            copy = available;
+        }
 
-        mInputBuffer->set_range(mInputBuffer->range_offset() + copy,
-                                mInputBuffer->range_length() - copy);
+        memcpy((char *)data + size_done, in, copy);
+        mRing->advanceRead(copy);
+        wakeDecoder = true;
 
         size_done += copy;
         size_remaining -= copy;
     }
 
-    {
-        Mutex::Autolock autoLock(mLock);
-        mNumFramesPlayed += size_done / mFrameSize;
-        mNumFramesPlayedSysTimeUs = ALooper::GetNowUs();
+    if (!stretching) {
+        framesDonePermille = (size_done / mFrameSize) * 1000ll;
+    }
 
-        if (mReachedEOS) {
-            mPinnedTimeUs = mNumFramesPlayedSysTimeUs;
-        } else {
-            mPinnedTimeUs = -1ll;
-        }
+    if (!mReachedEOS && size_done < size) {
+        // The decoder fell behind or a seek is still underway. The sink
+        // gets silence rather than waiting, the clock doesn't move for it.
+        memset((char *)data + size_done, 0, size - size_done);
+        size_done = size;
     }
 
-    if (postEOS) {
-        mObserver->postAudioEOS(postEOSDelayUs);
+    mNumFramesPlayed += size_done / mFrameSize;
+    mNumFramesPlayedSysTimeUs = ALooper::GetNowUs();
+    mMediaFramesPlayedPermille += framesDonePermille;
+    mCallbackRatePermille = ratePermille;
+
+    if (mReachedEOS) {
+        mPinnedTimeUs = mNumFramesPlayedSysTimeUs;
+    } else {
+        mPinnedTimeUs = -1ll;
     }
 
-    if (postSeekComplete) {
-        mObserver->postAudioSeekComplete();
+    publishTimeMapping();
+
+    if (wakeDecoder) {
+        wakeDecodeThread();
     }
 
     return size_done;
 }
 
+// A sequence lock: the callback never waits for a reader, a reader that
+// raced it reads again.
+void AudioPlayer::publishTimeMapping() {
+    int32_t seq = mTimeMappingSeq;
+    android_atomic_acquire_store(seq + 1, &mTimeMappingSeq);
+
+    mTimeMapping.mSeekEpoch = mCallbackSeekEpoch;
+    mTimeMapping.mFlushEpoch = mCallbackFlushEpoch;
+    mTimeMapping.mNumFramesPlayed = mNumFramesPlayed;
+    mTimeMapping.mNumFramesPlayedSysTimeUs = mNumFramesPlayedSysTimeUs;
+    mTimeMapping.mMediaFramesPlayedPermille = mMediaFramesPlayedPermille;
+    mTimeMapping.mPositionTimeMediaUs = mPositionTimeMediaUs;
+    mTimeMapping.mPositionTimeRealUs = mPositionTimeRealUs;
+    mTimeMapping.mLatencyUs = mLatencyUs;
+    mTimeMapping.mPinnedTimeUs = mPinnedTimeUs;
+    mTimeMapping.mRatePermille = mCallbackRatePermille;
+    mTimeMapping.mReachedEOS = mReachedEOS;
+    mTimeMapping.mFinalStatus = mFinalStatus;
+
+    android_atomic_release_store(seq + 2, &mTimeMappingSeq);
+}
+
+// What the callback published, brought up to date with the seeks,
+// flushes and pauses it hasn't seen yet.
+void AudioPlayer::getTimeMappingLocked(TimeMapping *mapping) const {
+    for (;;) {
+        int32_t seq = android_atomic_acquire_load(&mTimeMappingSeq);
+        if (seq & 1) {
+            continue;
+        }
+
+        *mapping = mTimeMapping;
+
+        if (android_atomic_release_load(&mTimeMappingSeq) == seq) {
+            break;
+        }
+    }
+
+    if (mapping->mFlushEpoch != mFlushEpoch) {
+        mapping->mNumFramesPlayed = 0;
+        mapping->mNumFramesPlayedSysTimeUs = mFlushSysTimeUs;
+        mapping->mMediaFramesPlayedPermille = 0;
+    }
+
+    if (mapping->mSeekEpoch != mSeekEpoch) {
+        mapping->mPositionTimeMediaUs = -1;
+        mapping->mPositionTimeRealUs = -1;
+        mapping->mReachedEOS = false;
+        mapping->mFinalStatus = OK;
+    }
+
+    // Time stands still from a pause until the next callback.
+    if (mapping->mPinnedTimeUs < 0
+            && mPausedSysTimeUs >= mapping->mNumFramesPlayedSysTimeUs) {
+        mapping->mPinnedTimeUs = mPausedSysTimeUs;
+    }
+}
+
 int64_t AudioPlayer::getRealTimeUs() {
     Mutex::Autolock autoLock(mLock);
-    return getRealTimeUsLocked();
+
+    TimeMapping mapping;
+    getTimeMappingLocked(&mapping);
+
+    return getRealTimeUsLocked(mapping);
 }
 
-int64_t AudioPlayer::getRealTimeUsLocked() const {
+int64_t AudioPlayer::getRealTimeUsLocked(const TimeMapping &mapping) const {
     CHECK(mStarted);
     CHECK_NE(mSampleRate, 0);
-    int64_t result = -mLatencyUs + (mNumFramesPlayed * 1000000) / mSampleRate;
+
+    // While time-stretching the clock runs at the playback rate, media time
+    // and whatever is synced to it keep up that way.
+    int64_t result = (mapping.mMediaFramesPlayedPermille * 1000) / mSampleRate;
 
     // Compensate for large audio buffers, updates of mNumFramesPlayed
     // are less frequent, therefore to get a "smoother" notion of time we
     // compensate using system time.
     int64_t diffUs;
-    if (mPinnedTimeUs >= 0ll) {
-        diffUs = mPinnedTimeUs;
+    if (mapping.mPinnedTimeUs >= 0ll) {
+        diffUs = mapping.mPinnedTimeUs;
     } else {
         diffUs = ALooper::GetNowUs();
     }
 
-    diffUs -= mNumFramesPlayedSysTimeUs;
+    diffUs -= mapping.mNumFramesPlayedSysTimeUs;
 
-    return result + diffUs;
+    return result
+        + (diffUs - mapping.mLatencyUs) * mapping.mRatePermille / 1000;
 }
 
 int64_t AudioPlayer::getMediaTimeUs() {
     Mutex::Autolock autoLock(mLock);
 
-    if (mPositionTimeMediaUs < 0 || mPositionTimeRealUs < 0) {
-        if (mSeeking) {
-            return mSeekTimeUs;
-        }
+    TimeMapping mapping;
+    getTimeMappingLocked(&mapping);
 
-        return 0;
+    // Nothing played since starting or seeking yet.
+    if (mapping.mPositionTimeMediaUs < 0 || mapping.mPositionTimeRealUs < 0) {
+        return mSeekTimeUs;
     }
 
-    int64_t realTimeOffset = getRealTimeUsLocked() - mPositionTimeRealUs;
+    int64_t realTimeOffset =
+        getRealTimeUsLocked(mapping) - mapping.mPositionTimeRealUs;
     if (realTimeOffset < 0) {
         realTimeOffset = 0;
     }
 
-    return realTimeOffset + mPositionTimeMediaUs;
+    return realTimeOffset + mapping.mPositionTimeMediaUs;
 }
 
 bool AudioPlayer::getMediaTimeMapping(
         int64_t *realtime_us, int64_t *mediatime_us) {
     Mutex::Autolock autoLock(mLock);
 
-    *realtime_us = mPositionTimeRealUs;
-    *mediatime_us = mPositionTimeMediaUs;
+    TimeMapping mapping;
+    getTimeMappingLocked(&mapping);
+
+    *realtime_us = mapping.mPositionTimeRealUs;
+    *mediatime_us = mapping.mPositionTimeMediaUs;
 
-    return mPositionTimeRealUs != -1 && mPositionTimeMediaUs != -1;
+    return mapping.mPositionTimeRealUs != -1
+        && mapping.mPositionTimeMediaUs != -1;
 }
 
 status_t AudioPlayer::seekTo(int64_t time_us) {
     Mutex::Autolock autoLock(mLock);
 
     mSeeking = true;
-    mPositionTimeRealUs = mPositionTimeMediaUs = -1;
-    mReachedEOS = false;
     mSeekTimeUs = time_us;
 
-    // Flush resets the number of played frames
-    mNumFramesPlayed = 0;
-    mNumFramesPlayedSysTimeUs = ALooper::GetNowUs();
+    // The decode thread reads from the new position, the callback drops
+    // what was decoded before and counts its frames from 0 again, as the
+    // flush below resets the sink's.
+    android_atomic_inc(&mSeekEpoch);
+    android_atomic_inc(&mFlushEpoch);
+    mFlushSysTimeUs = ALooper::GetNowUs();
+    wakeDecodeThread();
 
     if (mAudioSink != NULL) {
         mAudioSink->flush();
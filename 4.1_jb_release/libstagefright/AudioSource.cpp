@@ -24,9 +24,13 @@
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <cutils/atomic.h>
 #include <cutils/properties.h>
 #include <stdlib.h>
 
+#include "include/LockFreeQueue.h"
+#include "include/PCMCaptureDSP.h"
+
 namespace android {
 
 static void AudioRecordCallbackFunction(int event, void *user, void *info) {
@@ -50,9 +54,17 @@ AudioSource::AudioSource(
         audio_source_t inputSource, uint32_t sampleRate, uint32_t channelCount)
     : mStarted(false),
       mSampleRate(sampleRate),
+      mTrackMaxAmplitude(0),
+      mMaxAmplitude(0),
+      mStartTimeUs(0),
       mPrevSampleTimeUs(0),
+      mInitialReadTimeUs(0),
       mNumFramesReceived(0),
-      mNumClientOwnedBuffers(0) {
+      mNumClientOwnedBuffers(0),
+      mBuffers(NULL),
+      mNumBuffers(0),
+      mFreeBuffers(NULL),
+      mBuffersReceived(NULL) {
 
     ALOGV("sampleRate: %d, channelCount: %d", sampleRate, channelCount);
     CHECK(channelCount == 1 || channelCount == 2);
@@ -87,8 +99,31 @@ AudioSource::AudioSource(
                     frameCount);
         mInitCheck = mRecord->initCheck();
     } else {
+        mRecord = NULL;
         mInitCheck = status;
     }
+
+    if (mInitCheck == OK) {
+        int64_t bytesPerSecond =
+            (int64_t)sampleRate * channelCount * sizeof(int16_t);
+
+        mNumBuffers =
+            (kBufferPoolDurationUs * bytesPerSecond / 1000000ll
+                + kMaxBufferSize - 1) / kMaxBufferSize;
+        if (mNumBuffers < kMinNumBuffers) {
+            mNumBuffers = kMinNumBuffers;
+        }
+
+        mFreeBuffers = new LockFreeQueue<MediaBuffer *>(mNumBuffers);
+        mBuffersReceived = new LockFreeQueue<MediaBuffer *>(mNumBuffers);
+
+        mBuffers = new MediaBuffer *[mNumBuffers];
+        for (size_t i = 0; i < mNumBuffers; ++i) {
+            mBuffers[i] = new MediaBuffer(kMaxBufferSize);
+            mBuffers[i]->setObserver(this);
+            CHECK(mFreeBuffers->push(mBuffers[i]));
+        }
+    }
 }
 
 AudioSource::~AudioSource() {
@@ -98,6 +133,21 @@ AudioSource::~AudioSource() {
 
     delete mRecord;
     mRecord = NULL;
+
+    for (size_t i = 0; i < mNumBuffers; ++i) {
+        mBuffers[i]->setObserver(NULL);
+        mBuffers[i]->release();
+        mBuffers[i] = NULL;
+    }
+
+    delete[] mBuffers;
+    mBuffers = NULL;
+
+    delete mBuffersReceived;
+    mBuffersReceived = NULL;
+
+    delete mFreeBuffers;
+    mFreeBuffers = NULL;
 }
 
 status_t AudioSource::initCheck() const {
@@ -114,18 +164,27 @@ status_t AudioSource::start(MetaData *params) {
         return NO_INIT;
     }
 
-    mTrackMaxAmplitude = false;
-    mMaxAmplitude = 0;
-    mInitialReadTimeUs = 0;
-    mStartTimeUs = 0;
-    int64_t startTimeUs;
-    if (params && params->findInt64(kKeyTime, &startTimeUs)) {
-        mStartTimeUs = startTimeUs;
+    {
+        Mutex::Autolock autoCallbackLock(mCallbackLock);
+
+        android_atomic_release_store(0, &mTrackMaxAmplitude);
+        android_atomic_release_store(0, &mMaxAmplitude);
+        mInitialReadTimeUs = 0;
+        mStartTimeUs = 0;
+        int64_t startTimeUs;
+        if (params && params->findInt64(kKeyTime, &startTimeUs)) {
+            mStartTimeUs = startTimeUs;
+        }
+
+        // The callback may run as soon as the recording starts.
+        mStarted = true;
     }
+
     status_t err = mRecord->start();
-    if (err == OK) {
-        mStarted = true;
-    } else {
+    if (err != OK) {
+        Mutex::Autolock autoCallbackLock(mCallbackLock);
+        mStarted = false;
+
         delete mRecord;
         mRecord = NULL;
     }
@@ -134,13 +193,18 @@ status_t AudioSource::start(MetaData *params) {
     return err;
 }
 
+void AudioSource::recycleBuffer_l(MediaBuffer *buffer) {
+    // Leave the other keys in place, overwriting them in the callback
+    // doesn't allocate.
+    buffer->meta_data()->remove(kKeyAnchorTime);
+    CHECK(mFreeBuffers->push(buffer));
+}
+
 void AudioSource::releaseQueuedFrames_l() {
     ALOGV("releaseQueuedFrames_l");
-    List<MediaBuffer *>::iterator it;
-    while (!mBuffersReceived.empty()) {
-        it = mBuffersReceived.begin();
-        (*it)->release();
-        mBuffersReceived.erase(it);
+    MediaBuffer *buffer;
+    while (mBuffersReceived->pop(&buffer)) {
+        recycleBuffer_l(buffer);
     }
 }
 
@@ -161,7 +225,13 @@ status_t AudioSource::reset() {
         return NO_INIT;
     }
 
-    mStarted = false;
+    {
+        Mutex::Autolock autoCallbackLock(mCallbackLock);
+        mStarted = false;
+        mFrameAvailableCondition.signal();
+    }
+
+    // From here on the callback drops whatever it gets.
     mRecord->stop();
     waitOutstandingEncodingFrames_l();
     releaseQueuedFrames_l();
@@ -184,38 +254,6 @@ sp<MetaData> AudioSource::getFormat() {
     return meta;
 }
 
-void AudioSource::rampVolume(
-        int32_t startFrame, int32_t rampDurationFrames,
-        uint8_t *data,   size_t bytes) {
-
-    const int32_t kShift = 14;
-    int32_t fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
-    const int32_t nChannels = mRecord->channelCount();
-    int32_t stopFrame = startFrame + bytes / sizeof(int16_t);
-    int16_t *frame = (int16_t *) data;
-    if (stopFrame > rampDurationFrames) {
-        stopFrame = rampDurationFrames;
-    }
-
-    while (startFrame < stopFrame) {
-        if (nChannels == 1) {  // mono
-            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
-            ++frame;
-            ++startFrame;
-        } else {               // stereo
-            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
-            frame[1] = (frame[1] * fixedMultiplier) >> kShift;
-            frame += 2;
-            startFrame += 2;
-        }
-
-        // Update the multiplier every 4 frames
-        if ((startFrame & 3) == 0) {
-            fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
-        }
-    }
-}
-
 status_t AudioSource::read(
         MediaBuffer **out, const ReadOptions *options) {
     Mutex::Autolock autoLock(mLock);
@@ -225,42 +263,28 @@ status_t AudioSource::read(
         return NO_INIT;
     }
 
-    while (mStarted && mBuffersReceived.empty()) {
-        mFrameAvailableCondition.wait(mLock);
+    // The buffers were faded in and their amplitude tracked as they
+    // were received, all that is left is to hand them out.
+    MediaBuffer *buffer = NULL;
+    while (mStarted && !mBuffersReceived->pop(&buffer)) {
+        // The callback pushes and reset() clears mStarted with
+        // mCallbackLock held, so no wakeup slips in between the check
+        // below and the wait. mLock is let go for the buffers coming back.
+        mLock.unlock();
+        {
+            Mutex::Autolock autoCallbackLock(mCallbackLock);
+            while (mStarted && mBuffersReceived->empty()) {
+                mFrameAvailableCondition.wait(mCallbackLock);
+            }
+        }
+        mLock.lock();
     }
     if (!mStarted) {
         return OK;
     }
-    MediaBuffer *buffer = *mBuffersReceived.begin();
-    mBuffersReceived.erase(mBuffersReceived.begin());
     ++mNumClientOwnedBuffers;
-    buffer->setObserver(this);
     buffer->add_ref();
 
-    // Mute/suppress the recording sound
-    int64_t timeUs;
-    CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
-    int64_t elapsedTimeUs = timeUs - mStartTimeUs;
-    if (elapsedTimeUs < kAutoRampStartUs) {
-        memset((uint8_t *) buffer->data(), 0, buffer->range_length());
-    } else if (elapsedTimeUs < kAutoRampStartUs + kAutoRampDurationUs) {
-        int32_t autoRampDurationFrames =
-                    (kAutoRampDurationUs * mSampleRate + 500000LL) / 1000000LL;
-
-        int32_t autoRampStartFrames =
-                    (kAutoRampStartUs * mSampleRate + 500000LL) / 1000000LL;
-
-        int32_t nFrames = mNumFramesReceived - autoRampStartFrames;
-        rampVolume(nFrames, autoRampDurationFrames,
-                (uint8_t *) buffer->data(), buffer->range_length());
-    }
-
-    // Track the max recording signal amplitude.
-    if (mTrackMaxAmplitude) {
-        trackMaxAmplitude(
-            (int16_t *) buffer->data(), buffer->range_length() >> 1);
-    }
-
     *out = buffer;
     return OK;
 }
@@ -269,8 +293,7 @@ void AudioSource::signalBufferReturned(MediaBuffer *buffer) {
     ALOGV("signalBufferReturned: %p", buffer->data());
     Mutex::Autolock autoLock(mLock);
     --mNumClientOwnedBuffers;
-    buffer->setObserver(0);
-    buffer->release();
+    recycleBuffer_l(buffer);
     mFrameEncodingCompletionCondition.signal();
     return;
 }
@@ -278,7 +301,7 @@ void AudioSource::signalBufferReturned(MediaBuffer *buffer) {
 status_t AudioSource::dataCallbackTimestamp(
         const AudioRecord::Buffer& audioBuffer, int64_t timeUs) {
     ALOGV("dataCallbackTimestamp: %lld us", timeUs);
-    Mutex::Autolock autoLock(mLock);
+    Mutex::Autolock autoLock(mCallbackLock);
     if (!mStarted) {
         ALOGW("Spurious callback from AudioRecord. Drop the audio data.");
         return OK;
@@ -318,73 +341,110 @@ status_t AudioSource::dataCallbackTimestamp(
         ALOGW("Lost audio record data: %d bytes", numLostBytes);
     }
 
-    while (numLostBytes > 0) {
-        size_t bufferSize = numLostBytes;
-        if (numLostBytes > kMaxBufferSize) {
-            numLostBytes -= kMaxBufferSize;
-            bufferSize = kMaxBufferSize;
-        } else {
-            numLostBytes = 0;
-        }
-        MediaBuffer *lostAudioBuffer = new MediaBuffer(bufferSize);
-        memset(lostAudioBuffer->data(), 0, bufferSize);
-        lostAudioBuffer->set_range(0, bufferSize);
-        queueInputBuffer_l(lostAudioBuffer, timeUs);
-    }
+    queueAudio(NULL, numLostBytes, timeUs);
 
     if (audioBuffer.size == 0) {
         ALOGW("Nothing is available from AudioRecord callback buffer");
         return OK;
     }
 
-    const size_t bufferSize = audioBuffer.size;
-    MediaBuffer *buffer = new MediaBuffer(bufferSize);
-    memcpy((uint8_t *) buffer->data(),
-            audioBuffer.i16, audioBuffer.size);
-    buffer->set_range(0, bufferSize);
-    queueInputBuffer_l(buffer, timeUs);
+    queueAudio(audioBuffer.i16, audioBuffer.size, timeUs);
     return OK;
 }
 
-void AudioSource::queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs) {
-    const size_t bufferSize = buffer->range_length();
+void AudioSource::queueAudio(
+        const int16_t *data, size_t size, int64_t timeUs) {
+    const size_t frameSize = mRecord->frameSize();
+    const size_t numChannels = mRecord->channelCount();
+
+    const int32_t autoRampDurationFrames =
+                (kAutoRampDurationUs * mSampleRate + 500000LL) / 1000000LL;
+
+    const int32_t autoRampStartFrames =
+                (kAutoRampStartUs * mSampleRate + 500000LL) / 1000000LL;
+
+    int32_t peak = 0;
+    while (size > 0) {
+        size_t bufferSize = size;
+        if (bufferSize > kMaxBufferSize) {
+            bufferSize = kMaxBufferSize;
+        }
+
+        MediaBuffer *buffer;
+        if (!mFreeBuffers->pop(&buffer)) {
+            // The client holds on to every buffer there is. Drop the
+            // audio, the timestamps carry on as if it had been queued.
+            ALOGW("No buffer for %d bytes of audio record data", bufferSize);
+            queueInputBuffer(NULL, bufferSize, timeUs);
+        } else {
+            int16_t *dst = (int16_t *) buffer->data();
+            if (data == NULL) {
+                memset(dst, 0, bufferSize);
+            } else {
+                int32_t bufferPeak = CopyPCMWithRampAndPeak(
+                        dst, data, bufferSize / frameSize, numChannels,
+                        mNumFramesReceived - autoRampStartFrames,
+                        autoRampDurationFrames);
+                if (bufferPeak > peak) {
+                    peak = bufferPeak;
+                }
+            }
+            buffer->set_range(0, bufferSize);
+            queueInputBuffer(buffer, bufferSize, timeUs);
+        }
+
+        if (data != NULL) {
+            data += bufferSize / sizeof(int16_t);
+        }
+        size -= bufferSize;
+    }
+
+    // Track the max recording signal amplitude.
+    if (peak > 0 && android_atomic_acquire_load(&mTrackMaxAmplitude)) {
+        int32_t prevPeak;
+        do {
+            prevPeak = mMaxAmplitude;
+        } while (peak > prevPeak
+                && android_atomic_cmpxchg(prevPeak, peak, &mMaxAmplitude));
+    }
+}
+
+void AudioSource::queueInputBuffer(
+        MediaBuffer *buffer, size_t bufferSize, int64_t timeUs) {
     const size_t frameSize = mRecord->frameSize();
     const int64_t timestampUs =
                 mPrevSampleTimeUs +
                     ((1000000LL * (bufferSize / frameSize)) +
                         (mSampleRate >> 1)) / mSampleRate;
 
-    if (mNumFramesReceived == 0) {
-        buffer->meta_data()->setInt64(kKeyAnchorTime, mStartTimeUs);
+    if (buffer != NULL) {
+        if (mNumFramesReceived == 0) {
+            buffer->meta_data()->setInt64(kKeyAnchorTime, mStartTimeUs);
+        }
+
+        buffer->meta_data()->setInt64(kKeyTime, mPrevSampleTimeUs);
+        buffer->meta_data()->setInt64(kKeyDriftTime, timeUs - mInitialReadTimeUs);
+
+        // There is room for every buffer in the pool.
+        CHECK(mBuffersReceived->push(buffer));
+
+        // Under mCallbackLock, which read() waits with.
+        mFrameAvailableCondition.signal();
     }
 
-    buffer->meta_data()->setInt64(kKeyTime, mPrevSampleTimeUs);
-    buffer->meta_data()->setInt64(kKeyDriftTime, timeUs - mInitialReadTimeUs);
     mPrevSampleTimeUs = timestampUs;
     mNumFramesReceived += bufferSize / frameSize;
-    mBuffersReceived.push_back(buffer);
-    mFrameAvailableCondition.signal();
-}
-
-void AudioSource::trackMaxAmplitude(int16_t *data, int nSamples) {
-    for (int i = nSamples; i > 0; --i) {
-        int16_t value = *data++;
-        if (value < 0) {
-            value = -value;
-        }
-        if (mMaxAmplitude < value) {
-            mMaxAmplitude = value;
-        }
-    }
 }
 
 int16_t AudioSource::getMaxAmplitude() {
     // First call activates the tracking.
-    if (!mTrackMaxAmplitude) {
-        mTrackMaxAmplitude = true;
+    if (!android_atomic_acquire_load(&mTrackMaxAmplitude)) {
+        android_atomic_release_store(1, &mTrackMaxAmplitude);
     }
-    int16_t value = mMaxAmplitude;
-    mMaxAmplitude = 0;
+    int32_t value;
+    do {
+        value = mMaxAmplitude;
+    } while (android_atomic_cmpxchg(value, 0, &mMaxAmplitude));
     ALOGV("max amplitude since last call: %d", value);
     return value;
 }
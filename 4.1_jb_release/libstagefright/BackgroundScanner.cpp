@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "BackgroundScanner"
+#include <utils/Log.h>
+
+#include "include/BackgroundScanner.h"
+
+#include <media/stagefright/foundation/ALooper.h>
+
+#include <pthread.h>
+
+namespace android {
+
+struct BackgroundScanner::ThreadContext {
+    ThreadContext(BackgroundScanner *scanner, const char *name)
+        : mScanner(scanner),
+          mName(name) {
+    }
+
+    wp<BackgroundScanner> mScanner;
+    const char *mName;
+};
+
+status_t BackgroundScanner::startScanThread(const char *name) {
+    ThreadContext *context = new ThreadContext(this, name);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int err = pthread_create(&thread, &attr, ScanThread, context);
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+        ALOGE("%s: pthread_create failed (%d)", name, err);
+        delete context;
+        return UNKNOWN_ERROR;
+    }
+
+    return OK;
+}
+
+// static
+void *BackgroundScanner::ScanThread(void *me) {
+    ThreadContext *context = (ThreadContext *)me;
+    int64_t startUs = ALooper::GetNowUs();
+
+    for (;;) {
+        sp<BackgroundScanner> scanner = context->mScanner.promote();
+        if (scanner == NULL) {
+            ALOGV("%s: released after %lld us",
+                    context->mName, ALooper::GetNowUs() - startUs);
+            break;
+        }
+        if (!scanner->scanStep()) {
+            ALOGV("%s: scan took %lld us",
+                    context->mName, ALooper::GetNowUs() - startUs);
+            break;
+        }
+    }
+
+    delete context;
+    return NULL;
+}
+
+}  // namespace android
@@ -18,6 +18,7 @@
 #define LOG_TAG "FLACExtractor"
 #include <utils/Log.h>
 
+#include "include/BackgroundScanner.h"
 #include "include/FLACExtractor.h"
 // Vorbis comments
 #include "include/OggExtractor.h"
@@ -25,23 +26,160 @@
 #include "FLAC/stream_decoder.h"
 
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaBufferGroup.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/MediaBuffer.h>
+#include <utils/threads.h>
 
 namespace android {
 
 class FLACParser;
 
+// FLACSeekIndex maps sample numbers to the byte offsets of the frames that
+// start there, so that a seek can go straight to the frame holding the
+// target sample instead of letting libFLAC bisect the stream with many
+// small reads. It is seeded from the SEEKTABLE if the stream has one.
+// Unless that is dense enough, a thread scans the stream for frame headers,
+// except on caching (network) sources, where the parsers only report the
+// frames they happen to read. One index is shared by the extractor and all
+// of its sources.
+
+class FLACSeekIndex : public BackgroundScanner {
+
+public:
+    FLACSeekIndex(
+            const FLAC__StreamMetadata_StreamInfo &streamInfo,
+            off64_t firstFrameOffset);
+
+    const FLAC__StreamMetadata_StreamInfo &getStreamInfo() const {
+        return mStreamInfo;
+    }
+    off64_t getFirstFrameOffset() const {
+        return mFirstFrameOffset;
+    }
+
+    // SEEKTABLE offsets are relative to the first frame
+    void addSeekTable(const Vector<FLAC__StreamMetadata_SeekPoint> &points);
+    void startScan(const sp<DataSource> &dataSource);
+    void addFrame(FLAC__uint64 sample, off64_t offset);
+
+    // whether readers should report the frames they come across
+    bool wantsFrames();
+
+    // finds the last known frame starting at or before sample
+    bool lookup(FLAC__uint64 sample,
+            FLAC__uint64 *frameSample, off64_t *frameOffset);
+
+    // blocks until a running scan is done, returns the number of entries
+    size_t waitForScan();
+
+protected:
+    virtual ~FLACSeekIndex();
+
+private:
+    struct Entry {
+        FLAC__uint64 mSample;
+        off64_t mOffset;
+    };
+    struct ScanContext;
+
+    FLAC__StreamMetadata_StreamInfo mStreamInfo;
+    off64_t mFirstFrameOffset;
+
+    // frames closer than this to a known one aren't worth an entry
+    FLAC__uint64 mMinSpacing;
+    // how far a seek may decode forward, beyond that libFLAC does better
+    FLAC__uint64 mMaxGap;
+
+    Mutex mLock;
+    Condition mScanDone;
+    Vector<Entry> mEntries;
+    bool mScanning;
+    bool mComplete;
+
+    // only touched by the scan thread once it runs
+    ScanContext *mScanContext;
+
+    ssize_t findEntry_l(FLAC__uint64 sample) const;
+    void insertEntry_l(FLAC__uint64 sample, off64_t offset, bool force);
+    void onScanDone(bool complete);
+
+    virtual bool scanStep();
+
+    // no copy constructor or assignment
+    FLACSeekIndex(const FLACSeekIndex &);
+    FLACSeekIndex &operator=(const FLACSeekIndex &);
+
+};
+
+// FLACFrameScanner finds frame headers in a stream fed to it in pieces of
+// any size. As the sync code can also turn up inside frame data, a header
+// only counts if its CRC-8 matches, its fields agree with STREAMINFO and
+// it continues the sample count of a frame found before it.
+
+class FLACFrameScanner {
+
+public:
+    FLACFrameScanner(
+            const FLAC__StreamMetadata_StreamInfo &streamInfo,
+            off64_t firstFrameOffset);
+    ~FLACFrameScanner();
+
+    void feed(off64_t offset, const uint8_t *data, size_t size,
+            FLACSeekIndex *index);
+
+private:
+    enum {
+        // sync, codes, 7 byte UTF-8 number, block size, sample rate, CRC
+        kMaxHeaderSize = 16,
+        kMaxPending = 8,
+    };
+
+    struct Frame {
+        FLAC__uint64 mSample;
+        unsigned mBlockSize;
+        off64_t mOffset;
+    };
+
+    FLAC__StreamMetadata_StreamInfo mStreamInfo;
+    off64_t mFirstFrameOffset;
+    off64_t mMaxFrameDistance;
+
+    // unscanned tail of the data fed so far
+    uint8_t *mBuffer;
+    size_t mBufferSize;
+    size_t mBufferCapacity;
+    off64_t mBufferOffset;
+
+    // once a frame is confirmed, the next one must follow on from it
+    bool mChained;
+    FLAC__uint64 mNextSample;
+    off64_t mLastOffset;
+    Vector<Frame> mPending;
+
+    bool parseHeader(const uint8_t *data,
+            FLAC__uint64 *sample, unsigned *blockSize) const;
+    void onHeader(const Frame &frame, FLACSeekIndex *index);
+    void accept(const Frame &frame, FLACSeekIndex *index);
+    void reset(off64_t offset);
+
+    // no copy constructor or assignment
+    FLACFrameScanner(const FLACFrameScanner &);
+    FLACFrameScanner &operator=(const FLACFrameScanner &);
+
+};
+
 class FLACSource : public MediaSource {
 
 public:
     FLACSource(
             const sp<DataSource> &dataSource,
-            const sp<MetaData> &trackMetadata);
+            const sp<MetaData> &trackMetadata,
+            const sp<FLACSeekIndex> &seekIndex);
 
     virtual status_t start(MetaData *params);
     virtual status_t stop();
@@ -56,6 +194,7 @@ protected:
 private:
     sp<DataSource> mDataSource;
     sp<MetaData> mTrackMetadata;
+    sp<FLACSeekIndex> mSeekIndex;
     sp<FLACParser> mParser;
     bool mInitCheck;
     bool mStarted;
@@ -77,7 +216,9 @@ public:
         const sp<DataSource> &dataSource,
         // If metadata pointers aren't provided, we don't fill them
         const sp<MetaData> &fileMetadata = 0,
-        const sp<MetaData> &trackMetadata = 0);
+        const sp<MetaData> &trackMetadata = 0,
+        // If a seek index is provided, seeks use it and reads add to it
+        const sp<FLACSeekIndex> &seekIndex = 0);
 
     status_t initCheck() const {
         return mInitCheck;
@@ -99,6 +240,18 @@ public:
     FLAC__uint64 getTotalSamples() const {
         return mStreamInfo.total_samples;
     }
+    const FLAC__StreamMetadata_StreamInfo &getStreamInfo() const {
+        return mStreamInfo;
+    }
+
+    // where the first frame starts, negative if libFLAC couldn't tell
+    off64_t getFirstFrameOffset() const {
+        return mFirstFrameOffset;
+    }
+    // valid points of the SEEKTABLE, if any
+    const Vector<FLAC__StreamMetadata_SeekPoint> &getSeekPoints() const {
+        return mSeekPoints;
+    }
 
     // media buffers
     void allocateBuffers();
@@ -119,6 +272,16 @@ private:
     sp<MetaData> mTrackMetadata;
     bool mInitCheck;
 
+    // seek index shared with the extractor, and what we report to it
+    sp<FLACSeekIndex> mSeekIndex;
+    FLACFrameScanner *mScanner;
+    off64_t mFirstFrameOffset;
+    Vector<FLAC__StreamMetadata_SeekPoint> mSeekPoints;
+
+    // bytes and reads since the data source was opened, for seek statistics
+    int64_t mNumBytesRead;
+    uint32_t mNumReads;
+
     // media buffers
     size_t mMaxBufferSize;
     MediaBufferGroup *mGroup;
@@ -146,6 +309,8 @@ private:
 
     status_t init();
     MediaBuffer *readBuffer(bool doSeek, FLAC__uint64 sample);
+    bool seekTo(FLAC__uint64 sample, unsigned *skip);
+    bool decodeFrom(off64_t offset, FLAC__uint64 sample, unsigned *skip);
 
     // no copy constructor or assignment
     FLACParser(const FLACParser &);
@@ -279,6 +444,11 @@ FLAC__StreamDecoderReadStatus FLACParser::readCallback(
     } else {
         assert(actual <= requested);
         *bytes = actual;
+        if (mScanner != NULL && mSeekIndex->wantsFrames()) {
+            mScanner->feed(mCurrentPos, buffer, actual, mSeekIndex.get());
+        }
+        mNumBytesRead += actual;
+        ++mNumReads;
         mCurrentPos += actual;
         return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
     }
@@ -343,6 +513,18 @@ void FLACParser::metadataCallback(const FLAC__StreamMetadata *metadata)
             ALOGE("FLACParser::metadataCallback unexpected STREAMINFO");
         }
         break;
+    case FLAC__METADATA_TYPE_SEEKTABLE:
+        {
+        const FLAC__StreamMetadata_SeekTable *st = &metadata->data.seek_table;
+        for (unsigned i = 0; i < st->num_points; ++i) {
+            const FLAC__StreamMetadata_SeekPoint &point = st->points[i];
+            if (point.sample_number != FLAC__STREAM_METADATA_SEEKPOINT_PLACEHOLDER
+                    && point.frame_samples > 0) {
+                mSeekPoints.push(point);
+            }
+        }
+        }
+        break;
     case FLAC__METADATA_TYPE_VORBIS_COMMENT:
         {
         const FLAC__StreamMetadata_VorbisComment *vc;
@@ -432,16 +614,445 @@ static void copyTrespass(short *dst, const int *const *src, unsigned nSamples)
     TRESPASS();
 }
 
+// FLACFrameScanner
+
+FLACFrameScanner::FLACFrameScanner(
+        const FLAC__StreamMetadata_StreamInfo &streamInfo,
+        off64_t firstFrameOffset)
+    : mStreamInfo(streamInfo),
+      mFirstFrameOffset(firstFrameOffset),
+      mBuffer(NULL),
+      mBufferSize(0),
+      mBufferCapacity(0),
+      mBufferOffset(0LL),
+      mChained(false),
+      mNextSample(0LL),
+      mLastOffset(0LL)
+{
+    // past this distance without a successor the chain is considered lost,
+    // e.g. because of a damaged frame
+    mMaxFrameDistance = streamInfo.max_framesize > 0 ?
+            2 * (off64_t) streamInfo.max_framesize : 1024 * 1024;
+}
+
+FLACFrameScanner::~FLACFrameScanner()
+{
+    free(mBuffer);
+    mBuffer = NULL;
+}
+
+void FLACFrameScanner::reset(off64_t offset)
+{
+    mBufferSize = 0;
+    mBufferOffset = offset;
+    mChained = false;
+    mPending.clear();
+}
+
+void FLACFrameScanner::feed(
+        off64_t offset, const uint8_t *data, size_t size,
+        FLACSeekIndex *index)
+{
+    if (offset != mBufferOffset + (off64_t) mBufferSize) {
+        // not where the last piece ended, e.g. after a seek
+        reset(offset);
+    }
+    if (mBufferSize + size > mBufferCapacity) {
+        size_t capacity = mBufferSize + size;
+        uint8_t *buffer = (uint8_t *) realloc(mBuffer, capacity);
+        if (buffer == NULL) {
+            reset(offset + size);
+            return;
+        }
+        mBuffer = buffer;
+        mBufferCapacity = capacity;
+    }
+    memcpy(mBuffer + mBufferSize, data, size);
+    mBufferSize += size;
+
+    // a header starting within the last kMaxHeaderSize - 1 bytes may still
+    // be incomplete, so those are left for the next piece
+    size_t i = 0;
+    while (i + kMaxHeaderSize <= mBufferSize) {
+        const uint8_t *sync = (const uint8_t *) memchr(
+                mBuffer + i, 0xff, mBufferSize - kMaxHeaderSize + 1 - i);
+        if (sync == NULL) {
+            i = mBufferSize - kMaxHeaderSize + 1;
+            break;
+        }
+        i = sync - mBuffer;
+        Frame frame;
+        frame.mOffset = mBufferOffset + i;
+        if ((sync[1] & 0xfe) == 0xf8 && frame.mOffset >= mFirstFrameOffset
+                && parseHeader(sync, &frame.mSample, &frame.mBlockSize)) {
+            onHeader(frame, index);
+        }
+        ++i;
+    }
+    memmove(mBuffer, mBuffer + i, mBufferSize - i);
+    mBufferSize -= i;
+    mBufferOffset += i;
+}
+
+bool FLACFrameScanner::parseHeader(
+        const uint8_t *data, FLAC__uint64 *sample, unsigned *blockSize) const
+{
+    bool variableBlockSize = data[1] & 1;
+    unsigned blockSizeCode = data[2] >> 4;
+    unsigned sampleRateCode = data[2] & 0x0f;
+    unsigned channelCode = data[3] >> 4;
+    unsigned sampleSizeCode = (data[3] >> 1) & 7;
+    if (blockSizeCode == 0 || sampleRateCode == 15 || channelCode > 10
+            || sampleSizeCode == 3 || sampleSizeCode == 7 || (data[3] & 1)) {
+        return false;
+    }
+    // channel assignments above 7 are the stereo decorrelation modes
+    unsigned channels = channelCode < 8 ? channelCode + 1 : 2;
+    static const unsigned kSampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 0 };
+    if (channels != mStreamInfo.channels || (sampleSizeCode != 0 &&
+            kSampleSizes[sampleSizeCode] != mStreamInfo.bits_per_sample)) {
+        return false;
+    }
+
+    // frame (fixed block size) or sample (variable) number, UTF-8 coded
+    size_t n = 4;
+    FLAC__uint64 number = data[n++];
+    unsigned extra;
+    if (!(number & 0x80)) {
+        extra = 0;
+    } else if ((number & 0xe0) == 0xc0) {
+        number &= 0x1f;
+        extra = 1;
+    } else if ((number & 0xf0) == 0xe0) {
+        number &= 0x0f;
+        extra = 2;
+    } else if ((number & 0xf8) == 0xf0) {
+        number &= 0x07;
+        extra = 3;
+    } else if ((number & 0xfc) == 0xf8) {
+        number &= 0x03;
+        extra = 4;
+    } else if ((number & 0xfe) == 0xfc) {
+        number &= 0x01;
+        extra = 5;
+    } else if (number == 0xfe && variableBlockSize) {
+        number = 0;
+        extra = 6;
+    } else {
+        return false;
+    }
+    for (unsigned i = 0; i < extra; ++i, ++n) {
+        if ((data[n] & 0xc0) != 0x80) {
+            return false;
+        }
+        number = (number << 6) | (data[n] & 0x3f);
+    }
+
+    unsigned size;
+    if (blockSizeCode == 1) {
+        size = 192;
+    } else if (blockSizeCode <= 5) {
+        size = 576 << (blockSizeCode - 2);
+    } else if (blockSizeCode == 6) {
+        size = data[n++] + 1;
+    } else if (blockSizeCode == 7) {
+        size = ((data[n] << 8) | data[n + 1]) + 1;
+        n += 2;
+    } else {
+        size = 256 << (blockSizeCode - 8);
+    }
+    if (mStreamInfo.max_blocksize > 0 && size > mStreamInfo.max_blocksize) {
+        return false;
+    }
+
+    static const unsigned kSampleRates[12] = {
+        0, 88200, 176400, 192000, 8000, 16000,
+        22050, 24000, 32000, 44100, 48000, 96000
+    };
+    unsigned sampleRate;
+    if (sampleRateCode < 12) {
+        sampleRate = kSampleRates[sampleRateCode];
+    } else if (sampleRateCode == 12) {
+        sampleRate = data[n++] * 1000;
+    } else {
+        sampleRate = (data[n] << 8) | data[n + 1];
+        if (sampleRateCode == 14) {
+            sampleRate *= 10;
+        }
+        n += 2;
+    }
+    if (sampleRate != 0 && sampleRate != mStreamInfo.sample_rate) {
+        return false;
+    }
+
+    // CRC-8, polynomial x^8 + x^2 + x + 1, over the header
+    unsigned crc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= data[i];
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+        }
+    }
+    if (crc != data[n]) {
+        return false;
+    }
+
+    if (variableBlockSize) {
+        *sample = number;
+    } else if (mStreamInfo.min_blocksize == mStreamInfo.max_blocksize) {
+        // same as libFLAC: only the last frame may be shorter
+        *sample = number * mStreamInfo.min_blocksize;
+    } else {
+        *sample = number * size;
+    }
+    *blockSize = size;
+    return true;
+}
+
+void FLACFrameScanner::onHeader(const Frame &frame, FLACSeekIndex *index)
+{
+    if (mChained) {
+        if (frame.mSample == mNextSample) {
+            accept(frame, index);
+            return;
+        }
+        if (frame.mOffset - mLastOffset <= mMaxFrameDistance) {
+            return;
+        }
+        mChained = false;
+    }
+    // until a header is confirmed by the one after it, remember the last few
+    for (size_t i = mPending.size(); i-- > 0;) {
+        const Frame &pending = mPending.itemAt(i);
+        if (pending.mSample + pending.mBlockSize == frame.mSample
+                && pending.mOffset < frame.mOffset) {
+            index->addFrame(pending.mSample, pending.mOffset);
+            mPending.clear();
+            accept(frame, index);
+            return;
+        }
+    }
+    if (mPending.size() == kMaxPending) {
+        mPending.removeAt(0);
+    }
+    mPending.push(frame);
+}
+
+void FLACFrameScanner::accept(const Frame &frame, FLACSeekIndex *index)
+{
+    index->addFrame(frame.mSample, frame.mOffset);
+    mChained = true;
+    mNextSample = frame.mSample + frame.mBlockSize;
+    mLastOffset = frame.mOffset;
+}
+
+// FLACSeekIndex
+
+struct FLACSeekIndex::ScanContext {
+    ScanContext(const FLACSeekIndex *index,
+            const sp<DataSource> &dataSource)
+        : mDataSource(dataSource),
+          mScanner(index->getStreamInfo(), index->getFirstFrameOffset()),
+          mOffset(index->getFirstFrameOffset()),
+          mBuffer(new uint8_t[kChunkSize]) {
+    }
+
+    ~ScanContext() {
+        delete[] mBuffer;
+    }
+
+    static const size_t kChunkSize = 64 * 1024;
+
+    sp<DataSource> mDataSource;
+    FLACFrameScanner mScanner;
+    off64_t mOffset;
+    uint8_t *mBuffer;
+};
+
+FLACSeekIndex::FLACSeekIndex(
+        const FLAC__StreamMetadata_StreamInfo &streamInfo,
+        off64_t firstFrameOffset)
+    : mStreamInfo(streamInfo),
+      mFirstFrameOffset(firstFrameOffset),
+      mScanning(false),
+      mComplete(false),
+      mScanContext(NULL)
+{
+    mMinSpacing = streamInfo.sample_rate / 10;
+    if (mMinSpacing == 0) {
+        mMinSpacing = 1;
+    }
+    // entries added in any order, around the SEEKTABLE ones, can end up a
+    // spacing and a block apart on either side
+    mMaxGap = 2 * (mMinSpacing + streamInfo.max_blocksize);
+}
+
+FLACSeekIndex::~FLACSeekIndex()
+{
+    ALOGV("FLACSeekIndex::~FLACSeekIndex %u entries", mEntries.size());
+    delete mScanContext;
+}
+
+ssize_t FLACSeekIndex::findEntry_l(FLAC__uint64 sample) const
+{
+    // binary search for the last entry with mSample <= sample
+    ssize_t lo = 0;
+    ssize_t hi = mEntries.size();
+    while (lo < hi) {
+        ssize_t mid = (lo + hi) / 2;
+        if (mEntries.itemAt(mid).mSample <= sample) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+void FLACSeekIndex::insertEntry_l(
+        FLAC__uint64 sample, off64_t offset, bool force)
+{
+    ssize_t index = findEntry_l(sample);
+    if (index >= 0 && mEntries.itemAt(index).mSample == sample) {
+        return;
+    }
+    if (!force) {
+        if (index >= 0
+                && sample - mEntries.itemAt(index).mSample < mMinSpacing) {
+            return;
+        }
+        if (index + 1 < (ssize_t) mEntries.size()
+                && mEntries.itemAt(index + 1).mSample - sample < mMinSpacing) {
+            return;
+        }
+    }
+    Entry entry;
+    entry.mSample = sample;
+    entry.mOffset = offset;
+    mEntries.insertAt(entry, index + 1);
+}
+
+void FLACSeekIndex::addSeekTable(
+        const Vector<FLAC__StreamMetadata_SeekPoint> &points)
+{
+    Mutex::Autolock autoLock(mLock);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const FLAC__StreamMetadata_SeekPoint &point = points.itemAt(i);
+        insertEntry_l(point.sample_number,
+                mFirstFrameOffset + (off64_t) point.stream_offset, true);
+    }
+    // Tables written by "flac" have a point every 10 seconds, which is
+    // too far apart to decode forward from. libFLAC bisects between those
+    // itself, and the index keeps filling in.
+    FLAC__uint64 last = 0;
+    for (size_t i = 0; i < mEntries.size(); ++i) {
+        if (mEntries.itemAt(i).mSample - last >= mMaxGap) {
+            break;
+        }
+        last = mEntries.itemAt(i).mSample;
+    }
+    mComplete = mStreamInfo.total_samples > 0
+            && mStreamInfo.total_samples - last < mMaxGap;
+    ALOGV("FLACSeekIndex::addSeekTable %u entries, %s", mEntries.size(),
+            mComplete ? "complete" : "sparse");
+}
+
+void FLACSeekIndex::addFrame(FLAC__uint64 sample, off64_t offset)
+{
+    Mutex::Autolock autoLock(mLock);
+    insertEntry_l(sample, offset, false);
+}
+
+bool FLACSeekIndex::wantsFrames()
+{
+    Mutex::Autolock autoLock(mLock);
+    return !mComplete && !mScanning;
+}
+
+bool FLACSeekIndex::lookup(
+        FLAC__uint64 sample, FLAC__uint64 *frameSample, off64_t *frameOffset)
+{
+    Mutex::Autolock autoLock(mLock);
+    ssize_t index = findEntry_l(sample);
+    if (index < 0) {
+        return false;
+    }
+    const Entry &entry = mEntries.itemAt(index);
+    if (sample - entry.mSample >= mMaxGap) {
+        return false;
+    }
+    *frameSample = entry.mSample;
+    *frameOffset = entry.mOffset;
+    return true;
+}
+
+void FLACSeekIndex::startScan(const sp<DataSource> &dataSource)
+{
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mComplete || mScanning) {
+            return;
+        }
+        mScanning = true;
+    }
+    mScanContext = new ScanContext(this, dataSource);
+    if (startScanThread("FLACSeekIndex") != OK) {
+        onScanDone(false);
+    }
+}
+
+bool FLACSeekIndex::scanStep()
+{
+    ScanContext *context = mScanContext;
+    ssize_t n = context->mDataSource->readAt(
+            context->mOffset, context->mBuffer, ScanContext::kChunkSize);
+    if (n <= 0) {
+        ALOGV("FLACSeekIndex scanned %lld bytes, err %d",
+                context->mOffset, (int) n);
+        onScanDone(n == 0);
+        return false;
+    }
+    context->mScanner.feed(context->mOffset, context->mBuffer, n, this);
+    context->mOffset += n;
+    return true;
+}
+
+void FLACSeekIndex::onScanDone(bool complete)
+{
+    delete mScanContext;
+    mScanContext = NULL;
+
+    Mutex::Autolock autoLock(mLock);
+    mScanning = false;
+    mComplete = complete;
+    mScanDone.broadcast();
+}
+
+size_t FLACSeekIndex::waitForScan()
+{
+    Mutex::Autolock autoLock(mLock);
+    while (mScanning) {
+        mScanDone.wait(mLock);
+    }
+    return mEntries.size();
+}
+
 // FLACParser
 
 FLACParser::FLACParser(
         const sp<DataSource> &dataSource,
         const sp<MetaData> &fileMetadata,
-        const sp<MetaData> &trackMetadata)
+        const sp<MetaData> &trackMetadata,
+        const sp<FLACSeekIndex> &seekIndex)
     : mDataSource(dataSource),
       mFileMetadata(fileMetadata),
       mTrackMetadata(trackMetadata),
       mInitCheck(false),
+      mSeekIndex(seekIndex),
+      mScanner(NULL),
+      mFirstFrameOffset(-1LL),
+      mNumBytesRead(0LL),
+      mNumReads(0),
       mMaxBufferSize(0),
       mGroup(NULL),
       mCopy(copyTrespass),
@@ -467,6 +1078,8 @@ FLACParser::~FLACParser()
         FLAC__stream_decoder_delete(mDecoder);
         mDecoder = NULL;
     }
+    delete mScanner;
+    mScanner = NULL;
 }
 
 status_t FLACParser::init()
@@ -488,6 +1101,8 @@ status_t FLACParser::init()
             mDecoder, FLAC__METADATA_TYPE_PICTURE);
     FLAC__stream_decoder_set_metadata_respond(
             mDecoder, FLAC__METADATA_TYPE_VORBIS_COMMENT);
+    FLAC__stream_decoder_set_metadata_respond(
+            mDecoder, FLAC__METADATA_TYPE_SEEKTABLE);
     FLAC__StreamDecoderInitStatus initStatus;
     initStatus = FLAC__stream_decoder_init_stream(
             mDecoder,
@@ -505,6 +1120,11 @@ status_t FLACParser::init()
         ALOGE("end_of_metadata failed");
         return NO_INIT;
     }
+    // libFLAC stops right in front of the first frame
+    FLAC__uint64 firstFrameOffset;
+    if (FLAC__stream_decoder_get_decode_position(mDecoder, &firstFrameOffset)) {
+        mFirstFrameOffset = firstFrameOffset;
+    }
     if (mStreamInfoValid) {
         // check channel count
         switch (getChannels()) {
@@ -578,6 +1198,10 @@ status_t FLACParser::init()
     if (mFileMetadata != 0) {
         mFileMetadata->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_FLAC);
     }
+    if (mSeekIndex != 0) {
+        mScanner = new FLACFrameScanner(
+                mSeekIndex->getStreamInfo(), mSeekIndex->getFirstFrameOffset());
+    }
     return OK;
 }
 
@@ -596,17 +1220,90 @@ void FLACParser::releaseBuffers()
     mGroup = NULL;
 }
 
+// Decodes the frame holding "sample", leaving in *skip how many of its
+// samples precede it. The seek index takes us straight to a frame at or
+// before the sample if it knows one, from where we decode forward, and
+// libFLAC's own seek is the fallback.
+
+bool FLACParser::seekTo(FLAC__uint64 sample, unsigned *skip)
+{
+    int64_t startUs = ALooper::GetNowUs();
+    int64_t startBytes = mNumBytesRead;
+    uint32_t startReads = mNumReads;
+    bool indexed = false;
+    FLAC__uint64 frameSample;
+    off64_t frameOffset;
+    if (mSeekIndex != 0 && (getTotalSamples() == 0 || sample < getTotalSamples())
+            && mSeekIndex->lookup(sample, &frameSample, &frameOffset)) {
+        indexed = decodeFrom(frameOffset, sample, skip);
+        if (!indexed) {
+            ALOGW("FLACParser::seekTo frame at %lld for sample %llu unusable",
+                    frameOffset, sample);
+            FLAC__stream_decoder_flush(mDecoder);
+        }
+    }
+    if (!indexed) {
+        mWriteRequested = true;
+        mWriteCompleted = false;
+        // We implement the seek callback, so this works without explicit flush
+        if (!FLAC__stream_decoder_seek_absolute(mDecoder, sample)) {
+            ALOGE("FLACParser::readBuffer seek to sample %llu failed", sample);
+            return false;
+        }
+        // libFLAC already dropped the samples before the target
+        *skip = 0;
+    }
+    ALOGV("FLACParser::readBuffer seek to sample %llu succeeded%s: "
+            "%lld us, %lld bytes in %u reads", sample,
+            indexed ? " using index" : "", ALooper::GetNowUs() - startUs,
+            mNumBytesRead - startBytes, mNumReads - startReads);
+    return true;
+}
+
+bool FLACParser::decodeFrom(
+        off64_t offset, FLAC__uint64 sample, unsigned *skip)
+{
+    if (!FLAC__stream_decoder_flush(mDecoder)) {
+        return false;
+    }
+    mCurrentPos = offset;
+    mEOF = false;
+    for (;;) {
+        mWriteRequested = true;
+        mWriteCompleted = false;
+        if (!FLAC__stream_decoder_process_single(mDecoder)) {
+            return false;
+        }
+        if (!mWriteCompleted) {
+            // libFLAC reports damaged frames and moves on to the next one
+            FLAC__StreamDecoderState state =
+                    FLAC__stream_decoder_get_state(mDecoder);
+            if (state == FLAC__STREAM_DECODER_END_OF_STREAM
+                    || state == FLAC__STREAM_DECODER_ABORTED) {
+                return false;
+            }
+            continue;
+        }
+        FLAC__uint64 first = mWriteHeader.number.sample_number;
+        if (sample < first) {
+            return false;
+        }
+        if (sample - first < mWriteHeader.blocksize) {
+            *skip = sample - first;
+            return true;
+        }
+    }
+}
+
 MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
 {
+    unsigned skip = 0;
     mWriteRequested = true;
     mWriteCompleted = false;
     if (doSeek) {
-        // We implement the seek callback, so this works without explicit flush
-        if (!FLAC__stream_decoder_seek_absolute(mDecoder, sample)) {
-            ALOGE("FLACParser::readBuffer seek to sample %llu failed", sample);
+        if (!seekTo(sample, &skip)) {
             return NULL;
         }
-        ALOGV("FLACParser::readBuffer seek to sample %llu succeeded", sample);
     } else {
         if (!FLAC__stream_decoder_process_single(mDecoder)) {
             ALOGE("FLACParser::readBuffer process_single failed");
@@ -635,15 +1332,22 @@ MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
     if (err != OK) {
         return NULL;
     }
+    // after a seek that decoded forward, start at the requested sample
+    CHECK(skip < blocksize);
+    blocksize -= skip;
+    const FLAC__int32 *src[FLAC__MAX_CHANNELS];
+    for (unsigned i = 0; i < getChannels(); ++i) {
+        src[i] = mWriteBuffer[i] + skip;
+    }
     size_t bufferSize = blocksize * getChannels() * sizeof(short);
     CHECK(bufferSize <= mMaxBufferSize);
     short *data = (short *) buffer->data();
     buffer->set_range(0, bufferSize);
     // copy PCM from FLAC write buffer to our media buffer, with interleaving
-    (*mCopy)(data, mWriteBuffer, blocksize);
+    (*mCopy)(data, src, blocksize);
     // fill in buffer metadata
     CHECK(mWriteHeader.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
-    FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number;
+    FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number + skip;
     int64_t timeUs = (1000000LL * sampleNumber) / getSampleRate();
     buffer->meta_data()->setInt64(kKeyTime, timeUs);
     buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
@@ -654,9 +1358,11 @@ MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
 
 FLACSource::FLACSource(
         const sp<DataSource> &dataSource,
-        const sp<MetaData> &trackMetadata)
+        const sp<MetaData> &trackMetadata,
+        const sp<FLACSeekIndex> &seekIndex)
     : mDataSource(dataSource),
       mTrackMetadata(trackMetadata),
+      mSeekIndex(seekIndex),
       mParser(0),
       mInitCheck(false),
       mStarted(false)
@@ -731,16 +1437,17 @@ status_t FLACSource::init()
 {
     ALOGV("FLACSource::init");
     // re-use the same track metadata passed into constructor from FLACExtractor
-    mParser = new FLACParser(mDataSource);
+    mParser = new FLACParser(mDataSource, 0, 0, mSeekIndex);
     return mParser->initCheck();
 }
 
 // FLACExtractor
 
 FLACExtractor::FLACExtractor(
-        const sp<DataSource> &dataSource)
+        const sp<DataSource> &dataSource, bool useSeekIndex)
     : mDataSource(dataSource),
-      mInitCheck(false)
+      mInitCheck(false),
+      mUseSeekIndex(useSeekIndex)
 {
     ALOGV("FLACExtractor::FLACExtractor");
     mInitCheck = init();
@@ -761,7 +1468,7 @@ sp<MediaSource> FLACExtractor::getTrack(size_t index)
     if (mInitCheck != OK || index > 0) {
         return NULL;
     }
-    return new FLACSource(mDataSource, mTrackMetadata);
+    return new FLACSource(mDataSource, mTrackMetadata, mSeekIndex);
 }
 
 sp<MetaData> FLACExtractor::getTrackMetaData(
@@ -779,7 +1486,25 @@ status_t FLACExtractor::init()
     mTrackMetadata = new MetaData;
     // FLACParser will fill in the metadata for us
     mParser = new FLACParser(mDataSource, mFileMetadata, mTrackMetadata);
-    return mParser->initCheck();
+    status_t err = mParser->initCheck();
+    if (err != OK || !mUseSeekIndex || mParser->getFirstFrameOffset() < 0) {
+        return err;
+    }
+    mSeekIndex = new FLACSeekIndex(
+            mParser->getStreamInfo(), mParser->getFirstFrameOffset());
+    if (!mParser->getSeekPoints().isEmpty()) {
+        mSeekIndex->addSeekTable(mParser->getSeekPoints());
+    }
+    // a second reader would keep dragging a cache away from playback
+    if (!(mDataSource->flags() & DataSource::kIsCachingDataSource)) {
+        mSeekIndex->startScan(mDataSource);
+    }
+    return OK;
+}
+
+size_t FLACExtractor::waitForSeekIndex()
+{
+    return mSeekIndex != 0 ? mSeekIndex->waitForScan() : 0;
 }
 
 sp<MetaData> FLACExtractor::getMetaData()
@@ -835,49 +835,124 @@ off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
 }
 
 static void StripStartcode(MediaBuffer *buffer) {
-    if (buffer->range_length() < 4) {
+    if (buffer->range_length() < 3) {
         return;
     }
 
     const uint8_t *ptr =
         (const uint8_t *)buffer->data() + buffer->range_offset();
 
-    if (!memcmp(ptr, "\x00\x00\x00\x01", 4)) {
+    if (buffer->range_length() >= 4 && !memcmp(ptr, "\x00\x00\x00\x01", 4)) {
         buffer->set_range(
                 buffer->range_offset() + 4, buffer->range_length() - 4);
+    } else if (!memcmp(ptr, "\x00\x00\x01", 3)) {
+        buffer->set_range(
+                buffer->range_offset() + 3, buffer->range_length() - 3);
     }
 }
 
-off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
-    off64_t old_offset = mOffset;
+static const uint8_t *findNextStartCode(
+        const uint8_t *data, size_t length) {
 
-    size_t length = buffer->range_length();
+    ALOGV("findNextStartCode: %p %d", data, length);
 
-    if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
+    size_t bytesLeft = length;
+    while (bytesLeft > 4  &&
+            memcmp("\x00\x00\x00\x01", &data[length - bytesLeft], 4)) {
+        --bytesLeft;
+    }
+    if (bytesLeft <= 4) {
+        bytesLeft = 0; // Last parameter set
+    }
+    return &data[length - bytesLeft];
+}
 
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
+// Returns the end of the NAL unit at "data" in an AVC sample whose leading
+// start code has been stripped, and sets *next to the NAL unit after it.
+// Unless the sample is flagged with kKeyMultipleNALUnits it is a single
+// NAL unit; otherwise the NAL units are separated by 3 or 4 byte start
+// codes.
+static const uint8_t *findNalUnitEnd(
+        const uint8_t *data, const uint8_t *end, bool multipleNalUnits,
+        const uint8_t **next) {
+    *next = end;
+    if (!multipleNalUnits) {
+        return end;
+    }
+
+    for (const uint8_t *ptr = data; ptr + 3 <= end; ++ptr) {
+        if (ptr[2] > 1) {
+            ptr += 2;
+        } else if (ptr[0] == 0 && ptr[1] == 0 && ptr[2] == 1) {
+            *next = ptr + 3;
+            return (ptr > data && ptr[-1] == 0) ? ptr - 1 : ptr;
+        }
+    }
+    return end;
+}
 
-        mOffset += length + 4;
-    } else {
-        CHECK_LT(length, 65536);
+// Returns the size of an AVC sample of several NAL units once each of them
+// has a length prefix of nalLengthSize bytes in place of its start code.
+static size_t getLengthPrefixedSize(
+        const uint8_t *data, size_t length, size_t nalLengthSize) {
+    const uint8_t *end = data + length;
+    size_t size = 0;
+    do {
+        const uint8_t *next;
+        const uint8_t *nalEnd = findNalUnitEnd(data, end, true, &next);
+        size += nalLengthSize + (nalEnd - data);
+        data = next;
+    } while (data < end);
+    return size;
+}
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
-    }
+off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
+    off64_t old_offset = mOffset;
+
+    const uint8_t *data =
+        (const uint8_t *)buffer->data() + buffer->range_offset();
+    const uint8_t *end = data + buffer->range_length();
+
+    // A picture encoded as several slices may come as one NAL unit per
+    // slice, separated by start codes; each gets its own length prefix.
+    int32_t multipleNalUnits;
+    if (!buffer->meta_data()->findInt32(
+                kKeyMultipleNALUnits, &multipleNalUnits)) {
+        multipleNalUnits = false;
+    }
+
+    do {
+        const uint8_t *next;
+        const uint8_t *nalEnd =
+            findNalUnitEnd(data, end, multipleNalUnits, &next);
+        size_t length = nalEnd - data;
+
+        if (mUse4ByteNalLength) {
+            uint8_t x = length >> 24;
+            ::write(mFd, &x, 1);
+            x = (length >> 16) & 0xff;
+            ::write(mFd, &x, 1);
+            x = (length >> 8) & 0xff;
+            ::write(mFd, &x, 1);
+            x = length & 0xff;
+            ::write(mFd, &x, 1);
+
+            ::write(mFd, data, length);
+
+            mOffset += length + 4;
+        } else {
+            CHECK_LT(length, 65536);
+
+            uint8_t x = length >> 8;
+            ::write(mFd, &x, 1);
+            x = length & 0xff;
+            ::write(mFd, &x, 1);
+            ::write(mFd, data, length);
+            mOffset += length + 2;
+        }
+
+        data = next;
+    } while (data < end);
 
     return old_offset;
 }
@@ -1585,22 +1660,6 @@ static void getNalUnitType(uint8_t byte, uint8_t* type) {
     *type = (byte & 0x1F);
 }
 
-static const uint8_t *findNextStartCode(
-        const uint8_t *data, size_t length) {
-
-    ALOGV("findNextStartCode: %p %d", data, length);
-
-    size_t bytesLeft = length;
-    while (bytesLeft > 4  &&
-            memcmp("\x00\x00\x00\x01", &data[length - bytesLeft], 4)) {
-        --bytesLeft;
-    }
-    if (bytesLeft <= 4) {
-        bytesLeft = 0; // Last parameter set
-    }
-    return &data[length - bytesLeft];
-}
-
 const uint8_t *MPEG4Writer::Track::parseParamSet(
         const uint8_t *data, size_t length, int type, size_t *paramSetLen) {
 
@@ -1932,7 +1991,17 @@ status_t MPEG4Writer::Track::threadEntry() {
 
         size_t sampleSize = copy->range_length();
         if (mIsAvc) {
-            if (mOwner->useNalLengthFour()) {
+            // Each NAL unit gets a length prefix, in place of the start
+            // code separating it from the previous one, if any.
+            int32_t multipleNalUnits;
+            if (meta_data->findInt32(kKeyMultipleNALUnits, &multipleNalUnits)
+                    && multipleNalUnits) {
+                copy->meta_data()->setInt32(kKeyMultipleNALUnits, true);
+                sampleSize = getLengthPrefixedSize(
+                        (const uint8_t *)copy->data() + copy->range_offset(),
+                        copy->range_length(),
+                        mOwner->useNalLengthFour() ? 4 : 2);
+            } else if (mOwner->useNalLengthFour()) {
                 sampleSize += 4;
             } else {
                 sampleSize += 2;
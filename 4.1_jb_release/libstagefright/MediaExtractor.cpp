@@ -30,6 +30,7 @@
 #include "include/AACExtractor.h"
 #include "include/ExtendedExtractor.h"
 #include "matroska/MatroskaExtractor.h"
+#include "matroska/PrebuiltMatroskaExtractor.h"
 
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/DataSource.h>
@@ -51,6 +52,18 @@ uint32_t MediaExtractor::flags() const {
     return CAN_SEEK_BACKWARD | CAN_SEEK_FORWARD | CAN_PAUSE | CAN_SEEK;
 }
 
+// Files with tracks only the prebuilt Matroska extractor handles (VobSub,
+// ACM audio, the less common VFW fourccs) are opened with it instead.
+static MediaExtractor *CreateMatroskaExtractor(const sp<DataSource> &source) {
+    if (!MatroskaExtractor::NeedsPrebuilt(source)) {
+        return new MatroskaExtractor(source);
+    }
+
+    ALOGI("opening matroska file with the prebuilt extractor");
+
+    return new PrebuiltMatroskaExtractor(source);
+}
+
 // static
 sp<MediaExtractor> MediaExtractor::Create(
         const sp<DataSource> &source, const char *mime) {
@@ -133,7 +146,7 @@ sp<MediaExtractor> MediaExtractor::Create(
             }
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MATROSKA)) {
             if (strstr(value, "Matroska")) {
-                ret = new MatroskaExtractor(source);
+                ret = CreateMatroskaExtractor(source);
             }
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MPEG2TS)) {
             if (strstr(value, "Mpeg2ts")) {
@@ -164,7 +177,7 @@ sp<MediaExtractor> MediaExtractor::Create(
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_OGG)) {
             ret = new OggExtractor(source);
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MATROSKA)) {
-            ret = new MatroskaExtractor(source);
+            ret = CreateMatroskaExtractor(source);
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MPEG2TS)) {
             ret = new MPEG2TSExtractor(source);
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_WVM)) {
@@ -271,7 +284,7 @@ sp<MediaExtractor> MediaExtractor::Create(
             }
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MATROSKA)) {
             if (strstr(value, "Matroska")) {
-                ret = new MatroskaExtractor(source);
+                ret = CreateMatroskaExtractor(source);
             }
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MPEG2TS)) {
             if(!strncasecmp("http://",path, 7)) {
@@ -309,7 +322,7 @@ sp<MediaExtractor> MediaExtractor::Create(
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_OGG)) {
             ret = new OggExtractor(source);
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MATROSKA)) {
-            ret = new MatroskaExtractor(source);
+            ret = CreateMatroskaExtractor(source);
 
 
         } else if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MPEG2TS)) {
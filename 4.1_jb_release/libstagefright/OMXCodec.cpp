@@ -39,6 +39,7 @@
 #include "include/FLVDecoder.h"
 #include "include/VC1Decoder.h"
 #include "include/ESDS.h"
+#include "include/SoftOMXComponent.h"
 
 #include <binder/IServiceManager.h>
 #include <binder/MemoryDealer.h>
@@ -2331,6 +2332,10 @@ void OMXCodec::on_message(const omx_message &msg) {
                     buffer->meta_data()->setInt32(kKeyIsCodecConfig, true);
                     isCodecSpecific = true;
                 }
+                if (msg.u.extended_buffer_data.flags
+                        & kSoftOMXBufferFlagMultipleNALUnits) {
+                    buffer->meta_data()->setInt32(kKeyMultipleNALUnits, true);
+                }
 
                 if (isGraphicBuffer || mQuirks & kOutputBuffersAreUnreadable) {
                     buffer->meta_data()->setInt32(kKeyIsUnreadable, true);
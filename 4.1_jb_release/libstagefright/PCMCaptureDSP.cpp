@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PCMCaptureDSP"
+#include <utils/Log.h>
+
+#include "include/PCMCaptureDSP.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// As in PCMConversion, the SSE2 loops are built whenever the target has
+// them and the C loops take whatever is left over, giving the same
+// results. The peak is kept as the largest and smallest sample seen, which
+// the C loops leave for the compiler to vectorize on other targets.
+
+namespace android {
+
+#if defined(__SSE2__)
+static inline int32_t horizontalMax(__m128i x) {
+    x = _mm_max_epi16(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_max_epi16(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    x = _mm_max_epi16(x, _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (int16_t)_mm_cvtsi128_si32(x);
+}
+
+static inline int32_t horizontalMin(__m128i x) {
+    x = _mm_min_epi16(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_min_epi16(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    x = _mm_min_epi16(x, _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (int16_t)_mm_cvtsi128_si32(x);
+}
+#endif
+
+static void copySamples(
+        int16_t *dst, const int16_t *src, size_t n,
+        int32_t *hi, int32_t *lo) {
+    size_t i = 0;
+    int32_t maxValue = *hi;
+    int32_t minValue = *lo;
+
+#if defined(__SSE2__)
+    if (n >= 16) {
+        __m128i max0 = _mm_set1_epi16(maxValue);
+        __m128i min0 = _mm_set1_epi16(minValue);
+        __m128i max1 = max0;
+        __m128i min1 = min0;
+
+        for (; i + 16 <= n; i += 16) {
+            __m128i x0 = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i x1 = _mm_loadu_si128((const __m128i *)(src + i + 8));
+            _mm_storeu_si128((__m128i *)(dst + i), x0);
+            _mm_storeu_si128((__m128i *)(dst + i + 8), x1);
+
+            max0 = _mm_max_epi16(max0, x0);
+            min0 = _mm_min_epi16(min0, x0);
+            max1 = _mm_max_epi16(max1, x1);
+            min1 = _mm_min_epi16(min1, x1);
+        }
+
+        maxValue = horizontalMax(_mm_max_epi16(max0, max1));
+        minValue = horizontalMin(_mm_min_epi16(min0, min1));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        int32_t x = src[i];
+        dst[i] = x;
+        maxValue = x > maxValue ? x : maxValue;
+        minValue = x < minValue ? x : minValue;
+    }
+
+    *hi = maxValue;
+    *lo = minValue;
+}
+
+// "frame" is where src begins on the fade, all of it lies before the
+// end of the fade.
+static void rampSamples(
+        int16_t *dst, const int16_t *src,
+        size_t numFrames, size_t numChannels, int32_t frame, int32_t step,
+        int32_t *hi, int32_t *lo) {
+    size_t n = numFrames * numChannels;
+    size_t i = 0;
+    int32_t maxValue = *hi;
+    int32_t minValue = *lo;
+
+#if defined(__SSE2__)
+    // A vector then spans whole frames and moves on by the same number
+    // of them each time.
+    if (n >= 8 && 8 % numChannels == 0) {
+        int32_t c = numChannels;
+        __m128i g0 = _mm_setr_epi32(
+                (frame + 0 / c) * step, (frame + 1 / c) * step,
+                (frame + 2 / c) * step, (frame + 3 / c) * step);
+        __m128i g1 = _mm_setr_epi32(
+                (frame + 4 / c) * step, (frame + 5 / c) * step,
+                (frame + 6 / c) * step, (frame + 7 / c) * step);
+        __m128i inc = _mm_set1_epi32((8 / c) * step);
+
+        __m128i max0 = _mm_set1_epi16(maxValue);
+        __m128i min0 = _mm_set1_epi16(minValue);
+
+        for (; i + 8 <= n; i += 8) {
+            __m128i g = _mm_packs_epi32(
+                    _mm_srli_epi32(g0, 16), _mm_srli_epi32(g1, 16));
+
+            __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i productLo = _mm_mullo_epi16(x, g);
+            __m128i productHi = _mm_mulhi_epi16(x, g);
+            __m128i y = _mm_packs_epi32(
+                    _mm_srai_epi32(_mm_unpacklo_epi16(productLo, productHi), 14),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(productLo, productHi), 14));
+            _mm_storeu_si128((__m128i *)(dst + i), y);
+
+            max0 = _mm_max_epi16(max0, y);
+            min0 = _mm_min_epi16(min0, y);
+
+            g0 = _mm_add_epi32(g0, inc);
+            g1 = _mm_add_epi32(g1, inc);
+        }
+
+        maxValue = horizontalMax(max0);
+        minValue = horizontalMin(min0);
+    }
+#endif
+
+    for (size_t f = i / numChannels; f < numFrames; ++f) {
+        int32_t g = ((frame + (int32_t)f) * step) >> 16;
+        for (; i < (f + 1) * numChannels; ++i) {
+            int32_t y = (src[i] * g) >> 14;
+            dst[i] = y;
+            maxValue = y > maxValue ? y : maxValue;
+            minValue = y < minValue ? y : minValue;
+        }
+    }
+
+    *hi = maxValue;
+    *lo = minValue;
+}
+
+int16_t CopyPCMWithRampAndPeak(
+        int16_t *dst, const int16_t *src,
+        size_t numFrames, size_t numChannels,
+        int64_t rampFrame, int32_t rampDurationFrames) {
+    int32_t hi = 0;
+    int32_t lo = 0;
+
+    if (rampFrame < 0 && numFrames > 0) {
+        size_t n = numFrames;
+        if ((int64_t)n > -rampFrame) {
+            n = -rampFrame;
+        }
+
+        memset(dst, 0, n * numChannels * sizeof(int16_t));
+
+        dst += n * numChannels;
+        src += n * numChannels;
+        numFrames -= n;
+        rampFrame += n;
+    }
+
+    if (rampFrame < rampDurationFrames && numFrames > 0) {
+        size_t n = numFrames;
+        if ((int64_t)n > rampDurationFrames - rampFrame) {
+            n = rampDurationFrames - rampFrame;
+        }
+
+        rampSamples(
+                dst, src, n, numChannels,
+                (int32_t)rampFrame, (1 << 30) / rampDurationFrames, &hi, &lo);
+
+        dst += n * numChannels;
+        src += n * numChannels;
+        numFrames -= n;
+    }
+
+    if (numFrames > 0) {
+        copySamples(dst, src, numFrames * numChannels, &hi, &lo);
+    }
+
+    int32_t peak = hi > -lo ? hi : -lo;
+    return peak > 32767 ? 32767 : peak;
+}
+
+}  // namespace android
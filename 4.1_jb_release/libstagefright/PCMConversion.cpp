@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PCMConversion"
+#include <utils/Log.h>
+
+#include "include/PCMConversion.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+// The SSE2 and SSSE3 loops are built whenever the target has them, every
+// x86 Android device does. Whatever is left over at the end of a buffer,
+// and everything on other targets, goes through the C loops, which give
+// the same results.
+
+namespace android {
+
+static int16_t sALawToS16[256];
+static int16_t sMuLawToS16[256];
+static float sALawToFloat[256];
+static float sMuLawToFloat[256];
+
+static pthread_once_t sTablesOnce = PTHREAD_ONCE_INIT;
+
+// Same expansion as SoftG711::DecodeALaw() and SoftG711::DecodeMLaw().
+static void initTables() {
+    for (int32_t x = 0; x < 256; ++x) {
+        int32_t ix = (x ^ 0x55) & 0x7f;
+        int32_t iexp = ix >> 4;
+        int32_t mant = ix & 0x0f;
+        if (iexp > 0) {
+            mant += 16;
+        }
+        mant = (mant << 4) + 8;
+        if (iexp > 1) {
+            mant = mant << (iexp - 1);
+        }
+        sALawToS16[x] = (x > 127) ? mant : -mant;
+
+        int32_t mantissa = ~x;
+        int32_t exponent = (mantissa >> 4) & 7;
+        int32_t segment = exponent + 1;
+        mantissa &= 0x0f;
+        int32_t step = 4 << segment;
+        int32_t abs = (0x80l << exponent) + step * mantissa + step / 2 - 4 * 33;
+        sMuLawToS16[x] = (x < 0x80) ? -abs : abs;
+
+        sALawToFloat[x] = sALawToS16[x] * (1.0f / 32768.0f);
+        sMuLawToFloat[x] = sMuLawToS16[x] * (1.0f / 32768.0f);
+    }
+}
+
+size_t PCMSampleSize(PCMSampleFormat format) {
+    switch (format) {
+        case kPCMFormatU8:
+        case kPCMFormatALaw:
+        case kPCMFormatMuLaw:
+            return 1;
+        case kPCMFormatS16:
+            return 2;
+        case kPCMFormatS24:
+            return 3;
+        case kPCMFormatS32:
+        case kPCMFormatFloat:
+            return 4;
+    }
+    return 0;
+}
+
+static inline int32_t S32_LE_AT(const uint8_t *ptr) {
+    return (int32_t)(ptr[3] << 24 | ptr[2] << 16 | ptr[1] << 8 | ptr[0]);
+}
+
+static inline float FLOAT_LE_AT(const uint8_t *ptr) {
+    uint32_t bits = (uint32_t)S32_LE_AT(ptr);
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// Matches the SSE2 loop: NaN and anything above full scale clip to the
+// top, rounding is to nearest even.
+static inline int16_t floatToS16(float x) {
+    float y = x * 32768.0f;
+    if (!(y < 32767.0f)) {
+        return 32767;
+    }
+    if (y < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void convertU8ToS16(int16_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for (; i + 16 <= n; i += 16) {
+        // x ^ 0x80 is x - 128 as a signed byte, put into the high byte
+        __m128i x = _mm_xor_si128(
+                _mm_loadu_si128((const __m128i *)(src + i)), bias);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi8(zero, x));
+        _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpackhi_epi8(zero, x));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = ((int16_t)src[i] - 128) * 256;
+    }
+}
+
+static void convertS24ToS16(int16_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // keeps the upper two bytes of each sample, 8 samples from 24 bytes
+    const __m128i lo = _mm_setr_epi8(
+            1, 2, 4, 5, 7, 8, 10, 11, 13, 14, -1, -1, -1, -1, -1, -1);
+    const __m128i hi = _mm_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, 9, 11, 12, 14, 15);
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *p = src + 3 * i;
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), lo);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 8)), hi);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(a, b));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint8_t *p = src + 3 * i;
+        dst[i] = (int16_t)(p[1] | p[2] << 8);
+    }
+}
+
+static void convertS32ToS16(int16_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 4 * i + 16));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(
+                _mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = (int16_t)(S32_LE_AT(src + 4 * i) >> 16);
+    }
+}
+
+static void convertFloatToS16(int16_t *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 top = _mm_set1_ps(32767.0f);
+    const __m128 bottom = _mm_set1_ps(-32768.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps((const float *)(src + 4 * i)), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps((const float *)(src + 4 * i + 16)), scale);
+        // min returns its second operand for NaN
+        a = _mm_max_ps(_mm_min_ps(a, top), bottom);
+        b = _mm_max_ps(_mm_min_ps(b, top), bottom);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(
+                _mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = floatToS16(FLOAT_LE_AT(src + 4 * i));
+    }
+}
+
+static void convertTableToS16(
+        int16_t *dst, const uint8_t *src, size_t n, const int16_t *table) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int16_t a = table[src[i]];
+        int16_t b = table[src[i + 1]];
+        int16_t c = table[src[i + 2]];
+        int16_t d = table[src[i + 3]];
+        dst[i] = a;
+        dst[i + 1] = b;
+        dst[i + 2] = c;
+        dst[i + 3] = d;
+    }
+    for (; i < n; ++i) {
+        dst[i] = table[src[i]];
+    }
+}
+
+void ConvertPCMToS16(
+        int16_t *dst, const void *_src, PCMSampleFormat format,
+        size_t numSamples) {
+    const uint8_t *src = (const uint8_t *)_src;
+
+    switch (format) {
+        case kPCMFormatU8:
+            convertU8ToS16(dst, src, numSamples);
+            break;
+        case kPCMFormatS16:
+            if ((const void *)dst != _src) {
+                memcpy(dst, src, numSamples * sizeof(int16_t));
+            }
+            break;
+        case kPCMFormatS24:
+            convertS24ToS16(dst, src, numSamples);
+            break;
+        case kPCMFormatS32:
+            convertS32ToS16(dst, src, numSamples);
+            break;
+        case kPCMFormatFloat:
+            convertFloatToS16(dst, src, numSamples);
+            break;
+        case kPCMFormatALaw:
+            pthread_once(&sTablesOnce, initTables);
+            convertTableToS16(dst, src, numSamples, sALawToS16);
+            break;
+        case kPCMFormatMuLaw:
+            pthread_once(&sTablesOnce, initTables);
+            convertTableToS16(dst, src, numSamples, sMuLawToS16);
+            break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void convertU8ToFloat(float *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_xor_si128(
+                _mm_loadu_si128((const __m128i *)(src + i)), bias);
+        __m128i w[2] = {
+            _mm_unpacklo_epi8(zero, x), _mm_unpackhi_epi8(zero, x)
+        };
+        for (int j = 0; j < 2; ++j) {
+            // the byte ends up in the top of each 32 bit lane
+            __m128i l = _mm_srai_epi32(_mm_unpacklo_epi16(zero, w[j]), 24);
+            __m128i h = _mm_srai_epi32(_mm_unpackhi_epi16(zero, w[j]), 24);
+            _mm_storeu_ps(dst + i + 8 * j, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+            _mm_storeu_ps(dst + i + 8 * j + 4, _mm_mul_ps(_mm_cvtepi32_ps(h), scale));
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = ((int32_t)src[i] - 128) * (1.0f / 128.0f);
+    }
+}
+
+static void convertS16ToFloat(float *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        __m128i l = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16);
+        __m128i h = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(h), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint8_t *p = src + 2 * i;
+        dst[i] = (int16_t)(p[0] | p[1] << 8) * (1.0f / 32768.0f);
+    }
+}
+
+static void convertS24ToFloat(float *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // moves each sample into the top of a 32 bit lane, 8 from 24 bytes
+    const __m128i lo = _mm_setr_epi8(
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128i hi = _mm_setr_epi8(
+            -1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15);
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *p = src + 3 * i;
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), lo);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 8)), hi);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint8_t *p = src + 3 * i;
+        int32_t x = (int32_t)(p[0] << 8 | p[1] << 16 | p[2] << 24);
+        dst[i] = (float)x * (1.0f / 2147483648.0f);
+    }
+}
+
+static void convertS32ToFloat(float *dst, const uint8_t *src, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = (float)S32_LE_AT(src + 4 * i) * (1.0f / 2147483648.0f);
+    }
+}
+
+static void convertTableToFloat(
+        float *dst, const uint8_t *src, size_t n, const float *table) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float a = table[src[i]];
+        float b = table[src[i + 1]];
+        float c = table[src[i + 2]];
+        float d = table[src[i + 3]];
+        dst[i] = a;
+        dst[i + 1] = b;
+        dst[i + 2] = c;
+        dst[i + 3] = d;
+    }
+    for (; i < n; ++i) {
+        dst[i] = table[src[i]];
+    }
+}
+
+void ConvertPCMToFloat(
+        float *dst, const void *_src, PCMSampleFormat format,
+        size_t numSamples) {
+    const uint8_t *src = (const uint8_t *)_src;
+
+    switch (format) {
+        case kPCMFormatU8:
+            convertU8ToFloat(dst, src, numSamples);
+            break;
+        case kPCMFormatS16:
+            convertS16ToFloat(dst, src, numSamples);
+            break;
+        case kPCMFormatS24:
+            convertS24ToFloat(dst, src, numSamples);
+            break;
+        case kPCMFormatS32:
+            convertS32ToFloat(dst, src, numSamples);
+            break;
+        case kPCMFormatFloat:
+            memcpy(dst, src, numSamples * sizeof(float));
+            break;
+        case kPCMFormatALaw:
+            pthread_once(&sTablesOnce, initTables);
+            convertTableToFloat(dst, src, numSamples, sALawToFloat);
+            break;
+        case kPCMFormatMuLaw:
+            pthread_once(&sTablesOnce, initTables);
+            convertTableToFloat(dst, src, numSamples, sMuLawToFloat);
+            break;
+    }
+}
+
+}  // namespace android
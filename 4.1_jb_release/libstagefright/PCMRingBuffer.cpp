@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "PCMRingBuffer"
+#include <utils/Log.h>
+
+#include "include/PCMRingBuffer.h"
+
+#include <cutils/atomic.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <string.h>
+
+namespace android {
+
+static size_t roundUpToPowerOf2(size_t x) {
+    size_t y = 1;
+    while (y < x) {
+        y <<= 1;
+    }
+    return y;
+}
+
+// The producer publishes data and tags with a release store of its
+// position, the consumer picks them up with an acquire load, and the same
+// the other way round for the room that was freed. The write position is
+// loaded before the tags, a tag pinned anywhere before it is then visible.
+
+PCMRingBuffer::PCMRingBuffer(size_t minCapacity, size_t minNumTags)
+    : mCapacity(roundUpToPowerOf2(minCapacity)),
+      mNumTags(roundUpToPowerOf2(minNumTags)),
+      mWritePosition(0),
+      mReadPosition(0),
+      mTagWriteIndex(0),
+      mTagReadIndex(0) {
+    CHECK_LE(mCapacity, 0x40000000u);
+
+    mData = new uint8_t[mCapacity];
+    mTags = new Tag[mNumTags];
+}
+
+PCMRingBuffer::~PCMRingBuffer() {
+    delete[] mTags;
+    mTags = NULL;
+
+    delete[] mData;
+    mData = NULL;
+}
+
+size_t PCMRingBuffer::getWritableBytes() const {
+    uint32_t readPos = android_atomic_acquire_load(&mReadPosition);
+
+    return mCapacity - ((uint32_t)mWritePosition - readPos);
+}
+
+bool PCMRingBuffer::canWriteTag() const {
+    uint32_t readIndex = android_atomic_acquire_load(&mTagReadIndex);
+
+    return (uint32_t)mTagWriteIndex - readIndex < mNumTags;
+}
+
+size_t PCMRingBuffer::write(const void *data, size_t size) {
+    size_t n = getWritableBytes();
+    if (size > n) {
+        size = n;
+    }
+
+    uint32_t writePos = mWritePosition;
+    size_t offset = writePos & (mCapacity - 1);
+    size_t first = mCapacity - offset;
+    if (first > size) {
+        first = size;
+    }
+
+    memcpy(mData + offset, data, first);
+    memcpy(mData, (const uint8_t *)data + first, size - first);
+
+    android_atomic_release_store(writePos + size, &mWritePosition);
+
+    return size;
+}
+
+bool PCMRingBuffer::writeTag(const Tag &tag) {
+    if (!canWriteTag()) {
+        return false;
+    }
+
+    uint32_t index = mTagWriteIndex;
+    Tag *out = &mTags[index & (mNumTags - 1)];
+    *out = tag;
+    out->mPosition = mWritePosition;
+
+    android_atomic_release_store(index + 1, &mTagWriteIndex);
+
+    return true;
+}
+
+uint32_t PCMRingBuffer::getReadPosition() const {
+    return mReadPosition;
+}
+
+size_t PCMRingBuffer::getReadableBytes() const {
+    uint32_t readPos = mReadPosition;
+    size_t n = (uint32_t)android_atomic_acquire_load(&mWritePosition) - readPos;
+
+    uint32_t index = mTagReadIndex;
+    if ((uint32_t)android_atomic_acquire_load(&mTagWriteIndex) != index) {
+        size_t toTag = mTags[index & (mNumTags - 1)].mPosition - readPos;
+        if (toTag < n) {
+            n = toTag;
+        }
+    }
+
+    return n;
+}
+
+size_t PCMRingBuffer::getReadRegion(const uint8_t **data) const {
+    size_t n = getReadableBytes();
+
+    size_t offset = (uint32_t)mReadPosition & (mCapacity - 1);
+    if (n > mCapacity - offset) {
+        n = mCapacity - offset;
+    }
+
+    *data = mData + offset;
+
+    return n;
+}
+
+void PCMRingBuffer::advanceRead(size_t size) {
+    android_atomic_release_store(
+            (uint32_t)mReadPosition + size, &mReadPosition);
+}
+
+bool PCMRingBuffer::getDueTag(Tag *tag) const {
+    uint32_t index = mTagReadIndex;
+    if ((uint32_t)android_atomic_acquire_load(&mTagWriteIndex) == index) {
+        return false;
+    }
+
+    *tag = mTags[index & (mNumTags - 1)];
+
+    return tag->mPosition == (uint32_t)mReadPosition;
+}
+
+void PCMRingBuffer::popTag() {
+    android_atomic_release_store(mTagReadIndex + 1, &mTagReadIndex);
+}
+
+bool PCMRingBuffer::skipToEpoch(int32_t epoch) {
+    for (;;) {
+        uint32_t readPos = mReadPosition;
+        uint32_t writePos = android_atomic_acquire_load(&mWritePosition);
+
+        uint32_t index = mTagReadIndex;
+        if ((uint32_t)android_atomic_acquire_load(&mTagWriteIndex) == index) {
+            advanceRead(writePos - readPos);
+            return false;
+        }
+
+        const Tag &tag = mTags[index & (mNumTags - 1)];
+        advanceRead(tag.mPosition - readPos);
+
+        if (tag.mEpoch == epoch) {
+            return true;
+        }
+
+        popTag();
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "TimeStretcher"
+#include <utils/Log.h>
+
+#include "include/TimeStretcher.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace android {
+
+// Sequences get shorter as the rate goes up, long ones smear transients
+// when slowing down less than short ones, but make fast speech echoey.
+static const int32_t kMaxSequenceMs = 90;
+static const int32_t kMinSequenceMs = 40;
+static const int32_t kMaxSeekMs = 20;
+static const int32_t kMinSeekMs = 15;
+static const int32_t kOverlapMs = 8;
+
+// The seek window is first searched at every kCoarseStep-th offset, then
+// around the best of those.
+static const size_t kCoarseStep = 4;
+
+// Dot product of a and b, and energy of b, over n samples.
+static void correlate(
+        const float *a, const float *b, size_t n, float *dot, float *energy) {
+    size_t i = 0;
+    float d = 0.0f, e = 0.0f;
+#if defined(__SSE__)
+    __m128 d0 = _mm_setzero_ps(), d1 = _mm_setzero_ps();
+    __m128 e0 = _mm_setzero_ps(), e1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        __m128 x0 = _mm_loadu_ps(b + i);
+        __m128 x1 = _mm_loadu_ps(b + i + 4);
+        d0 = _mm_add_ps(d0, _mm_mul_ps(_mm_loadu_ps(a + i), x0));
+        d1 = _mm_add_ps(d1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), x1));
+        e0 = _mm_add_ps(e0, _mm_mul_ps(x0, x0));
+        e1 = _mm_add_ps(e1, _mm_mul_ps(x1, x1));
+    }
+    float sums[8];
+    _mm_storeu_ps(sums, _mm_add_ps(d0, d1));
+    _mm_storeu_ps(sums + 4, _mm_add_ps(e0, e1));
+    d = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    e = (sums[4] + sums[5]) + (sums[6] + sums[7]);
+#else
+    // Four independent sums, which the compiler can keep in one vector.
+    float d4[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float e4[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (; i + 4 <= n; i += 4) {
+        for (size_t j = 0; j < 4; ++j) {
+            d4[j] += a[i + j] * b[i + j];
+            e4[j] += b[i + j] * b[i + j];
+        }
+    }
+    d = (d4[0] + d4[1]) + (d4[2] + d4[3]);
+    e = (e4[0] + e4[1]) + (e4[2] + e4[3]);
+#endif
+    for (; i < n; ++i) {
+        d += a[i] * b[i];
+        e += b[i] * b[i];
+    }
+    *dot = d;
+    *energy = e;
+}
+
+static void toMono(
+        float *dst, const int16_t *src, size_t numFrames, int32_t numChannels) {
+    if (numChannels == 1) {
+        for (size_t i = 0; i < numFrames; ++i) {
+            dst[i] = src[i];
+        }
+    } else {
+        for (size_t i = 0; i < numFrames; ++i) {
+            dst[i] = (int32_t)src[2 * i] + src[2 * i + 1];
+        }
+    }
+}
+
+// Fades from a to b over numFrames frames.
+static void crossfade(
+        int16_t *dst, const int16_t *a, const int16_t *b, size_t numFrames,
+        int32_t numChannels) {
+    int32_t n = numFrames;
+    for (int32_t i = 0; i < n; ++i) {
+        for (int32_t ch = 0; ch < numChannels; ++ch) {
+            int32_t k = i * numChannels + ch;
+            dst[k] = (a[k] * (n - i) + b[k] * i) / n;
+        }
+    }
+}
+
+TimeStretcher::TimeStretcher(int32_t sampleRate, int32_t numChannels)
+    : mSampleRate(sampleRate),
+      mNumChannels(numChannels),
+      mRatePermille(1000),
+      mFlushing(false),
+      mOverlapFrames(0),
+      mInput(NULL),
+      mInputCapacity(0),
+      mInputFrames(0),
+      mOutput(NULL),
+      mOutputFrames(0),
+      mOutputOffset(0),
+      mOverlap(NULL),
+      mHaveOverlap(false),
+      mSkipRemainder(0),
+      mMonoOverlap(NULL),
+      mMonoInput(NULL) {
+    CHECK(numChannels == 1 || numChannels == 2);
+    CHECK_GT(sampleRate, 0);
+
+    // A multiple of 8 keeps the correlation in whole vectors.
+    mOverlapFrames = (sampleRate * kOverlapMs / 1000 + 7) & ~7;
+
+    size_t maxSequenceFrames, maxSeekFrames;
+    getSequenceFrames(kMinRatePermille, &maxSequenceFrames, &maxSeekFrames);
+
+    for (int32_t rate = kMinRatePermille; rate <= kMaxRatePermille; ++rate) {
+        size_t required = getRequiredFrames(rate);
+        if (required > mInputCapacity) {
+            mInputCapacity = required;
+        }
+    }
+
+    mInput = new int16_t[mInputCapacity * numChannels];
+    mOutput = new int16_t[maxSequenceFrames * numChannels];
+    mOverlap = new int16_t[mOverlapFrames * numChannels];
+    mMonoOverlap = new float[mOverlapFrames];
+    mMonoInput = new float[maxSeekFrames + mOverlapFrames];
+
+    ALOGV("overlap %d frames, up to %d frames of input held back",
+         mOverlapFrames, mInputCapacity);
+}
+
+TimeStretcher::~TimeStretcher() {
+    delete[] mMonoInput;
+    mMonoInput = NULL;
+    delete[] mMonoOverlap;
+    mMonoOverlap = NULL;
+    delete[] mOverlap;
+    mOverlap = NULL;
+    delete[] mOutput;
+    mOutput = NULL;
+    delete[] mInput;
+    mInput = NULL;
+}
+
+void TimeStretcher::setRatePermille(int32_t ratePermille) {
+    if (ratePermille < kMinRatePermille) {
+        ratePermille = kMinRatePermille;
+    } else if (ratePermille > kMaxRatePermille) {
+        ratePermille = kMaxRatePermille;
+    }
+    mRatePermille = ratePermille;
+}
+
+void TimeStretcher::reset() {
+    mFlushing = false;
+    mInputFrames = 0;
+    mOutputFrames = 0;
+    mOutputOffset = 0;
+    mHaveOverlap = false;
+    mSkipRemainder = 0;
+}
+
+bool TimeStretcher::isEmpty() const {
+    return mInputFrames == 0
+        && mOutputOffset == mOutputFrames
+        && !mHaveOverlap;
+}
+
+bool TimeStretcher::isPassThrough() const {
+    return mRatePermille == 1000 && isEmpty();
+}
+
+int64_t TimeStretcher::getBufferedDurationUs() const {
+    // What has been put together still stands for input at the rate.
+    int64_t permille = (int64_t)mInputFrames * 1000
+        + (int64_t)(mOutputFrames - mOutputOffset) * mRatePermille;
+
+    return permille * 1000 / mSampleRate;
+}
+
+void TimeStretcher::getSequenceFrames(
+        int32_t ratePermille, size_t *sequenceFrames,
+        size_t *seekFrames) const {
+    // Linear between 0.5x and 2x, flat beyond.
+    int32_t rate = ratePermille;
+    if (rate < 500) {
+        rate = 500;
+    } else if (rate > 2000) {
+        rate = 2000;
+    }
+
+    int32_t sequenceMs =
+        kMaxSequenceMs - (rate - 500) * (kMaxSequenceMs - kMinSequenceMs) / 1500;
+    int32_t seekMs = kMaxSeekMs - (rate - 500) * (kMaxSeekMs - kMinSeekMs) / 1500;
+
+    *sequenceFrames = mSampleRate * sequenceMs / 1000;
+    *seekFrames = mSampleRate * seekMs / 1000;
+}
+
+size_t TimeStretcher::getRequiredFrames(int32_t ratePermille) const {
+    size_t sequenceFrames, seekFrames;
+    getSequenceFrames(ratePermille, &sequenceFrames, &seekFrames);
+
+    // The window has to be there in full, and the skip has to be covered
+    // whatever was left over from the previous one.
+    size_t skipFrames =
+        ((int64_t)ratePermille * (sequenceFrames - mOverlapFrames) + 999) / 1000 + 1;
+    size_t windowFrames = seekFrames + sequenceFrames;
+
+    return skipFrames > windowFrames ? skipFrames : windowFrames;
+}
+
+size_t TimeStretcher::findBestOffset(size_t seekFrames) {
+    size_t n = mOverlapFrames;
+
+    toMono(mMonoOverlap, mOverlap, n, mNumChannels);
+    toMono(mMonoInput, mInput, seekFrames + n, mNumChannels);
+
+    size_t best = 0;
+    float bestScore = -HUGE_VALF;
+
+    for (size_t offset = 0; offset < seekFrames; offset += kCoarseStep) {
+        float dot, energy;
+        correlate(mMonoOverlap, mMonoInput + offset, n, &dot, &energy);
+        float score = dot / sqrtf(energy + 1.0f);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+
+    size_t first = best >= kCoarseStep ? best - kCoarseStep + 1 : 0;
+    size_t last = best + kCoarseStep - 1;
+    if (last >= seekFrames) {
+        last = seekFrames - 1;
+    }
+
+    size_t coarseBest = best;
+    for (size_t offset = first; offset <= last; ++offset) {
+        if (offset == coarseBest) {
+            continue;
+        }
+
+        float dot, energy;
+        correlate(mMonoOverlap, mMonoInput + offset, n, &dot, &energy);
+        float score = dot / sqrtf(energy + 1.0f);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+
+    return best;
+}
+
+void TimeStretcher::consumeInput(size_t numFrames) {
+    CHECK_LE(numFrames, mInputFrames);
+
+    mInputFrames -= numFrames;
+    memmove(mInput, mInput + numFrames * mNumChannels,
+            mInputFrames * mNumChannels * sizeof(int16_t));
+}
+
+// Puts together the next sequence: the overlap faded into the best match
+// for it within the seek window, followed by the rest of the sequence from
+// there. The input then moves on by the nominal skip.
+void TimeStretcher::runSequence() {
+    size_t sequenceFrames, seekFrames;
+    getSequenceFrames(mRatePermille, &sequenceFrames, &seekFrames);
+
+    size_t n = mOverlapFrames;
+    size_t offset = 0;
+    if (mHaveOverlap) {
+        offset = findBestOffset(seekFrames);
+        crossfade(mOutput, mOverlap, mInput + offset * mNumChannels, n,
+                  mNumChannels);
+    } else {
+        memcpy(mOutput, mInput, n * mNumChannels * sizeof(int16_t));
+    }
+
+    memcpy(mOutput + n * mNumChannels,
+           mInput + (offset + n) * mNumChannels,
+           (sequenceFrames - 2 * n) * mNumChannels * sizeof(int16_t));
+    mOutputFrames = sequenceFrames - n;
+    mOutputOffset = 0;
+
+    memcpy(mOverlap,
+           mInput + (offset + sequenceFrames - n) * mNumChannels,
+           n * mNumChannels * sizeof(int16_t));
+    mHaveOverlap = true;
+
+    int64_t skip = (int64_t)mRatePermille * (sequenceFrames - n) + mSkipRemainder;
+    mSkipRemainder = skip % 1000;
+    consumeInput(skip / 1000);
+}
+
+// Fades the overlap into the input for good, from then on the input is
+// passed through as it is.
+void TimeStretcher::rejoin() {
+    size_t sequenceFrames, seekFrames;
+    getSequenceFrames(mRatePermille, &sequenceFrames, &seekFrames);
+
+    size_t n = mOverlapFrames;
+    if (mInputFrames < n) {
+        // Only when flushing, the overlap is as good an ending as any.
+        memcpy(mOutput, mOverlap, n * mNumChannels * sizeof(int16_t));
+        mOutputFrames = n;
+        mOutputOffset = 0;
+        mInputFrames = 0;
+        mHaveOverlap = false;
+        return;
+    }
+
+    size_t offset = 0;
+    if (mInputFrames >= seekFrames + n) {
+        offset = findBestOffset(seekFrames);
+    }
+
+    crossfade(mOutput, mOverlap, mInput + offset * mNumChannels, n,
+              mNumChannels);
+    mOutputFrames = n;
+    mOutputOffset = 0;
+    mHaveOverlap = false;
+    mSkipRemainder = 0;
+
+    consumeInput(offset + n);
+}
+
+size_t TimeStretcher::process(
+        int16_t *out, size_t maxOutFrames,
+        const int16_t *in, size_t *inFrames) {
+    size_t numOut = 0;
+    size_t numIn = 0;
+    size_t available = *inFrames;
+
+    for (;;) {
+        size_t n = mOutputFrames - mOutputOffset;
+        if (n > maxOutFrames - numOut) {
+            n = maxOutFrames - numOut;
+        }
+        memcpy(out + numOut * mNumChannels,
+               mOutput + mOutputOffset * mNumChannels,
+               n * mNumChannels * sizeof(int16_t));
+        mOutputOffset += n;
+        numOut += n;
+
+        if (numOut == maxOutFrames) {
+            break;
+        }
+
+        size_t required;
+        if (mRatePermille != 1000 && !mFlushing) {
+            required = getRequiredFrames(mRatePermille);
+            if (mInputFrames >= required) {
+                runSequence();
+                continue;
+            }
+        } else if (mHaveOverlap) {
+            size_t sequenceFrames, seekFrames;
+            getSequenceFrames(mRatePermille, &sequenceFrames, &seekFrames);
+
+            required = seekFrames + mOverlapFrames;
+            if (mInputFrames >= required || mFlushing) {
+                rejoin();
+                continue;
+            }
+        } else {
+            // Passing through, what is buffered goes first.
+            n = mInputFrames;
+            if (n > maxOutFrames - numOut) {
+                n = maxOutFrames - numOut;
+            }
+            memcpy(out + numOut * mNumChannels, mInput,
+                   n * mNumChannels * sizeof(int16_t));
+            consumeInput(n);
+            numOut += n;
+
+            n = available - numIn;
+            if (n > maxOutFrames - numOut) {
+                n = maxOutFrames - numOut;
+            }
+            if (n > 0) {
+                memcpy(out + numOut * mNumChannels, in + numIn * mNumChannels,
+                       n * mNumChannels * sizeof(int16_t));
+                numIn += n;
+                numOut += n;
+            }
+            break;
+        }
+
+        if (numIn == available) {
+            break;
+        }
+
+        // Only ever take in as much as the next step needs, that keeps the
+        // latency down.
+        n = required - mInputFrames;
+        if (n > available - numIn) {
+            n = available - numIn;
+        }
+        memcpy(mInput + mInputFrames * mNumChannels, in + numIn * mNumChannels,
+               n * mNumChannels * sizeof(int16_t));
+        mInputFrames += n;
+        numIn += n;
+    }
+
+    *inFrames = numIn;
+
+    return numOut;
+}
+
+size_t TimeStretcher::flush(int16_t *out, size_t maxOutFrames) {
+    mFlushing = true;
+
+    size_t numIn = 0;
+    return process(out, maxOutFrames, NULL, &numIn);
+}
+
+}  // namespace android
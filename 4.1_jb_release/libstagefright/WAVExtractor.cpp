@@ -19,6 +19,8 @@
 #include <utils/Log.h>
 
 #include "include/WAVExtractor.h"
+#include "include/ADPCMDecoder.h"
+#include "include/PCMConversion.h"
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/DataSource.h>
@@ -40,6 +42,13 @@ enum {
     WAVE_FORMAT_ALAW = 6,
     WAVE_FORMAT_MULAW = 7,
 };
+#else
+enum {
+    WAVE_FORMAT_EXTENSIBLE = 0xfffe,
+};
+
+// WAVEFORMATEX followed by wSamplesPerBlock, wNumCoef and 7 coefficient sets
+static const uint32_t kMSADPCMFormatSize = 50;
 #endif
 
 static uint32_t U32_LE_AT(const uint8_t *ptr) {
@@ -96,8 +105,15 @@ private:
 	uint32_t mNumSamples;
 	uint32_t mWBitsPerSample;//the encoder data bits width each sample
 	bool isLittleEndian;
-	MSADPCM_PRIVATE * pMsAdpcm;
-	tPCM * pPCM;
+	tPCM * pPCM;//only 3 bit IMA ADPCM still goes through the wavdec library
+	PCMSampleFormat mSampleFormat;
+	size_t mBlocksPerBuffer;
+	size_t mFramesPerBuffer;
+
+	static const size_t kMaxOutputSize;
+
+	status_t readADPCMBlocks(MediaBuffer *buffer);
+	status_t readPCMFrames(MediaBuffer *buffer);
 #endif
     MediaBufferGroup *mGroup;
     off64_t mCurrentPos;
@@ -280,8 +296,10 @@ status_t WAVExtractor::init() {
 
 
     // Get file size at the very first time
-	if(mDataSource->getSize((off64_t *)&mDataSize)!= OK)
+	off64_t fileSize;
+	if(mDataSource->getSize(&fileSize)!= OK)
 		return NO_INIT;
+	mDataSize = fileSize;
 
 
     uint32_t filepos = 0;
@@ -368,48 +386,64 @@ status_t WAVExtractor::init() {
 	//make sure the fmt chuck data is OK.
 	uint32_t needbyte = (SubChunk_Size > 1024)?1024:SubChunk_Size;
 
-	if (mDataSource->readAt(filepos, iBuffer, needbyte) < needbyte)
+	if (needbyte < 16 || mDataSource->readAt(filepos, iBuffer, needbyte) < needbyte)
     {
 
         return NO_INIT;
     }
 
 	filepos += SubChunk_Size;
-	PCMWAVEFORMAT sWaveFormat;
-	//long	read_size;
 
-	/* clear the sWaveFormat structure */
-	memset((void *)&sWaveFormat,0, sizeof(sWaveFormat));
-
-	// Copy the wave format structure from the "fmt " chunk into a
-	// local.  We do this instead of grabbing the values directly from
-	// the data buffer since the "fmt " chunk can occur with any
-	// alignment, making it a lot easier to simply copy the structure.
-	//
+	// The fields are picked out one at a time, copying the chunk into a
+	// PCMWAVEFORMAT only works where long is 32 bits.
+	uint16_t formatTag = U16_LE_AT(iBuffer);
+	uint16_t nChannels = U16_LE_AT(&iBuffer[2]);
+	uint32_t nSamplesPerSec = U32_LE_AT(&iBuffer[4]);
+	uint32_t nAvgBytesPerSec = U32_LE_AT(&iBuffer[8]);
+	uint16_t nBlockAlign = U16_LE_AT(&iBuffer[12]);
+	uint16_t wBitsPerSample = U16_LE_AT(&iBuffer[14]);
+	uint16_t cbSize = (needbyte >= 18) ? U16_LE_AT(&iBuffer[16]) : 0;
+	uint16_t wSamplesPerBlock = (needbyte >= 20) ? U16_LE_AT(&iBuffer[18]) : 0;
+	uint16_t wNumCoef = (needbyte >= 22) ? U16_LE_AT(&iBuffer[20]) : 0;
+
+	if (formatTag == WAVE_FORMAT_EXTENSIBLE)
+	{
+		// the format tag leads the sub format GUID
+		if (needbyte < 40)
+		{
+			ALOGE("--->PVWAVPARSER_READ_ERROR21");
+			return NO_INIT;
+		}
+		formatTag = U16_LE_AT(&iBuffer[24]);
+		if (formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT)
+		{
+			ALOGE("--->PVWAVPARSER_READ_ERROR21");
+			return NO_INIT;
+		}
+	}
 
-	int type = (int)iBuffer[0];
-	if (type == (int)WAVE_FORMAT_ADPCM)//MSADPCM
+	if (formatTag == WAVE_FORMAT_ADPCM)//MSADPCM
 	{
 
 		// If the length of the "fmt " chunk is not the same as the size
 		// of the MS ADPCM wave format sturcture, then we can not decode
 		// this file.
 		//
-		if (SubChunk_Size != sizeof(PCMWAVEFORMAT)-2)	//
+		if (SubChunk_Size != kMSADPCMFormatSize)	//
 		{
 			ALOGE("--->PVWAVPARSER_READ_ERROR16");
 			return NO_INIT;
 		}
-		memcpy((void *)&sWaveFormat,
-			   iBuffer, sizeof(PCMWAVEFORMAT));
 
 		/* sanity check */
-		if ((sWaveFormat.nChannels > 2) ||
-			(sWaveFormat.nBlockAlign > 4096) ||
-			(sWaveFormat.wBitsPerSample != 4) ||
-			(sWaveFormat.cbSize != 32) ||
-			(sWaveFormat.wSamplesPerBlock > MSADPCM_MAX_PCM_LENGTH) ||
-			(sWaveFormat.wNumCoef != 7))
+		if ((nChannels > 2) ||
+			(nBlockAlign > 4096) ||
+			(wBitsPerSample != 4) ||
+			(cbSize != 32) ||
+			(wSamplesPerBlock > MSADPCM_MAX_PCM_LENGTH) ||
+			(wSamplesPerBlock < 2) ||
+			(wSamplesPerBlock > MSADPCMMaxSamplesPerBlock(nBlockAlign, nChannels)) ||
+			(wNumCoef != 7))
 		{
 			//
 			// The wave format does not pass the sanity checks, so we can
@@ -420,15 +454,13 @@ status_t WAVExtractor::init() {
 		}
 
 	}
-	else if ( type == (int)WAVE_FORMAT_DVI_ADPCM)//IMAADPCM
+	else if (formatTag == WAVE_FORMAT_DVI_ADPCM)//IMAADPCM
 	{
-		memcpy((void *)&sWaveFormat, iBuffer, 20);
-
 		/* sanity check */
-		if ((sWaveFormat.nChannels > 2) ||
-				(sWaveFormat.nBlockAlign > 4096) ||
-				(sWaveFormat.cbSize != 2) ||
-				(sWaveFormat.wSamplesPerBlock > IMAADPCM_MAX_PCM_LENGTH))
+		if ((nChannels > 2) ||
+				(nBlockAlign > 4096) ||
+				(cbSize != 2) ||
+				(wSamplesPerBlock > IMAADPCM_MAX_PCM_LENGTH))
 		{
 			//
 			// The wave format does not pass the sanity checks, so we can
@@ -439,19 +471,28 @@ status_t WAVExtractor::init() {
 		}
 
 		/* IMA ADPCM supports 3 or 4 bits per sample. */
-		if (!( sWaveFormat.wBitsPerSample ==3 || sWaveFormat.wBitsPerSample ==4 ))
+		if (!( wBitsPerSample ==3 || wBitsPerSample ==4 ))
 		{
 			ALOGE("--->PVWAVPARSER_READ_ERROR19");
 			return NO_INIT;
 
 		}
+
+		if (wBitsPerSample == 4 &&
+				((wSamplesPerBlock < 1) ||
+				 (wSamplesPerBlock > IMAADPCMMaxSamplesPerBlock(nBlockAlign, nChannels))))
+		{
+			ALOGE("--->PVWAVPARSER_READ_ERROR18");
+			return NO_INIT;
+		}
 	}
-	else if ( type == WAVE_FORMAT_PCM)//PCM
+	else if (formatTag == WAVE_FORMAT_PCM
+			|| formatTag == WAVE_FORMAT_IEEE_FLOAT
+			|| formatTag == WAVE_FORMAT_ALAW
+			|| formatTag == WAVE_FORMAT_MULAW)//PCM
 	{
-		memcpy((void *)&sWaveFormat, iBuffer, SubChunk_Size);
-
 		/* sanity check */
-		if ((sWaveFormat.nChannels > 2)||(sWaveFormat.nBlockAlign > 4096))
+		if ((nChannels > 2)||(nBlockAlign > 4096))
 		{
 			//
 			// The wave format does not pass the sanity checks, so we can
@@ -461,6 +502,25 @@ status_t WAVExtractor::init() {
 			ALOGE("--->PVWAVPARSER_READ_ERROR20");
 			return NO_INIT;
 		}
+
+		bool supported;
+		switch (formatTag) {
+			case WAVE_FORMAT_PCM:
+				supported = wBitsPerSample == 8 || wBitsPerSample == 16
+						|| wBitsPerSample == 24 || wBitsPerSample == 32;
+				break;
+			case WAVE_FORMAT_IEEE_FLOAT:
+				supported = wBitsPerSample == 32;
+				break;
+			default:
+				supported = wBitsPerSample == 8;
+				break;
+		}
+		if (!supported)
+		{
+			ALOGE("--->PVWAVPARSER_READ_ERROR20");
+			return NO_INIT;
+		}
 	}
 	else
 	{
@@ -473,14 +533,17 @@ status_t WAVExtractor::init() {
 //--------------------------------------------------------------
 
 	/* Save information about this file which we will need. */
-	mWaveFormat = sWaveFormat.wFormatTag;
-	mNumChannels = (unsigned char)sWaveFormat.nChannels;
-	mSampleRate = (unsigned short)sWaveFormat.nSamplesPerSec;
-	mByteRate = sWaveFormat.nAvgBytesPerSec;
-	mBlockAlign = sWaveFormat.nBlockAlign;
-	mBitsPerSample = (sWaveFormat.wBitsPerSample == 8)?8:16;
-	mWBitsPerSample = sWaveFormat.wBitsPerSample;
-	mSamplesPerBlock = sWaveFormat.wSamplesPerBlock;
+	mWaveFormat = formatTag;
+	mNumChannels = nChannels;
+	mSampleRate = nSamplesPerSec;
+	mByteRate = nAvgBytesPerSec;
+	mBlockAlign = nBlockAlign;
+	mWBitsPerSample = wBitsPerSample;
+	mSamplesPerBlock = wSamplesPerBlock;
+	if (formatTag == WAVE_FORMAT_ADPCM || formatTag == WAVE_FORMAT_DVI_ADPCM)
+		mBitsPerSample = 16;//the decoded output
+	else
+		mBitsPerSample = wBitsPerSample;
 	mBytesPerSample = (mBitsPerSample + 7) / 8;  // compute (ceil(BitsPerSample/8))
 	switch (mSampleRate)
     {
@@ -560,26 +623,14 @@ status_t WAVExtractor::init() {
 
 	 mTrackMeta = new MetaData;
 	 ALOGV("----->mWaveFormat %d",mWaveFormat);
-	 switch (mWaveFormat) {
-
-	 	case WAVE_FORMAT_ADPCM:
-		case WAVE_FORMAT_DVI_ADPCM:
-			//reset the mNumSamples value
-			mNumSamples = (PCMBytesPresent/(uint32_t)mBlockAlign)*sWaveFormat.wSamplesPerBlock;//computer the totle num of samples
-        case WAVE_FORMAT_PCM:
-            mTrackMeta->setCString(
-                    kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_RAW);
-            break;
-        case WAVE_FORMAT_ALAW:
-            mTrackMeta->setCString(
-                    kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_G711_ALAW);
-            break;
-        default:
-            CHECK_EQ(mWaveFormat, WAVE_FORMAT_MULAW);
-            mTrackMeta->setCString(
-                    kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_G711_MLAW);
-            break;
-    }
+	 if ((mWaveFormat == WAVE_FORMAT_ADPCM || mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
+	 		&& mBlockAlign) {
+		//reset the mNumSamples value
+		mNumSamples = (PCMBytesPresent/(uint32_t)mBlockAlign)*mSamplesPerBlock;//computer the totle num of samples
+	 }
+	 // WAVSource hands out 16 bit PCM whatever the file holds
+	 mTrackMeta->setCString(
+	 		kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_RAW);
 
     mTrackMeta->setInt32(kKeyChannelCount, mNumChannels);
     mTrackMeta->setInt32(kKeySampleRate, mSampleRate);
@@ -605,6 +656,10 @@ status_t WAVExtractor::init() {
 
 const size_t WAVSource::kMaxFrameSize = 32768;
 #if SUPPORT_ADPCM
+// Decoded bytes per read, 8 bit and 24 or 32 bit sources need up to twice
+// that much room.
+const size_t WAVSource::kMaxOutputSize = 65536;
+
 WAVSource::WAVSource(
         const sp<DataSource> &dataSource,
         const sp<MetaData> &meta,
@@ -619,7 +674,6 @@ WAVSource::WAVSource(
       mSize(extractor->mDataSize),
       mStarted(false),
       mGroup(NULL){
-      pMsAdpcm = NULL;
 	  pPCM = NULL;
 	mByteRate = extractor->mByteRate;
     mBlockAlign =  extractor->mBlockAlign;
@@ -632,6 +686,27 @@ WAVSource::WAVSource(
 	isLittleEndian =  extractor->isLittleEndian;
 	mOutNumSamples = 0;;//output the total num sample after each reset
 	mTimeUs = 0LL;
+	mBlocksPerBuffer = 0;
+	mFramesPerBuffer = 0;
+
+	switch (mWaveFormat) {
+		case WAVE_FORMAT_IEEE_FLOAT:
+			mSampleFormat = kPCMFormatFloat;
+			break;
+		case WAVE_FORMAT_ALAW:
+			mSampleFormat = kPCMFormatALaw;
+			break;
+		case WAVE_FORMAT_MULAW:
+			mSampleFormat = kPCMFormatMuLaw;
+			break;
+		default:
+			// what the ADPCM decoders produce, or PCM of the given width
+			mSampleFormat =
+				mBitsPerSample == 8 ? kPCMFormatU8 :
+				mBitsPerSample == 24 ? kPCMFormatS24 :
+				mBitsPerSample == 32 ? kPCMFormatS32 : kPCMFormatS16;
+			break;
+	}
 
    mMeta->setInt32(kKeySampleRate, mSampleRate);
    mMeta->setInt32(kKeyChannelCount, mNumChannels);
@@ -672,22 +747,20 @@ status_t WAVSource::start(MetaData *params) {
     CHECK(!mStarted);
 
     mGroup = new MediaBufferGroup;
-    mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
-
-    if (mBitsPerSample == 8) {
-        // As a temporary buffer for 8->16 bit conversion.
-        mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
-    }
-
-    mCurrentPos = mOffset;
 #if SUPPORT_ADPCM
+    mCurrentPos = mOffset;
+	mOutNumSamples = 0;
+	mTimeUs = 0LL;
+
 	 /* Save information about this file which we will need. */
-	if(mWaveFormat == WAVE_FORMAT_ADPCM|| mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
+	if(mWaveFormat == WAVE_FORMAT_DVI_ADPCM && mWBitsPerSample == 3)
 	{
 		pPCM = new tPCM;
 		if(!pPCM)//creat failed ,return;
 		{
 			ALOGE("--->PVWAVPARSER_READ_ERROR27");
+			delete mGroup;
+			mGroup = NULL;
 			return UNKNOWN_ERROR;
 		}
 
@@ -707,24 +780,39 @@ status_t WAVSource::start(MetaData *params) {
 	    pPCM->wFormatTag = mWaveFormat;
 		pPCM->ulLength =  mSize - mOffset;//data chunk length
 
-		if(mWaveFormat == WAVE_FORMAT_ADPCM)
-		{
-			if (pPCM->ulLength == 0xffffffff)
-				pPCM->ulLength = 0x7fffffff;
-			pMsAdpcm = new MSADPCM_PRIVATE;
-			if(!pMsAdpcm)
-			{
-				ALOGE("--->PVWAVPARSER_READ_ERROR28");
-				delete pPCM;
-				pPCM = NULL;
-				return UNKNOWN_ERROR;
-			}
-			omx_msadpcm_dec_init(pPCM, pMsAdpcm);
-		}
-		else
-			mNumChannels = 2;//the IMA decoder,though the channel is mone or stero , the out data is stero data
+		mNumChannels = 2;//the IMA decoder,though the channel is mone or stero , the out data is stero data
+		mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
+	}
+	else if(mWaveFormat == WAVE_FORMAT_ADPCM|| mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
+	{
+		// The blocks are read in behind the room for their samples and
+		// decoded straight into the buffer, several per read.
+		size_t blockOutputSize = mSamplesPerBlock * mNumChannels * sizeof(int16_t);
+		mBlocksPerBuffer = kMaxOutputSize / blockOutputSize;
+		if (mBlocksPerBuffer == 0)
+			mBlocksPerBuffer = 1;
+		mGroup->add_buffer(new MediaBuffer(
+				mBlocksPerBuffer * (blockOutputSize + mBlockAlign)));
+	}
+	else
+	{
+		// 8 bit samples are read into the second half of the buffer and
+		// expanded from there, wider ones are narrowed in place.
+		size_t sampleSize = PCMSampleSize(mSampleFormat);
+		mFramesPerBuffer = kMaxOutputSize / (mNumChannels * sizeof(int16_t));
+		mGroup->add_buffer(new MediaBuffer(
+				mFramesPerBuffer * mNumChannels * (sampleSize < 2 ? 2 : sampleSize)));
 	}
 	mMeta->setInt32(kKeyChannelCount, mNumChannels);
+#else
+    mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
+
+    if (mBitsPerSample == 8) {
+        // As a temporary buffer for 8->16 bit conversion.
+        mGroup->add_buffer(new MediaBuffer(kMaxFrameSize));
+    }
+
+    mCurrentPos = mOffset;
 #endif
     mStarted = true;
 
@@ -746,11 +834,6 @@ status_t WAVSource::stop() {
 		delete pPCM;
 		pPCM = NULL;
 	}
-	if(pMsAdpcm)
-	{
-		delete pMsAdpcm;
-		pMsAdpcm = NULL;
-	}
 #endif
     return OK;
 }
@@ -761,6 +844,81 @@ sp<MetaData> WAVSource::getFormat() {
     return mMeta;
 }
 
+#if SUPPORT_ADPCM
+status_t WAVSource::readADPCMBlocks(MediaBuffer *buffer) {
+	size_t numBlocks = mBlocksPerBuffer;
+	size_t available =
+		(mCurrentPos >= (off64_t)mSize) ? 0 : (mSize - mCurrentPos) / mBlockAlign;
+	if (numBlocks > available) {
+		numBlocks = available;
+	}
+	if (numBlocks == 0) {
+		return ERROR_END_OF_STREAM;
+	}
+
+	size_t blockOutputSize = mSamplesPerBlock * mNumChannels * sizeof(int16_t);
+	int16_t *samples = (int16_t *)buffer->data();
+	uint8_t *blocks = (uint8_t *)buffer->data() + mBlocksPerBuffer * blockOutputSize;
+
+	ssize_t n = mDataSource->readAt(mCurrentPos, blocks, numBlocks * mBlockAlign);
+	if (n < (ssize_t)mBlockAlign) {
+		return ERROR_END_OF_STREAM;
+	}
+	numBlocks = n / mBlockAlign;
+	mCurrentPos += numBlocks * mBlockAlign;
+
+	buffer->meta_data()->setInt64(
+			kKeyTime, mTimeUs + 1000000LL * mOutNumSamples / mSampleRate);
+
+	if (mWaveFormat == WAVE_FORMAT_ADPCM) {
+		DecodeMSADPCMBlocks(
+				samples, blocks, numBlocks, mBlockAlign, mSamplesPerBlock,
+				mNumChannels);
+	} else {
+		DecodeIMAADPCMBlocks(
+				samples, blocks, numBlocks, mBlockAlign, mSamplesPerBlock,
+				mNumChannels);
+	}
+	mOutNumSamples += numBlocks * mSamplesPerBlock;
+
+	buffer->set_range(0, numBlocks * blockOutputSize);
+	return OK;
+}
+
+status_t WAVSource::readPCMFrames(MediaBuffer *buffer) {
+	size_t frameSize = mNumChannels * mBytesPerSample;
+	size_t numFrames = mFramesPerBuffer;
+	size_t available =
+		(mCurrentPos >= (off64_t)mSize) ? 0 : (mSize - mCurrentPos) / frameSize;
+	if (numFrames > available) {
+		numFrames = available;
+	}
+	if (numFrames == 0) {
+		return ERROR_END_OF_STREAM;
+	}
+
+	uint8_t *data = (uint8_t *)buffer->data();
+	uint8_t *src = (mBytesPerSample < 2) ? data + numFrames * mNumChannels : data;
+
+	ssize_t n = mDataSource->readAt(mCurrentPos, src, numFrames * frameSize);
+	if (n < (ssize_t)frameSize) {
+		return ERROR_END_OF_STREAM;
+	}
+	numFrames = n / frameSize;
+
+	buffer->meta_data()->setInt64(
+			kKeyTime,
+			1000000LL * ((mCurrentPos - mOffset) / frameSize) / mSampleRate);
+	mCurrentPos += numFrames * frameSize;
+
+	size_t numSamples = numFrames * mNumChannels;
+	ConvertPCMToS16((int16_t *)data, src, mSampleFormat, numSamples);
+
+	buffer->set_range(0, numSamples * sizeof(int16_t));
+	return OK;
+}
+#endif
+
 status_t WAVSource::read(
         MediaBuffer **out, const ReadOptions *options) {
     *out = NULL;
@@ -777,14 +935,20 @@ status_t WAVSource::read(
 			blockCounter += ((numSamples%mSamplesPerBlock) > (mSamplesPerBlock >> 1))?1:0;
 			pos = blockCounter * mBlockAlign;
 			mOutNumSamples = 0;;//output the total num sample after each reset
-			mTimeUs = seekTimeUs;
+			mTimeUs = blockCounter * mSamplesPerBlock * 1000000LL / mSampleRate;
 		}
 		else
-#endif
+			pos = (seekTimeUs * mSampleRate) / 1000000 * mNumChannels * mBytesPerSample;
+		// mSize is where the data ends here
+		if (pos > (int64_t)mSize - mOffset) {
+			pos = mSize - mOffset;
+		}
+#else
 		pos = (seekTimeUs * mSampleRate) / 1000000 * mNumChannels * (mBitsPerSample >> 3);
         if (pos > mSize) {
             pos = mSize;
         }
+#endif
         mCurrentPos = pos + mOffset;
     }
 
@@ -794,7 +958,7 @@ status_t WAVSource::read(
         return err;
     }
 #if SUPPORT_ADPCM
-	if(mWaveFormat == WAVE_FORMAT_ADPCM || mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
+	if(pPCM != NULL)
 	{
 		//whether reach end of the file
 		if(mBlockAlign + mCurrentPos > mSize)
@@ -816,40 +980,34 @@ status_t WAVSource::read(
 
 		ssize_t outLen = 0;
 		 buffer->meta_data()->setInt64(kKeyTime,mTimeUs +( 1000000LL*mOutNumSamples /mSampleRate));
-		if(mWaveFormat == WAVE_FORMAT_ADPCM)
-		{
-			memcpy(pMsAdpcm->block,buffer->data(),mBlockAlign);
-			omx_msadpcm_decode_block(pMsAdpcm);
-			outLen = pMsAdpcm->samplesperblock*2*pMsAdpcm->channels;
-			memcpy(buffer->data(),pMsAdpcm->samples,outLen);
-			mOutNumSamples += pMsAdpcm->samplesperblock;
-		}
-		else if(mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
-		{
-			outLen = OMX_IMAADPCM_DEC((char*)buffer->data(), mBlockAlign, pPCM);
-			mOutNumSamples += outLen;
-			outLen = outLen *4;
-			memcpy(buffer->data(), pPCM->OutputBuff, outLen);
-		}
+		outLen = OMX_IMAADPCM_DEC((char*)buffer->data(), mBlockAlign, pPCM);
+		mOutNumSamples += outLen;
+		outLen = outLen *4;
+		memcpy(buffer->data(), pPCM->OutputBuff, outLen);
 		 buffer->set_range(0, outLen);
-
 	}
 	else
 	{
-#endif
+		if(mWaveFormat == WAVE_FORMAT_ADPCM || mWaveFormat == WAVE_FORMAT_DVI_ADPCM)
+			err = readADPCMBlocks(buffer);
+		else
+			err = readPCMFrames(buffer);
+
+		if (err != OK)
+		{
+			buffer->release();
+			buffer = NULL;
+			return err;
+		}
+	}
+#else
     size_t maxBytesToRead =
         mBitsPerSample == 8 ? kMaxFrameSize / 2 : kMaxFrameSize;
-#if SUPPORT_ADPCM
-	size_t maxBytesAvailable =
-		(mCurrentPos  >= (off64_t)mSize)
-			? 0 : mSize - mCurrentPos ;
 
-#else
 	size_t maxBytesAvailable =
 		(mCurrentPos - mOffset >= (off64_t)mSize)
 			? 0 : mSize - (mCurrentPos - mOffset);
 
-#endif
     if (maxBytesToRead > maxBytesAvailable) {
         maxBytesToRead = maxBytesAvailable;
     }
@@ -880,31 +1038,18 @@ status_t WAVSource::read(
             // one is 2 bytes wide.
             tmp->set_range(0, 2 * n);
 
-            int16_t *dst = (int16_t *)tmp->data();
-            const uint8_t *src = (const uint8_t *)buffer->data();
-            while (n-- > 0) {
-                *dst++ = ((int16_t)(*src) - 128) * 256;
-                ++src;
-            }
+            ConvertPCMToS16(
+                    (int16_t *)tmp->data(), buffer->data(), kPCMFormatU8, n);
 
             buffer->release();
             buffer = tmp;
         } else if (mBitsPerSample == 24) {
             // Convert 24-bit signed samples to 16-bit signed.
 
-            const uint8_t *src =
-                (const uint8_t *)buffer->data() + buffer->range_offset();
-            int16_t *dst = (int16_t *)src;
+            uint8_t *src = (uint8_t *)buffer->data() + buffer->range_offset();
 
             size_t numSamples = buffer->range_length() / 3;
-            for (size_t i = 0; i < numSamples; ++i) {
-                int32_t x = (int32_t)(src[0] | src[1] << 8 | src[2] << 16);
-                x = (x << 8) >> 8;  // sign extension
-
-                x = x >> 8;
-                *dst++ = (int16_t)x;
-                src += 3;
-            }
+            ConvertPCMToS16((int16_t *)src, src, kPCMFormatS24, numSamples);
 
             buffer->set_range(buffer->range_offset(), 2 * numSamples);
         }
@@ -916,8 +1061,6 @@ status_t WAVSource::read(
             kKeyTime,
             1000000LL * (mCurrentPos - mOffset)
                 / (mNumChannels * bytesPerSample) / mSampleRate);
-#if SUPPORT_ADPCM
-		}
 #endif
 
     buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
@@ -152,8 +152,90 @@ LOCAL_C_INCLUDES := \
 LOCAL_ARM_MODE := arm
 LOCAL_MODULE := libstagefright_aacdec
 
+# x86: SSE4.1 and AVX2 versions of the IMDCT, the FFTs and the SBR
+# filterbank windows, picked at run time. They are in
+# libstagefright_aacdec_sse41 and libstagefright_aacdec_avx2 below, which
+# have to be linked along with this library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+ 	aacdec_x86.cpp
+
+LOCAL_CFLAGS += -DAACDEC_X86
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../common/include
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+ 	aacdec_sse41.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include
+
+LOCAL_CFLAGS := -DAAC_PLUS -DHQ_SBR -DPARAMETRICSTEREO -DOSCL_IMPORT_REF= -DOSCL_EXPORT_REF= -DOSCL_UNUSED_ARG= \
+        -DAACDEC_X86 -msse4.1
+
+LOCAL_MODULE := libstagefright_aacdec_sse41
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+ 	aacdec_avx2.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include
+
+LOCAL_CFLAGS := -DAAC_PLUS -DHQ_SBR -DPARAMETRICSTEREO -DOSCL_IMPORT_REF= -DOSCL_EXPORT_REF= -DOSCL_UNUSED_ARG= \
+        -DAACDEC_X86 -mavx2
+
+LOCAL_MODULE := libstagefright_aacdec_avx2
+
 include $(BUILD_STATIC_LIBRARY)
 
+endif
+
+################################################################################
+# test utility: checks the x86 functions and times the decoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/AACDecBench.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH)
+
+LOCAL_CFLAGS := -DAAC_PLUS -DHQ_SBR -DPARAMETRICSTEREO -DOSCL_IMPORT_REF= -DOSCL_EXPORT_REF= -DOSCL_UNUSED_ARG=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_aacdec
+
+LOCAL_SHARED_LIBRARIES := \
+        libutils liblog
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DAACDEC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_aacdec_sse41 \
+        libstagefright_aacdec_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := aacdec_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -170,6 +252,13 @@ LOCAL_CFLAGS := -DOSCL_IMPORT_REF=
 
 LOCAL_STATIC_LIBRARIES := \
         libstagefright_aacdec 
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_aacdec_sse41 \
+        libstagefright_aacdec_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_LDFLAGS :=  \
 	$(LOCAL_PATH)/faad/libstagefright_faad.a 
 LOCAL_LDLIBS = -L(LOCAL_PATH)
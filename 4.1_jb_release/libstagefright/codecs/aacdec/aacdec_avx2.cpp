@@ -0,0 +1,416 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: aacdec_avx2.cpp
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                   Date: MM/DD/YYYY
+ Description:
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+ AVX2 IMDCT, FFTs and SBR filterbank windows, eight butterflies or samples
+ per vector, four in the FFT stages that have fewer. Built with -mavx2 in
+ libstagefright_aacdec_avx2; aacdec_x86.cpp only calls it on CPUs and
+ kernels that have AVX2.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <immintrin.h>
+
+#include "aacdec_x86.h"
+#include "aacdec_sse41_ops.h"
+#include "aacdec_x86_lanes.h"
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+typedef Int32 v8si __attribute__((vector_size(32)));
+
+struct aacdec_ops_avx2
+{
+    typedef v8si V;
+    typedef aacdec_ops_sse41 H;
+    enum { N = 8 };
+
+    static inline V load(const Int32 *p)
+    {
+        return (V)_mm256_loadu_si256((const __m256i *)p);
+    }
+    static inline void store(Int32 *p, V a)
+    {
+        _mm256_storeu_si256((__m256i *)p, (__m256i)a);
+    }
+    static inline V rev(V a)
+    {
+        return (V)_mm256_permutevar8x32_epi32((__m256i)a,
+                                              _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static inline V load_rev(const Int32 *p)
+    {
+        return rev(load(p));
+    }
+    static inline void store_rev(Int32 *p, V a)
+    {
+        store(p, rev(a));
+    }
+    static inline V first(V a, V b)
+    {
+        return (V)_mm256_blend_epi32((__m256i)a, (__m256i)b, 0x01);
+    }
+    static inline Int32 or_lanes(V a)
+    {
+        return H::or_lanes((H::V)_mm_or_si128(_mm256_castsi256_si128((__m256i)a),
+                                              _mm256_extracti128_si256((__m256i)a, 1)));
+    }
+    static inline V set1(Int32 a)
+    {
+        return (V)_mm256_set1_epi32(a);
+    }
+    static inline V shl(V a, Int n)
+    {
+        return (V)_mm256_slli_epi32((__m256i)a, n);
+    }
+    static inline V sar(V a, Int n)
+    {
+        return (V)_mm256_srai_epi32((__m256i)a, n);
+    }
+    /* 64 bit products of the even and the odd lanes, bits n .. n + 31 of each */
+    static inline V mul(V a, V b, Int n)
+    {
+        __m256i even = _mm256_mul_epi32((__m256i)a, (__m256i)b);
+        __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64((__m256i)a, 32),
+                                        _mm256_srli_epi64((__m256i)b, 32));
+
+        return (V)_mm256_blend_epi32(_mm256_srli_epi64(even, n),
+                                     _mm256_slli_epi64(odd, 32 - n), 0xAA);
+    }
+    static inline V mullo(V a, V b)
+    {
+        return (V)_mm256_mullo_epi32((__m256i)a, (__m256i)b);
+    }
+    static inline V min(V a, V b)
+    {
+        return (V)_mm256_min_epi32((__m256i)a, (__m256i)b);
+    }
+    static inline V max(V a, V b)
+    {
+        return (V)_mm256_max_epi32((__m256i)a, (__m256i)b);
+    }
+    /* the shuffles work per 128 bit half, the permutes put the quadwords in order */
+    static inline void load_cplx(const Int32 *p, V &re, V &im)
+    {
+        __m256 x0 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)p));
+        __m256 x1 = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)(p + 8)));
+
+        re = (V)_mm256_permute4x64_epi64(_mm256_castps_si256(
+                                             _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0))), 0xD8);
+        im = (V)_mm256_permute4x64_epi64(_mm256_castps_si256(
+                                             _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1))), 0xD8);
+    }
+    static inline void store_cplx(Int32 *p, V re, V im)
+    {
+        __m256i lo = _mm256_unpacklo_epi32((__m256i)re, (__m256i)im);
+        __m256i hi = _mm256_unpackhi_epi32((__m256i)re, (__m256i)im);
+
+        _mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(p + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    static inline V load16(const Int16 *p)
+    {
+        return (V)_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)p));
+    }
+    static inline V load16_rev(const Int16 *p)
+    {
+        return rev(load16(p));
+    }
+    /* the shuffle works per 128 bit half, quadwords 0 and 2 hold the result */
+    static inline void store16(Int16 *p, V a)
+    {
+        const __m256i low = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13,
+                                             -1, -1, -1, -1, -1, -1, -1, -1,
+                                             0, 1, 4, 5, 8, 9, 12, 13,
+                                             -1, -1, -1, -1, -1, -1, -1, -1);
+        __m256i x = _mm256_shuffle_epi8((__m256i)a, low);
+
+        _mm_storeu_si128((__m128i *)p,
+                         _mm256_castsi256_si128(_mm256_permute4x64_epi64(x, 0x08)));
+    }
+    static inline void store16_rev(Int16 *p, V a)
+    {
+        store16(p, rev(a));
+    }
+    /* the low halves of the lanes are the even Int16 already */
+    static inline void store16_even(Int16 *p, V a)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+
+        _mm256_storeu_si256((__m256i *)p, _mm256_blend_epi16(x, (__m256i)a, 0x55));
+    }
+    static inline void store16_odd(Int16 *p, V a)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+
+        _mm256_storeu_si256((__m256i *)p,
+                            _mm256_blend_epi16(x, _mm256_slli_epi32((__m256i)a, 16), 0xAA));
+    }
+    /* 8x8 transposes, the columns past the last multiple of 8 one by one */
+    static inline void transpose(__m256i r[8])
+    {
+        __m256i t[8];
+        __m256i u[8];
+        Int i;
+
+        for (i = 0; i < 8; i += 2)
+        {
+            t[i    ] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        }
+        for (i = 0; i < 8; i += 4)
+        {
+            u[i    ] = _mm256_unpacklo_epi64(t[i    ], t[i + 2]);
+            u[i + 1] = _mm256_unpackhi_epi64(t[i    ], t[i + 2]);
+            u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+            u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+        }
+        for (i = 0; i < 4; i++)
+        {
+            r[i    ] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+            r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+        }
+    }
+    static inline void load_lanes(V v[], const Int32 *p, Int stride, Int count)
+    {
+        __m256i r[8];
+        Int k, l;
+
+        for (k = 0; k + 8 <= count; k += 8)
+        {
+            for (l = 0; l < 8; l++)
+            {
+                r[l] = _mm256_loadu_si256((const __m256i *)&p[l*stride + k]);
+            }
+            transpose(r);
+            for (l = 0; l < 8; l++)
+            {
+                v[k + l] = (V)r[l];
+            }
+        }
+        for (; k < count; k++)
+        {
+            v[k] = (V)_mm256_setr_epi32(p[k], p[stride + k], p[2*stride + k], p[3*stride + k],
+                                        p[4*stride + k], p[5*stride + k], p[6*stride + k],
+                                        p[7*stride + k]);
+        }
+    }
+    /* four vectors, as inv_long_complex_rot_lanes() stores them, go out as 4x8 */
+    static inline void store_lanes(Int32 *p, const V v[], Int stride, Int count)
+    {
+        Int32 t[8] __attribute__((aligned(32)));
+        __m256i r[8];
+        Int k, l;
+
+        if (count == 4)
+        {
+            __m256i t0 = _mm256_unpacklo_epi32((__m256i)v[0], (__m256i)v[1]);
+            __m256i t1 = _mm256_unpacklo_epi32((__m256i)v[2], (__m256i)v[3]);
+            __m256i t2 = _mm256_unpackhi_epi32((__m256i)v[0], (__m256i)v[1]);
+            __m256i t3 = _mm256_unpackhi_epi32((__m256i)v[2], (__m256i)v[3]);
+
+            r[0] = _mm256_unpacklo_epi64(t0, t1);
+            r[1] = _mm256_unpackhi_epi64(t0, t1);
+            r[2] = _mm256_unpacklo_epi64(t2, t3);
+            r[3] = _mm256_unpackhi_epi64(t2, t3);
+            for (l = 0; l < 4; l++)
+            {
+                _mm_storeu_si128((__m128i *)&p[l*stride], _mm256_castsi256_si128(r[l]));
+                _mm_storeu_si128((__m128i *)&p[(l + 4)*stride],
+                                 _mm256_extracti128_si256(r[l], 1));
+            }
+            return;
+        }
+
+        for (k = 0; k + 8 <= count; k += 8)
+        {
+            for (l = 0; l < 8; l++)
+            {
+                r[l] = (__m256i)v[k + l];
+            }
+            transpose(r);
+            for (l = 0; l < 8; l++)
+            {
+                _mm256_storeu_si256((__m256i *)&p[l*stride + k], r[l]);
+            }
+        }
+        for (; k < count; k++)
+        {
+            _mm256_store_si256((__m256i *)t, (__m256i)v[k]);
+            for (l = 0; l < 8; l++)
+            {
+                p[l*stride + k] = t[l];
+            }
+        }
+    }
+};
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+static Int32 twLong[FFT_TW_LONG_SIZE] __attribute__((aligned(32)));
+static Int32 twShort[FFT_TW_SHORT_SIZE] __attribute__((aligned(32)));
+#ifdef AAC_PLUS
+static Int32 synWindow[SBR_SYN_WIN_SIZE] __attribute__((aligned(32)));
+static Int32 anWindowLC[SBR_ANA_WIN_SIZE] __attribute__((aligned(32)));
+#ifdef HQ_SBR
+static Int32 anWindow[SBR_ANA_WIN_SIZE] __attribute__((aligned(32)));
+#endif
+#endif
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+static void init_tables(void)
+{
+    build_fft_twiddles(twLong, W_256rx4, FFT_RX4_LONG);
+    build_fft_twiddles(twShort, W_64rx4, FFT_RX4_SHORT);
+#ifdef AAC_PLUS
+    build_synthesis_window(synWindow);
+    build_analysis_window(anWindowLC, sbrDecoderFilterbankCoefficients_an_filt_LC);
+#ifdef HQ_SBR
+    build_analysis_window(anWindow, sbrDecoderFilterbankCoefficients_an_filt);
+#endif
+#endif
+}
+
+
+Int imdct_fxp_AVX2(Int32   data_quant[],
+                   Int32   freq_2_time_buffer[],
+                   const   Int     n,
+                   Int     Q_format,
+                   Int32   max)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return imdct_fxp_lanes<aacdec_ops_avx2>(data_quant, freq_2_time_buffer, n,
+            Q_format, max, twLong, twShort);
+}
+
+
+Int mix_radix_fft_AVX2(Int32 *Data, Int32 *peak_value)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return mix_radix_fft_lanes<aacdec_ops_avx2>(Data, peak_value, twLong);
+}
+
+
+Int fft_rx4_short_AVX2(Int32 Data[], Int32 *peak_value)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return fft_rx4_short_lanes<aacdec_ops_avx2>(Data, peak_value, twShort);
+}
+
+#ifdef AAC_PLUS
+
+void calc_sbr_anafilterbank_LC_AVX2(Int32 * Sr,
+                                    Int16 * X,
+                                    Int32 scratch_mem[][64],
+                                    Int32 maxBand)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    analysis_window_LC<aacdec_ops_avx2>(X, scratch_mem[0], anWindowLC);
+
+    analysis_sub_band_LC(scratch_mem[0],
+                         Sr,
+                         maxBand,
+                         (Int32(*)[64])scratch_mem[1]);
+}
+
+
+void calc_sbr_synfilterbank_LC_AVX2(Int32 * Sr,
+                                    Int16 * timeSig,
+                                    Int16   V[1280],
+                                    bool bDownSampleSBR)
+{
+    if (bDownSampleSBR)
+    {
+        calc_sbr_synfilterbank_LC(Sr, timeSig, V, bDownSampleSBR);
+        return;
+    }
+
+    pthread_once(&tablesOnce, init_tables);
+
+    synthesis_sub_band_LC(Sr, V);
+    synthesis_window<aacdec_ops_avx2>(V, timeSig, synWindow);
+}
+
+#ifdef HQ_SBR
+
+void calc_sbr_anafilterbank_AVX2(Int32 * Sr,
+                                 Int32 * Si,
+                                 Int16 * X,
+                                 Int32 scratch_mem[][64],
+                                 Int32 maxBand)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    analysis_window<aacdec_ops_avx2>(X, scratch_mem[0], anWindow);
+
+    analysis_sub_band(scratch_mem[0],
+                      Sr,
+                      Si,
+                      maxBand,
+                      (Int32(*)[64])scratch_mem[1]);
+}
+
+
+void calc_sbr_synfilterbank_AVX2(Int32 * Sr,
+                                 Int32 * Si,
+                                 Int16 * timeSig,
+                                 Int16   V[1280],
+                                 bool bDownSampleSBR)
+{
+    if (bDownSampleSBR)
+    {
+        calc_sbr_synfilterbank(Sr, Si, timeSig, V, bDownSampleSBR);
+        return;
+    }
+
+    pthread_once(&tablesOnce, init_tables);
+
+    synthesis_sub_band(Sr, Si, V);
+    synthesis_window<aacdec_ops_avx2>(V, timeSig, synWindow);
+}
+
+#endif      /* HQ_SBR */
+
+#endif      /* AAC_PLUS */
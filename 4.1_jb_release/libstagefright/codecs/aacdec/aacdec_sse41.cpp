@@ -0,0 +1,183 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: aacdec_sse41.cpp
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                   Date: MM/DD/YYYY
+ Description:
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+ SSE4.1 IMDCT, FFTs and SBR filterbank windows, four butterflies or samples
+ per vector. Built with -msse4.1 in libstagefright_aacdec_sse41;
+ aacdec_x86.cpp only calls it on CPUs that have SSE4.1.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+
+#include "aacdec_x86.h"
+#include "aacdec_sse41_ops.h"
+#include "aacdec_x86_lanes.h"
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+static Int32 twLong[FFT_TW_LONG_SIZE] __attribute__((aligned(16)));
+static Int32 twShort[FFT_TW_SHORT_SIZE] __attribute__((aligned(16)));
+#ifdef AAC_PLUS
+static Int32 synWindow[SBR_SYN_WIN_SIZE] __attribute__((aligned(16)));
+static Int32 anWindowLC[SBR_ANA_WIN_SIZE] __attribute__((aligned(16)));
+#ifdef HQ_SBR
+static Int32 anWindow[SBR_ANA_WIN_SIZE] __attribute__((aligned(16)));
+#endif
+#endif
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+static void init_tables(void)
+{
+    build_fft_twiddles(twLong, W_256rx4, FFT_RX4_LONG);
+    build_fft_twiddles(twShort, W_64rx4, FFT_RX4_SHORT);
+#ifdef AAC_PLUS
+    build_synthesis_window(synWindow);
+    build_analysis_window(anWindowLC, sbrDecoderFilterbankCoefficients_an_filt_LC);
+#ifdef HQ_SBR
+    build_analysis_window(anWindow, sbrDecoderFilterbankCoefficients_an_filt);
+#endif
+#endif
+}
+
+
+Int imdct_fxp_SSE41(Int32   data_quant[],
+                    Int32   freq_2_time_buffer[],
+                    const   Int     n,
+                    Int     Q_format,
+                    Int32   max)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return imdct_fxp_lanes<aacdec_ops_sse41>(data_quant, freq_2_time_buffer, n,
+            Q_format, max, twLong, twShort);
+}
+
+
+Int mix_radix_fft_SSE41(Int32 *Data, Int32 *peak_value)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return mix_radix_fft_lanes<aacdec_ops_sse41>(Data, peak_value, twLong);
+}
+
+
+Int fft_rx4_short_SSE41(Int32 Data[], Int32 *peak_value)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    return fft_rx4_short_lanes<aacdec_ops_sse41>(Data, peak_value, twShort);
+}
+
+#ifdef AAC_PLUS
+
+void calc_sbr_anafilterbank_LC_SSE41(Int32 * Sr,
+                                     Int16 * X,
+                                     Int32 scratch_mem[][64],
+                                     Int32 maxBand)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    analysis_window_LC<aacdec_ops_sse41>(X, scratch_mem[0], anWindowLC);
+
+    analysis_sub_band_LC(scratch_mem[0],
+                         Sr,
+                         maxBand,
+                         (Int32(*)[64])scratch_mem[1]);
+}
+
+
+void calc_sbr_synfilterbank_LC_SSE41(Int32 * Sr,
+                                     Int16 * timeSig,
+                                     Int16   V[1280],
+                                     bool bDownSampleSBR)
+{
+    if (bDownSampleSBR)
+    {
+        calc_sbr_synfilterbank_LC(Sr, timeSig, V, bDownSampleSBR);
+        return;
+    }
+
+    pthread_once(&tablesOnce, init_tables);
+
+    synthesis_sub_band_LC(Sr, V);
+    synthesis_window<aacdec_ops_sse41>(V, timeSig, synWindow);
+}
+
+#ifdef HQ_SBR
+
+void calc_sbr_anafilterbank_SSE41(Int32 * Sr,
+                                  Int32 * Si,
+                                  Int16 * X,
+                                  Int32 scratch_mem[][64],
+                                  Int32 maxBand)
+{
+    pthread_once(&tablesOnce, init_tables);
+
+    analysis_window<aacdec_ops_sse41>(X, scratch_mem[0], anWindow);
+
+    analysis_sub_band(scratch_mem[0],
+                      Sr,
+                      Si,
+                      maxBand,
+                      (Int32(*)[64])scratch_mem[1]);
+}
+
+
+void calc_sbr_synfilterbank_SSE41(Int32 * Sr,
+                                  Int32 * Si,
+                                  Int16 * timeSig,
+                                  Int16   V[1280],
+                                  bool bDownSampleSBR)
+{
+    if (bDownSampleSBR)
+    {
+        calc_sbr_synfilterbank(Sr, Si, timeSig, V, bDownSampleSBR);
+        return;
+    }
+
+    pthread_once(&tablesOnce, init_tables);
+
+    synthesis_sub_band(Sr, Si, V);
+    synthesis_window<aacdec_ops_sse41>(V, timeSig, synWindow);
+}
+
+#endif      /* HQ_SBR */
+
+#endif      /* AAC_PLUS */
@@ -0,0 +1,235 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Pathname: aacdec_sse41_ops.h
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                       Date:
+ Description:
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ The four lane SSE4.1 operations of aacdec_x86_lanes.h. aacdec_sse41.cpp
+ runs everything on them; aacdec_avx2.cpp uses them for the FFT stages
+ and samples that do not fill eight lanes. Only for files built with
+ -msse4.1 or -mavx2.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef AACDEC_SSE41_OPS_H
+#define AACDEC_SSE41_OPS_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+
+#include <smmintrin.h>
+
+#include "pv_audio_type_defs.h"
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+
+typedef Int32 v4si __attribute__((vector_size(16)));
+
+struct aacdec_ops_sse41
+{
+    typedef v4si V;
+    typedef aacdec_ops_sse41 H;
+    enum { N = 4 };
+
+    static inline V load(const Int32 *p)
+    {
+        return (V)_mm_loadu_si128((const __m128i *)p);
+    }
+    static inline void store(Int32 *p, V a)
+    {
+        _mm_storeu_si128((__m128i *)p, (__m128i)a);
+    }
+    static inline V rev(V a)
+    {
+        return (V)_mm_shuffle_epi32((__m128i)a, 0x1B);
+    }
+    static inline V load_rev(const Int32 *p)
+    {
+        return rev(load(p));
+    }
+    static inline void store_rev(Int32 *p, V a)
+    {
+        store(p, rev(a));
+    }
+    static inline V first(V a, V b)
+    {
+        return (V)_mm_blend_epi16((__m128i)a, (__m128i)b, 0x03);
+    }
+    static inline Int32 or_lanes(V a)
+    {
+        __m128i t = _mm_or_si128((__m128i)a, _mm_shuffle_epi32((__m128i)a, 0x4E));
+
+        t = _mm_or_si128(t, _mm_shuffle_epi32(t, 0xB1));
+
+        return _mm_cvtsi128_si32(t);
+    }
+    static inline V set1(Int32 a)
+    {
+        return (V)_mm_set1_epi32(a);
+    }
+    static inline V shl(V a, Int n)
+    {
+        return (V)_mm_slli_epi32((__m128i)a, n);
+    }
+    static inline V sar(V a, Int n)
+    {
+        return (V)_mm_srai_epi32((__m128i)a, n);
+    }
+    /* 64 bit products of the even and the odd lanes, bits n .. n + 31 of each */
+    static inline V mul(V a, V b, Int n)
+    {
+        __m128i even = _mm_mul_epi32((__m128i)a, (__m128i)b);
+        __m128i odd  = _mm_mul_epi32(_mm_srli_epi64((__m128i)a, 32),
+                                     _mm_srli_epi64((__m128i)b, 32));
+
+        return (V)_mm_blend_epi16(_mm_srli_epi64(even, n),
+                                  _mm_slli_epi64(odd, 32 - n), 0xCC);
+    }
+    static inline V mullo(V a, V b)
+    {
+        return (V)_mm_mullo_epi32((__m128i)a, (__m128i)b);
+    }
+    static inline V min(V a, V b)
+    {
+        return (V)_mm_min_epi32((__m128i)a, (__m128i)b);
+    }
+    static inline V max(V a, V b)
+    {
+        return (V)_mm_max_epi32((__m128i)a, (__m128i)b);
+    }
+    static inline void load_cplx(const Int32 *p, V &re, V &im)
+    {
+        __m128 x0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)p));
+        __m128 x1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p + 4)));
+
+        re = (V)_mm_castps_si128(_mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)));
+        im = (V)_mm_castps_si128(_mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    static inline void store_cplx(Int32 *p, V re, V im)
+    {
+        _mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi32((__m128i)re, (__m128i)im));
+        _mm_storeu_si128((__m128i *)(p + 4), _mm_unpackhi_epi32((__m128i)re, (__m128i)im));
+    }
+    static inline V load16(const Int16 *p)
+    {
+        return (V)_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)p));
+    }
+    static inline V load16_rev(const Int16 *p)
+    {
+        return rev(load16(p));
+    }
+    static inline void store16(Int16 *p, V a)
+    {
+        const __m128i low = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13,
+                                          -1, -1, -1, -1, -1, -1, -1, -1);
+
+        _mm_storel_epi64((__m128i *)p, _mm_shuffle_epi8((__m128i)a, low));
+    }
+    static inline void store16_rev(Int16 *p, V a)
+    {
+        store16(p, rev(a));
+    }
+    /* the low halves of the lanes are the even Int16 already */
+    static inline void store16_even(Int16 *p, V a)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+
+        _mm_storeu_si128((__m128i *)p, _mm_blend_epi16(x, (__m128i)a, 0x55));
+    }
+    static inline void store16_odd(Int16 *p, V a)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+
+        _mm_storeu_si128((__m128i *)p,
+                         _mm_blend_epi16(x, _mm_slli_epi32((__m128i)a, 16), 0xAA));
+    }
+    /* 4x4 transposes, the columns past the last multiple of 4 one by one */
+    static inline void transpose(__m128i &r0, __m128i &r1, __m128i &r2, __m128i &r3)
+    {
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+        r0 = _mm_unpacklo_epi64(t0, t1);
+        r1 = _mm_unpackhi_epi64(t0, t1);
+        r2 = _mm_unpacklo_epi64(t2, t3);
+        r3 = _mm_unpackhi_epi64(t2, t3);
+    }
+    static inline void load_lanes(V v[], const Int32 *p, Int stride, Int count)
+    {
+        Int k;
+
+        for (k = 0; k + 4 <= count; k += 4)
+        {
+            __m128i r0 = _mm_loadu_si128((const __m128i *)&p[k]);
+            __m128i r1 = _mm_loadu_si128((const __m128i *)&p[stride + k]);
+            __m128i r2 = _mm_loadu_si128((const __m128i *)&p[2*stride + k]);
+            __m128i r3 = _mm_loadu_si128((const __m128i *)&p[3*stride + k]);
+
+            transpose(r0, r1, r2, r3);
+            v[k    ] = (V)r0;
+            v[k + 1] = (V)r1;
+            v[k + 2] = (V)r2;
+            v[k + 3] = (V)r3;
+        }
+        for (; k < count; k++)
+        {
+            v[k] = (V)_mm_setr_epi32(p[k], p[stride + k], p[2*stride + k], p[3*stride + k]);
+        }
+    }
+    static inline void store_lanes(Int32 *p, const V v[], Int stride, Int count)
+    {
+        Int k;
+
+        for (k = 0; k + 4 <= count; k += 4)
+        {
+            __m128i r0 = (__m128i)v[k];
+            __m128i r1 = (__m128i)v[k + 1];
+            __m128i r2 = (__m128i)v[k + 2];
+            __m128i r3 = (__m128i)v[k + 3];
+
+            transpose(r0, r1, r2, r3);
+            _mm_storeu_si128((__m128i *)&p[k], r0);
+            _mm_storeu_si128((__m128i *)&p[stride + k], r1);
+            _mm_storeu_si128((__m128i *)&p[2*stride + k], r2);
+            _mm_storeu_si128((__m128i *)&p[3*stride + k], r3);
+        }
+        for (; k < count; k++)
+        {
+            p[k             ] = _mm_extract_epi32((__m128i)v[k], 0);
+            p[stride + k    ] = _mm_extract_epi32((__m128i)v[k], 1);
+            p[2*stride + k  ] = _mm_extract_epi32((__m128i)v[k], 2);
+            p[3*stride + k  ] = _mm_extract_epi32((__m128i)v[k], 3);
+        }
+    }
+};
+
+#endif  /* AACDEC_SSE41_OPS_H */
@@ -0,0 +1,131 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: aacdec_x86.cpp
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                   Date: MM/DD/YYYY
+ Description:
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+ CPU detection and selection of the x86 functions.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+
+#include "aacdec_x86.h"
+#include "imdct_fxp.h"
+#include "mix_radix_fft.h"
+#include "fft_rx4.h"
+#include "calc_sbr_anafilterbank.h"
+#include "calc_sbr_synfilterbank.h"
+#include "x86_cpu.h"
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+tAACDecX86Funcs aacdecX86Funcs =
+{
+    imdct_fxp,
+    mix_radix_fft,
+    fft_rx4_short,
+#ifdef AAC_PLUS
+    calc_sbr_anafilterbank_LC,
+    calc_sbr_synfilterbank_LC,
+#ifdef HQ_SBR
+    calc_sbr_anafilterbank,
+    calc_sbr_synfilterbank,
+#endif
+#endif
+};
+
+static pthread_once_t x86FuncsOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void aacdec_GetX86Functions(tAACDecX86Funcs *funcs)
+{
+    UInt32 features = x86_cpu_get_features();
+
+    funcs->imdct_fxp                 = imdct_fxp;
+    funcs->mix_radix_fft             = mix_radix_fft;
+    funcs->fft_rx4_short             = fft_rx4_short;
+#ifdef AAC_PLUS
+    funcs->calc_sbr_anafilterbank_LC = calc_sbr_anafilterbank_LC;
+    funcs->calc_sbr_synfilterbank_LC = calc_sbr_synfilterbank_LC;
+#ifdef HQ_SBR
+    funcs->calc_sbr_anafilterbank    = calc_sbr_anafilterbank;
+    funcs->calc_sbr_synfilterbank    = calc_sbr_synfilterbank;
+#endif
+#endif
+
+    if (features & X86_CPU_SSE4_1)
+    {
+        funcs->imdct_fxp                 = imdct_fxp_SSE41;
+        funcs->mix_radix_fft             = mix_radix_fft_SSE41;
+        funcs->fft_rx4_short             = fft_rx4_short_SSE41;
+#ifdef AAC_PLUS
+        funcs->calc_sbr_anafilterbank_LC = calc_sbr_anafilterbank_LC_SSE41;
+        funcs->calc_sbr_synfilterbank_LC = calc_sbr_synfilterbank_LC_SSE41;
+#ifdef HQ_SBR
+        funcs->calc_sbr_anafilterbank    = calc_sbr_anafilterbank_SSE41;
+        funcs->calc_sbr_synfilterbank    = calc_sbr_synfilterbank_SSE41;
+#endif
+#endif
+    }
+
+    if (features & X86_CPU_AVX2)
+    {
+        funcs->imdct_fxp                 = imdct_fxp_AVX2;
+        funcs->mix_radix_fft             = mix_radix_fft_AVX2;
+        funcs->fft_rx4_short             = fft_rx4_short_AVX2;
+#ifdef AAC_PLUS
+        funcs->calc_sbr_anafilterbank_LC = calc_sbr_anafilterbank_LC_AVX2;
+        funcs->calc_sbr_synfilterbank_LC = calc_sbr_synfilterbank_LC_AVX2;
+#ifdef HQ_SBR
+        funcs->calc_sbr_anafilterbank    = calc_sbr_anafilterbank_AVX2;
+        funcs->calc_sbr_synfilterbank    = calc_sbr_synfilterbank_AVX2;
+#endif
+#endif
+    }
+}
+
+
+static void set_x86_functions(void)
+{
+    aacdec_GetX86Functions(&aacdecX86Funcs);
+}
+
+
+void aacdec_InitX86Functions(void)
+{
+    pthread_once(&x86FuncsOnce, set_x86_functions);
+}
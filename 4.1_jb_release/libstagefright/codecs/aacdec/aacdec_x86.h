@@ -0,0 +1,184 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Pathname: aacdec_x86.h
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                       Date:
+ Description:
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ SSE4.1 and AVX2 versions of the IMDCT (pre-rotation, mixed radix FFT and
+ post-rotation), the short window FFT and the windowing of the SBR QMF
+ analysis and synthesis filterbanks, picked at run time. They give the same
+ output as the C code.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef AACDEC_X86_H
+#define AACDEC_X86_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+
+#include "pv_audio_type_defs.h"
+
+/*----------------------------------------------------------------------------
+; STRUCTURES TYPEDEF'S
+----------------------------------------------------------------------------*/
+#ifdef AACDEC_X86
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        Int(*imdct_fxp)(Int32   data_quant[],
+                        Int32   freq_2_time_buffer[],
+                        const   Int     n,
+                        Int     Q_format,
+                        Int32   max);
+
+        Int(*mix_radix_fft)(Int32 *Data,
+                            Int32 *peak_value);
+
+        Int(*fft_rx4_short)(Int32 Data[],
+                            Int32 *peak_value);
+
+#ifdef AAC_PLUS
+        void (*calc_sbr_anafilterbank_LC)(Int32 * Sr,
+                                          Int16 * X,
+                                          Int32 scratch_mem[][64],
+                                          Int32 maxBand);
+
+        void (*calc_sbr_synfilterbank_LC)(Int32 * Sr,
+                                          Int16 * timeSig,
+                                          Int16   V[1280],
+                                          bool bDownSampleSBR);
+
+#ifdef HQ_SBR
+        void (*calc_sbr_anafilterbank)(Int32 * Sr,
+                                       Int32 * Si,
+                                       Int16 * X,
+                                       Int32 scratch_mem[][64],
+                                       Int32 maxBand);
+
+        void (*calc_sbr_synfilterbank)(Int32 * Sr,
+                                       Int32 * Si,
+                                       Int16 * timeSig,
+                                       Int16   V[1280],
+                                       bool bDownSampleSBR);
+#endif
+#endif
+    } tAACDecX86Funcs;
+
+    /* the functions in use, the C versions until aacdec_InitX86Functions() */
+    extern tAACDecX86Funcs aacdecX86Funcs;
+
+    /*
+     * Fill funcs with the SSE4.1 or AVX2 functions the CPU supports, as
+     * reported by x86_cpu_get_features().
+     */
+    void aacdec_GetX86Functions(tAACDecX86Funcs *funcs);
+
+    /* sets aacdecX86Funcs on the first call, from PVMP4AudioDecoderInitLibrary() */
+    void aacdec_InitX86Functions(void);
+
+    /* aacdec_sse41.cpp, in libstagefright_aacdec_sse41 */
+    Int imdct_fxp_SSE41(Int32   data_quant[],
+                        Int32   freq_2_time_buffer[],
+                        const   Int     n,
+                        Int     Q_format,
+                        Int32   max);
+    Int mix_radix_fft_SSE41(Int32 *Data, Int32 *peak_value);
+    Int fft_rx4_short_SSE41(Int32 Data[], Int32 *peak_value);
+#ifdef AAC_PLUS
+    void calc_sbr_anafilterbank_LC_SSE41(Int32 * Sr,
+                                         Int16 * X,
+                                         Int32 scratch_mem[][64],
+                                         Int32 maxBand);
+    void calc_sbr_synfilterbank_LC_SSE41(Int32 * Sr,
+                                         Int16 * timeSig,
+                                         Int16   V[1280],
+                                         bool bDownSampleSBR);
+#ifdef HQ_SBR
+    void calc_sbr_anafilterbank_SSE41(Int32 * Sr,
+                                      Int32 * Si,
+                                      Int16 * X,
+                                      Int32 scratch_mem[][64],
+                                      Int32 maxBand);
+    void calc_sbr_synfilterbank_SSE41(Int32 * Sr,
+                                      Int32 * Si,
+                                      Int16 * timeSig,
+                                      Int16   V[1280],
+                                      bool bDownSampleSBR);
+#endif
+#endif
+
+    /* aacdec_avx2.cpp, in libstagefright_aacdec_avx2 */
+    Int imdct_fxp_AVX2(Int32   data_quant[],
+                       Int32   freq_2_time_buffer[],
+                       const   Int     n,
+                       Int     Q_format,
+                       Int32   max);
+    Int mix_radix_fft_AVX2(Int32 *Data, Int32 *peak_value);
+    Int fft_rx4_short_AVX2(Int32 Data[], Int32 *peak_value);
+#ifdef AAC_PLUS
+    void calc_sbr_anafilterbank_LC_AVX2(Int32 * Sr,
+                                        Int16 * X,
+                                        Int32 scratch_mem[][64],
+                                        Int32 maxBand);
+    void calc_sbr_synfilterbank_LC_AVX2(Int32 * Sr,
+                                        Int16 * timeSig,
+                                        Int16   V[1280],
+                                        bool bDownSampleSBR);
+#ifdef HQ_SBR
+    void calc_sbr_anafilterbank_AVX2(Int32 * Sr,
+                                     Int32 * Si,
+                                     Int16 * X,
+                                     Int32 scratch_mem[][64],
+                                     Int32 maxBand);
+    void calc_sbr_synfilterbank_AVX2(Int32 * Sr,
+                                     Int32 * Si,
+                                     Int16 * timeSig,
+                                     Int16   V[1280],
+                                     bool bDownSampleSBR);
+#endif
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#define X86_FUNC(name)  (*aacdecX86Funcs.name)
+
+#else
+
+#define X86_FUNC(name)  name
+
+#endif
+
+#endif  /* AACDEC_X86_H */
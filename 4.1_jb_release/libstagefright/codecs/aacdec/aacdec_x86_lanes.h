@@ -0,0 +1,1086 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Pathname: aacdec_x86_lanes.h
+
+------------------------------------------------------------------------------
+ REVISION HISTORY
+
+ Who:                                       Date:
+ Description:
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ The IMDCT, the radix 4 FFTs and the SBR filterbank windows written once
+ for aacdec_sse41.cpp and aacdec_avx2.cpp. Each lane of a vector runs the
+ exact operations of the C code on its own butterfly, rotation or output
+ sample, so the output is the same bit for bit.
+
+ The including file provides a class O with
+
+    V                     a vector of O::N Int32 lanes with + - & ^ | and unary -
+    H                     a class like O with at most 4 lanes, for the FFT
+                          stages with only 4 butterflies per group
+    load, store           N consecutive Int32
+    load_rev, store_rev   N consecutive Int32, last one in lane 0
+    rev                   the lanes in reverse order
+    first                 lane 0 of b, the other lanes of a
+    or_lanes              all lanes or'ed together
+    set1                  a constant in every lane
+    shl, sar              shift every lane
+    mul                   (Int32)(((int64_t)a * b) >> n) in every lane
+    mullo                 a * b, the low 32 bits
+    min, max              per lane
+    load_cplx             N interleaved pairs, the first of each in re
+    store_cplx            the reverse
+    load16, load16_rev    N consecutive Int16, sign extended
+    store16, store16_rev  the low 16 bits of every lane
+    store16_even          the low 16 bits of lane l to p[2*l], the odd
+                          Int16 in between are left as they are
+    store16_odd           the same to p[2*l + 1], nothing past the last
+                          lane is touched
+    load_lanes            v[k] lane l = p[l*stride + k], k < count
+    store_lanes           the reverse
+
+ aacdec_ops_c below is the same thing for one lane; it handles the
+ butterflies and samples left over when they do not fill a vector.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef AACDEC_X86_LANES_H
+#define AACDEC_X86_LANES_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+
+#include "pv_audio_type_defs.h"
+#include "fxp_mul32.h"
+#include "pv_normalize.h"
+#include "fft_rx4.h"
+#include "mix_radix_fft.h"
+#include "imdct_fxp.h"
+#include "inv_long_complex_rot.h"
+#include "inv_short_complex_rot.h"
+#include "aac_mem_funcs.h"
+#include "window_block_fxp.h"
+#include "qmf_filterbank_coeff.h"
+#include "analysis_sub_band.h"
+#include "synthesis_sub_band.h"
+#include "calc_sbr_anafilterbank.h"
+#include "calc_sbr_synfilterbank.h"
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+
+/* the shift of saturate2(), N in calc_sbr_synfilterbank.h */
+static const Int synfil_shift = N;
+
+/* N is the lane count of the operation classes from here on */
+#undef N
+
+/* as in imdct_fxp.cpp */
+#define ERROR_IN_FRAME_SIZE 10
+
+/* twiddles of one FFT stage, see build_fft_twiddles() */
+#define FFT_TW_W1_HI    0
+#define FFT_TW_W1_LO    1
+#define FFT_TW_W2_HI    2
+#define FFT_TW_W2_LO    3
+#define FFT_TW_W3_HI    4
+#define FFT_TW_W3_LO    5
+
+/* twiddle table sizes, 6 rows of n2 per stage */
+#define FFT_TW_LONG_SIZE    (6*(64 + 16 + 4))
+#define FFT_TW_SHORT_SIZE   (6*(16 + 4))
+
+/* SBR filterbank windows, one row of 32 output samples per tap */
+#define SBR_WIN_COLS        32
+#define SBR_SYN_WIN_SIZE    (10*SBR_WIN_COLS)
+#define SBR_ANA_WIN_SIZE    (5*SBR_WIN_COLS)
+
+extern "C"
+{
+    void digit_reversal_swapping(Int32 *y, Int32 *x);
+}
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+
+struct aacdec_ops_c
+{
+    typedef Int32 V;
+    typedef aacdec_ops_c H;
+    enum { N = 1 };
+
+    static inline V load(const Int32 *p)
+    {
+        return *p;
+    }
+    static inline void store(Int32 *p, V a)
+    {
+        *p = a;
+    }
+    static inline V load_rev(const Int32 *p)
+    {
+        return *p;
+    }
+    static inline void store_rev(Int32 *p, V a)
+    {
+        *p = a;
+    }
+    static inline V rev(V a)
+    {
+        return a;
+    }
+    static inline V first(V a, V b)
+    {
+        OSCL_UNUSED_ARG(a);
+
+        return b;
+    }
+    static inline Int32 or_lanes(V a)
+    {
+        return a;
+    }
+    static inline V set1(Int32 a)
+    {
+        return a;
+    }
+    static inline V shl(V a, Int n)
+    {
+        return a << n;
+    }
+    static inline V sar(V a, Int n)
+    {
+        return a >> n;
+    }
+    static inline V mul(V a, V b, Int n)
+    {
+        return (Int32)(((int64_t)(a) * b) >> n);
+    }
+    static inline V mullo(V a, V b)
+    {
+        return a * b;
+    }
+    static inline V min(V a, V b)
+    {
+        return a < b ? a : b;
+    }
+    static inline V max(V a, V b)
+    {
+        return a > b ? a : b;
+    }
+    static inline void load_cplx(const Int32 *p, V &re, V &im)
+    {
+        re = p[0];
+        im = p[1];
+    }
+    static inline void store_cplx(Int32 *p, V re, V im)
+    {
+        p[0] = re;
+        p[1] = im;
+    }
+    static inline V load16(const Int16 *p)
+    {
+        return *p;
+    }
+    static inline V load16_rev(const Int16 *p)
+    {
+        return *p;
+    }
+    static inline void store16(Int16 *p, V a)
+    {
+        *p = (Int16)a;
+    }
+    static inline void store16_rev(Int16 *p, V a)
+    {
+        *p = (Int16)a;
+    }
+    static inline void store16_even(Int16 *p, V a)
+    {
+        *p = (Int16)a;
+    }
+    static inline void store16_odd(Int16 *p, V a)
+    {
+        p[1] = (Int16)a;
+    }
+    static inline void load_lanes(V v[], const Int32 *p, Int stride, Int count)
+    {
+        OSCL_UNUSED_ARG(stride);
+
+        for (Int k = 0; k < count; k++)
+        {
+            v[k] = p[k];
+        }
+    }
+    static inline void store_lanes(Int32 *p, const V v[], Int stride, Int count)
+    {
+        OSCL_UNUSED_ARG(stride);
+
+        for (Int k = 0; k < count; k++)
+        {
+            p[k] = v[k];
+        }
+    }
+};
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+/* cmplx_mul32_by_16(x, y, exp_jw), w_hi and w_lo split from exp_jw */
+template <class O>
+static inline typename O::V cmplx_mul_lanes(typename O::V x, typename O::V y,
+        typename O::V w_hi, typename O::V w_lo)
+{
+    return O::mul(x, w_hi, 32) + O::mul(y, w_lo, 32);
+}
+
+/* the two factors cmplx_mul32_by_16() takes from exp_jw */
+template <class O>
+static inline void split_twiddle(typename O::V w, typename O::V &w_hi, typename O::V &w_lo)
+{
+    w_hi = w & O::set1((Int32)0xFFFF0000);
+    w_lo = O::shl(w, 16);
+}
+
+/* max |= (x >> 31) ^ x */
+template <class O>
+static inline typename O::V peak_lanes(typename O::V max, typename O::V x)
+{
+    return max | (O::sar(x, 31) ^ x);
+}
+
+/*
+ *  The twiddles of the stages of fft_rx4_long() or fft_rx4_short(), as
+ *  the stages read them from pw, split for cmplx_mul32_by_16() and laid out
+ *  per stage as 6 rows FFT_TW_... of n2 entries, j = 0 .. n2 - 1. Entry
+ *  j = 0 is not used.
+ */
+static void build_fft_twiddles(Int32 *table, const Int32 *pw, Int n)
+{
+    Int n2, j, r;
+
+    for (n2 = n >> 2; n2 >= 4; n2 >>= 2)
+    {
+        for (r = 0; r < 6; r++)
+        {
+            table[r*n2] = 0;
+        }
+        for (j = 1; j < n2; j++)
+        {
+            for (r = 0; r < 3; r++)
+            {
+                Int32 w = *pw++;
+
+                table[(2*r    )*n2 + j] = (Int32)((UInt32)w & 0xFFFF0000);
+                table[(2*r + 1)*n2 + j] = (Int32)((UInt32)w << 16);
+            }
+        }
+        table += 6 * n2;
+    }
+}
+
+/*
+ *  O::N butterflies j .. j + O::N - 1 of a radix 4 stage, on the group at
+ *  pData, as in fft_rx4_long() (short_fft false) or fft_rx4_short(). The
+ *  inputs are shifted down by shift, the sums and differences by exp.
+ *  Butterfly 0 of a group has no twiddle.
+ */
+template <class O>
+static inline void fft_rx4_butterfly_lanes(Int32 *pData, Int n1, Int j, const Int32 *tw,
+        Int n2, Int shift, Int exp, bool short_fft)
+{
+    typedef typename O::V V;
+    Int32 *pData1 = pData + 2 * j;
+    Int32 *pData2 = pData1 + n1;
+    Int32 *pData3 = pData1 + (n1 >> 1);
+    Int32 *pData4 = pData3 + n1;
+    V a_re, a_im, b_re, b_im, c_re, c_im, d_re, d_im;
+    V r1, r2, r3, r4, s1, s2, t1, t2;
+    V pb_re, pb_im, pc_re, pc_im, pd_re, pd_im;
+    V ob_re, ob_im, oc_re, oc_im, od_re, od_im;
+    V w_hi, w_lo;
+
+    O::load_cplx(pData1, a_re, a_im);
+    O::load_cplx(pData2, b_re, b_im);
+    O::load_cplx(pData3, c_re, c_im);
+    O::load_cplx(pData4, d_re, d_im);
+
+    if (shift)
+    {
+        a_re = O::sar(a_re, shift);
+        a_im = O::sar(a_im, shift);
+        b_re = O::sar(b_re, shift);
+        b_im = O::sar(b_im, shift);
+        c_re = O::sar(c_re, shift);
+        c_im = O::sar(c_im, shift);
+        d_re = O::sar(d_re, shift);
+        d_im = O::sar(d_im, shift);
+    }
+
+    r1 = a_re + b_re;
+    r2 = a_re - b_re;
+    r3 = c_re + d_re;
+    r4 = c_re - d_re;
+    s1 = a_im + b_im;
+    s2 = a_im - b_im;
+    t1 = c_im + d_im;
+    t2 = c_im - d_im;
+
+    O::store_cplx(pData1, O::sar(r1 + r3, exp), O::sar(s1 + t1, exp));
+
+    /* what the C code rotates, and stores as it is for butterfly 0 */
+    pb_re = O::sar(r1 - r3, exp);
+    pb_im = O::sar(s1 - t1, exp);
+    pc_re = O::sar(r2 + t2, exp);
+    pc_im = O::sar(s2 - r4, exp);
+    pd_re = O::sar(r2 - t2, exp);
+    pd_im = O::sar(s2 + r4, exp);
+
+    if (!short_fft)
+    {
+        pb_re = O::shl(pb_re, 1);
+        pb_im = O::shl(pb_im, 1);
+        pc_re = O::shl(pc_re, 1);
+        pc_im = O::shl(pc_im, 1);
+        pd_re = O::shl(pd_re, 1);
+        pd_im = O::shl(pd_im, 1);
+    }
+
+    w_hi = O::load(&tw[FFT_TW_W2_HI*n2 + j]);
+    w_lo = O::load(&tw[FFT_TW_W2_LO*n2 + j]);
+    ob_re = cmplx_mul_lanes<O>(pb_re, pb_im, w_hi, w_lo);
+    ob_im = cmplx_mul_lanes<O>(pb_im, -pb_re, w_hi, w_lo);
+
+    w_hi = O::load(&tw[FFT_TW_W1_HI*n2 + j]);
+    w_lo = O::load(&tw[FFT_TW_W1_LO*n2 + j]);
+    oc_re = cmplx_mul_lanes<O>(pc_re, pc_im, w_hi, w_lo);
+    oc_im = cmplx_mul_lanes<O>(pc_im, -pc_re, w_hi, w_lo);
+
+    w_hi = O::load(&tw[FFT_TW_W3_HI*n2 + j]);
+    w_lo = O::load(&tw[FFT_TW_W3_LO*n2 + j]);
+    od_re = cmplx_mul_lanes<O>(pd_re, pd_im, w_hi, w_lo);
+    od_im = cmplx_mul_lanes<O>(pd_im, -pd_re, w_hi, w_lo);
+
+    if (short_fft)
+    {
+        ob_re = O::shl(ob_re, 1);
+        ob_im = O::shl(ob_im, 1);
+        oc_re = O::shl(oc_re, 1);
+        oc_im = O::shl(oc_im, 1);
+        od_re = O::shl(od_re, 1);
+        od_im = O::shl(od_im, 1);
+    }
+
+    if (j == 0)
+    {
+        ob_re = O::first(ob_re, O::sar(r1 - r3, exp));
+        ob_im = O::first(ob_im, O::sar(s1 - t1, exp));
+        oc_re = O::first(oc_re, O::sar(r2 + t2, exp));
+        oc_im = O::first(oc_im, O::sar(s2 - r4, exp));
+        od_re = O::first(od_re, O::sar(r2 - t2, exp));
+        od_im = O::first(od_im, O::sar(s2 + r4, exp));
+    }
+
+    O::store_cplx(pData2, ob_re, ob_im);
+    O::store_cplx(pData3, oc_re, oc_im);
+    O::store_cplx(pData4, od_re, od_im);
+}
+
+/*
+ *  One radix 4 stage over all groups of n1 complex values. Stages with
+ *  fewer butterflies per group than O::N lanes go to O::H.
+ */
+template <class O>
+static void fft_rx4_stage_lanes(Int32 Data[], Int n, Int n1, const Int32 *tw,
+                                Int shift, Int exp, bool short_fft)
+{
+    Int n2 = n1 >> 2;
+    Int i, j;
+
+    if (n2 < O::N)
+    {
+        fft_rx4_stage_lanes<typename O::H>(Data, n, n1, tw, shift, exp, short_fft);
+        return;
+    }
+
+    for (i = 0; i < n; i += n1)
+    {
+        for (j = 0; j < n2; j += O::N)
+        {
+            fft_rx4_butterfly_lanes<O>(&Data[i << 1], n1, j, tw, n2, shift, exp, short_fft);
+        }
+    }
+}
+
+/*
+ *  The last radix 4 stage of fft_rx4_long() and fft_rx4_short(), O::N
+ *  groups of 4 complex values at a time, and the peak of the output.
+ */
+template <class O>
+static Int32 fft_rx4_last_stage_lanes(Int32 Data[], Int n)
+{
+    typedef typename O::V V;
+    V v[8];
+    V max = O::set1(0);
+    V r1, r2, t1, t2, s1, s2, s3, u1, u2;
+    Int g;
+
+    for (g = 0; g < (n >> 2); g += O::N)
+    {
+        O::load_lanes(v, &Data[g << 3], 8, 8);
+
+        r1 = v[0] + v[4];
+        r2 = v[0] - v[4];
+        t1 = v[2] + v[6];
+        t2 = v[2] - v[6];
+        s1 = v[1] + v[5];
+        s2 = v[1] - v[5];
+        s3 = s2 + t2;
+        s2 = s2 - t2;
+        u1 = v[3] + v[7];
+        u2 = v[3] - v[7];
+
+        v[0] = r1 + t1;
+        v[4] = r1 - t1;
+        v[1] = s1 + u1;
+        v[5] = s1 - u1;
+        v[3] = s2;
+        v[7] = s3;
+        v[6] = r2 - u2;
+        v[2] = r2 + u2;
+
+        for (Int k = 0; k < 8; k++)
+        {
+            max = peak_lanes<O>(max, v[k]);
+        }
+
+        O::store_lanes(&Data[g << 3], v, 8, 8);
+    }
+
+    return O::or_lanes(max);
+}
+
+/*
+ *  fft_rx4_long(), twiddles from build_fft_twiddles(.., W_256rx4, 256)
+ */
+template <class O>
+static void fft_rx4_long_lanes(Int32 Data[], Int32 *peak_value, const Int32 *tw)
+{
+    fft_rx4_stage_lanes<O>(Data, FFT_RX4_LONG, 256, tw, 0, 0, false);
+    fft_rx4_stage_lanes<O>(Data, FFT_RX4_LONG, 64, tw + 6*64, 0, 0, false);
+    fft_rx4_stage_lanes<O>(Data, FFT_RX4_LONG, 16, tw + 6*(64 + 16), 0, 0, false);
+
+    *peak_value = fft_rx4_last_stage_lanes<O>(Data, FFT_RX4_LONG);
+}
+
+/*
+ *  fft_rx4_short(), twiddles from build_fft_twiddles(.., W_64rx4, 64).
+ *  Peaks that would shift by a negative count go to the C code.
+ */
+template <class O>
+static Int fft_rx4_short_lanes(Int32 Data[], Int32 *peak_value, const Int32 *tw)
+{
+    Int32 max = *peak_value;
+    Int exp = 0;
+
+    if (max > 0x008000)
+    {
+        exp = 8 - pv_normalize(max);
+    }
+    if (exp < 2)
+    {
+        return fft_rx4_short(Data, peak_value);
+    }
+
+    fft_rx4_stage_lanes<O>(Data, FFT_RX4_SHORT, 64, tw, 2, exp - 2, true);
+    fft_rx4_stage_lanes<O>(Data, FFT_RX4_SHORT, 16, tw + 6*16, 0, 0, true);
+
+    *peak_value = fft_rx4_last_stage_lanes<O>(Data, FFT_RX4_SHORT);
+
+    return exp;
+}
+
+/*
+ *  The radix 2 butterflies m .. m + O::N - 1 of mix_radix_fft(), m > 0
+ */
+template <class O>
+static inline void radix_2_lanes(Int32 *Data, Int m, Int exp)
+{
+    typedef typename O::V V;
+    Int32 *pData_1 = &Data[2 * m];
+    Int32 *pData_2 = pData_1 + FFT_RX4_LENGTH_FOR_LONG;
+    Int32 *pData_3 = pData_1 + HALF_FFT_RX4_LENGTH_FOR_LONG;
+    Int32 *pData_4 = pData_3 + FFT_RX4_LENGTH_FOR_LONG;
+    V a_re, a_im, b_re, b_im, diff1, diff2, w_hi, w_lo;
+
+    split_twiddle<O>(O::load(&w_512rx2[m - 1]), w_hi, w_lo);
+
+    O::load_cplx(pData_3, a_re, a_im);
+    O::load_cplx(pData_4, b_re, b_im);
+    diff1 = O::sar(a_re - b_re, exp - 4);
+    diff2 = O::sar(a_im - b_im, exp - 4);
+    O::store_cplx(pData_3, O::sar(a_re + b_re, exp), O::sar(a_im + b_im, exp));
+    O::store_cplx(pData_4,
+                  O::sar(cmplx_mul_lanes<O>(diff2, -diff1, w_hi, w_lo), 3),
+                  O::sar(-cmplx_mul_lanes<O>(diff1, diff2, w_hi, w_lo), 3));
+
+    O::load_cplx(pData_1, a_re, a_im);
+    O::load_cplx(pData_2, b_re, b_im);
+    diff1 = O::sar(a_re - b_re, exp - 4);
+    diff2 = O::sar(a_im - b_im, exp - 4);
+    O::store_cplx(pData_1, O::sar(a_re + b_re, exp), O::sar(a_im + b_im, exp));
+    O::store_cplx(pData_2,
+                  O::sar(cmplx_mul_lanes<O>(diff1, diff2, w_hi, w_lo), 3),
+                  O::sar(cmplx_mul_lanes<O>(diff2, -diff1, w_hi, w_lo), 3));
+}
+
+/*
+ *  mix_radix_fft()
+ */
+template <class O>
+static Int mix_radix_fft_lanes(Int32 *Data, Int32 *peak_value, const Int32 *tw)
+{
+    Int32 *pData_1 = Data;
+    Int32 *pData_2 = Data + FFT_RX4_LENGTH_FOR_LONG;
+    Int32 *pData_3 = Data + HALF_FFT_RX4_LENGTH_FOR_LONG;
+    Int32 *pData_4 = pData_3 + FFT_RX4_LENGTH_FOR_LONG;
+    Int32 temp1, temp2, temp3, temp4, diff1;
+    Int32 max1, max2;
+    Int exp, m;
+
+    exp = 8 - pv_normalize(*peak_value);   /* use 24 bits for mix radix fft */
+    if (exp < 4)
+    {
+        exp = 4;
+    }
+
+    /* butterfly 0 has no twiddle, as in the C code */
+    temp1      = pData_3[0];
+    temp2      = pData_4[0];
+    diff1      = (temp1  - temp2) >> exp;
+    pData_3[0] = (temp1  + temp2) >> exp;
+    temp3      = pData_3[1];
+    temp4      = pData_4[1];
+    pData_4[1] = -diff1;
+    pData_3[1] = (temp3  + temp4) >> exp;
+    pData_4[0] = (temp3  - temp4) >> exp;
+
+    temp1      = pData_1[0];
+    temp2      = pData_2[0];
+    temp4      = pData_2[1];
+    pData_1[0] = (temp1  + temp2) >> exp;
+    temp3      = pData_1[1];
+    diff1      = (temp1  - temp2) >> exp ;
+    pData_1[1] = (temp3  + temp4) >> exp;
+    pData_2[1] = (temp3  - temp4) >> exp;
+    pData_2[0] =  diff1;
+
+    for (m = 1; m + O::N <= ONE_FOURTH_FFT_RX4_LENGTH_FOR_LONG; m += O::N)
+    {
+        radix_2_lanes<O>(Data, m, exp);
+    }
+    for (; m + O::H::N <= ONE_FOURTH_FFT_RX4_LENGTH_FOR_LONG; m += O::H::N)
+    {
+        radix_2_lanes<typename O::H>(Data, m, exp);
+    }
+    for (; m < ONE_FOURTH_FFT_RX4_LENGTH_FOR_LONG; m++)
+    {
+        radix_2_lanes<aacdec_ops_c>(Data, m, exp);
+    }
+
+    fft_rx4_long_lanes<O>(Data, &max1, tw);
+    fft_rx4_long_lanes<O>(&Data[FFT_RX4_LENGTH_FOR_LONG], &max2, tw);
+
+    digit_reversal_swapping(Data, &Data[FFT_RX4_LENGTH_FOR_LONG]);
+
+    *peak_value = max1 | max2;
+
+    return exp;
+}
+
+/*
+ *  inv_long_complex_rot(). The Int16 output overwrites the Int32 input, so
+ *  all of it is rotated first: Int32 c of s1/s2 holds the output Int16
+ *  c / 1023 - c and 1024 + c / 2047 - c, negated in the first quarter.
+ */
+template <class O>
+static Int inv_long_complex_rot_lanes(Int32 *Data, Int32 max)
+{
+    typedef typename O::V V;
+    Int32 s1[TWICE_INV_LONG_CX_ROT_LENGTH] __attribute__((aligned(32)));
+    Int32 s2[TWICE_INV_LONG_CX_ROT_LENGTH] __attribute__((aligned(32)));
+    Int16 *out = (Int16 *)Data;
+    Int exp;
+    Int t, k;
+
+    exp = 16 - pv_normalize(max) - 1;
+    if (exp < 0)
+    {
+        return inv_long_complex_rot(Data, max);
+    }
+
+    /*
+     *  Rotations t .. t + O::N - 1 of the four quarters, each in the order
+     *  the C code stores them: a = 128 + t, b = 383 - t, c = 384 + t and
+     *  d = 127 - t. Each pair holds imaginary, real.
+     */
+    for (t = 0; t < (INV_LONG_CX_ROT_LENGTH >> 1); t += O::N)
+    {
+        V a_im, a_re, b_im, b_re, c_im, c_re, d_im, d_re;
+        V wa, wb, wc, wd, w_hi, w_lo;
+        V v[4];
+
+        O::load_cplx(&Data[256 + 2*t], a_im, a_re);
+        O::load_cplx(&Data[768 - 2*t - 2*O::N], b_im, b_re);
+        O::load_cplx(&Data[768 + 2*t], c_im, c_re);
+        O::load_cplx(&Data[256 - 2*t - 2*O::N], d_im, d_re);
+        b_im = O::rev(b_im);
+        b_re = O::rev(b_re);
+        d_im = O::rev(d_im);
+        d_re = O::rev(d_re);
+
+        O::load_cplx(&exp_rotation_N_2048[256 + 2*t], wa, wc);
+        O::load_cplx(&exp_rotation_N_2048[256 - 2*t - 2*O::N], wd, wb);
+        wb = O::rev(wb);
+        wd = O::rev(wd);
+
+        split_twiddle<O>(wa, w_hi, w_lo);
+        v[0] = O::sar(cmplx_mul_lanes<O>(a_re, -a_im, w_hi, w_lo), exp);
+        a_im = O::sar(cmplx_mul_lanes<O>(a_im, a_re, w_hi, w_lo), exp);
+
+        split_twiddle<O>(wb, w_hi, w_lo);
+        v[1] = O::sar(cmplx_mul_lanes<O>(b_im, b_re, w_hi, w_lo), exp);
+        b_re = O::sar(cmplx_mul_lanes<O>(b_re, -b_im, w_hi, w_lo), exp);
+
+        split_twiddle<O>(wc, w_hi, w_lo);
+        v[2] = O::sar(cmplx_mul_lanes<O>(c_re, -c_im, w_hi, w_lo), exp);
+        c_im = O::sar(cmplx_mul_lanes<O>(c_im, c_re, w_hi, w_lo), exp);
+
+        split_twiddle<O>(wd, w_hi, w_lo);
+        v[3] = O::sar(cmplx_mul_lanes<O>(d_im, d_re, w_hi, w_lo), exp);
+        d_re = O::sar(cmplx_mul_lanes<O>(d_re, -d_im, w_hi, w_lo), exp);
+
+        O::store_lanes(&s1[4*t], v, 4, 4);
+
+        v[0] = a_im;
+        v[1] = b_re;
+        v[2] = c_im;
+        v[3] = d_re;
+        O::store_lanes(&s2[4*t], v, 4, 4);
+    }
+
+    for (k = 0; k < TWICE_INV_LONG_CX_ROT_LENGTH; k += O::N)
+    {
+        V x = O::load(&s1[k]);
+        V y = O::load(&s2[k]);
+
+        O::store16(&out[k], -x);
+        O::store16_rev(&out[1024 - k - O::N], x);
+        O::store16(&out[1024 + k], y);
+        O::store16_rev(&out[2048 - k - O::N], y);
+    }
+
+    return (exp + 1);
+}
+
+/*
+ *  The pre-rotation of imdct_fxp(): rotation c reads Int32 2c and the odd
+ *  n/2 - 1 - 2c and writes 2c, 2c + 1. Rotations c .. c + O::N - 1 and
+ *  n/4 - c - O::N .. n/4 - 1 - c read and write the same two blocks, so
+ *  they go together.
+ */
+template <class O>
+static Int32 imdct_pre_rotation_lanes(Int32 data_quant[], Int n, const Int32 *p_rotate,
+                                      Int shift1)
+{
+    typedef typename O::V V;
+    Int n_2 = n >> 1;
+    Int n_4 = n >> 2;
+    V max = O::set1(0);
+    Int c;
+
+    for (c = 0; c < (n_4 >> 1); c += O::N)
+    {
+        Int32 *p_data_1 = &data_quant[2 * c];
+        Int32 *p_data_2 = &data_quant[n_2 - 2 * c - 2 * O::N];
+        V f_re, f_im, b_re, b_im, x_even, x_odd, y_even, y_odd;
+        V w_hi, w_lo, temp1, temp2;
+
+        O::load_cplx(p_data_1, x_even, x_odd);
+        O::load_cplx(p_data_2, y_even, y_odd);
+
+        f_re = x_even;
+        f_im = O::rev(y_odd);
+        b_re = y_even;
+        b_im = O::rev(x_odd);
+
+        if (shift1 >= 0)
+        {
+            f_re = O::shl(f_re, shift1);
+            f_im = O::shl(f_im, shift1);
+            b_re = O::shl(b_re, shift1);
+            b_im = O::shl(b_im, shift1);
+        }
+        else
+        {
+            f_re = O::sar(f_re, 1);
+            f_im = O::sar(f_im, 1);
+            b_re = O::sar(b_re, 1);
+            b_im = O::sar(b_im, 1);
+        }
+
+        split_twiddle<O>(O::load(&p_rotate[c]), w_hi, w_lo);
+        temp1 =  cmplx_mul_lanes<O>(f_im, -f_re, w_hi, w_lo);
+        temp2 = -cmplx_mul_lanes<O>(f_re,  f_im, w_hi, w_lo);
+        O::store_cplx(p_data_1, temp1, temp2);
+        max = peak_lanes<O>(max, temp1);
+        max = peak_lanes<O>(max, temp2);
+
+        split_twiddle<O>(O::load(&p_rotate[n_4 - c - O::N]), w_hi, w_lo);
+        temp1 =  cmplx_mul_lanes<O>(b_im, -b_re, w_hi, w_lo);
+        temp2 = -cmplx_mul_lanes<O>(b_re,  b_im, w_hi, w_lo);
+        O::store_cplx(p_data_2, temp1, temp2);
+        max = peak_lanes<O>(max, temp1);
+        max = peak_lanes<O>(max, temp2);
+    }
+
+    return O::or_lanes(max);
+}
+
+/*
+ *  imdct_fxp()
+ */
+template <class O>
+static Int imdct_fxp_lanes(Int32   data_quant[],
+                           Int32   freq_2_time_buffer[],
+                           const   Int     n,
+                           Int     Q_format,
+                           Int32   max,
+                           const Int32 *twLong,
+                           const Int32 *twShort)
+{
+    const Int32 *p_rotate;
+    Int shift;
+    Int shift1;
+
+    if (max == 0)
+    {
+        return (ALL_ZEROS_BUFFER);
+    }
+
+    switch (n)
+    {
+        case SHORT_WINDOW_TYPE:
+            p_rotate = exp_rotation_N_256;
+            shift = 21;
+            break;
+
+        case LONG_WINDOW_TYPE:
+            p_rotate = exp_rotation_N_2048;
+            shift = 24;
+            break;
+
+        default:
+            return (ERROR_IN_FRAME_SIZE);
+    }
+
+    shift1 = pv_normalize(max) - 1;     /* -1 to leave room for addition */
+    Q_format -= (16 - shift1);
+
+    max = imdct_pre_rotation_lanes<O>(data_quant, n, p_rotate, shift1);
+
+    if (n != SHORT_WINDOW_TYPE)
+    {
+        shift -= mix_radix_fft_lanes<O>(data_quant, &max, twLong);
+        shift -= inv_long_complex_rot_lanes<O>(data_quant, max);
+    }
+    else
+    {
+        shift -= fft_rx4_short_lanes<O>(data_quant, &max, twShort);
+        shift -= inv_short_complex_rot(data_quant, freq_2_time_buffer, max);
+        pv_memcpy(data_quant, freq_2_time_buffer, SHORT_WINDOW*sizeof(*data_quant));
+    }
+
+    return (shift + Q_format);
+}
+
+#ifdef AAC_PLUS
+
+/*
+ *  sbrDecoderFilterbankCoefficients rearranged for synthesis_window_lanes():
+ *  row t holds tap t of output samples 1 .. 31, the even taps from the top
+ *  16 bits of the C table and the odd ones from the bottom 16 bits.
+ */
+static void build_synthesis_window(Int32 table[SBR_SYN_WIN_SIZE])
+{
+    Int t, i;
+
+    for (t = 0; t < 10; t++)
+    {
+        for (i = 0; i < SBR_WIN_COLS; i++)
+        {
+            Int32 c = (i < 31) ? sbrDecoderFilterbankCoefficients[5*i + (t >> 1)] : 0;
+
+            table[t*SBR_WIN_COLS + i] = (t & 1) ? ((c << 16) >> 16) : (c >> 16);
+        }
+    }
+}
+
+/*
+ *  An analysis filter table transposed for analysis_window_lanes(): row t
+ *  holds tap t of samples 1 .. 31.
+ */
+static void build_analysis_window(Int32 table[SBR_ANA_WIN_SIZE], const Int32 *coef)
+{
+    Int t, i;
+
+    for (t = 0; t < 5; t++)
+    {
+        for (i = 0; i < SBR_WIN_COLS; i++)
+        {
+            table[t*SBR_WIN_COLS + i] = (i < 31) ? coef[5*i + t] : 0;
+        }
+    }
+}
+
+/* the taps of output sample i + 1 are at V[i + 1 + offset], V[1279 - i - offset] */
+static const Int16 synthesis_offsets[10] =
+    { 0, 192, 256, 448, 512, 704, 768, 960, 1024, 1216 };
+
+/*
+ *  The loop of calc_sbr_synfilterbank_LC() and calc_sbr_synfilterbank():
+ *  output samples i + 1 and 63 - i, i = start .. 30, O::N at a time.
+ *  Returns where it stopped.
+ */
+template <class O>
+static Int synthesis_window_lanes(const Int16 V[1280], Int16 *timeSig,
+                                  const Int32 *table, Int start)
+{
+    typedef typename O::V Vec;
+    Int i, t;
+
+    for (i = start; i + O::N <= 31; i += O::N)
+    {
+        Vec realAccu1 = O::set1(ROUND_SYNFIL);
+        Vec realAccu2 = O::set1(ROUND_SYNFIL);
+
+        for (t = 0; t < 10; t++)
+        {
+            Vec c = O::load(&table[t*SBR_WIN_COLS + i]);
+            Int off = synthesis_offsets[t];
+
+            realAccu1 = realAccu1 + O::mullo(O::load16(&V[1 + i + off]), c);
+            realAccu2 = realAccu2 + O::mullo(O::load16_rev(&V[1280 - i - O::N - off]), c);
+        }
+
+        /* saturate2() */
+        realAccu1 = O::sar(realAccu1 - O::sar(realAccu1, 2), synfil_shift);
+        realAccu2 = O::sar(realAccu2 - O::sar(realAccu2, 2), synfil_shift);
+        realAccu1 = O::max(O::min(realAccu1, O::set1(INT16_MAX)), O::set1(INT16_MIN));
+        realAccu2 = O::max(O::min(realAccu2, O::set1(INT16_MAX)), O::set1(INT16_MIN));
+
+        O::store16_even(&timeSig[2 + 2*i], realAccu1);
+        O::store16_odd(&timeSig[127 - 2*i - 2*O::N], O::rev(realAccu2));
+    }
+
+    return i;
+}
+
+/*
+ *  Output samples 0 and 32 of the synthesis filterbank, as in the C code
+ */
+static void synthesis_first_samples(const Int16 V[1280], Int16 *timeSig)
+{
+    Int32 realAccu1;
+    Int32 realAccu2;
+    Int16 tmp1;
+    Int16 tmp2;
+
+    tmp1 = V[ 704];
+    tmp2 = V[ 768];
+    realAccu1 =  fxp_mac_16_by_16(tmp1, Qfmt(0.853738560F), ROUND_SYNFIL);
+    realAccu1 =  fxp_mac_16_by_16(tmp2, Qfmt(-0.361158990F), realAccu1);
+    tmp1 = -V[ 512];
+    tmp2 =  V[ 960];
+    realAccu1 =  fxp_mac_16_by_16(tmp1, Qfmt(-0.361158990F), realAccu1);
+    realAccu1 =  fxp_mac_16_by_16(tmp2, Qfmt(0.070353307F), realAccu1);
+    tmp1 =  V[ 448];
+    tmp2 =  V[1024];
+    realAccu1 =  fxp_mac_16_by_16(tmp1, Qfmt(0.070353307F), realAccu1);
+    realAccu1 =  fxp_mac_16_by_16(tmp2, Qfmt(-0.013271822F), realAccu1);
+    tmp1 =  -V[ 256];
+    tmp2 =   V[ 192];
+    realAccu1 =  fxp_mac_16_by_16(tmp1, Qfmt(-0.013271822F), realAccu1);
+    realAccu1 =  fxp_mac_16_by_16(tmp2, Qfmt(0.002620176F), realAccu1);
+    realAccu1 =  fxp_mac_16_by_16(V[1216], Qfmt(0.002620176F), realAccu1);
+
+    tmp1 = V[  32];
+    tmp2 = V[1248];
+    realAccu2 =  fxp_mac_16_by_16(tmp1, Qfmt(-0.000665042F), ROUND_SYNFIL);
+    realAccu2 =  fxp_mac_16_by_16(tmp2, Qfmt(-0.000665042F), realAccu2);
+    tmp1 = V[ 224];
+    tmp2 = V[1056];
+    realAccu2 =  fxp_mac_16_by_16(tmp1, Qfmt(0.005271576F), realAccu2);
+    realAccu2 =  fxp_mac_16_by_16(tmp2, Qfmt(0.005271576F), realAccu2);
+    tmp1 = V[ 992];
+    tmp2 = V[ 288];
+    realAccu2 =  fxp_mac_16_by_16(tmp1, Qfmt(0.058591568F), realAccu2);
+    realAccu2 =  fxp_mac_16_by_16(tmp2, Qfmt(0.058591568F), realAccu2);
+    tmp1 = V[ 480];
+    tmp2 = V[ 800];
+    realAccu2 =  fxp_mac_16_by_16(tmp1, Qfmt(-0.058370533F), realAccu2);
+    realAccu2 =  fxp_mac_16_by_16(tmp2, Qfmt(-0.058370533F), realAccu2);
+    tmp1 = V[ 736];
+    tmp2 = V[ 544];
+    realAccu2 =  fxp_mac_16_by_16(tmp1, Qfmt(0.702238872F), realAccu2);
+    realAccu2 =  fxp_mac_16_by_16(tmp2, Qfmt(0.702238872F), realAccu2);
+
+    /* saturate2() */
+    realAccu1 -= (realAccu1 >> 2);
+    realAccu1  = (realAccu1 >> synfil_shift);
+    if ((realAccu1 >> 15) != (realAccu1 >> 31))
+    {
+        realAccu1 = ((realAccu1 >> 31) ^ INT16_MAX);
+    }
+    timeSig[0] = (Int16)realAccu1;
+
+    realAccu2 -= (realAccu2 >> 2);
+    realAccu2  = (realAccu2 >> synfil_shift);
+    if ((realAccu2 >> 15) != (realAccu2 >> 31))
+    {
+        realAccu2 = ((realAccu2 >> 31) ^ INT16_MAX);
+    }
+    timeSig[64] = (Int16)realAccu2;
+}
+
+/*
+ *  The windowing of calc_sbr_synfilterbank_LC() and
+ *  calc_sbr_synfilterbank(), on V[] as synthesis_sub_band(_LC) left it
+ */
+template <class O>
+static void synthesis_window(const Int16 V[1280], Int16 *timeSig, const Int32 *table)
+{
+    Int i;
+
+    synthesis_first_samples(V, timeSig);
+
+    i = synthesis_window_lanes<O>(V, timeSig, table, 0);
+    i = synthesis_window_lanes<typename O::H>(V, timeSig, table, i);
+    synthesis_window_lanes<aacdec_ops_c>(V, timeSig, table, i);
+}
+
+/*
+ *  The loop of calc_sbr_anafilterbank_LC() and calc_sbr_anafilterbank():
+ *  Y[i + 1] and Y[63 - i], i = start .. 30, O::N at a time. Returns where
+ *  it stopped.
+ */
+template <class O>
+static Int analysis_window_lanes(const Int16 *X, Int32 *Y, const Int32 *table, Int start)
+{
+    typedef typename O::V V;
+    Int i, t;
+
+    for (i = start; i + O::N <= 31; i += O::N)
+    {
+        V realAccu1 = O::set1(0);
+        V realAccu2 = O::set1(0);
+
+        for (t = 0; t < 5; t++)
+        {
+            V c = O::load(&table[t*SBR_WIN_COLS + i]);
+            V tmp1 = O::load16_rev(&X[-i - O::N - 64*t]);
+            V tmp2 = O::load16(&X[-319 + i + 64*t]);
+
+            realAccu1 = realAccu1 + O::mul(c, O::shl(tmp1, 16), 32);
+            realAccu2 = realAccu2 + O::mul(c, O::shl(tmp2, 16), 32);
+        }
+
+        O::store(&Y[1 + i], realAccu1);
+        O::store_rev(&Y[64 - i - O::N], realAccu2);
+    }
+
+    return i;
+}
+
+/*
+ *  The windowing of calc_sbr_anafilterbank_LC(), which gives scratch_mem[0]
+ */
+template <class O>
+static void analysis_window_LC(const Int16 *X, Int32 *Y, const Int32 *table)
+{
+    const Int16 *pt_X_1 = X;
+    Int32 realAccu1;
+    Int32 realAccu2;
+    Int i;
+
+    realAccu1  =  fxp_mul32_by_16(Qfmt27(-0.51075594183097F),   pt_X_1[-192]);
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.51075594183097F), -pt_X_1[-128], realAccu1);
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F),  pt_X_1[-256], realAccu1);
+    Y[0]       =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F), -pt_X_1[ -64], realAccu1);
+
+    i = analysis_window_lanes<O>(X, Y, table, 0);
+    i = analysis_window_lanes<typename O::H>(X, Y, table, i);
+    analysis_window_lanes<aacdec_ops_c>(X, Y, table, i);
+
+    realAccu2  = fxp_mul32_by_16(Qfmt27(0.00370548843500F), X[ -32]);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.00370548843500F), pt_X_1[-288], realAccu2);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.09949460091720F), pt_X_1[ -96], realAccu2);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.09949460091720F), pt_X_1[-224], realAccu2);
+    Y[32]      = fxp_mac32_by_16(Qfmt27(1.20736865027288F), pt_X_1[-160], realAccu2);
+}
+
+#ifdef HQ_SBR
+
+/*
+ *  The windowing of calc_sbr_anafilterbank(), which gives scratch_mem[0]
+ */
+template <class O>
+static void analysis_window(const Int16 *X, Int32 *Y, const Int32 *table)
+{
+    Int32 realAccu1;
+    Int32 realAccu2;
+    Int i;
+
+    realAccu1  =  fxp_mul32_by_16(Qfmt27(-0.36115899F),   X[-192]);
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.36115899F),  -X[-128], realAccu1);
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.013271822F),  X[-256], realAccu1);
+    Y[0]       =  fxp_mac32_by_16(Qfmt27(-0.013271822F), -X[ -64], realAccu1);
+
+    i = analysis_window_lanes<O>(X, Y, table, 0);
+    i = analysis_window_lanes<typename O::H>(X, Y, table, i);
+    analysis_window_lanes<aacdec_ops_c>(X, Y, table, i);
+
+    realAccu2  = fxp_mul32_by_16(Qfmt27(0.002620176F), X[ -32]);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.002620176F), X[-288], realAccu2);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.070353307F), X[ -96], realAccu2);
+    realAccu2  = fxp_mac32_by_16(Qfmt27(0.070353307F), X[-224], realAccu2);
+    Y[32]      = fxp_mac32_by_16(Qfmt27(0.85373856F), (X[-160]), realAccu2);
+}
+
+#endif      /* HQ_SBR */
+
+#endif      /* AAC_PLUS */
+
+#endif  /* AACDEC_X86_LANES_H */
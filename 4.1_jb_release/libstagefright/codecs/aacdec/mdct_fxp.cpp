@@ -211,6 +211,7 @@
 #include "mdct_fxp.h"
 #include "fft_rx4.h"
 #include "mix_radix_fft.h"
+#include "aacdec_x86.h"
 #include "fwd_long_complex_rot.h"
 #include "fwd_short_complex_rot.h"
 
@@ -410,7 +411,7 @@ Int mdct_fxp(
         if (n != SHORT_WINDOW_TYPE)
         {
 
-            shift = mix_radix_fft(
+            shift = X86_FUNC(mix_radix_fft)(
                         Q_FFTarray,
                         &max1);
 
@@ -423,7 +424,7 @@ Int mdct_fxp(
         else        /*  n_4 is 64 */
         {
 
-            shift = fft_rx4_short(
+            shift = X86_FUNC(fft_rx4_short)(
                         Q_FFTarray,
                         &max1);
 
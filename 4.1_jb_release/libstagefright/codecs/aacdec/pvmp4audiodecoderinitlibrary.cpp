@@ -203,6 +203,7 @@
 #include "pvmp4audiodecoder_api.h" /* Where this function is declared       */
 #include "s_tdec_int_chan.h"
 #include "sfb.h"                   /* samp_rate_info[] is declared here     */
+#include "aacdec_x86.h"            /* aacdec_InitX86Functions()             */
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -246,6 +247,10 @@ OSCL_EXPORT_REF Int PVMP4AudioDecoderInitLibrary(
 
     pVars = (tDec_Int_File *)pMem;
 
+#ifdef AACDEC_X86
+    aacdec_InitX86Functions();
+#endif
+
     /*
      * Initialize all memory. The pointers to channel memory will be
      * set to zero also.
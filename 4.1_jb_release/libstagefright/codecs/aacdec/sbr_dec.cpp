@@ -88,6 +88,7 @@ Copyright (c) ISO/IEC 2002.
 #include    "s_sbr_frame_data.h"
 #include    "calc_sbr_synfilterbank.h"
 #include    "calc_sbr_anafilterbank.h"
+#include    "aacdec_x86.h"
 #include    "calc_sbr_envelope.h"
 #include    "sbr_generate_high_freq.h"
 #include    "sbr_dec.h"
@@ -224,21 +225,21 @@ void sbr_dec(Int16 *inPcmData,
         if (sbrDec->LC_aacP_DecoderFlag == ON)
         {
 
-            calc_sbr_anafilterbank_LC(hFrameData->codecQmfBufferReal[sbrDec->bufWriteOffs + i],
-                                      &inPcmData[319] + (i << 5),
-                                      scratch_mem,
-                                      num_qmf_bands);
+            X86_FUNC(calc_sbr_anafilterbank_LC)(hFrameData->codecQmfBufferReal[sbrDec->bufWriteOffs + i],
+                                                &inPcmData[319] + (i << 5),
+                                                scratch_mem,
+                                                num_qmf_bands);
 
         }
 #ifdef HQ_SBR
         else
         {
 
-            calc_sbr_anafilterbank(hFrameData->codecQmfBufferReal[sbrDec->bufWriteOffs + i],
-                                   hFrameData->codecQmfBufferImag[sbrDec->bufWriteOffs + i],
-                                   &inPcmData[319] + (i << 5),
-                                   scratch_mem,
-                                   num_qmf_bands);
+            X86_FUNC(calc_sbr_anafilterbank)(hFrameData->codecQmfBufferReal[sbrDec->bufWriteOffs + i],
+                                             hFrameData->codecQmfBufferImag[sbrDec->bufWriteOffs + i],
+                                             &inPcmData[319] + (i << 5),
+                                             scratch_mem,
+                                             num_qmf_bands);
         }
 #endif
 
@@ -609,19 +610,19 @@ void sbr_dec(Int16 *inPcmData,
 
             if (pVars->mc_info.bDownSampledSbr)
             {
-                calc_sbr_synfilterbank(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
-                                       hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
-                                       ftimeOutPtr + (i << 6),
-                                       &circular_buffer_s[1984 - (i<<6)],
-                                       pVars->mc_info.bDownSampledSbr);
+                X86_FUNC(calc_sbr_synfilterbank)(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
+                                                 hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
+                                                 ftimeOutPtr + (i << 6),
+                                                 &circular_buffer_s[1984 - (i<<6)],
+                                                 pVars->mc_info.bDownSampledSbr);
             }
             else
             {
-                calc_sbr_synfilterbank(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
-                                       hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
-                                       ftimeOutPtr + (i << 7),
-                                       &circular_buffer_s[3968 - (i<<7)],
-                                       pVars->mc_info.bDownSampledSbr);
+                X86_FUNC(calc_sbr_synfilterbank)(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
+                                                 hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
+                                                 ftimeOutPtr + (i << 7),
+                                                 &circular_buffer_s[3968 - (i<<7)],
+                                                 pVars->mc_info.bDownSampledSbr);
 
             }
 
@@ -680,19 +681,19 @@ void sbr_dec(Int16 *inPcmData,
             if (pVars->mc_info.bDownSampledSbr)
             {
 
-                calc_sbr_synfilterbank(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
-                                       hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
-                                       ftimeOutPtrPS + (i << 6),
-                                       &circular_buffer_s[1984 - (i<<6)],
-                                       pVars->mc_info.bDownSampledSbr);
+                X86_FUNC(calc_sbr_synfilterbank)(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
+                                                 hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
+                                                 ftimeOutPtrPS + (i << 6),
+                                                 &circular_buffer_s[1984 - (i<<6)],
+                                                 pVars->mc_info.bDownSampledSbr);
             }
             else
             {
-                calc_sbr_synfilterbank(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
-                                       hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
-                                       ftimeOutPtrPS + (i << 7),
-                                       &circular_buffer_s[3968 - (i<<7)],
-                                       pVars->mc_info.bDownSampledSbr);
+                X86_FUNC(calc_sbr_synfilterbank)(hParametricStereoDec->qmfBufferReal[i],  /* realSamples  */
+                                                 hParametricStereoDec->qmfBufferImag[i], /* imagSamples  */
+                                                 ftimeOutPtrPS + (i << 7),
+                                                 &circular_buffer_s[3968 - (i<<7)],
+                                                 pVars->mc_info.bDownSampledSbr);
             }
 
         }
@@ -808,17 +809,17 @@ void sbr_dec(Int16 *inPcmData,
 
                 if (pVars->mc_info.bDownSampledSbr)
                 {
-                    calc_sbr_synfilterbank_LC(Sr,               /* realSamples  */
-                                              ftimeOutPtr + (i << 6),
-                                              &circular_buffer_s[1984 - (i<<6)],
-                                              pVars->mc_info.bDownSampledSbr);
+                    X86_FUNC(calc_sbr_synfilterbank_LC)(Sr,               /* realSamples  */
+                                                        ftimeOutPtr + (i << 6),
+                                                        &circular_buffer_s[1984 - (i<<6)],
+                                                        pVars->mc_info.bDownSampledSbr);
                 }
                 else
                 {
-                    calc_sbr_synfilterbank_LC(Sr,               /* realSamples  */
-                                              ftimeOutPtr + (i << 7),
-                                              &circular_buffer_s[3968 - (i<<7)],
-                                              pVars->mc_info.bDownSampledSbr);
+                    X86_FUNC(calc_sbr_synfilterbank_LC)(Sr,               /* realSamples  */
+                                                        ftimeOutPtr + (i << 7),
+                                                        &circular_buffer_s[3968 - (i<<7)],
+                                                        pVars->mc_info.bDownSampledSbr);
                 }
             }
 #ifdef HQ_SBR
@@ -872,19 +873,19 @@ void sbr_dec(Int16 *inPcmData,
 
                 if (pVars->mc_info.bDownSampledSbr)
                 {
-                    calc_sbr_synfilterbank(Sr,              /* realSamples  */
-                                           Si,             /* imagSamples  */
-                                           ftimeOutPtr + (i << 6),
-                                           &circular_buffer_s[1984 - (i<<6)],
-                                           pVars->mc_info.bDownSampledSbr);
+                    X86_FUNC(calc_sbr_synfilterbank)(Sr,              /* realSamples  */
+                                                     Si,             /* imagSamples  */
+                                                     ftimeOutPtr + (i << 6),
+                                                     &circular_buffer_s[1984 - (i<<6)],
+                                                     pVars->mc_info.bDownSampledSbr);
                 }
                 else
                 {
-                    calc_sbr_synfilterbank(Sr,              /* realSamples  */
-                                           Si,             /* imagSamples  */
-                                           ftimeOutPtr + (i << 7),
-                                           &circular_buffer_s[3968 - (i<<7)],
-                                           pVars->mc_info.bDownSampledSbr);
+                    X86_FUNC(calc_sbr_synfilterbank)(Sr,              /* realSamples  */
+                                                     Si,             /* imagSamples  */
+                                                     ftimeOutPtr + (i << 7),
+                                                     &circular_buffer_s[3968 - (i<<7)],
+                                                     pVars->mc_info.bDownSampledSbr);
                 }
             }
 #endif
@@ -0,0 +1,905 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the x86 IMDCT, FFTs and SBR filterbanks against the C versions
+ * on random input, then decodes AAC-LC, HE-AAC and HE-AACv2 streams with
+ * each function set through PVMP4AudioDecodeFrame() alone, and prints how
+ * many times faster than realtime it runs. The PCM has to be
+ * identical for all sets.
+ *
+ * Only the library is timed. SoftAAC is given the AudioSpecificConfig and
+ * then one raw frame per input buffer by MPEG4Extractor, reconfigures its
+ * output port once the first frame shows SBR, and copies its output
+ * through OMX buffers on the component's looper thread;
+ * "codec_component_bench -d file.m4a" times it that way, through
+ * MediaCodec.
+ *
+ * Usage: aacdec_bench [-s seconds] [-m lc|he|hev2] [-i input.aac] [-n runs]
+ *
+ * The generated streams are raw frames behind an AudioSpecificConfig, as
+ * an MP4 file hands them to SoftAAC:
+ *   lc    48 kHz stereo, two independent channels
+ *   he    24 kHz stereo core with SBR, 48 kHz out
+ *   hev2  24 kHz mono core with SBR and parametric stereo, 48 kHz stereo out
+ * The core codes every band as perceptual noise with a random spectral
+ * envelope and long, start, short and stop windows; the SBR envelopes and
+ * the PS parameters change every frame. The audio is noise, but every
+ * frame runs the whole synthesis path. An ADTS file given with -i is
+ * decoded as it is.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "pvmp4audiodecoder_api.h"
+#include "imdct_fxp.h"
+#include "mix_radix_fft.h"
+#include "fft_rx4.h"
+#include "calc_sbr_anafilterbank.h"
+#include "calc_sbr_synfilterbank.h"
+#include "aacdec_x86.h"
+
+#define OUTPUT_SAMPLES      (4096)      /* SoftAAC, 2048 stereo samples */
+#define MAX_FRAME_BYTES     768
+
+/* element ids and window sequences of the raw data block */
+#define ID_SCE              0
+#define ID_CPE              1
+#define ID_FIL              6
+#define ID_END              7
+
+#define ONLY_LONG           0
+#define LONG_START          1
+#define EIGHT_SHORT         2
+#define LONG_STOP           3
+
+#define NOISE_HCB           13
+#define MAX_SFB_LONG        40
+#define MAX_SFB_SHORT       12
+
+/* SBR header below: start_freq 5, stop_freq 9, default scales */
+#define SBR_START_FREQ      5
+#define SBR_STOP_FREQ       9
+#define SBR_ENV_BANDS       16          /* high resolution envelope bands */
+#define SBR_NOISE_BANDS     4
+#define SBR_EXTENSION       13
+#define PS_EXTENSION_ID     2
+#define PS_BINS             10
+
+typedef enum
+{
+    MODE_LC,
+    MODE_HE,
+    MODE_HEV2,
+    MODE_FILE
+} StreamMode;
+
+static const char *modeNames[] = { "lc", "he", "hev2", "file" };
+
+typedef struct
+{
+    uint8_t *data;
+    int *offsets;           /* numFrames + 1 entries, none for ADTS */
+    int numFrames;
+    int size;
+    uint8_t config[2];      /* AudioSpecificConfig */
+} Stream;
+
+typedef struct
+{
+    const char *name;
+    const char *cpu;    /* STAGEFRIGHT_X86_CPU, NULL for no limit */
+#ifdef AACDEC_X86
+    tAACDecX86Funcs funcs;
+#endif
+} FunctionSet;
+
+static FunctionSet sets[3];
+static int numSets;
+
+static unsigned int seed = 12345;
+
+static unsigned int Rand(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) | (seed << 16);
+}
+
+static double Now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void InitSets(void)
+{
+    static const char *names[3] = { "c", "sse41", "avx2" };
+    int i, j;
+
+    numSets = 0;
+    for (i = 0; i < 3; i++)
+    {
+        FunctionSet *set = &sets[numSets];
+
+        set->name = names[i];
+        set->cpu = i < 2 ? names[i] : NULL;
+#ifdef AACDEC_X86
+        if (set->cpu)
+            setenv("STAGEFRIGHT_X86_CPU", set->cpu, 1);
+        else
+            unsetenv("STAGEFRIGHT_X86_CPU");
+        aacdec_GetX86Functions(&set->funcs);
+
+        /* skip the sets the CPU does not have */
+        for (j = 0; j < numSets; j++)
+        {
+            if (!memcmp(&sets[j].funcs, &set->funcs, sizeof(set->funcs)))
+                break;
+        }
+        if (j < numSets)
+            continue;
+#else
+        if (i > 0)
+            break;
+        (void)j;
+#endif
+        numSets++;
+    }
+    unsetenv("STAGEFRIGHT_X86_CPU");
+}
+
+#ifdef AACDEC_X86
+
+/* random value of up to bits bits */
+static Int32 RandValue(int bits)
+{
+    return (Int32)Rand() >> (32 - bits);
+}
+
+static void RandVector(Int32 *x, int n, int bits)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        x[i] = RandValue(bits);
+}
+
+static Int32 AbsMax(const Int32 *x, int n)
+{
+    Int32 max = 0;
+    int i;
+
+    /* q_normalize() */
+    for (i = 0; i < n; i++)
+        max |= (x[i] >> 31) ^ x[i];
+
+    return max;
+}
+
+static int Compare(const char *what, const char *name, const void *a, const void *b,
+                   int size, int iter)
+{
+    if (!memcmp(a, b, size))
+        return 0;
+
+    printf("%s: %s differs from c at iteration %d\n", name, what, iter);
+    return 1;
+}
+
+/* checks the functions of set against the C versions */
+static int CheckSet(const FunctionSet *set, int iterations)
+{
+    static Int32 dataC[LONG_WINDOW_TYPE], dataX[LONG_WINDOW_TYPE];
+    static Int32 bufC[LONG_WINDOW_TYPE], bufX[LONG_WINDOW_TYPE];
+    static Int32 scratchC[16][64], scratchX[16][64];
+    static Int16 vC[1280], vX[1280];
+    static Int16 x[352];
+    Int32 srC[64], srX[64], siC[64], siX[64];
+    Int16 timeC[128], timeX[128];
+    int iter, failed = 0;
+
+    for (iter = 0; iter < iterations && !failed; iter++)
+    {
+        Int32 peakC = 0, peakX = 0;
+        Int retC, retX;
+        int bits = 12 + Rand() % 13;
+
+        /* imdct, long and short windows, the input as q_normalize() leaves it */
+        {
+            Int n = (Rand() & 1) ? LONG_WINDOW_TYPE : SHORT_WINDOW_TYPE;
+            Int qFormat = Rand() % 20;
+            Int32 max;
+
+            memset(dataC, 0, sizeof(dataC));
+            RandVector(dataC, n >> 1, 1 + Rand() % 28);
+            if (Rand() % 16 == 0)
+                memset(dataC, 0, sizeof(dataC));
+            memcpy(dataX, dataC, sizeof(dataC));
+            max = AbsMax(dataC, n >> 1);
+
+            retC = imdct_fxp(dataC, bufC, n, qFormat, max);
+            retX = set->funcs.imdct_fxp(dataX, bufX, n, qFormat, max);
+            failed |= Compare("imdct_fxp", set->name, dataC, dataX,
+                              (n == LONG_WINDOW_TYPE ? n : n >> 1) * sizeof(Int32), iter);
+            failed |= Compare("imdct_fxp exp", set->name, &retC, &retX, sizeof(retC), iter);
+        }
+
+        /* the FFTs of mdct_fxp() */
+        RandVector(dataC, 1024, bits);
+        memcpy(dataX, dataC, sizeof(dataC));
+        retC = mix_radix_fft(dataC, &peakC);
+        retX = set->funcs.mix_radix_fft(dataX, &peakX);
+        failed |= Compare("mix_radix_fft", set->name, dataC, dataX, 1024 * sizeof(Int32), iter);
+        failed |= Compare("mix_radix_fft peak", set->name, &peakC, &peakX, sizeof(peakC), iter);
+        failed |= Compare("mix_radix_fft exp", set->name, &retC, &retX, sizeof(retC), iter);
+
+        RandVector(dataC, 128, bits);
+        memcpy(dataX, dataC, sizeof(dataC));
+        retC = fft_rx4_short(dataC, &peakC);
+        retX = set->funcs.fft_rx4_short(dataX, &peakX);
+        failed |= Compare("fft_rx4_short", set->name, dataC, dataX, 128 * sizeof(Int32), iter);
+        failed |= Compare("fft_rx4_short peak", set->name, &peakC, &peakX, sizeof(peakC), iter);
+        failed |= Compare("fft_rx4_short exp", set->name, &retC, &retX, sizeof(retC), iter);
+
+#ifdef AAC_PLUS
+        /* SBR analysis, on 320 input samples */
+        {
+            Int32 maxBand = 1 + Rand() % 32;
+            int i;
+
+            for (i = 0; i < 352; i++)
+                x[i] = (Int16)Rand();
+
+            memset(srC, 0, sizeof(srC));
+            memset(srX, 0, sizeof(srX));
+            calc_sbr_anafilterbank_LC(srC, &x[319], scratchC, maxBand);
+            set->funcs.calc_sbr_anafilterbank_LC(srX, &x[319], scratchX, maxBand);
+            failed |= Compare("calc_sbr_anafilterbank_LC", set->name, srC, srX,
+                              sizeof(srC), iter);
+#ifdef HQ_SBR
+            memset(siC, 0, sizeof(siC));
+            memset(siX, 0, sizeof(siX));
+            calc_sbr_anafilterbank(srC, siC, &x[319], scratchC, maxBand);
+            set->funcs.calc_sbr_anafilterbank(srX, siX, &x[319], scratchX, maxBand);
+            failed |= Compare("calc_sbr_anafilterbank", set->name, srC, srX, sizeof(srC), iter);
+            failed |= Compare("calc_sbr_anafilterbank imag", set->name, siC, siX,
+                              sizeof(siC), iter);
+#endif
+        }
+
+        /* SBR synthesis, on the filter states of the previous iteration */
+        {
+            bool down = Rand() % 4 == 0;
+
+            if (iter == 0)
+            {
+                for (int i = 0; i < 1280; i++)
+                    vC[i] = (Int16)Rand();
+                memcpy(vX, vC, sizeof(vC));
+            }
+
+            /* only every other output sample is written, the rest stays */
+            for (int i = 0; i < 128; i++)
+                timeC[i] = timeX[i] = (Int16)Rand();
+
+            RandVector(srC, 64, bits);
+            memcpy(srX, srC, sizeof(srC));
+            calc_sbr_synfilterbank_LC(srC, timeC, vC, down);
+            set->funcs.calc_sbr_synfilterbank_LC(srX, timeX, vX, down);
+            failed |= Compare("calc_sbr_synfilterbank_LC", set->name, timeC, timeX,
+                              sizeof(timeC), iter);
+            failed |= Compare("calc_sbr_synfilterbank_LC states", set->name, vC, vX,
+                              sizeof(vC), iter);
+#ifdef HQ_SBR
+            RandVector(srC, 64, bits);
+            RandVector(siC, 64, bits);
+            memcpy(srX, srC, sizeof(srC));
+            memcpy(siX, siC, sizeof(siC));
+            calc_sbr_synfilterbank(srC, siC, timeC, vC, down);
+            set->funcs.calc_sbr_synfilterbank(srX, siX, timeX, vX, down);
+            failed |= Compare("calc_sbr_synfilterbank", set->name, timeC, timeX,
+                              sizeof(timeC), iter);
+            failed |= Compare("calc_sbr_synfilterbank states", set->name, vC, vX,
+                              sizeof(vC), iter);
+#endif
+        }
+#endif
+    }
+
+    return failed;
+}
+
+#endif
+
+typedef struct
+{
+    uint8_t *data;
+    int bit;
+} BitWriter;
+
+static void PutBits(BitWriter *w, uint32_t value, int bits)
+{
+    while (bits-- > 0)
+    {
+        if (value & (1u << bits))
+            w->data[w->bit >> 3] |= 0x80 >> (w->bit & 7);
+        w->bit++;
+    }
+}
+
+/* writes a Huffman code given as a string of '0' and '1' */
+static void PutCode(BitWriter *w, const char *code)
+{
+    for (; *code; code++)
+        PutBits(w, *code - '0', 1);
+}
+
+/* codes of the deltas -2..2 in the decoder's Huffman tables */
+static const char *const sfDelta[5] = { NULL, "100", "0", "1010", NULL };
+static const char *const sbrEnvDelta[5] = { "101", "01", "00", "100", "1101" };
+static const char *const sbrNoiseDelta[5] = { "1110", "10", "0", "110", "11110" };
+static const char *const psIidDelta[5] = { "1101", "101", "0", "100", "1100" };
+static const char *const psIccDelta[5] = { "11110", "110", "0", "10", "1110" };
+
+/* a delta of -1, 0 or 1, falling more often than rising */
+static int RandDelta(void)
+{
+    unsigned int r = Rand() % 8;
+
+    return r < 3 ? -1 : r < 6 ? 0 : 1;
+}
+
+/* the next window sequence: long, then now and then start, shorts, stop */
+static int NextWindow(int prev, int *shortsLeft)
+{
+    switch (prev)
+    {
+        case LONG_START:
+            *shortsLeft = 1 + Rand() % 3;
+            /* fall through */
+        case EIGHT_SHORT:
+            if ((*shortsLeft)-- > 0)
+                return EIGHT_SHORT;
+            return LONG_STOP;
+        default:
+            return Rand() % 12 == 0 ? LONG_START : ONLY_LONG;
+    }
+}
+
+/* one individual_channel_stream with every band coded as noise */
+static void PutIcs(BitWriter *w, int window)
+{
+    int globalGain = 100 + Rand() % 8;
+    int groups, maxSfb, sectBits, escape, g, sfb, len;
+    int energy = 256 + 48 + Rand() % 8;
+
+    PutBits(w, globalGain, 8);
+
+    /* ics_info */
+    PutBits(w, 0, 1);
+    PutBits(w, window, 2);
+    PutBits(w, Rand() & 1, 1);
+    if (window == EIGHT_SHORT)
+    {
+        uint32_t grouping = Rand() & 0x7f;
+
+        maxSfb = MAX_SFB_SHORT;
+        PutBits(w, maxSfb, 4);
+        PutBits(w, grouping, 7);
+        for (groups = 8; grouping; grouping &= grouping - 1)
+            groups--;
+        sectBits = 3;
+    }
+    else
+    {
+        maxSfb = MAX_SFB_LONG;
+        groups = 1;
+        PutBits(w, maxSfb, 6);
+        PutBits(w, 0, 1);
+        sectBits = 5;
+    }
+
+    /* section_data, one noise section per group */
+    escape = (1 << sectBits) - 1;
+    for (g = 0; g < groups; g++)
+    {
+        PutBits(w, NOISE_HCB, 4);
+        for (len = maxSfb; len >= escape; len -= escape)
+            PutBits(w, escape, sectBits);
+        PutBits(w, len, sectBits);
+    }
+
+    /* scale_factor_data, the first noise energy in 9 bits, then deltas */
+    for (g = 0; g < groups; g++)
+    {
+        for (sfb = 0; sfb < maxSfb; sfb++)
+        {
+            if (g == 0 && sfb == 0)
+            {
+                PutBits(w, energy, 9);
+            }
+            else
+            {
+                PutCode(w, sfDelta[2 + RandDelta()]);
+            }
+        }
+    }
+
+    /* no pulse, TNS or gain control data, no spectral data for noise */
+    PutBits(w, 0, 3);
+}
+
+static void PutSbrHeader(BitWriter *w)
+{
+    PutBits(w, 1, 1);
+    PutBits(w, 1, 1);
+    PutBits(w, SBR_START_FREQ, 4);
+    PutBits(w, SBR_STOP_FREQ, 4);
+    PutBits(w, 0, 3);
+    PutBits(w, 0, 2);
+    PutBits(w, 0, 2);
+}
+
+/* FIXFIX, one envelope at high frequency resolution */
+static void PutSbrGrid(BitWriter *w)
+{
+    PutBits(w, 0, 2);
+    PutBits(w, 0, 2);
+    PutBits(w, 1, 1);
+}
+
+static void PutSbrInvf(BitWriter *w)
+{
+    int i;
+
+    for (i = 0; i < SBR_NOISE_BANDS; i++)
+        PutBits(w, Rand() & 3, 2);
+}
+
+/* one envelope, coded in frequency direction */
+static void PutSbrEnvelope(BitWriter *w)
+{
+    int i;
+
+    PutBits(w, 40 + Rand() % 16, 7);
+    for (i = 1; i < SBR_ENV_BANDS; i++)
+        PutCode(w, sbrEnvDelta[2 + RandDelta()]);
+}
+
+static void PutSbrNoise(BitWriter *w)
+{
+    int i;
+
+    PutBits(w, 4 + Rand() % 8, 5);
+    for (i = 1; i < SBR_NOISE_BANDS; i++)
+        PutCode(w, sbrNoiseDelta[2 + RandDelta()]);
+}
+
+/* IID and ICC in 10 bands, one envelope, coded in frequency direction */
+static void PutPsData(BitWriter *w)
+{
+    int i, value, next;
+
+    PutBits(w, 1, 1);       /* header */
+    PutBits(w, 1, 1);
+    PutBits(w, 0, 3);
+    PutBits(w, 1, 1);
+    PutBits(w, 0, 3);
+    PutBits(w, 0, 1);
+    PutBits(w, 0, 1);       /* fixed borders, one envelope */
+    PutBits(w, 1, 2);
+
+    PutBits(w, 0, 1);
+    for (i = 0, value = 0; i < PS_BINS; i++, value = next)
+    {
+        next = value + (int)(Rand() % 3) - 1;
+        if (next < -3 || next > 3)
+            next = value;
+        PutCode(w, psIidDelta[2 + next - value]);
+    }
+
+    PutBits(w, 0, 1);
+    for (i = 0, value = 0; i < PS_BINS; i++, value = next)
+    {
+        next = value + (int)(Rand() % 3) - 1;
+        if (next < 0 || next > 5)
+            next = value;
+        PutCode(w, psIccDelta[2 + next - value]);
+    }
+}
+
+/* sbr_extension_data of a single or a pair of channels */
+static int PutSbrData(BitWriter *w, int channels, int ps)
+{
+    int start = w->bit;
+    int ch;
+
+    PutSbrHeader(w);
+
+    PutBits(w, 0, 1);
+    if (channels == 2)
+    {
+        PutBits(w, 0, 1);   /* no coupling */
+        PutSbrGrid(w);
+        PutSbrGrid(w);
+        PutBits(w, 0, 4);   /* frequency direction */
+        PutSbrInvf(w);
+        PutSbrInvf(w);
+        PutSbrEnvelope(w);
+        PutSbrEnvelope(w);
+        PutSbrNoise(w);
+        PutSbrNoise(w);
+        PutBits(w, 0, 2);
+        PutBits(w, 0, 1);
+    }
+    else
+    {
+        PutSbrGrid(w);
+        PutBits(w, 0, 2);
+        PutSbrInvf(w);
+        PutSbrEnvelope(w);
+        PutSbrNoise(w);
+        PutBits(w, 0, 1);
+        if (ps)
+        {
+            uint8_t psData[32];
+            BitWriter p = { psData, 0 };
+            int bytes;
+
+            memset(psData, 0, sizeof(psData));
+            PutBits(&p, PS_EXTENSION_ID, 2);
+            PutPsData(&p);
+            bytes = (p.bit + 7) >> 3;
+
+            PutBits(w, 1, 1);
+            PutBits(w, bytes, 4);
+            for (ch = 0; ch < bytes; ch++)
+                PutBits(w, psData[ch], 8);
+        }
+        else
+        {
+            PutBits(w, 0, 1);
+        }
+    }
+
+    return w->bit - start;
+}
+
+/* a fill element carrying the SBR data of the element before it */
+static void PutSbrFill(BitWriter *w, int channels, int ps)
+{
+    uint8_t sbr[MAX_FRAME_BYTES];
+    BitWriter s = { sbr, 0 };
+    int count, i;
+
+    memset(sbr, 0, sizeof(sbr));
+    PutBits(&s, SBR_EXTENSION, 4);
+    PutSbrData(&s, channels, ps);
+    count = (s.bit + 7) >> 3;
+
+    PutBits(w, ID_FIL, 3);
+    if (count >= 15)
+    {
+        PutBits(w, 15, 4);
+        PutBits(w, count - 14, 8);
+    }
+    else
+    {
+        PutBits(w, count, 4);
+    }
+    for (i = 0; i < count; i++)
+        PutBits(w, sbr[i], 8);
+}
+
+static void MakeStream(Stream *stream, StreamMode mode, int seconds)
+{
+    int rate = mode == MODE_LC ? 48000 : 24000;
+    int channels = mode == MODE_HEV2 ? 1 : 2;
+    int frames = seconds * rate / 1024;
+    int window = ONLY_LONG, shortsLeft = 0;
+    int f;
+
+    stream->data = (uint8_t *)calloc(frames, MAX_FRAME_BYTES);
+    stream->offsets = (int *)malloc((frames + 1) * sizeof(int));
+    stream->numFrames = frames;
+
+    /* AAC-LC, frequency index, channel configuration, 1024 samples */
+    stream->config[0] = (2 << 3) | ((rate == 48000 ? 3 : 6) >> 1);
+    stream->config[1] = ((rate == 48000 ? 3 : 6) << 7) | (channels << 3);
+
+    stream->offsets[0] = 0;
+    for (f = 0; f < frames; f++)
+    {
+        BitWriter w = { stream->data + stream->offsets[f], 0 };
+
+        window = NextWindow(window, &shortsLeft);
+
+        if (channels == 2)
+        {
+            PutBits(&w, ID_CPE, 3);
+            PutBits(&w, 0, 4);
+            PutBits(&w, 0, 1);      /* separate windows */
+            PutIcs(&w, window);
+            PutIcs(&w, window);
+        }
+        else
+        {
+            PutBits(&w, ID_SCE, 3);
+            PutBits(&w, 0, 4);
+            PutIcs(&w, window);
+        }
+        if (mode != MODE_LC)
+            PutSbrFill(&w, channels, mode == MODE_HEV2);
+        PutBits(&w, ID_END, 3);
+
+        stream->offsets[f + 1] = stream->offsets[f] + ((w.bit + 7) >> 3);
+    }
+    stream->size = stream->offsets[frames];
+}
+
+static int ReadFile(Stream *stream, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL)
+        return -1;
+
+    fseek(f, 0, SEEK_END);
+    stream->size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    stream->data = (uint8_t *)malloc(stream->size + 1);
+    stream->size = fread(stream->data, 1, stream->size, f);
+    stream->offsets = NULL;
+    stream->numFrames = 0;
+    fclose(f);
+
+    return 0;
+}
+
+/* decodes the stream, returns the seconds taken and the PCM hash */
+static int Decode(const FunctionSet *set, const Stream *stream,
+                  double *seconds, double *audioSeconds, unsigned int *hash)
+{
+    tPVMP4AudioDecoderExternal config;
+    static int16_t pcm[OUTPUT_SAMPLES];
+    void *decoderBuf;
+    unsigned int h = 2166136261u;
+    long samples = 0;
+    int32_t rate = 0;
+    double start;
+    int frame = 0, offset = 0;
+
+    /* the settings SoftAAC::initDecoder() uses */
+    memset(&config, 0, sizeof(config));
+    config.outputFormat = OUTPUTFORMAT_16PCM_INTERLEAVED;
+    config.aacPlusEnabled = 1;
+    config.desiredChannels = 2;
+
+    decoderBuf = malloc(PVMP4AudioDecoderGetMemRequirements());
+    if (PVMP4AudioDecoderInitLibrary(&config, decoderBuf) != MP4AUDEC_SUCCESS)
+    {
+        free(decoderBuf);
+        return 1;
+    }
+
+#ifdef AACDEC_X86
+    aacdecX86Funcs = set->funcs;
+#else
+    (void)set;
+#endif
+
+    if (stream->offsets != NULL)
+    {
+        config.pInputBuffer = (UChar *)stream->config;
+        config.inputBufferCurrentLength = sizeof(stream->config);
+        config.inputBufferMaxLength = 0;
+        if (PVMP4AudioDecoderConfig(&config, decoderBuf) != MP4AUDEC_SUCCESS)
+        {
+            free(decoderBuf);
+            return 1;
+        }
+    }
+
+    start = Now();
+
+    /* one raw frame per buffer, or the ADTS data as it comes */
+    while (stream->offsets != NULL ? frame < stream->numFrames : offset < stream->size)
+    {
+        Int err;
+        int n, length;
+
+        if (stream->offsets != NULL)
+        {
+            offset = stream->offsets[frame];
+            length = stream->offsets[frame + 1] - offset;
+        }
+        else
+        {
+            length = stream->size - offset;
+        }
+
+        config.pInputBuffer = stream->data + offset;
+        config.inputBufferCurrentLength = length;
+        config.inputBufferMaxLength = 0;
+        config.inputBufferUsedLength = 0;
+        config.remainderBits = 0;
+        config.pOutputBuffer = pcm;
+        config.pOutputBuffer_plus = &pcm[2048];
+        config.repositionFlag = false;
+
+        err = PVMP4AudioDecodeFrame(&config, decoderBuf);
+        if (err != MP4AUDEC_SUCCESS)
+            break;
+
+        /* SoftAAC turns AAC+ off on the second frame when there is none */
+        if (frame == 1 && config.extendedAudioObjectType == MP4AUDIO_AAC_LC
+                && config.aacPlusUpsamplingFactor == 2)
+        {
+            config.aacPlusEnabled = 0;
+        }
+
+        frame++;
+        offset += config.inputBufferUsedLength;
+        if (stream->offsets == NULL && config.inputBufferUsedLength == 0)
+            break;
+
+        n = config.frameLength * config.aacPlusUpsamplingFactor;
+        samples += n;
+        rate = config.samplingRate;
+
+        n *= config.desiredChannels * sizeof(int16_t);
+        for (int i = 0; i < n; i++)
+            h = (h ^ ((uint8_t *)pcm)[i]) * 16777619u;
+    }
+
+    *seconds = Now() - start;
+    *audioSeconds = rate > 0 ? (double)samples / rate : 0;
+    *hash = h;
+
+    free(decoderBuf);
+
+    return samples == 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *only = NULL;
+    int duration = 60, runs = 3;
+    int i, m, run, failed = 0;
+    Stream streams[MODE_FILE + 1];
+    int numModes = 0;
+    StreamMode modes[MODE_FILE + 1];
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            duration = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+        {
+            input = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("usage: %s [-s seconds] [-m lc|he|hev2] [-i input.aac] [-n runs]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    InitSets();
+
+    /* before the checks use Rand(), so builds without them get the same streams */
+    if (input != NULL)
+    {
+        if (ReadFile(&streams[MODE_FILE], input))
+        {
+            printf("cannot read %s\n", input);
+            return 1;
+        }
+        modes[numModes++] = MODE_FILE;
+    }
+    else
+    {
+        for (m = MODE_LC; m <= MODE_HEV2; m++)
+        {
+            if (only != NULL && strcmp(only, modeNames[m]))
+                continue;
+            MakeStream(&streams[m], (StreamMode)m, duration);
+            modes[numModes++] = (StreamMode)m;
+        }
+        if (numModes == 0)
+        {
+            printf("unknown mode %s\n", only);
+            return 1;
+        }
+    }
+
+#ifdef AACDEC_X86
+    for (i = 0; i < numSets; i++)
+    {
+        if (CheckSet(&sets[i], 2000))
+        {
+            failed = 1;
+        }
+        else
+        {
+            printf("%s: functions match c\n", sets[i].name);
+        }
+    }
+#endif
+
+    for (m = 0; m < numModes; m++)
+    {
+        const Stream *stream = &streams[modes[m]];
+        unsigned int refHash = 0;
+
+        for (i = 0; i < numSets; i++)
+        {
+            double best = 0, audioSeconds = 0;
+            unsigned int hash = 0;
+
+            /* best of a few runs, the first one warms the caches */
+            for (run = 0; run < runs; run++)
+            {
+                double seconds;
+
+                if (Decode(&sets[i], stream, &seconds, &audioSeconds, &hash))
+                {
+                    printf("%s %s: nothing decoded\n", modeNames[modes[m]], sets[i].name);
+                    return 1;
+                }
+                if (run == 0 || seconds < best)
+                    best = seconds;
+            }
+
+            printf("%s %s: %.1fx realtime, %.1f s of audio, hash %08x\n",
+                   modeNames[modes[m]], sets[i].name, audioSeconds / best,
+                   audioSeconds, hash);
+
+            if (i == 0)
+            {
+                refHash = hash;
+            }
+            else if (hash != refHash)
+            {
+                printf("%s %s: PCM differs from c\n", modeNames[modes[m]], sets[i].name);
+                failed = 1;
+            }
+        }
+
+        free(stream->data);
+        free(stream->offsets);
+    }
+
+    return failed;
+}
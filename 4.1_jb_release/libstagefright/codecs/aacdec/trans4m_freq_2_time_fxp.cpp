@@ -445,6 +445,7 @@ OUT          ==============================================================
 #include "aac_mem_funcs.h"
 #include "window_block_fxp.h"
 #include "imdct_fxp.h"
+#include "aacdec_x86.h"
 
 #include "fxp_mul32.h"
 
@@ -615,7 +616,7 @@ void trans4m_freq_2_time_fxp_1(
         pFreqInfo = (Int16 *)Frequency_data;
 
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   LONG_BLOCK1,
@@ -1058,7 +1059,7 @@ void trans4m_freq_2_time_fxp_1(
 
             pFreqInfo = (Int16 *) & pFrequency_data[ wnd*SHORT_WINDOW];
 
-            exp = imdct_fxp(
+            exp = X86_FUNC(imdct_fxp)(
                       (Int32 *)pFreqInfo,
                       freq_2_time_buffer,
                       SHORT_BLOCK1,
@@ -1163,7 +1164,7 @@ void trans4m_freq_2_time_fxp_1(
                                     + HALF_SHORT_WINDOW;
 
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   SHORT_BLOCK1,
@@ -1274,7 +1275,7 @@ void trans4m_freq_2_time_fxp_1(
 
         pOverlap_and_Add_Buffer_1x = &Time_data[W_L_STOP_1 + SHORT_WINDOW*(wnd+1)];  /* !!!! */
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   SHORT_BLOCK1,
@@ -1402,7 +1403,7 @@ void trans4m_freq_2_time_fxp_1(
 
 
 
-            exp = imdct_fxp(
+            exp = X86_FUNC(imdct_fxp)(
                       (Int32 *)pFreqInfo,
                       freq_2_time_buffer,
                       SHORT_BLOCK1,
@@ -1618,7 +1619,7 @@ void trans4m_freq_2_time_fxp_2(
         pFreqInfo = (Int16 *)Frequency_data;
 
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   LONG_BLOCK1,
@@ -2087,7 +2088,7 @@ void trans4m_freq_2_time_fxp_2(
 
             pFreqInfo = (Int16 *) & pFrequency_data[ wnd*SHORT_WINDOW];
 
-            exp = imdct_fxp(
+            exp = X86_FUNC(imdct_fxp)(
                       (Int32 *)pFreqInfo,
                       freq_2_time_buffer,
                       SHORT_BLOCK1,
@@ -2193,7 +2194,7 @@ void trans4m_freq_2_time_fxp_2(
                                     + HALF_SHORT_WINDOW;
 
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   SHORT_BLOCK1,
@@ -2307,7 +2308,7 @@ void trans4m_freq_2_time_fxp_2(
         pOverlap_and_Add_Buffer_1x = &Time_data[W_L_STOP_1 + SHORT_WINDOW*(wnd+1)];
 
 
-        exp = imdct_fxp(
+        exp = X86_FUNC(imdct_fxp)(
                   (Int32 *)pFreqInfo,
                   freq_2_time_buffer,
                   SHORT_BLOCK1,
@@ -2438,7 +2439,7 @@ void trans4m_freq_2_time_fxp_2(
 
 
 
-            exp = imdct_fxp(
+            exp = X86_FUNC(imdct_fxp)(
                       (Int32 *)pFreqInfo,
                       freq_2_time_buffer,
                       SHORT_BLOCK1,
@@ -84,8 +84,78 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/src/asm/ARMV5E
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/src/asm/ARMV7
 endif
 
+# x86: SSE2 and AVX2 versions of the MDCT, band energy, TNS and quantizer
+# functions, picked at run time. The AVX2 ones are in
+# libstagefright_aacenc_avx2 below, which has to be linked along with this
+# library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+	src/aacenc_x86.c \
+	src/band_nrg_sse2.c \
+	src/quantize_sse2.c \
+	src/tns_sse2.c \
+	src/transform_sse2.c
+
+LOCAL_CFLAGS += -DAACENC_X86 -msse2
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../common/include
+endif
+
 include $(BUILD_STATIC_LIBRARY)
 
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	src/band_nrg_avx2.c \
+	src/transform_avx2.c
+
+LOCAL_MODULE := libstagefright_aacenc_avx2
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/basic_op
+
+LOCAL_CFLAGS := $(VO_CFLAGS) -DAACENC_X86 -mavx2
+
+include $(BUILD_STATIC_LIBRARY)
+
+endif
+
+################################################################################
+# test utility: checks the x86 functions and times the encoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	test/AACEncBench.c
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codecs/common/include \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/basic_op
+
+LOCAL_CFLAGS := $(VO_CFLAGS)
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_aacenc
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright_enc_common
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DAACENC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_aacenc_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := aacenc_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -133,6 +203,11 @@ else # visualon
   LOCAL_STATIC_LIBRARIES := \
           libstagefright_aacenc
 
+  ifeq ($(TARGET_ARCH),x86)
+  LOCAL_STATIC_LIBRARIES += libstagefright_aacenc_avx2 \
+          libstagefright_x86_cpu
+  endif
+
   LOCAL_SHARED_LIBRARIES := \
           libstagefright_omx libstagefright_foundation libutils \
           libstagefright_enc_common
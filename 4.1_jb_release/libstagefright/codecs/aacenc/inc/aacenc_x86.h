@@ -0,0 +1,137 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		aacenc_x86.h
+
+	Content:	x86 SSE2/AVX2 versions of the transform, band energy, TNS and
+				quantizer functions, picked at run time
+
+*******************************************************************************/
+
+#ifndef __AACENC_X86_H__
+#define __AACENC_X86_H__
+
+#include "typedef.h"
+
+#ifdef AACENC_X86
+
+/* the C versions are exported when the x86 functions may replace them */
+#define X86_STATIC
+
+typedef struct {
+	void (*PreMDCT)(int *buf0, int num, const int *csptr);
+	void (*PostMDCT)(int *buf0, int num, const int *csptr);
+	void (*Radix4FFT)(int *buf, int num, int bgn, int *twidTab);
+
+	void (*CalcBandEnergy)(const Word32 *mdctSpectrum,
+	                       const Word16 *bandOffset,
+	                       const Word16  numBands,
+	                       Word32       *bandEnergy,
+	                       Word32       *bandEnergySum);
+	void (*CalcBandEnergyMS)(const Word32 *mdctSpectrumLeft,
+	                         const Word32 *mdctSpectrumRight,
+	                         const Word16 *bandOffset,
+	                         const Word16  numBands,
+	                         Word32       *bandEnergyMid,
+	                         Word32       *bandEnergyMidSum,
+	                         Word32       *bandEnergySide,
+	                         Word32       *bandEnergySideSum);
+
+	void (*AutoCorrelation)(const Word16 input[],
+	                        Word32       corr[],
+	                        Word16       samples,
+	                        Word16       corrCoeff);
+
+	void (*quantizeLines)(const Word16 gain,
+	                      const Word16 noOfLines,
+	                      const Word32 *mdctSpectrum,
+	                      Word16 *quaSpectrum);
+	Word32 (*calcSfbDist)(const Word32 *spec,
+	                      Word16  sfbWidth,
+	                      Word16  gain);
+} AACENC_X86_FUNCS;
+
+/* the functions in use, the C versions until InitX86Functions() */
+extern AACENC_X86_FUNCS aacencX86Funcs;
+
+/*
+ * Fill funcs with the SSE2 or AVX2 functions the CPU supports, as reported
+ * by x86_cpu_get_features().
+ */
+void GetX86Functions(AACENC_X86_FUNCS *funcs);
+
+/* sets aacencX86Funcs on the first call, from voAACEncInit() */
+void InitX86Functions(void);
+
+#define X86_FUNC(name)	(*aacencX86Funcs.name)
+
+/* C versions, transform.c, tns.c and quantize.c */
+void PreMDCT(int *buf0, int num, const int *csptr);
+void PostMDCT(int *buf0, int num, const int *csptr);
+void Radix4FFT(int *buf, int num, int bgn, int *twidTab);
+void AutoCorrelation(const Word16 input[], Word32 corr[], Word16 samples,
+                     Word16 corrCoeff);
+void quantizeLines(const Word16 gain, const Word16 noOfLines,
+                   const Word32 *mdctSpectrum, Word16 *quaSpectrum);
+Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum);
+void iquantizeLines(const Word16 gain, const Word16 noOfLines,
+                    const Word16 *quantSpectrum, Word32 *mdctSpectrum);
+
+/* transform_sse2.c */
+void PreMDCT_SSE2(int *buf0, int num, const int *csptr);
+void PostMDCT_SSE2(int *buf0, int num, const int *csptr);
+void Radix4FFT_SSE2(int *buf, int num, int bgn, int *twidTab);
+
+/* band_nrg_sse2.c */
+void CalcBandEnergy_SSE2(const Word32 *mdctSpectrum, const Word16 *bandOffset,
+                         const Word16 numBands, Word32 *bandEnergy,
+                         Word32 *bandEnergySum);
+void CalcBandEnergyMS_SSE2(const Word32 *mdctSpectrumLeft,
+                           const Word32 *mdctSpectrumRight,
+                           const Word16 *bandOffset, const Word16 numBands,
+                           Word32 *bandEnergyMid, Word32 *bandEnergyMidSum,
+                           Word32 *bandEnergySide, Word32 *bandEnergySideSum);
+
+/* tns_sse2.c */
+void AutoCorrelation_SSE2(const Word16 input[], Word32 corr[], Word16 samples,
+                          Word16 corrCoeff);
+
+/* quantize_sse2.c */
+void quantizeLines_SSE2(const Word16 gain, const Word16 noOfLines,
+                        const Word32 *mdctSpectrum, Word16 *quaSpectrum);
+Word32 calcSfbDist_SSE2(const Word32 *spec, Word16 sfbWidth, Word16 gain);
+
+/* transform_avx2.c and band_nrg_avx2.c, in libstagefright_aacenc_avx2 */
+void PreMDCT_AVX2(int *buf0, int num, const int *csptr);
+void PostMDCT_AVX2(int *buf0, int num, const int *csptr);
+void Radix4FFT_AVX2(int *buf, int num, int bgn, int *twidTab);
+void CalcBandEnergy_AVX2(const Word32 *mdctSpectrum, const Word16 *bandOffset,
+                         const Word16 numBands, Word32 *bandEnergy,
+                         Word32 *bandEnergySum);
+void CalcBandEnergyMS_AVX2(const Word32 *mdctSpectrumLeft,
+                           const Word32 *mdctSpectrumRight,
+                           const Word16 *bandOffset, const Word16 numBands,
+                           Word32 *bandEnergyMid, Word32 *bandEnergyMidSum,
+                           Word32 *bandEnergySide, Word32 *bandEnergySideSum);
+
+#else
+
+#define X86_STATIC	static
+#define X86_FUNC(name)	name
+
+#endif
+
+#endif /* __AACENC_X86_H__ */
@@ -26,6 +26,7 @@
 #include "aac_rom.h"
 #include "cmnMemory.h"
 #include "memalign.h"
+#include "aacenc_x86.h"
 
 /**
 * Init the audio codec module and return codec handle
@@ -49,6 +50,10 @@ VO_U32 VO_API voAACEncInit(VO_HANDLE * phCodec,VO_AUDIO_CODINGTYPE vType, VO_COD
 	interMem = 0;
 	error = 0;
 
+#ifdef AACENC_X86
+	InitX86Functions();
+#endif
+
 	/* init the memory operator */
 	if(pUserData == NULL || pUserData->memflag != VO_IMF_USERMEMOPERATOR || pUserData->memData == NULL )
 	{
@@ -0,0 +1,91 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		aacenc_x86.c
+
+	Content:	CPU detection and selection of the x86 functions
+
+*******************************************************************************/
+
+#include <pthread.h>
+
+#include "typedef.h"
+#include "band_nrg.h"
+#include "quantize.h"
+#include "aacenc_x86.h"
+#include "x86_cpu.h"
+
+AACENC_X86_FUNCS aacencX86Funcs = {
+	PreMDCT,
+	PostMDCT,
+	Radix4FFT,
+	CalcBandEnergy,
+	CalcBandEnergyMS,
+	AutoCorrelation,
+	quantizeLines,
+	calcSfbDist
+};
+
+static pthread_once_t x86FuncsOnce = PTHREAD_ONCE_INIT;
+
+/*********************************************************************************
+*
+* function name: GetX86Functions
+* description:  fill funcs with the fastest functions the CPU supports
+*
+**********************************************************************************/
+void GetX86Functions(AACENC_X86_FUNCS *funcs)
+{
+	unsigned int features = x86_cpu_get_features();
+
+	funcs->PreMDCT = PreMDCT;
+	funcs->PostMDCT = PostMDCT;
+	funcs->Radix4FFT = Radix4FFT;
+	funcs->CalcBandEnergy = CalcBandEnergy;
+	funcs->CalcBandEnergyMS = CalcBandEnergyMS;
+	funcs->AutoCorrelation = AutoCorrelation;
+	funcs->quantizeLines = quantizeLines;
+	funcs->calcSfbDist = calcSfbDist;
+
+	if (features & X86_CPU_SSE2) {
+		funcs->PreMDCT = PreMDCT_SSE2;
+		funcs->PostMDCT = PostMDCT_SSE2;
+		funcs->Radix4FFT = Radix4FFT_SSE2;
+		funcs->CalcBandEnergy = CalcBandEnergy_SSE2;
+		funcs->CalcBandEnergyMS = CalcBandEnergyMS_SSE2;
+		funcs->AutoCorrelation = AutoCorrelation_SSE2;
+		funcs->quantizeLines = quantizeLines_SSE2;
+		funcs->calcSfbDist = calcSfbDist_SSE2;
+	}
+
+	if (features & X86_CPU_AVX2) {
+		funcs->PreMDCT = PreMDCT_AVX2;
+		funcs->PostMDCT = PostMDCT_AVX2;
+		funcs->Radix4FFT = Radix4FFT_AVX2;
+		funcs->CalcBandEnergy = CalcBandEnergy_AVX2;
+		funcs->CalcBandEnergyMS = CalcBandEnergyMS_AVX2;
+	}
+}
+
+static void SetX86Functions(void)
+{
+	GetX86Functions(&aacencX86Funcs);
+}
+
+void InitX86Functions(void)
+{
+	pthread_once(&x86FuncsOnce, SetX86Functions);
+}
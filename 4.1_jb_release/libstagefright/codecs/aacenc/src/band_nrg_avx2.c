@@ -0,0 +1,139 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		band_nrg_avx2.c
+
+	Content:	AVX2 versions of the band energy functions, eight lines at a
+				time, see band_nrg_sse2.c. Built with -mavx2, only called
+				when the CPU has AVX2.
+
+*******************************************************************************/
+
+#include <immintrin.h>
+
+#include "basic_op.h"
+#include "band_nrg.h"
+#include "aacenc_x86.h"
+
+/* MULHIGH(x, x) of eight lanes added to the four 64-bit lanes of acc */
+__inline __m256i AddSquares(__m256i acc, __m256i x)
+{
+	__m256i a = _mm256_abs_epi32(x);	/* |x|, unsigned */
+	__m256i even = _mm256_mul_epu32(a, a);
+	__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(a, 32));
+
+	acc = _mm256_add_epi64(acc, _mm256_srli_epi64(even, 32));
+	return _mm256_add_epi64(acc, _mm256_srli_epi64(odd, 32));
+}
+
+__inline Word64 Sum64(__m256i acc)
+{
+	Word64 sum[4];
+
+	_mm256_storeu_si256((__m256i *)sum, acc);
+	return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+__inline Word32 Clip32(Word64 x)
+{
+	return x > MAX_32 ? MAX_32 : (Word32)x;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergy_AVX2
+* description:   CalcBandEnergy(), eight lines at a time
+*
+**********************************************************************************/
+void CalcBandEnergy_AVX2(const Word32 *mdctSpectrum,
+                         const Word16 *bandOffset,
+                         const Word16  numBands,
+                         Word32       *bandEnergy,
+                         Word32       *bandEnergySum)
+{
+  Word32 i, j;
+  Word64 accuSum = 0;
+
+  for (i=0; i<numBands; i++) {
+    __m256i acc = _mm256_setzero_si256();
+    Word64 accu;
+
+    for (j=bandOffset[i]; j+8<=bandOffset[i+1]; j+=8)
+      acc = AddSquares(acc, _mm256_loadu_si256((const __m256i *)(mdctSpectrum + j)));
+
+    accu = Sum64(acc);
+    for (; j<bandOffset[i+1]; j++)
+      accu += MULHIGH(mdctSpectrum[j], mdctSpectrum[j]);
+
+    accu = Clip32(2 * (Word64)Clip32(accu));
+    accuSum = Clip32(accuSum + accu);
+    bandEnergy[i] = (Word32)accu;
+  }
+  *bandEnergySum = (Word32)accuSum;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergyMS_AVX2
+* description:   CalcBandEnergyMS(), eight lines at a time
+*
+**********************************************************************************/
+void CalcBandEnergyMS_AVX2(const Word32 *mdctSpectrumLeft,
+                           const Word32 *mdctSpectrumRight,
+                           const Word16 *bandOffset,
+                           const Word16  numBands,
+                           Word32       *bandEnergyMid,
+                           Word32       *bandEnergyMidSum,
+                           Word32       *bandEnergySide,
+                           Word32       *bandEnergySideSum)
+{
+  Word32 i, j;
+  Word64 accuMidSum = 0;
+  Word64 accuSideSum = 0;
+
+  for(i=0; i<numBands; i++) {
+    __m256i accMid = _mm256_setzero_si256();
+    __m256i accSide = _mm256_setzero_si256();
+    Word64 accuMid, accuSide;
+
+    for (j=bandOffset[i]; j+8<=bandOffset[i+1]; j+=8) {
+      __m256i l = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(mdctSpectrumLeft + j)), 1);
+      __m256i r = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(mdctSpectrumRight + j)), 1);
+
+      accMid = AddSquares(accMid, _mm256_add_epi32(l, r));
+      accSide = AddSquares(accSide, _mm256_sub_epi32(l, r));
+    }
+
+    accuMid = Sum64(accMid);
+    accuSide = Sum64(accSide);
+    for (; j<bandOffset[i+1]; j++) {
+      Word32 l = mdctSpectrumLeft[j] >> 1;
+      Word32 r = mdctSpectrumRight[j] >> 1;
+
+      accuMid += MULHIGH(l + r, l + r);
+      accuSide += MULHIGH(l - r, l - r);
+    }
+
+    accuMid = Clip32(2 * (Word64)Clip32(accuMid));
+    accuSide = Clip32(2 * (Word64)Clip32(accuSide));
+    bandEnergyMid[i] = (Word32)accuMid;
+    accuMidSum = Clip32(accuMidSum + accuMid);
+    bandEnergySide[i] = (Word32)accuSide;
+    accuSideSum = Clip32(accuSideSum + accuSide);
+  }
+  *bandEnergyMidSum = (Word32)accuMidSum;
+  *bandEnergySideSum = (Word32)accuSideSum;
+}
@@ -0,0 +1,143 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		band_nrg_sse2.c
+
+	Content:	SSE2 versions of the band energy functions, same output as
+				band_nrg.c
+
+	The terms MULHIGH(x, x) are never negative, so the saturating sums of
+	the C code equal the exact sums clipped to MAX_32. They are kept in 64
+	bits here and clipped once per band.
+
+*******************************************************************************/
+
+#include <emmintrin.h>
+
+#include "basic_op.h"
+#include "band_nrg.h"
+#include "aacenc_x86.h"
+
+/* MULHIGH(x, x) of four lanes added to the two 64-bit lanes of acc */
+__inline __m128i AddSquares(__m128i acc, __m128i x)
+{
+	__m128i s = _mm_srai_epi32(x, 31);
+	__m128i a = _mm_sub_epi32(_mm_xor_si128(x, s), s);	/* |x|, unsigned */
+	__m128i even = _mm_mul_epu32(a, a);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(a, 32));
+
+	acc = _mm_add_epi64(acc, _mm_srli_epi64(even, 32));
+	return _mm_add_epi64(acc, _mm_srli_epi64(odd, 32));
+}
+
+__inline Word64 Sum64(__m128i acc)
+{
+	Word64 sum[2];
+
+	_mm_storeu_si128((__m128i *)sum, acc);
+	return sum[0] + sum[1];
+}
+
+__inline Word32 Clip32(Word64 x)
+{
+	return x > MAX_32 ? MAX_32 : (Word32)x;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergy_SSE2
+* description:   CalcBandEnergy(), four lines at a time
+*
+**********************************************************************************/
+void CalcBandEnergy_SSE2(const Word32 *mdctSpectrum,
+                         const Word16 *bandOffset,
+                         const Word16  numBands,
+                         Word32       *bandEnergy,
+                         Word32       *bandEnergySum)
+{
+  Word32 i, j;
+  Word64 accuSum = 0;
+
+  for (i=0; i<numBands; i++) {
+    __m128i acc = _mm_setzero_si128();
+    Word64 accu;
+
+    for (j=bandOffset[i]; j+4<=bandOffset[i+1]; j+=4)
+      acc = AddSquares(acc, _mm_loadu_si128((const __m128i *)(mdctSpectrum + j)));
+
+    accu = Sum64(acc);
+    for (; j<bandOffset[i+1]; j++)
+      accu += MULHIGH(mdctSpectrum[j], mdctSpectrum[j]);
+
+    accu = Clip32(2 * (Word64)Clip32(accu));
+    accuSum = Clip32(accuSum + accu);
+    bandEnergy[i] = (Word32)accu;
+  }
+  *bandEnergySum = (Word32)accuSum;
+}
+
+/********************************************************************************
+*
+* function name: CalcBandEnergyMS_SSE2
+* description:   CalcBandEnergyMS(), four lines at a time
+*
+**********************************************************************************/
+void CalcBandEnergyMS_SSE2(const Word32 *mdctSpectrumLeft,
+                           const Word32 *mdctSpectrumRight,
+                           const Word16 *bandOffset,
+                           const Word16  numBands,
+                           Word32       *bandEnergyMid,
+                           Word32       *bandEnergyMidSum,
+                           Word32       *bandEnergySide,
+                           Word32       *bandEnergySideSum)
+{
+  Word32 i, j;
+  Word64 accuMidSum = 0;
+  Word64 accuSideSum = 0;
+
+  for(i=0; i<numBands; i++) {
+    __m128i accMid = _mm_setzero_si128();
+    __m128i accSide = _mm_setzero_si128();
+    Word64 accuMid, accuSide;
+
+    for (j=bandOffset[i]; j+4<=bandOffset[i+1]; j+=4) {
+      __m128i l = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(mdctSpectrumLeft + j)), 1);
+      __m128i r = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(mdctSpectrumRight + j)), 1);
+
+      accMid = AddSquares(accMid, _mm_add_epi32(l, r));
+      accSide = AddSquares(accSide, _mm_sub_epi32(l, r));
+    }
+
+    accuMid = Sum64(accMid);
+    accuSide = Sum64(accSide);
+    for (; j<bandOffset[i+1]; j++) {
+      Word32 l = mdctSpectrumLeft[j] >> 1;
+      Word32 r = mdctSpectrumRight[j] >> 1;
+
+      accuMid += MULHIGH(l + r, l + r);
+      accuSide += MULHIGH(l - r, l - r);
+    }
+
+    accuMid = Clip32(2 * (Word64)Clip32(accuMid));
+    accuSide = Clip32(2 * (Word64)Clip32(accuSide));
+    bandEnergyMid[i] = (Word32)accuMid;
+    accuMidSum = Clip32(accuMidSum + accuMid);
+    bandEnergySide[i] = (Word32)accuSide;
+    accuSideSum = Clip32(accuSideSum + accuSide);
+  }
+  *bandEnergyMidSum = (Word32)accuMidSum;
+  *bandEnergySideSum = (Word32)accuSideSum;
+}
@@ -37,6 +37,7 @@
 #include "grp_data.h"
 #include "tns_func.h"
 #include "memalign.h"
+#include "aacenc_x86.h"
 
 /*                                    long       start       short       stop */
 static Word16 blockType2windowShape[] = {KBD_WINDOW,SINE_WINDOW,SINE_WINDOW,KBD_WINDOW};
@@ -487,7 +488,7 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
   }
 
   /* Calc sfb-bandwise mdct-energies for left and right channel */
-  CalcBandEnergy( psyData->mdctSpectrum,
+  X86_FUNC(CalcBandEnergy)( psyData->mdctSpectrum,
                   hPsyConfLong->sfbOffset,
                   hPsyConfLong->sfbActive,
                   psyData->sfbEnergy.sfbLong,
@@ -535,7 +536,7 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
   /* Calc sfb-bandwise mdct-energies for left and right channel again */
   if (tnsData->dataRaw.tnsLong.subBlockInfo.tnsActive!=0) {
     Word16 tnsStartBand = hPsyConfLong->tnsConf.tnsStartBand;
-    CalcBandEnergy( psyData->mdctSpectrum,
+    X86_FUNC(CalcBandEnergy)( psyData->mdctSpectrum,
                     hPsyConfLong->sfbOffset+tnsStartBand,
                     hPsyConfLong->sfbActive - tnsStartBand,
                     psyData->sfbEnergy.sfbLong+tnsStartBand,
@@ -626,7 +627,7 @@ static Word16 advancePsychLong(PSY_DATA* psyData,
 static Word16 advancePsychLongMS (PSY_DATA psyData[MAX_CHANNELS],
                                   const PSY_CONFIGURATION_LONG *hPsyConfLong)
 {
-  CalcBandEnergyMS(psyData[0].mdctSpectrum,
+  X86_FUNC(CalcBandEnergyMS)(psyData[0].mdctSpectrum,
                    psyData[1].mdctSpectrum,
                    hPsyConfLong->sfbOffset,
                    hPsyConfLong->sfbActive,
@@ -671,7 +672,7 @@ static Word16 advancePsychShort(PSY_DATA* psyData,
     }
 
     /* Calc sfb-bandwise mdct-energies for left and right channel */
-    CalcBandEnergy( psyData->mdctSpectrum+wOffset,
+    X86_FUNC(CalcBandEnergy)( psyData->mdctSpectrum+wOffset,
                     hPsyConfShort->sfbOffset,
                     hPsyConfShort->sfbActive,
                     psyData->sfbEnergy.sfbShort[w],
@@ -717,7 +718,7 @@ static Word16 advancePsychShort(PSY_DATA* psyData,
     /* Calc sfb-bandwise mdct-energies for left and right channel again */
     if (tnsData->dataRaw.tnsShort.subBlockInfo[w].tnsActive != 0) {
       Word16 tnsStartBand = hPsyConfShort->tnsConf.tnsStartBand;
-      CalcBandEnergy( psyData->mdctSpectrum+wOffset,
+      X86_FUNC(CalcBandEnergy)( psyData->mdctSpectrum+wOffset,
                       hPsyConfShort->sfbOffset+tnsStartBand,
                       (hPsyConfShort->sfbActive - tnsStartBand),
                       psyData->sfbEnergy.sfbShort[w]+tnsStartBand,
@@ -796,7 +797,7 @@ static Word16 advancePsychShortMS (PSY_DATA psyData[MAX_CHANNELS],
   Word32 w, wOffset;
   wOffset = 0;
   for(w=0; w<TRANS_FAC; w++) {
-    CalcBandEnergyMS(psyData[0].mdctSpectrum+wOffset,
+    X86_FUNC(CalcBandEnergyMS)(psyData[0].mdctSpectrum+wOffset,
                      psyData[1].mdctSpectrum+wOffset,
                      hPsyConfShort->sfbOffset,
                      hPsyConfShort->sfbActive,
@@ -25,6 +25,7 @@
 #include "oper_32b.h"
 #include "quantize.h"
 #include "aac_rom.h"
+#include "aacenc_x86.h"
 
 #define MANT_DIGITS 9
 #define MANT_SIZE   (1<<MANT_DIGITS)
@@ -53,7 +54,7 @@ __inline Word32 pow34(Word32 x)
 *              quaSpectrum = mdctSpectrum^3/4*2^(-(3/16)*gain)
 *
 *****************************************************************************/
-static Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum)
+X86_STATIC Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum)
 {
   Word32 e, minusFinalExp, finalShift;
   Word32 x;
@@ -101,7 +102,7 @@ static Word16 quantizeSingleLine(const Word16 gain, const Word32 absSpectrum)
 *  output: quantized spectrum
 *
 *****************************************************************************/
-static void quantizeLines(const Word16 gain,
+X86_STATIC void quantizeLines(const Word16 gain,
                           const Word16 noOfLines,
                           const Word32 *mdctSpectrum,
                           Word16 *quaSpectrum)
@@ -225,7 +226,7 @@ static void quantizeLines(const Word16 gain,
 * output: spectral data
 *
 *****************************************************************************/
-static void iquantizeLines(const Word16 gain,
+X86_STATIC void iquantizeLines(const Word16 gain,
                            const Word16 noOfLines,
                            const Word16 *quantSpectrum,
                            Word32 *mdctSpectrum)
@@ -307,7 +308,7 @@ void QuantizeSpectrum(Word16 sfbCnt,
            sfbNext < maxSfbPerGroup && scalefactor == scalefactors[sfbOffs+sfbNext];
            sfbNext++) ;
 
-      quantizeLines(globalGain - scalefactor,
+      X86_FUNC(quantizeLines)(globalGain - scalefactor,
                     sfbOffset[sfbOffs+sfbNext] - sfbOffset[sfbOffs+sfb],
                     mdctSpectrum + sfbOffset[sfbOffs+sfb],
                     quantizedSpectrum + sfbOffset[sfbOffs+sfb]);
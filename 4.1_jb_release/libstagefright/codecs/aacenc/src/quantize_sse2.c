@@ -0,0 +1,197 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		quantize_sse2.c
+
+	Content:	SSE2 versions of the quantizer and the distortion estimate,
+				same output as quantize.c
+
+	Lines quantized to 0..3 are done four at a time against the quantBorders
+	table; the rare larger ones go through quantizeSingleLine() as in the C
+	code. Gains the C code shifts by more than 31, or left, are passed to the
+	C functions whole.
+
+*******************************************************************************/
+
+#include <emmintrin.h>
+
+#include "typedef.h"
+#include "basic_op.h"
+#include "oper_32b.h"
+#include "quantize.h"
+#include "aac_rom.h"
+#include "aacenc_x86.h"
+
+/* L_abs() of four lanes */
+__inline __m128i AbsSat(__m128i x)
+{
+	__m128i s = _mm_srai_epi32(x, 31);
+
+	x = _mm_sub_epi32(_mm_xor_si128(x, s), s);
+	return _mm_xor_si128(x, _mm_srai_epi32(x, 31));		/* MIN_32 -> MAX_32 */
+}
+
+/*****************************************************************************
+*
+* function name:quantizeLines_SSE2
+* description: quantizeLines(), four lines at a time
+*
+*****************************************************************************/
+void quantizeLines_SSE2(const Word16 gain,
+                        const Word16 noOfLines,
+                        const Word32 *mdctSpectrum,
+                        Word16 *quaSpectrum)
+{
+  const Word16 *pquat = quantBorders[gain&3];
+  Word32 g = (gain >> 2) + 20;
+  __m128i border0, border1, border2, border3;
+  __m128i shift;
+  Word32 line;
+
+  if (g < 0 || g >= INT_BITS) {
+    quantizeLines(gain, noOfLines, mdctSpectrum, quaSpectrum);
+    return;
+  }
+
+  shift = _mm_cvtsi32_si128(g);
+  border0 = _mm_set1_epi32(pquat[0]);
+  border1 = _mm_set1_epi32(pquat[1] - 1);
+  border2 = _mm_set1_epi32(pquat[2] - 1);
+  border3 = _mm_set1_epi32(pquat[3] - 1);
+
+  for (line=0; line+4<=noOfLines; line+=4) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(mdctSpectrum + line));
+    __m128i sa = AbsSat(x);
+    __m128i saShft = _mm_srl_epi32(sa, shift);
+    __m128i sign = _mm_srai_epi32(x, 31);
+    __m128i qua;
+    Word32 big;
+
+    /* 1, 2 or 3 above the first three borders, with the sign of x */
+    qua = _mm_add_epi32(_mm_cmpgt_epi32(saShft, border0), _mm_cmpgt_epi32(saShft, border1));
+    qua = _mm_sub_epi32(_mm_setzero_si128(), _mm_add_epi32(qua, _mm_cmpgt_epi32(saShft, border2)));
+    qua = _mm_sub_epi32(_mm_xor_si128(qua, sign), sign);
+    _mm_storel_epi64((__m128i *)(quaSpectrum + line), _mm_packs_epi32(qua, qua));
+
+    big = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(saShft, border3)));
+    while (big) {
+      Word32 k = __builtin_ctz(big);
+      Word32 mdctSpeL = mdctSpectrum[line + k];
+      Word16 q = quantizeSingleLine(gain, L_abs(mdctSpeL));
+
+      quaSpectrum[line + k] = mdctSpeL < 0 ? -q : q;
+      big &= big - 1;
+    }
+  }
+
+  if (line < noOfLines)
+    quantizeLines(gain, noOfLines - line, mdctSpectrum + line, quaSpectrum + line);
+}
+
+/*****************************************************************************
+*
+* function name:calcSfbDist_SSE2
+* description: calcSfbDist(), four lines at a time
+*
+*****************************************************************************/
+Word32 calcSfbDist_SSE2(const Word32 *spec,
+                        Word16  sfbWidth,
+                        Word16  gain)
+{
+  const Word16 *pquat = quantBorders[gain&3];
+  const Word16 *repquat = quantRecon[gain&3];
+  Word32 g = (gain >> 2) + 4;
+  Word32 g2 = (g << 1) + 1;
+  __m128i border0, border1, border2, border3;
+  __m128i recon0, recon1, recon2;
+  __m128i shift, distShift, distMax, acc;
+  const __m128i mask16 = _mm_set1_epi32(0xffff);
+  const __m128i zero = _mm_setzero_si128();
+  Word64 dist = 0;
+  Word32 line;
+
+  g += 16;
+  if (g < 0 || g >= INT_BITS)
+    return calcSfbDist(spec, sfbWidth, gain);
+
+  shift = _mm_cvtsi32_si128(g);
+  distShift = _mm_cvtsi32_si128(g2 < 0 ? -g2 : g2);
+  distMax = _mm_set1_epi32(MAX_32 >> (g2 < 0 ? 0 : g2));
+  border0 = _mm_set1_epi32(pquat[0] - 1);
+  border1 = _mm_set1_epi32(pquat[1] - 1);
+  border2 = _mm_set1_epi32(pquat[2] - 1);
+  border3 = _mm_set1_epi32(pquat[3] - 1);
+  recon0 = _mm_set1_epi32(repquat[0]);
+  recon1 = _mm_set1_epi32(repquat[1] - repquat[0]);
+  recon2 = _mm_set1_epi32(repquat[2] - repquat[1]);
+  acc = zero;
+
+  for (line=0; line+4<=sfbWidth; line+=4) {
+    __m128i sa = AbsSat(_mm_loadu_si128((const __m128i *)(spec + line)));
+    __m128i saShft = _mm_srl_epi32(sa, shift);
+    __m128i big = _mm_cmpgt_epi32(saShft, border3);
+    __m128i diff, distSingle;
+    Word32 bigMask;
+
+    /* the reconstruction value below saShft, 0 under the first border */
+    diff = _mm_and_si128(_mm_cmpgt_epi32(saShft, border0), recon0);
+    diff = _mm_add_epi32(diff, _mm_and_si128(_mm_cmpgt_epi32(saShft, border1), recon1));
+    diff = _mm_add_epi32(diff, _mm_and_si128(_mm_cmpgt_epi32(saShft, border2), recon2));
+    diff = _mm_and_si128(_mm_sub_epi32(saShft, diff), mask16);
+    distSingle = _mm_madd_epi16(diff, diff);
+
+    if (g2 < 0) {
+      distSingle = _mm_srl_epi32(distSingle, distShift);
+    }
+    else {
+      /* L_shl() */
+      __m128i sat = _mm_cmpgt_epi32(distSingle, distMax);
+
+      distSingle = _mm_or_si128(_mm_andnot_si128(sat, _mm_sll_epi32(distSingle, distShift)),
+                                _mm_and_si128(sat, _mm_set1_epi32(MAX_32)));
+    }
+
+    distSingle = _mm_andnot_si128(big, distSingle);
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(distSingle, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(distSingle, zero));
+
+    bigMask = _mm_movemask_ps(_mm_castsi128_ps(big));
+    while (bigMask) {
+      Word32 k = __builtin_ctz(bigMask);
+      Word32 sa1 = L_abs(spec[line + k]);
+      Word16 qua = quantizeSingleLine(gain, sa1);
+      Word32 iqval, diff32;
+
+      /* now that we have quantized x, re-quantize it. */
+      iquantizeLines(gain, 1, &qua, &iqval);
+      diff32 = sa1 - iqval;
+      dist += fixmul(diff32, diff32);
+      bigMask &= bigMask - 1;
+    }
+  }
+
+  if (line < sfbWidth)
+    dist += calcSfbDist(spec + line, sfbWidth - line, gain);
+
+  {
+    Word64 sum[2];
+
+    _mm_storeu_si128((__m128i *)sum, acc);
+    dist += sum[0] + sum[1];
+  }
+
+  return dist > MAX_32 ? MAX_32 : (Word32)dist;
+}
@@ -26,6 +26,7 @@
 #include "quantize.h"
 #include "bit_cnt.h"
 #include "aac_rom.h"
+#include "aacenc_x86.h"
 
 static const Word16 MAX_SCF_DELTA = 60;
 
@@ -157,7 +158,7 @@ static Word16 improveScf(Word32 *spec,
 	scfBest = scf;
 
 	/* calc real distortion */
-	sfbDist = calcSfbDist(spec, sfbWidth, scf);
+	sfbDist = X86_FUNC(calcSfbDist)(spec, sfbWidth, scf);
 	*minScfCalculated = scf;
 	if(!sfbDist)
 	  return scfBest;
@@ -172,7 +173,7 @@ static Word16 improveScf(Word32 *spec,
 		while (sfbDist > thresh125 && (cnt < 3)) {
 
 			scf = scf + 1;
-			sfbDist = calcSfbDist(spec, sfbWidth, scf);
+			sfbDist = X86_FUNC(calcSfbDist)(spec, sfbWidth, scf);
 
 			if (sfbDist < sfbDistBest) {
 				scfBest = scf;
@@ -186,7 +187,7 @@ static Word16 improveScf(Word32 *spec,
 		while ((sfbDist > thresh125) && (cnt < 1) && (scf > minScf)) {
 
 			scf = scf - 1;
-			sfbDist = calcSfbDist(spec, sfbWidth, scf);
+			sfbDist = X86_FUNC(calcSfbDist)(spec, sfbWidth, scf);
 
 			if (sfbDist < sfbDistBest) {
 				scfBest = scf;
@@ -209,7 +210,7 @@ static Word16 improveScf(Word32 *spec,
 			sfbDistAllowed = thresh08;
 		for (cnt=0; cnt<3; cnt++) {
 			scf = scf + 1;
-			sfbDist = calcSfbDist(spec, sfbWidth, scf);
+			sfbDist = X86_FUNC(calcSfbDist)(spec, sfbWidth, scf);
 
 			if (fixmul(COEF08_31,sfbDist) < sfbDistAllowed) {
 				*minScfCalculated = scfBest + 1;
@@ -500,7 +501,7 @@ static void assimilateSingleScf(PSY_OUT_CHANNEL *psyOutChan,
 					deltaPeTmp = deltaPe + sfbPeNew - sfbPeOld;
 
 					if (deltaPeTmp < 10) {
-						sfbDistNew = calcSfbDist(psyOutChan->mdctSpectrum+
+						sfbDistNew = X86_FUNC(calcSfbDist)(psyOutChan->mdctSpectrum+
 							psyOutChan->sfbOffsets[sfbAct],
 							(psyOutChan->sfbOffsets[sfbAct+1] - psyOutChan->sfbOffsets[sfbAct]),
 							scfAct);
@@ -657,7 +658,7 @@ static void assimilateMultipleScf(PSY_OUT_CHANNEL *psyOutChan,
 							if (scfTmp[sfb] != MIN_16) {
 								distOldSum = L_add(distOldSum, sfbDist[sfb]);
 
-								sfbDistNew[sfb] = calcSfbDist(psyOutChan->mdctSpectrum +
+								sfbDistNew[sfb] = X86_FUNC(calcSfbDist)(psyOutChan->mdctSpectrum +
 									psyOutChan->sfbOffsets[sfb],
 									(psyOutChan->sfbOffsets[sfb+1] - psyOutChan->sfbOffsets[sfb]),
 									scfAct);
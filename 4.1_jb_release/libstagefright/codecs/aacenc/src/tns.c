@@ -29,6 +29,7 @@
 #include "tns_param.h"
 #include "psy_configuration.h"
 #include "tns_func.h"
+#include "aacenc_x86.h"
 
 #define TNS_MODIFY_BEGIN         2600  /* Hz */
 #define RATIO_PATCH_LOWER_BORDER 380   /* Hz */
@@ -649,7 +650,7 @@ static Word16 CalcTnsFilter(const Word16 *signal,
     parcor[i] = 0;
   }
 
-  AutoCorrelation(signal, parcorWorkBuffer, numOfLines, tnsOrderPlus1);
+  X86_FUNC(AutoCorrelation)(signal, parcorWorkBuffer, numOfLines, tnsOrderPlus1);
 
   /* early return if signal is very low: signal prediction off, with zero parcor coeffs */
   if (parcorWorkBuffer[0] == 0)
@@ -0,0 +1,88 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		tns_sse2.c
+
+	Content:	SSE2 version of the TNS autocorrelation, same output as tns.c
+
+	Each term (t[i] * t[i+j]) >> 9 is at most 2^21 in size, so with up to
+	FRAME_LEN_LONG lines only R[0] can reach the saturation of L_add(), and
+	its terms are never negative. The sums are done exactly and R[0] is
+	clipped to MAX_32.
+
+*******************************************************************************/
+
+#include <emmintrin.h>
+
+#include "basic_op.h"
+#include "psy_const.h"
+#include "aacenc_x86.h"
+
+/* sum of (a[i] * b[i]) >> 9, i = 0..n-1 */
+static Word64 CorrSum(const Word16 *a, const Word16 *b, Word32 n)
+{
+	__m128i acc = _mm_setzero_si128();
+	Word32 sum[4];
+	Word64 accu;
+	Word32 i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+		__m128i lo = _mm_mullo_epi16(x, y);
+		__m128i hi = _mm_mulhi_epi16(x, y);
+
+		acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 9));
+		acc = _mm_add_epi32(acc, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 9));
+	}
+
+	_mm_storeu_si128((__m128i *)sum, acc);
+	accu = (Word64)sum[0] + sum[1] + sum[2] + sum[3];
+
+	for (; i < n; i++)
+		accu += (a[i] * b[i]) >> 9;
+
+	return accu;
+}
+
+/*****************************************************************************
+*
+* function name: AutoCorrelation_SSE2
+* description:  AutoCorrelation(), eight lines at a time
+*
+*****************************************************************************/
+void AutoCorrelation_SSE2(const Word16		 input[],
+                          Word32       corr[],
+                          Word16       samples,
+                          Word16       corrCoeff)
+{
+  Word64 accu;
+  Word32 i;
+
+  if (samples > FRAME_LEN_LONG) {
+    AutoCorrelation(input, corr, samples, corrCoeff);
+    return;
+  }
+
+  accu = CorrSum(input, input, samples);
+  corr[0] = accu > MAX_32 ? MAX_32 : (Word32)accu;
+
+  /* early termination if all corr coeffs are likely going to be zero */
+  if (corr[0] == 0) return;
+
+  for (i = 1; i < corrCoeff; i++)
+    corr[i] = (Word32)CorrSum(input, input + i, samples - i);
+}
@@ -24,6 +24,7 @@
 #include "psy_const.h"
 #include "transform.h"
 #include "aac_rom.h"
+#include "aacenc_x86.h"
 
 
 #define LS_TRANS ((FRAME_LEN_LONG-FRAME_LEN_SHORT)/2) /* 448 */
@@ -185,7 +186,7 @@ static void Radix8First(int *buf, int num)
 * description:  Radix 4 point fft core function
 *
 **********************************************************************************/
-static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
+X86_STATIC void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
 {
 	int r0, r1, r2, r3;
 	int r4, r5, r6, r7;
@@ -276,7 +277,7 @@ static void Radix4FFT(int *buf, int num, int bgn, int *twidTab)
 * description:  prepare MDCT process for next FFT compute
 *
 **********************************************************************************/
-static void PreMDCT(int *buf0, int num, const int *csptr)
+X86_STATIC void PreMDCT(int *buf0, int num, const int *csptr)
 {
 	int i;
 	int tr1, ti1, tr2, ti2;
@@ -311,7 +312,7 @@ static void PreMDCT(int *buf0, int num, const int *csptr)
 * description:   post MDCT process after next FFT for MDCT
 *
 **********************************************************************************/
-static void PostMDCT(int *buf0, int num, const int *csptr)
+X86_STATIC void PostMDCT(int *buf0, int num, const int *csptr)
 {
 	int i;
 	int tr1, ti1, tr2, ti2;
@@ -356,13 +357,13 @@ void PostMDCT(int *buf0, int num, const int *csptr);
 **********************************************************************************/
 void Mdct_Long(int *buf)
 {
-	PreMDCT(buf, 1024, cossintab + 128);
+	X86_FUNC(PreMDCT)(buf, 1024, cossintab + 128);
 
 	Shuffle(buf, 512, bitrevTab + 17);
 	Radix8First(buf, 512 >> 3);
-	Radix4FFT(buf, 512 >> 3, 8, (int *)twidTab512);
+	X86_FUNC(Radix4FFT)(buf, 512 >> 3, 8, (int *)twidTab512);
 
-	PostMDCT(buf, 1024, cossintab + 128);
+	X86_FUNC(PostMDCT)(buf, 1024, cossintab + 128);
 }
 
 
@@ -374,13 +375,13 @@ void Mdct_Long(int *buf)
 **********************************************************************************/
 void Mdct_Short(int *buf)
 {
-	PreMDCT(buf, 128, cossintab);
+	X86_FUNC(PreMDCT)(buf, 128, cossintab);
 
 	Shuffle(buf, 64, bitrevTab);
 	Radix4First(buf, 64 >> 2);
-	Radix4FFT(buf, 64 >> 2, 4, (int *)twidTab64);
+	X86_FUNC(Radix4FFT)(buf, 64 >> 2, 4, (int *)twidTab64);
 
-	PostMDCT(buf, 128, cossintab);
+	X86_FUNC(PostMDCT)(buf, 128, cossintab);
 }
 
 
@@ -0,0 +1,236 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		transform_avx2.c
+
+	Content:	AVX2 versions of the MDCT pre/post rotation and the radix 4
+				FFT stages, twice the width of transform_sse2.c. Built with
+				-mavx2, only called when the CPU has AVX2.
+
+*******************************************************************************/
+
+#include <immintrin.h>
+
+#include "typedef.h"
+#include "aacenc_x86.h"
+
+/* MULHIGH() on eight lanes */
+__inline __m256i MulHigh(__m256i a, __m256i b)
+{
+	__m256i even = _mm256_mul_epi32(a, b);
+	__m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+
+	return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+/* even and odd words of the sixteen at p */
+__inline void LoadPairs(const int *p, __m256i *even, __m256i *odd)
+{
+	const __m256i perm = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	__m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)p), perm);
+	__m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(p + 8)), perm);
+
+	*even = _mm256_permute2x128_si256(a, b, 0x20);
+	*odd = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+__inline void StorePairs(int *p, __m256i even, __m256i odd)
+{
+	__m256i lo = _mm256_unpacklo_epi32(even, odd);
+	__m256i hi = _mm256_unpackhi_epi32(even, odd);
+
+	_mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256((__m256i *)(p + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/* the same for the sixteen words ending at p, walked backwards */
+__inline void LoadPairsRev(const int *p, __m256i *even, __m256i *odd)
+{
+	const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+	LoadPairs(p - 15, even, odd);
+	*even = _mm256_permutevar8x32_epi32(*even, rev);
+	*odd = _mm256_permutevar8x32_epi32(*odd, rev);
+}
+
+__inline void StorePairsRev(int *p, __m256i even, __m256i odd)
+{
+	const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+	StorePairs(p - 15, _mm256_permutevar8x32_epi32(even, rev),
+	           _mm256_permutevar8x32_epi32(odd, rev));
+}
+
+/* two rows of four words, p and p + 16, one per half */
+__inline __m256i LoadRows(const int *p)
+{
+	__m256i x = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p));
+
+	return _mm256_inserti128_si256(x, _mm_loadu_si128((const __m128i *)(p + 16)), 1);
+}
+
+/* cos a, sin a, cos b, sin b of eight rotations */
+__inline void LoadRotations(const int *csptr, __m256i cs[4])
+{
+	__m256i r0 = LoadRows(csptr);
+	__m256i r1 = LoadRows(csptr + 4);
+	__m256i r2 = LoadRows(csptr + 8);
+	__m256i r3 = LoadRows(csptr + 12);
+	__m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+	__m256i t1 = _mm256_unpacklo_epi32(r2, r3);
+	__m256i t2 = _mm256_unpackhi_epi32(r0, r1);
+	__m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+
+	cs[0] = _mm256_unpacklo_epi64(t0, t1);
+	cs[1] = _mm256_unpackhi_epi64(t0, t1);
+	cs[2] = _mm256_unpacklo_epi64(t2, t3);
+	cs[3] = _mm256_unpackhi_epi64(t2, t3);
+}
+
+/*********************************************************************************
+*
+* function name: PreMDCT_AVX2
+* description:  PreMDCT(), eight rotations from each end at a time
+*
+**********************************************************************************/
+void PreMDCT_AVX2(int *buf0, int num, const int *csptr)
+{
+	int *buf1 = buf0 + num - 1;
+	__m256i tr1, ti1, tr2, ti2, cs[4];
+	int i;
+
+	for (i = num >> 5; i != 0; i--)
+	{
+		LoadRotations(csptr, cs);
+		LoadPairs(buf0, &tr1, &ti2);
+		LoadPairsRev(buf1, &tr2, &ti1);
+
+		StorePairs(buf0,
+		           _mm256_add_epi32(MulHigh(cs[0], tr1), MulHigh(cs[1], ti1)),
+		           _mm256_sub_epi32(MulHigh(cs[0], ti1), MulHigh(cs[1], tr1)));
+		StorePairsRev(buf1,
+		              _mm256_add_epi32(MulHigh(cs[2], tr2), MulHigh(cs[3], ti2)),
+		              _mm256_sub_epi32(MulHigh(cs[2], ti2), MulHigh(cs[3], tr2)));
+
+		csptr += 32;
+		buf0 += 16;
+		buf1 -= 16;
+	}
+}
+
+/*********************************************************************************
+*
+* function name: PostMDCT_AVX2
+* description:  PostMDCT(), eight rotations from each end at a time
+*
+**********************************************************************************/
+void PostMDCT_AVX2(int *buf0, int num, const int *csptr)
+{
+	int *buf1 = buf0 + num - 1;
+	__m256i tr1, ti1, tr2, ti2, cs[4];
+	int i;
+
+	for (i = num >> 5; i != 0; i--)
+	{
+		LoadRotations(csptr, cs);
+		LoadPairs(buf0, &tr1, &ti1);
+		LoadPairsRev(buf1, &tr2, &ti2);
+
+		StorePairs(buf0,
+		           _mm256_add_epi32(MulHigh(cs[0], tr1), MulHigh(cs[1], ti1)),
+		           _mm256_sub_epi32(MulHigh(cs[3], tr2), MulHigh(cs[2], ti2)));
+		StorePairsRev(buf1,
+		              _mm256_add_epi32(MulHigh(cs[2], tr2), MulHigh(cs[3], ti2)),
+		              _mm256_sub_epi32(MulHigh(cs[1], tr1), MulHigh(cs[0], ti1)));
+
+		csptr += 32;
+		buf0 += 16;
+		buf1 -= 16;
+	}
+}
+
+/* see CplxMul() in transform_sse2.c, four complex values */
+__inline __m256i CplxMul(__m256i x, __m256i cs)
+{
+	const __m256i negIm = _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+	__m256i p = MulHigh(_mm256_shuffle_epi32(cs, _MM_SHUFFLE(2, 2, 0, 0)), x);
+	__m256i q = MulHigh(_mm256_shuffle_epi32(cs, _MM_SHUFFLE(3, 3, 1, 1)),
+	                    _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm256_add_epi32(p, _mm256_sub_epi32(_mm256_xor_si256(q, negIm), negIm));
+}
+
+/* cos, sin pairs of four butterflies, six words apart */
+__inline __m256i LoadTwiddles(const int *csptr)
+{
+	__m128i lo = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)csptr),
+	                                _mm_loadl_epi64((const __m128i *)(csptr + 6)));
+	__m128i hi = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(csptr + 12)),
+	                                _mm_loadl_epi64((const __m128i *)(csptr + 18)));
+
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/*********************************************************************************
+*
+* function name: Radix4FFT_AVX2
+* description:  Radix4FFT(), four butterflies of a group at a time
+*
+**********************************************************************************/
+void Radix4FFT_AVX2(int *buf, int num, int bgn, int *twidTab)
+{
+	const __m256i negRe = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+	__m256i a, b, c, d, e, f, apb, amb;
+	int i, j, step;
+	int *xptr, *csptr;
+
+	for (num >>= 2; num != 0; num >>= 2)
+	{
+		step = 2*bgn;
+		xptr = buf;
+
+		for (i = num; i != 0; i--)
+		{
+			csptr = twidTab;
+
+			for (j = bgn; j != 0; j -= 4)
+			{
+				a = _mm256_srai_epi32(_mm256_loadu_si256((__m256i *)xptr), 2);
+				b = CplxMul(_mm256_loadu_si256((__m256i *)(xptr + step)), LoadTwiddles(csptr));
+				c = CplxMul(_mm256_loadu_si256((__m256i *)(xptr + 2*step)), LoadTwiddles(csptr + 2));
+				d = CplxMul(_mm256_loadu_si256((__m256i *)(xptr + 3*step)), LoadTwiddles(csptr + 4));
+				csptr += 24;
+
+				apb = _mm256_add_epi32(a, b);
+				amb = _mm256_sub_epi32(a, b);
+				f = _mm256_add_epi32(c, d);
+
+				/* e = -i * (c - d) */
+				e = _mm256_shuffle_epi32(_mm256_sub_epi32(c, d), _MM_SHUFFLE(2, 3, 0, 1));
+				e = _mm256_sub_epi32(_mm256_xor_si256(e, negRe), negRe);
+
+				_mm256_storeu_si256((__m256i *)xptr, _mm256_add_epi32(apb, f));
+				_mm256_storeu_si256((__m256i *)(xptr + step), _mm256_sub_epi32(amb, e));
+				_mm256_storeu_si256((__m256i *)(xptr + 2*step), _mm256_sub_epi32(apb, f));
+				_mm256_storeu_si256((__m256i *)(xptr + 3*step), _mm256_add_epi32(amb, e));
+				xptr += 8;
+			}
+			xptr += 3*step;
+		}
+		twidTab += 3*step;
+		bgn <<= 2;
+	}
+}
@@ -0,0 +1,220 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		transform_sse2.c
+
+	Content:	SSE2 versions of the MDCT pre/post rotation and the radix 4
+				FFT stages, same output as transform.c
+
+*******************************************************************************/
+
+#include <emmintrin.h>
+
+#include "typedef.h"
+#include "aacenc_x86.h"
+
+/* MULHIGH() on four lanes: the signed high word from the unsigned product */
+__inline __m128i MulHigh(__m128i a, __m128i b)
+{
+	const __m128i maskHi = _mm_set_epi32(-1, 0, -1, 0);
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	__m128i hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, maskHi));
+	__m128i corr = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+	                             _mm_and_si128(_mm_srai_epi32(b, 31), a));
+
+	return _mm_sub_epi32(hi, corr);
+}
+
+/* even and odd words of the eight at p */
+__inline void LoadPairs(const int *p, __m128i *even, __m128i *odd)
+{
+	__m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)p), _MM_SHUFFLE(3, 1, 2, 0));
+	__m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(p + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+
+	*even = _mm_unpacklo_epi64(a, b);
+	*odd = _mm_unpackhi_epi64(a, b);
+}
+
+__inline void StorePairs(int *p, __m128i even, __m128i odd)
+{
+	_mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi32(even, odd));
+	_mm_storeu_si128((__m128i *)(p + 4), _mm_unpackhi_epi32(even, odd));
+}
+
+/* the same for the eight words ending at p, walked backwards */
+__inline void LoadPairsRev(const int *p, __m128i *even, __m128i *odd)
+{
+	LoadPairs(p - 7, even, odd);
+	*even = _mm_shuffle_epi32(*even, _MM_SHUFFLE(0, 1, 2, 3));
+	*odd = _mm_shuffle_epi32(*odd, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+__inline void StorePairsRev(int *p, __m128i even, __m128i odd)
+{
+	StorePairs(p - 7, _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 1, 2, 3)),
+	           _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+/* cos a, sin a, cos b, sin b of four rotations */
+__inline void LoadRotations(const int *csptr, __m128i cs[4])
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i *)csptr);
+	__m128i r1 = _mm_loadu_si128((const __m128i *)(csptr + 4));
+	__m128i r2 = _mm_loadu_si128((const __m128i *)(csptr + 8));
+	__m128i r3 = _mm_loadu_si128((const __m128i *)(csptr + 12));
+	__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+	cs[0] = _mm_unpacklo_epi64(t0, t1);
+	cs[1] = _mm_unpackhi_epi64(t0, t1);
+	cs[2] = _mm_unpacklo_epi64(t2, t3);
+	cs[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+/*********************************************************************************
+*
+* function name: PreMDCT_SSE2
+* description:  PreMDCT(), four rotations from each end at a time
+*
+**********************************************************************************/
+void PreMDCT_SSE2(int *buf0, int num, const int *csptr)
+{
+	int *buf1 = buf0 + num - 1;
+	__m128i tr1, ti1, tr2, ti2, cs[4];
+	int i;
+
+	for (i = num >> 4; i != 0; i--)
+	{
+		LoadRotations(csptr, cs);
+		LoadPairs(buf0, &tr1, &ti2);
+		LoadPairsRev(buf1, &tr2, &ti1);
+
+		StorePairs(buf0,
+		           _mm_add_epi32(MulHigh(cs[0], tr1), MulHigh(cs[1], ti1)),
+		           _mm_sub_epi32(MulHigh(cs[0], ti1), MulHigh(cs[1], tr1)));
+		StorePairsRev(buf1,
+		              _mm_add_epi32(MulHigh(cs[2], tr2), MulHigh(cs[3], ti2)),
+		              _mm_sub_epi32(MulHigh(cs[2], ti2), MulHigh(cs[3], tr2)));
+
+		csptr += 16;
+		buf0 += 8;
+		buf1 -= 8;
+	}
+}
+
+/*********************************************************************************
+*
+* function name: PostMDCT_SSE2
+* description:  PostMDCT(), four rotations from each end at a time
+*
+**********************************************************************************/
+void PostMDCT_SSE2(int *buf0, int num, const int *csptr)
+{
+	int *buf1 = buf0 + num - 1;
+	__m128i tr1, ti1, tr2, ti2, cs[4];
+	int i;
+
+	for (i = num >> 4; i != 0; i--)
+	{
+		LoadRotations(csptr, cs);
+		LoadPairs(buf0, &tr1, &ti1);
+		LoadPairsRev(buf1, &tr2, &ti2);
+
+		StorePairs(buf0,
+		           _mm_add_epi32(MulHigh(cs[0], tr1), MulHigh(cs[1], ti1)),
+		           _mm_sub_epi32(MulHigh(cs[3], tr2), MulHigh(cs[2], ti2)));
+		StorePairsRev(buf1,
+		              _mm_add_epi32(MulHigh(cs[2], tr2), MulHigh(cs[3], ti2)),
+		              _mm_sub_epi32(MulHigh(cs[1], tr1), MulHigh(cs[0], ti1)));
+
+		csptr += 16;
+		buf0 += 8;
+		buf1 -= 8;
+	}
+}
+
+/* (x * conj(cos + i*sin)) on two interleaved complex values, cs holding the
+   cos, sin pairs of both */
+__inline __m128i CplxMul(__m128i x, __m128i cs)
+{
+	const __m128i negIm = _mm_set_epi32(-1, 0, -1, 0);
+	__m128i p = MulHigh(_mm_shuffle_epi32(cs, _MM_SHUFFLE(2, 2, 0, 0)), x);
+	__m128i q = MulHigh(_mm_shuffle_epi32(cs, _MM_SHUFFLE(3, 3, 1, 1)),
+	                    _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	/* re = cos*re + sin*im, im = cos*im - sin*re */
+	return _mm_add_epi32(p, _mm_sub_epi32(_mm_xor_si128(q, negIm), negIm));
+}
+
+/*********************************************************************************
+*
+* function name: Radix4FFT_SSE2
+* description:  Radix4FFT(), two butterflies of a group at a time
+*
+**********************************************************************************/
+void Radix4FFT_SSE2(int *buf, int num, int bgn, int *twidTab)
+{
+	const __m128i negRe = _mm_set_epi32(0, -1, 0, -1);
+	__m128i a, b, c, d, e, f, apb, amb;
+	int i, j, step;
+	int *xptr, *csptr;
+
+	for (num >>= 2; num != 0; num >>= 2)
+	{
+		step = 2*bgn;
+		xptr = buf;
+
+		for (i = num; i != 0; i--)
+		{
+			csptr = twidTab;
+
+			for (j = bgn; j != 0; j -= 2)
+			{
+				a = _mm_srai_epi32(_mm_loadu_si128((__m128i *)xptr), 2);
+				b = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i *)csptr),
+				                       _mm_loadl_epi64((__m128i *)(csptr + 6)));
+				b = CplxMul(_mm_loadu_si128((__m128i *)(xptr + step)), b);
+				c = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i *)(csptr + 2)),
+				                       _mm_loadl_epi64((__m128i *)(csptr + 8)));
+				c = CplxMul(_mm_loadu_si128((__m128i *)(xptr + 2*step)), c);
+				d = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i *)(csptr + 4)),
+				                       _mm_loadl_epi64((__m128i *)(csptr + 10)));
+				d = CplxMul(_mm_loadu_si128((__m128i *)(xptr + 3*step)), d);
+				csptr += 12;
+
+				apb = _mm_add_epi32(a, b);
+				amb = _mm_sub_epi32(a, b);
+				f = _mm_add_epi32(c, d);
+
+				/* e = -i * (c - d) */
+				e = _mm_shuffle_epi32(_mm_sub_epi32(c, d), _MM_SHUFFLE(2, 3, 0, 1));
+				e = _mm_sub_epi32(_mm_xor_si128(e, negRe), negRe);
+
+				_mm_storeu_si128((__m128i *)xptr, _mm_add_epi32(apb, f));
+				_mm_storeu_si128((__m128i *)(xptr + step), _mm_sub_epi32(amb, e));
+				_mm_storeu_si128((__m128i *)(xptr + 2*step), _mm_sub_epi32(apb, f));
+				_mm_storeu_si128((__m128i *)(xptr + 3*step), _mm_add_epi32(amb, e));
+				xptr += 4;
+			}
+			xptr += 3*step;
+		}
+		twidTab += 3*step;
+		bgn <<= 2;
+	}
+}
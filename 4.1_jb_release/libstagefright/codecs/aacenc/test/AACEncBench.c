@@ -0,0 +1,435 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/*******************************************************************************
+	File:		AACEncBench.c
+
+	Content:	checks the x86 transform, band energy, TNS and quantizer functions
+				against the C versions on random input, then encodes a test
+				signal with each function set through the voAACEnc API, the
+				way SoftAACEncoder does, and prints the realtime factor per
+				channel configuration. The bitstreams have to be identical.
+
+				SoftAACEncoder2, the OMX.google.aac.encoder built when
+				AAC_LIBRARY is fraunhofer, runs libFraunhoferAAC and none
+				of these functions, so this bench does not measure it.
+				codec_component_bench -e aac times whichever component is
+				installed.
+
+	Usage:		aacenc_bench [-s seconds] [-i input.pcm -c channels]
+
+*******************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "voAAC.h"
+#include "cmnMemory.h"
+#include "typedef.h"
+#include "basic_op.h"
+#include "aac_rom.h"
+#include "aacenc_x86.h"
+
+#define SAMPLE_RATE		44100
+#define FRAME_SAMPLES	1024
+#define OUT_SIZE		(8*1024)
+
+typedef struct {
+	const char *name;
+	const char *cpu;	/* STAGEFRIGHT_X86_CPU, NULL for no limit */
+#ifdef AACENC_X86
+	AACENC_X86_FUNCS funcs;
+#endif
+} FunctionSet;
+
+static FunctionSet sets[3];
+static int numSets;
+
+static unsigned int seed = 12345;
+
+static unsigned int Rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) | (seed << 16);
+}
+
+static double Now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void InitSets(void)
+{
+	static const char *names[3] = { "c", "sse2", "avx2" };
+	int i, j;
+
+	numSets = 0;
+	for (i = 0; i < 3; i++) {
+		FunctionSet *set = &sets[numSets];
+
+		set->name = names[i];
+		set->cpu = i < 2 ? names[i] : NULL;
+#ifdef AACENC_X86
+		if (set->cpu)
+			setenv("STAGEFRIGHT_X86_CPU", set->cpu, 1);
+		else
+			unsetenv("STAGEFRIGHT_X86_CPU");
+		GetX86Functions(&set->funcs);
+
+		/* skip the sets the CPU does not have */
+		for (j = 0; j < numSets; j++) {
+			if (!memcmp(&sets[j].funcs, &set->funcs, sizeof(set->funcs)))
+				break;
+		}
+		if (j < numSets)
+			continue;
+#else
+		if (i > 0)
+			break;
+		(void)j;
+#endif
+		numSets++;
+	}
+	unsetenv("STAGEFRIGHT_X86_CPU");
+}
+
+#ifdef AACENC_X86
+
+/* random spectral value, mostly small as after the MDCT of real audio */
+static Word32 RandSpec(void)
+{
+	unsigned int r = Rand();
+
+	switch (r & 15) {
+	case 0:
+		return 0;
+	case 1:
+		return (r & 16) ? MIN_32 : MAX_32;
+	default:
+		return (Word32)Rand() >> (r >> 27);
+	}
+}
+
+static int Compare(const char *what, const char *name, const void *a, const void *b,
+                   int size, int iter)
+{
+	if (!memcmp(a, b, size))
+		return 0;
+
+	printf("%s: %s differs from c at iteration %d\n", name, what, iter);
+	return 1;
+}
+
+/* checks the functions of set against the C versions */
+static int CheckSet(const FunctionSet *set, int iterations)
+{
+	static int ref[1024], buf[1024];
+	static Word16 qRef[1024], qBuf[1024];
+	Word32 eRef[2][64], eBuf[2][64], sRef[2], sBuf[2];
+	Word16 offset[65];
+	int i, n, k;
+
+	for (i = 0; i < iterations; i++) {
+		int lng = Rand() & 1;
+		int num = lng ? 1024 : 128;
+		const int *cs = lng ? cossintab + 128 : cossintab;
+		Word16 gain, width, numBands;
+
+		/* MDCT rotations and FFT */
+		for (n = 0; n < num; n++)
+			ref[n] = buf[n] = Rand();
+
+		PreMDCT(ref, num, cs);
+		set->funcs.PreMDCT(buf, num, cs);
+		if (Compare("PreMDCT", set->name, ref, buf, num * sizeof(int), i))
+			return 1;
+
+		if (lng) {
+			Radix4FFT(ref, 512 >> 3, 8, (int *)twidTab512);
+			set->funcs.Radix4FFT(buf, 512 >> 3, 8, (int *)twidTab512);
+		} else {
+			Radix4FFT(ref, 64 >> 2, 4, (int *)twidTab64);
+			set->funcs.Radix4FFT(buf, 64 >> 2, 4, (int *)twidTab64);
+		}
+		if (Compare("Radix4FFT", set->name, ref, buf, num * sizeof(int), i))
+			return 1;
+
+		PostMDCT(ref, num, cs);
+		set->funcs.PostMDCT(buf, num, cs);
+		if (Compare("PostMDCT", set->name, ref, buf, num * sizeof(int), i))
+			return 1;
+
+		/* band energies, on bands of any width */
+		for (n = 0; n < 1024; n++) {
+			ref[n] = RandSpec();
+			buf[n] = RandSpec();
+		}
+		memset(eRef, 0, sizeof(eRef));
+		memset(eBuf, 0, sizeof(eBuf));
+		numBands = 1 + Rand() % 64;
+		offset[0] = Rand() % 16;
+		for (n = 0; n < numBands; n++)
+			offset[n + 1] = offset[n] + Rand() % 16;
+
+		CalcBandEnergy(ref, offset, numBands, eRef[0], sRef);
+		set->funcs.CalcBandEnergy(ref, offset, numBands, eBuf[0], sBuf);
+		if (Compare("CalcBandEnergy", set->name, eRef[0], eBuf[0], numBands * sizeof(Word32), i)
+				|| Compare("CalcBandEnergy sum", set->name, sRef, sBuf, sizeof(Word32), i))
+			return 1;
+
+		CalcBandEnergyMS(ref, buf, offset, numBands, eRef[0], &sRef[0], eRef[1], &sRef[1]);
+		set->funcs.CalcBandEnergyMS(ref, buf, offset, numBands, eBuf[0], &sBuf[0],
+		                            eBuf[1], &sBuf[1]);
+		if (Compare("CalcBandEnergyMS", set->name, eRef, eBuf, sizeof(eRef), i)
+				|| Compare("CalcBandEnergyMS sum", set->name, sRef, sBuf, sizeof(sRef), i))
+			return 1;
+
+		/* TNS autocorrelation, now and then of a full scale signal */
+		width = 1 + Rand() % 1024;
+		k = Rand() % 16;
+		for (n = 0; n < width; n++)
+			qRef[n] = k ? (Word16)Rand() >> (k - 1) : -32768;
+		memset(eRef, 0, sizeof(eRef));
+		memset(eBuf, 0, sizeof(eBuf));
+		numBands = 1 + Rand() % 16;
+
+		AutoCorrelation(qRef, eRef[0], width, numBands);
+		set->funcs.AutoCorrelation(qRef, eBuf[0], width, numBands);
+		if (Compare("AutoCorrelation", set->name, eRef, eBuf, sizeof(eRef), i))
+			return 1;
+
+		/* quantizer and distortion, gains around those of the bands */
+		gain = (Word16)(Rand() % 200) - 100;
+		width = Rand() % 97;
+		k = Rand() % 32;
+		for (n = 0; n < width; n++)
+			ref[n] = (Rand() & 3) ? (Word32)Rand() >> k : RandSpec();
+
+		quantizeLines(gain, width, ref, qRef);
+		set->funcs.quantizeLines(gain, width, ref, qBuf);
+		if (Compare("quantizeLines", set->name, qRef, qBuf, width * sizeof(Word16), i))
+			return 1;
+
+		sRef[0] = calcSfbDist(ref, width, gain);
+		sBuf[0] = set->funcs.calcSfbDist(ref, width, gain);
+		if (Compare("calcSfbDist", set->name, sRef, sBuf, sizeof(Word32), i))
+			return 1;
+	}
+
+	return 0;
+}
+
+#endif /* AACENC_X86 */
+
+/* a few tones, noise and clicks, so both block types are used */
+static short *MakeSignal(int samples, int channels)
+{
+	short *pcm = (short *)malloc(samples * channels * sizeof(short));
+	int i, ch;
+
+	seed = 12345;
+
+	for (i = 0; i < samples; i++) {
+		double t = (double)i / SAMPLE_RATE;
+
+		for (ch = 0; ch < channels; ch++) {
+			double x = 0.3 * sin(2 * M_PI * (220 + 110 * ch) * t)
+			         + 0.2 * sin(2 * M_PI * (1000 + 500 * sin(t)) * t)
+			         + 0.05 * ((int)(Rand() & 0xffff) - 0x8000) / 32768.0;
+
+			if ((i % 20000) < 200)
+				x += 0.4 * ((int)(Rand() & 0xffff) - 0x8000) / 32768.0;
+			pcm[i * channels + ch] = (short)(x * 32767);
+		}
+	}
+
+	return pcm;
+}
+
+/* encodes the signal, returns the seconds taken and the FNV-1a hash of the
+   bitstream */
+static int Encode(const FunctionSet *set, const short *pcm, int samples, int channels,
+                  double *seconds, unsigned int *hash)
+{
+	VO_AUDIO_CODECAPI api;
+	VO_MEM_OPERATOR memOperator;
+	VO_CODEC_INIT_USERDATA userData;
+	VO_HANDLE handle;
+	AACENC_PARAM params;
+	VO_CODECBUFFER inputData, outputData;
+	VO_AUDIO_OUTPUTINFO outputInfo;
+	static unsigned char out[OUT_SIZE];
+	double start;
+	int frame, n;
+
+	if (voGetAACEncAPI(&api) != VO_ERR_NONE)
+		return 1;
+
+	memOperator.Alloc = cmnMemAlloc;
+	memOperator.Copy = cmnMemCopy;
+	memOperator.Free = cmnMemFree;
+	memOperator.Set = cmnMemSet;
+	memOperator.Check = cmnMemCheck;
+	userData.memflag = VO_IMF_USERMEMOPERATOR;
+	userData.memData = (VO_PTR)&memOperator;
+	if (api.Init(&handle, VO_AUDIO_CodingAAC, &userData) != VO_ERR_NONE)
+		return 1;
+
+#ifdef AACENC_X86
+	aacencX86Funcs = set->funcs;
+#else
+	(void)set;
+#endif
+
+	memset(&params, 0, sizeof(params));
+	params.sampleRate = SAMPLE_RATE;
+	params.bitRate = 64000 * channels;
+	params.nChannels = channels;
+	params.adtsUsed = 0;
+	if (api.SetParam(handle, VO_PID_AAC_ENCPARAM, &params) != VO_ERR_NONE)
+		return 1;
+
+	*hash = 2166136261u;
+	start = Now();
+
+	for (frame = 0; frame + FRAME_SAMPLES <= samples; frame += FRAME_SAMPLES) {
+		VO_U32 ret;
+
+		memset(&inputData, 0, sizeof(inputData));
+		inputData.Buffer = (unsigned char *)(pcm + frame * channels);
+		inputData.Length = FRAME_SAMPLES * channels * sizeof(short);
+		if (api.SetInputData(handle, &inputData) != VO_ERR_NONE)
+			return 1;
+
+		do {
+			outputData.Buffer = out;
+			outputData.Length = OUT_SIZE;
+			ret = api.GetOutputData(handle, &outputData, &outputInfo);
+			if (ret == VO_ERR_NONE) {
+				for (n = 0; n < (int)outputData.Length; n++)
+					*hash = (*hash ^ out[n]) * 16777619u;
+			}
+		} while (ret != VO_ERR_INPUT_BUFFER_SMALL);
+	}
+
+	*seconds = Now() - start;
+	api.Uninit(handle);
+
+	return 0;
+}
+
+static short *ReadPCM(const char *path, int channels, int *samples)
+{
+	FILE *f = fopen(path, "rb");
+	short *pcm;
+	long size;
+
+	if (f == NULL)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	*samples = size / (channels * sizeof(short));
+	pcm = (short *)malloc(*samples * channels * sizeof(short) + 1);
+	*samples = fread(pcm, channels * sizeof(short), *samples, f);
+	fclose(f);
+
+	return pcm;
+}
+
+int main(int argc, char **argv)
+{
+	const char *input = NULL;
+	int inputChannels = 2;
+	int duration = 30;
+	int channels, i, failed = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			duration = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			input = argv[++i];
+		} else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+			inputChannels = atoi(argv[++i]);
+		} else {
+			printf("usage: %s [-s seconds] [-i input.pcm -c channels]\n"
+			       "  input: 16-bit native endian PCM at %d Hz\n", argv[0], SAMPLE_RATE);
+			return 1;
+		}
+	}
+
+	InitSets();
+
+#ifdef AACENC_X86
+	for (i = 0; i < numSets; i++) {
+		if (CheckSet(&sets[i], 20000)) {
+			failed = 1;
+		} else {
+			printf("%s: functions match c\n", sets[i].name);
+		}
+	}
+#endif
+
+	for (channels = 1; channels <= 2; channels++) {
+		unsigned int refHash = 0;
+		int samples = duration * SAMPLE_RATE;
+		short *pcm;
+
+		if (input != NULL) {
+			if (channels != inputChannels)
+				continue;
+			pcm = ReadPCM(input, channels, &samples);
+			if (pcm == NULL) {
+				printf("cannot read %s\n", input);
+				return 1;
+			}
+		} else {
+			pcm = MakeSignal(samples, channels);
+		}
+
+		for (i = 0; i < numSets; i++) {
+			double seconds;
+			unsigned int hash;
+
+			if (Encode(&sets[i], pcm, samples, channels, &seconds, &hash)) {
+				printf("%s: encoder error\n", sets[i].name);
+				return 1;
+			}
+
+			printf("%d channel(s), %s: %.1fx realtime, hash %08x\n",
+			       channels, sets[i].name,
+			       (double)samples / SAMPLE_RATE / seconds, hash);
+
+			if (i == 0) {
+				refHash = hash;
+			} else if (hash != refHash) {
+				printf("%s: bitstream differs from c\n", sets[i].name);
+				failed = 1;
+			}
+		}
+
+		free(pcm);
+	}
+
+	return failed;
+}
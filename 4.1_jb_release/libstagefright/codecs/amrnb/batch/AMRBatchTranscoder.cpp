@@ -0,0 +1,833 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AMRBatchTranscoder"
+#include <utils/Log.h>
+
+#include "AMRBatchTranscoder.h"
+
+#include "gsmamr_dec.h"
+#include "gsmamr_enc.h"
+#include "pvamrwbdecoder.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+
+static const size_t kNumSamplesPerFrameNB = 160;
+static const size_t kNumSamplesPerFrameWB = 320;
+static const int64_t kFrameDurationUs = 20000;
+
+static const char kMagicNB[] = "#!AMR\n";
+static const char kMagicWB[] = "#!AMR-WB\n";
+
+static const size_t kWAVHeaderSize = 44;
+
+// Header byte and the payload of a 12.2 kbps frame.
+static const size_t kMaxEncodedFrameSize = 32;
+
+// Per frame latencies in 1us buckets, anything slower than 20ms is counted
+// in the last one (and still in the mean and the maximum).
+static const int64_t kLatencyBucketNs = 1000;
+static const size_t kNumLatencyBuckets = 20000;
+
+// 31 tap halfband lowpass at 4 kHz for going from AMR-WB to AMR-NB, Q15,
+// Hamming windowed. Every other tap is zero apart from the centre one, only
+// the taps at odd distances 1, 3, .. 15 from the centre are listed.
+static const int16_t kDecimatorCentre = 16412;
+static const int16_t kDecimatorTaps[8] = {
+    10342, -3176, 1609, -878, 462, -221, 96, -56
+};
+static const size_t kDecimatorHistory = 30;
+
+// Same as AMRExtractor, 0 for frame types not allowed in storage format.
+static size_t getFrameSize(bool isWide, unsigned FT) {
+    static const size_t kFrameSizeNB[16] = {
+        95, 103, 118, 134, 148, 159, 204, 244,
+        39, 43, 38, 37, // SID
+        0, 0, 0, // future use
+        0 // no data
+    };
+    static const size_t kFrameSizeWB[16] = {
+        132, 177, 253, 285, 317, 365, 397, 461, 477,
+        40, // SID
+        0, 0, 0, 0, // future use
+        0, // speech lost
+        0 // no data
+    };
+
+    if (FT > 15 || (isWide && FT > 9 && FT < 14) || (!isWide && FT > 11 && FT < 15)) {
+        return 0;
+    }
+
+    size_t frameSize = isWide ? kFrameSizeWB[FT] : kFrameSizeNB[FT];
+
+    // Round up bits to bytes and add 1 for the header byte.
+    return (frameSize + 7) / 8 + 1;
+}
+
+static void writeU16(uint8_t *p, uint16_t x) {
+    p[0] = x & 0xff;
+    p[1] = x >> 8;
+}
+
+static void writeU32(uint8_t *p, uint32_t x) {
+    writeU16(p, x & 0xffff);
+    writeU16(p + 2, x >> 16);
+}
+
+static void writeWAVHeader(uint8_t *p, uint32_t sampleRate, uint32_t dataSize) {
+    memcpy(p, "RIFF", 4);
+    writeU32(p + 4, 36 + dataSize);
+    memcpy(p + 8, "WAVEfmt ", 8);
+    writeU32(p + 16, 16);
+    writeU16(p + 20, 1);                // PCM
+    writeU16(p + 22, 1);                // mono
+    writeU32(p + 24, sampleRate);
+    writeU32(p + 28, sampleRate * sizeof(int16_t));
+    writeU16(p + 32, sizeof(int16_t));
+    writeU16(p + 34, 16);
+    memcpy(p + 36, "data", 4);
+    writeU32(p + 40, dataSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+AMRBatchTranscoder::Params::Params()
+    : mNumThreads(0),
+      mOutputFormat(OUTPUT_WAV),
+      mEncoderMode(MR122),
+      mDTX(false),
+      mReuseStates(true) {
+}
+
+AMRBatchTranscoder::Job::Job()
+    : mStatus(OK),
+      mWideband(false),
+      mNumFrames(0),
+      mOutputSize(0) {
+}
+
+AMRBatchTranscoder::Stats::Stats()
+    : mNumStreams(0),
+      mNumFailed(0),
+      mNumFrames(0),
+      mNumStatesCreated(0),
+      mWallTimeUs(0),
+      mAudioTimeUs(0),
+      mFrameLatencyMeanNs(0),
+      mFrameLatencyP50Ns(0),
+      mFrameLatencyP99Ns(0),
+      mFrameLatencyMaxNs(0) {
+}
+
+double AMRBatchTranscoder::Stats::channelsPerSecond() const {
+    if (mWallTimeUs <= 0) {
+        return 0.0;
+    }
+
+    return mNumStreams * 1E6 / mWallTimeUs;
+}
+
+double AMRBatchTranscoder::Stats::realtimeFactor() const {
+    if (mWallTimeUs <= 0) {
+        return 0.0;
+    }
+
+    return (double)mAudioTimeUs / mWallTimeUs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct AMRBatchTranscoder::Histogram {
+    Histogram();
+
+    void add(int64_t ns);
+    void merge(const Histogram &other);
+
+    // Upper edge of the bucket holding the given fraction of the samples.
+    int64_t percentile(double fraction) const;
+
+    uint32_t mBuckets[kNumLatencyBuckets];
+    uint64_t mCount;
+    int64_t mSumNs;
+    int64_t mMaxNs;
+};
+
+AMRBatchTranscoder::Histogram::Histogram()
+    : mCount(0),
+      mSumNs(0),
+      mMaxNs(0) {
+    memset(mBuckets, 0, sizeof(mBuckets));
+}
+
+void AMRBatchTranscoder::Histogram::add(int64_t ns) {
+    size_t bucket = ns / kLatencyBucketNs;
+    if (bucket >= kNumLatencyBuckets) {
+        bucket = kNumLatencyBuckets - 1;
+    }
+
+    ++mBuckets[bucket];
+    ++mCount;
+    mSumNs += ns;
+
+    if (ns > mMaxNs) {
+        mMaxNs = ns;
+    }
+}
+
+void AMRBatchTranscoder::Histogram::merge(const Histogram &other) {
+    for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+        mBuckets[i] += other.mBuckets[i];
+    }
+
+    mCount += other.mCount;
+    mSumNs += other.mSumNs;
+
+    if (other.mMaxNs > mMaxNs) {
+        mMaxNs = other.mMaxNs;
+    }
+}
+
+int64_t AMRBatchTranscoder::Histogram::percentile(double fraction) const {
+    if (mCount == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)(fraction * mCount + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumLatencyBuckets; ++i) {
+        seen += mBuckets[i];
+
+        if (seen >= target) {
+            int64_t edge = (i + 1) * kLatencyBucketNs;
+            return edge < mMaxNs ? edge : mMaxNs;
+        }
+    }
+
+    return mMaxNs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The decoders and the encoder one stream needs, created the first time a
+// stream asks for them. prepare() puts them back into their home state.
+struct AMRBatchTranscoder::CodecState {
+    CodecState(bool dtx);
+    ~CodecState();
+
+    status_t prepare(bool wideband, bool encode);
+
+    status_t decodeFrame(bool wideband, const uint8_t *frame, int16_t *pcm);
+    void decimate(const int16_t *in, int16_t *out);
+
+    status_t reserveOutput(size_t size);
+
+    bool mDTX;
+
+    void *mNBDecoder;
+
+    void *mWBDecoderBuf;
+    void *mWBDecoder;
+    int16_t *mWBDecoderCookie;
+    int16_t mWBInputBuffer[477];
+
+    void *mNBEncoder;
+    void *mSidSync;
+
+    int16_t mDecimatorBuffer[kDecimatorHistory + kNumSamplesPerFrameWB];
+
+    uint8_t *mOutput;
+    size_t mOutputSize;
+    size_t mOutputCapacity;
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(CodecState);
+};
+
+AMRBatchTranscoder::CodecState::CodecState(bool dtx)
+    : mDTX(dtx),
+      mNBDecoder(NULL),
+      mWBDecoderBuf(NULL),
+      mWBDecoder(NULL),
+      mWBDecoderCookie(NULL),
+      mNBEncoder(NULL),
+      mSidSync(NULL),
+      mOutput(NULL),
+      mOutputSize(0),
+      mOutputCapacity(0) {
+}
+
+AMRBatchTranscoder::CodecState::~CodecState() {
+    if (mNBDecoder != NULL) {
+        GSMDecodeFrameExit(&mNBDecoder);
+        mNBDecoder = NULL;
+    }
+
+    free(mWBDecoderBuf);
+    mWBDecoderBuf = NULL;
+    mWBDecoder = NULL;
+    mWBDecoderCookie = NULL;
+
+    if (mNBEncoder != NULL) {
+        AMREncodeExit(&mNBEncoder, &mSidSync);
+        mNBEncoder = NULL;
+        mSidSync = NULL;
+    }
+
+    free(mOutput);
+    mOutput = NULL;
+}
+
+status_t AMRBatchTranscoder::CodecState::prepare(bool wideband, bool encode) {
+    if (!wideband) {
+        if (mNBDecoder == NULL) {
+            if (GSMInitDecode(&mNBDecoder, (Word8 *)"AMRNBDecoder") != 0) {
+                mNBDecoder = NULL;
+                return NO_MEMORY;
+            }
+        } else {
+            Speech_Decode_Frame_reset(mNBDecoder);
+        }
+    } else {
+        if (mWBDecoderBuf == NULL) {
+            mWBDecoderBuf = malloc(pvDecoder_AmrWbMemRequirements());
+            if (mWBDecoderBuf == NULL) {
+                return NO_MEMORY;
+            }
+
+            pvDecoder_AmrWb_Init(&mWBDecoder, mWBDecoderBuf, &mWBDecoderCookie);
+        } else {
+            pvDecoder_AmrWb_Reset(mWBDecoder, 1 /* reset_all */);
+        }
+
+        memset(mDecimatorBuffer, 0, sizeof(mDecimatorBuffer));
+    }
+
+    if (encode) {
+        if (mNBEncoder == NULL) {
+            if (AMREncodeInit(&mNBEncoder, &mSidSync, mDTX) != 0) {
+                mNBEncoder = NULL;
+                mSidSync = NULL;
+                return NO_MEMORY;
+            }
+        } else if (AMREncodeReset(mNBEncoder, mSidSync) != 0) {
+            return UNKNOWN_ERROR;
+        }
+    }
+
+    mOutputSize = 0;
+
+    return OK;
+}
+
+status_t AMRBatchTranscoder::CodecState::decodeFrame(
+        bool wideband, const uint8_t *frame, int16_t *pcm) {
+    if (!wideband) {
+        int32_t numBytesRead =
+            AMRDecode(mNBDecoder,
+                      (Frame_Type_3GPP)((frame[0] >> 3) & 0x0f),
+                      (UWord8 *)&frame[1],
+                      pcm,
+                      MIME_IETF);
+
+        if (numBytesRead == -1) {
+            return ERROR_MALFORMED;
+        }
+
+        return OK;
+    }
+
+    int16 mode = (frame[0] >> 3) & 0x0f;
+
+    if (mode >= 9) {
+        // Produce silence instead of comfort noise and for
+        // speech lost/no data, as SoftAMR does.
+        memset(pcm, 0, kNumSamplesPerFrameWB * sizeof(int16_t));
+        return OK;
+    }
+
+    int16 frameType;
+    RX_State_wb rx_state;
+    mime_unsorting(
+            const_cast<uint8_t *>(&frame[1]),
+            mWBInputBuffer,
+            &frameType, &mode, 1, &rx_state);
+
+    int16_t numSamplesOutput;
+    pvDecoder_AmrWb(
+            mode, mWBInputBuffer,
+            pcm,
+            &numSamplesOutput,
+            mWBDecoderBuf, frameType, mWBDecoderCookie);
+
+    if ((size_t)numSamplesOutput != kNumSamplesPerFrameWB) {
+        return ERROR_MALFORMED;
+    }
+
+    for (size_t i = 0; i < kNumSamplesPerFrameWB; ++i) {
+        /* Delete the 2 LSBs (14-bit output) */
+        pcm[i] &= 0xfffC;
+    }
+
+    return OK;
+}
+
+// 16 kHz in, 8 kHz out. mDecimatorBuffer keeps the last kDecimatorHistory
+// input samples of the stream in front of the new frame.
+void AMRBatchTranscoder::CodecState::decimate(const int16_t *in, int16_t *out) {
+    int16_t *buf = mDecimatorBuffer;
+
+    memcpy(&buf[kDecimatorHistory], in, kNumSamplesPerFrameWB * sizeof(int16_t));
+
+    for (size_t n = 0; n < kNumSamplesPerFrameNB; ++n) {
+        const int16_t *centre = &buf[2 * n + kDecimatorHistory / 2];
+
+        int32_t acc = (int32_t)kDecimatorCentre * centre[0] + 16384;
+        for (size_t j = 0; j < 8; ++j) {
+            size_t k = 2 * j + 1;
+            acc += (int32_t)kDecimatorTaps[j] * (centre[-(ssize_t)k] + centre[k]);
+        }
+
+        acc >>= 15;
+        if (acc > 32767) {
+            acc = 32767;
+        } else if (acc < -32768) {
+            acc = -32768;
+        }
+
+        out[n] = acc;
+    }
+
+    memmove(buf, &buf[kNumSamplesPerFrameWB], kDecimatorHistory * sizeof(int16_t));
+}
+
+status_t AMRBatchTranscoder::CodecState::reserveOutput(size_t size) {
+    if (mOutputSize + size <= mOutputCapacity) {
+        return OK;
+    }
+
+    size_t capacity = mOutputCapacity > 0 ? mOutputCapacity : 65536;
+    while (capacity < mOutputSize + size) {
+        capacity *= 2;
+    }
+
+    uint8_t *output = (uint8_t *)realloc(mOutput, capacity);
+    if (output == NULL) {
+        return NO_MEMORY;
+    }
+
+    mOutput = output;
+    mOutputCapacity = capacity;
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct AMRBatchTranscoder::Worker {
+    AMRBatchTranscoder *mOwner;
+    pthread_t mThread;
+    Histogram mLatency;
+    size_t mNumStreams;
+    size_t mNumFailed;
+    uint64_t mNumFrames;
+};
+
+AMRBatchTranscoder::AMRBatchTranscoder(const Params &params)
+    : mParams(params),
+      mNumStatesCreated(0),
+      mJobs(NULL),
+      mNextJob(0) {
+}
+
+AMRBatchTranscoder::~AMRBatchTranscoder() {
+    for (size_t i = 0; i < mFreeStates.size(); ++i) {
+        delete mFreeStates.itemAt(i);
+    }
+    mFreeStates.clear();
+}
+
+AMRBatchTranscoder::CodecState *AMRBatchTranscoder::acquireState() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (!mFreeStates.isEmpty()) {
+        CodecState *state = mFreeStates.itemAt(mFreeStates.size() - 1);
+        mFreeStates.removeAt(mFreeStates.size() - 1);
+        return state;
+    }
+
+    ++mNumStatesCreated;
+    return new CodecState(mParams.mDTX);
+}
+
+void AMRBatchTranscoder::releaseState(CodecState *state) {
+    if (!mParams.mReuseStates) {
+        delete state;
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mFreeStates.push(state);
+}
+
+// static
+void *AMRBatchTranscoder::ThreadWrapper(void *me) {
+    Worker *worker = static_cast<Worker *>(me);
+    worker->mOwner->workerLoop(worker);
+
+    return NULL;
+}
+
+void AMRBatchTranscoder::workerLoop(Worker *worker) {
+    for (;;) {
+        Job *job;
+
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            if (mNextJob >= mJobs->size()) {
+                break;
+            }
+
+            job = &mJobs->editItemAt(mNextJob++);
+        }
+
+        CodecState *state = acquireState();
+
+        job->mStatus = transcode(state, job, &worker->mLatency);
+
+        releaseState(state);
+
+        if (job->mStatus != OK) {
+            ALOGW("%s: error %d", job->mInputPath.c_str(), job->mStatus);
+            ++worker->mNumFailed;
+        }
+
+        ++worker->mNumStreams;
+        worker->mNumFrames += job->mNumFrames;
+    }
+}
+
+status_t AMRBatchTranscoder::run(Vector<Job> *jobs, Stats *stats) {
+    size_t numThreads = mParams.mNumThreads;
+    if (numThreads == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = numCPUs > 0 ? numCPUs : 1;
+    }
+    if (numThreads > jobs->size()) {
+        numThreads = jobs->size() > 0 ? jobs->size() : 1;
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mJobs = jobs;
+        mNextJob = 0;
+        mNumStatesCreated = 0;
+    }
+
+    Worker *workers = new Worker[numThreads];
+
+    int64_t startUs = systemTime() / 1000ll;
+
+    size_t numStarted = 0;
+    for (size_t i = 0; i < numThreads; ++i) {
+        Worker *worker = &workers[i];
+        worker->mOwner = this;
+        worker->mNumStreams = 0;
+        worker->mNumFailed = 0;
+        worker->mNumFrames = 0;
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+        int err = pthread_create(&worker->mThread, &attr, ThreadWrapper, worker);
+
+        pthread_attr_destroy(&attr);
+
+        if (err != 0) {
+            ALOGE("could not start worker thread (%d)", err);
+            break;
+        }
+
+        ++numStarted;
+    }
+
+    if (numStarted == 0) {
+        delete[] workers;
+
+        Mutex::Autolock autoLock(mLock);
+        mJobs = NULL;
+
+        return UNKNOWN_ERROR;
+    }
+
+    Histogram *latency = new Histogram;
+
+    Stats result;
+    for (size_t i = 0; i < numStarted; ++i) {
+        Worker *worker = &workers[i];
+
+        void *dummy;
+        pthread_join(worker->mThread, &dummy);
+
+        latency->merge(worker->mLatency);
+
+        result.mNumStreams += worker->mNumStreams;
+        result.mNumFailed += worker->mNumFailed;
+        result.mNumFrames += worker->mNumFrames;
+    }
+
+    result.mWallTimeUs = systemTime() / 1000ll - startUs;
+    result.mAudioTimeUs = result.mNumFrames * kFrameDurationUs;
+
+    if (latency->mCount > 0) {
+        result.mFrameLatencyMeanNs = latency->mSumNs / (int64_t)latency->mCount;
+    }
+    result.mFrameLatencyP50Ns = latency->percentile(0.5);
+    result.mFrameLatencyP99Ns = latency->percentile(0.99);
+    result.mFrameLatencyMaxNs = latency->mMaxNs;
+
+    delete latency;
+    latency = NULL;
+
+    delete[] workers;
+    workers = NULL;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        result.mNumStatesCreated = mNumStatesCreated;
+        mJobs = NULL;
+    }
+
+    if (stats != NULL) {
+        *stats = result;
+    }
+
+    return OK;
+}
+
+status_t AMRBatchTranscoder::transcode(
+        CodecState *state, Job *job, Histogram *latency) {
+    job->mWideband = false;
+    job->mNumFrames = 0;
+    job->mOutputSize = 0;
+
+    int fd = open(job->mInputPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        status_t err = -errno;
+        close(fd);
+        return err;
+    }
+
+    size_t size = st.st_size;
+    if (size < sizeof(kMagicNB) - 1) {
+        close(fd);
+        return ERROR_MALFORMED;
+    }
+
+    const uint8_t *data = (const uint8_t *)mmap(
+            NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+    fd = -1;
+
+    if (data == MAP_FAILED) {
+        return -errno;
+    }
+
+    madvise(const_cast<uint8_t *>(data), size, MADV_SEQUENTIAL);
+
+    size_t offset;
+    bool wideband;
+    if (size >= sizeof(kMagicWB) - 1
+            && !memcmp(data, kMagicWB, sizeof(kMagicWB) - 1)) {
+        wideband = true;
+        offset = sizeof(kMagicWB) - 1;
+    } else if (!memcmp(data, kMagicNB, sizeof(kMagicNB) - 1)) {
+        wideband = false;
+        offset = sizeof(kMagicNB) - 1;
+    } else {
+        munmap(const_cast<uint8_t *>(data), size);
+        return ERROR_UNSUPPORTED;
+    }
+
+    job->mWideband = wideband;
+
+    bool encode = mParams.mOutputFormat == OUTPUT_AMR_NB;
+
+    status_t err = state->prepare(wideband, encode);
+
+    if (err == OK) {
+        if (encode) {
+            err = state->reserveOutput(sizeof(kMagicNB) - 1);
+            if (err == OK) {
+                memcpy(state->mOutput, kMagicNB, sizeof(kMagicNB) - 1);
+                state->mOutputSize = sizeof(kMagicNB) - 1;
+            }
+        } else {
+            err = state->reserveOutput(kWAVHeaderSize);
+            if (err == OK) {
+                state->mOutputSize = kWAVHeaderSize;
+            }
+        }
+    }
+
+    size_t numSamplesPerFrame =
+        wideband ? kNumSamplesPerFrameWB : kNumSamplesPerFrameNB;
+
+    int16_t pcm[kNumSamplesPerFrameWB];
+    int16_t pcmNB[kNumSamplesPerFrameNB];
+
+    while (err == OK && offset < size) {
+        size_t frameSize = getFrameSize(wideband, (data[offset] >> 3) & 0x0f);
+        if (frameSize == 0) {
+            err = ERROR_MALFORMED;
+            break;
+        }
+
+        if (offset + frameSize > size) {
+            // Truncated last frame, the stream ends here.
+            ALOGV("%s: dropping %d trailing bytes",
+                  job->mInputPath.c_str(), (int)(size - offset));
+            break;
+        }
+
+        err = state->reserveOutput(
+                encode ? kMaxEncodedFrameSize
+                       : numSamplesPerFrame * sizeof(int16_t));
+        if (err != OK) {
+            break;
+        }
+
+        int64_t startNs = systemTime();
+
+        if (encode) {
+            err = state->decodeFrame(wideband, &data[offset], pcm);
+            if (err != OK) {
+                break;
+            }
+
+            int16_t *input = pcm;
+            if (wideband) {
+                state->decimate(pcm, pcmNB);
+                input = pcmNB;
+            }
+
+            uint8_t *out = &state->mOutput[state->mOutputSize];
+
+            Frame_Type_3GPP frameType;
+            int res = AMREncode(
+                    state->mNBEncoder, state->mSidSync,
+                    (Mode)mParams.mEncoderMode,
+                    input, out, &frameType, AMR_TX_WMF);
+
+            if (res < 0 || (size_t)res > kMaxEncodedFrameSize) {
+                err = UNKNOWN_ERROR;
+                break;
+            }
+
+            // Convert header byte from WMF to IETF format.
+            out[0] = ((out[0] << 3) | 4) & 0x7c;
+
+            state->mOutputSize += res;
+        } else {
+            int16_t *out = (int16_t *)&state->mOutput[state->mOutputSize];
+
+            err = state->decodeFrame(wideband, &data[offset], out);
+            if (err != OK) {
+                break;
+            }
+
+            state->mOutputSize += numSamplesPerFrame * sizeof(int16_t);
+        }
+
+        latency->add(systemTime() - startNs);
+
+        offset += frameSize;
+        ++job->mNumFrames;
+    }
+
+    munmap(const_cast<uint8_t *>(data), size);
+    data = NULL;
+
+    if (err != OK) {
+        return err;
+    }
+
+    if (!encode) {
+        writeWAVHeader(
+                state->mOutput,
+                wideband ? 16000 : 8000,
+                state->mOutputSize - kWAVHeaderSize);
+    }
+
+    job->mOutputSize = state->mOutputSize;
+
+    if (job->mOutputPath.empty()) {
+        return OK;
+    }
+
+    fd = open(job->mOutputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    size_t written = 0;
+    while (written < state->mOutputSize) {
+        ssize_t n = write(fd, &state->mOutput[written], state->mOutputSize - written);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            err = -errno;
+            break;
+        }
+
+        written += n;
+    }
+
+    if (close(fd) != 0 && err == OK) {
+        err = -errno;
+    }
+
+    return err;
+}
+
+}  // namespace android
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AMR_BATCH_TRANSCODER_H_
+
+#define AMR_BATCH_TRANSCODER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/Errors.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Transcodes many independent AMR-NB and AMR-WB files (RFC 4867 storage
+// format, "#!AMR\n" or "#!AMR-WB\n") on a set of worker threads. The
+// decoder and encoder states are pooled: a state is put back to its home
+// state between streams, as a 3GPP homing frame would, instead of being
+// freed and allocated again for every file.
+struct AMRBatchTranscoder {
+    enum OutputFormat {
+        // 16 bit mono WAV at the rate of the input, 8 or 16 kHz.
+        OUTPUT_WAV,
+        // AMR-NB storage format. AMR-WB input is decimated to 8 kHz.
+        OUTPUT_AMR_NB,
+    };
+
+    struct Params {
+        Params();
+
+        size_t mNumThreads;         // 0: one per online CPU
+        OutputFormat mOutputFormat;
+        int32_t mEncoderMode;       // MR475 .. MR122, for OUTPUT_AMR_NB
+        bool mDTX;
+        bool mReuseStates;          // false: new codec states for every file
+    };
+
+    struct Job {
+        Job();
+
+        AString mInputPath;
+        AString mOutputPath;        // empty: the output is only counted
+
+        // Filled in by run().
+        status_t mStatus;
+        bool mWideband;
+        size_t mNumFrames;
+        size_t mOutputSize;
+    };
+
+    struct Stats {
+        Stats();
+
+        size_t mNumStreams;
+        size_t mNumFailed;
+        uint64_t mNumFrames;
+        size_t mNumStatesCreated;   // codec states allocated by this run
+        int64_t mWallTimeUs;
+        int64_t mAudioTimeUs;
+
+        // Time spent decoding (and encoding) one frame, 1us resolution.
+        int64_t mFrameLatencyMeanNs;
+        int64_t mFrameLatencyP50Ns;
+        int64_t mFrameLatencyP99Ns;
+        int64_t mFrameLatencyMaxNs;
+
+        // Streams, each one mono channel, per second of wall time.
+        double channelsPerSecond() const;
+        double realtimeFactor() const;
+    };
+
+    explicit AMRBatchTranscoder(const Params &params);
+    ~AMRBatchTranscoder();
+
+    // Runs all jobs and returns once they are done. The result of each
+    // stream is in its Job; returns OK unless the workers could not be
+    // started. The codec states stay pooled from one call to the next.
+    status_t run(Vector<Job> *jobs, Stats *stats);
+
+private:
+    struct CodecState;
+    struct Histogram;
+    struct Worker;
+
+    Params mParams;
+
+    Mutex mLock;
+    Vector<CodecState *> mFreeStates;
+    size_t mNumStatesCreated;
+
+    // The batch being run.
+    Vector<Job> *mJobs;
+    size_t mNextJob;
+
+    static void *ThreadWrapper(void *me);
+    void workerLoop(Worker *worker);
+
+    CodecState *acquireState();
+    void releaseState(CodecState *state);
+
+    status_t transcode(CodecState *state, Job *job, Histogram *latency);
+
+    DISALLOW_EVIL_CONSTRUCTORS(AMRBatchTranscoder);
+};
+
+}  // namespace android
+
+#endif  // AMR_BATCH_TRANSCODER_H_
@@ -0,0 +1,50 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        AMRBatchTranscoder.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        frameworks/av/media/libstagefright/codecs/amrwb/src \
+        $(LOCAL_PATH)/../dec/src \
+        $(LOCAL_PATH)/../dec/include \
+        $(LOCAL_PATH)/../enc/src \
+        $(LOCAL_PATH)/../common/include \
+        $(LOCAL_PATH)/../common
+
+LOCAL_CFLAGS := -DOSCL_IMPORT_REF=
+
+LOCAL_MODULE := libstagefright_amr_batch
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+# test utility: transcodes a batch of files on several threads and times it
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/AMRBatchBench.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH) \
+        $(LOCAL_PATH)/../enc/src \
+        $(LOCAL_PATH)/../common/include \
+        $(LOCAL_PATH)/../common
+
+LOCAL_CFLAGS := -DOSCL_IMPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_amr_batch \
+        libstagefright_amrnbdec libstagefright_amrnbenc libstagefright_amrwbdec
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright_foundation libutils liblog \
+        libstagefright_amrnb_common
+
+LOCAL_MODULE := amr_batch_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
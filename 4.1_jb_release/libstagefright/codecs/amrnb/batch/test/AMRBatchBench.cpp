@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Writes a set of AMR-NB and AMR-WB files and transcodes them with
+ * AMRBatchTranscoder: once on one thread with new codec states for every
+ * file as the reference, then on more threads with pooled states. Every
+ * run has to produce the same bytes as the reference. Prints channels per
+ * second, how many times faster than realtime the batch runs and the per
+ * frame latency.
+ *
+ * Usage: amr_batch_bench [-d dir] [-n streams] [-s seconds] [-f wav|amrnb]
+ *                        [-j threads]
+ *
+ * The AMR-NB files are synthetic voiced speech (a glottal pulse train with
+ * a moving pitch through two formant resonators, with pauses) coded by the
+ * AMR-NB encoder in every mode, some of them with DTX. The AMR-WB files
+ * hold frames of every mode with random payload, SID and no data frames,
+ * which the decoder takes as it takes any other bit pattern.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AMRBatchTranscoder.h"
+
+#include "gsmamr_enc.h"
+
+using namespace android;
+
+static const size_t kNumSamplesPerFrameNB = 160;
+
+static uint32_t gSeed = 1;
+
+static uint32_t Rand() {
+    gSeed = gSeed * 1103515245 + 12345;
+    return gSeed >> 8;
+}
+
+static bool writeFile(const char *path, const uint8_t *data, size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, file) == size;
+
+    return fclose(file) == 0 && ok;
+}
+
+static uint8_t *readFile(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = (uint8_t *)malloc(*size + 1);
+    if (fread(data, 1, *size, file) != *size) {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+
+    return data;
+}
+
+// Two pole resonator at freq Hz with the given bandwidth, 8 kHz.
+struct Resonator {
+    double mA1, mA2, mY1, mY2;
+
+    void set(double freq, double bandwidth) {
+        double r = exp(-M_PI * bandwidth / 8000.0);
+        mA1 = 2.0 * r * cos(2.0 * M_PI * freq / 8000.0);
+        mA2 = -r * r;
+    }
+
+    double process(double x) {
+        double y = x + mA1 * mY1 + mA2 * mY2;
+        mY2 = mY1;
+        mY1 = y;
+        return y;
+    }
+};
+
+static bool writeNBFile(
+        const char *path, size_t numFrames, int mode, bool dtx) {
+    void *encoder;
+    void *sidSync;
+    if (AMREncodeInit(&encoder, &sidSync, dtx) != 0) {
+        return false;
+    }
+
+    uint8_t *data = (uint8_t *)malloc(6 + numFrames * 32);
+    size_t size = 6;
+    memcpy(data, "#!AMR\n", 6);
+
+    Resonator f1 = { 0, 0, 0, 0 };
+    Resonator f2 = { 0, 0, 0, 0 };
+
+    double phase = 0.0;
+    double pitch = 100.0 + Rand() % 120;
+    double gain = 0.0;
+    int16_t pcm[kNumSamplesPerFrameNB];
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        // Syllables of 200-400ms, a third of them silent.
+        if (i % 15 == 0) {
+            gain = (Rand() % 3 == 0) ? 0.0 : 2000.0 + Rand() % 4000;
+            f1.set(300 + Rand() % 500, 80);
+            f2.set(900 + Rand() % 1400, 120);
+        }
+
+        pitch += ((int)(Rand() % 21) - 10) * 0.5;
+        if (pitch < 80) {
+            pitch = 80;
+        } else if (pitch > 300) {
+            pitch = 300;
+        }
+
+        for (size_t n = 0; n < kNumSamplesPerFrameNB; ++n) {
+            phase += pitch / 8000.0;
+
+            double excitation = ((int)(Rand() % 201) - 100) * 0.02;
+            if (phase >= 1.0) {
+                phase -= 1.0;
+                excitation += 40.0;
+            }
+
+            double y = f2.process(f1.process(excitation * gain / 40.0)) * 0.05;
+            if (y > 32767) {
+                y = 32767;
+            } else if (y < -32768) {
+                y = -32768;
+            }
+
+            pcm[n] = (int16_t)y & 0xfff8;   // 13 bit input, as from a codec
+        }
+
+        Frame_Type_3GPP frameType;
+        int res = AMREncode(
+                encoder, sidSync, (Mode)mode,
+                pcm, &data[size], &frameType, AMR_TX_WMF);
+
+        if (res < 0) {
+            free(data);
+            AMREncodeExit(&encoder, &sidSync);
+            return false;
+        }
+
+        // Convert header byte from WMF to IETF format.
+        data[size] = ((data[size] << 3) | 4) & 0x7c;
+        size += res;
+    }
+
+    AMREncodeExit(&encoder, &sidSync);
+
+    bool ok = writeFile(path, data, size);
+    free(data);
+
+    return ok;
+}
+
+static bool writeWBFile(const char *path, size_t numFrames) {
+    static const size_t kFrameSizeWB[10] = {
+        132, 177, 253, 285, 317, 365, 397, 461, 477, 40
+    };
+
+    uint8_t *data = (uint8_t *)malloc(9 + numFrames * 61);
+    size_t size = 9;
+    memcpy(data, "#!AMR-WB\n", 9);
+
+    unsigned mode = Rand() % 9;
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        if (i % 50 == 0) {
+            mode = Rand() % 9;
+        }
+
+        unsigned FT = mode;
+        uint32_t r = Rand() % 100;
+        if (r < 3) {
+            FT = 9;     // SID
+        } else if (r < 5) {
+            FT = 15;    // no data
+        }
+
+        data[size++] = (FT << 3) | 4;
+
+        if (FT < 10) {
+            size_t numBytes = (kFrameSizeWB[FT] + 7) / 8;
+            for (size_t k = 0; k < numBytes; ++k) {
+                data[size++] = Rand() & 0xff;
+            }
+        }
+    }
+
+    bool ok = writeFile(path, data, size);
+    free(data);
+
+    return ok;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-d dir] [-n streams] [-s seconds] [-f wav|amrnb] "
+            "[-j threads]\n", me);
+    exit(1);
+}
+
+static bool runBatch(
+        const char *dir, size_t numStreams,
+        const AMRBatchTranscoder::Params &params, const char *outputPrefix,
+        int runs) {
+    AMRBatchTranscoder transcoder(params);
+
+    for (int run = 0; run < runs; ++run) {
+        Vector<AMRBatchTranscoder::Job> jobs;
+        for (size_t i = 0; i < numStreams; ++i) {
+            AMRBatchTranscoder::Job job;
+            job.mInputPath = StringPrintf("%s/in_%03d.amr", dir, (int)i);
+            job.mOutputPath =
+                StringPrintf("%s/%s_%03d.out", dir, outputPrefix, (int)i);
+            jobs.push(job);
+        }
+
+        AMRBatchTranscoder::Stats stats;
+        if (transcoder.run(&jobs, &stats) != OK) {
+            fprintf(stderr, "run failed\n");
+            return false;
+        }
+
+        printf("%3d threads %-6s %3d states  %8.1f channels/s  %7.1fx realtime"
+               "  frame p50 %4lld us  p99 %4lld us  max %5lld us  mean %4lld us\n",
+               (int)params.mNumThreads,
+               params.mReuseStates ? "pooled" : "new",
+               (int)stats.mNumStatesCreated,
+               stats.channelsPerSecond(),
+               stats.realtimeFactor(),
+               (long long)(stats.mFrameLatencyP50Ns / 1000),
+               (long long)(stats.mFrameLatencyP99Ns / 1000),
+               (long long)(stats.mFrameLatencyMaxNs / 1000),
+               (long long)(stats.mFrameLatencyMeanNs / 1000));
+
+        if (stats.mNumFailed > 0) {
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                if (jobs[i].mStatus != OK) {
+                    fprintf(stderr, "%s: error %d\n",
+                            jobs[i].mInputPath.c_str(), jobs[i].mStatus);
+                }
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool compareOutputs(
+        const char *dir, size_t numStreams, const char *prefix) {
+    bool ok = true;
+
+    for (size_t i = 0; i < numStreams; ++i) {
+        AString refPath = StringPrintf("%s/ref_%03d.out", dir, (int)i);
+        AString path = StringPrintf("%s/%s_%03d.out", dir, prefix, (int)i);
+
+        size_t refSize, size;
+        uint8_t *ref = readFile(refPath.c_str(), &refSize);
+        uint8_t *data = readFile(path.c_str(), &size);
+
+        if (ref == NULL || data == NULL || refSize != size
+                || memcmp(ref, data, size)) {
+            fprintf(stderr, "%s differs from %s\n",
+                    path.c_str(), refPath.c_str());
+            ok = false;
+        }
+
+        free(ref);
+        free(data);
+    }
+
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *dir = "/data/local/tmp/amr_batch";
+    size_t numStreams = 64;
+    size_t seconds = 10;
+    size_t maxThreads = 0;
+    AMRBatchTranscoder::OutputFormat format = AMRBatchTranscoder::OUTPUT_WAV;
+
+    int res;
+    while ((res = getopt(argc, argv, "d:n:s:f:j:h")) >= 0) {
+        switch (res) {
+            case 'd':
+                dir = optarg;
+                break;
+            case 'n':
+                numStreams = atoi(optarg);
+                break;
+            case 's':
+                seconds = atoi(optarg);
+                break;
+            case 'f':
+                if (!strcmp(optarg, "wav")) {
+                    format = AMRBatchTranscoder::OUTPUT_WAV;
+                } else if (!strcmp(optarg, "amrnb")) {
+                    format = AMRBatchTranscoder::OUTPUT_AMR_NB;
+                } else {
+                    usage(argv[0]);
+                }
+                break;
+            case 'j':
+                maxThreads = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                break;
+        }
+    }
+
+    if (numStreams == 0 || seconds == 0) {
+        usage(argv[0]);
+    }
+
+    if (maxThreads == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = numCPUs > 0 ? numCPUs : 1;
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "cannot create %s\n", dir);
+        return 1;
+    }
+
+    size_t numFrames = seconds * 50;
+    for (size_t i = 0; i < numStreams; ++i) {
+        AString path = StringPrintf("%s/in_%03d.amr", dir, (int)i);
+
+        bool ok;
+        if (i % 2 == 0) {
+            // Each of the 8 modes, with and without DTX.
+            ok = writeNBFile(path.c_str(), numFrames, (i / 2) % 8, (i / 2) % 16 >= 8);
+        } else {
+            ok = writeWBFile(path.c_str(), numFrames);
+        }
+
+        if (!ok) {
+            fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    printf("%d streams of %d s, half AMR-NB and half AMR-WB, to %s\n",
+           (int)numStreams, (int)seconds,
+           format == AMRBatchTranscoder::OUTPUT_WAV ? "WAV" : "AMR-NB 12.2");
+
+    AMRBatchTranscoder::Params params;
+    params.mOutputFormat = format;
+    params.mNumThreads = 1;
+    params.mReuseStates = false;
+
+    if (!runBatch(dir, numStreams, params, "ref", 1)) {
+        return 1;
+    }
+
+    bool ok = true;
+    params.mReuseStates = true;
+
+    for (size_t numThreads = 1;; numThreads *= 2) {
+        if (numThreads > maxThreads) {
+            numThreads = maxThreads;
+        }
+
+        params.mNumThreads = numThreads;
+
+        // The second run starts with the states of the first one.
+        if (!runBatch(dir, numStreams, params, "out", 2)) {
+            return 1;
+        }
+
+        if (!compareOutputs(dir, numStreams, "out")) {
+            ok = false;
+        }
+
+        if (numThreads == maxThreads) {
+            break;
+        }
+    }
+
+    printf("%s\n", ok ? "outputs identical" : "OUTPUTS DIFFER");
+
+    return ok ? 0 : 1;
+}
@@ -114,8 +114,95 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/src/asm/ARMV5E
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/src/asm/ARMV7
 endif
 
+# x86: SSE4.1 and AVX2 versions of Convolve, cor_h_x, Syn_filt, Residu,
+# Filt_6k_7k, Pred_lt4 and Norm_Corr, picked at run time. They are in
+# libstagefright_amrwbenc_sse41 and libstagefright_amrwbenc_avx2 below,
+# which have to be linked along with this library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+	src/amrwbenc_x86.c
+
+LOCAL_CFLAGS += -DAMRWBENC_X86
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../common/include
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	src/convolve_sse41.c \
+	src/filt_sse41.c
+
+LOCAL_MODULE := libstagefright_amrwbenc_sse41
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codecs/common/include \
+	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/inc
+
+LOCAL_CFLAGS := $(VO_CFLAGS) -DAMRWBENC_X86 -msse4.1
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	src/convolve_avx2.c \
+	src/filt_avx2.c
+
+LOCAL_MODULE := libstagefright_amrwbenc_avx2
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codecs/common/include \
+	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/inc
+
+LOCAL_CFLAGS := $(VO_CFLAGS) -DAMRWBENC_X86 -mavx2
+
 include $(BUILD_STATIC_LIBRARY)
 
+endif
+
+################################################################################
+# test utility: checks the x86 functions and times the encoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	test/AMRWBEncBench.c
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codecs/common/include \
+	$(LOCAL_PATH)/src \
+	$(LOCAL_PATH)/inc
+
+LOCAL_CFLAGS := $(VO_CFLAGS)
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_amrwbenc
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright_enc_common
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DAMRWBENC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_amrwbenc_sse41 \
+	libstagefright_amrwbenc_avx2 \
+	libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := amrwbenc_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -131,6 +218,12 @@ LOCAL_C_INCLUDES := \
 LOCAL_STATIC_LIBRARIES := \
         libstagefright_amrwbenc
 
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_amrwbenc_sse41 \
+        libstagefright_amrwbenc_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_SHARED_LIBRARIES := \
         libstagefright_omx libstagefright_foundation libutils \
         libstagefright_enc_common
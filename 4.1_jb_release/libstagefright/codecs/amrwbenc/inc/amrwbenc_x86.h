@@ -0,0 +1,89 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: amrwbenc_x86.h                                           *
+*                                                                      *
+*       Description: x86 SSE4.1/AVX2 versions of the filters and       *
+*                    correlations, picked at run time                  *
+*                                                                      *
+************************************************************************/
+
+#ifndef __AMRWBENC_X86_H__
+#define __AMRWBENC_X86_H__
+
+#include "typedef.h"
+
+#ifdef AMRWBENC_X86
+
+/* the C versions are exported when the x86 functions may replace them */
+#define X86_STATIC
+
+typedef struct {
+	void (*Convolve)(Word16 x[], Word16 h[], Word16 y[], Word16 L);
+	void (*cor_h_x)(Word16 h[], Word16 x[], Word16 dn[]);
+	void (*Syn_filt)(Word16 a[], Word16 x[], Word16 y[], Word16 lg,
+	                 Word16 mem[], Word16 update);
+	void (*Residu)(Word16 a[], Word16 x[], Word16 y[], Word16 lg);
+	void (*Filt_6k_7k)(Word16 signal[], Word16 lg, Word16 mem[]);
+	void (*Pred_lt4)(Word16 exc[], Word16 T0, Word16 frac, Word16 L_subfr);
+	void (*Norm_Corr)(Word16 exc[], Word16 xn[], Word16 h[], Word16 L_subfr,
+	                  Word16 t_min, Word16 t_max, Word16 corr_norm[]);
+} AMRWBENC_X86_FUNCS;
+
+/* the functions in use, the C versions until InitX86Functions() */
+extern AMRWBENC_X86_FUNCS amrwbencX86Funcs;
+
+/*
+ * Fill funcs with the SSE4.1 or AVX2 functions the CPU supports, as reported
+ * by x86_cpu_get_features().
+ */
+void GetX86Functions(AMRWBENC_X86_FUNCS *funcs);
+
+/* sets amrwbencX86Funcs on the first call, from voAMRWB_Init() */
+void InitX86Functions(void);
+
+#define X86_FUNC(name)	(*amrwbencX86Funcs.name)
+
+/* C versions not in acelp.h, pitch_f4.c */
+void Norm_Corr(Word16 exc[], Word16 xn[], Word16 h[], Word16 L_subfr,
+               Word16 t_min, Word16 t_max, Word16 corr_norm[]);
+
+/* convolve_sse41.c and filt_sse41.c, in libstagefright_amrwbenc_sse41 */
+void Convolve_SSE41(Word16 x[], Word16 h[], Word16 y[], Word16 L);
+void cor_h_x_SSE41(Word16 h[], Word16 x[], Word16 dn[]);
+void Norm_Corr_SSE41(Word16 exc[], Word16 xn[], Word16 h[], Word16 L_subfr,
+                     Word16 t_min, Word16 t_max, Word16 corr_norm[]);
+void Syn_filt_SSE41(Word16 a[], Word16 x[], Word16 y[], Word16 lg,
+                    Word16 mem[], Word16 update);
+void Residu_SSE41(Word16 a[], Word16 x[], Word16 y[], Word16 lg);
+void Filt_6k_7k_SSE41(Word16 signal[], Word16 lg, Word16 mem[]);
+void Pred_lt4_SSE41(Word16 exc[], Word16 T0, Word16 frac, Word16 L_subfr);
+
+/* convolve_avx2.c and filt_avx2.c, in libstagefright_amrwbenc_avx2 */
+void Convolve_AVX2(Word16 x[], Word16 h[], Word16 y[], Word16 L);
+void cor_h_x_AVX2(Word16 h[], Word16 x[], Word16 dn[]);
+void Residu_AVX2(Word16 a[], Word16 x[], Word16 y[], Word16 lg);
+void Filt_6k_7k_AVX2(Word16 signal[], Word16 lg, Word16 mem[]);
+void Pred_lt4_AVX2(Word16 exc[], Word16 T0, Word16 frac, Word16 L_subfr);
+
+#else
+
+#define X86_STATIC	static
+#define X86_FUNC(name)	name
+
+#endif
+
+#endif /* __AMRWBENC_X86_H__ */
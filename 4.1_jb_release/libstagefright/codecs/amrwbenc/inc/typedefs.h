@@ -205,6 +205,9 @@ typedef int Bool;
 #define     Dot_product12    voAWB_Dot_product12
 #define     mem_malloc       voAWB_mem_malloc
 #define     mem_free         voAWB_mem_free
+#define     Norm_Corr        voAWB_Norm_Corr
+#define     GetX86Functions  voAWB_GetX86Functions
+#define     InitX86Functions voAWB_InitX86Functions
 /******************************************************/
 
 #endif  //#define __TYPEDEFS_H__
@@ -0,0 +1,89 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: amrwbenc_x86.c                                           *
+*                                                                      *
+*       Description: CPU detection and selection of the x86 functions  *
+*                                                                      *
+************************************************************************/
+
+#include <pthread.h>
+
+#include "typedef.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+#include "x86_cpu.h"
+
+AMRWBENC_X86_FUNCS amrwbencX86Funcs = {
+	Convolve,
+	cor_h_x,
+	Syn_filt,
+	Residu,
+	Filt_6k_7k,
+	Pred_lt4,
+	Norm_Corr
+};
+
+static pthread_once_t x86FuncsOnce = PTHREAD_ONCE_INIT;
+
+/*********************************************************************************
+*
+* function name: GetX86Functions
+* description:  fill funcs with the fastest functions the CPU supports
+*
+**********************************************************************************/
+void GetX86Functions(AMRWBENC_X86_FUNCS *funcs)
+{
+	unsigned int features = x86_cpu_get_features();
+
+	funcs->Convolve = Convolve;
+	funcs->cor_h_x = cor_h_x;
+	funcs->Syn_filt = Syn_filt;
+	funcs->Residu = Residu;
+	funcs->Filt_6k_7k = Filt_6k_7k;
+	funcs->Pred_lt4 = Pred_lt4;
+	funcs->Norm_Corr = Norm_Corr;
+
+	if (features & X86_CPU_SSE4_1)
+	{
+		funcs->Convolve = Convolve_SSE41;
+		funcs->cor_h_x = cor_h_x_SSE41;
+		funcs->Syn_filt = Syn_filt_SSE41;
+		funcs->Residu = Residu_SSE41;
+		funcs->Filt_6k_7k = Filt_6k_7k_SSE41;
+		funcs->Pred_lt4 = Pred_lt4_SSE41;
+		funcs->Norm_Corr = Norm_Corr_SSE41;
+	}
+
+	if (features & X86_CPU_AVX2)
+	{
+		funcs->Convolve = Convolve_AVX2;
+		funcs->cor_h_x = cor_h_x_AVX2;
+		funcs->Residu = Residu_AVX2;
+		funcs->Filt_6k_7k = Filt_6k_7k_AVX2;
+		funcs->Pred_lt4 = Pred_lt4_AVX2;
+	}
+}
+
+static void SetX86Functions(void)
+{
+	GetX86Functions(&amrwbencX86Funcs);
+}
+
+void InitX86Functions(void)
+{
+	pthread_once(&x86FuncsOnce, SetX86Functions);
+}
@@ -0,0 +1,177 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: convolve_avx2.c                                          *
+*                                                                      *
+*       Description: AVX2 versions of Convolve() and cor_h_x(), same   *
+*                    output as the C code                              *
+*                                                                      *
+*       The unpacks and packs work within each 128 bit half, so an     *
+*       unpacked pair of loads comes back in order from packssdw.      *
+*                                                                      *
+************************************************************************/
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "basic_op.h"
+#include "cnst.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+
+/* lo in the low half, hi in the high half, for pmaddwd */
+static __inline Word32 Pair(Word16 lo, Word16 hi)
+{
+	return (Word32)((UWord16)lo | ((UWord32)(UWord16)hi << 16));
+}
+
+/***********************************************************************
+* Function: Convolve_AVX2                                              *
+*                                                                      *
+* Description: Convolve(), sixteen outputs at a time                   *
+************************************************************************/
+void Convolve_AVX2(
+		Word16 x[],                           /* (i)     : input vector                           */
+		Word16 h[],                           /* (i)     : impulse response                       */
+		Word16 y[],                           /* (o)     : output vector                          */
+		Word16 L                              /* (i)     : vector size                            */
+		)
+{
+	Word16 hBuf[16 + L_SUBFR];
+	Word16 *hp = hBuf + 16;                  /* h[-16..-1] = 0 */
+	const __m256i round = _mm256_set1_epi32(0x8000);
+	Word32 i, n;
+
+	(void)L;
+	memset(hBuf, 0, 16 * sizeof(Word16));
+	memcpy(hp, h, L_SUBFR * sizeof(Word16));
+
+	for (n = 0; n < L_SUBFR; n += 16)
+	{
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+
+		/* x[i] * h[n+j-i] + x[i+1] * h[n+j-i-1] in lane j */
+		for (i = 0; i <= n + 14; i += 2)
+		{
+			__m256i c = _mm256_set1_epi32(Pair(x[i], x[i + 1]));
+			__m256i d0 = _mm256_loadu_si256((const __m256i *)(hp + n - i));
+			__m256i d1 = _mm256_loadu_si256((const __m256i *)(hp + n - i - 1));
+
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(d0, d1), c));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(d0, d1), c));
+		}
+
+		lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_slli_epi32(lo, 1), round), 16);
+		hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_slli_epi32(hi, 1), round), 16);
+		_mm256_storeu_si256((__m256i *)(y + n), _mm256_packs_epi32(lo, hi));
+	}
+}
+
+/***********************************************************************
+* Function: cor_h_x_AVX2                                               *
+*                                                                      *
+* Description: cor_h_x(), sixteen correlations at a time               *
+************************************************************************/
+void cor_h_x_AVX2(
+		Word16 h[],                           /* (i) Q12 : impulse response of weighted synthesis filter */
+		Word16 x[],                           /* (i) Q0  : target vector                                 */
+		Word16 dn[]                           /* (o) <12bit : correlation between target and h[]         */
+		)
+{
+	Word16 xBuf[L_SUBFR + 16];               /* x[64..79] = 0 */
+	Word32 y32[L_SUBFR], maxs[4];
+	Word32 i, m, j;
+	Word32 L_max, L_tot;
+	__m256i vmax = _mm256_setzero_si256();
+	__m256i satLo, satHi;
+	__m128i shift, max4;
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i round = _mm256_set1_epi32(0x8000);
+
+	memcpy(xBuf, x, L_SUBFR * sizeof(Word16));
+	memset(xBuf + L_SUBFR, 0, 16 * sizeof(Word16));
+
+	/* first keep the result on 32 bits and find absolute maximum */
+	for (i = 0; i < L_SUBFR; i += 16)
+	{
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+
+		/* h[m] * x[i+j+m] + h[m+1] * x[i+j+m+1] in lane j */
+		for (m = 0; m < L_SUBFR - i; m += 2)
+		{
+			__m256i c = _mm256_set1_epi32(Pair(h[m], h[m + 1]));
+			__m256i d0 = _mm256_loadu_si256((const __m256i *)(xBuf + i + m));
+			__m256i d1 = _mm256_loadu_si256((const __m256i *)(xBuf + i + m + 1));
+
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(d0, d1), c));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(d0, d1), c));
+		}
+
+		/* 1 -> to avoid null dn[] */
+		lo = _mm256_add_epi32(_mm256_slli_epi32(lo, 1), one);
+		hi = _mm256_add_epi32(_mm256_slli_epi32(hi, 1), one);
+
+		/* lo holds y32[i+0..3, i+8..11], hi y32[i+4..7, i+12..15] */
+		_mm256_storeu_si256((__m256i *)(y32 + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(y32 + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+
+		/* every group of four lanes holds tracks 0..3; |MIN_32| stays negative as in C */
+		vmax = _mm256_max_epi32(vmax, _mm256_max_epi32(_mm256_abs_epi32(lo), _mm256_abs_epi32(hi)));
+	}
+
+	max4 = _mm_max_epi32(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+	_mm_storeu_si128((__m128i *)maxs, max4);
+
+	/* tot += 3*max / 8 */
+	L_max = ((maxs[0] + maxs[1] + maxs[2] + maxs[3]) >> 2);
+	L_tot = vo_L_add(1, L_max);             /* +max/4 */
+	L_tot = vo_L_add(L_tot, (L_max >> 1));  /* +max/8 */
+
+	/* Find the number of right shifts to do on y32[] so that    */
+	/* 6.0 x sumation of max of dn[] in each track not saturate. */
+	j = norm_l(L_tot) - 4;             /* 4 -> 16 x tot */
+
+	/* L_shl(), saturating above 0 */
+	shift = _mm_cvtsi32_si128(j < 0 ? -j : j);
+	satLo = _mm256_set1_epi32(j > 0 ? MIN_32 >> j : MIN_32);
+	satHi = _mm256_set1_epi32(j > 0 ? MAX_32 >> j : MAX_32);
+
+	for (i = 0; i < L_SUBFR; i += 16)
+	{
+		__m256i lo = _mm256_loadu_si256((const __m256i *)(y32 + i));
+		__m256i hi = _mm256_loadu_si256((const __m256i *)(y32 + i + 8));
+
+		if (j < 0)
+		{
+			lo = _mm256_sra_epi32(lo, shift);
+			hi = _mm256_sra_epi32(hi, shift);
+		}
+		else
+		{
+			lo = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(lo, satLo), satHi), shift);
+			hi = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(hi, satLo), satHi), shift);
+		}
+
+		/* vo_round(), then the halves back in order */
+		lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 16);
+		hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 16);
+		_mm256_storeu_si256((__m256i *)(dn + i),
+		                    _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+}
@@ -0,0 +1,295 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: convolve_sse41.c                                         *
+*                                                                      *
+*       Description: SSE4.1 versions of Convolve(), cor_h_x() and      *
+*                    Norm_Corr(), same output as the C code            *
+*                                                                      *
+*       The C sums of 16x16 bit products wrap on 32 bits, so they are  *
+*       done with pmaddwd, two taps at a time, in any order.           *
+*                                                                      *
+************************************************************************/
+
+#include <smmintrin.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "basic_op.h"
+#include "math_op.h"
+#include "cnst.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+
+/* lo in the low half, hi in the high half, for pmaddwd */
+static __inline Word32 Pair(Word16 lo, Word16 hi)
+{
+	return (Word32)((UWord16)lo | ((UWord32)(UWord16)hi << 16));
+}
+
+static __inline Word32 HSum(__m128i x)
+{
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+	x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(x);
+}
+
+/* sum of a[i] * b[i], i = 0..63 */
+static __inline __m128i Dot64(const Word16 *a, const Word16 *b)
+{
+	__m128i acc = _mm_setzero_si128();
+	Word32 i;
+
+	for (i = 0; i < L_SUBFR; i += 8)
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(a + i)),
+		                                        _mm_loadu_si128((const __m128i *)(b + i))));
+	return acc;
+}
+
+/***********************************************************************
+* Function: Convolve_SSE41                                             *
+*                                                                      *
+* Description: Convolve(), eight outputs at a time                     *
+************************************************************************/
+void Convolve_SSE41(
+		Word16 x[],                           /* (i)     : input vector                           */
+		Word16 h[],                           /* (i)     : impulse response                       */
+		Word16 y[],                           /* (o)     : output vector                          */
+		Word16 L                              /* (i)     : vector size                            */
+		)
+{
+	Word16 hBuf[16 + L_SUBFR];
+	Word16 *hp = hBuf + 16;                  /* h[-16..-1] = 0 */
+	const __m128i round = _mm_set1_epi32(0x8000);
+	Word32 i, n;
+
+	(void)L;
+	memset(hBuf, 0, 16 * sizeof(Word16));
+	memcpy(hp, h, L_SUBFR * sizeof(Word16));
+
+	for (n = 0; n < L_SUBFR; n += 8)
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+
+		/* x[i] * h[n+j-i] + x[i+1] * h[n+j-i-1] in lane j */
+		for (i = 0; i <= n + 6; i += 2)
+		{
+			__m128i c = _mm_set1_epi32(Pair(x[i], x[i + 1]));
+			__m128i d0 = _mm_loadu_si128((const __m128i *)(hp + n - i));
+			__m128i d1 = _mm_loadu_si128((const __m128i *)(hp + n - i - 1));
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(d0, d1), c));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(d0, d1), c));
+		}
+
+		lo = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(lo, 1), round), 16);
+		hi = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(hi, 1), round), 16);
+		_mm_storeu_si128((__m128i *)(y + n), _mm_packs_epi32(lo, hi));
+	}
+}
+
+/***********************************************************************
+* Function: cor_h_x_SSE41                                              *
+*                                                                      *
+* Description: cor_h_x(), eight correlations at a time                 *
+************************************************************************/
+void cor_h_x_SSE41(
+		Word16 h[],                           /* (i) Q12 : impulse response of weighted synthesis filter */
+		Word16 x[],                           /* (i) Q0  : target vector                                 */
+		Word16 dn[]                           /* (o) <12bit : correlation between target and h[]         */
+		)
+{
+	Word16 xBuf[L_SUBFR + 16];               /* x[64..79] = 0 */
+	Word32 y32[L_SUBFR], maxs[4];
+	Word32 i, m, j;
+	Word32 L_max, L_tot;
+	__m128i vmax = _mm_setzero_si128();
+	__m128i shift, satLo, satHi;
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i round = _mm_set1_epi32(0x8000);
+
+	memcpy(xBuf, x, L_SUBFR * sizeof(Word16));
+	memset(xBuf + L_SUBFR, 0, 16 * sizeof(Word16));
+
+	/* first keep the result on 32 bits and find absolute maximum */
+	for (i = 0; i < L_SUBFR; i += 8)
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+
+		/* h[m] * x[i+j+m] + h[m+1] * x[i+j+m+1] in lane j */
+		for (m = 0; m < L_SUBFR - i; m += 2)
+		{
+			__m128i c = _mm_set1_epi32(Pair(h[m], h[m + 1]));
+			__m128i d0 = _mm_loadu_si128((const __m128i *)(xBuf + i + m));
+			__m128i d1 = _mm_loadu_si128((const __m128i *)(xBuf + i + m + 1));
+
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(d0, d1), c));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(d0, d1), c));
+		}
+
+		/* 1 -> to avoid null dn[] */
+		lo = _mm_add_epi32(_mm_slli_epi32(lo, 1), one);
+		hi = _mm_add_epi32(_mm_slli_epi32(hi, 1), one);
+		_mm_storeu_si128((__m128i *)(y32 + i), lo);
+		_mm_storeu_si128((__m128i *)(y32 + i + 4), hi);
+
+		/* lane j keeps the maximum of track j; |MIN_32| stays negative as in C */
+		vmax = _mm_max_epi32(vmax, _mm_max_epi32(_mm_abs_epi32(lo), _mm_abs_epi32(hi)));
+	}
+
+	_mm_storeu_si128((__m128i *)maxs, vmax);
+
+	/* tot += 3*max / 8 */
+	L_max = ((maxs[0] + maxs[1] + maxs[2] + maxs[3]) >> 2);
+	L_tot = vo_L_add(1, L_max);             /* +max/4 */
+	L_tot = vo_L_add(L_tot, (L_max >> 1));  /* +max/8 */
+
+	/* Find the number of right shifts to do on y32[] so that    */
+	/* 6.0 x sumation of max of dn[] in each track not saturate. */
+	j = norm_l(L_tot) - 4;             /* 4 -> 16 x tot */
+
+	/* L_shl(), saturating above 0 */
+	shift = _mm_cvtsi32_si128(j < 0 ? -j : j);
+	satLo = _mm_set1_epi32(j > 0 ? MIN_32 >> j : MIN_32);
+	satHi = _mm_set1_epi32(j > 0 ? MAX_32 >> j : MAX_32);
+
+	for (i = 0; i < L_SUBFR; i += 8)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i *)(y32 + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(y32 + i + 4));
+
+		if (j < 0)
+		{
+			lo = _mm_sra_epi32(lo, shift);
+			hi = _mm_sra_epi32(hi, shift);
+		}
+		else
+		{
+			lo = _mm_sll_epi32(_mm_min_epi32(_mm_max_epi32(lo, satLo), satHi), shift);
+			hi = _mm_sll_epi32(_mm_min_epi32(_mm_max_epi32(hi, satLo), satHi), shift);
+		}
+
+		/* vo_round() */
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 16);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 16);
+		_mm_storeu_si128((__m128i *)(dn + i), _mm_packs_epi32(lo, hi));
+	}
+}
+
+/***********************************************************************
+* Function: Norm_Corr_SSE41                                            *
+*                                                                      *
+* Description: Norm_Corr(), with the correlations and the update of    *
+*              the filtered excitation eight samples at a time         *
+************************************************************************/
+void Norm_Corr_SSE41(
+		Word16 exc[],                         /* (i)     : excitation buffer                     */
+		Word16 xn[],                          /* (i)     : target vector                         */
+		Word16 h[],                           /* (i) Q15 : impulse response of synth/wgt filters */
+		Word16 L_subfr,
+		Word16 t_min,                         /* (i)     : minimum value of pitch lag.           */
+		Word16 t_max,                         /* (i)     : maximum value of pitch lag.           */
+		Word16 corr_norm[])                   /* (o) Q15 : normalized correlation                */
+{
+	Word32 i, k, t;
+	Word32 corr, exp_corr, norm, exp, scale;
+	Word16 exp_norm, excf[L_SUBFR], tmp;
+	Word32 L_tmp, L_tmp1, L_tmp2;
+
+	(void)L_subfr;
+
+	/* compute the filtered excitation for the first delay t_min */
+	k = -t_min;
+	X86_FUNC(Convolve)(&exc[k], h, excf, 64);
+
+	/* Compute rounded down 1/sqrt(energy of xn[]) */
+	L_tmp = HSum(Dot64(xn, xn));
+
+	L_tmp = (L_tmp << 1) + 1;
+	exp = norm_l(L_tmp);
+	exp = (32 - exp);
+	scale = -(exp >> 1);           /* (1<<scale) < 1/sqrt(energy rounded) */
+
+	/* loop for every possible period */
+	for (t = t_min; t <= t_max; t++)
+	{
+		/* Compute correlation between xn[] and excf[] */
+		L_tmp = HSum(Dot64(xn, excf));
+		L_tmp1 = HSum(Dot64(excf, excf));
+
+		L_tmp = (L_tmp << 1) + 1;
+		L_tmp1 = (L_tmp1 << 1) + 1;
+
+		exp = norm_l(L_tmp);
+		L_tmp = (L_tmp << exp);
+		exp_corr = (30 - exp);
+		corr = extract_h(L_tmp);
+
+		exp = norm_l(L_tmp1);
+		L_tmp = (L_tmp1 << exp);
+		exp_norm = (30 - exp);
+
+		Isqrt_n(&L_tmp, &exp_norm);
+		norm = extract_h(L_tmp);
+
+		/* Normalize correlation = correlation * (1/sqrt(energy)) */
+		L_tmp = vo_L_mult(corr, norm);
+
+		L_tmp2 = exp_corr + exp_norm + scale;
+		if(L_tmp2 < 0)
+		{
+			L_tmp2 = -L_tmp2;
+			L_tmp = L_tmp >> L_tmp2;
+		}
+		else
+		{
+			L_tmp = L_tmp << L_tmp2;
+		}
+
+		corr_norm[t] = vo_round(L_tmp);
+
+		/* modify the filtered excitation excf[] for the next iteration,
+		   from the end so excf[i-1] is read before it is replaced */
+		if(t != t_max)
+		{
+			__m128i vtmp;
+
+			k = -(t + 1);
+			tmp = exc[k];
+			vtmp = _mm_set1_epi16(tmp);
+
+			for (i = L_SUBFR - 8; i >= 0; i -= 8)
+			{
+				__m128i hv = _mm_loadu_si128((const __m128i *)(h + i));
+				__m128i prev;
+				__m128i prod;
+
+				/* vo_mult(tmp, h[i]): bits 15..30 of the product */
+				prod = _mm_or_si128(_mm_slli_epi16(_mm_mulhi_epi16(vtmp, hv), 1),
+				                    _mm_srli_epi16(_mm_mullo_epi16(vtmp, hv), 15));
+
+				if (i > 0)
+					prev = _mm_loadu_si128((const __m128i *)(excf + i - 1));
+				else
+					prev = _mm_slli_si128(_mm_loadu_si128((const __m128i *)excf), 2);
+
+				_mm_storeu_si128((__m128i *)(excf + i), _mm_add_epi16(prod, prev));
+			}
+		}
+	}
+}
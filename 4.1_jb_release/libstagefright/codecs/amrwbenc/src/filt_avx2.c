@@ -0,0 +1,212 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: filt_avx2.c                                              *
+*                                                                      *
+*       Description: AVX2 versions of Residu(), Filt_6k_7k() and       *
+*                    Pred_lt4(), same output as the C code             *
+*                                                                      *
+************************************************************************/
+
+#include <immintrin.h>
+
+#include "typedef.h"
+#include "basic_op.h"
+#include "cnst.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+
+#define L_FIR        31
+#define UP_SAMP      4
+
+extern Word16 fir_6k_7k[L_FIR];
+extern Word16 inter4_2[4][32];
+
+/* lo in the low half, hi in the high half, for pmaddwd */
+static __inline Word32 Pair(Word16 lo, Word16 hi)
+{
+	return (Word32)((UWord16)lo | ((UWord32)(UWord16)hi << 16));
+}
+
+/* extract_h(L_add(L_shl2(s, n), 0x8000)) of eight lanes */
+static __inline __m256i ShlRound(__m256i s, Word32 n)
+{
+	s = _mm256_max_epi32(s, _mm256_set1_epi32(MIN_32 >> n));
+	s = _mm256_min_epi32(s, _mm256_set1_epi32(MAX_32 >> n));
+	s = _mm256_min_epi32(_mm256_sll_epi32(s, _mm_cvtsi32_si128(n)), _mm256_set1_epi32(MAX_32 - 0x8000));
+	return _mm256_srai_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(0x8000)), 16);
+}
+
+/* c[0] * p[j] + c[1] * p[j+1] + ... + c[taps-1] * p[j+taps-1] for sixteen
+   lanes j, taps even; lo holds lanes 0..3 and 8..11, hi 4..7 and 12..15 */
+static __inline void Fir(const Word16 *p, const Word16 *c, Word32 taps, __m256i *lo, __m256i *hi)
+{
+	Word32 k;
+
+	for (k = 0; k < taps; k += 2)
+	{
+		__m256i ck = _mm256_set1_epi32(Pair(c[k], c[k + 1]));
+		__m256i d0 = _mm256_loadu_si256((const __m256i *)(p + k));
+		__m256i d1 = _mm256_loadu_si256((const __m256i *)(p + k + 1));
+
+		*lo = _mm256_add_epi32(*lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(d0, d1), ck));
+		*hi = _mm256_add_epi32(*hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(d0, d1), ck));
+	}
+}
+
+/* c * p[j] added to lo and hi, in the same lane order */
+static __inline void Tap(const Word16 *p, Word16 c, __m256i *lo, __m256i *hi)
+{
+	__m256i ck = _mm256_set1_epi32(Pair(c, 0));
+	__m256i d = _mm256_loadu_si256((const __m256i *)p);
+	const __m256i zero = _mm256_setzero_si256();
+
+	*lo = _mm256_add_epi32(*lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(d, zero), ck));
+	*hi = _mm256_add_epi32(*hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(d, zero), ck));
+}
+
+/***********************************************************************
+* Function: Residu_AVX2                                                *
+*                                                                      *
+* Description: Residu(), sixteen outputs at a time                     *
+************************************************************************/
+void Residu_AVX2(
+		Word16 a[],                           /* (i) Q12 : prediction coefficients                     */
+		Word16 x[],                           /* (i)     : speech (values x[-m..-1] are needed         */
+		Word16 y[],                           /* (o) x2  : residual signal                             */
+		Word16 lg                             /* (i)     : size of filtering                           */
+		)
+{
+	Word16 aRev[16];
+	Word32 i, k;
+
+	/* a[15] .. a[0], so the taps run forwards from x[i-15] */
+	for (k = 0; k < 16; k++)
+		aRev[k] = a[15 - k];
+
+	for (i = 0; i + 16 <= lg; i += 16)
+	{
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+
+		Fir(x + i - 15, aRev, 16, &lo, &hi);
+		Tap(x + i - 16, a[16], &lo, &hi);
+		_mm256_storeu_si256((__m256i *)(y + i), _mm256_packs_epi32(ShlRound(lo, 5), ShlRound(hi, 5)));
+	}
+
+	if (i < lg)
+		Residu(a, x + i, y + i, lg - i);
+}
+
+/***********************************************************************
+* Function: Filt_6k_7k_AVX2                                            *
+*                                                                      *
+* Description: Filt_6k_7k(), sixteen outputs at a time. The filter is  *
+*              symmetric, so the 31 taps are summed directly.          *
+************************************************************************/
+void Filt_6k_7k_AVX2(
+		Word16 signal[],                      /* input:  signal                  */
+		Word16 lg,                            /* input:  length of input         */
+		Word16 mem[]                          /* in/out: memory (size=30)        */
+		)
+{
+	Word16 x[L_SUBFR16k + (L_FIR - 1)];
+	Word32 i, k, L_tmp;
+	const __m256i round = _mm256_set1_epi32(0x4000);
+
+	Copy(mem, x, L_FIR - 1);
+	for (i = 0; i + 16 <= lg; i += 16)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i *)(signal + i));
+
+		_mm256_storeu_si256((__m256i *)(x + i + L_FIR - 1), _mm256_srai_epi16(s, 2));   /* gain of filter = 4 */
+	}
+	for (; i < lg; i++)
+	{
+		x[i + L_FIR - 1] = signal[i] >> 2;
+	}
+
+	for (i = 0; i + 16 <= lg; i += 16)
+	{
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+
+		Fir(x + i, fir_6k_7k, 30, &lo, &hi);
+		Tap(x + i + 30, fir_6k_7k[30], &lo, &hi);
+
+		/* (L_tmp + 0x4000) >> 15, cut to 16 bits */
+		lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+		hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+		lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+		hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+		_mm256_storeu_si256((__m256i *)(signal + i), _mm256_packs_epi32(lo, hi));
+	}
+	for (; i < lg; i++)
+	{
+		L_tmp = 0;
+		for (k = 0; k < L_FIR; k++)
+			L_tmp += x[i + k] * fir_6k_7k[k];
+		signal[i] = (L_tmp + 0x4000) >> 15;
+	}
+
+	Copy(x + lg, mem, L_FIR - 1);
+}
+
+/***********************************************************************
+* Function: Pred_lt4_AVX2                                              *
+*                                                                      *
+* Description: Pred_lt4(), sixteen outputs at a time. exc[] is written *
+*              over the input it reads from, so the lag has to be      *
+*              at least 16 + 16; PIT_MIN always is.                    *
+************************************************************************/
+void Pred_lt4_AVX2(
+		Word16 exc[],                         /* in/out: excitation buffer */
+		Word16 T0,                            /* input : integer pitch lag */
+		Word16 frac,                          /* input : fraction of lag   */
+		Word16 L_subfr                        /* input : subframe size     */
+		)
+{
+	Word16 *x, *ptr2;
+	Word32 j, k;
+
+	if (T0 < 16 + 16)
+	{
+		Pred_lt4(exc, T0, frac, L_subfr);
+		return;
+	}
+
+	x = exc - T0;
+	k = -frac;
+	if (k < 0)
+	{
+		k += UP_SAMP;
+		x--;
+	}
+	x -= 15;                                     /* x = L_INTERPOL2 - 1 */
+	ptr2 = &(inter4_2[3 - k][0]);                /* k = UP_SAMP - 1 - frac */
+
+	for (j = 0; j + 16 <= L_subfr; j += 16)
+	{
+		__m256i lo = _mm256_setzero_si256();
+		__m256i hi = _mm256_setzero_si256();
+
+		Fir(x + j, ptr2, 32, &lo, &hi);
+		_mm256_storeu_si256((__m256i *)(exc + j), _mm256_packs_epi32(ShlRound(lo, 2), ShlRound(hi, 2)));
+	}
+
+	if (j < L_subfr)
+		Pred_lt4(exc + j, T0, frac, L_subfr - j);
+}
@@ -0,0 +1,298 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: filt_sse41.c                                             *
+*                                                                      *
+*       Description: SSE4.1 versions of Syn_filt(), Residu(),          *
+*                    Filt_6k_7k() and Pred_lt4(), same output as the   *
+*                    C code                                            *
+*                                                                      *
+************************************************************************/
+
+#include <smmintrin.h>
+
+#include "typedef.h"
+#include "basic_op.h"
+#include "cnst.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+
+#define L_FIR        31
+#define UP_SAMP      4
+
+extern Word16 fir_6k_7k[L_FIR];
+extern Word16 inter4_2[4][32];
+
+/* lo in the low half, hi in the high half, for pmaddwd */
+static __inline Word32 Pair(Word16 lo, Word16 hi)
+{
+	return (Word32)((UWord16)lo | ((UWord32)(UWord16)hi << 16));
+}
+
+/* extract_h(L_add(L_shl2(s, n), 0x8000)) of four lanes */
+static __inline __m128i ShlRound(__m128i s, Word32 n)
+{
+	s = _mm_max_epi32(s, _mm_set1_epi32(MIN_32 >> n));
+	s = _mm_min_epi32(s, _mm_set1_epi32(MAX_32 >> n));
+	s = _mm_min_epi32(_mm_sll_epi32(s, _mm_cvtsi32_si128(n)), _mm_set1_epi32(MAX_32 - 0x8000));
+	return _mm_srai_epi32(_mm_add_epi32(s, _mm_set1_epi32(0x8000)), 16);
+}
+
+/* c[0] * p[j] + c[1] * p[j+1] + ... + c[taps-1] * p[j+taps-1] in lane j,
+   eight lanes, taps even */
+static __inline void Fir(const Word16 *p, const Word16 *c, Word32 taps, __m128i *lo, __m128i *hi)
+{
+	Word32 k;
+
+	for (k = 0; k < taps; k += 2)
+	{
+		__m128i ck = _mm_set1_epi32(Pair(c[k], c[k + 1]));
+		__m128i d0 = _mm_loadu_si128((const __m128i *)(p + k));
+		__m128i d1 = _mm_loadu_si128((const __m128i *)(p + k + 1));
+
+		*lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(d0, d1), ck));
+		*hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(d0, d1), ck));
+	}
+}
+
+/* c * p[j] added to lo and hi */
+static __inline void Tap(const Word16 *p, Word16 c, __m128i *lo, __m128i *hi)
+{
+	__m128i ck = _mm_set1_epi32(Pair(c, 0));
+	__m128i d = _mm_loadu_si128((const __m128i *)p);
+	const __m128i zero = _mm_setzero_si128();
+
+	*lo = _mm_add_epi32(*lo, _mm_madd_epi16(_mm_unpacklo_epi16(d, zero), ck));
+	*hi = _mm_add_epi32(*hi, _mm_madd_epi16(_mm_unpackhi_epi16(d, zero), ck));
+}
+
+/***********************************************************************
+* Function: Syn_filt_SSE41                                             *
+*                                                                      *
+* Description: Syn_filt(), four outputs at a time. The taps on the     *
+*              outputs of the previous block are summed in parallel,   *
+*              the three most recent outputs are added one by one.     *
+************************************************************************/
+void Syn_filt_SSE41(
+		Word16 a[],                           /* (i) Q12 : a[m+1] prediction coefficients           */
+		Word16 x[],                           /* (i)     : input signal                             */
+		Word16 y[],                           /* (o)     : output signal                            */
+		Word16 lg,                            /* (i)     : size of filtering                        */
+		Word16 mem[],                         /* (i/o)   : memory associated with this filtering.   */
+		Word16 update                         /* (i)     : 0=no update, 1=update of memory.         */
+		)
+{
+	Word32 i, j, k, a0;
+	Word16 y_buf[L_SUBFR16k + M16k];
+	Word16 *yy = y_buf + 16;
+	Word32 L_tmp, y1, y2, y3;
+	Word32 part[4];
+	__m128i coef[7], ca0;
+	const __m128i zero = _mm_setzero_si128();
+
+	/* copy initial filter states into synthesis buffer */
+	for (i = 0; i < 16; i++)
+	{
+		y_buf[i] = mem[i];
+	}
+	a0 = (a[0] >> 1);                     /* input / 2 */
+
+	ca0 = _mm_set1_epi32(Pair(a0, 0));
+	for (k = 0; k < 6; k++)
+		coef[k] = _mm_set1_epi32(Pair(a[4 + 2 * k], a[5 + 2 * k]));
+	coef[6] = _mm_set1_epi32(Pair(a[16], 0));
+
+	y1 = yy[-1];
+	y2 = yy[-2];
+	y3 = yy[-3];
+
+	for (i = 0; i + 4 <= lg; i += 4)
+	{
+		__m128i acc, sum;
+
+		/* a0 * x[i+j] - a[4] * yy[i+j-4] - ... - a[16] * yy[i+j-16] */
+		acc = _mm_madd_epi16(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(x + i)), zero), ca0);
+		sum = _mm_madd_epi16(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(yy + i - 16)), zero),
+		                     coef[6]);
+		for (k = 0; k < 6; k++)
+		{
+			__m128i d0 = _mm_loadl_epi64((const __m128i *)(yy + i - 4 - 2 * k));
+			__m128i d1 = _mm_loadl_epi64((const __m128i *)(yy + i - 5 - 2 * k));
+
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(d0, d1), coef[k]));
+		}
+		_mm_storeu_si128((__m128i *)part, _mm_sub_epi32(acc, sum));
+
+		for (j = 0; j < 4; j++)
+		{
+			L_tmp = part[j] - vo_mult32(a[1], y1) - vo_mult32(a[2], y2) - vo_mult32(a[3], y3);
+			L_tmp = L_shl2(L_tmp, 4);
+			y3 = y2;
+			y2 = y1;
+			y1 = extract_h(L_add(L_tmp, 0x8000));
+			y[i + j] = yy[i + j] = y1;
+		}
+	}
+
+	for (; i < lg; i++)
+	{
+		L_tmp = vo_mult32(a0, x[i]);
+		for (k = 1; k <= 16; k++)
+			L_tmp -= vo_mult32(a[k], yy[i - k]);
+		L_tmp = L_shl2(L_tmp, 4);
+		y[i] = yy[i] = extract_h(L_add(L_tmp, 0x8000));
+	}
+
+	/* Update memory if required */
+	if (update)
+		for (i = 0; i < 16; i++)
+		{
+			mem[i] = yy[lg - 16 + i];
+		}
+}
+
+/***********************************************************************
+* Function: Residu_SSE41                                               *
+*                                                                      *
+* Description: Residu(), eight outputs at a time                       *
+************************************************************************/
+void Residu_SSE41(
+		Word16 a[],                           /* (i) Q12 : prediction coefficients                     */
+		Word16 x[],                           /* (i)     : speech (values x[-m..-1] are needed         */
+		Word16 y[],                           /* (o) x2  : residual signal                             */
+		Word16 lg                             /* (i)     : size of filtering                           */
+		)
+{
+	Word16 aRev[16];
+	Word32 i, k;
+
+	/* a[15] .. a[0], so the taps run forwards from x[i-15] */
+	for (k = 0; k < 16; k++)
+		aRev[k] = a[15 - k];
+
+	for (i = 0; i + 8 <= lg; i += 8)
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+
+		Fir(x + i - 15, aRev, 16, &lo, &hi);
+		Tap(x + i - 16, a[16], &lo, &hi);
+		_mm_storeu_si128((__m128i *)(y + i), _mm_packs_epi32(ShlRound(lo, 5), ShlRound(hi, 5)));
+	}
+
+	if (i < lg)
+		Residu(a, x + i, y + i, lg - i);
+}
+
+/***********************************************************************
+* Function: Filt_6k_7k_SSE41                                           *
+*                                                                      *
+* Description: Filt_6k_7k(), eight outputs at a time. The filter is    *
+*              symmetric, so the 31 taps are summed directly.          *
+************************************************************************/
+void Filt_6k_7k_SSE41(
+		Word16 signal[],                      /* input:  signal                  */
+		Word16 lg,                            /* input:  length of input         */
+		Word16 mem[]                          /* in/out: memory (size=30)        */
+		)
+{
+	Word16 x[L_SUBFR16k + (L_FIR - 1)];
+	Word32 i, k, L_tmp;
+	const __m128i round = _mm_set1_epi32(0x4000);
+
+	Copy(mem, x, L_FIR - 1);
+	for (i = 0; i + 8 <= lg; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)(signal + i));
+
+		_mm_storeu_si128((__m128i *)(x + i + L_FIR - 1), _mm_srai_epi16(s, 2));   /* gain of filter = 4 */
+	}
+	for (; i < lg; i++)
+	{
+		x[i + L_FIR - 1] = signal[i] >> 2;
+	}
+
+	for (i = 0; i + 8 <= lg; i += 8)
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+
+		Fir(x + i, fir_6k_7k, 30, &lo, &hi);
+		Tap(x + i + 30, fir_6k_7k[30], &lo, &hi);
+
+		/* (L_tmp + 0x4000) >> 15, cut to 16 bits */
+		lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+		hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+		lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+		hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+		_mm_storeu_si128((__m128i *)(signal + i), _mm_packs_epi32(lo, hi));
+	}
+	for (; i < lg; i++)
+	{
+		L_tmp = 0;
+		for (k = 0; k < L_FIR; k++)
+			L_tmp += x[i + k] * fir_6k_7k[k];
+		signal[i] = (L_tmp + 0x4000) >> 15;
+	}
+
+	Copy(x + lg, mem, L_FIR - 1);
+}
+
+/***********************************************************************
+* Function: Pred_lt4_SSE41                                             *
+*                                                                      *
+* Description: Pred_lt4(), eight outputs at a time. exc[] is written   *
+*              over the input it reads from, so the lag has to be      *
+*              at least 8 + 16; PIT_MIN always is.                     *
+************************************************************************/
+void Pred_lt4_SSE41(
+		Word16 exc[],                         /* in/out: excitation buffer */
+		Word16 T0,                            /* input : integer pitch lag */
+		Word16 frac,                          /* input : fraction of lag   */
+		Word16 L_subfr                        /* input : subframe size     */
+		)
+{
+	Word16 *x, *ptr2;
+	Word32 j, k;
+
+	if (T0 < 8 + 16)
+	{
+		Pred_lt4(exc, T0, frac, L_subfr);
+		return;
+	}
+
+	x = exc - T0;
+	k = -frac;
+	if (k < 0)
+	{
+		k += UP_SAMP;
+		x--;
+	}
+	x -= 15;                                     /* x = L_INTERPOL2 - 1 */
+	ptr2 = &(inter4_2[3 - k][0]);                /* k = UP_SAMP - 1 - frac */
+
+	for (j = 0; j + 8 <= L_subfr; j += 8)
+	{
+		__m128i lo = _mm_setzero_si128();
+		__m128i hi = _mm_setzero_si128();
+
+		Fir(x + j, ptr2, 32, &lo, &hi);
+		_mm_storeu_si128((__m128i *)(exc + j), _mm_packs_epi32(ShlRound(lo, 2), ShlRound(hi, 2)));
+	}
+
+	if (j < L_subfr)
+		Pred_lt4(exc + j, T0, frac, L_subfr - j);
+}
@@ -27,6 +27,7 @@
 #include "math_op.h"
 #include "acelp.h"
 #include "cnst.h"
+#include "amrwbenc_x86.h"
 
 #define UP_SAMP      4
 #define L_INTERPOL1  4
@@ -44,7 +45,7 @@ void Norm_corr_asm(
 		Word16 corr_norm[]                    /* (o) Q15 : normalized correlation                */
 		);
 #else
-static void Norm_Corr(
+X86_STATIC void Norm_Corr(
 		Word16 exc[],                         /* (i)     : excitation buffer                     */
 		Word16 xn[],                          /* (i)     : target vector                         */
 		Word16 h[],                           /* (i) Q15 : impulse response of synth/wgt filters */
@@ -89,7 +90,7 @@ Word16 Pitch_fr4(                          /* (o)     : pitch period.
 #ifdef ASM_OPT               /* asm optimization branch */
     Norm_corr_asm(exc, xn, h, L_subfr, t_min, t_max, corr);
 #else
-	Norm_Corr(exc, xn, h, L_subfr, t_min, t_max, corr);
+	X86_FUNC(Norm_Corr)(exc, xn, h, L_subfr, t_min, t_max, corr);
 #endif
 
 	/* Find integer pitch */
@@ -158,7 +159,7 @@ Word16 Pitch_fr4(                          /* (o)     : pitch period.
 *  square root of energy of target and filtered excitation).                        *
 ************************************************************************************/
 #ifndef ASM_OPT
-static void Norm_Corr(
+X86_STATIC void Norm_Corr(
 		Word16 exc[],                         /* (i)     : excitation buffer                     */
 		Word16 xn[],                          /* (i)     : target vector                         */
 		Word16 h[],                           /* (i) Q15 : impulse response of synth/wgt filters */
@@ -178,7 +179,7 @@ static void Norm_Corr(
 #ifdef ASM_OPT              /* asm optimization branch */
 	Convolve_asm(&exc[k], h, excf, 64);
 #else
-	Convolve(&exc[k], h, excf, 64);
+	X86_FUNC(Convolve)(&exc[k], h, excf, 64);
 #endif
 
 	/* Compute rounded down 1/sqrt(energy of xn[]) */
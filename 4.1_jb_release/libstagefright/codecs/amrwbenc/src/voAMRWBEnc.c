@@ -38,6 +38,7 @@
 #include "voAMRWB.h"
 #include "mem_align.h"
 #include "cmnMemory.h"
+#include "amrwbenc_x86.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -432,7 +433,7 @@ void coder(
 #ifdef ASM_OPT                    /* asm optimization branch */
 		Residu_opt(Ap, &speech[i_subfr], &wsp[i_subfr], L_SUBFR);
 #else
-		Residu(Ap, &speech[i_subfr], &wsp[i_subfr], L_SUBFR);
+		X86_FUNC(Residu)(Ap, &speech[i_subfr], &wsp[i_subfr], L_SUBFR);
 #endif
 
 		p_A += (M + 1);
@@ -545,7 +546,7 @@ void coder(
 #ifdef ASM_OPT                   /* asm optimization branch */
 		Residu_opt(&A[3 * (M + 1)], speech, exc, L_FRAME);
 #else
-		Residu(&A[3 * (M + 1)], speech, exc, L_FRAME);
+		X86_FUNC(Residu)(&A[3 * (M + 1)], speech, exc, L_FRAME);
 #endif
 
 		for (i = 0; i < L_FRAME; i++)
@@ -658,7 +659,7 @@ void coder(
 #ifdef ASM_OPT               /* asm optimization branch */
 		Residu_opt(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
 #else
-		Residu(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
+		X86_FUNC(Residu)(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
 #endif
 		p_Aq += (M + 1);
 	}
@@ -758,15 +759,15 @@ void coder(
 #ifdef ASM_OPT              /* asm optimization branch */
 		Residu_opt(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
 #else
-		Residu(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
+		X86_FUNC(Residu)(p_Aq, &speech[i_subfr], &exc[i_subfr], L_SUBFR);
 #endif
-		Syn_filt(p_Aq, &exc[i_subfr], error + M, L_SUBFR, error, 0);
+		X86_FUNC(Syn_filt)(p_Aq, &exc[i_subfr], error + M, L_SUBFR, error, 0);
 		Weight_a(p_A, Ap, GAMMA1, M);
 
 #ifdef ASM_OPT             /* asm optimization branch */
 		Residu_opt(Ap, error + M, xn, L_SUBFR);
 #else
-		Residu(Ap, error + M, xn, L_SUBFR);
+		X86_FUNC(Residu)(Ap, error + M, xn, L_SUBFR);
 #endif
 		Deemph2(xn, TILT_FAC, L_SUBFR, &(st->mem_w0));
 
@@ -779,12 +780,12 @@ void coder(
 		tmp = 0;
 		Preemph2(code + M, TILT_FAC, L_SUBFR / 2, &tmp);
 		Weight_a(p_A, Ap, GAMMA1, M);
-		Syn_filt(Ap,code + M, code + M, L_SUBFR / 2, code, 0);
+		X86_FUNC(Syn_filt)(Ap,code + M, code + M, L_SUBFR / 2, code, 0);
 
 #ifdef ASM_OPT                /* asm optimization branch */
 		Residu_opt(p_Aq,code + M, cn, L_SUBFR / 2);
 #else
-		Residu(p_Aq,code + M, cn, L_SUBFR / 2);
+		X86_FUNC(Residu)(p_Aq,code + M, cn, L_SUBFR / 2);
 #endif
 
 		/* second half: res[] --> cn[] (approximated and faster) */
@@ -956,14 +957,14 @@ void coder(
 #ifdef ASM_OPT                  /* asm optimization branch */
 		pred_lt4_asm(&exc[i_subfr], T0, T0_frac, L_SUBFR + 1);
 #else
-		Pred_lt4(&exc[i_subfr], T0, T0_frac, L_SUBFR + 1);
+		X86_FUNC(Pred_lt4)(&exc[i_subfr], T0, T0_frac, L_SUBFR + 1);
 #endif
 		if (*ser_size > NBBITS_9k)
 		{
 #ifdef ASM_OPT                   /* asm optimization branch */
 			Convolve_asm(&exc[i_subfr], h1, y1, L_SUBFR);
 #else
-			Convolve(&exc[i_subfr], h1, y1, L_SUBFR);
+			X86_FUNC(Convolve)(&exc[i_subfr], h1, y1, L_SUBFR);
 #endif
 			gain1 = G_pitch(xn, y1, g_coeff, L_SUBFR);
 			/* clip gain if necessary to avoid problem at decoder */
@@ -1001,7 +1002,7 @@ void coder(
 #ifdef ASM_OPT                 /* asm optimization branch */
 		Convolve_asm(code, h1, y2, L_SUBFR);
 #else
-		Convolve(code, h1, y2, L_SUBFR);
+		X86_FUNC(Convolve)(code, h1, y2, L_SUBFR);
 #endif
 
 		gain2 = G_pitch(xn, y2, g_coeff2, L_SUBFR);
@@ -1076,7 +1077,7 @@ void coder(
 		 * - Correlation between target xn2[] and impulse response h1[]    *
 		 * - Innovative codebook search                                    *
 		 *-----------------------------------------------------------------*/
-		cor_h_x(h2, xn2, dn);
+		X86_FUNC(cor_h_x)(h2, xn2, dn);
 		if (*ser_size <= NBBITS_7k)
 		{
 			ACELP_2t64_fx(dn, cn, h2, code, y2, indice);
@@ -1222,7 +1223,7 @@ void coder(
 			exc[i + i_subfr] = extract_h(L_add(L_tmp, 0x8000));
 		}
 
-		Syn_filt(p_Aq,&exc[i_subfr], synth, L_SUBFR, st->mem_syn, 1);
+		X86_FUNC(Syn_filt)(p_Aq,&exc[i_subfr], synth, L_SUBFR, st->mem_syn, 1);
 
 		if(*ser_size >= NBBITS_24k)
 		{
@@ -1500,11 +1501,11 @@ static Word16 synthesis(
 	/* set energy of white noise to energy of excitation */
 	tmp = extract_h(Dot_product12_asm(HF, HF, L_SUBFR16k, &exp));
 #else
-	Syn_filt(Ap, HF, HF, L_SUBFR16k, st->mem_syn_hf, 1);
+	X86_FUNC(Syn_filt)(Ap, HF, HF, L_SUBFR16k, st->mem_syn_hf, 1);
 	/* noise High Pass filtering (1ms of delay) */
-	Filt_6k_7k(HF, L_SUBFR16k, st->mem_hf);
+	X86_FUNC(Filt_6k_7k)(HF, L_SUBFR16k, st->mem_hf);
 	/* filtering of the original signal */
-	Filt_6k_7k(HF_SP, L_SUBFR16k, st->mem_hf2);
+	X86_FUNC(Filt_6k_7k)(HF_SP, L_SUBFR16k, st->mem_hf2);
 	/* check the gain difference */
 	Scale_sig(HF_SP, L_SUBFR16k, -1);
 	ener = extract_h(Dot_product12(HF_SP, HF_SP, L_SUBFR16k, &exp_ener));
@@ -1604,6 +1605,10 @@ VO_U32 VO_API voAMRWB_Init(VO_HANDLE * phCodec,                   /* o: the audi
 	VO_MEM_OPERATOR *pMemOP;
 	int interMem = 0;
 
+#ifdef AMRWBENC_X86
+	InitX86Functions();
+#endif
+
 	if(pUserData == NULL || pUserData->memflag != VO_IMF_USERMEMOPERATOR || pUserData->memData == NULL )
 	{
 #ifdef USE_DEAULT_MEM
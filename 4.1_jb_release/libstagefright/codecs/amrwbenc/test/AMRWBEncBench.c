@@ -0,0 +1,514 @@
+/*
+ ** Copyright 2003-2010, VisualOn, Inc.
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+/***********************************************************************
+*       File: AMRWBEncBench.c                                          *
+*                                                                      *
+*       Description: checks the x86 filters and correlations against   *
+*                    the C versions on random input, then encodes a    *
+*                    test signal, or a PCM file, with each function    *
+*                    set through the voAMRWB API the way               *
+*                    SoftAMRWBEncoder does, and prints how many        *
+*                    channels one core encodes in realtime. The        *
+*                    bitstreams have to be identical, and to the       *
+*                    reference file if one is given (3GPP TS 26.174    *
+*                    vectors: -f itu). The library alone is timed;     *
+*                    codec_component_bench -e amrwb times the          *
+*                    component with its OMX buffer handling.           *
+*                                                                      *
+*       Usage: amrwbenc_bench [-s seconds] [-i input.pcm] [-m mode]    *
+*                             [-f rfc3267|itu] [-d] [-r reference]     *
+*                                                                      *
+************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "voAMRWB.h"
+#include "cmnMemory.h"
+#include "typedef.h"
+#include "basic_op.h"
+#include "cnst.h"
+#include "acelp.h"
+#include "amrwbenc_x86.h"
+
+/* typedefs.h renames the encoder's Copy(), not the VO_MEM_OPERATOR member */
+#undef Copy
+
+#define SAMPLE_RATE		16000
+#define FRAME_SAMPLES	320
+#define OUT_SIZE		1024
+
+typedef struct {
+	const char *name;
+	const char *cpu;	/* STAGEFRIGHT_X86_CPU, NULL for no limit */
+#ifdef AMRWBENC_X86
+	AMRWBENC_X86_FUNCS funcs;
+#endif
+} FunctionSet;
+
+static FunctionSet sets[3];
+static int numSets;
+
+static const char *modeNames[VOAMRWB_N_MODES] = {
+	"6.60", "8.85", "12.65", "14.25", "15.85", "18.25", "19.85", "23.05", "23.85"
+};
+
+static unsigned int seed = 12345;
+
+static unsigned int Rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) | (seed << 16);
+}
+
+static double Now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void InitSets(void)
+{
+	static const char *names[3] = { "c", "sse41", "avx2" };
+	int i, j;
+
+	numSets = 0;
+	for (i = 0; i < 3; i++) {
+		FunctionSet *set = &sets[numSets];
+
+		set->name = names[i];
+		set->cpu = i < 2 ? names[i] : NULL;
+#ifdef AMRWBENC_X86
+		if (set->cpu)
+			setenv("STAGEFRIGHT_X86_CPU", set->cpu, 1);
+		else
+			unsetenv("STAGEFRIGHT_X86_CPU");
+		GetX86Functions(&set->funcs);
+
+		/* skip the sets the CPU does not have */
+		for (j = 0; j < numSets; j++) {
+			if (!memcmp(&sets[j].funcs, &set->funcs, sizeof(set->funcs)))
+				break;
+		}
+		if (j < numSets)
+			continue;
+#else
+		if (i > 0)
+			break;
+		(void)j;
+#endif
+		numSets++;
+	}
+	unsetenv("STAGEFRIGHT_X86_CPU");
+}
+
+#ifdef AMRWBENC_X86
+
+/* random sample, from full scale down to a few bits */
+static Word16 RandSample(int bits)
+{
+	return (Word16)Rand() >> (16 - bits);
+}
+
+static void RandVector(Word16 *x, int n, int bits)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		x[i] = RandSample(bits);
+}
+
+static int Compare(const char *what, const char *name, const void *a, const void *b,
+                   int size, int iter)
+{
+	if (!memcmp(a, b, size))
+		return 0;
+
+	printf("%s: %s differs from c at iteration %d\n", name, what, iter);
+	return 1;
+}
+
+/* checks the functions of set against the C versions */
+static int CheckSet(const FunctionSet *set, int iterations)
+{
+	enum { HIST = 256 };
+	Word16 x[HIST + 320], h[L_SUBFR], a[M + 1];
+	Word16 ref[HIST + 320], buf[HIST + 320];
+	Word16 memRef[32], memBuf[32];
+	int i, lg, bits, update;
+
+	for (i = 0; i < iterations; i++) {
+		bits = 4 + Rand() % 13;
+
+		/* Convolve, cor_h_x */
+		RandVector(x, L_SUBFR, bits);
+		RandVector(h, L_SUBFR, 4 + Rand() % 13);
+
+		Convolve(x, h, ref, L_SUBFR);
+		set->funcs.Convolve(x, h, buf, L_SUBFR);
+		if (Compare("Convolve", set->name, ref, buf, L_SUBFR * sizeof(Word16), i))
+			return 1;
+
+		/* the C code sums the four track maxima without saturation, so
+		   keep them below 2^29 each */
+		RandVector(x, L_SUBFR, bits < 12 ? bits : 12);
+		RandVector(h, L_SUBFR, 4 + Rand() % 8);
+		cor_h_x(h, x, ref);
+		set->funcs.cor_h_x(h, x, buf);
+		if (Compare("cor_h_x", set->name, ref, buf, L_SUBFR * sizeof(Word16), i))
+			return 1;
+
+		/* Syn_filt, on its own output now and then; coefficients that
+		   make it saturate too */
+		lg = (Rand() & 1) ? (Rand() & 1 ? L_SUBFR : L_SUBFR16k) : 1 + Rand() % L_SUBFR16k;
+		update = Rand() & 1;
+		RandVector(a, M + 1, 6 + Rand() % 8);
+		RandVector(x, lg, bits);
+		RandVector(memRef, M, bits);
+		memcpy(memBuf, memRef, sizeof(memRef));
+		memcpy(ref, x, lg * sizeof(Word16));
+		memcpy(buf, x, lg * sizeof(Word16));
+
+		if (Rand() & 1) {
+			Syn_filt(a, ref, ref, lg, memRef, update);
+			set->funcs.Syn_filt(a, buf, buf, lg, memBuf, update);
+		} else {
+			Syn_filt(a, x, ref, lg, memRef, update);
+			set->funcs.Syn_filt(a, x, buf, lg, memBuf, update);
+		}
+		if (Compare("Syn_filt", set->name, ref, buf, lg * sizeof(Word16), i)
+				|| Compare("Syn_filt memory", set->name, memRef, memBuf, M * sizeof(Word16), i))
+			return 1;
+
+		/* Residu, x[-16..-1] needed */
+		lg = (Rand() & 1) ? L_FRAME : 1 + Rand() % L_FRAME;
+		RandVector(x, M + lg, bits);
+
+		Residu(a, x + M, ref, lg);
+		set->funcs.Residu(a, x + M, buf, lg);
+		if (Compare("Residu", set->name, ref, buf, lg * sizeof(Word16), i))
+			return 1;
+
+		/* Filt_6k_7k, in place */
+		lg = (Rand() & 1) ? L_SUBFR16k : 1 + Rand() % L_SUBFR16k;
+		RandVector(ref, lg, bits);
+		memcpy(buf, ref, lg * sizeof(Word16));
+		RandVector(memRef, 30, bits - 2);
+		memcpy(memBuf, memRef, sizeof(memRef));
+
+		Filt_6k_7k(ref, lg, memRef);
+		set->funcs.Filt_6k_7k(buf, lg, memBuf);
+		if (Compare("Filt_6k_7k", set->name, ref, buf, lg * sizeof(Word16), i)
+				|| Compare("Filt_6k_7k memory", set->name, memRef, memBuf, 30 * sizeof(Word16), i))
+			return 1;
+
+		/* Pred_lt4, in place on the past excitation; short lags as well */
+		{
+			Word16 T0 = (Rand() & 7) ? PIT_MIN + Rand() % (PIT_MAX - PIT_MIN + 1)
+			                         : 17 + Rand() % (PIT_MIN - 17);
+			Word16 frac = (Word16)(Rand() % 7) - 3;
+
+			lg = (Rand() & 1) ? L_SUBFR + 1 : 1 + Rand() % (L_SUBFR + 1);
+			RandVector(ref, HIST + lg, bits);
+			memcpy(buf, ref, (HIST + lg) * sizeof(Word16));
+
+			Pred_lt4(ref + HIST, T0, frac, lg);
+			set->funcs.Pred_lt4(buf + HIST, T0, frac, lg);
+			if (Compare("Pred_lt4", set->name, ref + HIST, buf + HIST, lg * sizeof(Word16), i))
+				return 1;
+		}
+
+		/* Norm_Corr over a pitch range as Pitch_fr4() uses it; the output
+		   is indexed by lag, so give it room for every lag rather than
+		   pointing t_min entries before a short array */
+		{
+			Word16 t_min = PIT_MIN - 4 + Rand() % (PIT_MAX - PIT_MIN - 32);
+			Word16 t_max = t_min + 8 + Rand() % 24;
+			Word16 corrRef[PIT_MAX + 1], corrBuf[PIT_MAX + 1];
+
+			RandVector(x, HIST + L_SUBFR, bits);
+			RandVector(h, L_SUBFR, 10 + Rand() % 6);
+			RandVector(ref, L_SUBFR, bits);
+			memset(corrRef, 0, sizeof(corrRef));
+			memset(corrBuf, 0, sizeof(corrBuf));
+
+			Norm_Corr(x + HIST, ref, h, L_SUBFR, t_min, t_max, corrRef);
+			set->funcs.Norm_Corr(x + HIST, ref, h, L_SUBFR, t_min, t_max, corrBuf);
+			if (Compare("Norm_Corr", set->name, corrRef, corrBuf, sizeof(corrRef), i))
+				return 1;
+		}
+
+	}
+
+	return 0;
+}
+
+#endif /* AMRWBENC_X86 */
+
+/* voiced segments on a gliding pitch, noise bursts and pauses */
+static short *MakeSignal(int samples)
+{
+	short *pcm = (short *)malloc(samples * sizeof(short));
+	double phase = 0;
+	int i, k;
+
+	seed = 12345;
+
+	for (i = 0; i < samples; i++) {
+		double t = (double)i / SAMPLE_RATE;
+		double f0 = 120 + 60 * sin(2 * M_PI * 0.7 * t);
+		int segment = (i / 4000) % 5;
+		double x = 0;
+
+		phase += 2 * M_PI * f0 / SAMPLE_RATE;
+
+		if (segment < 3) {
+			/* a few harmonics under a slow formant */
+			for (k = 1; k <= 12; k++)
+				x += sin(k * phase) / k * (1 + cos(2 * M_PI * 0.3 * t + k));
+			x *= 0.08;
+		} else if (segment == 3) {
+			x = 0.1 * ((int)(Rand() & 0xffff) - 0x8000) / 32768.0;
+		}
+		x += 0.002 * ((int)(Rand() & 0xffff) - 0x8000) / 32768.0;
+
+		pcm[i] = (short)(x * 32767);
+	}
+
+	return pcm;
+}
+
+typedef struct {
+	unsigned char *data;
+	int size, capacity;
+} Stream;
+
+static void Append(Stream *s, const unsigned char *data, int size)
+{
+	if (s->size + size > s->capacity) {
+		s->capacity = 2 * (s->size + size);
+		s->data = (unsigned char *)realloc(s->data, s->capacity);
+	}
+	memcpy(s->data + s->size, data, size);
+	s->size += size;
+}
+
+/* encodes the signal, returns the seconds taken and the bitstream */
+static int Encode(const FunctionSet *set, const short *pcm, int samples, int mode,
+                  int frameType, int dtx, double *seconds, Stream *out)
+{
+	VO_AUDIO_CODECAPI api;
+	VO_MEM_OPERATOR memOperator;
+	VO_CODEC_INIT_USERDATA userData;
+	VO_HANDLE handle;
+	VO_CODECBUFFER inputData, outputData;
+	VO_AUDIO_OUTPUTINFO outputInfo;
+	unsigned char frame[OUT_SIZE];
+	double start;
+	int n;
+
+	if (voGetAMRWBEncAPI(&api) != VO_ERR_NONE)
+		return 1;
+
+	memOperator.Alloc = cmnMemAlloc;
+	memOperator.Copy = cmnMemCopy;
+	memOperator.Free = cmnMemFree;
+	memOperator.Set = cmnMemSet;
+	memOperator.Check = cmnMemCheck;
+	memset(&userData, 0, sizeof(userData));
+	userData.memflag = VO_IMF_USERMEMOPERATOR;
+	userData.memData = (VO_PTR)&memOperator;
+	if (api.Init(&handle, VO_AUDIO_CodingAMRWB, &userData) != VO_ERR_NONE)
+		return 1;
+
+#ifdef AMRWBENC_X86
+	amrwbencX86Funcs = set->funcs;
+#else
+	(void)set;
+#endif
+
+	if (api.SetParam(handle, VO_PID_AMRWB_FRAMETYPE, &frameType) != VO_ERR_NONE
+			|| api.SetParam(handle, VO_PID_AMRWB_MODE, &mode) != VO_ERR_NONE
+			|| api.SetParam(handle, VO_PID_AMRWB_DTX, &dtx) != VO_ERR_NONE)
+		return 1;
+
+	out->size = 0;
+	start = Now();
+
+	/* one frame in, one frame out, as SoftAMRWBEncoder feeds it */
+	for (n = 0; n + FRAME_SAMPLES <= samples; n += FRAME_SAMPLES) {
+		memset(&inputData, 0, sizeof(inputData));
+		inputData.Buffer = (unsigned char *)(pcm + n);
+		inputData.Length = FRAME_SAMPLES * sizeof(short);
+		if (api.SetInputData(handle, &inputData) != VO_ERR_NONE)
+			return 1;
+
+		outputData.Buffer = frame;
+		outputData.Length = OUT_SIZE;
+		if (api.GetOutputData(handle, &outputData, &outputInfo) != VO_ERR_NONE)
+			return 1;
+		Append(out, frame, outputData.Length);
+	}
+
+	*seconds = Now() - start;
+	api.Uninit(handle);
+
+	return 0;
+}
+
+static unsigned char *ReadFile(const char *path, int *size)
+{
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+
+	if (f == NULL)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	data = (unsigned char *)malloc(*size + 1);
+	*size = fread(data, 1, *size, f);
+	fclose(f);
+
+	return data;
+}
+
+static unsigned int Hash(const Stream *s)
+{
+	unsigned int hash = 2166136261u;
+	int n;
+
+	for (n = 0; n < s->size; n++)
+		hash = (hash ^ s->data[n]) * 16777619u;
+	return hash;
+}
+
+int main(int argc, char **argv)
+{
+	const char *input = NULL, *reference = NULL;
+	unsigned char *refData = NULL;
+	int refSize = 0;
+	int duration = 20, onlyMode = -1, frameType = VOAMRWB_RFC3267, dtx = 0;
+	int samples, mode, i, failed = 0;
+	short *pcm;
+	Stream out = { NULL, 0, 0 };
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			duration = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			input = argv[++i];
+		} else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+			onlyMode = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+			i++;
+			frameType = !strcmp(argv[i], "itu") ? VOAMRWB_ITU : VOAMRWB_RFC3267;
+		} else if (!strcmp(argv[i], "-d")) {
+			dtx = 1;
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			reference = argv[++i];
+		} else {
+			printf("usage: %s [-s seconds] [-i input.pcm] [-m mode] [-f rfc3267|itu] [-d]"
+			       " [-r reference]\n"
+			       "  input: 16-bit native endian PCM at %d Hz\n"
+			       "  mode: 0 (6.60 kbps) .. 8 (23.85 kbps), all by default\n", argv[0], SAMPLE_RATE);
+			return 1;
+		}
+	}
+	if (onlyMode >= VOAMRWB_N_MODES || (reference != NULL && onlyMode < 0)) {
+		printf("a reference needs one mode, 0..8\n");
+		return 1;
+	}
+
+	InitSets();
+
+#ifdef AMRWBENC_X86
+	for (i = 0; i < numSets; i++) {
+		if (CheckSet(&sets[i], 20000)) {
+			failed = 1;
+		} else {
+			printf("%s: functions match c\n", sets[i].name);
+		}
+	}
+#endif
+
+	if (input != NULL) {
+		pcm = (short *)ReadFile(input, &samples);
+		if (pcm == NULL) {
+			printf("cannot read %s\n", input);
+			return 1;
+		}
+		samples /= sizeof(short);
+	} else {
+		samples = duration * SAMPLE_RATE;
+		pcm = MakeSignal(samples);
+	}
+
+	if (reference != NULL) {
+		refData = ReadFile(reference, &refSize);
+		if (refData == NULL) {
+			printf("cannot read %s\n", reference);
+			return 1;
+		}
+	}
+
+	for (mode = 0; mode < VOAMRWB_N_MODES; mode++) {
+		unsigned int refHash = 0;
+
+		if (onlyMode >= 0 && mode != onlyMode)
+			continue;
+
+		for (i = 0; i < numSets; i++) {
+			double seconds;
+			unsigned int hash;
+
+			if (Encode(&sets[i], pcm, samples, mode, frameType, dtx, &seconds, &out)) {
+				printf("%s: encoder error\n", sets[i].name);
+				return 1;
+			}
+			hash = Hash(&out);
+
+			printf("%s kbps, %s: %.1f channels per core, hash %08x\n",
+			       modeNames[mode], sets[i].name,
+			       (double)samples / SAMPLE_RATE / seconds, hash);
+
+			if (i == 0) {
+				refHash = hash;
+			} else if (hash != refHash) {
+				printf("%s: bitstream differs from c\n", sets[i].name);
+				failed = 1;
+			}
+
+			if (refData != NULL && (out.size != refSize || memcmp(out.data, refData, refSize))) {
+				printf("%s: bitstream differs from %s\n", sets[i].name, reference);
+				failed = 1;
+			}
+		}
+	}
+
+	free(out.data);
+	free(refData);
+	free(pcm);
+
+	return failed;
+}
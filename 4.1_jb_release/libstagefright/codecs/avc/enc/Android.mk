@@ -17,6 +17,7 @@ LOCAL_SRC_FILES := \
     src/sad.cpp \
     src/sad_halfpel.cpp \
     src/slice.cpp \
+    src/slice_mt.cpp \
     src/vlc_encode.cpp
 
 
@@ -37,8 +38,44 @@ LOCAL_CFLAGS := \
     -D__arm__ \
     -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
 
+# x86: SSE2 and AVX2 versions of the SAD and SATD functions, picked at run
+# time. The AVX2 ones are in libstagefright_avcenc_avx2 below, which has to be
+# linked along with this library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+    src/sad_sse2.cpp
+
+LOCAL_CFLAGS += -DAVCENC_X86 -msse2
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../common/include
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    src/sad_avx2.cpp
+
+LOCAL_MODULE := libstagefright_avcenc_avx2
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/src \
+    $(LOCAL_PATH)/../common/include \
+    $(TOP)/frameworks/av/media/libstagefright/include \
+    $(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS := \
+    -D__arm__ -DAVCENC_X86 -mavx2 \
+    -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
+
 include $(BUILD_STATIC_LIBRARY)
 
+endif
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -62,6 +99,11 @@ LOCAL_CFLAGS := \
 LOCAL_STATIC_LIBRARIES := \
         libstagefright_avcenc
 
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_avcenc_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_SHARED_LIBRARIES := \
         libstagefright \
         libstagefright_avc_common \
@@ -75,3 +117,36 @@ LOCAL_MODULE := libstagefright_soft_h264enc
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# test utility: checks the SAD and SATD functions and times the encoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/AVCEncBench.cpp
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/../common/include
+
+LOCAL_CFLAGS := \
+    -D__arm__ \
+    -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_avcenc
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DAVCENC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_avcenc_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright_avc_common
+
+LOCAL_MODULE := avcenc_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
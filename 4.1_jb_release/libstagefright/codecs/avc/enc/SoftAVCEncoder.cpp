@@ -18,6 +18,8 @@
 #define LOG_TAG "SoftAVCEncoder"
 #include <utils/Log.h>
 
+#include <unistd.h>
+
 #include "avcenc_api.h"
 #include "avcenc_int.h"
 #include "OMX_Video.h"
@@ -32,6 +34,22 @@
 
 namespace android {
 
+// Vendor index of the "OMX.google.android.index.encoderSpeedPreset" extension,
+// an OMX_PARAM_U32TYPE on the output port selecting an entry of kSpeedPresets.
+static const OMX_INDEXTYPE kIndexEncoderSpeedPreset =
+    (OMX_INDEXTYPE)(OMX_IndexVendorStartUnused + 1);
+
+// Motion search of each speed preset, from the slowest
+static const struct {
+    AVCMESearch mSearch;
+    uint32_t mEarlyExitSAD;
+} kSpeedPresets[] = {
+    { AVC_ME_SPIRAL,  0   },
+    { AVC_ME_EPZS,    512 },
+    { AVC_ME_HEXAGON, 768 },
+    { AVC_ME_DIAMOND, 768 },
+};
+
 template<class T>
 static void InitOMXParams(T *params) {
     params->nSize = sizeof(T);
@@ -172,6 +190,8 @@ SoftAVCEncoder::SoftAVCEncoder(
       mVideoBitRate(192000),
       mVideoColorFormat(OMX_COLOR_FormatYUV420Planar),
       mIDRFrameRefreshIntervalInSec(1),
+      mNumThreads(1),
+      mSpeedPreset(0),
       mAVCEncProfile(AVC_BASELINE),
       mAVCEncLevel(AVC_LEVEL2),
       mNumInputFrames(-1),
@@ -184,6 +204,13 @@ SoftAVCEncoder::SoftAVCEncoder(
       mInputFrameData(NULL),
       mSliceGroup(NULL) {
 
+    // Encode each picture as one slice per core, up to kMaxNumThreads,
+    // the slices on as many threads.
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numCpus > 1) {
+        mNumThreads = numCpus > kMaxNumThreads ? kMaxNumThreads : (uint32_t)numCpus;
+    }
+
     initPorts();
     ALOGI("Construct SoftAVCEncoder");
 }
@@ -209,7 +236,7 @@ OMX_ERRORTYPE SoftAVCEncoder::initEncParams() {
     mHandle->CBAVC_Free = FreeWrapper;
 
     CHECK(mEncParams != NULL);
-    memset(mEncParams, 0, sizeof(mEncParams));
+    memset(mEncParams, 0, sizeof(*mEncParams));
     mEncParams->rate_control = AVC_ON;
     mEncParams->initQP = 0;
     mEncParams->init_CBP_removal_delay = 1600;
@@ -246,6 +273,11 @@ OMX_ERRORTYPE SoftAVCEncoder::initEncParams() {
 
     mEncParams->use_overrun_buffer = AVC_OFF;
 
+    mEncParams->num_slices = mNumThreads;
+    mEncParams->num_threads = mNumThreads;
+    mEncParams->me_search = kSpeedPresets[mSpeedPreset].mSearch;
+    mEncParams->me_early_exit = kSpeedPresets[mSpeedPreset].mEarlyExitSAD;
+
     if (mVideoColorFormat == OMX_COLOR_FormatYUV420SemiPlanar) {
         // Color conversion is needed.
         CHECK(mInputFrameData == NULL);
@@ -419,6 +451,17 @@ void SoftAVCEncoder::initPorts() {
 
 OMX_ERRORTYPE SoftAVCEncoder::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
+    if (index == kIndexEncoderSpeedPreset) {
+        OMX_PARAM_U32TYPE *presetParams = (OMX_PARAM_U32TYPE *)params;
+
+        if (presetParams->nPortIndex != 1) {
+            return OMX_ErrorUndefined;
+        }
+
+        presetParams->nU32 = mSpeedPreset;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamVideoErrorCorrection:
         {
@@ -529,6 +572,19 @@ OMX_ERRORTYPE SoftAVCEncoder::internalGetParameter(
 
 OMX_ERRORTYPE SoftAVCEncoder::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
+    if (index == kIndexEncoderSpeedPreset) {
+        const OMX_PARAM_U32TYPE *presetParams =
+            (const OMX_PARAM_U32TYPE *)params;
+
+        if (presetParams->nPortIndex != 1 ||
+            presetParams->nU32 >= sizeof(kSpeedPresets) / sizeof(kSpeedPresets[0])) {
+            return OMX_ErrorUndefined;
+        }
+
+        mSpeedPreset = presetParams->nU32;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamVideoErrorCorrection:
         {
@@ -671,6 +727,16 @@ OMX_ERRORTYPE SoftAVCEncoder::internalSetParameter(
     }
 }
 
+OMX_ERRORTYPE SoftAVCEncoder::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.encoderSpeedPreset")) {
+        *index = kIndexEncoderSpeedPreset;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftAVCEncoder::onQueueFilled(OMX_U32 portIndex) {
     if (mSignalledError || mSawInputEOS) {
         return;
@@ -807,15 +873,35 @@ void SoftAVCEncoder::onQueueFilled(OMX_U32 portIndex) {
         CHECK(encoderStatus == AVCENC_SUCCESS || encoderStatus == AVCENC_NEW_IDR);
         dataLength = outHeader->nAllocLen;  // Reset the output buffer length
         if (inHeader->nFilledLen > 0) {
-            encoderStatus = PVAVCEncodeNAL(mHandle, outPtr, &dataLength, &type);
-            if (encoderStatus == AVCENC_SUCCESS) {
+            // A picture encoded as several slices comes one NAL at a time;
+            // they are put in the same buffer, separated by start codes.
+            uint32_t filledLength = 0;
+            for (;;) {
+                encoderStatus = PVAVCEncodeNAL(mHandle, outPtr, &dataLength, &type);
+                if (encoderStatus != AVCENC_SUCCESS) {
+                    break;
+                }
                 CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
-            } else if (encoderStatus == AVCENC_PICTURE_READY) {
+                filledLength += dataLength;
+                if (filledLength + 4 > outHeader->nAllocLen) {
+                    encoderStatus = AVCENC_BITSTREAM_BUFFER_FULL;
+                    break;
+                }
+                memcpy(outPtr + dataLength, "\x00\x00\x00\x01", 4);
+                filledLength += 4;
+                outPtr += dataLength + 4;
+                dataLength = outHeader->nAllocLen - filledLength;
+            }
+            if (encoderStatus == AVCENC_PICTURE_READY) {
+                dataLength += filledLength;
                 CHECK(NULL == PVAVCEncGetOverrunBuffer(mHandle));
                 if (mIsIDRFrame) {
                     outHeader->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
                     mIsIDRFrame = false;
                 }
+                if (filledLength > 0) {
+                    outHeader->nFlags |= kSoftOMXBufferFlagMultipleNALUnits;
+                }
                 mReadyForNextFrame = true;
                 AVCFrameIO recon;
                 if (PVAVCEncGetRecon(mHandle, &recon) == AVCENC_SUCCESS) {
@@ -43,6 +43,9 @@ struct SoftAVCEncoder : public MediaBufferObserver,
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
 
 
@@ -61,6 +64,7 @@ protected:
 private:
     enum {
         kNumBuffers = 2,
+        kMaxNumThreads = 4,
     };
 
     // OMX input buffer's timestamp and flags
@@ -75,6 +79,8 @@ private:
     int32_t  mVideoBitRate;
     int32_t  mVideoColorFormat;
     int32_t  mIDRFrameRefreshIntervalInSec;
+    uint32_t mNumThreads;  // each picture is encoded as this many slices
+    uint32_t mSpeedPreset;  // motion search, from 0, the slowest
     AVCProfile mAVCEncProfile;
     AVCLevel   mAVCEncLevel;
 
@@ -225,11 +225,17 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncInitialize(AVCHandle *avcHandle, AVCEncPar
     {
         return AVCENC_MEMORY_FAIL;
     }
-    encvid->functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_C;
-    encvid->functionPointer->SAD_MB_HalfPel[0] = NULL;
-    encvid->functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_Cxh;
-    encvid->functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_Cyh;
-    encvid->functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_Cxhyh;
+    AVCInitFunctionPointers(encvid->functionPointer);
+
+    /* slice buffers and threads for slice-parallel encoding */
+    if (encvid->numSlices > 1)
+    {
+        status = InitSliceMT(avcHandle);
+        if (status != AVCENC_SUCCESS)
+        {
+            return status;
+        }
+    }
 
     /* initialize timing control */
     encvid->modTimeRef = 0;     /* ALWAYS ASSUME THAT TIMESTAMP START FROM 0 !!!*/
@@ -443,36 +449,48 @@ OSCL_EXPORT_REF AVCEnc_Status PVAVCEncodeNAL(AVCHandle *avcHandle, unsigned char
             break;
 
         case AVCEnc_Encoding_Frame:
-            /* initialized the structure */
-            BitstreamEncInit(bitstream, buffer, *buf_nal_size, encvid->overrunBuffer, encvid->oBSize);
-            BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
-
-            /* Re-order the reference list according to the ref_pic_list_reordering() */
-            /* We don't have to reorder the list for the encoder here. This can only be done
-            after we encode this slice. We can run thru a second-pass to see if new ordering
-            would save more bits. Too much delay !! */
-            /* status = ReOrderList(video);*/
-            status = InitSlice(encvid);
-            if (status != AVCENC_SUCCESS)
+            if (encvid->sliceMT != NULL)
             {
-                return status;
+                /* the slices are encoded in parallel on the first call */
+                status = AVCEncodeSliceMT(encvid, buffer, buf_nal_size);
+                if (status != AVCENC_SUCCESS && status != AVCENC_PICTURE_READY)
+                {
+                    return status;
+                }
             }
-
-            /* when we have everything, we encode the slice header */
-            status = EncodeSliceHeader(encvid, bitstream);
-            if (status != AVCENC_SUCCESS)
+            else
             {
-                return status;
-            }
+                /* initialized the structure */
+                BitstreamEncInit(bitstream, buffer, *buf_nal_size, encvid->overrunBuffer, encvid->oBSize);
+                BitstreamWriteBits(bitstream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
+
+                /* Re-order the reference list according to the ref_pic_list_reordering() */
+                /* We don't have to reorder the list for the encoder here. This can only be done
+                after we encode this slice. We can run thru a second-pass to see if new ordering
+                would save more bits. Too much delay !! */
+                /* status = ReOrderList(video);*/
+                status = InitSlice(encvid);
+                if (status != AVCENC_SUCCESS)
+                {
+                    return status;
+                }
 
-            status = AVCEncodeSlice(encvid);
+                /* when we have everything, we encode the slice header */
+                status = EncodeSliceHeader(encvid, bitstream);
+                if (status != AVCENC_SUCCESS)
+                {
+                    return status;
+                }
 
-            video->slice_id++;
+                status = AVCEncodeSlice(encvid);
 
-            /* closing the NAL with trailing bits */
-            BitstreamTrailingBits(bitstream, buf_nal_size);
+                video->slice_id++;
+
+                /* closing the NAL with trailing bits */
+                BitstreamTrailingBits(bitstream, buf_nal_size);
 
-            *buf_nal_size = bitstream->write_pos;
+                *buf_nal_size = bitstream->write_pos;
+            }
 
             encvid->rateCtrl->numFrameBits += ((*buf_nal_size) << 3);
 
@@ -604,6 +622,8 @@ OSCL_EXPORT_REF void    PVAVCCleanUpEncoder(AVCHandle *avcHandle)
 
     if (encvid != NULL)
     {
+        CleanupSliceMT(avcHandle);
+
         CleanMotionSearchModule(avcHandle);
 
         CleanupRateControlModule(avcHandle);
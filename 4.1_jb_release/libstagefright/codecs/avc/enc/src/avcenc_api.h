@@ -87,6 +87,19 @@ typedef enum
 
 #define MAX_NUM_SLICE_GROUP  8      /* maximum for all the profiles */
 
+/**
+This enumeration is for the full-pel motion search pattern. All of them start from the
+best of the spatio-temporal candidates.
+*/
+typedef enum
+{
+    AVC_ME_SPIRAL = 0,  /* 3x3 spiral steps, the original search */
+    AVC_ME_DIAMOND = 1, /* small diamond steps */
+    AVC_ME_HEXAGON = 2, /* hexagon steps, then one small diamond step */
+    AVC_ME_EPZS = 3     /* predictive zonal search, with the predicted MV and (0,0) as more
+                        candidates, then small diamond steps */
+} AVCMESearch;
+
 /**
 This structure contains the encoding parameters.
 */
@@ -158,6 +171,16 @@ typedef struct tagAVCEncParam
 
     AVCFlag use_overrun_buffer;  /* do not throw away the frame if output buffer is not big enough.
                                     copy excess bits to the overrun buffer */
+
+    uint32 num_slices;  /* number of slices per picture, each a band of whole MB rows.
+                        0 or 1 for one slice per slice group. Requires num_slice_group 1. */
+    uint32 num_threads; /* number of threads encoding the slices of a picture, including the
+                        calling thread. 0 or 1 to encode all of them on the calling thread.
+                        CBAVC_Malloc and CBAVC_Free may be called from the other threads. */
+
+    AVCMESearch me_search; /* full-pel motion search pattern, unused with fullsearch */
+    uint32 me_early_exit;   /* SAD of a 16x16 candidate at or below which the search stops
+                            without refining it, 0 to always refine */
 } AVCEncParams;
 
 
@@ -234,7 +257,9 @@ extern "C"
     fixed number of macroblocks, as specified in the encoder parameters set, or the
     maximum number of macroblocks fitted into the given input argument "buffer". The
     input frame is taken from the oldest unencoded input frame retrieved by users by
-    PVAVCEncGetInput API.
+    PVAVCEncGetInput API. With num_slices above one, all the slices of a picture are
+    encoded, on num_threads threads, by the first call and the following calls return
+    them one by one; a call that fails for lack of room can be retried with a bigger buffer.
     \param "avcHandle"  "Handle to the AVC encoder library object."
     \param "buffer"     "Pointer to the output AVC bitstream buffer, the format will be EBSP,
                          not RBSP."
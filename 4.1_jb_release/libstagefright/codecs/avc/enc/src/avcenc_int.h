@@ -337,6 +337,11 @@ typedef struct tagAVCEncFuncPtr
     int (*SAD_MB_HalfPel[4])(uint8*, uint8*, int, void *);
     int (*SAD_Macroblock)(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
 
+    /* SATD of the intra prediction modes */
+    int (*cost_i16)(uint8 *org, int org_pitch, uint8 *pred, int min_cost);
+    void (*cost_i4)(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost);
+    int (*SATDChroma)(uint8 *orgCb, uint8 *orgCr, int org_pitch, uint8 *pred, int min_cost);
+
 } AVCEncFuncPtr;
 
 /**
@@ -385,6 +390,12 @@ typedef struct tagEncObject
     AVCFrameIO          *currInput; /* pointer to the current input frame */
 
     int                 currSliceGroup; /* currently encoded slice group id */
+    uint                sliceEndMbAddr; /* the current slice ends before this MB */
+
+    /* slice-parallel encoding */
+    uint    numSlices;      /* number of slices per picture, 1 for one per slice group */
+    uint    numThreads;     /* number of threads encoding them */
+    struct tagEncSliceMT *sliceMT; /* NULL when numSlices is 1 */
 
     int     level[24][16], run[24][16]; /* scratch memory */
     int     leveldc[16], rundc[16]; /* for DC component */
@@ -440,6 +451,8 @@ typedef struct tagEncObject
 
     /* encoding complexity control */
     uint fullsearch_enable; /* flag to enable full-pel full-search */
+    AVCMESearch meSearch;   /* full-pel search pattern otherwise */
+    int meEarlyExit;        /* SAD at or below which the best candidate is not refined */
 
     /* misc.*/
     bool outOfBandParamSet; /* flag to enable out-of-band param set */
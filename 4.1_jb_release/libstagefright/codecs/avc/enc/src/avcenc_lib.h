@@ -452,6 +452,8 @@ extern "C"
                            uint8 *out, int outpitch,
                            int blkwidth, int blkheight);
 
+    void ePadChroma(uint8 *ref, int picwidth, int picheight, int picpitch, int x_pos, int y_pos);
+
     void eChromaMotionComp(uint8 *ref, int picwidth, int picheight,
                            int x_pos, int y_pos, uint8 *pred, int pred_pitch,
                            int blkwidth, int blkheight);
@@ -512,6 +514,14 @@ extern "C"
     */
     void  AVCPaddingEdge(AVCPictureData *refPic);
 
+    /**
+    This function pads 8 pixels around both chromas of the reference picture in one go,
+    so that motion compensation doesn't have to pad them block by block.
+    \param "refPic" "Pointer to the reference picture."
+    \return "void"
+    */
+    void  AVCPaddingEdgeChroma(AVCPictureData *refPic);
+
     /**
     This function keeps track of intra refresh macroblock locations.
     \param "encvid" "Pointer to the global array structure AVCEncObject."
@@ -572,6 +582,28 @@ extern "C"
                       int *imin, int *jmin, int ilow, int ihigh, int jlow, int jhigh,
                       int cmvx, int cmvy);
 
+    /**
+    Perform the fast full-pel search steps with a pattern of points around the
+    current best position.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "prev"   "Pointer to the reference frame."
+    \param "cur"    "Pointer to the current MB."
+    \param "pattern"    "Array of the relative positions of the points, in circular order."
+    \param "num_points" "Number of points of the pattern."
+    \param "max_step"   "Maximum number of moves."
+    \param "imin"   "Pointer to the best x-coordinate, input and output."
+    \param "jmin"   "Pointer to the best y-coordinate, input and output."
+    \param "min_sad"    "Pointer to the SAD of the best position, input and output."
+    \param "dmin"   "Cost of the best position on input."
+    \param "ilow, ihigh, jlow, jhigh"   "Search window."
+    \param "cmvx, cmvy" "Predicted motion vector."
+    \return "The cost of the best position."
+    */
+    int AVCPatternSearch(AVCEncObject *encvid, uint8 *prev, uint8 *cur,
+                         const int pattern[][2], int num_points, int max_step,
+                         int *imin, int *jmin, int *min_sad, int dmin,
+                         int ilow, int ihigh, int jlow, int jhigh, int cmvx, int cmvy);
+
     /**
     Select candidates from neighboring blocks according to the type of the
     prediction selection.
@@ -650,12 +682,13 @@ extern "C"
 
     /**
     This function calculates the SATD of a subpel candidate.
+    \param "encvid" "Pointer to AVCEncObject."
     \param "cand"   "Pointer to a candidate."
     \param "cur"    "Pointer to the current block."
     \param "dmin"   "Min-so-far SATD."
     \return "Sum of Absolute Transformed Difference."
     */
-    int SATD_MB(uint8 *cand, uint8 *cur, int dmin);
+    int SATD_MB(AVCEncObject *encvid, uint8 *cand, uint8 *cur, int dmin);
 
     /*------------- rate_control.c -------------------*/
 
@@ -773,6 +806,23 @@ extern "C"
     */
     AVCEnc_Status RCUpdateFrame(AVCEncObject *encvid);
 
+    /**
+    This function resets the bits usage stats of a slice encoded on its own copy of the
+    rate control structure, see slice_mt.cpp.
+    \param "rateCtrl" "Pointer to the slice copy of AVCRateControl."
+    \return "void"
+    */
+    void RCInitSlice(AVCRateControl *rateCtrl);
+
+    /**
+    This function adds the bits usage stats of a slice to those of the picture. It is
+    called for each slice in decoding order after they have all been encoded.
+    \param "rateCtrl" "Pointer to AVCRateControl of the picture."
+    \param "sliceRateCtrl" "Pointer to the slice copy of AVCRateControl."
+    \return "void"
+    */
+    void RCUpdateSlice(AVCRateControl *rateCtrl, AVCRateControl *sliceRateCtrl);
+
     /*--------- residual.c -------------------*/
 
     /**
@@ -816,6 +866,65 @@ extern "C"
     int AVCSAD_MB_HTFM(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
 #endif
 
+    /**
+    This function sets the SAD and SATD function pointers to the fastest versions
+    the CPU supports, as reported by x86_cpu_get_features() on x86.
+    \param "functionPointer" "Pointer to AVCEncFuncPtr."
+    \return "void"
+    */
+    void AVCInitFunctionPointers(AVCEncFuncPtr *functionPointer);
+
+#ifdef AVCENC_X86
+    /*------------- sad_sse2.cpp --------------------*/
+
+    /* Same results as the C versions, including where they stop early. */
+    int AVCSAD_Macroblock_SSE2(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
+    int AVCSAD_MB_HalfPel_SSE2xhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_SSE2yh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_SSE2xh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int cost_i16_SSE2(uint8 *org, int org_pitch, uint8 *pred, int min_cost);
+    void cost_i4_SSE2(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost);
+    int SATDChroma_SSE2(uint8 *orgCb, uint8 *orgCr, int org_pitch, uint8 *pred, int min_cost);
+
+    /*------------- sad_avx2.cpp --------------------*/
+
+    int AVCSAD_Macroblock_AVX2(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info);
+    int AVCSAD_MB_HalfPel_AVX2xhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_AVX2yh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int AVCSAD_MB_HalfPel_AVX2xh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info);
+    int cost_i16_AVX2(uint8 *org, int org_pitch, uint8 *pred, int min_cost);
+    int SATDChroma_AVX2(uint8 *orgCb, uint8 *orgCr, int org_pitch, uint8 *pred, int min_cost);
+#endif
+
+
+    /*------------- slice_mt.cpp --------------------*/
+
+    /**
+    This function allocates the slice buffers and starts the worker threads for
+    encoding encvid->numSlices slices per picture on encvid->numThreads threads.
+    \param "avcHandle" "Pointer to the encoder library handle."
+    \return "AVCENC_SUCCESS for success, AVCENC_MEMORY_FAIL or AVCENC_FAIL otherwise."
+    */
+    AVCEnc_Status InitSliceMT(AVCHandle *avcHandle);
+
+    /**
+    This function stops the worker threads and frees what InitSliceMT() allocated.
+    \param "avcHandle" "Pointer to the encoder library handle."
+    \return "void"
+    */
+    void CleanupSliceMT(AVCHandle *avcHandle);
+
+    /**
+    This function encodes all the slices of the current picture on the first call
+    and returns one slice NAL per call, in order.
+    \param "encvid" "Pointer to AVCEncObject."
+    \param "buffer" "Pointer to the output buffer."
+    \param "buf_nal_size" "As input, the size of the buffer, as output the size of the NAL."
+    \return "AVCENC_SUCCESS for a slice, AVCENC_PICTURE_READY for the last slice,
+             AVCENC_BITSTREAM_BUFFER_FULL if the NAL doesn't fit or the status of the
+             failed slice otherwise."
+    */
+    AVCEnc_Status AVCEncodeSliceMT(AVCEncObject *encvid, uint8 *buffer, uint *buf_nal_size);
 
     /*------------- slice.c -------------------------*/
 
@@ -54,6 +54,12 @@ AVCEnc_Status  SetEncodeParam(AVCHandle* avcHandle, AVCEncParams* encParam,
     and VerifyLevel() functions later. */
 
     encvid->fullsearch_enable = encParam->fullsearch;
+    if ((uint)encParam->me_search > AVC_ME_EPZS)
+    {
+        return AVCENC_NOT_SUPPORTED;
+    }
+    encvid->meSearch = encParam->me_search;
+    encvid->meEarlyExit = (encParam->me_early_exit > 65535) ? 65535 : (int)encParam->me_early_exit;
 
     encvid->outOfBandParamSet = ((encParam->out_of_band_param_set == AVC_ON) ? TRUE : FALSE);
 
@@ -529,6 +535,22 @@ AVCEnc_Status  SetEncodeParam(AVCHandle* avcHandle, AVCEncParams* encParam,
 //  rateCtrl->srcInterval = encParam->src_interval;
     rateCtrl->first_frame = 1; /* set this flag for the first time */
 
+    /* slice-parallel encoding, one slice per band of MB rows */
+    encvid->numSlices = 1;
+    encvid->numThreads = 1;
+    if (encParam->num_slices > 1)
+    {
+        if (picParam->num_slice_groups_minus1 > 0) /* one or the other */
+        {
+            return AVCENC_INVALID_NUM_SLICEGROUP;
+        }
+        encvid->numSlices = AVC_MIN(encParam->num_slices, video->PicHeightInMbs);
+        if (encParam->num_threads > 1)
+        {
+            encvid->numThreads = AVC_MIN(encParam->num_threads, encvid->numSlices);
+        }
+    }
+
     /* contrained_setx_flag will be set inside the VerifyProfile called below.*/
     if (!extS && !extP)
     {
@@ -780,6 +802,7 @@ AVCEnc_Status InitFrame(AVCEncObject *encvid)
     video->currPic->PicNum = video->CurrPicNum;
     video->mbNum = 0; /* start from zero MB */
     encvid->currSliceGroup = 0; /* start from slice group #0 */
+    encvid->sliceEndMbAddr = video->PicSizeInMbs; /* AVCEncodeSliceMT sets its own */
     encvid->numIntraMB = 0; /* reset this counter */
 
     if (video->nal_unit_type == AVC_NALTYPE_IDR)
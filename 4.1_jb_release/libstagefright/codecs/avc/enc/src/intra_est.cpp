@@ -45,6 +45,9 @@ bool IntraDecisionABE(AVCEncObject *encvid, int min_cost, uint8 *curL, int picPi
 
     if (((x_pos >> 4) != (int)video->PicWidthInMbs - 1) &&
             ((y_pos >> 4) != (int)video->PicHeightInMbs - 1) &&
+            /* the left column below reaches into the next MB row, which must
+               not belong to another slice that may be encoded concurrently */
+            (video->mbNum + video->PicWidthInMbs < encvid->sliceEndMbAddr) &&
             video->intraAvailA &&
             video->intraAvailB)
     {
@@ -438,7 +441,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate vertical mode */
     if (video->intraAvailB)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Vertical], *min_cost);
+        cost = (*encvid->functionPointer->cost_i16)(orgY, org_pitch, encvid->pred_i16[AVC_I16_Vertical], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
@@ -452,7 +455,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate horizontal mode */
     if (video->intraAvailA)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Horizontal], *min_cost);
+        cost = (*encvid->functionPointer->cost_i16)(orgY, org_pitch, encvid->pred_i16[AVC_I16_Horizontal], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
@@ -463,7 +466,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     }
 
     /* evaluate DC mode */
-    cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_DC], *min_cost);
+    cost = (*encvid->functionPointer->cost_i16)(orgY, org_pitch, encvid->pred_i16[AVC_I16_DC], *min_cost);
     if (cost < *min_cost)
     {
         *min_cost = cost;
@@ -475,7 +478,7 @@ void find_cost_16x16(AVCEncObject *encvid, uint8 *orgY, int *min_cost)
     /* evaluate plane mode */
     if (video->intraAvailA && video->intraAvailB && video->intraAvailD)
     {
-        cost = cost_i16(orgY, org_pitch, encvid->pred_i16[AVC_I16_Plane], *min_cost);
+        cost = (*encvid->functionPointer->cost_i16)(orgY, org_pitch, encvid->pred_i16[AVC_I16_Plane], *min_cost);
         if (cost < *min_cost)
         {
             *min_cost = cost;
@@ -1197,7 +1200,7 @@ int blk_intra4x4_search(AVCEncObject *encvid, int blkidx, uint8 *cur, uint8 *org
             cost  = (ipmode == mostProbableMode) ? 0 : fixedcost;
             pred = encvid->pred_i4[ipmode];
 
-            cost_i4(org, org_pitch, pred, &cost);
+            (*encvid->functionPointer->cost_i4)(org, org_pitch, pred, &cost);
 
             if (cost < min_cost)
             {
@@ -1680,7 +1683,7 @@ void chroma_intra_search(AVCEncObject *encvid)
     orgCr = currInput->YCbCr[2] + offset;
 
     mincost = 0x7fffffff;
-    cost = SATDChroma(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_DC], mincost);
+    cost = (*encvid->functionPointer->SATDChroma)(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_DC], mincost);
     if (cost < mincost)
     {
         mincost = cost;
@@ -1689,7 +1692,7 @@ void chroma_intra_search(AVCEncObject *encvid)
 
     if (video->intraAvailA)
     {
-        cost = SATDChroma(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Horizontal], mincost);
+        cost = (*encvid->functionPointer->SATDChroma)(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Horizontal], mincost);
         if (cost < mincost)
         {
             mincost = cost;
@@ -1699,7 +1702,7 @@ void chroma_intra_search(AVCEncObject *encvid)
 
     if (video->intraAvailB)
     {
-        cost = SATDChroma(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Vertical], mincost);
+        cost = (*encvid->functionPointer->SATDChroma)(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Vertical], mincost);
         if (cost < mincost)
         {
             mincost = cost;
@@ -1709,7 +1712,7 @@ void chroma_intra_search(AVCEncObject *encvid)
 
     if (video->intraAvailA && video->intraAvailB && video->intraAvailD)
     {
-        cost = SATDChroma(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Plane], mincost);
+        cost = (*encvid->functionPointer->SATDChroma)(orgCb, orgCr, org_pitch, encvid->pred_ic[AVC_IC_Plane], mincost);
         if (cost < mincost)
         {
             mincost = cost;
@@ -37,8 +37,6 @@ static void (*const eChromaMC_SIMD[8])(uint8 *, int , int , int , uint8 *, int,
 /* Perform motion prediction and compensation with residue if exist. */
 void AVCMBMotionComp(AVCEncObject *encvid, AVCCommonObj *video)
 {
-    (void)(encvid);
-
     AVCMacroblock *currMB = video->currMB;
     AVCPictureData *currPic = video->currPic;
     int mbPartIdx, subMbPartIdx;
@@ -101,6 +99,11 @@ void AVCMBMotionComp(AVCEncObject *encvid, AVCCommonObj *video)
                             predBlock + offsetP, picPitch, MbWidth, MbHeight);
 
             offsetP = (block_y * picWidth) + (block_x << 1);
+            if (encvid->numSlices == 1) /* else padded up front, shared by all slices */
+            {
+                ePadChroma(ref_Cb, picWidth >> 1, picHeight >> 1, picPitch >> 1, x_pos, y_pos);
+                ePadChroma(ref_Cr, picWidth >> 1, picHeight >> 1, picPitch >> 1, x_pos, y_pos);
+            }
             eChromaMotionComp(ref_Cb, picWidth >> 1, picHeight >> 1, x_pos, y_pos,
                               /*comp_Scb +  offsetC,*/
                               predCb + offsetP, picPitch >> 1, MbWidth >> 1, MbHeight >> 1);
@@ -1815,8 +1818,6 @@ void eChromaMotionComp(uint8 *ref, int picwidth, int picheight,
     int offset_dx, offset_dy;
     int index;
 
-    ePadChroma(ref, picwidth, picheight, picpitch, x_pos, y_pos);
-
     dx = x_pos & 7;
     dy = y_pos & 7;
     offset_dx = (dx + 7) >> 3;
@@ -47,6 +47,22 @@ const static int refine_next[8][2] =    /* [curr_k][increment] */
     {0, 0}, {2, 0}, {1, 1}, {0, 2}, { -1, 1}, { -2, 0}, { -1, -1}, {0, -2}
 };
 
+/* points of the fast search patterns, in circular order */
+const static int small_diamond[4][2] =  /* [k][x, y] */
+{
+    {0, -1}, {1, 0}, {0, 1}, { -1, 0}
+};
+
+const static int hexagon[6][2] =    /* [k][x, y] */
+{
+    { -2, 0}, { -1, -2}, {1, -2}, {2, 0}, {1, 2}, { -1, 2}
+};
+
+const static int square[8][2] = /* [k][x, y] */
+{
+    { -1, -1}, {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, { -1, 1}, { -1, 0}
+};
+
 #ifdef _SAD_STAT
 uint32 num_MB = 0;
 uint32 num_cand = 0;
@@ -298,6 +314,11 @@ void AVCMotionEstimation(AVCEncObject *encvid)
     if (refPic->padded == 0)
     {
         AVCPaddingEdge(refPic);
+        if (encvid->numSlices > 1)
+        {
+            /* slices encoded concurrently must not pad chroma on demand */
+            AVCPaddingEdgeChroma(refPic);
+        }
         refPic->padded = 1;
     }
     /* Random INTRA update */
@@ -562,6 +583,59 @@ void  AVCPaddingEdge(AVCPictureData *refPic)
     return ;
 }
 
+/*=====================================================================
+    Function:   AVCPaddingEdgeChroma
+    Purpose:    Pad 8 pixels around both chroma planes of a picture,
+                the whole border at once instead of block by block as
+                motion compensation does.
+=====================================================================*/
+
+void  AVCPaddingEdgeChroma(AVCPictureData *refPic)
+{
+    uint8 *plane[2];
+    uint8 *src, *dst;
+    int i, k;
+    int pitch, width, height;
+
+    width = refPic->width >> 1;
+    height = refPic->height >> 1;
+    pitch = refPic->pitch >> 1;
+    plane[0] = refPic->Scb;
+    plane[1] = refPic->Scr;
+
+    for (k = 0; k < 2; k++)
+    {
+        /* pad sides */
+        src = plane[k];
+        i = height;
+        while (i--)
+        {
+            memset(src - 8, src[0], 8);
+            memset(src + width, src[width-1], 8);
+            src += pitch;
+        }
+
+        /* pad top and bottom, corners included */
+        src = plane[k] - 8;
+        dst = src;
+        i = 8;
+        while (i--)
+        {
+            memcpy(dst -= pitch, src, pitch);
+        }
+
+        src = plane[k] + (height - 1) * pitch - 8;
+        dst = src;
+        i = 8;
+        while (i--)
+        {
+            memcpy(dst += pitch, src, pitch);
+        }
+    }
+
+    return ;
+}
+
 /*===========================================================================
     Function:   AVCRasterIntraUpdate
     Date:       2/26/01
@@ -1131,74 +1205,127 @@ void AVCMBMotionSearch(AVCEncObject *encvid, uint8 *cur, uint8 *best_cand[],
                 }
             }
 
-            /******************* local refinement ***************************/
-            center_again = 0;
-            last_loc = new_loc = 0;
-            //          ncand = ref + jmin*lx + imin;  /* center of the search */
-            step = 0;
-            dn[0] = dmin;
-            while (!center_again && step <= max_step)
+            if (encvid->meSearch != AVC_ME_SPIRAL)
             {
+                /* (0,0), and for EPZS the predicted MV, are candidates too */
+                mvx[0] = (cmvx + 2) >> 2;
+                mvy[0] = (cmvy + 2) >> 2;
+                mvx[1] = mvy[1] = 0;
+                for (k = (encvid->meSearch == AVC_ME_EPZS) ? 0 : 1; k < 2; k++)
+                {
+                    i = i0 + mvx[k];
+                    j = j0 + mvy[k];
 
-                AVCMoveNeighborSAD(dn, last_loc);
+                    if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
+                    {
+                        cand = ref + i + j * lx;
+                        d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
+                        mvcost = MV_COST(lambda_motion, mvshift, i - i0, j - j0, cmvx, cmvy);
+                        d +=  mvcost;
 
-                center_again = 1;
-                i = imin;
-                j = jmin - 1;
-                cand = ref + i + j * lx;
+                        if (d < dmin)
+                        {
+                            dmin = d;
+                            imin = i;
+                            jmin = j;
+                            ncand = cand;
+                            min_sad = d - mvcost; // for rate control
+                        }
+                    }
+                }
+            }
 
-                /*  starting from [0,-1] */
-                /* spiral check one step at a time*/
-                for (k = 2; k <= 8; k += 2)
+            /******************* local refinement ***************************/
+            if (min_sad <= encvid->meEarlyExit)
+            {
+                *hp_guess = 0; /* good enough, no refinement */
+            }
+            else if (encvid->meSearch == AVC_ME_HEXAGON)
+            {
+                *hp_guess = 0;
+                dmin = AVCPatternSearch(encvid, ref, cur, hexagon, 6, max_step, &imin, &jmin,
+                                        &min_sad, dmin, ilow, ihigh, jlow, jhigh, cmvx, cmvy);
+                dmin = AVCPatternSearch(encvid, ref, cur, square, 8, 1, &imin, &jmin,
+                                        &min_sad, dmin, ilow, ihigh, jlow, jhigh, cmvx, cmvy);
+                ncand = ref + imin + jmin * lx;
+            }
+            else if (encvid->meSearch != AVC_ME_SPIRAL) /* diamond and EPZS */
+            {
+                *hp_guess = 0;
+                dmin = AVCPatternSearch(encvid, ref, cur, small_diamond, 4, max_step, &imin, &jmin,
+                                        &min_sad, dmin, ilow, ihigh, jlow, jhigh, cmvx, cmvy);
+                ncand = ref + imin + jmin * lx;
+            }
+            else
+            {
+                center_again = 0;
+                last_loc = new_loc = 0;
+                //          ncand = ref + jmin*lx + imin;  /* center of the search */
+                step = 0;
+                dn[0] = dmin;
+                while (!center_again && step <= max_step)
                 {
-                    if (!tab_exclude[last_loc][k]) /* exclude last step computation */
-                    {       /* not already computed */
-                        if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
-                        {
-                            d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
-                            mvcost = MV_COST(lambda_motion, mvshift, i - i0, j - j0, cmvx, cmvy);
-                            d += mvcost;
 
-                            dn[k] = d; /* keep it for half pel use */
+                    AVCMoveNeighborSAD(dn, last_loc);
 
-                            if (d < dmin)
+                    center_again = 1;
+                    i = imin;
+                    j = jmin - 1;
+                    cand = ref + i + j * lx;
+
+                    /*  starting from [0,-1] */
+                    /* spiral check one step at a time*/
+                    for (k = 2; k <= 8; k += 2)
+                    {
+                        if (!tab_exclude[last_loc][k]) /* exclude last step computation */
+                        {       /* not already computed */
+                            if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
                             {
-                                ncand = cand;
-                                dmin = d;
-                                imin = i;
-                                jmin = j;
-                                center_again = 0;
-                                new_loc = k;
-                                min_sad = d - mvcost; // for rate control
+                                d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
+                                mvcost = MV_COST(lambda_motion, mvshift, i - i0, j - j0, cmvx, cmvy);
+                                d += mvcost;
+
+                                dn[k] = d; /* keep it for half pel use */
+
+                                if (d < dmin)
+                                {
+                                    ncand = cand;
+                                    dmin = d;
+                                    imin = i;
+                                    jmin = j;
+                                    center_again = 0;
+                                    new_loc = k;
+                                    min_sad = d - mvcost; // for rate control
+                                }
                             }
                         }
-                    }
-                    if (k == 8)  /* end side search*/
-                    {
-                        if (!center_again)
+                        if (k == 8)  /* end side search*/
                         {
-                            k = -1; /* start diagonal search */
-                            cand -= lx;
-                            j--;
+                            if (!center_again)
+                            {
+                                k = -1; /* start diagonal search */
+                                cand -= lx;
+                                j--;
+                            }
+                        }
+                        else
+                        {
+                            next = refine_next[k][0];
+                            i += next;
+                            cand += next;
+                            next = refine_next[k][1];
+                            j += next;
+                            cand += lx * next;
                         }
                     }
-                    else
-                    {
-                        next = refine_next[k][0];
-                        i += next;
-                        cand += next;
-                        next = refine_next[k][1];
-                        j += next;
-                        cand += lx * next;
-                    }
+                    last_loc = new_loc;
+                    step ++;
                 }
-                last_loc = new_loc;
-                step ++;
-            }
-            if (!center_again)
-                AVCMoveNeighborSAD(dn, last_loc);
+                if (!center_again)
+                    AVCMoveNeighborSAD(dn, last_loc);
 
-            *hp_guess = AVCFindMin(dn);
+                *hp_guess = AVCFindMin(dn);
+            }
 
             encvid->rateCtrl->MADofMB[mbnum] = min_sad / 256.0;
         }
@@ -1342,6 +1469,74 @@ int AVCFullSearch(AVCEncObject *encvid, uint8 *prev, uint8 *cur,
     return dmin;
 }
 
+/*===============================================================================
+    Function:   AVCPatternSearch
+    Purpose:    Move the best position (imin, jmin) to the best of the points
+                of a pattern around it, for as long as one of them is better
+                and up to max_step times. After a move, only the point in the
+                same direction and its two neighbors in the pattern are new.
+    Input/Output:   dmin is the cost at (imin, jmin), min_sad its SAD. Returns
+                the new cost, the position and SAD are updated.
+===============================================================================*/
+int AVCPatternSearch(AVCEncObject *encvid, uint8 *prev, uint8 *cur,
+                     const int pattern[][2], int num_points, int max_step,
+                     int *imin, int *jmin, int *min_sad, int dmin,
+                     int ilow, int ihigh, int jlow, int jhigh, int cmvx, int cmvy)
+{
+    AVCCommonObj *video = encvid->common;
+    int (*SAD_Macroblock)(uint8*, uint8*, int, void*) = encvid->functionPointer->SAD_Macroblock;
+    void *extra_info = encvid->sad_extra_info;
+    int lx = video->currPic->pitch; /* with padding */
+    int i0 = (video->mbNum % video->PicWidthInMbs) << 4; /* current position */
+    int j0 = (video->mbNum / video->PicWidthInMbs) << 4;
+    int ic = *imin; /* center of the pattern */
+    int jc = *jmin;
+    int i, j, k, n, d;
+    int dir = -1, best_dir, step;
+
+    int lambda_motion = encvid->lambda_motion;
+    uint8 *mvbits = encvid->mvbits;
+    int mvshift = 2;
+    int mvcost;
+
+    for (step = 0; step < max_step; step++)
+    {
+        best_dir = -1;
+        for (n = 0; n < ((dir < 0) ? num_points : 3); n++)
+        {
+            k = (dir < 0) ? n : (dir + num_points - 1 + n) % num_points;
+            i = ic + pattern[k][0];
+            j = jc + pattern[k][1];
+
+            if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
+            {
+                d = (*SAD_Macroblock)(prev + i + j * lx, cur, (dmin << 16) | lx, extra_info);
+                mvcost = MV_COST(lambda_motion, mvshift, i - i0, j - j0, cmvx, cmvy);
+                d += mvcost;
+
+                if (d < dmin)
+                {
+                    dmin = d;
+                    *imin = i;
+                    *jmin = j;
+                    *min_sad = d - mvcost;
+                    best_dir = k;
+                }
+            }
+        }
+
+        if (best_dir < 0) /* the center is the best */
+        {
+            break;
+        }
+        dir = best_dir;
+        ic = *imin;
+        jc = *jmin;
+    }
+
+    return dmin;
+}
+
 /*===============================================================================
     Function:   AVCCandidateSelection
     Date:       09/16/2000
@@ -753,6 +753,24 @@ void RCPostMB(AVCCommonObj *video, AVCRateControl *rateCtrl, int num_header_bits
     rateCtrl->NumberofTextureBits += rateCtrl->numMBTextureBits;
 }
 
+void RCInitSlice(AVCRateControl *rateCtrl)
+{
+    rateCtrl->NumberofHeaderBits = 0;
+    rateCtrl->NumberofTextureBits = 0;
+    rateCtrl->numMBHeaderBits = 0;
+    rateCtrl->numMBTextureBits = 0;
+}
+
+void RCUpdateSlice(AVCRateControl *rateCtrl, AVCRateControl *sliceRateCtrl)
+{
+    /* the QP is set per picture, so the slices only bring their bits, the
+       frame bits are counted as the slice NALs are output */
+    rateCtrl->numMBHeaderBits = sliceRateCtrl->numMBHeaderBits;
+    rateCtrl->numMBTextureBits = sliceRateCtrl->numMBTextureBits;
+    rateCtrl->NumberofHeaderBits += sliceRateCtrl->NumberofHeaderBits;
+    rateCtrl->NumberofTextureBits += sliceRateCtrl->NumberofTextureBits;
+}
+
 void RCRestoreQP(AVCMacroblock *currMB, AVCCommonObj *video, AVCEncObject *encvid)
 {
     currMB->QPy = video->QPy; /* use previous QP */
@@ -775,7 +793,7 @@ void RCCalculateMAD(AVCEncObject *encvid, AVCMacroblock *currMB, uint8 *orgL, in
             if (currMB->mbMode == AVC_I16)
             {
                 dmin_lx = (0xFFFF << 16) | orgPitch;
-                rateCtrl->MADofMB[video->mbNum] = AVCSAD_Macroblock_C(orgL,
+                rateCtrl->MADofMB[video->mbNum] = (*encvid->functionPointer->SAD_Macroblock)(orgL,
                                                   encvid->pred_i16[currMB->i16Mode], dmin_lx, NULL);
             }
             else /* i4 */
@@ -18,6 +18,10 @@
 #include "avcenc_lib.h"
 #include "sad_inline.h"
 
+#ifdef AVCENC_X86
+#include "x86_cpu.h"
+#endif
+
 #define Cached_lx 176
 
 #ifdef _SAD_STAT
@@ -42,11 +46,56 @@ uint32 num_sad_Blk_call = 0;
 
 
 /* consist of
+void AVCInitFunctionPointers(AVCEncFuncPtr *functionPointer)
 int AVCSAD_Macroblock_C(uint8 *ref,uint8 *blk,int dmin,int lx,void *extra_info)
 int AVCSAD_MB_HTFM_Collect(uint8 *ref,uint8 *blk,int dmin,int lx,void *extra_info)
 int AVCSAD_MB_HTFM(uint8 *ref,uint8 *blk,int dmin,int lx,void *extra_info)
 */
 
+/*==================================================================
+    Function:   AVCInitFunctionPointers
+    Purpose:    Select the SAD and SATD functions for this CPU. All
+                versions give the same results.
+==================================================================*/
+void AVCInitFunctionPointers(AVCEncFuncPtr *functionPointer)
+{
+    functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_C;
+    functionPointer->SAD_MB_HalfPel[0] = NULL;
+    functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_Cxh;
+    functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_Cyh;
+    functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_Cxhyh;
+    functionPointer->cost_i16 = &cost_i16;
+    functionPointer->cost_i4 = &cost_i4;
+    functionPointer->SATDChroma = &SATDChroma;
+
+#ifdef AVCENC_X86
+    uint32 features = x86_cpu_get_features();
+
+    if (features & X86_CPU_SSE2)
+    {
+        functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_SSE2;
+        functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_SSE2xh;
+        functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_SSE2yh;
+        functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_SSE2xhyh;
+        functionPointer->cost_i16 = &cost_i16_SSE2;
+        functionPointer->cost_i4 = &cost_i4_SSE2;
+        functionPointer->SATDChroma = &SATDChroma_SSE2;
+    }
+
+    if (features & X86_CPU_AVX2)
+    {
+        functionPointer->SAD_Macroblock = &AVCSAD_Macroblock_AVX2;
+        functionPointer->SAD_MB_HalfPel[1] = &AVCSAD_MB_HalfPel_AVX2xh;
+        functionPointer->SAD_MB_HalfPel[2] = &AVCSAD_MB_HalfPel_AVX2yh;
+        functionPointer->SAD_MB_HalfPel[3] = &AVCSAD_MB_HalfPel_AVX2xhyh;
+        functionPointer->cost_i16 = &cost_i16_AVX2;
+        functionPointer->SATDChroma = &SATDChroma_AVX2;
+    }
+#endif
+
+    return ;
+}
+
 
 /*==================================================================
     Function:   SAD_Macroblock
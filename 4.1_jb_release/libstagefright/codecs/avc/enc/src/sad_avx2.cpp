@@ -0,0 +1,298 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+int AVCSAD_Macroblock_AVX2(uint8 *ref,uint8 *blk,int dmin_lx,void *extra_info)
+int AVCSAD_MB_HalfPel_AVX2xhyh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int AVCSAD_MB_HalfPel_AVX2yh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int AVCSAD_MB_HalfPel_AVX2xh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int cost_i16_AVX2(uint8 *org,int org_pitch,uint8 *pred,int min_cost)
+int SATDChroma_AVX2(uint8 *orgCb,uint8 *orgCr,int org_pitch,uint8 *pred,int min_cost)
+
+Two rows of a macroblock, or a whole row of 16-bit values, per register.
+Like the SSE2 versions these stop where the C versions do, see sad_sse2.cpp.
+*/
+
+#include <immintrin.h>
+
+#include "avcenc_lib.h"
+#include "sad_x86.h"
+
+/* rows p and p + pitch */
+static inline __m256i Load2Rows(uint8 *p, int pitch)
+{
+    return _mm256_inserti128_si256(
+               _mm256_castsi128_si256(_mm_loadu_si128((__m128i*)p)),
+               _mm_loadu_si128((__m128i*)(p + pitch)), 1);
+}
+
+/* SumRows4 of the row sums in two registers of two rows each */
+static inline __m128i SumRows4x2(__m256i r01, __m256i r23)
+{
+    return SumRows4(_mm256_castsi256_si128(r01), _mm256_extracti128_si256(r01, 1),
+                    _mm256_castsi256_si128(r23), _mm256_extracti128_si256(r23, 1));
+}
+
+/*==================================================================
+    Function:   AVCSAD_Macroblock_AVX2
+    Purpose:    AVX2 version of AVCSAD_Macroblock_C.
+==================================================================*/
+int AVCSAD_Macroblock_AVX2(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_lx >> 16;
+    int lx = dmin_lx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        __m256i r01 = _mm256_sad_epu8(Load2Rows(ref, lx),
+                                      _mm256_loadu_si256((__m256i*)blk));
+        __m256i r23 = _mm256_sad_epu8(Load2Rows(ref + 2 * lx, lx),
+                                      _mm256_loadu_si256((__m256i*)(blk + 32)));
+
+        if (AccumulateSums4(SumRows4x2(r01, r23), &sad, dmin))
+        {
+            break;
+        }
+
+        ref += 4 * lx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+/*==================================================================
+    Function:   AVCSAD_MB_HalfPel_AVX2xhyh, yh, xh
+    Purpose:    AVX2 versions of AVCSAD_MB_HalfPel_Cxhyh, Cyh and Cxh.
+==================================================================*/
+/* p[j] + p[j + 1] of 16 pixels */
+static inline __m256i PairSum(uint8 *p)
+{
+    return _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)p)),
+                            _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)(p + 1))));
+}
+
+/* Two rows of (a + b + c + d + 2) >> 2 from three rows of pair sums */
+static inline __m256i Interp2Rows(__m256i h0, __m256i h1, __m256i h2)
+{
+    const __m256i two = _mm256_set1_epi16(2);
+    __m256i v0 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(h0, h1), two), 2);
+    __m256i v1 = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(h1, h2), two), 2);
+
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xD8);
+}
+
+int AVCSAD_MB_HalfPel_AVX2xhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+    __m256i h0, h1, h2, h3, h4;
+
+    h0 = PairSum(ref);
+
+    for (i = 0; i < 16; i += 4)
+    {
+        h1 = PairSum(ref + rx);
+        h2 = PairSum(ref + 2 * rx);
+        h3 = PairSum(ref + 3 * rx);
+        h4 = PairSum(ref + 4 * rx);
+
+        __m256i r01 = _mm256_sad_epu8(Interp2Rows(h0, h1, h2),
+                                      _mm256_loadu_si256((__m256i*)blk));
+        __m256i r23 = _mm256_sad_epu8(Interp2Rows(h2, h3, h4),
+                                      _mm256_loadu_si256((__m256i*)(blk + 32)));
+
+        if (AccumulateSums4(SumRows4x2(r01, r23), &sad, dmin))
+        {
+            break;
+        }
+
+        h0 = h4;
+        ref += 4 * rx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+static inline int Interp1Sad(uint8 *ref, uint8 *blk, int dmin_rx, int offset)
+{
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        __m256i a01 = _mm256_avg_epu8(Load2Rows(ref, rx), Load2Rows(ref + offset, rx));
+        __m256i a23 = _mm256_avg_epu8(Load2Rows(ref + 2 * rx, rx),
+                                      Load2Rows(ref + 2 * rx + offset, rx));
+        __m256i r01 = _mm256_sad_epu8(a01, _mm256_loadu_si256((__m256i*)blk));
+        __m256i r23 = _mm256_sad_epu8(a23, _mm256_loadu_si256((__m256i*)(blk + 32)));
+
+        if (AccumulateSums4(SumRows4x2(r01, r23), &sad, dmin))
+        {
+            break;
+        }
+
+        ref += 4 * rx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+int AVCSAD_MB_HalfPel_AVX2yh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    return Interp1Sad(ref, blk, dmin_rx, dmin_rx & 0xFFFF);
+}
+
+int AVCSAD_MB_HalfPel_AVX2xh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    return Interp1Sad(ref, blk, dmin_rx, 1);
+}
+
+/*==================================================================
+    Function:   cost_i16_AVX2, SATDChroma_AVX2
+    Purpose:    AVX2 versions of cost_i16 and SATDChroma, a row of
+                residue per register. See Hadamard4Columns.
+==================================================================*/
+static inline __m256i Hadamard4Columns256(__m256i x)
+{
+    const __m256i odd = _mm256_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0,
+                                         -1, 0, -1, 0, -1, 0, -1, 0);
+    const __m256i high = _mm256_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0,
+                                          -1, -1, 0, 0, -1, -1, 0, 0);
+    __m256i y;
+
+    y = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xB1), 0xB1);
+    x = _mm256_add_epi16(_mm256_sub_epi16(_mm256_xor_si256(x, odd), odd), y);
+
+    y = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0x4E), 0x4E);
+    return _mm256_add_epi16(_mm256_sub_epi16(_mm256_xor_si256(x, high), high), y);
+}
+
+static inline void Hadamard4Rows256(__m256i d[4], __m256i v[4])
+{
+    __m256i m0 = _mm256_add_epi16(d[0], d[3]);
+    __m256i m3 = _mm256_sub_epi16(d[0], d[3]);
+    __m256i m1 = _mm256_add_epi16(d[1], d[2]);
+    __m256i m2 = _mm256_sub_epi16(d[1], d[2]);
+
+    v[0] = _mm256_add_epi16(m0, m1);
+    v[1] = _mm256_add_epi16(m2, m3);
+    v[2] = _mm256_sub_epi16(m0, m1);
+    v[3] = _mm256_sub_epi16(m3, m2);
+}
+
+static inline __m256i SumAbs16(__m256i x)
+{
+    return _mm256_madd_epi16(_mm256_abs_epi16(x), _mm256_set1_epi16(1));
+}
+
+int cost_i16_AVX2(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
+{
+    const __m256i notDC = _mm256_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0,
+                                           -1, -1, -1, 0, -1, -1, -1, 0);
+    int16 dc[4][4];
+    __m256i d[4], v[4];
+    __m256i acc = _mm256_setzero_si256();
+    int cost = 0;
+    int j, k;
+
+    for (j = 0; j < 4; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            d[k] = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)org)),
+                                    _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)pred)));
+            org += org_pitch;
+            pred += 16;
+        }
+
+        Hadamard4Rows256(d, v);
+
+        v[0] = Hadamard4Columns256(v[0]);
+        dc[j][0] = (int16)_mm256_extract_epi16(v[0], 0);
+        dc[j][1] = (int16)_mm256_extract_epi16(v[0], 4);
+        dc[j][2] = (int16)_mm256_extract_epi16(v[0], 8);
+        dc[j][3] = (int16)_mm256_extract_epi16(v[0], 12);
+        acc = _mm256_add_epi32(acc, SumAbs16(_mm256_and_si256(v[0], notDC)));
+        acc = _mm256_add_epi32(acc, SumAbs16(Hadamard4Columns256(v[1])));
+        acc = _mm256_add_epi32(acc, SumAbs16(Hadamard4Columns256(v[2])));
+        acc = _mm256_add_epi32(acc, SumAbs16(Hadamard4Columns256(v[3])));
+
+        cost = HorizontalSum(_mm_add_epi32(_mm256_castsi256_si128(acc),
+                                           _mm256_extracti128_si256(acc, 1)));
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+    }
+
+    return DCCost_i16(dc, cost, min_cost);
+}
+
+int SATDChroma_AVX2(uint8 *orgCb, uint8 *orgCr, int org_pitch, uint8 *pred, int min_cost)
+{
+    __m256i d[4], v[4];
+    int cost = 0;
+    int j, k;
+
+    for (j = 0; j < 2; j++)
+    {
+        /* Cb in the low, Cr in the high half as in pred */
+        for (k = 0; k < 4; k++)
+        {
+            __m128i o = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i*)orgCb),
+                                           _mm_loadl_epi64((__m128i*)orgCr));
+
+            d[k] = _mm256_sub_epi16(_mm256_cvtepu8_epi16(o),
+                                    _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)pred)));
+            orgCb += org_pitch;
+            orgCr += org_pitch;
+            pred += 16;
+        }
+
+        Hadamard4Rows256(d, v);
+
+        for (k = 0; k < 4; k += 2)
+        {
+            __m256i s0 = SumAbs16(Hadamard4Columns256(v[k]));
+            __m256i s1 = SumAbs16(Hadamard4Columns256(v[k+1]));
+
+            if (AccumulateSums4(SumRows4x2(s0, s1), &cost, min_cost)) /* early drop out */
+            {
+                return cost;
+            }
+        }
+    }
+
+    return cost;
+}
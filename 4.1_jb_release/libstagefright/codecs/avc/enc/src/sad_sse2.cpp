@@ -0,0 +1,324 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+int AVCSAD_Macroblock_SSE2(uint8 *ref,uint8 *blk,int dmin_lx,void *extra_info)
+int AVCSAD_MB_HalfPel_SSE2xhyh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int AVCSAD_MB_HalfPel_SSE2yh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int AVCSAD_MB_HalfPel_SSE2xh(uint8 *ref,uint8 *blk,int dmin_rx,void *extra_info)
+int cost_i16_SSE2(uint8 *org,int org_pitch,uint8 *pred,int min_cost)
+void cost_i4_SSE2(uint8 *org,int org_pitch,uint8 *pred,uint16 *cost)
+int SATDChroma_SSE2(uint8 *orgCb,uint8 *orgCr,int org_pitch,uint8 *pred,int min_cost)
+
+The C versions stop once the SAD of a row, or the SATD of a group of
+coefficients, takes them over the threshold, and return the sum so far.
+These work on four rows or groups at a time and then find the one the C
+version would have stopped at, so the results are the same.
+*/
+
+#include "avcenc_lib.h"
+#include "sad_x86.h"
+
+/*==================================================================
+    Function:   AVCSAD_Macroblock_SSE2
+    Purpose:    SSE2 version of AVCSAD_Macroblock_C.
+==================================================================*/
+int AVCSAD_Macroblock_SSE2(uint8 *ref, uint8 *blk, int dmin_lx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_lx >> 16;
+    int lx = dmin_lx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        __m128i r0 = _mm_sad_epu8(_mm_loadu_si128((__m128i*)ref),
+                                  _mm_loadu_si128((__m128i*)blk));
+        __m128i r1 = _mm_sad_epu8(_mm_loadu_si128((__m128i*)(ref + lx)),
+                                  _mm_loadu_si128((__m128i*)(blk + 16)));
+        __m128i r2 = _mm_sad_epu8(_mm_loadu_si128((__m128i*)(ref + 2 * lx)),
+                                  _mm_loadu_si128((__m128i*)(blk + 32)));
+        __m128i r3 = _mm_sad_epu8(_mm_loadu_si128((__m128i*)(ref + 3 * lx)),
+                                  _mm_loadu_si128((__m128i*)(blk + 48)));
+
+        if (AccumulateSums4(SumRows4(r0, r1, r2, r3), &sad, dmin))
+        {
+            break;
+        }
+
+        ref += 4 * lx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+/*==================================================================
+    Function:   AVCSAD_MB_HalfPel_SSE2xhyh, yh, xh
+    Purpose:    SSE2 versions of AVCSAD_MB_HalfPel_Cxhyh, Cyh and Cxh.
+==================================================================*/
+/* (a + b + c + d + 2) >> 2 of 16 pixels */
+static inline __m128i Interp2(uint8 *p1, uint8 *p3)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    __m128i a = _mm_loadu_si128((__m128i*)p1);
+    __m128i b = _mm_loadu_si128((__m128i*)(p1 + 1));
+    __m128i c = _mm_loadu_si128((__m128i*)p3);
+    __m128i d = _mm_loadu_si128((__m128i*)(p3 + 1));
+    __m128i lo, hi;
+
+    lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(c, zero));
+    lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(d, zero));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+
+    hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(c, zero));
+    hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(d, zero));
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+int AVCSAD_MB_HalfPel_SSE2xhyh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        __m128i r0 = _mm_sad_epu8(Interp2(ref, ref + rx),
+                                  _mm_loadu_si128((__m128i*)blk));
+        __m128i r1 = _mm_sad_epu8(Interp2(ref + rx, ref + 2 * rx),
+                                  _mm_loadu_si128((__m128i*)(blk + 16)));
+        __m128i r2 = _mm_sad_epu8(Interp2(ref + 2 * rx, ref + 3 * rx),
+                                  _mm_loadu_si128((__m128i*)(blk + 32)));
+        __m128i r3 = _mm_sad_epu8(Interp2(ref + 3 * rx, ref + 4 * rx),
+                                  _mm_loadu_si128((__m128i*)(blk + 48)));
+
+        if (AccumulateSums4(SumRows4(r0, r1, r2, r3), &sad, dmin))
+        {
+            break;
+        }
+
+        ref += 4 * rx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+/* SAD of one row against the rounded average of p and p + offset */
+static inline __m128i Interp1SadRow(uint8 *p, int offset, uint8 *blk)
+{
+    __m128i avg = _mm_avg_epu8(_mm_loadu_si128((__m128i*)p),
+                               _mm_loadu_si128((__m128i*)(p + offset)));
+
+    return _mm_sad_epu8(avg, _mm_loadu_si128((__m128i*)blk));
+}
+
+static inline int Interp1Sad(uint8 *ref, uint8 *blk, int dmin_rx, int offset)
+{
+    int dmin = (uint32)dmin_rx >> 16;
+    int rx = dmin_rx & 0xFFFF;
+    int sad = 0;
+    int i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        __m128i r0 = Interp1SadRow(ref, offset, blk);
+        __m128i r1 = Interp1SadRow(ref + rx, offset, blk + 16);
+        __m128i r2 = Interp1SadRow(ref + 2 * rx, offset, blk + 32);
+        __m128i r3 = Interp1SadRow(ref + 3 * rx, offset, blk + 48);
+
+        if (AccumulateSums4(SumRows4(r0, r1, r2, r3), &sad, dmin))
+        {
+            break;
+        }
+
+        ref += 4 * rx;
+        blk += 64;
+    }
+
+    return sad;
+}
+
+int AVCSAD_MB_HalfPel_SSE2yh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    return Interp1Sad(ref, blk, dmin_rx, dmin_rx & 0xFFFF);
+}
+
+int AVCSAD_MB_HalfPel_SSE2xh(uint8 *ref, uint8 *blk, int dmin_rx, void *extra_info)
+{
+    (void)(extra_info);
+
+    return Interp1Sad(ref, blk, dmin_rx, 1);
+}
+
+/*==================================================================
+    Function:   cost_i16_SSE2
+    Purpose:    SSE2 version of cost_i16. The 4x4 Hadamard transforms
+                are done vertically first, the coefficients are the same.
+==================================================================*/
+/* org - pred of 16 pixels as two vectors of 8 int16 */
+static inline void Residue16(uint8 *org, uint8 *pred, __m128i *lo, __m128i *hi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i o = _mm_loadu_si128((__m128i*)org);
+    __m128i p = _mm_loadu_si128((__m128i*)pred);
+
+    *lo = _mm_sub_epi16(_mm_unpacklo_epi8(o, zero), _mm_unpacklo_epi8(p, zero));
+    *hi = _mm_sub_epi16(_mm_unpackhi_epi8(o, zero), _mm_unpackhi_epi8(p, zero));
+}
+
+int cost_i16_SSE2(uint8 *org, int org_pitch, uint8 *pred, int min_cost)
+{
+    const __m128i notDC = _mm_set_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    int16 dc[4][4];
+    __m128i d[4][2], v[4];
+    __m128i acc = _mm_setzero_si128();
+    int cost = 0;
+    int j, k, h;
+
+    for (j = 0; j < 4; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            Residue16(org, pred, &d[k][0], &d[k][1]);
+            org += org_pitch;
+            pred += 16;
+        }
+
+        for (h = 0; h < 2; h++)
+        {
+            Hadamard4Rows(d[0][h], d[1][h], d[2][h], d[3][h], v);
+
+            v[0] = Hadamard4Columns(v[0]);
+            dc[j][2*h] = (int16)_mm_extract_epi16(v[0], 0);
+            dc[j][2*h+1] = (int16)_mm_extract_epi16(v[0], 4);
+            acc = _mm_add_epi32(acc, SumAbs8(_mm_and_si128(v[0], notDC)));
+            acc = _mm_add_epi32(acc, SumAbs8(Hadamard4Columns(v[1])));
+            acc = _mm_add_epi32(acc, SumAbs8(Hadamard4Columns(v[2])));
+            acc = _mm_add_epi32(acc, SumAbs8(Hadamard4Columns(v[3])));
+        }
+
+        cost = HorizontalSum(acc);
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+    }
+
+    return DCCost_i16(dc, cost, min_cost);
+}
+
+/*==================================================================
+    Function:   cost_i4_SSE2
+    Purpose:    SSE2 version of cost_i4.
+==================================================================*/
+void cost_i4_SSE2(uint8 *org, int org_pitch, uint8 *pred, uint16 *cost)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i o, p, r01, r23, s, t, u;
+    int satd;
+
+    o = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*(int32*)org),
+                           _mm_cvtsi32_si128(*(int32*)(org + org_pitch)));
+    p = _mm_unpacklo_epi32(_mm_cvtsi32_si128(*(int32*)(org + 2 * org_pitch)),
+                           _mm_cvtsi32_si128(*(int32*)(org + 3 * org_pitch)));
+    o = _mm_unpacklo_epi64(o, p);
+    p = _mm_loadu_si128((__m128i*)pred);
+
+    /* rows 0, 1 and rows 3, 2 */
+    r01 = _mm_sub_epi16(_mm_unpacklo_epi8(o, zero), _mm_unpacklo_epi8(p, zero));
+    r23 = _mm_sub_epi16(_mm_unpackhi_epi8(o, zero), _mm_unpackhi_epi8(p, zero));
+    r23 = _mm_shuffle_epi32(r23, 0x4E);
+
+    /* m0, m1 and m3, m2 of the vertical transform */
+    s = _mm_add_epi16(r01, r23);
+    t = _mm_sub_epi16(r01, r23);
+    u = _mm_unpacklo_epi64(s, t);
+    t = _mm_unpackhi_epi64(s, t);
+    s = _mm_add_epi16(u, t);
+    t = _mm_sub_epi16(u, t);
+
+    satd = HorizontalSum(_mm_add_epi32(SumAbs8(Hadamard4Columns(s)),
+                                       SumAbs8(Hadamard4Columns(t))));
+
+    satd = (satd + 1) >> 1;
+    *cost += satd;
+
+    return ;
+}
+
+/*==================================================================
+    Function:   SATDChroma_SSE2
+    Purpose:    SSE2 version of SATDChroma.
+==================================================================*/
+int SATDChroma_SSE2(uint8 *orgCb, uint8 *orgCr, int org_pitch, uint8 *pred, int min_cost)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i cb[4], cr[4], vcb[4], vcr[4];
+    int cost = 0;
+    int j, k;
+
+    for (j = 0; j < 2; j++)
+    {
+        for (k = 0; k < 4; k++)
+        {
+            __m128i p = _mm_loadu_si128((__m128i*)pred);
+            __m128i o;
+
+            o = _mm_loadl_epi64((__m128i*)orgCb);
+            cb[k] = _mm_sub_epi16(_mm_unpacklo_epi8(o, zero), _mm_unpacklo_epi8(p, zero));
+            o = _mm_loadl_epi64((__m128i*)orgCr);
+            cr[k] = _mm_sub_epi16(_mm_unpacklo_epi8(o, zero), _mm_unpackhi_epi8(p, zero));
+
+            orgCb += org_pitch;
+            orgCr += org_pitch;
+            pred += 16;
+        }
+
+        Hadamard4Rows(cb[0], cb[1], cb[2], cb[3], vcb);
+        Hadamard4Rows(cr[0], cr[1], cr[2], cr[3], vcr);
+
+        /* the C version sums Cb and Cr of a row in turn */
+        for (k = 0; k < 4; k += 2)
+        {
+            __m128i sums = SumRows4(SumAbs8(Hadamard4Columns(vcb[k])),
+                                    SumAbs8(Hadamard4Columns(vcr[k])),
+                                    SumAbs8(Hadamard4Columns(vcb[k+1])),
+                                    SumAbs8(Hadamard4Columns(vcr[k+1])));
+
+            if (AccumulateSums4(sums, &cost, min_cost)) /* early drop out */
+            {
+                return cost;
+            }
+        }
+    }
+
+    return cost;
+}
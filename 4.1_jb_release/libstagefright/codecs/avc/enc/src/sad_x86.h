@@ -0,0 +1,160 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#ifndef _SAD_X86_H_
+#define _SAD_X86_H_
+
+/* Helpers shared by the SSE2 and AVX2 SAD and SATD functions */
+
+#include <emmintrin.h>
+
+/* [sum(a), sum(b), sum(c), sum(d)] of four vectors of 4 int32, or of four
+   _mm_sad_epu8 results */
+static inline __m128i SumRows4(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    __m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    __m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+    return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+/* Adds the four sums to *total one at a time. Returns 1 as soon as *total
+   goes over threshold, with *total the sum up to there, as the C loops do. */
+static inline int AccumulateSums4(__m128i sums, int *total, int threshold)
+{
+    int mask;
+
+    sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 4));
+    sums = _mm_add_epi32(sums, _mm_slli_si128(sums, 8));
+    sums = _mm_add_epi32(sums, _mm_set1_epi32(*total));
+
+    mask = _mm_movemask_epi8(_mm_cmpgt_epi32(sums, _mm_set1_epi32(threshold)));
+    if (mask)
+    {
+        int32 partial[4];
+
+        _mm_storeu_si128((__m128i*)partial, sums);
+        *total = partial[__builtin_ctz(mask) >> 2];
+        return 1;
+    }
+
+    *total = _mm_cvtsi128_si32(_mm_shuffle_epi32(sums, 0xFF));
+    return 0;
+}
+
+static inline int HorizontalSum(__m128i x)
+{
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0x4E));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0xB1));
+
+    return _mm_cvtsi128_si32(x);
+}
+
+/* Sum of the absolute values of 8 int16, as 4 int32 */
+static inline __m128i SumAbs8(__m128i x)
+{
+    x = _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+
+    return _mm_madd_epi16(x, _mm_set1_epi16(1));
+}
+
+/* 4-point Hadamard transform of each group of 4 int16. The DC goes to the
+   first of the group, the other coefficients may be reordered or negated,
+   which the absolute sums don't see. */
+static inline __m128i Hadamard4Columns(__m128i x)
+{
+    const __m128i odd = _mm_set_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m128i high = _mm_set_epi16(-1, -1, 0, 0, -1, -1, 0, 0);
+    __m128i y;
+
+    /* a + b, a - b, c + d, c - d */
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+    x = _mm_add_epi16(_mm_sub_epi16(_mm_xor_si128(x, odd), odd), y);
+
+    y = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0x4E), 0x4E);
+    return _mm_add_epi16(_mm_sub_epi16(_mm_xor_si128(x, high), high), y);
+}
+
+/* Vertical 4-point Hadamard transform of four rows, the output rows in the
+   order of the C vertical transforms */
+static inline void Hadamard4Rows(__m128i d0, __m128i d1, __m128i d2, __m128i d3,
+                                 __m128i v[4])
+{
+    __m128i m0 = _mm_add_epi16(d0, d3);
+    __m128i m3 = _mm_sub_epi16(d0, d3);
+    __m128i m1 = _mm_add_epi16(d1, d2);
+    __m128i m2 = _mm_sub_epi16(d1, d2);
+
+    v[0] = _mm_add_epi16(m0, m1);
+    v[1] = _mm_add_epi16(m2, m3);
+    v[2] = _mm_sub_epi16(m0, m1);
+    v[3] = _mm_sub_epi16(m3, m2);
+}
+
+/* The Hadamard of the DC coefficients of cost_i16, dc[block row][block] */
+static inline int DCCost_i16(int16 dc[4][4], int cost, int min_cost)
+{
+    int m0, m1, m2, m3;
+    int j;
+
+    for (j = 0; j < 4; j++)
+    {
+        m0 = dc[j][0];
+        m3 = dc[j][3];
+        m0 >>= 2;
+        m0 += (m3 >> 2);
+        m3 = m0 - (m3 >> 1);
+        m1 = dc[j][1];
+        m2 = dc[j][2];
+        m1 >>= 2;
+        m1 += (m2 >> 2);
+        m2 = m1 - (m2 >> 1);
+        dc[j][0] = (m0 + m1);
+        dc[j][2] = (m0 - m1);
+        dc[j][1] = (m2 + m3);
+        dc[j][3] = (m3 - m2);
+    }
+
+    for (j = 0; j < 4; j++)
+    {
+        m0 = dc[0][j];
+        m3 = dc[3][j];
+        m0 += m3;
+        m3 = m0 - (m3 << 1);
+        m1 = dc[1][j];
+        m2 = dc[2][j];
+        m1 += m2;
+        m2 = m1 - (m2 << 1);
+        m0 = m0 + m1;
+        cost += ((m0 >= 0) ? m0 : -m0);
+        m1 = m0 - (m1 << 1);
+        cost += ((m1 >= 0) ? m1 : -m1);
+        m3 = m2 + m3;
+        cost += ((m3 >= 0) ? m3 : -m3);
+        m2 = m3 - (m2 << 1);
+        cost += ((m2 >= 0) ? m2 : -m2);
+
+        if ((cost >> 1) > min_cost) /* early drop out */
+        {
+            return (cost >> 1);
+        }
+    }
+
+    return (cost >> 1);
+}
+
+#endif /* _SAD_X86_H_ */
@@ -42,7 +42,10 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
     {
         video->mbNum = CurrMbAddr;
         currMB = video->currMB = &(video->mblock[CurrMbAddr]);
-        currMB->slice_id = video->slice_id;  // for deblocking
+        if (currMB->slice_id != (int)video->slice_id) /* set up front by AVCEncodeSliceMT */
+        {
+            currMB->slice_id = video->slice_id;  // for deblocking
+        }
 
         video->mb_x = CurrMbAddr % video->PicWidthInMbs;
         video->mb_y = CurrMbAddr / video->PicWidthInMbs;
@@ -130,6 +133,14 @@ AVCEnc_Status AVCEncodeSlice(AVCEncObject *encvid)
                 break;
             }
         }
+        else if ((uint)CurrMbAddr >= encvid->sliceEndMbAddr)
+        {
+            /* end of one of the slices of AVCEncodeSliceMT, the next one
+               starts with this MB */
+            video->mbNum = CurrMbAddr;
+            status = AVCENC_SUCCESS;
+            break;
+        }
     }
 
     if (video->mb_skip_run > 0)
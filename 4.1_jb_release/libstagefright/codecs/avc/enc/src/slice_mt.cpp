@@ -0,0 +1,463 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#include <pthread.h>
+#include "avcenc_lib.h"
+
+/* Slice-parallel encoding. With numSlices above one, each picture is cut into
+   bands of whole MB rows coded as separate slices. A slice doesn't predict
+   from the MBs of the others, so once InitFrame() has done the motion
+   estimation of the whole picture, the slices are encoded independently, each
+   on its own copy of the encoder state and into its own buffer, by a pool of
+   worker threads and the calling thread. The output doesn't depend on which
+   thread encodes which slice. The loop filter still runs on the whole picture
+   after all the slices are done. */
+
+/* initial size of the slice buffers, a raw MB. They grow as overrun buffers. */
+#define SLICE_BUFFER_BYTES_PER_MB   384
+
+typedef struct tagEncSlice
+{
+    /* copies of the picture state, set up by EncodeOneSlice() */
+    AVCEncObject    encvid;
+    AVCCommonObj    video;
+    AVCSliceHeader  sliceHdr;
+    AVCRateControl  rateCtrl;
+    AVCEncBitstream bitstream;
+
+    uint    firstMbAddr;    /* first MB of the slice */
+    uint    endMbAddr;      /* first MB after the slice */
+    uint8   *buffer;        /* slice NAL */
+    int     bufSize;        /* size of the buffer */
+    uint    size;           /* size of the NAL */
+    AVCEnc_Status status;   /* AVCEncodeSlice() status or the failure */
+} AVCEncSlice;
+
+typedef struct tagEncSliceMT
+{
+    AVCEncSlice *slice;     /* numSlices of them */
+    int     numSlices;
+    int     numWorkers;     /* threads running besides the calling thread */
+    pthread_t *thread;
+
+    bool    syncInit;       /* the mutex and conditions are initialized */
+    pthread_mutex_t mutex;
+    pthread_cond_t  workCond;   /* slices to encode or shutdown */
+    pthread_cond_t  doneCond;   /* all the slices are encoded */
+
+    /* protected by the mutex */
+    AVCEncObject *encvid;   /* picture being encoded */
+    uint    baseSliceId;    /* slice_id of the first slice */
+    int     nextSlice;      /* next slice to pick up */
+    int     numDone;        /* number of slices encoded */
+    bool    shutdown;
+
+    int     nextNAL;        /* next slice to output, -1 before the picture is encoded */
+} AVCEncSliceMT;
+
+/* ======================================================================== */
+/*  Function : EncodeOneSlice()                                             */
+/*  Purpose  : Encode slice k of the picture into its buffer. The picture   */
+/*             state is only read while the slices are encoded, what they   */
+/*             write goes to their copies, to their own MBs and to their    */
+/*             own rows of the reconstructed picture.                       */
+/*  In/out   :                                                              */
+/*  Return   :                                                              */
+/* ======================================================================== */
+static void EncodeOneSlice(AVCEncSliceMT *mt, int k)
+{
+    AVCEncSlice *slice = &mt->slice[k];
+    AVCEncObject *encvid = &slice->encvid;
+    AVCCommonObj *video = &slice->video;
+    AVCEncBitstream *stream = &slice->bitstream;
+    AVCEnc_Status status;
+
+    slice->encvid = *mt->encvid;
+    slice->video = *mt->encvid->common;
+    slice->sliceHdr = *mt->encvid->common->sliceHdr;
+    slice->rateCtrl = *mt->encvid->rateCtrl;
+
+    encvid->common = video;
+    encvid->bitstream = stream;
+    encvid->rateCtrl = &slice->rateCtrl;
+    encvid->sliceMT = NULL;
+    encvid->sliceEndMbAddr = slice->endMbAddr;
+    encvid->numIntraMB = 0;
+    /* the slice buffer is the overrun buffer of the copy, so that it is
+       reallocated if the slice doesn't fit */
+    encvid->overrunBuffer = slice->buffer;
+    encvid->oBSize = slice->bufSize;
+
+    video->sliceHdr = &slice->sliceHdr;
+    video->mbNum = slice->firstMbAddr;
+    video->slice_id = mt->baseSliceId + k;
+
+    RCInitSlice(&slice->rateCtrl);
+
+    BitstreamEncInit(stream, slice->buffer, slice->bufSize, slice->buffer, slice->bufSize);
+    stream->encvid = encvid;
+    BitstreamWriteBits(stream, 8, (video->nal_ref_idc << 5) | (video->nal_unit_type));
+
+    status = InitSlice(encvid);
+    if (status == AVCENC_SUCCESS)
+    {
+        status = EncodeSliceHeader(encvid, stream);
+    }
+    if (status == AVCENC_SUCCESS)
+    {
+        status = AVCEncodeSlice(encvid);
+
+        /* closing the NAL with trailing bits */
+        BitstreamTrailingBits(stream, &slice->size);
+    }
+
+    if (encvid->overrunBuffer != NULL) /* NULL if reallocating it failed */
+    {
+        slice->buffer = encvid->overrunBuffer;
+        slice->bufSize = encvid->oBSize;
+    }
+    slice->size = stream->write_pos;
+    slice->status = status;
+
+    return ;
+}
+
+/* Encodes slices until there are none left to pick up, called with the
+   mutex held */
+static void RunSlices(AVCEncSliceMT *mt)
+{
+    int k;
+
+    while (mt->nextSlice < mt->numSlices)
+    {
+        k = mt->nextSlice++;
+
+        pthread_mutex_unlock(&mt->mutex);
+        EncodeOneSlice(mt, k);
+        pthread_mutex_lock(&mt->mutex);
+
+        if (++mt->numDone == mt->numSlices)
+        {
+            pthread_cond_signal(&mt->doneCond);
+        }
+    }
+
+    return ;
+}
+
+static void *SliceWorker(void *arg)
+{
+    AVCEncSliceMT *mt = (AVCEncSliceMT*) arg;
+
+    pthread_mutex_lock(&mt->mutex);
+    while (!mt->shutdown)
+    {
+        RunSlices(mt);
+        if (!mt->shutdown)
+        {
+            pthread_cond_wait(&mt->workCond, &mt->mutex);
+        }
+    }
+    pthread_mutex_unlock(&mt->mutex);
+
+    return NULL;
+}
+
+/* ======================================================================== */
+/*  Function : InitSliceMT()                                                */
+/*  Purpose  : Cut the picture into encvid->numSlices bands of MB rows,     */
+/*             allocate their buffers and start encvid->numThreads - 1      */
+/*             worker threads.                                              */
+/*  In/out   :                                                              */
+/*  Return   : AVCENC_SUCCESS for success.                                  */
+/* ======================================================================== */
+AVCEnc_Status InitSliceMT(AVCHandle *avcHandle)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCCommonObj *video = encvid->common;
+    void *userData = avcHandle->userData;
+    AVCEncSliceMT *mt;
+    AVCEncSlice *slice;
+    int numSlices = encvid->numSlices;
+    int k;
+
+    mt = (AVCEncSliceMT*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSliceMT), DEFAULT_ATTR);
+    if (mt == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    memset(mt, 0, sizeof(AVCEncSliceMT));
+    encvid->sliceMT = mt; /* for CleanupSliceMT() to undo what is done */
+
+    mt->numSlices = numSlices;
+    mt->nextSlice = numSlices; /* nothing to pick up until a picture comes */
+    mt->nextNAL = -1;
+
+    mt->slice = (AVCEncSlice*) avcHandle->CBAVC_Malloc(userData, sizeof(AVCEncSlice) * numSlices, DEFAULT_ATTR);
+    if (mt->slice == NULL)
+    {
+        return AVCENC_MEMORY_FAIL;
+    }
+    memset(mt->slice, 0, sizeof(AVCEncSlice) * numSlices);
+
+    for (k = 0; k < numSlices; k++)
+    {
+        slice = &mt->slice[k];
+
+        /* the rows are spread as evenly as they can be */
+        slice->firstMbAddr = (k * video->PicHeightInMbs / numSlices) * video->PicWidthInMbs;
+        slice->endMbAddr = ((k + 1) * video->PicHeightInMbs / numSlices) * video->PicWidthInMbs;
+
+        slice->bufSize = (slice->endMbAddr - slice->firstMbAddr) * SLICE_BUFFER_BYTES_PER_MB;
+        slice->buffer = (uint8*) avcHandle->CBAVC_Malloc(userData, slice->bufSize, DEFAULT_ATTR);
+        if (slice->buffer == NULL)
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+    }
+
+    if (pthread_mutex_init(&mt->mutex, NULL) != 0)
+    {
+        return AVCENC_FAIL;
+    }
+    pthread_cond_init(&mt->workCond, NULL);
+    pthread_cond_init(&mt->doneCond, NULL);
+    mt->syncInit = true;
+
+    if (encvid->numThreads > 1)
+    {
+        mt->thread = (pthread_t*) avcHandle->CBAVC_Malloc(userData, sizeof(pthread_t) * (encvid->numThreads - 1), DEFAULT_ATTR);
+        if (mt->thread == NULL)
+        {
+            return AVCENC_MEMORY_FAIL;
+        }
+
+        for (k = 0; k < (int)encvid->numThreads - 1; k++)
+        {
+            if (pthread_create(&mt->thread[k], NULL, SliceWorker, mt) != 0)
+            {
+                return AVCENC_FAIL;
+            }
+            mt->numWorkers++;
+        }
+    }
+
+    return AVCENC_SUCCESS;
+}
+
+/* ======================================================================== */
+/*  Function : CleanupSliceMT()                                             */
+/*  Purpose  : Stop the worker threads and free the slices.                 */
+/*  In/out   :                                                              */
+/*  Return   :                                                              */
+/* ======================================================================== */
+void CleanupSliceMT(AVCHandle *avcHandle)
+{
+    AVCEncObject *encvid = (AVCEncObject*) avcHandle->AVCObject;
+    AVCEncSliceMT *mt = encvid->sliceMT;
+    void *userData = avcHandle->userData;
+    int k;
+
+    if (mt == NULL)
+    {
+        return ;
+    }
+
+    if (mt->syncInit)
+    {
+        pthread_mutex_lock(&mt->mutex);
+        mt->shutdown = true;
+        pthread_cond_broadcast(&mt->workCond);
+        pthread_mutex_unlock(&mt->mutex);
+
+        for (k = 0; k < mt->numWorkers; k++)
+        {
+            pthread_join(mt->thread[k], NULL);
+        }
+
+        pthread_cond_destroy(&mt->doneCond);
+        pthread_cond_destroy(&mt->workCond);
+        pthread_mutex_destroy(&mt->mutex);
+    }
+
+    if (mt->thread)
+    {
+        avcHandle->CBAVC_Free(userData, (int)mt->thread);
+    }
+
+    if (mt->slice)
+    {
+        for (k = 0; k < mt->numSlices; k++)
+        {
+            if (mt->slice[k].buffer)
+            {
+                avcHandle->CBAVC_Free(userData, (int)mt->slice[k].buffer);
+            }
+        }
+        avcHandle->CBAVC_Free(userData, (int)mt->slice);
+    }
+
+    avcHandle->CBAVC_Free(userData, (int)mt);
+    encvid->sliceMT = NULL;
+
+    return ;
+}
+
+/* ======================================================================== */
+/*  Function : EncodePictureSlices()                                        */
+/*  Purpose  : Encode all the slices of the picture and bring their rate    */
+/*             control stats and state back into encvid.                    */
+/*  In/out   :                                                              */
+/*  Return   : AVCENC_SUCCESS for success, or the first slice failure.      */
+/* ======================================================================== */
+static AVCEnc_Status EncodePictureSlices(AVCEncObject *encvid, AVCEncSliceMT *mt)
+{
+    AVCCommonObj *video = encvid->common;
+    AVCEncSlice *slice;
+    AVCEnc_Status status;
+    uint mbAddr;
+    int k;
+
+    /* MBs of different slices are not available to each other, with the
+       slice_ids set before any slice starts */
+    for (k = 0; k < mt->numSlices; k++)
+    {
+        slice = &mt->slice[k];
+        for (mbAddr = slice->firstMbAddr; mbAddr < slice->endMbAddr; mbAddr++)
+        {
+            video->mblock[mbAddr].slice_id = video->slice_id + k;
+        }
+    }
+
+    pthread_mutex_lock(&mt->mutex);
+    mt->encvid = encvid;
+    mt->baseSliceId = video->slice_id;
+    mt->nextSlice = 0;
+    mt->numDone = 0;
+    pthread_cond_broadcast(&mt->workCond);
+
+    RunSlices(mt);
+
+    while (mt->numDone < mt->numSlices)
+    {
+        pthread_cond_wait(&mt->doneCond, &mt->mutex);
+    }
+    pthread_mutex_unlock(&mt->mutex);
+
+    video->slice_id += mt->numSlices;
+
+    for (k = 0; k < mt->numSlices; k++)
+    {
+        slice = &mt->slice[k];
+        status = (k == mt->numSlices - 1) ? AVCENC_PICTURE_READY : AVCENC_SUCCESS;
+        if (slice->status != status)
+        {
+            return (slice->status < AVCENC_SUCCESS) ? slice->status : AVCENC_FAIL;
+        }
+    }
+
+    for (k = 0; k < mt->numSlices; k++)
+    {
+        slice = &mt->slice[k];
+        RCUpdateSlice(encvid->rateCtrl, &slice->rateCtrl);
+        encvid->numIntraMB += slice->encvid.numIntraMB;
+    }
+
+    /* leave the state as the last slice does when they are encoded one
+       after the other, with the picture-wide slice header fields */
+    slice = &mt->slice[mt->numSlices - 1];
+    *video->sliceHdr = mt->slice[0].sliceHdr;
+    video->FilterOffsetA = slice->video.FilterOffsetA;
+    video->FilterOffsetB = slice->video.FilterOffsetB;
+    video->QPy = slice->video.QPy;
+    video->mbNum = slice->video.mbNum;
+
+    return AVCENC_SUCCESS;
+}
+
+/* ======================================================================== */
+/*  Function : AVCEncodeSliceMT()                                           */
+/*  Purpose  : Return the next slice NAL of the picture, encoding all of    */
+/*             them first on the first call.                                */
+/*  In/out   :                                                              */
+/*  Return   : AVCENC_SUCCESS or AVCENC_PICTURE_READY for the last slice.   */
+/* ======================================================================== */
+AVCEnc_Status AVCEncodeSliceMT(AVCEncObject *encvid, uint8 *buffer, uint *buf_nal_size)
+{
+    AVCEncSliceMT *mt = encvid->sliceMT;
+    AVCEncBitstream *bitstream = encvid->bitstream;
+    AVCHandle *avcHandle = encvid->avcHandle;
+    AVCEncSlice *slice;
+    AVCEnc_Status status;
+
+    if (mt->nextNAL < 0)
+    {
+        status = EncodePictureSlices(encvid, mt);
+        if (status != AVCENC_SUCCESS)
+        {
+            return status;
+        }
+        mt->nextNAL = 0;
+    }
+
+    slice = &mt->slice[mt->nextNAL];
+
+    /* as BitstreamEncInit(), for PVAVCEncGetOverrunBuffer() */
+    bitstream->bitstreamBuffer = buffer;
+    bitstream->buf_size = *buf_nal_size;
+    bitstream->overrunBuffer = encvid->overrunBuffer;
+    bitstream->oBSize = encvid->oBSize;
+
+    if (buffer == NULL || slice->size > *buf_nal_size)
+    {
+        if (encvid->overrunBuffer == NULL)
+        {
+            /* can be called again with a bigger buffer */
+            return AVCENC_BITSTREAM_BUFFER_FULL;
+        }
+
+        if ((int)slice->size > encvid->oBSize)
+        {
+            avcHandle->CBAVC_Free(avcHandle->userData, (int)encvid->overrunBuffer);
+
+            encvid->oBSize = (slice->size + 100) & ~0x3;
+            encvid->overrunBuffer = (uint8*) avcHandle->CBAVC_Malloc(avcHandle->userData,
+                                    encvid->oBSize, DEFAULT_ATTR);
+            if (encvid->overrunBuffer == NULL)
+            {
+                encvid->oBSize = 0;
+                return AVCENC_MEMORY_FAIL;
+            }
+        }
+
+        buffer = encvid->overrunBuffer;
+        bitstream->bitstreamBuffer = bitstream->overrunBuffer = encvid->overrunBuffer;
+        bitstream->buf_size = bitstream->oBSize = encvid->oBSize;
+    }
+
+    memcpy(buffer, slice->buffer, slice->size);
+    bitstream->write_pos = slice->size;
+    *buf_nal_size = slice->size;
+
+    if (++mt->nextNAL == mt->numSlices)
+    {
+        mt->nextNAL = -1;
+        return AVCENC_PICTURE_READY;
+    }
+
+    return AVCENC_SUCCESS;
+}
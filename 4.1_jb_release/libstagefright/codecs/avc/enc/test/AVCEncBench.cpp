@@ -0,0 +1,885 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: AVCEncBench.cpp
+ * Brief: Checks the SAD and SATD functions of the AVC encoder, times the
+ *        encoder with each set and with each number of threads, and compares
+ *        the motion search presets
+ *
+ * The SAD and SATD functions of every set the CPU supports are first run on
+ * the same random input as the C versions, with random early-exit
+ * thresholds, and must return the same values. The YUV 4:2:0 input is then
+ * encoded once per set, with the settings of SoftAVCEncoder. The bitstreams
+ * must be identical. With -t, the input is then encoded with the last set on
+ * 1 to that many threads, printing the speedup over one thread. The
+ * bitstreams must be identical too. Exits with 1 on the first difference.
+ *
+ * With -m, the input is then encoded with the last set and each of the speed
+ * presets of SoftAVCEncoder, at QPs 22, 27, 32 and 37 without rate control.
+ * For each preset, the speed over the four runs, the rate and luma PSNR at
+ * each QP, and the BD-rate against the first preset are printed. A negative
+ * BD-rate is a saving in bits at the same PSNR.
+ *
+ * usage: AVCEncBench [-n frames] [-b bitrate] [-r fps] [-p] [-s slices]
+ *                    [-t threads] [-m] [-o out.264] input.yuv width height
+ *
+ *   -p  quarter-pel motion search, which SoftAVCEncoder leaves off
+ *   -s  slices per picture, by default 1, or the -t number of threads
+ *   -t  maximum number of threads of the scaling runs
+ *   -m  compare the motion search presets
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "avcenc_lib.h"
+
+/* biggest NAL unit */
+#define OUT_BUF_SIZE    (4 << 20)
+
+typedef struct
+{
+    const char *pName;
+    const char *pCpu;       /* STAGEFRIGHT_X86_CPU, NULL for the best the CPU has */
+    AVCEncFuncPtr func;
+
+} FunctionSet;
+
+static FunctionSet sets[] =
+{
+    { "c",    "c",    },
+#ifdef AVCENC_X86
+    { "sse2", "sse2", },
+    { "avx2", NULL,   },
+#endif
+};
+
+#define NUM_SETS    ((int)(sizeof(sets) / sizeof(sets[0])))
+
+static uint32 randState;
+
+static uint32 Rand(void)
+{
+    randState = randState * 1664525 + 1013904223;
+    return randState >> 8;
+}
+
+static void SelectSet(const FunctionSet *set)
+{
+    if (set->pCpu != NULL)
+    {
+        setenv("STAGEFRIGHT_X86_CPU", set->pCpu, 1);
+    }
+    else
+    {
+        unsetenv("STAGEFRIGHT_X86_CPU");
+    }
+}
+
+/* Sets whose functions are the same as those of the set before, because the
+   CPU doesn't have the instructions, are not run */
+static int InitSets(void)
+{
+    int i, num = 0;
+
+    for (i = 0; i < NUM_SETS; i++)
+    {
+        SelectSet(&sets[i]);
+        AVCInitFunctionPointers(&sets[i].func);
+
+        if (num > 0 &&
+                sets[i].func.SAD_Macroblock == sets[num - 1].func.SAD_Macroblock)
+        {
+            continue;
+        }
+        sets[num++] = sets[i];
+    }
+
+    return num;
+}
+
+/* Reference pixels, with the current block a noisy copy so that the
+   thresholds are crossed anywhere in the block */
+static void RandomBlock(uint8 *ref, int size, uint8 *blk, int blkSize,
+                        int lx, int width)
+{
+    int i, noise = 1 << (Rand() % 8);
+    int flat = Rand() & 1;
+    int base = Rand() & 0xFF;
+
+    for (i = 0; i < size; i++)
+    {
+        ref[i] = flat ? (uint8)(base + (Rand() % 9) - 4) : (uint8)Rand();
+    }
+    for (i = 0; i < blkSize; i++)
+    {
+        int v = ref[(i / width) * lx + (i % width)] + (int)(Rand() % noise) - noise / 2;
+        blk[i] = (uint8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+}
+
+static int Threshold(int max)
+{
+    switch (Rand() % 4)
+    {
+        case 0:
+            return 0x7FFFFFFF;
+        case 1:
+            return Rand() % 64;
+        default:
+            return Rand() % max;
+    }
+}
+
+static int CheckSet(const FunctionSet *set, const FunctionSet *ref,
+                    int iterations)
+{
+    uint8 pixels[48 * 20] __attribute__((aligned(16)));
+    uint8 blk[16 * 16] __attribute__((aligned(16)));
+    uint8 pred[16 * 16] __attribute__((aligned(16)));
+    int i, k;
+
+    for (i = 0; i < iterations; i++)
+    {
+        int lx = 17 + Rand() % 31;
+        int dmin = Threshold(0xFFFF) & 0xFFFF;
+        int minCost = Threshold(1 << 14);
+        uint8 *org;
+        int a, b;
+
+        /* SAD_Macroblock, lx as in the motion search */
+        RandomBlock(pixels, sizeof(pixels), blk, 256, lx, 16);
+        a = (*ref->func.SAD_Macroblock)(pixels, blk, (dmin << 16) | lx, NULL);
+        b = (*set->func.SAD_Macroblock)(pixels, blk, (dmin << 16) | lx, NULL);
+        if (a != b)
+        {
+            printf("SAD_Macroblock: %s %d, %s %d, iteration %d\n",
+                   ref->pName, a, set->pName, b, i);
+            return 1;
+        }
+
+        /* half-pel SADs, the reference one pixel bigger to the right and below */
+        RandomBlock(pixels, sizeof(pixels), blk, 256, lx, 16);
+        for (k = 1; k < 4; k++)
+        {
+            a = (*ref->func.SAD_MB_HalfPel[k])(pixels, blk, (dmin << 16) | lx, NULL);
+            b = (*set->func.SAD_MB_HalfPel[k])(pixels, blk, (dmin << 16) | lx, NULL);
+            if (a != b)
+            {
+                printf("SAD_MB_HalfPel[%d]: %s %d, %s %d, iteration %d\n",
+                       k, ref->pName, a, set->pName, b, i);
+                return 1;
+            }
+        }
+
+        /* cost_i16, pred is 16x16 */
+        org = pixels + (Rand() % 4);
+        RandomBlock(org, 16 * lx, pred, 256, lx, 16);
+        a = (*ref->func.cost_i16)(org, lx, pred, minCost);
+        b = (*set->func.cost_i16)(org, lx, pred, minCost);
+        if (a != b)
+        {
+            printf("cost_i16: %s %d, %s %d, iteration %d\n",
+                   ref->pName, a, set->pName, b, i);
+            return 1;
+        }
+
+        /* cost_i4, pred is 4x4 and the cost is added to */
+        {
+            uint16 costA = Rand() & 0x3FFF;
+            uint16 costB = costA;
+
+            RandomBlock(org, 4 * lx, pred, 16, lx, 4);
+            (*ref->func.cost_i4)(org, lx, pred, &costA);
+            (*set->func.cost_i4)(org, lx, pred, &costB);
+            if (costA != costB)
+            {
+                printf("cost_i4: %s %d, %s %d, iteration %d\n",
+                       ref->pName, costA, set->pName, costB, i);
+                return 1;
+            }
+        }
+
+        /* SATDChroma, pred is 8x8 Cb next to 8x8 Cr */
+        {
+            uint8 *orgCb = org;
+            uint8 *orgCr = org + 8 * lx;
+            int j;
+
+            RandomBlock(org, 16 * lx, pred, 256, lx, 16);
+            for (j = 0; j < 8; j++)
+            {
+                memcpy(pred + j * 16 + 8, pred + (j + 8) * 16, 8);
+            }
+            a = (*ref->func.SATDChroma)(orgCb, orgCr, lx, pred, minCost);
+            b = (*set->func.SATDChroma)(orgCb, orgCr, lx, pred, minCost);
+            if (a != b)
+            {
+                printf("SATDChroma: %s %d, %s %d, iteration %d\n",
+                       ref->pName, a, set->pName, b, i);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+    Encoder
+------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint8 **dpb;
+    uint numDpb;
+
+} Frames;
+
+static int MallocCb(void *userData, int32 size, int attribute)
+{
+    (void)userData;
+    (void)attribute;
+
+    return (int)(intptr_t)malloc(size);
+}
+
+static void FreeCb(void *userData, int mem)
+{
+    (void)userData;
+
+    free((void *)(intptr_t)mem);
+}
+
+static int DpbAllocCb(void *userData, uint sizeInMbs, uint numBuffers)
+{
+    Frames *frames = (Frames *)userData;
+    uint i;
+
+    frames->dpb = (uint8 **)calloc(numBuffers, sizeof(uint8 *));
+    for (i = 0; i < numBuffers; i++)
+    {
+        frames->dpb[i] = (uint8 *)malloc(sizeInMbs * 384);
+    }
+    frames->numDpb = numBuffers;
+
+    return 1;
+}
+
+static int BindCb(void *userData, int index, uint8 **yuv)
+{
+    Frames *frames = (Frames *)userData;
+
+    *yuv = frames->dpb[index];
+
+    return 1;
+}
+
+static void UnbindCb(void *userData, int index)
+{
+    (void)userData;
+    (void)index;
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static AVCLevel LevelFor(int width, int height)
+{
+    int mbs = ((width + 15) >> 4) * ((height + 15) >> 4);
+
+    if (mbs <= 3600)
+    {
+        return AVC_LEVEL3_1;
+    }
+    return (mbs <= 8192) ? AVC_LEVEL4 : AVC_LEVEL5_1;
+}
+
+/* the speed presets of SoftAVCEncoder, from the slowest */
+typedef struct
+{
+    const char *pName;
+    AVCMESearch search;
+    uint32 earlyExit;
+
+} SearchPreset;
+
+static const SearchPreset presets[] =
+{
+    { "spiral",  AVC_ME_SPIRAL,  0   },
+    { "epzs",    AVC_ME_EPZS,    512 },
+    { "hexagon", AVC_ME_HEXAGON, 768 },
+    { "diamond", AVC_ME_DIAMOND, 768 },
+};
+
+#define NUM_PRESETS ((int)(sizeof(presets) / sizeof(presets[0])))
+
+static const int bdQPs[] = { 22, 27, 32, 37 };
+
+#define NUM_BD_QPS  ((int)(sizeof(bdQPs) / sizeof(bdQPs[0])))
+
+typedef struct
+{
+    const char *pInput;
+    int width, height;
+    int frames;
+    int bitrate;
+    int frameRate;
+    int subPel;
+    int slices;
+    int threads;
+    int qp;                 /* 0 for rate control */
+    const SearchPreset *preset;
+
+} EncodeParams;
+
+typedef struct
+{
+    int frames;
+    uint32 size;
+    uint32 hash;            /* FNV-1a of the stream */
+    double seconds;         /* spent in the encoder */
+    int reconFrames;
+    double psnr;            /* luma, summed over reconFrames */
+
+} EncodeResult;
+
+static double PSNR(const uint8 *org, int orgPitch, const uint8 *rec, int recPitch,
+                   int width, int height)
+{
+    double sse = 0;
+    int i, j, d;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            d = org[i] - rec[i];
+            sse += d * d;
+        }
+        org += orgPitch;
+        rec += recPitch;
+    }
+    if (sse == 0)
+    {
+        return 99.0;
+    }
+    return 10.0 * log10(255.0 * 255.0 * width * height / sse);
+}
+
+/* Adds a NAL unit with its start code to the result and to out */
+static void PutNAL(EncodeResult *result, FILE *out, const uint8 *nal, uint size)
+{
+    static const uint8 startCode[4] = { 0, 0, 0, 1 };
+    uint i;
+
+    for (i = 0; i < 4 + size; i++)
+    {
+        result->hash = (result->hash ^ (i < 4 ? startCode[i] : nal[i - 4])) * 16777619;
+    }
+    result->size += 4 + size;
+
+    if (out != NULL)
+    {
+        fwrite(startCode, 1, 4, out);
+        fwrite(nal, 1, size, out);
+    }
+}
+
+/* Encodes the input with the functions selected by set. The stream goes to
+   out if it isn't NULL. Returns 0, or -1 on error. */
+static int Encode(const FunctionSet *set, const EncodeParams *p, FILE *out,
+                  EncodeResult *result)
+{
+    AVCHandle handle;
+    AVCEncParams params;
+    Frames frames;
+    FILE *input;
+    uint8 *yuv, *nal;
+    int frameSize = p->width * p->height * 3 / 2;
+    AVCEnc_Status status;
+    uint i;
+    double start;
+
+    input = fopen(p->pInput, "rb");
+    if (input == NULL)
+    {
+        printf("cannot open %s\n", p->pInput);
+        return -1;
+    }
+    yuv = (uint8 *)malloc(frameSize);
+    nal = (uint8 *)malloc(OUT_BUF_SIZE);
+
+    memset(&frames, 0, sizeof(frames));
+    memset(&handle, 0, sizeof(handle));
+    handle.userData = &frames;
+    handle.CBAVC_DPBAlloc = DpbAllocCb;
+    handle.CBAVC_FrameBind = BindCb;
+    handle.CBAVC_FrameUnbind = UnbindCb;
+    handle.CBAVC_Malloc = MallocCb;
+    handle.CBAVC_Free = FreeCb;
+
+    /* as SoftAVCEncoder sets them */
+    memset(&params, 0, sizeof(params));
+    params.rate_control = AVC_ON;
+    params.init_CBP_removal_delay = 1600;
+    params.auto_scd = AVC_ON;
+    params.out_of_band_param_set = AVC_ON;
+    params.poc_type = 2;
+    params.log2_max_poc_lsb_minus_4 = 12;
+    params.num_ref_frame = 1;
+    params.num_slice_group = 1;
+    params.db_filter = AVC_ON;
+    params.search_range = 16;
+    params.sub_pel = p->subPel ? AVC_ON : AVC_OFF;
+    params.submb_pred = AVC_OFF;
+    params.me_search = p->preset->search;
+    params.me_early_exit = p->preset->earlyExit;
+    params.num_slices = p->slices;
+    params.num_threads = p->threads;
+    params.width = p->width;
+    params.height = p->height;
+    params.bitrate = p->bitrate;
+    params.frame_rate = 1000 * p->frameRate;
+    params.CPB_size = (uint32)(p->bitrate >> 1);
+    params.idr_period = p->frameRate;
+    if (p->qp > 0)
+    {
+        params.rate_control = AVC_OFF;
+        params.initQP = p->qp;
+    }
+    params.profile = AVC_BASELINE;
+    params.level = LevelFor(p->width, p->height);
+
+    SelectSet(set);
+    memset(result, 0, sizeof(*result));
+    result->hash = 2166136261u;
+
+    start = Now();
+    if (PVAVCEncInitialize(&handle, &params, NULL, NULL) != AVCENC_SUCCESS)
+    {
+        printf("PVAVCEncInitialize failed\n");
+        fclose(input);
+        free(nal);
+        free(yuv);
+        return -1;
+    }
+
+    /* SPS and PPS */
+    for (;;)
+    {
+        uint size = OUT_BUF_SIZE;
+        int type;
+
+        if (PVAVCEncodeNAL(&handle, nal, &size, &type) != AVCENC_SUCCESS)
+        {
+            break;
+        }
+        PutNAL(result, out, nal, size);
+    }
+    result->seconds += Now() - start;
+
+    while (result->frames < p->frames &&
+            fread(yuv, 1, frameSize, input) == (size_t)frameSize)
+    {
+        AVCFrameIO in, recon;
+
+        memset(&in, 0, sizeof(in));
+        in.height = p->height;
+        in.pitch = p->width;
+        in.coding_timestamp = (result->frames * 1000) / p->frameRate;
+        in.disp_order = result->frames;
+        in.YCbCr[0] = yuv;
+        in.YCbCr[1] = yuv + p->width * p->height;
+        in.YCbCr[2] = in.YCbCr[1] + (p->width * p->height >> 2);
+        result->frames++;
+
+        start = Now();
+        status = PVAVCEncSetInput(&handle, &in);
+        if (status == AVCENC_SUCCESS || status == AVCENC_NEW_IDR)
+        {
+            do
+            {
+                uint size = OUT_BUF_SIZE;
+                int type;
+
+                status = PVAVCEncodeNAL(&handle, nal, &size, &type);
+                if (status == AVCENC_SUCCESS || status == AVCENC_PICTURE_READY)
+                {
+                    result->seconds += Now() - start;
+                    PutNAL(result, out, nal, size);
+                    start = Now();
+                }
+            } while (status == AVCENC_SUCCESS);
+
+            if (PVAVCEncGetRecon(&handle, &recon) == AVCENC_SUCCESS)
+            {
+                if (p->qp > 0)
+                {
+                    result->psnr += PSNR(yuv, p->width, recon.YCbCr[0], recon.pitch,
+                                         p->width, p->height);
+                    result->reconFrames++;
+                }
+                PVAVCEncReleaseRecon(&handle, &recon);
+            }
+        }
+        result->seconds += Now() - start;
+    }
+
+    PVAVCCleanUpEncoder(&handle);
+
+    for (i = 0; i < frames.numDpb; i++)
+    {
+        free(frames.dpb[i]);
+    }
+    free(frames.dpb);
+    free(nal);
+    free(yuv);
+    fclose(input);
+
+    return 0;
+}
+
+/* Fits the cubic through the 4 points (x[k], y[k]) and returns the
+   integral of it from x0 to x1 */
+static double CubicIntegral(const double *x, const double *y, double x0, double x1)
+{
+    double m[4][5], c[4], t;
+    int i, j, k;
+
+    for (i = 0; i < 4; i++)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            m[i][j] = pow(x[i], j);
+        }
+        m[i][4] = y[i];
+    }
+    /* Gaussian elimination with partial pivoting */
+    for (k = 0; k < 4; k++)
+    {
+        for (i = k + 1, j = k; i < 4; i++)
+        {
+            if (fabs(m[i][k]) > fabs(m[j][k]))
+            {
+                j = i;
+            }
+        }
+        for (i = 0; i < 5; i++)
+        {
+            t = m[k][i];
+            m[k][i] = m[j][i];
+            m[j][i] = t;
+        }
+        for (i = k + 1; i < 4; i++)
+        {
+            t = m[i][k] / m[k][k];
+            for (j = k; j < 5; j++)
+            {
+                m[i][j] -= t * m[k][j];
+            }
+        }
+    }
+    for (k = 3; k >= 0; k--)
+    {
+        c[k] = m[k][4];
+        for (j = k + 1; j < 4; j++)
+        {
+            c[k] -= m[k][j] * c[j];
+        }
+        c[k] /= m[k][k];
+    }
+
+    t = 0;
+    for (j = 0; j < 4; j++)
+    {
+        t += c[j] * (pow(x1, j + 1) - pow(x0, j + 1)) / (j + 1);
+    }
+    return t;
+}
+
+/* Bjontegaard delta rate of the test curve against the reference one, in
+   percent, over the PSNR range both cover */
+static double BDRate(const double *refRate, const double *refPSNR,
+                     const double *testRate, const double *testPSNR)
+{
+    double refLog[NUM_BD_QPS], testLog[NUM_BD_QPS];
+    double lo, hi, refMin, refMax, testMin, testMax;
+    int k;
+
+    refMin = testMin = 1e9;
+    refMax = testMax = -1e9;
+    for (k = 0; k < NUM_BD_QPS; k++)
+    {
+        refLog[k] = log(refRate[k]);
+        testLog[k] = log(testRate[k]);
+        refMin = fmin(refMin, refPSNR[k]);
+        refMax = fmax(refMax, refPSNR[k]);
+        testMin = fmin(testMin, testPSNR[k]);
+        testMax = fmax(testMax, testPSNR[k]);
+    }
+    lo = fmax(refMin, testMin);
+    hi = fmin(refMax, testMax);
+    if (hi <= lo)
+    {
+        return NAN;
+    }
+
+    return (exp((CubicIntegral(testPSNR, testLog, lo, hi) -
+                 CubicIntegral(refPSNR, refLog, lo, hi)) / (hi - lo)) - 1) * 100;
+}
+
+/* Encodes the input with each preset at each of bdQPs. Returns 0, or -1 on
+   error. */
+static int ComparePresets(const FunctionSet *set, EncodeParams p)
+{
+    double rate[NUM_PRESETS][NUM_BD_QPS], psnr[NUM_PRESETS][NUM_BD_QPS];
+    EncodeResult result;
+    int i, k;
+
+    printf("\n%s, QP", set->pName);
+    for (k = 0; k < NUM_BD_QPS; k++)
+    {
+        printf("   %2d: kbps   PSNR", bdQPs[k]);
+    }
+    printf("   BD-rate\n");
+
+    for (i = 0; i < NUM_PRESETS; i++)
+    {
+        double seconds = 0;
+        int frames = 0;
+
+        p.preset = &presets[i];
+        for (k = 0; k < NUM_BD_QPS; k++)
+        {
+            p.qp = bdQPs[k];
+            if (Encode(set, &p, NULL, &result) < 0)
+            {
+                return -1;
+            }
+            if (result.reconFrames == 0)
+            {
+                printf("%s: no picture encoded\n", presets[i].pName);
+                return -1;
+            }
+            seconds += result.seconds;
+            frames += result.frames;
+            rate[i][k] = result.size * 8.0 * p.frameRate / result.frames / 1000;
+            psnr[i][k] = result.psnr / result.reconFrames;
+        }
+
+        printf("%-8s %7.2f fps", presets[i].pName, frames / seconds);
+        for (k = 0; k < NUM_BD_QPS; k++)
+        {
+            printf(" %8.1f %6.2f", rate[i][k], psnr[i][k]);
+        }
+        if (i > 0)
+        {
+            printf(" %+8.2f%%", BDRate(rate[0], psnr[0], rate[i], psnr[i]));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+static void Usage(void)
+{
+    printf("usage: AVCEncBench [-n frames] [-b bitrate] [-r fps] [-p] [-s slices]\n"
+           "                   [-t threads] [-m] [-o out.264] input.yuv width height\n");
+}
+
+int main(int argc, char **argv)
+{
+    EncodeParams p;
+    EncodeResult results[NUM_SETS];
+    EncodeResult single, multi;
+    const char *pOutput = NULL;
+    int numSets, i, arg, maxThreads = 0, compare = 0;
+
+    p.frames = 100;
+    p.bitrate = 0;
+    p.frameRate = 30;
+    p.subPel = 0;
+    p.slices = 0;
+    p.threads = 1;
+    p.qp = 0;
+    p.preset = &presets[0];
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (!strcmp(argv[arg], "-p"))
+        {
+            p.subPel = 1;
+        }
+        else if (!strcmp(argv[arg], "-m"))
+        {
+            compare = 1;
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-n"))
+        {
+            p.frames = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-b"))
+        {
+            p.bitrate = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-r"))
+        {
+            p.frameRate = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-s"))
+        {
+            p.slices = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-t"))
+        {
+            maxThreads = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-o"))
+        {
+            pOutput = argv[++arg];
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (argc - arg != 3)
+    {
+        Usage();
+        return 1;
+    }
+    p.pInput = argv[arg];
+    p.width = atoi(argv[arg + 1]);
+    p.height = atoi(argv[arg + 2]);
+    if (p.width <= 0 || p.height <= 0 || ((p.width | p.height) & 15) ||
+            p.frames <= 0 || p.frameRate <= 0 || p.slices < 0 || maxThreads < 0)
+    {
+        Usage();
+        return 1;
+    }
+    if (p.bitrate <= 0)
+    {
+        /* about 0.1 bit per pixel */
+        p.bitrate = p.width * p.height / 10 * p.frameRate;
+    }
+    if (p.slices == 0)
+    {
+        p.slices = (maxThreads > 1) ? maxThreads : 1;
+    }
+
+    numSets = InitSets();
+
+    randState = 1;
+    for (i = 1; i < numSets; i++)
+    {
+        if (CheckSet(&sets[i], &sets[0], 100000))
+        {
+            return 1;
+        }
+        printf("%s: same results as %s over 100000 blocks\n",
+               sets[i].pName, sets[0].pName);
+    }
+
+    printf("\n%dx%d, %d bps, %d slice%s%s\n", p.width, p.height, p.bitrate,
+           p.slices, p.slices > 1 ? "s" : "", p.subPel ? ", quarter-pel" : "");
+
+    for (i = 0; i < numSets; i++)
+    {
+        FILE *out = NULL;
+
+        if (i == 0 && pOutput != NULL)
+        {
+            out = fopen(pOutput, "wb");
+            if (out == NULL)
+            {
+                printf("cannot open %s\n", pOutput);
+                return 1;
+            }
+        }
+
+        if (Encode(&sets[i], &p, out, &results[i]) < 0)
+        {
+            return 1;
+        }
+        if (out != NULL)
+        {
+            fclose(out);
+        }
+
+        printf("%-6s %4d frames %8.2f fps %10u bytes\n", sets[i].pName,
+               results[i].frames, results[i].frames / results[i].seconds,
+               results[i].size);
+
+        if (i > 0 && (results[i].size != results[0].size ||
+                      results[i].hash != results[0].hash))
+        {
+            printf("%s: the stream differs from %s\n",
+                   sets[i].pName, sets[0].pName);
+            return 1;
+        }
+    }
+
+    /* scaling, the one thread run again so that all of them are timed alike */
+    if (maxThreads > 0)
+    {
+        printf("\n%s\n", sets[numSets - 1].pName);
+
+        for (p.threads = 1; p.threads <= maxThreads; p.threads++)
+        {
+            if (Encode(&sets[numSets - 1], &p, NULL, &multi) < 0)
+            {
+                return 1;
+            }
+            if (p.threads == 1)
+            {
+                single = multi;
+            }
+
+            printf("%2d thread%s %4d frames %8.2f fps %10u bytes %6.2fx\n",
+                   p.threads, p.threads > 1 ? "s" : " ", multi.frames,
+                   multi.frames / multi.seconds, multi.size,
+                   single.seconds / multi.seconds);
+
+            if (multi.size != single.size || multi.hash != single.hash)
+            {
+                printf("%d threads: the stream differs from 1 thread\n", p.threads);
+                return 1;
+            }
+        }
+        p.threads = 1;
+    }
+
+    if (compare && ComparePresets(&sets[numSets - 1], p) < 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
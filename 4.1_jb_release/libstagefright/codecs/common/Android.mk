@@ -31,3 +31,44 @@ include $(BUILD_SHARED_LIBRARY)
 
 
 
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+# Run-time CPU feature detection for the x86 codec kernels. Every module that
+# links one of the codec libraries built with x86 kernels has to link this
+# one too.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := x86_cpu.c
+
+LOCAL_MODULE := libstagefright_x86_cpu
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include
+
+# Lets STAGEFRIGHT_X86_CPU cap the kernel set, for the conformance tests.
+ifeq ($(TARGET_BUILD_VARIANT),eng)
+LOCAL_CFLAGS += -DX86_CPU_OVERRIDE
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+# The same with STAGEFRIGHT_X86_CPU on all builds, for the benchmarks.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := x86_cpu.c
+
+LOCAL_MODULE := libstagefright_x86_cpu_override
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/include
+
+LOCAL_CFLAGS += -DX86_CPU_OVERRIDE
+
+include $(BUILD_STATIC_LIBRARY)
+
+endif
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86_cpu.h
+ * Brief: Run-time CPU feature detection shared by the x86 codec kernels
+ */
+
+#ifndef X86_CPU_H_
+#define X86_CPU_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Instruction set extensions the codecs have kernels for */
+#define X86_CPU_SSE2            0x00000001
+#define X86_CPU_SSE4_1          0x00000002
+#define X86_CPU_AVX2            0x00000004
+
+/**
+ * Function: x86_cpu_get_features
+ *
+ * Description:
+ * Returns the X86_CPU_* extensions that both the CPU and the operating
+ * system support. Each one implies those before it.
+ *
+ * Built with X86_CPU_OVERRIDE, as on eng builds and in the benchmarks, the
+ * result can be capped by setting the environment variable
+ * STAGEFRIGHT_X86_CPU to "c", "sse2" or "sse41". It is read on every call so
+ * that the benchmarks can compare the kernel sets in one process.
+ *
+ */
+unsigned int x86_cpu_get_features(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* X86_CPU_H_ */
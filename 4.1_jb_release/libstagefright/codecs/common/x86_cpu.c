@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86_cpu.c
+ * Brief: Run-time CPU feature detection shared by the x86 codec kernels
+ */
+
+#include <cpuid.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x86_cpu.h"
+
+/* CPUID.1:EDX */
+#define CPUID1_EDX_SSE2         (1 << 26)
+
+/* CPUID.1:ECX */
+#define CPUID1_ECX_SSE4_1       (1 << 19)
+#define CPUID1_ECX_OSXSAVE      (1 << 27)
+#define CPUID1_ECX_AVX          (1 << 28)
+
+/* CPUID.(EAX=7,ECX=0):EBX */
+#define CPUID7_EBX_AVX2         (1 << 5)
+
+/* XCR0: the OS saves the SSE and AVX register state on context switches */
+#define XCR0_SSE_AVX            0x6
+
+static pthread_once_t x86_cpu_once = PTHREAD_ONCE_INIT;
+static unsigned int x86_cpu_features;
+
+static unsigned int x86_cpu_read_xcr0(void)
+{
+    unsigned int eax, edx;
+
+    /* xgetbv, spelled out for assemblers that predate it */
+    __asm__ volatile (".byte 0x0f, 0x01, 0xd0"
+                      : "=a" (eax), "=d" (edx) : "c" (0));
+
+    return eax;
+}
+
+static void x86_cpu_detect(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int maxLeaf = __get_cpuid_max(0, NULL);
+    unsigned int features = 0;
+
+    if (maxLeaf < 1)
+    {
+        return;
+    }
+
+    __cpuid(1, eax, ebx, ecx, edx);
+
+    if (!(edx & CPUID1_EDX_SSE2))
+    {
+        return;
+    }
+    features |= X86_CPU_SSE2;
+
+    if (!(ecx & CPUID1_ECX_SSE4_1))
+    {
+        x86_cpu_features = features;
+        return;
+    }
+    features |= X86_CPU_SSE4_1;
+
+    if (maxLeaf >= 7
+            && (ecx & CPUID1_ECX_OSXSAVE) && (ecx & CPUID1_ECX_AVX)
+            && (x86_cpu_read_xcr0() & XCR0_SSE_AVX) == XCR0_SSE_AVX)
+    {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+        if (ebx & CPUID7_EBX_AVX2)
+        {
+            features |= X86_CPU_AVX2;
+        }
+    }
+
+    x86_cpu_features = features;
+}
+
+unsigned int x86_cpu_get_features(void)
+{
+    unsigned int features;
+
+    pthread_once(&x86_cpu_once, x86_cpu_detect);
+    features = x86_cpu_features;
+
+#ifdef X86_CPU_OVERRIDE
+    {
+        const char *cap = getenv("STAGEFRIGHT_X86_CPU");
+
+        if (cap != NULL)
+        {
+            if (!strcmp(cap, "c"))
+            {
+                features = 0;
+            }
+            else if (!strcmp(cap, "sse2"))
+            {
+                features &= X86_CPU_SSE2;
+            }
+            else if (!strcmp(cap, "sse41"))
+            {
+                features &= X86_CPU_SSE2 | X86_CPU_SSE4_1;
+            }
+        }
+    }
+#endif
+
+    return features;
+}
@@ -1,21 +1,66 @@
 LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
+LOCAL_SRC_FILES := \
+        FLACParallelEncoder.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        external/flac/include \
+        external/openssl/include
+
+LOCAL_MODULE := libstagefright_flacenc
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
 LOCAL_SRC_FILES := \
         SoftFlacEncoder.cpp
 
 LOCAL_C_INCLUDES := \
         frameworks/av/media/libstagefright/include \
         frameworks/native/include/media/openmax \
-        external/flac/include
+        external/flac/include \
+        external/openssl/include
 
 LOCAL_SHARED_LIBRARIES := \
-        libstagefright libstagefright_omx libstagefright_foundation libutils
+        libstagefright libstagefright_omx libstagefright_foundation libutils \
+        libcrypto
 
 LOCAL_STATIC_LIBRARIES := \
+        libstagefright_flacenc \
         libFLAC \
 
 LOCAL_MODULE := libstagefright_soft_flacenc
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# test utility: times the single and the parallel encoder and checks the frames
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/FlacEncBench.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        external/flac/include \
+        external/openssl/include \
+        $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_flacenc \
+        libFLAC
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright_foundation libutils liblog libcrypto
+
+LOCAL_MODULE := flacenc_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
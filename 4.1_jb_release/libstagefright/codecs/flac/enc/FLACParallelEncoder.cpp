@@ -0,0 +1,718 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FLACParallelEncoder"
+#include <utils/Log.h>
+
+#include "FLACParallelEncoder.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace android {
+
+// CRC-8 (x^8 + x^2 + x + 1) of the frame header and CRC-16
+// (x^16 + x^15 + x^2 + 1) of the whole frame, as in the FLAC spec.
+static uint8_t gCRC8Table[256];
+static uint16_t gCRC16Table[256];
+static pthread_once_t gCRCTablesOnce = PTHREAD_ONCE_INIT;
+
+static void initCRCTables() {
+    for (unsigned i = 0; i < 256; ++i) {
+        unsigned crc8 = i;
+        unsigned crc16 = i << 8;
+
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+            crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+        }
+
+        gCRC8Table[i] = crc8 & 0xff;
+        gCRC16Table[i] = crc16 & 0xffff;
+    }
+}
+
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = gCRC8Table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = (crc << 8) ^ gCRC16Table[(crc >> 8) ^ data[i]];
+    }
+    return crc;
+}
+
+// Frame and sample numbers are coded like UTF-8, up to 36 bits in 7 bytes.
+static size_t utf8Size(const uint8_t *data) {
+    uint8_t x = data[0];
+
+    if (!(x & 0x80)) {
+        return 1;
+    }
+
+    size_t size = 0;
+    while (size < 8 && (x & 0x80)) {
+        x <<= 1;
+        ++size;
+    }
+
+    return (size >= 2 && size <= 7) ? size : 0;
+}
+
+static size_t writeUTF8(uint8_t *data, uint32_t x) {
+    if (x < 0x80) {
+        data[0] = x;
+        return 1;
+    }
+
+    size_t size = 2;
+    while (size < 6 && x >= (1u << (5 * size + 1))) {
+        ++size;
+    }
+
+    for (size_t i = size - 1; i > 0; --i) {
+        data[i] = 0x80 | (x & 0x3f);
+        x >>= 6;
+    }
+    data[0] = (0xff00 >> size) | x;
+
+    return size;
+}
+
+// Copies the fixed blocksize frame in src to dst with the frame number
+// replaced and both CRCs redone. dst has room for size + 5 bytes. Returns
+// the size of the new frame, 0 if src is not a frame libFLAC would write.
+static size_t renumberFrame(
+        const uint8_t *src, size_t size, uint32_t frameNumber, uint8_t *dst) {
+    if (size < 7 || src[0] != 0xff || src[1] != 0xf8) {
+        // Not a sync code, or a variable blocksize frame.
+        return 0;
+    }
+
+    unsigned blockSizeCode = src[2] >> 4;
+    unsigned sampleRateCode = src[2] & 0x0f;
+
+    size_t numberSize = utf8Size(&src[4]);
+    if (numberSize == 0) {
+        return 0;
+    }
+
+    size_t extraSize = 0;
+    if (blockSizeCode == 6) {
+        extraSize += 1;
+    } else if (blockSizeCode == 7) {
+        extraSize += 2;
+    }
+    if (sampleRateCode == 12) {
+        extraSize += 1;
+    } else if (sampleRateCode == 13 || sampleRateCode == 14) {
+        extraSize += 2;
+    }
+
+    size_t srcHeaderSize = 4 + numberSize + extraSize;
+    if (srcHeaderSize + 1 + 2 > size) {
+        return 0;
+    }
+
+    memcpy(dst, src, 4);
+    size_t headerSize = 4 + writeUTF8(&dst[4], frameNumber);
+    memcpy(&dst[headerSize], &src[4 + numberSize], extraSize);
+    headerSize += extraSize;
+
+    dst[headerSize] = crc8(dst, headerSize);
+
+    size_t bodySize = size - (srcHeaderSize + 1) - 2;
+    memcpy(&dst[headerSize + 1], &src[srcHeaderSize + 1], bodySize);
+
+    size_t frameSize = headerSize + 1 + bodySize;
+    uint16_t crc = crc16(dst, frameSize);
+    dst[frameSize] = crc >> 8;
+    dst[frameSize + 1] = crc & 0xff;
+
+    return frameSize + 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct FLACParallelEncoder::Chunk {
+    Chunk()
+        : mPCM(NULL),
+          mData(NULL),
+          mCapacity(0) {
+        reset();
+    }
+
+    ~Chunk() {
+        free(mPCM);
+        mPCM = NULL;
+
+        free(mData);
+        mData = NULL;
+    }
+
+    void reset() {
+        mIndex = 0;
+        mNumSamples = 0;
+        mSize = 0;
+        mFrameEnds.clear();
+        mNextFrame = 0;
+        mStatus = OK;
+        mDone = false;
+    }
+
+    bool reserve(size_t size) {
+        if (mSize + size <= mCapacity) {
+            return true;
+        }
+
+        size_t capacity = mCapacity > 0 ? mCapacity : 65536;
+        while (capacity < mSize + size) {
+            capacity *= 2;
+        }
+
+        uint8_t *data = (uint8_t *)realloc(mData, capacity);
+        if (data == NULL) {
+            return false;
+        }
+
+        mData = data;
+        mCapacity = capacity;
+
+        return true;
+    }
+
+    uint64_t mIndex;
+
+    int16_t *mPCM;
+    size_t mNumSamples;         // per channel
+
+    // The encoded frames, back to back.
+    uint8_t *mData;
+    size_t mSize;
+    size_t mCapacity;
+    Vector<size_t> mFrameEnds;
+
+    size_t mNextFrame;          // first frame not dequeued yet
+    status_t mStatus;
+    bool mDone;
+};
+
+FLACParallelEncoder::FLACParallelEncoder(
+        unsigned numChannels, unsigned sampleRate,
+        unsigned compressionLevel, size_t numThreads)
+    : mNumChannels(numChannels),
+      mSampleRate(sampleRate),
+      mCompressionLevel(compressionLevel),
+      mBlockSize(0),
+      mNumThreads(numThreads),
+      mInitCheck(NO_INIT),
+      mDone(false),
+      mThreads(NULL),
+      mNumThreadsStarted(0),
+      mFilling(NULL),
+      mNextChunkIndex(0),
+      mSawInputEOS(false),
+      mTotalSamples(0),
+      mMinFrameSize(0),
+      mMaxFrameSize(0),
+      mSentEOS(false) {
+    pthread_once(&gCRCTablesOnce, initCRCTables);
+
+    memset(mMD5Digest, 0, sizeof(mMD5Digest));
+    MD5_Init(&mMD5);
+
+    if (mNumThreads == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        mNumThreads = numCPUs > 0 ? numCPUs : 1;
+    }
+
+    // The block size libFLAC picks for this compression level.
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+    if (encoder == NULL) {
+        mInitCheck = NO_MEMORY;
+        return;
+    }
+
+    if (FLAC__stream_encoder_set_compression_level(encoder, mCompressionLevel)) {
+        mBlockSize = FLAC__stream_encoder_get_blocksize(encoder);
+    }
+
+    FLAC__stream_encoder_delete(encoder);
+    encoder = NULL;
+
+    if (mBlockSize == 0) {
+        mInitCheck = UNKNOWN_ERROR;
+        return;
+    }
+
+    mThreads = new pthread_t[mNumThreads];
+
+    for (size_t i = 0; i < mNumThreads; ++i) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+        int err = pthread_create(&mThreads[i], &attr, ThreadWrapper, this);
+
+        pthread_attr_destroy(&attr);
+
+        if (err != 0) {
+            ALOGE("could not start worker thread (%d)", err);
+            break;
+        }
+
+        ++mNumThreadsStarted;
+    }
+
+    mInitCheck = mNumThreadsStarted > 0 ? OK : UNKNOWN_ERROR;
+}
+
+FLACParallelEncoder::~FLACParallelEncoder() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mDone = true;
+        mWorkAvailable.broadcast();
+    }
+
+    for (size_t i = 0; i < mNumThreadsStarted; ++i) {
+        void *dummy;
+        pthread_join(mThreads[i], &dummy);
+    }
+
+    delete[] mThreads;
+    mThreads = NULL;
+
+    // Every chunk on mQueue is on mChunks too.
+    for (List<Chunk *>::iterator it = mChunks.begin(); it != mChunks.end(); ++it) {
+        delete *it;
+    }
+    mChunks.clear();
+    mQueue.clear();
+
+    for (size_t i = 0; i < mFreeChunks.size(); ++i) {
+        delete mFreeChunks.itemAt(i);
+    }
+    mFreeChunks.clear();
+
+    delete mFilling;
+    mFilling = NULL;
+}
+
+status_t FLACParallelEncoder::initCheck() const {
+    return mInitCheck;
+}
+
+FLACParallelEncoder::Chunk *FLACParallelEncoder::allocChunk_l() {
+    Chunk *chunk;
+
+    if (!mFreeChunks.isEmpty()) {
+        chunk = mFreeChunks.itemAt(mFreeChunks.size() - 1);
+        mFreeChunks.removeAt(mFreeChunks.size() - 1);
+
+        chunk->reset();
+        return chunk;
+    }
+
+    chunk = new Chunk;
+    chunk->mPCM = (int16_t *)malloc(
+            kFramesPerChunk * mBlockSize * mNumChannels * sizeof(int16_t));
+
+    if (chunk->mPCM == NULL) {
+        delete chunk;
+        return NULL;
+    }
+
+    return chunk;
+}
+
+status_t FLACParallelEncoder::queueInput(const int16_t *pcm, size_t numFrames) {
+    CHECK(!mSawInputEOS);
+
+    if (mInitCheck != OK) {
+        return mInitCheck;
+    }
+
+    // The MD5 in STREAMINFO is over the little endian samples, which is how
+    // they already are in memory.
+    MD5_Update(&mMD5, pcm, numFrames * mNumChannels * sizeof(int16_t));
+
+    const size_t chunkSamples = kFramesPerChunk * mBlockSize;
+
+    while (numFrames > 0) {
+        if (mFilling == NULL) {
+            Mutex::Autolock autoLock(mLock);
+
+            mFilling = allocChunk_l();
+            if (mFilling == NULL) {
+                return NO_MEMORY;
+            }
+        }
+
+        size_t n = chunkSamples - mFilling->mNumSamples;
+        if (n > numFrames) {
+            n = numFrames;
+        }
+
+        memcpy(&mFilling->mPCM[mFilling->mNumSamples * mNumChannels],
+               pcm, n * mNumChannels * sizeof(int16_t));
+
+        mFilling->mNumSamples += n;
+        pcm += n * mNumChannels;
+        numFrames -= n;
+
+        if (mFilling->mNumSamples == chunkSamples) {
+            status_t err = submitChunk();
+            if (err != OK) {
+                return err;
+            }
+        }
+    }
+
+    return OK;
+}
+
+status_t FLACParallelEncoder::signalEndOfStream() {
+    CHECK(!mSawInputEOS);
+
+    if (mInitCheck != OK) {
+        return mInitCheck;
+    }
+
+    if (mFilling != NULL && mFilling->mNumSamples > 0) {
+        status_t err = submitChunk();
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    MD5_Final(mMD5Digest, &mMD5);
+
+    Mutex::Autolock autoLock(mLock);
+
+    if (mFilling != NULL) {
+        mFreeChunks.push(mFilling);
+        mFilling = NULL;
+    }
+
+    mSawInputEOS = true;
+
+    return OK;
+}
+
+status_t FLACParallelEncoder::submitChunk() {
+    Mutex::Autolock autoLock(mLock);
+
+    while (mQueue.size() >= 2 * mNumThreadsStarted) {
+        mChunkDone.wait(mLock);
+    }
+
+    Chunk *chunk = mFilling;
+    mFilling = NULL;
+
+    chunk->mIndex = mNextChunkIndex++;
+
+    mQueue.push_back(chunk);
+    mChunks.push_back(chunk);
+
+    mWorkAvailable.signal();
+
+    return OK;
+}
+
+ssize_t FLACParallelEncoder::dequeueOutput(
+        uint8_t *data, size_t capacity, bool wait, uint64_t *firstSample) {
+    Chunk *chunk;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        for (;;) {
+            if (mChunks.empty()) {
+                if (!mSawInputEOS) {
+                    return -EAGAIN;
+                }
+
+                mSentEOS = true;
+                return 0;
+            }
+
+            chunk = *mChunks.begin();
+            if (chunk->mDone) {
+                break;
+            }
+
+            if (!wait) {
+                return -EAGAIN;
+            }
+
+            mChunkDone.wait(mLock);
+        }
+    }
+
+    // Only this thread touches a chunk once it is done.
+    if (chunk->mStatus != OK) {
+        return chunk->mStatus;
+    }
+
+    size_t numFrames = chunk->mFrameEnds.size();
+    size_t start =
+        chunk->mNextFrame > 0 ? chunk->mFrameEnds[chunk->mNextFrame - 1] : 0;
+
+    size_t frameStart = start;
+    size_t i = chunk->mNextFrame;
+    while (i < numFrames && chunk->mFrameEnds[i] - start <= capacity) {
+        size_t frameSize = chunk->mFrameEnds[i] - frameStart;
+
+        if (mMinFrameSize == 0 || frameSize < mMinFrameSize) {
+            mMinFrameSize = frameSize;
+        }
+        if (frameSize > mMaxFrameSize) {
+            mMaxFrameSize = frameSize;
+        }
+
+        frameStart = chunk->mFrameEnds[i];
+        ++i;
+    }
+
+    if (i == chunk->mNextFrame) {
+        ALOGE("a %d byte frame does not fit into %d bytes",
+              (int)(chunk->mFrameEnds[i] - start), (int)capacity);
+
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+
+    size_t size = frameStart - start;
+    memcpy(data, &chunk->mData[start], size);
+
+    size_t startSample = chunk->mNextFrame * mBlockSize;
+    size_t endSample = i * mBlockSize;
+    if (endSample > chunk->mNumSamples) {
+        endSample = chunk->mNumSamples;
+    }
+
+    *firstSample = chunk->mIndex * kFramesPerChunk * mBlockSize + startSample;
+    mTotalSamples += endSample - startSample;
+
+    chunk->mNextFrame = i;
+
+    if (i == numFrames) {
+        Mutex::Autolock autoLock(mLock);
+
+        mChunks.erase(mChunks.begin());
+        mFreeChunks.push(chunk);
+    }
+
+    return size;
+}
+
+void FLACParallelEncoder::getStreamHeader(uint8_t header[kStreamHeaderSize]) {
+    memcpy(header, "fLaC", 4);
+
+    // Last metadata block, STREAMINFO, 34 bytes.
+    header[4] = 0x80;
+    header[5] = 0;
+    header[6] = 0;
+    header[7] = 34;
+
+    uint8_t *info = &header[8];
+
+    info[0] = mBlockSize >> 8;
+    info[1] = mBlockSize & 0xff;
+    info[2] = mBlockSize >> 8;
+    info[3] = mBlockSize & 0xff;
+
+    info[4] = (mMinFrameSize >> 16) & 0xff;
+    info[5] = (mMinFrameSize >> 8) & 0xff;
+    info[6] = mMinFrameSize & 0xff;
+    info[7] = (mMaxFrameSize >> 16) & 0xff;
+    info[8] = (mMaxFrameSize >> 8) & 0xff;
+    info[9] = mMaxFrameSize & 0xff;
+
+    // 20 bits sample rate, 3 bits channels - 1, 5 bits bits per sample - 1,
+    // 36 bits total samples.
+    uint64_t x = ((uint64_t)mSampleRate << 44)
+        | ((uint64_t)(mNumChannels - 1) << 41)
+        | ((uint64_t)(16 - 1) << 36)
+        | (mTotalSamples & 0xfffffffffull);
+
+    for (size_t i = 0; i < 8; ++i) {
+        info[10 + i] = (x >> (56 - 8 * i)) & 0xff;
+    }
+
+    // Zero, as in unknown, until the whole stream went out.
+    if (mSentEOS) {
+        memcpy(&info[18], mMD5Digest, 16);
+    } else {
+        memset(&info[18], 0, 16);
+    }
+}
+
+// static
+void *FLACParallelEncoder::ThreadWrapper(void *me) {
+    static_cast<FLACParallelEncoder *>(me)->threadEntry();
+
+    return NULL;
+}
+
+void FLACParallelEncoder::threadEntry() {
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+    FLAC__int32 *pcm32 = (FLAC__int32 *)malloc(
+            kFramesPerChunk * mBlockSize * mNumChannels * sizeof(FLAC__int32));
+
+    for (;;) {
+        Chunk *chunk;
+
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            while (!mDone && mQueue.empty()) {
+                mWorkAvailable.wait(mLock);
+            }
+
+            if (mDone) {
+                break;
+            }
+
+            chunk = *mQueue.begin();
+            mQueue.erase(mQueue.begin());
+
+            // There is room on the queue again.
+            mChunkDone.broadcast();
+        }
+
+        status_t err = NO_MEMORY;
+        if (encoder != NULL && pcm32 != NULL) {
+            err = encodeChunk(encoder, pcm32, chunk);
+        }
+
+        Mutex::Autolock autoLock(mLock);
+        chunk->mStatus = err;
+        chunk->mDone = true;
+        mChunkDone.broadcast();
+    }
+
+    if (encoder != NULL) {
+        FLAC__stream_encoder_delete(encoder);
+        encoder = NULL;
+    }
+
+    free(pcm32);
+    pcm32 = NULL;
+}
+
+// FLAC__stream_encoder_finish() puts the settings back to their defaults,
+// so this runs before every chunk.
+bool FLACParallelEncoder::configure(FLAC__StreamEncoder *encoder) {
+    FLAC__bool ok = true;
+    ok = ok && FLAC__stream_encoder_set_channels(encoder, mNumChannels);
+    ok = ok && FLAC__stream_encoder_set_sample_rate(encoder, mSampleRate);
+    ok = ok && FLAC__stream_encoder_set_bits_per_sample(encoder, 16);
+    ok = ok && FLAC__stream_encoder_set_compression_level(encoder, mCompressionLevel);
+    ok = ok && FLAC__stream_encoder_set_blocksize(encoder, mBlockSize);
+    ok = ok && FLAC__stream_encoder_set_verify(encoder, false);
+    // The caller keeps the MD5 of the whole stream.
+    ok = ok && FLAC__stream_encoder_set_do_md5(encoder, false);
+
+    return ok;
+}
+
+status_t FLACParallelEncoder::encodeChunk(
+        FLAC__StreamEncoder *encoder, FLAC__int32 *pcm32, Chunk *chunk) {
+    if (!configure(encoder)) {
+        return UNKNOWN_ERROR;
+    }
+
+    if (FLAC__stream_encoder_init_stream(
+                encoder,
+                WriteCallback /*write_callback*/,
+                NULL /*seek_callback*/,
+                NULL /*tell_callback*/,
+                NULL /*metadata_callback*/,
+                (void *)chunk /*client_data*/)
+            != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+        return UNKNOWN_ERROR;
+    }
+
+    const size_t numSamples = chunk->mNumSamples * mNumChannels;
+    for (size_t i = 0; i < numSamples; ++i) {
+        pcm32[i] = (FLAC__int32)chunk->mPCM[i];
+    }
+
+    FLAC__bool ok = FLAC__stream_encoder_process_interleaved(
+            encoder, pcm32, chunk->mNumSamples);
+
+    ok = FLAC__stream_encoder_finish(encoder) && ok;
+
+    if (!ok) {
+        return UNKNOWN_ERROR;
+    }
+
+    if (chunk->mFrameEnds.size()
+            != (chunk->mNumSamples + mBlockSize - 1) / mBlockSize) {
+        ALOGE("chunk %lld came out as %d frames",
+              (long long)chunk->mIndex, (int)chunk->mFrameEnds.size());
+        return ERROR_MALFORMED;
+    }
+
+    return OK;
+}
+
+// static
+FLAC__StreamEncoderWriteStatus FLACParallelEncoder::WriteCallback(
+        const FLAC__StreamEncoder * /* encoder */, const FLAC__byte buffer[],
+        size_t bytes, unsigned samples, unsigned current_frame,
+        void *client_data) {
+    Chunk *chunk = static_cast<Chunk *>(client_data);
+
+    if (samples == 0) {
+        // The stream header of this encoder, not needed.
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+    }
+
+    // The frame number can take up to 5 more bytes.
+    if (!chunk->reserve(bytes + 5)) {
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+    }
+
+    size_t size = renumberFrame(
+            buffer, bytes,
+            chunk->mIndex * kFramesPerChunk + current_frame,
+            &chunk->mData[chunk->mSize]);
+
+    if (size == 0) {
+        return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+    }
+
+    chunk->mSize += size;
+    chunk->mFrameEnds.push(chunk->mSize);
+
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+}  // namespace android
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLAC_PARALLEL_ENCODER_H_
+
+#define FLAC_PARALLEL_ENCODER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <openssl/md5.h>
+#include <utils/Errors.h>
+#include <utils/List.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "FLAC/stream_encoder.h"
+
+namespace android {
+
+// Encodes 16 bit PCM into FLAC frames on a pool of worker threads. The input
+// is cut into chunks of kFramesPerChunk blocks, each worker runs its own
+// FLAC__StreamEncoder over a whole chunk and the frames come back out in
+// order, renumbered (with their CRCs redone) as if one encoder had written
+// them. The output only depends on the chunk size, not on the number of
+// threads. STREAMINFO and the MD5 of the input are kept up to date as
+// frames are handed out.
+struct FLACParallelEncoder {
+    enum {
+        kFramesPerChunk = 16,
+        kStreamHeaderSize = 4 + 4 + 34,     // "fLaC", block header, STREAMINFO
+    };
+
+    // numThreads 0: one per online CPU.
+    FLACParallelEncoder(
+            unsigned numChannels, unsigned sampleRate,
+            unsigned compressionLevel, size_t numThreads);
+
+    ~FLACParallelEncoder();
+
+    status_t initCheck() const;
+
+    size_t numThreads() const { return mNumThreads; }
+    unsigned blockSize() const { return mBlockSize; }
+
+    // Takes a copy of numFrames interleaved frames. Full chunks go to the
+    // workers right away; blocks while 2 * numThreads() chunks are still
+    // waiting for a worker.
+    status_t queueInput(const int16_t *pcm, size_t numFrames);
+
+    // Sends the last, partial chunk to the workers.
+    status_t signalEndOfStream();
+
+    // Copies as many whole FLAC frames of the next chunk in order as fit
+    // into data and returns their size, with the index of their first
+    // sample in *firstSample. Returns -EAGAIN if the next chunk is not
+    // encoded yet and wait is false, 0 once everything up to the end of
+    // stream was returned.
+    ssize_t dequeueOutput(
+            uint8_t *data, size_t capacity, bool wait, uint64_t *firstSample);
+
+    // The "fLaC" marker and a STREAMINFO block (the last metadata block)
+    // describing the frames dequeued so far. Complete once dequeueOutput()
+    // returned 0.
+    void getStreamHeader(uint8_t header[kStreamHeaderSize]);
+
+private:
+    struct Chunk;
+
+    unsigned mNumChannels;
+    unsigned mSampleRate;
+    unsigned mCompressionLevel;
+    unsigned mBlockSize;
+    size_t mNumThreads;
+    status_t mInitCheck;
+
+    Mutex mLock;
+    Condition mWorkAvailable;
+    Condition mChunkDone;
+    bool mDone;
+
+    pthread_t *mThreads;
+    size_t mNumThreadsStarted;
+
+    // Chunks waiting for a worker, and all chunks not handed out yet in
+    // stream order.
+    List<Chunk *> mQueue;
+    List<Chunk *> mChunks;
+    Vector<Chunk *> mFreeChunks;
+
+    // Caller side.
+    Chunk *mFilling;
+    uint64_t mNextChunkIndex;
+    bool mSawInputEOS;
+    MD5_CTX mMD5;
+
+    // STREAMINFO of the frames dequeued so far.
+    uint64_t mTotalSamples;
+    size_t mMinFrameSize;
+    size_t mMaxFrameSize;
+    uint8_t mMD5Digest[16];
+    bool mSentEOS;
+
+    static void *ThreadWrapper(void *me);
+    void threadEntry();
+
+    bool configure(FLAC__StreamEncoder *encoder);
+    status_t encodeChunk(
+            FLAC__StreamEncoder *encoder, FLAC__int32 *pcm32, Chunk *chunk);
+
+    static FLAC__StreamEncoderWriteStatus WriteCallback(
+            const FLAC__StreamEncoder *encoder, const FLAC__byte buffer[],
+            size_t bytes, unsigned samples, unsigned current_frame,
+            void *client_data);
+
+    Chunk *allocChunk_l();
+    status_t submitChunk();
+
+    DISALLOW_EVIL_CONSTRUCTORS(FLACParallelEncoder);
+};
+
+}  // namespace android
+
+#endif  // FLAC_PARALLEL_ENCODER_H_
@@ -23,12 +23,19 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
 
+#include <errno.h>
+
 #define FLAC_COMPRESSION_LEVEL_MIN     0
 #define FLAC_COMPRESSION_LEVEL_DEFAULT 5
 #define FLAC_COMPRESSION_LEVEL_MAX     8
 
 namespace android {
 
+// Vendor index of the "OMX.google.android.index.flacEncoderThreads" extension,
+// an OMX_PARAM_U32TYPE on the output port with the number of encoding threads.
+static const OMX_INDEXTYPE kIndexFlacEncoderThreads =
+    (OMX_INDEXTYPE)(OMX_IndexVendorStartUnused + 1);
+
 template<class T>
 static void InitOMXParams(T *params) {
     params->nSize = sizeof(T);
@@ -48,9 +55,14 @@ SoftFlacEncoder::SoftFlacEncoder(
       mNumChannels(1),
       mSampleRate(44100),
       mCompressionLevel(FLAC_COMPRESSION_LEVEL_DEFAULT),
+      mNumThreads(1),
       mEncoderWriteData(false),
       mEncoderReturnedEncodedData(false),
       mEncoderReturnedNbBytes(0),
+      mParallelEncoder(NULL),
+      mAnchorTimeUs(-1),
+      mSawInputEOS(false),
+      mSawOutputEOS(false),
       mInputBufferPcm32(NULL)
 #ifdef WRITE_FLAC_HEADER_IN_FIRST_BUFFER
       , mHeaderOffset(0)
@@ -77,6 +89,8 @@ SoftFlacEncoder::SoftFlacEncoder(
 
 SoftFlacEncoder::~SoftFlacEncoder() {
     ALOGV("SoftFlacEncoder::~SoftFlacEncoder()");
+    delete mParallelEncoder;
+    mParallelEncoder = NULL;
     if (mFlacStreamEncoder != NULL) {
         FLAC__stream_encoder_delete(mFlacStreamEncoder);
         mFlacStreamEncoder = NULL;
@@ -147,6 +161,17 @@ OMX_ERRORTYPE SoftFlacEncoder::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
     ALOGV("SoftFlacEncoder::internalGetParameter(index=0x%x)", index);
 
+    if (index == kIndexFlacEncoderThreads) {
+        OMX_PARAM_U32TYPE *threadParams = (OMX_PARAM_U32TYPE *)params;
+
+        if (threadParams->nPortIndex != 1) {
+            return OMX_ErrorUndefined;
+        }
+
+        threadParams->nU32 = mNumThreads;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamAudioPcm:
         {
@@ -187,6 +212,20 @@ OMX_ERRORTYPE SoftFlacEncoder::internalGetParameter(
 
 OMX_ERRORTYPE SoftFlacEncoder::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
+    if (index == kIndexFlacEncoderThreads) {
+        const OMX_PARAM_U32TYPE *threadParams =
+            (const OMX_PARAM_U32TYPE *)params;
+
+        if (threadParams->nPortIndex != 1 ||
+            threadParams->nU32 > kMaxNumThreads ||
+            mParallelEncoder != NULL) {
+            return OMX_ErrorUndefined;
+        }
+
+        mNumThreads = threadParams->nU32;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamAudioPcm:
         {
@@ -231,6 +270,8 @@ OMX_ERRORTYPE SoftFlacEncoder::internalSetParameter(
             // used only for setting the compression level
             OMX_AUDIO_PARAM_FLACTYPE *flacParams = (OMX_AUDIO_PARAM_FLACTYPE *)params;
             mCompressionLevel = flacParams->nCompressionLevel; // range clamping done inside encoder
+            // the serial encoder is configured with the PCM parameters, the
+            // parallel one with the first input buffer
             return OMX_ErrorNone;
         }
 
@@ -240,6 +281,16 @@ OMX_ERRORTYPE SoftFlacEncoder::internalSetParameter(
     }
 }
 
+OMX_ERRORTYPE SoftFlacEncoder::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.flacEncoderThreads")) {
+        *index = kIndexFlacEncoderThreads;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftFlacEncoder::onQueueFilled(OMX_U32 portIndex) {
 
     ALOGV("SoftFlacEncoder::onQueueFilled(portIndex=%ld)", portIndex);
@@ -248,6 +299,11 @@ void SoftFlacEncoder::onQueueFilled(OMX_U32 portIndex) {
         return;
     }
 
+    if (mNumThreads != 1) {
+        onQueueFilledParallel();
+        return;
+    }
+
     List<BufferInfo *> &inQueue = getPortQueue(0);
     List<BufferInfo *> &outQueue = getPortQueue(1);
 
@@ -326,6 +382,121 @@ void SoftFlacEncoder::onQueueFilled(OMX_U32 portIndex) {
     }
 }
 
+void SoftFlacEncoder::onQueueFilledParallel() {
+    if (mSawOutputEOS) {
+        return;
+    }
+
+    if (mParallelEncoder == NULL) {
+        mParallelEncoder = new FLACParallelEncoder(
+                mNumChannels, mSampleRate, mCompressionLevel, mNumThreads);
+
+        if (mParallelEncoder->initCheck() != OK) {
+            ALOGE("failed to start the parallel encoder");
+            mSignalledError = true;
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            return;
+        }
+
+        ALOGV("encoding on %d threads, %u samples per frame",
+                (int)mParallelEncoder->numThreads(), mParallelEncoder->blockSize());
+    }
+
+    List<BufferInfo *> &inQueue = getPortQueue(0);
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    for (;;) {
+        if (!drainParallelOutput()) {
+            return;
+        }
+
+        // Only take more input while there is somewhere to put the output,
+        // the encoded chunks would pile up otherwise.
+        if (mSawInputEOS || inQueue.empty() || outQueue.empty()) {
+            return;
+        }
+
+        BufferInfo *inInfo = *inQueue.begin();
+        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+        status_t err;
+        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+            err = mParallelEncoder->signalEndOfStream();
+            mSawInputEOS = true;
+        } else {
+            if (mAnchorTimeUs < 0) {
+                mAnchorTimeUs = inHeader->nTimeStamp;
+            }
+
+            const OMX_S16 * const pcm16 =
+                reinterpret_cast<OMX_S16 *>(inHeader->pBuffer + inHeader->nOffset);
+
+            err = mParallelEncoder->queueInput(
+                    pcm16, inHeader->nFilledLen / (2 * mNumChannels));
+        }
+
+        inQueue.erase(inQueue.begin());
+        inInfo->mOwnedByUs = false;
+        notifyEmptyBufferDone(inHeader);
+
+        if (err != OK) {
+            ALOGE(" error encountered during encoding (%d)", err);
+            mSignalledError = true;
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            return;
+        }
+    }
+}
+
+// Fills the output buffers with the frames encoded so far, all the frames
+// once the input reached the end of stream. Returns false after an error
+// or the EOS output buffer.
+bool SoftFlacEncoder::drainParallelOutput() {
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    while (!outQueue.empty()) {
+        BufferInfo *outInfo = *outQueue.begin();
+        OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+        uint64_t firstSample;
+        ssize_t n = mParallelEncoder->dequeueOutput(
+                outHeader->pBuffer, outHeader->nAllocLen,
+                mSawInputEOS /* wait */, &firstSample);
+
+        if (n == -EAGAIN) {
+            return true;
+        }
+
+        if (n < 0) {
+            ALOGE(" error encountered during encoding (%d)", (int)n);
+            mSignalledError = true;
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            return false;
+        }
+
+        outHeader->nOffset = 0;
+        outHeader->nFilledLen = n;
+
+        if (n == 0) {
+            outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+            mSawOutputEOS = true;
+        } else {
+            outHeader->nFlags = 0;
+            outHeader->nTimeStamp = (mAnchorTimeUs < 0 ? 0 : mAnchorTimeUs)
+                + (int64_t)(firstSample * 1000000ll / mSampleRate);
+        }
+
+        outQueue.erase(outQueue.begin());
+        outInfo->mOwnedByUs = false;
+        notifyFillBufferDone(outHeader);
+
+        if (mSawOutputEOS) {
+            return false;
+        }
+    }
+
+    return true;
+}
 
 FLAC__StreamEncoderWriteStatus SoftFlacEncoder::onEncodedFlacAvailable(
             const FLAC__byte buffer[],
@@ -22,6 +22,8 @@
 
 #include "FLAC/stream_encoder.h"
 
+#include "FLACParallelEncoder.h"
+
 // use this symbol to have the first output buffer start with FLAC frame header so a dump of
 // all the output buffers can be opened as a .flac file
 //#define WRITE_FLAC_HEADER_IN_FIRST_BUFFER
@@ -45,6 +47,9 @@ protected:
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
 
 private:
@@ -53,6 +58,7 @@ private:
         kNumBuffers = 2,
         kMaxNumSamplesPerFrame = 1152,
         kMaxOutputBufferSize = 65536,    //TODO check if this can be reduced
+        kMaxNumThreads = 16,
     };
 
     bool mSignalledError;
@@ -61,6 +67,10 @@ private:
     OMX_U32 mSampleRate;
     OMX_U32 mCompressionLevel;
 
+    // 1: a single FLAC__StreamEncoder on this thread, otherwise chunks of
+    // frames on a FLACParallelEncoder with this many workers (0: one per CPU)
+    OMX_U32 mNumThreads;
+
     // should the data received by the callback be written to the output port
     bool        mEncoderWriteData;
     bool        mEncoderReturnedEncodedData;
@@ -69,8 +79,17 @@ private:
 
     FLAC__StreamEncoder* mFlacStreamEncoder;
 
+    // parallel mode, created with the first input buffer
+    FLACParallelEncoder *mParallelEncoder;
+    int64_t mAnchorTimeUs;
+    bool mSawInputEOS;
+    bool mSawOutputEOS;
+
     void initPorts();
 
+    void onQueueFilledParallel();
+    bool drainParallelOutput();
+
     OMX_ERRORTYPE configureEncoder();
 
     // FLAC encoder callbacks
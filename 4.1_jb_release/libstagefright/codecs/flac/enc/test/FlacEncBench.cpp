@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Encodes synthetic 16 bit PCM at 44.1, 96 and 192 kHz with one
+ * FLAC__StreamEncoder, the way SoftFlacEncoder does in its default mode,
+ * and with FLACParallelEncoder on 1, 2, 4 .. N threads, and prints how many
+ * times faster than realtime each one runs.
+ *
+ * Every parallel stream is checked frame by frame: sync code, frame
+ * numbers counting up from 0, header CRC-8 and frame CRC-16. The streams
+ * have to be identical for all thread counts, and identical to the single
+ * encoder's frames except at compression levels 1 and 4, whose adaptive
+ * mid-side stereo carries state from one frame to the next. The MD5 in
+ * STREAMINFO has to match the input.
+ *
+ * Usage: flacenc_bench [-s seconds] [-l level] [-c channels] [-j threads]
+ *                      [-o dir]
+ *
+ * With -o the parallel stream of each rate is also written out as a .flac
+ * file.
+ *
+ * This times libFLAC and FLACParallelEncoder directly. The component,
+ * SoftFlacEncoder, with its OMX buffer handling is timed by
+ * "codec_component_bench -e flac" in libstagefright/tests.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <math.h>
+
+#include <openssl/md5.h>
+
+#include "FLACParallelEncoder.h"
+
+using namespace android;
+
+static const size_t kInputFrames = 1152;        // SoftFlacEncoder input buffer
+static const size_t kOutputBufferSize = 65536;  // SoftFlacEncoder output buffer
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_sec * 1000000ll + tv.tv_usec;
+}
+
+static uint32_t gSeed = 1;
+
+static uint32_t Rand() {
+    gSeed = gSeed * 1103515245 + 12345;
+    return gSeed >> 8;
+}
+
+// A few partials with vibrato under a slow envelope, and noise bursts, so
+// that the predictor has something to do and the residual is not flat.
+static void generatePCM(int16_t *pcm, size_t numFrames, unsigned numChannels,
+                        unsigned sampleRate) {
+    static const double kPartials[5] = { 1.0, 2.0, 3.0, 5.0, 8.0 };
+
+    double f0 = 110.0;
+    double phase[5] = { 0, 0, 0, 0, 0 };
+    double noiseLevel = 0.0;
+
+    for (size_t i = 0; i < numFrames; ++i) {
+        if (i % (sampleRate / 2) == 0) {
+            f0 = 110.0 * pow(2.0, (Rand() % 36) / 12.0);
+            noiseLevel = (Rand() % 4 == 0) ? 2000.0 : 0.0;
+        }
+
+        double t = (double)i / sampleRate;
+        double vibrato = 1.0 + 0.003 * sin(2.0 * M_PI * 5.0 * t);
+        double envelope = 0.5 + 0.5 * sin(2.0 * M_PI * 0.25 * t);
+
+        double x = 0.0;
+        for (size_t k = 0; k < 5; ++k) {
+            phase[k] += 2.0 * M_PI * f0 * kPartials[k] * vibrato / sampleRate;
+            x += sin(phase[k]) * 6000.0 / (k + 1);
+        }
+        x *= envelope;
+
+        noiseLevel *= 0.9995;
+
+        for (unsigned c = 0; c < numChannels; ++c) {
+            double noise = ((int)(Rand() % 2001) - 1000) * noiseLevel / 1000.0;
+            double y = x * (c == 0 ? 1.0 : 0.8) + noise;
+
+            if (y > 32767) {
+                y = 32767;
+            } else if (y < -32768) {
+                y = -32768;
+            }
+
+            pcm[i * numChannels + c] = (int16_t)y;
+        }
+    }
+}
+
+struct Output {
+    Output() : mData(NULL), mSize(0), mCapacity(0) {}
+    ~Output() { free(mData); }
+
+    void append(const uint8_t *data, size_t size) {
+        if (mSize + size > mCapacity) {
+            mCapacity = (mSize + size) * 2;
+            mData = (uint8_t *)realloc(mData, mCapacity);
+        }
+
+        memcpy(&mData[mSize], data, size);
+        mSize += size;
+    }
+
+    uint8_t *mData;
+    size_t mSize;
+    size_t mCapacity;
+};
+
+static FLAC__StreamEncoderWriteStatus serialWriteCallback(
+        const FLAC__StreamEncoder * /* encoder */, const FLAC__byte buffer[],
+        size_t bytes, unsigned samples, unsigned /* current_frame */,
+        void *client_data) {
+    if (samples > 0) {
+        static_cast<Output *>(client_data)->append(buffer, bytes);
+    }
+
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+static bool encodeSerial(
+        const int16_t *pcm, size_t numFrames, unsigned numChannels,
+        unsigned sampleRate, unsigned level, Output *output) {
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+
+    FLAC__bool ok = encoder != NULL;
+    ok = ok && FLAC__stream_encoder_set_channels(encoder, numChannels);
+    ok = ok && FLAC__stream_encoder_set_sample_rate(encoder, sampleRate);
+    ok = ok && FLAC__stream_encoder_set_bits_per_sample(encoder, 16);
+    ok = ok && FLAC__stream_encoder_set_compression_level(encoder, level);
+    ok = ok && FLAC__stream_encoder_set_verify(encoder, false);
+    ok = ok && FLAC__STREAM_ENCODER_INIT_STATUS_OK ==
+            FLAC__stream_encoder_init_stream(
+                    encoder, serialWriteCallback, NULL, NULL, NULL, output);
+
+    FLAC__int32 pcm32[kInputFrames * 8];
+
+    for (size_t i = 0; ok && i < numFrames; i += kInputFrames) {
+        size_t n = numFrames - i < kInputFrames ? numFrames - i : kInputFrames;
+
+        for (size_t k = 0; k < n * numChannels; ++k) {
+            pcm32[k] = pcm[i * numChannels + k];
+        }
+
+        ok = FLAC__stream_encoder_process_interleaved(encoder, pcm32, n);
+    }
+
+    if (encoder != NULL) {
+        ok = FLAC__stream_encoder_finish(encoder) && ok;
+        FLAC__stream_encoder_delete(encoder);
+    }
+
+    return ok;
+}
+
+static bool encodeParallel(
+        const int16_t *pcm, size_t numFrames, unsigned numChannels,
+        unsigned sampleRate, unsigned level, size_t numThreads,
+        Output *output, uint8_t header[FLACParallelEncoder::kStreamHeaderSize]) {
+    FLACParallelEncoder encoder(numChannels, sampleRate, level, numThreads);
+    if (encoder.initCheck() != OK) {
+        return false;
+    }
+
+    uint8_t *buffer = (uint8_t *)malloc(kOutputBufferSize);
+    uint64_t expectedSample = 0;
+    bool ok = true;
+
+    // Same order of calls as SoftFlacEncoder: whatever is done goes out
+    // before the next input buffer, everything once the input ended.
+    for (size_t i = 0; ok; i += kInputFrames) {
+        for (;;) {
+            uint64_t firstSample;
+            ssize_t n = encoder.dequeueOutput(
+                    buffer, kOutputBufferSize, i >= numFrames, &firstSample);
+
+            if (n == -EAGAIN || n == 0) {
+                break;
+            }
+
+            if (n < 0 || firstSample < expectedSample) {
+                fprintf(stderr, "dequeueOutput: %d, first sample %lld\n",
+                        (int)n, (long long)firstSample);
+                ok = false;
+                break;
+            }
+
+            output->append(buffer, n);
+            expectedSample = firstSample + 1;
+        }
+
+        if (i >= numFrames) {
+            break;
+        }
+
+        size_t n = numFrames - i < kInputFrames ? numFrames - i : kInputFrames;
+        if (encoder.queueInput(&pcm[i * numChannels], n) != OK) {
+            ok = false;
+            break;
+        }
+
+        if (i + n >= numFrames && encoder.signalEndOfStream() != OK) {
+            ok = false;
+            break;
+        }
+    }
+
+    encoder.getStreamHeader(header);
+
+    free(buffer);
+
+    return ok;
+}
+
+// Independent of the CRC tables in FLACParallelEncoder.
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    unsigned crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size) {
+    unsigned crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) & 0xffff : (crc << 1) & 0xffff;
+        }
+    }
+    return crc;
+}
+
+// Walks the frames using the sizes from the frame CRCs: a frame ends where
+// its CRC-16 checks out and the next sync code with the next frame number
+// starts. Returns the number of frames, -1 on error.
+static ssize_t checkFrames(const uint8_t *data, size_t size,
+                           size_t *minFrameSize, size_t *maxFrameSize) {
+    size_t offset = 0;
+    uint32_t frameNumber = 0;
+
+    *minFrameSize = 0;
+    *maxFrameSize = 0;
+
+    while (offset < size) {
+        const uint8_t *frame = &data[offset];
+        if (size - offset < 8 || frame[0] != 0xff || frame[1] != 0xf8) {
+            fprintf(stderr, "no frame at %d\n", (int)offset);
+            return -1;
+        }
+
+        // The frame number, coded like UTF-8.
+        size_t numberSize = 1;
+        uint32_t number = frame[4];
+        if (frame[4] & 0x80) {
+            while (numberSize < 7 && (frame[4] & (0x80 >> numberSize))) {
+                ++numberSize;
+            }
+            number = frame[4] & (0x7f >> numberSize);
+            for (size_t i = 1; i < numberSize; ++i) {
+                number = (number << 6) | (frame[4 + i] & 0x3f);
+            }
+        }
+
+        if (number != frameNumber) {
+            fprintf(stderr, "frame %d numbered %d\n", (int)frameNumber, (int)number);
+            return -1;
+        }
+
+        unsigned blockSizeCode = frame[2] >> 4;
+        unsigned sampleRateCode = frame[2] & 0x0f;
+        size_t headerSize = 4 + numberSize
+            + (blockSizeCode == 6 ? 1 : blockSizeCode == 7 ? 2 : 0)
+            + (sampleRateCode == 12 ? 1 : (sampleRateCode == 13 || sampleRateCode == 14) ? 2 : 0);
+
+        if (crc8(frame, headerSize) != frame[headerSize]) {
+            fprintf(stderr, "frame %d: bad header CRC\n", (int)frameNumber);
+            return -1;
+        }
+
+        // Running CRC-16 over the frame, zero right after its own CRC.
+        size_t end = 0;
+        for (size_t n = headerSize + 3; n <= size - offset; ++n) {
+            bool last = n == size - offset;
+            if (!last && (frame[n] != 0xff || frame[n + 1] != 0xf8)) {
+                continue;
+            }
+
+            if (crc16(frame, n) == 0) {
+                end = n;
+                break;
+            }
+        }
+
+        if (end == 0) {
+            fprintf(stderr, "frame %d: bad CRC\n", (int)frameNumber);
+            return -1;
+        }
+
+        if (*minFrameSize == 0 || end < *minFrameSize) {
+            *minFrameSize = end;
+        }
+        if (end > *maxFrameSize) {
+            *maxFrameSize = end;
+        }
+
+        offset += end;
+        ++frameNumber;
+    }
+
+    return frameNumber;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-s seconds] [-l level] [-c channels] [-j threads] [-o dir]\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    static const unsigned kSampleRates[3] = { 44100, 96000, 192000 };
+
+    size_t seconds = 30;
+    unsigned level = 5;
+    unsigned numChannels = 2;
+    size_t maxThreads = 0;
+    const char *outputDir = NULL;
+
+    int res;
+    while ((res = getopt(argc, argv, "s:l:c:j:o:h")) >= 0) {
+        switch (res) {
+            case 's':
+                seconds = atoi(optarg);
+                break;
+            case 'l':
+                level = atoi(optarg);
+                break;
+            case 'c':
+                numChannels = atoi(optarg);
+                break;
+            case 'j':
+                maxThreads = atoi(optarg);
+                break;
+            case 'o':
+                outputDir = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                break;
+        }
+    }
+
+    if (seconds == 0 || level > 8 || numChannels < 1 || numChannels > 8) {
+        usage(argv[0]);
+    }
+
+    if (maxThreads == 0) {
+        long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = numCPUs > 0 ? numCPUs : 1;
+    }
+
+    // Adaptive mid-side stereo looks back across frames at these levels.
+    bool chunkingChangesFrames = numChannels == 2 && (level == 1 || level == 4);
+
+    bool ok = true;
+
+    for (size_t r = 0; r < 3; ++r) {
+        unsigned sampleRate = kSampleRates[r];
+        size_t numFrames = seconds * sampleRate;
+
+        int16_t *pcm = (int16_t *)malloc(numFrames * numChannels * sizeof(int16_t));
+        generatePCM(pcm, numFrames, numChannels, sampleRate);
+
+        uint8_t md5[16];
+        MD5((const unsigned char *)pcm, numFrames * numChannels * sizeof(int16_t), md5);
+
+        int64_t startUs = getNowUs();
+
+        Output serial;
+        if (!encodeSerial(pcm, numFrames, numChannels, sampleRate, level, &serial)) {
+            fprintf(stderr, "serial encoder failed\n");
+            return 1;
+        }
+
+        int64_t serialUs = getNowUs() - startUs;
+
+        printf("%6u Hz %u ch level %u, %d s: %5.1f%% of PCM\n",
+               sampleRate, numChannels, level, (int)seconds,
+               100.0 * serial.mSize / (numFrames * numChannels * sizeof(int16_t)));
+        printf("    single encoder  %7.1fx realtime\n",
+               seconds * 1E6 / serialUs);
+
+        Output reference;
+        for (size_t numThreads = 1;; numThreads *= 2) {
+            if (numThreads > maxThreads) {
+                numThreads = maxThreads;
+            }
+
+            Output output;
+            uint8_t header[FLACParallelEncoder::kStreamHeaderSize];
+
+            startUs = getNowUs();
+
+            if (!encodeParallel(pcm, numFrames, numChannels, sampleRate, level,
+                                numThreads, &output, header)) {
+                fprintf(stderr, "parallel encoder failed\n");
+                return 1;
+            }
+
+            int64_t parallelUs = getNowUs() - startUs;
+
+            printf("    %2d threads      %7.1fx realtime  %5.2fx single\n",
+                   (int)numThreads, seconds * 1E6 / parallelUs,
+                   (double)serialUs / parallelUs);
+
+            size_t minFrameSize, maxFrameSize;
+            ssize_t numFlacFrames =
+                checkFrames(output.mData, output.mSize, &minFrameSize, &maxFrameSize);
+
+            const uint8_t *info = &header[8];
+            uint64_t totalSamples =
+                ((uint64_t)(info[13] & 0x0f) << 32) | ((uint32_t)info[14] << 24)
+                | (info[15] << 16) | (info[16] << 8) | info[17];
+            size_t infoMinFrameSize = (info[4] << 16) | (info[5] << 8) | info[6];
+            size_t infoMaxFrameSize = (info[7] << 16) | (info[8] << 8) | info[9];
+
+            if (numFlacFrames < 0) {
+                ok = false;
+            } else if (totalSamples != numFrames
+                    || infoMinFrameSize != minFrameSize
+                    || infoMaxFrameSize != maxFrameSize
+                    || memcmp(&info[18], md5, 16)) {
+                fprintf(stderr, "STREAMINFO does not match the stream\n");
+                ok = false;
+            }
+
+            if (reference.mData == NULL) {
+                reference.append(output.mData, output.mSize);
+
+                if (!chunkingChangesFrames
+                        && (serial.mSize != output.mSize
+                            || memcmp(serial.mData, output.mData, output.mSize))) {
+                    fprintf(stderr, "frames differ from the single encoder's\n");
+                    ok = false;
+                }
+
+                if (outputDir != NULL) {
+                    char path[256];
+                    snprintf(path, sizeof(path), "%s/flacenc_%u.flac", outputDir, sampleRate);
+
+                    FILE *file = fopen(path, "wb");
+                    if (file != NULL) {
+                        fwrite(header, 1, sizeof(header), file);
+                        fwrite(output.mData, 1, output.mSize, file);
+                        fclose(file);
+                    }
+                }
+            } else if (reference.mSize != output.mSize
+                    || memcmp(reference.mData, output.mData, output.mSize)) {
+                fprintf(stderr, "%d threads: stream differs from 1 thread\n",
+                        (int)numThreads);
+                ok = false;
+            }
+
+            if (numThreads == maxThreads) {
+                break;
+            }
+        }
+
+        free(pcm);
+    }
+
+    printf("%s\n", ok ? "streams identical and valid" : "STREAMS DIFFER OR ARE INVALID");
+
+    return ok ? 0 : 1;
+}
@@ -53,4 +53,68 @@ LOCAL_C_INCLUDES := \
   $(TOP)/frameworks/av/media/libstagefright/libvpu/common
 LOCAL_CFLAGS := -DOSCL_EXPORT_REF= -DOSCL_IMPORT_REF=
 
+# x86: SSE2 and AVX2 versions of the IDCT, motion compensation and post-filter
+# functions, picked at run time. The AVX2 ones are in
+# libstagefright_m4vh263dec_avx2 below, which has to be linked along with this
+# library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+    src/idct_sse2.cpp \
+    src/get_pred_sse2.cpp \
+    src/post_filter_sse2.cpp
+
+LOCAL_CFLAGS += -DM4VDEC_X86 -msse2
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../common/include
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    src/idct_avx2.cpp
+
+LOCAL_MODULE := libstagefright_m4vh263dec_avx2
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/src \
+    $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := -DM4VDEC_X86 -mavx2 -DOSCL_EXPORT_REF= -DOSCL_IMPORT_REF=
+
 include $(BUILD_STATIC_LIBRARY)
+
+endif
+
+################################################################################
+# test utility: checks the IDCT, motion compensation and post-filter functions
+# and times the decoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/M4VDecBench.cpp
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := -DOSCL_EXPORT_REF= -DOSCL_IMPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_m4vh263dec
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DM4VDEC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_m4vh263dec_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := m4vdec_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
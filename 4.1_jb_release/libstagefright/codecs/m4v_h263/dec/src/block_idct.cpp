@@ -238,12 +238,12 @@ void MBlockIDCT(VideoDecData *video)
     cu_comp = currVop->uChan + (offset >> 2) + (x_pos << 2);
     cv_comp = currVop->vChan + (offset >> 2) + (x_pos << 2);
 
-    BlockIDCT_intra(mblock, c_comp, 0, width);
-    BlockIDCT_intra(mblock, c_comp + 8, 1, width);
-    BlockIDCT_intra(mblock, c_comp + (width << 3), 2, width);
-    BlockIDCT_intra(mblock, c_comp + (width << 3) + 8, 3, width);
-    BlockIDCT_intra(mblock, cu_comp, 4, width_uv);
-    BlockIDCT_intra(mblock, cv_comp, 5, width_uv);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, c_comp, 0, width);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, c_comp + 8, 1, width);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, c_comp + (width << 3), 2, width);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, c_comp + (width << 3) + 8, 3, width);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, cu_comp, 4, width_uv);
+    (*video->functionPointer.BlockIDCT_intra)(mblock, cv_comp, 5, width_uv);
 }
 
 
@@ -179,7 +179,8 @@ void CombinedHorzVertFilter(
     int height,
     int16 *QP_store,
     int chr,
-    uint8 *pp_mod)
+    uint8 *pp_mod,
+    DecFuncPtr *functionPointer)
 {
 
     /*----------------------------------------------------------------------------
@@ -187,11 +188,11 @@ void CombinedHorzVertFilter(
     ----------------------------------------------------------------------------*/
     int br, bc, mbr, mbc;
     int QP = 1;
-    uint8 *ptr, *ptr_e;
+    uint8 *ptr;
     int pp_w, pp_h;
     int brwidth;
 
-    int jVal0, jVal1, jVal2;
+    int jVal0;
     /*----------------------------------------------------------------------------
     ; Function body here
     ----------------------------------------------------------------------------*/
@@ -222,105 +223,8 @@ void CombinedHorzVertFilter(
                             jVal0 = brwidth + bc;
                             if (chr)    QP = QP_store[jVal0];
 
-                            ptr_e = ptr + 8;        /* pointer to where the loop ends */
-
-                            if (((pp_mod[jVal0]&0x02)) && ((pp_mod[jVal0-pp_w]&0x02)))
-                            {
-                                /* Horiz Hard filter */
-                                do
-                                {
-                                    jVal0 = *(ptr - width);     /* C */
-                                    jVal1 = *ptr;               /* D */
-                                    jVal2 = jVal1 - jVal0;
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP << 1)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP << 1)))) /* (D-C) compared with 2QP */
-                                    {
-                                        /* differentiate between real and fake edge */
-                                        jVal0 = ((jVal0 + jVal1) >> 1);     /* (D+C)/2 */
-                                        *(ptr - width) = (uint8)(jVal0);    /*  C */
-                                        *ptr = (uint8)(jVal0);          /*  D */
-
-                                        jVal0 = *(ptr - (width << 1));      /* B */
-                                        jVal1 = *(ptr + width);         /* E */
-                                        jVal2 = jVal1 - jVal0;      /* E-B */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal0 += ((jVal2 + 3) >> 2);
-                                            jVal1 -= ((jVal2 + 3) >> 2);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
-                                            *(ptr + width) = (uint8)jVal1;          /* store E */
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal0 -= ((3 - jVal2) >> 2);
-                                            jVal1 += ((3 - jVal2) >> 2);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
-                                            *(ptr + width) = (uint8)jVal1;          /* store E */
-                                        }
-
-                                        jVal0 = *(ptr - (width << 1) - width);  /* A */
-                                        jVal1 = *(ptr + (width << 1));      /* F */
-                                        jVal2 = jVal1 - jVal0;              /* (F-A) */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal0 += ((jVal2 + 7) >> 3);
-                                            jVal1 -= ((jVal2 + 7) >> 3);
-                                            *(ptr - (width << 1) - width) = (uint8)(jVal0);
-                                            *(ptr + (width << 1)) = (uint8)(jVal1);
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal0 -= ((7 - jVal2) >> 3);
-                                            jVal1 += ((7 - jVal2) >> 3);
-                                            *(ptr - (width << 1) - width) = (uint8)(jVal0);
-                                            *(ptr + (width << 1)) = (uint8)(jVal1);
-                                        }
-                                    }/* a3_0 > 2QP */
-                                }
-                                while (++ptr < ptr_e);
-                            }
-                            else   /* Horiz soft filter*/
-                            {
-                                do
-                                {
-                                    jVal0 = *(ptr - width); /* B */
-                                    jVal1 = *ptr;           /* C */
-                                    jVal2 = jVal1 - jVal0;  /* C-B */
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP)))) /* (C-B) compared with QP */
-                                    {
-
-                                        jVal0 = ((jVal0 + jVal1) >> 1);     /* (B+C)/2 cannot overflow; ceil() */
-                                        *(ptr - width) = (uint8)(jVal0);    /* B = (B+C)/2 */
-                                        *ptr = (uint8)jVal0;            /* C = (B+C)/2 */
-
-                                        jVal0 = *(ptr - (width << 1));      /* A */
-                                        jVal1 = *(ptr + width);         /* D */
-                                        jVal2 = jVal1 - jVal0;          /* D-A */
-
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= ((jVal2 + 7) >> 3);
-                                            jVal0 += ((jVal2 + 7) >> 3);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /* A */
-                                            *(ptr + width) = (uint8)jVal1;          /* D */
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 += ((7 - jVal2) >> 3);
-                                            jVal0 -= ((7 - jVal2) >> 3);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /* A */
-                                            *(ptr + width) = (uint8)jVal1;          /* D */
-                                        }
-                                    }
-                                }
-                                while (++ptr < ptr_e);
-                            } /* Soft filter*/
+                            (*functionPointer->HorzEdgeFilter)(ptr, width, QP,
+                                                               (pp_mod[jVal0]&0x02) && (pp_mod[jVal0-pp_w]&0x02));
                         }/* boundary checking*/
                     }/*bc*/
             }/*br*/
@@ -338,105 +242,8 @@ void CombinedHorzVertFilter(
                             jVal0 = brwidth + bc;
                             if (chr)    QP = QP_store[jVal0];
 
-                            ptr_e = ptr + (width << 3);
-
-                            if (((pp_mod[jVal0-1]&0x01)) && ((pp_mod[jVal0]&0x01)))
-                            {
-                                /* Vert Hard filter */
-                                do
-                                {
-                                    jVal1 = *ptr;       /* D */
-                                    jVal0 = *(ptr - 1); /* C */
-                                    jVal2 = jVal1 - jVal0;  /* D-C */
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP << 1)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP << 1))))
-                                    {
-                                        jVal1 = (jVal0 + jVal1) >> 1;   /* (C+D)/2 */
-                                        *ptr        =   jVal1;
-                                        *(ptr - 1)  =   jVal1;
-
-                                        jVal1 = *(ptr + 1);     /* E */
-                                        jVal0 = *(ptr - 2);     /* B */
-                                        jVal2 = jVal1 - jVal0;      /* E-B */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= ((jVal2 + 3) >> 2);        /* E = E -(E-B)/4 */
-                                            jVal0 += ((jVal2 + 3) >> 2);        /* B = B +(E-B)/4 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 += ((3 - jVal2) >> 2);        /* E = E -(E-B)/4 */
-                                            jVal0 -= ((3 - jVal2) >> 2);        /* B = B +(E-B)/4 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-                                        }
-
-                                        jVal1 = *(ptr + 2);     /* F */
-                                        jVal0 = *(ptr - 3);     /* A */
-
-                                        jVal2 = jVal1 - jVal0;          /* (F-A) */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= ((jVal2 + 7) >> 3);    /* F -= (F-A)/8 */
-                                            jVal0 += ((jVal2 + 7) >> 3);    /* A += (F-A)/8 */
-                                            *(ptr + 2) = jVal1;
-                                            *(ptr - 3) = jVal0;
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 -= ((jVal2 - 7) >> 3);    /* F -= (F-A)/8 */
-                                            jVal0 += ((jVal2 - 7) >> 3);    /* A += (F-A)/8 */
-                                            *(ptr + 2) = jVal1;
-                                            *(ptr - 3) = jVal0;
-                                        }
-                                    }   /* end of ver hard filetering */
-                                }
-                                while ((ptr += width) < ptr_e);
-                            }
-                            else   /* Vert soft filter*/
-                            {
-                                do
-                                {
-                                    jVal1 = *ptr;               /* C */
-                                    jVal0 = *(ptr - 1);         /* B */
-                                    jVal2 = jVal1 - jVal0;
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP))))
-                                    {
-
-                                        jVal1 = (jVal0 + jVal1 + 1) >> 1;
-                                        *ptr = jVal1;           /* C */
-                                        *(ptr - 1) = jVal1;     /* B */
-
-                                        jVal1 = *(ptr + 1);     /* D */
-                                        jVal0 = *(ptr - 2);     /* A */
-                                        jVal2 = (jVal1 - jVal0);        /* D- A */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= (((jVal2) + 7) >> 3);      /* D -= (D-A)/8 */
-                                            jVal0 += (((jVal2) + 7) >> 3);      /* A += (D-A)/8 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 += ((7 - (jVal2)) >> 3);      /* D -= (D-A)/8 */
-                                            jVal0 -= ((7 - (jVal2)) >> 3);      /* A += (D-A)/8 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-                                        }
-                                    }
-                                }
-                                while ((ptr += width) < ptr_e);
-                            } /* Soft filter*/
+                            (*functionPointer->VertEdgeFilter)(ptr, width, QP,
+                                                               (pp_mod[jVal0-1]&0x01) && (pp_mod[jVal0]&0x01));
                         } /* boundary*/
                     } /*bc*/
                 brwidth += pp_w;
@@ -456,7 +263,8 @@ void CombinedHorzVertFilter_NoSoftDeblocking(
     int height,
     int16 *QP_store,
     int chr,
-    uint8 *pp_mod)
+    uint8 *pp_mod,
+    DecFuncPtr *functionPointer)
 {
 
     /*----------------------------------------------------------------------------
@@ -464,11 +272,11 @@ void CombinedHorzVertFilter_NoSoftDeblocking(
     ----------------------------------------------------------------------------*/
     int br, bc, mbr, mbc;
     int QP = 1;
-    uint8 *ptr, *ptr_e;
+    uint8 *ptr;
     int pp_w, pp_h;
     int brwidth;
 
-    int jVal0, jVal1, jVal2;
+    int jVal0;
     /*----------------------------------------------------------------------------
     ; Function body here
     ----------------------------------------------------------------------------*/
@@ -499,67 +307,11 @@ void CombinedHorzVertFilter_NoSoftDeblocking(
                             jVal0 = brwidth + bc;
                             if (chr)    QP = QP_store[jVal0];
 
-                            ptr_e = ptr + 8;        /* pointer to where the loop ends */
-
                             if (((pp_mod[jVal0]&0x02)) && ((pp_mod[jVal0-pp_w]&0x02)))
                             {
                                 /* Horiz Hard filter */
-                                do
-                                {
-                                    jVal0 = *(ptr - width);     /* C */
-                                    jVal1 = *ptr;               /* D */
-                                    jVal2 = jVal1 - jVal0;
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP << 1)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP << 1)))) /* (D-C) compared with 2QP */
-                                    {
-                                        /* differentiate between real and fake edge */
-                                        jVal0 = ((jVal0 + jVal1) >> 1);     /* (D+C)/2 */
-                                        *(ptr - width) = (uint8)(jVal0);    /*  C */
-                                        *ptr = (uint8)(jVal0);          /*  D */
-
-                                        jVal0 = *(ptr - (width << 1));      /* B */
-                                        jVal1 = *(ptr + width);         /* E */
-                                        jVal2 = jVal1 - jVal0;      /* E-B */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal0 += ((jVal2 + 3) >> 2);
-                                            jVal1 -= ((jVal2 + 3) >> 2);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
-                                            *(ptr + width) = (uint8)jVal1;          /* store E */
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal0 -= ((3 - jVal2) >> 2);
-                                            jVal1 += ((3 - jVal2) >> 2);
-                                            *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
-                                            *(ptr + width) = (uint8)jVal1;          /* store E */
-                                        }
-
-                                        jVal0 = *(ptr - (width << 1) - width);  /* A */
-                                        jVal1 = *(ptr + (width << 1));      /* F */
-                                        jVal2 = jVal1 - jVal0;              /* (F-A) */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal0 += ((jVal2 + 7) >> 3);
-                                            jVal1 -= ((jVal2 + 7) >> 3);
-                                            *(ptr - (width << 1) - width) = (uint8)(jVal0);
-                                            *(ptr + (width << 1)) = (uint8)(jVal1);
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal0 -= ((7 - jVal2) >> 3);
-                                            jVal1 += ((7 - jVal2) >> 3);
-                                            *(ptr - (width << 1) - width) = (uint8)(jVal0);
-                                            *(ptr + (width << 1)) = (uint8)(jVal1);
-                                        }
-                                    }/* a3_0 > 2QP */
-                                }
-                                while (++ptr < ptr_e);
+                                (*functionPointer->HorzEdgeFilter)(ptr, width, QP, 1);
                             }
-
                         }/* boundary checking*/
                     }/*bc*/
             }/*br*/
@@ -577,65 +329,10 @@ void CombinedHorzVertFilter_NoSoftDeblocking(
                             jVal0 = brwidth + bc;
                             if (chr)    QP = QP_store[jVal0];
 
-                            ptr_e = ptr + (width << 3);
-
                             if (((pp_mod[jVal0-1]&0x01)) && ((pp_mod[jVal0]&0x01)))
                             {
                                 /* Vert Hard filter */
-                                do
-                                {
-                                    jVal1 = *ptr;       /* D */
-                                    jVal0 = *(ptr - 1); /* C */
-                                    jVal2 = jVal1 - jVal0;  /* D-C */
-
-                                    if (((jVal2 > 0) && (jVal2 < (QP << 1)))
-                                            || ((jVal2 < 0) && (jVal2 > -(QP << 1))))
-                                    {
-                                        jVal1 = (jVal0 + jVal1) >> 1;   /* (C+D)/2 */
-                                        *ptr        =   jVal1;
-                                        *(ptr - 1)  =   jVal1;
-
-                                        jVal1 = *(ptr + 1);     /* E */
-                                        jVal0 = *(ptr - 2);     /* B */
-                                        jVal2 = jVal1 - jVal0;      /* E-B */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= ((jVal2 + 3) >> 2);        /* E = E -(E-B)/4 */
-                                            jVal0 += ((jVal2 + 3) >> 2);        /* B = B +(E-B)/4 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 += ((3 - jVal2) >> 2);        /* E = E -(E-B)/4 */
-                                            jVal0 -= ((3 - jVal2) >> 2);        /* B = B +(E-B)/4 */
-                                            *(ptr + 1) = jVal1;
-                                            *(ptr - 2) = jVal0;
-                                        }
-
-                                        jVal1 = *(ptr + 2);     /* F */
-                                        jVal0 = *(ptr - 3);     /* A */
-
-                                        jVal2 = jVal1 - jVal0;          /* (F-A) */
-
-                                        if (jVal2 > 0)
-                                        {
-                                            jVal1 -= ((jVal2 + 7) >> 3);    /* F -= (F-A)/8 */
-                                            jVal0 += ((jVal2 + 7) >> 3);    /* A += (F-A)/8 */
-                                            *(ptr + 2) = jVal1;
-                                            *(ptr - 3) = jVal0;
-                                        }
-                                        else if (jVal2)
-                                        {
-                                            jVal1 -= ((jVal2 - 7) >> 3);    /* F -= (F-A)/8 */
-                                            jVal0 += ((jVal2 - 7) >> 3);    /* A += (F-A)/8 */
-                                            *(ptr + 2) = jVal1;
-                                            *(ptr - 3) = jVal0;
-                                        }
-                                    }   /* end of ver hard filetering */
-                                }
-                                while ((ptr += width) < ptr_e);
+                                (*functionPointer->VertEdgeFilter)(ptr, width, QP, 1);
                             }
 
                         } /* boundary*/
@@ -651,4 +348,228 @@ void CombinedHorzVertFilter_NoSoftDeblocking(
     ----------------------------------------------------------------------------*/
     return;
 }
+
+/* ======================================================================== */
+/*  Function : HorzEdgeFilter()                                            */
+/*  Purpose  : Deblocks the 8 pixels of a horizontal block edge; ptr is   */
+/*             the first pixel below the edge. hard selects the hard      */
+/*             filter, else the soft one.                                 */
+/* ======================================================================== */
+void HorzEdgeFilter(uint8 *ptr, int width, int QP, int hard)
+{
+    uint8 *ptr_e = ptr + 8;
+    int jVal0, jVal1, jVal2;
+
+    if (hard)
+    {
+        /* Horiz Hard filter */
+        do
+        {
+            jVal0 = *(ptr - width);     /* C */
+            jVal1 = *ptr;               /* D */
+            jVal2 = jVal1 - jVal0;
+
+            if (((jVal2 > 0) && (jVal2 < (QP << 1)))
+                    || ((jVal2 < 0) && (jVal2 > -(QP << 1)))) /* (D-C) compared with 2QP */
+            {
+                /* differentiate between real and fake edge */
+                jVal0 = ((jVal0 + jVal1) >> 1);     /* (D+C)/2 */
+                *(ptr - width) = (uint8)(jVal0);    /*  C */
+                *ptr = (uint8)(jVal0);          /*  D */
+
+                jVal0 = *(ptr - (width << 1));      /* B */
+                jVal1 = *(ptr + width);         /* E */
+                jVal2 = jVal1 - jVal0;      /* E-B */
+
+                if (jVal2 > 0)
+                {
+                    jVal0 += ((jVal2 + 3) >> 2);
+                    jVal1 -= ((jVal2 + 3) >> 2);
+                    *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
+                    *(ptr + width) = (uint8)jVal1;          /* store E */
+                }
+                else if (jVal2)
+                {
+                    jVal0 -= ((3 - jVal2) >> 2);
+                    jVal1 += ((3 - jVal2) >> 2);
+                    *(ptr - (width << 1)) = (uint8)jVal0;       /*  store B */
+                    *(ptr + width) = (uint8)jVal1;          /* store E */
+                }
+
+                jVal0 = *(ptr - (width << 1) - width);  /* A */
+                jVal1 = *(ptr + (width << 1));      /* F */
+                jVal2 = jVal1 - jVal0;              /* (F-A) */
+
+                if (jVal2 > 0)
+                {
+                    jVal0 += ((jVal2 + 7) >> 3);
+                    jVal1 -= ((jVal2 + 7) >> 3);
+                    *(ptr - (width << 1) - width) = (uint8)(jVal0);
+                    *(ptr + (width << 1)) = (uint8)(jVal1);
+                }
+                else if (jVal2)
+                {
+                    jVal0 -= ((7 - jVal2) >> 3);
+                    jVal1 += ((7 - jVal2) >> 3);
+                    *(ptr - (width << 1) - width) = (uint8)(jVal0);
+                    *(ptr + (width << 1)) = (uint8)(jVal1);
+                }
+            }/* a3_0 > 2QP */
+        }
+        while (++ptr < ptr_e);
+    }
+    else   /* Horiz soft filter*/
+    {
+        do
+        {
+            jVal0 = *(ptr - width); /* B */
+            jVal1 = *ptr;           /* C */
+            jVal2 = jVal1 - jVal0;  /* C-B */
+
+            if (((jVal2 > 0) && (jVal2 < (QP)))
+                    || ((jVal2 < 0) && (jVal2 > -(QP)))) /* (C-B) compared with QP */
+            {
+
+                jVal0 = ((jVal0 + jVal1) >> 1);     /* (B+C)/2 cannot overflow; ceil() */
+                *(ptr - width) = (uint8)(jVal0);    /* B = (B+C)/2 */
+                *ptr = (uint8)jVal0;            /* C = (B+C)/2 */
+
+                jVal0 = *(ptr - (width << 1));      /* A */
+                jVal1 = *(ptr + width);         /* D */
+                jVal2 = jVal1 - jVal0;          /* D-A */
+
+
+                if (jVal2 > 0)
+                {
+                    jVal1 -= ((jVal2 + 7) >> 3);
+                    jVal0 += ((jVal2 + 7) >> 3);
+                    *(ptr - (width << 1)) = (uint8)jVal0;       /* A */
+                    *(ptr + width) = (uint8)jVal1;          /* D */
+                }
+                else if (jVal2)
+                {
+                    jVal1 += ((7 - jVal2) >> 3);
+                    jVal0 -= ((7 - jVal2) >> 3);
+                    *(ptr - (width << 1)) = (uint8)jVal0;       /* A */
+                    *(ptr + width) = (uint8)jVal1;          /* D */
+                }
+            }
+        }
+        while (++ptr < ptr_e);
+    }
+
+    return;
+}
+
+/* ======================================================================== */
+/*  Function : VertEdgeFilter()                                            */
+/*  Purpose  : Deblocks the 8 pixels of a vertical block edge; ptr is     */
+/*             the first pixel right of the edge. hard selects the hard   */
+/*             filter, else the soft one.                                 */
+/* ======================================================================== */
+void VertEdgeFilter(uint8 *ptr, int width, int QP, int hard)
+{
+    uint8 *ptr_e = ptr + (width << 3);
+    int jVal0, jVal1, jVal2;
+
+    if (hard)
+    {
+        /* Vert Hard filter */
+        do
+        {
+            jVal1 = *ptr;       /* D */
+            jVal0 = *(ptr - 1); /* C */
+            jVal2 = jVal1 - jVal0;  /* D-C */
+
+            if (((jVal2 > 0) && (jVal2 < (QP << 1)))
+                    || ((jVal2 < 0) && (jVal2 > -(QP << 1))))
+            {
+                jVal1 = (jVal0 + jVal1) >> 1;   /* (C+D)/2 */
+                *ptr        =   jVal1;
+                *(ptr - 1)  =   jVal1;
+
+                jVal1 = *(ptr + 1);     /* E */
+                jVal0 = *(ptr - 2);     /* B */
+                jVal2 = jVal1 - jVal0;      /* E-B */
+
+                if (jVal2 > 0)
+                {
+                    jVal1 -= ((jVal2 + 3) >> 2);        /* E = E -(E-B)/4 */
+                    jVal0 += ((jVal2 + 3) >> 2);        /* B = B +(E-B)/4 */
+                    *(ptr + 1) = jVal1;
+                    *(ptr - 2) = jVal0;
+                }
+                else if (jVal2)
+                {
+                    jVal1 += ((3 - jVal2) >> 2);        /* E = E -(E-B)/4 */
+                    jVal0 -= ((3 - jVal2) >> 2);        /* B = B +(E-B)/4 */
+                    *(ptr + 1) = jVal1;
+                    *(ptr - 2) = jVal0;
+                }
+
+                jVal1 = *(ptr + 2);     /* F */
+                jVal0 = *(ptr - 3);     /* A */
+
+                jVal2 = jVal1 - jVal0;          /* (F-A) */
+
+                if (jVal2 > 0)
+                {
+                    jVal1 -= ((jVal2 + 7) >> 3);    /* F -= (F-A)/8 */
+                    jVal0 += ((jVal2 + 7) >> 3);    /* A += (F-A)/8 */
+                    *(ptr + 2) = jVal1;
+                    *(ptr - 3) = jVal0;
+                }
+                else if (jVal2)
+                {
+                    jVal1 -= ((jVal2 - 7) >> 3);    /* F -= (F-A)/8 */
+                    jVal0 += ((jVal2 - 7) >> 3);    /* A += (F-A)/8 */
+                    *(ptr + 2) = jVal1;
+                    *(ptr - 3) = jVal0;
+                }
+            }   /* end of ver hard filetering */
+        }
+        while ((ptr += width) < ptr_e);
+    }
+    else   /* Vert soft filter*/
+    {
+        do
+        {
+            jVal1 = *ptr;               /* C */
+            jVal0 = *(ptr - 1);         /* B */
+            jVal2 = jVal1 - jVal0;
+
+            if (((jVal2 > 0) && (jVal2 < (QP)))
+                    || ((jVal2 < 0) && (jVal2 > -(QP))))
+            {
+
+                jVal1 = (jVal0 + jVal1 + 1) >> 1;
+                *ptr = jVal1;           /* C */
+                *(ptr - 1) = jVal1;     /* B */
+
+                jVal1 = *(ptr + 1);     /* D */
+                jVal0 = *(ptr - 2);     /* A */
+                jVal2 = (jVal1 - jVal0);        /* D- A */
+
+                if (jVal2 > 0)
+                {
+                    jVal1 -= (((jVal2) + 7) >> 3);      /* D -= (D-A)/8 */
+                    jVal0 += (((jVal2) + 7) >> 3);      /* A += (D-A)/8 */
+                    *(ptr + 1) = jVal1;
+                    *(ptr - 2) = jVal0;
+
+                }
+                else if (jVal2)
+                {
+                    jVal1 += ((7 - (jVal2)) >> 3);      /* D -= (D-A)/8 */
+                    jVal0 -= ((7 - (jVal2)) >> 3);      /* A += (D-A)/8 */
+                    *(ptr + 1) = jVal1;
+                    *(ptr - 2) = jVal0;
+                }
+            }
+        }
+        while ((ptr += width) < ptr_e);
+    }
+
+    return;
+}
 #endif
@@ -26,21 +26,18 @@ void CombinedHorzVertRingFilter(
     int height,
     int16 *QP_store,
     int chr,
-    uint8 *pp_mod)
+    uint8 *pp_mod,
+    DecFuncPtr *functionPointer)
 {
 
     /*----------------------------------------------------------------------------
     ; Define all local variables
     ----------------------------------------------------------------------------*/
-    int index, counter;
+    int index;
     int br, bc, incr, mbr, mbc;
     int QP = 1;
-    int v[5];
-    uint8 *ptr, *ptr_c, *ptr_n;
-    int w1, w2, w3, w4;
+    uint8 *ptr;
     int pp_w, pp_h, brwidth;
-    int sum, delta;
-    int a3_0, a3_1, a3_2, A3_0;
     /* for Deringing Threshold approach (MPEG4)*/
     int max_diff, thres, v0, h0, min_blk, max_blk;
     int cnthflag;
@@ -52,11 +49,7 @@ void CombinedHorzVertRingFilter(
     pp_w = (width >> 3);
     pp_h = (height >> 3);
 
-    /* Set up various values needed for updating pointers into rec */
-    w1 = width;             /* Offset to next row in pixels */
-    w2 = width << 1;        /* Offset to two rows in pixels */
-    w3 = w1 + w2;           /* Offset to three rows in pixels */
-    w4 = w2 << 1;           /* Offset to four rows in pixels */
+    /* Set up the offset needed for updating pointers into rec */
     incr = width - BLKSIZE; /* Offset to next row after processing block */
 
     /* Work through the area hortizontally by two rows per step */
@@ -116,124 +109,14 @@ void CombinedHorzVertRingFilter(
 
                             /* Set HorzHflag (bit 4) in the pp_mod location */
                             pp_mod[index-pp_w] |= 0x10; /*  4/26/00 reuse pp_mod for HorzHflag*/
-
-                            /* Filter across the 8 pixels of the block */
-                            for (index = BLKSIZE; index > 0; index--)
-                            {
-                                /* Difference between the current pixel and the pixel above it */
-                                a3_0 = *ptr - *(ptr - w1);
-
-                                /* if the magnitude of the difference is greater than the KThH threshold
-                                 * and within the quantization parameter, apply hard filter */
-                                if ((a3_0 > KThH || a3_0 < -KThH) && a3_0<QP && a3_0> -QP)
-                                {
-                                    ptr_c = ptr - w3;   /* Points to pixel three rows above */
-                                    ptr_n = ptr + w1;   /* Points to pixel one row below */
-                                    v[0] = (int)(*(ptr_c - w3));
-                                    v[1] = (int)(*(ptr_c - w2));
-                                    v[2] = (int)(*(ptr_c - w1));
-                                    v[3] = (int)(*ptr_c);
-                                    v[4] = (int)(*(ptr_c + w1));
-
-                                    sum = v[0]
-                                          + v[1]
-                                          + v[2]
-                                          + *ptr_c
-                                          + v[4]
-                                          + (*(ptr_c + w2))
-                                          + (*(ptr_c + w3));  /* Current pixel */
-
-                                    delta = (sum + *ptr_c + 4) >> 3;   /* Average pixel values with rounding */
-                                    *(ptr_c) = (uint8) delta;
-
-                                    /* Move pointer down one row of pixels (points to pixel two rows
-                                     * above current pixel) */
-                                    ptr_c += w1;
-
-                                    for (counter = 0; counter < 5; counter++)
-                                    {
-                                        /* Subtract off highest pixel and add in pixel below */
-                                        sum = sum - v[counter] + *ptr_n;
-                                        /* Average the pixel values with rounding */
-                                        delta = (sum + *ptr_c + 4) >> 3;
-                                        *ptr_c = (uint8)(delta);
-
-                                        /* Increment pointers to next pixel row */
-                                        ptr_c += w1;
-                                        ptr_n += w1;
-                                    }
-                                }
-                                /* Increment pointer to next pixel */
-                                ++ptr;
-                            } /* index*/
+                            (*functionPointer->HorzEdgeRingFilter)(ptr, width, QP, 1);
                         }
                         else
                         { /* soft filter*/
 
                             /* Clear HorzHflag (bit 4) in the pp_mod location */
                             pp_mod[index-pp_w] &= 0xef; /* reset 1110,1111 */
-
-                            for (index = BLKSIZE; index > 0; index--)
-                            {
-                                /* Difference between the current pixel and the pixel above it */
-                                a3_0 = *(ptr) - *(ptr - w1);
-
-                                /* if the magnitude of the difference is greater than the KTh threshold,
-                                 * apply soft filter */
-                                if ((a3_0 > KTh || a3_0 < -KTh))
-                                {
-
-                                    /* Sum of weighted differences */
-                                    a3_0 += ((*(ptr - w2) - *(ptr + w1)) << 1) + (a3_0 << 2);
-
-                                    /* Check if sum is less than the quantization parameter */
-                                    if (PV_ABS(a3_0) < (QP << 3))
-                                    {
-                                        a3_1 = *(ptr - w2) - *(ptr - w3);
-                                        a3_1 += ((*(ptr - w4) - *(ptr - w1)) << 1) + (a3_1 << 2);
-
-                                        a3_2  = *(ptr + w2) - *(ptr + w1);
-                                        a3_2 += ((*(ptr) - *(ptr + w3)) << 1) + (a3_2 << 2);
-
-                                        A3_0 = PV_ABS(a3_0) - PV_MIN(PV_ABS(a3_1), PV_ABS(a3_2));
-
-                                        if (A3_0 > 0)
-                                        {
-                                            A3_0 += A3_0 << 2;
-                                            A3_0 = (A3_0 + 32) >> 6;
-                                            if (a3_0 > 0)
-                                            {
-                                                A3_0 = -A3_0;
-                                            }
-
-                                            delta = (*(ptr - w1) - *(ptr)) >> 1;
-                                            if (delta >= 0)
-                                            {
-                                                if (delta >= A3_0)
-                                                {
-                                                    delta = PV_MAX(A3_0, 0);
-                                                }
-                                            }
-                                            else
-                                            {
-                                                if (A3_0 > 0)
-                                                {
-                                                    delta = 0;
-                                                }
-                                                else
-                                                {
-                                                    delta = PV_MAX(A3_0, delta);
-                                                }
-                                            }
-
-                                            *(ptr - w1) = (uint8)(*(ptr - w1) - delta);
-                                            *(ptr) = (uint8)(*(ptr) + delta);
-                                        }
-                                    } /*threshold*/
-                                }
-                                /* Increment pointer to next pixel */
-                                ++ptr;
-                            } /*index*/
+                            (*functionPointer->HorzEdgeRingFilter)(ptr, width, QP, 0);
                         } /* Soft filter*/
                     }/* boundary checking*/
                 }/*bc*/
@@ -275,121 +158,14 @@ void CombinedHorzVertRingFilter(
 
                             /* Set VertHflag (bit 5) in the pp_mod location of previous block*/
                             pp_mod[index-1] |= 0x20; /*  4/26/00 reuse pp_mod for VertHflag*/
-
-                            /* Filter across the 8 pixels of the block */
-                            for (index = BLKSIZE; index > 0; index--)
-                            {
-                                /* Difference between the current pixel
-                                * and the pixel to left of it */
-                                a3_0 = *ptr - *(ptr - 1);
-
-                                /* if the magnitude of the difference is greater than the KThH threshold
-                                 * and within the quantization parameter, apply hard filter */
-                                if ((a3_0 > KThH || a3_0 < -KThH) && a3_0<QP && a3_0> -QP)
-                                {
-                                    ptr_c = ptr - 3;
-                                    ptr_n = ptr + 1;
-                                    v[0] = (int)(*(ptr_c - 3));
-                                    v[1] = (int)(*(ptr_c - 2));
-                                    v[2] = (int)(*(ptr_c - 1));
-                                    v[3] = (int)(*ptr_c);
-                                    v[4] = (int)(*(ptr_c + 1));
-
-                                    sum = v[0]
-                                          + v[1]
-                                          + v[2]
-                                          + *ptr_c
-                                          + v[4]
-                                          + (*(ptr_c + 2))
-                                          + (*(ptr_c + 3));
-
-                                    delta = (sum + *ptr_c + 4) >> 3;
-                                    *(ptr_c) = (uint8) delta;
-
-                                    /* Move pointer down one pixel to the right */
-                                    ptr_c += 1;
-                                    for (counter = 0; counter < 5; counter++)
-                                    {
-                                        /* Subtract off highest pixel and add in pixel below */
-                                        sum = sum - v[counter] + *ptr_n;
-                                        /* Average the pixel values with rounding */
-                                        delta = (sum + *ptr_c + 4) >> 3;
-                                        *ptr_c = (uint8)(delta);
-
-                                        /* Increment pointers to next pixel */
-                                        ptr_c += 1;
-                                        ptr_n += 1;
-                                    }
-                                }
-                                /* Increment pointers to next pixel row */
-                                ptr += w1;
-                            } /* index*/
+                            (*functionPointer->VertEdgeRingFilter)(ptr, width, QP, 1);
                         }
                         else
                         { /* soft filter*/
 
                             /* Clear VertHflag (bit 5) in the pp_mod location */
                             pp_mod[index-1] &= 0xdf; /* reset 1101,1111 */
-                            for (index = BLKSIZE; index > 0; index--)
-                            {
-                                /* Difference between the current pixel and the pixel above it */
-                                a3_0 = *(ptr) - *(ptr - 1);
-
-                                /* if the magnitude of the difference is greater than the KTh threshold,
-                                 * apply soft filter */
-                                if ((a3_0 > KTh || a3_0 < -KTh))
-                                {
-
-                                    /* Sum of weighted differences */
-                                    a3_0 += ((*(ptr - 2) - *(ptr + 1)) << 1) + (a3_0 << 2);
-
-                                    /* Check if sum is less than the quantization parameter */
-                                    if (PV_ABS(a3_0) < (QP << 3))
-                                    {
-                                        a3_1 = *(ptr - 2) - *(ptr - 3);
-                                        a3_1 += ((*(ptr - 4) - *(ptr - 1)) << 1) + (a3_1 << 2);
-
-                                        a3_2  = *(ptr + 2) - *(ptr + 1);
-                                        a3_2 += ((*(ptr) - *(ptr + 3)) << 1) + (a3_2 << 2);
-
-                                        A3_0 = PV_ABS(a3_0) - PV_MIN(PV_ABS(a3_1), PV_ABS(a3_2));
-
-                                        if (A3_0 > 0)
-                                        {
-                                            A3_0 += A3_0 << 2;
-                                            A3_0 = (A3_0 + 32) >> 6;
-                                            if (a3_0 > 0)
-                                            {
-                                                A3_0 = -A3_0;
-                                            }
-
-                                            delta = (*(ptr - 1) - *(ptr)) >> 1;
-                                            if (delta >= 0)
-                                            {
-                                                if (delta >= A3_0)
-                                                {
-                                                    delta = PV_MAX(A3_0, 0);
-                                                }
-                                            }
-                                            else
-                                            {
-                                                if (A3_0 > 0)
-                                                {
-                                                    delta = 0;
-                                                }
-                                                else
-                                                {
-                                                    delta = PV_MAX(A3_0, delta);
-                                                }
-                                            }
-
-                                            *(ptr - 1) = (uint8)(*(ptr - 1) - delta);
-                                            *(ptr) = (uint8)(*(ptr) + delta);
-                                        }
-                                    } /*threshold*/
-                                }
-                                ptr += w1;
-                            } /*index*/
+                            (*functionPointer->VertEdgeRingFilter)(ptr, width, QP, 0);
                         } /* Soft filter*/
                     } /* boundary*/
                 } /*bc*/
@@ -445,7 +221,7 @@ void CombinedHorzVertRingFilter(
                                     ptr = rec + (brwidth << 6) + (bc << 3);
 
                                     /* Find minimum and maximum value of pixel block */
-                                    FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                                    (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
 
                                     /* threshold determination */
                                     thres = (max_blk + min_blk + 1) >> 1;
@@ -464,7 +240,7 @@ void CombinedHorzVertRingFilter(
                                         h0 = (bc << 3) - 1;
 
                                         /*smooth 8x8 region*/
-                                        AdaptiveSmooth_NoMMX(rec, v0, h0, v0 + 1, h0 + 1, thres, width, max_diff);
+                                        (*functionPointer->AdaptiveSmooth)(rec, v0, h0, v0 + 1, h0 + 1, thres, width, max_diff);
                                     }
 #endif
                                 }/*cnthflag*/
@@ -529,7 +305,7 @@ void CombinedHorzVertRingFilter(
                                     ptr = rec + (brwidth << 6) + (bc << 3);
 
                                     /* Find minimum and maximum value of pixel block */
-                                    FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                                    (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
 
                                     /* threshold determination */
                                     thres = (max_blk + min_blk + 1) >> 1;
@@ -543,7 +319,7 @@ void CombinedHorzVertRingFilter(
                                     if ((max_blk - min_blk) >= DERING_THR)
                                     {
                                         /* Smooth 4x4 region */
-                                        AdaptiveSmooth_NoMMX(rec, v0, h0, v0 - 3, h0 - 3, thres, width, max_diff);
+                                        (*functionPointer->AdaptiveSmooth)(rec, v0, h0, v0 - 3, h0 - 3, thres, width, max_diff);
                                     }
                                 }/*cnthflag*/
                             } /* br==0, bc==0*/
@@ -562,4 +338,279 @@ void CombinedHorzVertRingFilter(
     ----------------------------------------------------------------------------*/
     return ;
 }
+
+/* ======================================================================== */
+/*  Function : HorzEdgeRingFilter()                                        */
+/*  Purpose  : Deblocks the 8 pixels of a horizontal block edge; ptr is   */
+/*             the first pixel below the edge. hard selects the hard      */
+/*             filter, else the soft one.                                 */
+/* ======================================================================== */
+void HorzEdgeRingFilter(uint8 *ptr, int width, int QP, int hard)
+{
+    int index, counter;
+    int v[5];
+    uint8 *ptr_c, *ptr_n;
+    int w1 = width;         /* Offset to next row in pixels */
+    int w2 = width << 1;    /* Offset to two rows in pixels */
+    int w3 = w1 + w2;       /* Offset to three rows in pixels */
+    int w4 = w2 << 1;       /* Offset to four rows in pixels */
+    int sum, delta;
+    int a3_0, a3_1, a3_2, A3_0;
+
+    if (hard)
+    {   /* Hard filter */
+
+        /* Filter across the 8 pixels of the block */
+        for (index = BLKSIZE; index > 0; index--)
+        {
+            /* Difference between the current pixel and the pixel above it */
+            a3_0 = *ptr - *(ptr - w1);
+
+            /* if the magnitude of the difference is greater than the KThH threshold
+             * and within the quantization parameter, apply hard filter */
+            if ((a3_0 > KThH || a3_0 < -KThH) && a3_0<QP && a3_0> -QP)
+            {
+                ptr_c = ptr - w3;   /* Points to pixel three rows above */
+                ptr_n = ptr + w1;   /* Points to pixel one row below */
+                v[0] = (int)(*(ptr_c - w3));
+                v[1] = (int)(*(ptr_c - w2));
+                v[2] = (int)(*(ptr_c - w1));
+                v[3] = (int)(*ptr_c);
+                v[4] = (int)(*(ptr_c + w1));
+
+                sum = v[0]
+                      + v[1]
+                      + v[2]
+                      + *ptr_c
+                      + v[4]
+                      + (*(ptr_c + w2))
+                      + (*(ptr_c + w3));  /* Current pixel */
+
+                delta = (sum + *ptr_c + 4) >> 3;   /* Average pixel values with rounding */
+                *(ptr_c) = (uint8) delta;
+
+                /* Move pointer down one row of pixels (points to pixel two rows
+                 * above current pixel) */
+                ptr_c += w1;
+
+                for (counter = 0; counter < 5; counter++)
+                {
+                    /* Subtract off highest pixel and add in pixel below */
+                    sum = sum - v[counter] + *ptr_n;
+                    /* Average the pixel values with rounding */
+                    delta = (sum + *ptr_c + 4) >> 3;
+                    *ptr_c = (uint8)(delta);
+
+                    /* Increment pointers to next pixel row */
+                    ptr_c += w1;
+                    ptr_n += w1;
+                }
+            }
+            /* Increment pointer to next pixel */
+            ++ptr;
+        } /* index*/
+    }
+    else
+    { /* soft filter*/
+
+        for (index = BLKSIZE; index > 0; index--)
+        {
+            /* Difference between the current pixel and the pixel above it */
+            a3_0 = *(ptr) - *(ptr - w1);
+
+            /* if the magnitude of the difference is greater than the KTh threshold,
+             * apply soft filter */
+            if ((a3_0 > KTh || a3_0 < -KTh))
+            {
+
+                /* Sum of weighted differences */
+                a3_0 += ((*(ptr - w2) - *(ptr + w1)) << 1) + (a3_0 << 2);
+
+                /* Check if sum is less than the quantization parameter */
+                if (PV_ABS(a3_0) < (QP << 3))
+                {
+                    a3_1 = *(ptr - w2) - *(ptr - w3);
+                    a3_1 += ((*(ptr - w4) - *(ptr - w1)) << 1) + (a3_1 << 2);
+
+                    a3_2  = *(ptr + w2) - *(ptr + w1);
+                    a3_2 += ((*(ptr) - *(ptr + w3)) << 1) + (a3_2 << 2);
+
+                    A3_0 = PV_ABS(a3_0) - PV_MIN(PV_ABS(a3_1), PV_ABS(a3_2));
+
+                    if (A3_0 > 0)
+                    {
+                        A3_0 += A3_0 << 2;
+                        A3_0 = (A3_0 + 32) >> 6;
+                        if (a3_0 > 0)
+                        {
+                            A3_0 = -A3_0;
+                        }
+
+                        delta = (*(ptr - w1) - *(ptr)) >> 1;
+                        if (delta >= 0)
+                        {
+                            if (delta >= A3_0)
+                            {
+                                delta = PV_MAX(A3_0, 0);
+                            }
+                        }
+                        else
+                        {
+                            if (A3_0 > 0)
+                            {
+                                delta = 0;
+                            }
+                            else
+                            {
+                                delta = PV_MAX(A3_0, delta);
+                            }
+                        }
+
+                        *(ptr - w1) = (uint8)(*(ptr - w1) - delta);
+                        *(ptr) = (uint8)(*(ptr) + delta);
+                    }
+                } /*threshold*/
+            }
+            /* Increment pointer to next pixel */
+            ++ptr;
+        } /*index*/
+    }
+
+    return;
+}
+
+/* ======================================================================== */
+/*  Function : VertEdgeRingFilter()                                        */
+/*  Purpose  : Deblocks the 8 pixels of a vertical block edge; ptr is     */
+/*             the first pixel right of the edge. hard selects the hard   */
+/*             filter, else the soft one.                                 */
+/* ======================================================================== */
+void VertEdgeRingFilter(uint8 *ptr, int width, int QP, int hard)
+{
+    int index, counter;
+    int v[5];
+    uint8 *ptr_c, *ptr_n;
+    int w1 = width;         /* Offset to next row in pixels */
+    int sum, delta;
+    int a3_0, a3_1, a3_2, A3_0;
+
+    if (hard)
+    {   /* Hard filter */
+
+        /* Filter across the 8 pixels of the block */
+        for (index = BLKSIZE; index > 0; index--)
+        {
+            /* Difference between the current pixel
+            * and the pixel to left of it */
+            a3_0 = *ptr - *(ptr - 1);
+
+            /* if the magnitude of the difference is greater than the KThH threshold
+             * and within the quantization parameter, apply hard filter */
+            if ((a3_0 > KThH || a3_0 < -KThH) && a3_0<QP && a3_0> -QP)
+            {
+                ptr_c = ptr - 3;
+                ptr_n = ptr + 1;
+                v[0] = (int)(*(ptr_c - 3));
+                v[1] = (int)(*(ptr_c - 2));
+                v[2] = (int)(*(ptr_c - 1));
+                v[3] = (int)(*ptr_c);
+                v[4] = (int)(*(ptr_c + 1));
+
+                sum = v[0]
+                      + v[1]
+                      + v[2]
+                      + *ptr_c
+                      + v[4]
+                      + (*(ptr_c + 2))
+                      + (*(ptr_c + 3));
+
+                delta = (sum + *ptr_c + 4) >> 3;
+                *(ptr_c) = (uint8) delta;
+
+                /* Move pointer down one pixel to the right */
+                ptr_c += 1;
+                for (counter = 0; counter < 5; counter++)
+                {
+                    /* Subtract off highest pixel and add in pixel below */
+                    sum = sum - v[counter] + *ptr_n;
+                    /* Average the pixel values with rounding */
+                    delta = (sum + *ptr_c + 4) >> 3;
+                    *ptr_c = (uint8)(delta);
+
+                    /* Increment pointers to next pixel */
+                    ptr_c += 1;
+                    ptr_n += 1;
+                }
+            }
+            /* Increment pointers to next pixel row */
+            ptr += w1;
+        } /* index*/
+    }
+    else
+    { /* soft filter*/
+
+        for (index = BLKSIZE; index > 0; index--)
+        {
+            /* Difference between the current pixel and the pixel above it */
+            a3_0 = *(ptr) - *(ptr - 1);
+
+            /* if the magnitude of the difference is greater than the KTh threshold,
+             * apply soft filter */
+            if ((a3_0 > KTh || a3_0 < -KTh))
+            {
+
+                /* Sum of weighted differences */
+                a3_0 += ((*(ptr - 2) - *(ptr + 1)) << 1) + (a3_0 << 2);
+
+                /* Check if sum is less than the quantization parameter */
+                if (PV_ABS(a3_0) < (QP << 3))
+                {
+                    a3_1 = *(ptr - 2) - *(ptr - 3);
+                    a3_1 += ((*(ptr - 4) - *(ptr - 1)) << 1) + (a3_1 << 2);
+
+                    a3_2  = *(ptr + 2) - *(ptr + 1);
+                    a3_2 += ((*(ptr) - *(ptr + 3)) << 1) + (a3_2 << 2);
+
+                    A3_0 = PV_ABS(a3_0) - PV_MIN(PV_ABS(a3_1), PV_ABS(a3_2));
+
+                    if (A3_0 > 0)
+                    {
+                        A3_0 += A3_0 << 2;
+                        A3_0 = (A3_0 + 32) >> 6;
+                        if (a3_0 > 0)
+                        {
+                            A3_0 = -A3_0;
+                        }
+
+                        delta = (*(ptr - 1) - *(ptr)) >> 1;
+                        if (delta >= 0)
+                        {
+                            if (delta >= A3_0)
+                            {
+                                delta = PV_MAX(A3_0, 0);
+                            }
+                        }
+                        else
+                        {
+                            if (A3_0 > 0)
+                            {
+                                delta = 0;
+                            }
+                            else
+                            {
+                                delta = PV_MAX(A3_0, delta);
+                            }
+                        }
+
+                        *(ptr - 1) = (uint8)(*(ptr - 1) - delta);
+                        *(ptr) = (uint8)(*(ptr) + delta);
+                    }
+                } /*threshold*/
+            }
+            ptr += w1;
+        } /*index*/
+    }
+
+    return;
+}
 #endif
@@ -674,7 +674,7 @@ PV_STATUS GetMBData(VideoDecData *video)
                 ncoeffs[comp] = VlcDequantH263InterBlock(video, comp, mblock->bitmapcol[comp], &mblock->bitmaprow[comp]);
                 if (VLC_ERROR_DETECTED(ncoeffs[comp])) return PV_FAIL;
 
-                BlockIDCT(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
+                (*video->functionPointer.BlockIDCT)(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
                           mblock->bitmapcol[comp], mblock->bitmaprow[comp]);
 
 #ifdef PV_POSTPROC_ON
@@ -704,7 +704,7 @@ PV_STATUS GetMBData(VideoDecData *video)
             ncoeffs[4] = VlcDequantH263InterBlock(video, 4, mblock->bitmapcol[4], &mblock->bitmaprow[4]);
             if (VLC_ERROR_DETECTED(ncoeffs[4])) return PV_FAIL;
 
-            BlockIDCT(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
+            (*video->functionPointer.BlockIDCT)(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
                       mblock->bitmapcol[4], mblock->bitmaprow[4]);
 
 #ifdef PV_POSTPROC_ON
@@ -728,7 +728,7 @@ PV_STATUS GetMBData(VideoDecData *video)
             ncoeffs[5] = VlcDequantH263InterBlock(video, 5, mblock->bitmapcol[5], &mblock->bitmaprow[5]);
             if (VLC_ERROR_DETECTED(ncoeffs[5])) return PV_FAIL;
 
-            BlockIDCT(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
+            (*video->functionPointer.BlockIDCT)(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
                       mblock->bitmapcol[5], mblock->bitmaprow[5]);
 
 #ifdef PV_POSTPROC_ON
@@ -756,7 +756,7 @@ PV_STATUS GetMBData(VideoDecData *video)
                 ncoeffs[comp] = VlcDequantH263InterBlock(video, comp, mblock->bitmapcol[comp], &mblock->bitmaprow[comp]);
                 if (VLC_ERROR_DETECTED(ncoeffs[comp])) return PV_FAIL;
 
-                BlockIDCT(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
+                (*video->functionPointer.BlockIDCT)(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
                           mblock->bitmapcol[comp], mblock->bitmaprow[comp]);
 
 #ifdef PV_POSTPROC_ON
@@ -782,7 +782,7 @@ PV_STATUS GetMBData(VideoDecData *video)
             ncoeffs[4] = VlcDequantH263InterBlock(video, 4, mblock->bitmapcol[4], &mblock->bitmaprow[4]);
             if (VLC_ERROR_DETECTED(ncoeffs[4])) return PV_FAIL;
 
-            BlockIDCT(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
+            (*video->functionPointer.BlockIDCT)(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
                       mblock->bitmapcol[4], mblock->bitmaprow[4]);
 
 #ifdef PV_POSTPROC_ON
@@ -806,7 +806,7 @@ PV_STATUS GetMBData(VideoDecData *video)
             ncoeffs[5] = VlcDequantH263InterBlock(video, 5, mblock->bitmapcol[5], &mblock->bitmaprow[5]);
             if (VLC_ERROR_DETECTED(ncoeffs[5])) return PV_FAIL;
 
-            BlockIDCT(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
+            (*video->functionPointer.BlockIDCT)(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
                       mblock->bitmapcol[5], mblock->bitmaprow[5]);
 
 #ifdef PV_POSTPROC_ON
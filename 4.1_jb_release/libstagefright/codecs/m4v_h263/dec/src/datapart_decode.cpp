@@ -728,7 +728,7 @@ PV_STATUS GetMBData_DataPart(VideoDecData *video)
                     return PV_FAIL;
 
 
-                BlockIDCT(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
+                (*video->functionPointer.BlockIDCT)(c_comp + (comp&2)*(width << 2) + 8*(comp&1), mblock->pred_block + (comp&2)*64 + 8*(comp&1), mblock->block[comp], width, ncoeffs[comp],
                           mblock->bitmapcol[comp], mblock->bitmaprow[comp]);
 
             }
@@ -752,7 +752,7 @@ PV_STATUS GetMBData_DataPart(VideoDecData *video)
             if (VLC_ERROR_DETECTED(ncoeffs[4]))
                 return PV_FAIL;
 
-            BlockIDCT(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
+            (*video->functionPointer.BlockIDCT)(video->currVop->uChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 256, mblock->block[4], width >> 1, ncoeffs[4],
                       mblock->bitmapcol[4], mblock->bitmaprow[4]);
 
         }
@@ -772,7 +772,7 @@ PV_STATUS GetMBData_DataPart(VideoDecData *video)
             if (VLC_ERROR_DETECTED(ncoeffs[5]))
                 return PV_FAIL;
 
-            BlockIDCT(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
+            (*video->functionPointer.BlockIDCT)(video->currVop->vChan + (offset >> 2) + (x_pos << 2), mblock->pred_block + 264, mblock->block[5], width >> 1, ncoeffs[5],
                       mblock->bitmapcol[5], mblock->bitmaprow[5]);
 
         }
@@ -26,7 +26,8 @@ void Deringing_Chroma(
     int height,
     int16 *QP_store,
     int,
-    uint8 *pp_mod
+    uint8 *pp_mod,
+    DecFuncPtr *functionPointer
 )
 {
     /*----------------------------------------------------------------------------
@@ -56,7 +57,7 @@ void Deringing_Chroma(
         max_diff = (QP_store[h_blk>>3] >> 2) + 4;
         ptr = &Rec_C[h_blk];
         max_blk = min_blk = *ptr;
-        FindMaxMin(ptr, &min_blk, &max_blk, width);
+        (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, width);
         h0 = ((h_blk - 1) >= 1) ? (h_blk - 1) : 1;
 
         if (max_blk - min_blk >= 4)
@@ -124,7 +125,7 @@ void Deringing_Chroma(
         max_diff = (QP_store[((((int32)v_blk*width)>>3))>>3] >> 2) + 4;
         ptr = &Rec_C[(int32)v_blk * width];
         max_blk = min_blk = *ptr;
-        FindMaxMin(ptr, &min_blk, &max_blk, incr);
+        (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
 
         if (max_blk - min_blk >= 4)
         {
@@ -191,14 +192,14 @@ void Deringing_Chroma(
                 max_diff = (QP_store[((((int32)v_blk*width)>>3)+h_blk)>>3] >> 2) + 4;
                 ptr = &Rec_C[(int32)v_blk * width + h_blk];
                 max_blk = min_blk = *ptr;
-                FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
                 h0 = h_blk - 1;
 
                 if (max_blk - min_blk >= 4)
                 {
                     thres = (max_blk + min_blk + 1) >> 1;
 #ifdef NoMMX
-                    AdaptiveSmooth_NoMMX(Rec_C, v0, h0, v_blk, h_blk, thres, width, max_diff);
+                    (*functionPointer->AdaptiveSmooth)(Rec_C, v0, h0, v_blk, h_blk, thres, width, max_diff);
 #else
                     DeringAdaptiveSmoothMMX(&Rec_C[(int32)v0*width+h0], width, thres, max_diff);
 #endif
@@ -26,7 +26,8 @@ void Deringing_Luma(
     int height,
     int16 *QP_store,
     int,
-    uint8 *pp_mod)
+    uint8 *pp_mod,
+    DecFuncPtr *functionPointer)
 {
     /*----------------------------------------------------------------------------
     ; Define all local variables
@@ -60,7 +61,7 @@ void Deringing_Luma(
             for (BLK_H = 0; BLK_H < MBSIZE; BLK_H += BLKSIZE)
             {
                 ptr = &Rec_Y[(int32)(BLK_V) * width + MB_H + BLK_H];
-                FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
 
                 thres[blks] = (max_blk + min_blk + 1) >> 1;
                 range[blks] = max_blk - min_blk;
@@ -93,8 +94,8 @@ void Deringing_Luma(
                     /* adaptive smoothing */
                     thr = thres[blks];
 
-                    AdaptiveSmooth_NoMMX(Rec_Y, v0, h0, v_blk, h_blk,
-                                         thr, width, max_diff);
+                    (*functionPointer->AdaptiveSmooth)(Rec_Y, v0, h0, v_blk, h_blk,
+                                                       thr, width, max_diff);
                 }
                 blks++;
             } /* block level (Luminance) */
@@ -115,7 +116,7 @@ void Deringing_Luma(
             for (BLK_H = 0; BLK_H < MBSIZE; BLK_H += BLKSIZE)
             {
                 ptr = &Rec_Y[(int32)(MB_V + BLK_V) * width + BLK_H];
-                FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
                 thres[blks] = (max_blk + min_blk + 1) >> 1;
                 range[blks] = max_blk - min_blk;
 
@@ -147,8 +148,8 @@ void Deringing_Luma(
                     /* adaptive smoothing */
                     thr = thres[blks];
 
-                    AdaptiveSmooth_NoMMX(Rec_Y, v0, h0, v_blk, h_blk,
-                                         thr, width, max_diff);
+                    (*functionPointer->AdaptiveSmooth)(Rec_Y, v0, h0, v_blk, h_blk,
+                                                       thr, width, max_diff);
                 }
                 blks++;
             }
@@ -173,7 +174,7 @@ void Deringing_Luma(
                     if ((pp_mod[blk_indx]&0x4) != 0)
                     {
                         ptr = &Rec_Y[(int32)(MB_V + BLK_V) * width + MB_H + BLK_H];
-                        FindMaxMin(ptr, &min_blk, &max_blk, incr);
+                        (*functionPointer->FindMaxMin)(ptr, &min_blk, &max_blk, incr);
                         thres[blks] = (max_blk + min_blk + 1) >> 1;
                         range[blks] = max_blk - min_blk;
 
@@ -209,8 +210,8 @@ void Deringing_Luma(
                             /* adaptive smoothing */
                             thr = thres[blks];
 #ifdef NoMMX
-                            AdaptiveSmooth_NoMMX(Rec_Y, v0, h0, v_blk, h_blk,
-                                                 thr, width, max_diff);
+                            (*functionPointer->AdaptiveSmooth)(Rec_Y, v0, h0, v_blk, h_blk,
+                                                               thr, width, max_diff);
 #else
                             DeringAdaptiveSmoothMMX(&Rec_Y[v0*width+h0],
                                                     width, thr, max_diff);
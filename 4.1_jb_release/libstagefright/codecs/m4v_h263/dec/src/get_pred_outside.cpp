@@ -246,7 +246,8 @@ int GetPredOutside(
     int width,      /* i */
     int height,     /* i */
     int rnd1,       /* i */
-    int pred_width
+    int pred_width,
+    DecFuncPtr *functionPointer  /* i */
 )
 {
     /*----------------------------------------------------------------------------
@@ -294,7 +295,7 @@ int GetPredOutside(
 
             ptr = pred + (((ypos >> 1) + 8) << 4) + (xpos >> 1) + 8;
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -321,7 +322,7 @@ int GetPredOutside(
 
             ptr = pred + 8 + (xpos >> 1);
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -349,7 +350,7 @@ int GetPredOutside(
 
             ptr = pred + 8 + (((ypos >> 1) - (height - 8)) << 4) + (xpos >> 1);
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -386,7 +387,7 @@ int GetPredOutside(
 
             ptr = pred + (((ypos >> 1) + 8) << 4) + xoffset;
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -418,7 +419,7 @@ int GetPredOutside(
 
             ptr = pred + (((ypos >> 1) - (height - 8)) << 4) + xoffset;
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -449,7 +450,7 @@ int GetPredOutside(
 
             ptr = pred + ((8 + (ypos >> 1)) << 4) + (8 - (width - (xpos >> 1)));
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
@@ -477,7 +478,7 @@ int GetPredOutside(
 
             ptr = pred + 8 - (width - (xpos >> 1));
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
 
@@ -506,7 +507,7 @@ int GetPredOutside(
 
             ptr = pred + 8 - (width - (xpos >> 1)) + ((8 - (height - (ypos >> 1))) << 4);
 
-            GetPredAdvBTable[ypos&1][xpos&1](ptr, pred_block, 16, (pred_width << 1) | rnd1);
+            (*functionPointer->GetPredAdvB[ypos&1][xpos&1])(ptr, pred_block, 16, (pred_width << 1) | rnd1);
 
             return 1;
         }
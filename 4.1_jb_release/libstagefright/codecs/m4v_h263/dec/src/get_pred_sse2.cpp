@@ -0,0 +1,126 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+int GetPredAdvancedBy0x0_SSE2(uint8 *prev,uint8 *pred_block,int width,int pred_width_rnd)
+int GetPredAdvancedBy0x1_SSE2(uint8 *prev,uint8 *pred_block,int width,int pred_width_rnd)
+int GetPredAdvancedBy1x0_SSE2(uint8 *prev,uint8 *pred_block,int width,int pred_width_rnd)
+int GetPredAdvancedBy1x1_SSE2(uint8 *prev,uint8 *pred_block,int width,int pred_width_rnd)
+
+Same output as the C versions in get_pred_adv_b_add.cpp: the 8x8 prediction
+at full-pel, horizontal, vertical and diagonal half-pel positions, rounded
+up when bit 0 of pred_width_rnd is set and down otherwise. No alignment is
+needed, so there is one path for all positions of prev.
+*/
+
+#include "mp4dec_lib.h"
+#include "mp4dec_x86.h"
+
+/* (a + b + rnd1) >> 1 */
+static inline __m128i HalfPel(__m128i a, __m128i b, int rnd1)
+{
+    __m128i avg = _mm_avg_epu8(a, b);   /* (a + b + 1) >> 1 */
+
+    if (!rnd1)
+    {
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+    }
+
+    return avg;
+}
+
+int GetPredAdvancedBy0x0_SSE2(uint8 *prev, uint8 *pred_block, int width, int pred_width_rnd)
+{
+    int pred_width = pred_width_rnd >> 1;
+    int i;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        _mm_storel_epi64((__m128i*)pred_block, _mm_loadl_epi64((__m128i*)prev));
+        prev += width;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+int GetPredAdvancedBy0x1_SSE2(uint8 *prev, uint8 *pred_block, int width, int pred_width_rnd)
+{
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+    int i;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        __m128i a = _mm_loadl_epi64((__m128i*)prev);
+        __m128i b = _mm_loadl_epi64((__m128i*)(prev + 1));
+
+        _mm_storel_epi64((__m128i*)pred_block, HalfPel(a, b, rnd1));
+        prev += width;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+int GetPredAdvancedBy1x0_SSE2(uint8 *prev, uint8 *pred_block, int width, int pred_width_rnd)
+{
+    int pred_width = pred_width_rnd >> 1;
+    int rnd1 = pred_width_rnd & 1;
+    __m128i a = _mm_loadl_epi64((__m128i*)prev);
+    int i;
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        __m128i b = _mm_loadl_epi64((__m128i*)(prev += width));
+
+        _mm_storel_epi64((__m128i*)pred_block, HalfPel(a, b, rnd1));
+        a = b;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
+
+int GetPredAdvancedBy1x1_SSE2(uint8 *prev, uint8 *pred_block, int width, int pred_width_rnd)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rnd = _mm_set1_epi16((pred_width_rnd & 1) + 1);
+    int pred_width = pred_width_rnd >> 1;
+    __m128i top, bottom, x;
+    int i;
+
+    /* horizontal pair sums of the first row */
+    top = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                        _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+
+    for (i = B_SIZE; i > 0; i--)
+    {
+        prev += width;
+        bottom = _mm_add_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)prev), zero),
+                               _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)(prev + 1)), zero));
+
+        /* (a + b + c + d + rnd1 + 1) >> 2 */
+        x = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(top, bottom), rnd), 2);
+        _mm_storel_epi64((__m128i*)pred_block, _mm_packus_epi16(x, x));
+
+        top = bottom;
+        pred_block += pred_width;
+    }
+
+    return 1;
+}
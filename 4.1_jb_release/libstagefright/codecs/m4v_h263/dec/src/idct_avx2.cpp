@@ -0,0 +1,178 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+void BlockIDCT_AVX2(uint8 *dst,uint8 *pred,int16 *blk,int width,int nzcoefs,
+                    uint8 *bitmapcol,uint8 bitmaprow)
+void BlockIDCT_intra_AVX2(MacroBlock *mblock,PIXEL *c_comp,int comp,int width)
+
+Same as the SSE2 versions in idct_sse2.cpp, with the 32-bit passes done on
+all eight columns or rows at once. Built with -mavx2, only called when the
+CPU has AVX2.
+*/
+
+#include <immintrin.h>
+
+#include "mp4dec_lib.h"
+#include "idct.h"
+#include "mp4dec_x86.h"
+
+#define MADD_PAIR256(a, b)  _mm256_set1_epi32(((uint32)(b) << 16) | ((a) & 0xFFFF))
+
+/* the 16-bit pairs (a[i], b[i]) of all eight lanes, for _mm256_madd_epi16 */
+static inline __m256i Interleave16(__m128i a, __m128i b)
+{
+    __m256i x = _mm256_castsi128_si256(_mm_unpacklo_epi16(a, b));
+
+    return _mm256_inserti128_si256(x, _mm_unpackhi_epi16(a, b), 1);
+}
+
+/* the two halves of a 32-bit vector to int16, dropping the top bits or
+   with saturation */
+static inline __m128i Truncate32(__m256i x)
+{
+    x = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+
+    return _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+static inline __m128i Saturate32(__m256i x)
+{
+    return _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+/* One pass of the IDCT on all eight lanes, see Idct4() in idct_sse2.cpp */
+static inline void Idct8(__m256i y[8], const __m128i b[8], int row)
+{
+    const __m256i c181 = _mm256_set1_epi32(181);
+    const __m256i r128 = _mm256_set1_epi32(128);
+    __m256i p04 = Interleave16(b[0], b[4]);
+    __m256i p17 = Interleave16(b[1], b[7]);
+    __m256i p53 = Interleave16(b[5], b[3]);
+    __m256i p26 = Interleave16(b[2], b[6]);
+    __m256i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    int shift = row ? 14 : 8;
+
+    x0 = _mm256_madd_epi16(p04, MADD_PAIR256(row ? 256 : 2048, 0));
+    x0 = _mm256_add_epi32(x0, _mm256_set1_epi32(row ? 8192 : 128));
+    x1 = _mm256_madd_epi16(p04, MADD_PAIR256(0, row ? 256 : 2048));
+
+    /* first stage */
+    x4 = _mm256_madd_epi16(p17, MADD_PAIR256(W1, W7));
+    x5 = _mm256_madd_epi16(p17, MADD_PAIR256(W7, -W1));
+    x6 = _mm256_madd_epi16(p53, MADD_PAIR256(W5, W3));
+    x7 = _mm256_madd_epi16(p53, MADD_PAIR256(W3, -W5));
+
+    /* second stage */
+    x3 = _mm256_madd_epi16(p26, MADD_PAIR256(W2, W6));
+    x2 = _mm256_madd_epi16(p26, MADD_PAIR256(W6, -W2));
+
+    if (row)
+    {
+        const __m256i r4 = _mm256_set1_epi32(4);
+
+        x4 = _mm256_srai_epi32(_mm256_add_epi32(x4, r4), 3);
+        x5 = _mm256_srai_epi32(_mm256_add_epi32(x5, r4), 3);
+        x6 = _mm256_srai_epi32(_mm256_add_epi32(x6, r4), 3);
+        x7 = _mm256_srai_epi32(_mm256_add_epi32(x7, r4), 3);
+        x3 = _mm256_srai_epi32(_mm256_add_epi32(x3, r4), 3);
+        x2 = _mm256_srai_epi32(_mm256_add_epi32(x2, r4), 3);
+    }
+
+    x8 = _mm256_add_epi32(x0, x1);
+    x0 = _mm256_sub_epi32(x0, x1);
+    x1 = _mm256_add_epi32(x4, x6);
+    x4 = _mm256_sub_epi32(x4, x6);
+    x6 = _mm256_add_epi32(x5, x7);
+    x5 = _mm256_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm256_add_epi32(x8, x3);
+    x8 = _mm256_sub_epi32(x8, x3);
+    x3 = _mm256_add_epi32(x0, x2);
+    x0 = _mm256_sub_epi32(x0, x2);
+    x2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage */
+    y[0] = _mm256_srai_epi32(_mm256_add_epi32(x7, x1), shift);
+    y[1] = _mm256_srai_epi32(_mm256_add_epi32(x3, x2), shift);
+    y[2] = _mm256_srai_epi32(_mm256_add_epi32(x0, x4), shift);
+    y[3] = _mm256_srai_epi32(_mm256_add_epi32(x8, x6), shift);
+    y[4] = _mm256_srai_epi32(_mm256_sub_epi32(x8, x6), shift);
+    y[5] = _mm256_srai_epi32(_mm256_sub_epi32(x0, x4), shift);
+    y[6] = _mm256_srai_epi32(_mm256_sub_epi32(x3, x2), shift);
+    y[7] = _mm256_srai_epi32(_mm256_sub_epi32(x7, x1), shift);
+}
+
+/* full IDCT of blk to dst, adding pred unless it is NULL */
+static void Idct(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    __m128i b[8];
+    __m256i y[8];
+    int i;
+
+    /* columns, one lane per column */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_loadu_si128((__m128i*)(blk + 8 * i));
+    }
+
+    Idct8(y, b, 0);
+
+    /* rows, one lane per row */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = Truncate32(y[i]);
+    }
+    Transpose8x8(b);
+
+    Idct8(y, b, 1);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = Saturate32(y[i]);
+    }
+
+    IdctStoreRows(b, pred, dst, width);
+    ClearBlock(blk);
+}
+
+void BlockIDCT_AVX2(uint8 *dst, uint8 *pred, int16 *blk, int width, int nzcoefs,
+                    uint8 *, uint8)
+{
+    if (nzcoefs <= 1)
+    {
+        IdctDC(blk, pred, dst, width);
+        return ;
+    }
+
+    Idct(blk, pred, dst, width);
+}
+
+void BlockIDCT_intra_AVX2(MacroBlock *mblock, PIXEL *c_comp, int comp, int width)
+{
+    int16 *blk = mblock->block[comp];
+
+    if (mblock->no_coeff[comp] <= 1)
+    {
+        IdctDC(blk, NULL, c_comp, width);
+        return ;
+    }
+
+    Idct(blk, NULL, c_comp, width);
+}
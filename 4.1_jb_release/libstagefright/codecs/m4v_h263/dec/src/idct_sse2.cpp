@@ -0,0 +1,184 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+void BlockIDCT_SSE2(uint8 *dst,uint8 *pred,int16 *blk,int width,int nzcoefs,
+                    uint8 *bitmapcol,uint8 bitmaprow)
+void BlockIDCT_intra_SSE2(MacroBlock *mblock,PIXEL *c_comp,int comp,int width)
+
+These give the same output as BlockIDCT() and BlockIDCT_intra() in
+block_idct.cpp. The reduced C versions for sparse blocks (idct_vca.cpp) give
+the same result as the full IDCT, so only the DC-only case is kept apart and
+the bitmaps are not needed.
+*/
+
+#include "mp4dec_lib.h"
+#include "idct.h"
+#include "mp4dec_x86.h"
+
+/* low 32 bits of x*c, c the same in all four lanes */
+static inline __m128i MulLo32(__m128i x, __m128i c)
+{
+    __m128i even = _mm_mul_epu32(x, c);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), c);
+
+    even = _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0));
+    odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0));
+
+    return _mm_unpacklo_epi32(even, odd);
+}
+
+/* ======================================================================== */
+/*  Function : Idct4                                                        */
+/*  Purpose  : One pass of the IDCT on four lanes, low or high half of b[], */
+/*             b[i] holding coefficient i. The column pass is idctcol(),    */
+/*             the row pass the rounding of idctrow().                      */
+/* ======================================================================== */
+static inline void Idct4(__m128i y[8], const __m128i b[8], int hi, int row)
+{
+    const __m128i c0 = MADD_PAIR(row ? 256 : 2048, 0);
+    const __m128i c1 = MADD_PAIR(0, row ? 256 : 2048);
+    const __m128i c181 = _mm_set1_epi32(181);
+    const __m128i r128 = _mm_set1_epi32(128);
+    int shift = row ? 14 : 8;
+    __m128i p04, p17, p53, p26;
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    if (hi)
+    {
+        p04 = _mm_unpackhi_epi16(b[0], b[4]);
+        p17 = _mm_unpackhi_epi16(b[1], b[7]);
+        p53 = _mm_unpackhi_epi16(b[5], b[3]);
+        p26 = _mm_unpackhi_epi16(b[2], b[6]);
+    }
+    else
+    {
+        p04 = _mm_unpacklo_epi16(b[0], b[4]);
+        p17 = _mm_unpacklo_epi16(b[1], b[7]);
+        p53 = _mm_unpacklo_epi16(b[5], b[3]);
+        p26 = _mm_unpacklo_epi16(b[2], b[6]);
+    }
+
+    x0 = _mm_add_epi32(_mm_madd_epi16(p04, c0), _mm_set1_epi32(row ? 8192 : 128));
+    x1 = _mm_madd_epi16(p04, c1);
+
+    /* first stage */
+    x4 = _mm_madd_epi16(p17, MADD_PAIR(W1, W7));
+    x5 = _mm_madd_epi16(p17, MADD_PAIR(W7, -W1));
+    x6 = _mm_madd_epi16(p53, MADD_PAIR(W5, W3));
+    x7 = _mm_madd_epi16(p53, MADD_PAIR(W3, -W5));
+
+    /* second stage */
+    x3 = _mm_madd_epi16(p26, MADD_PAIR(W2, W6));
+    x2 = _mm_madd_epi16(p26, MADD_PAIR(W6, -W2));
+
+    if (row)
+    {
+        const __m128i r4 = _mm_set1_epi32(4);
+
+        x4 = _mm_srai_epi32(_mm_add_epi32(x4, r4), 3);
+        x5 = _mm_srai_epi32(_mm_add_epi32(x5, r4), 3);
+        x6 = _mm_srai_epi32(_mm_add_epi32(x6, r4), 3);
+        x7 = _mm_srai_epi32(_mm_add_epi32(x7, r4), 3);
+        x3 = _mm_srai_epi32(_mm_add_epi32(x3, r4), 3);
+        x2 = _mm_srai_epi32(_mm_add_epi32(x2, r4), 3);
+    }
+
+    x8 = _mm_add_epi32(x0, x1);
+    x0 = _mm_sub_epi32(x0, x1);
+    x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = _mm_srai_epi32(_mm_add_epi32(MulLo32(_mm_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm_srai_epi32(_mm_add_epi32(MulLo32(_mm_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage */
+    y[0] = _mm_srai_epi32(_mm_add_epi32(x7, x1), shift);
+    y[1] = _mm_srai_epi32(_mm_add_epi32(x3, x2), shift);
+    y[2] = _mm_srai_epi32(_mm_add_epi32(x0, x4), shift);
+    y[3] = _mm_srai_epi32(_mm_add_epi32(x8, x6), shift);
+    y[4] = _mm_srai_epi32(_mm_sub_epi32(x8, x6), shift);
+    y[5] = _mm_srai_epi32(_mm_sub_epi32(x0, x4), shift);
+    y[6] = _mm_srai_epi32(_mm_sub_epi32(x3, x2), shift);
+    y[7] = _mm_srai_epi32(_mm_sub_epi32(x7, x1), shift);
+}
+
+/* full IDCT of blk to dst, adding pred unless it is NULL */
+static void Idct(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    __m128i b[8], lo[8], hi[8];
+    int i;
+
+    /* columns, one lane per column */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_loadu_si128((__m128i*)(blk + 8 * i));
+    }
+
+    Idct4(lo, b, 0, 0);
+    Idct4(hi, b, 1, 0);
+
+    /* rows, one lane per row */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = TruncatePack32(lo[i], hi[i]);
+    }
+    Transpose8x8(b);
+
+    Idct4(lo, b, 0, 1);
+    Idct4(hi, b, 1, 1);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_packs_epi32(lo[i], hi[i]);
+    }
+
+    IdctStoreRows(b, pred, dst, width);
+    ClearBlock(blk);
+}
+
+void BlockIDCT_SSE2(uint8 *dst, uint8 *pred, int16 *blk, int width, int nzcoefs,
+                    uint8 *, uint8)
+{
+    if (nzcoefs <= 1)
+    {
+        IdctDC(blk, pred, dst, width);
+        return ;
+    }
+
+    Idct(blk, pred, dst, width);
+}
+
+void BlockIDCT_intra_SSE2(MacroBlock *mblock, PIXEL *c_comp, int comp, int width)
+{
+    int16 *blk = mblock->block[comp];
+
+    if (mblock->no_coeff[comp] <= 1)
+    {
+        IdctDC(blk, NULL, c_comp, width);
+        return ;
+    }
+
+    Idct(blk, NULL, c_comp, width);
+}
@@ -274,15 +274,16 @@ void  MBMotionComp(
         /* (x,y) is inside the frame */
         /*****************************/
         ;
-        GetPredAdvBTable[ypred&1][xpred&1](c_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(c_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
     }
     else
     {   /******************************/
         /* (x,y) is outside the frame */
         /******************************/
         GetPredOutside(xpred, ypred, c_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
     }
 
 
@@ -309,15 +310,16 @@ void  MBMotionComp(
     {   /*****************************/
         /* (x,y) is inside the frame */
         /*****************************/
-        GetPredAdvBTable[ypred&1][xpred&1](c_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(c_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
     }
     else
     {   /******************************/
         /* (x,y) is outside the frame */
         /******************************/
         GetPredOutside(xpred, ypred, c_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
     }
 
 
@@ -345,15 +347,16 @@ void  MBMotionComp(
     {   /*****************************/
         /* (x,y) is inside the frame */
         /*****************************/
-        GetPredAdvBTable[ypred&1][xpred&1](c_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(c_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
     }
     else
     {   /******************************/
         /* (x,y) is outside the frame */
         /******************************/
         GetPredOutside(xpred, ypred, c_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
     }
 
 
@@ -382,15 +385,16 @@ void  MBMotionComp(
     {   /*****************************/
         /* (x,y) is inside the frame */
         /*****************************/
-        GetPredAdvBTable[ypred&1][xpred&1](c_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(c_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
     }
     else
     {   /******************************/
         /* (x,y) is outside the frame */
         /******************************/
         GetPredOutside(xpred, ypred, c_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
     }
     /* Call function to set de-blocking and de-ringing */
     /*   semaphores for luminance                      */
@@ -485,8 +489,8 @@ void  MBMotionComp(
         }
 
         /* Compute prediction for Chrominance b (block[4]) */
-        GetPredAdvBTable[ypred&1][xpred&1](cu_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(cu_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
 
         if (CBP&1)
         {
@@ -499,8 +503,8 @@ void  MBMotionComp(
             pred_width = width;
         }
         /* Compute prediction for Chrominance r (block[5]) */
-        GetPredAdvBTable[ypred&1][xpred&1](cv_prev + (xpred >> 1) + ((ypred >> 1)*width),
-                                           pred, width, (pred_width << 1) | round1);
+        (*video->functionPointer.GetPredAdvB[ypred&1][xpred&1])(cv_prev + (xpred >> 1) + ((ypred >> 1)*width),
+                                                                pred, width, (pred_width << 1) | round1);
 
         return ;
     }
@@ -522,7 +526,8 @@ void  MBMotionComp(
 
         /* Compute prediction for Chrominance b (block[4]) */
         GetPredOutside(xpred, ypred,    cu_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
 
         if (CBP&1)
         {
@@ -537,7 +542,8 @@ void  MBMotionComp(
 
         /* Compute prediction for Chrominance r (block[5]) */
         GetPredOutside(xpred, ypred,    cv_prev,
-                       pred, width, height, round1, pred_width);
+                       pred, width, height, round1, pred_width,
+                       &video->functionPointer);
 
         return ;
     }
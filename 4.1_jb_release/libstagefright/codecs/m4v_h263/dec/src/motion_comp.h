@@ -72,12 +72,6 @@ extern "C"
                             }
 
 
-    static int (*const GetPredAdvBTable[2][2])(uint8*, uint8*, int, int) =
-    {
-        {&GetPredAdvancedBy0x0, &GetPredAdvancedBy0x1},
-        {&GetPredAdvancedBy1x0, &GetPredAdvancedBy1x1}
-    };
-
     /*----------------------------------------------------------------------------
     ; SIMPLE TYPEDEF'S
     ----------------------------------------------------------------------------*/
@@ -63,6 +63,10 @@ extern "C"
     /* defined in pvdec_api.c, these function are not supposed to be    */
     /* exposed to programmers outside PacketVideo.  08/15/2000.    */
     uint VideoDecoderErrorDetected(VideoDecData *video);
+    /* Select the IDCT, half-pel prediction and post-filter functions for  */
+    /* this CPU, as reported by x86_cpu_get_features() on x86. All         */
+    /* versions give the same results.                                     */
+    void InitDecFunctions(DecFuncPtr *functionPointer);
 
 #ifdef ENABLE_LOG
     void m4vdec_dprintf(char *format, ...);
@@ -97,6 +101,16 @@ extern "C"
 
     void MBlockIDCT(VideoDecData *video);
     void BlockIDCT_intra(MacroBlock *mblock, PIXEL *c_comp, int comp, int width_offset);
+
+#ifdef M4VDEC_X86
+    /* defined in idct_sse2.c and idct_avx2.c */
+    void BlockIDCT_SSE2(uint8 *dst, uint8 *pred, int16 *blk, int width, int nzcoefs,
+                        uint8 *bitmapcol, uint8 bitmaprow);
+    void BlockIDCT_intra_SSE2(MacroBlock *mblock, PIXEL *c_comp, int comp, int width);
+    void BlockIDCT_AVX2(uint8 *dst, uint8 *pred, int16 *blk, int width, int nzcoefs,
+                        uint8 *bitmapcol, uint8 bitmaprow);
+    void BlockIDCT_intra_AVX2(MacroBlock *mblock, PIXEL *c_comp, int comp, int width);
+#endif
     /*--------------------------------------------------------------------------*/
     /* defined in combined_decode.c */
     PV_STATUS DecodeFrameCombinedMode(VideoDecData *video);
@@ -242,6 +256,14 @@ extern "C"
         int pred_width_rnd /* i */
     );
 
+#ifdef M4VDEC_X86
+    /* defined in get_pred_sse2.c */
+    int GetPredAdvancedBy0x0_SSE2(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy0x1_SSE2(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy1x0_SSE2(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    int GetPredAdvancedBy1x1_SSE2(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+#endif
+
     /*--------------------------------------------------------------------------*/
     /* defined in get_pred_outside.c */
     int GetPredOutside(
@@ -252,7 +274,8 @@ extern "C"
         int width,
         int height,
         int rnd1,
-        int pred_width
+        int pred_width,
+        DecFuncPtr *functionPointer
     );
 
     /*--------------------------------------------------------------------------*/
@@ -289,15 +312,30 @@ extern "C"
     void AdaptiveSmooth_NoMMX(uint8 *Rec_Y, int v0, int h0, int v_blk, int h_blk,
                               int thr, int width, int max_diff);
     void Deringing_Luma(uint8 *Rec_Y, int width, int height, int16 *QP_store,
-                        int Combined, uint8 *pp_mod);
+                        int Combined, uint8 *pp_mod, DecFuncPtr *functionPointer);
     void Deringing_Chroma(uint8 *Rec_C, int width, int height, int16 *QP_store,
-                          int Combined, uint8 *pp_mod);
+                          int Combined, uint8 *pp_mod, DecFuncPtr *functionPointer);
     void CombinedHorzVertFilter(uint8 *rec, int width, int height, int16 *QP_store,
-                                int chr, uint8 *pp_mod);
+                                int chr, uint8 *pp_mod, DecFuncPtr *functionPointer);
     void CombinedHorzVertFilter_NoSoftDeblocking(uint8 *rec, int width, int height, int16 *QP_store,
-            int chr, uint8 *pp_mod);
+            int chr, uint8 *pp_mod, DecFuncPtr *functionPointer);
     void CombinedHorzVertRingFilter(uint8 *rec, int width, int height,
-                                    int16 *QP_store, int chr, uint8 *pp_mod);
+                                    int16 *QP_store, int chr, uint8 *pp_mod, DecFuncPtr *functionPointer);
+    void HorzEdgeFilter(uint8 *ptr, int width, int QP, int hard);
+    void VertEdgeFilter(uint8 *ptr, int width, int QP, int hard);
+    void HorzEdgeRingFilter(uint8 *ptr, int width, int QP, int hard);
+    void VertEdgeRingFilter(uint8 *ptr, int width, int QP, int hard);
+
+#ifdef M4VDEC_X86
+    /* defined in post_filter_sse2.c */
+    void FindMaxMin_SSE2(uint8 *ptr, int *min, int *max, int incr);
+    void AdaptiveSmooth_SSE2(uint8 *Rec_Y, int v0, int h0, int v_blk, int h_blk,
+                             int thr, int width, int max_diff);
+    void HorzEdgeFilter_SSE2(uint8 *ptr, int width, int QP, int hard);
+    void VertEdgeFilter_SSE2(uint8 *ptr, int width, int QP, int hard);
+    void HorzEdgeRingFilter_SSE2(uint8 *ptr, int width, int QP, int hard);
+    void VertEdgeRingFilter_SSE2(uint8 *ptr, int width, int QP, int hard);
+#endif
 
     /*--------------------------------------------------------------------------*/
     /* defined in conceal.c */
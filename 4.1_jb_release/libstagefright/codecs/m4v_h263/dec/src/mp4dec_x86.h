@@ -0,0 +1,146 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#ifndef _MP4DEC_X86_H_
+#define _MP4DEC_X86_H_
+
+/* Helpers shared by the SSE2 and AVX2 functions of the decoder. */
+
+#include <emmintrin.h>
+#include "mp4dec_lib.h"
+
+/* pair of 16-bit constants for _mm_madd_epi16, a on the even lanes */
+#define MADD_PAIR(a, b)     _mm_set1_epi32(((uint32)(b) << 16) | ((a) & 0xFFFF))
+
+static inline void Transpose8x8(__m128i r[8])
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* 32-bit values to int16, dropping the top bits as a C store does */
+static inline __m128i TruncatePack32(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+/* 8 pixels to 16 bits and back, keeping the low 8 bits as a uint8 store does */
+static inline __m128i LoadPel8(uint8 *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)p), _mm_setzero_si128());
+}
+
+static inline void StorePel8(uint8 *p, __m128i x)
+{
+    x = _mm_and_si128(x, _mm_set1_epi16(0xFF));
+    _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(x, x));
+}
+
+/* ======================================================================== */
+/*  Function : IdctDC                                                       */
+/*  Purpose  : A block with only the DC coefficient, idctcol1() followed by */
+/*             idctrow1() or idctrow1_intra(). Writes to dst, adding pred   */
+/*             (pitch 16) unless pred is NULL, and clears the DC.           */
+/* ======================================================================== */
+static inline void IdctDC(int16 *blk, uint8 *pred, uint8 *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i dc = _mm_set1_epi16((int16)((blk[0] + 4) >> 3));
+    int i;
+
+    blk[0] = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = dc;
+
+        if (pred)
+        {
+            x = _mm_adds_epi16(x, _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(x, x));
+        dst += width;
+    }
+}
+
+/* ======================================================================== */
+/*  Function : IdctStoreRows                                                */
+/*  Purpose  : Transposes the 8 row-IDCT outputs, one lane per row, and     */
+/*             writes them to dst, adding pred (pitch 16) unless pred is    */
+/*             NULL, clipped to [0,255].                                    */
+/* ======================================================================== */
+static inline void IdctStoreRows(__m128i p[8], uint8 *pred, uint8 *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    Transpose8x8(p);
+
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = p[i];
+
+        if (pred)
+        {
+            x = _mm_adds_epi16(x, _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(x, x));
+        dst += width;
+    }
+}
+
+/* Clears the block, as the C row IDCTs leave it */
+static inline void ClearBlock(int16 *blk)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i;
+
+    for (i = 0; i < 64; i += 8)
+    {
+        _mm_storeu_si128((__m128i*)(blk + i), zero);
+    }
+}
+
+#endif /* _MP4DEC_X86_H_ */
@@ -193,6 +193,23 @@ typedef struct tagVLCtab2
 typedef int16 typeDCStore[6];   /*  ACDC */
 typedef int16 typeDCACStore[4][8];
 
+/* IDCT, half-pel prediction and post-filter functions, the C versions or   */
+/*    faster ones for the CPU. Set by InitDecFunctions().                   */
+typedef struct tagDecFuncPtr
+{
+    void (*BlockIDCT)(uint8 *dst, uint8 *pred, int16 *blk, int width, int nzcoefs,
+                      uint8 *bitmapcol, uint8 bitmaprow);
+    void (*BlockIDCT_intra)(MacroBlock *mblock, PIXEL *c_comp, int comp, int width);
+    int (*GetPredAdvB[2][2])(uint8 *c_prev, uint8 *pred_block, int width, int pred_width_rnd);
+    /* post-filter */
+    void (*FindMaxMin)(uint8 *ptr, int *min, int *max, int incr);
+    void (*AdaptiveSmooth)(uint8 *Rec_Y, int v0, int h0, int v_blk, int h_blk,
+                           int thr, int width, int max_diff);
+    void (*HorzEdgeFilter)(uint8 *ptr, int width, int QP, int hard);
+    void (*VertEdgeFilter)(uint8 *ptr, int width, int QP, int hard);
+    void (*HorzEdgeRingFilter)(uint8 *ptr, int width, int QP, int hard);
+    void (*VertEdgeRingFilter)(uint8 *ptr, int width, int QP, int hard);
+} DecFuncPtr;
 
 
 /* Global structure that can be passed around */
@@ -275,6 +292,7 @@ typedef struct tagVideoDecData
 
     PV_STATUS(*vlcDecCoeffIntra)(BitstreamDecVideo *stream, Tcoef *pTcoef/*, int intra_luma*/);
     PV_STATUS(*vlcDecCoeffInter)(BitstreamDecVideo *stream, Tcoef *pTcoef);
+    DecFuncPtr          functionPointer;
     int                 initialized;
 
     /* Annex IJKT */
@@ -72,7 +72,7 @@ void PostFilter(
 
     if ((filter_type & PV_DEBLOCK) && (filter_type & PV_DERING))
     {
-        CombinedHorzVertRingFilter(output, width, height, QP_store, 0, pp_mod);
+        CombinedHorzVertRingFilter(output, width, height, QP_store, 0, pp_mod, &video->functionPointer);
     }
     else
     {
@@ -81,18 +81,18 @@ void PostFilter(
             if (softDeblocking)
             {
                 CombinedHorzVertFilter(output, width, height,
-                                       QP_store, 0, pp_mod);
+                                       QP_store, 0, pp_mod, &video->functionPointer);
             }
             else
             {
                 CombinedHorzVertFilter_NoSoftDeblocking(output, width, height,
-                                                        QP_store, 0, pp_mod);
+                                                        QP_store, 0, pp_mod, &video->functionPointer);
             }
         }
         if (filter_type & PV_DERING)
         {
             Deringing_Luma(output, width, height, QP_store,
-                           combined_with_deblock_filter, pp_mod);
+                           combined_with_deblock_filter, pp_mod, &video->functionPointer);
 
         }
     }
@@ -104,7 +104,7 @@ void PostFilter(
 
     if ((filter_type & PV_DEBLOCK) && (filter_type & PV_DERING))
     {
-        CombinedHorzVertRingFilter(output, (int)(width >> 1), (int)(height >> 1), QP_store, (int) 1, pp_mod);
+        CombinedHorzVertRingFilter(output, (int)(width >> 1), (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
     }
     else
     {
@@ -113,19 +113,19 @@ void PostFilter(
             if (softDeblocking)
             {
                 CombinedHorzVertFilter(output, (int)(width >> 1),
-                                       (int)(height >> 1), QP_store, (int) 1, pp_mod);
+                                       (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
             }
             else
             {
                 CombinedHorzVertFilter_NoSoftDeblocking(output, (int)(width >> 1),
-                                                        (int)(height >> 1), QP_store, (int) 1, pp_mod);
+                                                        (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
             }
         }
         if (filter_type & PV_DERING)
         {
             Deringing_Chroma(output, (int)(width >> 1),
                              (int)(height >> 1), QP_store,
-                             combined_with_deblock_filter, pp_mod);
+                             combined_with_deblock_filter, pp_mod, &video->functionPointer);
         }
     }
 
@@ -134,7 +134,7 @@ void PostFilter(
 
     if ((filter_type & PV_DEBLOCK) && (filter_type & PV_DERING))
     {
-        CombinedHorzVertRingFilter(output, (int)(width >> 1), (int)(height >> 1), QP_store, (int) 1, pp_mod);
+        CombinedHorzVertRingFilter(output, (int)(width >> 1), (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
     }
     else
     {
@@ -143,19 +143,19 @@ void PostFilter(
             if (softDeblocking)
             {
                 CombinedHorzVertFilter(output, (int)(width >> 1),
-                                       (int)(height >> 1), QP_store, (int) 1, pp_mod);
+                                       (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
             }
             else
             {
                 CombinedHorzVertFilter_NoSoftDeblocking(output, (int)(width >> 1),
-                                                        (int)(height >> 1), QP_store, (int) 1, pp_mod);
+                                                        (int)(height >> 1), QP_store, (int) 1, pp_mod, &video->functionPointer);
             }
         }
         if (filter_type & PV_DERING)
         {
             Deringing_Chroma(output, (int)(width >> 1),
                              (int)(height >> 1), QP_store,
-                             combined_with_deblock_filter, pp_mod);
+                             combined_with_deblock_filter, pp_mod, &video->functionPointer);
         }
     }
 
@@ -0,0 +1,425 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+void FindMaxMin_SSE2(uint8 *ptr,int *min,int *max,int incr)
+void AdaptiveSmooth_SSE2(uint8 *Rec_Y,int y_start,int x_start,int y_blk_start,
+                         int x_blk_start,int thr,int width,int max_diff)
+void HorzEdgeFilter_SSE2(uint8 *ptr,int width,int QP,int hard)
+void VertEdgeFilter_SSE2(uint8 *ptr,int width,int QP,int hard)
+void HorzEdgeRingFilter_SSE2(uint8 *ptr,int width,int QP,int hard)
+void VertEdgeRingFilter_SSE2(uint8 *ptr,int width,int QP,int hard)
+
+Same output as the C versions in find_min_max.cpp, adaptive_smooth_no_mmx.cpp,
+chv_filter.cpp and chvr_filter.cpp. The C filters go one pixel at a time
+along the edge but each pixel only changes its own row or column, so here
+the 8 rows or columns across the edge are the lanes of a vector. For a
+vertical edge the 8 rows are transposed first.
+*/
+
+#include "mp4dec_lib.h"
+#include "post_proc.h"
+#include "mp4dec_x86.h"
+
+#ifdef PV_POSTPROC_ON
+
+static inline __m128i Abs16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+/* sign(x) * ((|x| + round) >> shift) */
+static inline __m128i SignedRoundShift(__m128i x, int round, int shift)
+{
+    __m128i neg = _mm_cmplt_epi16(x, _mm_setzero_si128());
+    __m128i y = _mm_srai_epi16(_mm_add_epi16(Abs16(x), _mm_set1_epi16(round)), shift);
+
+    return _mm_sub_epi16(_mm_xor_si128(y, neg), neg);
+}
+
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* ======================================================================== */
+/*  Function : DeblockHard, DeblockSoft                                     */
+/*  Purpose  : The hard and soft filters of CombinedHorzVertFilter() on 8   */
+/*             lanes, x[0] the first pixel past the edge. vert selects the  */
+/*             rounding of the vertical-edge C code. Return 0 if no lane    */
+/*             is filtered.                                                 */
+/* ======================================================================== */
+static inline int DeblockHard(__m128i *x, int QP, int vert)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d = _mm_sub_epi16(x[0], x[-1]);     /* D-C */
+    __m128i cond, avg, t, f, u;
+
+    cond = _mm_andnot_si128(_mm_cmpeq_epi16(d, zero),
+                            _mm_cmplt_epi16(Abs16(d), _mm_set1_epi16(QP << 1)));
+    if (_mm_movemask_epi8(cond) == 0)
+    {
+        return 0;
+    }
+
+    /* C and D to (C+D)/2 */
+    avg = _mm_srai_epi16(_mm_add_epi16(x[-1], x[0]), 1);
+
+    /* B and E by (E-B)/4 */
+    t = SignedRoundShift(_mm_sub_epi16(x[1], x[-2]), 3, 2);
+
+    /* A and F by (F-A)/8 */
+    f = _mm_sub_epi16(x[2], x[-3]);
+    if (vert)
+    {
+        __m128i pos = _mm_srai_epi16(_mm_add_epi16(f, _mm_set1_epi16(7)), 3);
+        __m128i neg = _mm_srai_epi16(_mm_sub_epi16(f, _mm_set1_epi16(7)), 3);
+
+        u = Select(_mm_cmpgt_epi16(f, zero), pos,
+                   _mm_and_si128(_mm_cmplt_epi16(f, zero), neg));
+    }
+    else
+    {
+        u = SignedRoundShift(f, 7, 3);
+    }
+
+    t = _mm_and_si128(cond, t);
+    u = _mm_and_si128(cond, u);
+    x[-3] = _mm_add_epi16(x[-3], u);
+    x[-2] = _mm_add_epi16(x[-2], t);
+    x[-1] = Select(cond, avg, x[-1]);
+    x[0] = Select(cond, avg, x[0]);
+    x[1] = _mm_sub_epi16(x[1], t);
+    x[2] = _mm_sub_epi16(x[2], u);
+
+    return 1;
+}
+
+static inline int DeblockSoft(__m128i *x, int QP, int vert)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i d = _mm_sub_epi16(x[0], x[-1]);     /* C-B */
+    __m128i cond, avg, u;
+
+    cond = _mm_andnot_si128(_mm_cmpeq_epi16(d, zero),
+                            _mm_cmplt_epi16(Abs16(d), _mm_set1_epi16(QP)));
+    if (_mm_movemask_epi8(cond) == 0)
+    {
+        return 0;
+    }
+
+    /* B and C to (B+C)/2, rounded up for a vertical edge */
+    avg = _mm_add_epi16(x[-1], x[0]);
+    if (vert)
+    {
+        avg = _mm_add_epi16(avg, _mm_set1_epi16(1));
+    }
+    avg = _mm_srai_epi16(avg, 1);
+
+    /* A and D by (D-A)/8 */
+    u = _mm_and_si128(cond, SignedRoundShift(_mm_sub_epi16(x[1], x[-2]), 7, 3));
+
+    x[-2] = _mm_add_epi16(x[-2], u);
+    x[-1] = Select(cond, avg, x[-1]);
+    x[0] = Select(cond, avg, x[0]);
+    x[1] = _mm_sub_epi16(x[1], u);
+
+    return 1;
+}
+
+/* ======================================================================== */
+/*  Function : RingHard, RingSoft                                           */
+/*  Purpose  : The hard and soft filters of CombinedHorzVertRingFilter() on */
+/*             8 lanes, x[0] the first pixel past the edge. Return 0 if no  */
+/*             lane is filtered.                                            */
+/* ======================================================================== */
+static inline int RingHard(__m128i *x, int QP)
+{
+    const __m128i r4 = _mm_set1_epi16(4);
+    __m128i a = Abs16(_mm_sub_epi16(x[0], x[-1]));
+    __m128i cond, sum, out[6];
+    int i;
+
+    cond = _mm_and_si128(_mm_cmpgt_epi16(a, _mm_set1_epi16(KThH)),
+                         _mm_cmplt_epi16(a, _mm_set1_epi16(QP)));
+    if (_mm_movemask_epi8(cond) == 0)
+    {
+        return 0;
+    }
+
+    /* x[-3..2] to the 7-tap average around them, with the centre twice */
+    sum = _mm_add_epi16(_mm_add_epi16(x[-6], x[-5]), _mm_add_epi16(x[-4], x[-3]));
+    sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_add_epi16(x[-2], x[-1]), x[0]));
+    for (i = 0; i < 6; i++)
+    {
+        if (i)
+        {
+            sum = _mm_add_epi16(_mm_sub_epi16(sum, x[i - 7]), x[i]);
+        }
+        out[i] = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(sum, x[i - 3]), r4), 3);
+    }
+
+    for (i = 0; i < 6; i++)
+    {
+        x[i - 3] = Select(cond, out[i], x[i - 3]);
+    }
+
+    return 1;
+}
+
+static inline int RingSoft(__m128i *x, int QP)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a, a3_0, a3_1, a3_2, A3_0, delta, apply;
+
+    a = _mm_sub_epi16(x[0], x[-1]);
+    apply = _mm_cmpgt_epi16(Abs16(a), _mm_set1_epi16(KTh));
+    if (_mm_movemask_epi8(apply) == 0)
+    {
+        return 0;
+    }
+
+    /* a3_0 = 5*(x0 - x-1) + 2*(x-2 - x1), and the same one pixel further
+       out on each side */
+    a3_0 = _mm_add_epi16(_mm_add_epi16(a, _mm_slli_epi16(a, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[-2], x[1]), 1));
+    a = _mm_sub_epi16(x[-2], x[-3]);
+    a3_1 = _mm_add_epi16(_mm_add_epi16(a, _mm_slli_epi16(a, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[-4], x[-1]), 1));
+    a = _mm_sub_epi16(x[2], x[1]);
+    a3_2 = _mm_add_epi16(_mm_add_epi16(a, _mm_slli_epi16(a, 2)),
+                         _mm_slli_epi16(_mm_sub_epi16(x[0], x[3]), 1));
+
+    apply = _mm_and_si128(apply, _mm_cmplt_epi16(Abs16(a3_0), _mm_set1_epi16(QP << 3)));
+
+    A3_0 = _mm_sub_epi16(Abs16(a3_0), _mm_min_epi16(Abs16(a3_1), Abs16(a3_2)));
+    apply = _mm_and_si128(apply, _mm_cmpgt_epi16(A3_0, zero));
+    if (_mm_movemask_epi8(apply) == 0)
+    {
+        return 0;
+    }
+
+    /* A3_0 = -sign(a3_0) * (5*A3_0 + 32) >> 6 */
+    A3_0 = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(A3_0, _mm_slli_epi16(A3_0, 2)),
+                                        _mm_set1_epi16(32)), 6);
+    a = _mm_cmpgt_epi16(a3_0, zero);
+    A3_0 = _mm_sub_epi16(_mm_xor_si128(A3_0, a), a);
+
+    /* delta = (x-1 - x0)/2, limited by A3_0 as in the C code */
+    delta = _mm_srai_epi16(_mm_sub_epi16(x[-1], x[0]), 1);
+    {
+        __m128i dneg = _mm_cmplt_epi16(delta, zero);
+        __m128i pos = Select(_mm_cmplt_epi16(delta, A3_0), delta, _mm_max_epi16(A3_0, zero));
+        __m128i neg = _mm_andnot_si128(_mm_cmpgt_epi16(A3_0, zero), _mm_max_epi16(A3_0, delta));
+
+        delta = _mm_and_si128(apply, Select(dneg, neg, pos));
+    }
+
+    x[-1] = _mm_sub_epi16(x[-1], delta);
+    x[0] = _mm_add_epi16(x[0], delta);
+
+    return 1;
+}
+
+void HorzEdgeFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    __m128i r[6], *x = r + 3;
+    int i;
+
+    for (i = -3; i < 3; i++)
+    {
+        x[i] = LoadPel8(ptr + i * width);
+    }
+
+    if (hard ? DeblockHard(x, QP, 0) : DeblockSoft(x, QP, 0))
+    {
+        for (i = -3; i < 3; i++)
+        {
+            StorePel8(ptr + i * width, x[i]);
+        }
+    }
+}
+
+void VertEdgeFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    __m128i c[8], *x = c + 4;
+    int i;
+
+    /* columns -4..3 of the 8 rows, one lane per row */
+    for (i = 0; i < 8; i++)
+    {
+        c[i] = LoadPel8(ptr - 4 + i * width);
+    }
+    Transpose8x8(c);
+
+    if (hard ? DeblockHard(x, QP, 1) : DeblockSoft(x, QP, 1))
+    {
+        Transpose8x8(c);
+        for (i = 0; i < 8; i++)
+        {
+            StorePel8(ptr - 4 + i * width, c[i]);
+        }
+    }
+}
+
+void HorzEdgeRingFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    __m128i r[12], *x = r + 6;
+    int i;
+
+    for (i = -6; i < 6; i++)
+    {
+        x[i] = LoadPel8(ptr + i * width);
+    }
+
+    if (hard ? RingHard(x, QP) : RingSoft(x, QP))
+    {
+        for (i = -3; i < 3; i++)
+        {
+            StorePel8(ptr + i * width, x[i]);
+        }
+    }
+}
+
+void VertEdgeRingFilter_SSE2(uint8 *ptr, int width, int QP, int hard)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+    __m128i c[16], *x = c + 8;
+    int i;
+
+    /* columns -8..7 of the 8 rows, one lane per row */
+    for (i = 0; i < 8; i++)
+    {
+        __m128i p = _mm_loadu_si128((__m128i*)(ptr - 8 + i * width));
+
+        c[i] = _mm_unpacklo_epi8(p, zero);
+        c[i + 8] = _mm_unpackhi_epi8(p, zero);
+    }
+    Transpose8x8(c);
+    Transpose8x8(c + 8);
+
+    if (hard ? RingHard(x, QP) : RingSoft(x, QP))
+    {
+        Transpose8x8(c);
+        Transpose8x8(c + 8);
+        for (i = 0; i < 8; i++)
+        {
+            __m128i p = _mm_packus_epi16(_mm_and_si128(c[i], lowByte),
+                                         _mm_and_si128(c[i + 8], lowByte));
+
+            _mm_storeu_si128((__m128i*)(ptr - 8 + i * width), p);
+        }
+    }
+}
+
+void FindMaxMin_SSE2(uint8 *ptr, int *min, int *max, int incr)
+{
+    __m128i lo, hi;
+    int i;
+
+    incr += BLKSIZE;
+    lo = hi = _mm_loadl_epi64((__m128i*)ptr);
+    for (i = 1; i < BLKSIZE; i++)
+    {
+        __m128i x = _mm_loadl_epi64((__m128i*)(ptr += incr));
+
+        lo = _mm_min_epu8(lo, x);
+        hi = _mm_max_epu8(hi, x);
+    }
+
+    /* fold the 8 bytes */
+    lo = _mm_min_epu8(lo, _mm_srli_epi64(lo, 32));
+    lo = _mm_min_epu8(lo, _mm_srli_epi64(lo, 16));
+    lo = _mm_min_epu8(lo, _mm_srli_epi64(lo, 8));
+    hi = _mm_max_epu8(hi, _mm_srli_epi64(hi, 32));
+    hi = _mm_max_epu8(hi, _mm_srli_epi64(hi, 16));
+    hi = _mm_max_epu8(hi, _mm_srli_epi64(hi, 8));
+
+    *min = _mm_cvtsi128_si32(lo) & 0xFF;
+    *max = _mm_cvtsi128_si32(hi) & 0xFF;
+}
+
+/* ======================================================================== */
+/*  Function : AdaptiveSmooth_SSE2                                          */
+/*  Purpose  : AdaptiveSmooth_NoMMX() on a whole 8x8 block, one row at a    */
+/*             time. Every output pixel only depends on the unfiltered      */
+/*             pixels, so the 10 rows around the block are read first. The  */
+/*             other regions go to the C version.                           */
+/* ======================================================================== */
+void AdaptiveSmooth_SSE2(uint8 *Rec_Y, int y_start, int x_start, int y_blk_start,
+                         int x_blk_start, int thr, int width, int max_diff)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i thres = _mm_set1_epi16(thr);
+    const __m128i diff = _mm_set1_epi16(max_diff);
+    __m128i hsum[10], hmin[10], hmax[10], org[10];
+    uint8 *ptr;
+    int i;
+
+    if (y_start != y_blk_start - 1 || x_start != x_blk_start - 1)
+    {
+        AdaptiveSmooth_NoMMX(Rec_Y, y_start, x_start, y_blk_start, x_blk_start,
+                             thr, width, max_diff);
+        return ;
+    }
+
+    /* rows -1..8: the [1 2 1] sums and the min and max of the 3 pixels
+       around each pixel of the row */
+    ptr = Rec_Y + (int32)y_start * width + x_blk_start;
+    for (i = 0; i < 10; i++)
+    {
+        __m128i l = _mm_loadl_epi64((__m128i*)(ptr - 1));
+        __m128i c = _mm_loadl_epi64((__m128i*)ptr);
+        __m128i r = _mm_loadl_epi64((__m128i*)(ptr + 1));
+
+        hmin[i] = _mm_unpacklo_epi8(_mm_min_epu8(_mm_min_epu8(l, c), r), zero);
+        hmax[i] = _mm_unpacklo_epi8(_mm_max_epu8(_mm_max_epu8(l, c), r), zero);
+        org[i] = _mm_unpacklo_epi8(c, zero);
+        hsum[i] = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(l, zero), _mm_unpacklo_epi8(r, zero)),
+                                _mm_slli_epi16(org[i], 1));
+        ptr += width;
+    }
+
+    ptr = Rec_Y + (int32)y_blk_start * width + x_blk_start;
+    for (i = 1; i < 9; i++)
+    {
+        __m128i sum, lo, hi, apply;
+
+        /* smooth if all 9 pixels are >= thr or all are below it */
+        lo = _mm_min_epi16(_mm_min_epi16(hmin[i - 1], hmin[i]), hmin[i + 1]);
+        hi = _mm_max_epi16(_mm_max_epi16(hmax[i - 1], hmax[i]), hmax[i + 1]);
+        apply = _mm_or_si128(_mm_andnot_si128(_mm_cmpgt_epi16(thres, lo), _mm_cmpeq_epi16(zero, zero)),
+                             _mm_cmpgt_epi16(thres, hi));
+
+        if (_mm_movemask_epi8(apply))
+        {
+            sum = _mm_add_epi16(_mm_add_epi16(hsum[i - 1], hsum[i + 1]), _mm_slli_epi16(hsum[i], 1));
+            sum = _mm_srai_epi16(_mm_add_epi16(sum, _mm_set1_epi16(8)), 4);
+
+            /* at most max_diff away from the original pixel */
+            sum = _mm_max_epi16(sum, _mm_sub_epi16(org[i], diff));
+            sum = _mm_min_epi16(sum, _mm_add_epi16(org[i], diff));
+
+            sum = Select(apply, sum, org[i]);
+            _mm_storel_epi64((__m128i*)ptr, _mm_packus_epi16(sum, sum));
+        }
+        ptr += width;
+    }
+}
+
+#endif
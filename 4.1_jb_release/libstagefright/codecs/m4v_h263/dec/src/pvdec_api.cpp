@@ -19,6 +19,10 @@
 #include "vlc_decode.h"
 #include "bitstream.h"
 
+#ifdef M4VDEC_X86
+#include "x86_cpu.h"
+#endif
+
 #define OSCL_DISABLE_WARNING_CONDITIONAL_IS_CONSTANT
 
 #ifdef DEC_INTERNAL_MEMORY_OPT
@@ -90,6 +94,7 @@ OSCL_EXPORT_REF Bool PVInitVideoDecoder(VideoDecControls *decCtrl, uint8 *volbuf
     if (video != NULL)
     {
         oscl_memset(video, 0, sizeof(VideoDecData));
+        InitDecFunctions(&video->functionPointer);
         video->memoryUsage = sizeof(VideoDecData);
         video->numberOfLayers = nLayers;
 #ifdef DEC_INTERNAL_MEMORY_OPT
@@ -1698,5 +1703,55 @@ Bool PVGetVolInfo(VideoDecControls *decCtrl, VolInfo *pVolInfo)
     return PV_TRUE;
 }
 
+/* ======================================================================== */
+/*  Function : InitDecFunctions()                                           */
+/*  Purpose  : Select the IDCT, half-pel prediction and post-filter         */
+/*             functions for this CPU. All versions give the same results.  */
+/* ======================================================================== */
+void InitDecFunctions(DecFuncPtr *functionPointer)
+{
+    functionPointer->BlockIDCT = &BlockIDCT;
+    functionPointer->BlockIDCT_intra = &BlockIDCT_intra;
+    functionPointer->GetPredAdvB[0][0] = &GetPredAdvancedBy0x0;
+    functionPointer->GetPredAdvB[0][1] = &GetPredAdvancedBy0x1;
+    functionPointer->GetPredAdvB[1][0] = &GetPredAdvancedBy1x0;
+    functionPointer->GetPredAdvB[1][1] = &GetPredAdvancedBy1x1;
+#ifdef PV_POSTPROC_ON
+    functionPointer->FindMaxMin = &FindMaxMin;
+    functionPointer->AdaptiveSmooth = &AdaptiveSmooth_NoMMX;
+    functionPointer->HorzEdgeFilter = &HorzEdgeFilter;
+    functionPointer->VertEdgeFilter = &VertEdgeFilter;
+    functionPointer->HorzEdgeRingFilter = &HorzEdgeRingFilter;
+    functionPointer->VertEdgeRingFilter = &VertEdgeRingFilter;
+#endif
 
+#ifdef M4VDEC_X86
+    uint features = x86_cpu_get_features();
 
+    if (features & X86_CPU_SSE2)
+    {
+        functionPointer->BlockIDCT = &BlockIDCT_SSE2;
+        functionPointer->BlockIDCT_intra = &BlockIDCT_intra_SSE2;
+        functionPointer->GetPredAdvB[0][0] = &GetPredAdvancedBy0x0_SSE2;
+        functionPointer->GetPredAdvB[0][1] = &GetPredAdvancedBy0x1_SSE2;
+        functionPointer->GetPredAdvB[1][0] = &GetPredAdvancedBy1x0_SSE2;
+        functionPointer->GetPredAdvB[1][1] = &GetPredAdvancedBy1x1_SSE2;
+#ifdef PV_POSTPROC_ON
+        functionPointer->FindMaxMin = &FindMaxMin_SSE2;
+        functionPointer->AdaptiveSmooth = &AdaptiveSmooth_SSE2;
+        functionPointer->HorzEdgeFilter = &HorzEdgeFilter_SSE2;
+        functionPointer->VertEdgeFilter = &VertEdgeFilter_SSE2;
+        functionPointer->HorzEdgeRingFilter = &HorzEdgeRingFilter_SSE2;
+        functionPointer->VertEdgeRingFilter = &VertEdgeRingFilter_SSE2;
+#endif
+    }
+
+    if (features & X86_CPU_AVX2)
+    {
+        functionPointer->BlockIDCT = &BlockIDCT_AVX2;
+        functionPointer->BlockIDCT_intra = &BlockIDCT_intra_AVX2;
+    }
+#endif
+
+    return ;
+}
@@ -0,0 +1,566 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: M4VDecBench.cpp
+ * Brief: Checks the IDCT, motion compensation and post-filter functions of
+ *        the MPEG-4/H.263 decoder and times the decoder with each set
+ *
+ * The functions of every set the CPU supports are first run on the same
+ * random blocks as the C versions and must give the same pixels. The
+ * elementary stream is then decoded once per set, the way SoftMPEG4 drives
+ * the decoder, and the decoded (and post-filtered with -p) frames must be
+ * identical. Exits with 1 on the first difference.
+ *
+ * This times the decoder library alone, set against set. The SoftMPEG4
+ * component, with its OMX buffer handling, is timed on the device by
+ * codec_component_bench -c OMX.google.mpeg4.decoder -d clip.
+ *
+ * usage: M4VDecBench [-n frames] [-p postproc] [-h] input width height
+ *
+ *   -p  1 deblocking, 2 deringing, 3 both; SoftMPEG4 uses 0
+ *   -h  H.263 stream instead of MPEG-4
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "mp4dec_lib.h"
+#include "zigzag.h"
+
+typedef struct
+{
+    const char *pName;
+    const char *pCpu;       /* STAGEFRIGHT_X86_CPU, NULL for the best the CPU has */
+    DecFuncPtr func;
+
+} FunctionSet;
+
+static FunctionSet sets[] =
+{
+    { "c",    "c",    },
+#ifdef M4VDEC_X86
+    { "sse2", "sse2", },
+    { "avx2", NULL,   },
+#endif
+};
+
+#define NUM_SETS    ((int)(sizeof(sets) / sizeof(sets[0])))
+
+static uint32_t randState;
+
+static uint32_t Rand(void)
+{
+    randState = randState * 1664525 + 1013904223;
+    return randState >> 8;
+}
+
+static void SelectSet(const FunctionSet *set)
+{
+    if (set->pCpu != NULL)
+    {
+        setenv("STAGEFRIGHT_X86_CPU", set->pCpu, 1);
+    }
+    else
+    {
+        unsetenv("STAGEFRIGHT_X86_CPU");
+    }
+}
+
+/* Sets whose functions are the same as those of the set before, because the
+   CPU doesn't have the instructions, are not run */
+static int InitSets(void)
+{
+    int i, num = 0;
+
+    for (i = 0; i < NUM_SETS; i++)
+    {
+        SelectSet(&sets[i]);
+        InitDecFunctions(&sets[i].func);
+
+        if (num > 0 && !memcmp(&sets[i].func, &sets[num - 1].func, sizeof(DecFuncPtr)))
+        {
+            continue;
+        }
+        sets[num++] = sets[i];
+    }
+
+    return num;
+}
+
+static void RandomPixels(uint8 *p, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+    {
+        p[i] = (uint8)Rand();
+    }
+}
+
+/* A picture area with an edge through the middle: two flat sides a step
+   apart plus a little noise, so that all the filter conditions are hit */
+static void RandomEdge(uint8 *p, int width, int height, int vert)
+{
+    int base = Rand() & 0xFF;
+    int step = (int)(Rand() % 65) - 32;
+    int noise = 1 + (Rand() % 8);
+    int i, j;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            int far = vert ? (i >= width / 2) : (j >= height / 2);
+            int v = base + (far ? step : 0) + (int)(Rand() % noise) - noise / 2;
+
+            p[j * width + i] = (uint8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+}
+
+/* Coefficients as vlc_dequant leaves them: in the first nz zigzag positions,
+   or anywhere with nz 64 for the alternate scans, and the bitmaps to match.
+   bitmaprow only has the bits of columns 1 to 3. */
+static int RandomCoeffs(int16 *blk, uint8 *bitmapcol, uint8 *bitmaprow)
+{
+    int nz, i, k;
+    int range = 1 << (1 + (Rand() % 12));
+
+    memset(blk, 0, 64 * sizeof(int16));
+    memset(bitmapcol, 0, 8);
+    *bitmaprow = 0;
+
+    switch (Rand() % 4)
+    {
+        case 0:
+            nz = 1;
+            break;
+        case 1:
+            nz = 2 + (Rand() % 9);
+            break;
+        case 2:
+            nz = 64;
+            break;
+        default:
+            nz = 11 + (Rand() % 54);
+            break;
+    }
+
+    for (i = 0; i < nz; i++)
+    {
+        int v = (Rand() % 3 && i != nz - 1) ? 0 : (int)(Rand() % range) - range / 2;
+
+        if (nz == 64)
+        {
+            k = Rand() % 64;
+        }
+        else
+        {
+            k = zigzag_inv[i];
+            if (i == nz - 1 && v == 0)
+            {
+                v = 1;
+            }
+        }
+        v = v < -2048 ? -2048 : (v > 2047 ? 2047 : v);
+        blk[k] = (int16)v;
+        if (v)
+        {
+            bitmapcol[k & 0x7] |= 0x80 >> (k >> 3);
+        }
+    }
+
+    for (k = 1; k < 4; k++)
+    {
+        if (bitmapcol[k])
+        {
+            *bitmaprow |= 0x80 >> k;
+        }
+    }
+
+    return nz;
+}
+
+static int CheckSet(const FunctionSet *set, const FunctionSet *ref,
+                    int iterations)
+{
+    static MacroBlock mbA, mbB;
+    uint8 pred[16 * 8];
+    uint8 prev[80 * 24];
+    uint8 picA[48 * 48], picB[48 * 48];
+    int16 blkA[64], blkB[64];
+    int i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        int width = 24 + (Rand() % 25);
+        int QP = 1 + (Rand() % 31);
+        int hard = Rand() & 1;
+        uint8 *ptr = picA + 16 * width + 16;
+        int k, nz, x, y, minA, maxA, minB, maxB;
+
+        /* IDCT with prediction */
+        nz = RandomCoeffs(blkA, mbA.bitmapcol[0], &mbA.bitmaprow[0]);
+        memcpy(blkB, blkA, sizeof(blkA));
+        RandomPixels(pred, sizeof(pred));
+        RandomPixels(picA, sizeof(picA));
+        memcpy(picB, picA, sizeof(picA));
+        (*ref->func.BlockIDCT)(picA, pred, blkA, width, nz, mbA.bitmapcol[0], mbA.bitmaprow[0]);
+        (*set->func.BlockIDCT)(picB, pred, blkB, width, nz, mbA.bitmapcol[0], mbA.bitmaprow[0]);
+        if (memcmp(picA, picB, sizeof(picA)) || memcmp(blkA, blkB, sizeof(blkA)))
+        {
+            printf("BlockIDCT: %s and %s differ, iteration %d\n",
+                   ref->pName, set->pName, i);
+            return 1;
+        }
+
+        /* intra IDCT */
+        k = Rand() % 6;
+        mbA.no_coeff[k] = RandomCoeffs(mbA.block[k], mbA.bitmapcol[k], &mbA.bitmaprow[k]);
+        memcpy(&mbB, &mbA, sizeof(mbA));
+        (*ref->func.BlockIDCT_intra)(&mbA, picA, k, width);
+        (*set->func.BlockIDCT_intra)(&mbB, picB, k, width);
+        if (memcmp(picA, picB, sizeof(picA)) || memcmp(mbA.block[k], mbB.block[k], 64 * sizeof(int16)))
+        {
+            printf("BlockIDCT_intra: %s and %s differ, iteration %d\n",
+                   ref->pName, set->pName, i);
+            return 1;
+        }
+
+        /* prediction at the four half-pel positions */
+        x = Rand() & 1;
+        y = Rand() & 1;
+        RandomPixels(prev, sizeof(prev));
+        {
+            int lx = 9 + (Rand() % 72);
+            int rnd = Rand() & 1;
+            int retA, retB;
+
+            memset(picA, 0, sizeof(picA));
+            memset(picB, 0, sizeof(picB));
+            retA = (*ref->func.GetPredAdvB[y][x])(prev, picA, lx, (16 << 1) | rnd);
+            retB = (*set->func.GetPredAdvB[y][x])(prev, picB, lx, (16 << 1) | rnd);
+            if (retA != retB || memcmp(picA, picB, sizeof(picA)))
+            {
+                printf("GetPredAdvB[%d][%d]: %s and %s differ, iteration %d\n",
+                       y, x, ref->pName, set->pName, i);
+                return 1;
+            }
+        }
+
+        /* deblocking and deringing across an edge at (16, 16) */
+        x = Rand() & 1;
+        RandomEdge(picA, width, 32, x);
+        memcpy(picB, picA, sizeof(picA));
+        switch (Rand() % 4)
+        {
+            case 0:
+                (*(x ? ref->func.VertEdgeFilter : ref->func.HorzEdgeFilter))(ptr, width, QP, hard);
+                (*(x ? set->func.VertEdgeFilter : set->func.HorzEdgeFilter))(ptr - picA + picB, width, QP, hard);
+                break;
+            default:
+                (*(x ? ref->func.VertEdgeRingFilter : ref->func.HorzEdgeRingFilter))(ptr, width, QP, hard);
+                (*(x ? set->func.VertEdgeRingFilter : set->func.HorzEdgeRingFilter))(ptr - picA + picB, width, QP, hard);
+                break;
+        }
+        if (memcmp(picA, picB, sizeof(picA)))
+        {
+            printf("%s edge filter: %s and %s differ, iteration %d\n",
+                   x ? "vertical" : "horizontal", ref->pName, set->pName, i);
+            return 1;
+        }
+
+        /* range and adaptive smoothing of the block at (16, 16) */
+        (*ref->func.FindMaxMin)(ptr, &minA, &maxA, width - 8);
+        (*set->func.FindMaxMin)(ptr, &minB, &maxB, width - 8);
+        if (minA != minB || maxA != maxB)
+        {
+            printf("FindMaxMin: %s and %s differ, iteration %d\n",
+                   ref->pName, set->pName, i);
+            return 1;
+        }
+        x = 15 + (Rand() % 4 == 0);
+        y = 15 + (Rand() % 4 == 0);
+        {
+            int thr = (minA + maxA + 1) >> 1;
+            int max_diff = 1 + (Rand() % 8);
+
+            if (Rand() & 1)
+            {
+                thr = Rand() & 0xFF;
+            }
+            (*ref->func.AdaptiveSmooth)(picA, y, x, 16, 16, thr, width, max_diff);
+            (*set->func.AdaptiveSmooth)(picB, y, x, 16, 16, thr, width, max_diff);
+        }
+        if (memcmp(picA, picB, sizeof(picA)))
+        {
+            printf("AdaptiveSmooth: %s and %s differ, iteration %d\n",
+                   ref->pName, set->pName, i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+    Decoder
+------------------------------------------------------------------------------*/
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct
+{
+    uint8 *pStream;
+    int32 size;
+    int width, height;
+    int frames;
+    int postProc;
+    int h263;
+
+} DecodeParams;
+
+typedef struct
+{
+    int frames;
+    uint32_t hash;          /* FNV-1a of the output frames */
+    double seconds;         /* spent in the decoder */
+
+} DecodeResult;
+
+/* Size of the VOL header at the start of an MPEG-4 stream: everything
+   before the first VOP start code */
+static int32 VolSize(const uint8 *p, int32 size)
+{
+    int32 i;
+
+    for (i = 0; i + 3 < size; i++)
+    {
+        if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 1 && p[i + 3] == 0xB6)
+        {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+/* Decodes the stream with the functions selected by set, as SoftMPEG4 does:
+   the VOL header first, then a frame at a time into two output buffers in
+   turn. Returns 0, or -1 on error. */
+static int Decode(const FunctionSet *set, const DecodeParams *p, DecodeResult *result)
+{
+    VideoDecControls handle;
+    MP4DecodingMode mode = p->h263 ? H263_MODE : MPEG4_MODE;
+    uint8 *volData[1];
+    int32 volSize = 0;
+    uint8 *bitstream = p->pStream;
+    int32 left = p->size;
+    uint8 *frame[2], *post = NULL;
+    int32 bufWidth, bufHeight, frameSize, i;
+    double start;
+
+    volData[0] = NULL;
+    if (!p->h263)
+    {
+        volData[0] = bitstream;
+        volSize = VolSize(bitstream, left);
+        bitstream += volSize;
+        left -= volSize;
+    }
+
+    SelectSet(set);
+    memset(&handle, 0, sizeof(handle));
+    memset(result, 0, sizeof(*result));
+    result->hash = 2166136261u;
+
+    start = Now();
+    if (!PVInitVideoDecoder(&handle, volData, &volSize, 1, p->width, p->height, mode) ||
+            PVGetDecBitstreamMode(&handle) != mode)
+    {
+        printf("PVInitVideoDecoder failed\n");
+        return -1;
+    }
+    PVSetPostProcType(&handle, p->postProc);
+    result->seconds += Now() - start;
+
+    PVGetBufferDimensions(&handle, &bufWidth, &bufHeight);
+    frameSize = bufWidth * bufHeight * 3 / 2;
+    frame[0] = (uint8 *)calloc(frameSize, 1);
+    frame[1] = (uint8 *)calloc(frameSize, 1);
+    if (p->postProc)
+    {
+        post = (uint8 *)calloc(frameSize, 1);
+    }
+    PVSetReferenceYUV(&handle, frame[1]);
+
+    while (result->frames < p->frames && left > 0)
+    {
+        uint8 *out = frame[result->frames & 1];
+        uint32 timestamp = 0xFFFFFFFF;
+        uint useExtTimestamp = 0;
+        int32 size = left;
+
+        start = Now();
+        if (PVDecodeVideoFrame(&handle, &bitstream, &timestamp, &size,
+                               &useExtTimestamp, out) != PV_TRUE)
+        {
+            break;
+        }
+        if (post != NULL)
+        {
+            PVDecPostProcess(&handle, post);
+            out = post;
+        }
+        result->seconds += Now() - start;
+
+        if (size >= left)
+        {
+            break;
+        }
+        bitstream += left - size;
+        left = size;
+        result->frames++;
+
+        for (i = 0; i < frameSize; i++)
+        {
+            result->hash = (result->hash ^ out[i]) * 16777619;
+        }
+    }
+
+    PVCleanUpVideoDecoder(&handle);
+
+    free(post);
+    free(frame[1]);
+    free(frame[0]);
+
+    return 0;
+}
+
+static void Usage(void)
+{
+    printf("usage: M4VDecBench [-n frames] [-p postproc] [-h] input width height\n");
+}
+
+int main(int argc, char **argv)
+{
+    DecodeParams p;
+    DecodeResult results[NUM_SETS];
+    FILE *input;
+    long size;
+    int numSets, i, arg;
+
+    p.frames = 1000000;
+    p.postProc = 0;
+    p.h263 = 0;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (!strcmp(argv[arg], "-h"))
+        {
+            p.h263 = 1;
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-n"))
+        {
+            p.frames = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-p"))
+        {
+            p.postProc = atoi(argv[++arg]);
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (argc - arg != 3)
+    {
+        Usage();
+        return 1;
+    }
+    p.width = atoi(argv[arg + 1]);
+    p.height = atoi(argv[arg + 2]);
+    if (p.width <= 0 || p.height <= 0 || p.frames <= 0 ||
+            p.postProc < 0 || p.postProc > (PV_DEBLOCK | PV_DERING))
+    {
+        Usage();
+        return 1;
+    }
+
+    input = fopen(argv[arg], "rb");
+    if (input == NULL)
+    {
+        printf("cannot open %s\n", argv[arg]);
+        return 1;
+    }
+    fseek(input, 0, SEEK_END);
+    size = ftell(input);
+    fseek(input, 0, SEEK_SET);
+    p.pStream = (uint8 *)malloc(size > 0 ? size : 1);
+    p.size = (int32)fread(p.pStream, 1, size, input);
+    fclose(input);
+
+    numSets = InitSets();
+
+    randState = 1;
+    for (i = 1; i < numSets; i++)
+    {
+        if (CheckSet(&sets[i], &sets[0], 100000))
+        {
+            return 1;
+        }
+        printf("%s: same results as %s over 100000 blocks\n",
+               sets[i].pName, sets[0].pName);
+    }
+
+    printf("\n%dx%d, %s, post-processing %d\n", p.width, p.height,
+           p.h263 ? "H.263" : "MPEG-4", p.postProc);
+
+    for (i = 0; i < numSets; i++)
+    {
+        if (Decode(&sets[i], &p, &results[i]) < 0)
+        {
+            return 1;
+        }
+
+        printf("%-6s %4d frames %8.2f fps\n", sets[i].pName,
+               results[i].frames, results[i].frames / results[i].seconds);
+
+        if (i > 0 && (results[i].frames != results[0].frames ||
+                      results[i].hash != results[0].hash))
+        {
+            printf("%s: the frames differ from %s\n",
+                   sets[i].pName, sets[0].pName);
+            return 1;
+        }
+    }
+
+    free(p.pStream);
+
+    return 0;
+}
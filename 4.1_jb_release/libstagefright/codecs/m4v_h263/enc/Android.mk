@@ -33,8 +33,43 @@ LOCAL_C_INCLUDES := \
     $(TOP)/frameworks/av/media/libstagefright/include \
     $(TOP)/frameworks/native/include/media/openmax
 
+# x86: SSE2 and AVX2 versions of the DCT, quantizer and IDCT functions, picked
+# at run time. The AVX2 ones are in libstagefright_m4vh263enc_avx2 below, which
+# has to be linked along with this library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+    src/dct_sse2.cpp \
+    src/fastquant_sse2.cpp
+
+LOCAL_CFLAGS += -DM4VENC_X86 -msse2
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../common/include
+endif
+
 include $(BUILD_STATIC_LIBRARY)
 
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    src/dct_avx2.cpp
+
+LOCAL_MODULE := libstagefright_m4vh263enc_avx2
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/src \
+    $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+    -DBX_RC -DM4VENC_X86 -mavx2 \
+    -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
+
+include $(BUILD_STATIC_LIBRARY)
+
+endif
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -58,6 +93,11 @@ LOCAL_CFLAGS := \
 LOCAL_STATIC_LIBRARIES := \
         libstagefright_m4vh263enc
 
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_m4vh263enc_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_SHARED_LIBRARIES := \
         libstagefright \
         libstagefright_enc_common \
@@ -70,3 +110,34 @@ LOCAL_MODULE := libstagefright_soft_mpeg4enc
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
+
+################################################################################
+# test utility: checks the DCT, quantizer and IDCT functions and times the
+# encoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/M4VEncBench.cpp
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+    -DBX_RC \
+    -DOSCL_IMPORT_REF= -DOSCL_UNUSED_ARG= -DOSCL_EXPORT_REF=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_m4vh263enc
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DM4VENC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_m4vh263enc_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := m4venc_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
@@ -31,6 +31,22 @@
 
 namespace android {
 
+// Vendor index of the "OMX.google.android.index.encoderSpeedPreset" extension,
+// an OMX_PARAM_U32TYPE on the output port selecting an entry of kSpeedPresets.
+static const OMX_INDEXTYPE kIndexEncoderSpeedPreset =
+    (OMX_INDEXTYPE)(OMX_IndexVendorStartUnused + 1);
+
+// Motion search of each speed preset, from the slowest
+static const struct {
+    MESearchType mSearch;
+    uint32_t mEarlyExitSAD;
+} kSpeedPresets[] = {
+    { ME_SPIRAL,  0   },
+    { ME_EPZS,    512 },
+    { ME_HEXAGON, 768 },
+    { ME_DIAMOND, 768 },
+};
+
 template<class T>
 static void InitOMXParams(T *params) {
     params->nSize = sizeof(T);
@@ -83,6 +99,7 @@ SoftMPEG4Encoder::SoftMPEG4Encoder(
       mVideoBitRate(192000),
       mVideoColorFormat(OMX_COLOR_FormatYUV420Planar),
       mIDRFrameRefreshIntervalInSec(1),
+      mSpeedPreset(0),
       mNumInputFrames(-1),
       mStarted(false),
       mSawInputEOS(false),
@@ -170,6 +187,8 @@ OMX_ERRORTYPE SoftMPEG4Encoder::initEncParams() {
     mEncParams->numIntraMB = 0;
     mEncParams->sceneDetect = PV_ON;
     mEncParams->searchRange = 16;
+    mEncParams->meSearch = kSpeedPresets[mSpeedPreset].mSearch;
+    mEncParams->meEarlyExitSAD = kSpeedPresets[mSpeedPreset].mEarlyExitSAD;
     mEncParams->mv8x8Enable = PV_OFF;
     mEncParams->gobHeaderInterval = 0;
     mEncParams->useACPred = PV_ON;
@@ -292,6 +311,17 @@ void SoftMPEG4Encoder::initPorts() {
 
 OMX_ERRORTYPE SoftMPEG4Encoder::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
+    if (index == kIndexEncoderSpeedPreset) {
+        OMX_PARAM_U32TYPE *presetParams = (OMX_PARAM_U32TYPE *)params;
+
+        if (presetParams->nPortIndex != 1) {
+            return OMX_ErrorUndefined;
+        }
+
+        presetParams->nU32 = mSpeedPreset;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamVideoErrorCorrection:
         {
@@ -420,6 +450,19 @@ OMX_ERRORTYPE SoftMPEG4Encoder::internalGetParameter(
 
 OMX_ERRORTYPE SoftMPEG4Encoder::internalSetParameter(
         OMX_INDEXTYPE index, const OMX_PTR params) {
+    if (index == kIndexEncoderSpeedPreset) {
+        const OMX_PARAM_U32TYPE *presetParams =
+            (const OMX_PARAM_U32TYPE *)params;
+
+        if (presetParams->nPortIndex != 1 ||
+            presetParams->nU32 >= sizeof(kSpeedPresets) / sizeof(kSpeedPresets[0])) {
+            return OMX_ErrorUndefined;
+        }
+
+        mSpeedPreset = presetParams->nU32;
+        return OMX_ErrorNone;
+    }
+
     switch (index) {
         case OMX_IndexParamVideoErrorCorrection:
         {
@@ -583,6 +626,16 @@ OMX_ERRORTYPE SoftMPEG4Encoder::internalSetParameter(
     }
 }
 
+OMX_ERRORTYPE SoftMPEG4Encoder::getExtensionIndex(
+        const char *name, OMX_INDEXTYPE *index) {
+    if (!strcmp(name, "OMX.google.android.index.encoderSpeedPreset")) {
+        *index = kIndexEncoderSpeedPreset;
+        return OMX_ErrorNone;
+    }
+
+    return SimpleSoftOMXComponent::getExtensionIndex(name, index);
+}
+
 void SoftMPEG4Encoder::onQueueFilled(OMX_U32 portIndex) {
     if (mSignalledError || mSawInputEOS) {
         return;
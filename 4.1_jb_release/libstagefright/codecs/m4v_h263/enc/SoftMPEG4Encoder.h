@@ -41,6 +41,9 @@ struct SoftMPEG4Encoder : public SimpleSoftOMXComponent {
     virtual OMX_ERRORTYPE internalSetParameter(
             OMX_INDEXTYPE index, const OMX_PTR params);
 
+    virtual OMX_ERRORTYPE getExtensionIndex(
+            const char *name, OMX_INDEXTYPE *index);
+
     virtual void onQueueFilled(OMX_U32 portIndex);
 
 protected:
@@ -64,6 +67,7 @@ private:
     int32_t  mVideoBitRate;
     int32_t  mVideoColorFormat;
     int32_t  mIDRFrameRefreshIntervalInSec;
+    uint32_t mSpeedPreset;  // motion search, from 0, the slowest
 
     int64_t  mNumInputFrames;
     bool     mStarted;
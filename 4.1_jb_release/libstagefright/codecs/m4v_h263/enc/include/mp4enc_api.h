@@ -72,6 +72,17 @@ typedef enum
     PV_ON
 } ParamEncMode;
 
+/* full-pel motion search patterns, all of them starting from the best of the
+   spatio-temporal candidates */
+typedef enum
+{
+    ME_SPIRAL,  /* 3x3 spiral steps, the original search */
+    ME_DIAMOND, /* small diamond steps */
+    ME_HEXAGON, /* hexagon steps, then one 3x3 step */
+    ME_EPZS     /* predictive zonal search: the median MV of the neighbors and (0,0) as
+                   more candidates, then small diamond steps */
+} MESearchType;
+
 
 /* {SPL0, SPL1, SPL2, SPL3, CPL1, CPL2, CPL2, CPL2} , SPL0: Simple Profile@Level0 , CPL1: Core Profile@Level1 */
 /* {SSPL0, SSPL1, SSPL2, SSPL2, CSPL1, CSPL2, CSPL3, CSPL3} , SSPL0: Simple Scalable Profile@Level0, CPL1: Core Scalable Profile@Level1 */
@@ -234,6 +245,14 @@ typedef struct tagvideoEncOptions
     /** @brief This flag turns on the use of AC prediction */
     Bool                useACPred;
 
+    /** @brief  Selects the full-pel motion search pattern of the 16x16 motion vectors. ME_SPIRAL is the default,
+    *           the others evaluate fewer positions. */
+    MESearchType        meSearch;
+
+    /** @brief  Sets the SAD of the best 16x16 candidate at or below which it is taken without
+    *           refining it. 0, the default, always refines it. */
+    Int                 meEarlyExitSAD;
+
 } VideoEncOptions;
 
 #ifdef __cplusplus
@@ -0,0 +1,275 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+Void BlockDCT_AANwSub_AVX2(Short *out,UChar *cur,UChar *pred,Int width)
+Void BlockDCT_AANIntra_AVX2(Short *out,UChar *cur,UChar *dummy2,Int width)
+void BlockIDCTMotionComp_AVX2(Short *block,UChar *bitmapcol,UChar bitmaprow,
+                              Int dctMode,UChar *rec,UChar *pred,Int lx_intra)
+
+Same as the SSE2 versions in dct_sse2.cpp, with the 32-bit passes done on
+all eight columns or rows at once. Built with -mavx2, only called when the
+CPU has AVX2.
+*/
+
+#include <immintrin.h>
+
+#include "mp4def.h"
+#include "mp4lib_int.h"
+#include "mp4enc_lib.h"
+#include "dct.h"
+#include "dct_x86.h"
+
+#define MADD_PAIR256(a, b)  _mm256_set1_epi32(((UInt)(b) << 16) | ((a) & 0xFFFF))
+
+/* 8 Shorts to 32 bits, then the two halves of a 32-bit vector back to
+   Shorts dropping the top bits, or with saturation */
+static inline __m256i Widen16(__m128i x)
+{
+    return _mm256_cvtepi16_epi32(x);
+}
+
+static inline __m128i Truncate32(__m256i x)
+{
+    x = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+
+    return _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+static inline __m128i Saturate32(__m256i x)
+{
+    return _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+/* the 16-bit pairs (a[i], b[i]) of all eight lanes, for _mm256_madd_epi16 */
+static inline __m256i Interleave16(__m128i a, __m128i b)
+{
+    __m256i x = _mm256_castsi128_si256(_mm_unpacklo_epi16(a, b));
+
+    return _mm256_inserti128_si256(x, _mm_unpackhi_epi16(a, b), 1);
+}
+
+static void FdctColumns(Short *out, __m128i r[8])
+{
+    const __m256i round = _mm256_set1_epi32(FDCT_ROUND);
+    const __m256i ColTh = _mm256_set1_epi32(out[64]);
+    __m256i k[8], a0, a1, a2, a3, a4, a5, a6, a7, b0, b1, b2, b3;
+    __m256i t2, t4, t5, t6, r4, r6, sign, abs_sum;
+    __m128i skip;
+    Int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        k[i] = Widen16(r[i]);
+    }
+
+    /* sum_abs() takes one less for a negative k0 */
+    sign = _mm256_srai_epi32(k[0], 31);
+    abs_sum = _mm256_xor_si256(k[0], sign);
+    for (i = 1; i < 8; i++)
+    {
+        abs_sum = _mm256_add_epi32(abs_sum, _mm256_abs_epi32(k[i]));
+    }
+    skip = Saturate32(_mm256_cmpgt_epi32(ColTh, abs_sum));
+
+    /* fdct_1 */
+    a0 = _mm256_add_epi32(k[0], k[7]);
+    a7 = _mm256_sub_epi32(k[0], k[7]);
+    a1 = _mm256_add_epi32(k[1], k[6]);
+    a6 = _mm256_sub_epi32(k[1], k[6]);
+    a2 = _mm256_add_epi32(k[2], k[5]);
+    a5 = _mm256_sub_epi32(k[2], k[5]);
+    a3 = _mm256_add_epi32(k[3], k[4]);
+    a4 = _mm256_sub_epi32(k[3], k[4]);
+
+    b0 = _mm256_add_epi32(a0, a3);
+    b3 = _mm256_sub_epi32(a0, a3);
+    b1 = _mm256_add_epi32(a1, a2);
+    b2 = _mm256_sub_epi32(a1, a2);
+
+    k[0] = _mm256_add_epi32(b0, b1);
+    k[4] = _mm256_sub_epi32(b0, b1);
+
+    /* fdct_2 */
+    t4 = _mm256_add_epi32(a4, a5);
+    t5 = _mm256_add_epi32(a5, a6);
+    t6 = _mm256_add_epi32(a6, a7);
+    t2 = _mm256_add_epi32(b2, b3);
+    t5 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(t5, _mm256_set1_epi32(724)), round), 10);
+    t2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(t2, _mm256_set1_epi32(724)), round), 10);
+
+    t2 = _mm256_add_epi32(t2, b3);
+    k[2] = t2;
+    k[6] = _mm256_slli_epi32(_mm256_sub_epi32(_mm256_slli_epi32(b3, 1), t2), 1);
+
+    /* fdct_3, ROTATE k4,k6,392,946 */
+    a0 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(t4, t6), _mm256_set1_epi32(392)), round);
+    r4 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(t4, _mm256_set1_epi32(554)), a0), 10);
+    r6 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(t6, _mm256_set1_epi32(1338)), a0), 10);
+
+    t5 = _mm256_add_epi32(t5, a7);
+    a7 = _mm256_sub_epi32(_mm256_slli_epi32(a7, 1), t5);
+    r4 = _mm256_add_epi32(r4, a7);
+    k[3] = _mm256_sub_epi32(_mm256_slli_epi32(a7, 1), r4);
+    t5 = _mm256_add_epi32(t5, r6);
+    k[5] = _mm256_slli_epi32(r4, 1);
+    k[1] = t5;
+    k[7] = _mm256_slli_epi32(_mm256_sub_epi32(t5, _mm256_slli_epi32(r6, 1)), 2);
+
+    out += 64;
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = Truncate32(k[i]);
+        __m128i keep = i ? r[i] : _mm_set1_epi16(0x7fff);
+
+        x = _mm_or_si128(_mm_and_si128(skip, keep), _mm_andnot_si128(skip, x));
+        _mm_storeu_si128((__m128i*)(out + 8 * i), x);
+    }
+}
+
+Void BlockDCT_AANwSub_AVX2(Short *out, UChar *cur, UChar *pred, Int width)
+{
+    __m128i r[8];
+
+    FdctRows(r, cur, pred, width);
+    FdctColumns(out, r);
+}
+
+Void BlockDCT_AANIntra_AVX2(Short *out, UChar *cur, UChar *dummy2, Int width)
+{
+    __m128i r[8];
+
+    OSCL_UNUSED_ARG(dummy2);
+
+    FdctRows(r, cur, NULL, width);
+    FdctColumns(out, r);
+}
+
+/* One pass of the IDCT on all eight lanes, see Idct4() in dct_sse2.cpp */
+static inline void Idct8(__m256i y[8], const __m128i b[8], Int row)
+{
+    const __m256i c181 = _mm256_set1_epi32(181);
+    const __m256i r128 = _mm256_set1_epi32(128);
+    __m256i p04 = Interleave16(b[0], b[4]);
+    __m256i p17 = Interleave16(b[1], b[7]);
+    __m256i p53 = Interleave16(b[5], b[3]);
+    __m256i p26 = Interleave16(b[2], b[6]);
+    __m256i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    Int shift = row ? 14 : 8;
+
+    x0 = _mm256_madd_epi16(p04, MADD_PAIR256(row ? 256 : 2048, 0));
+    x0 = _mm256_add_epi32(x0, _mm256_set1_epi32(row ? 8192 : 128));
+    x1 = _mm256_madd_epi16(p04, MADD_PAIR256(0, row ? 256 : 2048));
+
+    /* first stage */
+    x4 = _mm256_madd_epi16(p17, MADD_PAIR256(W1, W7));
+    x5 = _mm256_madd_epi16(p17, MADD_PAIR256(W7, -W1));
+    x6 = _mm256_madd_epi16(p53, MADD_PAIR256(W5, W3));
+    x7 = _mm256_madd_epi16(p53, MADD_PAIR256(W3, -W5));
+
+    /* second stage */
+    x3 = _mm256_madd_epi16(p26, MADD_PAIR256(W2, W6));
+    x2 = _mm256_madd_epi16(p26, MADD_PAIR256(W6, -W2));
+
+    if (row)
+    {
+        const __m256i r4 = _mm256_set1_epi32(4);
+
+        x4 = _mm256_srai_epi32(_mm256_add_epi32(x4, r4), 3);
+        x5 = _mm256_srai_epi32(_mm256_add_epi32(x5, r4), 3);
+        x6 = _mm256_srai_epi32(_mm256_add_epi32(x6, r4), 3);
+        x7 = _mm256_srai_epi32(_mm256_add_epi32(x7, r4), 3);
+        x3 = _mm256_srai_epi32(_mm256_add_epi32(x3, r4), 3);
+        x2 = _mm256_srai_epi32(_mm256_add_epi32(x2, r4), 3);
+    }
+
+    x8 = _mm256_add_epi32(x0, x1);
+    x0 = _mm256_sub_epi32(x0, x1);
+    x1 = _mm256_add_epi32(x4, x6);
+    x4 = _mm256_sub_epi32(x4, x6);
+    x6 = _mm256_add_epi32(x5, x7);
+    x5 = _mm256_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm256_add_epi32(x8, x3);
+    x8 = _mm256_sub_epi32(x8, x3);
+    x3 = _mm256_add_epi32(x0, x2);
+    x0 = _mm256_sub_epi32(x0, x2);
+    x2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage */
+    y[0] = _mm256_srai_epi32(_mm256_add_epi32(x7, x1), shift);
+    y[1] = _mm256_srai_epi32(_mm256_add_epi32(x3, x2), shift);
+    y[2] = _mm256_srai_epi32(_mm256_add_epi32(x0, x4), shift);
+    y[3] = _mm256_srai_epi32(_mm256_add_epi32(x8, x6), shift);
+    y[4] = _mm256_srai_epi32(_mm256_sub_epi32(x8, x6), shift);
+    y[5] = _mm256_srai_epi32(_mm256_sub_epi32(x0, x4), shift);
+    y[6] = _mm256_srai_epi32(_mm256_sub_epi32(x3, x2), shift);
+    y[7] = _mm256_srai_epi32(_mm256_sub_epi32(x7, x1), shift);
+}
+
+void BlockIDCTMotionComp_AVX2(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                              Int dctMode, UChar *rec, UChar *pred, Int lx_intra)
+{
+    Int lx = lx_intra >> 1;
+    Int intra = (lx_intra & 1);
+    __m128i b[8];
+    __m256i y[8];
+    Int i;
+
+    if (IdctZeroOrDC(block, bitmapcol, bitmaprow, dctMode, rec, pred, lx, intra))
+    {
+        return ;
+    }
+
+    /* columns, one lane per column */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_loadu_si128((__m128i*)(block + 8 * i));
+    }
+
+    Idct8(y, b, 0);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = Truncate32(y[i]);
+    }
+
+    if (intra && bitmaprow == 0x10)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            _mm_storeu_si128((__m128i*)(block + 8 * i), b[i]);
+        }
+        idct_row0x10Intra(block, rec, lx);
+        return ;
+    }
+
+    /* rows, one lane per row */
+    Transpose8x8(b);
+
+    Idct8(y, b, 1);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = Saturate32(y[i]);
+    }
+
+    IdctStoreRows(b, rec, pred, lx, intra);
+    ClearBlock(block);
+}
@@ -0,0 +1,298 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+Void BlockDCT_AANwSub_SSE2(Short *out,UChar *cur,UChar *pred,Int width)
+Void BlockDCT_AANIntra_SSE2(Short *out,UChar *cur,UChar *dummy2,Int width)
+void BlockIDCTMotionComp_SSE2(Short *block,UChar *bitmapcol,UChar bitmaprow,
+                              Int dctMode,UChar *rec,UChar *pred,Int lx_intra)
+
+These give the same output as the C versions in dct.cpp and fastidct.cpp,
+including the column threshold of the FDCT and the clipping of the IDCT.
+The C IDCT has reduced versions for sparse blocks, which give the same
+result as the full one except idct_row0x10Intra, so that one is still used.
+*/
+
+#include "mp4def.h"
+#include "mp4lib_int.h"
+#include "mp4enc_lib.h"
+#include "dct.h"
+#include "dct_x86.h"
+
+/* low 32 bits of x*c, c the same in all four lanes */
+static inline __m128i MulLo32(__m128i x, __m128i c)
+{
+    __m128i even = _mm_mul_epu32(x, c);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), c);
+
+    even = _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0));
+    odd = _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0));
+
+    return _mm_unpacklo_epi32(even, odd);
+}
+
+/* ======================================================================== */
+/*  Function : FdctColumns4                                                 */
+/*  Purpose  : Column pass of the FDCT on four columns, k[i] holding row i  */
+/*             in 32 bits. Returns the mask of the columns under the        */
+/*             threshold, which the C code leaves out.                      */
+/* ======================================================================== */
+static inline __m128i FdctColumns4(__m128i k[8], __m128i ColTh)
+{
+    const __m128i round = _mm_set1_epi32(FDCT_ROUND);
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7, b0, b1, b2, b3;
+    __m128i t2, t4, t5, t6, r4, r6, sign, abs_sum;
+    Int i;
+
+    /* sum_abs() takes one less for a negative k0 */
+    sign = _mm_srai_epi32(k[0], 31);
+    abs_sum = _mm_xor_si128(k[0], sign);
+    for (i = 1; i < 8; i++)
+    {
+        sign = _mm_srai_epi32(k[i], 31);
+        abs_sum = _mm_add_epi32(abs_sum, _mm_sub_epi32(_mm_xor_si128(k[i], sign), sign));
+    }
+
+    /* fdct_1 */
+    a0 = _mm_add_epi32(k[0], k[7]);
+    a7 = _mm_sub_epi32(k[0], k[7]);
+    a1 = _mm_add_epi32(k[1], k[6]);
+    a6 = _mm_sub_epi32(k[1], k[6]);
+    a2 = _mm_add_epi32(k[2], k[5]);
+    a5 = _mm_sub_epi32(k[2], k[5]);
+    a3 = _mm_add_epi32(k[3], k[4]);
+    a4 = _mm_sub_epi32(k[3], k[4]);
+
+    b0 = _mm_add_epi32(a0, a3);
+    b3 = _mm_sub_epi32(a0, a3);
+    b1 = _mm_add_epi32(a1, a2);
+    b2 = _mm_sub_epi32(a1, a2);
+
+    k[0] = _mm_add_epi32(b0, b1);
+    k[4] = _mm_sub_epi32(b0, b1);
+
+    /* fdct_2 */
+    t4 = _mm_add_epi32(a4, a5);
+    t5 = _mm_add_epi32(a5, a6);
+    t6 = _mm_add_epi32(a6, a7);
+    t2 = _mm_add_epi32(b2, b3);
+    t5 = _mm_srai_epi32(_mm_add_epi32(MulLo32(t5, _mm_set1_epi32(724)), round), 10);
+    t2 = _mm_srai_epi32(_mm_add_epi32(MulLo32(t2, _mm_set1_epi32(724)), round), 10);
+
+    t2 = _mm_add_epi32(t2, b3);
+    k[2] = t2;
+    k[6] = _mm_slli_epi32(_mm_sub_epi32(_mm_slli_epi32(b3, 1), t2), 1);
+
+    /* fdct_3, ROTATE k4,k6,392,946 */
+    a0 = _mm_add_epi32(MulLo32(_mm_sub_epi32(t4, t6), _mm_set1_epi32(392)), round);
+    r4 = _mm_srai_epi32(_mm_add_epi32(MulLo32(t4, _mm_set1_epi32(554)), a0), 10);
+    r6 = _mm_srai_epi32(_mm_add_epi32(MulLo32(t6, _mm_set1_epi32(1338)), a0), 10);
+
+    t5 = _mm_add_epi32(t5, a7);
+    a7 = _mm_sub_epi32(_mm_slli_epi32(a7, 1), t5);
+    r4 = _mm_add_epi32(r4, a7);
+    k[3] = _mm_sub_epi32(_mm_slli_epi32(a7, 1), r4);
+    t5 = _mm_add_epi32(t5, r6);
+    k[5] = _mm_slli_epi32(r4, 1);
+    k[1] = t5;
+    k[7] = _mm_slli_epi32(_mm_sub_epi32(t5, _mm_slli_epi32(r6, 1)), 2);
+
+    return _mm_cmplt_epi32(abs_sum, ColTh);
+}
+
+/* ======================================================================== */
+/*  Function : FdctColumns                                                  */
+/*  Purpose  : Column pass of the FDCT on the rows from FdctRows(), written */
+/*             to out[64..127] with 0x7fff on row 0 of a column under the   */
+/*             threshold.                                                   */
+/* ======================================================================== */
+static void FdctColumns(Short *out, __m128i r[8])
+{
+    const __m128i ColTh = _mm_set1_epi32(out[64]);
+    __m128i lo[8], hi[8], skip;
+    Int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        lo[i] = _mm_srai_epi32(_mm_unpacklo_epi16(r[i], r[i]), 16);
+        hi[i] = _mm_srai_epi32(_mm_unpackhi_epi16(r[i], r[i]), 16);
+    }
+
+    skip = _mm_packs_epi32(FdctColumns4(lo, ColTh), FdctColumns4(hi, ColTh));
+
+    out += 64;
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = TruncatePack32(lo[i], hi[i]);
+        __m128i keep = i ? r[i] : _mm_set1_epi16(0x7fff);
+
+        x = _mm_or_si128(_mm_and_si128(skip, keep), _mm_andnot_si128(skip, x));
+        _mm_storeu_si128((__m128i*)(out + 8 * i), x);
+    }
+}
+
+Void BlockDCT_AANwSub_SSE2(Short *out, UChar *cur, UChar *pred, Int width)
+{
+    __m128i r[8];
+
+    FdctRows(r, cur, pred, width);
+    FdctColumns(out, r);
+}
+
+Void BlockDCT_AANIntra_SSE2(Short *out, UChar *cur, UChar *dummy2, Int width)
+{
+    __m128i r[8];
+
+    OSCL_UNUSED_ARG(dummy2);
+
+    FdctRows(r, cur, NULL, width);
+    FdctColumns(out, r);
+}
+
+/* ======================================================================== */
+/*  Function : Idct4                                                        */
+/*  Purpose  : One pass of the IDCT on four lanes, low or high half of b[], */
+/*             b[i] holding coefficient i. The column pass is idct_col(),   */
+/*             the row pass the rounding of idct_rowIntra/zmv().            */
+/* ======================================================================== */
+static inline void Idct4(__m128i y[8], const __m128i b[8], Int hi, Int row)
+{
+    const __m128i c0 = MADD_PAIR(row ? 256 : 2048, 0);
+    const __m128i c1 = MADD_PAIR(0, row ? 256 : 2048);
+    const __m128i c181 = _mm_set1_epi32(181);
+    const __m128i r128 = _mm_set1_epi32(128);
+    Int shift = row ? 14 : 8;
+    __m128i p04, p17, p53, p26;
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    if (hi)
+    {
+        p04 = _mm_unpackhi_epi16(b[0], b[4]);
+        p17 = _mm_unpackhi_epi16(b[1], b[7]);
+        p53 = _mm_unpackhi_epi16(b[5], b[3]);
+        p26 = _mm_unpackhi_epi16(b[2], b[6]);
+    }
+    else
+    {
+        p04 = _mm_unpacklo_epi16(b[0], b[4]);
+        p17 = _mm_unpacklo_epi16(b[1], b[7]);
+        p53 = _mm_unpacklo_epi16(b[5], b[3]);
+        p26 = _mm_unpacklo_epi16(b[2], b[6]);
+    }
+
+    x0 = _mm_add_epi32(_mm_madd_epi16(p04, c0), _mm_set1_epi32(row ? 8192 : 128));
+    x1 = _mm_madd_epi16(p04, c1);
+
+    /* first stage */
+    x4 = _mm_madd_epi16(p17, MADD_PAIR(W1, W7));
+    x5 = _mm_madd_epi16(p17, MADD_PAIR(W7, -W1));
+    x6 = _mm_madd_epi16(p53, MADD_PAIR(W5, W3));
+    x7 = _mm_madd_epi16(p53, MADD_PAIR(W3, -W5));
+
+    /* second stage */
+    x3 = _mm_madd_epi16(p26, MADD_PAIR(W2, W6));
+    x2 = _mm_madd_epi16(p26, MADD_PAIR(W6, -W2));
+
+    if (row)
+    {
+        const __m128i r4 = _mm_set1_epi32(4);
+
+        x4 = _mm_srai_epi32(_mm_add_epi32(x4, r4), 3);
+        x5 = _mm_srai_epi32(_mm_add_epi32(x5, r4), 3);
+        x6 = _mm_srai_epi32(_mm_add_epi32(x6, r4), 3);
+        x7 = _mm_srai_epi32(_mm_add_epi32(x7, r4), 3);
+        x3 = _mm_srai_epi32(_mm_add_epi32(x3, r4), 3);
+        x2 = _mm_srai_epi32(_mm_add_epi32(x2, r4), 3);
+    }
+
+    x8 = _mm_add_epi32(x0, x1);
+    x0 = _mm_sub_epi32(x0, x1);
+    x1 = _mm_add_epi32(x4, x6);
+    x4 = _mm_sub_epi32(x4, x6);
+    x6 = _mm_add_epi32(x5, x7);
+    x5 = _mm_sub_epi32(x5, x7);
+
+    /* third stage */
+    x7 = _mm_add_epi32(x8, x3);
+    x8 = _mm_sub_epi32(x8, x3);
+    x3 = _mm_add_epi32(x0, x2);
+    x0 = _mm_sub_epi32(x0, x2);
+    x2 = _mm_srai_epi32(_mm_add_epi32(MulLo32(_mm_add_epi32(x4, x5), c181), r128), 8);
+    x4 = _mm_srai_epi32(_mm_add_epi32(MulLo32(_mm_sub_epi32(x4, x5), c181), r128), 8);
+
+    /* fourth stage */
+    y[0] = _mm_srai_epi32(_mm_add_epi32(x7, x1), shift);
+    y[1] = _mm_srai_epi32(_mm_add_epi32(x3, x2), shift);
+    y[2] = _mm_srai_epi32(_mm_add_epi32(x0, x4), shift);
+    y[3] = _mm_srai_epi32(_mm_add_epi32(x8, x6), shift);
+    y[4] = _mm_srai_epi32(_mm_sub_epi32(x8, x6), shift);
+    y[5] = _mm_srai_epi32(_mm_sub_epi32(x0, x4), shift);
+    y[6] = _mm_srai_epi32(_mm_sub_epi32(x3, x2), shift);
+    y[7] = _mm_srai_epi32(_mm_sub_epi32(x7, x1), shift);
+}
+
+void BlockIDCTMotionComp_SSE2(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                              Int dctMode, UChar *rec, UChar *pred, Int lx_intra)
+{
+    Int lx = lx_intra >> 1;
+    Int intra = (lx_intra & 1);
+    __m128i b[8], lo[8], hi[8];
+    Int i;
+
+    if (IdctZeroOrDC(block, bitmapcol, bitmaprow, dctMode, rec, pred, lx, intra))
+    {
+        return ;
+    }
+
+    /* columns, one lane per column */
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_loadu_si128((__m128i*)(block + 8 * i));
+    }
+
+    Idct4(lo, b, 0, 0);
+    Idct4(hi, b, 1, 0);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = TruncatePack32(lo[i], hi[i]);
+    }
+
+    if (intra && bitmaprow == 0x10)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            _mm_storeu_si128((__m128i*)(block + 8 * i), b[i]);
+        }
+        idct_row0x10Intra(block, rec, lx);
+        return ;
+    }
+
+    /* rows, one lane per row */
+    Transpose8x8(b);
+
+    Idct4(lo, b, 0, 1);
+    Idct4(hi, b, 1, 1);
+
+    for (i = 0; i < 8; i++)
+    {
+        b[i] = _mm_packs_epi32(lo[i], hi[i]);
+    }
+
+    IdctStoreRows(b, rec, pred, lx, intra);
+    ClearBlock(block);
+}
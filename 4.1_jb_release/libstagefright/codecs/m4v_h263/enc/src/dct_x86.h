@@ -0,0 +1,251 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+#ifndef _DCT_X86_H_
+#define _DCT_X86_H_
+
+/* Helpers shared by the SSE2 and AVX2 FDCT and IDCT functions. Include after
+   dct.h, which has the IDCT constants W1..W7. */
+
+#include <emmintrin.h>
+#include "mp4def.h"
+
+#define FDCT_ROUND      512     /* 1 << (FDCT_SHIFT - 1) */
+
+/* pair of 16-bit constants for _mm_madd_epi16, a on the even lanes */
+#define MADD_PAIR(a, b)     _mm_set1_epi32(((UInt)(b) << 16) | ((a) & 0xFFFF))
+
+static inline void Transpose8x8(__m128i r[8])
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* 32-bit values to Short, dropping the top bits as a C store does */
+static inline __m128i TruncatePack32(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+/* (a*x + b*y + FDCT_ROUND) >> FDCT_SHIFT, with coef = MADD_PAIR(a, b) */
+static inline __m128i FdctRotate(__m128i x, __m128i y, __m128i coef)
+{
+    const __m128i round = _mm_set1_epi32(FDCT_ROUND);
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(x, y), coef);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(x, y), coef);
+
+    lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 10);
+    hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 10);
+
+    return _mm_packs_epi32(lo, hi);
+}
+
+/* ======================================================================== */
+/*  Function : FdctRows                                                     */
+/*  Purpose  : Row pass of BlockDCT_AANwSub and BlockDCT_AANIntra on the    */
+/*             8x8 residue, 2*(cur - pred) or 2*cur when pred is NULL.      */
+/*             Returns the rows as the C code stores them in out[64..127].  */
+/*  Note     : 16 bits are enough. Adds, subtracts and shifts give the same */
+/*             low 16 bits as in 32 bits, and the inputs of the multiplies  */
+/*             are below 4096 so those are exact.                           */
+/* ======================================================================== */
+static inline void FdctRows(__m128i r[8], UChar *cur, UChar *pred, Int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c724 = MADD_PAIR(724, 0);
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7, b0, b1, b2, b3;
+    __m128i t2, t4, t5, t6, r4, r6;
+    Int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)cur), zero);
+
+        if (pred)
+        {
+            x = _mm_sub_epi16(x, _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        r[i] = _mm_slli_epi16(x, 1);
+        cur += width;
+    }
+
+    /* one vector per column, one lane per row */
+    Transpose8x8(r);
+
+    /* fdct_1 */
+    a0 = _mm_add_epi16(r[0], r[7]);
+    a7 = _mm_sub_epi16(r[0], r[7]);
+    a1 = _mm_add_epi16(r[1], r[6]);
+    a6 = _mm_sub_epi16(r[1], r[6]);
+    a2 = _mm_add_epi16(r[2], r[5]);
+    a5 = _mm_sub_epi16(r[2], r[5]);
+    a3 = _mm_add_epi16(r[3], r[4]);
+    a4 = _mm_sub_epi16(r[3], r[4]);
+
+    b0 = _mm_add_epi16(a0, a3);
+    b3 = _mm_sub_epi16(a0, a3);
+    b1 = _mm_add_epi16(a1, a2);
+    b2 = _mm_sub_epi16(a1, a2);
+
+    r[0] = _mm_add_epi16(b0, b1);
+    r[4] = _mm_sub_epi16(b0, b1);
+
+    /* fdct_2 */
+    t4 = _mm_add_epi16(a4, a5);
+    t5 = FdctRotate(_mm_add_epi16(a5, a6), zero, c724);
+    t6 = _mm_add_epi16(a6, a7);
+    t2 = FdctRotate(_mm_add_epi16(b2, b3), zero, c724);
+
+    t2 = _mm_add_epi16(t2, b3);
+    r[2] = t2;
+    r[6] = _mm_slli_epi16(_mm_sub_epi16(_mm_slli_epi16(b3, 1), t2), 1);
+
+    /* fdct_3 */
+    r4 = FdctRotate(t4, t6, MADD_PAIR(946, -392));
+    r6 = FdctRotate(t4, t6, MADD_PAIR(392, 946));
+
+    t5 = _mm_add_epi16(t5, a7);
+    a7 = _mm_sub_epi16(_mm_slli_epi16(a7, 1), t5);
+    r4 = _mm_add_epi16(r4, a7);
+    r[3] = _mm_sub_epi16(_mm_slli_epi16(a7, 1), r4);
+    t5 = _mm_add_epi16(t5, r6);
+    r[5] = _mm_slli_epi16(r4, 1);
+    r[1] = t5;
+    r[7] = _mm_slli_epi16(_mm_sub_epi16(t5, _mm_slli_epi16(r6, 1)), 2);
+
+    /* back to one vector per row */
+    Transpose8x8(r);
+}
+
+/* ======================================================================== */
+/*  Function : IdctZeroOrDC                                                 */
+/*  Purpose  : The all-zero and DC-only cases of BlockIDCTMotionComp.       */
+/*             Returns 0 if the block needs the full IDCT.                  */
+/* ======================================================================== */
+static inline Int IdctZeroOrDC(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                               Int dctMode, UChar *rec, UChar *pred, Int lx, Int intra)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i dc;
+    Int i;
+
+    if (dctMode == 0 || bitmaprow == 0)
+    {
+        dc = zero;
+    }
+    else if (dctMode == 1 || (bitmaprow == 0x80 && bitmapcol[0] == 0x80))
+    {
+        dc = _mm_set1_epi16((Short)(((block[0] << 3) + 32) >> 6));
+        block[0] = 0;
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (intra)
+    {
+        dc = _mm_packus_epi16(dc, dc);
+        for (i = 0; i < 8; i++)
+        {
+            _mm_storel_epi64((__m128i*)rec, dc);
+            rec += lx;
+        }
+    }
+    else
+    {
+        for (i = 0; i < 8; i++)
+        {
+            __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero);
+
+            x = _mm_adds_epi16(x, dc);
+            _mm_storel_epi64((__m128i*)rec, _mm_packus_epi16(x, x));
+            rec += lx;
+            pred += 16;
+        }
+    }
+
+    return 1;
+}
+
+/* ======================================================================== */
+/*  Function : IdctStoreRows                                                */
+/*  Purpose  : Transposes the 8 row-IDCT outputs, one lane per row, and     */
+/*             writes them to rec, adding pred unless intra, clipped to     */
+/*             [0,255].                                                     */
+/* ======================================================================== */
+static inline void IdctStoreRows(__m128i p[8], UChar *rec, UChar *pred, Int lx, Int intra)
+{
+    const __m128i zero = _mm_setzero_si128();
+    Int i;
+
+    Transpose8x8(p);
+
+    for (i = 0; i < 8; i++)
+    {
+        __m128i x = p[i];
+
+        if (!intra)
+        {
+            x = _mm_adds_epi16(x, _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)pred), zero));
+            pred += 16;
+        }
+        _mm_storel_epi64((__m128i*)rec, _mm_packus_epi16(x, x));
+        rec += lx;
+    }
+}
+
+/* Clears the block, as the C row IDCTs leave it */
+static inline void ClearBlock(Short *block)
+{
+    const __m128i zero = _mm_setzero_si128();
+    Int i;
+
+    for (i = 0; i < 64; i += 8)
+    {
+        _mm_storeu_si128((__m128i*)(block + i), zero);
+    }
+}
+
+#endif /* _DCT_X86_H_ */
@@ -21,6 +21,46 @@
 #include "dct.h"
 #include "m4venc_oscl.h"
 
+#ifdef M4VENC_X86
+#include "x86_cpu.h"
+#endif
+
+/* ======================================================================== */
+/*  Function : InitBlockCodingFunctions( )                                  */
+/*  Purpose  : Select the 8x8 DCT, H.263 quant/dequant and IDCT functions   */
+/*             for this CPU. All versions give the same results.            */
+/* ======================================================================== */
+void InitBlockCodingFunctions(FuncPtr *functionPointer)
+{
+    functionPointer->BlockDCT8x8wSub = &BlockDCT_AANwSub;
+    functionPointer->BlockDCT8x8Intra = &BlockDCT_AANIntra;
+    functionPointer->BlockQuantDequantH263Inter = &BlockQuantDequantH263Inter;
+    functionPointer->BlockQuantDequantH263Intra = &BlockQuantDequantH263Intra;
+    functionPointer->BlockIDCTMotionComp = &BlockIDCTMotionComp;
+
+#ifdef M4VENC_X86
+    UInt features = x86_cpu_get_features();
+
+    if (features & X86_CPU_SSE2)
+    {
+        functionPointer->BlockDCT8x8wSub = &BlockDCT_AANwSub_SSE2;
+        functionPointer->BlockDCT8x8Intra = &BlockDCT_AANIntra_SSE2;
+        functionPointer->BlockQuantDequantH263Inter = &BlockQuantDequantH263Inter_SSE2;
+        functionPointer->BlockQuantDequantH263Intra = &BlockQuantDequantH263Intra_SSE2;
+        functionPointer->BlockIDCTMotionComp = &BlockIDCTMotionComp_SSE2;
+    }
+
+    if (features & X86_CPU_AVX2)
+    {
+        functionPointer->BlockDCT8x8wSub = &BlockDCT_AANwSub_AVX2;
+        functionPointer->BlockDCT8x8Intra = &BlockDCT_AANIntra_AVX2;
+        functionPointer->BlockIDCTMotionComp = &BlockIDCTMotionComp_AVX2;
+    }
+#endif
+
+    return ;
+}
+
 /* ======================================================================== */
 /*  Function : CodeMB_H263( )                                               */
 /*  Date     : 8/15/2001                                                    */
@@ -99,8 +139,8 @@ PV_STATUS CodeMB_H263(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
         BlockDCT1x1 = &Block1x1DCTIntra;
         BlockDCT2x2 = &Block2x2DCT_AANIntra;
         BlockDCT4x4 = &Block4x4DCT_AANIntra;
-        BlockDCT8x8 = &BlockDCT_AANIntra;
-        BlockQuantDequantH263 = &BlockQuantDequantH263Intra;
+        BlockDCT8x8 = video->functionPointer->BlockDCT8x8Intra;
+        BlockQuantDequantH263 = video->functionPointer->BlockQuantDequantH263Intra;
         BlockQuantDequantH263DC = &BlockQuantDequantH263DCIntra;
         if (shortHeader)
         {
@@ -118,9 +158,9 @@ PV_STATUS CodeMB_H263(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
         BlockDCT1x1 = &Block1x1DCTwSub;
         BlockDCT2x2 = &Block2x2DCT_AANwSub;
         BlockDCT4x4 = &Block4x4DCT_AANwSub;
-        BlockDCT8x8 = &BlockDCT_AANwSub;
+        BlockDCT8x8 = video->functionPointer->BlockDCT8x8wSub;
 
-        BlockQuantDequantH263 = &BlockQuantDequantH263Inter;
+        BlockQuantDequantH263 = video->functionPointer->BlockQuantDequantH263Inter;
         BlockQuantDequantH263DC = &BlockQuantDequantH263DCInter;
         ColTh = ColThInter[QP];
         DctTh1 = (Int)(16 * QP);  //9*QP;
@@ -233,7 +273,8 @@ PV_STATUS CodeMB_H263(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
             CBP |= (*BlockQuantDequantH263)(dataBlock, output, &QuantParam,
                                             bitmapcol, bitmaprow + k, bitmapzz, dctMode, k, dc_scaler, shortHeader);
         }
-        BlockIDCTMotionComp(dataBlock, bitmapcol, bitmaprow[k], dctMode, rec, pred, (lx << 1) | intra);
+        (*video->functionPointer->BlockIDCTMotionComp)(dataBlock, bitmapcol, bitmaprow[k], dctMode,
+                rec, pred, (lx << 1) | intra);
         output += 64;
         if (!(k&1))
         {
@@ -324,7 +365,7 @@ PV_STATUS CodeMB_MPEG(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
         BlockDCT1x1 = &Block1x1DCTIntra;
         BlockDCT2x2 = &Block2x2DCT_AANIntra;
         BlockDCT4x4 = &Block4x4DCT_AANIntra;
-        BlockDCT8x8 = &BlockDCT_AANIntra;
+        BlockDCT8x8 = video->functionPointer->BlockDCT8x8Intra;
 
         BlockQuantDequantMPEG = &BlockQuantDequantMPEGIntra;
         BlockQuantDequantMPEGDC = &BlockQuantDequantMPEGDCIntra;
@@ -341,7 +382,7 @@ PV_STATUS CodeMB_MPEG(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
         BlockDCT1x1 = &Block1x1DCTwSub;
         BlockDCT2x2 = &Block2x2DCT_AANwSub;
         BlockDCT4x4 = &Block4x4DCT_AANwSub;
-        BlockDCT8x8 = &BlockDCT_AANwSub;
+        BlockDCT8x8 = video->functionPointer->BlockDCT8x8wSub;
 
         BlockQuantDequantMPEG = &BlockQuantDequantMPEGInter;
         BlockQuantDequantMPEGDC = &BlockQuantDequantMPEGDCInter;
@@ -453,7 +494,8 @@ PV_STATUS CodeMB_MPEG(VideoEncData *video, approxDCT *function, Int QP, Int ncoe
                                             bitmapcol, bitmaprow + k, bitmapzz, dctMode, k, dc_scaler); //
         }
         dctMode = 8; /* for mismatch handle */
-        BlockIDCTMotionComp(dataBlock, bitmapcol, bitmaprow[k], dctMode, rec, pred, (lx << 1) | (intra));
+        (*video->functionPointer->BlockIDCTMotionComp)(dataBlock, bitmapcol, bitmaprow[k], dctMode,
+                rec, pred, (lx << 1) | (intra));
 
         output += 64;
         if (!(k&1))
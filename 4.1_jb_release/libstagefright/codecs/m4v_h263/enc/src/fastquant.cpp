@@ -17,6 +17,7 @@
  */
 #include "mp4enc_lib.h"
 #include "fastquant_inline.h"
+#include "fastquant_tab.h"
 
 #define siz 63
 #define LSL 18
@@ -25,53 +26,6 @@
 const static UChar imask[8] = {128, 64, 32, 16, 8, 4, 2, 1};
 #define SIGN0(a)        ( ((a)<0) ? -1 : (((a)>0) ? 1  : 0) )
 
-/* variable bit precision quantization scale */
-/* used to avoid using 32-bit multiplication */
-const static Short scaleArrayV[32] = {0, 16384, 8192, 5462,  /* 15 */
-                                      4096, 3277, 2731, 2341,
-                                      4096, 3641, 3277, 2979,  /* 16 */
-                                      2731, 2521, 2341, 2185,
-                                      4096, 3856, 3641, 3450,  /* 17 */
-                                      3277, 3121, 2979, 2850,
-                                      5462, 5243, 5042, 4855,  /* 18 */
-                                      4682, 4520, 4370, 4229
-                                     };
-
-/* scale for dc_scaler and qmat, note, no value smaller than 8 */
-const static Short scaleArrayV2[47] = {0, 0, 0, 0, 0, 0, 0, 0, /* 15 */
-                                       4096, 3641, 3277, 2979, 2731, 2521, 2341, 2185,
-                                       4096, 3856, 3641, 3450, 3277, 3121, 2979, 2850,  /* 16 */
-                                       2731, 2622, 2521, 2428, 2341, 2260, 2185, 2115,
-                                       4096, 3972, 3856, 3745, 3641, 3543, 3450, 3361,  /* 17 */
-                                       3277, 3197, 3121, 3049, 2979, 2913, 2850
-                                      };
-
-/* AAN scale and zigzag */
-const static Short AANScale[64] =
-{
-    /* 0 */ 0x1000, 0x0B89, 0x0C3E, 0x0D9B, 0x1000, 0x0A2E, 0x0EC8, 0x0E7F,
-    /* 1 */ 0x0B89, 0x0851, 0x08D4, 0x09CF, 0x0B89, 0x0757, 0x0AA8, 0x0A73,
-    /* 2 */ 0x0C3E, 0x08D4, 0x095F, 0x0A6A, 0x0C3E, 0x07CB, 0x0B50, 0x0B18,
-    /* 3 */ 0x0D9B, 0x09CF, 0x0A6A, 0x0B92, 0x0D9B, 0x08A8, 0x0C92, 0x0C54,
-    /* 4 */ 0x1000, 0x0B89, 0x0C3E, 0x0D9B, 0x1000, 0x0A2E, 0x0EC8, 0x0E7F,
-    /* 5 */ 0x0A2E, 0x0757, 0x07CB, 0x08A8, 0x0A2E, 0x067A, 0x0968, 0x0939,
-    /* 6 */ 0x0EC8, 0x0AA8, 0x0B50, 0x0C92, 0x0EC8, 0x0968, 0x0DA8, 0x0D64,
-    /* 7 */ 0x0E7F, 0x0A73, 0x0B18, 0x0C54, 0x0E7F, 0x0939, 0x0D64, 0x0D23
-};
-
-const static UShort ZZTab[64] =
-{
-    /* 0 */ 0x0, 0x2, 0xA, 0xC, 0x1C, 0x1E, 0x36, 0x38,
-    /* 1 */ 0x4, 0x8, 0xE, 0x1A, 0x20, 0x34, 0x3A, 0x54,
-    /* 2 */ 0x6, 0x10, 0x18, 0x22, 0x32, 0x3C, 0x52, 0x56,
-    /* 3 */ 0x12, 0x16, 0x24, 0x30, 0x3E, 0x50, 0x58, 0x6A,
-    /* 4 */ 0x14, 0x26, 0x2E, 0x40, 0x4E, 0x5A, 0x68, 0x6C,
-    /* 5 */ 0x28, 0x2C, 0x42, 0x4C, 0x5C, 0x66, 0x6E, 0x78,
-    /* 6 */ 0x2A, 0x44, 0x4A, 0x5E, 0x64, 0x70, 0x76, 0x7A,
-    /* 7 */ 0x46, 0x48, 0x60, 0x62, 0x72, 0x74, 0x7C, 0x7E
-};
-
-
 //Tao need to remove, write another version of abs
 //#include <math.h>
 
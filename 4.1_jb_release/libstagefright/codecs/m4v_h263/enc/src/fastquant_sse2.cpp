@@ -0,0 +1,288 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/* contains
+Int BlockQuantDequantH263Inter_SSE2(Short *rcoeff,Short *qcoeff,struct QPstruct *QuantParam,
+                                    UChar bitmapcol[],UChar *bitmaprow,UInt *bitmapzz,
+                                    Int dctMode,Int comp,Int dummy,UChar shortHeader)
+Int BlockQuantDequantH263Intra_SSE2(Short *rcoeff,Short *qcoeff,struct QPstruct *QuantParam,
+                                    UChar bitmapcol[],UChar *bitmaprow,UInt *bitmapzz,
+                                    Int dctMode,Int comp,Int dc_scaler,UChar shortHeader)
+
+The C versions go down each column and use a narrower dead zone on the
+coefficient after one that was quantized to zero by the normal one. These
+quantize a row of eight columns at a time, with that state kept per column,
+then write the nonzero coefficients and the bitmaps as the C code does.
+*/
+
+#include <emmintrin.h>
+
+#include "mp4enc_lib.h"
+#include "fastquant_tab.h"
+
+/* ======================================================================== */
+/*  Function : QuantRows                                                    */
+/*  Purpose  : Quantize and dequantize rows 0 to dctMode-1 of coeff.        */
+/*  In/out   :                                                              */
+/*      active[]    columns to do in each row, as 16-bit masks              */
+/*      thresh      dead zone, |coeff| < thresh goes to zero                */
+/*      QPdiv2      taken off the scaled coefficient, 0 for intra           */
+/*      qv, dqv     quantized and dequantized values, where nz has a bit    */
+/*  Return   :      nz[i] has bit j set if row i column j is nonzero        */
+/* ======================================================================== */
+static void QuantRows(Short *coeff, struct QPstruct *QuantParam, Int thresh, Int QPdiv2,
+                      Int dctMode, Int ac_clip, const __m128i active[8],
+                      Short *qv, Short *dqv, UChar nz[8])
+{
+    const __m128i thr = _mm_set1_epi16(thresh);
+    const __m128i negthr = _mm_set1_epi16(-thresh);
+    const __m128i round = _mm_set1_epi32(1 << 15);
+    const __m128i q_scale = _mm_set1_epi16(scaleArrayV[QuantParam->QP]);
+    const __m128i shift = _mm_cvtsi32_si128(15 + (QuantParam->QPx2 >> 4));
+    const __m128i offset = _mm_set1_epi16(-QPdiv2);
+    const __m128i clipmax = _mm_set1_epi16(ac_clip);
+    const __m128i clipmin = _mm_set1_epi16(-ac_clip - 1);
+    const __m128i dqmul = _mm_set1_epi32(0x10000 | QuantParam->QPx2);
+    const __m128i addition = _mm_set1_epi16(QuantParam->Addition);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i state = zero;   /* columns whose last coefficient went to zero */
+    Int i;
+
+    for (i = 0; i < dctMode; i++)
+    {
+        __m128i c = _mm_loadu_si128((__m128i*)(coeff + (i << 3)));
+        __m128i dead, code, lo, hi, p0, p1, v, q, sign, sel;
+
+        /* -thresh is in the dead zone too, unless the one above was zero */
+        dead = _mm_and_si128(_mm_cmpgt_epi16(c, negthr), _mm_cmplt_epi16(c, thr));
+        dead = _mm_or_si128(dead, _mm_andnot_si128(state, _mm_cmpeq_epi16(c, negthr)));
+        code = _mm_andnot_si128(dead, active[i]);
+        state = _mm_andnot_si128(state, _mm_and_si128(dead, active[i]));
+
+        nz[i] = 0;
+        if (_mm_movemask_epi8(code) == 0)
+        {
+            continue;
+        }
+
+        /* scaling, (coeff*AANScale + round) >> 16 */
+        v = _mm_loadu_si128((__m128i*)(AANScale + (i << 3)));
+        lo = _mm_mullo_epi16(c, v);
+        hi = _mm_mulhi_epi16(c, v);
+        p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 16);
+        p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 16);
+        v = _mm_packs_epi32(p0, p1);
+
+        /* towards zero by QPdiv2 */
+        sign = _mm_srai_epi16(v, 15);
+        v = _mm_add_epi16(v, _mm_sub_epi16(_mm_xor_si128(offset, sign), sign));
+
+        /* quant, (coeff*q_scale) >> shift, plus one if negative */
+        lo = _mm_mullo_epi16(v, q_scale);
+        hi = _mm_mulhi_epi16(v, q_scale);
+        p0 = _mm_sra_epi32(_mm_unpacklo_epi16(lo, hi), shift);
+        p1 = _mm_sra_epi32(_mm_unpackhi_epi16(lo, hi), shift);
+        p0 = _mm_add_epi32(p0, _mm_srli_epi32(p0, 31));
+        p1 = _mm_add_epi32(p1, _mm_srli_epi32(p1, 31));
+        q = _mm_packs_epi32(p0, p1);
+
+        code = _mm_andnot_si128(_mm_cmpeq_epi16(q, zero), code);
+        nz[i] = _mm_movemask_epi8(_mm_packs_epi16(code, zero));
+        if (nz[i] == 0)
+        {
+            continue;
+        }
+
+        q = _mm_min_epi16(_mm_max_epi16(q, clipmin), clipmax);
+        _mm_storeu_si128((__m128i*)(qv + (i << 3)), q);
+
+        /* dequant, q*QPx2 +/- Addition, clipped to [-2048,2047] */
+        sign = _mm_srai_epi16(q, 15);
+        sel = _mm_sub_epi16(_mm_xor_si128(addition, sign), sign);
+        p0 = _mm_madd_epi16(_mm_unpacklo_epi16(q, sel), dqmul);
+        p1 = _mm_madd_epi16(_mm_unpackhi_epi16(q, sel), dqmul);
+        v = _mm_packs_epi32(p0, p1);
+        v = _mm_min_epi16(_mm_max_epi16(v, _mm_set1_epi16(-2048)), _mm_set1_epi16(2047));
+        _mm_storeu_si128((__m128i*)(dqv + (i << 3)), v);
+    }
+}
+
+/* columns below dctMode, except those marked all zero by the FDCT */
+static inline __m128i ActiveColumns(Short *coeff, Int dctMode)
+{
+    const __m128i index = _mm_set_epi16(7, 6, 5, 4, 3, 2, 1, 0);
+    __m128i active = _mm_cmpgt_epi16(_mm_set1_epi16(dctMode), index);
+    __m128i row0 = _mm_loadu_si128((__m128i*)coeff);
+
+    return _mm_andnot_si128(_mm_cmpeq_epi16(row0, _mm_set1_epi16(0x7fff)), active);
+}
+
+static inline void SetBitmapRow(UChar bitmapcol[], UChar *bitmaprow, Int dctMode)
+{
+    Int i;
+
+    for (i = 0; i < dctMode; i++)
+    {
+        if (bitmapcol[i]) (*bitmaprow) |= (0x80 >> i);
+    }
+}
+
+Int BlockQuantDequantH263Inter_SSE2(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                    UChar bitmapcol[ ], UChar *bitmaprow, UInt *bitmapzz,
+                                    Int dctMode, Int comp, Int dummy, UChar shortHeader)
+{
+    Short qv[64], dqv[64];
+    UChar nz[8];
+    __m128i active[8];
+    Int i, j, k, zz, mask;
+    Int ac_clip = shortHeader ? 126 : 2047;
+
+    OSCL_UNUSED_ARG(comp);
+    OSCL_UNUSED_ARG(dummy);
+
+    *((Int*)bitmapcol) = *((Int*)(bitmapcol + 4)) = 0;
+    bitmapzz[0] = bitmapzz[1] = 0;
+    *bitmaprow = 0;
+
+    active[0] = ActiveColumns(rcoeff + 64, dctMode);
+    for (i = 1; i < dctMode; i++)
+    {
+        active[i] = active[0];
+    }
+
+    QuantRows(rcoeff + 64, QuantParam, (QuantParam->QPx2plus << 4) - 8, QuantParam->QPdiv2,
+              dctMode, ac_clip, active, qv, dqv, nz);
+
+    for (i = 0; i < dctMode; i++)
+    {
+        mask = nz[i];
+        while (mask)
+        {
+            j = __builtin_ctz(mask);
+            mask &= mask - 1;
+            k = (i << 3) + j;
+            zz = ZZTab[k] >> 1;
+
+            qcoeff[zz] = qv[k];
+            rcoeff[k] = dqv[k];
+            bitmapcol[j] |= (0x80 >> i);
+            if (zz > 31) bitmapzz[1] |= (1 << (63 - zz));
+            else        bitmapzz[0] |= (1 << (31 - zz));
+        }
+    }
+
+    SetBitmapRow(bitmapcol, bitmaprow, dctMode);
+
+    if (*bitmaprow)
+        return 1;
+    else
+        return 0;
+}
+
+Int BlockQuantDequantH263Intra_SSE2(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                    UChar bitmapcol[ ], UChar *bitmaprow, UInt *bitmapzz,
+                                    Int dctMode, Int comp, Int dc_scaler, UChar shortHeader)
+{
+    Short qv[64], dqv[64];
+    UChar nz[8];
+    __m128i active[8];
+    Int i, j, k, mask;
+    Int coeff, q_value;
+    Int ac_clip = shortHeader ? 126 : 2047;
+    Short *src = rcoeff + 64;
+
+    OSCL_UNUSED_ARG(bitmapzz);
+    OSCL_UNUSED_ARG(comp);
+
+    *((Int*)bitmapcol) = *((Int*)(bitmapcol + 4)) = 0;
+    *bitmaprow = 0;
+
+    active[0] = ActiveColumns(src, dctMode);
+
+    /* DC value, as in the C version */
+    coeff = src[0];
+    if (coeff == 0x7fff)
+    {
+        if (shortHeader)
+        {
+            qcoeff[0] = 1; /* can't be zero */
+            rcoeff[0] = PV_MAX(-2048, PV_MIN(2047, dc_scaler));
+            bitmapcol[0] |= 128;
+        }
+        for (i = 1; i < dctMode; i++)
+        {
+            active[i] = active[0];
+        }
+    }
+    else
+    {
+        q_value = (1 << 15) + (coeff << 12);
+        coeff = q_value >> 16;
+        if (coeff >= 0) coeff += (dc_scaler >> 1) ;
+        else            coeff -= (dc_scaler >> 1) ;
+        q_value = scaleArrayV2[dc_scaler];
+        coeff = coeff * q_value;
+        coeff >>= (15 + (dc_scaler >> 4));
+        coeff += ((UInt)coeff >> 31);
+
+        if (shortHeader)
+            coeff = PV_MAX(1, PV_MIN(254, coeff));
+
+        if (coeff)
+        {
+            qcoeff[0] = coeff;
+            coeff = coeff * dc_scaler;
+            coeff = PV_MAX(-2048, PV_MIN(2047, coeff));
+            rcoeff[0] = coeff;
+            bitmapcol[0] |= 128;
+        }
+
+        /* the AC of column 0 starts at row 1, and the C code checks that
+           one for the all-zero mark */
+        active[1] = _mm_insert_epi16(active[0], (src[8] == 0x7fff) ? 0 : -1, 0);
+        active[0] = _mm_insert_epi16(active[0], 0, 0);
+        for (i = 2; i < dctMode; i++)
+        {
+            active[i] = active[1];
+        }
+    }
+
+    QuantRows(src, QuantParam, (QuantParam->QPx2 << 4) - 8, 0,
+              dctMode, ac_clip, active, qv, dqv, nz);
+
+    for (i = 0; i < dctMode; i++)
+    {
+        mask = nz[i];
+        while (mask)
+        {
+            j = __builtin_ctz(mask);
+            mask &= mask - 1;
+            k = (i << 3) + j;
+
+            qcoeff[k] = qv[k];
+            rcoeff[k] = dqv[k];
+            bitmapcol[j] |= (0x80 >> i);
+        }
+    }
+
+    SetBitmapRow(bitmapcol, bitmaprow, dctMode);
+
+    if (((*bitmaprow)&127) || (bitmapcol[0]&127)) /* exclude DC */
+        return 1;
+    else
+        return 0;
+}
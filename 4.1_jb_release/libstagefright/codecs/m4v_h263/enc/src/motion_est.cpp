@@ -67,6 +67,22 @@ const static Int refine_next[8][2] =    /* [curr_k][increment] */
     {0, 0}, {2, 0}, {1, 1}, {0, 2}, { -1, 1}, { -2, 0}, { -1, -1}, {0, -2}
 };
 
+/* points of the fast search patterns, in circular order */
+const static Int small_diamond[4][2] =  /* [k][x, y] */
+{
+    {0, -1}, {1, 0}, {0, 1}, { -1, 0}
+};
+
+const static Int hexagon[6][2] =    /* [k][x, y] */
+{
+    { -2, 0}, { -1, -2}, {1, -2}, {2, 0}, {1, 2}, { -1, 2}
+};
+
+const static Int square[8][2] = /* [k][x, y] */
+{
+    { -1, -1}, {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, { -1, 1}, { -1, 0}
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -79,6 +95,10 @@ extern "C"
                     Int *imin, Int *jmin, Int ilow, Int ihigh, Int jlow, Int jhigh);
     Int fullsearchBlk(VideoEncData *video, Vol *currVol, UChar *cent, UChar *cur,
                       Int *imin, Int *jmin, Int ilow, Int ihigh, Int jlow, Int jhigh, Int range);
+    Int PatternSearch(VideoEncData *video, UChar *prev, UChar *cur,
+                      const Int pattern[][2], Int num_points, Int max_step,
+                      Int i0, Int j0, Int *imin, Int *jmin, Int dmin,
+                      Int ilow, Int ihigh, Int jlow, Int jhigh);
     void CandidateSelection(Int *mvx, Int *mvy, Int *num_can, Int imb, Int jmb,
                             VideoEncData *video, Int type_pred);
     void RasterIntraUpdate(UChar *intraArray, UChar *Mode, Int totalMB, Int numRefresh);
@@ -793,7 +813,7 @@ void MBMotionSearch(VideoEncData *video, UChar *cur, UChar *best_cand[],
 #endif
     Int k;
     Int mvx[5], mvy[5], imin0, jmin0;
-    Int num_can, center_again;
+    Int num_can, center_again, early_exit;
     Int last_loc, new_loc = 0;
     Int step, max_step = range >> 1;
     Int next;
@@ -934,83 +954,153 @@ void MBMotionSearch(VideoEncData *video, UChar *cur, UChar *best_cand[],
                 jmin = j0;
             }
 
+            if (encParams->MESearch != ME_SPIRAL)
+            {
+                /* (0,0), and for EPZS the median MV of the left, top and top-right
+                   MBs, are candidates too */
+                num_can = 0;
+                if (encParams->MESearch == ME_EPZS && i0 > 0 && j0 > 0)
+                {
+                    MOT *pmotA = &mot[mbnum - 1][0];
+                    MOT *pmotB = &mot[mbnum - currVol->nMBPerRow][0];
+                    MOT *pmotC = &mot[mbnum - currVol->nMBPerRow +
+                                      ((i0 + 16 < width) ? 1 : -1)][0];
+
+                    mvx[num_can] = PV_MEDIAN(pmotA->x, pmotB->x, pmotC->x) >> 1;
+                    mvy[num_can++] = PV_MEDIAN(pmotA->y, pmotB->y, pmotC->y) >> 1;
+                }
+                mvx[num_can] = mvy[num_can] = 0;
+                num_can++;
+
+                for (k = 0; k < num_can; k++)
+                {
+                    i = i0 + mvx[k];
+                    j = j0 + mvy[k];
+
+                    if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh &&
+                            (i != imin || j != jmin))
+                    {
+                        cand = ref + i + j * lx;
+                        d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
+
+                        if (d < dmin)
+                        {
+                            dmin = d;
+                            imin = i;
+                            jmin = j;
+                            ncand = cand;
+                        }
+                        else if ((d == dmin) && PV_ABS(mvx[k]) + PV_ABS(mvy[k]) < PV_ABS(i0 - imin) + PV_ABS(j0 - jmin))
+                        {
+                            dmin = d;
+                            imin = i;
+                            jmin = j;
+                            ncand = cand;
+                        }
+                    }
+                }
+            }
+            early_exit = (dmin <= encParams->MEEarlyExitSAD);
+
 #if (ZERO_MV_PREF==0)  /*  COMPUTE ZERO VECTOR FIRST !!!!!*/
             dmin -= PREF_NULL_VEC;
 #endif
 
             /******************* local refinement ***************************/
-            center_again = 0;
-            last_loc = new_loc = 0;
-            //          ncand = ref + jmin*lx + imin;  /* center of the search */
-            step = 0;
-            dn[0] = dmin;
-            while (!center_again && step <= max_step)
+            if (early_exit)
             {
+                *hp_guess = 0; /* good enough, no refinement */
+            }
+            else if (encParams->MESearch == ME_HEXAGON)
+            {
+                *hp_guess = 0;
+                dmin = PatternSearch(video, ref, cur, hexagon, 6, max_step, i0, j0, &imin, &jmin,
+                                     dmin, ilow, ihigh, jlow, jhigh);
+                dmin = PatternSearch(video, ref, cur, square, 8, 1, i0, j0, &imin, &jmin,
+                                     dmin, ilow, ihigh, jlow, jhigh);
+                ncand = ref + imin + jmin * lx;
+            }
+            else if (encParams->MESearch != ME_SPIRAL) /* diamond and EPZS */
+            {
+                *hp_guess = 0;
+                dmin = PatternSearch(video, ref, cur, small_diamond, 4, max_step, i0, j0, &imin, &jmin,
+                                     dmin, ilow, ihigh, jlow, jhigh);
+                ncand = ref + imin + jmin * lx;
+            }
+            else
+            {
+                center_again = 0;
+                last_loc = new_loc = 0;
+                //          ncand = ref + jmin*lx + imin;  /* center of the search */
+                step = 0;
+                dn[0] = dmin;
+                while (!center_again && step <= max_step)
+                {
 
-                MoveNeighborSAD(dn, last_loc);
-
-                center_again = 1;
-                i = imin;
-                j = jmin - 1;
-                cand = ref + i + j * lx;
+                    MoveNeighborSAD(dn, last_loc);
 
-                /*  starting from [0,-1] */
-                /* spiral check one step at a time*/
-                for (k = 2; k <= 8; k += 2)
-                {
-                    if (!tab_exclude[last_loc][k]) /* exclude last step computation */
-                    {       /* not already computed */
-                        if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
-                        {
-                            d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
-                            dn[k] = d; /* keep it for half pel use */
+                    center_again = 1;
+                    i = imin;
+                    j = jmin - 1;
+                    cand = ref + i + j * lx;
 
-                            if (d < dmin)
+                    /*  starting from [0,-1] */
+                    /* spiral check one step at a time*/
+                    for (k = 2; k <= 8; k += 2)
+                    {
+                        if (!tab_exclude[last_loc][k]) /* exclude last step computation */
+                        {       /* not already computed */
+                            if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
                             {
-                                ncand = cand;
-                                dmin = d;
-                                imin = i;
-                                jmin = j;
-                                center_again = 0;
-                                new_loc = k;
+                                d = (*SAD_Macroblock)(cand, cur, (dmin << 16) | lx, extra_info);
+                                dn[k] = d; /* keep it for half pel use */
+
+                                if (d < dmin)
+                                {
+                                    ncand = cand;
+                                    dmin = d;
+                                    imin = i;
+                                    jmin = j;
+                                    center_again = 0;
+                                    new_loc = k;
+                                }
+                                else if ((d == dmin) && PV_ABS(i0 - i) + PV_ABS(j0 - j) < PV_ABS(i0 - imin) + PV_ABS(j0 - jmin))
+                                {
+                                    ncand = cand;
+                                    imin = i;
+                                    jmin = j;
+                                    center_again = 0;
+                                    new_loc = k;
+                                }
                             }
-                            else if ((d == dmin) && PV_ABS(i0 - i) + PV_ABS(j0 - j) < PV_ABS(i0 - imin) + PV_ABS(j0 - jmin))
+                        }
+                        if (k == 8)  /* end side search*/
+                        {
+                            if (!center_again)
                             {
-                                ncand = cand;
-                                imin = i;
-                                jmin = j;
-                                center_again = 0;
-                                new_loc = k;
+                                k = -1; /* start diagonal search */
+                                cand -= lx;
+                                j--;
                             }
                         }
-                    }
-                    if (k == 8)  /* end side search*/
-                    {
-                        if (!center_again)
+                        else
                         {
-                            k = -1; /* start diagonal search */
-                            cand -= lx;
-                            j--;
+                            next = refine_next[k][0];
+                            i += next;
+                            cand += next;
+                            next = refine_next[k][1];
+                            j += next;
+                            cand += lx * next;
                         }
                     }
-                    else
-                    {
-                        next = refine_next[k][0];
-                        i += next;
-                        cand += next;
-                        next = refine_next[k][1];
-                        j += next;
-                        cand += lx * next;
-                    }
+                    last_loc = new_loc;
+                    step ++;
                 }
-                last_loc = new_loc;
-                step ++;
-            }
-            if (!center_again)
-                MoveNeighborSAD(dn, last_loc);
-
-            *hp_guess = FindMin(dn);
+                if (!center_again)
+                    MoveNeighborSAD(dn, last_loc);
 
+    *hp_guess = FindMin(dn);
+            }
         }
 
 #if (ZERO_MV_PREF==1)   /* compute (0,0) MV at the end */
@@ -1340,6 +1430,65 @@ Int fullsearchBlk(VideoEncData *video, Vol *currVol, UChar *cent, UChar *cur,
 }
 #endif /* NO_INTER4V */
 
+/*===============================================================================
+    Function:   PatternSearch
+    Purpose:    Move the best position (imin, jmin) to the best of the points
+                of a pattern around it, for as long as one of them is better
+                and up to max_step times. After a move, only the point in the
+                same direction and its two neighbors in the pattern are new.
+    Input/Output:   dmin is the SAD at (imin, jmin). Returns the new SAD, the
+                position is updated. Ties go to the shorter MV, as in
+                MBMotionSearch.
+===============================================================================*/
+Int PatternSearch(VideoEncData *video, UChar *prev, UChar *cur,
+                  const Int pattern[][2], Int num_points, Int max_step,
+                  Int i0, Int j0, Int *imin, Int *jmin, Int dmin,
+                  Int ilow, Int ihigh, Int jlow, Int jhigh)
+{
+    Int(*SAD_Macroblock)(UChar*, UChar*, Int, void*) = video->functionPointer->SAD_Macroblock;
+    void *extra_info = video->sad_extra_info;
+    Int lx = video->currVop->pitch; /* with padding */
+    Int ic = *imin; /* center of the pattern */
+    Int jc = *jmin;
+    Int i, j, k, n, d;
+    Int dir = -1, best_dir, step;
+
+    for (step = 0; step < max_step; step++)
+    {
+        best_dir = -1;
+        for (n = 0; n < ((dir < 0) ? num_points : 3); n++)
+        {
+            k = (dir < 0) ? n : (dir + num_points - 1 + n) % num_points;
+            i = ic + pattern[k][0];
+            j = jc + pattern[k][1];
+
+            if (i >= ilow && i <= ihigh && j >= jlow && j <= jhigh)
+            {
+                d = (*SAD_Macroblock)(prev + i + j * lx, cur, (dmin << 16) | lx, extra_info);
+
+                if (d < dmin || ((d == dmin) &&
+                                 PV_ABS(i0 - i) + PV_ABS(j0 - j) < PV_ABS(i0 - *imin) + PV_ABS(j0 - *jmin)))
+                {
+                    dmin = d;
+                    *imin = i;
+                    *jmin = j;
+                    best_dir = k;
+                }
+            }
+        }
+
+        if (best_dir < 0) /* the center is the best */
+        {
+            break;
+        }
+        dir = best_dir;
+        ic = *imin;
+        jc = *jmin;
+    }
+
+    return dmin;
+}
+
 /*===============================================================================
     Function:   CandidateSelection
     Date:       09/16/2000
@@ -115,6 +115,7 @@ typedef UChar PIXEL;
 #define PV_SIGN0(a)     (((a)<0)? -1 : (((a)>0) ? 1 : 0))
 #define PV_MAX(a,b)     ((a)>(b)? (a):(b))
 #define PV_MIN(a,b)     ((a)<(b)? (a):(b))
+#define PV_MEDIAN(a,b,c)    PV_MAX(PV_MIN(a,b), PV_MIN(PV_MAX(a,b),c))
 
 #define MODE_INTRA      0
 #define MODE_INTER      1
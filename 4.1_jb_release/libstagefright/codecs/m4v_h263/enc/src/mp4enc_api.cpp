@@ -158,7 +158,8 @@ OSCL_EXPORT_REF Bool PVGetDefaultEncOption(VideoEncOptions *encOption, Int encUs
 {
     VideoEncOptions defaultUseCase = {H263_MODE, profile_level_max_packet_size[SIMPLE_PROFILE_LEVEL0] >> 3,
                                       SIMPLE_PROFILE_LEVEL0, PV_OFF, 0, 1, 1000, 33, {144, 144}, {176, 176}, {15, 30}, {64000, 128000},
-                                      {10, 10}, {12, 12}, {0, 0}, CBR_1, 0.0, PV_OFF, -1, 0, PV_OFF, 16, PV_OFF, 0, PV_ON
+                                      {10, 10}, {12, 12}, {0, 0}, CBR_1, 0.0, PV_OFF, -1, 0, PV_OFF, 16, PV_OFF, 0, PV_ON,
+                                      ME_SPIRAL, 0
                                      };
 
     OSCL_UNUSED_ARG(encUseCase); // unused for now. Later we can add more defaults setting and use this
@@ -330,6 +331,12 @@ OSCL_EXPORT_REF Bool    PVInitVideoEncoder(VideoEncControls *encoderControl, Vid
 
     encParams->HalfPel_Enabled = 1;
     encParams->SearchRange = encOption->searchRange; /* 4/16/2001 */
+    if ((UInt)encOption->meSearch > ME_EPZS || encOption->meEarlyExitSAD < 0)
+    {
+        goto CLEAN_UP;
+    }
+    encParams->MESearch = encOption->meSearch;
+    encParams->MEEarlyExitSAD = encOption->meEarlyExitSAD;
     encParams->FullSearch_Enabled = 0;
 #ifdef NO_INTER4V
     encParams->MV8x8_Enabled = 0;
@@ -1051,6 +1058,7 @@ OSCL_EXPORT_REF Bool    PVInitVideoEncoder(VideoEncControls *encoderControl, Vid
     video->functionPointer->SAD_Macroblock = &SAD_Macroblock_C;
     video->functionPointer->ChooseMode = &ChooseMode_C;
     video->functionPointer->GetHalfPelMBRegion = &GetHalfPelMBRegion_C;
+    InitBlockCodingFunctions(video->functionPointer);
 //  video->functionPointer->SAD_MB_PADDING = &SAD_MB_PADDING; /* 4/21/01 */
 
 
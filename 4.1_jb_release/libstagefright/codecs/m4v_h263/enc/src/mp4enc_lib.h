@@ -47,6 +47,11 @@ extern "C"
 
 //void m4v_memset(void *adr_dst, uint8 value, uint32 size);
 
+    /* Select the 8x8 DCT, H.263 quant/dequant and IDCT functions for this CPU.
+       All versions give the same results. On x86 the CPU's features come from
+       x86_cpu_get_features(). */
+    void InitBlockCodingFunctions(FuncPtr *functionPointer);
+
     PV_STATUS CodeMB_H263(VideoEncData *video, approxDCT *function, Int offsetQP, Int ncoefblck[]);
 #ifndef NO_MPEG_QUANT
     PV_STATUS CodeMB_MPEG(VideoEncData *video, approxDCT *function, Int offsetQP, Int ncoefblck[]);
@@ -97,6 +102,27 @@ extern "C"
                              Int dctMode, UChar *rec, UChar *prev, Int lx_intra_zeroMV);
 
 
+#ifdef M4VENC_X86
+    /*---- dct_sse2.cpp, fastquant_sse2.cpp -----*/
+    /* Same results as the C versions */
+    Void BlockDCT_AANwSub_SSE2(Short *out, UChar *cur, UChar *pred, Int width);
+    Void BlockDCT_AANIntra_SSE2(Short *out, UChar *cur, UChar *dummy2, Int width);
+    void BlockIDCTMotionComp_SSE2(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                                  Int dctMode, UChar *rec, UChar *pred, Int lx_intra);
+    Int BlockQuantDequantH263Inter_SSE2(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                        UChar bitmapcol[ ], UChar *bitmaprow, UInt *bitmapzz,
+                                        Int dctMode, Int comp, Int dummy, UChar shortHeader);
+    Int BlockQuantDequantH263Intra_SSE2(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                        UChar bitmapcol[ ], UChar *bitmaprow, UInt *bitmapzz,
+                                        Int dctMode, Int comp, Int dc_scaler, UChar shortHeader);
+
+    /*---- dct_avx2.cpp -----*/
+    Void BlockDCT_AANwSub_AVX2(Short *out, UChar *cur, UChar *pred, Int width);
+    Void BlockDCT_AANIntra_AVX2(Short *out, UChar *cur, UChar *dummy2, Int width);
+    void BlockIDCTMotionComp_AVX2(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                                  Int dctMode, UChar *rec, UChar *pred, Int lx_intra);
+#endif
+
     /* defined in motion_comp.c */
     void getMotionCompensatedMB(VideoEncData *video, Int ind_x, Int ind_y, Int offset);
     void EncPrediction_INTER(Int xpred, Int ypred, UChar *c_prev, UChar *c_rec,
@@ -220,6 +220,8 @@ typedef struct tagVideoEncParams
     Bool    RD_opt_Enabled;         /* Enable operational R-D optimization */
     Int     GOB_Header_Interval;        /* Enable encoding GOB header in H263_WITH_ERR_RES and SHORT_HERDER_WITH_ERR_RES */
     Int     SearchRange;            /* Search range for 16x16 motion vector */
+    Int     MESearch;               /* full-pel search pattern for 16x16 motion vector, MESearchType */
+    Int     MEEarlyExitSAD;         /* SAD at or below which the best candidate is not refined */
     Int     MemoryUsage;            /* Amount of memory allocated */
     Int     GetVolHeader[2];        /* Flag to check if Vol Header has been retrieved */
     Int     BufferSize[2];          /* Buffer Size for Base and Enhance Layers */
@@ -243,6 +245,17 @@ typedef struct tagFuncPtr
     void (*ChooseMode)(UChar *Mode, UChar *cur, Int lx, Int min_SAD);
     void (*GetHalfPelMBRegion)(UChar *cand, UChar *hmem, Int lx);
     void (*blockIdct)(Int *block);
+    /* 8x8 DCT, H.263 quant/dequant and IDCT used by CodeMB_H263 and CodeMB_MPEG */
+    void (*BlockDCT8x8wSub)(Short *out, UChar *cur, UChar *pred, Int width);
+    void (*BlockDCT8x8Intra)(Short *out, UChar *cur, UChar *dummy, Int width);
+    Int(*BlockQuantDequantH263Inter)(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                     UChar bitmapcol[], UChar *bitmaprow, UInt *bitmapzz,
+                                     Int dctMode, Int comp, Int dummy, UChar shortHeader);
+    Int(*BlockQuantDequantH263Intra)(Short *rcoeff, Short *qcoeff, struct QPstruct *QuantParam,
+                                     UChar bitmapcol[], UChar *bitmaprow, UInt *bitmapzz,
+                                     Int dctMode, Int comp, Int dc_scaler, UChar shortHeader);
+    void (*BlockIDCTMotionComp)(Short *block, UChar *bitmapcol, UChar bitmaprow,
+                                Int dctMode, UChar *rec, UChar *pred, Int lx_intra);
 
 
 } FuncPtr;
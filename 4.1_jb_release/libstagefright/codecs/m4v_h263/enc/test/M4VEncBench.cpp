@@ -0,0 +1,583 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: M4VEncBench.cpp
+ * Brief: Checks the DCT, quantizer and IDCT functions of the MPEG-4/H.263
+ *        encoder and times the encoder with each set
+ *
+ * The DCT, quantizer and IDCT functions of every set the CPU supports are
+ * first run on the same random blocks as the C versions and must give the
+ * same coefficients, bitmaps and reconstructed pixels. The YUV 4:2:0 input
+ * is then encoded once per set, with the settings of SoftMPEG4Encoder. The
+ * bitstreams must be identical. Exits with 1 on the first difference.
+ *
+ * usage: M4VEncBench [-n frames] [-b bitrate] [-r fps] [-h] [-o out.m4v]
+ *                    input.yuv width height
+ *
+ *   -h  H.263 baseline instead of MPEG-4 simple profile
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "mp4def.h"
+#include "mp4lib_int.h"
+#include "mp4enc_lib.h"
+#include "dct.h"
+
+/* biggest frame */
+#define OUT_BUF_SIZE    (1 << 20)
+
+typedef struct
+{
+    const char *pName;
+    const char *pCpu;       /* STAGEFRIGHT_X86_CPU, NULL for the best the CPU has */
+    FuncPtr func;
+
+} FunctionSet;
+
+static FunctionSet sets[] =
+{
+    { "c",    "c",    },
+#ifdef M4VENC_X86
+    { "sse2", "sse2", },
+    { "avx2", NULL,   },
+#endif
+};
+
+#define NUM_SETS    ((int)(sizeof(sets) / sizeof(sets[0])))
+
+static uint32_t randState;
+
+static uint32_t Rand(void)
+{
+    randState = randState * 1664525 + 1013904223;
+    return randState >> 8;
+}
+
+static void SelectSet(const FunctionSet *set)
+{
+    if (set->pCpu != NULL)
+    {
+        setenv("STAGEFRIGHT_X86_CPU", set->pCpu, 1);
+    }
+    else
+    {
+        unsetenv("STAGEFRIGHT_X86_CPU");
+    }
+}
+
+/* Sets whose functions are the same as those of the set before, because the
+   CPU doesn't have the instructions, are not run */
+static int InitSets(void)
+{
+    int i, num = 0;
+
+    for (i = 0; i < NUM_SETS; i++)
+    {
+        SelectSet(&sets[i]);
+        InitBlockCodingFunctions(&sets[i].func);
+
+        if (num > 0 &&
+                sets[i].func.BlockDCT8x8wSub == sets[num - 1].func.BlockDCT8x8wSub)
+        {
+            continue;
+        }
+        sets[num++] = sets[i];
+    }
+
+    return num;
+}
+
+/* 8x8 current block at stride width and 8x8 prediction at stride 16, the
+   current one a noisy copy of the prediction so that the residue goes from
+   nothing to full range */
+static void RandomBlock(UChar *cur, int width, UChar *pred)
+{
+    int i, j, noise = 1 << (Rand() % 9);
+    int base = Rand() & 0xFF;
+    int flat = Rand() & 1;
+
+    for (j = 0; j < 8; j++)
+    {
+        for (i = 0; i < 8; i++)
+        {
+            int p = flat ? base + (int)(Rand() % 9) - 4 : (int)(Rand() & 0xFF);
+            int v = p + (int)(Rand() % noise) - noise / 2;
+
+            p = p < 0 ? 0 : (p > 255 ? 255 : p);
+            pred[j * 16 + i] = (UChar)p;
+            cur[j * width + i] = (UChar)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+}
+
+/* What the quantizer returns and writes */
+typedef struct
+{
+    Short block[65 + 64];   /* the FDCT output, dequantized in place */
+    Short qcoeff[64];
+    UChar bitmapcol[8];
+    UChar bitmaprow;
+    UInt bitmapzz[2];
+    Int cbp;
+
+} QuantResult;
+
+static void SetQP(struct QPstruct *qp, Int QP)
+{
+    qp->QPx2 = QP << 1;
+    qp->QP = QP;
+    qp->QPdiv2 = QP >> 1;
+    qp->QPx2plus = qp->QPx2 + qp->QPdiv2;
+    qp->Addition = QP - 1 + (QP & 0x1);
+}
+
+static int CheckSet(const FunctionSet *set, const FunctionSet *ref,
+                    int iterations)
+{
+    UChar cur[64 * 8];
+    UChar pred[16 * 8] __attribute__((aligned(16)));
+    UChar recA[40 * 8], recB[40 * 8];
+    QuantResult a, b;
+    struct QPstruct qp;
+    int i, k;
+
+    for (i = 0; i < iterations; i++)
+    {
+        Int intra = Rand() & 1;
+        Int width = 8 + (Rand() % 57);
+        Int QP = 1 + (Rand() % 31);
+        Int shortHeader = Rand() & 1;
+        Int dcScaler = shortHeader ? 8 : cal_dc_scalerENC(QP, 1 + (Rand() & 1));
+        Int dctMode = 8;
+        Int lx = 8 + (Rand() % 33);
+        Short colTh;
+        void (*dct)(Short *, UChar *, UChar *, Int);
+
+        RandomBlock(cur, width, pred);
+        SetQP(&qp, QP);
+
+        /* FDCT, the output in block[64..127] and ColTh in block[64] */
+        memset(&a, 0, sizeof(a));
+        colTh = (Short)((Rand() & 3) ? (intra ? ColThIntra[QP] : ColThInter[QP]) :
+                        Rand() % 0x800);
+        a.block[64] = colTh;
+        memcpy(&b, &a, sizeof(a));
+        if (intra)
+        {
+            (*ref->func.BlockDCT8x8Intra)(a.block, cur, NULL, width);
+            (*set->func.BlockDCT8x8Intra)(b.block, cur, NULL, width);
+        }
+        else
+        {
+            (*ref->func.BlockDCT8x8wSub)(a.block, cur, pred, width);
+            (*set->func.BlockDCT8x8wSub)(b.block, cur, pred, width);
+        }
+        if (memcmp(a.block, b.block, sizeof(a.block)))
+        {
+            printf("BlockDCT8x8%s: %s and %s differ, iteration %d\n",
+                   intra ? "Intra" : "wSub", ref->pName, set->pName, i);
+            return 1;
+        }
+
+        /* the smaller DCTs of CodeMB_H263 before the quantizer too */
+        switch (Rand() % 4)
+        {
+            case 0:
+                dctMode = 2;
+                dct = intra ? &Block2x2DCT_AANIntra : &Block2x2DCT_AANwSub;
+                break;
+            case 1:
+                dctMode = 4;
+                dct = intra ? &Block4x4DCT_AANIntra : &Block4x4DCT_AANwSub;
+                break;
+            default:
+                dct = NULL;
+                break;
+        }
+        if (dct != NULL)
+        {
+            memset(&a.block[64], 0, 64 * sizeof(Short));
+            a.block[64] = colTh;
+            (*dct)(a.block, cur, pred, width);
+        }
+
+        /* coefficients on the dead-zone thresholds, where the comparisons
+           must be the same */
+        for (k = 0; k < 8; k++)
+        {
+            Short *c = &a.block[64 + (Rand() % 64)];
+            Int t = (Rand() & 1) ? qp.QPx2 : qp.QPx2plus;
+
+            if (*c != 0x7FFF)
+            {
+                *c = (Short)(((t << 4) - 8 + (int)(Rand() % 3) - 1) * ((Rand() & 1) ? 1 : -1));
+            }
+        }
+        memcpy(&b, &a, sizeof(a));
+
+        if (intra)
+        {
+            a.cbp = (*ref->func.BlockQuantDequantH263Intra)(a.block, a.qcoeff, &qp,
+                    a.bitmapcol, &a.bitmaprow, a.bitmapzz, dctMode, 0, dcScaler, shortHeader);
+            b.cbp = (*set->func.BlockQuantDequantH263Intra)(b.block, b.qcoeff, &qp,
+                    b.bitmapcol, &b.bitmaprow, b.bitmapzz, dctMode, 0, dcScaler, shortHeader);
+        }
+        else
+        {
+            a.cbp = (*ref->func.BlockQuantDequantH263Inter)(a.block, a.qcoeff, &qp,
+                    a.bitmapcol, &a.bitmaprow, a.bitmapzz, dctMode, 0, 0, shortHeader);
+            b.cbp = (*set->func.BlockQuantDequantH263Inter)(b.block, b.qcoeff, &qp,
+                    b.bitmapcol, &b.bitmaprow, b.bitmapzz, dctMode, 0, 0, shortHeader);
+        }
+        if (memcmp(&a, &b, sizeof(a)))
+        {
+            printf("BlockQuantDequantH263%s: %s and %s differ, iteration %d\n",
+                   intra ? "Intra" : "Inter", ref->pName, set->pName, i);
+            return 1;
+        }
+
+        /* IDCT of the dequantized block, or of a DC-only or empty block */
+        switch (Rand() % 8)
+        {
+            case 0:
+                dctMode = 0;
+                break;
+            case 1:
+                dctMode = 1;
+                memset(a.block, 0, 64 * sizeof(Short));
+                a.block[0] = (Short)((int)(Rand() % 4096) - 2048);
+                a.bitmaprow = 0x80;
+                break;
+            default:
+                break;
+        }
+        memcpy(&b, &a, sizeof(a));
+        memset(recA, 0xAA, sizeof(recA));
+        memset(recB, 0xAA, sizeof(recB));
+        (*ref->func.BlockIDCTMotionComp)(a.block, a.bitmapcol, a.bitmaprow, dctMode,
+                                         recA, pred, (lx << 1) | intra);
+        (*set->func.BlockIDCTMotionComp)(b.block, b.bitmapcol, b.bitmaprow, dctMode,
+                                         recB, pred, (lx << 1) | intra);
+        if (memcmp(recA, recB, sizeof(recA)) || memcmp(a.block, b.block, 64 * sizeof(Short)))
+        {
+            printf("BlockIDCTMotionComp: %s and %s differ, iteration %d\n",
+                   ref->pName, set->pName, i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+    Encoder
+------------------------------------------------------------------------------*/
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct
+{
+    const char *pInput;
+    int width, height;
+    int frames;
+    int bitrate;
+    int frameRate;
+    int h263;
+
+} EncodeParams;
+
+typedef struct
+{
+    int frames;
+    uint32_t size;
+    uint32_t hash;          /* FNV-1a of the stream */
+    double seconds;         /* spent in the encoder */
+
+} EncodeResult;
+
+static void PutData(EncodeResult *result, FILE *out, const UChar *data, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+    {
+        result->hash = (result->hash ^ data[i]) * 16777619;
+    }
+    result->size += size;
+
+    if (out != NULL)
+    {
+        fwrite(data, 1, size, out);
+    }
+}
+
+/* Encodes the input with the functions selected by set. The stream goes to
+   out if it isn't NULL. Returns 0, or -1 on error. */
+static int Encode(const FunctionSet *set, const EncodeParams *p, FILE *out,
+                  EncodeResult *result)
+{
+    VideoEncControls handle;
+    VideoEncOptions options;
+    FILE *input;
+    UChar *yuv, *data;
+    int frameSize = p->width * p->height * 3 / 2;
+    double start;
+
+    input = fopen(p->pInput, "rb");
+    if (input == NULL)
+    {
+        printf("cannot open %s\n", p->pInput);
+        return -1;
+    }
+    yuv = (UChar *)malloc(frameSize);
+    data = (UChar *)malloc(OUT_BUF_SIZE);
+
+    /* as SoftMPEG4Encoder sets them */
+    memset(&handle, 0, sizeof(handle));
+    memset(&options, 0, sizeof(options));
+    PVGetDefaultEncOption(&options, 0);
+    options.encMode = p->h263 ? H263_MODE : COMBINE_MODE_WITH_ERR_RES;
+    options.packetSize = 32;
+    options.rvlcEnable = PV_OFF;
+    options.numLayers = 1;
+    options.timeIncRes = 1000;
+    options.tickPerSrc = options.timeIncRes / p->frameRate;
+    options.encWidth[0] = p->width;
+    options.encHeight[0] = p->height;
+    options.encFrameRate[0] = p->frameRate;
+    options.rcType = VBR_1;
+    options.vbvDelay = 5.0f;
+    options.profile_level = CORE_PROFILE_LEVEL2;
+    options.bitRate[0] = p->bitrate;
+    options.iQuant[0] = 15;
+    options.pQuant[0] = 12;
+    options.quantType[0] = 0;
+    options.noFrameSkipped = PV_OFF;
+    options.intraPeriod = p->frameRate;
+    options.numIntraMB = 0;
+    options.sceneDetect = PV_ON;
+    options.searchRange = 16;
+    options.mv8x8Enable = PV_OFF;
+    options.gobHeaderInterval = 0;
+    options.useACPred = PV_ON;
+    options.intraDCVlcTh = 0;
+
+    SelectSet(set);
+    memset(result, 0, sizeof(*result));
+    result->hash = 2166136261u;
+
+    start = Now();
+    if (!PVInitVideoEncoder(&handle, &options))
+    {
+        printf("PVInitVideoEncoder failed\n");
+        fclose(input);
+        free(data);
+        free(yuv);
+        return -1;
+    }
+
+    if (!p->h263)
+    {
+        Int size = OUT_BUF_SIZE;
+
+        if (!PVGetVolHeader(&handle, data, &size, 0))
+        {
+            printf("PVGetVolHeader failed\n");
+            PVCleanUpVideoEncoder(&handle);
+            fclose(input);
+            free(data);
+            free(yuv);
+            return -1;
+        }
+        result->seconds += Now() - start;
+        PutData(result, out, data, size);
+    }
+
+    while (result->frames < p->frames &&
+            fread(yuv, 1, frameSize, input) == (size_t)frameSize)
+    {
+        VideoEncFrameIO vin, vout;
+        ULong modTime;
+        Int size = OUT_BUF_SIZE;
+        Int layer = 0;
+
+        memset(&vin, 0, sizeof(vin));
+        vin.height = p->height;
+        vin.pitch = p->width;
+        vin.timestamp = (result->frames * 1000) / p->frameRate;
+        vin.yChan = yuv;
+        vin.uChan = yuv + p->width * p->height;
+        vin.vChan = vin.uChan + (p->width * p->height >> 2);
+        result->frames++;
+
+        start = Now();
+        if (!PVEncodeVideoFrame(&handle, &vin, &vout, &modTime, data, &size, &layer))
+        {
+            printf("PVEncodeVideoFrame failed\n");
+            break;
+        }
+        result->seconds += Now() - start;
+
+        /* skipped by the rate control */
+        if (layer < 0)
+        {
+            continue;
+        }
+        PutData(result, out, data, size);
+    }
+
+    PVCleanUpVideoEncoder(&handle);
+
+    free(data);
+    free(yuv);
+    fclose(input);
+
+    return 0;
+}
+
+static void Usage(void)
+{
+    printf("usage: M4VEncBench [-n frames] [-b bitrate] [-r fps] [-h] [-o out.m4v]\n"
+           "                   input.yuv width height\n");
+}
+
+int main(int argc, char **argv)
+{
+    EncodeParams p;
+    EncodeResult results[NUM_SETS];
+    const char *pOutput = NULL;
+    int numSets, i, arg;
+
+    p.frames = 100;
+    p.bitrate = 0;
+    p.frameRate = 30;
+    p.h263 = 0;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (!strcmp(argv[arg], "-h"))
+        {
+            p.h263 = 1;
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-n"))
+        {
+            p.frames = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-b"))
+        {
+            p.bitrate = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-r"))
+        {
+            p.frameRate = atoi(argv[++arg]);
+        }
+        else if (arg + 1 < argc && !strcmp(argv[arg], "-o"))
+        {
+            pOutput = argv[++arg];
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+    if (argc - arg != 3)
+    {
+        Usage();
+        return 1;
+    }
+    p.pInput = argv[arg];
+    p.width = atoi(argv[arg + 1]);
+    p.height = atoi(argv[arg + 2]);
+    if (p.width <= 0 || p.height <= 0 || ((p.width | p.height) & 15) ||
+            p.frames <= 0 || p.frameRate <= 0)
+    {
+        Usage();
+        return 1;
+    }
+    if (p.bitrate <= 0)
+    {
+        /* about 0.1 bit per pixel */
+        p.bitrate = p.width * p.height / 10 * p.frameRate;
+    }
+
+    numSets = InitSets();
+
+    randState = 1;
+    for (i = 1; i < numSets; i++)
+    {
+        if (CheckSet(&sets[i], &sets[0], 100000))
+        {
+            return 1;
+        }
+        printf("%s: same results as %s over 100000 blocks\n",
+               sets[i].pName, sets[0].pName);
+    }
+
+    printf("\n%dx%d, %d bps, %s\n", p.width, p.height, p.bitrate,
+           p.h263 ? "H.263" : "MPEG-4");
+
+    for (i = 0; i < numSets; i++)
+    {
+        FILE *out = NULL;
+
+        if (i == 0 && pOutput != NULL)
+        {
+            out = fopen(pOutput, "wb");
+            if (out == NULL)
+            {
+                printf("cannot open %s\n", pOutput);
+                return 1;
+            }
+        }
+
+        if (Encode(&sets[i], &p, out, &results[i]) < 0)
+        {
+            return 1;
+        }
+        if (out != NULL)
+        {
+            fclose(out);
+        }
+
+        printf("%-6s %4d frames %8.2f fps %10u bytes\n", sets[i].pName,
+               results[i].frames, results[i].frames / results[i].seconds,
+               results[i].size);
+
+        if (i > 0 && (results[i].size != results[0].size ||
+                      results[i].hash != results[0].hash))
+        {
+            printf("%s: the stream differs from %s\n",
+                   sets[i].pName, sets[0].pName);
+            return 1;
+        }
+    }
+
+    return 0;
+}
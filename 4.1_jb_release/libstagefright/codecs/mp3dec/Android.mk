@@ -66,8 +66,96 @@ LOCAL_MODULE := libstagefright_mp3dec
 
 LOCAL_ARM_MODE := arm
 
+# x86: SSE4.1 and AVX2 versions of the alias reduction, the IMDCT and the
+# polyphase synthesis, picked at run time. They are in
+# libstagefright_mp3dec_sse41 and libstagefright_mp3dec_avx2 below, which
+# have to be linked along with this library.
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_SRC_FILES += \
+ 	src/pvmp3_x86.cpp
+
+LOCAL_CFLAGS += -DMP3DEC_X86
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/../common/include
+endif
+
+include $(BUILD_STATIC_LIBRARY)
+
+ifeq ($(TARGET_ARCH),x86)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+ 	src/pvmp3_sse41.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+        -DOSCL_UNUSED_ARG= -DMP3DEC_X86 -msse4.1
+
+LOCAL_MODULE := libstagefright_mp3dec_sse41
+
+include $(BUILD_STATIC_LIBRARY)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+ 	src/pvmp3_avx2.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+        -DOSCL_UNUSED_ARG= -DMP3DEC_X86 -mavx2
+
+LOCAL_MODULE := libstagefright_mp3dec_avx2
+
 include $(BUILD_STATIC_LIBRARY)
 
+endif
+
+################################################################################
+# test utility: checks the x86 functions and times the decoder
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+        test/MP3DecBench.cpp
+
+LOCAL_C_INCLUDES := \
+        frameworks/av/media/libstagefright/include \
+        $(LOCAL_PATH)/src \
+        $(LOCAL_PATH)/include
+
+LOCAL_CFLAGS := \
+        -DOSCL_UNUSED_ARG=
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_mp3dec
+
+LOCAL_SHARED_LIBRARIES := \
+        libutils liblog
+
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_CFLAGS += -DMP3DEC_X86
+LOCAL_STATIC_LIBRARIES += libstagefright_mp3dec_sse41 \
+        libstagefright_mp3dec_avx2 \
+        libstagefright_x86_cpu_override
+endif
+
+LOCAL_MODULE := mp3dec_bench
+LOCAL_MODULE_TAGS := debug
+
+include $(BUILD_EXECUTABLE)
+
 ################################################################################
 
 include $(CLEAR_VARS)
@@ -87,6 +175,12 @@ LOCAL_SHARED_LIBRARIES := \
 LOCAL_STATIC_LIBRARIES := \
         libstagefright_mp3dec
 
+ifeq ($(TARGET_ARCH),x86)
+LOCAL_STATIC_LIBRARIES += libstagefright_mp3dec_sse41 \
+        libstagefright_mp3dec_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_MODULE := libstagefright_soft_mp3dec
 LOCAL_MODULE_TAGS := optional
 
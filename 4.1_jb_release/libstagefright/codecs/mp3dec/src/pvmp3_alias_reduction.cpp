@@ -107,8 +107,6 @@ Input
 ; Include all pre-processor statements here. Include conditional
 ; compile variables also.
 ----------------------------------------------------------------------------*/
-#define NUM_BUTTERFLIES 8
-
 #define Q31_fmt(a)    (int32(double(0x7FFFFFFF)*a))
 
 /*----------------------------------------------------------------------------
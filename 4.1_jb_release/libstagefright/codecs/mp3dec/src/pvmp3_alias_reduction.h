@@ -56,6 +56,7 @@
 ; DEFINES
 ; Include all pre-processor statements here.
 ----------------------------------------------------------------------------*/
+#define NUM_BUTTERFLIES 8
 
 /*----------------------------------------------------------------------------
 ; EXTERNAL VARIABLES REFERENCES
@@ -78,6 +79,10 @@ extern "C"
 {
 #endif
 
+    /* pvmp3_alias_reduction.cpp, shared with the x86 versions */
+    extern const int32 c_signal[NUM_BUTTERFLIES];
+    extern const int32 c_alias[NUM_BUTTERFLIES];
+
     void pvmp3_alias_reduction(int32 *input_buffer,
     granuleInfo *gr_info,
     int32 *used_freq_lines,
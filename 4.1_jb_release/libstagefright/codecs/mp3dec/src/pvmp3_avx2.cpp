@@ -0,0 +1,230 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_avx2.cpp
+
+------------------------------------------------------------------------------
+ MODULE DESCRIPTION
+
+ AVX2 alias reduction, IMDCT and polyphase synthesis, eight subbands,
+ butterflies or time slots per vector. Built with -mavx2 in
+ libstagefright_mp3dec_avx2; pvmp3_x86.cpp only calls it on CPUs and
+ systems that have AVX2.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <immintrin.h>
+
+#include "pvmp3_x86.h"
+#include "pvmp3_x86_lanes.h"
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+typedef int32 v8si __attribute__((vector_size(32)));
+
+struct pvmp3_ops_avx2
+{
+    typedef v8si V;
+    enum { N = 8 };
+
+    static inline V load(const int32 *p)
+    {
+        return (V)_mm256_loadu_si256((const __m256i *)p);
+    }
+    static inline void store(int32 *p, V a)
+    {
+        _mm256_storeu_si256((__m256i *)p, (__m256i)a);
+    }
+    static inline V load_rev(const int32 *p)
+    {
+        return (V)_mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)p),
+                                              _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+    static inline void store_rev(int32 *p, V a)
+    {
+        _mm256_storeu_si256((__m256i *)p,
+                            _mm256_permutevar8x32_epi32((__m256i)a,
+                                    _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)));
+    }
+    static inline V set1(int32 a)
+    {
+        return (V)_mm256_set1_epi32(a);
+    }
+    static inline V shl(V a, int32 n)
+    {
+        return (V)_mm256_slli_epi32((__m256i)a, n);
+    }
+    static inline V sar(V a, int32 n)
+    {
+        return (V)_mm256_srai_epi32((__m256i)a, n);
+    }
+    /* 64 bit products of the even and the odd lanes, bits n .. n + 31 of each */
+    static inline V mul(V a, V b, int32 n)
+    {
+        __m256i even = _mm256_mul_epi32((__m256i)a, (__m256i)b);
+        __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64((__m256i)a, 32),
+                                        _mm256_srli_epi64((__m256i)b, 32));
+
+        return (V)_mm256_blend_epi32(_mm256_srli_epi64(even, n),
+                                     _mm256_slli_epi64(odd, 32 - n), 0xAA);
+    }
+    /* the packs work per 128 bit half, quadwords 0 and 2 hold the result */
+    static inline void store_pcm(int16 *p, V a)
+    {
+        __m256i pcm = _mm256_packs_epi32((__m256i)a, (__m256i)a);
+
+        _mm_storeu_si128((__m128i *)p,
+                         _mm256_castsi256_si128(_mm256_permute4x64_epi64(pcm, 0x08)));
+    }
+    /* 8x8 transposes, the columns past the last multiple of 8 one by one */
+    static inline void transpose(__m256i r[8])
+    {
+        __m256i t[8];
+        __m256i u[8];
+        int32 i;
+
+        for (i = 0; i < 8; i += 2)
+        {
+            t[i    ] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        }
+        for (i = 0; i < 8; i += 4)
+        {
+            u[i    ] = _mm256_unpacklo_epi64(t[i    ], t[i + 2]);
+            u[i + 1] = _mm256_unpackhi_epi64(t[i    ], t[i + 2]);
+            u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+            u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+        }
+        for (i = 0; i < 4; i++)
+        {
+            r[i    ] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+            r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+        }
+    }
+    static inline void load_lanes(V v[], const int32 *p, int32 stride, int32 count)
+    {
+        __m256i r[8];
+        int32 k, l;
+
+        for (k = 0; k + 8 <= count; k += 8)
+        {
+            for (l = 0; l < 8; l++)
+            {
+                r[l] = _mm256_loadu_si256((const __m256i *)&p[l*stride + k]);
+            }
+            transpose(r);
+            for (l = 0; l < 8; l++)
+            {
+                v[k + l] = (V)r[l];
+            }
+        }
+        for (; k < count; k++)
+        {
+            v[k] = (V)_mm256_setr_epi32(p[k], p[stride + k], p[2*stride + k], p[3*stride + k],
+                                        p[4*stride + k], p[5*stride + k], p[6*stride + k],
+                                        p[7*stride + k]);
+        }
+    }
+    static inline void store_lanes(int32 *p, const V v[], int32 stride, int32 count)
+    {
+        int32 t[8] __attribute__((aligned(32)));
+        __m256i r[8];
+        int32 k, l;
+
+        for (k = 0; k + 8 <= count; k += 8)
+        {
+            for (l = 0; l < 8; l++)
+            {
+                r[l] = (__m256i)v[k + l];
+            }
+            transpose(r);
+            for (l = 0; l < 8; l++)
+            {
+                _mm256_storeu_si256((__m256i *)&p[l*stride + k], r[l]);
+            }
+        }
+        for (; k < count; k++)
+        {
+            _mm256_store_si256((__m256i *)t, (__m256i)v[k]);
+            for (l = 0; l < 8; l++)
+            {
+                p[l*stride + k] = t[l];
+            }
+        }
+    }
+};
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+static int32 windowTable[HAN_SIZE/2] __attribute__((aligned(32)));
+static pthread_once_t windowOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+static void init_window_table(void)
+{
+    build_window_lanes<pvmp3_ops_avx2>(windowTable);
+}
+
+
+void pvmp3_alias_reduction_AVX2(int32 *input_buffer,
+                                 granuleInfo *gr_info,
+                                 int32 *used_freq_lines,
+                                 mp3Header *info)
+{
+    alias_reduction_lanes<pvmp3_ops_avx2>(input_buffer, gr_info, used_freq_lines, info);
+}
+
+
+void pvmp3_imdct_synth_AVX2(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                             int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                             uint32 blk_type,
+                             int16 mx_band,
+                             int32 used_freq_lines,
+                             int32 *Scratch_mem)
+{
+    OSCL_UNUSED_ARG(Scratch_mem);
+
+    imdct_synth_lanes<pvmp3_ops_avx2>(in, overlap, blk_type, mx_band, used_freq_lines);
+}
+
+
+void pvmp3_poly_phase_synthesis_AVX2(tmp3dec_chan *pChVars,
+                                      int32 numChannels,
+                                      e_equalization equalizerType,
+                                      int16 *outPcm)
+{
+    pthread_once(&windowOnce, init_window_table);
+
+    poly_phase_synthesis_lanes<pvmp3_ops_avx2>(pChVars, numChannels, equalizerType,
+            outPcm, windowTable);
+}
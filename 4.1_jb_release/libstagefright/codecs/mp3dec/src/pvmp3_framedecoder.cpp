@@ -116,6 +116,7 @@ Input
 #include "s_tmp3dec_file.h"
 #include "pvmp3_getbits.h"
 #include "mp3_mem_funcs.h"
+#include "pvmp3_x86.h"
 #include "frame.h"
 #include "synth.h"
 #include "utils/Log.h"
@@ -459,7 +460,7 @@ ERROR_CODE pvmp3_framedecoder(tPVMP3DecoderExternal *pExt,
                               info,
                               pVars->Scratch_mem);
 
-                pvmp3_alias_reduction(pChVars[ch]->work_buf_int32,
+                X86_FUNC(alias_reduction)(pChVars[ch]->work_buf_int32,
                                       &pVars->sideInfo.ch[ch].gran[gr],
                                       &pChVars[ ch]->used_freq_lines,
                                       info);
@@ -486,7 +487,7 @@ ERROR_CODE pvmp3_framedecoder(tPVMP3DecoderExternal *pExt,
                     }
                 }
 
-                pvmp3_imdct_synth(pChVars[ch]->work_buf_int32,
+                X86_FUNC(imdct_synth)(pChVars[ch]->work_buf_int32,
                                   pChVars[ch]->overlap,
                                   pVars->sideInfo.ch[ch].gran[gr].block_type,
                                   mixedBlocksLongBlocks,
@@ -498,7 +499,7 @@ ERROR_CODE pvmp3_framedecoder(tPVMP3DecoderExternal *pExt,
                  *   Polyphase synthesis
                  */
 
-                pvmp3_poly_phase_synthesis(pChVars[ch],
+                X86_FUNC(poly_phase_synthesis)(pChVars[ch],
                                            pVars->num_channels,
                                            pExt->equalizerType,
                                            &ptrOutBuffer[ch]);
@@ -715,6 +716,10 @@ void pvmp3_InitDecoder(tPVMP3DecoderExternal *pExt,
 
     pVars->inputStream.pBuffer = pExt->pInputBuffer;
 
+#ifdef MP3DEC_X86
+    pvmp3_InitX86Functions();
+#endif
+
     /*
      *  Initialize huffman decoding table
      */
@@ -115,10 +115,6 @@ Overlapping and adding with previous block
 ; Include all pre-processor statements here. Include conditional
 ; compile variables also.
 ----------------------------------------------------------------------------*/
-#define LONG        0
-#define START       1
-#define SHORT       2
-#define STOP        3
 
 /*----------------------------------------------------------------------------
 ; LOCAL FUNCTION DEFINITIONS
@@ -68,6 +68,10 @@
 /*----------------------------------------------------------------------------
 ; DEFINES AND SIMPLE TYPEDEF'S
 ----------------------------------------------------------------------------*/
+#define LONG        0
+#define START       1
+#define SHORT       2
+#define STOP        3
 
 
 /*----------------------------------------------------------------------------
@@ -81,6 +85,12 @@ extern "C"
 {
 #endif
 
+    /* pvmp3_imdct_synth.cpp, shared with the x86 versions */
+    extern const int32 normal_win[36];
+    extern const int32 start_win[36];
+    extern const int32 stop_win[36];
+    extern const int32 short_win[12];
+
     void pvmp3_imdct_synth(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
     int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
     uint32 blk_type,
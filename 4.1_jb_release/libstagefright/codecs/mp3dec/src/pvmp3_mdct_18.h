@@ -89,6 +89,10 @@ extern "C"
 {
 #endif
 
+    /* pvmp3_mdct_18.cpp, shared with the x86 versions */
+    extern const int32 cosTerms_dct18[9];
+    extern const int32 cosTerms_1_ov_cos_phi[18];
+
     void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window);
 
     void pvmp3_dct_9(int32 vec[]);
@@ -90,6 +90,9 @@ extern "C"
 #endif
 
 
+    /* pvmp3_mdct_6.cpp, shared with the x86 versions */
+    extern const int32 cosTerms_1_ov_cos_phi_N6[6];
+
     void pvmp3_mdct_6(int32 vec[], int32 *overlap);
 
     void pvmp3_dct_6(int32 vec[]);
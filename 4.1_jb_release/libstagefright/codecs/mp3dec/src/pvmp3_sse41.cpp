@@ -0,0 +1,207 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_sse41.cpp
+
+------------------------------------------------------------------------------
+ MODULE DESCRIPTION
+
+ SSE4.1 alias reduction, IMDCT and polyphase synthesis, four subbands,
+ butterflies or time slots per vector. Built with -msse4.1 in
+ libstagefright_mp3dec_sse41; pvmp3_x86.cpp only calls it on CPUs that
+ have SSE4.1.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <smmintrin.h>
+
+#include "pvmp3_x86.h"
+#include "pvmp3_x86_lanes.h"
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+typedef int32 v4si __attribute__((vector_size(16)));
+
+struct pvmp3_ops_sse41
+{
+    typedef v4si V;
+    enum { N = 4 };
+
+    static inline V load(const int32 *p)
+    {
+        return (V)_mm_loadu_si128((const __m128i *)p);
+    }
+    static inline void store(int32 *p, V a)
+    {
+        _mm_storeu_si128((__m128i *)p, (__m128i)a);
+    }
+    static inline V load_rev(const int32 *p)
+    {
+        return (V)_mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)p), 0x1B);
+    }
+    static inline void store_rev(int32 *p, V a)
+    {
+        _mm_storeu_si128((__m128i *)p, _mm_shuffle_epi32((__m128i)a, 0x1B));
+    }
+    static inline V set1(int32 a)
+    {
+        return (V)_mm_set1_epi32(a);
+    }
+    static inline V shl(V a, int32 n)
+    {
+        return (V)_mm_slli_epi32((__m128i)a, n);
+    }
+    static inline V sar(V a, int32 n)
+    {
+        return (V)_mm_srai_epi32((__m128i)a, n);
+    }
+    /* 64 bit products of the even and the odd lanes, bits n .. n + 31 of each */
+    static inline V mul(V a, V b, int32 n)
+    {
+        __m128i even = _mm_mul_epi32((__m128i)a, (__m128i)b);
+        __m128i odd  = _mm_mul_epi32(_mm_srli_epi64((__m128i)a, 32),
+                                     _mm_srli_epi64((__m128i)b, 32));
+
+        return (V)_mm_blend_epi16(_mm_srli_epi64(even, n),
+                                  _mm_slli_epi64(odd, 32 - n), 0xCC);
+    }
+    static inline void store_pcm(int16 *p, V a)
+    {
+        _mm_storel_epi64((__m128i *)p, _mm_packs_epi32((__m128i)a, (__m128i)a));
+    }
+    /* 4x4 transposes, the columns past the last multiple of 4 one by one */
+    static inline void transpose(__m128i &r0, __m128i &r1, __m128i &r2, __m128i &r3)
+    {
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+        r0 = _mm_unpacklo_epi64(t0, t1);
+        r1 = _mm_unpackhi_epi64(t0, t1);
+        r2 = _mm_unpacklo_epi64(t2, t3);
+        r3 = _mm_unpackhi_epi64(t2, t3);
+    }
+    static inline void load_lanes(V v[], const int32 *p, int32 stride, int32 count)
+    {
+        int32 k;
+
+        for (k = 0; k + 4 <= count; k += 4)
+        {
+            __m128i r0 = _mm_loadu_si128((const __m128i *)&p[k]);
+            __m128i r1 = _mm_loadu_si128((const __m128i *)&p[stride + k]);
+            __m128i r2 = _mm_loadu_si128((const __m128i *)&p[2*stride + k]);
+            __m128i r3 = _mm_loadu_si128((const __m128i *)&p[3*stride + k]);
+
+            transpose(r0, r1, r2, r3);
+            v[k    ] = (V)r0;
+            v[k + 1] = (V)r1;
+            v[k + 2] = (V)r2;
+            v[k + 3] = (V)r3;
+        }
+        for (; k < count; k++)
+        {
+            v[k] = (V)_mm_setr_epi32(p[k], p[stride + k], p[2*stride + k], p[3*stride + k]);
+        }
+    }
+    static inline void store_lanes(int32 *p, const V v[], int32 stride, int32 count)
+    {
+        int32 k;
+
+        for (k = 0; k + 4 <= count; k += 4)
+        {
+            __m128i r0 = (__m128i)v[k];
+            __m128i r1 = (__m128i)v[k + 1];
+            __m128i r2 = (__m128i)v[k + 2];
+            __m128i r3 = (__m128i)v[k + 3];
+
+            transpose(r0, r1, r2, r3);
+            _mm_storeu_si128((__m128i *)&p[k], r0);
+            _mm_storeu_si128((__m128i *)&p[stride + k], r1);
+            _mm_storeu_si128((__m128i *)&p[2*stride + k], r2);
+            _mm_storeu_si128((__m128i *)&p[3*stride + k], r3);
+        }
+        for (; k < count; k++)
+        {
+            p[k             ] = _mm_extract_epi32((__m128i)v[k], 0);
+            p[stride + k    ] = _mm_extract_epi32((__m128i)v[k], 1);
+            p[2*stride + k  ] = _mm_extract_epi32((__m128i)v[k], 2);
+            p[3*stride + k  ] = _mm_extract_epi32((__m128i)v[k], 3);
+        }
+    }
+};
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+static int32 windowTable[HAN_SIZE/2] __attribute__((aligned(16)));
+static pthread_once_t windowOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+static void init_window_table(void)
+{
+    build_window_lanes<pvmp3_ops_sse41>(windowTable);
+}
+
+
+void pvmp3_alias_reduction_SSE41(int32 *input_buffer,
+                                 granuleInfo *gr_info,
+                                 int32 *used_freq_lines,
+                                 mp3Header *info)
+{
+    alias_reduction_lanes<pvmp3_ops_sse41>(input_buffer, gr_info, used_freq_lines, info);
+}
+
+
+void pvmp3_imdct_synth_SSE41(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                             int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                             uint32 blk_type,
+                             int16 mx_band,
+                             int32 used_freq_lines,
+                             int32 *Scratch_mem)
+{
+    OSCL_UNUSED_ARG(Scratch_mem);
+
+    imdct_synth_lanes<pvmp3_ops_sse41>(in, overlap, blk_type, mx_band, used_freq_lines);
+}
+
+
+void pvmp3_poly_phase_synthesis_SSE41(tmp3dec_chan *pChVars,
+                                      int32 numChannels,
+                                      e_equalization equalizerType,
+                                      int16 *outPcm)
+{
+    pthread_once(&windowOnce, init_window_table);
+
+    poly_phase_synthesis_lanes<pvmp3_ops_sse41>(pChVars, numChannels, equalizerType,
+            outPcm, windowTable);
+}
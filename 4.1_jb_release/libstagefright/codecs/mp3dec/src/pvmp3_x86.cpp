@@ -0,0 +1,94 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_x86.cpp
+
+------------------------------------------------------------------------------
+ MODULE DESCRIPTION
+
+ CPU detection and selection of the x86 functions.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include <pthread.h>
+
+#include "pvmp3_x86.h"
+#include "pvmp3_alias_reduction.h"
+#include "pvmp3_imdct_synth.h"
+#include "pvmp3_poly_phase_synthesis.h"
+#include "x86_cpu.h"
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+tPVMP3X86Funcs pvmp3X86Funcs =
+{
+    pvmp3_alias_reduction,
+    pvmp3_imdct_synth,
+    pvmp3_poly_phase_synthesis
+};
+
+static pthread_once_t x86FuncsOnce = PTHREAD_ONCE_INIT;
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void pvmp3_GetX86Functions(tPVMP3X86Funcs *funcs)
+{
+    uint32 features = x86_cpu_get_features();
+
+    funcs->alias_reduction      = pvmp3_alias_reduction;
+    funcs->imdct_synth          = pvmp3_imdct_synth;
+    funcs->poly_phase_synthesis = pvmp3_poly_phase_synthesis;
+
+    if (features & X86_CPU_SSE4_1)
+    {
+        funcs->alias_reduction      = pvmp3_alias_reduction_SSE41;
+        funcs->imdct_synth          = pvmp3_imdct_synth_SSE41;
+        funcs->poly_phase_synthesis = pvmp3_poly_phase_synthesis_SSE41;
+    }
+
+    if (features & X86_CPU_AVX2)
+    {
+        funcs->alias_reduction      = pvmp3_alias_reduction_AVX2;
+        funcs->imdct_synth          = pvmp3_imdct_synth_AVX2;
+        funcs->poly_phase_synthesis = pvmp3_poly_phase_synthesis_AVX2;
+    }
+}
+
+
+static void set_x86_functions(void)
+{
+    pvmp3_GetX86Functions(&pvmp3X86Funcs);
+}
+
+
+void pvmp3_InitX86Functions(void)
+{
+    pthread_once(&x86FuncsOnce, set_x86_functions);
+}
@@ -0,0 +1,140 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_x86.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ SSE4.1 and AVX2 versions of the alias reduction, the IMDCT and the
+ polyphase synthesis, picked at run time. They give the same output as the
+ C code.
+
+------------------------------------------------------------------------------
+*/
+/*----------------------------------------------------------------------------
+; CONTINUE ONLY IF NOT ALREADY DEFINED
+----------------------------------------------------------------------------*/
+
+#ifndef PVMP3_X86_H
+#define PVMP3_X86_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_audio_type_defs.h"
+#include "pvmp3_dec_defs.h"
+#include "s_tmp3dec_chan.h"
+#include "pvmp3decoder_api.h"
+
+/*----------------------------------------------------------------------------
+; STRUCTURES TYPEDEF'S
+----------------------------------------------------------------------------*/
+#ifdef MP3DEC_X86
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        void (*alias_reduction)(int32 *input_buffer,
+                                granuleInfo *gr_info,
+                                int32 *used_freq_lines,
+                                mp3Header *info);
+
+        void (*imdct_synth)(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                            int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                            uint32 blk_type,
+                            int16 mx_band,
+                            int32 used_freq_lines,
+                            int32 *Scratch_mem);
+
+        void (*poly_phase_synthesis)(tmp3dec_chan *pChVars,
+                                     int32 numChannels,
+                                     e_equalization equalizerType,
+                                     int16 *outPcm);
+    } tPVMP3X86Funcs;
+
+    /* the functions in use, the C versions until pvmp3_InitX86Functions() */
+    extern tPVMP3X86Funcs pvmp3X86Funcs;
+
+    /*
+     * Fill funcs with the SSE4.1 or AVX2 functions the CPU supports, as
+     * reported by x86_cpu_get_features().
+     */
+    void pvmp3_GetX86Functions(tPVMP3X86Funcs *funcs);
+
+    /* sets pvmp3X86Funcs on the first call, from pvmp3_InitDecoder() */
+    void pvmp3_InitX86Functions(void);
+
+    /* pvmp3_sse41.cpp, in libstagefright_mp3dec_sse41 */
+    void pvmp3_alias_reduction_SSE41(int32 *input_buffer,
+                                     granuleInfo *gr_info,
+                                     int32 *used_freq_lines,
+                                     mp3Header *info);
+    void pvmp3_imdct_synth_SSE41(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                                 int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                                 uint32 blk_type,
+                                 int16 mx_band,
+                                 int32 used_freq_lines,
+                                 int32 *Scratch_mem);
+    void pvmp3_poly_phase_synthesis_SSE41(tmp3dec_chan *pChVars,
+                                          int32 numChannels,
+                                          e_equalization equalizerType,
+                                          int16 *outPcm);
+
+    /* pvmp3_avx2.cpp, in libstagefright_mp3dec_avx2 */
+    void pvmp3_alias_reduction_AVX2(int32 *input_buffer,
+                                    granuleInfo *gr_info,
+                                    int32 *used_freq_lines,
+                                    mp3Header *info);
+    void pvmp3_imdct_synth_AVX2(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                                int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                                uint32 blk_type,
+                                int16 mx_band,
+                                int32 used_freq_lines,
+                                int32 *Scratch_mem);
+    void pvmp3_poly_phase_synthesis_AVX2(tmp3dec_chan *pChVars,
+                                         int32 numChannels,
+                                         e_equalization equalizerType,
+                                         int16 *outPcm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define X86_FUNC(name)  (*pvmp3X86Funcs.name)
+
+#else
+
+#define X86_FUNC(name)  pvmp3_##name
+
+#endif
+
+/*----------------------------------------------------------------------------
+; END
+----------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,1089 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_x86_lanes.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ The IMDCT, DCT-32, synthesis window and alias reduction written once for
+ pvmp3_sse41.cpp and pvmp3_avx2.cpp. Each lane of a vector runs the exact
+ operations of the C code on its own subband or time slot, so the output is
+ the same bit for bit.
+
+ The including file provides a class O with
+
+    V                    a vector of O::N int32 lanes with + - ^ and unary -
+    load, store          N consecutive int32
+    load_rev, store_rev  N consecutive int32, last one in lane 0
+    set1                 a constant in every lane
+    shl, sar             shift every lane
+    mul                  (int32)(((int64)a * b) >> n) in every lane
+    store_pcm            saturate16() of every lane, to N int16
+    load_lanes           v[k] lane l = p[l*stride + k], k < count
+    store_lanes          the reverse
+
+ pvmp3_ops_c below is the same thing for one lane; it handles the subbands
+ and slots left over when they do not fill a vector.
+
+------------------------------------------------------------------------------
+*/
+/*----------------------------------------------------------------------------
+; CONTINUE ONLY IF NOT ALREADY DEFINED
+----------------------------------------------------------------------------*/
+
+#ifndef PVMP3_X86_LANES_H
+#define PVMP3_X86_LANES_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_audio_type_defs.h"
+#include "pv_mp3dec_fxd_op.h"
+#include "pvmp3_dec_defs.h"
+#include "pvmp3_tables.h"
+#include "pvmp3_mdct_18.h"
+#include "pvmp3_mdct_6.h"
+#include "pvmp3_dct_16.h"
+#include "pvmp3_imdct_synth.h"
+#include "pvmp3_alias_reduction.h"
+#include "pvmp3_equalizer.h"
+#include "pvmp3_polyphase_filter_window.h"
+#include "s_tmp3dec_chan.h"
+#include "mp3_mem_funcs.h"
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+
+/* as in pvmp3_dct_9.cpp */
+#define Qfmt31(a)   (int32)(a*(0x7FFFFFFF))
+
+#define cos_pi_9    Qfmt31( 0.93969262078591f)
+#define cos_2pi_9   Qfmt31( 0.76604444311898f)
+#define cos_4pi_9   Qfmt31( 0.17364817766693f)
+#define cos_5pi_9   Qfmt31(-0.17364817766693f)
+#define cos_7pi_9   Qfmt31(-0.76604444311898f)
+#define cos_8pi_9   Qfmt31(-0.93969262078591f)
+#define cos_pi_6    Qfmt31( 0.86602540378444f)
+#define cos_5pi_6   Qfmt31(-0.86602540378444f)
+#define cos_5pi_18  Qfmt31( 0.64278760968654f)
+#define cos_7pi_18  Qfmt31( 0.34202014332567f)
+#define cos_11pi_18 Qfmt31(-0.34202014332567f)
+#define cos_13pi_18 Qfmt31(-0.64278760968654f)
+#define cos_17pi_18 Qfmt31(-0.98480775301221f)
+
+/* as in pvmp3_dct_6.cpp */
+#define Qfmt30(a)   (Int32)(a*((Int32)1<<30) + (a>=0?0.5F:-0.5F))
+
+#define cos_pi_6_q30 Qfmt30(  0.86602540378444f)
+#define cos_7_pi_12  Qfmt30( -0.25881904510252f)
+#define cos_3_pi_12  Qfmt30(  0.70710678118655f)
+#define cos_11_pi_12 Qfmt30( -0.96592582628907f)
+
+/* largest number of lanes, for the transposition buffers */
+#define PVMP3_MAX_LANES     8
+
+/*----------------------------------------------------------------------------
+; SIMPLE TYPEDEF'S
+----------------------------------------------------------------------------*/
+
+struct pvmp3_ops_c
+{
+    typedef int32 V;
+    enum { N = 1 };
+
+    static inline V load(const int32 *p)
+    {
+        return *p;
+    }
+    static inline void store(int32 *p, V a)
+    {
+        *p = a;
+    }
+    static inline V load_rev(const int32 *p)
+    {
+        return *p;
+    }
+    static inline void store_rev(int32 *p, V a)
+    {
+        *p = a;
+    }
+    static inline V set1(int32 a)
+    {
+        return a;
+    }
+    static inline V shl(V a, int32 n)
+    {
+        return a << n;
+    }
+    static inline V sar(V a, int32 n)
+    {
+        return a >> n;
+    }
+    static inline V mul(V a, V b, int32 n)
+    {
+        return (int32)(((int64)(a) * b) >> n);
+    }
+    static inline void store_pcm(int16 *p, V a)
+    {
+        *p = saturate16(a);
+    }
+    static inline void load_lanes(V v[], const int32 *p, int32 stride, int32 count)
+    {
+        OSCL_UNUSED_ARG(stride);
+
+        for (int32 k = 0; k < count; k++)
+        {
+            v[k] = p[k];
+        }
+    }
+    static inline void store_lanes(int32 *p, const V v[], int32 stride, int32 count)
+    {
+        OSCL_UNUSED_ARG(stride);
+
+        for (int32 k = 0; k < count; k++)
+        {
+            p[k] = v[k];
+        }
+    }
+};
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+/* a * c >> n, c the same in all lanes */
+template <class O>
+static inline typename O::V mul_q(typename O::V a, int32 c, int32 n)
+{
+    return O::mul(a, O::set1(c), n);
+}
+
+/*
+ *  pvmp3_dct_9()
+ */
+template <class O>
+static void dct_9_lanes(typename O::V vec[])
+{
+    typedef typename O::V V;
+
+    V tmp0 =  vec[8] + vec[0];
+    V tmp8 =  vec[8] - vec[0];
+    V tmp1 =  vec[7] + vec[1];
+    V tmp7 =  vec[7] - vec[1];
+    V tmp2 =  vec[6] + vec[2];
+    V tmp6 =  vec[6] - vec[2];
+    V tmp3 =  vec[5] + vec[3];
+    V tmp5 =  vec[5] - vec[3];
+
+    vec[0]  = (tmp0 + tmp2 + tmp3)     + (tmp1 + vec[4]);
+    vec[6]  = O::sar(tmp0 + tmp2 + tmp3, 1) - (tmp1 + vec[4]);
+    vec[2]  = O::sar(tmp1, 1) - vec[4];
+    vec[4]  =  -vec[2];
+    vec[8]  =  -vec[2];
+    vec[4]  = vec[4] + mul_q<O>(O::shl(tmp0, 1), cos_2pi_9, 32);
+    vec[8]  = vec[8] + mul_q<O>(O::shl(tmp0, 1), cos_4pi_9, 32);
+    vec[2]  = vec[2] + mul_q<O>(O::shl(tmp0, 1), cos_pi_9, 32);
+    vec[2]  = vec[2] + mul_q<O>(O::shl(tmp2, 1), cos_5pi_9, 32);
+    vec[4]  = vec[4] + mul_q<O>(O::shl(tmp2, 1), cos_8pi_9, 32);
+    vec[8]  = vec[8] + mul_q<O>(O::shl(tmp2, 1), cos_2pi_9, 32);
+    vec[8]  = vec[8] + mul_q<O>(O::shl(tmp3, 1), cos_8pi_9, 32);
+    vec[4]  = vec[4] + mul_q<O>(O::shl(tmp3, 1), cos_4pi_9, 32);
+    vec[2]  = vec[2] + mul_q<O>(O::shl(tmp3, 1), cos_7pi_9, 32);
+
+    vec[1]  = mul_q<O>(O::shl(tmp5, 1), cos_11pi_18, 32);
+    vec[1]  = vec[1] + mul_q<O>(O::shl(tmp6, 1), cos_13pi_18, 32);
+    vec[1]  = vec[1] + mul_q<O>(O::shl(tmp7, 1), cos_5pi_6, 32);
+    vec[1]  = vec[1] + mul_q<O>(O::shl(tmp8, 1), cos_17pi_18, 32);
+    vec[3]  = mul_q<O>(O::shl(tmp5 + tmp6  - tmp8, 1), cos_pi_6, 32);
+    vec[5]  = mul_q<O>(O::shl(tmp5, 1), cos_17pi_18, 32);
+    vec[5]  = vec[5] + mul_q<O>(O::shl(tmp6, 1), cos_7pi_18, 32);
+    vec[5]  = vec[5] + mul_q<O>(O::shl(tmp7, 1), cos_pi_6, 32);
+    vec[5]  = vec[5] + mul_q<O>(O::shl(tmp8, 1), cos_13pi_18, 32);
+    vec[7]  = mul_q<O>(O::shl(tmp5, 1), cos_5pi_18, 32);
+    vec[7]  = vec[7] + mul_q<O>(O::shl(tmp6, 1), cos_17pi_18, 32);
+    vec[7]  = vec[7] + mul_q<O>(O::shl(tmp7, 1), cos_pi_6, 32);
+    vec[7]  = vec[7] + mul_q<O>(O::shl(tmp8, 1), cos_11pi_18, 32);
+}
+
+/*
+ *  pvmp3_mdct_18()
+ */
+template <class O>
+static void mdct_18_lanes(typename O::V vec[], typename O::V history[], const int32 *window)
+{
+    typedef typename O::V V;
+    int32 i;
+    V tmp;
+    V tmp1;
+    V tmp2;
+    V tmp3;
+    V tmp4;
+
+    for (i = 0; i < 9; i++)
+    {
+        tmp  = mul_q<O>(O::shl(vec[i], 1), cosTerms_1_ov_cos_phi[i], 32);
+        tmp1 = mul_q<O>(vec[17 - i], cosTerms_1_ov_cos_phi[17 - i], 27);
+        vec[i]      = tmp + tmp1;
+        vec[17 - i] = mul_q<O>(tmp - tmp1, cosTerms_dct18[i], 28);
+    }
+
+    dct_9_lanes<O>(vec);         // Even terms
+    dct_9_lanes<O>(&vec[9]);     // Odd  terms
+
+    tmp3     = vec[16];
+    vec[16]  = vec[ 8];
+    tmp4     = vec[14];
+    vec[14]  = vec[ 7];
+    tmp      = vec[12];
+    vec[12]  = vec[ 6];
+    tmp2     = vec[10];
+    vec[10]  = vec[ 5];
+    vec[ 8]  = vec[ 4];
+    vec[ 6]  = vec[ 3];
+    vec[ 4]  = vec[ 2];
+    vec[ 2]  = vec[ 1];
+    vec[ 1]  = vec[ 9] - tmp2;
+    vec[ 3]  = vec[11] - tmp2;
+    vec[ 5]  = vec[11] - tmp;
+    vec[ 7]  = vec[13] - tmp;
+    vec[ 9]  = vec[13] - tmp4;
+    vec[11]  = vec[15] - tmp4;
+    vec[13]  = vec[15] - tmp3;
+    vec[15]  = vec[17] - tmp3;
+
+    /* overlap and add */
+
+    tmp2 = vec[0];
+    tmp3 = vec[9];
+
+    for (i = 0; i < 6; i++)
+    {
+        tmp  = history[ i];
+        tmp4 = vec[i+10];
+        vec[i+10] = tmp3 + tmp4;
+        tmp1 = vec[i+1];
+        vec[ i] = tmp + mul_q<O>(vec[i+10], window[ i], 32);
+        tmp3 = tmp4;
+        history[i  ] = -(tmp2 + tmp1);
+        tmp2 = tmp1;
+    }
+
+    tmp  = history[ 6];
+    tmp4 = vec[16];
+    vec[16] = tmp3 + tmp4;
+    tmp1 = vec[7];
+    vec[ 6] = tmp + mul_q<O>(O::shl(vec[16], 1), window[ 6], 32);
+    tmp  = history[ 7];
+    history[6] = -(tmp2 + tmp1);
+    history[7] = -(tmp1 + vec[8]);
+
+    tmp1  = history[ 8];
+    tmp4    = vec[17] + tmp4;
+    vec[ 7] = tmp + mul_q<O>(O::shl(tmp4, 1), window[ 7], 32);
+    history[8] = -(vec[8] + vec[9]);
+    vec[ 8] = tmp1 + mul_q<O>(O::shl(vec[17], 1), window[ 8], 32);
+
+    tmp  = history[9];
+    tmp1 = history[17];
+    tmp2 = history[16];
+    vec[ 9] = tmp  + mul_q<O>(O::shl(vec[17], 1), window[ 9], 32);
+
+    vec[17] = tmp1 + mul_q<O>(O::shl(vec[10], 1), window[17], 32);
+    vec[10] = -vec[ 16];
+    vec[16] = tmp2 + mul_q<O>(O::shl(vec[11], 1), window[16], 32);
+    tmp1 = history[15];
+    tmp2 = history[14];
+    vec[11] = -vec[ 15];
+    vec[15] = tmp1 + mul_q<O>(O::shl(vec[12], 1), window[15], 32);
+    vec[12] = -vec[ 14];
+    vec[14] = tmp2 + mul_q<O>(O::shl(vec[13], 1), window[14], 32);
+
+    tmp  = history[13];
+    tmp1 = history[12];
+    tmp2 = history[11];
+    tmp3 = history[10];
+    vec[13] = tmp  + mul_q<O>(O::shl(vec[12], 1), window[13], 32);
+    vec[12] = tmp1 + mul_q<O>(O::shl(vec[11], 1), window[12], 32);
+    vec[11] = tmp2 + mul_q<O>(O::shl(vec[10], 1), window[11], 32);
+    vec[10] = tmp3 + mul_q<O>(O::shl(tmp4, 1), window[10], 32);
+
+    /* next iteration overlap */
+
+    tmp1 = O::shl(history[ 8], 1);
+    tmp3 = O::shl(history[ 7], 1);
+    tmp2 = O::shl(history[ 1], 1);
+    tmp  = O::shl(history[ 0], 1);
+
+    history[ 0] = mul_q<O>(tmp1, window[18], 32);
+    history[17] = mul_q<O>(tmp1, window[35], 32);
+    history[ 1] = mul_q<O>(tmp3, window[19], 32);
+    history[16] = mul_q<O>(tmp3, window[34], 32);
+
+    history[ 7] = mul_q<O>(tmp2, window[25], 32);
+    history[10] = mul_q<O>(tmp2, window[28], 32);
+    history[ 8] = mul_q<O>(tmp,  window[26], 32);
+    history[ 9] = mul_q<O>(tmp,  window[27], 32);
+
+    tmp1 = O::shl(history[ 6], 1);
+    tmp3 = O::shl(history[ 5], 1);
+    tmp4 = O::shl(history[ 4], 1);
+    tmp2 = O::shl(history[ 3], 1);
+    tmp  = O::shl(history[ 2], 1);
+
+    history[ 2] = mul_q<O>(tmp1, window[20], 32);
+    history[15] = mul_q<O>(tmp1, window[33], 32);
+    history[ 3] = mul_q<O>(tmp3, window[21], 32);
+    history[14] = mul_q<O>(tmp3, window[32], 32);
+    history[ 4] = mul_q<O>(tmp4, window[22], 32);
+    history[13] = mul_q<O>(tmp4, window[31], 32);
+    history[ 5] = mul_q<O>(tmp2, window[23], 32);
+    history[12] = mul_q<O>(tmp2, window[30], 32);
+    history[ 6] = mul_q<O>(tmp,  window[24], 32);
+    history[11] = mul_q<O>(tmp,  window[29], 32);
+}
+
+/*
+ *  pvmp3_dct_6()
+ */
+template <class O>
+static void dct_6_lanes(typename O::V vec[])
+{
+    typedef typename O::V V;
+
+    V tmp0 =  vec[5] + vec[0];
+    V tmp5 =  vec[5] - vec[0];
+    V tmp1 =  vec[4] + vec[1];
+    V tmp4 =  vec[4] - vec[1];
+    V tmp2 =  vec[3] + vec[2];
+    V tmp3 =  vec[3] - vec[2];
+
+    vec[0]  = tmp0 + tmp2 ;
+    vec[2]  = mul_q<O>(tmp0 - tmp2, cos_pi_6_q30, 30);
+    vec[4]  = O::sar(vec[0], 1) - tmp1;
+    vec[0]  = vec[0] + tmp1;
+
+    tmp0    = mul_q<O>(tmp3, cos_7_pi_12, 30);
+    tmp0    = tmp0 + mul_q<O>(tmp4, -cos_3_pi_12, 30);
+    vec[1]  = tmp0 + mul_q<O>(tmp5, cos_11_pi_12, 30);
+
+    vec[3]  = mul_q<O>(tmp3 + tmp4  - tmp5, cos_3_pi_12, 30);
+    tmp0    = mul_q<O>(tmp3, cos_11_pi_12, 30);
+    tmp0    = tmp0 + mul_q<O>(tmp4, cos_3_pi_12, 30);
+    vec[5]  = tmp0 + mul_q<O>(tmp5, cos_7_pi_12, 30);
+}
+
+/*
+ *  pvmp3_mdct_6()
+ */
+template <class O>
+static void mdct_6_lanes(typename O::V vec[], typename O::V history[])
+{
+    typedef typename O::V V;
+    int32 i;
+    V tmp;
+
+    for (i = 0; i < 6; i++)
+    {
+        vec[i] = mul_q<O>(vec[i], cosTerms_1_ov_cos_phi_N6[i], 29);
+    }
+
+    dct_6_lanes<O>(vec);    // Even terms
+
+    tmp = -(vec[0] + vec[1]);
+    history[3] = tmp;
+    history[2] = tmp;
+    tmp = -(vec[1] + vec[2]);
+    vec[0] =  vec[3] + vec[4];
+    vec[1] =  vec[4] + vec[5];
+    history[4] = tmp;
+    history[1] = tmp;
+    tmp = -(vec[2] + vec[3]);
+    vec[4] = -vec[1];
+    history[5] = tmp;
+    history[0] = tmp;
+
+    vec[2] =  vec[5];
+    vec[3] = -vec[5];
+    vec[5] = -vec[0];
+}
+
+/*
+ *  The SHORT case of pvmp3_imdct_synth()
+ */
+template <class O>
+static void imdct_short_lanes(typename O::V out[], typename O::V history[])
+{
+    typedef typename O::V V;
+    V scratch[18];
+    V prev_ovr[18];
+    int32 i;
+
+    for (i = 0; i < 6; i++)
+    {
+        scratch[i    ] = out[(i*3)];
+        scratch[6  +i] = out[(i*3) + 1];
+        scratch[12 +i] = out[(i*3) + 2];
+    }
+
+    mdct_6_lanes<O>(&scratch[ 0], &prev_ovr[ 0]);
+    mdct_6_lanes<O>(&scratch[ 6], &prev_ovr[ 6]);
+    mdct_6_lanes<O>(&scratch[12], &prev_ovr[12]);
+
+    for (i = 0; i < 6; i++)
+    {
+        V temp  =  history[i];
+        /* next iteration overlap */
+        history[i]  =  mul_q<O>(O::shl(prev_ovr[ 6+i], 1), short_win[6+i], 32);
+        history[i]  =  history[i] + mul_q<O>(O::shl(scratch[12+i], 1), short_win[  i], 32);
+        out[i]  =  temp;
+    }
+
+    for (i = 0; i < 6; i++)
+    {
+        out[i+6]   =  mul_q<O>(O::shl(scratch[i], 1), short_win[i], 32);
+        out[i+6]   =  out[i+6] + history[i+6];
+        /* next iteration overlap */
+        history[i+6]  =  mul_q<O>(O::shl(prev_ovr[12+i], 1), short_win[6+i], 32);
+    }
+
+    for (i = 0; i < 6; i++)
+    {
+        out[i+12]  =  mul_q<O>(O::shl(prev_ovr[  i], 1), short_win[6+i], 32);
+        out[i+12]  =  out[i+12] + mul_q<O>(O::shl(scratch[6+i], 1), short_win[  i], 32);
+        out[i+12]  =  out[i+12] + history[i+12];
+        history[12+i]  =  O::set1(0);
+    }
+}
+
+/*
+ *  O::N subbands from band on, all with blocks of type blk_type
+ */
+template <class O>
+static void imdct_bands_lanes(int32 in[], int32 overlap[], int32 band, uint32 blk_type)
+{
+    typedef typename O::V V;
+    V out[FILTERBANK_BANDS];
+    V history[FILTERBANK_BANDS];
+    int32 sign[PVMP3_MAX_LANES];
+    int32 l, slot;
+    V odd;
+
+    O::load_lanes(out, &in[band*FILTERBANK_BANDS], FILTERBANK_BANDS, FILTERBANK_BANDS);
+    O::load_lanes(history, &overlap[band*FILTERBANK_BANDS], FILTERBANK_BANDS, FILTERBANK_BANDS);
+
+    switch (blk_type)
+    {
+        case LONG:
+
+            mdct_18_lanes<O>(out, history, normal_win);
+
+            break;
+
+        case START:
+
+            mdct_18_lanes<O>(out, history, start_win);
+
+            break;
+
+        case STOP:
+
+            mdct_18_lanes<O>(out, history, stop_win);
+
+            break;
+
+        case SHORT:
+
+            imdct_short_lanes<O>(out, history);
+
+            break;
+    }
+
+    /*
+     *     Compensation for frequency inversion of polyphase filterbank,
+     *     odd time samples of odd subbands are negated: (x ^ -1) - -1
+     */
+
+    for (l = 0; l < O::N; l++)
+    {
+        sign[l] = -((band + l) & 1);
+    }
+    odd = O::load(sign);
+
+    for (slot = 1; slot < FILTERBANK_BANDS; slot += 2)
+    {
+        out[slot] = (out[slot] ^ odd) - odd;
+    }
+
+    O::store_lanes(&in[band*FILTERBANK_BANDS], out, FILTERBANK_BANDS, FILTERBANK_BANDS);
+    O::store_lanes(&overlap[band*FILTERBANK_BANDS], history, FILTERBANK_BANDS, FILTERBANK_BANDS);
+}
+
+/*
+ *  pvmp3_imdct_synth(), O::N subbands at a time where they share a block
+ *  type, one at a time elsewhere
+ */
+template <class O>
+static void imdct_synth_lanes(int32 in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                              int32 overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
+                              uint32 blk_type,
+                              int16 mx_band,
+                              int32 used_freq_lines)
+{
+    int32 band;
+    int32 bands2process = used_freq_lines + 2;
+
+    if (bands2process > SUBBANDS_NUMBER)
+    {
+        bands2process = SUBBANDS_NUMBER;  /* default */
+    }
+
+    band = 0;
+    while (band < bands2process)
+    {
+        uint32 current_blk_type = (band < mx_band) ? LONG : blk_type;
+
+        if (band + O::N <= bands2process &&
+                (band >= mx_band || band + O::N <= mx_band))
+        {
+            imdct_bands_lanes<O>(in, overlap, band, current_blk_type);
+            band += O::N;
+        }
+        else
+        {
+            imdct_bands_lanes<pvmp3_ops_c>(in, overlap, band, current_blk_type);
+            band++;
+        }
+    }
+
+    for (band = bands2process; band < SUBBANDS_NUMBER; band++)
+    {
+        int32 * out     = in      + (band * FILTERBANK_BANDS);
+        int32 * history = overlap + (band * FILTERBANK_BANDS);
+        int32 slot;
+
+        if (band & 1)
+        {
+            for (slot = 0; slot < FILTERBANK_BANDS; slot += 2)
+            {
+                out[slot  ] =  history[slot  ];
+                out[slot+1] = -history[slot+1];
+            }
+        }
+        else
+        {
+            for (slot = 0; slot < FILTERBANK_BANDS; slot++)
+            {
+                out[slot] = history[slot];
+            }
+        }
+
+        pv_memset(history, 0, FILTERBANK_BANDS*sizeof(*overlap));
+    }
+}
+
+/*
+ *  pvmp3_split(), on vec[16..31]
+ */
+template <class O>
+static void split_lanes(typename O::V vec[])
+{
+    typedef typename O::V V;
+    int32 k;
+
+    for (k = 0; k < 16; k++)
+    {
+        V tmp2 = vec[16 + k];
+        V tmp1 = vec[15 - k];
+        int32 cosx = CosTable_dct32[15 - k];
+
+        vec[15 - k] = tmp1 + tmp2;
+        if (k < 6)
+        {
+            vec[16 + k] = mul_q<O>(tmp1 - tmp2, cosx, 27);
+        }
+        else
+        {
+            vec[16 + k] = mul_q<O>(O::shl(tmp1 - tmp2, 1), cosx, 32);
+        }
+    }
+}
+
+/*
+ *  pvmp3_dct_16()
+ */
+template <class O>
+static void dct_16_lanes(typename O::V vec[], int32 flag)
+{
+    typedef typename O::V V;
+    V tmp0;
+    V tmp1;
+    V tmp2;
+    V tmp3;
+    V tmp4;
+    V tmp5;
+    V tmp6;
+    V tmp7;
+    V tmp_o0;
+    V tmp_o1;
+    V tmp_o2;
+    V tmp_o3;
+    V tmp_o4;
+    V tmp_o5;
+    V tmp_o6;
+    V tmp_o7;
+    V itmp_e0;
+    V itmp_e1;
+    V itmp_e2;
+
+    /*  split input vector */
+
+    tmp_o0 = mul_q<O>((vec[ 0] - vec[15]), Qfmt_31(0.50241928618816F), 32);
+    tmp0   =  vec[ 0] + vec[15];
+
+    tmp_o7 = mul_q<O>(O::shl(vec[ 7] - vec[ 8], 3), Qfmt_31(0.63764357733614F), 32);
+    tmp7   =  vec[ 7] + vec[ 8];
+
+    itmp_e0    = mul_q<O>((tmp0 - tmp7), Qfmt_31(0.50979557910416F), 32);
+    tmp7 = (tmp0 + tmp7);
+
+    tmp_o1 = mul_q<O>((vec[ 1] - vec[14]), Qfmt_31(0.52249861493969F), 32);
+    tmp1   =  vec[ 1] + vec[14];
+
+    tmp_o6 = mul_q<O>(O::shl(vec[ 6] - vec[ 9], 1), Qfmt_31(0.86122354911916F), 32);
+    tmp6   =  vec[ 6] + vec[ 9];
+
+    itmp_e1 = (tmp1 + tmp6);
+    tmp6    = mul_q<O>((tmp1 - tmp6), Qfmt_31(0.60134488693505F), 32);
+
+    tmp_o2 = mul_q<O>((vec[ 2] - vec[13]), Qfmt_31(0.56694403481636F), 32);
+    tmp2   =  vec[ 2] + vec[13];
+    tmp_o5 = mul_q<O>(O::shl(vec[ 5] - vec[10], 1), Qfmt_31(0.53033884299517F), 32);
+    tmp5   =  vec[ 5] + vec[10];
+
+    itmp_e2 = (tmp2 + tmp5);
+    tmp5    = mul_q<O>((tmp2 - tmp5), Qfmt_31(0.89997622313642F), 32);
+
+    tmp_o3 = mul_q<O>((vec[ 3] - vec[12]), Qfmt_31(0.64682178335999F), 32);
+    tmp3   =  vec[ 3] + vec[12];
+    tmp_o4 = mul_q<O>((vec[ 4] - vec[11]), Qfmt_31(0.78815462345125F), 32);
+    tmp4   =  vec[ 4] + vec[11];
+
+    tmp1   = (tmp3 + tmp4);
+    tmp4   =  mul_q<O>(O::shl(tmp3 - tmp4, 2), Qfmt_31(0.64072886193538F), 32);
+
+    /*  split even part of tmp_e */
+
+    tmp0 = (tmp7 + tmp1);
+    tmp1 = mul_q<O>((tmp7 - tmp1), Qfmt_31(0.54119610014620F), 32);
+
+    tmp3 = mul_q<O>(O::shl(itmp_e1 - itmp_e2, 1), Qfmt_31(0.65328148243819F), 32);
+    tmp7 = (itmp_e1 + itmp_e2);
+
+    vec[ 0]  = O::sar(tmp0 + tmp7, 1);
+    vec[ 8]  = mul_q<O>((tmp0 - tmp7), Qfmt_31(0.70710678118655F), 32);
+    tmp0     = mul_q<O>(O::shl(tmp1 - tmp3, 1), Qfmt_31(0.70710678118655F), 32);
+    vec[ 4]  =  tmp1 + tmp3 + tmp0;
+    vec[12]  =  tmp0;
+
+    /*  split odd part of tmp_e */
+
+    tmp1 = mul_q<O>(O::shl(itmp_e0 - tmp4, 1), Qfmt_31(0.54119610014620F), 32);
+    tmp7 = itmp_e0 + tmp4;
+
+    tmp3  = mul_q<O>(O::shl(tmp6 - tmp5, 2), Qfmt_31(0.65328148243819F), 32);
+    tmp6  = tmp6 + tmp5;
+
+    tmp4  = mul_q<O>(O::shl(tmp7 - tmp6, 1), Qfmt_31(0.70710678118655F), 32);
+    tmp6  = tmp6 + tmp7;
+    tmp7  = mul_q<O>(O::shl(tmp1 - tmp3, 1), Qfmt_31(0.70710678118655F), 32);
+
+    tmp1     =  tmp1 + tmp3 + tmp7;
+    vec[ 2]  =  tmp1 + tmp6;
+    vec[ 6]  =  tmp1 + tmp4;
+    vec[10]  =  tmp7 + tmp4;
+    vec[14]  =  tmp7;
+
+
+    // dct8;
+
+    tmp1 = mul_q<O>(O::shl(tmp_o0 - tmp_o7, 1), Qfmt_31(0.50979557910416F), 32);
+    tmp7 = tmp_o0 + tmp_o7;
+
+    tmp6   = tmp_o1 + tmp_o6;
+    tmp_o1 = mul_q<O>(O::shl(tmp_o1 - tmp_o6, 1), Qfmt_31(0.60134488693505F), 32);
+
+    tmp5   = tmp_o2 + tmp_o5;
+    tmp_o5 = mul_q<O>(O::shl(tmp_o2 - tmp_o5, 1), Qfmt_31(0.89997622313642F), 32);
+
+    tmp0 = mul_q<O>(O::shl(tmp_o3 - tmp_o4, 3), Qfmt_31(0.6407288619354F), 32);
+    tmp4 = tmp_o3 + tmp_o4;
+
+    if (!flag)
+    {
+        tmp7   = -tmp7;
+        tmp1   = -tmp1;
+        tmp6   = -tmp6;
+        tmp_o1 = -tmp_o1;
+        tmp5   = -tmp5;
+        tmp_o5 = -tmp_o5;
+        tmp4   = -tmp4;
+        tmp0   = -tmp0;
+    }
+
+    tmp2     =  mul_q<O>(O::shl(tmp1 -   tmp0, 1), Qfmt_31(0.54119610014620F), 32);
+    tmp0     =  tmp0 + tmp1;
+    tmp1     =  mul_q<O>(O::shl(tmp7 -   tmp4, 1), Qfmt_31(0.54119610014620F), 32);
+    tmp7     =  tmp7 + tmp4;
+    tmp4     =  mul_q<O>(O::shl(tmp6 -   tmp5, 2), Qfmt_31(0.65328148243819F), 32);
+    tmp6     =  tmp6 + tmp5;
+    tmp5     =  mul_q<O>(O::shl(tmp_o1 - tmp_o5, 2), Qfmt_31(0.65328148243819F), 32);
+    tmp_o1   =  tmp_o1 + tmp_o5;
+
+    vec[13]  =  mul_q<O>(O::shl(tmp1 -   tmp4, 1), Qfmt_31(0.70710678118655F), 32);
+    vec[ 5]  =  tmp1 + tmp4 + vec[13];
+
+    vec[ 9]  =  mul_q<O>(O::shl(tmp7 -   tmp6, 1), Qfmt_31(0.70710678118655F), 32);
+    vec[ 1]  =  tmp7 + tmp6;
+
+    tmp4     =  mul_q<O>(O::shl(tmp0 - tmp_o1, 1), Qfmt_31(0.70710678118655F), 32);
+    tmp0     =  tmp0 + tmp_o1;
+    tmp6     =  mul_q<O>(O::shl(tmp2 -   tmp5, 1), Qfmt_31(0.70710678118655F), 32);
+    tmp2     =  tmp2 + tmp5 + tmp6;
+    tmp0     =  tmp0 + tmp2;
+
+    vec[ 1]  = vec[ 1] + tmp0;
+    vec[ 3]  = tmp0 + vec[ 5];
+    tmp2     = tmp2 + tmp4;
+    vec[ 5]  = tmp2 + vec[ 5];
+    vec[ 7]  = tmp2 + vec[ 9];
+    tmp4     = tmp4 + tmp6;
+    vec[ 9]  = tmp4 + vec[ 9];
+    vec[11]  = tmp4 + vec[13];
+    vec[13]  = tmp6 + vec[13];
+    vec[15]  = tmp6;
+}
+
+/*
+ *  pvmp3_merge_in_place_N32()
+ */
+template <class O>
+static void merge_in_place_N32_lanes(typename O::V vec[])
+{
+    typedef typename O::V V;
+    V temp0;
+    V temp1;
+    V temp2;
+    V temp3;
+
+    temp0   = vec[14];
+    vec[14] = vec[ 7];
+    temp1   = vec[12];
+    vec[12] = vec[ 6];
+    temp2   = vec[10];
+    vec[10] = vec[ 5];
+    temp3   = vec[ 8];
+    vec[ 8] = vec[ 4];
+    vec[ 6] = vec[ 3];
+    vec[ 4] = vec[ 2];
+    vec[ 2] = vec[ 1];
+
+    vec[ 1] = (vec[16] + vec[17]);
+    vec[16] = temp3;
+    vec[ 3] = (vec[18] + vec[17]);
+    vec[ 5] = (vec[19] + vec[18]);
+    vec[18] = vec[9];
+
+    vec[ 7] = (vec[20] + vec[19]);
+    vec[ 9] = (vec[21] + vec[20]);
+    vec[20] = temp2;
+    temp2   = vec[13];
+    temp3   = vec[11];
+    vec[11] = (vec[22] + vec[21]);
+    vec[13] = (vec[23] + vec[22]);
+    vec[22] = temp3;
+    temp3   = vec[15];
+
+    vec[15] = (vec[24] + vec[23]);
+    vec[17] = (vec[25] + vec[24]);
+    vec[19] = (vec[26] + vec[25]);
+    vec[21] = (vec[27] + vec[26]);
+    vec[23] = (vec[28] + vec[27]);
+    vec[24] = temp1;
+    vec[25] = (vec[29] + vec[28]);
+    vec[26] = temp2;
+    vec[27] = (vec[30] + vec[29]);
+    vec[28] = temp0;
+    vec[29] = (vec[30] + vec[31]);
+    vec[30] = temp3;
+}
+
+/*
+ *  The DCT 32 of pvmp3_poly_phase_synthesis(), on O::N time slots whose
+ *  subband samples start at data, data - SUBBANDS_NUMBER, ...
+ */
+template <class O>
+static void dct_32_lanes(int32 *data)
+{
+    typename O::V vec[SUBBANDS_NUMBER];
+
+    O::load_lanes(vec, data, -SUBBANDS_NUMBER, SUBBANDS_NUMBER);
+
+    split_lanes<O>(vec);
+
+    dct_16_lanes<O>(&vec[16], 0);
+    dct_16_lanes<O>(vec, 1);     // Even terms
+
+    merge_in_place_N32_lanes<O>(vec);
+
+    O::store_lanes(data, vec, -SUBBANDS_NUMBER, SUBBANDS_NUMBER);
+}
+
+/*
+ *  pqmfSynthWin rearranged for polyphase_window_lanes(): the 16 window
+ *  values of outputs j .. j + O::N - 1 side by side, j = 1, 1 + O::N, ...
+ *  The lanes past j = 15 are 0.
+ */
+template <class O>
+static void build_window_lanes(int32 table[HAN_SIZE/2])
+{
+    int32 g, t, l;
+
+    for (g = 0; g < 16 / O::N; g++)
+    {
+        for (t = 0; t < 16; t++)
+        {
+            for (l = 0; l < O::N; l++)
+            {
+                int32 j = g * O::N + l + 1;
+
+                table[(g*16 + t)*O::N + l] = (j < 16) ? pqmfSynthWin[(j - 1)*16 + t] : 0;
+            }
+        }
+    }
+}
+
+/*
+ *  pvmp3_polyphase_filter_window(), O::N output pairs j, 32 - j at a time
+ */
+template <class O>
+static void polyphase_window_lanes(int32 *synth_buffer,
+                                   int16 *outPcm,
+                                   int32 numChannels,
+                                   const int32 *table)
+{
+    typedef typename O::V V;
+    int16 pcm1[16 + PVMP3_MAX_LANES];
+    int16 pcm2[16 + PVMP3_MAX_LANES];
+    const int32 *winPtr;
+    int32 sum1;
+    int32 sum2;
+    int32 i, j, b;
+
+    for (j = 1; j < SUBBANDS_NUMBER / 2; j += O::N)
+    {
+        const int32 *win = &table[(j - 1)*16];
+        int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j];
+        int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j - (O::N - 1)];
+        V vsum1 = O::set1(0x00000020);
+        V vsum2 = O::set1(0x00000020);
+
+        for (b = 0; b < 4; b++)
+        {
+            V temp1 = O::load(&pt_1[SUBBANDS_NUMBER*(2*b)]);
+            V temp3 = O::load_rev(&pt_2[SUBBANDS_NUMBER*(15 - 2*b)]);
+            V temp2 = O::load_rev(&pt_2[SUBBANDS_NUMBER*(2*b + 1)]);
+            V temp4 = O::load(&pt_1[SUBBANDS_NUMBER*(14 - 2*b)]);
+            V w0 = O::load(&win[(4*b + 0)*O::N]);
+            V w1 = O::load(&win[(4*b + 1)*O::N]);
+            V w2 = O::load(&win[(4*b + 2)*O::N]);
+            V w3 = O::load(&win[(4*b + 3)*O::N]);
+
+            vsum1 = vsum1 + O::mul(temp1, w0, 32) - O::mul(temp3, w1, 32)
+                    + O::mul(temp2, w2, 32) + O::mul(temp4, w3, 32);
+            vsum2 = vsum2 + O::mul(temp3, w0, 32) + O::mul(temp1, w1, 32)
+                    - O::mul(temp4, w2, 32) + O::mul(temp2, w3, 32);
+        }
+
+        O::store_pcm(&pcm1[j], O::sar(vsum1, 6));
+        O::store_pcm(&pcm2[j], O::sar(vsum2, 6));
+    }
+
+    for (j = 1; j < SUBBANDS_NUMBER / 2; j++)
+    {
+        int32 k = j << (numChannels - 1);
+        outPcm[k] = pcm1[j];
+        outPcm[(numChannels<<5) - k] = pcm2[j];
+    }
+
+    sum1 = 0x00000020;
+    sum2 = 0x00000020;
+    winPtr = &pqmfSynthWin[(SUBBANDS_NUMBER / 2 - 1)*16];
+
+    for (i = 16; i < HAN_SIZE + 16; i += (SUBBANDS_NUMBER << 2))
+    {
+        int32 *pt_synth = &synth_buffer[i];
+        int32 temp1 = pt_synth[ 0                ];
+        int32 temp2 = pt_synth[ SUBBANDS_NUMBER  ];
+        int32 temp3 = pt_synth[ SUBBANDS_NUMBER/2];
+
+        sum1 = fxp_mac32_Q32(sum1, temp1, winPtr[0]) ;
+        sum1 = fxp_mac32_Q32(sum1, temp2, winPtr[1]) ;
+        sum2 = fxp_mac32_Q32(sum2, temp3, winPtr[2]) ;
+
+        temp1 = pt_synth[ SUBBANDS_NUMBER<<1 ];
+        temp2 = pt_synth[ 3*SUBBANDS_NUMBER  ];
+        temp3 = pt_synth[ SUBBANDS_NUMBER*5/2];
+
+        sum1 = fxp_mac32_Q32(sum1, temp1, winPtr[3]) ;
+        sum1 = fxp_mac32_Q32(sum1, temp2, winPtr[4]) ;
+        sum2 = fxp_mac32_Q32(sum2, temp3, winPtr[5]) ;
+
+        winPtr += 6;
+    }
+
+    outPcm[0] = saturate16(sum1 >> 6);
+    outPcm[(SUBBANDS_NUMBER/2)<<(numChannels-1)] = saturate16(sum2 >> 6);
+}
+
+/*
+ *  pvmp3_poly_phase_synthesis(). The DCTs of all 18 slots go first, O::N
+ *  slots at a time; the window of a slot only reads that slot and older
+ *  ones, which the C code has transformed by then as well.
+ */
+template <class O>
+static void poly_phase_synthesis_lanes(tmp3dec_chan   *pChVars,
+                                       int32          numChannels,
+                                       e_equalization equalizerType,
+                                       int16          *outPcm,
+                                       const int32    *table)
+{
+    int32 slot;
+
+    pvmp3_equalizer(pChVars->circ_buffer,
+                    equalizerType,
+                    pChVars->work_buf_int32);
+
+    for (slot = 0; slot + O::N <= FILTERBANK_BANDS; slot += O::N)
+    {
+        dct_32_lanes<O>(&pChVars->circ_buffer[544 - (slot<<5)]);
+    }
+    for (; slot < FILTERBANK_BANDS; slot++)
+    {
+        dct_32_lanes<pvmp3_ops_c>(&pChVars->circ_buffer[544 - (slot<<5)]);
+    }
+
+    for (slot = 0; slot < FILTERBANK_BANDS; slot++)
+    {
+        polyphase_window_lanes<O>(&pChVars->circ_buffer[544 - (slot<<5)],
+                                  outPcm + slot * (numChannels << 5),
+                                  numChannels,
+                                  table);
+    }
+
+    pv_memmove(&pChVars->circ_buffer[576],
+               pChVars->circ_buffer,
+               480*sizeof(*pChVars->circ_buffer));
+}
+
+/*
+ *  pvmp3_alias_reduction(), O::N butterflies at a time
+ */
+template <class O>
+static void alias_reduction_lanes(int32 *input_buffer,
+                                  granuleInfo *gr_info,
+                                  int32  *used_freq_lines,
+                                  mp3Header *info)
+{
+    typedef typename O::V V;
+    int32 sblim;
+    int32 sb, b;
+
+    *used_freq_lines = fxp_mul32_Q32(*used_freq_lines << 16, (int32)(0x7FFFFFFF / (float)18 - 1.0f)) >> 15;
+
+    if (gr_info->window_switching_flag &&  gr_info->block_type == 2)
+    {
+        if (gr_info->mixed_block_flag)
+        {
+            sblim = ((info->version_x == MPEG_2_5) && (info->sampling_frequency == 2)) ? 3 : 1;
+        }
+        else
+        {
+            return;  /* illegal parameter */
+        }
+    }
+    else
+    {
+        sblim = *used_freq_lines + 1;
+
+        if (sblim > SUBBANDS_NUMBER - 1)
+        {
+            sblim = SUBBANDS_NUMBER - 1;  /* default */
+        }
+    }
+
+    /* butterfly b between subbands sb and sb + 1 takes lines 17 - b and 18 + b */
+    for (sb = 0; sb < sblim; sb++)
+    {
+        int32 *ptr1 = &input_buffer[sb*FILTERBANK_BANDS + 17 - (O::N - 1)];
+        int32 *ptr2 = &input_buffer[sb*FILTERBANK_BANDS + 18];
+
+        for (b = 0; b < NUM_BUTTERFLIES; b += O::N)
+        {
+            V csi = O::load(&c_signal[b]);
+            V csa = O::load(&c_alias[b]);
+            V x = O::shl(O::load_rev(ptr1 - b), 1);
+            V y = O::shl(O::load(ptr2 + b), 1);
+
+            O::store_rev(ptr1 - b, O::mul(x, csi, 32) - O::mul(y, csa, 32));
+            O::store(ptr2 + b, O::mul(y, csi, 32) + O::mul(x, csa, 32));
+        }
+    }
+}
+
+#undef Qfmt31
+#undef cos_pi_9
+#undef cos_2pi_9
+#undef cos_4pi_9
+#undef cos_5pi_9
+#undef cos_7pi_9
+#undef cos_8pi_9
+#undef cos_pi_6
+#undef cos_5pi_6
+#undef cos_5pi_18
+#undef cos_7pi_18
+#undef cos_11pi_18
+#undef cos_13pi_18
+#undef cos_17pi_18
+#undef Qfmt30
+#undef cos_pi_6_q30
+#undef cos_7_pi_12
+#undef cos_3_pi_12
+#undef cos_11_pi_12
+
+/*----------------------------------------------------------------------------
+; END
+----------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the x86 alias reduction, IMDCT and polyphase synthesis against the
+ * C versions on random input, then decodes an MP3 file, or a generated
+ * Layer III stream, with each function set through pvmp3_framedecoder()
+ * alone, and prints how many times faster than realtime it runs. The PCM
+ * has to be identical for all sets.
+ *
+ * Only the library is timed. SoftMP3 is given one frame per input buffer by
+ * MP3Extractor and copies its output through OMX buffers on the component's
+ * looper thread; "codec_component_bench -d file.mp3" times it that way,
+ * through MediaCodec.
+ *
+ * Usage: mp3dec_bench [-s seconds] [-i input.mp3] [-n runs]
+ *
+ * The generated stream is MPEG-1 joint stereo, 44.1 kHz, 128 kbps, with
+ * random side info (long, start, short, mixed and stop blocks, random
+ * Huffman tables) and random main data, so every code path sees realistic
+ * block type mixes but the audio itself is noise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "pvmp3decoder_api.h"
+#include "pvmp3_dec_defs.h"
+#include "pvmp3_alias_reduction.h"
+#include "pvmp3_imdct_synth.h"
+#include "pvmp3_poly_phase_synthesis.h"
+#include "s_tmp3dec_chan.h"
+#include "pvmp3_x86.h"
+
+#define SAMPLE_RATE         44100
+#define FRAME_BYTES         417         /* 128 kbps at 44.1 kHz, no padding */
+#define SIDE_INFO_BYTES     32
+#define OUTPUT_SAMPLES      (4608 * 2 / sizeof(int16_t))    /* SoftMP3 */
+
+typedef struct
+{
+    const char *name;
+    const char *cpu;    /* STAGEFRIGHT_X86_CPU, NULL for no limit */
+#ifdef MP3DEC_X86
+    tPVMP3X86Funcs funcs;
+#endif
+} FunctionSet;
+
+static FunctionSet sets[3];
+static int numSets;
+
+static unsigned int seed = 12345;
+
+static unsigned int Rand(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) | (seed << 16);
+}
+
+static double Now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void InitSets(void)
+{
+    static const char *names[3] = { "c", "sse41", "avx2" };
+    int i, j;
+
+    numSets = 0;
+    for (i = 0; i < 3; i++)
+    {
+        FunctionSet *set = &sets[numSets];
+
+        set->name = names[i];
+        set->cpu = i < 2 ? names[i] : NULL;
+#ifdef MP3DEC_X86
+        if (set->cpu)
+            setenv("STAGEFRIGHT_X86_CPU", set->cpu, 1);
+        else
+            unsetenv("STAGEFRIGHT_X86_CPU");
+        pvmp3_GetX86Functions(&set->funcs);
+
+        /* skip the sets the CPU does not have */
+        for (j = 0; j < numSets; j++)
+        {
+            if (!memcmp(&sets[j].funcs, &set->funcs, sizeof(set->funcs)))
+                break;
+        }
+        if (j < numSets)
+            continue;
+#else
+        if (i > 0)
+            break;
+        (void)j;
+#endif
+        numSets++;
+    }
+    unsetenv("STAGEFRIGHT_X86_CPU");
+}
+
+#ifdef MP3DEC_X86
+
+/*
+ * random value of up to bits bits; decoded streams stay well below 2^28,
+ * and the C code overflows (undefined) on full scale input
+ */
+static int32 RandValue(int bits)
+{
+    return (int32)Rand() >> (32 - bits);
+}
+
+static void RandVector(int32 *x, int n, int bits)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        x[i] = RandValue(bits);
+}
+
+static int Compare(const char *what, const char *name, const void *a, const void *b,
+                   int size, int iter)
+{
+    if (!memcmp(a, b, size))
+        return 0;
+
+    printf("%s: %s differs from c at iteration %d\n", name, what, iter);
+    return 1;
+}
+
+static void RandGranule(granuleInfo *gr_info, mp3Header *info)
+{
+    memset(gr_info, 0, sizeof(*gr_info));
+    memset(info, 0, sizeof(*info));
+
+    gr_info->window_switching_flag = Rand() & 1;
+    gr_info->block_type = Rand() & 3;
+    gr_info->mixed_block_flag = Rand() & 1;
+    info->version_x = Rand() % 3;
+    info->sampling_frequency = Rand() % 3;
+}
+
+/* checks the functions of set against the C versions */
+static int CheckSet(const FunctionSet *set, int iterations)
+{
+    static tmp3dec_chan chanC, chanX;
+    static int32 inC[SUBBANDS_NUMBER*FILTERBANK_BANDS], inX[SUBBANDS_NUMBER*FILTERBANK_BANDS];
+    static int16 pcmC[2*SUBBANDS_NUMBER*FILTERBANK_BANDS], pcmX[2*SUBBANDS_NUMBER*FILTERBANK_BANDS];
+    int32 scratch[256];
+    granuleInfo gr_info;
+    mp3Header info;
+    int iter, failed = 0;
+
+    for (iter = 0; iter < iterations && !failed; iter++)
+    {
+        int32 linesC, linesX;
+        int bits = 12 + Rand() % 15;
+
+        /* alias reduction */
+        RandVector(inC, SUBBANDS_NUMBER*FILTERBANK_BANDS, bits);
+        memcpy(inX, inC, sizeof(inC));
+        RandGranule(&gr_info, &info);
+        linesC = linesX = Rand() % (SUBBANDS_NUMBER*FILTERBANK_BANDS + 1);
+
+        pvmp3_alias_reduction(inC, &gr_info, &linesC, &info);
+        set->funcs.alias_reduction(inX, &gr_info, &linesX, &info);
+        failed |= Compare("alias_reduction", set->name, inC, inX, sizeof(inC), iter);
+        failed |= Compare("alias_reduction lines", set->name, &linesC, &linesX,
+                          sizeof(linesC), iter);
+
+        /* imdct, on a history from the previous iteration */
+        {
+            uint32 blk_type = Rand() & 3;
+            int16 mx_band = (Rand() % 3) * 2;
+            int32 lines = Rand() % SUBBANDS_NUMBER;
+
+            RandVector(inC, SUBBANDS_NUMBER*FILTERBANK_BANDS, bits);
+            memcpy(inX, inC, sizeof(inC));
+            if (iter == 0)
+            {
+                RandVector(chanC.overlap, SUBBANDS_NUMBER*FILTERBANK_BANDS, bits);
+                memcpy(chanX.overlap, chanC.overlap, sizeof(chanC.overlap));
+            }
+
+            pvmp3_imdct_synth(inC, chanC.overlap, blk_type, mx_band, lines, scratch);
+            set->funcs.imdct_synth(inX, chanX.overlap, blk_type, mx_band, lines, scratch);
+            failed |= Compare("imdct_synth", set->name, inC, inX, sizeof(inC), iter);
+            failed |= Compare("imdct_synth overlap", set->name, chanC.overlap, chanX.overlap,
+                              sizeof(chanC.overlap), iter);
+        }
+
+        /* polyphase synthesis, on the history of the previous iteration */
+        {
+            int32 numChannels = 1 + (Rand() & 1);
+            e_equalization eq = (e_equalization)(Rand() % 8);
+
+            RandVector(chanC.work_buf_int32, SUBBANDS_NUMBER*FILTERBANK_BANDS, bits - 4);
+            memcpy(chanX.work_buf_int32, chanC.work_buf_int32, sizeof(chanC.work_buf_int32));
+            memset(pcmC, 0, sizeof(pcmC));
+            memset(pcmX, 0, sizeof(pcmX));
+
+            pvmp3_poly_phase_synthesis(&chanC, numChannels, eq, pcmC);
+            set->funcs.poly_phase_synthesis(&chanX, numChannels, eq, pcmX);
+            failed |= Compare("poly_phase_synthesis", set->name, pcmC, pcmX, sizeof(pcmC), iter);
+            failed |= Compare("poly_phase_synthesis history", set->name,
+                              chanC.circ_buffer, chanX.circ_buffer,
+                              sizeof(chanC.circ_buffer), iter);
+        }
+    }
+
+    return failed;
+}
+
+#endif
+
+typedef struct
+{
+    uint8 *data;
+    int size;
+    int bit;
+} BitWriter;
+
+static void PutBits(BitWriter *w, uint32 value, int bits)
+{
+    while (bits-- > 0)
+    {
+        if (value & (1u << bits))
+            w->data[w->bit >> 3] |= 0x80 >> (w->bit & 7);
+        w->bit++;
+    }
+}
+
+/* a Huffman table that exists, 4 and 14 do not */
+static uint32 RandTable(void)
+{
+    uint32 table;
+
+    do
+    {
+        table = Rand() & 31;
+    }
+    while (table == 4 || table == 14);
+
+    return table;
+}
+
+static uint8 *MakeStream(int frames, int *size)
+{
+    uint8 *stream = (uint8 *)calloc(frames, FRAME_BYTES);
+    int f, gr, ch, i;
+
+    for (f = 0; f < frames; f++)
+    {
+        BitWriter w = { stream + f * FRAME_BYTES, FRAME_BYTES, 0 };
+
+        /* MPEG-1 layer III, no CRC, 128 kbps, 44.1 kHz, joint stereo */
+        PutBits(&w, 0xFFFB, 16);
+        PutBits(&w, 9, 4);
+        PutBits(&w, 0, 2);
+        PutBits(&w, 0, 2);
+        PutBits(&w, MPG_MD_JOINT_STEREO, 2);
+        PutBits(&w, Rand() & 3, 2);
+        PutBits(&w, 1, 4);
+
+        /* main data right after the side info, no scalefactor sharing */
+        PutBits(&w, 0, 9);
+        PutBits(&w, 0, 3);
+        PutBits(&w, 0, 8);
+
+        for (gr = 0; gr < 2; gr++)
+        {
+            for (ch = 0; ch < 2; ch++)
+            {
+                PutBits(&w, (FRAME_BYTES - 4 - SIDE_INFO_BYTES) * 8 / 4, 12);
+                PutBits(&w, Rand() % 289, 9);
+                PutBits(&w, 130 + Rand() % 50, 8);
+                PutBits(&w, Rand() & 15, 4);
+                if (Rand() % 3 == 0)
+                {
+                    PutBits(&w, 1, 1);
+                    PutBits(&w, 1 + Rand() % 3, 2);
+                    PutBits(&w, Rand() & 1, 1);
+                    PutBits(&w, RandTable(), 5);
+                    PutBits(&w, RandTable(), 5);
+                    PutBits(&w, Rand() & 511, 9);
+                }
+                else
+                {
+                    PutBits(&w, 0, 1);
+                    PutBits(&w, RandTable(), 5);
+                    PutBits(&w, RandTable(), 5);
+                    PutBits(&w, RandTable(), 5);
+                    PutBits(&w, Rand() & 15, 4);
+                    PutBits(&w, Rand() & 7, 3);
+                }
+                PutBits(&w, Rand() & 7, 3);
+            }
+        }
+
+        for (i = 4 + SIDE_INFO_BYTES; i < FRAME_BYTES; i++)
+            w.data[i] = (uint8)Rand();
+    }
+
+    *size = frames * FRAME_BYTES;
+    return stream;
+}
+
+static uint8 *ReadFile(const char *path, int *size)
+{
+    FILE *f = fopen(path, "rb");
+    uint8 *data;
+
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    data = (uint8 *)malloc(*size + 1);
+    *size = fread(data, 1, *size, f);
+    fclose(f);
+
+    return data;
+}
+
+/* decodes the stream, returns the seconds taken and the PCM hash */
+static int Decode(const FunctionSet *set, uint8 *stream, int size,
+                  double *seconds, double *audioSeconds, unsigned int *hash)
+{
+    tPVMP3DecoderExternal config;
+    static int16 pcm[OUTPUT_SAMPLES];
+    void *decoderBuf;
+    unsigned int h = 2166136261u;
+    long samples = 0;
+    int32 rate = SAMPLE_RATE;
+    double start;
+    int offset = 0;
+
+    memset(&config, 0, sizeof(config));
+    config.equalizerType = flat;
+    config.crcEnabled = false;
+
+    decoderBuf = malloc(pvmp3_decoderMemRequirements());
+    pvmp3_InitDecoder(&config, decoderBuf);
+
+#ifdef MP3DEC_X86
+    pvmp3X86Funcs = set->funcs;
+#else
+    (void)set;
+#endif
+
+    start = Now();
+
+    /* the whole buffer in, one frame out per call */
+    while (offset < size)
+    {
+        ERROR_CODE err;
+        int n;
+
+        config.pInputBuffer = stream + offset;
+        config.inputBufferCurrentLength = size - offset;
+        config.inputBufferMaxLength = 0;
+        config.inputBufferUsedLength = 0;
+        config.outputFrameSize = OUTPUT_SAMPLES;
+        config.pOutputBuffer = pcm;
+
+        err = pvmp3_framedecoder(&config, decoderBuf);
+        if (err != NO_DECODING_ERROR && err != NO_ENOUGH_MAIN_DATA_ERROR
+                && err != SIDE_INFO_ERROR)
+        {
+            break;
+        }
+        if (config.inputBufferUsedLength == 0)
+            break;
+
+        offset += config.inputBufferUsedLength;
+        samples += config.outputFrameSize;
+        if (config.samplingRate > 0)
+            rate = config.samplingRate * (config.num_channels > 0 ? config.num_channels : 1);
+
+        for (n = 0; n < (int)(config.outputFrameSize * sizeof(int16)); n++)
+            h = (h ^ ((uint8 *)pcm)[n]) * 16777619u;
+    }
+
+    *seconds = Now() - start;
+    *audioSeconds = (double)samples / rate;
+    *hash = h;
+
+    free(decoderBuf);
+
+    return samples == 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    int duration = 60, runs = 3;
+    int size, i, run, failed = 0;
+    uint8 *stream;
+    unsigned int refHash = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            duration = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+        {
+            input = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("usage: %s [-s seconds] [-i input.mp3] [-n runs]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    InitSets();
+
+    if (input != NULL)
+    {
+        stream = ReadFile(input, &size);
+        if (stream == NULL)
+        {
+            printf("cannot read %s\n", input);
+            return 1;
+        }
+    }
+    else
+    {
+        /* before the checks use Rand(), so builds without them get the same stream */
+        stream = MakeStream(duration * SAMPLE_RATE / 1152, &size);
+    }
+
+#ifdef MP3DEC_X86
+    for (i = 0; i < numSets; i++)
+    {
+        if (CheckSet(&sets[i], 2000))
+        {
+            failed = 1;
+        }
+        else
+        {
+            printf("%s: functions match c\n", sets[i].name);
+        }
+    }
+#endif
+
+    for (i = 0; i < numSets; i++)
+    {
+        double best = 0, audioSeconds = 0;
+        unsigned int hash = 0;
+
+        /* best of a few runs, the first one warms the caches */
+        for (run = 0; run < runs; run++)
+        {
+            double seconds;
+
+            if (Decode(&sets[i], stream, size, &seconds, &audioSeconds, &hash))
+            {
+                printf("%s: nothing decoded\n", sets[i].name);
+                return 1;
+            }
+            if (run == 0 || seconds < best)
+                best = seconds;
+        }
+
+        printf("%s: %.1fx realtime, %.1f s of audio, hash %08x\n",
+               sets[i].name, audioSeconds / best, audioSeconds, hash);
+
+        if (i == 0)
+        {
+            refHash = hash;
+        }
+        else if (hash != refHash)
+        {
+            printf("%s: PCM differs from c\n", sets[i].name);
+            failed = 1;
+        }
+    }
+
+    free(stream);
+
+    return failed;
+}
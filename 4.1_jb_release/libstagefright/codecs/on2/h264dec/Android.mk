@@ -30,6 +30,7 @@ LOCAL_SRC_FILES := \
 	./source/h264bsd_vui.c \
 	./source/h264bsd_pic_order_cnt.c \
 	./source/h264bsd_decoder.c \
+	./source/h264bsd_mt.c \
 	./source/H264SwDecApi.c \
 	SoftAVC.cpp \
 
@@ -85,6 +86,43 @@ MY_OMXDL_ASM_SRC := \
 	./omxdl/arm_neon/vc/m4p10/src_gcc/omxVCM4P10_TransformDequantChromaDCFromPair_s.S \
 
 
+MY_OMXDL_X86_C_SRC := \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_CAVLCTables.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_DeBlockPixel.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_DecodeCoeffsToPair.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_DequantTables.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_InterpolateHalfDiag_Luma.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_InterpolateHalfHor_Luma.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_InterpolateHalfVer_Luma.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_PredictIntraDC4x4.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_TransformResidual4x4.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_UnpackBlock2x2.c \
+	./omxdl/reference/vc/m4p10/src/armVCM4P10_UnpackBlock4x4.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_DecodeChromaDcCoeffsToPairCAVLC.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_DecodeCoeffsToPairCAVLC.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_InterpolateChroma.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_InterpolateLuma.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_PredictIntra_16x16.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_PredictIntra_4x4.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_PredictIntraChroma_8x8.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_TransformDequantChromaDCFromPair.c \
+	./omxdl/reference/vc/m4p10/src/omxVCM4P10_TransformDequantLumaDCFromPair.c \
+	./omxdl/reference/vc/comm/src/armVCCOMM_Average.c \
+	./omxdl/reference/src/armCOMM_Bitstream.c \
+	./omxdl/reference/src/armCOMM.c \
+	./omxdl/x86/src/x86COMM.c \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Dispatch.c \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Reference.c
+
+MY_OMXDL_X86_C_INCLUDES := \
+	$(LOCAL_PATH)/./omxdl/reference/api \
+	$(LOCAL_PATH)/./omxdl/reference/vc/api \
+	$(LOCAL_PATH)/./omxdl/reference/vc/m4p10/api \
+	$(LOCAL_PATH)/./omxdl/x86/api \
+	$(LOCAL_PATH)/./omxdl/x86/vc/m4p10/api \
+	$(LOCAL_PATH)/../../common/include
+
+
 ifeq ($(ARCH_ARM_HAVE_NEON),true)
     LOCAL_ARM_NEON   := true
 #    LOCAL_CFLAGS     := -std=c99 -D._NEON -D._OMXDL
@@ -96,6 +134,18 @@ ifeq ($(ARCH_ARM_HAVE_NEON),true)
                         $(LOCAL_PATH)/./omxdl/arm_neon/vc/m4p10/api
 endif
 
+# x86: the reference OpenMAX DL C code, with the hot kernels replaced by SSE4.1
+# and AVX2 versions that are picked at run time.
+ifeq ($(TARGET_ARCH),x86)
+    LOCAL_CFLAGS     := -DH264DEC_OMXDL
+    LOCAL_SRC_FILES  += $(MY_OMXDL_X86_C_SRC)
+    LOCAL_C_INCLUDES += $(MY_OMXDL_X86_C_INCLUDES)
+    LOCAL_STATIC_LIBRARIES := \
+        libstagefright_h264dec_omxdl_sse4 \
+        libstagefright_h264dec_omxdl_avx2 \
+        libstagefright_x86_cpu
+endif
+
 LOCAL_SHARED_LIBRARIES := \
 	libstagefright libstagefright_omx libstagefright_foundation libutils \
 
@@ -125,3 +175,78 @@ LOCAL_MODULE := decoder
 
 include $(BUILD_EXECUTABLE)
 
+#####################################################################
+# test utility: multiple instances and thread scaling benchmark
+#####################################################################
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := ./source/TestBenchMultipleInstance.c
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/inc
+
+LOCAL_SHARED_LIBRARIES := libstagefright_soft_h264dec
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE := decoder_multi
+
+include $(BUILD_EXECUTABLE)
+
+ifeq ($(TARGET_ARCH),x86)
+
+#####################################################################
+# x86 OpenMAX DL kernels, one library per instruction set since the
+# compiler flags apply to a whole module
+#####################################################################
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Deblocking_SSE4.c \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Interpolate_SSE4.c \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Transform_SSE4.c
+
+LOCAL_C_INCLUDES := $(MY_OMXDL_X86_C_INCLUDES)
+
+LOCAL_CFLAGS := -msse4.1
+
+LOCAL_MODULE := libstagefright_h264dec_omxdl_sse4
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Deblocking_AVX2.c \
+	./omxdl/x86/vc/m4p10/src/x86VCM4P10_Interpolate_AVX2.c
+
+LOCAL_C_INCLUDES := $(MY_OMXDL_X86_C_INCLUDES)
+
+LOCAL_CFLAGS := -mavx2
+
+LOCAL_MODULE := libstagefright_h264dec_omxdl_avx2
+
+include $(BUILD_STATIC_LIBRARY)
+
+#####################################################################
+# test utility: x86 OpenMAX DL kernel check and benchmark
+#####################################################################
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	./omxdl/x86/test/x86VCM4P10_Bench.c \
+	$(MY_OMXDL_X86_C_SRC)
+
+LOCAL_C_INCLUDES := $(MY_OMXDL_X86_C_INCLUDES)
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_h264dec_omxdl_sse4 \
+	libstagefright_h264dec_omxdl_avx2 \
+	libstagefright_x86_cpu
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE := x86VCM4P10_Bench
+
+include $(BUILD_EXECUTABLE)
+
+endif
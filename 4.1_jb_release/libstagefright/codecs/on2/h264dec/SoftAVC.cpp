@@ -25,6 +25,8 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/IOMX.h>
 
+#include <unistd.h>
+
 
 namespace android {
 
@@ -56,6 +58,18 @@ static void InitOMXParams(T *params) {
     params->nVersion.s.nStep = 0;
 }
 
+static u8 *BindPictureWrapper(void *userData, u32 size, void **bufferId) {
+    SoftAVC *decoder = static_cast<SoftAVC *>(userData);
+    CHECK(decoder != NULL);
+    return decoder->bindPicture(size, bufferId);
+}
+
+static void UnbindPictureWrapper(void *userData, void *bufferId) {
+    SoftAVC *decoder = static_cast<SoftAVC *>(userData);
+    CHECK(decoder != NULL);
+    decoder->unbindPicture(bufferId);
+}
+
 SoftAVC::SoftAVC(
         const char *name,
         const OMX_CALLBACKTYPE *callbacks,
@@ -67,12 +81,14 @@ SoftAVC::SoftAVC(
       mWidth(320),
       mHeight(240),
       mPictureSize(mWidth * mHeight * 3 / 2),
+      mNumOutputBuffers(kNumOutputBuffers),
       mCropLeft(0),
       mCropTop(0),
       mCropWidth(mWidth),
       mCropHeight(mHeight),
       mFirstPicture(NULL),
       mFirstPictureId(-1),
+      mFirstPictureBufferId(NULL),
       mPicId(0),
       mHeadersDecoded(false),
       mEOSStatus(INPUT_DATA_AVAILABLE),
@@ -96,8 +112,6 @@ SoftAVC::~SoftAVC() {
     List<BufferInfo *> &inQueue = getPortQueue(kInputPortIndex);
     CHECK(outQueue.empty());
     CHECK(inQueue.empty());
-
-    delete[] mFirstPicture;
 }
 
 void SoftAVC::initPorts() {
@@ -132,13 +146,13 @@ void SoftAVC::initPorts() {
 
     def.nPortIndex = kOutputPortIndex;
     def.eDir = OMX_DirOutput;
-    def.nBufferCountMin = kNumOutputBuffers;
+    def.nBufferCountMin = mNumOutputBuffers;
     def.nBufferCountActual = def.nBufferCountMin;
     def.bEnabled = OMX_TRUE;
     def.bPopulated = OMX_FALSE;
     def.eDomain = OMX_PortDomainVideo;
     def.bBuffersContiguous = OMX_FALSE;
-    def.nBufferAlignment = 2;
+    def.nBufferAlignment = 16;
 
     def.format.video.cMIMEType = const_cast<char *>(MEDIA_MIMETYPE_VIDEO_RAW);
     def.format.video.pNativeRender = NULL;
@@ -154,19 +168,88 @@ void SoftAVC::initPorts() {
     def.format.video.pNativeWindow = NULL;
 
     def.nBufferSize =
-        (def.format.video.nFrameWidth * def.format.video.nFrameHeight * 3) / 2;
+        (def.format.video.nFrameWidth * def.format.video.nFrameHeight * 3) / 2
+        + kPicturePadding;
 
     addPort(def);
 }
 
 status_t SoftAVC::initDecoder() {
+    // Decode each picture with one thread per core, up to kMaxNumThreads.
+    long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t numThreads = numCpus > 1 ? (uint32_t)numCpus : 1;
+    if (numThreads > kMaxNumThreads) {
+        numThreads = kMaxNumThreads;
+    }
+
     // Force decoder to output buffers in display order.
-    if (H264SwDecInit(&mHandle, 0) == H264SWDEC_OK) {
-        return OK;
+    if (H264SwDecInit(&mHandle, 0, numThreads) == H264SWDEC_OK) {
+        return setPictureBuffers();
     }
     return UNKNOWN_ERROR;
 }
 
+status_t SoftAVC::setPictureBuffers() {
+    // Have the decoder decode the pictures into the output buffers, saves
+    // copying each picture. Pictures it keeps are moved out of the output
+    // buffers bound so far.
+    H264SwDecPictureBuffers buffers;
+    buffers.bindPicture = BindPictureWrapper;
+    buffers.unbindPicture = UnbindPictureWrapper;
+    buffers.pUserData = this;
+
+    if (H264SwDecSetPictureBuffers(mHandle, &buffers) == H264SWDEC_OK) {
+        CHECK(mBoundHeaders.isEmpty());
+        return OK;
+    }
+    return NO_MEMORY;
+}
+
+uint8_t *SoftAVC::bindPicture(uint32_t size, void **bufferId) {
+    // Buffers of the current port configuration only.
+    if (mOutputPortSettingsChange != NONE) {
+        return NULL;
+    }
+
+    // Leave at least one output buffer free for the pictures the decoder
+    // has to decode into its own memory, and for EOS.
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    BufferInfo *outInfo = NULL;
+    size_t numFree = 0;
+    for (List<BufferInfo *>::iterator it = outQueue.begin();
+            it != outQueue.end(); ++it) {
+        OMX_BUFFERHEADERTYPE *outHeader = (*it)->mHeader;
+        if (mBoundHeaders.indexOf(outHeader) >= 0) {
+            continue;
+        }
+        ++numFree;
+
+        if (outInfo == NULL
+                && outHeader->nAllocLen >= outHeader->nOffset + size
+                && ((uintptr_t)(outHeader->pBuffer + outHeader->nOffset)
+                        & 15) == 0) {
+            outInfo = *it;
+        }
+    }
+
+    if (outInfo == NULL || numFree < 2) {
+        return NULL;
+    }
+
+    OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+    mBoundHeaders.add(outHeader);
+    *bufferId = outHeader;
+    return outHeader->pBuffer + outHeader->nOffset;
+}
+
+void SoftAVC::unbindPicture(void *bufferId) {
+    // The header may have been returned already, don't touch it.
+    ssize_t index =
+        mBoundHeaders.indexOf(static_cast<OMX_BUFFERHEADERTYPE *>(bufferId));
+    CHECK(index >= 0);
+    mBoundHeaders.removeAt(index);
+}
+
 OMX_ERRORTYPE SoftAVC::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR params) {
     switch (index) {
@@ -297,11 +380,14 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
     }
 
     List<BufferInfo *> &inQueue = getPortQueue(kInputPortIndex);
-    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
     H264SwDecRet ret = H264SWDEC_PIC_RDY;
     bool portSettingsChanged = false;
+
+    // Pictures left over from when the output buffers ran out go first.
+    drainOutputBuffers();
+
     while ((mEOSStatus != INPUT_DATA_AVAILABLE || !inQueue.empty())
-            && outQueue.size() == kNumOutputBuffers) {
+            && hasFreeOutputBuffer()) {
 
         if (mEOSStatus == INPUT_EOS_SEEN) {
             drainAllOutputBuffers();
@@ -363,10 +449,13 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
                         // Save this output buffer; otherwise, it will be
                         // lost during dynamic port reconfiguration because
                         // OpenMAX client will delete _all_ output buffers
-                        // in the process.
+                        // in the process. No output buffers are bound
+                        // during the reconfiguration, the picture is in
+                        // the decoder's memory until the next decode.
                         saveFirstOutputBuffer(
                             decodedPicture.picId,
-                            (uint8_t *)decodedPicture.pOutputPicture);
+                            (uint8_t *)decodedPicture.pOutputPicture,
+                            decodedPicture.pBufferId);
                     }
                 }
                 inPicture.dataLen = 0;
@@ -389,30 +478,18 @@ void SoftAVC::onQueueFilled(OMX_U32 portIndex) {
             return;
         }
 
-        if (mFirstPicture && !outQueue.empty()) {
-            drainOneOutputBuffer(mFirstPictureId, mFirstPicture);
-            delete[] mFirstPicture;
-            mFirstPicture = NULL;
-            mFirstPictureId = -1;
-        }
-
-        while (!outQueue.empty() &&
-                mHeadersDecoded &&
-                H264SwDecNextPicture(mHandle, &decodedPicture, 0)
-                    == H264SWDEC_PIC_RDY) {
-
-            int32_t picId = decodedPicture.picId;
-            uint8_t *data = (uint8_t *) decodedPicture.pOutputPicture;
-            drainOneOutputBuffer(picId, data);
-        }
+        drainOutputBuffers();
     }
 }
 
 bool SoftAVC::handlePortSettingChangeEvent(const H264SwDecInfo *info) {
-    if (mWidth != info->picWidth || mHeight != info->picHeight) {
+    uint32_t numOutputBuffers = info->numPicBuffers + kNumOutputBuffers;
+    if (mWidth != info->picWidth || mHeight != info->picHeight ||
+        mNumOutputBuffers != numOutputBuffers) {
         mWidth  = info->picWidth;
         mHeight = info->picHeight;
         mPictureSize = mWidth * mHeight * 3 / 2;
+        mNumOutputBuffers = numOutputBuffers;
         mCropWidth = mWidth;
         mCropHeight = mHeight;
         updatePortDefinitions();
@@ -442,25 +519,89 @@ bool SoftAVC::handleCropRectEvent(const CropParams *crop) {
     return false;
 }
 
-void SoftAVC::saveFirstOutputBuffer(int32_t picId, uint8_t *data) {
+void SoftAVC::saveFirstOutputBuffer(
+        int32_t picId, uint8_t *data, void *bufferId) {
     CHECK(mFirstPicture == NULL);
     mFirstPictureId = picId;
+    mFirstPicture = data;
+    mFirstPictureBufferId = bufferId;
+}
 
-    mFirstPicture = new uint8_t[mPictureSize];
-    memcpy(mFirstPicture, data, mPictureSize);
+bool SoftAVC::hasFreeOutputBuffer() {
+    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
+    for (List<BufferInfo *>::iterator it = outQueue.begin();
+            it != outQueue.end(); ++it) {
+        if (mBoundHeaders.indexOf((*it)->mHeader) < 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void SoftAVC::drainOneOutputBuffer(int32_t picId, uint8_t* data) {
+// Takes the output buffer bufferId off the queue if there, otherwise the
+// first free one.
+SoftAVC::BufferInfo *SoftAVC::dequeueOutputBuffer(void *bufferId) {
     List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
-    BufferInfo *outInfo = *outQueue.begin();
-    outQueue.erase(outQueue.begin());
+    List<BufferInfo *>::iterator it = outQueue.begin();
+    while (it != outQueue.end() && (*it)->mHeader != bufferId) {
+        ++it;
+    }
+    if (it == outQueue.end()) {
+        it = outQueue.begin();
+        while (it != outQueue.end()
+                && mBoundHeaders.indexOf((*it)->mHeader) >= 0) {
+            ++it;
+        }
+    }
+    if (it == outQueue.end()) {
+        return NULL;
+    }
+
+    BufferInfo *outInfo = *it;
+    outQueue.erase(it);
+    return outInfo;
+}
+
+void SoftAVC::drainOutputBuffers() {
+    if (mFirstPicture && hasFreeOutputBuffer()) {
+        drainOneOutputBuffer(
+                mFirstPictureId, mFirstPicture, mFirstPictureBufferId);
+        mFirstPicture = NULL;
+        mFirstPictureId = -1;
+        mFirstPictureBufferId = NULL;
+    }
+
+    H264SwDecPicture decodedPicture;
+    while (mFirstPicture == NULL &&
+            hasFreeOutputBuffer() &&
+            mHeadersDecoded &&
+            H264SwDecNextPicture(mHandle, &decodedPicture, 0)
+                == H264SWDEC_PIC_RDY) {
+
+        int32_t picId = decodedPicture.picId;
+        uint8_t *data = (uint8_t *) decodedPicture.pOutputPicture;
+        drainOneOutputBuffer(picId, data, decodedPicture.pBufferId);
+    }
+}
+
+void SoftAVC::drainOneOutputBuffer(
+        int32_t picId, uint8_t* data, void *bufferId) {
+    // A picture decoded into an output buffer goes out in it unless the
+    // buffer is with the client, e.g. after a flush. Otherwise the picture
+    // is copied into a free buffer.
+    BufferInfo *outInfo = dequeueOutputBuffer(bufferId);
+    CHECK(outInfo != NULL);
     OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
     OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.valueFor(picId);
     outHeader->nTimeStamp = header->nTimeStamp;
     outHeader->nFlags = header->nFlags;
     outHeader->nFilledLen = mPictureSize;
-    memcpy(outHeader->pBuffer + outHeader->nOffset,
-            data, mPictureSize);
+    if (outHeader != bufferId) {
+        memcpy(outHeader->pBuffer + outHeader->nOffset,
+                data, mPictureSize);
+    } else {
+        CHECK(outHeader->pBuffer + outHeader->nOffset == data);
+    }
     mPicToHeaderMap.removeItem(picId);
     delete header;
     outInfo->mOwnedByUs = false;
@@ -468,13 +609,14 @@ void SoftAVC::drainOneOutputBuffer(int32_t picId, uint8_t* data) {
 }
 
 bool SoftAVC::drainAllOutputBuffers() {
-    List<BufferInfo *> &outQueue = getPortQueue(kOutputPortIndex);
     H264SwDecPicture decodedPicture;
 
-    while (!outQueue.empty()) {
-        BufferInfo *outInfo = *outQueue.begin();
-        outQueue.erase(outQueue.begin());
-        OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+    if (mFirstPicture) {
+        drainOutputBuffers();
+    }
+
+    // Each picture takes its own or a free output buffer, the EOS a free one.
+    while (mFirstPicture == NULL && hasFreeOutputBuffer()) {
         if (mHeadersDecoded &&
             H264SWDEC_PIC_RDY ==
                 H264SwDecNextPicture(mHandle, &decodedPicture, 1 /* flush */)) {
@@ -482,25 +624,21 @@ bool SoftAVC::drainAllOutputBuffers() {
             int32_t picId = decodedPicture.picId;
             CHECK(mPicToHeaderMap.indexOfKey(picId) >= 0);
 
-            memcpy(outHeader->pBuffer + outHeader->nOffset,
-                decodedPicture.pOutputPicture,
-                mPictureSize);
-
-            OMX_BUFFERHEADERTYPE *header = mPicToHeaderMap.valueFor(picId);
-            outHeader->nTimeStamp = header->nTimeStamp;
-            outHeader->nFlags = header->nFlags;
-            outHeader->nFilledLen = mPictureSize;
-            mPicToHeaderMap.removeItem(picId);
-            delete header;
+            drainOneOutputBuffer(picId,
+                    (uint8_t *)decodedPicture.pOutputPicture,
+                    decodedPicture.pBufferId);
         } else {
+            BufferInfo *outInfo = dequeueOutputBuffer(NULL);
+            OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
             outHeader->nTimeStamp = 0;
             outHeader->nFilledLen = 0;
             outHeader->nFlags = OMX_BUFFERFLAG_EOS;
             mEOSStatus = OUTPUT_FRAMES_FLUSHED;
-        }
 
-        outInfo->mOwnedByUs = false;
-        notifyFillBufferDone(outHeader);
+            outInfo->mOwnedByUs = false;
+            notifyFillBufferDone(outHeader);
+            break;
+        }
     }
 
     return true;
@@ -509,6 +647,22 @@ bool SoftAVC::drainAllOutputBuffers() {
 void SoftAVC::onPortFlushCompleted(OMX_U32 portIndex) {
     if (portIndex == kInputPortIndex) {
         mEOSStatus = INPUT_DATA_AVAILABLE;
+    } else if (portIndex == kOutputPortIndex) {
+        // The client has all output buffers back, move the pictures the
+        // decoder keeps out of them. A saved picture may be in one of them.
+        if (mFirstPicture) {
+            delete mPicToHeaderMap.valueFor(mFirstPictureId);
+            mPicToHeaderMap.removeItem(mFirstPictureId);
+            mFirstPicture = NULL;
+            mFirstPictureId = -1;
+            mFirstPictureBufferId = NULL;
+        }
+
+        if (!mBoundHeaders.isEmpty() && setPictureBuffers() != OK) {
+            ALOGE("Failed to release output buffers");
+            notify(OMX_EventError, OMX_ErrorUndefined, NO_MEMORY, NULL);
+            mSignalledError = true;
+        }
     }
 }
 
@@ -534,6 +688,17 @@ void SoftAVC::onPortEnableCompleted(OMX_U32 portIndex, bool enabled) {
     }
 }
 
+void SoftAVC::onFreeBuffer(OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header) {
+    if (portIndex == kOutputPortIndex && mBoundHeaders.indexOf(header) >= 0) {
+        // The decoder still needs the picture in this buffer.
+        if (setPictureBuffers() != OK) {
+            ALOGE("Failed to release output buffer %p", header);
+            notify(OMX_EventError, OMX_ErrorUndefined, NO_MEMORY, NULL);
+            mSignalledError = true;
+        }
+    }
+}
+
 void SoftAVC::updatePortDefinitions() {
     OMX_PARAM_PORTDEFINITIONTYPE *def = &editPortInfo(0)->mDef;
     def->format.video.nFrameWidth = mWidth;
@@ -547,9 +712,11 @@ void SoftAVC::updatePortDefinitions() {
     def->format.video.nStride = def->format.video.nFrameWidth;
     def->format.video.nSliceHeight = def->format.video.nFrameHeight;
 
+    def->nBufferCountMin = mNumOutputBuffers;
+    def->nBufferCountActual = def->nBufferCountMin;
     def->nBufferSize =
         (def->format.video.nFrameWidth
-            * def->format.video.nFrameHeight * 3) / 2;
+            * def->format.video.nFrameHeight * 3) / 2 + kPicturePadding;
 }
 
 }  // namespace android
@@ -20,6 +20,7 @@
 
 #include "SimpleSoftOMXComponent.h"
 #include <utils/KeyedVector.h>
+#include <utils/SortedVector.h>
 
 #include "H264SwDecApi.h"
 #include "basetype.h"
@@ -32,6 +33,10 @@ struct SoftAVC : public SimpleSoftOMXComponent {
             OMX_PTR appData,
             OMX_COMPONENTTYPE **component);
 
+    // Callbacks of H264SwDecPictureBuffers
+    uint8_t *bindPicture(uint32_t size, void **bufferId);
+    void unbindPicture(void *bufferId);
+
 protected:
     virtual ~SoftAVC();
 
@@ -46,13 +51,18 @@ protected:
     virtual void onQueueFilled(OMX_U32 portIndex);
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onPortEnableCompleted(OMX_U32 portIndex, bool enabled);
+    virtual void onFreeBuffer(OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header);
 
 private:
     enum {
         kInputPortIndex   = 0,
         kOutputPortIndex  = 1,
         kNumInputBuffers  = 8,
+        // Output buffers in addition to the pictures held by the decoder
         kNumOutputBuffers = 2,
+        // The decoder may read this far beyond the end of a picture
+        kPicturePadding   = 32,
+        kMaxNumThreads    = 4,
     };
 
     enum EOSStatus {
@@ -66,11 +76,16 @@ private:
     size_t mInputBufferCount;
 
     uint32_t mWidth, mHeight, mPictureSize;
+    uint32_t mNumOutputBuffers;
     uint32_t mCropLeft, mCropTop;
     uint32_t mCropWidth, mCropHeight;
 
     uint8_t *mFirstPicture;
     int32_t mFirstPictureId;
+    void *mFirstPictureBufferId;
+
+    // Output buffers the decoder decodes pictures into, see bindPicture.
+    SortedVector<OMX_BUFFERHEADERTYPE *> mBoundHeaders;
 
     int32_t mPicId;  // Which output picture is for which input buffer?
 
@@ -92,10 +107,14 @@ private:
 
     void initPorts();
     status_t initDecoder();
+    status_t setPictureBuffers();
     void updatePortDefinitions();
+    bool hasFreeOutputBuffer();
+    BufferInfo *dequeueOutputBuffer(void *bufferId);
+    void drainOutputBuffers();
     bool drainAllOutputBuffers();
-    void drainOneOutputBuffer(int32_t picId, uint8_t *data);
-    void saveFirstOutputBuffer(int32_t pidId, uint8_t *data);
+    void drainOneOutputBuffer(int32_t picId, uint8_t *data, void *bufferId);
+    void saveFirstOutputBuffer(int32_t pidId, uint8_t *data, void *bufferId);
     bool handleCropRectEvent(const CropParams* crop);
     bool handlePortSettingChangeEvent(const H264SwDecInfo *info);
 
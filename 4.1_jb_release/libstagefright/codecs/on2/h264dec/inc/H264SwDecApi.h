@@ -70,6 +70,9 @@ extern "C"
     3.1. Structures for H264SwDecDecode() parameters.
 ------------------------------------------------------------------------------*/
 
+    /* Maximum number of threads for H264SwDecInit() */
+    #define H264SWDEC_MAX_THREADS 8
+
     /* typedef of the Decoder instance */
     typedef void *H264SwDecInst;
 
@@ -100,8 +103,29 @@ extern "C"
         u32 isIdrPicture;       /* Flag to indicate if the picture is an
                                    IDR picture */
         u32 nbrOfErrMBs;        /* Number of concealed MB's in the picture  */
+        void *pBufferId;        /* Identifier of the application buffer the
+                                   picture is in, NULL if it is in a buffer
+                                   of the decoder, see
+                                   H264SwDecSetPictureBuffers */
     } H264SwDecPicture;
 
+    /* Picture buffers of the application for H264SwDecSetPictureBuffers */
+    typedef struct
+    {
+        /* Called for each new picture. Returns a 16-byte aligned buffer of
+         * at least size bytes for the picture, and stores a non-NULL
+         * identifier of the buffer into *ppBufferId. Returns NULL if no
+         * buffer is available, the picture is then decoded into a buffer of
+         * the decoder. */
+        u8 *(*bindPicture)(void *pUserData, u32 size, void **ppBufferId);
+        /* Called when the decoder no longer needs the buffer, i.e. the
+         * picture is neither used for reference nor waiting to be output,
+         * and for all bound buffers by H264SwDecSetPictureBuffers and
+         * H264SwDecRelease */
+        void (*unbindPicture)(void *pUserData, void *pBufferId);
+        void *pUserData;
+    } H264SwDecPictureBuffers;
+
 /*------------------------------------------------------------------------------
     3.2. Structures for information interchange with DEC API
          and user application.
@@ -126,6 +150,7 @@ extern "C"
         u32 parHeight;
         u32 croppingFlag;
         CropParams cropParams;
+        u32 numPicBuffers;  /* Max number of pictures held by the decoder */
     } H264SwDecInfo;
 
     /* Version information */
@@ -144,7 +169,8 @@ extern "C"
                                  H264SwDecOutput    *pOutput);
 
     H264SwDecRet H264SwDecInit(H264SwDecInst *decInst,
-                               u32            noOutputReordering);
+                               u32            noOutputReordering,
+                               u32            numThreads);
 
     H264SwDecRet H264SwDecNextPicture(H264SwDecInst     decInst,
                                       H264SwDecPicture *pOutput,
@@ -153,6 +179,9 @@ extern "C"
     H264SwDecRet H264SwDecGetInfo(H264SwDecInst decInst,
                                   H264SwDecInfo *pDecInfo);
 
+    H264SwDecRet H264SwDecSetPictureBuffers(H264SwDecInst decInst,
+                                  const H264SwDecPictureBuffers *pBuffers);
+
     void  H264SwDecRelease(H264SwDecInst decInst);
 
     H264SwDecApiVersion H264SwDecGetAPIVersion(void);
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86COMM.h
+ * Brief: Run-time CPU feature detection for the x86 OpenMAX DL backend
+ */
+
+#ifndef _x86COMM_H_
+#define _x86COMM_H_
+
+#include "omxtypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Instruction set extensions the x86 kernels are built for */
+#define X86COMM_CPU_SSE4_1      0x00000001
+#define X86COMM_CPU_AVX2        0x00000002
+
+/**
+ * Function: x86COMM_GetCPUFeatures
+ *
+ * Description:
+ * Returns the X86COMM_CPU_* extensions that both the CPU and the operating
+ * system support, from x86_cpu_get_features(). AVX2 implies SSE4.1.
+ *
+ */
+OMX_U32 x86COMM_GetCPUFeatures(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _x86COMM_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86COMM.c
+ * Brief: Run-time CPU feature detection for the x86 OpenMAX DL backend
+ */
+
+#include "omxtypes.h"
+#include "x86COMM.h"
+#include "x86_cpu.h"
+
+OMX_U32 x86COMM_GetCPUFeatures(void)
+{
+    unsigned int cpu = x86_cpu_get_features();
+    OMX_U32 features = 0;
+
+    if (cpu & X86_CPU_SSE4_1)
+    {
+        features |= X86COMM_CPU_SSE4_1;
+    }
+
+    if (cpu & X86_CPU_AVX2)
+    {
+        features |= X86COMM_CPU_AVX2;
+    }
+
+    return features;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Bench.c
+ * Brief: Checks the x86 SIMD kernels against the reference and times them
+ *
+ * Every kernel of every set the CPU supports is run on the same random
+ * input as the reference C version and the outputs are compared byte by
+ * byte. Exits with 1 on the first difference.
+ *
+ * usage: x86VCM4P10_Bench [iterations] [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "omxtypes.h"
+#include "x86COMM.h"
+#include "x86VCM4P10.h"
+
+/* Blocks start 16-byte aligned with room around them for the filter taps */
+#define BORDER      8
+#define STEP        64
+#define BUF_SIZE    (STEP * (16 + 2 * BORDER))
+#define BLOCK       (BORDER * STEP + 16)
+
+#define NUM_KERNELS 8
+
+static const char *kernelNames[NUM_KERNELS] =
+{
+    "InterpolateLuma",
+    "InterpolateChroma",
+    "FilterDeblockingLuma_VerEdge",
+    "FilterDeblockingLuma_HorEdge",
+    "FilterDeblockingChroma_VerEdge",
+    "FilterDeblockingChroma_HorEdge",
+    "DequantTransformResidualFromPairAndAdd",
+    "InvTransformResidualAndAdd"
+};
+
+typedef struct
+{
+    OMX_U8 src[BUF_SIZE] __attribute__((aligned(16)));
+    OMX_U8 dst[BUF_SIZE] __attribute__((aligned(16)));
+
+    /* Interpolation */
+    OMX_U32 width, height, dx, dy;
+
+    /* Deblocking */
+    OMX_U8 alpha[2], beta[2];
+    OMX_U8 thresholds[16] __attribute__((aligned(4)));
+    OMX_U8 bS[16] __attribute__((aligned(4)));
+
+    /* Transform */
+    OMX_U8 pairs[16 * 3 + 1];
+    OMX_S16 coeff[16] __attribute__((aligned(16)));
+    OMX_S16 DC;
+    OMX_INT QP, AC;
+
+} Input;
+
+static OMX_U32 randState;
+
+static OMX_U32 Rand(void)
+{
+    randState = randState * 1103515245 + 12345;
+    return (randState >> 8) & 0xffffff;
+}
+
+static int RandRange(int lo, int hi)
+{
+    return lo + (int)(Rand() % (OMX_U32)(hi - lo + 1));
+}
+
+/* Smooth pixels with some noise and an occasional step, so that the
+ * deblocking filters take all of their branches */
+static void RandomPixels(OMX_U8 *p)
+{
+    int base = RandRange(0, 255);
+    int noise = RandRange(0, 12);
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i++)
+    {
+        int v = base + RandRange(-noise, noise);
+
+        if (Rand() % 97 == 0)
+        {
+            base = RandRange(0, 255);
+        }
+        p[i] = (OMX_U8)(v < 0 ? 0 : v > 255 ? 255 : v);
+    }
+}
+
+/* bS tables the reference accepts: 4 only on the outer edge, where all of
+ * its values must be 4 */
+static void RandomBS(OMX_U8 *pBS)
+{
+    int strong = RandRange(0, 3) == 0;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        pBS[i] = (OMX_U8)(i < 4 && strong ? 4 : RandRange(0, 3));
+    }
+}
+
+static void RandomPairs(Input *in)
+{
+    OMX_U8 *p = in->pairs;
+    int count = RandRange(1, 16);
+    int pos = RandRange(0, 16 - count);
+    int i;
+
+    for (i = 0; i < count; i++, pos++)
+    {
+        int last = i == count - 1 ? 0x20 : 0;
+
+        if (RandRange(0, 3) == 0)
+        {
+            int value = RandRange(-2048, 2047);
+
+            *p++ = (OMX_U8)(0x10 | last | pos);
+            *p++ = (OMX_U8)(value & 0xff);
+            *p++ = (OMX_U8)((value >> 8) & 0xff);
+        }
+        else
+        {
+            *p++ = (OMX_U8)(last | pos);
+            *p++ = (OMX_U8)RandRange(-128, 127);
+        }
+    }
+}
+
+static void RandomInput(Input *in, int kernel)
+{
+    static const OMX_U32 lumaSizes[3] = { 4, 8, 16 };
+    static const OMX_U32 chromaSizes[3] = { 2, 4, 8 };
+    int i;
+
+    RandomPixels(in->src);
+    RandomPixels(in->dst);
+
+    if (kernel == 0)
+    {
+        in->width = lumaSizes[RandRange(0, 2)];
+        in->height = lumaSizes[RandRange(0, 2)];
+        in->dx = RandRange(0, 3);
+        in->dy = RandRange(0, 3);
+    }
+    else
+    {
+        in->width = chromaSizes[RandRange(0, 2)];
+        in->height = chromaSizes[RandRange(0, 2)];
+        in->dx = RandRange(0, 7);
+        in->dy = RandRange(0, 7);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        in->alpha[i] = (OMX_U8)RandRange(0, 255);
+        in->beta[i] = (OMX_U8)RandRange(0, 18);
+    }
+    for (i = 0; i < 16; i++)
+    {
+        in->thresholds[i] = (OMX_U8)RandRange(0, 25);
+    }
+    RandomBS(in->bS);
+
+    RandomPairs(in);
+    for (i = 0; i < 16; i++)
+    {
+        in->coeff[i] = (OMX_S16)(RandRange(0, 1) ? RandRange(-512, 511)
+                                                 : RandRange(-32768, 32767));
+    }
+    if (RandRange(0, 3) == 0)
+    {
+        memset(&in->coeff[1], 0, 15 * sizeof(OMX_S16));
+    }
+    in->DC = (OMX_S16)RandRange(-4096, 4095);
+    in->QP = RandRange(0, 51);
+    in->AC = RandRange(0, 3) != 0;
+}
+
+static OMXResult RunKernel(const x86VCM4P10_Kernels *k, int kernel, Input *in)
+{
+    OMX_U8 *pSrc = in->src + BLOCK;
+    OMX_U8 *pDst = in->dst + BLOCK;
+    const OMX_U8 *pPairs = in->pairs;
+
+    switch (kernel)
+    {
+    case 0:
+        return k->InterpolateLuma(pSrc, STEP, pDst, STEP,
+                                  in->width, in->height, in->dx, in->dy);
+    case 1:
+        return k->InterpolateChroma(pSrc, STEP, pDst, STEP,
+                                    in->width, in->height, in->dx, in->dy);
+    case 2:
+        return k->FilterDeblockingLuma_VerEdge(pDst, STEP, in->alpha,
+                                               in->beta, in->thresholds, in->bS);
+    case 3:
+        return k->FilterDeblockingLuma_HorEdge(pDst, STEP, in->alpha,
+                                               in->beta, in->thresholds, in->bS);
+    case 4:
+        return k->FilterDeblockingChroma_VerEdge(pDst, STEP, in->alpha,
+                                                 in->beta, in->thresholds, in->bS);
+    case 5:
+        return k->FilterDeblockingChroma_HorEdge(pDst, STEP, in->alpha,
+                                                 in->beta, in->thresholds, in->bS);
+    case 6:
+        return k->DequantTransformResidualFromPairAndAdd(
+            &pPairs, pSrc, in->AC && RandRange(0, 1) ? NULL : &in->DC,
+            pDst, STEP, STEP, in->QP, in->AC);
+    default:
+        return k->InvTransformResidualAndAdd(pSrc, in->coeff, pDst,
+                                             STEP, STEP, (OMX_U8)in->AC);
+    }
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs every kernel of k on the same inputs as the reference */
+static int Check(const x86VCM4P10_Kernels *ref, const x86VCM4P10_Kernels *k,
+                 int iterations)
+{
+    static Input in, copy;
+    int kernel, i;
+
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++)
+    {
+        for (i = 0; i < iterations; i++)
+        {
+            OMXResult refResult, result;
+            OMX_U32 state;
+
+            RandomInput(&in, kernel);
+            copy = in;
+
+            /* Both calls must make the same random choices */
+            state = randState;
+            refResult = RunKernel(ref, kernel, &in);
+            randState = state;
+            result = RunKernel(k, kernel, &copy);
+
+            if (refResult != result || memcmp(in.dst, copy.dst, BUF_SIZE))
+            {
+                printf("%s: %s differs from %s in iteration %d\n",
+                       k->pName, kernelNames[kernel], ref->pName, i);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Time per call on a fixed input, in nanoseconds */
+static double Time(const x86VCM4P10_Kernels *k, int kernel, int iterations)
+{
+    static Input in[16];
+    double start;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        RandomInput(&in[i], kernel);
+        /* The whole-block cases are the common ones in real streams */
+        if (kernel == 0)
+        {
+            in[i].width = in[i].height = 16;
+        }
+        else if (kernel == 1)
+        {
+            in[i].width = in[i].height = 8;
+        }
+    }
+
+    start = Now();
+    for (i = 0; i < iterations; i++)
+    {
+        RunKernel(k, kernel, &in[i & 15]);
+    }
+
+    return (Now() - start) * 1e9 / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    static const OMX_U32 levels[3] =
+    {
+        0, X86COMM_CPU_SSE4_1, X86COMM_CPU_SSE4_1 | X86COMM_CPU_AVX2
+    };
+    const x86VCM4P10_Kernels *ref = x86VCM4P10_GetKernels(0);
+    const x86VCM4P10_Kernels *sets[3];
+    OMX_U32 features = x86COMM_GetCPUFeatures();
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    int numSets = 0;
+    int kernel, i;
+
+    randState = argc > 2 ? (OMX_U32)strtoul(argv[2], NULL, 0) : 1;
+
+    for (i = 0; i < 3; i++)
+    {
+        if ((levels[i] & features) == levels[i])
+        {
+            sets[numSets++] = x86VCM4P10_GetKernels(levels[i]);
+        }
+    }
+
+    for (i = 1; i < numSets; i++)
+    {
+        if (!Check(ref, sets[i], iterations))
+        {
+            return 1;
+        }
+        printf("%s: bit-exact with %s over %d calls per kernel\n",
+               sets[i]->pName, ref->pName, iterations);
+    }
+
+    printf("\n%-40s", "ns per call");
+    for (i = 0; i < numSets; i++)
+    {
+        printf("%10s", sets[i]->pName);
+    }
+    printf("\n");
+
+    for (kernel = 0; kernel < NUM_KERNELS; kernel++)
+    {
+        printf("%-40s", kernelNames[kernel]);
+        for (i = 0; i < numSets; i++)
+        {
+            printf("%10.1f", Time(sets[i], kernel, iterations * 10));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#!/bin/sh
+#
+# Copyright (C) 2009 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Decodes each stream with the DecTestBench "decoder" once per x86 kernel
+# set (STAGEFRIGHT_X86_CPU=c, sse41, avx2) and checks that the output is the
+# same. The decoder has to come from an eng build, others ignore the variable.
+# If a stream has a <stream>.yuv next to it, as the JVT conformance streams
+# do, the output must also match that.
+#
+# usage: x86VCM4P10_Conformance.sh stream.264 [stream.264 ...]
+#
+# DECODER names the decoder binary, "decoder" by default. With ADB set, the
+# streams are pushed to and decoded on the device in /data/local/tmp.
+
+DECODER=${DECODER:-decoder}
+TMP=${TMPDIR:-/tmp}/x86VCM4P10_Conformance.$$
+FAILED=0
+
+mkdir -p $TMP || exit 1
+trap 'rm -rf $TMP' EXIT
+
+# decode <stream> <cpu> <output>
+decode() {
+    if [ -n "$ADB" ]; then
+        $ADB push "$1" /data/local/tmp/stream.264 >/dev/null 2>&1 &&
+        $ADB shell "STAGEFRIGHT_X86_CPU=$2 $DECODER -O/data/local/tmp/out.yuv \
+            /data/local/tmp/stream.264" >/dev/null 2>&1 &&
+        $ADB pull /data/local/tmp/out.yuv "$3" >/dev/null 2>&1
+    else
+        STAGEFRIGHT_X86_CPU=$2 $DECODER -O"$3" "$1" >/dev/null 2>&1
+    fi
+}
+
+for stream in "$@"; do
+    ok=1
+    expected=
+    if [ -f "${stream%.*}.yuv" ]; then
+        expected=$(md5sum < "${stream%.*}.yuv")
+    fi
+
+    for cpu in c sse41 avx2; do
+        if ! decode "$stream" $cpu $TMP/$cpu.yuv; then
+            echo "FAIL $stream ($cpu): decoder failed"
+            ok=0
+            continue
+        fi
+        sum=$(md5sum < $TMP/$cpu.yuv)
+        expected=${expected:-$sum}
+
+        if [ "$sum" != "$expected" ]; then
+            echo "FAIL $stream ($cpu): output differs"
+            ok=0
+        fi
+    done
+
+    if [ $ok = 1 ]; then
+        echo "PASS $stream"
+    else
+        FAILED=1
+    fi
+done
+
+exit $FAILED
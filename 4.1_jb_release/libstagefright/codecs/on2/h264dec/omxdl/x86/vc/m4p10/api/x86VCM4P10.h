@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10.h
+ * Brief: x86 SIMD kernels behind the H.264 OpenMAX DL decoding primitives
+ *
+ * The reference C versions are renamed to *_C, the SSE4.1 and AVX2 versions
+ * carry the _SSE4 and _AVX2 suffixes. Every variant produces output that is
+ * bit-exact with the reference for all arguments the reference accepts.
+ *
+ * The SIMD variants do not check their arguments, the public entry points in
+ * x86VCM4P10_Dispatch.c do that before calling them.
+ */
+
+#ifndef _x86VCM4P10_H_
+#define _x86VCM4P10_H_
+
+#include "omxtypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same signature as armVCM4P10_Interpolate_Luma() */
+typedef OMXResult (*x86VCM4P10_InterpolateLumaFunc)(
+        const OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+
+/* Same signature as armVCM4P10_Interpolate_Chroma() */
+typedef OMXResult (*x86VCM4P10_InterpolateChromaFunc)(
+        OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+
+/* Same signature as the omxVCM4P10_FilterDeblocking*_I() family */
+typedef OMXResult (*x86VCM4P10_FilterDeblockingFunc)(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+
+/* Same signature as omxVCM4P10_DequantTransformResidualFromPairAndAdd() */
+typedef OMXResult (*x86VCM4P10_DequantTransformFunc)(
+        const OMX_U8 **ppSrc, const OMX_U8 *pPred, const OMX_S16 *pDC,
+        OMX_U8 *pDst, OMX_INT predStep, OMX_INT dstStep, OMX_INT QP,
+        OMX_INT AC);
+
+/* Same signature as omxVCM4P10_InvTransformResidualAndAdd() */
+typedef OMXResult (*x86VCM4P10_InvTransformFunc)(
+        const OMX_U8 *pSrcPred, const OMX_S16 *pDequantCoeff,
+        OMX_U8 *pDstRecon, OMX_U32 iSrcPredStep, OMX_U32 iDstReconStep,
+        OMX_U8 bAC);
+
+typedef struct
+{
+    const char *pName;
+
+    x86VCM4P10_InterpolateLumaFunc      InterpolateLuma;
+    x86VCM4P10_InterpolateChromaFunc    InterpolateChroma;
+    x86VCM4P10_FilterDeblockingFunc     FilterDeblockingLuma_VerEdge;
+    x86VCM4P10_FilterDeblockingFunc     FilterDeblockingLuma_HorEdge;
+    x86VCM4P10_FilterDeblockingFunc     FilterDeblockingChroma_VerEdge;
+    x86VCM4P10_FilterDeblockingFunc     FilterDeblockingChroma_HorEdge;
+    x86VCM4P10_DequantTransformFunc     DequantTransformResidualFromPairAndAdd;
+    x86VCM4P10_InvTransformFunc         InvTransformResidualAndAdd;
+
+} x86VCM4P10_Kernels;
+
+/**
+ * Function: x86VCM4P10_GetKernels
+ *
+ * Description:
+ * Returns the fastest set of kernels that needs no more than the given
+ * X86COMM_CPU_* extensions. 0 selects the reference C kernels.
+ *
+ */
+const x86VCM4P10_Kernels *x86VCM4P10_GetKernels(OMX_U32 features);
+
+/* Reference C, see x86VCM4P10_Reference.c */
+
+OMXResult x86VCM4P10_Interpolate_Luma_C(
+        const OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+OMXResult x86VCM4P10_Interpolate_Chroma_C(
+        OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+OMXResult x86VCM4P10_FilterDeblockingLuma_VerEdge_I_C(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingLuma_HorEdge_I_C(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingChroma_VerEdge_I_C(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingChroma_HorEdge_I_C(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_DequantTransformResidualFromPairAndAdd_C(
+        const OMX_U8 **ppSrc, const OMX_U8 *pPred, const OMX_S16 *pDC,
+        OMX_U8 *pDst, OMX_INT predStep, OMX_INT dstStep, OMX_INT QP,
+        OMX_INT AC);
+OMXResult x86VCM4P10_InvTransformResidualAndAdd_C(
+        const OMX_U8 *pSrcPred, const OMX_S16 *pDequantCoeff,
+        OMX_U8 *pDstRecon, OMX_U32 iSrcPredStep, OMX_U32 iDstReconStep,
+        OMX_U8 bAC);
+
+/* SSE4.1, built with -msse4.1 */
+
+OMXResult x86VCM4P10_Interpolate_Luma_SSE4(
+        const OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+OMXResult x86VCM4P10_Interpolate_Chroma_SSE4(
+        OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+OMXResult x86VCM4P10_FilterDeblockingLuma_VerEdge_I_SSE4(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingLuma_HorEdge_I_SSE4(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingChroma_VerEdge_I_SSE4(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingChroma_HorEdge_I_SSE4(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_DequantTransformResidualFromPairAndAdd_SSE4(
+        const OMX_U8 **ppSrc, const OMX_U8 *pPred, const OMX_S16 *pDC,
+        OMX_U8 *pDst, OMX_INT predStep, OMX_INT dstStep, OMX_INT QP,
+        OMX_INT AC);
+OMXResult x86VCM4P10_InvTransformResidualAndAdd_SSE4(
+        const OMX_U8 *pSrcPred, const OMX_S16 *pDequantCoeff,
+        OMX_U8 *pDstRecon, OMX_U32 iSrcPredStep, OMX_U32 iDstReconStep,
+        OMX_U8 bAC);
+
+/* AVX2, built with -mavx2. Only the kernels that work on 16 pixel wide
+ * blocks gain from the wider registers, the others use the SSE4.1 ones. */
+
+OMXResult x86VCM4P10_Interpolate_Luma_AVX2(
+        const OMX_U8 *pSrc, OMX_U32 iSrcStep, OMX_U8 *pDst, OMX_U32 iDstStep,
+        OMX_U32 iWidth, OMX_U32 iHeight, OMX_U32 dx, OMX_U32 dy);
+OMXResult x86VCM4P10_FilterDeblockingLuma_VerEdge_I_AVX2(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+OMXResult x86VCM4P10_FilterDeblockingLuma_HorEdge_I_AVX2(
+        OMX_U8 *pSrcDst, OMX_S32 srcdstStep, const OMX_U8 *pAlpha,
+        const OMX_U8 *pBeta, const OMX_U8 *pThresholds, const OMX_U8 *pBS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _x86VCM4P10_H_ */
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Deblocking_AVX2.c
+ * Brief: AVX2 luma deblocking filters
+ *
+ * The luma filter of x86VCM4P10_Deblocking_SSE4.c on sixteen lanes, so that
+ * a whole 16 pixel edge is one pass. For vertical edges rows 0-7 sit in the
+ * low and rows 8-15 in the high 128-bit half, which lets the 8x8 transpose
+ * run on both halves at once.
+ */
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "omxtypes.h"
+#include "armCOMM.h"
+
+#include "x86VCM4P10.h"
+
+/* Pixels across the edge, p3 first */
+enum { P3, P2, P1, P0, Q0, Q1, Q2, Q3 };
+
+static inline __m256i x86_Clip(__m256i x, __m256i lo, __m256i hi)
+{
+    return _mm256_min_epi16(_mm256_max_epi16(x, lo), hi);
+}
+
+static inline __m256i x86_Avg(__m256i sum, __m256i round, int shift)
+{
+    return _mm256_srai_epi16(_mm256_add_epi16(sum, round), shift);
+}
+
+/* armVCM4P10_DeBlockPixel() for luma on sixteen lanes */
+static void x86_DeBlockLuma(
+    __m256i px[8], __m256i bS, __m256i tC0, int alpha, int beta)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i two = _mm256_set1_epi16(2);
+    const __m256i four = _mm256_set1_epi16(4);
+    const __m256i vBeta = _mm256_set1_epi16((OMX_S16)beta);
+    __m256i p3 = px[P3], p2 = px[P2], p1 = px[P1], p0 = px[P0];
+    __m256i q0 = px[Q0], q1 = px[Q1], q2 = px[Q2], q3 = px[Q3];
+    __m256i absPQ, filter, strong, ap, aq, tC, negTC0, delta, avg, d, pq;
+    __m256i sp, sq, p0n, p1n, q0n, q1n, p0s, p1s, p2s, q0s, q1s, q2s;
+
+    absPQ = _mm256_abs_epi16(_mm256_sub_epi16(p0, q0));
+    filter = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_cmpgt_epi16(_mm256_set1_epi16((OMX_S16)alpha), absPQ),
+            _mm256_cmpgt_epi16(bS, zero)),
+        _mm256_and_si256(
+            _mm256_cmpgt_epi16(vBeta, _mm256_abs_epi16(_mm256_sub_epi16(p1, p0))),
+            _mm256_cmpgt_epi16(vBeta, _mm256_abs_epi16(_mm256_sub_epi16(q1, q0)))));
+
+    if (_mm256_testz_si256(filter, filter))
+    {
+        return;
+    }
+
+    strong = _mm256_cmpeq_epi16(bS, four);
+    ap = _mm256_cmpgt_epi16(vBeta, _mm256_abs_epi16(_mm256_sub_epi16(p2, p0)));
+    aq = _mm256_cmpgt_epi16(vBeta, _mm256_abs_epi16(_mm256_sub_epi16(q2, q0)));
+    pq = _mm256_add_epi16(p0, q0);
+
+    /* bS < 4, ap and aq are -1 where set */
+    tC = _mm256_sub_epi16(_mm256_sub_epi16(tC0, ap), aq);
+    negTC0 = _mm256_sub_epi16(zero, tC0);
+
+    delta = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(
+        _mm256_slli_epi16(_mm256_sub_epi16(q0, p0), 2),
+        _mm256_sub_epi16(p1, q1)), four), 3);
+    delta = x86_Clip(delta, _mm256_sub_epi16(zero, tC), tC);
+    p0n = _mm256_add_epi16(p0, delta);
+    q0n = _mm256_sub_epi16(q0, delta);
+
+    avg = x86_Avg(pq, _mm256_set1_epi16(1), 1);
+    d = _mm256_srai_epi16(_mm256_sub_epi16(_mm256_add_epi16(p2, avg),
+                                           _mm256_add_epi16(p1, p1)), 1);
+    p1n = _mm256_blendv_epi8(
+        p1, _mm256_add_epi16(p1, x86_Clip(d, negTC0, tC0)), ap);
+    d = _mm256_srai_epi16(_mm256_sub_epi16(_mm256_add_epi16(q2, avg),
+                                           _mm256_add_epi16(q1, q1)), 1);
+    q1n = _mm256_blendv_epi8(
+        q1, _mm256_add_epi16(q1, x86_Clip(d, negTC0, tC0)), aq);
+
+    /* bS == 4 */
+    sp = _mm256_cmpgt_epi16(
+        _mm256_set1_epi16((OMX_S16)((alpha >> 2) + 2)), absPQ);
+    sq = _mm256_and_si256(sp, aq);
+    sp = _mm256_and_si256(sp, ap);
+
+    p0s = _mm256_blendv_epi8(
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(p1, p1),
+                                 _mm256_add_epi16(p0, q1)), two, 2),
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(p2, q1),
+                _mm256_slli_epi16(_mm256_add_epi16(p1, pq), 1)), four, 3),
+        sp);
+    p1s = _mm256_blendv_epi8(p1,
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(p2, p1), pq), two, 2),
+        sp);
+    p2s = _mm256_blendv_epi8(p2,
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(p3, 1),
+                _mm256_mullo_epi16(p2, _mm256_set1_epi16(3))),
+                _mm256_add_epi16(p1, pq)), four, 3),
+        sp);
+
+    q0s = _mm256_blendv_epi8(
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(q1, q1),
+                                 _mm256_add_epi16(q0, p1)), two, 2),
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(q2, p1),
+                _mm256_slli_epi16(_mm256_add_epi16(q1, pq), 1)), four, 3),
+        sq);
+    q1s = _mm256_blendv_epi8(q1,
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(q2, q1), pq), two, 2),
+        sq);
+    q2s = _mm256_blendv_epi8(q2,
+        x86_Avg(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(q3, 1),
+                _mm256_mullo_epi16(q2, _mm256_set1_epi16(3))),
+                _mm256_add_epi16(q1, pq)), four, 3),
+        sq);
+
+    /* The packing back to bytes clips p0 and q0 to [0,255] */
+    px[P2] = _mm256_blendv_epi8(p2, _mm256_blendv_epi8(p2, p2s, strong), filter);
+    px[P1] = _mm256_blendv_epi8(p1, _mm256_blendv_epi8(p1n, p1s, strong), filter);
+    px[P0] = _mm256_blendv_epi8(p0, _mm256_blendv_epi8(p0n, p0s, strong), filter);
+    px[Q0] = _mm256_blendv_epi8(q0, _mm256_blendv_epi8(q0n, q0s, strong), filter);
+    px[Q1] = _mm256_blendv_epi8(q1, _mm256_blendv_epi8(q1n, q1s, strong), filter);
+    px[Q2] = _mm256_blendv_epi8(q2, _mm256_blendv_epi8(q2, q2s, strong), filter);
+}
+
+/* Each of four bS or threshold bytes spread over four lanes */
+static inline __m256i x86_Spread(const OMX_U8 *p)
+{
+    const __m128i index = _mm_set_epi8(3, 3, 3, 3, 2, 2, 2, 2,
+                                       1, 1, 1, 1, 0, 0, 0, 0);
+    OMX_S32 v;
+
+    memcpy(&v, p, sizeof(v));
+    return _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_cvtsi32_si128(v), index));
+}
+
+/* 8x8 transpose of 16-bit lanes in each 128-bit half */
+static inline void x86_Transpose8x8x2(__m256i r[8])
+{
+    __m256i a0 = _mm256_unpacklo_epi16(r[0], r[1]);
+    __m256i a1 = _mm256_unpackhi_epi16(r[0], r[1]);
+    __m256i a2 = _mm256_unpacklo_epi16(r[2], r[3]);
+    __m256i a3 = _mm256_unpackhi_epi16(r[2], r[3]);
+    __m256i a4 = _mm256_unpacklo_epi16(r[4], r[5]);
+    __m256i a5 = _mm256_unpackhi_epi16(r[4], r[5]);
+    __m256i a6 = _mm256_unpacklo_epi16(r[6], r[7]);
+    __m256i a7 = _mm256_unpackhi_epi16(r[6], r[7]);
+    __m256i b0 = _mm256_unpacklo_epi32(a0, a2);
+    __m256i b1 = _mm256_unpackhi_epi32(a0, a2);
+    __m256i b2 = _mm256_unpacklo_epi32(a1, a3);
+    __m256i b3 = _mm256_unpackhi_epi32(a1, a3);
+    __m256i b4 = _mm256_unpacklo_epi32(a4, a6);
+    __m256i b5 = _mm256_unpackhi_epi32(a4, a6);
+    __m256i b6 = _mm256_unpacklo_epi32(a5, a7);
+    __m256i b7 = _mm256_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm256_unpacklo_epi64(b0, b4);
+    r[1] = _mm256_unpackhi_epi64(b0, b4);
+    r[2] = _mm256_unpacklo_epi64(b1, b5);
+    r[3] = _mm256_unpackhi_epi64(b1, b5);
+    r[4] = _mm256_unpacklo_epi64(b2, b6);
+    r[5] = _mm256_unpackhi_epi64(b2, b6);
+    r[6] = _mm256_unpacklo_epi64(b3, b7);
+    r[7] = _mm256_unpackhi_epi64(b3, b7);
+}
+
+static inline int x86_EdgeHasBS(const OMX_U8 *pBS)
+{
+    return pBS[0] | pBS[1] | pBS[2] | pBS[3];
+}
+
+OMXResult x86VCM4P10_FilterDeblockingLuma_VerEdge_I_AVX2(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int X, i, Internal = 0;
+
+    for (X = 0; X < 16; X += 4, Internal = 1)
+    {
+        OMX_U8 *pQ0 = pSrcDst + X - 4;
+        __m256i px[8];
+
+        if (!x86_EdgeHasBS(pBS + X))
+        {
+            continue;
+        }
+
+        for (i = 0; i < 8; i++)
+        {
+            px[i] = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i *)(pQ0 + i * srcdstStep)),
+                _mm_loadl_epi64((const __m128i *)(pQ0 + (i + 8) * srcdstStep))));
+        }
+        x86_Transpose8x8x2(px);
+
+        x86_DeBlockLuma(px, x86_Spread(pBS + X), x86_Spread(pThresholds + X),
+                        pAlpha[Internal], pBeta[Internal]);
+
+        x86_Transpose8x8x2(px);
+        for (i = 0; i < 8; i++)
+        {
+            __m128i rows = _mm_packus_epi16(_mm256_castsi256_si128(px[i]),
+                                            _mm256_extracti128_si256(px[i], 1));
+
+            _mm_storel_epi64((__m128i *)(pQ0 + i * srcdstStep), rows);
+            _mm_storeh_pd((double *)(pQ0 + (i + 8) * srcdstStep),
+                          _mm_castsi128_pd(rows));
+        }
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+OMXResult x86VCM4P10_FilterDeblockingLuma_HorEdge_I_AVX2(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int Y, i, Internal = 0;
+
+    for (Y = 0; Y < 16; Y += 4, Internal = 1)
+    {
+        OMX_U8 *pP3 = pSrcDst + (Y - 4) * srcdstStep;
+        __m256i px[8];
+
+        if (!x86_EdgeHasBS(pBS + Y))
+        {
+            continue;
+        }
+
+        for (i = 0; i < 8; i++)
+        {
+            px[i] = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *)(pP3 + i * srcdstStep)));
+        }
+
+        x86_DeBlockLuma(px, x86_Spread(pBS + Y), x86_Spread(pThresholds + Y),
+                        pAlpha[Internal], pBeta[Internal]);
+
+        for (i = P2; i <= Q2; i++)
+        {
+            _mm_storeu_si128((__m128i *)(pP3 + i * srcdstStep),
+                             _mm_packus_epi16(_mm256_castsi256_si128(px[i]),
+                                              _mm256_extracti128_si256(px[i], 1)));
+        }
+    }
+
+    return OMX_Sts_NoErr;
+}
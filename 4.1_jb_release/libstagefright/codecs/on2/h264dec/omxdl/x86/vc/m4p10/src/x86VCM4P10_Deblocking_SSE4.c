@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Deblocking_SSE4.c
+ * Brief: SSE4.1 luma and chroma deblocking filters
+ *
+ * armVCM4P10_DeBlockPixel() on eight 16-bit lanes at a time, one lane per
+ * pixel along the edge. Vertical edges are transposed into columns first.
+ * Edges are filtered in the same order as the reference since each one
+ * reads pixels the previous one wrote.
+ */
+
+#include <smmintrin.h>
+
+#include "omxtypes.h"
+#include "armCOMM.h"
+
+#include "x86VCM4P10.h"
+#include "x86VCM4P10_SSE4.h"
+
+/* Pixels across the edge, p3 first */
+enum { P3, P2, P1, P0, Q0, Q1, Q2, Q3 };
+
+static inline __m128i x86_Clip(__m128i x, __m128i lo, __m128i hi)
+{
+    return _mm_min_epi16(_mm_max_epi16(x, lo), hi);
+}
+
+/*
+ * Filters the pixels of eight lanes. bS and tC0 hold the strength and the
+ * threshold of each lane.
+ */
+static void x86_DeBlockPixels(
+    __m128i px[8], __m128i bS, __m128i tC0,
+    int alpha, int beta, int ChromaFlag)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i four = _mm_set1_epi16(4);
+    const __m128i vBeta = _mm_set1_epi16((OMX_S16)beta);
+    __m128i p2 = px[P2], p1 = px[P1], p0 = px[P0];
+    __m128i q0 = px[Q0], q1 = px[Q1], q2 = px[Q2];
+    __m128i absPQ, filter, strong, tC, delta, p0n, q0n, p0s, q0s;
+
+    absPQ = _mm_abs_epi16(_mm_sub_epi16(p0, q0));
+    filter = _mm_and_si128(
+        _mm_and_si128(_mm_cmpgt_epi16(_mm_set1_epi16((OMX_S16)alpha), absPQ),
+                      _mm_cmpgt_epi16(bS, zero)),
+        _mm_and_si128(
+            _mm_cmpgt_epi16(vBeta, _mm_abs_epi16(_mm_sub_epi16(p1, p0))),
+            _mm_cmpgt_epi16(vBeta, _mm_abs_epi16(_mm_sub_epi16(q1, q0)))));
+
+    if (_mm_testz_si128(filter, filter))
+    {
+        return;
+    }
+
+    strong = _mm_cmpeq_epi16(bS, four);
+
+    /* bS < 4 */
+    delta = _mm_srai_epi16(
+        _mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2),
+                                    _mm_sub_epi16(p1, q1)),
+                      four), 3);
+
+    if (ChromaFlag)
+    {
+        tC = _mm_add_epi16(tC0, _mm_set1_epi16(1));
+        delta = x86_Clip(delta, _mm_sub_epi16(zero, tC), tC);
+        p0n = _mm_add_epi16(p0, delta);
+        q0n = _mm_sub_epi16(q0, delta);
+
+        /* bS == 4 */
+        p0s = _mm_srai_epi16(_mm_add_epi16(
+            _mm_add_epi16(_mm_add_epi16(p1, p1), _mm_add_epi16(p0, q1)), two), 2);
+        q0s = _mm_srai_epi16(_mm_add_epi16(
+            _mm_add_epi16(_mm_add_epi16(q1, q1), _mm_add_epi16(q0, p1)), two), 2);
+    }
+    else
+    {
+        __m128i p3 = px[P3], q3 = px[Q3];
+        __m128i ap = _mm_cmpgt_epi16(vBeta, _mm_abs_epi16(_mm_sub_epi16(p2, p0)));
+        __m128i aq = _mm_cmpgt_epi16(vBeta, _mm_abs_epi16(_mm_sub_epi16(q2, q0)));
+        __m128i negTC0 = _mm_sub_epi16(zero, tC0);
+        __m128i avg = _mm_srai_epi16(
+            _mm_add_epi16(_mm_add_epi16(p0, q0), _mm_set1_epi16(1)), 1);
+        __m128i d, p1n, q1n, sp, sq, pq, p1s, p2s, q1s, q2s;
+
+        /* ap and aq are -1 where set */
+        tC = _mm_sub_epi16(_mm_sub_epi16(tC0, ap), aq);
+        delta = x86_Clip(delta, _mm_sub_epi16(zero, tC), tC);
+        p0n = _mm_add_epi16(p0, delta);
+        q0n = _mm_sub_epi16(q0, delta);
+
+        d = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(p2, avg),
+                                         _mm_add_epi16(p1, p1)), 1);
+        p1n = _mm_blendv_epi8(p1, _mm_add_epi16(p1, x86_Clip(d, negTC0, tC0)), ap);
+        d = _mm_srai_epi16(_mm_sub_epi16(_mm_add_epi16(q2, avg),
+                                         _mm_add_epi16(q1, q1)), 1);
+        q1n = _mm_blendv_epi8(q1, _mm_add_epi16(q1, x86_Clip(d, negTC0, tC0)), aq);
+
+        /* bS == 4 */
+        sp = _mm_cmpgt_epi16(_mm_set1_epi16((OMX_S16)((alpha >> 2) + 2)), absPQ);
+        sq = _mm_and_si128(sp, aq);
+        sp = _mm_and_si128(sp, ap);
+        pq = _mm_add_epi16(p0, q0);
+
+        p0s = _mm_blendv_epi8(
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(p1, p1), _mm_add_epi16(p0, q1)), two), 2),
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(p2, q1), _mm_slli_epi16(_mm_add_epi16(p1, pq), 1)),
+                four), 3),
+            sp);
+        p1s = _mm_blendv_epi8(p1,
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(p2, p1), pq), two), 2),
+            sp);
+        p2s = _mm_blendv_epi8(p2,
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(_mm_slli_epi16(p3, 1), _mm_mullo_epi16(p2, _mm_set1_epi16(3))),
+                _mm_add_epi16(p1, pq)), four), 3),
+            sp);
+
+        q0s = _mm_blendv_epi8(
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(q1, q1), _mm_add_epi16(q0, p1)), two), 2),
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(q2, p1), _mm_slli_epi16(_mm_add_epi16(q1, pq), 1)),
+                four), 3),
+            sq);
+        q1s = _mm_blendv_epi8(q1,
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(q2, q1), pq), two), 2),
+            sq);
+        q2s = _mm_blendv_epi8(q2,
+            _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(
+                _mm_add_epi16(_mm_slli_epi16(q3, 1), _mm_mullo_epi16(q2, _mm_set1_epi16(3))),
+                _mm_add_epi16(q1, pq)), four), 3),
+            sq);
+
+        px[P2] = _mm_blendv_epi8(p2, _mm_blendv_epi8(p2, p2s, strong), filter);
+        px[P1] = _mm_blendv_epi8(p1, _mm_blendv_epi8(p1n, p1s, strong), filter);
+        px[Q1] = _mm_blendv_epi8(q1, _mm_blendv_epi8(q1n, q1s, strong), filter);
+        px[Q2] = _mm_blendv_epi8(q2, _mm_blendv_epi8(q2, q2s, strong), filter);
+    }
+
+    /* The packing back to bytes clips p0 and q0 to [0,255] */
+    px[P0] = _mm_blendv_epi8(p0, _mm_blendv_epi8(p0n, p0s, strong), filter);
+    px[Q0] = _mm_blendv_epi8(q0, _mm_blendv_epi8(q0n, q0s, strong), filter);
+}
+
+/*
+ * Spreads four bytes of a bS or threshold table over the lanes: each byte
+ * to four lanes for luma, to two lanes for chroma.
+ */
+static inline __m128i x86_Spread(const OMX_U8 *p, int first, int perByte)
+{
+    OMX_S8 index[16];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        index[2 * i] = (OMX_S8)(first + i / perByte);
+        index[2 * i + 1] = -1;
+    }
+
+    return _mm_shuffle_epi8(x86_Load4(p),
+                            _mm_loadu_si128((const __m128i *)index));
+}
+
+/* 8x8 transpose of 16-bit lanes */
+static inline void x86_Transpose8x8(__m128i r[8])
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/* Vertical edge with q0 at column 0 of pQ0, over eight rows */
+static void x86_FilterVerEdge8(
+    OMX_U8 *pQ0, OMX_S32 step, __m128i bS, __m128i tC0,
+    int alpha, int beta, int ChromaFlag)
+{
+    __m128i px[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        px[i] = x86_Load8x16(pQ0 + i * step - 4);
+    }
+    x86_Transpose8x8(px);
+
+    x86_DeBlockPixels(px, bS, tC0, alpha, beta, ChromaFlag);
+
+    x86_Transpose8x8(px);
+    for (i = 0; i < 8; i++)
+    {
+        _mm_storel_epi64((__m128i *)(pQ0 + i * step - 4),
+                         _mm_packus_epi16(px[i], px[i]));
+    }
+}
+
+/* Horizontal edge with q0 on the row of pQ0, over eight columns */
+static void x86_FilterHorEdge8(
+    OMX_U8 *pQ0, OMX_S32 step, __m128i bS, __m128i tC0,
+    int alpha, int beta, int ChromaFlag)
+{
+    __m128i px[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        px[i] = x86_Load8x16(pQ0 + (i - 4) * step);
+    }
+
+    x86_DeBlockPixels(px, bS, tC0, alpha, beta, ChromaFlag);
+
+    for (i = ChromaFlag ? P0 : P2; i <= (ChromaFlag ? Q0 : Q2); i++)
+    {
+        _mm_storel_epi64((__m128i *)(pQ0 + (i - 4) * step),
+                         _mm_packus_epi16(px[i], px[i]));
+    }
+}
+
+static inline int x86_EdgeHasBS(const OMX_U8 *pBS)
+{
+    return pBS[0] | pBS[1] | pBS[2] | pBS[3];
+}
+
+OMXResult x86VCM4P10_FilterDeblockingLuma_VerEdge_I_SSE4(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int X, Internal = 0;
+
+    for (X = 0; X < 16; X += 4, Internal = 1)
+    {
+        const OMX_U8 *pEdgeBS = pBS + X;
+        const OMX_U8 *pEdgeTC0 = pThresholds + X;
+
+        if (!x86_EdgeHasBS(pEdgeBS))
+        {
+            continue;
+        }
+
+        x86_FilterVerEdge8(pSrcDst + X, srcdstStep,
+                           x86_Spread(pEdgeBS, 0, 4), x86_Spread(pEdgeTC0, 0, 4),
+                           pAlpha[Internal], pBeta[Internal], 0);
+        x86_FilterVerEdge8(pSrcDst + 8 * srcdstStep + X, srcdstStep,
+                           x86_Spread(pEdgeBS, 2, 4), x86_Spread(pEdgeTC0, 2, 4),
+                           pAlpha[Internal], pBeta[Internal], 0);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+OMXResult x86VCM4P10_FilterDeblockingLuma_HorEdge_I_SSE4(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int Y, Internal = 0;
+
+    for (Y = 0; Y < 16; Y += 4, Internal = 1)
+    {
+        const OMX_U8 *pEdgeBS = pBS + Y;
+        const OMX_U8 *pEdgeTC0 = pThresholds + Y;
+        OMX_U8 *pQ0 = pSrcDst + Y * srcdstStep;
+
+        if (!x86_EdgeHasBS(pEdgeBS))
+        {
+            continue;
+        }
+
+        x86_FilterHorEdge8(pQ0, srcdstStep,
+                           x86_Spread(pEdgeBS, 0, 4), x86_Spread(pEdgeTC0, 0, 4),
+                           pAlpha[Internal], pBeta[Internal], 0);
+        x86_FilterHorEdge8(pQ0 + 8, srcdstStep,
+                           x86_Spread(pEdgeBS, 2, 4), x86_Spread(pEdgeTC0, 2, 4),
+                           pAlpha[Internal], pBeta[Internal], 0);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+/*
+ * For chroma the bS of the second edge is at pBS[8], its thresholds are at
+ * pThresholds[4].
+ */
+OMXResult x86VCM4P10_FilterDeblockingChroma_VerEdge_I_SSE4(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int X, Internal = 0;
+
+    for (X = 0; X < 8; X += 4, Internal = 1)
+    {
+        const OMX_U8 *pEdgeBS = pBS + 2 * X;
+
+        if (!x86_EdgeHasBS(pEdgeBS))
+        {
+            continue;
+        }
+
+        x86_FilterVerEdge8(pSrcDst + X, srcdstStep,
+                           x86_Spread(pEdgeBS, 0, 2),
+                           x86_Spread(pThresholds + X, 0, 2),
+                           pAlpha[Internal], pBeta[Internal], 1);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+OMXResult x86VCM4P10_FilterDeblockingChroma_HorEdge_I_SSE4(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int Y, Internal = 0;
+
+    for (Y = 0; Y < 8; Y += 4, Internal = 1)
+    {
+        const OMX_U8 *pEdgeBS = pBS + 2 * Y;
+
+        if (!x86_EdgeHasBS(pEdgeBS))
+        {
+            continue;
+        }
+
+        x86_FilterHorEdge8(pSrcDst + Y * srcdstStep, srcdstStep,
+                           x86_Spread(pEdgeBS, 0, 2),
+                           x86_Spread(pThresholds + Y, 0, 2),
+                           pAlpha[Internal], pBeta[Internal], 1);
+    }
+
+    return OMX_Sts_NoErr;
+}
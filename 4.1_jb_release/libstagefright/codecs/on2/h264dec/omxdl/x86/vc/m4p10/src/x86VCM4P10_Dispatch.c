@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Dispatch.c
+ * Brief: Entry points of the x86 OpenMAX DL backend
+ *
+ * Each entry point checks its arguments exactly like the reference version
+ * does and then calls the kernel picked for this CPU the first time any of
+ * them runs. Block sizes the SIMD kernels are not written for, and bS or
+ * threshold tables the reference rejects halfway through filtering, go to the
+ * reference kernels so that the result stays the same.
+ */
+
+#include <pthread.h>
+
+#include "omxtypes.h"
+#include "armOMX.h"
+#include "omxVC.h"
+
+#include "armCOMM.h"
+#include "armVC.h"
+
+#include "x86COMM.h"
+#include "x86VCM4P10.h"
+
+static const x86VCM4P10_Kernels x86VCM4P10_KernelsC =
+{
+    "c",
+    x86VCM4P10_Interpolate_Luma_C,
+    x86VCM4P10_Interpolate_Chroma_C,
+    x86VCM4P10_FilterDeblockingLuma_VerEdge_I_C,
+    x86VCM4P10_FilterDeblockingLuma_HorEdge_I_C,
+    x86VCM4P10_FilterDeblockingChroma_VerEdge_I_C,
+    x86VCM4P10_FilterDeblockingChroma_HorEdge_I_C,
+    x86VCM4P10_DequantTransformResidualFromPairAndAdd_C,
+    x86VCM4P10_InvTransformResidualAndAdd_C,
+};
+
+static const x86VCM4P10_Kernels x86VCM4P10_KernelsSSE4 =
+{
+    "sse4",
+    x86VCM4P10_Interpolate_Luma_SSE4,
+    x86VCM4P10_Interpolate_Chroma_SSE4,
+    x86VCM4P10_FilterDeblockingLuma_VerEdge_I_SSE4,
+    x86VCM4P10_FilterDeblockingLuma_HorEdge_I_SSE4,
+    x86VCM4P10_FilterDeblockingChroma_VerEdge_I_SSE4,
+    x86VCM4P10_FilterDeblockingChroma_HorEdge_I_SSE4,
+    x86VCM4P10_DequantTransformResidualFromPairAndAdd_SSE4,
+    x86VCM4P10_InvTransformResidualAndAdd_SSE4,
+};
+
+static const x86VCM4P10_Kernels x86VCM4P10_KernelsAVX2 =
+{
+    "avx2",
+    x86VCM4P10_Interpolate_Luma_AVX2,
+    x86VCM4P10_Interpolate_Chroma_SSE4,
+    x86VCM4P10_FilterDeblockingLuma_VerEdge_I_AVX2,
+    x86VCM4P10_FilterDeblockingLuma_HorEdge_I_AVX2,
+    x86VCM4P10_FilterDeblockingChroma_VerEdge_I_SSE4,
+    x86VCM4P10_FilterDeblockingChroma_HorEdge_I_SSE4,
+    x86VCM4P10_DequantTransformResidualFromPairAndAdd_SSE4,
+    x86VCM4P10_InvTransformResidualAndAdd_SSE4,
+};
+
+static pthread_once_t x86VCM4P10_Once = PTHREAD_ONCE_INIT;
+static const x86VCM4P10_Kernels *x86VCM4P10_Selected;
+
+const x86VCM4P10_Kernels *x86VCM4P10_GetKernels(OMX_U32 features)
+{
+    if (features & X86COMM_CPU_AVX2)
+    {
+        return &x86VCM4P10_KernelsAVX2;
+    }
+    if (features & X86COMM_CPU_SSE4_1)
+    {
+        return &x86VCM4P10_KernelsSSE4;
+    }
+    return &x86VCM4P10_KernelsC;
+}
+
+static void x86VCM4P10_SelectKernels(void)
+{
+    x86VCM4P10_Selected = x86VCM4P10_GetKernels(x86COMM_GetCPUFeatures());
+}
+
+static const x86VCM4P10_Kernels *x86VCM4P10_CPUKernels(void)
+{
+    pthread_once(&x86VCM4P10_Once, x86VCM4P10_SelectKernels);
+
+    return x86VCM4P10_Selected;
+}
+
+/*
+ * Returns OMX_Sts_BadArgErr if the reference version would reject the bS
+ * values of a luma vertical edge.
+ */
+static OMXResult x86VCM4P10_CheckLumaVerEdge(
+    const OMX_U8 *pThresholds,
+    const OMX_U8 *pBS
+)
+{
+    int Y;
+
+    for (Y = 0; Y < 16; Y++)
+    {
+        armRetArgErrIf(pBS[Y] > 4, OMX_Sts_BadArgErr);
+        armRetArgErrIf((pBS[Y] == 4) && (Y > 3), OMX_Sts_BadArgErr);
+        armRetArgErrIf((pBS[Y] == 4) && (pBS[Y^3] != 4), OMX_Sts_BadArgErr);
+        armRetArgErrIf(pThresholds[Y] > 25, OMX_Sts_BadArgErr);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+/*
+ * Returns OMX_Sts_BadArgErr if the reference version would reject the bS
+ * values of the edges that use pBS[Base..Base+Count-1], for horizontal edges
+ * (Pair 1) or chroma vertical edges (Pair 3).
+ */
+static OMXResult x86VCM4P10_CheckBS(
+    const OMX_U8 *pBS,
+    int Base,
+    int Count,
+    int Pair
+)
+{
+    int I;
+
+    for (I = Base; I < Base + Count; I++)
+    {
+        armRetArgErrIf(pBS[I] > 4, OMX_Sts_BadArgErr);
+        armRetArgErrIf((I > 3) && (pBS[I] == 4), OMX_Sts_BadArgErr);
+        armRetArgErrIf((I < 4) && (pBS[I] == 4) && (pBS[I^Pair] != 4),
+                       OMX_Sts_BadArgErr);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+OMXResult armVCM4P10_Interpolate_Luma(
+     const OMX_U8     *pSrc,
+     OMX_U32    iSrcStep,
+     OMX_U8     *pDst,
+     OMX_U32    iDstStep,
+     OMX_U32    iWidth,
+     OMX_U32    iHeight,
+     OMX_U32    dx,
+     OMX_U32    dy
+)
+{
+    armRetArgErrIf(pSrc == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(pDst == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(dx > 3, OMX_Sts_BadArgErr)
+    armRetArgErrIf(dy > 3, OMX_Sts_BadArgErr)
+
+    if ((iWidth != 4 && iWidth != 8 && iWidth != 16) || iHeight > 16)
+    {
+        return x86VCM4P10_Interpolate_Luma_C(
+            pSrc, iSrcStep, pDst, iDstStep, iWidth, iHeight, dx, dy);
+    }
+
+    return x86VCM4P10_CPUKernels()->InterpolateLuma(
+        pSrc, iSrcStep, pDst, iDstStep, iWidth, iHeight, dx, dy);
+}
+
+OMXResult armVCM4P10_Interpolate_Chroma(
+        OMX_U8      *pSrc,
+        OMX_U32     iSrcStep,
+        OMX_U8      *pDst,
+        OMX_U32     iDstStep,
+        OMX_U32     iWidth,
+        OMX_U32     iHeight,
+        OMX_U32     dx,
+        OMX_U32     dy
+)
+{
+    armRetArgErrIf(pSrc == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(pDst == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(dx > 7, OMX_Sts_BadArgErr)
+    armRetArgErrIf(dy > 7, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iSrcStep == 0, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iDstStep == 0, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iWidth == 0, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iHeight == 0, OMX_Sts_BadArgErr)
+
+    if (iWidth != 2 && iWidth != 4 && iWidth != 8)
+    {
+        return x86VCM4P10_Interpolate_Chroma_C(
+            pSrc, iSrcStep, pDst, iDstStep, iWidth, iHeight, dx, dy);
+    }
+
+    return x86VCM4P10_CPUKernels()->InterpolateChroma(
+        pSrc, iSrcStep, pDst, iDstStep, iWidth, iHeight, dx, dy);
+}
+
+OMXResult omxVCM4P10_FilterDeblockingLuma_VerEdge_I(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    armRetArgErrIf(pSrcDst == NULL,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot16ByteAligned(pSrcDst),OMX_Sts_BadArgErr);
+    armRetArgErrIf(srcdstStep & 15,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(pAlpha == NULL,              OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta == NULL,               OMX_Sts_BadArgErr);
+    armRetArgErrIf(pThresholds == NULL,         OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pThresholds), OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBS == NULL,                     OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pBS),         OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta[0] > 18,  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta[1] > 18,  OMX_Sts_BadArgErr);
+
+    if (x86VCM4P10_CheckLumaVerEdge(pThresholds, pBS) != OMX_Sts_NoErr)
+    {
+        return x86VCM4P10_FilterDeblockingLuma_VerEdge_I_C(
+            pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+    }
+
+    return x86VCM4P10_CPUKernels()->FilterDeblockingLuma_VerEdge(
+        pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+}
+
+OMXResult omxVCM4P10_FilterDeblockingLuma_HorEdge_I(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    armRetArgErrIf(pSrcDst == NULL,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot8ByteAligned(pSrcDst), OMX_Sts_BadArgErr);
+    armRetArgErrIf(srcdstStep & 7,              OMX_Sts_BadArgErr);
+    armRetArgErrIf(pAlpha == NULL,              OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta == NULL,               OMX_Sts_BadArgErr);
+    armRetArgErrIf(pThresholds == NULL,         OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pThresholds), OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBS == NULL,                     OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pBS),         OMX_Sts_BadArgErr);
+
+    if (x86VCM4P10_CheckBS(pBS, 0, 16, 1) != OMX_Sts_NoErr)
+    {
+        return x86VCM4P10_FilterDeblockingLuma_HorEdge_I_C(
+            pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+    }
+
+    return x86VCM4P10_CPUKernels()->FilterDeblockingLuma_HorEdge(
+        pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+}
+
+OMXResult omxVCM4P10_FilterDeblockingChroma_VerEdge_I(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    int Y;
+
+    armRetArgErrIf(pSrcDst == NULL,                 OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot8ByteAligned(pSrcDst),     OMX_Sts_BadArgErr);
+    armRetArgErrIf(srcdstStep & 7,                  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pAlpha == NULL,                  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta == NULL,                   OMX_Sts_BadArgErr);
+    armRetArgErrIf(pThresholds == NULL,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pThresholds), OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBS == NULL,                     OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pBS),         OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta[0] > 18,  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta[1] > 18,  OMX_Sts_BadArgErr);
+
+    for (Y = 0; Y < 8; Y++)
+    {
+        if (pThresholds[Y] > 25)
+        {
+            return x86VCM4P10_FilterDeblockingChroma_VerEdge_I_C(
+                pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+        }
+    }
+
+    if (x86VCM4P10_CheckBS(pBS, 0, 4, 3) != OMX_Sts_NoErr
+            || x86VCM4P10_CheckBS(pBS, 8, 4, 3) != OMX_Sts_NoErr)
+    {
+        return x86VCM4P10_FilterDeblockingChroma_VerEdge_I_C(
+            pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+    }
+
+    return x86VCM4P10_CPUKernels()->FilterDeblockingChroma_VerEdge(
+        pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+}
+
+OMXResult omxVCM4P10_FilterDeblockingChroma_HorEdge_I(
+     OMX_U8* pSrcDst,
+     OMX_S32 srcdstStep,
+     const OMX_U8* pAlpha,
+     const OMX_U8* pBeta,
+     const OMX_U8* pThresholds,
+     const OMX_U8 *pBS
+ )
+{
+    armRetArgErrIf(pSrcDst == NULL,                 OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot8ByteAligned(pSrcDst),     OMX_Sts_BadArgErr);
+    armRetArgErrIf(srcdstStep & 7,                  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pAlpha == NULL,                  OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBeta == NULL,                   OMX_Sts_BadArgErr);
+    armRetArgErrIf(pThresholds == NULL,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pThresholds), OMX_Sts_BadArgErr);
+    armRetArgErrIf(pBS == NULL,                     OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pBS),         OMX_Sts_BadArgErr);
+
+    if (x86VCM4P10_CheckBS(pBS, 0, 4, 1) != OMX_Sts_NoErr
+            || x86VCM4P10_CheckBS(pBS, 8, 4, 1) != OMX_Sts_NoErr)
+    {
+        return x86VCM4P10_FilterDeblockingChroma_HorEdge_I_C(
+            pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+    }
+
+    return x86VCM4P10_CPUKernels()->FilterDeblockingChroma_HorEdge(
+        pSrcDst, srcdstStep, pAlpha, pBeta, pThresholds, pBS);
+}
+
+OMXResult omxVCM4P10_DequantTransformResidualFromPairAndAdd(
+     const OMX_U8 **ppSrc,
+     const OMX_U8 *pPred,
+     const OMX_S16 *pDC,
+     OMX_U8 *pDst,
+     OMX_INT predStep,
+     OMX_INT dstStep,
+     OMX_INT QP,
+     OMX_INT AC
+)
+{
+    armRetArgErrIf(pPred == NULL,            OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pPred),OMX_Sts_BadArgErr);
+    armRetArgErrIf(pDst   == NULL,           OMX_Sts_BadArgErr);
+    armRetArgErrIf(armNot4ByteAligned(pDst), OMX_Sts_BadArgErr);
+    armRetArgErrIf(predStep & 3,             OMX_Sts_BadArgErr);
+    armRetArgErrIf(dstStep & 3,              OMX_Sts_BadArgErr);
+    armRetArgErrIf(AC!=0 && (QP<0),          OMX_Sts_BadArgErr);
+    armRetArgErrIf(AC!=0 && (QP>51),         OMX_Sts_BadArgErr);
+    armRetArgErrIf(AC!=0 && ppSrc==NULL,     OMX_Sts_BadArgErr);
+    armRetArgErrIf(AC!=0 && *ppSrc==NULL,    OMX_Sts_BadArgErr);
+    armRetArgErrIf(AC==0 && pDC==NULL,       OMX_Sts_BadArgErr);
+
+    return x86VCM4P10_CPUKernels()->DequantTransformResidualFromPairAndAdd(
+        ppSrc, pPred, pDC, pDst, predStep, dstStep, QP, AC);
+}
+
+OMXResult omxVCM4P10_InvTransformResidualAndAdd(
+	const OMX_U8* 	pSrcPred,
+	const OMX_S16* 	pDequantCoeff,
+	OMX_U8* 	pDstRecon,
+	OMX_U32 	iSrcPredStep,
+	OMX_U32		iDstReconStep,
+	OMX_U8		bAC
+)
+{
+    armRetArgErrIf(pSrcPred == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(armNot4ByteAligned(pSrcPred), OMX_Sts_BadArgErr)
+    armRetArgErrIf(pDequantCoeff == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(armNot8ByteAligned(pDequantCoeff), OMX_Sts_BadArgErr)
+    armRetArgErrIf(pDstRecon == NULL, OMX_Sts_BadArgErr)
+    armRetArgErrIf(armNot4ByteAligned(pDstRecon), OMX_Sts_BadArgErr)
+    armRetArgErrIf(bAC > 1, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iSrcPredStep == 0 || iSrcPredStep & 3, OMX_Sts_BadArgErr)
+    armRetArgErrIf(iDstReconStep == 0 || iDstReconStep & 3, OMX_Sts_BadArgErr)
+
+    return x86VCM4P10_CPUKernels()->InvTransformResidualAndAdd(
+        pSrcPred, pDequantCoeff, pDstRecon, iSrcPredStep, iDstReconStep, bAC);
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Interpolate_AVX2.c
+ * Brief: AVX2 luma interpolation for 16 pixel wide blocks
+ *
+ * Same arithmetic as x86VCM4P10_Interpolate_SSE4.c with a whole 16 pixel row
+ * in one register. Narrower blocks use the SSE4.1 version.
+ */
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "omxtypes.h"
+#include "armCOMM.h"
+
+#include "x86VCM4P10.h"
+
+static inline __m256i x86_Load16x16(const OMX_U8 *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+static inline __m256i x86_Tap6x16(
+    __m256i a, __m256i b, __m256i c, __m256i d, __m256i e, __m256i f)
+{
+    __m256i cd = _mm256_add_epi16(c, d);
+    __m256i be = _mm256_add_epi16(b, e);
+    __m256i af = _mm256_add_epi16(a, f);
+
+    return _mm256_add_epi16(
+        _mm256_sub_epi16(af, _mm256_mullo_epi16(be, _mm256_set1_epi16(5))),
+        _mm256_mullo_epi16(cd, _mm256_set1_epi16(20)));
+}
+
+static inline __m256i x86_HorTap16(const OMX_U8 *p)
+{
+    return x86_Tap6x16(
+        x86_Load16x16(p - 2), x86_Load16x16(p - 1), x86_Load16x16(p),
+        x86_Load16x16(p + 1), x86_Load16x16(p + 2), x86_Load16x16(p + 3));
+}
+
+static inline __m256i x86_VerTap16(const OMX_U8 *p, OMX_S32 step)
+{
+    return x86_Tap6x16(
+        x86_Load16x16(p - 2 * step), x86_Load16x16(p - step),
+        x86_Load16x16(p), x86_Load16x16(p + step),
+        x86_Load16x16(p + 2 * step), x86_Load16x16(p + 3 * step));
+}
+
+/* Packs sixteen 16-bit lanes to pixels and writes them, averaged with pAvg
+ * unless that is NULL */
+static inline void x86_StorePixels16(
+    OMX_U8 *pDst, __m256i pixels, const OMX_U8 *pAvg)
+{
+    __m128i row = _mm_packus_epi16(_mm256_castsi256_si128(pixels),
+                                   _mm256_extracti128_si256(pixels, 1));
+
+    if (pAvg != NULL)
+    {
+        row = _mm_avg_epu8(row, _mm_loadu_si128((const __m128i *)pAvg));
+    }
+    _mm_storeu_si128((__m128i *)pDst, row);
+}
+
+static inline __m256i x86_Round5x16(__m256i x)
+{
+    return _mm256_srai_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(16)), 5);
+}
+
+static void x86_HalfHor16(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 height)
+{
+    OMX_U32 y;
+
+    for (y = 0; y < height; y++)
+    {
+        x86_StorePixels16(pDst, x86_Round5x16(x86_HorTap16(pSrc)), pAvg);
+
+        pSrc += srcStep;
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+static void x86_HalfVer16(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 height)
+{
+    OMX_U32 y;
+
+    for (y = 0; y < height; y++)
+    {
+        x86_StorePixels16(pDst, x86_Round5x16(x86_VerTap16(pSrc, srcStep)), pAvg);
+
+        pSrc += srcStep;
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+static void x86_HalfDiag16(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 height)
+{
+    __m256i rows[21];
+    const __m256i coeffAB = _mm256_set1_epi32((-5 << 16) | 1);
+    const __m256i coeffC = _mm256_set1_epi32(20);
+    const __m256i round = _mm256_set1_epi32(512);
+    const __m256i zero = _mm256_setzero_si256();
+    OMX_U32 y;
+
+    for (y = 0; y < height + 5; y++)
+    {
+        rows[y] = x86_HorTap16(pSrc + ((OMX_S32)y - 2) * srcStep);
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        __m256i af = _mm256_add_epi16(rows[y], rows[y + 5]);
+        __m256i be = _mm256_add_epi16(rows[y + 1], rows[y + 4]);
+        __m256i cd = _mm256_add_epi16(rows[y + 2], rows[y + 3]);
+        __m256i lo, hi;
+
+        /* unpack and pack work within 128-bit halves, so the pixel order
+         * is restored by the pack */
+        lo = _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(af, be), coeffAB),
+            _mm256_madd_epi16(_mm256_unpacklo_epi16(cd, zero), coeffC));
+        hi = _mm256_add_epi32(
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(af, be), coeffAB),
+            _mm256_madd_epi16(_mm256_unpackhi_epi16(cd, zero), coeffC));
+
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 10);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 10);
+
+        x86_StorePixels16(pDst, _mm256_packs_epi32(lo, hi), pAvg);
+
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+OMXResult x86VCM4P10_Interpolate_Luma_AVX2(
+     const OMX_U8     *pSrc,
+     OMX_U32    iSrcStep,
+     OMX_U8     *pDst,
+     OMX_U32    iDstStep,
+     OMX_U32    iWidth,
+     OMX_U32    iHeight,
+     OMX_U32    dx,
+     OMX_U32    dy
+)
+{
+    OMX_U8 pBuf[16 * 16];
+    OMX_S32 srcStep = (OMX_S32)iSrcStep;
+    OMX_S32 dstStep = (OMX_S32)iDstStep;
+    const OMX_U8 *pSrcHalfHor = pSrc + (dy == 3 ? srcStep : 0);
+    const OMX_U8 *pSrcHalfVer = pSrc + (dx == 3 ? 1 : 0);
+    OMX_U32 y;
+
+    if (iWidth != 16)
+    {
+        return x86VCM4P10_Interpolate_Luma_SSE4(
+            pSrc, iSrcStep, pDst, iDstStep, iWidth, iHeight, dx, dy);
+    }
+
+    if (dx == 0 && dy == 0)
+    {
+        for (y = 0; y < iHeight; y++)
+        {
+            memcpy(pDst + y * dstStep, pSrc + y * srcStep, 16);
+        }
+    }
+    else if (dy == 0)
+    {
+        x86_HalfHor16(pSrc, srcStep, pDst, dstStep,
+                      dx != 2 ? pSrcHalfVer : NULL, srcStep, iHeight);
+    }
+    else if (dx == 0)
+    {
+        x86_HalfVer16(pSrc, srcStep, pDst, dstStep,
+                      dy != 2 ? pSrcHalfHor : NULL, srcStep, iHeight);
+    }
+    else if (dx == 2 && dy == 2)
+    {
+        x86_HalfDiag16(pSrc, srcStep, pDst, dstStep, NULL, 0, iHeight);
+    }
+    else if (dx == 2)
+    {
+        x86_HalfHor16(pSrcHalfHor, srcStep, pBuf, 16, NULL, 0, iHeight);
+        x86_HalfDiag16(pSrc, srcStep, pDst, dstStep, pBuf, 16, iHeight);
+    }
+    else if (dy == 2)
+    {
+        x86_HalfVer16(pSrcHalfVer, srcStep, pBuf, 16, NULL, 0, iHeight);
+        x86_HalfDiag16(pSrc, srcStep, pDst, dstStep, pBuf, 16, iHeight);
+    }
+    else
+    {
+        x86_HalfHor16(pSrcHalfHor, srcStep, pBuf, 16, NULL, 0, iHeight);
+        x86_HalfVer16(pSrcHalfVer, srcStep, pDst, dstStep, pBuf, 16, iHeight);
+    }
+
+    return OMX_Sts_NoErr;
+}
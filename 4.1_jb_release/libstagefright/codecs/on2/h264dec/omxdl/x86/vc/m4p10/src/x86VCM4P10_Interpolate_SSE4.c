@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Interpolate_SSE4.c
+ * Brief: SSE4.1 luma and chroma interpolation
+ *
+ * Every load reads exactly the pixels the reference version reads, so blocks
+ * may sit at the very end of a buffer.
+ */
+
+#include <smmintrin.h>
+
+#include "omxtypes.h"
+#include "armCOMM.h"
+
+#include "x86VCM4P10.h"
+#include "x86VCM4P10_SSE4.h"
+
+/* 6-tap filter on eight 16-bit lanes: a - 5b + 20c + 20d - 5e + f */
+static inline __m128i x86_Tap6(
+    __m128i a, __m128i b, __m128i c, __m128i d, __m128i e, __m128i f)
+{
+    __m128i cd = _mm_add_epi16(c, d);
+    __m128i be = _mm_add_epi16(b, e);
+    __m128i af = _mm_add_epi16(a, f);
+
+    return _mm_add_epi16(
+        _mm_sub_epi16(af, _mm_mullo_epi16(be, _mm_set1_epi16(5))),
+        _mm_mullo_epi16(cd, _mm_set1_epi16(20)));
+}
+
+/* Rounds a 6-tap sum to a pixel, (x + 16) >> 5 saturated to [0,255] */
+static inline __m128i x86_Round5(__m128i x)
+{
+    return _mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(16)), 5);
+}
+
+/* Unrounded horizontal 6-tap sums for the 4 or 8 pixels at p */
+static inline __m128i x86_HorTap(const OMX_U8 *p, OMX_U32 width)
+{
+    if (width == 4)
+    {
+        return x86_Tap6(
+            x86_Load4x16(p - 2), x86_Load4x16(p - 1), x86_Load4x16(p),
+            x86_Load4x16(p + 1), x86_Load4x16(p + 2), x86_Load4x16(p + 3));
+    }
+
+    return x86_Tap6(
+        x86_Load8x16(p - 2), x86_Load8x16(p - 1), x86_Load8x16(p),
+        x86_Load8x16(p + 1), x86_Load8x16(p + 2), x86_Load8x16(p + 3));
+}
+
+/* Unrounded vertical 6-tap sums for the 4 or 8 pixels at p */
+static inline __m128i x86_VerTap(const OMX_U8 *p, OMX_S32 step, OMX_U32 width)
+{
+    if (width == 4)
+    {
+        return x86_Tap6(
+            x86_Load4x16(p - 2 * step), x86_Load4x16(p - step),
+            x86_Load4x16(p), x86_Load4x16(p + step),
+            x86_Load4x16(p + 2 * step), x86_Load4x16(p + 3 * step));
+    }
+
+    return x86_Tap6(
+        x86_Load8x16(p - 2 * step), x86_Load8x16(p - step),
+        x86_Load8x16(p), x86_Load8x16(p + step),
+        x86_Load8x16(p + 2 * step), x86_Load8x16(p + 3 * step));
+}
+
+/* Writes pixels, averaged with the ones at pAvg unless that is NULL */
+static inline void x86_StorePixels(
+    OMX_U8 *pDst, __m128i pixels, const OMX_U8 *pAvg, OMX_U32 width)
+{
+    if (width == 4)
+    {
+        if (pAvg != NULL)
+        {
+            pixels = _mm_avg_epu8(pixels, x86_Load4(pAvg));
+        }
+        x86_Store4(pDst, pixels);
+    }
+    else
+    {
+        if (pAvg != NULL)
+        {
+            pixels = _mm_avg_epu8(pixels, _mm_loadl_epi64((const __m128i *)pAvg));
+        }
+        _mm_storel_epi64((__m128i *)pDst, pixels);
+    }
+}
+
+/*
+ * Half pixel positions b (horizontal) and h (vertical), optionally averaged
+ * with a second block for the quarter positions next to them. Runs over
+ * 4 or 8 pixel wide columns.
+ */
+static void x86_HalfHor(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 width, OMX_U32 height)
+{
+    OMX_U32 y;
+
+    for (y = 0; y < height; y++)
+    {
+        __m128i sum = x86_Round5(x86_HorTap(pSrc, width));
+
+        x86_StorePixels(pDst, _mm_packus_epi16(sum, sum), pAvg, width);
+
+        pSrc += srcStep;
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+static void x86_HalfVer(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 width, OMX_U32 height)
+{
+    OMX_U32 y;
+
+    for (y = 0; y < height; y++)
+    {
+        __m128i sum = x86_Round5(x86_VerTap(pSrc, srcStep, width));
+
+        x86_StorePixels(pDst, _mm_packus_epi16(sum, sum), pAvg, width);
+
+        pSrc += srcStep;
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+/*
+ * Center position j: the unrounded horizontal sums fit 16 bits, the vertical
+ * pass over them needs 32 bits. (a + f) - 5(b + e) + 20(c + d) is done as
+ * two multiply-adds on interleaved pairs.
+ */
+static void x86_HalfDiag(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    const OMX_U8 *pAvg, OMX_S32 avgStep, OMX_U32 width, OMX_U32 height)
+{
+    __m128i rows[21];
+    const __m128i coeffAB = _mm_set_epi16(-5, 1, -5, 1, -5, 1, -5, 1);
+    const __m128i coeffC = _mm_set1_epi32(20);
+    const __m128i round = _mm_set1_epi32(512);
+    OMX_U32 y;
+
+    for (y = 0; y < height + 5; y++)
+    {
+        rows[y] = x86_HorTap(pSrc + ((OMX_S32)y - 2) * srcStep, width);
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        __m128i af = _mm_add_epi16(rows[y], rows[y + 5]);
+        __m128i be = _mm_add_epi16(rows[y + 1], rows[y + 4]);
+        __m128i cd = _mm_add_epi16(rows[y + 2], rows[y + 3]);
+        __m128i lo, hi, pixels;
+
+        lo = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpacklo_epi16(af, be), coeffAB),
+            _mm_mullo_epi32(_mm_cvtepi16_epi32(cd), coeffC));
+        hi = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpackhi_epi16(af, be), coeffAB),
+            _mm_mullo_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(cd, 8)), coeffC));
+
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 10);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 10);
+        pixels = _mm_packs_epi32(lo, hi);
+
+        x86_StorePixels(pDst, _mm_packus_epi16(pixels, pixels), pAvg, width);
+
+        pDst += dstStep;
+        if (pAvg != NULL)
+        {
+            pAvg += avgStep;
+        }
+    }
+}
+
+static void x86_Copy(
+    const OMX_U8 *pSrc, OMX_S32 srcStep, OMX_U8 *pDst, OMX_S32 dstStep,
+    OMX_U32 width, OMX_U32 height)
+{
+    OMX_U32 y;
+
+    for (y = 0; y < height; y++)
+    {
+        memcpy(pDst, pSrc, width);
+        pSrc += srcStep;
+        pDst += dstStep;
+    }
+}
+
+OMXResult x86VCM4P10_Interpolate_Luma_SSE4(
+     const OMX_U8     *pSrc,
+     OMX_U32    iSrcStep,
+     OMX_U8     *pDst,
+     OMX_U32    iDstStep,
+     OMX_U32    iWidth,
+     OMX_U32    iHeight,
+     OMX_U32    dx,
+     OMX_U32    dy
+)
+{
+    OMX_U8 pBuf[16 * 16];
+    OMX_S32 srcStep = (OMX_S32)iSrcStep;
+    OMX_S32 dstStep = (OMX_S32)iDstStep;
+    OMX_U32 width = iWidth == 16 ? 8 : iWidth;
+    OMX_U32 x;
+
+    /* The reference names of the positions are in armVCM4P10_Interpolate_Luma */
+    const OMX_U8 *pSrcHalfHor = pSrc + (dy == 3 ? srcStep : 0);
+    const OMX_U8 *pSrcHalfVer = pSrc + (dx == 3 ? 1 : 0);
+
+    for (x = 0; x < iWidth; x += width)
+    {
+        if (dx == 0 && dy == 0)
+        {
+            x86_Copy(pSrc + x, srcStep, pDst + x, dstStep, width, iHeight);
+        }
+        else if (dy == 0)
+        {
+            x86_HalfHor(pSrc + x, srcStep, pDst + x, dstStep,
+                        dx != 2 ? pSrcHalfVer + x : NULL, srcStep,
+                        width, iHeight);
+        }
+        else if (dx == 0)
+        {
+            x86_HalfVer(pSrc + x, srcStep, pDst + x, dstStep,
+                        dy != 2 ? pSrcHalfHor + x : NULL, srcStep,
+                        width, iHeight);
+        }
+        else if (dx == 2 && dy == 2)
+        {
+            x86_HalfDiag(pSrc + x, srcStep, pDst + x, dstStep,
+                         NULL, 0, width, iHeight);
+        }
+        else if (dx == 2)
+        {
+            x86_HalfHor(pSrcHalfHor + x, srcStep, pBuf, 16,
+                        NULL, 0, width, iHeight);
+            x86_HalfDiag(pSrc + x, srcStep, pDst + x, dstStep,
+                         pBuf, 16, width, iHeight);
+        }
+        else if (dy == 2)
+        {
+            x86_HalfVer(pSrcHalfVer + x, srcStep, pBuf, 16,
+                        NULL, 0, width, iHeight);
+            x86_HalfDiag(pSrc + x, srcStep, pDst + x, dstStep,
+                         pBuf, 16, width, iHeight);
+        }
+        else
+        {
+            x86_HalfHor(pSrcHalfHor + x, srcStep, pBuf, 16,
+                        NULL, 0, width, iHeight);
+            x86_HalfVer(pSrcHalfVer + x, srcStep, pDst + x, dstStep,
+                        pBuf, 16, width, iHeight);
+        }
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+/*
+ * Chroma is (A*p00 + B*p01 + C*p10 + D*p11 + 32) >> 6 with A+B+C+D = 64,
+ * which fits 16 bits. The pixel pairs (p00, p01) are interleaved so that a
+ * single pmaddubsw per row does the horizontal part.
+ */
+static inline __m128i x86_ChromaPairs(const OMX_U8 *p, OMX_U32 width)
+{
+    if (width == 8)
+    {
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),
+                                 _mm_loadl_epi64((const __m128i *)(p + 1)));
+    }
+    if (width == 4)
+    {
+        return _mm_unpacklo_epi8(x86_Load4(p), x86_Load4(p + 1));
+    }
+    return _mm_unpacklo_epi8(x86_Load2(p), x86_Load2(p + 1));
+}
+
+OMXResult x86VCM4P10_Interpolate_Chroma_SSE4(
+        OMX_U8      *pSrc,
+        OMX_U32     iSrcStep,
+        OMX_U8      *pDst,
+        OMX_U32     iDstStep,
+        OMX_U32     iWidth,
+        OMX_U32     iHeight,
+        OMX_U32     dx,
+        OMX_U32     dy
+)
+{
+    OMX_S32 srcStep = (OMX_S32)iSrcStep;
+    OMX_S32 dstStep = (OMX_S32)iDstStep;
+    __m128i coeffAB, coeffCD, round, top;
+    OMX_U32 y;
+
+    if (dx == 0 && dy == 0)
+    {
+        x86_Copy(pSrc, srcStep, pDst, dstStep, iWidth, iHeight);
+        return OMX_Sts_NoErr;
+    }
+
+    coeffAB = _mm_set1_epi16((OMX_S16)(((dx * (8 - dy)) << 8)
+                                       | ((8 - dx) * (8 - dy))));
+    coeffCD = _mm_set1_epi16((OMX_S16)(((dx * dy) << 8)
+                                       | ((8 - dx) * dy)));
+    round = _mm_set1_epi16(32);
+
+    top = _mm_maddubs_epi16(x86_ChromaPairs(pSrc, iWidth), coeffAB);
+
+    for (y = 0; y < iHeight; y++)
+    {
+        __m128i pairs = x86_ChromaPairs(pSrc + srcStep, iWidth);
+        __m128i sum = _mm_add_epi16(
+            _mm_add_epi16(top, _mm_maddubs_epi16(pairs, coeffCD)), round);
+        __m128i pixels = _mm_srli_epi16(sum, 6);
+
+        pixels = _mm_packus_epi16(pixels, pixels);
+        if (iWidth == 8)
+        {
+            _mm_storel_epi64((__m128i *)pDst, pixels);
+        }
+        else if (iWidth == 4)
+        {
+            x86_Store4(pDst, pixels);
+        }
+        else
+        {
+            x86_Store2(pDst, pixels);
+        }
+
+        top = _mm_maddubs_epi16(pairs, coeffAB);
+        pSrc += srcStep;
+        pDst += dstStep;
+    }
+
+    return OMX_Sts_NoErr;
+}
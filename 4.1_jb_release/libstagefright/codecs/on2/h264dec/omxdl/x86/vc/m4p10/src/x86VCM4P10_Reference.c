@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Reference.c
+ * Brief: The reference C versions of the kernels the x86 backend replaces
+ *
+ * The public names belong to x86VCM4P10_Dispatch.c, so the reference sources
+ * are compiled here under the *_C names instead, the same way armOMX.h moves
+ * a function "out of the way" to compare it against a replacement. They are
+ * the fallback on CPUs without SSE4.1 and what the SIMD kernels are checked
+ * against.
+ */
+
+#include "omxtypes.h"
+#include "armOMX.h"
+#include "omxVC.h"
+
+#include "armCOMM.h"
+#include "armVC.h"
+
+#include "x86VCM4P10.h"
+
+#define armVCM4P10_Interpolate_Luma     x86VCM4P10_Interpolate_Luma_C
+#define armVCM4P10_Interpolate_Chroma   x86VCM4P10_Interpolate_Chroma_C
+
+#undef omxVCM4P10_FilterDeblockingLuma_VerEdge_I
+#undef omxVCM4P10_FilterDeblockingLuma_HorEdge_I
+#undef omxVCM4P10_FilterDeblockingChroma_VerEdge_I
+#undef omxVCM4P10_FilterDeblockingChroma_HorEdge_I
+#undef omxVCM4P10_DequantTransformResidualFromPairAndAdd
+#undef omxVCM4P10_InvTransformResidualAndAdd
+
+#define omxVCM4P10_FilterDeblockingLuma_VerEdge_I \
+        x86VCM4P10_FilterDeblockingLuma_VerEdge_I_C
+#define omxVCM4P10_FilterDeblockingLuma_HorEdge_I \
+        x86VCM4P10_FilterDeblockingLuma_HorEdge_I_C
+#define omxVCM4P10_FilterDeblockingChroma_VerEdge_I \
+        x86VCM4P10_FilterDeblockingChroma_VerEdge_I_C
+#define omxVCM4P10_FilterDeblockingChroma_HorEdge_I \
+        x86VCM4P10_FilterDeblockingChroma_HorEdge_I_C
+#define omxVCM4P10_DequantTransformResidualFromPairAndAdd \
+        x86VCM4P10_DequantTransformResidualFromPairAndAdd_C
+#define omxVCM4P10_InvTransformResidualAndAdd \
+        x86VCM4P10_InvTransformResidualAndAdd_C
+
+#include "../../../../reference/vc/m4p10/src/armVCM4P10_Interpolate_Luma.c"
+#include "../../../../reference/vc/m4p10/src/armVCM4P10_Interpolate_Chroma.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_FilterDeblockingLuma_VerEdge_I.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_FilterDeblockingLuma_HorEdge_I.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_FilterDeblockingChroma_VerEdge_I.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_FilterDeblockingChroma_HorEdge_I.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_DequantTransformResidualFromPairAndAdd.c"
+#include "../../../../reference/vc/m4p10/src/omxVCM4P10_InvTransformResidualAndAdd.c"
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_SSE4.h
+ * Brief: Load and store helpers shared by the SSE4.1 and AVX2 kernels
+ *
+ * Small loads go through memcpy so that unaligned addresses are fine and no
+ * byte outside the block is touched.
+ */
+
+#ifndef _x86VCM4P10_SSE4_H_
+#define _x86VCM4P10_SSE4_H_
+
+#include <smmintrin.h>
+#include <string.h>
+
+#include "omxtypes.h"
+
+static inline __m128i x86_Load2(const OMX_U8 *p)
+{
+    OMX_U16 v;
+
+    memcpy(&v, p, sizeof(v));
+    return _mm_cvtsi32_si128(v);
+}
+
+static inline __m128i x86_Load4(const OMX_U8 *p)
+{
+    OMX_S32 v;
+
+    memcpy(&v, p, sizeof(v));
+    return _mm_cvtsi32_si128(v);
+}
+
+static inline void x86_Store2(OMX_U8 *p, __m128i v)
+{
+    OMX_U16 x = (OMX_U16)_mm_cvtsi128_si32(v);
+
+    memcpy(p, &x, sizeof(x));
+}
+
+static inline void x86_Store4(OMX_U8 *p, __m128i v)
+{
+    OMX_S32 x = _mm_cvtsi128_si32(v);
+
+    memcpy(p, &x, sizeof(x));
+}
+
+/* 4 or 8 pixels widened to 16-bit lanes */
+static inline __m128i x86_Load4x16(const OMX_U8 *p)
+{
+    return _mm_cvtepu8_epi16(x86_Load4(p));
+}
+
+static inline __m128i x86_Load8x16(const OMX_U8 *p)
+{
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)p));
+}
+
+#endif /* _x86VCM4P10_SSE4_H_ */
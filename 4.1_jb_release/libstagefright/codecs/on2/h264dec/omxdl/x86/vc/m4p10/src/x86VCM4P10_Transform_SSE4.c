@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File: x86VCM4P10_Transform_SSE4.c
+ * Brief: SSE4.1 4x4 dequantization, inverse transform and reconstruction
+ *
+ * Follows armVCM4P10_TransformResidual4x4(): the row pass is kept to 16 bits
+ * like the reference stores it, the column pass is done in 32 bits.
+ */
+
+#include <smmintrin.h>
+
+#include "omxtypes.h"
+#include "armOMX.h"
+#include "omxVC.h"
+
+#include "armCOMM.h"
+#include "armVC.h"
+
+#include "x86VCM4P10.h"
+#include "x86VCM4P10_SSE4.h"
+
+/* armVCM4P10_VMatrix[QP%6][armVCM4P10_PosToVCol4x4[i]] in raster order */
+static const OMX_S16 x86VCM4P10_DequantScale[6][16] __attribute__((aligned(16))) =
+{
+    { 10, 13, 10, 13, 13, 16, 13, 16, 10, 13, 10, 13, 13, 16, 13, 16 },
+    { 11, 14, 11, 14, 14, 18, 14, 18, 11, 14, 11, 14, 14, 18, 14, 18 },
+    { 13, 16, 13, 16, 16, 20, 16, 20, 13, 16, 13, 16, 16, 20, 16, 20 },
+    { 14, 18, 14, 18, 18, 23, 18, 23, 14, 18, 14, 18, 18, 23, 18, 23 },
+    { 16, 20, 16, 20, 20, 25, 20, 25, 16, 20, 16, 20, 20, 25, 20, 25 },
+    { 18, 23, 18, 23, 23, 29, 23, 29, 18, 23, 18, 23, 23, 29, 23, 29 }
+};
+
+/* Adds a residual row of four 32-bit values to four predicted pixels */
+static inline void x86_AddRow(
+    OMX_U8 *pDst, const OMX_U8 *pPred, __m128i residual)
+{
+    __m128i row = _mm_add_epi32(_mm_cvtepu8_epi32(x86_Load4(pPred)), residual);
+
+    row = _mm_packs_epi32(row, row);
+    x86_Store4(pDst, _mm_packus_epi16(row, row));
+}
+
+/*
+ * Transforms the 4x4 block in rows01 (rows 0 and 1) and rows23 (rows 2 and
+ * 3) and adds it to the prediction.
+ */
+static void x86_TransformAndAdd(
+    __m128i rows01, __m128i rows23,
+    const OMX_U8 *pPred, OMX_S32 predStep, OMX_U8 *pDst, OMX_S32 dstStep)
+{
+    const __m128i round = _mm_set1_epi32(32);
+    __m128i t0, t1, d0, d1, d2, d3, e0, e1, e2, e3, f0, f1, f2, f3;
+    __m128i g0, g1, g2, g3;
+
+    /* Transpose so that lane i of dK is element K of row i */
+    t0 = _mm_unpacklo_epi16(rows01, _mm_srli_si128(rows01, 8));
+    t1 = _mm_unpacklo_epi16(rows23, _mm_srli_si128(rows23, 8));
+    d0 = _mm_unpacklo_epi32(t0, t1);
+    d2 = _mm_unpackhi_epi32(t0, t1);
+    d1 = _mm_srli_si128(d0, 8);
+    d3 = _mm_srli_si128(d2, 8);
+
+    /* Rows, wrapping at 16 bits */
+    e0 = _mm_add_epi16(d0, d2);
+    e1 = _mm_sub_epi16(d0, d2);
+    e2 = _mm_sub_epi16(_mm_srai_epi16(d1, 1), d3);
+    e3 = _mm_add_epi16(d1, _mm_srai_epi16(d3, 1));
+    f0 = _mm_add_epi16(e0, e3);
+    f1 = _mm_add_epi16(e1, e2);
+    f2 = _mm_sub_epi16(e1, e2);
+    f3 = _mm_sub_epi16(e0, e3);
+
+    /* Transpose back, lane i of fK is now column i of row K */
+    t0 = _mm_unpacklo_epi16(f0, f1);
+    t1 = _mm_unpacklo_epi16(f2, f3);
+    f0 = _mm_unpacklo_epi32(t0, t1);
+    f2 = _mm_unpackhi_epi32(t0, t1);
+    f1 = _mm_cvtepi16_epi32(_mm_srli_si128(f0, 8));
+    f3 = _mm_cvtepi16_epi32(_mm_srli_si128(f2, 8));
+    f0 = _mm_cvtepi16_epi32(f0);
+    f2 = _mm_cvtepi16_epi32(f2);
+
+    /* Columns */
+    g0 = _mm_add_epi32(f0, f2);
+    g1 = _mm_sub_epi32(f0, f2);
+    g2 = _mm_sub_epi32(_mm_srai_epi32(f1, 1), f3);
+    g3 = _mm_add_epi32(f1, _mm_srai_epi32(f3, 1));
+
+    x86_AddRow(pDst, pPred,
+               _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(g0, g3), round), 6));
+    x86_AddRow(pDst + dstStep, pPred + predStep,
+               _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(g1, g2), round), 6));
+    x86_AddRow(pDst + 2 * dstStep, pPred + 2 * predStep,
+               _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(g1, g2), round), 6));
+    x86_AddRow(pDst + 3 * dstStep, pPred + 3 * predStep,
+               _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(g0, g3), round), 6));
+}
+
+/* Only a DC coefficient: every residual is (DC + 32) >> 6 */
+static void x86_DCAndAdd(
+    OMX_S16 DC,
+    const OMX_U8 *pPred, OMX_S32 predStep, OMX_U8 *pDst, OMX_S32 dstStep)
+{
+    __m128i residual = _mm_set1_epi32(((OMX_S32)DC + 32) >> 6);
+    int y;
+
+    for (y = 0; y < 4; y++)
+    {
+        x86_AddRow(pDst + y * dstStep, pPred + y * predStep, residual);
+    }
+}
+
+OMXResult x86VCM4P10_DequantTransformResidualFromPairAndAdd_SSE4(
+     const OMX_U8 **ppSrc,
+     const OMX_U8 *pPred,
+     const OMX_S16 *pDC,
+     OMX_U8 *pDst,
+     OMX_INT predStep,
+     OMX_INT dstStep,
+     OMX_INT QP,
+     OMX_INT AC
+)
+{
+    OMX_S16 pBuffer[16] __attribute__((aligned(16)));
+    __m128i rows01, rows23, shift;
+    OMX_S16 DC;
+
+    if (!AC)
+    {
+        x86_DCAndAdd(pDC[0], pPred, predStep, pDst, dstStep);
+        return OMX_Sts_NoErr;
+    }
+
+    armVCM4P10_UnpackBlock4x4(ppSrc, pBuffer);
+
+    shift = _mm_cvtsi32_si128(QP / 6);
+    rows01 = _mm_sll_epi16(_mm_mullo_epi16(
+        _mm_load_si128((const __m128i *)pBuffer),
+        _mm_load_si128((const __m128i *)&x86VCM4P10_DequantScale[QP % 6][0])),
+        shift);
+    rows23 = _mm_sll_epi16(_mm_mullo_epi16(
+        _mm_load_si128((const __m128i *)&pBuffer[8]),
+        _mm_load_si128((const __m128i *)&x86VCM4P10_DequantScale[QP % 6][8])),
+        shift);
+
+    DC = pDC ? pDC[0] : (OMX_S16)_mm_extract_epi16(rows01, 0);
+    rows01 = _mm_insert_epi16(rows01, DC, 0);
+
+    /* Everything but the DC may have been zero */
+    if (_mm_testz_si128(_mm_or_si128(_mm_srli_si128(rows01, 2), rows23),
+                        _mm_set1_epi8(-1)))
+    {
+        x86_DCAndAdd(DC, pPred, predStep, pDst, dstStep);
+    }
+    else
+    {
+        x86_TransformAndAdd(rows01, rows23, pPred, predStep, pDst, dstStep);
+    }
+
+    return OMX_Sts_NoErr;
+}
+
+OMXResult x86VCM4P10_InvTransformResidualAndAdd_SSE4(
+	const OMX_U8 	*pSrcPred,
+	const OMX_S16 	*pDequantCoeff,
+	OMX_U8 		*pDstRecon,
+	OMX_U32 	iSrcPredStep,
+	OMX_U32		iDstReconStep,
+	OMX_U8		bAC
+)
+{
+    if (!bAC)
+    {
+        x86_DCAndAdd(pDequantCoeff[0], pSrcPred, (OMX_S32)iSrcPredStep,
+                     pDstRecon, (OMX_S32)iDstReconStep);
+        return OMX_Sts_NoErr;
+    }
+
+    x86_TransformAndAdd(
+        _mm_loadu_si128((const __m128i *)pDequantCoeff),
+        _mm_loadu_si128((const __m128i *)(pDequantCoeff + 8)),
+        pSrcPred, (OMX_S32)iSrcPredStep,
+        pDstRecon, (OMX_S32)iDstReconStep);
+
+    return OMX_Sts_NoErr;
+}
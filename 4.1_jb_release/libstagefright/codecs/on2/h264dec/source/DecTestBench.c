@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*------------------------------------------------------------------------------
     Module defines
@@ -33,6 +34,9 @@
 /* Debug prints */
 #define DEBUG(argv) printf argv
 
+/* Max number of test bench picture buffers, -Zn */
+#define MAX_PIC_BUFFERS 32
+
 /* CVS tag name for identification */
 const char tagName[256] = "$Name: FIRST_ANDROID_COPYRIGHT $";
 
@@ -40,6 +44,9 @@ void WriteOutput(char *filename, u8 *data, u32 picSize);
 u32 NextPacket(u8 **pStrm);
 u32 CropPicture(u8 *pOutImage, u8 *pInImage,
     u32 picWidth, u32 picHeight, CropParams *pCropParams);
+u8 *BindPicture(void *pUserData, u32 size, void **pBufferId);
+void UnbindPicture(void *pUserData, void *pBufferId);
+double Now(void);
 
 /* Global variables for stream handling */
 u8 *streamStop = NULL;
@@ -47,6 +54,17 @@ u32 packetize = 0;
 u32 nalUnitStream = 0;
 FILE *foutput = NULL;
 
+/* Test bench picture buffers the decoder decodes into with -Z */
+typedef struct {
+    u8 *pAllocated;
+    u8 *data;           /* pAllocated aligned to 16 bytes */
+    u32 size;
+    u32 bound;
+} PicBuffer;
+
+PicBuffer picBuffers[MAX_PIC_BUFFERS];
+u32 numPicBuffers = 0;
+
 #ifdef SOC_DESIGNER
 
 // Initialisation function defined in InitCache.s
@@ -102,6 +120,9 @@ int main(int argc, char **argv)
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numThreads = 1;
+    u32 numInPicBuffers = 0;
+    double start;
 
     FILE *finput;
 
@@ -123,7 +144,7 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file.h264\n",
+            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-Mn] [-Z[n]] [-T] file.h264\n",
             argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
@@ -136,6 +157,10 @@ int main(int argc, char **argv)
         DEBUG(("\t-U NAL unit stream mode\n"));
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
         DEBUG(("\t-R disable DPB output reordering\n"));
+        DEBUG(("\t-Mn decode each picture with n threads (default 1)\n"));
+        DEBUG(("\t-Z[n] decode into at most n picture buffers of the test bench,\n"
+               "\t      into the decoder's own when none free (default %d)\n",
+               MAX_PIC_BUFFERS));
         DEBUG(("\t-T to print tag name and exit\n"));
         return 0;
     }
@@ -167,6 +192,16 @@ int main(int argc, char **argv)
         {
             disableOutputReordering = 1;
         }
+        else if ( strncmp(argv[i], "-M", 2) == 0 )
+        {
+            numThreads = (u32)atoi(argv[i]+2);
+        }
+        else if ( strncmp(argv[i], "-Z", 2) == 0 )
+        {
+            numPicBuffers = argv[i][2] ? (u32)atoi(argv[i]+2) : MAX_PIC_BUFFERS;
+            if (numPicBuffers > MAX_PIC_BUFFERS)
+                numPicBuffers = MAX_PIC_BUFFERS;
+        }
     }
 
     /* open input file for reading, file name given by user. If file open
@@ -196,7 +231,7 @@ int main(int argc, char **argv)
     fclose(finput);
 
     /* initialize decoder. If unsuccessful -> exit */
-    ret = H264SwDecInit(&decInst, disableOutputReordering);
+    ret = H264SwDecInit(&decInst, disableOutputReordering, numThreads);
     if (ret != H264SWDEC_OK)
     {
         DEBUG(("DECODER INITIALIZATION FAILED\n"));
@@ -204,6 +239,22 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (numPicBuffers)
+    {
+        H264SwDecPictureBuffers buffers;
+
+        buffers.bindPicture = BindPicture;
+        buffers.unbindPicture = UnbindPicture;
+        buffers.pUserData = NULL;
+        ret = H264SwDecSetPictureBuffers(decInst, &buffers);
+        if (ret != H264SWDEC_OK)
+        {
+            DEBUG(("SETTING PICTURE BUFFERS FAILED\n"));
+            free(byteStrmStart);
+            return -1;
+        }
+    }
+
     /* initialize H264SwDecDecode() input structure */
     streamStop = byteStrmStart + strmLen;
     decInput.pStream = byteStrmStart;
@@ -216,6 +267,7 @@ int main(int argc, char **argv)
         decInput.dataLen = tmp;
 
     picDecodeNumber = picDisplayNumber = 1;
+    start = Now();
     /* main decoding loop */
     do
     {
@@ -325,6 +377,8 @@ int main(int argc, char **argv)
                     fflush(stdout);
 
                     numErrors += decPicture.nbrOfErrMBs;
+                    if (decPicture.pBufferId)
+                        numInPicBuffers++;
 
                     /* Increment display number for every displayed picture */
                     picDisplayNumber++;
@@ -387,6 +441,8 @@ int main(int argc, char **argv)
         fflush(stdout);
 
         numErrors += decPicture.nbrOfErrMBs;
+        if (decPicture.pBufferId)
+            numInPicBuffers++;
 
         /* Increment display number for every displayed picture */
         picDisplayNumber++;
@@ -408,6 +464,8 @@ int main(int argc, char **argv)
         }
     }
 
+    start = Now() - start;
+
     /* release decoder instance */
     H264SwDecRelease(decInst);
 
@@ -417,8 +475,15 @@ int main(int argc, char **argv)
     /* free allocated buffers */
     free(byteStrmStart);
     free(tmpImage);
+    for (i = 0; i < numPicBuffers; i++)
+        free(picBuffers[i].pAllocated);
 
     DEBUG(("Output file: %s\n", outFileName));
+    DEBUG(("%d pictures in %.3f s, %.1f fps\n", picDisplayNumber - 1, start,
+        start > 0 ? (picDisplayNumber - 1) / start : 0.0));
+    if (numPicBuffers)
+        DEBUG(("%d pictures decoded into test bench buffers\n",
+            numInPicBuffers));
 
     DEBUG(("DECODING DONE\n"));
     if (numErrors || picDecodeNumber == 1)
@@ -759,3 +824,89 @@ void H264SwDecMemset(void *ptr, i32 value, u32 count)
     memset(ptr, value, count);
 }
 
+/*------------------------------------------------------------------------------
+
+    Function name:  BindPicture
+
+    Purpose:
+        H264SwDecPictureBuffers callback, gives the decoder a free test
+        bench buffer of at least size bytes for the next picture. Buffers
+        are allocated on first use and reallocated if too small. Returns
+        NULL if all of the -Zn buffers are bound.
+
+------------------------------------------------------------------------------*/
+u8 *BindPicture(void *pUserData, u32 size, void **pBufferId)
+{
+
+    u32 i;
+    PicBuffer *pBuf;
+
+    (void)pUserData;
+
+    for (i = 0; i < numPicBuffers; i++)
+    {
+        pBuf = picBuffers + i;
+        if (pBuf->bound)
+            continue;
+
+        if (pBuf->size < size)
+        {
+            free(pBuf->pAllocated);
+            pBuf->pAllocated = (u8 *)malloc(size + 15);
+            if (pBuf->pAllocated == NULL)
+            {
+                pBuf->size = 0;
+                return NULL;
+            }
+            pBuf->data = pBuf->pAllocated +
+                ((16 - ((size_t)pBuf->pAllocated & 15)) & 15);
+            pBuf->size = size;
+        }
+
+        pBuf->bound = 1;
+        *pBufferId = pBuf;
+        return pBuf->data;
+    }
+
+    return NULL;
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  UnbindPicture
+
+    Purpose:
+        H264SwDecPictureBuffers callback, the decoder no longer needs the
+        buffer.
+
+------------------------------------------------------------------------------*/
+void UnbindPicture(void *pUserData, void *pBufferId)
+{
+
+    PicBuffer *pBuf = (PicBuffer *)pBufferId;
+
+    (void)pUserData;
+
+    if (!pBuf->bound)
+    {
+        DEBUG(("BUFFER UNBOUND TWICE\n"));
+        exit(100);
+    }
+    pBuf->bound = 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  Now
+
+    Purpose:
+        Monotonic time in seconds.
+
+------------------------------------------------------------------------------*/
+double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
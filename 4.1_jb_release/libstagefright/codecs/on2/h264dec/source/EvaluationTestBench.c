@@ -97,7 +97,7 @@ int main(int argc, char **argv)
     fclose(finput);
 
     /* initialize decoder. If unsuccessful -> exit */
-    ret = H264SwDecInit(&decInst, 0);
+    ret = H264SwDecInit(&decInst, 0, 1);
     if (ret != H264SWDEC_OK)
     {
         printf("DECODER INITIALIZATION FAILED\n");
@@ -29,6 +29,7 @@
           H264SwDecDecode
           H264SwDecGetAPIVersion
           H264SwDecNextPicture
+          H264SwDecSetPictureBuffers
 
 ------------------------------------------------------------------------------*/
 
@@ -47,7 +48,7 @@
 ------------------------------------------------------------------------------*/
 
 #define H264SWDEC_MAJOR_VERSION 2
-#define H264SWDEC_MINOR_VERSION 3
+#define H264SWDEC_MINOR_VERSION 5
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -105,6 +106,9 @@ void H264SwDecMemset(void *ptr, i32 value, u32 count) {
             noOutputReordering  flag to indicate decoder that it doesn't have
                                 to try to provide output pictures in display
                                 order, saves memory
+            numThreads          number of threads decoding each picture,
+                                0 and 1 decode in the calling thread only,
+                                at most H264SWDEC_MAX_THREADS
 
         Outputs:
             decInst             pointer to initialized instance is stored here
@@ -117,7 +121,8 @@ void H264SwDecMemset(void *ptr, i32 value, u32 count) {
 
 ------------------------------------------------------------------------------*/
 
-H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering)
+H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering,
+    u32 numThreads)
 {
     u32 rv = 0;
 
@@ -140,6 +145,12 @@ H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering)
         return(H264SWDEC_PARAM_ERR);
     }
 
+    if (numThreads > H264SWDEC_MAX_THREADS)
+    {
+        DEC_API_TRC("H264SwDecInit# ERROR: numThreads > H264SWDEC_MAX_THREADS");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
     pDecCont = (decContainer_t *)H264SwDecMalloc(sizeof(decContainer_t));
 
     if (pDecCont == NULL)
@@ -149,12 +160,13 @@ H264SwDecRet H264SwDecInit(H264SwDecInst *decInst, u32 noOutputReordering)
     }
 
 #ifdef H264DEC_TRACE
-    sprintf(pDecCont->str, "H264SwDecInit# decInst %p noOutputReordering %d",
-            (void*)decInst, noOutputReordering);
+    sprintf(pDecCont->str,
+            "H264SwDecInit# decInst %p noOutputReordering %d numThreads %d",
+            (void*)decInst, noOutputReordering, numThreads);
     DEC_API_TRC(pDecCont->str);
 #endif
 
-    rv = h264bsdInit(&pDecCont->storage, noOutputReordering);
+    rv = h264bsdInit(&pDecCont->storage, noOutputReordering, numThreads);
     if (rv != HANTRO_OK)
     {
         H264SwDecRelease(pDecCont);
@@ -246,6 +258,9 @@ H264SwDecRet H264SwDecGetInfo(H264SwDecInst decInst, H264SwDecInfo *pDecInfo)
     /* profile */
     pDecInfo->profile = h264bsdProfile(pStorage);
 
+    /* pictures in the DPB and the one being decoded */
+    pDecInfo->numPicBuffers = pStorage->activeSps->maxDpbSize + 1;
+
     DEC_API_TRC("H264SwDecGetInfo# OK");
 
     return(H264SWDEC_OK);
@@ -524,6 +539,7 @@ H264SwDecRet H264SwDecNextPicture(H264SwDecInst decInst,
     decContainer_t *pDecCont;
     u32 numErrMbs, isIdrPic, picId;
     u32 *pOutPic;
+    void *pBufferId;
 
     DEC_API_TRC("H264SwDecNextPicture#");
 
@@ -545,7 +561,8 @@ H264SwDecRet H264SwDecNextPicture(H264SwDecInst decInst,
         h264bsdFlushBuffer(&pDecCont->storage);
 
     pOutPic = (u32*)h264bsdNextOutputPicture(&pDecCont->storage, &picId,
-                                             &isIdrPic, &numErrMbs);
+                                             &isIdrPic, &numErrMbs,
+                                             &pBufferId);
 
     if (pOutPic == NULL)
     {
@@ -558,10 +575,84 @@ H264SwDecRet H264SwDecNextPicture(H264SwDecInst decInst,
         pOutput->picId          = picId;
         pOutput->isIdrPicture   = isIdrPic;
         pOutput->nbrOfErrMBs    = numErrMbs;
+        pOutput->pBufferId      = pBufferId;
         DEC_API_TRC("H264SwDecNextPicture# OK: return H264SWDEC_PIC_RDY");
         return(H264SWDEC_PIC_RDY);
     }
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: H264SwDecSetPictureBuffers
+
+        Functional description:
+            Set the buffers of the application the pictures are decoded
+            into. The decoder binds a buffer to each new picture with the
+            bindPicture callback and gives it back with unbindPicture when
+            the picture is no longer needed for reference or display, the
+            pictures output by H264SwDecNextPicture tell in pBufferId the
+            buffer they are in. Saves copying the pictures out of the
+            decoder when the buffers are those the application displays.
+
+            May be called at any time. Pictures the decoder still needs are
+            first copied from the previously set buffers into buffers of the
+            decoder and all the previously set buffers are unbound, i.e.
+            the function also releases the buffers of the application, for
+            example before they are freed.
+
+        Input:
+            decInst     decoder instance.
+            pBuffers    buffers of the application, NULL to decode into
+                        buffers of the decoder
+
+        Output:
+            none
+
+        Returns:
+            H264SWDEC_OK            success
+            H264SWDEC_PARAM_ERR     invalid parameters
+            H264SWDEC_MEMFAIL       memory allocation failed
+
+------------------------------------------------------------------------------*/
+
+H264SwDecRet H264SwDecSetPictureBuffers(H264SwDecInst decInst,
+    const H264SwDecPictureBuffers *pBuffers)
+{
+
+    decContainer_t *pDecCont;
 
+    DEC_API_TRC("H264SwDecSetPictureBuffers#");
+
+    if (decInst == NULL)
+    {
+        DEC_API_TRC("H264SwDecSetPictureBuffers# ERROR: decInst is NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    if (pBuffers != NULL &&
+        (pBuffers->bindPicture == NULL || pBuffers->unbindPicture == NULL))
+    {
+        DEC_API_TRC("H264SwDecSetPictureBuffers# ERROR: callback is NULL");
+        return(H264SWDEC_PARAM_ERR);
+    }
+
+    pDecCont = (decContainer_t*)decInst;
+
+#ifdef H264DEC_TRACE
+    sprintf(pDecCont->str, "H264SwDecSetPictureBuffers# decInst %p pBuffers %p",
+            decInst, (void*)pBuffers);
+    DEC_API_TRC(pDecCont->str);
+#endif
+
+    if (h264bsdSetPictureBuffers(&pDecCont->storage, pBuffers) != HANTRO_OK)
+    {
+        DEC_API_TRC("H264SwDecSetPictureBuffers# ERROR: Memory allocation failed");
+        return(H264SWDEC_MEMFAIL);
+    }
+
+    DEC_API_TRC("H264SwDecSetPictureBuffers# OK");
+
+    return(H264SWDEC_OK);
+
+}
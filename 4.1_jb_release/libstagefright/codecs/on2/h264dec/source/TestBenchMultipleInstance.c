@@ -21,6 +21,7 @@ const char tagName[256] = "$Name: FIRST_ANDROID_COPYRIGHT $";
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #define DEBUG(argv) printf argv
 
@@ -50,9 +51,19 @@ typedef struct
     FILE *foutput;
     char outFileName[256];
     u8 *byteStrmStart;
+    u32 strmLen;
     u32 picNumber;
+    u32 checksum;
 } Decoder;
 
+u32 DecodeStreams(Decoder **decoder, i32 instCount, u32 numThreads,
+    u32 maxNumPics, u32 cropDisplay, u32 disableOutputReordering,
+    u32 verbose);
+
+void OutputPicture(Decoder *decoder, i32 i, u32 cropDisplay, u32 verbose);
+
+double Now(void);
+
 
 /*------------------------------------------------------------------------------
 
@@ -60,14 +71,18 @@ typedef struct
 int main(int argc, char **argv)
 {
 
-    i32 instCount, instRunning;
+    i32 instCount;
     i32 i;
     u32 maxNumPics;
     u32 strmLen;
-    H264SwDecRet ret;
     u32 numErrors = 0;
     u32 cropDisplay = 0;
     u32 disableOutputReordering = 0;
+    u32 numThreads = 1;
+    u32 scaling = 0;
+    u32 numPics, mismatch;
+    u32 *checksums;
+    double start, time, refTime = 0;
     FILE *finput;
     Decoder **decoder;
     char outFileName[256] = "out.yuv";
@@ -82,7 +97,7 @@ int main(int argc, char **argv)
     if (argc < 2)
     {
         DEBUG((
-            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-T] file1.264 [file2.264] .. [fileN.264]\n",
+            "Usage: %s [-Nn] [-Ooutfile] [-P] [-U] [-C] [-R] [-Mn] [-S] [-T] file1.264 [file2.264] .. [fileN.264]\n",
             argv[0]));
         DEBUG(("\t-Nn forces decoding to stop after n pictures\n"));
 #if defined(_NO_OUT)
@@ -93,6 +108,10 @@ int main(int argc, char **argv)
 #endif
         DEBUG(("\t-C display cropped image (default decoded image)\n"));
         DEBUG(("\t-R disable DPB output reordering\n"));
+        DEBUG(("\t-Mn decode each picture with n threads (default 1)\n"));
+        DEBUG(("\t-S decode with 1 to %d threads, check that the output is the same\n"
+               "\t   and print the decoding times, no output is written\n",
+               H264SWDEC_MAX_THREADS));
         DEBUG(("\t-T to print tag name and exit\n"));
         exit(100);
     }
@@ -123,6 +142,16 @@ int main(int argc, char **argv)
             disableOutputReordering = 1;
             instCount--;
         }
+        else if ( strncmp(argv[i], "-M", 2) == 0 )
+        {
+            numThreads = (u32)atoi(argv[i]+2);
+            instCount--;
+        }
+        else if ( strcmp(argv[i], "-S") == 0 )
+        {
+            scaling = 1;
+            instCount--;
+        }
     }
 
     if (instCount < 1)
@@ -134,7 +163,8 @@ int main(int argc, char **argv)
     /* allocate memory for multiple decoder instances
      * one instance for every stream file */
     decoder = (Decoder **)malloc(sizeof(Decoder*)*(u32)instCount);
-    if (decoder == NULL)
+    checksums = (u32 *)malloc(sizeof(u32)*(u32)instCount);
+    if (decoder == NULL || checksums == NULL)
     {
         DEBUG(("Unable to allocate memory\n"));
         exit(100);
@@ -167,9 +197,10 @@ int main(int argc, char **argv)
         }
         fread(decoder[i]->byteStrmStart, sizeof(u8), strmLen, finput);
         fclose(finput);
+        decoder[i]->strmLen = strmLen;
 
         /* open output file */
-        if (strcmp(outFileName, "none") != 0)
+        if (!scaling && strcmp(outFileName, "none") != 0)
         {
 #if defined(_NO_OUT)
             decoder[i]->foutput = NULL;
@@ -183,8 +214,96 @@ int main(int argc, char **argv)
             }
 #endif
         }
+    }
 
-        ret = H264SwDecInit(&(decoder[i]->decInst), disableOutputReordering);
+    if (!scaling)
+    {
+        numErrors = DecodeStreams(decoder, instCount, numThreads, maxNumPics,
+            cropDisplay, disableOutputReordering, 1);
+    }
+    else
+    {
+        /* decode all streams with each number of threads, output of the
+         * single threaded run is the reference */
+        DEBUG(("%8s %10s %10s %8s\n", "threads", "seconds", "fps", "speedup"));
+        for (numThreads = 1; numThreads <= H264SWDEC_MAX_THREADS; numThreads++)
+        {
+            start = Now();
+            numErrors += DecodeStreams(decoder, instCount, numThreads,
+                maxNumPics, cropDisplay, disableOutputReordering, 0);
+            time = Now() - start;
+
+            numPics = 0;
+            mismatch = 0;
+            for (i = 0; i < instCount; i++)
+            {
+                numPics += decoder[i]->picNumber;
+                if (numThreads == 1)
+                    checksums[i] = decoder[i]->checksum;
+                else if (checksums[i] != decoder[i]->checksum)
+                {
+                    DEBUG(("Decoder[%d] output with %d threads differs\n",
+                        i, numThreads));
+                    mismatch = 1;
+                }
+            }
+            if (numThreads == 1)
+                refTime = time;
+
+            DEBUG(("%8d %10.3f %10.1f %8.2f\n", numThreads, time,
+                time > 0 ? numPics / time : 0.0,
+                time > 0 ? refTime / time : 0.0));
+            fflush(stdout);
+
+            if (mismatch)
+                exit(2);
+        }
+    }
+
+    /* close each instance */
+    for (i = 0; i < instCount; i++)
+    {
+        if (decoder[i]->foutput)
+            fclose(decoder[i]->foutput);
+
+        free(decoder[i]->byteStrmStart);
+
+        free(decoder[i]);
+    }
+
+    free(checksums);
+    free(decoder);
+
+    if (numErrors)
+        return 1;
+    else
+        return 0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  DecodeStreams
+
+    Decodes the streams of all instances, a picture of each at a time, with
+    numThreads threads per instance. Returns the number of concealed
+    macroblocks.
+
+------------------------------------------------------------------------------*/
+u32 DecodeStreams(Decoder **decoder, i32 instCount, u32 numThreads,
+    u32 maxNumPics, u32 cropDisplay, u32 disableOutputReordering,
+    u32 verbose)
+{
+
+    i32 instRunning;
+    i32 i;
+    H264SwDecRet ret;
+    u32 numErrors = 0;
+
+    for (i = 0; i < instCount; i++)
+    {
+        ret = H264SwDecInit(&(decoder[i]->decInst), disableOutputReordering,
+            numThreads);
 
         if (ret != H264SWDEC_OK)
         {
@@ -193,9 +312,10 @@ int main(int argc, char **argv)
         }
 
         decoder[i]->decInput.pStream = decoder[i]->byteStrmStart;
-        decoder[i]->decInput.dataLen = strmLen;
+        decoder[i]->decInput.dataLen = decoder[i]->strmLen;
         decoder[i]->decInput.intraConcealmentMethod = 0;
-
+        decoder[i]->picNumber = 0;
+        decoder[i]->checksum = 0;
     }
 
     /* main decoding loop */
@@ -204,6 +324,9 @@ int main(int argc, char **argv)
         /* decode once using each instance */
         for (i = 0; i < instCount; i++)
         {
+            if (decoder[i]->decInput.dataLen == 0)
+                continue;
+
             ret = H264SwDecDecode(decoder[i]->decInst,
                                 &(decoder[i]->decInput),
                                 &(decoder[i]->decOutput));
@@ -218,7 +341,8 @@ int main(int argc, char **argv)
                     if (ret != H264SWDEC_OK)
                         exit(1);
 
-                    if (cropDisplay && decoder[i]->decInfo.croppingFlag)
+                    if (verbose && cropDisplay &&
+                        decoder[i]->decInfo.croppingFlag)
                     {
                         DEBUG(("Decoder[%d] Cropping params: (%d, %d) %dx%d\n",
                             i,
@@ -228,13 +352,16 @@ int main(int argc, char **argv)
                             decoder[i]->decInfo.cropParams.cropOutHeight));
                     }
 
-                    DEBUG(("Decoder[%d] Width %d Height %d\n", i,
-                        decoder[i]->decInfo.picWidth,
-                        decoder[i]->decInfo.picHeight));
+                    if (verbose)
+                    {
+                        DEBUG(("Decoder[%d] Width %d Height %d\n", i,
+                            decoder[i]->decInfo.picWidth,
+                            decoder[i]->decInfo.picHeight));
 
-                    DEBUG(("Decoder[%d] videoRange %d, matricCoefficients %d\n",
-                        i, decoder[i]->decInfo.videoRange,
-                        decoder[i]->decInfo.matrixCoefficients));
+                        DEBUG(("Decoder[%d] videoRange %d, matricCoefficients %d\n",
+                            i, decoder[i]->decInfo.videoRange,
+                            decoder[i]->decInfo.matrixCoefficients));
+                    }
                     decoder[i]->decInput.dataLen -=
                         (u32)(decoder[i]->decOutput.pStrmCurrPos -
                               decoder[i]->decInput.pStream);
@@ -261,23 +388,11 @@ int main(int argc, char **argv)
                     while (H264SwDecNextPicture(decoder[i]->decInst,
                             &(decoder[i]->decPicture), 0) == H264SWDEC_PIC_RDY)
                     {
-                        decoder[i]->picNumber++;
-
                         numErrors += decoder[i]->decPicture.nbrOfErrMBs;
-
-                        DEBUG(("Decoder[%d] PIC %d, type %s, concealed %d\n",
-                            i, decoder[i]->picNumber,
-                            decoder[i]->decPicture.isIdrPicture
-                                ? "IDR" : "NON-IDR",
-                            decoder[i]->decPicture.nbrOfErrMBs));
-                        fflush(stdout);
-
-                        CropWriteOutput(decoder[i]->foutput,
-                                (u8*)decoder[i]->decPicture.pOutputPicture,
-                                cropDisplay, &(decoder[i]->decInfo));
+                        OutputPicture(decoder[i], i, cropDisplay, verbose);
                     }
 
-                    if (maxNumPics && decoder[i]->picNumber == maxNumPics)
+                    if (maxNumPics && decoder[i]->picNumber >= maxNumPics)
                         decoder[i]->decInput.dataLen = 0;
                     break;
 
@@ -306,43 +421,69 @@ int main(int argc, char **argv)
     } while (instRunning);
 
 
-    /* get last frames and close each instance */
+    /* get last frames and release each instance */
     for (i = 0; i < instCount; i++)
     {
         while (H264SwDecNextPicture(decoder[i]->decInst,
                 &(decoder[i]->decPicture), 1) == H264SWDEC_PIC_RDY)
         {
-            decoder[i]->picNumber++;
-
-            DEBUG(("Decoder[%d] PIC %d, type %s, concealed %d\n",
-                i, decoder[i]->picNumber,
-                decoder[i]->decPicture.isIdrPicture
-                    ? "IDR" : "NON-IDR",
-                decoder[i]->decPicture.nbrOfErrMBs));
-            fflush(stdout);
-
-            CropWriteOutput(decoder[i]->foutput,
-                    (u8*)decoder[i]->decPicture.pOutputPicture,
-                    cropDisplay, &(decoder[i]->decInfo));
+            OutputPicture(decoder[i], i, cropDisplay, verbose);
         }
 
         H264SwDecRelease(decoder[i]->decInst);
+    }
 
-        if (decoder[i]->foutput)
-            fclose(decoder[i]->foutput);
+    return numErrors;
 
-        free(decoder[i]->byteStrmStart);
+}
 
-        free(decoder[i]);
+/*------------------------------------------------------------------------------
+
+    Function name:  OutputPicture
+
+    Writes out the picture in decPicture and adds it into the checksum of
+    the instance.
+
+------------------------------------------------------------------------------*/
+void OutputPicture(Decoder *decoder, i32 i, u32 cropDisplay, u32 verbose)
+{
+    u32 *p = decoder->decPicture.pOutputPicture;
+    u32 n;
+
+    decoder->picNumber++;
+
+    if (verbose)
+    {
+        DEBUG(("Decoder[%d] PIC %d, type %s, concealed %d\n",
+            i, decoder->picNumber,
+            decoder->decPicture.isIdrPicture ? "IDR" : "NON-IDR",
+            decoder->decPicture.nbrOfErrMBs));
+        fflush(stdout);
     }
 
-    free(decoder);
+    /* picture size in words, always a multiple of 384/4 */
+    n = decoder->decInfo.picWidth * decoder->decInfo.picHeight * 3 / 8;
+    while (n--)
+        decoder->checksum = decoder->checksum * 31 + *p++;
 
-    if (numErrors)
-        return 1;
-    else
-        return 0;
+    CropWriteOutput(decoder->foutput, (u8*)decoder->decPicture.pOutputPicture,
+            cropDisplay, &(decoder->decInfo));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function name:  Now
+
+    Monotonic time in seconds.
+
+------------------------------------------------------------------------------*/
+double Now(void)
+{
+    struct timespec ts;
 
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
 /*------------------------------------------------------------------------------
@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdFilterPicture
+          h264bsdFilterRows
           FilterVerLumaEdge
           FilterHorLumaEdge
           FilterHorLuma
@@ -551,12 +552,7 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
     Function: h264bsdFilterPicture
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for a picture, see h264bsdFilterRows.
 
         Inputs:
           image         pointer to image to be filtered
@@ -570,12 +566,59 @@ u32 EdgeBoundaryStrengthLeft(mbStorage_t *mb1, mbStorage_t *mb2)
           none
 
 ------------------------------------------------------------------------------*/
-#ifndef H264DEC_OMXDL
+
 void h264bsdFilterPicture(
   image_t *image,
   mbStorage_t *mb)
 {
 
+/* Code */
+
+    ASSERT(image);
+
+    h264bsdFilterRows(image, mb, 0, image->height);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdFilterRows
+
+        Functional description:
+          Perform deblocking filtering for macroblock rows firstRow to
+          lastRow - 1 of a picture. Filter does not copy the original picture
+          anywhere but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Filtering of a row changes the bottom three pixel rows of the
+          macroblock row above it, so rows have to be filtered in order.
+          Filtering the rows of a picture in any number of calls gives the
+          same result as filtering them all at once.
+
+        Inputs:
+          image         pointer to image to be filtered
+          mb            pointer to macroblock data structure of the top-left
+                        macroblock of the picture
+          firstRow      first macroblock row to filter
+          lastRow       macroblock row after the last one to filter
+
+        Outputs:
+          image         filtered image stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+#ifndef H264DEC_OMXDL
+void h264bsdFilterRows(
+  image_t *image,
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 lastRow)
+{
+
 /* Variables */
 
     u32 flags;
@@ -598,9 +641,11 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= lastRow && lastRow <= image->height);
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    pMb = mb + firstRow * picWidthInMbs;
+
+    for (mbRow = firstRow, mbCol = 0; mbRow < lastRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
@@ -1739,20 +1784,27 @@ void FilterChroma(
 
 /*------------------------------------------------------------------------------
 
-    Function: h264bsdFilterPicture
+    Function: h264bsdFilterRows
 
         Functional description:
-          Perform deblocking filtering for a picture. Filter does not copy
-          the original picture anywhere but filtering is performed directly
-          on the original image. Parameters controlling the filtering process
-          are computed based on information in macroblock structures of the
-          filtered macroblock, macroblock above and macroblock on the left of
-          the filtered one.
+          Perform deblocking filtering for macroblock rows firstRow to
+          lastRow - 1 of a picture. Filter does not copy the original picture
+          anywhere but filtering is performed directly on the original image.
+          Parameters controlling the filtering process are computed based on
+          information in macroblock structures of the filtered macroblock,
+          macroblock above and macroblock on the left of the filtered one.
+
+          Filtering of a row changes the bottom three pixel rows of the
+          macroblock row above it, so rows have to be filtered in order.
+          Filtering the rows of a picture in any number of calls gives the
+          same result as filtering them all at once.
 
         Inputs:
           image         pointer to image to be filtered
           mb            pointer to macroblock data structure of the top-left
                         macroblock of the picture
+          firstRow      first macroblock row to filter
+          lastRow       macroblock row after the last one to filter
 
         Outputs:
           image         filtered image stored here
@@ -1763,9 +1815,11 @@ void FilterChroma(
 ------------------------------------------------------------------------------*/
 
 /*lint --e{550} Symbol not accessed */
-void h264bsdFilterPicture(
+void h264bsdFilterRows(
   image_t *image,
-  mbStorage_t *mb)
+  mbStorage_t *mb,
+  u32 firstRow,
+  u32 lastRow)
 {
 
 /* Variables */
@@ -1794,9 +1848,11 @@ void h264bsdFilterPicture(
     data = image->data;
     picSizeInMbs = picWidthInMbs * image->height;
 
-    pMb = mb;
+    ASSERT(firstRow <= lastRow && lastRow <= image->height);
+
+    pMb = mb + firstRow * picWidthInMbs;
 
-    for (mbRow = 0, mbCol = 0; mbRow < image->height; pMb++)
+    for (mbRow = firstRow, mbCol = 0; mbRow < lastRow; pMb++)
     {
         flags = GetMbFilteringFlags(pMb);
 
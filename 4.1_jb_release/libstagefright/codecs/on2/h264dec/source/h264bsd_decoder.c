@@ -28,6 +28,7 @@
           h264bsdShutdown
           h264bsdCurrentImage
           h264bsdNextOutputPicture
+          h264bsdSetPictureBuffers
           h264bsdPicWidth
           h264bsdPicHeight
           h264bsdFlushBuffer
@@ -54,6 +55,7 @@
 #include "h264bsd_dpb.h"
 #include "h264bsd_deblocking.h"
 #include "h264bsd_conceal.h"
+#include "h264bsd_mt.h"
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -77,6 +79,8 @@
         Inputs:
             noOutputReordering  flag to indicate the decoder that it does not
                                 have to perform reordering of display images.
+            numThreads          number of threads decoding a picture, see
+                                h264bsd_mt.c
 
         Outputs:
             pStorage            pointer to initialized storage structure
@@ -86,7 +90,7 @@
 
 ------------------------------------------------------------------------------*/
 
-u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering)
+u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering, u32 numThreads)
 {
 
 /* Variables */
@@ -108,6 +112,13 @@ u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering)
     if (noOutputReordering)
         pStorage->noReordering = HANTRO_TRUE;
 
+    if (numThreads > 1)
+    {
+        pStorage->mt = h264bsdMtInit(numThreads);
+        if (!pStorage->mt)
+            return HANTRO_NOK;
+    }
+
     return HANTRO_OK;
 }
 
@@ -242,6 +253,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
             {
                 pStorage->currImage->data =
                     h264bsdAllocateDpbImage(pStorage->dpb);
+                if (pStorage->currImage->data == NULL)
+                    return(H264BSD_MEMALLOC_ERROR);
                 h264bsdInitRefPicList(pStorage->dpb);
                 tmp = h264bsdConceal(pStorage, pStorage->currImage, P_SLICE);
             }
@@ -420,6 +433,8 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
                     }
                     pStorage->currImage->data =
                         h264bsdAllocateDpbImage(pStorage->dpb);
+                    if (pStorage->currImage->data == NULL)
+                        return(H264BSD_MEMALLOC_ERROR);
                 }
 
                 /* store slice header to storage if successfully decoded */
@@ -471,7 +486,11 @@ u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
 
     if (picReady)
     {
-        h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
+        if (pStorage->mt)
+            h264bsdMtFilterPicture(pStorage->mt, pStorage->currImage,
+                pStorage->mb);
+        else
+            h264bsdFilterPicture(pStorage->currImage, pStorage->mb);
 
         h264bsdResetStorage(pStorage);
 
@@ -563,6 +582,9 @@ void h264bsdShutdown(storage_t *pStorage)
         }
     }
 
+    h264bsdMtShutdown(pStorage->mt);
+    pStorage->mt = NULL;
+
     FREE(pStorage->mbLayer);
     FREE(pStorage->mb);
     FREE(pStorage->sliceGroupMap);
@@ -586,6 +608,8 @@ void h264bsdShutdown(storage_t *pStorage)
             isIdrPic    IDR flag of the picture will be stored here
             numErrMbs   number of concealed macroblocks in the picture
                         will be stored here
+            pBufferId   identifier of the application buffer of the
+                        picture, NULL if not in an application buffer
 
         Returns:
             pointer to the picture data
@@ -594,7 +618,7 @@ void h264bsdShutdown(storage_t *pStorage)
 ------------------------------------------------------------------------------*/
 
 u8* h264bsdNextOutputPicture(storage_t *pStorage, u32 *picId, u32 *isIdrPic,
-    u32 *numErrMbs)
+    u32 *numErrMbs, void **pBufferId)
 {
 
 /* Variables */
@@ -612,6 +636,7 @@ u8* h264bsdNextOutputPicture(storage_t *pStorage, u32 *picId, u32 *isIdrPic,
         *picId = pOut->picId;
         *isIdrPic = pOut->isIdr;
         *numErrMbs = pOut->numErrMbs;
+        *pBufferId = pOut->pBufferId;
         return (pOut->data);
     }
     else
@@ -619,6 +644,54 @@ u8* h264bsdNextOutputPicture(storage_t *pStorage, u32 *picId, u32 *isIdrPic,
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetPictureBuffers
+
+        Functional description:
+            Set the application buffers the pictures are decoded into, see
+            h264bsdSetDpbPictureBuffers. Pictures kept by the decoder are
+            moved out of the previous application buffers, also the one
+            being decoded.
+
+        Inputs:
+            pStorage    pointer to storage data structure
+            pBuffers    application picture buffers, NULL for none
+
+        Outputs:
+            none
+
+        Returns:
+            HANTRO_OK                   success
+            MEMORY_ALLOCATION_ERROR     memory allocation failed
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetPictureBuffers(storage_t *pStorage,
+    const H264SwDecPictureBuffers *pBuffers)
+{
+
+/* Variables */
+
+    u32 tmp;
+    u8 *data;
+
+/* Code */
+
+    ASSERT(pStorage);
+
+    data = pStorage->currImage->data;
+
+    tmp = h264bsdSetDpbPictureBuffers(pStorage->dpb, pBuffers,
+        pStorage->currImage);
+
+    if (pStorage->mt && pStorage->currImage->data != data)
+        h264bsdMtMoveImage(pStorage->mt, pStorage->currImage);
+
+    return(tmp);
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: h264bsdPicWidth
@@ -57,13 +57,15 @@ enum {
     4. Function prototypes
 ------------------------------------------------------------------------------*/
 
-u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering);
+u32 h264bsdInit(storage_t *pStorage, u32 noOutputReordering, u32 numThreads);
 u32 h264bsdDecode(storage_t *pStorage, u8 *byteStrm, u32 len, u32 picId,
     u32 *readBytes);
 void h264bsdShutdown(storage_t *pStorage);
 
 u8* h264bsdNextOutputPicture(storage_t *pStorage, u32 *picId, u32 *isIdrPic,
-    u32 *numErrMbs);
+    u32 *numErrMbs, void **pBufferId);
+u32 h264bsdSetPictureBuffers(storage_t *pStorage,
+    const H264SwDecPictureBuffers *pBuffers);
 
 u32 h264bsdPicWidth(storage_t *pStorage);
 u32 h264bsdPicHeight(storage_t *pStorage);
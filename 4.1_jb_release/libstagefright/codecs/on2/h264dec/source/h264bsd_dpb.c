@@ -46,6 +46,12 @@
           h264bsdDpbOutputPicture
           h264bsdFlushDpb
           h264bsdFreeDpb
+          h264bsdSetDpbPictureBuffers
+          BindPicture
+          UnbindPicture
+          UnbindUnusedPictures
+          IsOutputPending
+          ExchangeData
 
 ------------------------------------------------------------------------------*/
 
@@ -114,6 +120,16 @@ static u32 OutputPicture(dpbStorage_t *dpb);
 
 static void ShellSort(dpbPicture_t *pPic, u32 num);
 
+static u32 BindPicture(dpbStorage_t *dpb, dpbPicture_t *pPic);
+
+static void UnbindPicture(dpbStorage_t *dpb, dpbPicture_t *pPic);
+
+static void UnbindUnusedPictures(dpbStorage_t *dpb);
+
+static u32 IsOutputPending(dpbStorage_t *dpb, u8 *data);
+
+static void ExchangeData(dpbPicture_t *pPic1, dpbPicture_t *pPic2);
+
 /*------------------------------------------------------------------------------
 
     Function: ComparePictures
@@ -807,6 +823,7 @@ u32 h264bsdMarkDecRefPic(
         ASSERT(dpb->numOut == 0);
         ASSERT(dpb->outIndex == 0);
         dpb->outBuf[dpb->numOut].data  = dpb->currentOut->data;
+        dpb->outBuf[dpb->numOut].pBufferId = dpb->currentOut->pBufferId;
         dpb->outBuf[dpb->numOut].isIdr = dpb->currentOut->isIdr;
         dpb->outBuf[dpb->numOut].picId = dpb->currentOut->picId;
         dpb->outBuf[dpb->numOut].numErrMbs = dpb->currentOut->numErrMbs;
@@ -825,6 +842,8 @@ u32 h264bsdMarkDecRefPic(
     /* sort dpb */
     ShellSort(dpb->buffer, dpb->dpbSize+1);
 
+    UnbindUnusedPictures(dpb);
+
     return(status);
 
 }
@@ -864,12 +883,16 @@ u8* h264bsdGetRefPicData(dpbStorage_t *dpb, u32 index)
     Function: h264bsdAllocateDpbImage
 
         Functional description:
-            function to allocate memory for a image. This function does not
-            really allocate any memory but reserves one of the buffer
-            positions for decoding of current picture
+            function to allocate memory for a image. This function reserves
+            one of the buffer positions for decoding of current picture. If
+            the application has set picture buffers, the picture is bound
+            to a new application buffer, otherwise (or if the application
+            has none available) the buffer of the position is used and
+            allocated if missing.
 
         Returns:
             pointer to memory area for the image
+            NULL if memory allocation failed
 
 
 ------------------------------------------------------------------------------*/
@@ -887,6 +910,9 @@ u8* h264bsdAllocateDpbImage(dpbStorage_t *dpb)
 
     dpb->currentOut = dpb->buffer + dpb->dpbSize;
 
+    if (BindPicture(dpb, dpb->currentOut) != HANTRO_OK)
+        return(NULL);
+
     return(dpb->currentOut->data);
 
 }
@@ -958,7 +984,9 @@ static u32 SlidingWindowRefPicMarking(dpbStorage_t *dpb)
             If noReordering flag is FALSE the DPB stores dpbSize pictures
             for display reordering purposes. On the other hand, if the
             flag is TRUE the DPB only stores maxRefFrames reference pictures
-            and outputs all the pictures immediately.
+            and outputs all the pictures immediately. Picture buffers are
+            not allocated if the application has set picture buffers,
+            h264bsdAllocateDpbImage binds or allocates them on demand.
 
         Inputs:
             picSizeInMbs    picture size in macroblocks
@@ -1009,13 +1037,16 @@ u32 h264bsdInitDpb(
     dpb->fullness            = 0;
     dpb->numRefFrames        = 0;
     dpb->prevRefFrameNum     = 0;
+    /* 32 bytes beyond the picture for the reads of the OpenMax DL functions,
+     * see below */
+    dpb->picSize             = picSizeInMbs*384 + 32;
 
     ALLOCATE(dpb->buffer, MAX_NUM_REF_IDX_L0_ACTIVE + 1, dpbPicture_t);
     if (dpb->buffer == NULL)
         return(MEMORY_ALLOCATION_ERROR);
     H264SwDecMemset(dpb->buffer, 0,
             (MAX_NUM_REF_IDX_L0_ACTIVE + 1)*sizeof(dpbPicture_t));
-    for (i = 0; i < dpb->dpbSize + 1; i++)
+    for (i = 0; !dpb->picBuffers.bindPicture && i < dpb->dpbSize + 1; i++)
     {
         /* Allocate needed amount of memory, which is:
          * image size + 32 + 15, where 32 cames from the fact that in ARM OpenMax
@@ -1249,6 +1280,7 @@ u32 h264bsdCheckGapsInFrameNum(dpbStorage_t *dpb, u32 frameNum, u32 isRefPic,
 
     u32 unUsedShortTermFrameNum;
     u8 *tmp;
+    u32 i;
 
 /* Code */
 
@@ -1316,31 +1348,22 @@ u32 h264bsdCheckGapsInFrameNum(dpbStorage_t *dpb, u32 frameNum, u32 isRefPic,
          * buffer position dpbSize is not in the output buffer (this will be
          * "allocated" by h264bsdAllocateDpbImage). If it is -> exchange data
          * pointer with the one stored in the beginning */
-        if (dpb->numOut)
+        if (IsOutputPending(dpb, dpb->buffer[dpb->dpbSize].data))
         {
-            u32 i;
-
-            for (i = 0; i < dpb->numOut; i++)
+            /* find buffer position containing data pointer stored in tmp */
+            for (i = 0; i < dpb->dpbSize; i++)
             {
-                if (dpb->outBuf[i].data == dpb->buffer[dpb->dpbSize].data)
+                if (dpb->buffer[i].data == tmp)
                 {
-                    /* find buffer position containing data pointer stored in
-                     * tmp */
-                    for (i = 0; i < dpb->dpbSize; i++)
-                    {
-                        if (dpb->buffer[i].data == tmp)
-                        {
-                            dpb->buffer[i].data =
-                                dpb->buffer[dpb->dpbSize].data;
-                            dpb->buffer[dpb->dpbSize].data = tmp;
-                            break;
-                        }
-                    }
-                    ASSERT(i < dpb->dpbSize);
+                    ExchangeData(dpb->buffer + i,
+                        dpb->buffer + dpb->dpbSize);
                     break;
                 }
             }
+            ASSERT(i < dpb->dpbSize);
         }
+
+        UnbindUnusedPictures(dpb);
     }
     /* frameNum for reference pictures shall not be the same as for previous
      * reference picture, otherwise accesses to pictures in the buffer cannot
@@ -1441,6 +1464,7 @@ u32 OutputPicture(dpbStorage_t *dpb)
         return(HANTRO_NOK);
 
     dpb->outBuf[dpb->numOut].data  = tmp->data;
+    dpb->outBuf[dpb->numOut].pBufferId = tmp->pBufferId;
     dpb->outBuf[dpb->numOut].isIdr = tmp->isIdr;
     dpb->outBuf[dpb->numOut].picId = tmp->picId;
     dpb->outBuf[dpb->numOut].numErrMbs = tmp->numErrMbs;
@@ -1462,6 +1486,9 @@ u32 OutputPicture(dpbStorage_t *dpb)
 
         Functional description:
             Function to get next display order picture from the output buffer.
+            The application buffers of pictures no longer needed are unbound,
+            the one of the returned picture stays bound until the next call
+            or the next picture is decoded.
 
         Return:
             pointer to output picture structure, NULL if no pictures to
@@ -1478,6 +1505,8 @@ dpbOutPicture_t* h264bsdDpbOutputPicture(dpbStorage_t *dpb)
 
     ASSERT(dpb);
 
+    UnbindUnusedPictures(dpb);
+
     if (dpb->outIndex < dpb->numOut)
         return(dpb->outBuf + dpb->outIndex++);
     else
@@ -1516,7 +1545,8 @@ void h264bsdFlushDpb(dpbStorage_t *dpb)
     Function: h264bsdFreeDpb
 
         Functional description:
-            Function to free memories reserved for the DPB.
+            Function to free memories reserved for the DPB and to unbind the
+            application buffers.
 
 ------------------------------------------------------------------------------*/
 
@@ -1535,6 +1565,7 @@ void h264bsdFreeDpb(dpbStorage_t *dpb)
     {
         for (i = 0; i < dpb->dpbSize+1; i++)
         {
+            UnbindPicture(dpb, dpb->buffer + i);
             FREE(dpb->buffer[i].pAllocatedData);
         }
     }
@@ -1544,6 +1575,267 @@ void h264bsdFreeDpb(dpbStorage_t *dpb)
 
 }
 
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetDpbPictureBuffers
+
+        Functional description:
+            Function to set the application picture buffers. Pictures still
+            needed for reference or display and the picture being decoded
+            are first copied from the previous application buffers into
+            buffers of the decoder, after which all the previous application
+            buffers are unbound.
+
+        Inputs:
+            dpb         pointer to dpb data structure
+            pBuffers    application picture buffers, NULL for none
+            image       current image
+
+        Outputs:
+            image       'data' updated if the current image was copied
+
+        Returns:
+            HANTRO_OK       success
+            MEMORY_ALLOCATION_ERROR if memory allocation failed
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdSetDpbPictureBuffers(dpbStorage_t *dpb,
+    const H264SwDecPictureBuffers *pBuffers, image_t *image)
+{
+
+/* Variables */
+
+    u32 i, j;
+    u8 *data;
+    dpbPicture_t *pPic;
+
+/* Code */
+
+    ASSERT(dpb);
+    ASSERT(image);
+
+    for (i = 0; dpb->buffer && i < dpb->dpbSize+1; i++)
+    {
+        pPic = dpb->buffer + i;
+        if (pPic->pBufferId == NULL)
+            continue;
+
+        data = NULL;
+        if (IS_EXISTING(*pPic) || pPic->toBeDisplayed ||
+            IsOutputPending(dpb, pPic->data) || pPic->data == image->data)
+        {
+            ASSERT(pPic->pAllocatedData == NULL);
+            ALLOCATE(pPic->pAllocatedData, dpb->picSize + 15, u8);
+            if (pPic->pAllocatedData == NULL)
+                return(MEMORY_ALLOCATION_ERROR);
+            data = ALIGN(pPic->pAllocatedData, 16);
+            H264SwDecMemcpy(data, pPic->data, dpb->picSize);
+
+            for (j = dpb->outIndex; j < dpb->numOut; j++)
+            {
+                if (dpb->outBuf[j].data == pPic->data)
+                {
+                    dpb->outBuf[j].data = data;
+                    dpb->outBuf[j].pBufferId = NULL;
+                }
+            }
+            if (image->data == pPic->data)
+                image->data = data;
+        }
+
+        UnbindPicture(dpb, pPic);
+        pPic->data = data;
+    }
+
+    if (pBuffers)
+        dpb->picBuffers = *pBuffers;
+    else
+        H264SwDecMemset(&dpb->picBuffers, 0, sizeof(dpb->picBuffers));
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: BindPicture
+
+        Functional description:
+            Function to get a buffer for a picture. The application buffer
+            bound to the picture is unbound and a new one is requested. If
+            the application does not provide one, the buffer of the decoder
+            is used, allocating it if missing. The buffer of the decoder is
+            freed when an application buffer is bound.
+
+        Returns:
+            HANTRO_OK       success
+            MEMORY_ALLOCATION_ERROR if memory allocation failed
+
+------------------------------------------------------------------------------*/
+
+static u32 BindPicture(dpbStorage_t *dpb, dpbPicture_t *pPic)
+{
+
+/* Variables */
+
+    u8 *data;
+    void *pBufferId;
+
+/* Code */
+
+    UnbindPicture(dpb, pPic);
+
+    if (dpb->picBuffers.bindPicture)
+    {
+        pBufferId = NULL;
+        data = dpb->picBuffers.bindPicture(dpb->picBuffers.pUserData,
+            dpb->picSize, &pBufferId);
+        if (data != NULL)
+        {
+            ASSERT(pBufferId != NULL);
+            ASSERT(data == ALIGN(data, 16));
+            FREE(pPic->pAllocatedData);
+            pPic->data = data;
+            pPic->pBufferId = pBufferId;
+            return(HANTRO_OK);
+        }
+    }
+
+    if (pPic->pAllocatedData == NULL)
+    {
+        ALLOCATE(pPic->pAllocatedData, dpb->picSize + 15, u8);
+        if (pPic->pAllocatedData == NULL)
+            return(MEMORY_ALLOCATION_ERROR);
+    }
+    pPic->data = ALIGN(pPic->pAllocatedData, 16);
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: UnbindPicture
+
+        Functional description:
+            Function to give the application buffer of a picture back to
+            the application.
+
+------------------------------------------------------------------------------*/
+
+static void UnbindPicture(dpbStorage_t *dpb, dpbPicture_t *pPic)
+{
+
+/* Code */
+
+    if (pPic->pBufferId)
+    {
+        ASSERT(dpb->picBuffers.unbindPicture);
+        dpb->picBuffers.unbindPicture(dpb->picBuffers.pUserData,
+            pPic->pBufferId);
+        pPic->pBufferId = NULL;
+        pPic->data = NULL;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: UnbindUnusedPictures
+
+        Functional description:
+            Function to unbind the application buffers of pictures that are
+            not needed for reference or display and not waiting in the
+            output buffer. Buffer position dpbSize is left alone, it holds
+            the picture being decoded or is bound again by
+            h264bsdAllocateDpbImage.
+
+------------------------------------------------------------------------------*/
+
+static void UnbindUnusedPictures(dpbStorage_t *dpb)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    for (i = 0; i < dpb->dpbSize; i++)
+    {
+        if (dpb->buffer[i].pBufferId &&
+            !IS_EXISTING(dpb->buffer[i]) &&
+            !dpb->buffer[i].toBeDisplayed &&
+            !IsOutputPending(dpb, dpb->buffer[i].data))
+        {
+            UnbindPicture(dpb, dpb->buffer + i);
+        }
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: IsOutputPending
+
+        Functional description:
+            Function to check if a picture is in the output buffer and not
+            yet given to the application.
+
+------------------------------------------------------------------------------*/
+
+static u32 IsOutputPending(dpbStorage_t *dpb, u8 *data)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    for (i = dpb->outIndex; i < dpb->numOut; i++)
+    {
+        if (dpb->outBuf[i].data == data)
+            return(HANTRO_TRUE);
+    }
+
+    return(HANTRO_FALSE);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: ExchangeData
+
+        Functional description:
+            Function to exchange the buffers of two pictures.
+
+------------------------------------------------------------------------------*/
+
+static void ExchangeData(dpbPicture_t *pPic1, dpbPicture_t *pPic2)
+{
+
+/* Variables */
+
+    dpbPicture_t tmp;
+
+/* Code */
+
+    tmp.data = pPic1->data;
+    tmp.pAllocatedData = pPic1->pAllocatedData;
+    tmp.pBufferId = pPic1->pBufferId;
+
+    pPic1->data = pPic2->data;
+    pPic1->pAllocatedData = pPic2->pAllocatedData;
+    pPic1->pBufferId = pPic2->pBufferId;
+
+    pPic2->data = tmp.data;
+    pPic2->pAllocatedData = tmp.pAllocatedData;
+    pPic2->pBufferId = tmp.pBufferId;
+
+}
+
 /*------------------------------------------------------------------------------
 
     Function: ShellSort
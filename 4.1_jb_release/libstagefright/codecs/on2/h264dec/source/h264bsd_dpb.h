@@ -33,6 +33,7 @@
 ------------------------------------------------------------------------------*/
 
 #include "basetype.h"
+#include "H264SwDecApi.h"
 #include "h264bsd_slice_header.h"
 #include "h264bsd_image.h"
 
@@ -54,8 +55,10 @@ typedef enum {
 
 /* structure to represent a buffered picture */
 typedef struct {
-    u8 *data;           /* 16-byte aligned pointer of pAllocatedData */
+    u8 *data;           /* 16-byte aligned pointer of pAllocatedData or
+                           application buffer, NULL if neither present */
     u8 *pAllocatedData; /* allocated picture pointer; (size + 15) bytes */
+    void *pBufferId;    /* application buffer bound to the picture */
     i32 picNum;
     u32 frameNum;
     i32 picOrderCnt;
@@ -69,6 +72,7 @@ typedef struct {
 /* structure to represent display image output from the buffer */
 typedef struct {
     u8 *data;
+    void *pBufferId;
     u32 picId;
     u32 numErrMbs;
     u32 isIdr;
@@ -92,6 +96,9 @@ typedef struct {
     u32 lastContainsMmco5;
     u32 noReordering;
     u32 flushed;
+    u32 picSize;        /* bytes needed for a picture buffer */
+    H264SwDecPictureBuffers picBuffers; /* application picture buffers,
+                                           bindPicture NULL if not used */
 } dpbStorage_t;
 
 /*------------------------------------------------------------------------------
@@ -145,5 +152,8 @@ void h264bsdFlushDpb(dpbStorage_t *dpb);
 
 void h264bsdFreeDpb(dpbStorage_t *dpb);
 
+u32 h264bsdSetDpbPictureBuffers(dpbStorage_t *dpb,
+    const H264SwDecPictureBuffers *pBuffers, image_t *image);
+
 #endif /* #ifdef H264SWDEC_DPB_H */
 
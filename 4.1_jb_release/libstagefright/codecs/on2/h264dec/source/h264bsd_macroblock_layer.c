@@ -34,6 +34,8 @@
           CbpIntra16x16
           h264bsdPredModeIntra16x16
           h264bsdDecodeMacroblock
+          h264bsdSetMacroblockState
+          h264bsdReconstructMacroblock
           ProcessResidual
           h264bsdSubMbPartMode
 
@@ -966,52 +968,161 @@ u32 h264bsdDecodeMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
     u32 constrainedIntraPredFlag, u8* data)
 {
 
+/* Code */
+
+    h264bsdSetMacroblockState(pMb, pMbLayer, qpY);
+
+    return(h264bsdReconstructMacroblock(pMb, pMbLayer, currImage, dpb, mbNum,
+        constrainedIntraPredFlag, data));
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdSetMacroblockState
+
+        Functional description:
+          First half of h264bsdDecodeMacroblock. Stores the macroblock type,
+          quantization parameter and numbers of coefficients of the
+          macroblock into its mbStorage structure and marks the macroblock
+          decoded. Parsing of the following macroblocks of the slice only
+          depends on this information, so it is all that has to be done
+          before the next macroblock can be parsed.
+
+        Inputs:
+          pMb           pointer to macroblock specific information
+          mbLayer       pointer to current macroblock data from stream
+          qpY           pointer to slice QP
+
+        Outputs:
+          pMb           structure is updated with current macroblock
+          qpY           QP of the macroblock is stored here
+
+        Returns:
+          none
+
+------------------------------------------------------------------------------*/
+
+void h264bsdSetMacroblockState(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
+    i32 *qpY)
+{
+
 /* Variables */
 
-    u32 i, tmp;
+    u32 i;
     mbType_e mbType;
-#ifdef H264DEC_OMXDL
-    const u8 *pSrc;
-#endif
+
 /* Code */
 
     ASSERT(pMb);
     ASSERT(pMbLayer);
-    ASSERT(currImage);
     ASSERT(qpY && *qpY < 52);
-    ASSERT(mbNum < currImage->width*currImage->height);
 
     mbType = pMbLayer->mbType;
     pMb->mbType = mbType;
 
     pMb->decoded++;
 
-    h264bsdSetCurrImageMbPointers(currImage, mbNum);
-
     if (mbType == I_PCM)
     {
-        u8 *pData = (u8*)data;
 #ifdef H264DEC_OMXDL
         u8 *tot = pMb->totalCoeff;
 #else
         i16 *tot = pMb->totalCoeff;
 #endif
-        i32 *lev = pMbLayer->residual.level[0];
 
         pMb->qpY = 0;
 
+        for (i = 24; i--;)
+            *tot++ = 16;
+    }
+    else if (mbType != P_Skip)
+    {
+        H264SwDecMemcpy(pMb->totalCoeff,
+                        pMbLayer->residual.totalCoeff,
+                        27*sizeof(*pMb->totalCoeff));
+
+        /* update qpY */
+        if (pMbLayer->mbQpDelta)
+        {
+            *qpY = *qpY + pMbLayer->mbQpDelta;
+            if (*qpY < 0) *qpY += 52;
+            else if (*qpY >= 52) *qpY -= 52;
+        }
+        pMb->qpY = (u32)*qpY;
+    }
+    else
+    {
+        H264SwDecMemset(pMb->totalCoeff, 0, 27*sizeof(*pMb->totalCoeff));
+        pMb->qpY = (u32)*qpY;
+    }
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdReconstructMacroblock
+
+        Functional description:
+          Second half of h264bsdDecodeMacroblock. Performs the prediction
+          and residual processing of a macroblock whose state has been set
+          by h264bsdSetMacroblockState and writes it into output image.
+          Reads the mbStorage and image data of the neighbouring macroblocks
+          A, B, C and D, which thus have to be reconstructed before.
+
+        Inputs:
+          pMb           pointer to macroblock specific information
+          mbLayer       pointer to current macroblock data from stream
+          currImage     pointer to output image
+          dpb           pointer to decoded picture buffer
+          mbNum         current macroblock number
+          constrainedIntraPred  flag specifying if neighbouring inter
+                                macroblocks are used in intra prediction
+
+        Outputs:
+          pMb           structure is updated with current macroblock
+          currImage     decoded macroblock is written into output image
+
+        Returns:
+          HANTRO_OK     success
+          HANTRO_NOK    error in macroblock decoding
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdReconstructMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
+    image_t *currImage, dpbStorage_t *dpb, u32 mbNum,
+    u32 constrainedIntraPredFlag, u8* data)
+{
+
+/* Variables */
+
+    u32 i, tmp;
+    mbType_e mbType;
+#ifdef H264DEC_OMXDL
+    const u8 *pSrc;
+#endif
+/* Code */
+
+    ASSERT(pMb);
+    ASSERT(pMbLayer);
+    ASSERT(currImage);
+    ASSERT(mbNum < currImage->width*currImage->height);
+
+    mbType = pMbLayer->mbType;
+
+    h264bsdSetCurrImageMbPointers(currImage, mbNum);
+
+    if (mbType == I_PCM)
+    {
+        u8 *pData = (u8*)data;
+        i32 *lev = pMbLayer->residual.level[0];
+
         /* if decoded flag > 1 -> mb has already been successfully decoded and
          * written to output -> do not write again */
         if (pMb->decoded > 1)
-        {
-            for (i = 24; i--;)
-                *tot++ = 16;
             return HANTRO_OK;
-        }
 
         for (i = 24; i--;)
         {
-            *tot++ = 16;
             for (tmp = 16; tmp--;)
                 *pData++ = (u8)(*lev++);
         }
@@ -1031,19 +1142,6 @@ u32 h264bsdDecodeMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
 #endif
         if (mbType != P_Skip)
         {
-            H264SwDecMemcpy(pMb->totalCoeff,
-                            pMbLayer->residual.totalCoeff,
-                            27*sizeof(*pMb->totalCoeff));
-
-            /* update qpY */
-            if (pMbLayer->mbQpDelta)
-            {
-                *qpY = *qpY + pMbLayer->mbQpDelta;
-                if (*qpY < 0) *qpY += 52;
-                else if (*qpY >= 52) *qpY -= 52;
-            }
-            pMb->qpY = (u32)*qpY;
-
 #ifdef H264DEC_OMXDL
             pSrc = pMbLayer->residual.posCoefBuf;
 
@@ -1059,7 +1157,8 @@ u32 h264bsdDecodeMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
                     if (*totalCoeff)
                     {
                         res = omxVCM4P10_DequantTransformResidualFromPairAndAdd(
-                                &pSrc, p, 0, p, 16, 16, *qpY, *totalCoeff);
+                                &pSrc, p, 0, p, 16, 16, (OMX_INT)pMb->qpY,
+                                *totalCoeff);
                         if (res != OMX_Sts_NoErr)
                             return (HANTRO_NOK);
                     }
@@ -1098,11 +1197,6 @@ u32 h264bsdDecodeMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
             if (tmp != HANTRO_OK)
                 return (tmp);
         }
-        else
-        {
-            H264SwDecMemset(pMb->totalCoeff, 0, 27*sizeof(*pMb->totalCoeff));
-            pMb->qpY = (u32)*qpY;
-        }
 #ifdef H264DEC_OMXDL
         /* if decoded flag > 1 -> mb has already been successfully decoded and
          * written to output -> do not write again */
@@ -200,6 +200,13 @@ u32 h264bsdDecodeMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
     image_t *currImage, dpbStorage_t *dpb, i32 *qpY, u32 mbNum,
     u32 constrainedIntraPredFlag, u8* data);
 
+void h264bsdSetMacroblockState(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
+    i32 *qpY);
+
+u32 h264bsdReconstructMacroblock(mbStorage_t *pMb, macroblockLayer_t *pMbLayer,
+    image_t *currImage, dpbStorage_t *dpb, u32 mbNum,
+    u32 constrainedIntraPredFlag, u8* data);
+
 u32 h264bsdPredModeIntra16x16(mbType_e mbType);
 
 mbPartPredMode_e h264bsdMbPartPredMode(mbType_e mbType);
@@ -0,0 +1,936 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+     1. Include headers
+     2. External compiler flags
+     3. Module defines
+     4. Local function prototypes
+     5. Functions
+          h264bsdMtInit
+          h264bsdMtShutdown
+          h264bsdMtStartSlice
+          h264bsdMtGetMbLayer
+          h264bsdMtDecodeMacroblock
+          h264bsdMtEndSlice
+          h264bsdMtFilterPicture
+          h264bsdMtMoveImage
+          Worker
+          ReconstructRow
+          FilterRows
+          RestoreRows
+          SetGeometry
+          FreeGeometry
+
+--------------------------------------------------------------------------------
+
+    Frame-internal multithreading
+
+    The thread calling h264bsdDecode parses the macroblocks of a slice and
+    stores each into its own macroblockLayer_t in a ring. Parsing of a
+    macroblock only depends on the numbers of coefficients, macroblock types
+    and QP of the ones before it, which h264bsdSetMacroblockState stores
+    right after parsing. Reconstruction is done by worker threads, one
+    macroblock row at a time. Macroblock (x, y) is reconstructed after
+    (x - 1, y) and (x + 1, y - 1) so that rows proceed as a wavefront, two
+    macroblocks behind the row above.
+
+    Deblocking of a row changes the last pixel rows of the row above, and
+    the row below predicts from unfiltered pixels. A worker filters row y as
+    soon as rows y and y + 1 have been completely reconstructed, i.e. one
+    row behind reconstruction. The remaining rows are filtered when the
+    picture is ready, as before.
+
+    The output is the same as in single threaded decoding. Work is drained
+    at the end of each slice, so a failed slice leaves the decoder state as
+    if its macroblocks had been decoded one after another up to the first
+    macroblock that failed. As the picture is concealed and filtered
+    afterwards, the rows filtered so far are restored from a copy taken
+    before they were filtered and filtering of the picture is left until the
+    picture is ready. The same is done before redundant slices, which may
+    change the information of already decoded macroblocks.
+
+    Slices with slice groups are decoded in the calling thread.
+
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include <pthread.h>
+
+#include "h264bsd_mt.h"
+#include "h264bsd_deblocking.h"
+#include "h264bsd_util.h"
+
+/*------------------------------------------------------------------------------
+    2. External compiler flags
+--------------------------------------------------------------------------------
+
+--------------------------------------------------------------------------------
+    3. Module defines
+------------------------------------------------------------------------------*/
+
+/* size of a macroblockLayer_t in the ring, see h264bsdInit */
+#define MB_LAYER_SIZE ((sizeof(macroblockLayer_t) + 63) & ~0x3F)
+
+struct mtStorage
+{
+    u32 numWorkers;
+    pthread_t threads[H264BSD_MAX_THREADS - 1];
+
+    pthread_mutex_t mutex;
+    /* idle workers wait for rows to reconstruct or filter */
+    pthread_cond_t workCond;
+    /* decoding thread waits for ring slots and for the end of slice */
+    pthread_cond_t decCond;
+    u32 decWaiting;
+    u32 shutdown;
+
+    /* picture dimensions in macroblocks and storage depending on them */
+    u32 width;
+    u32 height;
+    u32 picSizeInMbs;
+    /* worker of a row waits for the row above and for parsing */
+    pthread_cond_t *rowCond;
+    u32 *rowWaiting;
+    /* number of reconstructed macroblocks of each row */
+    u32 *rowMbs;
+    /* next macroblock to reconstruct in each row of the current slice */
+    u32 *rowCol;
+    /* sliceId of each macroblock before the current slice */
+    u32 *prevSliceId;
+    /* macroblock layers of parsed macroblocks */
+    u8 *ring;
+    u32 ringSize;
+    /* rows filtered during decoding as they were before filtering */
+    u8 *backup;
+
+    /* current picture */
+    image_t image;
+    mbStorage_t *mb;
+    u32 filteredRows;
+    u32 filterRunning;
+    u32 earlyFilter;
+    u32 rowMbsValid;
+
+    /* current slice */
+    u32 active;
+    storage_t *pStorage;
+    u32 constrainedIntraPredFlag;
+    u32 isISlice;
+    u32 firstMb;
+    u32 touchedMbs;
+    u32 parsedMbs;
+    u32 parseDone;
+    u32 nextRow;
+    u32 running;
+    u32 errorMb;
+    u32 numDecodedMbs;
+};
+
+/*------------------------------------------------------------------------------
+    4. Local function prototypes
+------------------------------------------------------------------------------*/
+
+static void *Worker(void *arg);
+static void ReconstructRow(mtStorage_t *mt, u32 row, u8 *data);
+static void FilterRows(mtStorage_t *mt);
+static void RestoreRows(mtStorage_t *mt);
+static u32 SetGeometry(mtStorage_t *mt, u32 width, u32 height);
+static void FreeGeometry(mtStorage_t *mt);
+
+/* Row available for a worker to claim */
+static u32 RowReady(mtStorage_t *mt)
+{
+    u32 first;
+
+    first = MAX(mt->firstMb, mt->nextRow * mt->width);
+
+    return(mt->active && mt->nextRow < mt->height &&
+           first < mt->parsedMbs && first < mt->errorMb);
+}
+
+/* Next row can be filtered: it and the row below it are reconstructed */
+static u32 FilterReady(mtStorage_t *mt)
+{
+    u32 row = mt->filteredRows;
+
+    return(mt->earlyFilter && row < mt->height &&
+           mt->rowMbs[row] == mt->width &&
+           (row + 1 == mt->height || mt->rowMbs[row + 1] == mt->width));
+}
+
+/* Macroblock layer structure of macroblock mbNum */
+static macroblockLayer_t *MbLayer(mtStorage_t *mt, u32 mbNum)
+{
+    return((macroblockLayer_t *)
+        (mt->ring + (mbNum % mt->ringSize) * MB_LAYER_SIZE));
+}
+
+/* Macroblock of the current slice reconstructed or dropped */
+static u32 MbDone(mtStorage_t *mt, u32 mbNum)
+{
+    u32 row = mbNum / mt->width;
+
+    return(mbNum >= mt->errorMb ||
+           (row < mt->nextRow && mt->rowCol[row] > mbNum % mt->width));
+}
+
+static void WakeDecoder(mtStorage_t *mt)
+{
+    if (mt->decWaiting)
+        pthread_cond_signal(&mt->decCond);
+}
+
+static void WakeRow(mtStorage_t *mt, u32 row)
+{
+    if (row < mt->height && mt->rowWaiting[row])
+        pthread_cond_signal(&mt->rowCond[row]);
+}
+
+static void WakeAll(mtStorage_t *mt)
+{
+    u32 i;
+
+    for (i = 0; i < mt->height; i++)
+        WakeRow(mt, i);
+    pthread_cond_broadcast(&mt->workCond);
+    WakeDecoder(mt);
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtInit
+
+        Functional description:
+            Start worker threads for decoding with numThreads threads, the
+            decoding thread included.
+
+        Inputs:
+            numThreads  number of threads, 2 to H264BSD_MAX_THREADS
+
+        Returns:
+            pointer to the thread storage
+            NULL if memory allocation or thread creation failed
+
+------------------------------------------------------------------------------*/
+
+mtStorage_t *h264bsdMtInit(u32 numThreads)
+{
+
+/* Variables */
+
+    mtStorage_t *mt;
+    u32 i;
+
+/* Code */
+
+    ASSERT(numThreads > 1 && numThreads <= H264BSD_MAX_THREADS);
+
+    mt = (mtStorage_t *)H264SwDecMalloc(sizeof(mtStorage_t));
+    if (mt == NULL)
+        return(NULL);
+
+    H264SwDecMemset(mt, 0, sizeof(mtStorage_t));
+    pthread_mutex_init(&mt->mutex, NULL);
+    pthread_cond_init(&mt->workCond, NULL);
+    pthread_cond_init(&mt->decCond, NULL);
+
+    for (i = 0; i < numThreads - 1; i++)
+    {
+        if (pthread_create(&mt->threads[i], NULL, Worker, mt) != 0)
+        {
+            h264bsdMtShutdown(mt);
+            return(NULL);
+        }
+        mt->numWorkers++;
+    }
+
+    return(mt);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtShutdown
+
+        Functional description:
+            Stop the worker threads and free the thread storage.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdMtShutdown(mtStorage_t *mt)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    if (mt == NULL)
+        return;
+
+    pthread_mutex_lock(&mt->mutex);
+    mt->shutdown = HANTRO_TRUE;
+    pthread_cond_broadcast(&mt->workCond);
+    pthread_mutex_unlock(&mt->mutex);
+
+    for (i = 0; i < mt->numWorkers; i++)
+        pthread_join(mt->threads[i], NULL);
+
+    FreeGeometry(mt);
+    pthread_cond_destroy(&mt->decCond);
+    pthread_cond_destroy(&mt->workCond);
+    pthread_mutex_destroy(&mt->mutex);
+
+    H264SwDecFree(mt);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtStartSlice
+
+        Functional description:
+            Prepare for decoding of a slice. Called before the slice data of
+            each slice is decoded, with no work in progress.
+
+        Inputs:
+            pStorage        pointer to storage structure
+            currImage       pointer to current picture
+            pSliceHeader    pointer to slice header of the slice
+
+        Returns:
+            HANTRO_TRUE     slice is decoded with the worker threads
+            HANTRO_FALSE    slice is decoded in the calling thread
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdMtStartSlice(mtStorage_t *mt, storage_t *pStorage,
+    image_t *currImage, sliceHeader_t *pSliceHeader)
+{
+
+/* Variables */
+
+    u32 i, j;
+
+/* Code */
+
+    ASSERT(mt);
+    ASSERT(!mt->active);
+
+    if (mt->width != currImage->width || mt->height != currImage->height)
+    {
+        if (SetGeometry(mt, currImage->width, currImage->height) != HANTRO_OK)
+            return(HANTRO_FALSE);
+    }
+
+    /* first slice of a new picture */
+    if (pStorage->slice->sliceId == 0)
+    {
+        mt->filteredRows = 0;
+        mt->earlyFilter = HANTRO_TRUE;
+        H264SwDecMemset(mt->rowMbs, 0, mt->height * sizeof(u32));
+        mt->rowMbsValid = HANTRO_TRUE;
+    }
+
+    if (pStorage->activePps->numSliceGroups != 1 ||
+        pSliceHeader->redundantPicCnt)
+    {
+        /* redundant slices update information of decoded macroblocks,
+         * filtering has to wait until they have been decoded */
+        if (pSliceHeader->redundantPicCnt)
+        {
+            RestoreRows(mt);
+            mt->earlyFilter = HANTRO_FALSE;
+        }
+        mt->rowMbsValid = HANTRO_FALSE;
+        return(HANTRO_FALSE);
+    }
+
+    if (!mt->rowMbsValid)
+    {
+        for (i = 0; i < mt->height; i++)
+        {
+            mt->rowMbs[i] = 0;
+            for (j = 0; j < mt->width; j++)
+                if (pStorage->mb[i * mt->width + j].decoded)
+                    mt->rowMbs[i]++;
+        }
+        mt->rowMbsValid = HANTRO_TRUE;
+    }
+
+    mt->image = *currImage;
+    mt->mb = pStorage->mb;
+    mt->pStorage = pStorage;
+    mt->constrainedIntraPredFlag =
+        pStorage->activePps->constrainedIntraPredFlag;
+    mt->isISlice = IS_I_SLICE(pSliceHeader->sliceType);
+    mt->firstMb = pSliceHeader->firstMbInSlice;
+    mt->touchedMbs = mt->firstMb;
+    mt->parsedMbs = mt->firstMb;
+    mt->parseDone = HANTRO_FALSE;
+    mt->nextRow = mt->firstMb / mt->width;
+    mt->running = 0;
+    mt->errorMb = mt->picSizeInMbs;
+    mt->numDecodedMbs = pStorage->slice->numDecodedMbs;
+
+    pthread_mutex_lock(&mt->mutex);
+    mt->active = HANTRO_TRUE;
+    pthread_mutex_unlock(&mt->mutex);
+
+    return(HANTRO_TRUE);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtGetMbLayer
+
+        Functional description:
+            Get the macroblock layer structure for parsing of macroblock
+            mbNum. Waits until the structure is no longer needed by the
+            macroblock that used it before. Called before SetMbParams changes
+            the mbStorage of the macroblock.
+
+        Returns:
+            pointer to the macroblock layer structure
+
+------------------------------------------------------------------------------*/
+
+macroblockLayer_t *h264bsdMtGetMbLayer(mtStorage_t *mt, u32 mbNum)
+{
+
+/* Variables */
+
+    u32 prev;
+
+/* Code */
+
+    ASSERT(mt->active);
+    ASSERT(mbNum == mt->touchedMbs);
+
+    mt->prevSliceId[mbNum] = mt->pStorage->mb[mbNum].sliceId;
+    mt->touchedMbs = mbNum + 1;
+
+    if (mbNum >= mt->firstMb + mt->ringSize)
+    {
+        prev = mbNum - mt->ringSize;
+
+        pthread_mutex_lock(&mt->mutex);
+        while (!MbDone(mt, prev))
+        {
+            mt->decWaiting = HANTRO_TRUE;
+            pthread_cond_wait(&mt->decCond, &mt->mutex);
+            mt->decWaiting = HANTRO_FALSE;
+        }
+        pthread_mutex_unlock(&mt->mutex);
+    }
+
+    return(MbLayer(mt, mbNum));
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtDecodeMacroblock
+
+        Functional description:
+            Counterpart of h264bsdDecodeMacroblock for the decoding thread.
+            Sets the state of the parsed macroblock and hands it over to the
+            workers for reconstruction.
+
+        Returns:
+            HANTRO_OK   success
+            HANTRO_NOK  reconstruction of an earlier macroblock failed
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdMtDecodeMacroblock(mtStorage_t *mt, u32 mbNum, i32 *qpY)
+{
+
+/* Variables */
+
+    u32 row, failed;
+
+/* Code */
+
+    ASSERT(mbNum == mt->parsedMbs);
+
+    h264bsdSetMacroblockState(mt->pStorage->mb + mbNum, MbLayer(mt, mbNum),
+        qpY);
+
+    row = mbNum / mt->width;
+
+    pthread_mutex_lock(&mt->mutex);
+    mt->parsedMbs = mbNum + 1;
+    WakeRow(mt, row);
+    /* first macroblock of a row -> row can be claimed */
+    if (row == mt->nextRow && RowReady(mt))
+        pthread_cond_signal(&mt->workCond);
+    failed = mt->errorMb < mbNum;
+    pthread_mutex_unlock(&mt->mutex);
+
+    return(failed ? HANTRO_NOK : HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtEndSlice
+
+        Functional description:
+            Wait until the parsed macroblocks of the slice are reconstructed
+            and, if reconstruction of one failed, set the state as it would
+            be after single threaded decoding stopped at that macroblock.
+
+        Inputs:
+            status      result of parsing of the slice
+
+        Returns:
+            HANTRO_OK   slice decoded successfully
+            status      parsing failed
+            HANTRO_NOK  reconstruction failed
+
+------------------------------------------------------------------------------*/
+
+u32 h264bsdMtEndSlice(mtStorage_t *mt, u32 status)
+{
+
+/* Variables */
+
+    u32 i, errorMb;
+    storage_t *pStorage;
+
+/* Code */
+
+    ASSERT(mt->active);
+
+    pthread_mutex_lock(&mt->mutex);
+    if (status != HANTRO_OK)
+        mt->earlyFilter = HANTRO_FALSE;
+    mt->parseDone = HANTRO_TRUE;
+    WakeAll(mt);
+    while (mt->running || RowReady(mt) || mt->filterRunning ||
+           FilterReady(mt))
+    {
+        mt->decWaiting = HANTRO_TRUE;
+        pthread_cond_wait(&mt->decCond, &mt->mutex);
+        mt->decWaiting = HANTRO_FALSE;
+    }
+    mt->active = HANTRO_FALSE;
+    errorMb = mt->errorMb;
+    pthread_mutex_unlock(&mt->mutex);
+
+    if (errorMb < mt->picSizeInMbs)
+    {
+        pStorage = mt->pStorage;
+
+        /* macroblocks after the failed one were not decoded */
+        for (i = errorMb + 1; i < mt->touchedMbs; i++)
+        {
+            pStorage->mb[i].sliceId = mt->prevSliceId[i];
+            pStorage->mb[i].decoded = 0;
+        }
+        if (mt->isISlice)
+            pStorage->slice->lastMbAddr =
+                errorMb > mt->firstMb ? errorMb - 1 : 0;
+        pStorage->slice->numDecodedMbs = mt->numDecodedMbs;
+
+        status = HANTRO_NOK;
+    }
+
+    /* the failed slice is marked corrupted and later concealed */
+    if (status != HANTRO_OK)
+    {
+        RestoreRows(mt);
+        mt->rowMbsValid = HANTRO_FALSE;
+    }
+
+    return(status);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtFilterPicture
+
+        Functional description:
+            Counterpart of h264bsdFilterPicture, filters the rows that were
+            not filtered during decoding.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdMtFilterPicture(mtStorage_t *mt, image_t *image, mbStorage_t *mb)
+{
+
+/* Code */
+
+    ASSERT(!mt->active);
+    ASSERT(!mt->filteredRows || image->data == mt->image.data);
+
+    h264bsdFilterRows(image, mb, mt->filteredRows, image->height);
+
+    mt->filteredRows = 0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: h264bsdMtMoveImage
+
+        Functional description:
+            Follow the picture being decoded to a new buffer with the same
+            contents, rows filtered so far stay filtered.
+
+------------------------------------------------------------------------------*/
+
+void h264bsdMtMoveImage(mtStorage_t *mt, image_t *image)
+{
+
+/* Code */
+
+    ASSERT(!mt->active);
+
+    mt->image.data = image->data;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: Worker
+
+        Functional description:
+            Worker thread main loop. Filtering of the next row is preferred
+            over reconstruction of a new one to keep filtering one row
+            behind.
+
+------------------------------------------------------------------------------*/
+
+static void *Worker(void *arg)
+{
+
+/* Variables */
+
+    mtStorage_t *mt = (mtStorage_t *)arg;
+    u8 mbData[384 + 15 + 32];
+    u8 *data;
+
+/* Code */
+
+    /* ensure 16-byte alignment */
+    data = (u8*)ALIGN(mbData, 16);
+
+    pthread_mutex_lock(&mt->mutex);
+    while (!mt->shutdown)
+    {
+        if (mt->active && !mt->filterRunning && FilterReady(mt))
+        {
+            FilterRows(mt);
+        }
+        else if (RowReady(mt))
+        {
+            ReconstructRow(mt, mt->nextRow++, data);
+        }
+        else
+        {
+            pthread_cond_wait(&mt->workCond, &mt->mutex);
+        }
+    }
+    pthread_mutex_unlock(&mt->mutex);
+
+    return(NULL);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: ReconstructRow
+
+        Functional description:
+            Reconstruct the macroblocks of the current slice in a row. Called
+            and returns with the mutex held.
+
+------------------------------------------------------------------------------*/
+
+static void ReconstructRow(mtStorage_t *mt, u32 row, u8 *data)
+{
+
+/* Variables */
+
+    u32 tmp, col, mbNum, above;
+    image_t image;
+    mbStorage_t *pMb;
+
+/* Code */
+
+    image = mt->image;
+    col = row * mt->width < mt->firstMb ? mt->firstMb % mt->width : 0;
+    mt->rowCol[row] = col;
+    mt->running++;
+
+    for (; col < mt->width; col++)
+    {
+        mbNum = row * mt->width + col;
+
+        for (;;)
+        {
+            if (mbNum >= mt->errorMb ||
+                (mbNum >= mt->parsedMbs && mt->parseDone))
+                goto done;
+
+            /* row above in the slice has to be two macroblocks ahead, or
+             * done if this is the last macroblock of the row */
+            above = MIN(col + 1, mt->width - 1);
+            if (mbNum < mt->parsedMbs &&
+                (row == 0 || (row - 1) * mt->width + above < mt->firstMb ||
+                 mt->rowCol[row - 1] > above))
+                break;
+
+            mt->rowWaiting[row] = HANTRO_TRUE;
+            pthread_cond_wait(&mt->rowCond[row], &mt->mutex);
+            mt->rowWaiting[row] = HANTRO_FALSE;
+        }
+
+        pthread_mutex_unlock(&mt->mutex);
+
+        pMb = mt->mb + mbNum;
+        tmp = h264bsdReconstructMacroblock(pMb, MbLayer(mt, mbNum), &image,
+            mt->pStorage->dpb, mbNum, mt->constrainedIntraPredFlag, data);
+
+        pthread_mutex_lock(&mt->mutex);
+
+        if (tmp != HANTRO_OK)
+        {
+            EPRINT("MACRO_BLOCK");
+            if (mbNum < mt->errorMb)
+                mt->errorMb = mbNum;
+            mt->earlyFilter = HANTRO_FALSE;
+            WakeAll(mt);
+            goto done;
+        }
+
+        mt->rowCol[row] = col + 1;
+        mt->rowMbs[row]++;
+        WakeRow(mt, row + 1);
+        WakeDecoder(mt);
+    }
+
+done:
+    mt->running--;
+    if (!mt->filterRunning && FilterReady(mt))
+        pthread_cond_signal(&mt->workCond);
+    WakeDecoder(mt);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FilterRows
+
+        Functional description:
+            Filter rows as long as they are ready. A copy of each row is
+            stored before filtering for RestoreRows. Called and returns with
+            the mutex held.
+
+------------------------------------------------------------------------------*/
+
+static void FilterRows(mtStorage_t *mt)
+{
+
+/* Variables */
+
+    u32 row, i, lumaSize, chromaSize;
+    u32 width = mt->width * 16;
+    u8 *pic, *backup;
+
+/* Code */
+
+    mt->filterRunning = HANTRO_TRUE;
+
+    while (FilterReady(mt))
+    {
+        row = mt->filteredRows;
+
+        pthread_mutex_unlock(&mt->mutex);
+
+        lumaSize = mt->picSizeInMbs * 256;
+        chromaSize = mt->picSizeInMbs * 64;
+
+        /* luma rows, then the same rows of both chroma components */
+        pic = mt->image.data + row * 16 * width;
+        backup = mt->backup + row * 16 * width;
+        H264SwDecMemcpy(backup, pic, 16 * width);
+        for (i = 0; i < 2; i++)
+        {
+            pic = mt->image.data + lumaSize + i * chromaSize +
+                row * 8 * (width / 2);
+            backup = mt->backup + lumaSize + i * chromaSize +
+                row * 8 * (width / 2);
+            H264SwDecMemcpy(backup, pic, 8 * (width / 2));
+        }
+
+        h264bsdFilterRows(&mt->image, mt->mb, row, row + 1);
+
+        pthread_mutex_lock(&mt->mutex);
+
+        mt->filteredRows++;
+    }
+
+    mt->filterRunning = HANTRO_FALSE;
+    WakeDecoder(mt);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: RestoreRows
+
+        Functional description:
+            Undo filtering of the rows filtered during decoding of the
+            current picture. Filtering of a row does not change the rows
+            below it, so the rows are restored by copying back the pixel
+            rows of all of them.
+
+------------------------------------------------------------------------------*/
+
+static void RestoreRows(mtStorage_t *mt)
+{
+
+/* Variables */
+
+    u32 i, lumaSize, chromaSize;
+    u32 width = mt->width * 16;
+
+/* Code */
+
+    ASSERT(!mt->filterRunning);
+
+    if (!mt->filteredRows)
+        return;
+
+    lumaSize = mt->picSizeInMbs * 256;
+    chromaSize = mt->picSizeInMbs * 64;
+
+    H264SwDecMemcpy(mt->image.data, mt->backup,
+        mt->filteredRows * 16 * width);
+    for (i = 0; i < 2; i++)
+        H264SwDecMemcpy(mt->image.data + lumaSize + i * chromaSize,
+            mt->backup + lumaSize + i * chromaSize,
+            mt->filteredRows * 8 * (width / 2));
+
+    mt->filteredRows = 0;
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: SetGeometry
+
+        Functional description:
+            Allocate the storage depending on picture dimensions.
+
+        Returns:
+            HANTRO_OK   success
+            HANTRO_NOK  memory allocation failed
+
+------------------------------------------------------------------------------*/
+
+static u32 SetGeometry(mtStorage_t *mt, u32 width, u32 height)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    FreeGeometry(mt);
+
+    mt->width = width;
+    mt->height = height;
+    mt->picSizeInMbs = width * height;
+    /* enough for the rows in progress and a row being parsed ahead */
+    mt->ringSize = MIN((mt->numWorkers + 2) * width, mt->picSizeInMbs);
+
+    ALLOCATE(mt->rowCond, height, pthread_cond_t);
+    ALLOCATE(mt->rowWaiting, height, u32);
+    ALLOCATE(mt->rowMbs, height, u32);
+    ALLOCATE(mt->rowCol, height, u32);
+    ALLOCATE(mt->prevSliceId, mt->picSizeInMbs, u32);
+    ALLOCATE(mt->ring, mt->ringSize * MB_LAYER_SIZE, u8);
+    ALLOCATE(mt->backup, mt->picSizeInMbs * 384, u8);
+
+    if (!mt->rowCond || !mt->rowWaiting || !mt->rowMbs || !mt->rowCol ||
+        !mt->prevSliceId || !mt->ring || !mt->backup)
+    {
+        FREE(mt->rowCond);
+        FreeGeometry(mt);
+        return(HANTRO_NOK);
+    }
+
+    for (i = 0; i < height; i++)
+    {
+        pthread_cond_init(&mt->rowCond[i], NULL);
+        mt->rowWaiting[i] = HANTRO_FALSE;
+    }
+
+    mt->filteredRows = 0;
+    mt->earlyFilter = HANTRO_FALSE;
+    mt->rowMbsValid = HANTRO_FALSE;
+
+    return(HANTRO_OK);
+
+}
+
+/*------------------------------------------------------------------------------
+
+    Function: FreeGeometry
+
+------------------------------------------------------------------------------*/
+
+static void FreeGeometry(mtStorage_t *mt)
+{
+
+/* Variables */
+
+    u32 i;
+
+/* Code */
+
+    if (mt->rowCond)
+    {
+        for (i = 0; i < mt->height; i++)
+            pthread_cond_destroy(&mt->rowCond[i]);
+        FREE(mt->rowCond);
+    }
+    FREE(mt->rowWaiting);
+    FREE(mt->rowMbs);
+    FREE(mt->rowCol);
+    FREE(mt->prevSliceId);
+    FREE(mt->ring);
+    FREE(mt->backup);
+
+    mt->width = mt->height = mt->picSizeInMbs = 0;
+    mt->filteredRows = 0;
+
+}
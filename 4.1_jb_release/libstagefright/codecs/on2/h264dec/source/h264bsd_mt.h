@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Table of contents
+
+    1. Include headers
+    2. Module defines
+    3. Data types
+    4. Function prototypes
+
+------------------------------------------------------------------------------*/
+
+#ifndef H264SWDEC_MT_H
+#define H264SWDEC_MT_H
+
+/*------------------------------------------------------------------------------
+    1. Include headers
+------------------------------------------------------------------------------*/
+
+#include "basetype.h"
+#include "h264bsd_storage.h"
+#include "h264bsd_slice_header.h"
+#include "h264bsd_macroblock_layer.h"
+#include "h264bsd_image.h"
+
+/*------------------------------------------------------------------------------
+    2. Module defines
+------------------------------------------------------------------------------*/
+
+/* maximum number of threads decoding one picture */
+#define H264BSD_MAX_THREADS 8
+
+/*------------------------------------------------------------------------------
+    3. Data types
+------------------------------------------------------------------------------*/
+
+typedef struct mtStorage mtStorage_t;
+
+/*------------------------------------------------------------------------------
+    4. Function prototypes
+------------------------------------------------------------------------------*/
+
+mtStorage_t *h264bsdMtInit(u32 numThreads);
+void h264bsdMtShutdown(mtStorage_t *mt);
+
+u32 h264bsdMtStartSlice(mtStorage_t *mt, storage_t *pStorage,
+    image_t *currImage, sliceHeader_t *pSliceHeader);
+macroblockLayer_t *h264bsdMtGetMbLayer(mtStorage_t *mt, u32 mbNum);
+u32 h264bsdMtDecodeMacroblock(mtStorage_t *mt, u32 mbNum, i32 *qpY);
+u32 h264bsdMtEndSlice(mtStorage_t *mt, u32 status);
+
+void h264bsdMtFilterPicture(mtStorage_t *mt, image_t *image, mbStorage_t *mb);
+void h264bsdMtMoveImage(mtStorage_t *mt, image_t *image);
+
+#endif /* #ifdef H264SWDEC_MT_H */
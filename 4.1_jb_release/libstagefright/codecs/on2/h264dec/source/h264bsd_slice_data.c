@@ -24,6 +24,7 @@
      4. Local function prototypes
      5. Functions
           h264bsdDecodeSliceData
+          DecodeSliceData
           SetMbParams
           h264bsdMarkSliceCorrupted
 
@@ -36,6 +37,7 @@
 #include "h264bsd_slice_data.h"
 #include "h264bsd_util.h"
 #include "h264bsd_vlc.h"
+#include "h264bsd_mt.h"
 
 /*------------------------------------------------------------------------------
     2. External compiler flags
@@ -52,6 +54,9 @@
 static void SetMbParams(mbStorage_t *pMb, sliceHeader_t *pSlice, u32 sliceId,
     i32 chromaQpIndexOffset);
 
+static u32 DecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
+    image_t *currImage, sliceHeader_t *pSliceHeader, mtStorage_t *mt);
+
 /*------------------------------------------------------------------------------
 
    5.1  Function name: h264bsdDecodeSliceData
@@ -86,6 +91,42 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
     image_t *currImage, sliceHeader_t *pSliceHeader)
 {
 
+/* Variables */
+
+    u32 tmp;
+    mtStorage_t *mt;
+
+/* Code */
+
+    mt = NULL;
+    if (pStorage->mt != NULL &&
+        h264bsdMtStartSlice(pStorage->mt, pStorage, currImage, pSliceHeader))
+        mt = pStorage->mt;
+
+    tmp = DecodeSliceData(pStrmData, pStorage, currImage, pSliceHeader, mt);
+
+    if (mt != NULL)
+        tmp = h264bsdMtEndSlice(mt, tmp);
+
+    return(tmp);
+
+}
+
+/*------------------------------------------------------------------------------
+
+   5.2  Function name: DecodeSliceData
+
+        Functional description:
+            Decode the macroblocks of one slice. With mt set, macroblocks
+            are only parsed here and reconstructed by the worker threads,
+            see h264bsd_mt.c.
+
+------------------------------------------------------------------------------*/
+
+static u32 DecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
+    image_t *currImage, sliceHeader_t *pSliceHeader, mtStorage_t *mt)
+{
+
 /* Variables */
 
     u8 mbData[384 + 15 + 32];
@@ -136,6 +177,10 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
             return(HANTRO_NOK);
         }
 
+        /* each macroblock is parsed into its own mbLayer */
+        if (mt)
+            mbLayer = h264bsdMtGetMbLayer(mt, currMbAddr);
+
         SetMbParams(pStorage->mb + currMbAddr, pSliceHeader,
             pStorage->slice->sliceId, pStorage->activePps->chromaQpIndexOffset);
 
@@ -167,6 +212,11 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
         {
             DEBUG(("Skipping macroblock %d\n", currMbAddr));
             skipRun--;
+            if (mt)
+            {
+                H264SwDecMemset(&mbLayer->mbPred, 0, sizeof(mbPred_t));
+                mbLayer->mbType = P_Skip;
+            }
         }
         else
         {
@@ -181,9 +231,12 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
             }
         }
 
-        tmp = h264bsdDecodeMacroblock(pStorage->mb + currMbAddr, mbLayer,
-            currImage, pStorage->dpb, &qpY, currMbAddr,
-            pStorage->activePps->constrainedIntraPredFlag, data);
+        if (mt)
+            tmp = h264bsdMtDecodeMacroblock(mt, currMbAddr, &qpY);
+        else
+            tmp = h264bsdDecodeMacroblock(pStorage->mb + currMbAddr, mbLayer,
+                currImage, pStorage->dpb, &qpY, currMbAddr,
+                pStorage->activePps->constrainedIntraPredFlag, data);
         if (tmp != HANTRO_OK)
         {
             EPRINT("MACRO_BLOCK");
@@ -232,7 +285,7 @@ u32 h264bsdDecodeSliceData(strmData_t *pStrmData, storage_t *pStorage,
 
 /*------------------------------------------------------------------------------
 
-   5.2  Function: SetMbParams
+   5.3  Function: SetMbParams
 
         Functional description:
             Set macroblock parameters that remain constant for this slice
@@ -273,7 +326,7 @@ void SetMbParams(mbStorage_t *pMb, sliceHeader_t *pSlice, u32 sliceId,
 
 /*------------------------------------------------------------------------------
 
-   5.3  Function name: h264bsdMarkSliceCorrupted
+   5.4  Function name: h264bsdMarkSliceCorrupted
 
         Functional description:
             Mark macroblocks of the slice corrupted. If lastMbAddr in the slice
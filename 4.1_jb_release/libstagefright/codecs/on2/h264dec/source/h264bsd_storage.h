@@ -146,6 +146,9 @@ typedef struct
                               HEADERS_RDY to the user */
     u32 intraConcealmentFlag; /* 0 gray picture for corrupted intra
                                  1 previous frame used if available */
+    /* worker threads for frame-internal multithreading, NULL if decoding
+     * in the calling thread only */
+    struct mtStorage *mt;
 } storage_t;
 
 /*------------------------------------------------------------------------------
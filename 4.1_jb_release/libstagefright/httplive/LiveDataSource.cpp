@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "LiveDataSource"
+#include <utils/Log.h>
+
+#include "LiveDataSource.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <errno.h>
+#include <stdlib.h>
+
+namespace android {
+
+LiveDataSource::LiveDataSource(size_t capacity)
+    : mOffset(0),
+      mQueuedBytes(0),
+      mFinalResult(OK),
+      mNumChunks(capacity / kChunkSize),
+      mChunkData(NULL) {
+    if (mNumChunks < 4) {
+        mNumChunks = 4;
+    }
+}
+
+LiveDataSource::~LiveDataSource() {
+    mBufferQueue.clear();
+    mFreeChunks.clear();
+
+    free(mChunkData);
+    mChunkData = NULL;
+}
+
+status_t LiveDataSource::initCheck() const {
+    return OK;
+}
+
+size_t LiveDataSource::countQueuedBuffers() {
+    Mutex::Autolock autoLock(mLock);
+
+    return mBufferQueue.size();
+}
+
+ssize_t LiveDataSource::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    // The TS extractor takes a short read for the end of the stream, only
+    // return one if there really is nothing more to come.
+    while (mQueuedBytes < size && mFinalResult == OK) {
+        mCondition.wait(mLock);
+    }
+
+    if (mQueuedBytes == 0) {
+        return mFinalResult;
+    }
+
+    return readAt_l(offset, data, size);
+}
+
+ssize_t LiveDataSource::readAtNonBlocking(
+        off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mQueuedBytes == 0) {
+        if (mFinalResult != OK) {
+            return mFinalResult;
+        }
+
+        return -EWOULDBLOCK;
+    }
+
+    return readAt_l(offset, data, size);
+}
+
+ssize_t LiveDataSource::readAt_l(off64_t offset, void *data, size_t size) {
+    if (offset != mOffset) {
+        ALOGE("Attempt at reading non-sequentially from LiveDataSource.");
+        return -EPIPE;
+    }
+
+    size_t sizeDone = 0;
+
+    while (sizeDone < size && !mBufferQueue.empty()) {
+        sp<ABuffer> buffer = *mBufferQueue.begin();
+
+        size_t copy = size - sizeDone;
+
+        if (copy > buffer->size()) {
+            copy = buffer->size();
+        }
+
+        // This is the one copy between the download and the TS parser, and
+        // it stays. The reader is the prebuilt MPEG2TSExtractor
+        // (mpeg2ts/libstagefright_mpeg2tsextractor.a), whose feedMore()
+        // reads every packet into a buffer of its own through readAt() and
+        // feeds ATSParser from there, so chunks can't be handed over in
+        // place.
+        memcpy((uint8_t *)data + sizeDone, buffer->data(), copy);
+
+        sizeDone += copy;
+
+        buffer->setRange(buffer->offset() + copy, buffer->size() - copy);
+
+        if (buffer->size() == 0) {
+            mBufferQueue.erase(mBufferQueue.begin());
+            recycle_l(buffer);
+        }
+    }
+
+    mOffset += sizeDone;
+    mQueuedBytes -= sizeDone;
+
+    return sizeDone;
+}
+
+void LiveDataSource::queueBuffer(const sp<ABuffer> &buffer) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mFinalResult != OK) {
+        recycle_l(buffer);
+        return;
+    }
+
+    if (buffer->size() == 0) {
+        recycle_l(buffer);
+        return;
+    }
+
+    mBufferQueue.push_back(buffer);
+    mQueuedBytes += buffer->size();
+
+    mCondition.broadcast();
+}
+
+void LiveDataSource::queueEOS(status_t finalResult) {
+    CHECK_NE(finalResult, (status_t)OK);
+
+    Mutex::Autolock autoLock(mLock);
+
+    mFinalResult = finalResult;
+    mCondition.broadcast();
+}
+
+void LiveDataSource::reset() {
+    Mutex::Autolock autoLock(mLock);
+
+    // XXX FIXME: If we've done a partial read and waiting for more buffers,
+    // we'll mix old and new data...
+
+    mFinalResult = OK;
+
+    while (!mBufferQueue.empty()) {
+        sp<ABuffer> buffer = *mBufferQueue.begin();
+        mBufferQueue.erase(mBufferQueue.begin());
+
+        recycle_l(buffer);
+    }
+
+    mQueuedBytes = 0;
+    mOffset = 0;
+}
+
+sp<ABuffer> LiveDataSource::acquireChunk(bool priority, int64_t timeoutUs) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mChunkData == NULL) {
+        allocateChunks_l();
+    }
+
+    size_t numReserved = priority ? 0 : mNumChunks / 4;
+
+    while (mFreeChunks.size() <= numReserved) {
+        if (timeoutUs <= 0) {
+            return NULL;
+        }
+
+        nsecs_t startNs = systemTime();
+        if (mChunkFreedCondition.waitRelative(mLock, timeoutUs * 1000ll) != OK) {
+            return NULL;
+        }
+        timeoutUs -= (systemTime() - startNs) / 1000ll;
+    }
+
+    sp<ABuffer> chunk = *mFreeChunks.begin();
+    mFreeChunks.erase(mFreeChunks.begin());
+
+    chunk->setRange(0, 0);
+
+    return chunk;
+}
+
+void LiveDataSource::releaseChunk(const sp<ABuffer> &chunk) {
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK(isChunk_l(chunk));
+    recycle_l(chunk);
+}
+
+size_t LiveDataSource::countFreeChunks() {
+    Mutex::Autolock autoLock(mLock);
+
+    return mChunkData == NULL ? mNumChunks : mFreeChunks.size();
+}
+
+size_t LiveDataSource::countChunks() const {
+    return mNumChunks;
+}
+
+bool LiveDataSource::isChunk_l(const sp<ABuffer> &buffer) const {
+    return mChunkData != NULL
+        && buffer->base() >= mChunkData
+        && buffer->base() < mChunkData + mNumChunks * kChunkSize;
+}
+
+void LiveDataSource::allocateChunks_l() {
+    // A single allocation that is carved up for the lifetime of the data
+    // source, downloads never allocate or grow buffers.
+    mChunkData = (uint8_t *)malloc(mNumChunks * kChunkSize);
+    CHECK(mChunkData != NULL);
+
+    for (size_t i = 0; i < mNumChunks; ++i) {
+        mFreeChunks.push_back(
+                new ABuffer(mChunkData + i * kChunkSize, kChunkSize));
+    }
+}
+
+void LiveDataSource::recycle_l(const sp<ABuffer> &buffer) {
+    if (!isChunk_l(buffer)) {
+        return;
+    }
+
+    buffer->setRange(0, 0);
+    mFreeChunks.push_back(buffer);
+
+    mChunkFreedCondition.broadcast();
+}
+
+}  // namespace android
@@ -22,16 +22,30 @@
 #include <media/stagefright/DataSource.h>
 #include <utils/threads.h>
 #include <utils/List.h>
+#include <utils/Vector.h>
 
 namespace android {
 
 struct ABuffer;
 
+// Hands the transport stream of an HLS session to its reader. Segments are
+// downloaded straight into chunks of a fixed size memory area owned by the
+// data source and queued here in playlist order, chunks go back to the free
+// list once they have been read.
 struct LiveDataSource : public DataSource {
-    LiveDataSource();
+    enum {
+        // Holds whole TS packets and whole AES blocks, so that every chunk
+        // but a segment's last is full and can be decrypted on its own.
+        kChunkSize       = 188 * 348,
+
+        kDefaultCapacity = 8 * 1024 * 1024,
+    };
+
+    LiveDataSource(size_t capacity = kDefaultCapacity);
 
     virtual status_t initCheck() const;
 
+    // Blocks until "size" bytes are available or the stream has ended.
     virtual ssize_t readAt(off64_t offset, void *data, size_t size);
     ssize_t readAtNonBlocking(off64_t offset, void *data, size_t size);
 
@@ -41,18 +55,38 @@ struct LiveDataSource : public DataSource {
 
     size_t countQueuedBuffers();
 
+    // Returns an empty chunk to download into, or NULL if none was freed
+    // within "timeoutUs". Unless "priority" is set a quarter of the chunks
+    // is held back for the segment the reader is waiting for, so that
+    // segments downloaded ahead of time cannot starve it.
+    sp<ABuffer> acquireChunk(bool priority, int64_t timeoutUs);
+
+    // Gives back a chunk that is not going to be queued.
+    void releaseChunk(const sp<ABuffer> &chunk);
+
+    size_t countFreeChunks();
+    size_t countChunks() const;
+
 protected:
     virtual ~LiveDataSource();
 
 private:
     Mutex mLock;
     Condition mCondition;
+    Condition mChunkFreedCondition;
 
     off64_t mOffset;
     List<sp<ABuffer> > mBufferQueue;
+    size_t mQueuedBytes;
     status_t mFinalResult;
 
-    FILE *mBackupFile;
+    size_t mNumChunks;
+    uint8_t *mChunkData;
+    List<sp<ABuffer> > mFreeChunks;
+
+    bool isChunk_l(const sp<ABuffer> &buffer) const;
+    void allocateChunks_l();
+    void recycle_l(const sp<ABuffer> &buffer);
 
     ssize_t readAt_l(off64_t offset, void *data, size_t size);
 
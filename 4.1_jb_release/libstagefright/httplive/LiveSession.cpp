@@ -0,0 +1,1189 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "LiveSession"
+#include <utils/Log.h>
+
+#include "include/LiveSession.h"
+
+#include "LiveDataSource.h"
+#include "SegmentFetcher.h"
+
+#include "include/M3UParser.h"
+#include "include/HTTPBase.h"
+
+#include <cutils/properties.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <openssl/md5.h>
+
+namespace android {
+
+LiveSession::LiveSession(uint32_t flags, bool uidValid, uid_t uid)
+    : mFlags(flags),
+      mUIDValid(uidValid),
+      mUID(uid),
+      mDataSource(new LiveDataSource),
+      mPrefetchDepth(kDefaultPrefetchDepth),
+      mPrevBandwidthIndex(-1),
+      mLastFedBandwidthIndex(-1),
+      mLastPlaylistFetchTimeUs(-1),
+      mSeqNumber(-1),
+      mNumRetries(0),
+      mSignalDiscontinuity(false),
+      mEOSQueued(false),
+      mDurationUs(-1),
+      mCurrenttimeUs(0),
+      mSeekDone(false),
+      mDisconnectPending(false),
+      mMonitorQueueGeneration(0),
+      mRefreshState(INITIAL_MINIMUM_RELOAD_DELAY) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.httplive.prefetch", value, NULL)) {
+        char *end;
+        unsigned long depth = strtoul(value, &end, 10);
+        if (end > value && *end == '\0') {
+            setPrefetchDepth(depth);
+        }
+    }
+}
+
+LiveSession::~LiveSession() {
+    cancelSegments();
+
+    for (size_t i = 0; i < mFetchers.size(); ++i) {
+        mFetcherLoopers.editItemAt(i)->unregisterHandler(
+                mFetchers.itemAt(i)->id());
+        mFetcherLoopers.editItemAt(i)->stop();
+    }
+}
+
+sp<DataSource> LiveSession::getDataSource() {
+    return mDataSource;
+}
+
+void LiveSession::setPrefetchDepth(size_t depth) {
+    if (depth > kMaxPrefetchDepth) {
+        depth = kMaxPrefetchDepth;
+    }
+
+    mPrefetchDepth = depth;
+}
+
+void LiveSession::connect(
+        const char *url, const KeyedVector<String8, String8> *headers) {
+    sp<AMessage> msg = new AMessage(kWhatConnect, id());
+    msg->setString("url", url);
+
+    if (headers != NULL) {
+        msg->setPointer(
+                "headers",
+                new KeyedVector<String8, String8>(*headers));
+    }
+
+    msg->post();
+}
+
+void LiveSession::disconnect() {
+    Mutex::Autolock autoLock(mLock);
+    mDisconnectPending = true;
+
+    if (mHTTPDataSource != NULL) {
+        mHTTPDataSource->disconnect();
+    }
+
+    (new AMessage(kWhatDisconnect, id()))->post();
+}
+
+void LiveSession::seekTo(int64_t timeUs) {
+    Mutex::Autolock autoLock(mLock);
+    mSeekDone = false;
+
+    sp<AMessage> msg = new AMessage(kWhatSeek, id());
+    msg->setInt64("timeUs", timeUs);
+    msg->post();
+
+    while (!mSeekDone) {
+        mCondition.wait(mLock);
+    }
+}
+
+void LiveSession::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatConnect:
+            onConnect(msg);
+            break;
+
+        case kWhatDisconnect:
+            onDisconnect();
+            break;
+
+        case kWhatMonitorQueue:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+
+            if (generation != mMonitorQueueGeneration) {
+                // Stale event
+                break;
+            }
+
+            onMonitorQueue();
+            break;
+        }
+
+        case kWhatSeek:
+            onSeek(msg);
+            break;
+
+        case kWhatFetcherNotify:
+            onFetcherNotify(msg);
+            break;
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
+// static
+int LiveSession::SortByBandwidth(const BandwidthItem *a, const BandwidthItem *b) {
+    if (a->mBandwidth < b->mBandwidth) {
+        return -1;
+    } else if (a->mBandwidth == b->mBandwidth) {
+        return 0;
+    }
+
+    return 1;
+}
+
+sp<HTTPBase> LiveSession::createHTTPDataSource() {
+    sp<HTTPBase> source = HTTPBase::Create(
+            (mFlags & kFlagIncognito) ? HTTPBase::kFlagIncognito : 0);
+
+    if (mUIDValid) {
+        source->setUID(mUID);
+    }
+
+    return source;
+}
+
+static int64_t getItemDurationUs(const sp<M3UParser> &playlist, size_t index) {
+    sp<AMessage> itemMeta;
+    CHECK(playlist->itemAt(index, NULL /* uri */, &itemMeta));
+
+    int64_t itemDurationUs;
+    CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+
+    return itemDurationUs;
+}
+
+static int32_t getFirstSeqNumber(const sp<M3UParser> &playlist) {
+    int32_t firstSeqNumberInPlaylist;
+    if (playlist->meta() == NULL || !playlist->meta()->findInt32(
+                "media-sequence", &firstSeqNumberInPlaylist)) {
+        firstSeqNumberInPlaylist = 0;
+    }
+
+    return firstSeqNumberInPlaylist;
+}
+
+void LiveSession::onConnect(const sp<AMessage> &msg) {
+    AString url;
+    CHECK(msg->findString("url", &url));
+
+    KeyedVector<String8, String8> *headers = NULL;
+    if (!msg->findPointer("headers", (void **)&headers)) {
+        mExtraHeaders.clear();
+    } else {
+        mExtraHeaders = *headers;
+
+        delete headers;
+        headers = NULL;
+    }
+
+    if (!(mFlags & kFlagIncognito)) {
+        ALOGI("onConnect '%s'", url.c_str());
+    } else {
+        ALOGI("onConnect <URL suppressed>");
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mHTTPDataSource = createHTTPDataSource();
+    }
+
+    mMasterURL = url;
+
+    bool dummy;
+    sp<M3UParser> playlist = fetchPlaylist(url.c_str(), &dummy);
+
+    if (playlist == NULL) {
+        ALOGE("unable to fetch master playlist '%s'.", url.c_str());
+
+        mDataSource->queueEOS(ERROR_IO);
+        return;
+    }
+
+    if (playlist->isVariantPlaylist()) {
+        for (size_t i = 0; i < playlist->size(); ++i) {
+            BandwidthItem item;
+
+            sp<AMessage> meta;
+            playlist->itemAt(i, &item.mURI, &meta);
+
+            int32_t bandwidth;
+            if (meta == NULL || !meta->findInt32("bandwidth", &bandwidth)) {
+                bandwidth = 0;
+            }
+            item.mBandwidth = bandwidth;
+
+            mBandwidthItems.push(item);
+        }
+
+        if (mBandwidthItems.isEmpty()) {
+            ALOGE("master playlist lists no variants.");
+
+            mDataSource->queueEOS(ERROR_MALFORMED);
+            return;
+        }
+
+        mBandwidthItems.sort(SortByBandwidth);
+    } else {
+        // Not a variant playlist, there is nothing to choose from and the
+        // playlist just fetched is the one to play.
+        mPlaylist = playlist;
+        mPrevBandwidthIndex = 0;
+        mLastPlaylistFetchTimeUs = ALooper::GetNowUs();
+
+        int64_t durationUs = -1;
+        if (mPlaylist->isComplete()) {
+            durationUs = 0;
+            for (size_t i = 0; i < mPlaylist->size(); ++i) {
+                durationUs += getItemDurationUs(mPlaylist, i);
+            }
+        }
+
+        Mutex::Autolock autoLock(mLock);
+        mDurationUs = durationUs;
+    }
+
+    for (size_t i = 0; i <= mPrefetchDepth; ++i) {
+        sp<ALooper> looper = new ALooper;
+        looper->setName("segment fetcher");
+        looper->start();
+
+        sp<AMessage> notify = new AMessage(kWhatFetcherNotify, id());
+        notify->setSize("fetcher", i);
+
+        sp<SegmentFetcher> fetcher = new SegmentFetcher(
+                notify, mDataSource, createHTTPDataSource(), mExtraHeaders);
+
+        looper->registerHandler(fetcher);
+
+        mFetcherLoopers.push(looper);
+        mFetchers.push(fetcher);
+    }
+
+    postMonitorQueue();
+}
+
+void LiveSession::onDisconnect() {
+    ALOGI("onDisconnect");
+
+    // Stops the monitor.
+    ++mMonitorQueueGeneration;
+
+    cancelSegments();
+
+    mEOSQueued = true;
+    mDataSource->queueEOS(ERROR_END_OF_STREAM);
+
+    Mutex::Autolock autoLock(mLock);
+    mDisconnectPending = false;
+}
+
+status_t LiveSession::fetchFile(
+        const char *url, sp<ABuffer> *out,
+        int64_t range_offset, int64_t range_length) {
+    *out = NULL;
+
+    sp<DataSource> source;
+
+    if (!strncasecmp(url, "file://", 7)) {
+        source = new FileSource(url + 7);
+    } else if (strncasecmp(url, "http://", 7)
+            && strncasecmp(url, "https://", 8)) {
+        return ERROR_UNSUPPORTED;
+    } else {
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            if (mDisconnectPending) {
+                return ERROR_IO;
+            }
+        }
+
+        KeyedVector<String8, String8> headers = mExtraHeaders;
+        if (range_offset > 0 || range_length >= 0) {
+            headers.add(
+                    String8("Range"),
+                    String8(
+                        StringPrintf(
+                            "bytes=%lld-%s",
+                            range_offset,
+                            range_length < 0
+                                ? "" : StringPrintf("%lld", range_offset + range_length - 1).c_str()).c_str()));
+        }
+        status_t err = mHTTPDataSource->connect(url, &headers);
+
+        if (err != OK) {
+            return err;
+        }
+
+        source = mHTTPDataSource;
+    }
+
+    off64_t size;
+    status_t err = source->getSize(&size);
+
+    if (err != OK) {
+        size = 65536;
+    }
+
+    sp<ABuffer> buffer = new ABuffer(size);
+    buffer->setRange(0, 0);
+
+    for (;;) {
+        size_t bufferRemaining = buffer->capacity() - buffer->size();
+
+        if (bufferRemaining == 0) {
+            // Grow geometrically, playlists of long live streams are large.
+            bufferRemaining = buffer->size();
+
+            ALOGV("increasing download buffer to %d bytes",
+                 buffer->size() + bufferRemaining);
+
+            sp<ABuffer> copy = new ABuffer(buffer->size() + bufferRemaining);
+            memcpy(copy->data(), buffer->data(), buffer->size());
+            copy->setRange(0, buffer->size());
+
+            buffer = copy;
+        }
+
+        size_t maxBytesToRead = bufferRemaining;
+        if (range_length >= 0) {
+            int64_t bytesLeftInRange = range_length - buffer->size();
+            if (bytesLeftInRange < (int64_t)maxBytesToRead) {
+                maxBytesToRead = bytesLeftInRange;
+
+                if (bytesLeftInRange == 0) {
+                    break;
+                }
+            }
+        }
+
+        ssize_t n = source->readAt(
+                buffer->size(), buffer->data() + buffer->size(),
+                maxBytesToRead);
+
+        if (n < 0) {
+            return n;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        buffer->setRange(0, buffer->size() + (size_t)n);
+    }
+
+    *out = buffer;
+
+    return OK;
+}
+
+sp<M3UParser> LiveSession::fetchPlaylist(const char *url, bool *unchanged) {
+    ALOGV("fetchPlaylist '%s'", url);
+
+    *unchanged = false;
+
+    sp<ABuffer> buffer;
+    status_t err = fetchFile(url, &buffer);
+
+    if (err != OK) {
+        return NULL;
+    }
+
+    // MD5 functionality is not available on the simulator, treat all
+    // playlists as changed.
+
+#if defined(HAVE_ANDROID_OS)
+    uint8_t hash[16];
+
+    // The URL is part of the hash, variant playlists with relative segment
+    // URIs are often identical and a new variant is never unchanged.
+    MD5_CTX m;
+    MD5_Init(&m);
+    MD5_Update(&m, url, strlen(url));
+    MD5_Update(&m, buffer->data(), buffer->size());
+
+    MD5_Final(hash, &m);
+
+    if (mPlaylist != NULL && !memcmp(hash, mPlaylistHash, 16)) {
+        // playlist unchanged
+
+        if (mRefreshState != THIRD_UNCHANGED_RELOAD_ATTEMPT) {
+            mRefreshState = (RefreshState)(mRefreshState + 1);
+        }
+
+        *unchanged = true;
+
+        ALOGV("Playlist unchanged, refresh state is now %d",
+             (int)mRefreshState);
+
+        return NULL;
+    }
+
+    memcpy(mPlaylistHash, hash, sizeof(hash));
+
+    mRefreshState = INITIAL_MINIMUM_RELOAD_DELAY;
+#endif
+
+    sp<M3UParser> playlist =
+        new M3UParser(url, buffer->data(), buffer->size());
+
+    if (playlist->initCheck() != OK) {
+        ALOGE("failed to parse .m3u8 playlist");
+
+        return NULL;
+    }
+
+    return playlist;
+}
+
+status_t LiveSession::refreshPlaylist(size_t bandwidthIndex) {
+    AString url;
+    if (mBandwidthItems.size() > 0) {
+        url = mBandwidthItems.editItemAt(bandwidthIndex).mURI;
+    } else {
+        url = mMasterURL;
+    }
+
+    bool unchanged;
+    sp<M3UParser> playlist = fetchPlaylist(url.c_str(), &unchanged);
+    if (playlist == NULL) {
+        if (unchanged) {
+            // We succeeded in fetching the playlist, but it was
+            // unchanged from the last time we tried.
+        } else {
+            ALOGE("failed to load playlist at url '%s'", url.c_str());
+            return ERROR_IO;
+        }
+    } else {
+        mPlaylist = playlist;
+    }
+
+    mPrevBandwidthIndex = bandwidthIndex;
+    mLastPlaylistFetchTimeUs = ALooper::GetNowUs();
+
+    int64_t durationUs = -1;
+    if (mPlaylist->isComplete()) {
+        durationUs = 0;
+        for (size_t i = 0; i < mPlaylist->size(); ++i) {
+            durationUs += getItemDurationUs(mPlaylist, i);
+        }
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mDurationUs = durationUs;
+
+    return OK;
+}
+
+void LiveSession::addBandwidthSample(
+        size_t numBytes, int64_t startUs, int64_t endUs) {
+    BandwidthSample sample;
+    sample.mNumBytes = numBytes;
+    sample.mStartUs = startUs;
+    sample.mEndUs = endUs;
+
+    mBandwidthSamples.push_back(sample);
+
+    if (mBandwidthSamples.size() > kMaxBandwidthSamples) {
+        mBandwidthSamples.erase(mBandwidthSamples.begin());
+    }
+}
+
+bool LiveSession::estimateBandwidth(int32_t *bandwidthBps) {
+    if (mBandwidthSamples.empty()) {
+        return false;
+    }
+
+    // Segments are downloaded in parallel, so the link is credited with the
+    // bytes of all recent downloads over the time during which at least one
+    // of them was in progress, rather than each download with its own rate.
+    Vector<BandwidthSample> samples;
+    for (List<BandwidthSample>::iterator it = mBandwidthSamples.begin();
+         it != mBandwidthSamples.end(); ++it) {
+        size_t i = samples.size();
+        while (i > 0 && samples.itemAt(i - 1).mStartUs > it->mStartUs) {
+            --i;
+        }
+        samples.insertAt(*it, i);
+    }
+
+    size_t numBytes = 0;
+    int64_t busyUs = 0;
+    int64_t busyUntilUs = samples.itemAt(0).mStartUs;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const BandwidthSample &sample = samples.itemAt(i);
+
+        numBytes += sample.mNumBytes;
+
+        int64_t startUs =
+            sample.mStartUs > busyUntilUs ? sample.mStartUs : busyUntilUs;
+
+        if (sample.mEndUs > startUs) {
+            busyUs += sample.mEndUs - startUs;
+            busyUntilUs = sample.mEndUs;
+        }
+    }
+
+    if (busyUs <= 0) {
+        return false;
+    }
+
+    *bandwidthBps = (int32_t)(numBytes * 8E6 / busyUs);
+
+    return true;
+}
+
+size_t LiveSession::getBandwidthIndex() {
+    if (mBandwidthItems.size() == 0) {
+        return 0;
+    }
+
+    int32_t bandwidthBps;
+    if (estimateBandwidth(&bandwidthBps)) {
+        ALOGV("bandwidth estimated at %.2f kbps", bandwidthBps / 1024.0f);
+    } else {
+        ALOGV("no bandwidth estimate.");
+        return 0;  // Pick the lowest bandwidth stream by default.
+    }
+
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.httplive.max-bw", value, NULL)) {
+        char *end;
+        long maxBw = strtoul(value, &end, 10);
+        if (end > value && *end == '\0') {
+            if (maxBw > 0 && bandwidthBps > maxBw) {
+                ALOGV("bandwidth capped to %ld bps", maxBw);
+                bandwidthBps = maxBw;
+            }
+        }
+    }
+
+    // Consider only 80% of the available bandwidth usable.
+    bandwidthBps = (bandwidthBps * 8) / 10;
+
+    // Pick the highest bandwidth stream below or equal to estimated bandwidth.
+
+    size_t index = mBandwidthItems.size() - 1;
+    while (index > 0 && mBandwidthItems.itemAt(index).mBandwidth
+                            > (size_t)bandwidthBps) {
+        --index;
+    }
+
+    return index;
+}
+
+bool LiveSession::timeToRefreshPlaylist(int64_t nowUs) const {
+    if (mPlaylist == NULL) {
+        CHECK_EQ((int)mRefreshState, (int)INITIAL_MINIMUM_RELOAD_DELAY);
+        return true;
+    }
+
+    int32_t targetDurationSecs;
+    if (mPlaylist->meta() == NULL || !mPlaylist->meta()->findInt32(
+                "target-duration", &targetDurationSecs)) {
+        targetDurationSecs = 10;
+    }
+
+    int64_t targetDurationUs = targetDurationSecs * 1000000ll;
+
+    int64_t minPlaylistAgeUs;
+
+    switch (mRefreshState) {
+        case INITIAL_MINIMUM_RELOAD_DELAY:
+        {
+            size_t n = mPlaylist->size();
+            if (n > 0) {
+                minPlaylistAgeUs = getItemDurationUs(mPlaylist, n - 1);
+                break;
+            }
+
+            // fall through
+        }
+
+        case FIRST_UNCHANGED_RELOAD_ATTEMPT:
+        {
+            minPlaylistAgeUs = targetDurationUs / 2;
+            break;
+        }
+
+        case SECOND_UNCHANGED_RELOAD_ATTEMPT:
+        {
+            minPlaylistAgeUs = (targetDurationUs * 3) / 2;
+            break;
+        }
+
+        case THIRD_UNCHANGED_RELOAD_ATTEMPT:
+        {
+            minPlaylistAgeUs = targetDurationUs * 3;
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+
+    return mLastPlaylistFetchTimeUs + minPlaylistAgeUs <= nowUs;
+}
+
+status_t LiveSession::getCipherInfo(
+        size_t playlistIndex, int32_t seqNumber,
+        sp<ABuffer> *key, sp<ABuffer> *iv) {
+    key->clear();
+    iv->clear();
+
+    sp<AMessage> itemMeta;
+    bool found = false;
+    AString method;
+
+    for (ssize_t i = playlistIndex; i >= 0; --i) {
+        AString uri;
+        CHECK(mPlaylist->itemAt(i, &uri, &itemMeta));
+
+        if (itemMeta->findString("cipher-method", &method)) {
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        method = "NONE";
+    }
+
+    if (method == "NONE") {
+        return OK;
+    } else if (!(method == "AES-128")) {
+        ALOGE("Unsupported cipher method '%s'", method.c_str());
+        return ERROR_UNSUPPORTED;
+    }
+
+    AString keyURI;
+    if (!itemMeta->findString("cipher-uri", &keyURI)) {
+        ALOGE("Missing key uri");
+        return ERROR_MALFORMED;
+    }
+
+    ssize_t index = mAESKeyForURI.indexOfKey(keyURI);
+
+    if (index >= 0) {
+        *key = mAESKeyForURI.valueAt(index);
+    } else {
+        status_t err = fetchFile(keyURI.c_str(), key);
+
+        if (err != OK) {
+            ALOGE("failed to fetch cipher key from '%s'.", keyURI.c_str());
+            return ERROR_IO;
+        } else if ((*key)->size() != 16) {
+            ALOGE("key file '%s' wasn't 16 bytes in size.", keyURI.c_str());
+            return ERROR_MALFORMED;
+        }
+
+        mAESKeyForURI.add(keyURI, *key);
+    }
+
+    *iv = new ABuffer(16);
+    uint8_t *aes_ivec = (*iv)->data();
+    memset(aes_ivec, 0, 16);
+
+    AString ivString;
+    if (itemMeta->findString("cipher-iv", &ivString)) {
+        if ((!ivString.startsWith("0x") && !ivString.startsWith("0X"))
+                || ivString.size() != 16 * 2 + 2) {
+            ALOGE("malformed cipher IV '%s'.", ivString.c_str());
+            return ERROR_MALFORMED;
+        }
+
+        for (size_t i = 0; i < 16; ++i) {
+            char c1 = tolower(ivString.c_str()[2 + 2 * i]);
+            char c2 = tolower(ivString.c_str()[3 + 2 * i]);
+            if (!isxdigit(c1) || !isxdigit(c2)) {
+                ALOGE("malformed cipher IV '%s'.", ivString.c_str());
+                return ERROR_MALFORMED;
+            }
+            uint8_t nibble1 = isdigit(c1) ? c1 - '0' : c1 - 'a' + 10;
+            uint8_t nibble2 = isdigit(c2) ? c2 - '0' : c2 - 'a' + 10;
+
+            aes_ivec[i] = nibble1 << 4 | nibble2;
+        }
+    } else {
+        aes_ivec[15] = seqNumber & 0xff;
+        aes_ivec[14] = (seqNumber >> 8) & 0xff;
+        aes_ivec[13] = (seqNumber >> 16) & 0xff;
+        aes_ivec[12] = (seqNumber >> 24) & 0xff;
+    }
+
+    return OK;
+}
+
+void LiveSession::onMonitorQueue() {
+    fillPipeline();
+
+    // Catches chunks being freed by the reader and live playlists growing.
+    postMonitorQueue(100000ll);
+}
+
+void LiveSession::fillPipeline() {
+    while (!mEOSQueued && mSegments.size() <= mPrefetchDepth) {
+        // Only download ahead while there is room for it, a download that
+        // has to wait for the reader keeps its connection idle.
+        if (!mSegments.empty()
+                && mDataSource->countFreeChunks() * 2
+                    < mDataSource->countChunks()) {
+            break;
+        }
+
+        status_t err = startNextSegment();
+
+        if (err == -EAGAIN) {
+            break;
+        }
+
+        if (err == ERROR_END_OF_STREAM) {
+            if (mSegments.empty()) {
+                mEOSQueued = true;
+                mDataSource->queueEOS(ERROR_END_OF_STREAM);
+            }
+            break;
+        }
+
+        if (err != OK) {
+            cancelSegments();
+
+            mEOSQueued = true;
+            mDataSource->queueEOS(err);
+            break;
+        }
+    }
+
+    feedSegments();
+}
+
+status_t LiveSession::startNextSegment() {
+    ssize_t fetcherIndex = -1;
+    for (size_t i = 0; i < mFetchers.size() && fetcherIndex < 0; ++i) {
+        fetcherIndex = i;
+
+        for (List<Segment>::iterator it = mSegments.begin();
+             it != mSegments.end(); ++it) {
+            if (it->mFetcherIndex == i && !it->mDone) {
+                fetcherIndex = -1;
+                break;
+            }
+        }
+    }
+
+    if (fetcherIndex < 0) {
+        return -EAGAIN;
+    }
+
+    size_t bandwidthIndex = getBandwidthIndex();
+    bool refreshed = false;
+
+    if (mPlaylist == NULL
+            || (ssize_t)bandwidthIndex != mPrevBandwidthIndex
+            || (!mPlaylist->isComplete()
+                && timeToRefreshPlaylist(ALooper::GetNowUs()))) {
+        ssize_t prevBandwidthIndex = mPrevBandwidthIndex;
+
+        status_t err = refreshPlaylist(bandwidthIndex);
+        refreshed = true;
+
+        if (prevBandwidthIndex >= 0
+                && (ssize_t)bandwidthIndex != prevBandwidthIndex) {
+            if (err != OK) {
+                ALOGW("failed to switch bandwidth, staying with the "
+                      "previous one");
+
+                err = OK;
+            } else if (mSeqNumber >= 0) {
+                int32_t firstSeqNumberInPlaylist = getFirstSeqNumber(mPlaylist);
+
+                if (mSeqNumber < firstSeqNumberInPlaylist
+                        || mSeqNumber >= firstSeqNumberInPlaylist
+                                + (int32_t)mPlaylist->size()) {
+                    // Go back to the previous bandwidth.
+
+                    ALOGI("new bandwidth does not have the sequence number "
+                         "we're looking for, switching back to previous "
+                         "bandwidth");
+
+                    err = refreshPlaylist(prevBandwidthIndex);
+                }
+            }
+        }
+
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    int32_t firstSeqNumberInPlaylist = getFirstSeqNumber(mPlaylist);
+
+    if (mSeqNumber < 0) {
+        mSeqNumber = firstSeqNumberInPlaylist;
+    }
+
+    int32_t lastSeqNumberInPlaylist =
+        firstSeqNumberInPlaylist + (int32_t)mPlaylist->size() - 1;
+
+    bool explicitDiscontinuity = false;
+
+    if (mSeqNumber > lastSeqNumberInPlaylist) {
+        if (mPlaylist->isComplete()) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        if (refreshed && ++mNumRetries > kMaxNumRetries) {
+            ALOGE("live playlist stopped growing.");
+            return ERROR_END_OF_STREAM;
+        }
+
+        // Wait for the playlist to grow.
+        return -EAGAIN;
+    }
+
+    if (mSeqNumber < firstSeqNumberInPlaylist) {
+        if (mPlaylist->isComplete()) {
+            ALOGE("Cannot find sequence number %d in playlist "
+                 "(contains %d - %d)",
+                 mSeqNumber, firstSeqNumberInPlaylist,
+                 lastSeqNumberInPlaylist);
+
+            return ERROR_END_OF_STREAM;
+        }
+
+        // we've missed the boat, let's start from the lowest sequence
+        // number available and signal a discontinuity.
+
+        ALOGI("We've missed the boat, restarting playback.");
+        mSeqNumber = lastSeqNumberInPlaylist;
+        explicitDiscontinuity = true;
+    }
+
+    mNumRetries = 0;
+
+    size_t index = mSeqNumber - firstSeqNumberInPlaylist;
+
+    AString uri;
+    sp<AMessage> itemMeta;
+    CHECK(mPlaylist->itemAt(index, &uri, &itemMeta));
+
+    int32_t val;
+    if (itemMeta->findInt32("discontinuity", &val) && val != 0) {
+        explicitDiscontinuity = true;
+    }
+
+    int64_t rangeOffset, rangeLength;
+    if (!itemMeta->findInt64("range-offset", &rangeOffset)
+            || !itemMeta->findInt64("range-length", &rangeLength)) {
+        rangeOffset = 0;
+        rangeLength = -1;
+    }
+
+    sp<ABuffer> key, iv;
+    status_t err = getCipherInfo(index, mSeqNumber, &key, &iv);
+
+    if (err != OK) {
+        return err;
+    }
+
+    Segment segment;
+    segment.mSeqNumber = mSeqNumber;
+    segment.mBandwidthIndex = mPrevBandwidthIndex;
+    segment.mFetcherIndex = fetcherIndex;
+    segment.mDiscontinuity = explicitDiscontinuity;
+    segment.mFeeding = false;
+    segment.mDone = false;
+    segment.mFinalResult = OK;
+
+    segment.mStartTimeUs = 0;
+    for (size_t i = 0; i < index; ++i) {
+        segment.mStartTimeUs += getItemDurationUs(mPlaylist, i);
+    }
+
+    if (!(mFlags & kFlagIncognito)) {
+        ALOGV("fetching segment %d from '%s'", mSeqNumber, uri.c_str());
+    } else {
+        ALOGV("fetching segment %d", mSeqNumber);
+    }
+
+    segment.mFetcherGeneration = mFetchers.editItemAt(fetcherIndex)->fetch(
+            mSeqNumber, uri, rangeOffset, rangeLength, key, iv);
+
+    mSegments.push_back(segment);
+
+    ++mSeqNumber;
+
+    return OK;
+}
+
+void LiveSession::feedSegments() {
+    while (!mSegments.empty()) {
+        Segment *segment = &*mSegments.begin();
+
+        if (!segment->mFeeding) {
+            segment->mFeeding = true;
+
+            bool bandwidthChanged =
+                mLastFedBandwidthIndex >= 0
+                    && (ssize_t)segment->mBandwidthIndex
+                            != mLastFedBandwidthIndex;
+
+            if (mSignalDiscontinuity || segment->mDiscontinuity
+                    || bandwidthChanged) {
+                // Signal discontinuity.
+
+                ALOGI("queueing discontinuity (explicit=%d, "
+                     "bandwidthChanged=%d)",
+                     segment->mDiscontinuity, bandwidthChanged);
+
+                sp<ABuffer> tmp = new ABuffer(188);
+                memset(tmp->data(), 0, tmp->size());
+
+                // signal a 'hard' discontinuity for explicit or
+                // bandwidthChanged, seeks count as the latter.
+                tmp->data()[1] = 1;
+
+                mDataSource->queueBuffer(tmp);
+
+                mSignalDiscontinuity = false;
+            }
+
+            mLastFedBandwidthIndex = segment->mBandwidthIndex;
+
+            if (!segment->mDone) {
+                mFetchers.editItemAt(segment->mFetcherIndex)->setPriority(true);
+            }
+
+            Mutex::Autolock autoLock(mLock);
+            mCurrenttimeUs = segment->mStartTimeUs;
+        }
+
+        while (!segment->mChunks.empty()) {
+            mDataSource->queueBuffer(*segment->mChunks.begin());
+            segment->mChunks.erase(segment->mChunks.begin());
+        }
+
+        if (!segment->mDone) {
+            break;
+        }
+
+        if (segment->mFinalResult != OK) {
+            ALOGE("failed to fetch .ts segment %d", segment->mSeqNumber);
+
+            status_t err = segment->mFinalResult;
+            cancelSegments();
+
+            mEOSQueued = true;
+            mDataSource->queueEOS(err);
+            return;
+        }
+
+        mSegments.erase(mSegments.begin());
+    }
+}
+
+void LiveSession::cancelSegments() {
+    for (List<Segment>::iterator it = mSegments.begin();
+         it != mSegments.end(); ++it) {
+        if (!it->mDone) {
+            mFetchers.editItemAt(it->mFetcherIndex)->cancel();
+        }
+
+        while (!it->mChunks.empty()) {
+            mDataSource->releaseChunk(*it->mChunks.begin());
+            it->mChunks.erase(it->mChunks.begin());
+        }
+    }
+
+    mSegments.clear();
+}
+
+void LiveSession::onFetcherNotify(const sp<AMessage> &msg) {
+    size_t fetcherIndex;
+    int32_t what, seqNumber, generation;
+    CHECK(msg->findSize("fetcher", &fetcherIndex));
+    CHECK(msg->findInt32("what", &what));
+    CHECK(msg->findInt32("seqNumber", &seqNumber));
+    CHECK(msg->findInt32("generation", &generation));
+
+    Segment *segment = NULL;
+    for (List<Segment>::iterator it = mSegments.begin();
+         it != mSegments.end(); ++it) {
+        if (it->mFetcherIndex == fetcherIndex
+                && it->mFetcherGeneration == generation
+                && it->mSeqNumber == seqNumber
+                && !it->mDone) {
+            segment = &*it;
+            break;
+        }
+    }
+
+    if (what == SegmentFetcher::kWhatChunk) {
+        sp<ABuffer> chunk;
+        CHECK(msg->findBuffer("buffer", &chunk));
+
+        if (segment == NULL) {
+            // The segment was cancelled.
+            mDataSource->releaseChunk(chunk);
+            return;
+        }
+
+        segment->mChunks.push_back(chunk);
+
+        if (segment == &*mSegments.begin()) {
+            feedSegments();
+        }
+        return;
+    }
+
+    CHECK_EQ(what, (int32_t)SegmentFetcher::kWhatDone);
+
+    if (segment == NULL) {
+        return;
+    }
+
+    int32_t err;
+    CHECK(msg->findInt32("err", &err));
+
+    segment->mDone = true;
+    segment->mFinalResult = err;
+
+    mFetchers.editItemAt(fetcherIndex)->setPriority(false);
+
+    int32_t throttled;
+    if (err == OK
+            && msg->findInt32("throttled", &throttled) && !throttled) {
+        size_t numBytes;
+        int64_t startUs, endUs;
+        CHECK(msg->findSize("numBytes", &numBytes));
+        CHECK(msg->findInt64("startUs", &startUs));
+        CHECK(msg->findInt64("endUs", &endUs));
+
+        addBandwidthSample(numBytes, startUs, endUs);
+    }
+
+    feedSegments();
+    fillPipeline();
+}
+
+void LiveSession::onSeek(const sp<AMessage> &msg) {
+    int64_t timeUs;
+    CHECK(msg->findInt64("timeUs", &timeUs));
+
+    if (mPlaylist != NULL && mPlaylist->isComplete()) {
+        size_t index = 0;
+        int64_t segmentStartUs = 0;
+        while (index < mPlaylist->size()) {
+            int64_t itemDurationUs = getItemDurationUs(mPlaylist, index);
+
+            if (timeUs < segmentStartUs + itemDurationUs) {
+                break;
+            }
+
+            segmentStartUs += itemDurationUs;
+            ++index;
+        }
+
+        if (index < mPlaylist->size()) {
+            int32_t newSeqNumber = getFirstSeqNumber(mPlaylist) + index;
+
+            ALOGI("seeking to seq no %d", newSeqNumber);
+
+            cancelSegments();
+            mDataSource->reset();
+
+            mSeqNumber = newSeqNumber;
+            mEOSQueued = false;
+
+            // reseting the data source will have had the side effect of
+            // discarding any previously queued bandwidth change
+            // discontinuity. Therefore we'll need to treat these seek
+            // discontinuities as involving a bandwidth change as well.
+            mSignalDiscontinuity = true;
+        }
+    }
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mSeekDone = true;
+        mCondition.broadcast();
+    }
+
+    fillPipeline();
+}
+
+status_t LiveSession::getDuration(int64_t *durationUs) {
+    Mutex::Autolock autoLock(mLock);
+    *durationUs = mDurationUs;
+
+    return OK;
+}
+
+status_t LiveSession::getCurrentTime(int64_t *CurrenttimeUs) {
+    Mutex::Autolock autoLock(mLock);
+    *CurrenttimeUs = mCurrenttimeUs;
+
+    return OK;
+}
+
+bool LiveSession::isSeekable() {
+    int64_t durationUs;
+    return getDuration(&durationUs) == OK && durationUs >= 0;
+}
+
+void LiveSession::postMonitorQueue(int64_t delayUs) {
+    sp<AMessage> msg = new AMessage(kWhatMonitorQueue, id());
+    msg->setInt32("generation", ++mMonitorQueueGeneration);
+    msg->post(delayUs);
+}
+
+}  // namespace android
@@ -0,0 +1,390 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentFetcher"
+#include <utils/Log.h>
+
+#include "SegmentFetcher.h"
+
+#include "LiveDataSource.h"
+
+#include "include/HTTPBase.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <openssl/aes.h>
+
+namespace android {
+
+SegmentFetcher::SegmentFetcher(
+        const sp<AMessage> &notify,
+        const sp<LiveDataSource> &dataSource,
+        const sp<HTTPBase> &httpDataSource,
+        const KeyedVector<String8, String8> &extraHeaders)
+    : mNotify(notify),
+      mDataSource(dataSource),
+      mHTTPDataSource(httpDataSource),
+      mExtraHeaders(extraHeaders),
+      mGeneration(0),
+      mPriority(false) {
+}
+
+SegmentFetcher::~SegmentFetcher() {
+}
+
+int32_t SegmentFetcher::fetch(
+        int32_t seqNumber, const AString &uri,
+        int64_t rangeOffset, int64_t rangeLength,
+        const sp<ABuffer> &key, const sp<ABuffer> &iv) {
+    int32_t generation;
+    {
+        Mutex::Autolock autoLock(mLock);
+        generation = mGeneration;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatFetch, id());
+    msg->setInt32("seqNumber", seqNumber);
+    msg->setInt32("generation", generation);
+    msg->setString("uri", uri.c_str());
+    msg->setInt64("rangeOffset", rangeOffset);
+    msg->setInt64("rangeLength", rangeLength);
+
+    if (key != NULL) {
+        msg->setBuffer("key", key);
+        msg->setBuffer("iv", iv);
+    }
+
+    msg->post();
+
+    return generation;
+}
+
+void SegmentFetcher::cancel() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mGeneration;
+        mPriority = false;
+    }
+
+    // Unblocks a pending read.
+    if (mHTTPDataSource != NULL) {
+        mHTTPDataSource->disconnect();
+    }
+}
+
+void SegmentFetcher::setPriority(bool priority) {
+    Mutex::Autolock autoLock(mLock);
+    mPriority = priority;
+}
+
+bool SegmentFetcher::isCancelled(int32_t generation) {
+    Mutex::Autolock autoLock(mLock);
+    return generation != mGeneration;
+}
+
+void SegmentFetcher::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatFetch:
+        {
+            onFetch(msg);
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
+status_t SegmentFetcher::openSource(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+        sp<DataSource> *source, off64_t *offset) {
+    *offset = 0;
+
+    if (!strncasecmp(uri.c_str(), "file://", 7)) {
+        *source = new FileSource(uri.c_str() + 7);
+        *offset = rangeOffset;
+
+        return (*source)->initCheck();
+    }
+
+    if (strncasecmp(uri.c_str(), "http://", 7)
+            && strncasecmp(uri.c_str(), "https://", 8)) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    KeyedVector<String8, String8> headers = mExtraHeaders;
+    if (rangeOffset > 0 || rangeLength >= 0) {
+        headers.add(
+                String8("Range"),
+                String8(
+                    StringPrintf(
+                        "bytes=%lld-%s",
+                        rangeOffset,
+                        rangeLength < 0
+                            ? "" : StringPrintf("%lld", rangeOffset + rangeLength - 1).c_str()).c_str()));
+    }
+
+    status_t err = mHTTPDataSource->connect(uri.c_str(), &headers);
+
+    if (err != OK) {
+        return err;
+    }
+
+    *source = mHTTPDataSource;
+
+    return OK;
+}
+
+sp<ABuffer> SegmentFetcher::acquireChunk(int32_t generation, bool *throttled) {
+    for (;;) {
+        bool priority;
+        {
+            Mutex::Autolock autoLock(mLock);
+
+            if (generation != mGeneration) {
+                return NULL;
+            }
+
+            priority = mPriority;
+        }
+
+        sp<ABuffer> chunk = mDataSource->acquireChunk(priority, 0);
+        if (chunk != NULL) {
+            return chunk;
+        }
+
+        *throttled = true;
+
+        chunk = mDataSource->acquireChunk(priority, kChunkWaitUs);
+        if (chunk != NULL) {
+            return chunk;
+        }
+    }
+}
+
+void SegmentFetcher::postChunk(
+        int32_t seqNumber, int32_t generation, const sp<ABuffer> &chunk) {
+    sp<AMessage> notify = mNotify->dup();
+    notify->setInt32("what", kWhatChunk);
+    notify->setInt32("seqNumber", seqNumber);
+    notify->setInt32("generation", generation);
+    notify->setBuffer("buffer", chunk);
+    notify->post();
+}
+
+void SegmentFetcher::releaseChunk(sp<ABuffer> *chunk) {
+    if (*chunk != NULL) {
+        mDataSource->releaseChunk(*chunk);
+        chunk->clear();
+    }
+}
+
+void SegmentFetcher::onFetch(const sp<AMessage> &msg) {
+    int32_t seqNumber, generation;
+    CHECK(msg->findInt32("seqNumber", &seqNumber));
+    CHECK(msg->findInt32("generation", &generation));
+
+    if (isCancelled(generation)) {
+        return;
+    }
+
+    AString uri;
+    int64_t rangeOffset, rangeLength;
+    CHECK(msg->findString("uri", &uri));
+    CHECK(msg->findInt64("rangeOffset", &rangeOffset));
+    CHECK(msg->findInt64("rangeLength", &rangeLength));
+
+    sp<ABuffer> key, iv;
+    AES_KEY aesKey;
+    uint8_t aesIV[16];
+    if (msg->findBuffer("key", &key)) {
+        CHECK(msg->findBuffer("iv", &iv));
+        CHECK_EQ(key->size(), 16u);
+        CHECK_EQ(iv->size(), sizeof(aesIV));
+
+        CHECK_EQ(AES_set_decrypt_key(key->data(), 128, &aesKey), 0);
+        memcpy(aesIV, iv->data(), sizeof(aesIV));
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+    bool throttled = false;
+
+    sp<DataSource> source;
+    off64_t offset;
+    status_t err = openSource(uri, rangeOffset, rangeLength, &source, &offset);
+
+    // With encryption the last chunk is held back until the end of the
+    // segment is known, its padding has to be stripped.
+    sp<ABuffer> chunk, pending;
+    size_t numBytes = 0;
+
+    while (err == OK) {
+        if (chunk == NULL) {
+            chunk = acquireChunk(generation, &throttled);
+
+            if (chunk == NULL) {
+                break;
+            }
+        }
+
+        size_t maxBytesToRead = chunk->capacity() - chunk->size();
+
+        if (rangeLength >= 0) {
+            int64_t bytesLeftInRange = rangeLength - numBytes;
+
+            if (bytesLeftInRange < (int64_t)maxBytesToRead) {
+                maxBytesToRead = bytesLeftInRange;
+            }
+
+            if (maxBytesToRead == 0) {
+                break;
+            }
+        }
+
+        ssize_t n = source->readAt(
+                offset, chunk->data() + chunk->size(), maxBytesToRead);
+
+        if (isCancelled(generation)) {
+            break;
+        }
+
+        if (n < 0) {
+            err = n;
+            break;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        offset += n;
+        numBytes += n;
+        chunk->setRange(0, chunk->size() + n);
+
+        if (chunk->size() < chunk->capacity()) {
+            continue;
+        }
+
+        if (key != NULL) {
+            AES_cbc_encrypt(
+                    chunk->data(), chunk->data(), chunk->size(),
+                    &aesKey, aesIV, AES_DECRYPT);
+
+            if (pending != NULL) {
+                postChunk(seqNumber, generation, pending);
+            }
+
+            pending = chunk;
+        } else {
+            postChunk(seqNumber, generation, chunk);
+        }
+
+        chunk.clear();
+    }
+
+    if (source != NULL && source == mHTTPDataSource) {
+        mHTTPDataSource->disconnect();
+    }
+
+    if (isCancelled(generation)) {
+        releaseChunk(&chunk);
+        releaseChunk(&pending);
+        return;
+    }
+
+    if (err == OK && chunk != NULL && chunk->size() == 0) {
+        releaseChunk(&chunk);
+    }
+
+    if (err == OK && key != NULL) {
+        if (chunk != NULL) {
+            if (chunk->size() % 16) {
+                ALOGE("encrypted segment %d is not a multiple of the "
+                      "AES block size", seqNumber);
+
+                err = ERROR_MALFORMED;
+            } else {
+                AES_cbc_encrypt(
+                        chunk->data(), chunk->data(), chunk->size(),
+                        &aesKey, aesIV, AES_DECRYPT);
+
+                if (pending != NULL) {
+                    postChunk(seqNumber, generation, pending);
+                }
+
+                pending = chunk;
+                chunk.clear();
+            }
+        }
+
+        if (err == OK && pending != NULL) {
+            // PKCS7 padding.
+            size_t n = pending->size();
+            size_t pad = pending->data()[n - 1];
+
+            if (pad == 0 || pad > 16 || pad > n) {
+                err = ERROR_MALFORMED;
+            } else {
+                for (size_t i = 0; i < pad; ++i) {
+                    if (pending->data()[n - 1 - i] != pad) {
+                        err = ERROR_MALFORMED;
+                        break;
+                    }
+                }
+            }
+
+            if (err == OK) {
+                pending->setRange(0, n - pad);
+                postChunk(seqNumber, generation, pending);
+                pending.clear();
+            } else {
+                ALOGE("malformed padding in encrypted segment %d", seqNumber);
+            }
+        }
+    } else if (err == OK && chunk != NULL) {
+        postChunk(seqNumber, generation, chunk);
+        chunk.clear();
+    }
+
+    releaseChunk(&chunk);
+    releaseChunk(&pending);
+
+    int64_t endUs = ALooper::GetNowUs();
+
+    ALOGV("segment %d: %d bytes in %lld us%s (err %d)",
+          seqNumber, numBytes, endUs - startUs,
+          throttled ? ", throttled" : "", err);
+
+    sp<AMessage> notify = mNotify->dup();
+    notify->setInt32("what", kWhatDone);
+    notify->setInt32("seqNumber", seqNumber);
+    notify->setInt32("generation", generation);
+    notify->setInt32("err", err);
+    notify->setSize("numBytes", numBytes);
+    notify->setInt64("startUs", startUs);
+    notify->setInt64("endUs", endUs);
+    notify->setInt32("throttled", throttled);
+    notify->post();
+}
+
+}  // namespace android
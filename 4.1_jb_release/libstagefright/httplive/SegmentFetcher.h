@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENT_FETCHER_H_
+
+#define SEGMENT_FETCHER_H_
+
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+
+namespace android {
+
+struct ABuffer;
+struct DataSource;
+struct HTTPBase;
+struct LiveDataSource;
+
+// Downloads one media segment at a time on its own looper, so that a
+// LiveSession can have several segments in flight. The segment is read
+// straight into chunks of the session's LiveDataSource and every chunk is
+// handed back, in order, through the notify message:
+//
+//   what = kWhatChunk, "seqNumber", "generation", "buffer"
+//   what = kWhatDone,  "seqNumber", "generation", "err",
+//                      "numBytes", "startUs", "endUs", "throttled"
+//
+// "throttled" is set if the download had to wait for free chunks, its
+// timing then says more about the reader than about the network.
+struct SegmentFetcher : public AHandler {
+    enum {
+        kWhatChunk  = 'chnk',
+        kWhatDone   = 'done',
+    };
+
+    SegmentFetcher(
+            const sp<AMessage> &notify,
+            const sp<LiveDataSource> &dataSource,
+            const sp<HTTPBase> &httpDataSource,
+            const KeyedVector<String8, String8> &extraHeaders);
+
+    // Starts downloading "uri", or the part of it given by "rangeOffset"
+    // and "rangeLength" if the latter is not negative. The segment is
+    // AES-128 decrypted if "key" is not NULL. Returns the generation the
+    // notifications for this segment will carry.
+    int32_t fetch(
+            int32_t seqNumber, const AString &uri,
+            int64_t rangeOffset, int64_t rangeLength,
+            const sp<ABuffer> &key, const sp<ABuffer> &iv);
+
+    // Abandons the current download, no further notifications are sent for
+    // it and its chunks go back to the data source.
+    void cancel();
+
+    // Set while the segment is the one being read, it may then use the
+    // chunks held back for it.
+    void setPriority(bool priority);
+
+protected:
+    virtual ~SegmentFetcher();
+
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
+private:
+    enum {
+        kWhatFetch  = 'fetc',
+    };
+
+    enum {
+        // How long to wait for a free chunk before checking for
+        // cancellation again.
+        kChunkWaitUs = 20000,
+    };
+
+    sp<AMessage> mNotify;
+    sp<LiveDataSource> mDataSource;
+    sp<HTTPBase> mHTTPDataSource;
+    KeyedVector<String8, String8> mExtraHeaders;
+
+    Mutex mLock;
+    int32_t mGeneration;
+    bool mPriority;
+
+    void onFetch(const sp<AMessage> &msg);
+
+    status_t openSource(
+            const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+            sp<DataSource> *source, off64_t *offset);
+
+    sp<ABuffer> acquireChunk(int32_t generation, bool *throttled);
+    bool isCancelled(int32_t generation);
+
+    void postChunk(
+            int32_t seqNumber, int32_t generation, const sp<ABuffer> &chunk);
+
+    void releaseChunk(sp<ABuffer> *chunk);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentFetcher);
+};
+
+}  // namespace android
+
+#endif  // SEGMENT_FETCHER_H_
@@ -0,0 +1,64 @@
+# Build the unit tests.
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := LiveSession_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	LiveSession_test.cpp \
+	HLSTestServer.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcrypto \
+	libssl \
+	libstagefright \
+	libstagefright_foundation \
+	libstlport \
+	libutils \
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_httplive \
+	libgtest \
+	libgtest_main \
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/gtest/include \
+	external/openssl/include \
+	external/stlport/stlport \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax \
+
+LOCAL_CFLAGS += -Wno-multichar
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        hls_session_bench.cpp   \
+        HLSTestServer.cpp       \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation libcrypto libssl
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_httplive
+
+LOCAL_C_INCLUDES:= \
+	external/openssl/include \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS += -Wno-multichar
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= hls_session_bench
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "HLSTestServer"
+#include <utils/Log.h>
+
+#include "HLSTestServer.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <openssl/aes.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace android {
+
+static const char *kKeyURL = "http://hls.test/key.bin";
+
+static const uint8_t kKey[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+const char *HLSTestServer::kMasterURL = "http://hls.test/master.m3u8";
+const char *HLSTestServer::kMediaURL = "http://hls.test/v0/index.m3u8";
+
+HLSTestServer::Params::Params()
+    : mNumVariants(1),
+      mNumSegments(10),
+      mSegmentDurationUs(10000000ll),
+      mPacketsPerSegment(100),
+      mEncrypt(false),
+      mByteRanges(false),
+      mDiscontinuitySeq(-1),
+      mLive(false),
+      mLiveWindowSize(3),
+      mLiveNeverEnds(false) {
+    for (size_t i = 0; i < kMaxNumVariants; ++i) {
+        mBandwidths[i] = 200000ul << (2 * i);
+    }
+}
+
+HLSTestServer::LinkParams::LinkParams()
+    : mLatencyUs(0),
+      mRateBps(0) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// One connection, LiveSession makes one of these per download in flight.
+struct HLSTestServer::Source : public HTTPBase {
+    Source(const sp<HLSTestServer> &server)
+        : mServer(server),
+          mOffset(0),
+          mLength(0),
+          mActive(false),
+          mAborted(false) {
+    }
+
+    virtual status_t initCheck() const {
+        return mFile != NULL ? OK : NO_INIT;
+    }
+
+    virtual status_t connect(
+            const char *uri,
+            const KeyedVector<String8, String8> *headers,
+            off64_t offset) {
+        finish();
+
+        mAborted = false;
+        mFile.clear();
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mActive = true;
+        }
+
+        int64_t latencyUs = mServer->onConnect(uri);
+
+        if (!mServer->sleepUs(latencyUs, &mAborted)) {
+            finish();
+            return ERROR_IO;
+        }
+
+        sp<ABuffer> file = mServer->findFile(uri);
+        if (file == NULL) {
+            finish();
+            return ERROR_IO;
+        }
+
+        int64_t start = offset;
+        int64_t length = (int64_t)file->size() - offset;
+
+        ssize_t index =
+            headers != NULL ? headers->indexOfKey(String8("Range")) : -1;
+
+        if (index >= 0) {
+            const char *range = headers->valueAt(index).string();
+
+            long long first, last;
+            if (sscanf(range, "bytes=%lld-%lld", &first, &last) == 2) {
+                start = first;
+                length = last + 1 - first;
+            } else if (sscanf(range, "bytes=%lld-", &first) == 1) {
+                start = first;
+                length = (int64_t)file->size() - first;
+            } else {
+                finish();
+                return ERROR_MALFORMED;
+            }
+        }
+
+        if (start < 0 || length < 0
+                || start + length > (int64_t)file->size()) {
+            finish();
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        mFile = file;
+        mOffset = start;
+        mLength = length;
+
+        return OK;
+    }
+
+    virtual void disconnect() {
+        mAborted = true;
+        finish();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (mAborted || mFile == NULL) {
+            return ERROR_IO;
+        }
+
+        if (offset >= mLength) {
+            finish();
+            return 0;
+        }
+
+        // Small writes so that concurrent connections share the link.
+        static const size_t kMaxWriteSize = 8192;
+
+        size_t n = size;
+        if (n > kMaxWriteSize) {
+            n = kMaxWriteSize;
+        }
+        if ((off64_t)n > mLength - offset) {
+            n = mLength - offset;
+        }
+
+        if (!mServer->transfer(n, &mAborted)) {
+            return ERROR_IO;
+        }
+
+        memcpy(data, mFile->data() + mOffset + offset, n);
+
+        if (offset + (off64_t)n == mLength) {
+            finish();
+        }
+
+        return n;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        if (mFile == NULL) {
+            return NO_INIT;
+        }
+
+        *size = mLength;
+        return OK;
+    }
+
+protected:
+    virtual ~Source() {
+        finish();
+    }
+
+private:
+    sp<HLSTestServer> mServer;
+
+    sp<ABuffer> mFile;
+    off64_t mOffset;
+    off64_t mLength;
+
+    Mutex mLock;
+    bool mActive;
+    volatile bool mAborted;
+
+    // A connection counts as active until all of it has been read, or
+    // until it is dropped.
+    void finish() {
+        Mutex::Autolock autoLock(mLock);
+
+        if (mActive) {
+            mActive = false;
+            mServer->onTransferDone();
+        }
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Source);
+};
+
+struct HLSTestServer::Session : public LiveSession {
+    Session(const sp<HLSTestServer> &server)
+        : mServer(server) {
+    }
+
+protected:
+    virtual sp<HTTPBase> createHTTPDataSource() {
+        return new Source(mServer);
+    }
+
+private:
+    sp<HLSTestServer> mServer;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Session);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+HLSTestServer::HLSTestServer(const Params &params, const LinkParams &link)
+    : mParams(params),
+      mLink(link),
+      mLinkFreeUs(0),
+      mStartTimeUs(ALooper::GetNowUs()) {
+    CHECK_GE(mParams.mNumVariants, 1u);
+    CHECK_LE(mParams.mNumVariants, (size_t)kMaxNumVariants);
+    CHECK(!mParams.mLive || mParams.mLiveWindowSize >= 1);
+
+    memset(&mStats, 0, sizeof(mStats));
+
+    generate();
+}
+
+HLSTestServer::~HLSTestServer() {
+}
+
+void HLSTestServer::setLink(const LinkParams &link) {
+    Mutex::Autolock autoLock(mLock);
+    mLink = link;
+}
+
+HLSTestServer::Stats HLSTestServer::stats() {
+    Mutex::Autolock autoLock(mLock);
+    return mStats;
+}
+
+Vector<int64_t> HLSTestServer::playlistRequestTimes() {
+    Mutex::Autolock autoLock(mLock);
+    return mPlaylistRequestTimesUs;
+}
+
+sp<LiveSession> HLSTestServer::createSession() {
+    return new Session(this);
+}
+
+// static
+void HLSTestServer::MakePacket(
+        size_t variant, int32_t seqNumber, size_t index, uint8_t *data) {
+    memset(data, 0xff, 188);
+
+    data[0] = 0x47;
+    data[1] = variant;
+    data[2] = seqNumber >> 24;
+    data[3] = (seqNumber >> 16) & 0xff;
+    data[4] = (seqNumber >> 8) & 0xff;
+    data[5] = seqNumber & 0xff;
+    data[6] = index >> 24;
+    data[7] = (index >> 16) & 0xff;
+    data[8] = (index >> 8) & 0xff;
+    data[9] = index & 0xff;
+}
+
+// static
+bool HLSTestServer::ParsePacket(
+        const uint8_t *data,
+        size_t *variant, int32_t *seqNumber, size_t *index) {
+    if (data[0] != 0x47) {
+        return false;
+    }
+
+    for (size_t i = 10; i < 188; ++i) {
+        if (data[i] != 0xff) {
+            return false;
+        }
+    }
+
+    *variant = data[1];
+    *seqNumber = data[2] << 24 | data[3] << 16 | data[4] << 8 | data[5];
+    *index = data[6] << 24 | data[7] << 16 | data[8] << 8 | data[9];
+
+    return true;
+}
+
+// static
+bool HLSTestServer::IsDiscontinuity(const uint8_t *data) {
+    for (size_t i = 0; i < 188; ++i) {
+        if (data[i] != (i == 1 ? 1 : 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void HLSTestServer::addFile(const AString &url, const AString &data) {
+    sp<ABuffer> buffer = new ABuffer(data.size());
+    memcpy(buffer->data(), data.c_str(), data.size());
+
+    addFile(url, buffer);
+}
+
+void HLSTestServer::addFile(const AString &url, const sp<ABuffer> &data) {
+    mFiles.add(url, data);
+}
+
+sp<ABuffer> HLSTestServer::makeSegment(size_t variant, int32_t seqNumber) {
+    sp<ABuffer> segment = new ABuffer(mParams.mPacketsPerSegment * 188);
+
+    for (size_t i = 0; i < mParams.mPacketsPerSegment; ++i) {
+        MakePacket(variant, seqNumber, i, segment->data() + i * 188);
+    }
+
+    return segment;
+}
+
+void HLSTestServer::encryptSegment(sp<ABuffer> *segment, const uint8_t *iv) {
+    size_t size = (*segment)->size();
+    size_t pad = 16 - size % 16;
+
+    sp<ABuffer> encrypted = new ABuffer(size + pad);
+    memcpy(encrypted->data(), (*segment)->data(), size);
+    memset(encrypted->data() + size, pad, pad);
+
+    AES_KEY aesKey;
+    CHECK_EQ(AES_set_encrypt_key(kKey, 128, &aesKey), 0);
+
+    uint8_t ivec[16];
+    memcpy(ivec, iv, sizeof(ivec));
+
+    AES_cbc_encrypt(
+            encrypted->data(), encrypted->data(), encrypted->size(),
+            &aesKey, ivec, AES_ENCRYPT);
+
+    *segment = encrypted;
+}
+
+void HLSTestServer::generate() {
+    if (mParams.mEncrypt) {
+        sp<ABuffer> key = new ABuffer(sizeof(kKey));
+        memcpy(key->data(), kKey, sizeof(kKey));
+        addFile(kKeyURL, key);
+    }
+
+    if (mParams.mNumVariants > 1) {
+        AString master = "#EXTM3U\n";
+        for (size_t v = 0; v < mParams.mNumVariants; ++v) {
+            master.append(
+                    StringPrintf(
+                        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=%lu\n"
+                        "v%d/index.m3u8\n",
+                        mParams.mBandwidths[v], v));
+        }
+
+        addFile(kMasterURL, master);
+    }
+
+    for (size_t v = 0; v < mParams.mNumVariants; ++v) {
+        sp<ABuffer> all;
+        if (mParams.mByteRanges) {
+            all = new ABuffer(
+                    mParams.mNumSegments * (mParams.mPacketsPerSegment * 188 + 16));
+            all->setRange(0, 0);
+        }
+
+        for (size_t i = 0; i < mParams.mNumSegments; ++i) {
+            int32_t seqNumber = i;
+            AString entry;
+
+            sp<ABuffer> segment = makeSegment(v, seqNumber);
+
+            if (mParams.mEncrypt) {
+                uint8_t iv[16];
+                memset(iv, 0, sizeof(iv));
+
+                if (seqNumber & 1) {
+                    AString ivString = "0x";
+                    for (size_t j = 0; j < 16; ++j) {
+                        iv[j] = j * 17 + seqNumber;
+                        ivString.append(StringPrintf("%02X", iv[j]));
+                    }
+
+                    entry.append(
+                            StringPrintf(
+                                "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=%s\n",
+                                kKeyURL, ivString.c_str()));
+                } else {
+                    iv[12] = seqNumber >> 24;
+                    iv[13] = (seqNumber >> 16) & 0xff;
+                    iv[14] = (seqNumber >> 8) & 0xff;
+                    iv[15] = seqNumber & 0xff;
+
+                    entry.append(
+                            StringPrintf("#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n",
+                                         kKeyURL));
+                }
+
+                encryptSegment(&segment, iv);
+            }
+
+            if (seqNumber == mParams.mDiscontinuitySeq) {
+                entry.append("#EXT-X-DISCONTINUITY\n");
+            }
+
+            entry.append(
+                    StringPrintf("#EXTINF:%.3f,\n",
+                                 mParams.mSegmentDurationUs / 1E6));
+
+            if (mParams.mByteRanges) {
+                entry.append(
+                        StringPrintf("#EXT-X-BYTERANGE:%d@%d\n",
+                                     segment->size(), all->size()));
+                entry.append("all.ts\n");
+
+                memcpy(all->data() + all->size(),
+                       segment->data(), segment->size());
+                all->setRange(0, all->size() + segment->size());
+            } else {
+                entry.append(StringPrintf("seg%d.ts\n", seqNumber));
+                addFile(StringPrintf("http://hls.test/v%d/seg%d.ts", v, seqNumber),
+                        segment);
+            }
+
+            mPlaylistEntries[v].push(entry);
+        }
+
+        if (all != NULL) {
+            addFile(StringPrintf("http://hls.test/v%d/all.ts", v), all);
+        }
+
+        // Live playlists are made up as they are requested.
+        if (!mParams.mLive) {
+            addFile(StringPrintf("http://hls.test/v%d/index.m3u8", v),
+                    makePlaylist(v, mParams.mNumSegments));
+        }
+    }
+}
+
+size_t HLSTestServer::countPublishedSegments(int64_t nowUs) const {
+    if (!mParams.mLive) {
+        return mParams.mNumSegments;
+    }
+
+    size_t n = mParams.mLiveWindowSize
+        + (nowUs - mStartTimeUs) / mParams.mSegmentDurationUs;
+
+    return n < mParams.mNumSegments ? n : mParams.mNumSegments;
+}
+
+AString HLSTestServer::makePlaylist(size_t variant, size_t numPublished) const {
+    size_t first = 0;
+    if (mParams.mLive && numPublished > mParams.mLiveWindowSize) {
+        first = numPublished - mParams.mLiveWindowSize;
+    }
+
+    int64_t targetDurationSecs = (mParams.mSegmentDurationUs + 999999) / 1000000;
+
+    AString playlist = "#EXTM3U\n";
+    playlist.append(
+            StringPrintf("#EXT-X-TARGETDURATION:%lld\n", targetDurationSecs));
+    playlist.append(StringPrintf("#EXT-X-MEDIA-SEQUENCE:%d\n", first));
+
+    if (mParams.mEncrypt) {
+        playlist.append(
+                StringPrintf("#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n",
+                             kKeyURL));
+    }
+
+    for (size_t i = first; i < numPublished; ++i) {
+        playlist.append(mPlaylistEntries[variant].itemAt(i));
+    }
+
+    if (numPublished == mParams.mNumSegments
+            && !(mParams.mLive && mParams.mLiveNeverEnds)) {
+        playlist.append("#EXT-X-ENDLIST\n");
+    }
+
+    return playlist;
+}
+
+sp<ABuffer> HLSTestServer::findFile(const char *url) {
+    if (mParams.mLive) {
+        for (size_t v = 0; v < mParams.mNumVariants; ++v) {
+            if (StringPrintf("http://hls.test/v%d/index.m3u8", v) == url) {
+                AString playlist = makePlaylist(
+                        v, countPublishedSegments(ALooper::GetNowUs()));
+
+                sp<ABuffer> buffer = new ABuffer(playlist.size());
+                memcpy(buffer->data(), playlist.c_str(), playlist.size());
+
+                return buffer;
+            }
+        }
+    }
+
+    ssize_t index = mFiles.indexOfKey(AString(url));
+
+    if (index < 0) {
+        ALOGW("404 '%s'", url);
+        return NULL;
+    }
+
+    return mFiles.valueAt(index);
+}
+
+bool HLSTestServer::sleepUs(int64_t delayUs, const volatile bool *aborted) {
+    int64_t untilUs = ALooper::GetNowUs() + delayUs;
+
+    for (;;) {
+        if (*aborted) {
+            return false;
+        }
+
+        int64_t nowUs = ALooper::GetNowUs();
+        if (nowUs >= untilUs) {
+            return true;
+        }
+
+        int64_t sliceUs = untilUs - nowUs;
+        if (sliceUs > 2000) {
+            sliceUs = 2000;
+        }
+
+        usleep(sliceUs);
+    }
+}
+
+bool HLSTestServer::transfer(size_t numBytes, const volatile bool *aborted) {
+    int64_t doneUs;
+
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        mStats.mNumBytesServed += numBytes;
+
+        if (mLink.mRateBps <= 0) {
+            return !*aborted;
+        }
+
+        int64_t nowUs = ALooper::GetNowUs();
+        int64_t startUs = mLinkFreeUs > nowUs ? mLinkFreeUs : nowUs;
+
+        doneUs = startUs + numBytes * 8000000ll / mLink.mRateBps;
+        mLinkFreeUs = doneUs;
+    }
+
+    return sleepUs(doneUs - ALooper::GetNowUs(), aborted);
+}
+
+int64_t HLSTestServer::onConnect(const AString &url) {
+    Mutex::Autolock autoLock(mLock);
+
+    ++mStats.mNumRequests;
+    if (url.endsWith("/index.m3u8")) {
+        ++mStats.mNumPlaylistRequests;
+        mPlaylistRequestTimesUs.push(ALooper::GetNowUs());
+    } else if (!url.endsWith(".m3u8") && !(url == kKeyURL)) {
+        ++mStats.mNumSegmentRequests;
+    }
+
+    if (++mStats.mNumActive > mStats.mMaxActive) {
+        mStats.mMaxActive = mStats.mNumActive;
+    }
+
+    return mLink.mLatencyUs;
+}
+
+void HLSTestServer::onTransferDone() {
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK_GT(mStats.mNumActive, 0u);
+    --mStats.mNumActive;
+}
+
+}  // namespace android
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HLS_TEST_SERVER_H_
+
+#define HLS_TEST_SERVER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/KeyedVector.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include "include/HTTPBase.h"
+#include "include/LiveSession.h"
+
+namespace android {
+
+struct ABuffer;
+
+// Serves an HLS presentation from memory over a simulated link, so that
+// LiveSession can be exercised without a network. Every segment is a run of
+// 188 byte packets laid out as
+//
+//   [0x47][variant][seqNumber, 32 bit BE][packet index, 32 bit BE][0xff...]
+//
+// which lets a reader check exactly which segments it was handed, in which
+// order and from which variant.
+struct HLSTestServer : public RefBase {
+    enum {
+        kMaxNumVariants = 4,
+    };
+
+    struct Params {
+        Params();
+
+        // The master playlist lists this many variants at the given
+        // bandwidths, with a single variant there is no master playlist and
+        // kMediaURL is the media playlist.
+        size_t mNumVariants;
+        unsigned long mBandwidths[kMaxNumVariants];
+
+        size_t mNumSegments;
+        int64_t mSegmentDurationUs;
+        size_t mPacketsPerSegment;
+
+        // AES-128 encrypts every segment. Odd segments carry an explicit
+        // IV, the others use their sequence number.
+        bool mEncrypt;
+
+        // Serves all segments of a variant from one file using
+        // EXT-X-BYTERANGE.
+        bool mByteRanges;
+
+        // Tags this sequence number with EXT-X-DISCONTINUITY, if >= 0.
+        int32_t mDiscontinuitySeq;
+
+        // Serves a live event instead of a complete presentation. The media
+        // playlist lists a window of mLiveWindowSize segments which moves on
+        // by one segment every mSegmentDurationUs from construction, and
+        // gets its EXT-X-ENDLIST once all mNumSegments are out, unless
+        // mLiveNeverEnds, in which case it just stops changing.
+        bool mLive;
+        size_t mLiveWindowSize;
+        bool mLiveNeverEnds;
+    };
+
+    // Time spent on every connect and the rate, in bits per second, of
+    // the link all connections share. 0 means unlimited.
+    struct LinkParams {
+        LinkParams();
+
+        int64_t mLatencyUs;
+        int64_t mRateBps;
+    };
+
+    struct Stats {
+        size_t mNumRequests;
+        size_t mNumSegmentRequests;
+        size_t mNumPlaylistRequests;
+        size_t mNumActive;
+        size_t mMaxActive;
+        size_t mNumBytesServed;
+    };
+
+    static const char *kMasterURL;
+    static const char *kMediaURL;
+
+    HLSTestServer(const Params &params, const LinkParams &link);
+
+    void setLink(const LinkParams &link);
+
+    Stats stats();
+
+    // When every media playlist request so far was made.
+    Vector<int64_t> playlistRequestTimes();
+
+    // A LiveSession fetching everything from this server.
+    sp<LiveSession> createSession();
+
+    // What a reader should find in packet "index" of segment "seqNumber".
+    static void MakePacket(
+            size_t variant, int32_t seqNumber, size_t index, uint8_t *data);
+
+    // Parses a packet built by MakePacket(), returns false for anything
+    // else, including the discontinuity marker.
+    static bool ParsePacket(
+            const uint8_t *data,
+            size_t *variant, int32_t *seqNumber, size_t *index);
+
+    static bool IsDiscontinuity(const uint8_t *data);
+
+protected:
+    virtual ~HLSTestServer();
+
+private:
+    struct Source;
+    struct Session;
+
+    Params mParams;
+
+    Mutex mLock;
+    LinkParams mLink;
+    int64_t mLinkFreeUs;
+    Stats mStats;
+    Vector<int64_t> mPlaylistRequestTimesUs;
+
+    int64_t mStartTimeUs;
+    KeyedVector<AString, sp<ABuffer> > mFiles;
+
+    // The lines every segment adds to the media playlist of a variant.
+    Vector<AString> mPlaylistEntries[kMaxNumVariants];
+
+    void addFile(const AString &url, const AString &data);
+    void addFile(const AString &url, const sp<ABuffer> &data);
+
+    void generate();
+    sp<ABuffer> makeSegment(size_t variant, int32_t seqNumber);
+    void encryptSegment(sp<ABuffer> *segment, const uint8_t *iv);
+
+    size_t countPublishedSegments(int64_t nowUs) const;
+    AString makePlaylist(size_t variant, size_t numPublished) const;
+
+    sp<ABuffer> findFile(const char *url);
+
+    // Blocks for as long as sending "numBytes" takes on the shared link,
+    // returns false if "aborted" got set meanwhile.
+    bool transfer(size_t numBytes, const volatile bool *aborted);
+    bool sleepUs(int64_t delayUs, const volatile bool *aborted);
+
+    // Returns the latency of the new connection.
+    int64_t onConnect(const AString &url);
+    void onTransferDone();
+
+    DISALLOW_EVIL_CONSTRUCTORS(HLSTestServer);
+};
+
+}  // namespace android
+
+#endif  // HLS_TEST_SERVER_H_
@@ -0,0 +1,725 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "LiveSession_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/LiveSession.h"
+#include "include/M3UParser.h"
+#include "httplive/LiveDataSource.h"
+#include "HLSTestServer.h"
+
+namespace android {
+
+struct Packet {
+    bool mDiscontinuity;
+    size_t mVariant;
+    int32_t mSeqNumber;
+    size_t mIndex;
+};
+
+// Reads whole packets off "source" until it ends or "maxPackets" have been
+// read, returns the final read result.
+static ssize_t ReadPackets(
+        const sp<DataSource> &source, off64_t *offset,
+        Vector<Packet> *packets, size_t maxPackets = 0) {
+    uint8_t data[188];
+
+    for (;;) {
+        if (maxPackets > 0 && packets->size() >= maxPackets) {
+            return OK;
+        }
+
+        ssize_t n = source->readAt(*offset, data, sizeof(data));
+
+        if (n <= 0) {
+            return n;
+        }
+
+        if (n != (ssize_t)sizeof(data)) {
+            ADD_FAILURE() << "short read of " << n << " bytes";
+            return ERROR_MALFORMED;
+        }
+
+        *offset += n;
+
+        Packet packet;
+        packet.mDiscontinuity = HLSTestServer::IsDiscontinuity(data);
+
+        if (!packet.mDiscontinuity
+                && !HLSTestServer::ParsePacket(
+                    data, &packet.mVariant, &packet.mSeqNumber,
+                    &packet.mIndex)) {
+            ADD_FAILURE() << "corrupt packet at offset " << *offset - n;
+            return ERROR_MALFORMED;
+        }
+
+        packets->push(packet);
+    }
+}
+
+// Checks that "packets" holds every packet of segments "firstSeq" and up,
+// in order, with discontinuity markers only between segments.
+static void ExpectSegments(
+        const Vector<Packet> &packets, size_t packetsPerSegment,
+        int32_t firstSeq, size_t numSegments) {
+    int32_t seqNumber = firstSeq;
+    size_t index = 0;
+
+    for (size_t i = 0; i < packets.size(); ++i) {
+        const Packet &packet = packets.itemAt(i);
+
+        if (packet.mDiscontinuity) {
+            EXPECT_EQ(0u, index) << "marker inside segment " << seqNumber;
+            continue;
+        }
+
+        ASSERT_EQ(seqNumber, packet.mSeqNumber) << "at packet " << i;
+        ASSERT_EQ(index, packet.mIndex) << "at packet " << i;
+
+        if (++index == packetsPerSegment) {
+            index = 0;
+            ++seqNumber;
+        }
+    }
+
+    EXPECT_EQ(0u, index);
+    EXPECT_EQ(firstSeq + (int32_t)numSegments, seqNumber);
+}
+
+static size_t CountDiscontinuities(const Vector<Packet> &packets) {
+    size_t n = 0;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (packets.itemAt(i).mDiscontinuity) {
+            ++n;
+        }
+    }
+
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class M3UParserTest : public ::testing::Test {
+protected:
+    sp<M3UParser> parse(const char *baseURI, const char *text) {
+        return new M3UParser(baseURI, text, strlen(text));
+    }
+};
+
+TEST_F(M3UParserTest, MediaPlaylist) {
+    static const char *kPlaylist =
+        "#EXTM3U\n"
+        "#EXT-X-TARGETDURATION:10\r\n"
+        "#EXT-X-MEDIA-SEQUENCE:7\n"
+        "#EXT-X-KEY:METHOD=AES-128,URI=\"keys/k1\",IV=0x000102030405060708090a0b0c0d0e0f\n"
+        "#EXTINF:9.5,\n"
+        "#EXT-X-BYTERANGE:1000@200\n"
+        "media.ts\n"
+        "#EXT-X-DISCONTINUITY\n"
+        "#EXTINF:10,\n"
+        "#EXT-X-BYTERANGE:500\n"
+        "media.ts\n"
+        "#EXTINF:4,\n"
+        "/abs/last.ts\n"
+        "#EXT-X-ENDLIST\n";
+
+    sp<M3UParser> parser =
+        parse("http://host/path/index.m3u8?token=a/b", kPlaylist);
+
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    EXPECT_FALSE(parser->isVariantPlaylist());
+    EXPECT_TRUE(parser->isComplete());
+    ASSERT_EQ(3u, parser->size());
+
+    int32_t x;
+    ASSERT_TRUE(parser->meta()->findInt32("target-duration", &x));
+    EXPECT_EQ(10, x);
+    ASSERT_TRUE(parser->meta()->findInt32("media-sequence", &x));
+    EXPECT_EQ(7, x);
+
+    AString uri;
+    sp<AMessage> meta;
+    int64_t durationUs, offset, length;
+    AString s;
+
+    ASSERT_TRUE(parser->itemAt(0, &uri, &meta));
+    EXPECT_STREQ("http://host/path/media.ts", uri.c_str());
+    ASSERT_TRUE(meta->findInt64("durationUs", &durationUs));
+    EXPECT_EQ(9500000ll, durationUs);
+    ASSERT_TRUE(meta->findInt64("range-offset", &offset));
+    ASSERT_TRUE(meta->findInt64("range-length", &length));
+    EXPECT_EQ(200, offset);
+    EXPECT_EQ(1000, length);
+    ASSERT_TRUE(meta->findString("cipher-method", &s));
+    EXPECT_STREQ("AES-128", s.c_str());
+    ASSERT_TRUE(meta->findString("cipher-uri", &s));
+    EXPECT_STREQ("http://host/path/keys/k1", s.c_str());
+    ASSERT_TRUE(meta->findString("cipher-iv", &s));
+    EXPECT_STREQ("0x000102030405060708090a0b0c0d0e0f", s.c_str());
+    EXPECT_FALSE(meta->findInt32("discontinuity", &x));
+
+    ASSERT_TRUE(parser->itemAt(1, &uri, &meta));
+    ASSERT_TRUE(meta->findInt32("discontinuity", &x));
+    EXPECT_NE(0, x);
+    ASSERT_TRUE(meta->findInt64("range-offset", &offset));
+    ASSERT_TRUE(meta->findInt64("range-length", &length));
+    EXPECT_EQ(1200, offset);
+    EXPECT_EQ(500, length);
+    EXPECT_FALSE(meta->findString("cipher-method", &s));
+
+    ASSERT_TRUE(parser->itemAt(2, &uri, &meta));
+    EXPECT_STREQ("http://host/abs/last.ts", uri.c_str());
+    EXPECT_FALSE(meta->findInt64("range-offset", &offset));
+}
+
+TEST_F(M3UParserTest, VariantPlaylist) {
+    static const char *kPlaylist =
+        "#EXTM3U\n"
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,CODECS=\"avc1.4d401e,mp4a.40.2\",BANDWIDTH=1280000\n"
+        "hi/index.m3u8\n"
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=240000\n"
+        "http://other/lo.m3u8\n";
+
+    sp<M3UParser> parser = parse("http://host/live/master.m3u8", kPlaylist);
+
+    ASSERT_EQ((status_t)OK, parser->initCheck());
+    EXPECT_TRUE(parser->isVariantPlaylist());
+    ASSERT_EQ(2u, parser->size());
+
+    AString uri;
+    sp<AMessage> meta;
+    int32_t bandwidth;
+
+    ASSERT_TRUE(parser->itemAt(0, &uri, &meta));
+    EXPECT_STREQ("http://host/live/hi/index.m3u8", uri.c_str());
+    ASSERT_TRUE(meta->findInt32("bandwidth", &bandwidth));
+    EXPECT_EQ(1280000, bandwidth);
+
+    ASSERT_TRUE(parser->itemAt(1, &uri, &meta));
+    EXPECT_STREQ("http://other/lo.m3u8", uri.c_str());
+    ASSERT_TRUE(meta->findInt32("bandwidth", &bandwidth));
+    EXPECT_EQ(240000, bandwidth);
+}
+
+TEST_F(M3UParserTest, RejectsSegmentWithoutDuration) {
+    sp<M3UParser> parser = parse(
+            "http://host/index.m3u8",
+            "#EXTM3U\n#EXT-X-TARGETDURATION:10\nmedia.ts\n");
+
+    EXPECT_NE((status_t)OK, parser->initCheck());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class LiveDataSourceTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mSource = new LiveDataSource(4 * LiveDataSource::kChunkSize);
+    }
+
+    sp<ABuffer> fill(const sp<ABuffer> &chunk, uint8_t first, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            chunk->data()[i] = first + i;
+        }
+        chunk->setRange(0, size);
+
+        return chunk;
+    }
+
+    sp<LiveDataSource> mSource;
+};
+
+TEST_F(LiveDataSourceTest, HoldsChunksBackForPriorityDownloads) {
+    ASSERT_EQ(4u, mSource->countChunks());
+    EXPECT_EQ(4u, mSource->countFreeChunks());
+
+    sp<ABuffer> chunks[4];
+    for (size_t i = 0; i < 3; ++i) {
+        chunks[i] = mSource->acquireChunk(false, 0);
+        ASSERT_TRUE(chunks[i] != NULL);
+        EXPECT_EQ((size_t)LiveDataSource::kChunkSize, chunks[i]->capacity());
+        EXPECT_EQ(0u, chunks[i]->size());
+    }
+
+    // The last one is kept for the segment being read.
+    EXPECT_TRUE(mSource->acquireChunk(false, 0) == NULL);
+    EXPECT_TRUE(mSource->acquireChunk(false, 10000) == NULL);
+
+    chunks[3] = mSource->acquireChunk(true, 0);
+    ASSERT_TRUE(chunks[3] != NULL);
+    EXPECT_TRUE(mSource->acquireChunk(true, 0) == NULL);
+    EXPECT_EQ(0u, mSource->countFreeChunks());
+
+    mSource->releaseChunk(chunks[0]);
+    EXPECT_EQ(1u, mSource->countFreeChunks());
+    EXPECT_TRUE(chunks[0]->data() == mSource->acquireChunk(true, 0)->data());
+}
+
+TEST_F(LiveDataSourceTest, RecyclesChunksOnceRead) {
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 0, 100));
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 100, 50));
+    EXPECT_EQ(2u, mSource->countFreeChunks());
+
+    uint8_t data[120];
+    ASSERT_EQ(120, mSource->readAt(0, data, sizeof(data)));
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        ASSERT_EQ((uint8_t)i, data[i]);
+    }
+
+    // The first chunk is used up, the second still has 30 bytes left.
+    EXPECT_EQ(3u, mSource->countFreeChunks());
+
+    EXPECT_EQ(-EPIPE, mSource->readAt(0, data, 10));
+
+    ASSERT_EQ(30, mSource->readAtNonBlocking(120, data, sizeof(data)));
+    EXPECT_EQ(120, data[0]);
+    EXPECT_EQ(4u, mSource->countFreeChunks());
+
+    EXPECT_EQ(-EWOULDBLOCK, mSource->readAtNonBlocking(150, data, 10));
+}
+
+TEST_F(LiveDataSourceTest, EndOfStream) {
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 0, 10));
+    mSource->queueEOS(ERROR_END_OF_STREAM);
+
+    // Anything queued after the end is dropped.
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 0, 10));
+    EXPECT_EQ(3u, mSource->countFreeChunks());
+
+    uint8_t data[188];
+    EXPECT_EQ(10, mSource->readAt(0, data, sizeof(data)));
+    EXPECT_EQ(ERROR_END_OF_STREAM, mSource->readAt(10, data, sizeof(data)));
+    EXPECT_EQ(ERROR_END_OF_STREAM,
+              mSource->readAtNonBlocking(10, data, sizeof(data)));
+}
+
+TEST_F(LiveDataSourceTest, ResetDropsQueuedChunks) {
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 0, 10));
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 10, 10));
+    mSource->queueEOS(ERROR_END_OF_STREAM);
+
+    uint8_t data[5];
+    ASSERT_EQ(5, mSource->readAt(0, data, sizeof(data)));
+
+    mSource->reset();
+    EXPECT_EQ(4u, mSource->countFreeChunks());
+    EXPECT_EQ(0u, mSource->countQueuedBuffers());
+
+    // Reading starts over at offset 0.
+    mSource->queueBuffer(fill(mSource->acquireChunk(true, 0), 42, 5));
+    ASSERT_EQ(5, mSource->readAt(0, data, sizeof(data)));
+    EXPECT_EQ(42, data[0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class LiveSessionTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("live session");
+        mLooper->start();
+    }
+
+    virtual void TearDown() {
+        if (mSession != NULL) {
+            mSession->disconnect();
+
+            mLooper->unregisterHandler(mSession->id());
+            mSession.clear();
+        }
+
+        mLooper->stop();
+    }
+
+    void start(const HLSTestServer::Params &params,
+               const HLSTestServer::LinkParams &link,
+               size_t prefetchDepth = 2) {
+        mServer = new HLSTestServer(params, link);
+
+        mSession = mServer->createSession();
+        mSession->setPrefetchDepth(prefetchDepth);
+        mLooper->registerHandler(mSession);
+
+        mSession->connect(
+                params.mNumVariants > 1
+                    ? HLSTestServer::kMasterURL : HLSTestServer::kMediaURL);
+
+        mSource = mSession->getDataSource();
+        mOffset = 0;
+    }
+
+    sp<ALooper> mLooper;
+    sp<HLSTestServer> mServer;
+    sp<LiveSession> mSession;
+    sp<DataSource> mSource;
+    off64_t mOffset;
+};
+
+TEST_F(LiveSessionTest, PlaysSegmentsInOrder) {
+    HLSTestServer::Params params;
+    HLSTestServer::LinkParams link;
+    link.mLatencyUs = 5000;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+    EXPECT_EQ(0u, CountDiscontinuities(packets));
+
+    int64_t durationUs;
+    ASSERT_EQ((status_t)OK, mSession->getDuration(&durationUs));
+    EXPECT_EQ(params.mNumSegments * params.mSegmentDurationUs, durationUs);
+    EXPECT_TRUE(mSession->isSeekable());
+
+    EXPECT_EQ(params.mNumSegments, mServer->stats().mNumSegmentRequests);
+}
+
+TEST_F(LiveSessionTest, DownloadsSegmentsInParallel) {
+    HLSTestServer::Params params;
+    HLSTestServer::LinkParams link;
+    link.mLatencyUs = 50000;
+
+    start(params, link, 2);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+
+    HLSTestServer::Stats stats = mServer->stats();
+    EXPECT_GE(stats.mMaxActive, 2u);
+    EXPECT_LE(stats.mMaxActive, 3u);
+}
+
+TEST_F(LiveSessionTest, DownloadsSegmentsOneAtATimeWithoutPrefetch) {
+    HLSTestServer::Params params;
+    HLSTestServer::LinkParams link;
+    link.mLatencyUs = 20000;
+
+    start(params, link, 0);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+
+    EXPECT_EQ(1u, mServer->stats().mMaxActive);
+}
+
+TEST_F(LiveSessionTest, SwitchesVariantToMatchLink) {
+    HLSTestServer::Params params;
+    params.mNumVariants = 4;
+    params.mNumSegments = 16;
+    params.mPacketsPerSegment = 40;
+
+    // Variants at 200k, 800k, 3.2M and 12.8M, of which 800k fits into 80%
+    // of the link.
+    HLSTestServer::LinkParams link;
+    link.mRateBps = 2000000;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+
+    size_t lastVariant = 0;
+    bool markerSeen = false;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        const Packet &packet = packets.itemAt(i);
+
+        if (packet.mDiscontinuity) {
+            markerSeen = true;
+            continue;
+        }
+
+        EXPECT_LE(packet.mVariant, 1u);
+
+        if (packet.mVariant != lastVariant) {
+            EXPECT_TRUE(markerSeen) << "switch without a discontinuity";
+            lastVariant = packet.mVariant;
+        }
+
+        markerSeen = false;
+    }
+
+    EXPECT_EQ(1u, lastVariant);
+}
+
+TEST_F(LiveSessionTest, SeekRestartsAtSegment) {
+    HLSTestServer::Params params;
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    ASSERT_EQ((ssize_t)OK, ReadPackets(mSource, &mOffset, &packets, 150));
+    EXPECT_EQ(1, packets.itemAt(149).mSeqNumber);
+
+    mSession->seekTo(55000000ll);
+
+    packets.clear();
+    mOffset = 0;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+
+    ASSERT_FALSE(packets.isEmpty());
+    EXPECT_TRUE(packets.itemAt(0).mDiscontinuity);
+    EXPECT_EQ(1u, CountDiscontinuities(packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 5, 5);
+}
+
+TEST_F(LiveSessionTest, DecryptsSegments) {
+    HLSTestServer::Params params;
+    params.mEncrypt = true;
+
+    // Segments do not end on a chunk or an AES block boundary.
+    params.mPacketsPerSegment = 700;
+
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+}
+
+TEST_F(LiveSessionTest, FetchesByteRanges) {
+    HLSTestServer::Params params;
+    params.mByteRanges = true;
+    params.mEncrypt = true;
+
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+}
+
+TEST_F(LiveSessionTest, SignalsDiscontinuity) {
+    HLSTestServer::Params params;
+    params.mDiscontinuitySeq = 4;
+
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+
+    ASSERT_EQ(1u, CountDiscontinuities(packets));
+
+    size_t index = 4 * params.mPacketsPerSegment;
+    EXPECT_TRUE(packets.itemAt(index).mDiscontinuity);
+}
+
+TEST_F(LiveSessionTest, DisconnectEndsStream) {
+    HLSTestServer::Params params;
+    params.mPacketsPerSegment = 2000;
+
+    HLSTestServer::LinkParams link;
+    link.mRateBps = 4000000;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    ASSERT_EQ((ssize_t)OK, ReadPackets(mSource, &mOffset, &packets, 10));
+
+    int64_t startUs = ALooper::GetNowUs();
+    mSession->disconnect();
+
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+    EXPECT_LT(ALooper::GetNowUs() - startUs, 2000000ll);
+    EXPECT_LT(packets.size(), params.mNumSegments * params.mPacketsPerSegment);
+}
+
+TEST_F(LiveSessionTest, FailedMasterPlaylistEndsStream) {
+    HLSTestServer::Params params;
+    HLSTestServer::LinkParams link;
+
+    mServer = new HLSTestServer(params, link);
+    mSession = mServer->createSession();
+    mLooper->registerHandler(mSession);
+    mSession->connect("http://hls.test/missing.m3u8");
+
+    mSource = mSession->getDataSource();
+    mOffset = 0;
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_IO, ReadPackets(mSource, &mOffset, &packets));
+    EXPECT_TRUE(packets.isEmpty());
+}
+
+TEST_F(LiveSessionTest, FollowsGrowingLivePlaylist) {
+    HLSTestServer::Params params;
+    params.mLive = true;
+    params.mLiveWindowSize = 3;
+    params.mNumSegments = 10;
+    params.mSegmentDurationUs = 300000ll;
+
+    HLSTestServer::LinkParams link;
+    link.mLatencyUs = 50000;
+
+    int64_t startUs = ALooper::GetNowUs();
+    start(params, link);
+
+    int64_t durationUs;
+    ASSERT_EQ((status_t)OK, mSession->getDuration(&durationUs));
+    EXPECT_EQ(-1ll, durationUs);
+    EXPECT_FALSE(mSession->isSeekable());
+
+    Vector<Packet> packets;
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+    EXPECT_EQ(0u, CountDiscontinuities(packets));
+
+    // The last segment only shows up once the window has moved on seven
+    // times, which the session has to notice by reloading the playlist.
+    size_t numMoves = params.mNumSegments - params.mLiveWindowSize;
+    EXPECT_GE(ALooper::GetNowUs() - startUs,
+              (int64_t)numMoves * params.mSegmentDurationUs);
+
+    HLSTestServer::Stats stats = mServer->stats();
+    EXPECT_EQ(params.mNumSegments, stats.mNumSegmentRequests);
+
+    // The segments there from the start are prefetched.
+    EXPECT_GE(stats.mMaxActive, 2u);
+
+    // Reloads are paced by the segment duration, not by how often the
+    // queue is monitored.
+    EXPECT_GE(stats.mNumPlaylistRequests, 3u);
+    EXPECT_LE(stats.mNumPlaylistRequests, numMoves + 4);
+}
+
+TEST_F(LiveSessionTest, BacksOffWhileLivePlaylistIsUnchanged) {
+    HLSTestServer::Params params;
+    params.mLive = true;
+    params.mLiveWindowSize = 3;
+    params.mLiveNeverEnds = true;
+    params.mNumSegments = 3;
+    params.mSegmentDurationUs = 500000ll;
+
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    ASSERT_EQ((ssize_t)OK,
+              ReadPackets(mSource, &mOffset, &packets,
+                          params.mNumSegments * params.mPacketsPerSegment));
+    ExpectSegments(packets, params.mPacketsPerSegment, 0, params.mNumSegments);
+
+    usleep(3200000);
+
+    Vector<int64_t> timesUs = mServer->playlistRequestTimes();
+    ASSERT_GE(timesUs.size(), 2u);
+
+    // The first reload waits for the duration of the last segment (0.5s).
+#if defined(HAVE_ANDROID_OS)
+    // Every unchanged reload after that waits longer, for half the target
+    // duration (1s), then one and a half.
+    static const int64_t kIntervalsUs[] = { 500000ll, 500000ll, 1500000ll };
+#else
+    // Without MD5 every reload counts as changed.
+    static const int64_t kIntervalsUs[] = {
+        500000ll, 500000ll, 500000ll, 500000ll, 500000ll, 500000ll
+    };
+#endif
+    static const size_t kNumIntervals =
+        sizeof(kIntervalsUs) / sizeof(kIntervalsUs[0]);
+
+    ASSERT_EQ(kNumIntervals + 1, timesUs.size());
+
+    for (size_t i = 0; i < kNumIntervals; ++i) {
+        // Reloads are checked for every 100ms.
+        int64_t intervalUs = timesUs.itemAt(i + 1) - timesUs.itemAt(i);
+        EXPECT_GE(intervalUs, kIntervalsUs[i]) << "reload " << i + 1;
+        EXPECT_LT(intervalUs, kIntervalsUs[i] + 150000ll) << "reload " << i + 1;
+    }
+}
+
+TEST_F(LiveSessionTest, RejoinsLivePlaylistAfterFallingBehind) {
+    HLSTestServer::Params params;
+    params.mLive = true;
+    params.mLiveWindowSize = 3;
+    params.mNumSegments = 16;
+    params.mSegmentDurationUs = 200000ll;
+
+    // About 2MB per segment, so that a stalled reader fills the data
+    // source after a few of them and downloads stop.
+    params.mPacketsPerSegment = 10000;
+
+    HLSTestServer::LinkParams link;
+
+    start(params, link);
+
+    Vector<Packet> packets;
+    ASSERT_EQ((ssize_t)OK, ReadPackets(mSource, &mOffset, &packets, 10));
+
+    // Meanwhile the window moves on by ten segments, past whatever the
+    // session had buffered.
+    usleep(2000000);
+
+    EXPECT_EQ(ERROR_END_OF_STREAM, ReadPackets(mSource, &mOffset, &packets));
+
+    // All of what was buffered, then a discontinuity and a jump to the
+    // live edge as of the next reload.
+    ASSERT_EQ(1u, CountDiscontinuities(packets));
+
+    size_t marker = 0;
+    while (!packets.itemAt(marker).mDiscontinuity) {
+        ++marker;
+    }
+
+    ASSERT_GT(marker, 0u);
+    ASSERT_LT(marker + 1, packets.size());
+
+    Vector<Packet> before, after;
+    before.appendArray(packets.array(), marker);
+    after.appendArray(
+            packets.array() + marker + 1, packets.size() - marker - 1);
+
+    int32_t lastBefore = before.itemAt(before.size() - 1).mSeqNumber;
+    int32_t firstAfter = after.itemAt(0).mSeqNumber;
+
+    ExpectSegments(before, params.mPacketsPerSegment, 0, lastBefore + 1);
+    ExpectSegments(after, params.mPacketsPerSegment,
+                   firstAfter, params.mNumSegments - firstAfter);
+
+    EXPECT_GT(firstAfter, lastBefore + 1);
+    EXPECT_LT(firstAfter, (int32_t)params.mNumSegments);
+}
+
+}  // namespace android
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Plays an HLS presentation served over a simulated link of the given
+// per-request latency and shared rate, once for every prefetch depth, and
+// reports how long it takes to read it all and how often and for how long
+// the reader waited at a segment boundary. With -l the presentation is a
+// live event whose playlist grows by one segment every segment duration,
+// there the waits include those for the live edge and the number of
+// playlist reloads shows how the session paces them.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "hls_session_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/LiveSession.h"
+#include "HLSTestServer.h"
+
+using namespace android;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-r kbps] [-n segments] [-s packets] [-d ms] "
+            "[-l window] latencyMs...\n"
+            "       -r  link rate (default 20000)\n"
+            "       -n  number of segments (default 20)\n"
+            "       -s  188 byte packets per segment (default 400)\n"
+            "       -d  segment duration (default 10000)\n"
+            "       -l  play a live event listing this many segments at a "
+            "time\n", me);
+    exit(1);
+}
+
+// A wait for the first packet of a segment longer than this is a stall.
+static const int64_t kStallUs = 5000ll;
+
+static void runOne(
+        const HLSTestServer::Params &params, int64_t latencyUs,
+        int64_t rateBps, size_t prefetchDepth) {
+    HLSTestServer::LinkParams link;
+    link.mLatencyUs = latencyUs;
+    link.mRateBps = rateBps;
+
+    sp<HLSTestServer> server = new HLSTestServer(params, link);
+
+    sp<ALooper> looper = new ALooper;
+    looper->setName("live session");
+    looper->start();
+
+    sp<LiveSession> session = server->createSession();
+    session->setPrefetchDepth(prefetchDepth);
+    looper->registerHandler(session);
+
+    int64_t startUs = getNowUs();
+    session->connect(HLSTestServer::kMediaURL);
+
+    sp<DataSource> source = session->getDataSource();
+
+    int64_t firstPacketUs = -1;
+    size_t numStalls = 0;
+    int64_t stallUs = 0;
+
+    uint8_t data[188];
+    off64_t offset = 0;
+    int32_t lastSeqNumber = -1;
+    for (;;) {
+        int64_t readStartUs = getNowUs();
+        ssize_t n = source->readAt(offset, data, sizeof(data));
+        int64_t waitUs = getNowUs() - readStartUs;
+
+        if (n <= 0) {
+            CHECK_EQ(n, (ssize_t)ERROR_END_OF_STREAM);
+            break;
+        }
+
+        CHECK_EQ(n, (ssize_t)sizeof(data));
+        offset += n;
+
+        size_t variant, index;
+        int32_t seqNumber;
+        if (!HLSTestServer::ParsePacket(data, &variant, &seqNumber, &index)) {
+            continue;
+        }
+
+        if (firstPacketUs < 0) {
+            firstPacketUs = getNowUs() - startUs;
+        } else if (seqNumber != lastSeqNumber && waitUs > kStallUs) {
+            ++numStalls;
+            stallUs += waitUs;
+        }
+
+        lastSeqNumber = seqNumber;
+    }
+
+    int64_t totalUs = getNowUs() - startUs;
+
+    session->disconnect();
+    looper->unregisterHandler(session->id());
+    session.clear();
+    looper->stop();
+
+    HLSTestServer::Stats stats = server->stats();
+
+    printf("%8lld %6d %10.1f %10.1f %8d %10.1f %10d %8d\n",
+           latencyUs / 1000, prefetchDepth,
+           firstPacketUs / 1E3, totalUs / 1E3,
+           numStalls, stallUs / 1E3, stats.mMaxActive,
+           stats.mNumPlaylistRequests);
+}
+
+int main(int argc, char **argv) {
+    HLSTestServer::Params params;
+    params.mNumSegments = 20;
+    params.mPacketsPerSegment = 400;
+
+    int64_t rateBps = 20000000ll;
+
+    int res;
+    while ((res = getopt(argc, argv, "r:n:s:d:l:")) >= 0) {
+        switch (res) {
+            case 'r':
+                rateBps = atoll(optarg) * 1000ll;
+                break;
+
+            case 'n':
+                params.mNumSegments = atoi(optarg);
+                break;
+
+            case 's':
+                params.mPacketsPerSegment = atoi(optarg);
+                break;
+
+            case 'd':
+                params.mSegmentDurationUs = atoll(optarg) * 1000ll;
+                break;
+
+            case 'l':
+                params.mLive = true;
+                params.mLiveWindowSize = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (rateBps < 0 || params.mNumSegments == 0
+            || params.mPacketsPerSegment == 0
+            || params.mSegmentDurationUs <= 0
+            || (params.mLive && params.mLiveWindowSize == 0)) {
+        usage(argv[0]);
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    static const int64_t kDefaultLatenciesMs[] = { 20, 100, 250 };
+    static const size_t kPrefetchDepths[] = { 0, 1, 2, 4 };
+
+    Vector<int64_t> latencies;
+    if (argc == 0) {
+        latencies.appendArray(
+                kDefaultLatenciesMs,
+                sizeof(kDefaultLatenciesMs) / sizeof(kDefaultLatenciesMs[0]));
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            int64_t latencyMs = atoll(argv[i]);
+            if (latencyMs < 0) {
+                usage(argv[0]);
+            }
+            latencies.push(latencyMs);
+        }
+    }
+
+    printf("%8s %6s %10s %10s %8s %10s %10s %8s\n",
+           "rtt ms", "depth", "first ms", "total ms", "stalls", "stall ms",
+           "max conns", "reloads");
+
+    for (size_t i = 0; i < latencies.size(); ++i) {
+        for (size_t j = 0;
+             j < sizeof(kPrefetchDepths) / sizeof(kPrefetchDepths[0]); ++j) {
+            runOne(params, latencies.itemAt(i) * 1000ll, rateBps,
+                   kPrefetchDepths[j]);
+        }
+    }
+
+    return 0;
+}
@@ -25,6 +25,7 @@
 namespace android {
 
 struct AMessage;
+class AACFrameIndex;
 class String8;
 
 class AACExtractor : public MediaExtractor {
@@ -42,10 +43,15 @@ protected:
 
 private:
     sp<DataSource> mDataSource;
-    sp<MetaData> mMeta;
     status_t mInitCheck;
 
-    Vector<uint64_t> mOffsetVector;
+    enum {
+        // frames read at open to estimate the duration from the file size
+        kNumEstimateFrames = 64,
+    };
+
+    sp<AACFrameIndex> mFrameIndex;
+    off64_t mFirstFrameOffset;
     int64_t mFrameDurationUs;
 
     AACExtractor(const AACExtractor &);
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPCM_DECODER_H_
+
+#define ADPCM_DECODER_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Samples per channel a block of the given size can hold at most, 0 if
+// it can't even hold the block header.
+size_t MSADPCMMaxSamplesPerBlock(size_t blockAlign, size_t numChannels);
+size_t IMAADPCMMaxSamplesPerBlock(size_t blockAlign, size_t numChannels);
+
+// Decode numBlocks consecutive blocks of 4 bit Microsoft or IMA (DVI)
+// ADPCM, as stored in WAV files, to interleaved 16 bit samples. Each block
+// yields samplesPerBlock samples per channel, which must not be more than
+// the *MaxSamplesPerBlock() functions above allow for blockAlign.
+void DecodeMSADPCMBlocks(
+        int16_t *dst, const uint8_t *src, size_t numBlocks,
+        size_t blockAlign, size_t samplesPerBlock, size_t numChannels);
+
+void DecodeIMAADPCMBlocks(
+        int16_t *dst, const uint8_t *src, size_t numBlocks,
+        size_t blockAlign, size_t samplesPerBlock, size_t numChannels);
+
+}  // namespace android
+
+#endif  // ADPCM_DECODER_H_
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BACKGROUND_SCANNER_H_
+
+#define BACKGROUND_SCANNER_H_
+
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+// Base of the extractor indexes that fill themselves in by scanning the
+// stream on a thread of their own. The thread holds only a weak reference
+// between steps, so a scan never keeps its index alive: it ends once
+// nobody else holds a reference, or when scanStep() says it is done.
+class BackgroundScanner : public RefBase {
+protected:
+    BackgroundScanner() {}
+    virtual ~BackgroundScanner() {}
+
+    // Starts a detached thread calling scanStep(), name is only logged.
+    status_t startScanThread(const char *name);
+
+    // Called on the scan thread, which holds a strong reference meanwhile.
+    // Returns false once the scan is over.
+    virtual bool scanStep() = 0;
+
+private:
+    struct ThreadContext;
+
+    static void *ScanThread(void *me);
+
+    BackgroundScanner(const BackgroundScanner &);
+    BackgroundScanner &operator=(const BackgroundScanner &);
+};
+
+}  // namespace android
+
+#endif  // BACKGROUND_SCANNER_H_
@@ -24,12 +24,14 @@
 namespace android {
 
 class FLACParser;
+class FLACSeekIndex;
 
 class FLACExtractor : public MediaExtractor {
 
 public:
     // Extractor assumes ownership of source
-    FLACExtractor(const sp<DataSource> &source);
+    // Without the seek index all seeks are left to libFLAC
+    FLACExtractor(const sp<DataSource> &source, bool useSeekIndex = true);
 
     virtual size_t countTracks();
     virtual sp<MediaSource> getTrack(size_t index);
@@ -37,6 +39,10 @@ public:
 
     virtual sp<MetaData> getMetaData();
 
+    // Blocks until the seek index is done scanning the stream, if it does,
+    // and returns its number of entries
+    size_t waitForSeekIndex();
+
 protected:
     virtual ~FLACExtractor();
 
@@ -44,6 +50,8 @@ private:
     sp<DataSource> mDataSource;
     sp<FLACParser> mParser;
     status_t mInitCheck;
+    bool mUseSeekIndex;
+    sp<FLACSeekIndex> mSeekIndex;
     sp<MetaData> mFileMetadata;
 
     // There is only one track
@@ -20,15 +20,20 @@
 
 #include <media/stagefright/foundation/AHandler.h>
 
+#include <utils/KeyedVector.h>
+#include <utils/List.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
 struct ABuffer;
+struct ALooper;
 struct DataSource;
 struct LiveDataSource;
 struct M3UParser;
 struct HTTPBase;
+struct SegmentFetcher;
 
 struct LiveSession : public AHandler {
     enum Flags {
@@ -39,6 +44,11 @@ struct LiveSession : public AHandler {
 
     sp<DataSource> getDataSource();
 
+    // Number of segments downloaded ahead of, and in parallel with, the one
+    // being read. Takes effect on connect(), 0 downloads one segment at a
+    // time.
+    void setPrefetchDepth(size_t depth);
+
     void connect(
             const char *url,
             const KeyedVector<String8, String8> *headers = NULL);
@@ -57,10 +67,16 @@ protected:
 
     virtual void onMessageReceived(const sp<AMessage> &msg);
 
+    // Playlists, keys and segments are all fetched through sources made
+    // here, one per segment download in flight.
+    virtual sp<HTTPBase> createHTTPDataSource();
+
 private:
     enum {
-        kMaxNumQueuedFragments = 6,
         kMaxNumRetries         = 25,
+        kDefaultPrefetchDepth  = 2,
+        kMaxPrefetchDepth      = 8,
+        kMaxBandwidthSamples   = 8,
     };
 
     enum {
@@ -68,6 +84,7 @@ private:
         kWhatDisconnect     = 'disc',
         kWhatMonitorQueue   = 'moni',
         kWhatSeek           = 'seek',
+        kWhatFetcherNotify  = 'fetN',
     };
 
     struct BandwidthItem {
@@ -75,6 +92,28 @@ private:
         unsigned long mBandwidth;
     };
 
+    struct BandwidthSample {
+        size_t mNumBytes;
+        int64_t mStartUs;
+        int64_t mEndUs;
+    };
+
+    // A segment that is being downloaded, or whose data has not all been
+    // handed to the data source yet. Only the first one in mSegments feeds
+    // the data source, the chunks of the others wait in mChunks.
+    struct Segment {
+        int32_t mSeqNumber;
+        size_t mBandwidthIndex;
+        size_t mFetcherIndex;
+        int32_t mFetcherGeneration;
+        int64_t mStartTimeUs;
+        bool mDiscontinuity;
+        bool mFeeding;
+        bool mDone;
+        status_t mFinalResult;
+        List<sp<ABuffer> > mChunks;
+    };
+
     uint32_t mFlags;
     bool mUIDValid;
     uid_t mUID;
@@ -90,20 +129,27 @@ private:
 
     KeyedVector<AString, sp<ABuffer> > mAESKeyForURI;
 
+    size_t mPrefetchDepth;
+    Vector<sp<ALooper> > mFetcherLoopers;
+    Vector<sp<SegmentFetcher> > mFetchers;
+    List<Segment> mSegments;
+
+    List<BandwidthSample> mBandwidthSamples;
+
     ssize_t mPrevBandwidthIndex;
+    ssize_t mLastFedBandwidthIndex;
     int64_t mLastPlaylistFetchTimeUs;
     sp<M3UParser> mPlaylist;
     int32_t mSeqNumber;
-    int64_t mSeekTimeUs;
     int32_t mNumRetries;
+    bool mSignalDiscontinuity;
+    bool mEOSQueued;
 
     Mutex mLock;
     Condition mCondition;
     int64_t mDurationUs;
     int64_t mCurrenttimeUs;
     bool mSeekDone;
-    bool mSeekFlag;
-    bool mNeedDecrypt;
     bool mDisconnectPending;
 
     int32_t mMonitorQueueGeneration;
@@ -120,19 +166,30 @@ private:
 
     void onConnect(const sp<AMessage> &msg);
     void onDisconnect();
-    void onDownloadNext();
     void onMonitorQueue();
     void onSeek(const sp<AMessage> &msg);
+    void onFetcherNotify(const sp<AMessage> &msg);
+
+    // Starts downloads until the prefetch depth is reached.
+    void fillPipeline();
+    status_t startNextSegment();
+    void feedSegments();
+    void cancelSegments();
 
     status_t fetchFile(
             const char *url, sp<ABuffer> *out,
             int64_t range_offset = 0, int64_t range_length = -1);
 
     sp<M3UParser> fetchPlaylist(const char *url, bool *unchanged);
+    status_t refreshPlaylist(size_t bandwidthIndex);
     size_t getBandwidthIndex();
 
-    status_t decryptBuffer(
-            size_t playlistIndex, const sp<ABuffer> &buffer);
+    void addBandwidthSample(size_t numBytes, int64_t startUs, int64_t endUs);
+    bool estimateBandwidth(int32_t *bandwidthBps);
+
+    status_t getCipherInfo(
+            size_t playlistIndex, int32_t seqNumber,
+            sp<ABuffer> *key, sp<ABuffer> *iv);
 
     void postMonitorQueue(int64_t delayUs = 0);
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOCK_FREE_QUEUE_H_
+
+#define LOCK_FREE_QUEUE_H_
+
+#include <cutils/atomic.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// A bounded FIFO between one thread that pushes and one that pops, in the
+// manner of PCMRingBuffer: each side only ever moves its own index, so
+// neither waits for the other. Callers that share a side have to
+// serialize it themselves.
+template<typename T>
+struct LockFreeQueue {
+    // The capacity is rounded up to a power of 2.
+    LockFreeQueue(size_t minCapacity)
+        : mCapacity(1),
+          mPushIndex(0),
+          mPopIndex(0) {
+        while (mCapacity < minCapacity) {
+            mCapacity <<= 1;
+        }
+        CHECK_LE(mCapacity, 0x40000000u);
+
+        mItems = new T[mCapacity];
+    }
+
+    ~LockFreeQueue() {
+        delete[] mItems;
+        mItems = NULL;
+    }
+
+    size_t capacity() const { return mCapacity; }
+
+    // Pusher side, returns false if the queue is full.
+    bool push(const T &item) {
+        uint32_t index = mPushIndex;
+        if (index - (uint32_t)android_atomic_acquire_load(&mPopIndex)
+                >= mCapacity) {
+            return false;
+        }
+
+        mItems[index & (mCapacity - 1)] = item;
+        android_atomic_release_store(index + 1, &mPushIndex);
+
+        return true;
+    }
+
+    // Popper side, returns false if the queue is empty.
+    bool pop(T *item) {
+        uint32_t index = mPopIndex;
+        if ((uint32_t)android_atomic_acquire_load(&mPushIndex) == index) {
+            return false;
+        }
+
+        *item = mItems[index & (mCapacity - 1)];
+        android_atomic_release_store(index + 1, &mPopIndex);
+
+        return true;
+    }
+
+    // Either side, exact only when called from the popper.
+    bool empty() const {
+        return android_atomic_acquire_load(&mPushIndex)
+            == android_atomic_acquire_load(&mPopIndex);
+    }
+
+private:
+    T *mItems;
+    size_t mCapacity;
+
+    // Free running, wrapped into mItems on access.
+    volatile int32_t mPushIndex;
+    volatile int32_t mPopIndex;
+
+    DISALLOW_EVIL_CONSTRUCTORS(LockFreeQueue);
+};
+
+}  // namespace android
+
+#endif  // LOCK_FREE_QUEUE_H_
@@ -19,31 +19,18 @@
 #define MPEG4_EXTRACTOR_H_
 
 #include <media/stagefright/MediaExtractor.h>
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
 #include <utils/Vector.h>
 #include <utils/String8.h>
 
-#define QT_PCM
-#define QT_MAX_AUDIO_WAVFMT_SIZE		20
-
 namespace android {
 
 struct AMessage;
 class DataSource;
+class MPEG4Source;
 class SampleTable;
 class String8;
-struct MPEG4Source;
-typedef struct
-{
-    uint16_t    FormatTag;
-    uint16_t    Channels;
-    uint32_t    SamplesPerSec;
-    uint32_t    AvgBytesPerSec;
-    uint16_t    BlockAlign;
-    uint16_t    BitsPerSample;
-    uint16_t    Size;
-	uint16_t	  SamplesPerBlock;
-
-}WaveFormatExStruct;
 
 class MPEG4Extractor : public MediaExtractor {
 public:
@@ -58,16 +45,31 @@ public:
 
     // for DRM
     virtual char* getDrmTrackInfo(size_t trackID, int *len);
-#ifdef QT_PCM
-    uint32_t audioExtraSize;//add by Charles Chen
-    uint8_t audioExtraData[QT_MAX_AUDIO_WAVFMT_SIZE];
-    bool bWavCodecPrivateSend;
-#endif
+
 protected:
     virtual ~MPEG4Extractor();
 
 private:
-    friend struct MPEG4Source;
+    friend class MPEG4Source;
+
+    // Per-sample defaults of a track whose samples are stored in movie
+    // fragments, as given by its 'trex' box.
+    struct TrackExtends {
+        uint32_t mTrackID;
+        uint32_t mSampleDescriptionIndex;
+        uint32_t mSampleDuration;
+        uint32_t mSampleSize;
+        uint32_t mSampleFlags;
+    };
+
+    // Uncompressed QuickTime audio ('twos', 'sowt', 'raw ', 'alaw',
+    // 'ulaw'), 0 for anything else.
+    struct PCMInfo {
+        uint32_t mFormat;
+        uint32_t mBitsPerSample;
+        uint32_t mBytesPerFrame;
+    };
+
     struct Track {
         Track *next;
         sp<MetaData> meta;
@@ -75,19 +77,38 @@ private:
         sp<SampleTable> sampleTable;
         bool includes_expensive_metadata;
         bool skipTrack;
+
+        uint32_t trackID;
+        PCMInfo pcm;
     };
 
     sp<DataSource> mDataSource;
-	bool mHaveMetadata;
     status_t mInitCheck;
     bool mHasVideo;
-    long stream_num;
-    long long   min_off[16];
 
     Track *mFirstTrack, *mLastTrack;
 
     sp<MetaData> mFileMetaData;
 
+    uint32_t mMovieTimescale;
+
+    // Set if the movie may be extended by movie fragments, those are
+    // searched for starting right after the 'moov' box.
+    bool mHasMovieExtends;
+    Vector<TrackExtends> mTrackExtends;
+    int64_t mFragmentedDurationUs;
+    off64_t mFirstMoofOffset;
+
+    // Where each started track reads next. The lowest of these goes to
+    // DataSource::updatecache(), NuCachedSource2 only drops cached data
+    // below it, which keeps the data of a track lagging behind the others
+    // on a badly interleaved file. Sample tables too large to be held in
+    // memory are read during playback as well, the first of them is kept
+    // in mLowestTableOffset.
+    Mutex mReadOffsetLock;
+    KeyedVector<const MPEG4Source *, off64_t> mReadOffsets;
+    off64_t mLowestTableOffset;
+
     Vector<uint32_t> mPath;
     String8 mLastCommentMean;
     String8 mLastCommentName;
@@ -96,12 +117,23 @@ private:
     status_t readMetaData();
     status_t parseChunk(off64_t *offset, int depth);
     status_t parseMetaData(off64_t offset, size_t size);
+    status_t parseAudioSampleEntry(
+            uint32_t chunk_type, off64_t *offset, off64_t data_offset,
+            off64_t chunk_size, int depth);
 
     status_t updateAudioTrackInfoFromESDS_MPEG4Audio(
             const void *esds_data, size_t esds_size);
 
     static status_t verifyTrack(Track *track);
 
+    bool isFragmented(const Track *track) const;
+    const TrackExtends *findTrackExtends(uint32_t trackID) const;
+    status_t setMaxInputSize(Track *track);
+
+    // Called by a track once it has read up to "offset", -1 when it is
+    // stopped.
+    void setReadOffset(const MPEG4Source *source, off64_t offset);
+
     struct SINF {
         SINF *next;
         uint16_t trackID;
@@ -117,7 +149,6 @@ private:
 
     status_t parseTrackHeader(off64_t data_offset, off64_t data_size);
 
-    Track *findTrackByMimePrefix(const char *mimePrefix);
 
     MPEG4Extractor(const MPEG4Extractor &);
     MPEG4Extractor &operator=(const MPEG4Extractor &);
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_CAPTURE_DSP_H_
+
+#define PCM_CAPTURE_DSP_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Copies numFrames frames of interleaved 16 bit PCM from src to dst,
+// fading them in on the way, and returns the largest magnitude written,
+// -32768 counting as 32767. dst may be the same as src.
+//
+// "rampFrame" is where on the fade src begins. Frames before 0 are muted,
+// frames at or past rampDurationFrames are copied as they are, and in
+// between the gain rises linearly: sample * g >> 14 with
+// g = (frame * (2^30 / rampDurationFrames)) >> 16.
+int16_t CopyPCMWithRampAndPeak(
+        int16_t *dst, const int16_t *src,
+        size_t numFrames, size_t numChannels,
+        int64_t rampFrame, int32_t rampDurationFrames);
+
+}  // namespace android
+
+#endif  // PCM_CAPTURE_DSP_H_
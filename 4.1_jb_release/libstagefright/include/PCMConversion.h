@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_CONVERSION_H_
+
+#define PCM_CONVERSION_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Little endian sample formats as found in WAV files.
+enum PCMSampleFormat {
+    kPCMFormatU8,
+    kPCMFormatS16,
+    kPCMFormatS24,      // packed, 3 bytes per sample
+    kPCMFormatS32,
+    kPCMFormatFloat,    // IEEE float, nominally in [-1, 1]
+    kPCMFormatALaw,
+    kPCMFormatMuLaw,
+};
+
+size_t PCMSampleSize(PCMSampleFormat format);
+
+// Converts numSamples samples to signed 16 bit. Wider formats lose their
+// low bits, float is rounded and saturated, G.711 is expanded the way
+// SoftG711 does it. The conversion runs front to back, so dst may be the
+// same as src for the formats at least 2 bytes wide, and the 1 byte
+// formats may be read from numSamples bytes or more past dst.
+void ConvertPCMToS16(
+        int16_t *dst, const void *src, PCMSampleFormat format,
+        size_t numSamples);
+
+// Converts numSamples samples to float, full scale being [-1, 1).
+void ConvertPCMToFloat(
+        float *dst, const void *src, PCMSampleFormat format,
+        size_t numSamples);
+
+}  // namespace android
+
+#endif  // PCM_CONVERSION_H_
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_RING_BUFFER_H_
+
+#define PCM_RING_BUFFER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+// Hands PCM from one producer thread to one consumer thread without a
+// lock: only the producer moves the write position and only the consumer
+// the read position, so neither ever waits for the other.
+//
+// Next to the data runs a short queue of tags, each pinned to a position
+// in the stream. The producer tags where a decoded buffer begins and where
+// the stream ends, the consumer sees a tag once it has read up to it.
+struct PCMRingBuffer {
+    struct Tag {
+        // Where in the stream the tag applies, set by writeTag().
+        uint32_t mPosition;
+
+        // Whatever generation of the stream the data after it belongs to.
+        int32_t mEpoch;
+
+        // The media time of the data after it.
+        int64_t mTimeUs;
+
+        // OK, or the error the stream ended with.
+        status_t mStatus;
+    };
+
+    // The capacities are rounded up to powers of 2.
+    PCMRingBuffer(size_t minCapacity, size_t minNumTags);
+    ~PCMRingBuffer();
+
+    size_t capacity() const { return mCapacity; }
+
+    // Producer side.
+    size_t getWritableBytes() const;
+    bool canWriteTag() const;
+
+    // Returns the number of bytes written, as many as there is room for.
+    size_t write(const void *data, size_t size);
+
+    // Pins "tag" to the current write position, returns false if the
+    // tag queue is full.
+    bool writeTag(const Tag &tag);
+
+    // Consumer side.
+    uint32_t getReadPosition() const;
+
+    // Points "data" at what can be read in one go, up to the next tag or
+    // the end of the buffer, and returns its size.
+    size_t getReadRegion(const uint8_t **data) const;
+
+    void advanceRead(size_t size);
+
+    // Returns the next tag if it is pinned at the read position.
+    bool getDueTag(Tag *tag) const;
+    void popTag();
+
+    // Drops the data and tags of every other epoch up to the first tag
+    // of "epoch", which is left due. Returns false if that tag hasn't
+    // been written yet.
+    bool skipToEpoch(int32_t epoch);
+
+private:
+    uint8_t *mData;
+    size_t mCapacity;
+
+    Tag *mTags;
+    size_t mNumTags;
+
+    // Free running, wrapped into the buffers on access.
+    volatile int32_t mWritePosition;
+    volatile int32_t mReadPosition;
+    volatile int32_t mTagWriteIndex;
+    volatile int32_t mTagReadIndex;
+
+    // The number of bytes readable before the next tag, if there is one.
+    size_t getReadableBytes() const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(PCMRingBuffer);
+};
+
+}  // namespace android
+
+#endif  // PCM_RING_BUFFER_H_
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_ITERATOR_H_
+
+#define SAMPLE_ITERATOR_H_
+
+#include <utils/Vector.h>
+
+#include "include/SampleTable.h"
+
+namespace android {
+
+// Walks the samples of a SampleTable. Moving to the next sample, or to any
+// later sample in the same chunk, only touches the entries involved; other
+// moves restart from the nearest checkpoint of the run-length coded tables.
+struct SampleIterator {
+    SampleIterator(SampleTable *table);
+
+    status_t seekTo(uint32_t sampleIndex);
+
+    uint32_t getChunkIndex() const { return mCurrentChunkIndex; }
+    uint32_t getDescIndex() const { return mChunkDesc; }
+    off64_t getSampleOffset() const { return mCurrentSampleOffset; }
+    size_t getSampleSize() const { return mCurrentSampleSize; }
+    uint64_t getSampleTime() const { return mCurrentSampleTime; }
+    uint64_t getCompositionTime() const;
+
+    // Number of samples following the current one in the same chunk.
+    uint32_t getSamplesLeftInChunk() const;
+
+private:
+    SampleTable *mTable;
+
+    bool mInitialized;
+
+    uint32_t mSampleIndex;
+
+    SampleTable::RunCursor mChunkRun;
+    uint32_t mCurrentChunkIndex;
+    uint32_t mCurrentChunkFirstSampleIndex;
+    off64_t mCurrentChunkOffset;
+    uint32_t mChunkDesc;
+
+    SampleTable::RunCursor mTimeRun;
+    SampleTable::RunCursor mCompositionRun;
+
+    off64_t mCurrentSampleOffset;
+    size_t mCurrentSampleSize;
+    uint64_t mCurrentSampleTime;
+
+    status_t findChunk(uint32_t sampleIndex);
+    status_t findSampleOffset(uint32_t sampleIndex);
+
+    SampleIterator(const SampleIterator &);
+    SampleIterator &operator=(const SampleIterator &);
+};
+
+}  // namespace android
+
+#endif  // SAMPLE_ITERATOR_H_
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_TABLE_H_
+
+#define SAMPLE_TABLE_H_
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include <media/stagefright/MediaErrors.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+class DataSource;
+struct SampleIterator;
+
+// The sample tables of a single track. None of the tables is loaded at
+// parse time, only their location is recorded. Entries are decoded on
+// demand from a few cached pages of the on-disk (compact) representation,
+// run-length coded tables are additionally indexed by a sparse set of
+// checkpoints that grows as lookups reach further into the track. This
+// keeps both the time to open a file and the memory footprint independent
+// of the duration of the track.
+class SampleTable : public RefBase {
+public:
+    SampleTable(const sp<DataSource> &source);
+
+    bool isValid() const;
+
+    // type can be 'stco' or 'co64'.
+    status_t setChunkOffsetParams(
+            uint32_t type, off64_t data_offset, size_t data_size);
+
+    status_t setSampleToChunkParams(off64_t data_offset, size_t data_size);
+
+    // type can be 'stsz' or 'stz2'.
+    status_t setSampleSizeParams(
+            uint32_t type, off64_t data_offset, size_t data_size);
+
+    status_t setTimeToSampleParams(off64_t data_offset, size_t data_size);
+
+    status_t setCompositionTimeToSampleParams(
+            off64_t data_offset, size_t data_size);
+
+    status_t setSyncSampleParams(off64_t data_offset, size_t data_size);
+
+    // Uncompressed QuickTime audio describes every PCM frame as a sample
+    // of nominal size 1, this substitutes the actual size of a frame.
+    void setPCMFrameSize(size_t frameSize);
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    uint32_t countChunkOffsets() const;
+
+    uint32_t countSamples() const;
+
+    // Scans the sample size table the first time it is called.
+    status_t getMaxSampleSize(size_t *size);
+
+    status_t getMetaDataForSample(
+            uint32_t sampleIndex,
+            off64_t *offset,
+            size_t *size,
+            uint64_t *compositionTime,
+            bool *isSyncSample = NULL);
+
+    // Returns the number of samples starting at "sampleIndex" that are
+    // stored back to back within the same chunk, at most "maxSamples".
+    status_t countContiguousSamples(
+            uint32_t sampleIndex, uint32_t maxSamples, uint32_t *count);
+
+    enum {
+        kFlagBefore,
+        kFlagAfter,
+        kFlagClosest
+    };
+    status_t findSampleAtTime(
+            uint64_t req_time, uint32_t *sample_index, uint32_t flags);
+
+    status_t findSyncSampleNear(
+            uint32_t start_sample_index, uint32_t *sample_index,
+            uint32_t flags);
+
+    status_t findThumbnailSample(uint32_t *sample_index);
+
+protected:
+    ~SampleTable();
+
+private:
+    friend struct SampleIterator;
+
+    struct CompactTable;
+    struct RunTable;
+
+    // A run of samples described by one entry of 'stts', 'ctts' or 'stsc'.
+    struct RunCursor {
+        RunCursor() : mValid(false) {}
+
+        bool mValid;
+        uint32_t mEntry;
+        uint32_t mFirstSample;
+        uint32_t mNumSamples;
+        uint64_t mFirstTime;   // 'stts' only.
+
+        // Sample delta, composition offset or samples per chunk.
+        uint32_t mValue;
+
+        uint32_t mFirstChunk;  // 'stsc' only, 0-based.
+        uint32_t mDescIndex;   // 'stsc' only.
+
+        bool contains(uint32_t sampleIndex) const {
+            return mValid && sampleIndex >= mFirstSample
+                && sampleIndex - mFirstSample < mNumSamples;
+        }
+    };
+
+    static const uint32_t kChunkOffsetType32;
+    static const uint32_t kChunkOffsetType64;
+    static const uint32_t kSampleSizeType32;
+    static const uint32_t kSampleSizeTypeCompact;
+
+    sp<DataSource> mDataSource;
+    Mutex mLock;
+
+    off64_t mChunkOffsetOffset;
+    uint32_t mChunkOffsetType;
+    uint32_t mNumChunkOffsets;
+    CompactTable *mChunkOffsets;
+
+    off64_t mSampleToChunkOffset;
+    uint32_t mNumSampleToChunkEntries;
+    RunTable *mSampleToChunk;
+
+    off64_t mSampleSizeOffset;
+    uint32_t mSampleSizeFieldSize;
+    uint32_t mDefaultSampleSize;
+    uint32_t mNumSampleSizes;
+    CompactTable *mSampleSizes;
+
+    uint32_t mTimeToSampleCount;
+    RunTable *mTimeToSample;
+
+    RunTable *mCompositionTimeDelta;
+
+    off64_t mSyncSampleOffset;
+    uint32_t mNumSyncSamples;
+    CompactTable *mSyncSamples;
+    uint32_t mLastSyncSampleEntry;
+
+    bool mHaveMaxSampleSize;
+    size_t mMaxSampleSize;
+
+    SampleIterator *mSampleIterator;
+
+    status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
+    status_t getChunkOffset_l(uint32_t chunk_index, off64_t *offset);
+    status_t getSampleTime_l(uint32_t sample_index, uint64_t *time);
+    status_t isSyncSample_l(uint32_t sample_index, bool *isSync);
+
+    // Positions "run" on the run of "table" containing "sample_index".
+    static status_t findRun_l(
+            RunTable *table, uint32_t sample_index, RunCursor *run);
+
+    // Finds the index of the first entry of the sync sample table that is
+    // not less than "sample_index".
+    status_t lowerBoundSyncSample_l(uint32_t sample_index, uint32_t *entry);
+    status_t syncSampleAt_l(uint32_t entry, uint32_t *sample_index);
+
+    status_t scanMaxSampleSize_l(size_t *size);
+
+    SampleTable(const SampleTable &);
+    SampleTable &operator=(const SampleTable &);
+};
+
+}  // namespace android
+
+#endif  // SAMPLE_TABLE_H_
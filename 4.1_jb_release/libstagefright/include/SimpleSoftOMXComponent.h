@@ -72,6 +72,9 @@ protected:
     virtual void onPortFlushCompleted(OMX_U32 portIndex);
     virtual void onPortEnableCompleted(OMX_U32 portIndex, bool enabled);
 
+    // Called with the buffer about to be freed, it is not owned by us.
+    virtual void onFreeBuffer(OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header);
+
     PortInfo *editPortInfo(OMX_U32 portIndex);
 
 private:
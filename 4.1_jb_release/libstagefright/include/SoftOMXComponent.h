@@ -26,6 +26,13 @@
 
 namespace android {
 
+// Set in nFlags by a soft encoder whose output buffer holds several NAL
+// units, such as the slices of one picture, each one after the first
+// preceded by a start code. OMX IL leaves this bit of nFlags unassigned.
+enum {
+    kSoftOMXBufferFlagMultipleNALUnits = 0x00010000,
+};
+
 struct SoftOMXComponent : public RefBase {
     SoftOMXComponent(
             const char *name,
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_STRETCHER_H_
+
+#define TIME_STRETCHER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android {
+
+// Changes the tempo of interleaved 16 bit PCM without changing its pitch
+// (WSOLA). The input is cut into overlapping sequences, each one taken from
+// wherever within a small window around its nominal position it best
+// continues the one before, and cross-faded onto it.
+//
+// All memory is allocated by the constructor, process() can run in an
+// audio callback. At most about 110ms of input is held back.
+struct TimeStretcher {
+    enum {
+        kMinRatePermille = 500,
+        kMaxRatePermille = 3000,
+    };
+
+    // numChannels is 1 or 2.
+    TimeStretcher(int32_t sampleRate, int32_t numChannels);
+    ~TimeStretcher();
+
+    // Takes effect with the next sequence. At 1000 whatever is buffered
+    // is played out and the input is then passed straight through.
+    void setRatePermille(int32_t ratePermille);
+
+    // Drops whatever is buffered, e.g. after a seek.
+    void reset();
+
+    // Writes up to maxOutFrames frames to "out", taking at most *inFrames
+    // frames from "in", and returns the number of frames written. On
+    // return *inFrames holds the number of frames taken. Either all of
+    // the input is taken or the output is filled.
+    size_t process(
+            int16_t *out, size_t maxOutFrames,
+            const int16_t *in, size_t *inFrames);
+
+    // Once the input has ended, plays out what is still buffered at the
+    // normal rate. Returns the number of frames written, less than
+    // maxOutFrames once nothing is left.
+    size_t flush(int16_t *out, size_t maxOutFrames);
+
+    // True if nothing is buffered.
+    bool isEmpty() const;
+
+    // True if process() would merely copy its input.
+    bool isPassThrough() const;
+
+    // How much of the input taken so far is yet to come out, in media time.
+    int64_t getBufferedDurationUs() const;
+
+private:
+    int32_t mSampleRate;
+    int32_t mNumChannels;
+    int32_t mRatePermille;
+    bool mFlushing;
+
+    size_t mOverlapFrames;
+
+    int16_t *mInput;
+    size_t mInputCapacity;
+    size_t mInputFrames;
+
+    // The sequence last put together, handed out from mOutputOffset on.
+    int16_t *mOutput;
+    size_t mOutputFrames;
+    size_t mOutputOffset;
+
+    // The input following the last sequence, the next one is faded onto it.
+    int16_t *mOverlap;
+    bool mHaveOverlap;
+
+    // Whatever didn't make a whole frame of the nominal skip, in 1/1000s.
+    int64_t mSkipRemainder;
+
+    // Mono copies of the overlap and of the seek window to correlate.
+    float *mMonoOverlap;
+    float *mMonoInput;
+
+    void getSequenceFrames(
+            int32_t ratePermille, size_t *sequenceFrames,
+            size_t *seekFrames) const;
+    size_t getRequiredFrames(int32_t ratePermille) const;
+
+    size_t findBestOffset(size_t seekFrames);
+    void runSequence();
+    void rejoin();
+    void consumeInput(size_t numFrames);
+
+    DISALLOW_EVIL_CONSTRUCTORS(TimeStretcher);
+};
+
+}  // namespace android
+
+#endif  // TIME_STRETCHER_H_
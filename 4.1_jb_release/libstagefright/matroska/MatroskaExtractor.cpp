@@ -0,0 +1,2423 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MatroskaExtractor"
+#include <utils/Log.h>
+
+#include "MatroskaExtractor.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+#include <utils/String8.h>
+
+#include <ctype.h>
+#include <strings.h>
+#include <zlib.h>
+
+namespace android {
+
+// EBML element IDs, with their length marker bits kept.
+enum {
+    kEBMLHeaderId               = 0x1A45DFA3,
+    kDocTypeId                  = 0x4282,
+
+    kSegmentId                  = 0x18538067,
+
+    kSeekHeadId                 = 0x114D9B74,
+    kSeekId                     = 0x4DBB,
+    kSeekIDId                   = 0x53AB,
+    kSeekPositionId             = 0x53AC,
+
+    kInfoId                     = 0x1549A966,
+    kTimecodeScaleId            = 0x2AD7B1,
+    kDurationId                 = 0x4489,
+
+    kTracksId                   = 0x1654AE6B,
+    kTrackEntryId               = 0xAE,
+    kTrackNumberId              = 0xD7,
+    kTrackTypeId                = 0x83,
+    kCodecIDId                  = 0x86,
+    kCodecPrivateId             = 0x63A2,
+    kDefaultDurationId          = 0x23E383,
+    kLanguageId                 = 0x22B59C,
+    kVideoId                    = 0xE0,
+    kPixelWidthId               = 0xB0,
+    kPixelHeightId              = 0xBA,
+    kAudioId                    = 0xE1,
+    kSamplingFrequencyId        = 0xB5,
+    kChannelsId                 = 0x9F,
+    kBitDepthId                 = 0x6264,
+    kContentEncodingsId         = 0x6D80,
+    kContentEncodingId          = 0x6240,
+    kContentEncodingScopeId     = 0x5032,
+    kContentEncodingTypeId      = 0x5033,
+    kContentCompressionId       = 0x5034,
+    kContentCompAlgoId          = 0x4254,
+    kContentCompSettingsId      = 0x4255,
+    kContentEncryptionId        = 0x5035,
+
+    kClusterId                  = 0x1F43B675,
+    kTimecodeId                 = 0xE7,
+    kSimpleBlockId              = 0xA3,
+    kBlockGroupId               = 0xA0,
+    kBlockId                    = 0xA1,
+    kBlockDurationId            = 0x9B,
+    kReferenceBlockId           = 0xFB,
+
+    kCuesId                     = 0x1C53BB6B,
+    kCuePointId                 = 0xBB,
+    kCueTimeId                  = 0xB3,
+    kCueTrackPositionsId        = 0xB7,
+    kCueTrackId                 = 0xF7,
+    kCueClusterPositionId       = 0xF1,
+
+    kChaptersId                 = 0x1043A770,
+    kTagsId                     = 0x1254C367,
+    kAttachmentsId              = 0x1941A469,
+};
+
+static const uint64_t kUnknownSize = 0xffffffffffffffffull;
+
+// Enough for the longest ID (4 bytes) and size (8 bytes).
+static const size_t kMaxElementHeaderSize = 12;
+
+// Limits on what is read into memory in one piece.
+static const size_t kMaxElementSize = 32 * 1024 * 1024;
+static const size_t kMaxClusterSize = 64 * 1024 * 1024;
+
+// How far back from the cluster picked by the index a seek may go looking
+// for the sync frame preceding the seek time.
+static const int kMaxSeekRetries = 16;
+
+// Parses the variable size integer at the start of "data". IDs keep their
+// length marker, sizes drop it and all bits set stands for an unknown size.
+// Returns the number of bytes used, 0 if the integer is malformed or does
+// not fit into "size" bytes.
+static size_t parseVInt(
+        const uint8_t *data, size_t size, bool keepMarker, uint64_t *value) {
+    if (size == 0) {
+        return 0;
+    }
+
+    uint8_t first = data[0];
+    uint8_t mask = 0x80;
+    size_t len = 1;
+    while (len <= 8 && !(first & mask)) {
+        ++len;
+        mask >>= 1;
+    }
+
+    if (len > 8 || len > size) {
+        return 0;
+    }
+
+    uint8_t valueBits = mask - 1;
+    uint64_t x = keepMarker ? first : (first & valueBits);
+    bool allOnes = ((first & valueBits) == valueBits);
+    for (size_t i = 1; i < len; ++i) {
+        x = (x << 8) | data[i];
+        allOnes = allOnes && (data[i] == 0xff);
+    }
+
+    if (!keepMarker && allOnes) {
+        x = kUnknownSize;
+    }
+
+    *value = x;
+
+    return len;
+}
+
+static size_t parseElementHeader(
+        const uint8_t *data, size_t size, uint32_t *id, uint64_t *payloadSize) {
+    uint64_t x;
+    size_t idLen = parseVInt(data, size, true /* keepMarker */, &x);
+    if (idLen == 0 || idLen > 4) {
+        return 0;
+    }
+
+    size_t sizeLen = parseVInt(
+            data + idLen, size - idLen, false /* keepMarker */, payloadSize);
+    if (sizeLen == 0) {
+        return 0;
+    }
+
+    *id = (uint32_t)x;
+
+    return idLen + sizeLen;
+}
+
+static uint64_t readUInt(const uint8_t *data, size_t size) {
+    uint64_t x = 0;
+    for (size_t i = 0; i < size && i < 8; ++i) {
+        x = (x << 8) | data[i];
+    }
+    return x;
+}
+
+static double readFloat(const uint8_t *data, size_t size) {
+    if (size == 4) {
+        union { uint32_t u; float f; } x;
+        x.u = (uint32_t)readUInt(data, 4);
+        return x.f;
+    } else if (size == 8) {
+        union { uint64_t u; double d; } x;
+        x.u = readUInt(data, 8);
+        return x.d;
+    }
+    return 0.0;
+}
+
+// Walks the child elements of a master element held in memory. An element
+// running past the end of the data ends the walk, as does one of unknown
+// size which is then taken to extend to the end.
+struct ElementIterator {
+    ElementIterator(const uint8_t *data, size_t size)
+        : mData(data),
+          mSize(size),
+          mOffset(0),
+          mId(0),
+          mPayload(NULL),
+          mPayloadSize(0),
+          mTruncated(false) {
+    }
+
+    bool next() {
+        if (mOffset >= mSize) {
+            return false;
+        }
+
+        uint64_t payloadSize;
+        size_t headerLen = parseElementHeader(
+                mData + mOffset, mSize - mOffset, &mId, &payloadSize);
+
+        if (headerLen == 0) {
+            mTruncated = true;
+            return false;
+        }
+
+        size_t remaining = mSize - mOffset - headerLen;
+        if (payloadSize == kUnknownSize) {
+            payloadSize = remaining;
+        } else if (payloadSize > remaining) {
+            mTruncated = true;
+            return false;
+        }
+
+        mPayload = mData + mOffset + headerLen;
+        mPayloadSize = payloadSize;
+        mOffset += headerLen + payloadSize;
+
+        return true;
+    }
+
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mOffset;
+
+    uint32_t mId;
+    const uint8_t *mPayload;
+    size_t mPayloadSize;
+    bool mTruncated;
+};
+
+static bool isLevel1Id(uint32_t id) {
+    switch (id) {
+        case kEBMLHeaderId:
+        case kSegmentId:
+        case kSeekHeadId:
+        case kInfoId:
+        case kTracksId:
+        case kClusterId:
+        case kCuesId:
+        case kChaptersId:
+        case kTagsId:
+        case kAttachmentsId:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static status_t readElementHeaderAt(
+        const sp<DataSource> &source, off64_t offset,
+        uint32_t *id, uint64_t *payloadSize, size_t *headerLen) {
+    uint8_t header[kMaxElementHeaderSize];
+    ssize_t n = source->readAt(offset, header, sizeof(header));
+
+    if (n <= 0) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *headerLen = parseElementHeader(header, n, id, payloadSize);
+
+    return (*headerLen > 0) ? OK : ERROR_MALFORMED;
+}
+
+static status_t readElementAt(
+        const sp<DataSource> &source, off64_t offset, uint32_t expectedId,
+        sp<ABuffer> *payload) {
+    uint32_t id;
+    uint64_t size;
+    size_t headerLen;
+    status_t err = readElementHeaderAt(source, offset, &id, &size, &headerLen);
+    if (err != OK) {
+        return err;
+    }
+
+    if (id != expectedId || size == kUnknownSize || size > kMaxElementSize) {
+        return ERROR_MALFORMED;
+    }
+
+    sp<ABuffer> buffer = new ABuffer(size);
+    ssize_t n = source->readAt(offset + headerLen, buffer->data(), size);
+    if (n < (ssize_t)size) {
+        return ERROR_MALFORMED;
+    }
+
+    *payload = buffer;
+
+    return OK;
+}
+
+// Skips the EBML header and returns where the segment's payload starts and
+// ends, the end clamped to "fileSize" unless that is negative.
+static status_t findSegment(
+        const sp<DataSource> &source, off64_t fileSize,
+        off64_t *dataOffset, off64_t *end) {
+    uint32_t id;
+    uint64_t size;
+    size_t headerLen;
+    status_t err = readElementHeaderAt(source, 0, &id, &size, &headerLen);
+    if (err != OK) {
+        return err;
+    }
+
+    if (id != kEBMLHeaderId || size > 1024) {
+        return ERROR_MALFORMED;
+    }
+
+    off64_t offset = headerLen + size;
+    for (;;) {
+        err = readElementHeaderAt(source, offset, &id, &size, &headerLen);
+        if (err != OK) {
+            return ERROR_MALFORMED;
+        }
+
+        if (id == kSegmentId) {
+            break;
+        }
+
+        if (size == kUnknownSize) {
+            return ERROR_MALFORMED;
+        }
+        offset += headerLen + size;
+    }
+
+    *dataOffset = offset + headerLen;
+    if (size == kUnknownSize) {
+        *end = (fileSize >= 0) ? fileSize : (off64_t)0x7fffffffffffffffll;
+    } else {
+        *end = *dataOffset + size;
+        if (fileSize >= 0 && *end > fileSize) {
+            *end = fileSize;
+        }
+    }
+
+    return OK;
+}
+
+// The VFW fourccs of the MPEG-4 part 2 and MJPEG codecs MatroskaExtractor
+// handles itself.
+static bool isSupportedVfwFourcc(const uint8_t *data) {
+    char fourcc[5];
+    for (size_t i = 0; i < 4; ++i) {
+        fourcc[i] = toupper(data[i]);
+    }
+    fourcc[4] = '\0';
+
+    return !strcmp(fourcc, "XVID") || !strcmp(fourcc, "DIVX")
+        || !strcmp(fourcc, "DX50") || !strcmp(fourcc, "FMP4")
+        || !strcmp(fourcc, "MP4V") || !strcmp(fourcc, "MJPG");
+}
+
+// Inflates a zlib stream, used for tracks with ContentCompAlgo 0.
+static status_t inflateData(
+        const uint8_t *data, size_t size, sp<ABuffer> *out) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit(&stream) != Z_OK) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t capacity = size * 4 + 64;
+    sp<ABuffer> buffer = new ABuffer(capacity);
+
+    stream.next_in = (Bytef *)data;
+    stream.avail_in = size;
+
+    status_t err = OK;
+    for (;;) {
+        stream.next_out = buffer->data() + stream.total_out;
+        stream.avail_out = capacity - stream.total_out;
+
+        int res = inflate(&stream, Z_NO_FLUSH);
+
+        if (res == Z_STREAM_END) {
+            break;
+        } else if (res != Z_OK && res != Z_BUF_ERROR) {
+            err = ERROR_MALFORMED;
+            break;
+        }
+
+        if (stream.avail_out > 0) {
+            // All input consumed but the stream did not end.
+            if (stream.avail_in == 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (capacity * 2 > kMaxElementSize) {
+            err = ERROR_MALFORMED;
+            break;
+        }
+
+        sp<ABuffer> larger = new ABuffer(capacity * 2);
+        memcpy(larger->data(), buffer->data(), stream.total_out);
+        buffer = larger;
+        capacity *= 2;
+    }
+
+    size_t outSize = stream.total_out;
+    inflateEnd(&stream);
+
+    if (err != OK) {
+        return err;
+    }
+
+    buffer->setRange(0, outSize);
+    *out = buffer;
+
+    return OK;
+}
+
+// Replaces the length prefix of every NAL unit with a start code. Writes to
+// "dst" if it is not NULL, returns the size of the result or -1 if the NAL
+// lengths do not add up to "size".
+static ssize_t convertNALLengthsToStartCodes(
+        const uint8_t *src, size_t size, size_t nalSizeLen, uint8_t *dst) {
+    size_t srcOffset = 0;
+    size_t dstOffset = 0;
+
+    while (srcOffset < size) {
+        if (srcOffset + nalSizeLen > size) {
+            return -1;
+        }
+
+        size_t nalSize = (size_t)readUInt(&src[srcOffset], nalSizeLen);
+        srcOffset += nalSizeLen;
+
+        if (nalSize > size - srcOffset) {
+            return -1;
+        }
+
+        if (dst != NULL) {
+            memcpy(&dst[dstOffset], "\x00\x00\x00\x01", 4);
+            memmove(&dst[dstOffset + 4], &src[srcOffset], nalSize);
+        }
+
+        srcOffset += nalSize;
+        dstOffset += 4 + nalSize;
+    }
+
+    return dstOffset;
+}
+
+static void addESDSFromCodecPrivate(
+        const sp<MetaData> &meta, bool isAudio,
+        const uint8_t *priv, size_t privSize) {
+    // Every descriptor length is coded on 4 bytes, which the ESDS parser
+    // accepts and which keeps the layout independent of "privSize".
+    size_t decSpecificSize = 5 + privSize;
+    size_t decConfigSize = 5 + 13 + decSpecificSize;
+    size_t esSize = 5 + 3 + decConfigSize;
+
+    sp<ABuffer> esds = new ABuffer(esSize);
+    uint8_t *ptr = esds->data();
+
+    static const size_t kLengthBytes = 4;
+    size_t lengths[3] = {
+        esSize - 5, decConfigSize - 5, decSpecificSize - 5
+    };
+    static const uint8_t kTags[3] = { 0x03, 0x04, 0x05 };
+
+    for (size_t i = 0; i < 3; ++i) {
+        *ptr++ = kTags[i];
+        for (size_t j = kLengthBytes; j-- > 0;) {
+            *ptr++ = ((lengths[i] >> (7 * j)) & 0x7f) | (j > 0 ? 0x80 : 0);
+        }
+
+        if (kTags[i] == 0x03) {
+            *ptr++ = 0x00;  // ES_ID
+            *ptr++ = 0x00;
+            *ptr++ = 0x00;  // streamDependenceFlag, URL_Flag, OCRstreamFlag
+        } else if (kTags[i] == 0x04) {
+            *ptr++ = isAudio ? 0x40 : 0x20;  // ObjectTypeIndication
+            *ptr++ = isAudio ? 0x15 : 0x11;  // streamType
+            memset(ptr, 0, 11);              // bufferSize, bitrates
+            ptr += 11;
+        }
+    }
+
+    memcpy(ptr, priv, privSize);
+
+    meta->setData(kKeyESDS, 0, esds->data(), esds->size());
+}
+
+// Builds an AudioSpecificConfig for AAC tracks that only carry the profile
+// in their codec ID.
+static status_t makeAACCodecSpecificData(
+        const char *codecId, int32_t sampleRate, int32_t channelCount,
+        uint8_t *csd) {
+    static const int32_t kSampleRates[] = {
+        96000, 88200, 64000, 48000, 44100, 32000,
+        24000, 22050, 16000, 12000, 11025, 8000
+    };
+
+    uint8_t sampleRateIndex = 0xff;
+    for (size_t i = 0; i < sizeof(kSampleRates) / sizeof(kSampleRates[0]); ++i) {
+        if (kSampleRates[i] == sampleRate) {
+            sampleRateIndex = i;
+            break;
+        }
+    }
+
+    if (sampleRateIndex == 0xff || channelCount < 1 || channelCount > 7) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    uint8_t objectType = 2;  // LC
+    if (strstr(codecId, "/MAIN")) {
+        objectType = 1;
+    } else if (strstr(codecId, "/SSR")) {
+        objectType = 3;
+    } else if (strstr(codecId, "/LTP")) {
+        objectType = 4;
+    }
+
+    csd[0] = (objectType << 3) | (sampleRateIndex >> 1);
+    csd[1] = ((sampleRateIndex & 1) << 7) | (channelCount << 3);
+
+    return OK;
+}
+
+// The codec private data of Vorbis tracks holds the three Vorbis headers,
+// Xiph laced.
+static status_t addVorbisCodecInfo(
+        const sp<MetaData> &meta, const uint8_t *priv, size_t privSize) {
+    if (privSize < 1 || priv[0] != 2) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t offset = 1;
+    size_t sizes[2];
+    for (size_t i = 0; i < 2; ++i) {
+        sizes[i] = 0;
+        while (offset < privSize && priv[offset] == 0xff) {
+            sizes[i] += 0xff;
+            ++offset;
+        }
+        if (offset >= privSize) {
+            return ERROR_MALFORMED;
+        }
+        sizes[i] += priv[offset++];
+    }
+
+    size_t identOffset = offset;
+    size_t commentOffset = identOffset + sizes[0];
+    size_t setupOffset = commentOffset + sizes[1];
+
+    if (sizes[0] == 0 || setupOffset >= privSize
+            || priv[identOffset] != 1
+            || priv[commentOffset] != 3
+            || priv[setupOffset] != 5) {
+        return ERROR_MALFORMED;
+    }
+
+    meta->setData(kKeyVorbisInfo, 0, &priv[identOffset], sizes[0]);
+    meta->setData(
+            kKeyVorbisBooks, 0, &priv[setupOffset], privSize - setupOffset);
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct MatroskaSource : public MediaSource {
+    MatroskaSource(const sp<MatroskaExtractor> &extractor, size_t index);
+
+    virtual status_t start(MetaData *params);
+    virtual status_t stop();
+
+    virtual sp<MetaData> getFormat();
+
+    virtual status_t read(
+            MediaBuffer **buffer, const ReadOptions *options);
+
+protected:
+    virtual ~MatroskaSource();
+
+private:
+    typedef MatroskaExtractor::Cluster Cluster;
+    typedef MatroskaExtractor::Frame Frame;
+    typedef MatroskaExtractor::TrackInfo TrackInfo;
+
+    sp<MatroskaExtractor> mExtractor;
+    size_t mTrackIndex;
+    unsigned long mTrackNum;
+    int32_t mType;
+
+    bool mStarted;
+
+    // The next frame to look at is mCluster->mFrames[mFrameIndex].
+    sp<Cluster> mCluster;
+    size_t mFrameIndex;
+
+    bool mPendingInBandHeader;
+    int64_t mSkipUntilUs;
+
+    status_t getCluster(
+            off64_t offset, const sp<Cluster> &prev, sp<Cluster> *cluster);
+    status_t nextFrame(sp<Cluster> *cluster, size_t *index);
+    status_t seek(
+            int64_t seekTimeUs, ReadOptions::SeekMode mode,
+            int64_t *targetTimeUs);
+    status_t makeBuffer(
+            const sp<Cluster> &cluster, const Frame &frame,
+            MediaBuffer **buffer);
+
+    MatroskaSource(const MatroskaSource &);
+    MatroskaSource &operator=(const MatroskaSource &);
+};
+
+MatroskaSource::MatroskaSource(
+        const sp<MatroskaExtractor> &extractor, size_t index)
+    : mExtractor(extractor),
+      mTrackIndex(index),
+      mTrackNum(extractor->mTracks.itemAt(index).mTrackNum),
+      mType(extractor->mTracks.itemAt(index).mType),
+      mStarted(false),
+      mFrameIndex(0),
+      mPendingInBandHeader(false),
+      mSkipUntilUs(-1) {
+}
+
+MatroskaSource::~MatroskaSource() {
+    if (mStarted) {
+        stop();
+    }
+}
+
+status_t MatroskaSource::start(MetaData *params) {
+    CHECK(!mStarted);
+
+    mCluster.clear();
+    mFrameIndex = 0;
+    mPendingInBandHeader =
+        mExtractor->mTracks.itemAt(mTrackIndex).mInBandHeader != NULL;
+    mSkipUntilUs = -1;
+
+    mStarted = true;
+
+    return OK;
+}
+
+status_t MatroskaSource::stop() {
+    CHECK(mStarted);
+
+    mCluster.clear();
+
+    mStarted = false;
+
+    return OK;
+}
+
+sp<MetaData> MatroskaSource::getFormat() {
+    return mExtractor->mTracks.itemAt(mTrackIndex).mMeta;
+}
+
+status_t MatroskaSource::getCluster(
+        off64_t offset, const sp<Cluster> &prev, sp<Cluster> *cluster) {
+    Mutex::Autolock autoLock(mExtractor->mLock);
+
+    return mExtractor->getCluster_l(offset, prev, cluster);
+}
+
+status_t MatroskaSource::nextFrame(sp<Cluster> *cluster, size_t *index) {
+    for (;;) {
+        if (mCluster == NULL) {
+            status_t err = getCluster(
+                    mExtractor->mFirstClusterOffset, NULL, &mCluster);
+            if (err != OK) {
+                return err;
+            }
+            mFrameIndex = 0;
+        }
+
+        while (mFrameIndex < mCluster->mFrames.size()) {
+            const Frame &frame = mCluster->mFrames.itemAt(mFrameIndex++);
+            if (frame.mTrackNum == mTrackNum) {
+                *cluster = mCluster;
+                *index = mFrameIndex - 1;
+                return OK;
+            }
+        }
+
+        sp<Cluster> next;
+        status_t err = getCluster(mCluster->mNextOffset, mCluster, &next);
+        if (err != OK) {
+            return err;
+        }
+
+        mCluster = next;
+        mFrameIndex = 0;
+    }
+}
+
+status_t MatroskaSource::seek(
+        int64_t seekTimeUs, ReadOptions::SeekMode mode,
+        int64_t *targetTimeUs) {
+    int64_t searchTimeUs = seekTimeUs;
+
+    if (mType == SUBTITLE_TRACK_TYPE) {
+        // Subtitles are sparse, rather than look for the next one here
+        // the reads skip whatever precedes the seek time.
+        off64_t offset;
+        {
+            Mutex::Autolock autoLock(mExtractor->mLock);
+            status_t err = mExtractor->findCluster_l(
+                    mTrackNum, seekTimeUs, &offset);
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        status_t err = getCluster(offset, NULL, &mCluster);
+        if (err != OK) {
+            return err;
+        }
+
+        mFrameIndex = 0;
+        mSkipUntilUs = seekTimeUs;
+
+        return OK;
+    }
+
+    sp<Cluster> prevCluster, nextCluster;
+    size_t prevIndex = 0, nextIndex = 0;
+    bool wantNext = (mode == ReadOptions::SEEK_NEXT_SYNC
+            || mode == ReadOptions::SEEK_CLOSEST_SYNC);
+
+    for (int retries = 0;; ++retries) {
+        off64_t offset;
+        {
+            Mutex::Autolock autoLock(mExtractor->mLock);
+            status_t err = mExtractor->findCluster_l(
+                    mTrackNum, searchTimeUs, &offset);
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        sp<Cluster> first;
+        status_t err = getCluster(offset, NULL, &first);
+        if (err != OK) {
+            return err;
+        }
+
+        // Walk forward from the cluster the index gave us, remembering the
+        // last sync frame at or before the seek time and the first one
+        // after it.
+        sp<Cluster> cluster = first;
+        while (cluster != NULL) {
+            int64_t clusterTimeUs =
+                cluster->mTimecode * mExtractor->mTimecodeScale / 1000;
+
+            if (prevCluster != NULL && !wantNext
+                    && clusterTimeUs > seekTimeUs) {
+                break;
+            }
+
+            for (size_t i = 0; i < cluster->mFrames.size(); ++i) {
+                const Frame &frame = cluster->mFrames.itemAt(i);
+                if (frame.mTrackNum != mTrackNum || !frame.mIsKey) {
+                    continue;
+                }
+
+                if (frame.mTimeUs <= seekTimeUs) {
+                    prevCluster = cluster;
+                    prevIndex = i;
+                } else {
+                    nextCluster = cluster;
+                    nextIndex = i;
+                    break;
+                }
+            }
+
+            if (nextCluster != NULL) {
+                break;
+            }
+
+            sp<Cluster> next;
+            if (getCluster(cluster->mNextOffset, cluster, &next) != OK) {
+                break;
+            }
+            cluster = next;
+        }
+
+        int64_t firstTimeUs =
+            first->mTimecode * mExtractor->mTimecodeScale / 1000;
+
+        if (prevCluster != NULL || retries >= kMaxSeekRetries
+                || first->mOffset == mExtractor->mFirstClusterOffset
+                || firstTimeUs <= 0) {
+            break;
+        }
+
+        // The sync frame preceding the seek time lies in an earlier cluster,
+        // look again starting from the one before this one.
+        searchTimeUs = firstTimeUs - 1;
+        nextCluster.clear();
+    }
+
+    bool usePrev;
+    if (prevCluster == NULL || nextCluster == NULL) {
+        usePrev = (prevCluster != NULL);
+    } else if (mode == ReadOptions::SEEK_NEXT_SYNC) {
+        usePrev = false;
+    } else if (mode == ReadOptions::SEEK_CLOSEST_SYNC) {
+        int64_t prevTimeUs = prevCluster->mFrames.itemAt(prevIndex).mTimeUs;
+        int64_t nextTimeUs = nextCluster->mFrames.itemAt(nextIndex).mTimeUs;
+        usePrev = (seekTimeUs - prevTimeUs <= nextTimeUs - seekTimeUs);
+    } else {
+        usePrev = true;
+    }
+
+    if (usePrev) {
+        mCluster = prevCluster;
+        mFrameIndex = prevIndex;
+    } else if (nextCluster != NULL) {
+        mCluster = nextCluster;
+        mFrameIndex = nextIndex;
+    } else {
+        return ERROR_END_OF_STREAM;
+    }
+
+    if (mode == ReadOptions::SEEK_CLOSEST && mType == VIDEO_TRACK_TYPE) {
+        int64_t frameTimeUs = mCluster->mFrames.itemAt(mFrameIndex).mTimeUs;
+        if (frameTimeUs < seekTimeUs) {
+            *targetTimeUs = seekTimeUs;
+        }
+    }
+
+    const TrackInfo &track = mExtractor->mTracks.itemAt(mTrackIndex);
+    mPendingInBandHeader =
+        track.mInBandHeader != NULL && track.mInBandHeaderOnSeek;
+
+    return OK;
+}
+
+status_t MatroskaSource::makeBuffer(
+        const sp<Cluster> &cluster, const Frame &frame, MediaBuffer **out) {
+    const TrackInfo &track = mExtractor->mTracks.itemAt(mTrackIndex);
+
+    const uint8_t *data = cluster->mData->data() + frame.mOffset;
+    size_t size = frame.mSize;
+
+    sp<ABuffer> decoded;
+    if (track.mCompAlgo == MATROSKA_TRACK_ENCODING_COMP_ZLIB) {
+        status_t err = inflateData(data, size, &decoded);
+        if (err != OK) {
+            ALOGE("failed to inflate a frame of track %lu", mTrackNum);
+            return err;
+        }
+    } else if (track.mCompAlgo == MATROSKA_TRACK_ENCODING_COMP_HEADERSTRIP) {
+        size_t stripSize = track.mCompSettings->size();
+        decoded = new ABuffer(stripSize + size);
+        memcpy(decoded->data(), track.mCompSettings->data(), stripSize);
+        memcpy(decoded->data() + stripSize, data, size);
+    }
+
+    if (decoded != NULL) {
+        data = decoded->data();
+        size = decoded->size();
+    }
+
+    // Clusters convert the NAL units of uncompressed frames with 4 byte
+    // lengths in place when they are loaded, everything else is done here.
+    bool convertNALs = track.mNALSizeLen > 0
+        && (track.mNALSizeLen != 4 || decoded != NULL);
+
+    bool addHeader = mPendingInBandHeader;
+    mPendingInBandHeader = false;
+
+    MediaBuffer *buffer;
+    if (decoded == NULL && !convertNALs && !addHeader) {
+        // The frame is handed out in place, the buffer keeps the cluster's
+        // data alive for as long as it is held.
+        buffer = new MediaBuffer(cluster->mData);
+        buffer->set_range(frame.mOffset, frame.mSize);
+    } else {
+        ssize_t convertedSize = size;
+        if (convertNALs) {
+            convertedSize = convertNALLengthsToStartCodes(
+                    data, size, track.mNALSizeLen, NULL);
+            if (convertedSize < 0) {
+                ALOGW("frame of track %lu has bad NAL lengths", mTrackNum);
+                convertNALs = false;
+                convertedSize = size;
+            }
+        }
+
+        size_t headerSize = addHeader ? track.mInBandHeader->size() : 0;
+        buffer = new MediaBuffer(headerSize + convertedSize);
+        uint8_t *dst = (uint8_t *)buffer->data();
+
+        if (addHeader) {
+            memcpy(dst, track.mInBandHeader->data(), headerSize);
+        }
+
+        if (convertNALs) {
+            convertNALLengthsToStartCodes(
+                    data, size, track.mNALSizeLen, dst + headerSize);
+        } else {
+            memcpy(dst + headerSize, data, size);
+        }
+    }
+
+    buffer->meta_data()->setInt64(kKeyTime, frame.mTimeUs);
+    if (frame.mIsKey) {
+        buffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+    }
+    if (mType == SUBTITLE_TRACK_TYPE && frame.mDurationUs >= 0) {
+        buffer->meta_data()->setInt32(
+                kKeySubtitleDuration, (int32_t)(frame.mDurationUs / 1000));
+    }
+
+    *out = buffer;
+
+    return OK;
+}
+
+status_t MatroskaSource::read(
+        MediaBuffer **out, const ReadOptions *options) {
+    CHECK(mStarted);
+
+    *out = NULL;
+
+    int64_t targetTimeUs = -1;
+
+    int64_t seekTimeUs;
+    ReadOptions::SeekMode mode;
+    if (options && options->getSeekTo(&seekTimeUs, &mode)) {
+        status_t err = seek(seekTimeUs, mode, &targetTimeUs);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    sp<Cluster> cluster;
+    size_t index;
+    for (;;) {
+        status_t err = nextFrame(&cluster, &index);
+        if (err != OK) {
+            return err;
+        }
+
+        if (mSkipUntilUs < 0) {
+            break;
+        }
+
+        const Frame &frame = cluster->mFrames.itemAt(index);
+        int64_t endTimeUs = frame.mTimeUs
+            + (frame.mDurationUs > 0 ? frame.mDurationUs : 0);
+        if (endTimeUs >= mSkipUntilUs) {
+            mSkipUntilUs = -1;
+            break;
+        }
+    }
+
+    status_t err = makeBuffer(cluster, cluster->mFrames.itemAt(index), out);
+    if (err != OK) {
+        return err;
+    }
+
+    if (targetTimeUs >= 0) {
+        (*out)->meta_data()->setInt64(kKeyTargetTime, targetTimeUs);
+    }
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
+    : mDataSource(source),
+      mFileSize(-1),
+      mInitCheck(NO_INIT),
+      mSegmentDataOffset(0),
+      mSegmentEnd(0),
+      mTimecodeScale(1000000ll),
+      mDurationUs(-1),
+      mFirstClusterOffset(-1),
+      mCuesOffset(-1),
+      mCuesParsed(false),
+      mClusterScanOffset(-1),
+      mClusterScanDone(false),
+      mExtractedThumbnails(false),
+      mIsWebm(false) {
+    off64_t size;
+    if (mDataSource->getSize(&size) == OK) {
+        mFileSize = size;
+    }
+
+    mInitCheck = parseHeaders();
+
+    if (mInitCheck != OK) {
+        ALOGE("failed to parse the matroska headers (%d)", mInitCheck);
+        mTracks.clear();
+    }
+}
+
+MatroskaExtractor::~MatroskaExtractor() {
+}
+
+// static
+bool MatroskaExtractor::NeedsPrebuilt(const sp<DataSource> &source) {
+    off64_t fileSize;
+    if (source->getSize(&fileSize) != OK) {
+        fileSize = -1;
+    }
+
+    off64_t segmentDataOffset, segmentEnd;
+    if (findSegment(source, fileSize, &segmentDataOffset, &segmentEnd) != OK) {
+        return false;
+    }
+
+    // Only the element headers ahead of the first cluster are read, and the
+    // payload of Tracks, or of SeekHead if that is where Tracks is found.
+    off64_t tracksOffset = -1;
+    off64_t offset = segmentDataOffset;
+    while (tracksOffset < 0 && offset < segmentEnd) {
+        uint32_t id;
+        uint64_t size;
+        size_t headerLen;
+        if (readElementHeaderAt(source, offset, &id, &size, &headerLen) != OK
+                || id == kClusterId || size == kUnknownSize) {
+            break;
+        }
+
+        if (id == kTracksId) {
+            tracksOffset = offset;
+        } else if (id == kSeekHeadId) {
+            sp<ABuffer> seekHead;
+            if (readElementAt(source, offset, id, &seekHead) != OK) {
+                break;
+            }
+
+            ElementIterator it(seekHead->data(), seekHead->size());
+            while (it.next()) {
+                if (it.mId != kSeekId) {
+                    continue;
+                }
+
+                uint32_t seekId = 0;
+                off64_t position = -1;
+
+                ElementIterator child(it.mPayload, it.mPayloadSize);
+                while (child.next()) {
+                    if (child.mId == kSeekIDId) {
+                        seekId = (uint32_t)readUInt(
+                                child.mPayload, child.mPayloadSize);
+                    } else if (child.mId == kSeekPositionId) {
+                        position = segmentDataOffset
+                            + readUInt(child.mPayload, child.mPayloadSize);
+                    }
+                }
+
+                if (seekId == kTracksId && position >= 0) {
+                    tracksOffset = position;
+                    break;
+                }
+            }
+        }
+
+        offset += headerLen + size;
+    }
+
+    sp<ABuffer> tracks;
+    if (tracksOffset < 0
+            || readElementAt(source, tracksOffset, kTracksId, &tracks) != OK) {
+        return false;
+    }
+
+    ElementIterator it(tracks->data(), tracks->size());
+    while (it.next()) {
+        if (it.mId != kTrackEntryId) {
+            continue;
+        }
+
+        uint64_t type = 0;
+        String8 codecId;
+        const uint8_t *priv = NULL;
+        size_t privSize = 0;
+
+        ElementIterator child(it.mPayload, it.mPayloadSize);
+        while (child.next()) {
+            if (child.mId == kTrackTypeId) {
+                type = readUInt(child.mPayload, child.mPayloadSize);
+            } else if (child.mId == kCodecIDId) {
+                codecId.setTo((const char *)child.mPayload, child.mPayloadSize);
+            } else if (child.mId == kCodecPrivateId) {
+                priv = child.mPayload;
+                privSize = child.mPayloadSize;
+            }
+        }
+
+        if (type == AUDIO_TRACK_TYPE && codecId == "A_MS/ACM") {
+            return true;
+        }
+
+        if (type == SUBTITLE_TRACK_TYPE && codecId == "S_VOBSUB") {
+            return true;
+        }
+
+        // Mirrors the checks of parseVfwTrack().
+        if (type == VIDEO_TRACK_TYPE && codecId == "V_MS/VFW/FOURCC"
+                && privSize >= 40 && U32LE_AT(priv) >= 40
+                && U32LE_AT(priv) <= privSize
+                && !isSupportedVfwFourcc(&priv[16])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t MatroskaExtractor::countTracks() {
+    return mTracks.size();
+}
+
+size_t MatroskaExtractor::countSubtitleTracks() {
+    size_t n = 0;
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (mTracks.itemAt(i).mType == SUBTITLE_TRACK_TYPE) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+size_t MatroskaExtractor::countAudioTracks() {
+    size_t n = 0;
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (mTracks.itemAt(i).mType == AUDIO_TRACK_TYPE) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+sp<MediaSource> MatroskaExtractor::getTrack(size_t index) {
+    if (index >= mTracks.size()) {
+        return NULL;
+    }
+
+    return new MatroskaSource(this, index);
+}
+
+sp<MetaData> MatroskaExtractor::getTrackMetaData(
+        size_t index, uint32_t flags) {
+    if (index >= mTracks.size()) {
+        return NULL;
+    }
+
+    if ((flags & kIncludeExtensiveMetaData) && !mExtractedThumbnails) {
+        findThumbnails();
+        mExtractedThumbnails = true;
+    }
+
+    return mTracks.itemAt(index).mMeta;
+}
+
+sp<MetaData> MatroskaExtractor::getMetaData() {
+    sp<MetaData> meta = new MetaData;
+
+    if (mInitCheck == OK) {
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_CONTAINER_MATROSKA);
+    }
+
+    return meta;
+}
+
+ssize_t MatroskaExtractor::findTrackIndex(unsigned long trackNum) const {
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        if (mTracks.itemAt(i).mTrackNum == trackNum) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+status_t MatroskaExtractor::readElement(
+        off64_t offset, uint32_t expectedId, sp<ABuffer> *payload) {
+    return readElementAt(mDataSource, offset, expectedId, payload);
+}
+
+status_t MatroskaExtractor::parseHeaders() {
+    status_t err = findSegment(
+            mDataSource, mFileSize, &mSegmentDataOffset, &mSegmentEnd);
+    if (err != OK) {
+        return err;
+    }
+
+    sp<ABuffer> ebml;
+    err = readElement(0, kEBMLHeaderId, &ebml);
+    if (err != OK) {
+        return err;
+    }
+
+    String8 docType("matroska");
+    ElementIterator it(ebml->data(), ebml->size());
+    while (it.next()) {
+        if (it.mId == kDocTypeId) {
+            docType.setTo((const char *)it.mPayload, it.mPayloadSize);
+        }
+    }
+
+    if (docType == "webm") {
+        mIsWebm = true;
+    } else if (!(docType == "matroska")) {
+        ALOGE("unsupported doc type '%s'", docType.string());
+        return ERROR_UNSUPPORTED;
+    }
+
+    // Read the level 1 elements up to the first cluster. The cues are only
+    // located here and read when a seek first needs them.
+    off64_t infoOffset = -1;
+    off64_t tracksOffset = -1;
+    bool gotInfo = false;
+    bool gotTracks = false;
+
+    uint32_t id;
+    uint64_t size;
+    size_t headerLen;
+    off64_t offset = mSegmentDataOffset;
+    while (offset < mSegmentEnd) {
+        err = readElementHeaderAt(mDataSource, offset, &id, &size, &headerLen);
+        if (err != OK) {
+            break;
+        }
+
+        if (id == kClusterId) {
+            mFirstClusterOffset = offset;
+            break;
+        }
+
+        if (size == kUnknownSize) {
+            return ERROR_MALFORMED;
+        }
+
+        sp<ABuffer> payload;
+        switch (id) {
+            case kSeekHeadId:
+            {
+                if (readElement(offset, id, &payload) == OK) {
+                    parseSeekHead(
+                            payload->data(), payload->size(),
+                            &infoOffset, &tracksOffset);
+                }
+                break;
+            }
+
+            case kInfoId:
+            {
+                err = readElement(offset, id, &payload);
+                if (err == OK) {
+                    err = parseInfo(payload->data(), payload->size());
+                }
+                if (err != OK) {
+                    return err;
+                }
+                gotInfo = true;
+                break;
+            }
+
+            case kTracksId:
+            {
+                err = readElement(offset, id, &payload);
+                if (err == OK) {
+                    err = parseTracks(payload->data(), payload->size());
+                }
+                if (err != OK) {
+                    return err;
+                }
+                gotTracks = true;
+                break;
+            }
+
+            case kCuesId:
+                mCuesOffset = offset;
+                break;
+
+            default:
+                break;
+        }
+
+        offset += headerLen + size;
+    }
+
+    // Some muxers write Info or Tracks after the clusters, the seek head
+    // tells where.
+    sp<ABuffer> payload;
+    if (!gotInfo && infoOffset >= 0
+            && readElement(infoOffset, kInfoId, &payload) == OK) {
+        parseInfo(payload->data(), payload->size());
+    }
+
+    if (!gotTracks && tracksOffset >= 0
+            && readElement(tracksOffset, kTracksId, &payload) == OK) {
+        parseTracks(payload->data(), payload->size());
+    }
+
+    if (mFirstClusterOffset < 0) {
+        mFirstClusterOffset = mSegmentEnd;
+    }
+
+    if (mTracks.isEmpty()) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    if (mDurationUs >= 0) {
+        for (size_t i = 0; i < mTracks.size(); ++i) {
+            mTracks.editItemAt(i).mMeta->setInt64(kKeyDuration, mDurationUs);
+        }
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseSeekHead(
+        const uint8_t *data, size_t size,
+        off64_t *infoOffset, off64_t *tracksOffset) {
+    ElementIterator it(data, size);
+    while (it.next()) {
+        if (it.mId != kSeekId) {
+            continue;
+        }
+
+        uint32_t seekId = 0;
+        off64_t position = -1;
+
+        ElementIterator child(it.mPayload, it.mPayloadSize);
+        while (child.next()) {
+            if (child.mId == kSeekIDId) {
+                seekId = (uint32_t)readUInt(child.mPayload, child.mPayloadSize);
+            } else if (child.mId == kSeekPositionId) {
+                position = mSegmentDataOffset
+                    + readUInt(child.mPayload, child.mPayloadSize);
+            }
+        }
+
+        if (position < 0) {
+            continue;
+        }
+
+        switch (seekId) {
+            case kCuesId:
+                mCuesOffset = position;
+                break;
+            case kInfoId:
+                *infoOffset = position;
+                break;
+            case kTracksId:
+                *tracksOffset = position;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseInfo(const uint8_t *data, size_t size) {
+    double duration = -1.0;
+
+    ElementIterator it(data, size);
+    while (it.next()) {
+        if (it.mId == kTimecodeScaleId) {
+            mTimecodeScale = readUInt(it.mPayload, it.mPayloadSize);
+        } else if (it.mId == kDurationId) {
+            duration = readFloat(it.mPayload, it.mPayloadSize);
+        }
+    }
+
+    if (mTimecodeScale <= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    if (duration >= 0.0) {
+        mDurationUs = (int64_t)(duration * mTimecodeScale / 1000.0);
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseTracks(const uint8_t *data, size_t size) {
+    ElementIterator it(data, size);
+    while (it.next()) {
+        if (it.mId == kTrackEntryId) {
+            parseTrackEntry(it.mPayload, it.mPayloadSize);
+        }
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseTrackEntry(
+        const uint8_t *data, size_t size) {
+    TrackInfo info;
+    info.mTrackNum = 0;
+    info.mType = 0;
+    info.mMeta = new MetaData;
+    info.mDefaultDurationNs = 0;
+    info.mNALSizeLen = 0;
+    info.mCompAlgo = -1;
+    info.mInBandHeaderOnSeek = false;
+
+    String8 codecId;
+    String8 language("eng");
+    sp<ABuffer> codecPrivate;
+    int32_t width = 0, height = 0;
+    int32_t sampleRate = 8000, channelCount = 1, bitDepth = 0;
+
+    int32_t compScope = 1;
+    int32_t compAlgo = -1;
+    sp<ABuffer> compSettings;
+    size_t numEncodings = 0;
+    bool encrypted = false;
+
+    ElementIterator it(data, size);
+    while (it.next()) {
+        switch (it.mId) {
+            case kTrackNumberId:
+                info.mTrackNum = readUInt(it.mPayload, it.mPayloadSize);
+                break;
+
+            case kTrackTypeId:
+                info.mType = readUInt(it.mPayload, it.mPayloadSize);
+                break;
+
+            case kCodecIDId:
+                codecId.setTo((const char *)it.mPayload, it.mPayloadSize);
+                break;
+
+            case kCodecPrivateId:
+                codecPrivate = new ABuffer(it.mPayloadSize);
+                memcpy(codecPrivate->data(), it.mPayload, it.mPayloadSize);
+                break;
+
+            case kDefaultDurationId:
+                info.mDefaultDurationNs =
+                    readUInt(it.mPayload, it.mPayloadSize);
+                break;
+
+            case kLanguageId:
+                language.setTo((const char *)it.mPayload, it.mPayloadSize);
+                break;
+
+            case kVideoId:
+            {
+                ElementIterator child(it.mPayload, it.mPayloadSize);
+                while (child.next()) {
+                    if (child.mId == kPixelWidthId) {
+                        width = readUInt(child.mPayload, child.mPayloadSize);
+                    } else if (child.mId == kPixelHeightId) {
+                        height = readUInt(child.mPayload, child.mPayloadSize);
+                    }
+                }
+                break;
+            }
+
+            case kAudioId:
+            {
+                ElementIterator child(it.mPayload, it.mPayloadSize);
+                while (child.next()) {
+                    if (child.mId == kSamplingFrequencyId) {
+                        sampleRate = (int32_t)readFloat(
+                                child.mPayload, child.mPayloadSize);
+                    } else if (child.mId == kChannelsId) {
+                        channelCount =
+                            readUInt(child.mPayload, child.mPayloadSize);
+                    } else if (child.mId == kBitDepthId) {
+                        bitDepth = readUInt(child.mPayload, child.mPayloadSize);
+                    }
+                }
+                break;
+            }
+
+            case kContentEncodingsId:
+            {
+                ElementIterator encodings(it.mPayload, it.mPayloadSize);
+                while (encodings.next()) {
+                    if (encodings.mId != kContentEncodingId) {
+                        continue;
+                    }
+                    ++numEncodings;
+
+                    compAlgo = MATROSKA_TRACK_ENCODING_COMP_ZLIB;
+
+                    ElementIterator enc(
+                            encodings.mPayload, encodings.mPayloadSize);
+                    while (enc.next()) {
+                        if (enc.mId == kContentEncodingScopeId) {
+                            compScope = readUInt(enc.mPayload, enc.mPayloadSize);
+                        } else if (enc.mId == kContentEncodingTypeId) {
+                            encrypted = encrypted
+                                || readUInt(enc.mPayload, enc.mPayloadSize) != 0;
+                        } else if (enc.mId == kContentEncryptionId) {
+                            encrypted = true;
+                        } else if (enc.mId == kContentCompressionId) {
+                            ElementIterator comp(enc.mPayload, enc.mPayloadSize);
+                            while (comp.next()) {
+                                if (comp.mId == kContentCompAlgoId) {
+                                    compAlgo = readUInt(
+                                            comp.mPayload, comp.mPayloadSize);
+                                } else if (comp.mId == kContentCompSettingsId) {
+                                    compSettings =
+                                        new ABuffer(comp.mPayloadSize);
+                                    memcpy(compSettings->data(), comp.mPayload,
+                                           comp.mPayloadSize);
+                                }
+                            }
+                        }
+                    }
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (info.mTrackNum == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    if (numEncodings > 0) {
+        if (encrypted || numEncodings > 1
+                || (compAlgo != MATROSKA_TRACK_ENCODING_COMP_ZLIB
+                    && compAlgo != MATROSKA_TRACK_ENCODING_COMP_HEADERSTRIP)
+                || (compAlgo == MATROSKA_TRACK_ENCODING_COMP_HEADERSTRIP
+                    && compSettings == NULL)) {
+            ALOGW("track %lu uses an unsupported content encoding",
+                  info.mTrackNum);
+            return ERROR_UNSUPPORTED;
+        }
+
+        if ((compScope & 2) && codecPrivate != NULL) {
+            if (compAlgo == MATROSKA_TRACK_ENCODING_COMP_ZLIB) {
+                sp<ABuffer> inflated;
+                if (inflateData(codecPrivate->data(), codecPrivate->size(),
+                                &inflated) != OK) {
+                    return ERROR_MALFORMED;
+                }
+                codecPrivate = inflated;
+            } else {
+                sp<ABuffer> full = new ABuffer(
+                        compSettings->size() + codecPrivate->size());
+                memcpy(full->data(), compSettings->data(),
+                       compSettings->size());
+                memcpy(full->data() + compSettings->size(),
+                       codecPrivate->data(), codecPrivate->size());
+                codecPrivate = full;
+            }
+        }
+
+        if (compScope & 1) {
+            info.mCompAlgo = compAlgo;
+            info.mCompSettings = compSettings;
+        }
+    }
+
+    const sp<MetaData> &meta = info.mMeta;
+    if (info.mType == VIDEO_TRACK_TYPE) {
+        meta->setInt32(kKeyWidth, width);
+        meta->setInt32(kKeyHeight, height);
+    } else if (info.mType == AUDIO_TRACK_TYPE) {
+        meta->setInt32(kKeySampleRate, sampleRate);
+        meta->setInt32(kKeyChannelCount, channelCount);
+        meta->setCString(kKeyMediaLanguage, language.string());
+    } else if (info.mType == SUBTITLE_TRACK_TYPE) {
+        meta->setCString(kKeyMediaLanguage, language.string());
+        meta->setCString(kKeySubtitleLanguage, language.string());
+    } else {
+        return ERROR_UNSUPPORTED;
+    }
+
+    const char *id = codecId.string();
+    const uint8_t *priv = (codecPrivate != NULL) ? codecPrivate->data() : NULL;
+    size_t privSize = (codecPrivate != NULL) ? codecPrivate->size() : 0;
+
+    if (info.mType == VIDEO_TRACK_TYPE) {
+        if (!strcmp(id, "V_MPEG4/ISO/AVC")) {
+            if (privSize < 7) {
+                return ERROR_MALFORMED;
+            }
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+            meta->setData(kKeyAVCC, 0, priv, privSize);
+            info.mNALSizeLen = (priv[4] & 3) + 1;
+        } else if (!strcmp(id, "V_MPEG4/ISO/SP")
+                || !strcmp(id, "V_MPEG4/ISO/ASP")
+                || !strcmp(id, "V_MPEG4/ISO/AP")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_MPEG4);
+            if (privSize > 0) {
+                addESDSFromCodecPrivate(meta, false, priv, privSize);
+            }
+        } else if (!strcmp(id, "V_VP8")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_VPX);
+        } else if (!strcmp(id, "V_MPEG1") || !strcmp(id, "V_MPEG2")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_M2V);
+            info.mInBandHeader = codecPrivate;
+            info.mInBandHeaderOnSeek = true;
+        } else if (!strcmp(id, "V_MJPEG")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_MJPEG);
+        } else if (!strcmp(id, "V_MS/VFW/FOURCC")) {
+            status_t err = parseVfwTrack(&info, codecPrivate);
+            if (err != OK) {
+                return err;
+            }
+        } else {
+            ALOGW("%s is not supported.", id);
+            return ERROR_UNSUPPORTED;
+        }
+    } else if (info.mType == AUDIO_TRACK_TYPE) {
+        if (!strcmp(id, "A_AAC") || !strncmp(id, "A_AAC/", 6)) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AAC);
+            uint8_t csd[2];
+            if (privSize >= 2) {
+                addESDSFromCodecPrivate(meta, true, priv, privSize);
+            } else if (makeAACCodecSpecificData(
+                        id, sampleRate, channelCount, csd) == OK) {
+                addESDSFromCodecPrivate(meta, true, csd, sizeof(csd));
+            } else {
+                return ERROR_MALFORMED;
+            }
+        } else if (!strcmp(id, "A_VORBIS")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_VORBIS);
+            status_t err = addVorbisCodecInfo(meta, priv, privSize);
+            if (err != OK) {
+                return err;
+            }
+        } else if (!strcmp(id, "A_MPEG/L3") || !strcmp(id, "A_MPEG/L2")
+                || !strcmp(id, "A_MPEG/L1")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_MPEG);
+        } else if (!strcmp(id, "A_FLAC")) {
+            status_t err = parseFlacTrack(&info, codecPrivate);
+            if (err != OK) {
+                return err;
+            }
+        } else if (!strcmp(id, "A_AC3")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AC3);
+        } else if (!strcmp(id, "A_DTS")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_DTS);
+        } else if (!strcmp(id, "A_PCM/INT/LIT")
+                && (bitDepth == 0 || bitDepth == 16)) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_RAW);
+        } else if (!strcmp(id, "A_MS/ACM")) {
+            // WAVEFORMATEX wrapped codecs are left to the prebuilt, see
+            // NeedsPrebuilt().
+            return ERROR_UNSUPPORTED;
+        } else {
+            ALOGW("%s is not supported.", id);
+            return ERROR_UNSUPPORTED;
+        }
+    } else {
+        if (!strcmp(id, "S_TEXT/UTF8")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_TEXT_MATROSKA_UTF8);
+        } else if (!strcmp(id, "S_TEXT/SSA") || !strcmp(id, "S_TEXT/ASS")
+                || !strcmp(id, "S_SSA") || !strcmp(id, "S_ASS")) {
+            meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_TEXT_MATROSKA_SSA);
+        } else if (!strcmp(id, "S_VOBSUB")) {
+            // Only the prebuilt decodes these into pictures.
+            return ERROR_UNSUPPORTED;
+        } else {
+            ALOGW("%s is not supported.", id);
+            return ERROR_UNSUPPORTED;
+        }
+    }
+
+    if (findTrackIndex(info.mTrackNum) >= 0) {
+        ALOGW("ignoring duplicate track %lu", info.mTrackNum);
+        return ERROR_MALFORMED;
+    }
+
+    mTracks.push(info);
+
+    return OK;
+}
+
+// The codec private data of V_MS/VFW/FOURCC tracks is a BITMAPINFOHEADER,
+// followed by the codec's own setup data.
+status_t MatroskaExtractor::parseVfwTrack(
+        TrackInfo *info, const sp<ABuffer> &codecPrivate) {
+    static const size_t kBitmapInfoHeaderSize = 40;
+
+    if (codecPrivate == NULL || codecPrivate->size() < kBitmapInfoHeaderSize) {
+        return ERROR_MALFORMED;
+    }
+
+    const uint8_t *priv = codecPrivate->data();
+    size_t headerSize = U32LE_AT(priv);
+    if (headerSize < kBitmapInfoHeaderSize
+            || headerSize > codecPrivate->size()) {
+        return ERROR_MALFORMED;
+    }
+
+    if (!isSupportedVfwFourcc(&priv[16])) {
+        // DivX 3, VC-1, AVC in VFW and the like, see NeedsPrebuilt().
+        ALOGV("leaving fourcc %.4s to the prebuilt extractor", &priv[16]);
+        return ERROR_UNSUPPORTED;
+    }
+
+    const sp<MetaData> &meta = info->mMeta;
+    if (!strncasecmp((const char *)&priv[16], "MJPG", 4)) {
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_MJPEG);
+    } else {
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_MPEG4);
+        if (codecPrivate->size() > headerSize) {
+            addESDSFromCodecPrivate(
+                    meta, false, priv + headerSize,
+                    codecPrivate->size() - headerSize);
+        }
+    }
+
+    return OK;
+}
+
+// The codec private data of A_FLAC tracks holds the "fLaC" marker and the
+// metadata blocks, starting with STREAMINFO. The decoder parses a native
+// FLAC stream, so they go in band ahead of the first frame. They are not
+// repeated after seeks since the decoder carries on from its state then.
+status_t MatroskaExtractor::parseFlacTrack(
+        TrackInfo *info, const sp<ABuffer> &codecPrivate) {
+    static const size_t kStreamInfoSize = 34;
+
+    if (codecPrivate == NULL || codecPrivate->size() < 8 + kStreamInfoSize) {
+        return ERROR_MALFORMED;
+    }
+
+    const uint8_t *priv = codecPrivate->data();
+    if (memcmp(priv, "fLaC", 4) || (priv[4] & 0x7f) != 0
+            || ((priv[5] << 16) | (priv[6] << 8) | priv[7])
+                    < (int)kStreamInfoSize) {
+        return ERROR_MALFORMED;
+    }
+
+    const uint8_t *si = &priv[8];
+    int32_t sampleRate = (si[10] << 12) | (si[11] << 4) | (si[12] >> 4);
+    int32_t channelCount = ((si[12] >> 1) & 7) + 1;
+    int32_t bitDepth = (((si[12] & 1) << 4) | (si[13] >> 4)) + 1;
+
+    if (sampleRate == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    const sp<MetaData> &meta = info->mMeta;
+    meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_FLAC);
+    meta->setInt32(kKeySampleRate, sampleRate);
+    meta->setInt32(kKeyChannelCount, channelCount);
+    meta->setInt32(kKeyBitDepth, bitDepth);
+
+    info->mInBandHeader = codecPrivate;
+    info->mInBandHeaderOnSeek = false;
+
+    return OK;
+}
+
+void MatroskaExtractor::findThumbnails() {
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        TrackInfo *info = &mTracks.editItemAt(i);
+        if (info->mType != VIDEO_TRACK_TYPE) {
+            continue;
+        }
+
+        // Use the largest of the first few sync frames.
+        static const size_t kMaxSyncFrames = 20;
+        static const size_t kMaxClusters = 10;
+
+        int64_t thumbnailTimeUs = 0;
+        size_t maxSize = 0;
+        size_t numSyncFrames = 0;
+
+        Mutex::Autolock autoLock(mLock);
+
+        sp<Cluster> cluster;
+        off64_t offset = mFirstClusterOffset;
+        for (size_t j = 0; j < kMaxClusters && numSyncFrames < kMaxSyncFrames;
+                ++j) {
+            sp<Cluster> next;
+            if (getCluster_l(offset, cluster, &next) != OK) {
+                break;
+            }
+            cluster = next;
+            offset = cluster->mNextOffset;
+
+            for (size_t k = 0; k < cluster->mFrames.size()
+                    && numSyncFrames < kMaxSyncFrames; ++k) {
+                const Frame &frame = cluster->mFrames.itemAt(k);
+                if (frame.mTrackNum != info->mTrackNum || !frame.mIsKey) {
+                    continue;
+                }
+
+                ++numSyncFrames;
+                if (frame.mSize > maxSize) {
+                    maxSize = frame.mSize;
+                    thumbnailTimeUs = frame.mTimeUs;
+                }
+            }
+        }
+
+        info->mMeta->setInt64(kKeyThumbnailTime, thumbnailTimeUs);
+    }
+}
+
+// static
+int MatroskaExtractor::CompareCuePoints(
+        const CuePoint *a, const CuePoint *b) {
+    if (a->mTimecode != b->mTimecode) {
+        return (a->mTimecode < b->mTimecode) ? -1 : 1;
+    }
+    return 0;
+}
+
+status_t MatroskaExtractor::loadCues_l() {
+    mCuesParsed = true;
+
+    if (mCuesOffset < 0) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    sp<ABuffer> cues;
+    status_t err = readElement(mCuesOffset, kCuesId, &cues);
+    if (err != OK) {
+        ALOGW("failed to read the cues (%d), scanning clusters instead", err);
+        return err;
+    }
+
+    bool sorted = true;
+
+    ElementIterator it(cues->data(), cues->size());
+    while (it.next()) {
+        if (it.mId != kCuePointId) {
+            continue;
+        }
+
+        int64_t timecode = -1;
+        size_t firstPosition = mCues.size();
+
+        ElementIterator point(it.mPayload, it.mPayloadSize);
+        while (point.next()) {
+            if (point.mId == kCueTimeId) {
+                timecode = readUInt(point.mPayload, point.mPayloadSize);
+            } else if (point.mId == kCueTrackPositionsId) {
+                CuePoint cue;
+                cue.mTimecode = -1;
+                cue.mTrackNum = 0;
+                cue.mClusterOffset = -1;
+
+                ElementIterator pos(point.mPayload, point.mPayloadSize);
+                while (pos.next()) {
+                    if (pos.mId == kCueTrackId) {
+                        cue.mTrackNum = readUInt(pos.mPayload, pos.mPayloadSize);
+                    } else if (pos.mId == kCueClusterPositionId) {
+                        cue.mClusterOffset = mSegmentDataOffset
+                            + readUInt(pos.mPayload, pos.mPayloadSize);
+                    }
+                }
+
+                if (cue.mClusterOffset >= mFirstClusterOffset
+                        && cue.mClusterOffset < mSegmentEnd) {
+                    mCues.push(cue);
+                }
+            }
+        }
+
+        if (timecode < 0) {
+            mCues.removeItemsAt(firstPosition, mCues.size() - firstPosition);
+            continue;
+        }
+
+        for (size_t i = firstPosition; i < mCues.size(); ++i) {
+            mCues.editItemAt(i).mTimecode = timecode;
+        }
+
+        if (firstPosition > 0
+                && mCues.size() > firstPosition
+                && mCues.itemAt(firstPosition - 1).mTimecode > timecode) {
+            sorted = false;
+        }
+    }
+
+    if (!sorted) {
+        mCues.sort(CompareCuePoints);
+    }
+
+    ALOGV("read %d cue points", mCues.size());
+
+    return OK;
+}
+
+status_t MatroskaExtractor::findClusterEnd(
+        off64_t payloadOffset, off64_t *end) {
+    // Walk the children of a cluster of unknown size until an element that
+    // can only appear at level 1 starts.
+    off64_t offset = payloadOffset;
+    while (offset < mSegmentEnd) {
+        uint32_t id;
+        uint64_t size;
+        size_t headerLen;
+        status_t err = readElementHeaderAt(
+                mDataSource, offset, &id, &size, &headerLen);
+        if (err != OK) {
+            break;
+        }
+
+        if (isLevel1Id(id)) {
+            break;
+        }
+
+        if (size == kUnknownSize) {
+            return ERROR_MALFORMED;
+        }
+
+        offset += headerLen + size;
+    }
+
+    *end = (offset < mSegmentEnd) ? offset : mSegmentEnd;
+
+    return OK;
+}
+
+status_t MatroskaExtractor::scanClusters_l(int64_t timeUs) {
+    if (mClusterScanOffset < 0) {
+        mClusterScanOffset = mFirstClusterOffset;
+    }
+
+    while (!mClusterScanDone
+            && (mClusterIndex.isEmpty()
+                || mClusterIndex.itemAt(mClusterIndex.size() - 1).mTimecode
+                        * mTimecodeScale / 1000 <= timeUs)) {
+        off64_t offset = mClusterScanOffset;
+        if (offset >= mSegmentEnd) {
+            mClusterScanDone = true;
+            break;
+        }
+
+        // The cluster header and its first child, which is the cluster's
+        // timecode with all muxers we know of, fit into one small read.
+        uint8_t buffer[2 * kMaxElementHeaderSize + 8];
+        ssize_t n = mDataSource->readAt(offset, buffer, sizeof(buffer));
+
+        uint32_t id;
+        uint64_t size;
+        size_t headerLen = (n > 0)
+            ? parseElementHeader(buffer, n, &id, &size) : 0;
+
+        if (headerLen == 0) {
+            mClusterScanDone = true;
+            break;
+        }
+
+        off64_t payloadOffset = offset + headerLen;
+        off64_t end;
+        if (size != kUnknownSize) {
+            end = payloadOffset + size;
+        } else if (id != kClusterId
+                || findClusterEnd(payloadOffset, &end) != OK) {
+            mClusterScanDone = true;
+            break;
+        }
+
+        if (id == kClusterId) {
+            uint32_t childId;
+            uint64_t childSize;
+            size_t childHeaderLen = parseElementHeader(
+                    buffer + headerLen, n - headerLen, &childId, &childSize);
+
+            int64_t timecode = -1;
+            if (childHeaderLen > 0 && childId == kTimecodeId
+                    && headerLen + childHeaderLen + childSize <= (size_t)n) {
+                timecode = readUInt(
+                        buffer + headerLen + childHeaderLen, childSize);
+            } else {
+                // Unusual layout, load the whole cluster.
+                sp<Cluster> cluster;
+                if (getCluster_l(offset, NULL, &cluster) == OK) {
+                    timecode = cluster->mTimecode;
+                }
+            }
+
+            if (timecode >= 0) {
+                ClusterPos pos;
+                pos.mTimecode = timecode;
+                pos.mOffset = offset;
+                mClusterIndex.push(pos);
+            }
+        }
+
+        mClusterScanOffset = end;
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::findCluster_l(
+        unsigned long trackNum, int64_t timeUs, off64_t *offset) {
+    *offset = mFirstClusterOffset;
+
+    if (!mCuesParsed) {
+        loadCues_l();
+    }
+
+    if (!mCues.isEmpty()) {
+        // Find the last cue point at or before timeUs, preferring one
+        // listed for this track.
+        size_t lo = 0;
+        size_t hi = mCues.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (mCues.itemAt(mid).mTimecode * mTimecodeScale / 1000 <= timeUs) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == 0) {
+            return OK;
+        }
+
+        size_t best = lo - 1;
+        for (size_t i = lo; i-- > 0;) {
+            if (mCues.itemAt(i).mTrackNum == trackNum) {
+                best = i;
+                break;
+            }
+        }
+
+        *offset = mCues.itemAt(best).mClusterOffset;
+
+        return OK;
+    }
+
+    scanClusters_l(timeUs);
+
+    size_t lo = 0;
+    size_t hi = mClusterIndex.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mClusterIndex.itemAt(mid).mTimecode * mTimecodeScale / 1000
+                <= timeUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo > 0) {
+        *offset = mClusterIndex.itemAt(lo - 1).mOffset;
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::getCluster_l(
+        off64_t offset, const sp<Cluster> &prev, sp<Cluster> *cluster) {
+    const Cluster *hint =
+        (prev != NULL && prev->mNextOffset == offset) ? prev.get() : NULL;
+
+    while (offset < mSegmentEnd) {
+        for (size_t i = mClusterCache.size(); i-- > 0;) {
+            if (mClusterCache.itemAt(i)->mOffset == offset) {
+                *cluster = mClusterCache.itemAt(i);
+                if (i + 1 < mClusterCache.size()) {
+                    mClusterCache.removeAt(i);
+                    mClusterCache.push(*cluster);
+                }
+                return OK;
+            }
+        }
+
+        uint32_t id;
+        uint64_t size;
+        size_t headerLen;
+        if (hint != NULL && hint->mNextHeaderLen > 0) {
+            id = hint->mNextId;
+            size = hint->mNextSize;
+            headerLen = hint->mNextHeaderLen;
+        } else {
+            status_t err = readElementHeaderAt(
+                    mDataSource, offset, &id, &size, &headerLen);
+            if (err != OK) {
+                return ERROR_END_OF_STREAM;
+            }
+        }
+        hint = NULL;
+
+        if (id == kClusterId) {
+            return loadCluster_l(offset, id, size, headerLen, cluster);
+        }
+
+        // Cues, tags and the like between or after the clusters.
+        if (size == kUnknownSize) {
+            return ERROR_END_OF_STREAM;
+        }
+        offset += headerLen + size;
+    }
+
+    return ERROR_END_OF_STREAM;
+}
+
+status_t MatroskaExtractor::loadCluster_l(
+        off64_t offset, uint32_t id, uint64_t size, size_t headerLen,
+        sp<Cluster> *out) {
+    off64_t payloadOffset = offset + headerLen;
+
+    off64_t end;
+    if (size == kUnknownSize) {
+        status_t err = findClusterEnd(payloadOffset, &end);
+        if (err != OK) {
+            return err;
+        }
+    } else {
+        end = payloadOffset + size;
+    }
+
+    off64_t available = end;
+    if (available > mSegmentEnd) {
+        available = mSegmentEnd;
+    }
+
+    if (available - payloadOffset > (off64_t)kMaxClusterSize) {
+        ALOGE("cluster at %lld is too large", offset);
+        return ERROR_MALFORMED;
+    }
+
+    size_t payloadSize = available - payloadOffset;
+
+    // Read the header of the element following the cluster along with it,
+    // unless the cluster is cut short by the end of the data.
+    size_t readSize = payloadSize;
+    if (end == available) {
+        readSize += kMaxElementHeaderSize;
+    }
+
+    sp<ABuffer> data = new ABuffer(readSize);
+    ssize_t n = mDataSource->readAt(payloadOffset, data->data(), readSize);
+    if (n <= 0) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    sp<Cluster> cluster = new Cluster;
+    cluster->mOffset = offset;
+    cluster->mNextOffset = end;
+    cluster->mTimecode = 0;
+    cluster->mNextId = 0;
+    cluster->mNextSize = 0;
+    cluster->mNextHeaderLen = 0;
+
+    if ((size_t)n > payloadSize) {
+        cluster->mNextHeaderLen = parseElementHeader(
+                data->data() + payloadSize, n - payloadSize,
+                &cluster->mNextId, &cluster->mNextSize);
+    } else if ((size_t)n < payloadSize) {
+        // Truncated, use what is there.
+        payloadSize = n;
+        cluster->mNextOffset = payloadOffset + n;
+    }
+
+    data->setRange(0, payloadSize);
+    cluster->mData = data;
+
+    status_t err = parseCluster(cluster);
+    if (err != OK) {
+        return err;
+    }
+
+    mClusterCache.push(cluster);
+    if (mClusterCache.size() > kMaxCachedClusters) {
+        mClusterCache.removeAt(0);
+    }
+
+    *out = cluster;
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseCluster(const sp<Cluster> &cluster) {
+    const uint8_t *data = cluster->mData->data();
+    size_t size = cluster->mData->size();
+
+    ElementIterator it(data, size);
+    while (it.next()) {
+        if (it.mId == kTimecodeId) {
+            cluster->mTimecode = readUInt(it.mPayload, it.mPayloadSize);
+            break;
+        }
+    }
+
+    it = ElementIterator(data, size);
+    while (it.next()) {
+        if (it.mId == kSimpleBlockId) {
+            parseBlock(cluster, it.mPayload, it.mPayloadSize,
+                       true /* simpleBlock */, false, -1);
+        } else if (it.mId == kBlockGroupId) {
+            const uint8_t *block = NULL;
+            size_t blockSize = 0;
+            bool hasReference = false;
+            int64_t durationTicks = -1;
+
+            ElementIterator group(it.mPayload, it.mPayloadSize);
+            while (group.next()) {
+                if (group.mId == kBlockId) {
+                    block = group.mPayload;
+                    blockSize = group.mPayloadSize;
+                } else if (group.mId == kReferenceBlockId) {
+                    hasReference = true;
+                } else if (group.mId == kBlockDurationId) {
+                    durationTicks =
+                        readUInt(group.mPayload, group.mPayloadSize);
+                }
+            }
+
+            if (block != NULL) {
+                parseBlock(cluster, block, blockSize,
+                           false /* simpleBlock */, hasReference,
+                           durationTicks);
+            }
+        }
+    }
+
+    // Turn the NAL length prefixes of AVC frames into start codes where
+    // that can be done in place.
+    for (size_t i = 0; i < cluster->mFrames.size(); ++i) {
+        const Frame &frame = cluster->mFrames.itemAt(i);
+        const TrackInfo &track =
+            mTracks.itemAt(findTrackIndex(frame.mTrackNum));
+
+        if (track.mNALSizeLen != 4 || track.mCompAlgo >= 0) {
+            continue;
+        }
+
+        uint8_t *ptr = cluster->mData->data() + frame.mOffset;
+        if (convertNALLengthsToStartCodes(ptr, frame.mSize, 4, NULL)
+                == (ssize_t)frame.mSize) {
+            convertNALLengthsToStartCodes(ptr, frame.mSize, 4, ptr);
+        }
+    }
+
+    return OK;
+}
+
+status_t MatroskaExtractor::parseBlock(
+        const sp<Cluster> &cluster, const uint8_t *block, size_t size,
+        bool simpleBlock, bool hasReference, int64_t durationTicks) {
+    uint64_t trackNum;
+    size_t offset = parseVInt(block, size, false /* keepMarker */, &trackNum);
+    if (offset == 0 || offset + 3 > size) {
+        return ERROR_MALFORMED;
+    }
+
+    ssize_t trackIndex = findTrackIndex(trackNum);
+    if (trackIndex < 0) {
+        return OK;
+    }
+    const TrackInfo &track = mTracks.itemAt(trackIndex);
+
+    int16_t relativeTimecode = (int16_t)((block[offset] << 8) | block[offset + 1]);
+    uint8_t flags = block[offset + 2];
+    offset += 3;
+
+    int64_t timecode = cluster->mTimecode + relativeTimecode;
+    int64_t timeUs = (timecode > 0) ? timecode * mTimecodeScale / 1000 : 0;
+
+    Frame frame;
+    frame.mTrackNum = trackNum;
+    frame.mIsKey = simpleBlock ? (flags & 0x80) != 0 : !hasReference;
+    frame.mDurationUs =
+        (durationTicks >= 0) ? durationTicks * mTimecodeScale / 1000 : -1;
+    if (frame.mDurationUs < 0 && track.mDefaultDurationNs > 0) {
+        frame.mDurationUs = track.mDefaultDurationNs / 1000;
+    }
+
+    size_t blockOffset = block - cluster->mData->data();
+
+    uint32_t lacing = (flags >> 1) & 3;
+    if (lacing == 0) {
+        frame.mTimeUs = timeUs;
+        frame.mOffset = blockOffset + offset;
+        frame.mSize = size - offset;
+        cluster->mFrames.push(frame);
+        return OK;
+    }
+
+    if (offset >= size) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t numFrames = block[offset++] + 1;
+
+    // Sizes of all but the last frame, which takes what is left.
+    Vector<size_t> sizes;
+    size_t total = 0;
+
+    if (lacing == 1) {
+        // Xiph
+        for (size_t i = 0; i + 1 < numFrames; ++i) {
+            size_t frameSize = 0;
+            uint8_t byte;
+            do {
+                if (offset >= size) {
+                    return ERROR_MALFORMED;
+                }
+                byte = block[offset++];
+                frameSize += byte;
+            } while (byte == 0xff);
+
+            sizes.push(frameSize);
+            total += frameSize;
+        }
+    } else if (lacing == 3) {
+        // EBML, the first size is coded as is, the others as the signed
+        // difference to the one before.
+        int64_t frameSize = 0;
+        for (size_t i = 0; i + 1 < numFrames; ++i) {
+            uint64_t x;
+            size_t len = parseVInt(
+                    block + offset, size - offset, false /* keepMarker */, &x);
+            if (len == 0 || x == kUnknownSize) {
+                return ERROR_MALFORMED;
+            }
+            offset += len;
+
+            if (i == 0) {
+                frameSize = x;
+            } else {
+                frameSize += (int64_t)x - ((1ll << (7 * len - 1)) - 1);
+            }
+
+            if (frameSize < 0) {
+                return ERROR_MALFORMED;
+            }
+
+            sizes.push(frameSize);
+            total += frameSize;
+        }
+    } else {
+        // Fixed size
+        if ((size - offset) % numFrames) {
+            return ERROR_MALFORMED;
+        }
+
+        size_t frameSize = (size - offset) / numFrames;
+        for (size_t i = 0; i + 1 < numFrames; ++i) {
+            sizes.push(frameSize);
+            total += frameSize;
+        }
+    }
+
+    if (offset + total > size) {
+        return ERROR_MALFORMED;
+    }
+    sizes.push(size - offset - total);
+
+    // Laced frames only carry the time of the first one, the others are
+    // spaced by the track's default duration if it has one.
+    int64_t frameDurationUs = track.mDefaultDurationNs / 1000;
+    for (size_t i = 0; i < numFrames; ++i) {
+        frame.mTimeUs = timeUs + i * frameDurationUs;
+        frame.mOffset = blockOffset + offset;
+        frame.mSize = sizes.itemAt(i);
+        cluster->mFrames.push(frame);
+
+        offset += frame.mSize;
+    }
+
+    return OK;
+}
+
+bool SniffMatroska(
+        const sp<DataSource> &source, String8 *mimeType, float *confidence,
+        sp<AMessage> *) {
+    uint8_t header[256];
+    ssize_t n = source->readAt(0, header, sizeof(header));
+    if (n < (ssize_t)kMaxElementHeaderSize) {
+        return false;
+    }
+
+    uint32_t id;
+    uint64_t size;
+    size_t headerLen = parseElementHeader(header, n, &id, &size);
+    if (headerLen == 0 || id != kEBMLHeaderId || size == kUnknownSize) {
+        return false;
+    }
+
+    if (size > n - headerLen) {
+        size = n - headerLen;
+    }
+
+    ElementIterator it(header + headerLen, size);
+    while (it.next()) {
+        if (it.mId != kDocTypeId) {
+            continue;
+        }
+
+        String8 docType((const char *)it.mPayload, it.mPayloadSize);
+        if (docType == "matroska" || docType == "webm") {
+            mimeType->setTo(MEDIA_MIMETYPE_CONTAINER_MATROSKA);
+            *confidence = MATROSKA_CONTAINER_CONFIDENCE;
+            return true;
+        }
+        break;
+    }
+
+    return false;
+}
+
+}  // namespace android
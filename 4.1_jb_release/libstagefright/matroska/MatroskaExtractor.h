@@ -19,30 +19,16 @@
 #define MATROSKA_EXTRACTOR_H_
 
 #include <media/stagefright/MediaExtractor.h>
-#include <media/stagefright/MediaBuffer.h>
-
+#include <utils/threads.h>
 #include <utils/Vector.h>
-#include "dvdsubdec.h"
-
-#define MKV_SUB_LANGUAGE_LEN 5
-#define MKV_SUB_NAME_LEN 100
-
-#define MKV_SKIP_SEEK_TIME_DELTA_US 500000  /* 500 ms*/
-#define MKV_SKIP_SEEK_SYS_TIME_DELTA_US 5000000ll  /* 5s */
-
-namespace mkvparser {
-struct Segment;
-};
 
 namespace android {
 
-typedef struct MKVTrackDecSpeciInfo
-{
-	int32_t	Audio_extradata_size;
-	const uint8_t	*Audio_extradata;
-	int32_t	aac_type;
-	int32_t	aac_header_len;
-}MKVAACDecSpeciInfo;
+struct ABuffer;
+struct AMessage;
+class String8;
+
+struct MatroskaSource;
 
 typedef enum
 {
@@ -53,39 +39,6 @@ typedef enum
     TRACK_TYPE_BUTT     ,
 }MATROSKA_TRACK_TYPE;
 
-typedef struct BuiltInSubDataBuf
-{
-    uint8_t* data;
-    uint32_t size;
-    int64_t  timeMs;
-    uint32_t durationMs;
-    uint32_t capability;
-}BuiltInSubDataBuf;
-
-typedef struct SubtitleTrkInfo{
-    long    trackNumber;
-    char    nameAsUTF8[MKV_SUB_NAME_LEN];
-    char    codecId[MKV_SUB_NAME_LEN];
-    uint8_t codecIdLen;
-    uint8_t nameLen;
-    char language[MKV_SUB_LANGUAGE_LEN];
-
-}SubtitleTrkInfo;
-
-typedef struct AudioTrkInfo{
-    long    trackNumber;
-    char    codecId[MKV_SUB_NAME_LEN];
-    uint8_t codecIdLen;
-    char language[MKV_SUB_LANGUAGE_LEN];
-
-}AudioTrkInfo;
-
-
-typedef struct AvcFrameBuffer {
-    uint8_t* buf;
-    uint32_t capability;
-}AvcFrameBuffer;
-
 typedef enum {
   MATROSKA_TRACK_ENCODING_COMP_ZLIB        = 0,
   MATROSKA_TRACK_ENCODING_COMP_BZLIB       = 1,
@@ -93,57 +46,6 @@ typedef enum {
   MATROSKA_TRACK_ENCODING_COMP_HEADERSTRIP = 3,
 } MatroskaTrackEncodingCompAlgo;
 
-typedef enum {
-  ZLIB_INFLATE_END_FAIL                    = -2,
-  ZLIB_INFLATE_INIT_FAIL                   = -1,
-  ZLIB_DEC_OK                              = 0,
-} ZlibDecBufErrCode;
-
-typedef struct
-{
-    uint16_t  FormatTag;
-    uint16_t  Channels;
-    uint32_t  SamplesPerSec;
-    uint32_t  AvgBytesPerSec;
-    uint16_t  BlockAlign;
-    uint16_t  BitsPerSample;
-    uint16_t  Size;
-    uint16_t  SamplesPerBlock;
-
-}MkvWaveFormatExStruct;
-
-typedef struct
-{
-    uint32_t    start_code;
-    uint32_t    size;
-    uint32_t    timel;
-    uint32_t    timeh;
-    uint32_t    type;
-    uint32_t    slices;
-    uint32_t    retFlag;
-    uint32_t    res[1];
-}MkvMpeg2VideoSteamHead;
-
-typedef struct
-{
-    uint32_t    headLen;
-    uint8_t*    data;
-
-}MkvVC1StreamRCVInfo;
-
-typedef struct
-{
-    uint32_t    len;
-    uint8_t*    data;
-    uint8_t     sendFlag;
-}MkvVC1ExtraInfo;
-
-struct AMessage;
-class String8;
-
-struct DataSourceReader;
-struct MatroskaSource;
-
 struct MatroskaExtractor : public MediaExtractor {
     MatroskaExtractor(const sp<DataSource> &source);
 
@@ -160,11 +62,11 @@ struct MatroskaExtractor : public MediaExtractor {
 
     virtual sp<MetaData> getMetaData();
 
-    MkvWaveFormatExStruct mWavFormat;
-    BuiltInSubDataBuf mSubDataBuf;
-    bool mVideoEndFlag;
-    Vector<MediaSource*> mSourceQue;
-    MediaSource* m_SelectSubtileSrc;
+    // True if the file has tracks this extractor does not handle but the
+    // prebuilt one does, see PrebuiltMatroskaExtractor.h. Reads no more
+    // than the codec ids in Tracks, so that such files are not opened
+    // twice.
+    static bool NeedsPrebuilt(const sp<DataSource> &source);
 
 protected:
     virtual ~MatroskaExtractor();
@@ -174,51 +76,133 @@ private:
 
     struct TrackInfo {
         unsigned long mTrackNum;
+        int32_t mType;              // MATROSKA_TRACK_TYPE
         sp<MetaData> mMeta;
+
+        int64_t mDefaultDurationNs; // 0 if not given.
+
+        // Bytes of length prefix in front of every AVC NAL unit, 0 for
+        // all other codecs.
+        size_t mNALSizeLen;
+
+        // The ContentCompression applying to the frames, -1 for none.
+        int32_t mCompAlgo;
+        sp<ABuffer> mCompSettings;
+
+        // Handed out in front of the first frame after start, and after
+        // seeks as well if mInBandHeaderOnSeek is set, for decoders that
+        // expect the sequence or stream header in band.
+        sp<ABuffer> mInBandHeader;
+        bool mInBandHeaderOnSeek;
+    };
+
+    // One frame of a cluster, laced frames each get an entry of their own.
+    struct Frame {
+        unsigned long mTrackNum;
+        int64_t mTimeUs;
+        int64_t mDurationUs;        // -1 if unknown.
+        size_t mOffset;             // Into Cluster::mData.
+        size_t mSize;
+        bool mIsKey;
+    };
+
+    // A cluster loaded in a single read, its blocks split into frames
+    // which refer to the cluster's data rather than copy it.
+    struct Cluster : public RefBase {
+        off64_t mOffset;            // Of the cluster's element header.
+        off64_t mNextOffset;        // Of the element following it.
+        int64_t mTimecode;
+        sp<ABuffer> mData;
+        Vector<Frame> mFrames;
+
+        // Header of the element at mNextOffset if it was read along with
+        // this cluster, saving a separate read when that is loaded next.
+        uint32_t mNextId;
+        uint64_t mNextSize;
+        size_t mNextHeaderLen;      // 0 if not known.
+    };
+
+    struct CuePoint {
+        int64_t mTimecode;
+        unsigned long mTrackNum;
+        off64_t mClusterOffset;     // Absolute.
     };
-    Vector<TrackInfo> mTracks;
+
+    struct ClusterPos {
+        int64_t mTimecode;
+        off64_t mOffset;
+    };
+
+    enum {
+        kMaxCachedClusters = 4,
+    };
+
+    Mutex mLock;
 
     sp<DataSource> mDataSource;
-    DataSourceReader *mReader;
-    mkvparser::Segment *mSegment;
-    bool mExtractedThumbnails;
+    off64_t mFileSize;              // -1 if unknown.
+
+    status_t mInitCheck;
 
-    MKVAACDecSpeciInfo dec_specinfo;
-    bool mAudioUnSupported;
-    bool mVideoUnSupported;
-    MkvVC1StreamRCVInfo mVC1RcvHead;
-    MkvVC1ExtraInfo mVC1ExtraInfo;
-    bool mHaveBuiltInSubtitle;
-    Vector<SubtitleTrkInfo> mSubTrackInfo;
-    Vector<AudioTrkInfo> mAudioTrackInfo;
+    off64_t mSegmentDataOffset;
+    off64_t mSegmentEnd;            // Clamped to the file size if known.
+    int64_t mTimecodeScale;         // ns per timecode tick.
+    int64_t mDurationUs;            // -1 if unknown.
 
-    void addVorbisCodecInfo(
-        const sp<MetaData> &meta,
-        const void *_codecPrivate, size_t codecPrivateSize);
+    off64_t mFirstClusterOffset;
+    off64_t mCuesOffset;            // -1 if not known.
+
+    bool mCuesParsed;
+    Vector<CuePoint> mCues;
+
+    // Cluster start times, gathered by walking the cluster headers when
+    // there are no usable cues. Covers the clusters up to
+    // mClusterScanOffset.
+    Vector<ClusterPos> mClusterIndex;
+    off64_t mClusterScanOffset;
+    bool mClusterScanDone;
+
+    Vector<sp<Cluster> > mClusterCache;
+
+    Vector<TrackInfo> mTracks;
+    bool mExtractedThumbnails;
+    bool mIsWebm;
+
+    status_t parseHeaders();
+    status_t parseInfo(const uint8_t *data, size_t size);
+    status_t parseTracks(const uint8_t *data, size_t size);
+    status_t parseTrackEntry(const uint8_t *data, size_t size);
+    status_t parseVfwTrack(
+            TrackInfo *info, const sp<ABuffer> &codecPrivate);
+    status_t parseFlacTrack(
+            TrackInfo *info, const sp<ABuffer> &codecPrivate);
+    status_t parseSeekHead(
+            const uint8_t *data, size_t size,
+            off64_t *infoOffset, off64_t *tracksOffset);
+    status_t readElement(
+            off64_t offset, uint32_t expectedId, sp<ABuffer> *payload);
 
-    void addTracks();
     void findThumbnails();
-    void processAACDecoderSpecificInfo(const uint8_t* data,
-            size_t size,
-            const double sampleRate,
-            long long channelNum);
-
-    int32_t  MkvAACGetConfig();
-    void sendBuiltInSubtitleInfo();
-    void sendAudioTrackInfo();
-    void selectBuiltInSubtitleTrack(int aIdx);
-
-	ZlibDecBufErrCode zLibDecBuf(uint8_t* srcData,
-            size_t srcSize,
-            uint8_t** dstData,
-            size_t* dstBufSize,
-            size_t *dstDataSize);
-
-    void makeVC1RcvHead(uint32_t codecFourCC,
-            uint8_t* codecPrivateData,
-            uint32_t codecPrivateSize,
-            uint32_t width,
-            uint32_t height);
+
+    static int CompareCuePoints(const CuePoint *a, const CuePoint *b);
+    status_t loadCues_l();
+    status_t scanClusters_l(int64_t timeUs);
+    status_t findCluster_l(
+            unsigned long trackNum, int64_t timeUs, off64_t *offset);
+
+    status_t getCluster_l(
+            off64_t offset, const sp<Cluster> &prev, sp<Cluster> *cluster);
+    status_t loadCluster_l(
+            off64_t offset, uint32_t id, uint64_t size, size_t headerLen,
+            sp<Cluster> *cluster);
+    status_t parseCluster(const sp<Cluster> &cluster);
+    status_t parseBlock(
+            const sp<Cluster> &cluster, const uint8_t *block, size_t size,
+            bool simpleBlock, bool hasReference, int64_t durationTicks);
+    status_t findClusterEnd(
+            off64_t payloadOffset, off64_t *end);
+
+    ssize_t findTrackIndex(unsigned long trackNum) const;
 
     MatroskaExtractor(const MatroskaExtractor &);
     MatroskaExtractor &operator=(const MatroskaExtractor &);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PREBUILT_MATROSKA_EXTRACTOR_H_
+
+#define PREBUILT_MATROSKA_EXTRACTOR_H_
+
+#include <media/stagefright/MediaExtractor.h>
+
+#include <utils/Vector.h>
+
+// The vendor Matroska extractor in libstagefright_matroska_prebuilt.a,
+// which is the former libstagefright_matroska.a with every symbol it
+// defines renamed (see prebuilt_symbols.sh) so that it links next to the
+// source one. It is only used for the tracks
+// MatroskaExtractor leaves to it, see MatroskaExtractor::NeedsPrebuilt().
+//
+// The declaration below is the one the archive was compiled against and
+// must not change.
+
+#define MKV_SUB_LANGUAGE_LEN 5
+#define MKV_SUB_NAME_LEN 100
+
+namespace mkvparser {
+struct Segment;
+};
+
+namespace android {
+
+typedef struct MKVTrackDecSpeciInfo
+{
+	int32_t	Audio_extradata_size;
+	const uint8_t	*Audio_extradata;
+	int32_t	aac_type;
+	int32_t	aac_header_len;
+}MKVAACDecSpeciInfo;
+
+typedef struct BuiltInSubDataBuf
+{
+    uint8_t* data;
+    uint32_t size;
+    int64_t  timeMs;
+    uint32_t durationMs;
+    uint32_t capability;
+}BuiltInSubDataBuf;
+
+typedef struct SubtitleTrkInfo{
+    long    trackNumber;
+    char    nameAsUTF8[MKV_SUB_NAME_LEN];
+    char    codecId[MKV_SUB_NAME_LEN];
+    uint8_t codecIdLen;
+    uint8_t nameLen;
+    char language[MKV_SUB_LANGUAGE_LEN];
+
+}SubtitleTrkInfo;
+
+typedef struct AudioTrkInfo{
+    long    trackNumber;
+    char    codecId[MKV_SUB_NAME_LEN];
+    uint8_t codecIdLen;
+    char language[MKV_SUB_LANGUAGE_LEN];
+
+}AudioTrkInfo;
+
+typedef struct
+{
+    uint16_t  FormatTag;
+    uint16_t  Channels;
+    uint32_t  SamplesPerSec;
+    uint32_t  AvgBytesPerSec;
+    uint16_t  BlockAlign;
+    uint16_t  BitsPerSample;
+    uint16_t  Size;
+    uint16_t  SamplesPerBlock;
+
+}MkvWaveFormatExStruct;
+
+typedef struct
+{
+    uint32_t    headLen;
+    uint8_t*    data;
+
+}MkvVC1StreamRCVInfo;
+
+typedef struct
+{
+    uint32_t    len;
+    uint8_t*    data;
+    uint8_t     sendFlag;
+}MkvVC1ExtraInfo;
+
+struct DataSourceReader;
+
+struct PrebuiltMatroskaExtractor : public MediaExtractor {
+    PrebuiltMatroskaExtractor(const sp<DataSource> &source);
+
+    virtual size_t countTracks();
+
+    size_t countSubtitleTracks();
+
+    size_t countAudioTracks();
+
+    virtual sp<MediaSource> getTrack(size_t index);
+
+    virtual sp<MetaData> getTrackMetaData(
+            size_t index, uint32_t flags);
+
+    virtual sp<MetaData> getMetaData();
+
+    MkvWaveFormatExStruct mWavFormat;
+    BuiltInSubDataBuf mSubDataBuf;
+    bool mVideoEndFlag;
+    Vector<MediaSource*> mSourceQue;
+    MediaSource* m_SelectSubtileSrc;
+
+protected:
+    virtual ~PrebuiltMatroskaExtractor();
+
+private:
+    struct TrackInfo {
+        unsigned long mTrackNum;
+        sp<MetaData> mMeta;
+    };
+    Vector<TrackInfo> mTracks;
+
+    sp<DataSource> mDataSource;
+    DataSourceReader *mReader;
+    mkvparser::Segment *mSegment;
+    bool mExtractedThumbnails;
+
+    MKVAACDecSpeciInfo dec_specinfo;
+    bool mAudioUnSupported;
+    bool mVideoUnSupported;
+    MkvVC1StreamRCVInfo mVC1RcvHead;
+    MkvVC1ExtraInfo mVC1ExtraInfo;
+    bool mHaveBuiltInSubtitle;
+    Vector<SubtitleTrkInfo> mSubTrackInfo;
+    Vector<AudioTrkInfo> mAudioTrackInfo;
+
+    PrebuiltMatroskaExtractor(const PrebuiltMatroskaExtractor &);
+    PrebuiltMatroskaExtractor &operator=(const PrebuiltMatroskaExtractor &);
+};
+
+}  // namespace android
+
+#endif  // PREBUILT_MATROSKA_EXTRACTOR_H_
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Prints prebuilt_symbols.map for the vendor Matroska extractor archive
+# given as $1, the former matroska/libstagefright_matroska.a. The archive
+# the build links is made from it with
+#
+#   llvm-objcopy --redefine-syms=prebuilt_symbols.map \
+#           libstagefright_matroska.a libstagefright_matroska_prebuilt.a
+#
+# Every symbol the archive defines is renamed, so that nothing in it binds
+# to or interposes on anything else in libstagefright:
+#
+#  - MatroskaExtractor, MatroskaSource and SniffMatroska become
+#    PrebuiltMatroskaExtractor, PrebuiltMatroskaSource and
+#    PrebuiltSniffMatroska, the names PrebuiltMatroskaExtractor.h declares.
+#  - Everything else moves from namespace android to android_prebuilt and
+#    from mkvparser to mkvparser_prebuilt. That covers BlockIterator,
+#    DataSourceReader, the bundled mkvparser, and the weak copies of
+#    framework templates and inline functions the archive was built with.
+#
+# The COMDAT group signatures are renamed along with the symbols, or the
+# linker could keep another object's group of the same name instead of the
+# archive's and leave the renamed symbols undefined.
+
+NM=${NM:-nm}
+READELF=${READELF:-readelf}
+
+( $NM --defined-only -g "$1" | awk 'NF == 3 && $2 ~ /[A-Z]/ { print $3 }'
+  $READELF -g "$1" | sed -n 's/^COMDAT group section .*\[\(.*\)\] contains.*/\1/p' ) \
+        | sort -u | while read sym; do
+    new=`echo "$sym" | sed -e 's/17MatroskaExtractor/25PrebuiltMatroskaExtractor/g' \
+                           -e 's/14MatroskaSource/22PrebuiltMatroskaSource/g' \
+                           -e 's/13SniffMatroska/21PrebuiltSniffMatroska/g'`
+
+    if [ "$new" = "$sym" ]; then
+        new=`echo "$sym" | sed -e 's/7android/16android_prebuilt/g' \
+                               -e 's/9mkvparser/18mkvparser_prebuilt/g'`
+    fi
+
+    if [ "$new" = "$sym" ]; then
+        echo "$0: don't know how to rename $sym" >&2
+        exit 1
+    fi
+
+    echo "$sym $new"
+done
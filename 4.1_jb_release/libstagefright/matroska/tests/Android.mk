@@ -0,0 +1,63 @@
+# Build the unit tests.
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := MatroskaExtractor_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	MatroskaExtractor_test.cpp \
+	MKVGenerator.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright \
+	libstagefright_foundation \
+	libstlport \
+	libutils \
+	libz \
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_matroska \
+	libgtest \
+	libgtest_main \
+
+LOCAL_C_INCLUDES := \
+	bionic \
+	bionic/libstdc++/include \
+	external/gtest/include \
+	external/stlport/stlport \
+	external/zlib \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax \
+
+LOCAL_CFLAGS += -Wno-multichar
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        mkv_extractor_bench.cpp \
+        MKVGenerator.cpp        \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation libz
+
+LOCAL_STATIC_LIBRARIES := \
+        libstagefright_matroska
+
+LOCAL_C_INCLUDES:= \
+	external/zlib \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS += -Wno-multichar
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= mkv_extractor_bench
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,782 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MKVGenerator"
+#include <utils/Log.h>
+
+#include "MKVGenerator.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace android {
+
+static const int64_t kVideoFrameDurationUs = 40000;
+static const int64_t kAudioFrameDurationNs = 1024 * 1000000000ll / 44100;
+static const int64_t kSubtitleIntervalUs = 2000000;
+static const int64_t kSubtitleDurationUs = 1500000;
+static const size_t kFixedAudioFrameSize = 200;
+
+// AAC LC, 44.1kHz, stereo.
+static const uint8_t kAACConfig[] = { 0x12, 0x10 };
+
+// SPS/PPS for 320x240 baseline, the NAL length size gets patched in.
+static const uint8_t kAVCC[] = {
+    0x01, 0x42, 0xc0, 0x0d, 0xff, 0xe1,
+    0x00, 0x09, 0x67, 0x42, 0xc0, 0x0d, 0xda, 0x05, 0x07, 0xe8, 0x40,
+    0x01, 0x00, 0x04, 0x68, 0xce, 0x3c, 0x80,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Writes EBML into a byte vector. Master elements get an 8 byte size
+// that is filled in once they are closed.
+struct EBMLWriter {
+    EBMLWriter(Vector<uint8_t> *out)
+        : mOut(out) {
+    }
+
+    size_t offset() const {
+        return mOut->size();
+    }
+
+    void writeBytes(const void *data, size_t size) {
+        mOut->appendArray((const uint8_t *)data, size);
+    }
+
+    void writeByte(uint8_t x) {
+        mOut->push(x);
+    }
+
+    void writeId(uint32_t id) {
+        int shift = 24;
+        while (shift > 0 && !(id >> shift)) {
+            shift -= 8;
+        }
+        for (; shift >= 0; shift -= 8) {
+            writeByte(id >> shift);
+        }
+    }
+
+    void writeVInt(uint64_t x) {
+        size_t len = 1;
+        while (len < 8 && x >= (1ull << (7 * len)) - 1) {
+            ++len;
+        }
+        writeVInt(x, len);
+    }
+
+    void writeVInt(uint64_t x, size_t len) {
+        x |= 1ull << (7 * len);
+        for (size_t i = len; i-- > 0;) {
+            writeByte(x >> (8 * i));
+        }
+    }
+
+    void writeUInt(uint32_t id, uint64_t x) {
+        size_t len = 1;
+        while (len < 8 && (x >> (8 * len))) {
+            ++len;
+        }
+        writeId(id);
+        writeVInt(len);
+        for (size_t i = len; i-- > 0;) {
+            writeByte(x >> (8 * i));
+        }
+    }
+
+    // Always 8 bytes so that it can be patched.
+    size_t writeFixedUInt(uint32_t id, uint64_t x) {
+        writeId(id);
+        writeVInt(8);
+        size_t pos = offset();
+        for (size_t i = 8; i-- > 0;) {
+            writeByte(x >> (8 * i));
+        }
+        return pos;
+    }
+
+    void patchUInt(size_t pos, uint64_t x) {
+        for (size_t i = 0; i < 8; ++i) {
+            mOut->editItemAt(pos + i) = x >> (8 * (7 - i));
+        }
+    }
+
+    void writeFloat(uint32_t id, double x) {
+        union { double d; uint64_t u; } value;
+        value.d = x;
+        writeId(id);
+        writeVInt(8);
+        for (size_t i = 8; i-- > 0;) {
+            writeByte(value.u >> (8 * i));
+        }
+    }
+
+    void writeString(uint32_t id, const char *s) {
+        writeBinary(id, s, strlen(s));
+    }
+
+    void writeBinary(uint32_t id, const void *data, size_t size) {
+        writeId(id);
+        writeVInt(size);
+        writeBytes(data, size);
+    }
+
+    void startElement(uint32_t id, bool unknownSize = false) {
+        writeId(id);
+        mOpen.push(offset());
+        mUnknown.push(unknownSize);
+        writeVInt(unknownSize ? 0xffffffffffffffull : 0, 8);
+    }
+
+    void endElement() {
+        size_t pos = mOpen.itemAt(mOpen.size() - 1);
+        bool unknownSize = mUnknown.itemAt(mUnknown.size() - 1) != 0;
+        mOpen.pop();
+        mUnknown.pop();
+
+        if (unknownSize) {
+            return;
+        }
+
+        uint64_t size = offset() - pos - 8;
+        uint64_t x = size | (1ull << 56);
+        for (size_t i = 0; i < 8; ++i) {
+            mOut->editItemAt(pos + i) = x >> (8 * (7 - i));
+        }
+    }
+
+private:
+    Vector<uint8_t> *mOut;
+    Vector<size_t> mOpen;
+    Vector<uint8_t> mUnknown;
+
+    DISALLOW_EVIL_CONSTRUCTORS(EBMLWriter);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+MKVGenerator::Params::Params()
+    : mDurationUs(10000000ll),
+      mWebm(false),
+      mHasVideo(true),
+      mSyncInterval(25),
+      mFrameSize(2000),
+      mNALLengthSize(4),
+      mUseBlockGroups(false),
+      mHeaderStripping(false),
+      mHasAudio(true),
+      mAudioLacing(LACING_NONE),
+      mFramesPerLace(1),
+      mHasSubtitles(false),
+      mClusterDurationUs(2000000ll),
+      mClustersAtSyncFrames(true),
+      mWriteCues(true),
+      mUnknownSizes(false),
+      mVideoCodecId(NULL),
+      mAudioCodecId(NULL),
+      mSubtitleCodecId(NULL) {
+}
+
+// static
+int64_t MKVGenerator::VideoFrameTimeUs(uint32_t index) {
+    return index * kVideoFrameDurationUs;
+}
+
+// static
+uint32_t MKVGenerator::CountVideoFrames(const Params &params) {
+    return params.mHasVideo ? params.mDurationUs / kVideoFrameDurationUs : 0;
+}
+
+// static
+uint32_t MKVGenerator::CountAudioFrames(const Params &params) {
+    if (!params.mHasAudio) {
+        return 0;
+    }
+    return (params.mDurationUs * 1000 + kAudioFrameDurationNs - 1)
+        / kAudioFrameDurationNs;
+}
+
+// static
+uint32_t MKVGenerator::CountSubtitles(const Params &params) {
+    if (!params.mHasSubtitles) {
+        return 0;
+    }
+    return (params.mDurationUs + kSubtitleIntervalUs - 1) / kSubtitleIntervalUs;
+}
+
+static uint32_t framesPerLace(const MKVGenerator::Params &params) {
+    return (params.mAudioLacing == MKVGenerator::LACING_NONE)
+        ? 1 : params.mFramesPerLace;
+}
+
+// static
+int64_t MKVGenerator::AudioFrameTimeUs(const Params &params, uint32_t index) {
+    uint32_t first = index - index % framesPerLace(params);
+    int64_t timecodeMs = first * kAudioFrameDurationNs / 1000000;
+
+    return timecodeMs * 1000 + (index - first) * (kAudioFrameDurationNs / 1000);
+}
+
+// static
+int64_t MKVGenerator::SubtitleTimeUs(uint32_t index) {
+    return index * kSubtitleIntervalUs;
+}
+
+// static
+int64_t MKVGenerator::SubtitleDurationUs() {
+    return kSubtitleDurationUs;
+}
+
+static bool isSyncFrame(const MKVGenerator::Params &params, uint32_t index) {
+    return (index % params.mSyncInterval) == 0;
+}
+
+static void appendU32(Vector<uint8_t> *out, uint32_t x) {
+    out->push(x >> 24);
+    out->push((x >> 16) & 0xff);
+    out->push((x >> 8) & 0xff);
+    out->push(x & 0xff);
+}
+
+// The frame as stored, with NAL length prefixes for AVC.
+static void makeStoredVideoFrame(
+        const MKVGenerator::Params &params, uint32_t index,
+        Vector<uint8_t> *out) {
+    out->clear();
+
+    if (params.mWebm) {
+        appendU32(out, index);
+        out->push(isSyncFrame(params, index) ? 0x10 : 0x11);
+        while (out->size() < params.mFrameSize) {
+            out->push(index + out->size());
+        }
+        return;
+    }
+
+    // A slice NAL carrying the index followed by a filler NAL.
+    size_t lengthSize = params.mNALLengthSize;
+    for (size_t i = lengthSize; i-- > 0;) {
+        out->push(i == 0 ? 6 : 0);
+    }
+    out->push(isSyncFrame(params, index) ? 0x65 : 0x41);
+    appendU32(out, index);
+    out->push(0x80);
+
+    CHECK_GT(params.mFrameSize, out->size() + lengthSize + 1);
+    size_t fillerSize = params.mFrameSize - out->size() - lengthSize;
+    for (size_t i = lengthSize; i-- > 0;) {
+        out->push(fillerSize >> (8 * i));
+    }
+    out->push(0x0c);
+    while (out->size() < params.mFrameSize) {
+        out->push(0xff);
+    }
+}
+
+// static
+void MKVGenerator::MakeVideoFrame(
+        const Params &params, uint32_t index, Vector<uint8_t> *out) {
+    Vector<uint8_t> stored;
+    makeStoredVideoFrame(params, index, &stored);
+
+    if (params.mWebm) {
+        *out = stored;
+        return;
+    }
+
+    out->clear();
+
+    size_t lengthSize = params.mNALLengthSize;
+    size_t offset = 0;
+    while (offset < stored.size()) {
+        size_t nalSize = 0;
+        for (size_t i = 0; i < lengthSize; ++i) {
+            nalSize = (nalSize << 8) | stored.itemAt(offset++);
+        }
+        out->appendArray((const uint8_t *)"\x00\x00\x00\x01", 4);
+        out->appendArray(stored.array() + offset, nalSize);
+        offset += nalSize;
+    }
+}
+
+// static
+void MKVGenerator::MakeAudioFrame(
+        const Params &params, uint32_t index, Vector<uint8_t> *out) {
+    size_t size = (params.mAudioLacing == LACING_FIXED)
+        ? kFixedAudioFrameSize : 150 + (index * 37) % 300;
+
+    out->clear();
+    appendU32(out, index);
+    while (out->size() < size) {
+        out->push(index + out->size());
+    }
+}
+
+// static
+void MKVGenerator::MakeSubtitle(uint32_t index, Vector<uint8_t> *out) {
+    char text[32];
+    snprintf(text, sizeof(text), "Subtitle %u", index);
+
+    out->clear();
+    out->appendArray((const uint8_t *)text, strlen(text));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Block {
+    int64_t mTimeUs;
+    uint32_t mTrackNum;
+    uint32_t mFirstIndex;
+    uint32_t mNumFrames;
+    bool mIsKey;
+};
+
+}  // namespace
+
+static int compareBlocks(const Block *a, const Block *b) {
+    if (a->mTimeUs != b->mTimeUs) {
+        return (a->mTimeUs < b->mTimeUs) ? -1 : 1;
+    }
+    return (int)a->mTrackNum - (int)b->mTrackNum;
+}
+
+static void writeVorbisCodecPrivate(EBMLWriter *writer) {
+    // Identification, comment and setup headers, only their types and
+    // sizes matter to the extractor.
+    Vector<uint8_t> priv;
+    static const size_t kSizes[3] = { 30, 20, 300 };
+    static const uint8_t kTypes[3] = { 1, 3, 5 };
+
+    // Two Xiph laced sizes, both below 255.
+    priv.push(2);
+    priv.push(kSizes[0]);
+    priv.push(kSizes[1]);
+
+    for (size_t i = 0; i < 3; ++i) {
+        priv.push(kTypes[i]);
+        priv.appendArray((const uint8_t *)"vorbis", 6);
+        for (size_t j = 7; j < kSizes[i]; ++j) {
+            priv.push(j);
+        }
+    }
+
+    writer->writeBinary(0x63A2, priv.array(), priv.size());
+}
+
+static void writeTracks(
+        EBMLWriter *writer, const MKVGenerator::Params &params) {
+    writer->startElement(0x1654AE6B);  // Tracks
+
+    if (params.mHasVideo) {
+        writer->startElement(0xAE);  // TrackEntry
+        writer->writeUInt(0xD7, MKVGenerator::kVideoTrackNum);
+        writer->writeUInt(0x73C5, 0x1001);  // TrackUID
+        writer->writeUInt(0x83, 1);
+        writer->writeUInt(0x23E383, kVideoFrameDurationUs * 1000);
+
+        if (params.mVideoCodecId != NULL) {
+            writer->writeString(0x86, params.mVideoCodecId);
+            if (!params.mVideoCodecPrivate.isEmpty()) {
+                writer->writeBinary(
+                        0x63A2, params.mVideoCodecPrivate.array(),
+                        params.mVideoCodecPrivate.size());
+            }
+        } else if (params.mWebm) {
+            writer->writeString(0x86, "V_VP8");
+        } else {
+            writer->writeString(0x86, "V_MPEG4/ISO/AVC");
+
+            uint8_t avcc[sizeof(kAVCC)];
+            memcpy(avcc, kAVCC, sizeof(kAVCC));
+            avcc[4] = 0xfc | (params.mNALLengthSize - 1);
+            writer->writeBinary(0x63A2, avcc, sizeof(avcc));
+        }
+
+        writer->startElement(0xE0);  // Video
+        writer->writeUInt(0xB0, 320);
+        writer->writeUInt(0xBA, 240);
+        writer->endElement();
+
+        if (params.mHeaderStripping) {
+            writer->startElement(0x6D80);  // ContentEncodings
+            writer->startElement(0x6240);  // ContentEncoding
+            writer->startElement(0x5034);  // ContentCompression
+            writer->writeUInt(0x4254, 3);
+            writer->writeBinary(0x4255, "\x00\x00", 2);
+            writer->endElement();
+            writer->endElement();
+            writer->endElement();
+        }
+
+        writer->endElement();
+    }
+
+    if (params.mHasAudio) {
+        writer->startElement(0xAE);
+        writer->writeUInt(0xD7, MKVGenerator::kAudioTrackNum);
+        writer->writeUInt(0x73C5, 0x1002);
+        writer->writeUInt(0x83, 2);
+        writer->writeUInt(0x23E383, kAudioFrameDurationNs);
+        writer->writeString(0x22B59C, "ger");
+
+        if (params.mAudioCodecId != NULL) {
+            writer->writeString(0x86, params.mAudioCodecId);
+            if (!params.mAudioCodecPrivate.isEmpty()) {
+                writer->writeBinary(
+                        0x63A2, params.mAudioCodecPrivate.array(),
+                        params.mAudioCodecPrivate.size());
+            }
+        } else if (params.mWebm) {
+            writer->writeString(0x86, "A_VORBIS");
+            writeVorbisCodecPrivate(writer);
+        } else {
+            writer->writeString(0x86, "A_AAC");
+            writer->writeBinary(0x63A2, kAACConfig, sizeof(kAACConfig));
+        }
+
+        writer->startElement(0xE1);  // Audio
+        writer->writeFloat(0xB5, 44100.0);
+        writer->writeUInt(0x9F, 2);
+        writer->endElement();
+
+        writer->endElement();
+    }
+
+    if (params.mHasSubtitles) {
+        writer->startElement(0xAE);
+        writer->writeUInt(0xD7, MKVGenerator::kSubtitleTrackNum);
+        writer->writeUInt(0x73C5, 0x1003);
+        writer->writeUInt(0x83, 0x11);
+        writer->writeString(
+                0x86, params.mSubtitleCodecId != NULL
+                    ? params.mSubtitleCodecId : "S_TEXT/UTF8");
+        writer->writeString(0x22B59C, "fre");
+
+        writer->startElement(0x6D80);
+        writer->startElement(0x6240);
+        writer->startElement(0x5034);
+        writer->writeUInt(0x4254, 0);
+        writer->endElement();
+        writer->endElement();
+        writer->endElement();
+
+        writer->endElement();
+    }
+
+    writer->endElement();
+}
+
+static void writeBlock(
+        EBMLWriter *writer, const MKVGenerator::Params &params,
+        const Block &block, int64_t clusterTimecodeMs) {
+    Vector<Vector<uint8_t> > frames;
+    for (uint32_t i = 0; i < block.mNumFrames; ++i) {
+        frames.push();
+        Vector<uint8_t> *frame = &frames.editItemAt(frames.size() - 1);
+        uint32_t index = block.mFirstIndex + i;
+
+        if (block.mTrackNum == MKVGenerator::kVideoTrackNum) {
+            makeStoredVideoFrame(params, index, frame);
+            if (params.mHeaderStripping) {
+                CHECK(frame->itemAt(0) == 0 && frame->itemAt(1) == 0);
+                frame->removeItemsAt(0, 2);
+            }
+        } else if (block.mTrackNum == MKVGenerator::kAudioTrackNum) {
+            MKVGenerator::MakeAudioFrame(params, index, frame);
+        } else {
+            Vector<uint8_t> text;
+            MKVGenerator::MakeSubtitle(index, &text);
+
+            uLongf size = compressBound(text.size());
+            frame->resize(size);
+            CHECK_EQ(Z_OK, compress(frame->editArray(), &size,
+                                     text.array(), text.size()));
+            frame->resize(size);
+        }
+    }
+
+    MKVGenerator::Lacing lacing = MKVGenerator::LACING_NONE;
+    if (block.mTrackNum == MKVGenerator::kAudioTrackNum) {
+        lacing = params.mAudioLacing;
+    }
+
+    Vector<uint8_t> payload;
+    payload.push(0x80 | block.mTrackNum);
+
+    int64_t relativeTimecode = block.mTimeUs / 1000 - clusterTimecodeMs;
+    CHECK(relativeTimecode >= 0 && relativeTimecode < 0x8000);
+    payload.push(relativeTimecode >> 8);
+    payload.push(relativeTimecode & 0xff);
+
+    bool simpleBlock = true;
+    if (block.mTrackNum == MKVGenerator::kSubtitleTrackNum
+            || (params.mUseBlockGroups && !block.mIsKey)) {
+        simpleBlock = false;
+    }
+
+    uint8_t flags = lacing << 1;
+    if (simpleBlock && block.mIsKey) {
+        flags |= 0x80;
+    }
+    payload.push(flags);
+
+    if (lacing != MKVGenerator::LACING_NONE) {
+        payload.push(frames.size() - 1);
+
+        EBMLWriter laces(&payload);
+        int64_t prevSize = 0;
+        for (size_t i = 0; i + 1 < frames.size(); ++i) {
+            int64_t size = frames.itemAt(i).size();
+
+            if (lacing == MKVGenerator::LACING_XIPH) {
+                int64_t remaining = size;
+                while (remaining >= 255) {
+                    payload.push(0xff);
+                    remaining -= 255;
+                }
+                payload.push(remaining);
+            } else if (lacing == MKVGenerator::LACING_EBML) {
+                if (i == 0) {
+                    laces.writeVInt(size);
+                } else {
+                    int64_t diff = size - prevSize;
+                    size_t len = 1;
+                    while (diff < -((1ll << (7 * len - 1)) - 1)
+                            || diff > (1ll << (7 * len - 1)) - 1) {
+                        ++len;
+                    }
+                    laces.writeVInt(diff + (1ll << (7 * len - 1)) - 1, len);
+                }
+            }
+
+            prevSize = size;
+        }
+    }
+
+    for (size_t i = 0; i < frames.size(); ++i) {
+        payload.appendVector(frames.itemAt(i));
+    }
+
+    if (simpleBlock) {
+        writer->writeBinary(0xA3, payload.array(), payload.size());
+        return;
+    }
+
+    writer->startElement(0xA0);  // BlockGroup
+    writer->writeBinary(0xA1, payload.array(), payload.size());
+    if (block.mTrackNum == MKVGenerator::kSubtitleTrackNum) {
+        writer->writeUInt(0x9B, kSubtitleDurationUs / 1000);
+    } else if (!block.mIsKey) {
+        writer->writeUInt(0xFB, 0x100 - kVideoFrameDurationUs / 1000);
+    }
+    writer->endElement();
+}
+
+// static
+void MKVGenerator::Make(const Params &params, Vector<uint8_t> *out) {
+    out->clear();
+
+    Vector<Block> blocks;
+
+    for (uint32_t i = 0; i < CountVideoFrames(params); ++i) {
+        Block block;
+        block.mTimeUs = VideoFrameTimeUs(i);
+        block.mTrackNum = kVideoTrackNum;
+        block.mFirstIndex = i;
+        block.mNumFrames = 1;
+        block.mIsKey = isSyncFrame(params, i);
+        blocks.push(block);
+    }
+
+    uint32_t numAudioFrames = CountAudioFrames(params);
+    for (uint32_t i = 0; i < numAudioFrames; i += framesPerLace(params)) {
+        Block block;
+        block.mTimeUs = AudioFrameTimeUs(params, i);
+        block.mTrackNum = kAudioTrackNum;
+        block.mFirstIndex = i;
+        block.mNumFrames = numAudioFrames - i;
+        if (block.mNumFrames > framesPerLace(params)) {
+            block.mNumFrames = framesPerLace(params);
+        }
+        block.mIsKey = true;
+        blocks.push(block);
+    }
+
+    for (uint32_t i = 0; i < CountSubtitles(params); ++i) {
+        Block block;
+        block.mTimeUs = SubtitleTimeUs(i);
+        block.mTrackNum = kSubtitleTrackNum;
+        block.mFirstIndex = i;
+        block.mNumFrames = 1;
+        block.mIsKey = true;
+        blocks.push(block);
+    }
+
+    blocks.sort(compareBlocks);
+
+    EBMLWriter writer(out);
+
+    writer.startElement(0x1A45DFA3);  // EBML
+    writer.writeUInt(0x4286, 1);      // EBMLVersion
+    writer.writeUInt(0x42F7, 1);      // EBMLReadVersion
+    writer.writeUInt(0x42F2, 4);      // EBMLMaxIDLength
+    writer.writeUInt(0x42F3, 8);      // EBMLMaxSizeLength
+    writer.writeString(0x4282, params.mWebm ? "webm" : "matroska");
+    writer.writeUInt(0x4287, 2);      // DocTypeVersion
+    writer.writeUInt(0x4285, 2);      // DocTypeReadVersion
+    writer.endElement();
+
+    writer.startElement(0x18538067, params.mUnknownSizes);  // Segment
+    size_t segmentDataOffset = writer.offset();
+
+    // Seek head with room for the positions of Info, Tracks and Cues.
+    uint32_t seekIds[3] = { 0x1549A966, 0x1654AE6B, 0x1C53BB6B };
+    size_t seekPositions[3];
+    size_t numSeeks = params.mWriteCues ? 3 : 2;
+
+    writer.startElement(0x114D9B74);  // SeekHead
+    for (size_t i = 0; i < numSeeks; ++i) {
+        writer.startElement(0x4DBB);  // Seek
+        uint8_t id[4];
+        for (size_t j = 0; j < 4; ++j) {
+            id[j] = seekIds[i] >> (8 * (3 - j));
+        }
+        writer.writeBinary(0x53AB, id, sizeof(id));
+        seekPositions[i] = writer.writeFixedUInt(0x53AC, 0);
+        writer.endElement();
+    }
+    writer.endElement();
+
+    writer.patchUInt(seekPositions[0], writer.offset() - segmentDataOffset);
+    writer.startElement(0x1549A966);  // Info
+    writer.writeUInt(0x2AD7B1, 1000000);
+    writer.writeFloat(0x4489, params.mDurationUs / 1000.0);
+    writer.writeString(0x4D80, "MKVGenerator");  // MuxingApp
+    writer.writeString(0x5741, "MKVGenerator");  // WritingApp
+    writer.endElement();
+
+    writer.patchUInt(seekPositions[1], writer.offset() - segmentDataOffset);
+    writeTracks(&writer, params);
+
+    // Cue points for the video sync frames, or for every cluster if there
+    // is no video.
+    struct Cue {
+        int64_t mTimecodeMs;
+        uint32_t mTrackNum;
+        size_t mClusterPosition;
+    };
+    Vector<Cue> cues;
+
+    bool inCluster = false;
+    int64_t clusterTimecodeMs = 0;
+    size_t clusterPosition = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const Block &block = blocks.itemAt(i);
+        int64_t blockTimecodeMs = block.mTimeUs / 1000;
+
+        bool startCluster = !inCluster;
+        if (inCluster && (blockTimecodeMs - clusterTimecodeMs) * 1000
+                >= params.mClusterDurationUs) {
+            startCluster = !params.mClustersAtSyncFrames
+                || !params.mHasVideo
+                || (block.mTrackNum == kVideoTrackNum && block.mIsKey);
+        }
+
+        if (startCluster) {
+            if (inCluster) {
+                writer.endElement();
+            }
+
+            clusterTimecodeMs = blockTimecodeMs;
+            clusterPosition = writer.offset() - segmentDataOffset;
+            inCluster = true;
+
+            if (!params.mHasVideo) {
+                Cue cue;
+                cue.mTimecodeMs = clusterTimecodeMs;
+                cue.mTrackNum = block.mTrackNum;
+                cue.mClusterPosition = clusterPosition;
+                cues.push(cue);
+            }
+
+            writer.startElement(0x1F43B675, params.mUnknownSizes);
+            writer.writeUInt(0xE7, clusterTimecodeMs);
+        }
+
+        if (params.mHasVideo && block.mTrackNum == kVideoTrackNum
+                && block.mIsKey) {
+            Cue cue;
+            cue.mTimecodeMs = blockTimecodeMs;
+            cue.mTrackNum = kVideoTrackNum;
+            cue.mClusterPosition = clusterPosition;
+            cues.push(cue);
+        }
+
+        writeBlock(&writer, params, block, clusterTimecodeMs);
+    }
+
+    if (inCluster) {
+        writer.endElement();
+    }
+
+    if (params.mWriteCues) {
+        writer.patchUInt(seekPositions[2], writer.offset() - segmentDataOffset);
+
+        writer.startElement(0x1C53BB6B);  // Cues
+        for (size_t i = 0; i < cues.size(); ++i) {
+            const Cue &cue = cues.itemAt(i);
+            writer.startElement(0xBB);  // CuePoint
+            writer.writeUInt(0xB3, cue.mTimecodeMs);
+            writer.startElement(0xB7);  // CueTrackPositions
+            writer.writeUInt(0xF7, cue.mTrackNum);
+            writer.writeUInt(0xF1, cue.mClusterPosition);
+            writer.endElement();
+            writer.endElement();
+        }
+        writer.endElement();
+    }
+
+    writer.endElement();
+}
+
+// static
+status_t MKVGenerator::Write(const char *path, const Params &params) {
+    Vector<uint8_t> data;
+    Make(params, &data);
+
+    int fd = open(path, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    ssize_t n = write(fd, data.array(), data.size());
+    close(fd);
+
+    return (n == (ssize_t)data.size()) ? OK : ERROR_IO;
+}
+
+}  // namespace android
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MKV_GENERATOR_H_
+
+#define MKV_GENERATOR_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Assembles the Matroska/WebM files the extractor tests and benchmark run
+// on. Video frames are 40ms apart, audio frames are 1024 samples at 44.1kHz
+// and subtitles, if any, are shown for 1.5s every 2s.
+struct MKVGenerator {
+    enum Lacing {
+        LACING_NONE,
+        LACING_XIPH,
+        LACING_FIXED,
+        LACING_EBML,
+    };
+
+    enum {
+        kVideoTrackNum    = 1,
+        kAudioTrackNum    = 2,
+        kSubtitleTrackNum = 3,
+    };
+
+    struct Params {
+        Params();
+
+        int64_t mDurationUs;
+
+        // DocType "webm" with VP8 and Vorbis instead of AVC and AAC.
+        bool mWebm;
+
+        bool mHasVideo;            // 320x240
+        uint32_t mSyncInterval;
+        size_t mFrameSize;
+        size_t mNALLengthSize;     // AVC only.
+        // Non-sync video frames go into BlockGroups with a ReferenceBlock
+        // rather than SimpleBlocks.
+        bool mUseBlockGroups;
+        // Strips the first two bytes of every video frame, which are
+        // restored through ContentCompression.
+        bool mHeaderStripping;
+
+        bool mHasAudio;
+        Lacing mAudioLacing;
+        uint32_t mFramesPerLace;
+
+        // zlib compressed S_TEXT/UTF8 in BlockGroups with a BlockDuration.
+        bool mHasSubtitles;
+
+        // Clusters start with a sync frame once they are this long, or at
+        // fixed intervals if mClustersAtSyncFrames is not set.
+        int64_t mClusterDurationUs;
+        bool mClustersAtSyncFrames;
+
+        // Cues for the video track at the end of the file, located through
+        // the seek head.
+        bool mWriteCues;
+
+        // Live style segment and clusters of unknown size.
+        bool mUnknownSizes;
+
+        // Codec IDs and codec private data replacing those of the tracks
+        // above, NULL to keep them. The frames stay the same.
+        const char *mVideoCodecId;
+        Vector<uint8_t> mVideoCodecPrivate;
+        const char *mAudioCodecId;
+        Vector<uint8_t> mAudioCodecPrivate;
+        const char *mSubtitleCodecId;
+    };
+
+    static void Make(const Params &params, Vector<uint8_t> *out);
+    static status_t Write(const char *path, const Params &params);
+
+    // The payloads the extractor should hand out, each carries the frame's
+    // index. AVC frames come with start codes.
+    static void MakeVideoFrame(
+            const Params &params, uint32_t index, Vector<uint8_t> *out);
+    static void MakeAudioFrame(
+            const Params &params, uint32_t index, Vector<uint8_t> *out);
+    static void MakeSubtitle(uint32_t index, Vector<uint8_t> *out);
+
+    static uint32_t CountVideoFrames(const Params &params);
+    static uint32_t CountAudioFrames(const Params &params);
+    static uint32_t CountSubtitles(const Params &params);
+
+    static int64_t VideoFrameTimeUs(uint32_t index);
+    // Blocks are timed to the millisecond, laced frames after the first are
+    // spaced by the track's default duration.
+    static int64_t AudioFrameTimeUs(const Params &params, uint32_t index);
+    static int64_t SubtitleTimeUs(uint32_t index);
+    static int64_t SubtitleDurationUs();
+};
+
+}  // namespace android
+
+#endif  // MKV_GENERATOR_H_
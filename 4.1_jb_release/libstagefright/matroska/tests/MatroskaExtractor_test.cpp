@@ -0,0 +1,831 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MatroskaExtractor_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+#include <utils/String8.h>
+
+#include <string.h>
+
+#include "matroska/MatroskaExtractor.h"
+#include "MKVGenerator.h"
+
+namespace android {
+
+// Serves a file held in memory and keeps count of what is read.
+struct BufferSource : public DataSource {
+    BufferSource(const Vector<uint8_t> &data)
+        : mData(data),
+          mNumReads(0),
+          mBytesRead(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ++mNumReads;
+
+        if (offset < 0 || offset >= (off64_t)mData.size()) {
+            return 0;
+        }
+
+        if (offset + size > mData.size()) {
+            size = mData.size() - offset;
+        }
+
+        memcpy(data, mData.array() + offset, size);
+        mBytesRead += size;
+
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mData.size();
+        return OK;
+    }
+
+    size_t mNumReads;
+    size_t mBytesRead;
+
+private:
+    Vector<uint8_t> mData;
+
+    DISALLOW_EVIL_CONSTRUCTORS(BufferSource);
+};
+
+struct Frame {
+    int64_t mTimeUs;
+    bool mIsSync;
+    int32_t mDurationMs;
+    int64_t mTargetTimeUs;
+    const void *mData;
+    Vector<uint8_t> mPayload;
+};
+
+static bool readFrame(
+        const sp<MediaSource> &source, Frame *frame,
+        const MediaSource::ReadOptions *options = NULL,
+        status_t *err = NULL) {
+    MediaBuffer *buffer;
+    status_t status = source->read(&buffer, options);
+
+    if (err != NULL) {
+        *err = status;
+    }
+
+    if (status != OK) {
+        return false;
+    }
+
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, &frame->mTimeUs));
+
+    int32_t isSync;
+    frame->mIsSync =
+        buffer->meta_data()->findInt32(kKeyIsSyncFrame, &isSync) && isSync;
+
+    if (!buffer->meta_data()->findInt32(
+                kKeySubtitleDuration, &frame->mDurationMs)) {
+        frame->mDurationMs = -1;
+    }
+
+    if (!buffer->meta_data()->findInt64(
+                kKeyTargetTime, &frame->mTargetTimeUs)) {
+        frame->mTargetTimeUs = -1;
+    }
+
+    frame->mData = buffer->data();
+    frame->mPayload.clear();
+    frame->mPayload.appendArray(
+            (const uint8_t *)buffer->data() + buffer->range_offset(),
+            buffer->range_length());
+
+    buffer->release();
+    buffer = NULL;
+
+    return true;
+}
+
+static bool samePayload(const Vector<uint8_t> &a, const Vector<uint8_t> &b) {
+    return a.size() == b.size() && !memcmp(a.array(), b.array(), a.size());
+}
+
+// The index embedded by MKVGenerator.
+static uint32_t videoFrameIndex(
+        const MKVGenerator::Params &params, const Frame &frame) {
+    const uint8_t *data = frame.mPayload.array();
+    if (params.mWebm) {
+        CHECK_GE(frame.mPayload.size(), 4u);
+        return U32_AT(data);
+    }
+
+    CHECK_GE(frame.mPayload.size(), 9u);
+    CHECK(!memcmp(data, "\x00\x00\x00\x01", 4));
+    return U32_AT(&data[5]);
+}
+
+static ssize_t findTrack(const sp<MediaExtractor> &extractor, const char *mime) {
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<MetaData> meta = extractor->getTrackMetaData(i);
+        const char *trackMime;
+        if (meta != NULL && meta->findCString(kKeyMIMEType, &trackMime)
+                && !strcasecmp(mime, trackMime)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+class MatroskaExtractorTest : public ::testing::Test {
+protected:
+    sp<MediaExtractor> make(const MKVGenerator::Params &params) {
+        mParams = params;
+
+        Vector<uint8_t> data;
+        MKVGenerator::Make(params, &data);
+
+        return open(data);
+    }
+
+    sp<MediaExtractor> open(const Vector<uint8_t> &data) {
+        mSource = new BufferSource(data);
+        return new MatroskaExtractor(mSource);
+    }
+
+    sp<MediaSource> startTrack(
+            const sp<MediaExtractor> &extractor, const char *mime) {
+        ssize_t index = findTrack(extractor, mime);
+        CHECK_GE(index, 0);
+
+        sp<MediaSource> source = extractor->getTrack(index);
+        CHECK(source != NULL);
+        CHECK_EQ((status_t)OK, source->start());
+
+        return source;
+    }
+
+    const char *videoMime() const {
+        return mParams.mWebm
+            ? MEDIA_MIMETYPE_VIDEO_VPX : MEDIA_MIMETYPE_VIDEO_AVC;
+    }
+
+    const char *audioMime() const {
+        return mParams.mWebm
+            ? MEDIA_MIMETYPE_AUDIO_VORBIS : MEDIA_MIMETYPE_AUDIO_AAC;
+    }
+
+    void expectAllVideoFrames(const sp<MediaExtractor> &extractor) {
+        sp<MediaSource> video = startTrack(extractor, videoMime());
+
+        uint32_t numFrames = MKVGenerator::CountVideoFrames(mParams);
+        Frame frame;
+        Vector<uint8_t> expected;
+        for (uint32_t i = 0; i < numFrames; ++i) {
+            ASSERT_TRUE(readFrame(video, &frame)) << "frame " << i;
+
+            MKVGenerator::MakeVideoFrame(mParams, i, &expected);
+            ASSERT_TRUE(samePayload(expected, frame.mPayload))
+                << "frame " << i;
+            EXPECT_EQ(MKVGenerator::VideoFrameTimeUs(i), frame.mTimeUs);
+            EXPECT_EQ((i % mParams.mSyncInterval) == 0, frame.mIsSync)
+                << "frame " << i;
+        }
+
+        status_t err;
+        EXPECT_FALSE(readFrame(video, &frame, NULL, &err));
+        EXPECT_EQ(ERROR_END_OF_STREAM, err);
+
+        video->stop();
+    }
+
+    void expectAllAudioFrames(const sp<MediaExtractor> &extractor) {
+        sp<MediaSource> audio = startTrack(extractor, audioMime());
+
+        uint32_t numFrames = MKVGenerator::CountAudioFrames(mParams);
+        Frame frame;
+        Vector<uint8_t> expected;
+        for (uint32_t i = 0; i < numFrames; ++i) {
+            ASSERT_TRUE(readFrame(audio, &frame)) << "frame " << i;
+
+            MKVGenerator::MakeAudioFrame(mParams, i, &expected);
+            ASSERT_TRUE(samePayload(expected, frame.mPayload))
+                << "frame " << i;
+            EXPECT_EQ(MKVGenerator::AudioFrameTimeUs(mParams, i),
+                      frame.mTimeUs) << "frame " << i;
+        }
+
+        status_t err;
+        EXPECT_FALSE(readFrame(audio, &frame, NULL, &err));
+        EXPECT_EQ(ERROR_END_OF_STREAM, err);
+
+        audio->stop();
+    }
+
+    // Seeks the video track to "seekTimeUs" and checks which frame comes
+    // out, and that reading carries on from there.
+    void expectSeek(
+            const sp<MediaSource> &video, int64_t seekTimeUs,
+            MediaSource::ReadOptions::SeekMode mode,
+            uint32_t expectedIndex) {
+        MediaSource::ReadOptions options;
+        options.setSeekTo(seekTimeUs, mode);
+
+        Frame frame;
+        ASSERT_TRUE(readFrame(video, &frame, &options));
+        EXPECT_EQ(expectedIndex, videoFrameIndex(mParams, frame))
+            << "seek to " << seekTimeUs << " mode " << mode;
+        EXPECT_EQ(MKVGenerator::VideoFrameTimeUs(expectedIndex),
+                  frame.mTimeUs);
+        EXPECT_TRUE(frame.mIsSync);
+
+        if (mode == MediaSource::ReadOptions::SEEK_CLOSEST
+                && frame.mTimeUs < seekTimeUs) {
+            EXPECT_EQ(seekTimeUs, frame.mTargetTimeUs);
+        } else {
+            EXPECT_EQ(-1, frame.mTargetTimeUs);
+        }
+
+        ASSERT_TRUE(readFrame(video, &frame));
+        EXPECT_EQ(expectedIndex + 1, videoFrameIndex(mParams, frame));
+    }
+
+    void expectSeekModes(const sp<MediaExtractor> &extractor) {
+        typedef MediaSource::ReadOptions Opt;
+
+        sp<MediaSource> video = startTrack(extractor, videoMime());
+
+        uint32_t numFrames = MKVGenerator::CountVideoFrames(mParams);
+        uint32_t interval = mParams.mSyncInterval;
+        uint32_t lastSync = (numFrames - 1) / interval * interval;
+
+        // Somewhere after the middle first so that nothing is cached yet.
+        static const uint32_t kFrames[] = { 317, 0, 24, 25, 26, 113, 480 };
+        for (size_t i = 0; i < sizeof(kFrames) / sizeof(kFrames[0]); ++i) {
+            uint32_t index = kFrames[i];
+            if (index >= numFrames) {
+                continue;
+            }
+
+            // A bit past frame "index".
+            int64_t seekTimeUs = MKVGenerator::VideoFrameTimeUs(index) + 5000;
+
+            uint32_t prevSync = index / interval * interval;
+            uint32_t nextSync = prevSync + interval;
+            if (nextSync > lastSync) {
+                nextSync = prevSync;
+            }
+            uint32_t closestSync =
+                (MKVGenerator::VideoFrameTimeUs(nextSync) - seekTimeUs
+                    < seekTimeUs - MKVGenerator::VideoFrameTimeUs(prevSync))
+                ? nextSync : prevSync;
+
+            expectSeek(video, seekTimeUs, Opt::SEEK_PREVIOUS_SYNC, prevSync);
+            expectSeek(video, seekTimeUs, Opt::SEEK_NEXT_SYNC, nextSync);
+            expectSeek(video, seekTimeUs, Opt::SEEK_CLOSEST_SYNC, closestSync);
+            expectSeek(video, seekTimeUs, Opt::SEEK_CLOSEST, prevSync);
+        }
+
+        video->stop();
+    }
+
+    MKVGenerator::Params mParams;
+    sp<BufferSource> mSource;
+};
+
+TEST_F(MatroskaExtractorTest, Sniff) {
+    for (int webm = 0; webm < 2; ++webm) {
+        MKVGenerator::Params params;
+        params.mWebm = webm;
+        params.mDurationUs = 1000000ll;
+
+        Vector<uint8_t> data;
+        MKVGenerator::Make(params, &data);
+
+        String8 mimeType;
+        float confidence = 0.0f;
+        sp<AMessage> meta;
+        EXPECT_TRUE(SniffMatroska(
+                    new BufferSource(data), &mimeType, &confidence, &meta));
+        EXPECT_STREQ(MEDIA_MIMETYPE_CONTAINER_MATROSKA, mimeType.string());
+        EXPECT_GT(confidence, 0.0f);
+
+        // Same file with an unknown DocType.
+        for (size_t i = 0; i + 4 <= data.size(); ++i) {
+            if (!memcmp(data.array() + i, webm ? "webm" : "matr", 4)) {
+                data.editItemAt(i) = 'x';
+                break;
+            }
+        }
+        EXPECT_FALSE(SniffMatroska(
+                    new BufferSource(data), &mimeType, &confidence, &meta));
+    }
+
+    Vector<uint8_t> garbage;
+    for (size_t i = 0; i < 4096; ++i) {
+        garbage.push(i * 7);
+    }
+    String8 mimeType;
+    float confidence;
+    EXPECT_FALSE(SniffMatroska(
+                new BufferSource(garbage), &mimeType, &confidence, NULL));
+}
+
+TEST_F(MatroskaExtractorTest, TrackFormats) {
+    MKVGenerator::Params params;
+    params.mHasSubtitles = true;
+    sp<MediaExtractor> extractor = make(params);
+
+    ASSERT_EQ(3u, extractor->countTracks());
+
+    sp<MetaData> meta = extractor->getMetaData();
+    const char *mime;
+    ASSERT_TRUE(meta->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(MEDIA_MIMETYPE_CONTAINER_MATROSKA, mime);
+
+    meta = extractor->getTrackMetaData(findTrack(extractor, videoMime()));
+    ASSERT_TRUE(meta != NULL);
+    int32_t width, height;
+    EXPECT_TRUE(meta->findInt32(kKeyWidth, &width));
+    EXPECT_TRUE(meta->findInt32(kKeyHeight, &height));
+    EXPECT_EQ(320, width);
+    EXPECT_EQ(240, height);
+    uint32_t type;
+    const void *data;
+    size_t size;
+    EXPECT_TRUE(meta->findData(kKeyAVCC, &type, &data, &size));
+    int64_t durationUs;
+    EXPECT_TRUE(meta->findInt64(kKeyDuration, &durationUs));
+    EXPECT_EQ(params.mDurationUs, durationUs);
+
+    meta = extractor->getTrackMetaData(findTrack(extractor, audioMime()));
+    ASSERT_TRUE(meta != NULL);
+    int32_t sampleRate, channelCount;
+    EXPECT_TRUE(meta->findInt32(kKeySampleRate, &sampleRate));
+    EXPECT_TRUE(meta->findInt32(kKeyChannelCount, &channelCount));
+    EXPECT_EQ(44100, sampleRate);
+    EXPECT_EQ(2, channelCount);
+    EXPECT_TRUE(meta->findData(kKeyESDS, &type, &data, &size));
+    const char *language;
+    EXPECT_TRUE(meta->findCString(kKeyMediaLanguage, &language));
+    EXPECT_STREQ("ger", language);
+
+    meta = extractor->getTrackMetaData(
+            findTrack(extractor, MEDIA_MIMETYPE_TEXT_MATROSKA_UTF8));
+    ASSERT_TRUE(meta != NULL);
+    EXPECT_TRUE(meta->findCString(kKeySubtitleLanguage, &language));
+    EXPECT_STREQ("fre", language);
+
+    // Opening reads the headers only, the cues at the end are left alone.
+    EXPECT_LT(mSource->mBytesRead, 1024u);
+}
+
+TEST_F(MatroskaExtractorTest, ReadsEveryVideoFrame) {
+    MKVGenerator::Params params;
+    expectAllVideoFrames(make(params));
+
+    params.mUseBlockGroups = true;
+    expectAllVideoFrames(make(params));
+}
+
+TEST_F(MatroskaExtractorTest, FramesAreNotCopied) {
+    MKVGenerator::Params params;
+    sp<MediaExtractor> extractor = make(params);
+    sp<MediaSource> video = startTrack(extractor, videoMime());
+
+    // Frames of the same cluster are handed out from the cluster's buffer.
+    Frame first, second;
+    ASSERT_TRUE(readFrame(video, &first));
+    ASSERT_TRUE(readFrame(video, &second));
+    EXPECT_EQ(first.mData, second.mData);
+
+    video->stop();
+}
+
+TEST_F(MatroskaExtractorTest, AudioLacing) {
+    static const MKVGenerator::Lacing kLacings[] = {
+        MKVGenerator::LACING_NONE,
+        MKVGenerator::LACING_XIPH,
+        MKVGenerator::LACING_FIXED,
+        MKVGenerator::LACING_EBML,
+    };
+
+    for (size_t i = 0; i < sizeof(kLacings) / sizeof(kLacings[0]); ++i) {
+        SCOPED_TRACE(i);
+
+        MKVGenerator::Params params;
+        params.mAudioLacing = kLacings[i];
+        params.mFramesPerLace = 8;
+        expectAllAudioFrames(make(params));
+    }
+}
+
+TEST_F(MatroskaExtractorTest, NALLengthsAndHeaderStripping) {
+    MKVGenerator::Params params;
+    params.mNALLengthSize = 2;
+    expectAllVideoFrames(make(params));
+
+    params.mNALLengthSize = 4;
+    params.mHeaderStripping = true;
+    expectAllVideoFrames(make(params));
+}
+
+TEST_F(MatroskaExtractorTest, Subtitles) {
+    MKVGenerator::Params params;
+    params.mHasSubtitles = true;
+    sp<MediaExtractor> extractor = make(params);
+
+    sp<MediaSource> text =
+        startTrack(extractor, MEDIA_MIMETYPE_TEXT_MATROSKA_UTF8);
+
+    uint32_t numSubtitles = MKVGenerator::CountSubtitles(params);
+    Frame frame;
+    Vector<uint8_t> expected;
+    for (uint32_t i = 0; i < numSubtitles; ++i) {
+        ASSERT_TRUE(readFrame(text, &frame));
+
+        MKVGenerator::MakeSubtitle(i, &expected);
+        EXPECT_TRUE(samePayload(expected, frame.mPayload));
+        EXPECT_EQ(MKVGenerator::SubtitleTimeUs(i), frame.mTimeUs);
+        EXPECT_EQ(MKVGenerator::SubtitleDurationUs() / 1000, frame.mDurationMs);
+    }
+
+    status_t err;
+    EXPECT_FALSE(readFrame(text, &frame, NULL, &err));
+    EXPECT_EQ(ERROR_END_OF_STREAM, err);
+
+    // A seek into a subtitle's display time returns that subtitle, one
+    // between two subtitles returns the next.
+    MediaSource::ReadOptions options;
+    options.setSeekTo(MKVGenerator::SubtitleTimeUs(3) + 1000000ll);
+    ASSERT_TRUE(readFrame(text, &frame, &options));
+    EXPECT_EQ(MKVGenerator::SubtitleTimeUs(3), frame.mTimeUs);
+
+    options.setSeekTo(MKVGenerator::SubtitleTimeUs(3) + 1800000ll);
+    ASSERT_TRUE(readFrame(text, &frame, &options));
+    EXPECT_EQ(MKVGenerator::SubtitleTimeUs(4), frame.mTimeUs);
+
+    text->stop();
+}
+
+TEST_F(MatroskaExtractorTest, SeekWithCues) {
+    MKVGenerator::Params params;
+    params.mDurationUs = 30000000ll;
+    sp<MediaExtractor> extractor = make(params);
+
+    expectSeekModes(extractor);
+}
+
+TEST_F(MatroskaExtractorTest, SeekWithoutCues) {
+    MKVGenerator::Params params;
+    params.mDurationUs = 30000000ll;
+    params.mWriteCues = false;
+    // Clusters that do not start with sync frames make the seek step back
+    // into the cluster before the one holding the seek time.
+    params.mClustersAtSyncFrames = false;
+    params.mClusterDurationUs = 300000ll;
+    sp<MediaExtractor> extractor = make(params);
+
+    expectSeekModes(extractor);
+
+    // The cluster scan reads cluster headers only.
+    EXPECT_LT(mSource->mBytesRead, 8 * 1024 * 1024u);
+}
+
+TEST_F(MatroskaExtractorTest, SeekAudio) {
+    MKVGenerator::Params params;
+    params.mAudioLacing = MKVGenerator::LACING_XIPH;
+    params.mFramesPerLace = 4;
+    sp<MediaExtractor> extractor = make(params);
+
+    sp<MediaSource> audio = startTrack(extractor, audioMime());
+
+    static const uint32_t kFrames[] = { 200, 3, 101, 0, 400 };
+    for (size_t i = 0; i < sizeof(kFrames) / sizeof(kFrames[0]); ++i) {
+        uint32_t index = kFrames[i];
+        int64_t seekTimeUs = MKVGenerator::AudioFrameTimeUs(params, index);
+
+        MediaSource::ReadOptions options;
+        options.setSeekTo(seekTimeUs + 1);
+
+        Frame frame;
+        ASSERT_TRUE(readFrame(audio, &frame, &options));
+        EXPECT_EQ(seekTimeUs, frame.mTimeUs);
+
+        Vector<uint8_t> expected;
+        MKVGenerator::MakeAudioFrame(params, index, &expected);
+        EXPECT_TRUE(samePayload(expected, frame.mPayload));
+    }
+
+    audio->stop();
+}
+
+TEST_F(MatroskaExtractorTest, TracksShareClusterReads) {
+    MKVGenerator::Params params;
+    params.mDurationUs = 20000000ll;
+    params.mWriteCues = false;
+
+    Vector<uint8_t> data;
+    MKVGenerator::Make(params, &data);
+    sp<MediaExtractor> extractor = open(data);
+
+    sp<MediaSource> video = startTrack(extractor, videoMime());
+    sp<MediaSource> audio = startTrack(extractor, audioMime());
+
+    // Read the tracks side by side as a player would.
+    Frame frame;
+    bool videoDone = false, audioDone = false;
+    int64_t videoTimeUs = 0, audioTimeUs = 0;
+    while (!videoDone || !audioDone) {
+        if (!videoDone && (audioDone || videoTimeUs <= audioTimeUs)) {
+            videoDone = !readFrame(video, &frame);
+            videoTimeUs = frame.mTimeUs;
+        } else {
+            audioDone = !readFrame(audio, &frame);
+            audioTimeUs = frame.mTimeUs;
+        }
+    }
+
+    // Every cluster was read once, in a single read.
+    EXPECT_LT(mSource->mBytesRead, data.size() + data.size() / 20);
+    EXPECT_LT(mSource->mNumReads, 20u + params.mDurationUs / 1000000ll);
+
+    video->stop();
+    audio->stop();
+}
+
+TEST_F(MatroskaExtractorTest, UnknownSizes) {
+    MKVGenerator::Params params;
+    params.mUnknownSizes = true;
+    params.mWriteCues = false;
+    sp<MediaExtractor> extractor = make(params);
+
+    expectAllVideoFrames(extractor);
+    expectAllAudioFrames(extractor);
+    expectSeekModes(extractor);
+}
+
+TEST_F(MatroskaExtractorTest, WebM) {
+    MKVGenerator::Params params;
+    params.mWebm = true;
+    sp<MediaExtractor> extractor = make(params);
+
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    sp<MetaData> meta =
+        extractor->getTrackMetaData(findTrack(extractor, audioMime()));
+    ASSERT_TRUE(meta != NULL);
+    uint32_t type;
+    const void *data;
+    size_t size;
+    ASSERT_TRUE(meta->findData(kKeyVorbisInfo, &type, &data, &size));
+    EXPECT_EQ(30u, size);
+    EXPECT_EQ(1, ((const uint8_t *)data)[0]);
+    ASSERT_TRUE(meta->findData(kKeyVorbisBooks, &type, &data, &size));
+    EXPECT_EQ(300u, size);
+    EXPECT_EQ(5, ((const uint8_t *)data)[0]);
+
+    expectAllVideoFrames(extractor);
+    expectAllAudioFrames(extractor);
+}
+
+TEST_F(MatroskaExtractorTest, TruncatedFile) {
+    MKVGenerator::Params params;
+    params.mWriteCues = false;
+
+    Vector<uint8_t> data;
+    MKVGenerator::Make(params, &data);
+
+    // Cut the file in the middle of a cluster.
+    data.resize(data.size() * 3 / 5);
+    mParams = params;
+    sp<MediaExtractor> extractor = open(data);
+
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    sp<MediaSource> video = startTrack(extractor, videoMime());
+
+    // Whatever comes out is intact and in order.
+    Frame frame;
+    Vector<uint8_t> expected;
+    uint32_t numFrames = 0;
+    status_t err;
+    while (readFrame(video, &frame, NULL, &err)) {
+        MKVGenerator::MakeVideoFrame(params, numFrames, &expected);
+        ASSERT_TRUE(samePayload(expected, frame.mPayload));
+        ++numFrames;
+    }
+
+    EXPECT_EQ(ERROR_END_OF_STREAM, err);
+    EXPECT_GT(numFrames, MKVGenerator::CountVideoFrames(params) / 2);
+    EXPECT_LT(numFrames, MKVGenerator::CountVideoFrames(params));
+
+    video->stop();
+}
+
+// STREAMINFO for 48kHz, 6 channels and 24 bits, behind the "fLaC" marker.
+static void makeFlacCodecPrivate(Vector<uint8_t> *out) {
+    uint8_t streamInfo[34];
+    memset(streamInfo, 0, sizeof(streamInfo));
+    streamInfo[0] = 0x10;   // min block size 4096
+    streamInfo[2] = 0x10;   // max block size 4096
+    streamInfo[10] = 0x0b;
+    streamInfo[11] = 0xb8;
+    streamInfo[12] = (5 << 1) | 1;
+    streamInfo[13] = 7 << 4;
+
+    out->clear();
+    out->appendArray((const uint8_t *)"fLaC", 4);
+    out->push(0x80);        // last metadata block, STREAMINFO
+    out->push(0);
+    out->push(0);
+    out->push(sizeof(streamInfo));
+    out->appendArray(streamInfo, sizeof(streamInfo));
+}
+
+// A BITMAPINFOHEADER for "fourcc" followed by "extraSize" bytes.
+static void makeBitmapInfoHeader(
+        const char *fourcc, size_t extraSize, Vector<uint8_t> *out) {
+    static const uint32_t kFields[] = { 40, 320, 240 };
+
+    out->clear();
+    for (size_t i = 0; i < sizeof(kFields) / sizeof(kFields[0]); ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            out->push(kFields[i] >> (8 * j));
+        }
+    }
+    out->push(1);           // biPlanes
+    out->push(0);
+    out->push(24);          // biBitCount
+    out->push(0);
+    out->appendArray((const uint8_t *)fourcc, 4);
+    while (out->size() < 40) {
+        out->push(0);
+    }
+    for (size_t i = 0; i < extraSize; ++i) {
+        out->push(i);
+    }
+}
+
+TEST_F(MatroskaExtractorTest, FlacAudio) {
+    MKVGenerator::Params params;
+    params.mHasVideo = false;
+    params.mAudioCodecId = "A_FLAC";
+    makeFlacCodecPrivate(&params.mAudioCodecPrivate);
+    sp<MediaExtractor> extractor = make(params);
+
+    EXPECT_FALSE(MatroskaExtractor::NeedsPrebuilt(mSource));
+
+    ssize_t index = findTrack(extractor, MEDIA_MIMETYPE_AUDIO_FLAC);
+    ASSERT_GE(index, 0);
+    sp<MetaData> meta = extractor->getTrackMetaData(index);
+    int32_t sampleRate, channelCount, bitDepth;
+    EXPECT_TRUE(meta->findInt32(kKeySampleRate, &sampleRate));
+    EXPECT_TRUE(meta->findInt32(kKeyChannelCount, &channelCount));
+    EXPECT_TRUE(meta->findInt32(kKeyBitDepth, &bitDepth));
+    EXPECT_EQ(48000, sampleRate);
+    EXPECT_EQ(6, channelCount);
+    EXPECT_EQ(24, bitDepth);
+
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_FLAC);
+
+    // The stream header comes ahead of the first frame only.
+    Frame frame;
+    Vector<uint8_t> expected = params.mAudioCodecPrivate;
+    Vector<uint8_t> payload;
+    MKVGenerator::MakeAudioFrame(params, 0, &payload);
+    expected.appendVector(payload);
+    ASSERT_TRUE(readFrame(audio, &frame));
+    EXPECT_TRUE(samePayload(expected, frame.mPayload));
+
+    MKVGenerator::MakeAudioFrame(params, 1, &expected);
+    ASSERT_TRUE(readFrame(audio, &frame));
+    EXPECT_TRUE(samePayload(expected, frame.mPayload));
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(0);
+    MKVGenerator::MakeAudioFrame(params, 0, &expected);
+    ASSERT_TRUE(readFrame(audio, &frame, &options));
+    EXPECT_TRUE(samePayload(expected, frame.mPayload));
+
+    audio->stop();
+
+    // STREAMINFO is required.
+    params.mAudioCodecPrivate.resize(20);
+    EXPECT_EQ(-1, findTrack(make(params), MEDIA_MIMETYPE_AUDIO_FLAC));
+}
+
+TEST_F(MatroskaExtractorTest, MpegAudioLayers) {
+    static const char *kCodecIds[] = { "A_MPEG/L1", "A_MPEG/L2", "A_MPEG/L3" };
+
+    for (size_t i = 0; i < sizeof(kCodecIds) / sizeof(kCodecIds[0]); ++i) {
+        SCOPED_TRACE(kCodecIds[i]);
+
+        MKVGenerator::Params params;
+        params.mHasVideo = false;
+        params.mAudioCodecId = kCodecIds[i];
+        sp<MediaExtractor> extractor = make(params);
+
+        EXPECT_GE(findTrack(extractor, MEDIA_MIMETYPE_AUDIO_MPEG), 0);
+    }
+}
+
+TEST_F(MatroskaExtractorTest, VfwVideo) {
+    static const char *kFourccs[] = { "XVID", "XviD", "DIVX", "DX50", "FMP4" };
+
+    for (size_t i = 0; i < sizeof(kFourccs) / sizeof(kFourccs[0]); ++i) {
+        SCOPED_TRACE(kFourccs[i]);
+
+        MKVGenerator::Params params;
+        params.mVideoCodecId = "V_MS/VFW/FOURCC";
+        makeBitmapInfoHeader(kFourccs[i], 16, &params.mVideoCodecPrivate);
+        sp<MediaExtractor> extractor = make(params);
+
+        EXPECT_FALSE(MatroskaExtractor::NeedsPrebuilt(mSource));
+
+        ssize_t index = findTrack(extractor, MEDIA_MIMETYPE_VIDEO_MPEG4);
+        ASSERT_GE(index, 0);
+        sp<MetaData> meta = extractor->getTrackMetaData(index);
+        uint32_t type;
+        const void *data;
+        size_t size;
+        ASSERT_TRUE(meta->findData(kKeyESDS, &type, &data, &size));
+
+        // The setup data after the header ends the ESDS.
+        ASSERT_GE(size, 16u);
+        const uint8_t *extra = (const uint8_t *)data + size - 16;
+        for (size_t j = 0; j < 16; ++j) {
+            EXPECT_EQ(j, extra[j]);
+        }
+    }
+
+    MKVGenerator::Params params;
+    params.mVideoCodecId = "V_MS/VFW/FOURCC";
+    makeBitmapInfoHeader("MJPG", 0, &params.mVideoCodecPrivate);
+    EXPECT_GE(findTrack(make(params), MEDIA_MIMETYPE_VIDEO_MJPEG), 0);
+}
+
+TEST_F(MatroskaExtractorTest, PrebuiltOnlyTracks) {
+    MKVGenerator::Params params;
+    params.mHasSubtitles = true;
+    params.mWriteCues = true;
+    make(params);
+
+    // Deciding takes the element headers up to Tracks and Tracks itself.
+    mSource->mBytesRead = 0;
+    EXPECT_FALSE(MatroskaExtractor::NeedsPrebuilt(mSource));
+    EXPECT_LT(mSource->mBytesRead, 1024u);
+
+    params = MKVGenerator::Params();
+    params.mVideoCodecId = "V_MS/VFW/FOURCC";
+    makeBitmapInfoHeader("DIV3", 0, &params.mVideoCodecPrivate);
+    sp<MediaExtractor> extractor = make(params);
+    EXPECT_TRUE(MatroskaExtractor::NeedsPrebuilt(mSource));
+    EXPECT_EQ(1u, extractor->countTracks());
+
+    // A header claiming more than there is stays with this extractor, which
+    // rejects the track.
+    params.mVideoCodecPrivate.editItemAt(0) = 80;
+    make(params);
+    EXPECT_FALSE(MatroskaExtractor::NeedsPrebuilt(mSource));
+
+    params = MKVGenerator::Params();
+    params.mAudioCodecId = "A_MS/ACM";
+    make(params);
+    EXPECT_TRUE(MatroskaExtractor::NeedsPrebuilt(mSource));
+
+    params = MKVGenerator::Params();
+    params.mHasSubtitles = true;
+    params.mSubtitleCodecId = "S_VOBSUB";
+    make(params);
+    EXPECT_TRUE(MatroskaExtractor::NeedsPrebuilt(mSource));
+}
+
+}  // namespace android
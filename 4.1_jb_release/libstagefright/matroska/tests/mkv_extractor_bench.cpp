@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Writes Matroska files of increasing duration, with and without cues, and
+// reports for each how long MatroskaExtractor takes to open it and to seek,
+// how many reads a seek costs and how fast audio and video can be read
+// side by side.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "mkv_extractor_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "matroska/MatroskaExtractor.h"
+#include "MKVGenerator.h"
+
+using namespace android;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+struct CountingSource : public DataSource {
+    CountingSource(const sp<DataSource> &source)
+        : mNumReads(0),
+          mSource(source) {
+    }
+
+    virtual status_t initCheck() const {
+        return mSource->initCheck();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ++mNumReads;
+        return mSource->readAt(offset, data, size);
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        return mSource->getSize(size);
+    }
+
+    size_t mNumReads;
+
+private:
+    sp<DataSource> mSource;
+
+    DISALLOW_EVIL_CONSTRUCTORS(CountingSource);
+};
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-f path] [-k] durationSecs...\n"
+            "       -f  file to write to (default /sdcard/mkv_bench.mkv)\n"
+            "       -k  keep the last written file\n", me);
+    exit(1);
+}
+
+static void runOne(const char *path, int64_t durationSecs, bool withCues) {
+    MKVGenerator::Params params;
+    params.mDurationUs = durationSecs * 1000000ll;
+    params.mFrameSize = 1500;
+    params.mWriteCues = withCues;
+
+    CHECK_EQ(MKVGenerator::Write(path, params), (status_t)OK);
+
+    struct stat st;
+    CHECK_EQ(stat(path, &st), 0);
+
+    sp<CountingSource> source = new CountingSource(new FileSource(path));
+
+    int64_t startUs = getNowUs();
+
+    sp<MediaExtractor> extractor = new MatroskaExtractor(source);
+    size_t numTracks = extractor->countTracks();
+    CHECK_EQ(numTracks, 2u);
+
+    int64_t openUs = getNowUs() - startUs;
+
+    sp<MediaSource> video = extractor->getTrack(0);
+    CHECK_EQ(video->start(), (status_t)OK);
+
+    // Seek to a few places spread over the file, jumping back and forth.
+    size_t numReads = source->mNumReads;
+    startUs = getNowUs();
+    static const size_t kNumSeeks = 8;
+    for (size_t i = 0; i < kNumSeeks; ++i) {
+        MediaSource::ReadOptions options;
+        options.setSeekTo(
+                params.mDurationUs * ((i * 5) % kNumSeeks + 1) / (kNumSeeks + 1),
+                MediaSource::ReadOptions::SEEK_CLOSEST);
+
+        MediaBuffer *buffer;
+        CHECK_EQ(video->read(&buffer, &options), (status_t)OK);
+        buffer->release();
+    }
+    int64_t seekUs = (getNowUs() - startUs) / kNumSeeks;
+    double readsPerSeek =
+        (double)(source->mNumReads - numReads) / kNumSeeks;
+
+    sp<MediaSource> audio = extractor->getTrack(1);
+    CHECK_EQ(audio->start(), (status_t)OK);
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(0);
+
+    MediaBuffer *buffer;
+    CHECK_EQ(video->read(&buffer, &options), (status_t)OK);
+    buffer->release();
+
+    // Read both tracks to the end in presentation order.
+    startUs = getNowUs();
+    size_t numBytes = 0;
+    int64_t videoTimeUs = 0, audioTimeUs = 0;
+    bool videoDone = false, audioDone = false;
+    while (!videoDone || !audioDone) {
+        bool readVideo = !videoDone && (audioDone || videoTimeUs <= audioTimeUs);
+        sp<MediaSource> track = readVideo ? video : audio;
+
+        if (track->read(&buffer) != OK) {
+            (readVideo ? videoDone : audioDone) = true;
+            continue;
+        }
+
+        numBytes += buffer->range_length();
+        CHECK(buffer->meta_data()->findInt64(
+                    kKeyTime, readVideo ? &videoTimeUs : &audioTimeUs));
+        buffer->release();
+    }
+    int64_t readUs = getNowUs() - startUs;
+
+    audio->stop();
+    video->stop();
+    audio.clear();
+    video.clear();
+    extractor.clear();
+
+    printf("%8lld %6s %10.1f %10.2f %10.2f %10.1f %10.1f\n",
+           durationSecs, withCues ? "yes" : "no", st.st_size / 1E6,
+           openUs / 1E3, seekUs / 1E3, readsPerSeek,
+           readUs > 0 ? numBytes / (double)readUs : 0.0);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "/sdcard/mkv_bench.mkv";
+    bool keepFile = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "f:k")) >= 0) {
+        switch (res) {
+            case 'f':
+                path = optarg;
+                break;
+
+            case 'k':
+                keepFile = true;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    static const int64_t kDefaultDurations[] = { 60, 600, 3600 };
+
+    Vector<int64_t> durations;
+    if (argc == 0) {
+        durations.appendArray(
+                kDefaultDurations,
+                sizeof(kDefaultDurations) / sizeof(kDefaultDurations[0]));
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            int64_t durationSecs = atoll(argv[i]);
+            if (durationSecs <= 0) {
+                usage(argv[0]);
+            }
+            durations.push(durationSecs);
+        }
+    }
+
+    printf("%8s %6s %10s %10s %10s %10s %10s\n",
+           "secs", "cues", "MBytes", "open ms", "seek ms", "reads/seek",
+           "read MB/s");
+
+    for (size_t i = 0; i < durations.size(); ++i) {
+        runOne(path, durations.itemAt(i), true);
+        runOne(path, durations.itemAt(i), false);
+    }
+
+    if (!keepFile) {
+        unlink(path);
+    }
+
+    return 0;
+}
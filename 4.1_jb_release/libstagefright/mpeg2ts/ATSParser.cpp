@@ -0,0 +1,1630 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ATSParser"
+#include <utils/Log.h>
+
+#include "ATSParser.h"
+
+#include "AnotherPacketSource.h"
+#include "ESQueue.h"
+#include "include/MPEG2TSExtractor.h"
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/hexdump.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Debug.h>
+#include <utils/KeyedVector.h>
+
+#include <stddef.h>
+
+namespace android {
+
+// 33 bit PTS/DTS/PCR values are kept in 90kHz ticks, "extended" to 64 bits
+// so that they keep increasing across wrap-arounds.
+static const int64_t kTimestampWrap = 1ll << 33;
+
+// A PCR that jumps further than this is treated as a discontinuity.
+static const int64_t kMaxPCRDelta = 10 * 90000ll;
+
+// Returns the value congruent to "ts" modulo 2^33 that is closest to "ref".
+static int64_t extendTimestamp(uint64_t ts, int64_t ref) {
+    int64_t extended = (ref & ~(kTimestampWrap - 1)) + (int64_t)ts;
+
+    if (extended - ref > kTimestampWrap / 2) {
+        extended -= kTimestampWrap;
+    } else if (ref - extended > kTimestampWrap / 2) {
+        extended += kTimestampWrap;
+    }
+
+    return extended;
+}
+
+static uint64_t parseTimestamp(const uint8_t *ptr) {
+    return ((uint64_t)((ptr[0] >> 1) & 7) << 30)
+        | ((uint64_t)ptr[1] << 22)
+        | ((uint64_t)(ptr[2] >> 1) << 15)
+        | ((uint64_t)ptr[3] << 7)
+        | (ptr[4] >> 1);
+}
+
+static bool timestampMarkersOkay(const uint8_t *ptr) {
+    return (ptr[0] & 1) && (ptr[2] & 1) && (ptr[4] & 1);
+}
+
+// Picks the PTS out of the start of a PES packet if the header is complete.
+static bool peekPTS(const uint8_t *data, size_t size, uint64_t *PTS) {
+    if (size < 14
+            || data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x01
+            || (data[6] >> 6) != 2
+            || !(data[7] & 0x80)
+            || data[8] < 5
+            || !timestampMarkersOkay(&data[9])) {
+        return false;
+    }
+
+    *PTS = parseTimestamp(&data[9]);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ATSParser::Program : public RefBase {
+    Program(ATSParser *parser, unsigned programNumber, unsigned programMapPID);
+
+    status_t parseProgramMap(const uint8_t *data, size_t size);
+
+    // Returns false if the PID does not belong to this program.
+    bool parsePID(
+            unsigned pid, unsigned continuity_counter,
+            unsigned payload_unit_start_indicator,
+            const uint8_t *data, size_t size,
+            status_t *err);
+
+    void addStream(unsigned elementaryPID, unsigned streamType);
+
+    void updatePCR(uint64_t PCR_base, bool discontinuity);
+
+    void signalDiscontinuity(
+            DiscontinuityType type, const sp<AMessage> &extra);
+
+    void signalEOS(status_t finalResult);
+    void signalSeek();
+    void resetPayload();
+    void setPlayerType(int type);
+
+    sp<MediaSource> getSource(
+            SourceType type, const Vector<int32_t> &excludedPIDs,
+            unsigned *elementaryPID);
+
+    int64_t getTimeus(unsigned elementaryPID);
+
+    int64_t convertPTSToTimestamp(uint64_t PTS);
+    int64_t convertSeekPTSToTimestamp(uint64_t PTS);
+
+    bool PTSTimeDeltaEstablished() const {
+        return mFirstPTSValid;
+    }
+
+    unsigned number() const { return mProgramNumber; }
+    unsigned programMapPID() const { return mProgramMapPID; }
+    unsigned PCRPID() const { return mPCRPID; }
+
+    ATSParser *parser() const { return mParser; }
+
+private:
+    ATSParser *mParser;
+    unsigned mProgramNumber;
+    unsigned mProgramMapPID;
+    unsigned mPCRPID;
+    KeyedVector<unsigned, sp<Stream> > mStreams;
+
+    // Most packets belong to the same one or two streams, remember the
+    // last one found to avoid the lookup.
+    Stream *mLastStream;
+
+    bool mFirstPTSValid;
+    int64_t mFirstPTS;
+    int64_t mRefPTS;
+
+    bool mLastPTSValid;
+    int64_t mLastPTS;
+
+    bool mPCRValid;
+    int64_t mLastPCR;
+    int64_t mPCRInterval;
+
+    // Added to all timestamps, accumulates the jumps of the time base
+    // at PCR discontinuities.
+    int64_t mTimeOffset;
+
+    void resetClock();
+
+    DISALLOW_EVIL_CONSTRUCTORS(Program);
+};
+
+struct ATSParser::Stream : public RefBase {
+    Stream(Program *program, unsigned elementaryPID, unsigned streamType);
+
+    unsigned type() const { return mStreamType; }
+    unsigned pid() const { return mElementaryPID; }
+
+    status_t parse(
+            unsigned continuity_counter,
+            unsigned payload_unit_start_indicator,
+            const uint8_t *data, size_t size);
+
+    void signalDiscontinuity(
+            DiscontinuityType type, const sp<AMessage> &extra);
+
+    void signalEOS(status_t finalResult);
+    void signalSeek();
+    void resetPayload();
+    void setPlayerType(int type);
+
+    sp<MediaSource> getSource(SourceType type);
+
+    int64_t timeUs() const { return mCurTimeUs; }
+
+    bool isVideo() const;
+    bool isAudio() const;
+
+    static bool IsSupportedStreamType(unsigned streamType);
+
+protected:
+    virtual ~Stream();
+
+private:
+    Program *mProgram;
+    unsigned mElementaryPID;
+    unsigned mStreamType;
+    int mExpectedContinuityCounter;
+
+    // The PES packet being assembled, reused from one packet to the next.
+    sp<ABuffer> mBuffer;
+    bool mPayloadStarted;
+    size_t mPESLength;
+
+    // The PTS of the pending PES packet is converted as soon as its header
+    // arrives, before PCRs following it move the time base on.
+    bool mPESTimeValid;
+    int64_t mPESTimeUs;
+
+    int64_t mCurTimeUs;
+
+    ElementaryStreamQueue *mQueue;
+    sp<AnotherPacketSource> mSource;
+
+    bool isSelected() const;
+    void createQueue();
+
+    void appendPayload(const uint8_t *data, size_t size);
+    status_t flush();
+    status_t parsePES(const uint8_t *data, size_t size);
+
+    void onPayloadData(
+            unsigned PTS_DTS_flags, uint64_t PTS,
+            const uint8_t *data, size_t size);
+
+    void drainQueue();
+
+    DISALLOW_EVIL_CONSTRUCTORS(Stream);
+};
+
+struct ATSParser::PSISection : public RefBase {
+    PSISection();
+
+    // Consumes at most the bytes remaining in the current section,
+    // returns the number of bytes consumed.
+    size_t append(const uint8_t *data, size_t size);
+    void clear();
+
+    bool isEmpty() const { return mSize == 0; }
+    bool isComplete() const;
+    bool isMalformed() const { return mMalformed; }
+
+    const uint8_t *data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    bool isCRCOkay() const;
+
+    // Returns false if the section is identical to the last one for which
+    // this returned true, tables are repeated many times per second.
+    bool isNewVersion();
+
+protected:
+    virtual ~PSISection();
+
+private:
+    enum {
+        // 3 header bytes and a section_length of at most 1021.
+        kMaxSectionSize = 1024,
+    };
+
+    uint8_t mData[kMaxSectionSize];
+    size_t mSize;
+    bool mMalformed;
+
+    uint8_t mLastData[kMaxSectionSize];
+    size_t mLastSize;
+
+    size_t sectionSize() const;
+
+    DISALLOW_EVIL_CONSTRUCTORS(PSISection);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+ATSParser::Program::Program(
+        ATSParser *parser, unsigned programNumber, unsigned programMapPID)
+    : mParser(parser),
+      mProgramNumber(programNumber),
+      mProgramMapPID(programMapPID),
+      mPCRPID(0x1fff),
+      mLastStream(NULL),
+      mFirstPTSValid(false),
+      mFirstPTS(0),
+      mRefPTS(0),
+      mLastPTSValid(false),
+      mLastPTS(0),
+      mPCRValid(false),
+      mLastPCR(0),
+      mPCRInterval(0),
+      mTimeOffset(0) {
+    ALOGV("new program number %u", programNumber);
+}
+
+bool ATSParser::Program::parsePID(
+        unsigned pid, unsigned continuity_counter,
+        unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size,
+        status_t *err) {
+    *err = OK;
+
+    if (mLastStream == NULL || mLastStream->pid() != pid) {
+        ssize_t index = mStreams.indexOfKey(pid);
+        if (index < 0) {
+            return false;
+        }
+
+        mLastStream = mStreams.editValueAt(index).get();
+    }
+
+    *err = mLastStream->parse(
+            continuity_counter, payload_unit_start_indicator, data, size);
+
+    return true;
+}
+
+static unsigned refineStreamType(
+        unsigned streamType, const uint8_t *descriptors, size_t size) {
+    if (streamType == 0x87) {
+        // ATSC E-AC-3.
+        return ATSParser::STREAMTYPE_AC3;
+    }
+
+    if (streamType != 0x06) {
+        return streamType;
+    }
+
+    // PES private data, the actual codec is found in the descriptors.
+    while (size >= 2) {
+        unsigned tag = descriptors[0];
+        size_t length = descriptors[1];
+
+        if (2 + length > size) {
+            break;
+        }
+
+        const uint8_t *payload = &descriptors[2];
+
+        if (tag == 0x6a || tag == 0x7a) {
+            // DVB AC-3 and enhanced AC-3 descriptors.
+            return ATSParser::STREAMTYPE_AC3;
+        } else if (tag == 0x7b) {
+            return ATSParser::STREAMTYPE_DTS;
+        } else if (tag == 0x05 && length >= 4) {
+            // registration_descriptor, format_identifier
+            if (!memcmp(payload, "AC-3", 4)) {
+                return ATSParser::STREAMTYPE_AC3;
+            } else if (!memcmp(payload, "DTS1", 4)
+                    || !memcmp(payload, "DTS2", 4)
+                    || !memcmp(payload, "DTS3", 4)) {
+                return ATSParser::STREAMTYPE_DTS;
+            } else if (!memcmp(payload, "VC-1", 4)) {
+                return ATSParser::STREAMTYPE_VC1;
+            }
+        }
+
+        descriptors += 2 + length;
+        size -= 2 + length;
+    }
+
+    return streamType;
+}
+
+status_t ATSParser::Program::parseProgramMap(
+        const uint8_t *data, size_t size) {
+    // The section is complete and its CRC was verified, section_length
+    // matches "size".
+    if (size < 16) {
+        return ERROR_MALFORMED;
+    }
+
+    unsigned table_id = data[0];
+    if (table_id != 0x02) {
+        ALOGW("unexpected table_id 0x%02x on PMT PID 0x%04x",
+              table_id, mProgramMapPID);
+        return ERROR_MALFORMED;
+    }
+
+    unsigned program_number = (data[3] << 8) | data[4];
+    if (program_number != mProgramNumber) {
+        // Several programs may share the same PMT PID.
+        return OK;
+    }
+
+    mPCRPID = ((data[8] & 0x1f) << 8) | data[9];
+    ALOGV("program %u, PCR_PID = 0x%04x", mProgramNumber, mPCRPID);
+
+    size_t program_info_length = ((data[10] & 0x0f) << 8) | data[11];
+
+    size_t offset = 12 + program_info_length;
+    size_t end = size - 4;  // CRC
+
+    if (offset > end) {
+        return ERROR_MALFORMED;
+    }
+
+    while (offset + 5 <= end) {
+        unsigned streamType = data[offset];
+        unsigned elementaryPID =
+            ((data[offset + 1] & 0x1f) << 8) | data[offset + 2];
+        size_t ES_info_length =
+            ((data[offset + 3] & 0x0f) << 8) | data[offset + 4];
+
+        offset += 5;
+
+        if (offset + ES_info_length > end) {
+            return ERROR_MALFORMED;
+        }
+
+        streamType = refineStreamType(
+                streamType, &data[offset], ES_info_length);
+
+        offset += ES_info_length;
+
+        ALOGV("stream_type 0x%02x, elementary_PID 0x%04x",
+              streamType, elementaryPID);
+
+        ssize_t index = mStreams.indexOfKey(elementaryPID);
+        if (index >= 0) {
+            if (mStreams.valueAt(index)->type() != streamType) {
+                ALOGW("stream type of PID 0x%04x changed from 0x%02x to "
+                      "0x%02x, ignoring", elementaryPID,
+                      mStreams.valueAt(index)->type(), streamType);
+            }
+            continue;
+        }
+
+        addStream(elementaryPID, streamType);
+    }
+
+    if (offset != end) {
+        ALOGW("%d trailing bytes in PMT", (int)(end - offset));
+    }
+
+    return OK;
+}
+
+void ATSParser::Program::addStream(
+        unsigned elementaryPID, unsigned streamType) {
+    if (!Stream::IsSupportedStreamType(streamType)) {
+        ALOGI("ignoring stream with unsupported type 0x%02x on PID 0x%04x",
+              streamType, elementaryPID);
+        return;
+    }
+
+    mStreams.add(elementaryPID, new Stream(this, elementaryPID, streamType));
+}
+
+void ATSParser::Program::resetClock() {
+    mLastPTSValid = false;
+    mPCRValid = false;
+    mPCRInterval = 0;
+    mTimeOffset = 0;
+}
+
+void ATSParser::Program::updatePCR(uint64_t PCR_base, bool discontinuity) {
+    if (mParser->seekFlag) {
+        // Packets are no longer contiguous.
+        return;
+    }
+
+    if (!mPCRValid) {
+        int64_t ref = (int64_t)PCR_base;
+        if (mLastPTSValid) {
+            ref = mLastPTS;
+        } else if (mFirstPTSValid) {
+            ref = mRefPTS;
+        }
+
+        mLastPCR = extendTimestamp(PCR_base, ref);
+        mPCRValid = true;
+        return;
+    }
+
+    int64_t PCR = extendTimestamp(PCR_base, mLastPCR);
+    int64_t delta = PCR - mLastPCR;
+
+    if (discontinuity || delta < 0 || delta > kMaxPCRDelta) {
+        // The time base jumped, splice the new one onto the end of the old
+        // one so that timestamps handed out keep increasing.
+        int64_t newPCR = (int64_t)PCR_base;
+
+        mTimeOffset += mLastPCR + mPCRInterval - newPCR;
+        mLastPCR = newPCR;
+        mLastPTSValid = false;
+
+        ALOGI("PCR discontinuity on program %u, time offset now %lld us",
+              mProgramNumber, mTimeOffset * 100 / 9);
+        return;
+    }
+
+    if (delta > 0) {
+        mPCRInterval = delta;
+        mLastPCR = PCR;
+    }
+}
+
+int64_t ATSParser::Program::convertPTSToTimestamp(uint64_t PTS) {
+    int64_t extended;
+    if (mPCRValid) {
+        extended = extendTimestamp(PTS, mLastPCR);
+    } else if (mLastPTSValid) {
+        extended = extendTimestamp(PTS, mLastPTS);
+    } else if (mFirstPTSValid) {
+        extended = extendTimestamp(PTS, mRefPTS);
+    } else {
+        extended = (int64_t)PTS;
+    }
+
+    if (!mFirstPTSValid) {
+        mFirstPTSValid = true;
+        mRefPTS = extended;
+
+        if (mParser->mFlags & TS_TIMESTAMPS_ARE_ABSOLUTE) {
+            mFirstPTS = 0;
+        } else {
+            mFirstPTS = extended;
+        }
+    }
+
+    mLastPTS = extended;
+    mLastPTSValid = true;
+
+    int64_t ticks = extended - mFirstPTS + mTimeOffset;
+    if (ticks < 0) {
+        ticks = 0;
+    }
+
+    return (ticks * 100) / 9;
+}
+
+int64_t ATSParser::Program::convertSeekPTSToTimestamp(uint64_t PTS) {
+    if (!mFirstPTSValid) {
+        return convertPTSToTimestamp(PTS);
+    }
+
+    // The position within the file is all that matters here, PCR
+    // discontinuities seen during playback don't apply.
+    int64_t ticks = extendTimestamp(PTS, mRefPTS) - mFirstPTS;
+    if (ticks < 0) {
+        ticks = 0;
+    }
+
+    return (ticks * 100) / 9;
+}
+
+void ATSParser::Program::signalDiscontinuity(
+        DiscontinuityType type, const sp<AMessage> &extra) {
+    if (type & (DISCONTINUITY_TIME | DISCONTINUITY_PLUSTIME)) {
+        resetClock();
+    }
+
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        mStreams.editValueAt(i)->signalDiscontinuity(type, extra);
+    }
+}
+
+void ATSParser::Program::signalEOS(status_t finalResult) {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        mStreams.editValueAt(i)->signalEOS(finalResult);
+    }
+}
+
+void ATSParser::Program::signalSeek() {
+    resetClock();
+
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        mStreams.editValueAt(i)->signalSeek();
+    }
+}
+
+void ATSParser::Program::resetPayload() {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        mStreams.editValueAt(i)->resetPayload();
+    }
+}
+
+void ATSParser::Program::setPlayerType(int type) {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        mStreams.editValueAt(i)->setPlayerType(type);
+    }
+}
+
+sp<MediaSource> ATSParser::Program::getSource(
+        SourceType type, const Vector<int32_t> &excludedPIDs,
+        unsigned *elementaryPID) {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        const sp<Stream> &stream = mStreams.valueAt(i);
+
+        bool excluded = false;
+        for (size_t j = 0; j < excludedPIDs.size(); ++j) {
+            if ((unsigned)excludedPIDs.itemAt(j) == stream->pid()) {
+                excluded = true;
+                break;
+            }
+        }
+
+        if (excluded) {
+            continue;
+        }
+
+        sp<MediaSource> source = stream->getSource(type);
+        if (source != NULL) {
+            *elementaryPID = stream->pid();
+            return source;
+        }
+    }
+
+    return NULL;
+}
+
+int64_t ATSParser::Program::getTimeus(unsigned elementaryPID) {
+    ssize_t index = mStreams.indexOfKey(elementaryPID);
+    if (index < 0) {
+        return 0;
+    }
+
+    return mStreams.valueAt(index)->timeUs();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const size_t kInitialPESBufferSize = 64 * 1024;
+
+ATSParser::Stream::Stream(
+        Program *program, unsigned elementaryPID, unsigned streamType)
+    : mProgram(program),
+      mElementaryPID(elementaryPID),
+      mStreamType(streamType),
+      mExpectedContinuityCounter(-1),
+      mPayloadStarted(false),
+      mPESLength(0),
+      mPESTimeValid(false),
+      mPESTimeUs(0),
+      mCurTimeUs(0),
+      mQueue(NULL) {
+    mBuffer = new ABuffer(kInitialPESBufferSize);
+    mBuffer->setRange(0, 0);
+
+    createQueue();
+}
+
+ATSParser::Stream::~Stream() {
+    delete mQueue;
+    mQueue = NULL;
+}
+
+// static
+bool ATSParser::Stream::IsSupportedStreamType(unsigned streamType) {
+    switch (streamType) {
+        case STREAMTYPE_H264:
+        case STREAMTYPE_MPEG1_VIDEO:
+        case STREAMTYPE_MPEG2_VIDEO:
+        case STREAMTYPE_VC1:
+        case STREAMTYPE_MPEG1_AUDIO:
+        case STREAMTYPE_MPEG2_AUDIO:
+        case STREAMTYPE_MPEG2_AUDIO_ADTS:
+        case STREAMTYPE_MPEG2_AUDIO_LATM:
+        case STREAMTYPE_AC3:
+        case STREAMTYPE_DTS:
+        case STREAMTYPE_DTS1:
+        case STREAMTYPE_DTS2:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void ATSParser::Stream::createQueue() {
+    delete mQueue;
+    mQueue = NULL;
+
+    ElementaryStreamQueue::Mode mode;
+    uint32_t flags = 0;
+
+    switch (mStreamType) {
+        case STREAMTYPE_H264:
+            mode = ElementaryStreamQueue::H264;
+            if (mProgram->parser()->player_type == MPEG2TSExtractor::WIMO) {
+                // Wireless display sources send one picture per PES.
+                flags |= ElementaryStreamQueue::kFlag_AlignedData;
+            }
+            break;
+
+        case STREAMTYPE_MPEG1_VIDEO:
+        case STREAMTYPE_MPEG2_VIDEO:
+            mode = ElementaryStreamQueue::MPEG_VIDEO;
+            break;
+
+        case STREAMTYPE_VC1:
+            mode = ElementaryStreamQueue::VC1;
+            break;
+
+        case STREAMTYPE_MPEG1_AUDIO:
+        case STREAMTYPE_MPEG2_AUDIO:
+            mode = ElementaryStreamQueue::MPEG_AUDIO;
+            break;
+
+        case STREAMTYPE_MPEG2_AUDIO_ADTS:
+            mode = ElementaryStreamQueue::AAC_ADTS;
+            break;
+
+        case STREAMTYPE_MPEG2_AUDIO_LATM:
+            mode = ElementaryStreamQueue::AAC_LATM;
+            break;
+
+        case STREAMTYPE_AC3:
+            mode = ElementaryStreamQueue::AC3;
+            break;
+
+        case STREAMTYPE_DTS:
+        case STREAMTYPE_DTS1:
+        case STREAMTYPE_DTS2:
+            mode = ElementaryStreamQueue::DTS;
+            break;
+
+        default:
+            return;
+    }
+
+    mQueue = new ElementaryStreamQueue(mode, flags);
+}
+
+void ATSParser::Stream::setPlayerType(int type) {
+    if (mStreamType == STREAMTYPE_H264 && mSource == NULL) {
+        createQueue();
+    }
+}
+
+bool ATSParser::Stream::isVideo() const {
+    switch (mStreamType) {
+        case STREAMTYPE_H264:
+        case STREAMTYPE_MPEG1_VIDEO:
+        case STREAMTYPE_MPEG2_VIDEO:
+        case STREAMTYPE_VC1:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool ATSParser::Stream::isAudio() const {
+    switch (mStreamType) {
+        case STREAMTYPE_MPEG1_AUDIO:
+        case STREAMTYPE_MPEG2_AUDIO:
+        case STREAMTYPE_MPEG2_AUDIO_ADTS:
+        case STREAMTYPE_MPEG2_AUDIO_LATM:
+        case STREAMTYPE_AC3:
+        case STREAMTYPE_DTS:
+        case STREAMTYPE_DTS1:
+        case STREAMTYPE_DTS2:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool ATSParser::Stream::isSelected() const {
+    const ATSParser *parser = mProgram->parser();
+
+    return !parser->playStart
+        || mElementaryPID == parser->mAudioPID
+        || mElementaryPID == parser->mVideoPID;
+}
+
+status_t ATSParser::Stream::parse(
+        unsigned continuity_counter,
+        unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size) {
+    if (mExpectedContinuityCounter >= 0) {
+        if (continuity_counter
+                == (((unsigned)mExpectedContinuityCounter - 1) & 0x0f)) {
+            // Duplicate packet.
+            return OK;
+        }
+
+        if ((int)continuity_counter != mExpectedContinuityCounter) {
+            ALOGI("discontinuity on stream pid 0x%04x, expected %d, got %u",
+                  mElementaryPID, mExpectedContinuityCounter,
+                  continuity_counter);
+
+            if (!payload_unit_start_indicator) {
+                // The PES packet we were assembling is missing data.
+                mBuffer->setRange(0, 0);
+                mPayloadStarted = false;
+                mPESLength = 0;
+            }
+        }
+    }
+
+    mExpectedContinuityCounter = (continuity_counter + 1) & 0x0f;
+
+    uint64_t PTS;
+
+    if (mProgram->parser()->seekFlag) {
+        if (payload_unit_start_indicator && peekPTS(data, size, &PTS)) {
+            mCurTimeUs = mProgram->convertSeekPTSToTimestamp(PTS);
+        }
+        return OK;
+    }
+
+    if (!isSelected()) {
+        return OK;
+    }
+
+    status_t err = OK;
+
+    if (payload_unit_start_indicator) {
+        if (mPayloadStarted) {
+            // Unbounded PES packets end where the next one starts.
+            err = flush();
+        }
+
+        mPayloadStarted = true;
+
+        mPESTimeValid = peekPTS(data, size, &PTS);
+        if (mPESTimeValid) {
+            mPESTimeUs = mProgram->convertPTSToTimestamp(PTS);
+        }
+    }
+
+    if (!mPayloadStarted) {
+        return err;
+    }
+
+    appendPayload(data, size);
+
+    if (mPESLength == 0 && mBuffer->size() >= 6) {
+        const uint8_t *pes = mBuffer->data();
+        unsigned PES_packet_length = (pes[4] << 8) | pes[5];
+
+        if (PES_packet_length > 0) {
+            mPESLength = 6 + PES_packet_length;
+        }
+    }
+
+    if (mPESLength > 0 && mBuffer->size() >= mPESLength) {
+        // Bounded PES packets are complete as soon as all their payload
+        // arrived, no need to hold on to them until the next one starts.
+        status_t flushErr = flush();
+        mPayloadStarted = false;
+
+        if (err == OK) {
+            err = flushErr;
+        }
+    }
+
+    return err;
+}
+
+void ATSParser::Stream::appendPayload(const uint8_t *data, size_t size) {
+    size_t needed = mBuffer->size() + size;
+    if (mPESLength > needed) {
+        needed = mPESLength;
+    }
+
+    if (needed > mBuffer->capacity()) {
+        size_t newCapacity = mBuffer->capacity() * 2;
+        while (newCapacity < needed) {
+            newCapacity *= 2;
+        }
+
+        ALOGV("growing PES buffer of PID 0x%04x to %d bytes",
+              mElementaryPID, (int)newCapacity);
+
+        sp<ABuffer> newBuffer = new ABuffer(newCapacity);
+        memcpy(newBuffer->data(), mBuffer->data(), mBuffer->size());
+        newBuffer->setRange(0, mBuffer->size());
+        mBuffer = newBuffer;
+    }
+
+    memcpy(mBuffer->data() + mBuffer->size(), data, size);
+    mBuffer->setRange(0, mBuffer->size() + size);
+}
+
+status_t ATSParser::Stream::flush() {
+    if (mBuffer->size() == 0) {
+        return OK;
+    }
+
+    ALOGV("flushing stream 0x%04x size = %d",
+          mElementaryPID, (int)mBuffer->size());
+
+    status_t err = parsePES(mBuffer->data(), mBuffer->size());
+
+    mBuffer->setRange(0, 0);
+    mPESLength = 0;
+    mPESTimeValid = false;
+
+    return err;
+}
+
+status_t ATSParser::Stream::parsePES(const uint8_t *data, size_t size) {
+    if (size < 6) {
+        return ERROR_MALFORMED;
+    }
+
+    if (data[0] != 0x00 || data[1] != 0x00 || data[2] != 0x01) {
+        ALOGW("missing PES start code on PID 0x%04x", mElementaryPID);
+        return ERROR_MALFORMED;
+    }
+
+    unsigned stream_id = data[3];
+    size_t PES_packet_length = (data[4] << 8) | data[5];
+
+    if (stream_id == 0xbc       // program_stream_map
+            || stream_id == 0xbe    // padding_stream
+            || stream_id == 0xbf    // private_stream_2
+            || stream_id == 0xf0    // ECM
+            || stream_id == 0xf1    // EMM
+            || stream_id == 0xff    // program_stream_directory
+            || stream_id == 0xf2    // DSMCC
+            || stream_id == 0xf8) { // H.222.1 type E
+        return OK;
+    }
+
+    if (size < 9 || (data[6] >> 6) != 2) {
+        return ERROR_MALFORMED;
+    }
+
+    unsigned PTS_DTS_flags = data[7] >> 6;
+    size_t PES_header_data_length = data[8];
+
+    if (9 + PES_header_data_length > size) {
+        return ERROR_MALFORMED;
+    }
+
+    uint64_t PTS = 0;
+    if (PTS_DTS_flags == 2 || PTS_DTS_flags == 3) {
+        if (PES_header_data_length < 5 || !timestampMarkersOkay(&data[9])) {
+            return ERROR_MALFORMED;
+        }
+
+        PTS = parseTimestamp(&data[9]);
+    }
+
+    const uint8_t *payload = &data[9 + PES_header_data_length];
+    size_t payloadSize = size - 9 - PES_header_data_length;
+
+    if (PES_packet_length != 0) {
+        if (PES_packet_length < 3 + PES_header_data_length) {
+            return ERROR_MALFORMED;
+        }
+
+        size_t dataLength = PES_packet_length - 3 - PES_header_data_length;
+
+        if (dataLength > payloadSize) {
+            ALOGW("PES packet on PID 0x%04x truncated, %d of %d bytes",
+                  mElementaryPID, (int)payloadSize, (int)dataLength);
+        } else {
+            // Anything beyond is stuffing.
+            payloadSize = dataLength;
+        }
+    }
+
+    onPayloadData(PTS_DTS_flags, PTS, payload, payloadSize);
+
+    return OK;
+}
+
+void ATSParser::Stream::onPayloadData(
+        unsigned PTS_DTS_flags, uint64_t PTS,
+        const uint8_t *data, size_t size) {
+    int64_t timeUs = -1;
+    if (PTS_DTS_flags == 2 || PTS_DTS_flags == 3) {
+        timeUs = mPESTimeValid
+            ? mPESTimeUs : mProgram->convertPTSToTimestamp(PTS);
+        mCurTimeUs = timeUs;
+    }
+
+    if (mQueue == NULL || size == 0) {
+        return;
+    }
+
+    if (mQueue->appendData(data, size, timeUs) != OK) {
+        return;
+    }
+
+    drainQueue();
+}
+
+void ATSParser::Stream::drainQueue() {
+    MediaBuffer *accessUnit;
+    while ((accessUnit = mQueue->dequeueAccessUnit()) != NULL) {
+        if (mSource == NULL) {
+            sp<MetaData> meta = mQueue->getFormat();
+            CHECK(meta != NULL);
+
+            const char *mime;
+            CHECK(meta->findCString(kKeyMIMEType, &mime));
+            ALOGV("stream PID 0x%04x of type 0x%02x now has data, %s",
+                  mElementaryPID, mStreamType, mime);
+
+            mSource = new AnotherPacketSource(meta);
+            mSource->mElementaryPID = mElementaryPID;
+            mSource->mVideoFlag = isVideo();
+            mSource->mIsAudio = isAudio();
+        }
+
+        mSource->queueAccessUnit(accessUnit);
+    }
+}
+
+void ATSParser::Stream::resetPayload() {
+    mExpectedContinuityCounter = -1;
+
+    mBuffer->setRange(0, 0);
+    mPayloadStarted = false;
+    mPESLength = 0;
+    mPESTimeValid = false;
+
+    if (mQueue != NULL) {
+        mQueue->clear(false);
+    }
+}
+
+void ATSParser::Stream::signalDiscontinuity(
+        DiscontinuityType type, const sp<AMessage> &extra) {
+    resetPayload();
+
+    if (mQueue != NULL) {
+        bool isFormatChange =
+            (isAudio() && (type & DISCONTINUITY_AUDIO_FORMAT))
+                || (isVideo() && (type & DISCONTINUITY_VIDEO_FORMAT));
+
+        mQueue->clear(isFormatChange);
+    }
+
+    if (mSource != NULL) {
+        mSource->queueDiscontinuity(type, extra);
+    }
+}
+
+void ATSParser::Stream::signalEOS(status_t finalResult) {
+    if (mPayloadStarted && !mProgram->parser()->seekFlag) {
+        flush();
+        mPayloadStarted = false;
+    }
+
+    if (mQueue != NULL) {
+        mQueue->signalEOS();
+        drainQueue();
+    }
+
+    if (mSource != NULL) {
+        mSource->signalEOS(finalResult);
+    }
+}
+
+void ATSParser::Stream::signalSeek() {
+    mCurTimeUs = 0;
+
+    resetPayload();
+
+    if (mSource != NULL) {
+        mSource->clear();
+    }
+}
+
+sp<MediaSource> ATSParser::Stream::getSource(SourceType type) {
+    if ((type == VIDEO && isVideo()) || (type == AUDIO && isAudio())) {
+        return mSource;
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ATSParser::PSISection::PSISection()
+    : mSize(0),
+      mMalformed(false),
+      mLastSize(0) {
+}
+
+ATSParser::PSISection::~PSISection() {
+}
+
+size_t ATSParser::PSISection::sectionSize() const {
+    CHECK_GE(mSize, 3u);
+
+    return 3 + (((mData[1] & 0x0f) << 8) | mData[2]);
+}
+
+size_t ATSParser::PSISection::append(const uint8_t *data, size_t size) {
+    size_t consumed = 0;
+
+    if (mSize < 3) {
+        size_t n = 3 - mSize;
+        if (n > size) {
+            n = size;
+        }
+
+        memcpy(&mData[mSize], data, n);
+        mSize += n;
+        consumed += n;
+
+        if (mSize < 3) {
+            return consumed;
+        }
+
+        if (sectionSize() > kMaxSectionSize) {
+            mMalformed = true;
+            return size;
+        }
+    }
+
+    size_t n = sectionSize() - mSize;
+    if (n > size - consumed) {
+        n = size - consumed;
+    }
+
+    memcpy(&mData[mSize], &data[consumed], n);
+    mSize += n;
+    consumed += n;
+
+    return consumed;
+}
+
+void ATSParser::PSISection::clear() {
+    mSize = 0;
+    mMalformed = false;
+}
+
+bool ATSParser::PSISection::isComplete() const {
+    return !mMalformed && mSize >= 3 && mSize == sectionSize();
+}
+
+bool ATSParser::PSISection::isCRCOkay() const {
+    // CRC-32/MPEG-2 over the complete section including the CRC itself
+    // yields zero.
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < mSize; ++i) {
+        crc ^= (uint32_t)mData[i] << 24;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+
+    return crc == 0;
+}
+
+bool ATSParser::PSISection::isNewVersion() {
+    if (mSize == mLastSize && !memcmp(mData, mLastData, mSize)) {
+        return false;
+    }
+
+    memcpy(mLastData, mData, mSize);
+    mLastSize = mSize;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ATSParser::ATSParser(uint32_t flags)
+    : mFlags(flags),
+      kTSPacketSize(188),
+      seekFlag(0),
+      mAudioPID(0),
+      mVideoPID(0),
+      playStart(false),
+      player_type(0) {
+#if defined(__arm__) && !defined(TS_DEBUG)
+    // The prebuilt MPEG2TSExtractor (libstagefright_mpeg2tsextractor.a) was
+    // compiled for ARM against these headers. It allocates ATSParser itself
+    // and reads the public members of ATSParser and AnotherPacketSource in
+    // place, so these must match what it was built with.
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(sizeof(ATSParser) == 96);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(offsetof(ATSParser, mPIDbuffer) == 8);
+
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, quen_memUsed) == 4);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, quen_num) == 8);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, mVideoFlag) == 12);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, mIsAudio) == 13);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, discontinuityFlag) == 14);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, mType) == 16);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, mProgramID) == 20);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, mElementaryPID) == 24);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, lastTimestamp) == 32);
+    COMPILE_TIME_ASSERT_FUNCTION_SCOPE(
+            offsetof(AnotherPacketSource, IsAbufferFlag) == 40);
+#endif
+
+#ifdef TS_DEBUG
+    fp = fopen("/data/video/ts_dump.ts", "wb");
+#endif
+    mPSISections.add(0 /* PID */, new PSISection);
+}
+
+ATSParser::~ATSParser() {
+#ifdef TS_DEBUG
+    if (fp != NULL) {
+        fclose(fp);
+        fp = NULL;
+    }
+#endif
+}
+
+void ATSParser::set_player_type(int type) {
+    player_type = type;
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->setPlayerType(type);
+    }
+}
+
+status_t ATSParser::feedTSPacket(const void *data, size_t size) {
+    return feedTSPacket(data, size, 0);
+}
+
+status_t ATSParser::feedTSPacket(
+        const void *data, size_t size, uint32_t seekflag) {
+#ifdef TS_DEBUG
+    if (fp != NULL) {
+        fwrite(data, 1, size, fp);
+    }
+#endif
+
+    if (seekflag != seekFlag) {
+        // Payload collected on either side of the switch doesn't belong
+        // together.
+        seekFlag = seekflag;
+
+        for (size_t i = 0; i < mPrograms.size(); ++i) {
+            mPrograms.editItemAt(i)->resetPayload();
+        }
+    }
+
+    const uint8_t *ptr = (const uint8_t *)data;
+
+    while (size >= kTSPacketSize) {
+        if (ptr[0] != 0x47) {
+            // Lost sync, look for a sync byte that is followed by another
+            // one a packet later if we can tell.
+            size_t offset = 1;
+            while (offset < size) {
+                const uint8_t *next =
+                    (const uint8_t *)memchr(&ptr[offset], 0x47, size - offset);
+
+                if (next == NULL) {
+                    offset = size;
+                    break;
+                }
+
+                offset = next - ptr;
+
+                if (offset + kTSPacketSize >= size
+                        || ptr[offset + kTSPacketSize] == 0x47) {
+                    break;
+                }
+
+                ++offset;
+            }
+
+            ALOGW("lost sync, skipping %d bytes", (int)offset);
+
+            ptr += offset;
+            size -= offset;
+            continue;
+        }
+
+        status_t err = parseTS(ptr);
+
+        if (err != OK) {
+            ALOGV("dropping malformed packet (%d)", err);
+        }
+
+        ptr += kTSPacketSize;
+        size -= kTSPacketSize;
+    }
+
+    if (size > 0) {
+        ALOGW("ignoring %d trailing bytes of a partial packet", (int)size);
+    }
+
+    return OK;
+}
+
+status_t ATSParser::parseTS(const uint8_t *packet) {
+    unsigned transport_error_indicator = packet[1] >> 7;
+    unsigned payload_unit_start_indicator = (packet[1] >> 6) & 1;
+    unsigned PID = ((packet[1] & 0x1f) << 8) | packet[2];
+    unsigned adaptation_field_control = (packet[3] >> 4) & 3;
+    unsigned continuity_counter = packet[3] & 0x0f;
+
+    if (transport_error_indicator || PID == 0x1fff) {
+        return OK;
+    }
+
+    const uint8_t *payload = &packet[4];
+    size_t payloadSize = kTSPacketSize - 4;
+
+    if (adaptation_field_control & 2) {
+        size_t adaptation_field_length = packet[4];
+
+        if (adaptation_field_length + 1 > payloadSize) {
+            return ERROR_MALFORMED;
+        }
+
+        parseAdaptationField(PID, &packet[5], adaptation_field_length);
+
+        payload += 1 + adaptation_field_length;
+        payloadSize -= 1 + adaptation_field_length;
+    }
+
+    if (!(adaptation_field_control & 1) || payloadSize == 0) {
+        return OK;
+    }
+
+    return parsePID(
+            PID, continuity_counter, payload_unit_start_indicator,
+            payload, payloadSize);
+}
+
+void ATSParser::parseAdaptationField(
+        unsigned PID, const uint8_t *data, size_t size) {
+    if (size < 7 || !(data[0] & 0x10) /* PCR_flag */) {
+        return;
+    }
+
+    bool discontinuity_indicator = (data[0] & 0x80) != 0;
+
+    uint64_t PCR_base =
+        ((uint64_t)data[1] << 25)
+        | ((uint64_t)data[2] << 17)
+        | ((uint64_t)data[3] << 9)
+        | ((uint64_t)data[4] << 1)
+        | (data[5] >> 7);
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        if (mPrograms.itemAt(i)->PCRPID() == PID) {
+            mPrograms.editItemAt(i)->updatePCR(
+                    PCR_base, discontinuity_indicator);
+        }
+    }
+}
+
+status_t ATSParser::parsePID(
+        unsigned PID, unsigned continuity_counter,
+        unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size) {
+    ssize_t sectionIndex = mPSISections.indexOfKey(PID);
+
+    if (sectionIndex >= 0) {
+        return parsePSISection(
+                PID, payload_unit_start_indicator, data, size);
+    }
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        status_t err;
+        if (mPrograms.editItemAt(i)->parsePID(
+                    PID, continuity_counter, payload_unit_start_indicator,
+                    data, size, &err)) {
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+status_t ATSParser::parsePSISection(
+        unsigned PID, unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size) {
+    sp<PSISection> section = mPSISections.valueFor(PID);
+
+    if (payload_unit_start_indicator) {
+        unsigned pointer_field = data[0];
+        ++data;
+        --size;
+
+        if (pointer_field > size) {
+            section->clear();
+            return ERROR_MALFORMED;
+        }
+
+        if (!section->isEmpty()) {
+            // The bytes before the pointer complete the previous section.
+            section->append(data, pointer_field);
+        }
+
+        if (!section->isComplete()) {
+            section->clear();
+        }
+
+        data += pointer_field;
+        size -= pointer_field;
+    } else if (section->isEmpty()) {
+        // Waiting for the start of a section.
+        return OK;
+    }
+
+    status_t err = OK;
+
+    for (;;) {
+        if (section->isComplete()) {
+            if (section->isNewVersion()) {
+                if (!section->isCRCOkay()) {
+                    ALOGW("PSI section on PID 0x%04x has a bad CRC", PID);
+                    err = ERROR_MALFORMED;
+                } else {
+                    const uint8_t *sectionData = section->data();
+                    size_t sectionSize = section->size();
+
+                    // current_next_indicator
+                    if (sectionSize >= 8 && (sectionData[5] & 1)) {
+                        if (PID == 0) {
+                            ABitReader br(sectionData, sectionSize);
+                            parseProgramAssociationTable(&br);
+                        } else {
+                            for (size_t i = 0; i < mPrograms.size(); ++i) {
+                                if (mPrograms.itemAt(i)->programMapPID()
+                                        != PID) {
+                                    continue;
+                                }
+
+                                status_t pmtErr =
+                                    mPrograms.editItemAt(i)->parseProgramMap(
+                                            sectionData, sectionSize);
+
+                                if (pmtErr != OK) {
+                                    err = pmtErr;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            section->clear();
+        }
+
+        if (size == 0 || (section->isEmpty() && data[0] == 0xff)) {
+            // The rest of the packet is stuffing.
+            break;
+        }
+
+        size_t n = section->append(data, size);
+        data += n;
+        size -= n;
+
+        if (section->isMalformed()) {
+            ALOGW("oversized PSI section on PID 0x%04x", PID);
+            section->clear();
+            return ERROR_MALFORMED;
+        }
+
+        if (!section->isComplete()) {
+            break;
+        }
+    }
+
+    return err;
+}
+
+void ATSParser::parseProgramAssociationTable(ABitReader *br) {
+    // The section is complete, at least 8 bytes long and its CRC was
+    // verified.
+    size_t sectionSize = br->numBitsLeft() / 8;
+
+    unsigned table_id = br->getBits(8);
+    if (table_id != 0x00) {
+        ALOGW("unexpected table_id 0x%02x on PAT PID", table_id);
+        return;
+    }
+
+    br->skipBits(4);  // section_syntax_indicator, '0', reserved
+    unsigned section_length = br->getBits(12);
+    br->skipBits(16);  // transport_stream_id
+    br->skipBits(2);   // reserved
+    br->skipBits(5);   // version_number
+    br->skipBits(1);   // current_next_indicator
+    br->skipBits(8);   // section_number
+    br->skipBits(8);   // last_section_number
+
+    CHECK_EQ(3 + section_length, sectionSize);
+
+    if (section_length < 9) {
+        return;
+    }
+
+    size_t numProgramBytes = section_length - 5 /* header */ - 4 /* crc */;
+
+    for (size_t i = 0; i < numProgramBytes / 4; ++i) {
+        unsigned program_number = br->getBits(16);
+        br->skipBits(3);  // reserved
+
+        if (program_number == 0) {
+            br->skipBits(13);  // network_PID
+            continue;
+        }
+
+        unsigned programMapPID = br->getBits(13);
+
+        ALOGV("program_number %u, program_map_PID 0x%04x",
+              program_number, programMapPID);
+
+        bool found = false;
+        for (size_t index = 0; index < mPrograms.size(); ++index) {
+            const sp<Program> &program = mPrograms.itemAt(index);
+
+            if (program->number() == program_number) {
+                if (program->programMapPID() != programMapPID) {
+                    ALOGW("PMT PID of program %u changed, ignoring",
+                          program_number);
+                }
+
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            mPrograms.push(
+                    new Program(this, program_number, programMapPID));
+        }
+
+        if (mPSISections.indexOfKey(programMapPID) < 0) {
+            mPSISections.add(programMapPID, new PSISection);
+        }
+    }
+}
+
+void ATSParser::createLiveProgramID(
+        unsigned AudioPID, unsigned AudioType,
+        unsigned VideoPID, unsigned VideoType) {
+    // Live sources don't transmit PAT/PMT, the streams are known upfront.
+    sp<Program> program = new Program(this, 1 /* programNumber */, 0x1fff);
+
+    program->addStream(AudioPID, AudioType);
+    program->addStream(VideoPID, VideoType);
+
+    mPrograms.push(program);
+
+    ALOGI("live program, audio PID 0x%04x (0x%02x) video PID 0x%04x (0x%02x)",
+          AudioPID, AudioType, VideoPID, VideoType);
+}
+
+void ATSParser::signalDiscontinuity(
+        DiscontinuityType type, const sp<AMessage> &extra) {
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->signalDiscontinuity(type, extra);
+    }
+}
+
+void ATSParser::signalEOS(status_t finalResult) {
+    CHECK_NE(finalResult, (status_t)OK);
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->signalEOS(finalResult);
+    }
+}
+
+void ATSParser::signalSeek() {
+    for (size_t i = 0; i < mPSISections.size(); ++i) {
+        mPSISections.editValueAt(i)->clear();
+    }
+
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->signalSeek();
+    }
+}
+
+sp<MediaSource> ATSParser::getSource(
+        SourceType type, uint32_t &ProgramID, unsigned &elementaryPID) {
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        if (type == VIDEO && i > 0) {
+            // Only the first program's video is ever played.
+            break;
+        }
+
+        unsigned pid;
+        sp<MediaSource> source =
+            mPrograms.editItemAt(i)->getSource(type, mPIDbuffer, &pid);
+
+        if (source != NULL) {
+            ProgramID = i;
+            elementaryPID = pid;
+            return source;
+        }
+    }
+
+    return NULL;
+}
+
+sp<MediaSource> ATSParser::getSource(SourceType type) {
+    uint32_t programID = 0;
+    unsigned elementaryPID = 0;
+
+    return getSource(type, programID, elementaryPID);
+}
+
+int64_t ATSParser::getTimeus(uint32_t ProgramID, unsigned elementaryPID) {
+    if (ProgramID >= mPrograms.size()) {
+        return 0;
+    }
+
+    return mPrograms.editItemAt(ProgramID)->getTimeus(elementaryPID);
+}
+
+void ATSParser::Start(unsigned AudioPID, unsigned VideoPID) {
+    ALOGV("Start audio PID 0x%04x video PID 0x%04x", AudioPID, VideoPID);
+
+    mAudioPID = AudioPID;
+    mVideoPID = VideoPID;
+    playStart = true;
+}
+
+bool ATSParser::PTSTimeDeltaEstablished() {
+    if (mPrograms.isEmpty()) {
+        return false;
+    }
+
+    return mPrograms.itemAt(0)->PTSTimeDeltaEstablished();
+}
+
+}  // namespace android
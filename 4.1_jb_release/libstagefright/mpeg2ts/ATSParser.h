@@ -61,6 +61,9 @@ struct ATSParser : public RefBase {
     ATSParser(uint32_t flags = 0);
     void set_player_type(int type);
 
+    // "size" may span any number of consecutive 188 byte packets. While
+    // "seekflag" is set payloads are not assembled, only the PES timestamps
+    // are tracked (see getTimeus).
     status_t feedTSPacket(const void *data, size_t size,uint32_t seekflag);
 
     status_t feedTSPacket(const void *data, size_t size);
@@ -106,6 +109,8 @@ struct ATSParser : public RefBase {
 protected:
     virtual ~ATSParser();
 private:
+    // MPEG2TSExtractor allocates this object and reads its public members
+    // directly, keep the data member layout unchanged.
     struct Program;
     struct Stream;
     struct PSISection;
@@ -118,20 +123,25 @@ private:
     KeyedVector<unsigned, sp<PSISection> > mPSISections;
 
     void parseProgramAssociationTable(ABitReader *br);
-    void parseProgramMap(ABitReader *br);
-    void parsePES(ABitReader *br);
     size_t kTSPacketSize;
     uint32_t seekFlag;
     unsigned mAudioPID;
     unsigned mVideoPID;
     bool playStart;
     int   player_type;
+    status_t parsePSISection(
+        unsigned PID, unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size);
+
     status_t parsePID(
-        ABitReader *br, unsigned PID,
-        unsigned payload_unit_start_indicator);
+        unsigned PID, unsigned continuity_counter,
+        unsigned payload_unit_start_indicator,
+        const uint8_t *data, size_t size);
+
+    void parseAdaptationField(
+        unsigned PID, const uint8_t *data, size_t size);
 
-    void parseAdaptationField(ABitReader *br);
-    status_t parseTS(ABitReader *br);
+    status_t parseTS(const uint8_t *packet);
 
     DISALLOW_EVIL_CONSTRUCTORS(ATSParser);
 };
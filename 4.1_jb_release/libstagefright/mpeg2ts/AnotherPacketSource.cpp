@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AnotherPacketSource"
+#include <utils/Log.h>
+
+#include "AnotherPacketSource.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/foundation/hexdump.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+AnotherPacketSource::AnotherPacketSource(const sp<MetaData> &meta)
+    : quen_memUsed(0),
+      quen_num(0),
+      mVideoFlag(false),
+      mIsAudio(false),
+      discontinuityFlag(false),
+      mType(0),
+      mProgramID(0),
+      mElementaryPID(0),
+      lastTimestamp(0),
+      IsAbufferFlag(false),
+      mFormat(meta),
+      mEOSResult(OK) {
+    const char *mime;
+    if (meta != NULL && meta->findCString(kKeyMIMEType, &mime)) {
+        if (!strncasecmp("audio/", mime, 6)) {
+            mIsAudio = true;
+        } else if (!strncasecmp("video/", mime, 6)) {
+            mVideoFlag = true;
+        }
+    }
+}
+
+void AnotherPacketSource::setFormat(const sp<MetaData> &meta) {
+    CHECK(mFormat == NULL);
+    mFormat = meta;
+}
+
+AnotherPacketSource::~AnotherPacketSource() {
+    for (size_t i = 0; i < mMediaBuffers.size(); ++i) {
+        mMediaBuffers.editItemAt(i)->release();
+    }
+    mMediaBuffers.clear();
+}
+
+status_t AnotherPacketSource::start(MetaData *params) {
+    return OK;
+}
+
+status_t AnotherPacketSource::stop() {
+    Mutex::Autolock autoLock(mLock);
+
+    for (size_t i = 0; i < mMediaBuffers.size(); ++i) {
+        mMediaBuffers.editItemAt(i)->release();
+    }
+    mMediaBuffers.clear();
+    mBuffers.clear();
+
+    quen_num = 0;
+    quen_memUsed = 0;
+
+    return OK;
+}
+
+sp<MetaData> AnotherPacketSource::getFormat() {
+    return mFormat;
+}
+
+status_t AnotherPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
+    buffer->clear();
+
+    Mutex::Autolock autoLock(mLock);
+    while (mEOSResult == OK && mBuffers.empty()) {
+        mCondition.wait(mLock);
+    }
+
+    if (!mBuffers.empty()) {
+        *buffer = *mBuffers.begin();
+        mBuffers.erase(mBuffers.begin());
+
+        int32_t discontinuity;
+        if ((*buffer)->meta()->findInt32("discontinuity", &discontinuity)) {
+            if (wasFormatChange(discontinuity)) {
+                mFormat.clear();
+            }
+
+            return INFO_DISCONTINUITY;
+        }
+
+        if (quen_num > 0) {
+            --quen_num;
+        }
+
+        if (quen_memUsed >= (*buffer)->size()) {
+            quen_memUsed -= (*buffer)->size();
+        } else {
+            quen_memUsed = 0;
+        }
+
+        return OK;
+    }
+
+    return mEOSResult;
+}
+
+status_t AnotherPacketSource::read(
+        MediaBuffer **out, const ReadOptions *) {
+    *out = NULL;
+
+    Mutex::Autolock autoLock(mLock);
+    while (mEOSResult == OK
+            && (IsAbufferFlag ? mBuffers.empty() : mMediaBuffers.isEmpty())) {
+        mCondition.wait(mLock);
+    }
+
+    if (IsAbufferFlag && !mBuffers.empty()) {
+        const sp<ABuffer> buffer = *mBuffers.begin();
+        mBuffers.erase(mBuffers.begin());
+
+        int32_t discontinuity;
+        if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
+            if (wasFormatChange(discontinuity)) {
+                mFormat.clear();
+            }
+
+            return INFO_DISCONTINUITY;
+        }
+
+        if (quen_num > 0) {
+            --quen_num;
+        }
+
+        if (quen_memUsed >= buffer->size()) {
+            quen_memUsed -= buffer->size();
+        } else {
+            quen_memUsed = 0;
+        }
+
+        int64_t timeUs;
+        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+
+        MediaBuffer *mediaBuffer = new MediaBuffer(buffer);
+        mediaBuffer->meta_data()->setInt64(kKeyTime, timeUs);
+
+        *out = mediaBuffer;
+        return OK;
+    }
+
+    if (!mMediaBuffers.isEmpty()) {
+        MediaBuffer *mediaBuffer = mMediaBuffers.itemAt(0);
+        mMediaBuffers.removeAt(0);
+
+        if (!mVideoFlag) {
+            // Audio frames without a timestamp of their own continue
+            // from the last known position.
+            int64_t timeUs;
+            if (mediaBuffer->meta_data()->findInt64(kKeyTime, &timeUs)
+                    && timeUs == 0) {
+                mediaBuffer->meta_data()->setInt64(kKeyTime, lastTimestamp);
+            }
+        }
+
+        if (quen_num > 0) {
+            --quen_num;
+        }
+
+        if (quen_memUsed >= mediaBuffer->range_length()) {
+            quen_memUsed -= mediaBuffer->range_length();
+        } else {
+            quen_memUsed = 0;
+        }
+
+        *out = mediaBuffer;
+        return OK;
+    }
+
+    return mEOSResult;
+}
+
+bool AnotherPacketSource::wasFormatChange(
+        int32_t discontinuityType) const {
+    if (mIsAudio) {
+        return (discontinuityType & ATSParser::DISCONTINUITY_AUDIO_FORMAT) != 0;
+    }
+
+    return (discontinuityType & ATSParser::DISCONTINUITY_VIDEO_FORMAT) != 0;
+}
+
+void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
+    int32_t damaged;
+    if (buffer->meta()->findInt32("damaged", &damaged) && damaged) {
+        // LOG(VERBOSE) << "discarding damaged AU";
+        return;
+    }
+
+    int64_t timeUs;
+    CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+    ALOGV("queueAccessUnit timeUs=%lld us (%.2f secs)",
+          timeUs, timeUs / 1E6);
+
+    Mutex::Autolock autoLock(mLock);
+    mBuffers.push_back(buffer);
+    IsAbufferFlag = true;
+
+    ++quen_num;
+    quen_memUsed += buffer->size();
+
+    mCondition.signal();
+}
+
+void AnotherPacketSource::queueAccessUnit(MediaBuffer *buffer) {
+    Mutex::Autolock autoLock(mLock);
+    mMediaBuffers.push(buffer);
+
+    ++quen_num;
+    quen_memUsed += buffer->range_length();
+
+    mCondition.signal();
+}
+
+void AnotherPacketSource::queueDiscontinuity(
+        ATSParser::DiscontinuityType type,
+        const sp<AMessage> &extra) {
+    Mutex::Autolock autoLock(mLock);
+
+    // Leave only discontinuities in the queue.
+    List<sp<ABuffer> >::iterator it = mBuffers.begin();
+    while (it != mBuffers.end()) {
+        sp<ABuffer> oldBuffer = *it;
+
+        int32_t oldDiscontinuityType;
+        if (!oldBuffer->meta()->findInt32(
+                    "discontinuity", &oldDiscontinuityType)) {
+            it = mBuffers.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+
+    for (size_t i = 0; i < mMediaBuffers.size(); ++i) {
+        mMediaBuffers.editItemAt(i)->release();
+    }
+    mMediaBuffers.clear();
+
+    quen_num = 0;
+    quen_memUsed = 0;
+
+    mEOSResult = OK;
+
+    mType = type;
+    discontinuityFlag = true;
+
+    if (IsAbufferFlag) {
+        sp<ABuffer> buffer = new ABuffer(0);
+        buffer->meta()->setInt32("discontinuity", static_cast<int32_t>(type));
+        buffer->meta()->setMessage("extra", extra);
+
+        mBuffers.push_back(buffer);
+    }
+
+    mCondition.signal();
+}
+
+void AnotherPacketSource::signalEOS(status_t result) {
+    CHECK(result != OK);
+
+    Mutex::Autolock autoLock(mLock);
+    mEOSResult = result;
+    mCondition.signal();
+}
+
+bool AnotherPacketSource::hasBufferAvailable(status_t *finalResult) {
+    Mutex::Autolock autoLock(mLock);
+    if (IsAbufferFlag ? !mBuffers.empty() : !mMediaBuffers.isEmpty()) {
+        return true;
+    }
+
+    *finalResult = mEOSResult;
+    return false;
+}
+
+uint32_t AnotherPacketSource::numBufferAvailable(int32_t *mUseMem) {
+    Mutex::Autolock autoLock(mLock);
+    if (mUseMem != NULL) {
+        *mUseMem = quen_memUsed;
+    }
+
+    return quen_num;
+}
+
+int64_t AnotherPacketSource::getCurrentPackTime() {
+    Mutex::Autolock autoLock(mLock);
+    if (mMediaBuffers.isEmpty()) {
+        return 0;
+    }
+
+    int64_t timeUs;
+    if (!mMediaBuffers.itemAt(0)->meta_data()->findInt64(kKeyTime, &timeUs)) {
+        return 0;
+    }
+
+    return timeUs;
+}
+
+int64_t AnotherPacketSource::getBufferedDurationUs(status_t *finalResult) {
+    Mutex::Autolock autoLock(mLock);
+
+    *finalResult = mEOSResult;
+
+    if (mBuffers.empty()) {
+        return 0;
+    }
+
+    int64_t time1 = -1;
+    int64_t time2 = -1;
+
+    List<sp<ABuffer> >::iterator it = mBuffers.begin();
+    while (it != mBuffers.end()) {
+        const sp<ABuffer> &buffer = *it;
+
+        int64_t timeUs;
+        if (buffer->meta()->findInt64("timeUs", &timeUs)) {
+            if (time1 < 0) {
+                time1 = timeUs;
+            }
+
+            time2 = timeUs;
+        } else {
+            // This is a discontinuity, reset everything.
+            time1 = time2 = -1;
+        }
+
+        ++it;
+    }
+
+    return time2 - time1;
+}
+
+status_t AnotherPacketSource::nextBufferTime(int64_t *timeUs) {
+    *timeUs = 0;
+
+    Mutex::Autolock autoLock(mLock);
+
+    if (IsAbufferFlag) {
+        if (mBuffers.empty()) {
+            return mEOSResult != OK ? mEOSResult : -EWOULDBLOCK;
+        }
+
+        sp<ABuffer> buffer = *mBuffers.begin();
+        CHECK(buffer->meta()->findInt64("timeUs", timeUs));
+
+        return OK;
+    }
+
+    if (mMediaBuffers.isEmpty()) {
+        return mEOSResult != OK ? mEOSResult : -EWOULDBLOCK;
+    }
+
+    CHECK(mMediaBuffers.itemAt(0)->meta_data()->findInt64(kKeyTime, timeUs));
+
+    return OK;
+}
+
+void AnotherPacketSource::setLastTime(uint64_t timeus) {
+    Mutex::Autolock autoLock(mLock);
+    lastTimestamp = timeus;
+}
+
+void AnotherPacketSource::clear() {
+    Mutex::Autolock autoLock(mLock);
+
+    for (size_t i = 0; i < mMediaBuffers.size(); ++i) {
+        mMediaBuffers.editItemAt(i)->release();
+    }
+    mMediaBuffers.clear();
+    mBuffers.clear();
+
+    quen_num = 0;
+    quen_memUsed = 0;
+    discontinuityFlag = false;
+
+    mEOSResult = OK;
+}
+
+}  // namespace android
@@ -0,0 +1,1220 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ESQueue"
+#include <media/stagefright/foundation/ADebug.h>
+
+#include "ESQueue.h"
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+
+#include "include/avc_utils.h"
+
+namespace android {
+
+// Upper bound for payload we keep around without finding a single
+// access unit in it, protects against streams we misidentified.
+static const size_t kMaxPendingSize = 8 * 1024 * 1024;
+
+static const size_t kInitialBufferSize = 64 * 1024;
+
+ElementaryStreamQueue::ElementaryStreamQueue(Mode mode, uint32_t flags)
+    : mMode(mode),
+      mFlags(flags),
+      mEOS(false),
+      mLastTimeUs(-1),
+      mLastDurationUs(0),
+      mScanOffset(0),
+      mSawVCL(false),
+      mIsIDR(false),
+      mSawPicture(false),
+      mLATMConfigValid(false),
+      mLATMFrameLengthType(0),
+      mLATMOtherDataLenBits(0) {
+}
+
+ElementaryStreamQueue::~ElementaryStreamQueue() {
+}
+
+sp<MetaData> ElementaryStreamQueue::getFormat() {
+    return mFormat;
+}
+
+void ElementaryStreamQueue::clear(bool clearFormat) {
+    if (mBuffer != NULL) {
+        mBuffer->setRange(0, 0);
+    }
+
+    mRangeInfos.clear();
+
+    mEOS = false;
+    mLastTimeUs = -1;
+    mLastDurationUs = 0;
+    mScanOffset = 0;
+    mSawVCL = false;
+    mIsIDR = false;
+    mSawPicture = false;
+
+    if (clearFormat) {
+        mFormat.clear();
+        mSeqParamSet.clear();
+        mPicParamSet.clear();
+        mLATMConfigValid = false;
+    }
+}
+
+void ElementaryStreamQueue::signalEOS() {
+    mEOS = true;
+}
+
+status_t ElementaryStreamQueue::appendData(
+        const void *data, size_t size, int64_t timeUs) {
+    if (size == 0) {
+        return OK;
+    }
+
+    if (mBuffer == NULL) {
+        mBuffer = new ABuffer(
+                size > kInitialBufferSize ? size : kInitialBufferSize);
+        mBuffer->setRange(0, 0);
+    }
+
+    size_t neededSize = mBuffer->size() + size;
+    if (mBuffer->offset() + neededSize > mBuffer->capacity()) {
+        if (neededSize <= mBuffer->capacity()) {
+            // Enough room once the already consumed data is dropped.
+            memmove(mBuffer->base(), mBuffer->data(), mBuffer->size());
+            mBuffer->setRange(0, mBuffer->size());
+        } else {
+            size_t newCapacity = mBuffer->capacity() * 2;
+            if (newCapacity < neededSize) {
+                newCapacity = neededSize;
+            }
+
+            ALOGV("resizing buffer to %d bytes", newCapacity);
+
+            sp<ABuffer> buffer = new ABuffer(newCapacity);
+            memcpy(buffer->data(), mBuffer->data(), mBuffer->size());
+            buffer->setRange(0, mBuffer->size());
+
+            mBuffer = buffer;
+        }
+    }
+
+    memcpy(mBuffer->data() + mBuffer->size(), data, size);
+    mBuffer->setRange(mBuffer->offset(), neededSize);
+
+    RangeInfo info;
+    info.mLength = size;
+    info.mTimestampUs = timeUs;
+    mRangeInfos.push_back(info);
+
+    return OK;
+}
+
+void ElementaryStreamQueue::consume(size_t size) {
+    CHECK_LE(size, mBuffer->size());
+
+    mBuffer->setRange(mBuffer->offset() + size, mBuffer->size() - size);
+
+    if (mBuffer->size() == 0) {
+        // Cheap to rewind now, saves a memmove on the next append.
+        mBuffer->setRange(0, 0);
+    }
+
+    while (size > 0 && !mRangeInfos.empty()) {
+        RangeInfo *info = &*mRangeInfos.begin();
+
+        if (info->mLength > size) {
+            info->mLength -= size;
+            break;
+        }
+
+        size -= info->mLength;
+        mRangeInfos.erase(mRangeInfos.begin());
+    }
+}
+
+// Returns the timestamp that belongs to an access unit starting at the
+// front of the queue and consumes the access unit. A PES timestamp applies
+// to the first access unit starting in that PES payload, later access units
+// of the same payload get -1 and are extrapolated.
+int64_t ElementaryStreamQueue::fetchTimestamp(size_t size) {
+    int64_t timeUs = -1;
+
+    if (!mRangeInfos.empty()) {
+        RangeInfo *info = &*mRangeInfos.begin();
+        timeUs = info->mTimestampUs;
+        info->mTimestampUs = -1;
+    }
+
+    consume(size);
+
+    return timeUs;
+}
+
+MediaBuffer *ElementaryStreamQueue::makeAccessUnit(
+        const uint8_t *data, size_t size, int64_t timeUs,
+        int64_t durationUs, bool isSync) {
+    if (timeUs < 0) {
+        timeUs = (mLastTimeUs < 0) ? 0 : mLastTimeUs + mLastDurationUs;
+    }
+
+    mLastTimeUs = timeUs;
+    mLastDurationUs = durationUs;
+
+    MediaBuffer *accessUnit = new MediaBuffer(size);
+    memcpy(accessUnit->data(), data, size);
+
+    accessUnit->meta_data()->setInt64(kKeyTime, timeUs);
+    if (isSync) {
+        accessUnit->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+    }
+
+    return accessUnit;
+}
+
+bool ElementaryStreamQueue::resync(
+        size_t offset, uint32_t syncMask, uint32_t syncWord,
+        unsigned syncBytes) {
+    const uint8_t *data = mBuffer->data();
+    size_t size = mBuffer->size();
+
+    while (offset + syncBytes <= size) {
+        uint32_t x = 0;
+        for (unsigned i = 0; i < syncBytes; ++i) {
+            x = (x << 8) | data[offset + i];
+        }
+
+        if ((x & syncMask) == syncWord) {
+            ALOGV("resynced after %d bytes", offset);
+            consume(offset);
+            return true;
+        }
+
+        ++offset;
+    }
+
+    // Keep what might be the beginning of a sync word.
+    if (size >= syncBytes) {
+        consume(size - syncBytes + 1);
+    }
+
+    return false;
+}
+
+// Returns the offset of the next "00 00 01" at or after offset, or -1.
+static ssize_t findStartCode(
+        const uint8_t *data, size_t size, size_t offset) {
+    while (offset + 3 <= size) {
+        const uint8_t *p = (const uint8_t *)memchr(
+                &data[offset + 2], 0x01, size - offset - 2);
+
+        if (p == NULL) {
+            return -1;
+        }
+
+        size_t pos = p - data;
+        if (data[pos - 1] == 0x00 && data[pos - 2] == 0x00) {
+            return pos - 2;
+        }
+
+        offset = pos - 1;
+    }
+
+    return -1;
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnit() {
+    if (mBuffer == NULL || mBuffer->size() == 0) {
+        return NULL;
+    }
+
+    if (mFlags & kFlag_AlignedData) {
+        return dequeueAccessUnitAligned();
+    }
+
+    switch (mMode) {
+        case H264:
+            return dequeueAccessUnitH264();
+        case AAC_ADTS:
+            return dequeueAccessUnitAAC();
+        case AAC_LATM:
+            return dequeueAccessUnitLATM();
+        case MPEG_AUDIO:
+            return dequeueAccessUnitMPEGAudio();
+        case MPEG_VIDEO:
+            return dequeueAccessUnitMPEGVideo();
+        case AC3:
+            return dequeueAccessUnitAC3();
+        case DTS:
+        case VC1:
+            return dequeueAccessUnitAligned();
+        default:
+            TRESPASS();
+            return NULL;
+    }
+}
+
+void ElementaryStreamQueue::updateFormatH264(
+        const uint8_t *nal, size_t size) {
+    if (mFormat != NULL || size == 0) {
+        return;
+    }
+
+    unsigned nalType = nal[0] & 0x1f;
+
+    sp<ABuffer> nalUnit = new ABuffer(size);
+    memcpy(nalUnit->data(), nal, size);
+
+    if (nalType == 7) {
+        mSeqParamSet = nalUnit;
+    } else if (nalType == 8) {
+        mPicParamSet = nalUnit;
+    } else {
+        return;
+    }
+
+    if (mSeqParamSet == NULL || mPicParamSet == NULL) {
+        return;
+    }
+
+    static const uint8_t kStartCode[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+    sp<ABuffer> csd = new ABuffer(
+            8 + mSeqParamSet->size() + mPicParamSet->size());
+
+    uint8_t *out = csd->data();
+    memcpy(out, kStartCode, 4);
+    memcpy(out + 4, mSeqParamSet->data(), mSeqParamSet->size());
+    out += 4 + mSeqParamSet->size();
+    memcpy(out, kStartCode, 4);
+    memcpy(out + 4, mPicParamSet->data(), mPicParamSet->size());
+
+    mFormat = MakeAVCCodecSpecificData(csd);
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitH264() {
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        size_t offset = mScanOffset;
+        bool boundary = false;
+        size_t boundaryOffset = 0;
+
+        for (;;) {
+            ssize_t start = findStartCode(data, size, offset);
+            if (start < 0) {
+                // A partial start code may still be sitting at the end.
+                offset = (size > offset + 2) ? size - 2 : offset;
+                break;
+            }
+
+            size_t nalOffset = start + 3;
+            if (nalOffset + 2 > size && !mEOS) {
+                offset = start;
+                break;
+            }
+
+            unsigned nalType =
+                (nalOffset < size) ? (data[nalOffset] & 0x1f) : 0;
+
+            if (mSawVCL) {
+                if (nalType == 9
+                        || (nalType >= 6 && nalType <= 8)
+                        || (nalType >= 14 && nalType <= 18)) {
+                    boundary = true;
+                } else if ((nalType == 1 || nalType == 5)
+                        && nalOffset + 1 < size
+                        && (data[nalOffset + 1] & 0x80)) {
+                    // first_mb_in_slice == 0
+                    boundary = true;
+                }
+
+                if (boundary) {
+                    boundaryOffset = start;
+                    break;
+                }
+            }
+
+            if (nalType == 1 || nalType == 5) {
+                mSawVCL = true;
+                if (nalType == 5) {
+                    mIsIDR = true;
+                }
+            } else if ((nalType == 7 || nalType == 8) && mFormat == NULL) {
+                ssize_t nalEnd = findStartCode(data, size, nalOffset);
+                if (nalEnd < 0) {
+                    if (!mEOS) {
+                        offset = start;
+                        break;
+                    }
+                    nalEnd = size;
+                }
+
+                size_t nalSize = nalEnd - nalOffset;
+                while (nalSize > 1 && data[nalOffset + nalSize - 1] == 0x00) {
+                    --nalSize;
+                }
+
+                updateFormatH264(&data[nalOffset], nalSize);
+            }
+
+            offset = nalOffset;
+        }
+
+        if (!boundary) {
+            if (mEOS && mSawVCL) {
+                boundary = true;
+                boundaryOffset = size;
+            } else {
+                mScanOffset = offset;
+
+                if (!mSawVCL && size > kMaxPendingSize) {
+                    ALOGW("no slice data in %d bytes of H.264 payload", size);
+                    clear(false /* clearFormat */);
+                }
+
+                return NULL;
+            }
+        }
+
+        // The trailing zero byte of a 4-byte start code belongs to the
+        // next access unit.
+        size_t auSize = boundaryOffset;
+        while (auSize > 0 && data[auSize - 1] == 0x00) {
+            --auSize;
+        }
+
+        bool isIDR = mIsIDR;
+
+        mScanOffset = 0;
+        mSawVCL = false;
+        mIsIDR = false;
+
+        if (mFormat == NULL) {
+            ALOGV("dropping access unit preceding SPS/PPS");
+            consume(boundaryOffset);
+            continue;
+        }
+
+        int64_t timeUs = fetchTimestamp(boundaryOffset);
+
+        return makeAccessUnit(data, auSize, timeUs, 0, isIDR);
+    }
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitAAC() {
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        if (size < 7) {
+            return NULL;
+        }
+
+        // adts_fixed_header: syncword 0xfff, layer 0
+        if (data[0] != 0xff || (data[1] & 0xf6) != 0xf0) {
+            if (!resync(1, 0xfff6, 0xfff0, 2)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        bool protection_absent = (data[1] & 1) != 0;
+        unsigned profile = data[2] >> 6;
+        unsigned sampling_freq_index = (data[2] >> 2) & 0x0f;
+        unsigned channel_configuration =
+            ((data[2] & 1) << 2) | (data[3] >> 6);
+
+        // adts_variable_header
+        size_t aac_frame_length =
+            ((data[3] & 3) << 11) | (data[4] << 3) | (data[5] >> 5);
+        unsigned number_of_raw_data_blocks_in_frame = data[6] & 3;
+
+        size_t headerSize = protection_absent ? 7 : 9;
+
+        if (sampling_freq_index > 11 || aac_frame_length <= headerSize) {
+            if (!resync(1, 0xfff6, 0xfff0, 2)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        if (aac_frame_length > size) {
+            if (mEOS) {
+                consume(size);
+            }
+            return NULL;
+        }
+
+        if (mFormat == NULL) {
+            mFormat = MakeAACCodecSpecificData(
+                    profile, sampling_freq_index, channel_configuration);
+        }
+
+        int32_t sampleRate;
+        CHECK(mFormat->findInt32(kKeySampleRate, &sampleRate));
+
+        int64_t durationUs =
+            1024ll * (number_of_raw_data_blocks_in_frame + 1)
+                * 1000000ll / sampleRate;
+
+        int64_t timeUs = fetchTimestamp(aac_frame_length);
+
+        return makeAccessUnit(
+                data + headerSize, aac_frame_length - headerSize,
+                timeUs, durationUs, true /* isSync */);
+    }
+}
+
+// ABitReader aborts when reading past the end, LATM frames come straight off
+// the wire so reads beyond the end are flagged instead.
+struct LATMBitReader {
+    LATMBitReader(const uint8_t *data, size_t size)
+        : mReader(data, size),
+          mOverrun(false) {
+    }
+
+    unsigned getBits(size_t n) {
+        if (mOverrun || mReader.numBitsLeft() < n) {
+            mOverrun = true;
+            return 0;
+        }
+        return mReader.getBits(n);
+    }
+
+    void skipBits(size_t n) {
+        if (mOverrun || mReader.numBitsLeft() < n) {
+            mOverrun = true;
+            return;
+        }
+        mReader.skipBits(n);
+    }
+
+    size_t numBitsLeft() const {
+        return mOverrun ? 0 : mReader.numBitsLeft();
+    }
+
+    bool overrun() const {
+        return mOverrun;
+    }
+
+private:
+    ABitReader mReader;
+    bool mOverrun;
+
+    DISALLOW_EVIL_CONSTRUCTORS(LATMBitReader);
+};
+
+static unsigned latmGetValue(LATMBitReader *br) {
+    unsigned bytesForValue = br->getBits(2);
+
+    unsigned value = 0;
+    for (unsigned i = 0; i <= bytesForValue; ++i) {
+        value = (value << 8) | br->getBits(8);
+    }
+
+    return value;
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitLATM() {
+    static const int32_t kSamplingFreq[] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+        16000, 12000, 11025, 8000
+    };
+
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        if (size < 3) {
+            return NULL;
+        }
+
+        // AudioSyncStream: syncword 0x2b7, audioMuxLengthBytes
+        if (data[0] != 0x56 || (data[1] & 0xe0) != 0xe0) {
+            if (!resync(1, 0xffe0, 0x56e0, 2)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        size_t frameSize = 3 + (((data[1] & 0x1f) << 8) | data[2]);
+        if (frameSize > size) {
+            if (mEOS) {
+                consume(size);
+            }
+            return NULL;
+        }
+
+        LATMBitReader br(data + 3, frameSize - 3);
+
+        // AudioMuxElement(muxConfigPresent = 1)
+        bool useSameStreamMux = br.getBits(1);
+        if (!useSameStreamMux) {
+            unsigned audioMuxVersion = br.getBits(1);
+            unsigned audioMuxVersionA =
+                audioMuxVersion ? br.getBits(1) : 0;
+
+            bool supported = (audioMuxVersionA == 0);
+
+            if (supported && audioMuxVersion) {
+                latmGetValue(&br);  // taraBufferFullness
+            }
+
+            unsigned allStreamsSameTimeFraming = 1;
+            unsigned numSubFrames = 0, numProgram = 0, numLayer = 0;
+            if (supported) {
+                allStreamsSameTimeFraming = br.getBits(1);
+                numSubFrames = br.getBits(6);
+                numProgram = br.getBits(4);
+                numLayer = br.getBits(3);
+            }
+
+            if (!allStreamsSameTimeFraming || numSubFrames != 0
+                    || numProgram != 0 || numLayer != 0) {
+                ALOGW("unsupported LATM config, allStreamsSameTimeFraming %d, "
+                      "numSubFrames %d, numProgram %d, numLayer %d",
+                      allStreamsSameTimeFraming, numSubFrames,
+                      numProgram, numLayer);
+                supported = false;
+            }
+
+            size_t ascEndBits = 0;
+            if (supported && audioMuxVersion) {
+                unsigned ascLen = latmGetValue(&br);
+                if (ascLen > br.numBitsLeft()) {
+                    supported = false;
+                } else {
+                    ascEndBits = br.numBitsLeft() - ascLen;
+                }
+            }
+
+            // AudioSpecificConfig
+            unsigned audioObjectType = 0;
+            unsigned sampling_freq_index = 0;
+            unsigned channel_configuration = 0;
+            if (supported) {
+                audioObjectType = br.getBits(5);
+                if (audioObjectType == 31) {
+                    audioObjectType = 32 + br.getBits(6);
+                }
+
+                sampling_freq_index = br.getBits(4);
+                if (sampling_freq_index == 0x0f) {
+                    int32_t freq = br.getBits(24);
+                    for (sampling_freq_index = 0;
+                         sampling_freq_index < 11
+                            && kSamplingFreq[sampling_freq_index] > freq;
+                         ++sampling_freq_index) {
+                    }
+                }
+
+                channel_configuration = br.getBits(4);
+
+                if (audioObjectType == 5 || audioObjectType == 29) {
+                    // Explicit SBR/PS signalling, describe the core layer.
+                    if (br.getBits(4) == 0x0f) {
+                        br.skipBits(24);
+                    }
+                    audioObjectType = br.getBits(5);
+                }
+
+                if (channel_configuration == 0
+                        || audioObjectType < 1 || audioObjectType > 4) {
+                    ALOGW("unsupported LATM AudioSpecificConfig "
+                          "(object type %d, channel config %d)",
+                          audioObjectType, channel_configuration);
+                    supported = false;
+                }
+            }
+
+            if (supported) {
+                // GASpecificConfig
+                br.skipBits(1);  // frameLengthFlag
+                if (br.getBits(1)) {  // dependsOnCoreCoder
+                    br.skipBits(14);  // coreCoderDelay
+                }
+                br.skipBits(1);  // extensionFlag
+
+                if (audioMuxVersion) {
+                    if (br.numBitsLeft() < ascEndBits) {
+                        supported = false;
+                    } else {
+                        br.skipBits(br.numBitsLeft() - ascEndBits);
+                    }
+                }
+            }
+
+            if (supported) {
+                mLATMFrameLengthType = br.getBits(3);
+                if (mLATMFrameLengthType != 0) {
+                    ALOGW("unsupported LATM frameLengthType %d",
+                          mLATMFrameLengthType);
+                    supported = false;
+                }
+            }
+
+            if (supported) {
+                br.skipBits(8);  // latmBufferFullness
+
+                mLATMOtherDataLenBits = 0;
+                if (br.getBits(1)) {  // otherDataPresent
+                    if (audioMuxVersion) {
+                        mLATMOtherDataLenBits = latmGetValue(&br);
+                    } else {
+                        unsigned otherDataLenEsc;
+                        do {
+                            otherDataLenEsc = br.getBits(1);
+                            mLATMOtherDataLenBits =
+                                (mLATMOtherDataLenBits << 8) + br.getBits(8);
+                        } while (otherDataLenEsc);
+                    }
+                }
+
+                if (br.getBits(1)) {  // crcCheckPresent
+                    br.skipBits(8);
+                }
+            }
+
+            if (br.overrun()) {
+                supported = false;
+            }
+
+            if (!supported) {
+                mLATMConfigValid = false;
+                consume(frameSize);
+                continue;
+            }
+
+            if (mFormat == NULL) {
+                mFormat = MakeAACCodecSpecificData(
+                        audioObjectType - 1, sampling_freq_index,
+                        channel_configuration);
+            }
+
+            mLATMConfigValid = true;
+        }
+
+        if (!mLATMConfigValid) {
+            ALOGV("no StreamMuxConfig yet, dropping LATM frame");
+            consume(frameSize);
+            continue;
+        }
+
+        // PayloadLengthInfo
+        size_t payloadSize = 0;
+        unsigned tmp;
+        do {
+            if (br.numBitsLeft() < 8) {
+                break;
+            }
+            tmp = br.getBits(8);
+            payloadSize += tmp;
+        } while (tmp == 255);
+
+        if (payloadSize == 0 || payloadSize * 8 > br.numBitsLeft()) {
+            ALOGW("not a complete LATM packet (payload %d bytes, %d bits left)",
+                  payloadSize, br.numBitsLeft());
+            consume(frameSize);
+            continue;
+        }
+
+        int32_t sampleRate;
+        CHECK(mFormat->findInt32(kKeySampleRate, &sampleRate));
+
+        // PayloadMux, not necessarily byte aligned.
+        MediaBuffer *accessUnit = new MediaBuffer(payloadSize);
+        uint8_t *out = (uint8_t *)accessUnit->data();
+        for (size_t i = 0; i < payloadSize; ++i) {
+            out[i] = br.getBits(8);
+        }
+
+        int64_t timeUs = fetchTimestamp(frameSize);
+        if (timeUs < 0) {
+            timeUs = (mLastTimeUs < 0) ? 0 : mLastTimeUs + mLastDurationUs;
+        }
+
+        mLastTimeUs = timeUs;
+        mLastDurationUs = 1024ll * 1000000ll / sampleRate;
+
+        accessUnit->meta_data()->setInt64(kKeyTime, timeUs);
+        accessUnit->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+
+        return accessUnit;
+    }
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitMPEGAudio() {
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        if (size < 4) {
+            return NULL;
+        }
+
+        uint32_t header = U32_AT(data);
+
+        size_t frameSize;
+        int samplingRate, numChannels, numSamples;
+        if ((header & 0xffe00000) != 0xffe00000
+                || !GetMPEGAudioFrameSize(
+                    header, &frameSize, &samplingRate, &numChannels,
+                    NULL /* bitrate */, &numSamples)) {
+            if (!resync(1, 0xffe0, 0xffe0, 2)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        if (frameSize > size) {
+            if (mEOS) {
+                consume(size);
+            }
+            return NULL;
+        }
+
+        if (mFormat == NULL) {
+            mFormat = new MetaData;
+            mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_MPEG);
+            mFormat->setInt32(kKeySampleRate, samplingRate);
+            mFormat->setInt32(kKeyChannelCount, numChannels);
+        }
+
+        int64_t durationUs = numSamples * 1000000ll / samplingRate;
+        int64_t timeUs = fetchTimestamp(frameSize);
+
+        return makeAccessUnit(
+                data, frameSize, timeUs, durationUs, true /* isSync */);
+    }
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitMPEGVideo() {
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        size_t offset = mScanOffset;
+        bool boundary = false;
+        size_t boundaryOffset = 0;
+
+        for (;;) {
+            ssize_t start = findStartCode(data, size, offset);
+            if (start < 0 || start + 4 > size) {
+                offset = (size > offset + 3) ? size - 3 : offset;
+                break;
+            }
+
+            unsigned code = data[start + 3];
+
+            if (mSawPicture
+                    && (code == 0x00 || code == 0xb3 || code == 0xb8)) {
+                boundary = true;
+                boundaryOffset = start;
+                break;
+            }
+
+            if (code == 0xb3 && mFormat == NULL) {
+                // sequence_header
+                if (start + 8 > size) {
+                    offset = start;
+                    break;
+                }
+
+                int32_t width = (data[start + 4] << 4) | (data[start + 5] >> 4);
+                int32_t height =
+                    ((data[start + 5] & 0x0f) << 8) | data[start + 6];
+
+                ALOGI("found MPEG video config (%d x %d)", width, height);
+
+                mFormat = new MetaData;
+                mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_M2V);
+                mFormat->setInt32(kKeyWidth, width);
+                mFormat->setInt32(kKeyHeight, height);
+            } else if (code == 0x00) {
+                // picture_header
+                if (start + 6 > size) {
+                    offset = start;
+                    break;
+                }
+
+                mSawPicture = true;
+
+                unsigned picture_coding_type = (data[start + 5] >> 3) & 7;
+                if (picture_coding_type == 1) {
+                    mIsIDR = true;
+                }
+            }
+
+            offset = start + 4;
+        }
+
+        if (!boundary) {
+            if (mEOS && mSawPicture) {
+                boundary = true;
+                boundaryOffset = size;
+            } else {
+                mScanOffset = offset;
+
+                if (!mSawPicture && size > kMaxPendingSize) {
+                    ALOGW("no picture in %d bytes of MPEG video payload", size);
+                    clear(false /* clearFormat */);
+                }
+
+                return NULL;
+            }
+        }
+
+        bool isSync = mIsIDR;
+
+        mScanOffset = 0;
+        mSawPicture = false;
+        mIsIDR = false;
+
+        if (mFormat == NULL) {
+            ALOGV("dropping picture preceding the sequence header");
+            consume(boundaryOffset);
+            continue;
+        }
+
+        int64_t timeUs = fetchTimestamp(boundaryOffset);
+
+        return makeAccessUnit(data, boundaryOffset, timeUs, 0, isSync);
+    }
+}
+
+// Parses an (E-)AC3 syncframe header, returns the frame size in bytes or 0.
+static size_t parseAC3Header(
+        const uint8_t *data, size_t size,
+        int32_t *sampleRate, int32_t *numChannels, int32_t *numSamples,
+        bool *isDependent) {
+    static const int32_t kSampleRates[3] = { 48000, 44100, 32000 };
+    static const int32_t kReducedSampleRates[3] = { 24000, 22050, 16000 };
+    static const int32_t kBitrates[19] = {
+        32, 40, 48, 56, 64, 80, 96, 112, 128, 160,
+        192, 224, 256, 320, 384, 448, 512, 576, 640
+    };
+    static const int32_t kChannels[8] = { 2, 1, 2, 3, 3, 4, 4, 5 };
+    static const int32_t kBlocks[4] = { 1, 2, 3, 6 };
+
+    if (size < 8 || data[0] != 0x0b || data[1] != 0x77) {
+        return 0;
+    }
+
+    unsigned bsid = data[5] >> 3;
+
+    ABitReader br(data, size);
+    br.skipBits(16);  // syncword
+
+    size_t frameSize;
+    unsigned acmod;
+
+    if (bsid <= 10) {
+        br.skipBits(16);  // crc1
+        unsigned fscod = br.getBits(2);
+        unsigned frmsizecod = br.getBits(6);
+
+        if (fscod == 3 || frmsizecod >= 38) {
+            return 0;
+        }
+
+        int32_t bitrate = kBitrates[frmsizecod >> 1];
+        size_t words;
+        if (fscod == 0) {
+            words = bitrate * 2;
+        } else if (fscod == 1) {
+            words = bitrate * 320 / 147 + (frmsizecod & 1);
+        } else {
+            words = bitrate * 3;
+        }
+
+        frameSize = words * 2;
+
+        br.skipBits(5 + 3);  // bsid, bsmod
+        acmod = br.getBits(3);
+        if ((acmod & 1) && acmod != 1) {
+            br.skipBits(2);  // cmixlev
+        }
+        if (acmod & 4) {
+            br.skipBits(2);  // surmixlev
+        }
+        if (acmod == 2) {
+            br.skipBits(2);  // dsurmod
+        }
+
+        *sampleRate = kSampleRates[fscod];
+        *numSamples = 1536;
+        *isDependent = false;
+    } else if (bsid <= 16) {
+        unsigned strmtyp = br.getBits(2);
+        br.skipBits(3);  // substreamid
+        frameSize = (br.getBits(11) + 1) * 2;
+
+        unsigned fscod = br.getBits(2);
+        int32_t numBlocks;
+        if (fscod == 3) {
+            unsigned fscod2 = br.getBits(2);
+            if (fscod2 == 3) {
+                return 0;
+            }
+            *sampleRate = kReducedSampleRates[fscod2];
+            numBlocks = 6;
+        } else {
+            *sampleRate = kSampleRates[fscod];
+            numBlocks = kBlocks[br.getBits(2)];
+        }
+
+        acmod = br.getBits(3);
+
+        *numSamples = 256 * numBlocks;
+        *isDependent = (strmtyp == 1);
+    } else {
+        return 0;
+    }
+
+    *numChannels = kChannels[acmod] + br.getBits(1) /* lfeon */;
+
+    return frameSize;
+}
+
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitAC3() {
+    for (;;) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mBuffer->size();
+
+        if (size < 8) {
+            return NULL;
+        }
+
+        int32_t sampleRate, numChannels, numSamples;
+        bool isDependent;
+        size_t frameSize = parseAC3Header(
+                data, size, &sampleRate, &numChannels, &numSamples,
+                &isDependent);
+
+        if (frameSize == 0 || isDependent) {
+            if (!resync(1, 0xffff, 0x0b77, 2)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        // Dependent E-AC3 substreams are decoded together with the
+        // independent frame in front of them.
+        size_t auSize = frameSize;
+        for (;;) {
+            if (auSize + 8 > size) {
+                if (!mEOS) {
+                    return NULL;
+                }
+                break;
+            }
+
+            int32_t depSampleRate, depNumChannels, depNumSamples;
+            bool depIsDependent;
+            size_t depFrameSize = parseAC3Header(
+                    data + auSize, size - auSize,
+                    &depSampleRate, &depNumChannels, &depNumSamples,
+                    &depIsDependent);
+
+            if (depFrameSize == 0 || !depIsDependent) {
+                break;
+            }
+
+            auSize += depFrameSize;
+        }
+
+        if (auSize > size) {
+            if (mEOS) {
+                consume(size);
+            }
+            return NULL;
+        }
+
+        if (mFormat == NULL) {
+            mFormat = new MetaData;
+            mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AC3);
+            mFormat->setInt32(kKeySampleRate, sampleRate);
+            mFormat->setInt32(kKeyChannelCount, numChannels);
+        }
+
+        int64_t durationUs = numSamples * 1000000ll / sampleRate;
+        int64_t timeUs = fetchTimestamp(auSize);
+
+        return makeAccessUnit(
+                data, auSize, timeUs, durationUs, true /* isSync */);
+    }
+}
+
+void ElementaryStreamQueue::updateFormatAligned(
+        const uint8_t *data, size_t size) {
+    switch (mMode) {
+        case H264:
+        {
+            ssize_t start = findStartCode(data, size, 0);
+            while (start >= 0 && mFormat == NULL) {
+                size_t nalOffset = start + 3;
+                ssize_t nalEnd = findStartCode(data, size, nalOffset);
+
+                size_t nalSize = (nalEnd < 0 ? size : nalEnd) - nalOffset;
+                while (nalSize > 1 && data[nalOffset + nalSize - 1] == 0x00) {
+                    --nalSize;
+                }
+
+                if (nalSize > 0) {
+                    updateFormatH264(&data[nalOffset], nalSize);
+                }
+
+                start = nalEnd;
+            }
+            break;
+        }
+
+        case VC1:
+        {
+            // Advanced profile sequence header.
+            ssize_t start = findStartCode(data, size, 0);
+            while (start >= 0) {
+                if (start + 4 < size && data[start + 3] == 0x0f) {
+                    ABitReader br(&data[start + 4], size - start - 4);
+                    if (br.numBitsLeft() < 40) {
+                        break;
+                    }
+
+                    br.skipBits(2 + 3 + 2 + 3 + 5 + 1);
+                    int32_t width = (br.getBits(12) + 1) * 2;
+                    int32_t height = (br.getBits(12) + 1) * 2;
+
+                    ALOGI("found VC1 config (%d x %d)", width, height);
+
+                    mFormat = new MetaData;
+                    mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_VC1);
+                    mFormat->setInt32(kKeyWidth, width);
+                    mFormat->setInt32(kKeyHeight, height);
+                    break;
+                }
+
+                start = findStartCode(data, size, start + 3);
+            }
+            break;
+        }
+
+        case DTS:
+        {
+            static const int32_t kSampleRates[16] = {
+                0, 8000, 16000, 32000, 0, 0, 11025, 22050,
+                44100, 0, 0, 12000, 24000, 48000, 0, 0
+            };
+            static const int32_t kChannels[16] = {
+                1, 2, 2, 2, 2, 3, 3, 4, 4, 5, 6, 6, 6, 7, 8, 8
+            };
+
+            if (size < 16 || U32_AT(data) != 0x7ffe8001) {
+                break;
+            }
+
+            ABitReader br(data + 4, size - 4);
+            br.skipBits(1 + 5 + 1 + 7 + 14);  // FTYPE SHORT CPF NBLKS FSIZE
+            unsigned amode = br.getBits(6);
+            unsigned sfreq = br.getBits(4);
+            br.skipBits(5 + 1 + 1 + 1 + 1 + 1 + 3 + 1 + 1);
+            unsigned lff = br.getBits(2);
+
+            if (kSampleRates[sfreq] == 0) {
+                break;
+            }
+
+            mFormat = new MetaData;
+            mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_DTS);
+            mFormat->setInt32(kKeySampleRate, kSampleRates[sfreq]);
+            mFormat->setInt32(
+                    kKeyChannelCount,
+                    (amode < 16 ? kChannels[amode] : 2) + (lff ? 1 : 0));
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+// One access unit per PES payload.
+MediaBuffer *ElementaryStreamQueue::dequeueAccessUnitAligned() {
+    while (!mRangeInfos.empty()) {
+        const uint8_t *data = mBuffer->data();
+        size_t size = mRangeInfos.begin()->mLength;
+
+        if (mFormat == NULL) {
+            updateFormatAligned(data, size);
+        }
+
+        if (mFormat == NULL) {
+            consume(size);
+            continue;
+        }
+
+        bool isSync = true;
+        int64_t durationUs = 0;
+
+        if (mMode == H264) {
+            isSync = false;
+
+            ssize_t start = findStartCode(data, size, 0);
+            while (start >= 0 && (size_t)start + 3 < size) {
+                if ((data[start + 3] & 0x1f) == 5) {
+                    isSync = true;
+                    break;
+                }
+                start = findStartCode(data, size, start + 3);
+            }
+        } else if (mMode == VC1) {
+            isSync = false;
+
+            ssize_t start = findStartCode(data, size, 0);
+            while (start >= 0 && (size_t)start + 3 < size) {
+                // sequence header or entry point
+                if (data[start + 3] == 0x0f || data[start + 3] == 0x0e) {
+                    isSync = true;
+                    break;
+                }
+                start = findStartCode(data, size, start + 3);
+            }
+        } else if (mMode == DTS && size >= 6 && U32_AT(data) == 0x7ffe8001) {
+            int32_t sampleRate;
+            CHECK(mFormat->findInt32(kKeySampleRate, &sampleRate));
+
+            unsigned nblks = ((data[4] & 1) << 6) | (data[5] >> 2);
+            durationUs = (nblks + 1) * 32 * 1000000ll / sampleRate;
+        }
+
+        int64_t timeUs = fetchTimestamp(size);
+
+        return makeAccessUnit(data, size, timeUs, durationUs, isSync);
+    }
+
+    return NULL;
+}
+
+}  // namespace android
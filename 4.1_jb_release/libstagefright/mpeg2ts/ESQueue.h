@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ES_QUEUE_H_
+
+#define ES_QUEUE_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/List.h>
+#include <utils/RefBase.h>
+
+namespace android {
+
+struct ABuffer;
+struct MediaBuffer;
+struct MetaData;
+
+// Collects the payload of consecutive PES packets of one elementary stream
+// and cuts it into access units. Payload is appended to a single growable
+// buffer and consumed from its front, the remainder is only moved back to
+// the start of the buffer when more room is needed for the next append.
+struct ElementaryStreamQueue {
+    enum Mode {
+        H264,
+        AAC_ADTS,
+        AAC_LATM,
+        MPEG_AUDIO,
+        MPEG_VIDEO,
+        AC3,
+        DTS,
+        VC1,
+    };
+
+    enum Flags {
+        // Every PES packet carries exactly one complete access unit,
+        // no need to look for access unit boundaries in the payload.
+        kFlag_AlignedData = 1,
+    };
+
+    ElementaryStreamQueue(Mode mode, uint32_t flags = 0);
+    ~ElementaryStreamQueue();
+
+    Mode mode() const { return mMode; }
+
+    // A negative timeUs marks payload whose PES header had no PTS.
+    status_t appendData(const void *data, size_t size, int64_t timeUs);
+
+    // No more data follows, the last pending access unit is complete.
+    void signalEOS();
+
+    void clear(bool clearFormat);
+
+    // Returns NULL if no complete access unit is available yet.
+    MediaBuffer *dequeueAccessUnit();
+
+    sp<MetaData> getFormat();
+
+private:
+    struct RangeInfo {
+        int64_t mTimestampUs;
+        size_t mLength;
+    };
+
+    Mode mMode;
+    uint32_t mFlags;
+    bool mEOS;
+
+    sp<ABuffer> mBuffer;
+    List<RangeInfo> mRangeInfos;
+
+    sp<MetaData> mFormat;
+
+    int64_t mLastTimeUs;
+    int64_t mLastDurationUs;
+
+    // H.264 scanning state, carried over between calls so that the payload
+    // of the pending access unit is not rescanned each time a PES arrives.
+    size_t mScanOffset;
+    bool mSawVCL;
+    bool mIsIDR;
+    sp<ABuffer> mSeqParamSet;
+    sp<ABuffer> mPicParamSet;
+
+    // MPEG video scanning state.
+    bool mSawPicture;
+
+    // LATM, the StreamMuxConfig is only transmitted occasionally.
+    bool mLATMConfigValid;
+    unsigned mLATMFrameLengthType;
+    unsigned mLATMOtherDataLenBits;
+
+    void consume(size_t size);
+    int64_t fetchTimestamp(size_t size);
+    MediaBuffer *makeAccessUnit(
+            const uint8_t *data, size_t size, int64_t timeUs,
+            int64_t durationUs, bool isSync);
+
+    MediaBuffer *dequeueAccessUnitAligned();
+    MediaBuffer *dequeueAccessUnitH264();
+    MediaBuffer *dequeueAccessUnitAAC();
+    MediaBuffer *dequeueAccessUnitLATM();
+    MediaBuffer *dequeueAccessUnitMPEGAudio();
+    MediaBuffer *dequeueAccessUnitMPEGVideo();
+    MediaBuffer *dequeueAccessUnitAC3();
+
+    void updateFormatH264(const uint8_t *nal, size_t size);
+    void updateFormatAligned(const uint8_t *data, size_t size);
+
+    // Skips to the next candidate sync word, returns false if
+    // more data is needed.
+    bool resync(size_t offset, uint32_t syncMask, uint32_t syncWord,
+                unsigned syncBytes);
+
+    DISALLOW_EVIL_CONSTRUCTORS(ElementaryStreamQueue);
+};
+
+}  // namespace android
+
+#endif  // ES_QUEUE_H_
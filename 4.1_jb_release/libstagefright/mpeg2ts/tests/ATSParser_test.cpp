@@ -0,0 +1,660 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ATSParser_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+#include "../ATSParser.h"
+#include "../AnotherPacketSource.h"
+#include "TSGenerator.h"
+
+namespace android {
+
+static const size_t kTSPacketSize = 188;
+
+static const unsigned kVideoPID = 0x101;
+static const unsigned kAudioPID = 0x102;
+static const unsigned kAudioPID2 = 0x103;
+
+static const int64_t kFrameDurationTicks = 3600;  // 25 fps
+static const int64_t kFrameDurationUs = 40000;
+
+struct AccessUnit {
+    int64_t mTimeUs;
+    size_t mSize;
+    bool mIsSync;
+};
+
+// Reads everything queued on "source", the parser must have signalled
+// EOS so that this doesn't block.
+static void drainSource(
+        const sp<MediaSource> &source, Vector<AccessUnit> *accessUnits) {
+    accessUnits->clear();
+
+    for (;;) {
+        MediaBuffer *buffer;
+        status_t err = source->read(&buffer);
+
+        if (err != OK) {
+            EXPECT_EQ(ERROR_END_OF_STREAM, err);
+            break;
+        }
+
+        AccessUnit au;
+        CHECK(buffer->meta_data()->findInt64(kKeyTime, &au.mTimeUs));
+        au.mSize = buffer->range_length();
+
+        int32_t isSync;
+        au.mIsSync = buffer->meta_data()->findInt32(kKeyIsSyncFrame, &isSync)
+            && isSync;
+
+        accessUnits->push(au);
+
+        buffer->release();
+        buffer = NULL;
+    }
+}
+
+class ATSParserTest : public ::testing::Test {
+protected:
+    enum AudioType {
+        AUDIO_AAC,
+        AUDIO_MPEG,
+        AUDIO_AC3,
+    };
+
+    ATSParserTest()
+        : mNumFrames(0),
+          mFirstPTS(0) {
+    }
+
+    // One video access unit and one audio frame per 40ms, preceded by a PCR
+    // on the video PID. PAT and PMT are repeated every 10 frames.
+    void writeFrames(
+            TSGenerator *gen, size_t firstFrame, size_t numFrames,
+            int64_t firstPTS, AudioType audioType = AUDIO_AAC,
+            bool pcrDiscontinuity = false) {
+        for (size_t i = firstFrame; i < firstFrame + numFrames; ++i) {
+            if (i % 10 == 0) {
+                gen->writePAT();
+                gen->writePMT();
+            }
+
+            int64_t PTS = (firstPTS + (i - firstFrame) * kFrameDurationTicks)
+                & ((1ll << 33) - 1);
+
+            int64_t PCR = (PTS - 1800) & ((1ll << 33) - 1);
+            gen->writePCR(PCR, pcrDiscontinuity && i == firstFrame);
+
+            Vector<uint8_t> au;
+            TSGenerator::MakeH264AccessUnit(
+                    &au, i % 10 == 0, i % 10 == 0, 600 + (i % 7) * 100);
+            gen->writePES(kVideoPID, 0xe0, au.array(), au.size(), PTS,
+                          true /* unbounded */);
+
+            unsigned stream_id = 0xc0;
+            switch (audioType) {
+                case AUDIO_AAC:
+                    TSGenerator::MakeADTSFrame(&au, 300);
+                    break;
+                case AUDIO_MPEG:
+                    TSGenerator::MakeMPEGAudioFrame(&au);
+                    break;
+                case AUDIO_AC3:
+                    TSGenerator::MakeAC3Frame(&au);
+                    stream_id = 0xbd;
+                    break;
+            }
+            gen->writePES(kAudioPID, stream_id, au.array(), au.size(), PTS);
+        }
+    }
+
+    void makeStream(
+            TSGenerator *gen, size_t numFrames, int64_t firstPTS = 900000,
+            AudioType audioType = AUDIO_AAC) {
+        gen->setPCRPID(kVideoPID);
+        gen->addStream(kVideoPID, ATSParser::STREAMTYPE_H264);
+
+        switch (audioType) {
+            case AUDIO_AAC:
+                gen->addStream(
+                        kAudioPID, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS);
+                break;
+            case AUDIO_MPEG:
+                gen->addStream(kAudioPID, ATSParser::STREAMTYPE_MPEG1_AUDIO);
+                break;
+            case AUDIO_AC3:
+            {
+                // PES private data with a registration descriptor.
+                static const uint8_t kDescriptor[6] = {
+                    0x05, 0x04, 'A', 'C', '-', '3'
+                };
+                gen->addStream(kAudioPID, 0x06, kDescriptor,
+                               sizeof(kDescriptor));
+                break;
+            }
+        }
+
+        writeFrames(gen, 0, numFrames, firstPTS, audioType);
+
+        mNumFrames = numFrames;
+        mFirstPTS = firstPTS;
+    }
+
+    static void feed(
+            const sp<ATSParser> &parser, const uint8_t *data, size_t size,
+            size_t packetsPerCall, uint32_t seekFlag = 0) {
+        size_t chunkSize = packetsPerCall * kTSPacketSize;
+
+        while (size > 0) {
+            size_t n = (size < chunkSize) ? size : chunkSize;
+            ASSERT_EQ((status_t)OK, parser->feedTSPacket(data, n, seekFlag));
+            data += n;
+            size -= n;
+        }
+    }
+
+    static void parseAll(
+            const uint8_t *data, size_t size, size_t packetsPerCall,
+            Vector<AccessUnit> *video, Vector<AccessUnit> *audio) {
+        sp<ATSParser> parser = new ATSParser;
+        feed(parser, data, size, packetsPerCall);
+        parser->signalEOS(ERROR_END_OF_STREAM);
+
+        uint32_t programID = 0;
+        unsigned pid = 0;
+
+        sp<MediaSource> source =
+            parser->getSource(ATSParser::VIDEO, programID, pid);
+        ASSERT_TRUE(source != NULL);
+        EXPECT_EQ(kVideoPID, pid);
+        drainSource(source, video);
+
+        source = parser->getSource(ATSParser::AUDIO, programID, pid);
+        ASSERT_TRUE(source != NULL);
+        EXPECT_EQ(kAudioPID, pid);
+        drainSource(source, audio);
+    }
+
+    static void expectSameAccessUnits(
+            const Vector<AccessUnit> &a, const Vector<AccessUnit> &b) {
+        ASSERT_EQ(a.size(), b.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            EXPECT_EQ(a.itemAt(i).mTimeUs, b.itemAt(i).mTimeUs);
+            EXPECT_EQ(a.itemAt(i).mSize, b.itemAt(i).mSize);
+            EXPECT_EQ(a.itemAt(i).mIsSync, b.itemAt(i).mIsSync);
+        }
+    }
+
+    void expectRegularTimestamps(const Vector<AccessUnit> &accessUnits) {
+        ASSERT_EQ(mNumFrames, accessUnits.size());
+        for (size_t i = 0; i < accessUnits.size(); ++i) {
+            EXPECT_EQ((int64_t)i * kFrameDurationUs,
+                      accessUnits.itemAt(i).mTimeUs) << "frame " << i;
+        }
+    }
+
+    size_t mNumFrames;
+    int64_t mFirstPTS;
+};
+
+TEST_F(ATSParserTest, ParsesAVCAndADTS) {
+    TSGenerator gen;
+    makeStream(&gen, 50);
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, gen.data(), gen.size(), gen.size() / kTSPacketSize);
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    EXPECT_TRUE(parser->PTSTimeDeltaEstablished());
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<MediaSource> video =
+        parser->getSource(ATSParser::VIDEO, programID, pid);
+    ASSERT_TRUE(video != NULL);
+    EXPECT_EQ(0u, programID);
+    EXPECT_EQ(kVideoPID, pid);
+
+    sp<MetaData> format = video->getFormat();
+    const char *mime;
+    ASSERT_TRUE(format->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(MEDIA_MIMETYPE_VIDEO_AVC, mime);
+
+    int32_t width, height;
+    ASSERT_TRUE(format->findInt32(kKeyWidth, &width));
+    ASSERT_TRUE(format->findInt32(kKeyHeight, &height));
+    EXPECT_EQ(320, width);
+    EXPECT_EQ(240, height);
+
+    sp<MediaSource> audio =
+        parser->getSource(ATSParser::AUDIO, programID, pid);
+    ASSERT_TRUE(audio != NULL);
+    EXPECT_EQ(kAudioPID, pid);
+
+    format = audio->getFormat();
+    ASSERT_TRUE(format->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(MEDIA_MIMETYPE_AUDIO_AAC, mime);
+
+    Vector<AccessUnit> accessUnits;
+    drainSource(video, &accessUnits);
+    expectRegularTimestamps(accessUnits);
+    for (size_t i = 0; i < accessUnits.size(); ++i) {
+        EXPECT_EQ(i % 10 == 0, accessUnits.itemAt(i).mIsSync);
+    }
+
+    drainSource(audio, &accessUnits);
+    expectRegularTimestamps(accessUnits);
+    for (size_t i = 0; i < accessUnits.size(); ++i) {
+        // The ADTS header is stripped.
+        EXPECT_EQ(300u, accessUnits.itemAt(i).mSize);
+    }
+}
+
+TEST_F(ATSParserTest, BulkFeedingMatchesPacketAtATime) {
+    TSGenerator gen;
+    makeStream(&gen, 40);
+
+    Vector<AccessUnit> video1, audio1;
+    parseAll(gen.data(), gen.size(), 1, &video1, &audio1);
+
+    static const size_t kPacketsPerCall[] = { 3, 7, 64, 1000 };
+    for (size_t i = 0; i < sizeof(kPacketsPerCall) / sizeof(kPacketsPerCall[0]); ++i) {
+        Vector<AccessUnit> video2, audio2;
+        parseAll(gen.data(), gen.size(), kPacketsPerCall[i],
+                 &video2, &audio2);
+
+        expectSameAccessUnits(video1, video2);
+        expectSameAccessUnits(audio1, audio2);
+    }
+
+    expectRegularTimestamps(video1);
+}
+
+TEST_F(ATSParserTest, ParsesMPEGAudio) {
+    TSGenerator gen;
+    makeStream(&gen, 20, 900000, AUDIO_MPEG);
+
+    Vector<AccessUnit> video, audio;
+    parseAll(gen.data(), gen.size(), 16, &video, &audio);
+
+    expectRegularTimestamps(audio);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        EXPECT_EQ(417u, audio.itemAt(i).mSize);
+    }
+}
+
+TEST_F(ATSParserTest, ParsesAC3FromRegistrationDescriptor) {
+    TSGenerator gen;
+    makeStream(&gen, 20, 900000, AUDIO_AC3);
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, gen.data(), gen.size(), 16);
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<MediaSource> audio =
+        parser->getSource(ATSParser::AUDIO, programID, pid);
+    ASSERT_TRUE(audio != NULL);
+
+    const char *mime;
+    ASSERT_TRUE(audio->getFormat()->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(MEDIA_MIMETYPE_AUDIO_AC3, mime);
+
+    int32_t sampleRate, numChannels;
+    ASSERT_TRUE(audio->getFormat()->findInt32(kKeySampleRate, &sampleRate));
+    ASSERT_TRUE(
+            audio->getFormat()->findInt32(kKeyChannelCount, &numChannels));
+    EXPECT_EQ(48000, sampleRate);
+    EXPECT_EQ(2, numChannels);
+
+    Vector<AccessUnit> accessUnits;
+    drainSource(audio, &accessUnits);
+    expectRegularTimestamps(accessUnits);
+}
+
+TEST_F(ATSParserTest, TimestampsContinueAcrossWrapAround) {
+    TSGenerator gen;
+
+    // The 33 bit clock wraps one second in.
+    makeStream(&gen, 50, (1ll << 33) - 90000);
+
+    Vector<AccessUnit> video, audio;
+    parseAll(gen.data(), gen.size(), 32, &video, &audio);
+
+    expectRegularTimestamps(video);
+    expectRegularTimestamps(audio);
+}
+
+TEST_F(ATSParserTest, TimestampsContinueAcrossPCRDiscontinuity) {
+    TSGenerator gen;
+    makeStream(&gen, 25);
+
+    // The time base restarts from a much smaller value, as happens when
+    // broadcast streams are spliced.
+    writeFrames(&gen, 25, 25, 45000, AUDIO_AAC, true /* pcrDiscontinuity */);
+    mNumFrames = 50;
+
+    Vector<AccessUnit> video, audio;
+    parseAll(gen.data(), gen.size(), 32, &video, &audio);
+
+    expectRegularTimestamps(video);
+    expectRegularTimestamps(audio);
+}
+
+TEST_F(ATSParserTest, ContinuityErrorDropsDamagedPES) {
+    TSGenerator gen;
+    makeStream(&gen, 5);
+
+    size_t damagedOffset = gen.size();
+    writeFrames(&gen, 5, 15, mFirstPTS + 5 * kFrameDurationTicks);
+    mNumFrames = 20;
+
+    // Frame 5 consists of the PCR packet followed by the video PES, drop
+    // the second packet of the latter.
+    Vector<uint8_t> damaged;
+    damaged.appendArray(gen.data(), damagedOffset + 2 * kTSPacketSize);
+    damaged.appendArray(
+            gen.data() + damagedOffset + 3 * kTSPacketSize,
+            gen.size() - damagedOffset - 3 * kTSPacketSize);
+
+    Vector<AccessUnit> video, audio;
+    parseAll(damaged.array(), damaged.size(), 8, &video, &audio);
+
+    ASSERT_EQ(mNumFrames - 1, video.size());
+    for (size_t i = 0; i < video.size(); ++i) {
+        size_t frame = (i < 5) ? i : i + 1;
+        EXPECT_EQ((int64_t)frame * kFrameDurationUs, video.itemAt(i).mTimeUs);
+    }
+
+    // The audio PID is unaffected.
+    expectRegularTimestamps(audio);
+}
+
+TEST_F(ATSParserTest, DuplicatePacketsAreIgnored) {
+    TSGenerator gen;
+    makeStream(&gen, 20);
+
+    // Repeat every packet once, duplicates carry the same counter.
+    Vector<uint8_t> duplicated;
+    for (size_t offset = 0; offset < gen.size(); offset += kTSPacketSize) {
+        duplicated.appendArray(gen.data() + offset, kTSPacketSize);
+
+        unsigned adaptation_field_control = (gen.data()[offset + 3] >> 4) & 3;
+        if (adaptation_field_control & 1) {
+            duplicated.appendArray(gen.data() + offset, kTSPacketSize);
+        }
+    }
+
+    Vector<AccessUnit> video1, audio1;
+    parseAll(gen.data(), gen.size(), 8, &video1, &audio1);
+
+    Vector<AccessUnit> video2, audio2;
+    parseAll(duplicated.array(), duplicated.size(), 8, &video2, &audio2);
+
+    expectSameAccessUnits(video1, video2);
+    expectSameAccessUnits(audio1, audio2);
+}
+
+TEST_F(ATSParserTest, ResyncsAfterGarbage) {
+    TSGenerator gen;
+    makeStream(&gen, 30);
+
+    Vector<AccessUnit> video1, audio1;
+    parseAll(gen.data(), gen.size(), 8, &video1, &audio1);
+
+    // Insert junk between packets now and then, only packets that
+    // straddle the junk are lost.
+    Vector<uint8_t> corrupted;
+    size_t numPackets = gen.size() / kTSPacketSize;
+    for (size_t i = 0; i < numPackets; ++i) {
+        if (i > 0 && i % 97 == 0) {
+            for (size_t j = 0; j < 51; ++j) {
+                corrupted.push(j & 0x3f);
+            }
+        }
+
+        corrupted.appendArray(gen.data() + i * kTSPacketSize, kTSPacketSize);
+    }
+
+    // Fed in one go, the parser re-establishes sync without losing any
+    // of the packets after the junk.
+    sp<ATSParser> parser = new ATSParser;
+    ASSERT_EQ((status_t)OK,
+              parser->feedTSPacket(corrupted.array(), corrupted.size(), 0));
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    Vector<AccessUnit> video2, audio2;
+    drainSource(parser->getSource(ATSParser::VIDEO, programID, pid), &video2);
+    drainSource(parser->getSource(ATSParser::AUDIO, programID, pid), &audio2);
+
+    expectSameAccessUnits(video1, video2);
+    expectSameAccessUnits(audio1, audio2);
+}
+
+TEST_F(ATSParserTest, NullPacketsAndTEIAreSkipped) {
+    TSGenerator gen;
+    makeStream(&gen, 10);
+
+    Vector<uint8_t> padded;
+    for (size_t offset = 0; offset < gen.size(); offset += kTSPacketSize) {
+        padded.appendArray(gen.data() + offset, kTSPacketSize);
+
+        TSGenerator nullPacket;
+        nullPacket.writeNullPacket();
+        padded.appendArray(nullPacket.data(), nullPacket.size());
+
+        // A packet flagged as damaged by the demodulator.
+        padded.appendArray(gen.data() + offset, kTSPacketSize);
+        padded.editItemAt(padded.size() - kTSPacketSize + 1) |= 0x80;
+    }
+
+    Vector<AccessUnit> video1, audio1;
+    parseAll(gen.data(), gen.size(), 8, &video1, &audio1);
+
+    Vector<AccessUnit> video2, audio2;
+    parseAll(padded.array(), padded.size(), 8, &video2, &audio2);
+
+    expectSameAccessUnits(video1, video2);
+    expectSameAccessUnits(audio1, audio2);
+}
+
+TEST_F(ATSParserTest, PMTSpanningSeveralPackets) {
+    TSGenerator gen;
+
+    // Enough program_info to push the PMT across three packets.
+    uint8_t descriptors[400];
+    for (size_t i = 0; i < sizeof(descriptors); i += 100) {
+        descriptors[i] = 0x80;      // user private descriptor
+        descriptors[i + 1] = 98;
+        memset(&descriptors[i + 2], 0xaa, 98);
+    }
+    gen.setProgramInfo(descriptors, sizeof(descriptors));
+
+    makeStream(&gen, 20);
+
+    Vector<AccessUnit> video, audio;
+    parseAll(gen.data(), gen.size(), 5, &video, &audio);
+
+    expectRegularTimestamps(video);
+    expectRegularTimestamps(audio);
+}
+
+TEST_F(ATSParserTest, SectionWithBadCRCIsIgnored) {
+    TSGenerator gen;
+    makeStream(&gen, 10);
+
+    // Corrupt the transport_stream_id of the first PAT.
+    Vector<uint8_t> corrupted;
+    corrupted.appendArray(gen.data(), gen.size());
+    corrupted.editItemAt(4 + 1 + 3) ^= 0x55;
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, corrupted.array(), corrupted.size(), 4);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    EXPECT_TRUE(parser->getSource(ATSParser::VIDEO, programID, pid) == NULL);
+
+    // The next, intact PAT is picked up.
+    TSGenerator more;
+    makeStream(&more, 20);
+    feed(parser, more.data(), more.size(), 4);
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    EXPECT_TRUE(parser->getSource(ATSParser::VIDEO, programID, pid) != NULL);
+}
+
+TEST_F(ATSParserTest, GetSourceSkipsKnownPIDs) {
+    TSGenerator gen;
+    gen.addStream(kAudioPID2, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS);
+    makeStream(&gen, 10);
+
+    Vector<uint8_t> frame;
+    TSGenerator::MakeADTSFrame(&frame, 100);
+    for (size_t i = 0; i < 10; ++i) {
+        gen.writePES(kAudioPID2, 0xc1, frame.array(), frame.size(),
+                     mFirstPTS + i * kFrameDurationTicks);
+    }
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, gen.data(), gen.size(), 8);
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<MediaSource> audio1 =
+        parser->getSource(ATSParser::AUDIO, programID, pid);
+    ASSERT_TRUE(audio1 != NULL);
+    EXPECT_EQ(kAudioPID, pid);
+    parser->mPIDbuffer.push(pid);
+
+    sp<MediaSource> audio2 =
+        parser->getSource(ATSParser::AUDIO, programID, pid);
+    ASSERT_TRUE(audio2 != NULL);
+    EXPECT_EQ(kAudioPID2, pid);
+    EXPECT_TRUE(audio1 != audio2);
+    parser->mPIDbuffer.push(pid);
+
+    EXPECT_TRUE(parser->getSource(ATSParser::AUDIO, programID, pid) == NULL);
+}
+
+TEST_F(ATSParserTest, StartDropsUnselectedStreams) {
+    TSGenerator gen;
+    gen.addStream(kAudioPID2, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS);
+    makeStream(&gen, 10);
+
+    Vector<uint8_t> frame;
+    TSGenerator::MakeADTSFrame(&frame, 100);
+    for (size_t i = 0; i < 10; ++i) {
+        gen.writePES(kAudioPID2, 0xc1, frame.array(), frame.size(),
+                     mFirstPTS + i * kFrameDurationTicks);
+    }
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, gen.data(), gen.size(), 8);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<AnotherPacketSource> audio = static_cast<AnotherPacketSource *>(
+            parser->getSource(ATSParser::AUDIO, programID, pid).get());
+    ASSERT_TRUE(audio != NULL);
+    ASSERT_EQ(kAudioPID, pid);
+
+    uint32_t numQueued = audio->numBufferAvailable();
+    EXPECT_GT(numQueued, 0u);
+
+    parser->Start(kAudioPID2, kVideoPID);
+
+    TSGenerator more;
+    more.addStream(kAudioPID2, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS);
+    makeStream(&more, 10);
+    feed(parser, more.data(), more.size(), 8);
+
+    EXPECT_EQ(numQueued, audio->numBufferAvailable());
+}
+
+TEST_F(ATSParserTest, SeekModeOnlyTracksTimestamps) {
+    TSGenerator gen;
+    makeStream(&gen, 50);
+
+    size_t half = (gen.size() / kTSPacketSize / 2) * kTSPacketSize;
+
+    sp<ATSParser> parser = new ATSParser;
+    feed(parser, gen.data(), half, 8);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<AnotherPacketSource> video = static_cast<AnotherPacketSource *>(
+            parser->getSource(ATSParser::VIDEO, programID, pid).get());
+    ASSERT_TRUE(video != NULL);
+
+    parser->signalSeek();
+    EXPECT_EQ(0, parser->getTimeus(programID, kVideoPID));
+
+    feed(parser, gen.data() + half, gen.size() - half, 8, 1 /* seekFlag */);
+
+    EXPECT_EQ(49 * kFrameDurationUs,
+              parser->getTimeus(programID, kVideoPID));
+    EXPECT_EQ(49 * kFrameDurationUs,
+              parser->getTimeus(programID, kAudioPID));
+    EXPECT_EQ(0u, video->numBufferAvailable());
+}
+
+TEST_F(ATSParserTest, LiveProgramWithoutPSI) {
+    TSGenerator gen;
+    Vector<uint8_t> au;
+    for (size_t i = 0; i < 20; ++i) {
+        TSGenerator::MakeADTSFrame(&au, 200);
+        gen.writePES(kAudioPID, 0xc0, au.array(), au.size(),
+                     900000 + i * kFrameDurationTicks);
+    }
+
+    sp<ATSParser> parser = new ATSParser;
+    parser->createLiveProgramID(
+            kAudioPID, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS,
+            kVideoPID, ATSParser::STREAMTYPE_H264);
+    parser->Start(kAudioPID, kVideoPID);
+
+    feed(parser, gen.data(), gen.size(), 8);
+    parser->signalEOS(ERROR_END_OF_STREAM);
+
+    uint32_t programID = 0;
+    unsigned pid = 0;
+    sp<MediaSource> audio =
+        parser->getSource(ATSParser::AUDIO, programID, pid);
+    ASSERT_TRUE(audio != NULL);
+
+    mNumFrames = 20;
+    Vector<AccessUnit> accessUnits;
+    drainSource(audio, &accessUnits);
+    expectRegularTimestamps(accessUnits);
+}
+
+}  // namespace android
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TSGenerator.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+
+#include <string.h>
+
+namespace android {
+
+static const size_t kTSPacketSize = 188;
+
+TSGenerator::TSGenerator(unsigned programNumber, unsigned programMapPID)
+    : mProgramNumber(programNumber),
+      mProgramMapPID(programMapPID),
+      mPCRPID(0x1fff) {
+    memset(mCounters, 0, sizeof(mCounters));
+}
+
+void TSGenerator::addStream(
+        unsigned elementaryPID, unsigned streamType,
+        const uint8_t *descriptors, size_t descriptorsSize) {
+    StreamInfo info;
+    info.mPID = elementaryPID;
+    info.mType = streamType;
+    if (descriptorsSize > 0) {
+        info.mDescriptors.appendArray(descriptors, descriptorsSize);
+    }
+
+    mStreams.push(info);
+}
+
+void TSGenerator::setProgramInfo(const uint8_t *descriptors, size_t size) {
+    mProgramInfo.clear();
+    mProgramInfo.appendArray(descriptors, size);
+}
+
+// static
+uint32_t TSGenerator::CRC32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static void appendCRC(Vector<uint8_t> *section) {
+    // Patch section_length now that the size is known.
+    size_t sectionLength = section->size() + 4 - 3;
+    section->editItemAt(1) = 0xb0 | (sectionLength >> 8);
+    section->editItemAt(2) = sectionLength & 0xff;
+
+    uint32_t crc = TSGenerator::CRC32(section->array(), section->size());
+    section->push(crc >> 24);
+    section->push((crc >> 16) & 0xff);
+    section->push((crc >> 8) & 0xff);
+    section->push(crc & 0xff);
+}
+
+void TSGenerator::writePAT() {
+    Vector<uint8_t> section;
+
+    section.push(0x00);  // table_id
+    section.push(0xb0);  // section_length, patched later
+    section.push(0x00);
+    section.push(0x00);  // transport_stream_id
+    section.push(0x01);
+    section.push(0xc1);  // version 0, current_next_indicator
+    section.push(0x00);  // section_number
+    section.push(0x00);  // last_section_number
+
+    section.push(mProgramNumber >> 8);
+    section.push(mProgramNumber & 0xff);
+    section.push(0xe0 | (mProgramMapPID >> 8));
+    section.push(mProgramMapPID & 0xff);
+
+    appendCRC(&section);
+    writeSection(0, section);
+}
+
+void TSGenerator::writePMT() {
+    Vector<uint8_t> section;
+
+    section.push(0x02);  // table_id
+    section.push(0xb0);  // section_length, patched later
+    section.push(0x00);
+    section.push(mProgramNumber >> 8);
+    section.push(mProgramNumber & 0xff);
+    section.push(0xc1);  // version 0, current_next_indicator
+    section.push(0x00);  // section_number
+    section.push(0x00);  // last_section_number
+    section.push(0xe0 | (mPCRPID >> 8));
+    section.push(mPCRPID & 0xff);
+    section.push(0xf0 | (mProgramInfo.size() >> 8));
+    section.push(mProgramInfo.size() & 0xff);
+    section.appendVector(mProgramInfo);
+
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        const StreamInfo &info = mStreams.itemAt(i);
+
+        section.push(info.mType);
+        section.push(0xe0 | (info.mPID >> 8));
+        section.push(info.mPID & 0xff);
+        section.push(0xf0 | (info.mDescriptors.size() >> 8));
+        section.push(info.mDescriptors.size() & 0xff);
+        section.appendVector(info.mDescriptors);
+    }
+
+    appendCRC(&section);
+    writeSection(mProgramMapPID, section);
+}
+
+void TSGenerator::writeSection(unsigned PID, const Vector<uint8_t> &section) {
+    Vector<uint8_t> payload;
+    payload.push(0x00);  // pointer_field
+    payload.appendVector(section);
+
+    size_t offset = 0;
+    while (offset < payload.size()) {
+        uint8_t packet[kTSPacketSize - 4];
+        memset(packet, 0xff, sizeof(packet));
+
+        size_t n = payload.size() - offset;
+        if (n > sizeof(packet)) {
+            n = sizeof(packet);
+        }
+        memcpy(packet, payload.array() + offset, n);
+
+        // Sections are padded with 0xff rather than adaptation fields.
+        writePacket(PID, offset == 0, packet, sizeof(packet), NULL, 0);
+        offset += n;
+    }
+}
+
+void TSGenerator::writePCR(uint64_t PCR_base, bool discontinuity) {
+    uint8_t adaptationField[7];
+    adaptationField[0] = (discontinuity ? 0x80 : 0x00) | 0x10;  // PCR_flag
+    adaptationField[1] = PCR_base >> 25;
+    adaptationField[2] = PCR_base >> 17;
+    adaptationField[3] = PCR_base >> 9;
+    adaptationField[4] = PCR_base >> 1;
+    adaptationField[5] = ((PCR_base & 1) << 7) | 0x7e;
+    adaptationField[6] = 0x00;  // PCR_extension
+
+    writePacket(mPCRPID, false, NULL, 0,
+                adaptationField, sizeof(adaptationField));
+}
+
+void TSGenerator::writePES(
+        unsigned elementaryPID, unsigned stream_id,
+        const uint8_t *data, size_t size, int64_t PTS, bool unbounded) {
+    Vector<uint8_t> pes;
+
+    size_t headerDataLength = (PTS >= 0) ? 5 : 0;
+    size_t PES_packet_length = 3 + headerDataLength + size;
+    if (unbounded || PES_packet_length > 0xffff) {
+        PES_packet_length = 0;
+    }
+
+    pes.push(0x00);
+    pes.push(0x00);
+    pes.push(0x01);
+    pes.push(stream_id);
+    pes.push(PES_packet_length >> 8);
+    pes.push(PES_packet_length & 0xff);
+    pes.push(0x80);
+    pes.push((PTS >= 0) ? 0x80 : 0x00);
+    pes.push(headerDataLength);
+
+    if (PTS >= 0) {
+        pes.push(0x21 | ((PTS >> 29) & 0x0e));
+        pes.push((PTS >> 22) & 0xff);
+        pes.push(((PTS >> 14) & 0xfe) | 1);
+        pes.push((PTS >> 7) & 0xff);
+        pes.push(((PTS << 1) & 0xfe) | 1);
+    }
+
+    pes.appendArray(data, size);
+
+    size_t offset = 0;
+    while (offset < pes.size()) {
+        size_t n = pes.size() - offset;
+        if (n > kTSPacketSize - 4) {
+            n = kTSPacketSize - 4;
+        }
+
+        writePacket(elementaryPID, offset == 0,
+                    pes.array() + offset, n, NULL, 0);
+
+        offset += n;
+    }
+}
+
+void TSGenerator::writeNullPacket() {
+    uint8_t packet[kTSPacketSize];
+    memset(packet, 0xff, sizeof(packet));
+    packet[0] = 0x47;
+    packet[1] = 0x1f;
+    packet[2] = 0xff;
+    packet[3] = 0x10;
+
+    mData.appendArray(packet, sizeof(packet));
+}
+
+void TSGenerator::writeGarbage(size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        // Avoid accidental sync bytes.
+        mData.push((i * 7 + 1) & 0x3f);
+    }
+}
+
+void TSGenerator::writePacket(
+        unsigned PID, bool payload_unit_start_indicator,
+        const uint8_t *payload, size_t payloadSize,
+        const uint8_t *adaptationField, size_t adaptationFieldSize) {
+    CHECK_LE(payloadSize, kTSPacketSize - 4);
+
+    uint8_t packet[kTSPacketSize];
+    size_t offset = 4;
+
+    bool hasAdaptationField =
+        adaptationFieldSize > 0 || payloadSize < kTSPacketSize - 4;
+
+    if (hasAdaptationField) {
+        // Whatever the payload doesn't fill is stuffing.
+        size_t adaptation_field_length = kTSPacketSize - 4 - 1 - payloadSize;
+        CHECK_GE(adaptation_field_length, adaptationFieldSize);
+
+        packet[offset++] = adaptation_field_length;
+
+        if (adaptation_field_length > 0) {
+            if (adaptationFieldSize > 0) {
+                memcpy(&packet[offset], adaptationField, adaptationFieldSize);
+            } else {
+                packet[offset] = 0x00;
+                adaptationFieldSize = 1;
+            }
+
+            memset(&packet[offset + adaptationFieldSize], 0xff,
+                   adaptation_field_length - adaptationFieldSize);
+
+            offset += adaptation_field_length;
+        }
+    }
+
+    unsigned adaptation_field_control =
+        (hasAdaptationField ? 2 : 0) | (payloadSize > 0 ? 1 : 0);
+
+    packet[0] = 0x47;
+    packet[1] = (payload_unit_start_indicator ? 0x40 : 0x00) | (PID >> 8);
+    packet[2] = PID & 0xff;
+    packet[3] = (adaptation_field_control << 4) | mCounters[PID];
+
+    if (payloadSize > 0) {
+        memcpy(&packet[offset], payload, payloadSize);
+        mCounters[PID] = (mCounters[PID] + 1) & 0x0f;
+    }
+
+    CHECK_EQ(offset + payloadSize, kTSPacketSize);
+
+    mData.appendArray(packet, sizeof(packet));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct BitWriter {
+    BitWriter(Vector<uint8_t> *out)
+        : mOut(out),
+          mReservoir(0),
+          mNumBits(0) {
+    }
+
+    void putBits(uint32_t value, size_t n) {
+        while (n > 0) {
+            --n;
+            mReservoir = (mReservoir << 1) | ((value >> n) & 1);
+            if (++mNumBits == 8) {
+                mOut->push(mReservoir);
+                mReservoir = 0;
+                mNumBits = 0;
+            }
+        }
+    }
+
+    void putUE(uint32_t value) {
+        ++value;
+
+        size_t numBits = 0;
+        while ((value >> numBits) > 1) {
+            ++numBits;
+        }
+
+        putBits(0, numBits);
+        putBits(value, numBits + 1);
+    }
+
+    void putTrailingBits() {
+        putBits(1, 1);
+        while (mNumBits != 0) {
+            putBits(0, 1);
+        }
+    }
+
+private:
+    Vector<uint8_t> *mOut;
+    uint8_t mReservoir;
+    size_t mNumBits;
+};
+
+}  // namespace
+
+static void appendStartCode(Vector<uint8_t> *out) {
+    static const uint8_t kStartCode[4] = { 0x00, 0x00, 0x00, 0x01 };
+    out->appendArray(kStartCode, sizeof(kStartCode));
+}
+
+// static
+void TSGenerator::MakeH264AccessUnit(
+        Vector<uint8_t> *out, bool withParamSets, bool isIDR,
+        size_t sliceSize) {
+    out->clear();
+
+    appendStartCode(out);
+    out->push(0x09);  // access unit delimiter
+    out->push(0xf0);
+
+    if (withParamSets) {
+        // Baseline profile, 320x240.
+        appendStartCode(out);
+        out->push(0x67);
+        out->push(66);    // profile_idc
+        out->push(0xc0);  // constraint_set0/1
+        out->push(30);    // level_idc
+
+        BitWriter bits(out);
+        bits.putUE(0);        // seq_parameter_set_id
+        bits.putUE(0);        // log2_max_frame_num_minus4
+        bits.putUE(0);        // pic_order_cnt_type
+        bits.putUE(0);        // log2_max_pic_order_cnt_lsb_minus4
+        bits.putUE(1);        // num_ref_frames
+        bits.putBits(0, 1);   // gaps_in_frame_num_value_allowed_flag
+        bits.putUE(320 / 16 - 1);
+        bits.putUE(240 / 16 - 1);
+        bits.putBits(1, 1);   // frame_mbs_only_flag
+        bits.putBits(1, 1);   // direct_8x8_inference_flag
+        bits.putBits(0, 1);   // frame_cropping_flag
+        bits.putBits(0, 1);   // vui_parameters_present_flag
+        bits.putTrailingBits();
+
+        appendStartCode(out);
+        out->push(0x68);
+        out->push(0xce);
+        out->push(0x38);
+        out->push(0x80);
+    }
+
+    appendStartCode(out);
+    out->push(isIDR ? 0x65 : 0x41);
+    out->push(0x88);  // first_mb_in_slice 0, ...
+
+    // Slice data that can't be mistaken for a start code.
+    for (size_t i = 2; i < sliceSize; ++i) {
+        out->push(0x80 | (i & 0x7f));
+    }
+}
+
+// static
+void TSGenerator::MakeADTSFrame(Vector<uint8_t> *out, size_t payloadSize) {
+    out->clear();
+
+    size_t frameLength = 7 + payloadSize;
+
+    // AAC LC, 44.1kHz, stereo, no CRC.
+    out->push(0xff);
+    out->push(0xf1);
+    out->push(0x50);
+    out->push(0x80 | (frameLength >> 11));
+    out->push((frameLength >> 3) & 0xff);
+    out->push(((frameLength & 7) << 5) | 0x1f);
+    out->push(0xfc);
+
+    for (size_t i = 0; i < payloadSize; ++i) {
+        out->push(i & 0x7f);
+    }
+}
+
+// static
+void TSGenerator::MakeMPEGAudioFrame(Vector<uint8_t> *out) {
+    out->clear();
+
+    // MPEG-1 layer III, 128kbps, 44.1kHz, no padding: 417 bytes.
+    out->push(0xff);
+    out->push(0xfb);
+    out->push(0x90);
+    out->push(0x64);
+
+    for (size_t i = 4; i < 417; ++i) {
+        out->push(i & 0x7f);
+    }
+}
+
+// static
+void TSGenerator::MakeAC3Frame(Vector<uint8_t> *out) {
+    out->clear();
+
+    // 48kHz, 64kbps: 256 bytes, bsid 8, stereo.
+    out->push(0x0b);
+    out->push(0x77);
+    out->push(0x00);  // crc1
+    out->push(0x00);
+    out->push(0x08);  // fscod, frmsizecod
+    out->push(0x40);  // bsid, bsmod
+    out->push(0x40);  // acmod, dsurmod, lfeon
+
+    for (size_t i = 7; i < 256; ++i) {
+        out->push(i & 0x7f);
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TS_GENERATOR_H_
+
+#define TS_GENERATOR_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Produces synthetic MPEG2 transport streams for the parser tests and
+// benchmark: PAT/PMT sections, PCR packets and packetized PES payload.
+struct TSGenerator {
+    TSGenerator(unsigned programNumber = 1, unsigned programMapPID = 0x100);
+
+    void setPCRPID(unsigned PID) { mPCRPID = PID; }
+
+    void addStream(
+            unsigned elementaryPID, unsigned streamType,
+            const uint8_t *descriptors = NULL, size_t descriptorsSize = 0);
+
+    // Descriptors for the PMT's program_info loop.
+    void setProgramInfo(const uint8_t *descriptors, size_t size);
+
+    void writePAT();
+    void writePMT();
+
+    void writePCR(uint64_t PCR_base, bool discontinuity = false);
+
+    // PTS < 0 omits the timestamp. An "unbounded" PES has a
+    // PES_packet_length of 0, as is common for video.
+    void writePES(
+            unsigned elementaryPID, unsigned stream_id,
+            const uint8_t *data, size_t size,
+            int64_t PTS, bool unbounded = false);
+
+    void writeNullPacket();
+    void writeGarbage(size_t size);
+
+    const uint8_t *data() const { return mData.array(); }
+    size_t size() const { return mData.size(); }
+    void clear() { mData.clear(); }
+
+    // Elementary stream payload helpers.
+    static void MakeH264AccessUnit(
+            Vector<uint8_t> *out, bool withParamSets, bool isIDR,
+            size_t sliceSize);
+
+    static void MakeADTSFrame(Vector<uint8_t> *out, size_t payloadSize);
+    static void MakeMPEGAudioFrame(Vector<uint8_t> *out);
+    static void MakeAC3Frame(Vector<uint8_t> *out);
+
+    static uint32_t CRC32(const uint8_t *data, size_t size);
+
+private:
+    struct StreamInfo {
+        unsigned mPID;
+        unsigned mType;
+        Vector<uint8_t> mDescriptors;
+    };
+
+    unsigned mProgramNumber;
+    unsigned mProgramMapPID;
+    unsigned mPCRPID;
+    Vector<StreamInfo> mStreams;
+    Vector<uint8_t> mProgramInfo;
+
+    // Continuity counters, indexed by PID.
+    uint8_t mCounters[0x2000];
+
+    Vector<uint8_t> mData;
+
+    void writeSection(unsigned PID, const Vector<uint8_t> &section);
+
+    void writePacket(
+            unsigned PID, bool payload_unit_start_indicator,
+            const uint8_t *payload, size_t payloadSize,
+            const uint8_t *adaptationField, size_t adaptationFieldSize);
+
+    DISALLOW_EVIL_CONSTRUCTORS(TSGenerator);
+};
+
+}  // namespace android
+
+#endif  // TS_GENERATOR_H_
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how fast ATSParser demuxes a synthetic H.264/AAC transport
+// stream held in memory, as a function of the number of packets handed to
+// feedTSPacket per call.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ts_parser_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../ATSParser.h"
+#include "../AnotherPacketSource.h"
+#include "TSGenerator.h"
+
+using namespace android;
+
+static const size_t kTSPacketSize = 188;
+
+static const unsigned kVideoPID = 0x101;
+static const unsigned kAudioPID = 0x102;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+// 25fps video at roughly "videoKbps", two AAC frames per video frame.
+static void generateStream(
+        TSGenerator *gen, size_t durationSecs, size_t videoKbps) {
+    gen->setPCRPID(kVideoPID);
+    gen->addStream(kVideoPID, ATSParser::STREAMTYPE_H264);
+    gen->addStream(kAudioPID, ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS);
+
+    size_t averageFrameSize = videoKbps * 1000 / 8 / 25;
+
+    Vector<uint8_t> au;
+    Vector<uint8_t> frame;
+    for (size_t i = 0; i < durationSecs * 25; ++i) {
+        if (i % 25 == 0) {
+            gen->writePAT();
+            gen->writePMT();
+        }
+
+        int64_t PTS = 900000 + i * 3600;
+        gen->writePCR(PTS - 1800);
+
+        bool isIDR = (i % 50 == 0);
+        size_t size = isIDR ? averageFrameSize * 4 : averageFrameSize;
+        size = size * (90 + (i * 37) % 21) / 100;
+
+        TSGenerator::MakeH264AccessUnit(&au, isIDR, isIDR, size);
+        gen->writePES(kVideoPID, 0xe0, au.array(), au.size(), PTS,
+                      true /* unbounded */);
+
+        au.clear();
+        for (size_t j = 0; j < 2; ++j) {
+            TSGenerator::MakeADTSFrame(&frame, 370);
+            au.appendVector(frame);
+        }
+        gen->writePES(kAudioPID, 0xc0, au.array(), au.size(), PTS);
+    }
+}
+
+static size_t drain(const sp<MediaSource> &source) {
+    if (source == NULL) {
+        return 0;
+    }
+
+    sp<AnotherPacketSource> impl =
+        static_cast<AnotherPacketSource *>(source.get());
+
+    size_t n = 0;
+    status_t finalResult;
+    while (impl->hasBufferAvailable(&finalResult)) {
+        MediaBuffer *buffer;
+        CHECK_EQ(impl->read(&buffer), (status_t)OK);
+        buffer->release();
+        ++n;
+    }
+
+    return n;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-d durationSecs] [-b videoKbps] [-n packetsPerCall] "
+            "[-i iterations]\n", me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t durationSecs = 120;
+    size_t videoKbps = 8000;
+    size_t packetsPerCall = 64;
+    size_t numIterations = 5;
+
+    int res;
+    while ((res = getopt(argc, argv, "d:b:n:i:")) >= 0) {
+        switch (res) {
+            case 'd':
+                durationSecs = atoi(optarg);
+                break;
+
+            case 'b':
+                videoKbps = atoi(optarg);
+                break;
+
+            case 'n':
+                packetsPerCall = atoi(optarg);
+                break;
+
+            case 'i':
+                numIterations = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (durationSecs == 0 || videoKbps == 0 || packetsPerCall == 0
+            || numIterations == 0) {
+        usage(argv[0]);
+    }
+
+    TSGenerator gen;
+    generateStream(&gen, durationSecs, videoKbps);
+
+    size_t numPackets = gen.size() / kTSPacketSize;
+    printf("%d packets, %.1f MBytes, %d packets per call\n",
+           (int)numPackets, gen.size() / 1E6, (int)packetsPerCall);
+
+    int64_t bestUs = -1;
+    for (size_t iteration = 0; iteration < numIterations; ++iteration) {
+        sp<ATSParser> parser = new ATSParser;
+
+        sp<MediaSource> video, audio;
+        size_t numAccessUnits = 0;
+
+        int64_t startUs = getNowUs();
+
+        const uint8_t *data = gen.data();
+        size_t size = gen.size();
+        while (size > 0) {
+            size_t n = packetsPerCall * kTSPacketSize;
+            if (n > size) {
+                n = size;
+            }
+
+            CHECK_EQ(parser->feedTSPacket(data, n, 0), (status_t)OK);
+            data += n;
+            size -= n;
+
+            uint32_t programID = 0;
+            unsigned pid = 0;
+            if (video == NULL) {
+                video = parser->getSource(ATSParser::VIDEO, programID, pid);
+            }
+            if (audio == NULL) {
+                audio = parser->getSource(ATSParser::AUDIO, programID, pid);
+            }
+
+            numAccessUnits += drain(video) + drain(audio);
+        }
+
+        parser->signalEOS(ERROR_END_OF_STREAM);
+        numAccessUnits += drain(video) + drain(audio);
+
+        int64_t elapsedUs = getNowUs() - startUs;
+        if (bestUs < 0 || elapsedUs < bestUs) {
+            bestUs = elapsedUs;
+        }
+
+        printf("iteration %d: %d access units in %.3f secs\n",
+               (int)iteration, (int)numAccessUnits, elapsedUs / 1E6);
+    }
+
+    double elapsedSecs = bestUs / 1E6;
+    printf("best: %.0f packets/sec, %.2f MBytes/sec, %.1fx realtime\n",
+           numPackets / elapsedSecs,
+           gen.size() / elapsedSecs / 1E6,
+           durationSecs / elapsedSecs);
+
+    return 0;
+}
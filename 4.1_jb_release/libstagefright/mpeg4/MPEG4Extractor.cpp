@@ -0,0 +1,3973 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MPEG4Extractor"
+#include <utils/Log.h>
+
+#include "include/MPEG4Extractor.h"
+#include "include/SampleTable.h"
+#include "include/ESDS.h"
+
+#include <arpa/inet.h>
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaBufferGroup.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// Uncompressed audio is handed out in buffers of up to this many frames
+// instead of one buffer per (tiny) sample.
+static const uint32_t kMaxPCMFramesPerBuffer = 1024;
+
+// The WAVEFORMATEX of WAVDecoder.h, sent ahead of uncompressed audio.
+static const size_t kWaveFormatExSize = 20;
+
+// Sample table boxes of streamed content are read into memory in one go,
+// unless they are larger than this. Larger tables are decoded straight
+// from the source like any other.
+static const size_t kMaxCachedSampleTableSize = 4 * 1024 * 1024;
+
+class MPEG4Source : public MediaSource {
+public:
+    // Caller retains ownership of both "dataSource" and "sampleTable".
+    MPEG4Source(const sp<MPEG4Extractor> &owner,
+                const sp<MetaData> &format,
+                const sp<DataSource> &dataSource,
+                int32_t timeScale,
+                const sp<SampleTable> &sampleTable,
+                const MPEG4Extractor::PCMInfo &pcm,
+                bool isFragmented,
+                uint32_t trackID,
+                const MPEG4Extractor::TrackExtends *trackExtends,
+                off64_t firstMoofOffset);
+
+    virtual status_t start(MetaData *params = NULL);
+    virtual status_t stop();
+
+    virtual sp<MetaData> getFormat();
+
+    virtual status_t read(
+            MediaBuffer **buffer, const ReadOptions *options = NULL);
+
+protected:
+    virtual ~MPEG4Source();
+
+private:
+    // A sample of a movie fragment.
+    struct FragmentSample {
+        off64_t mOffset;
+        size_t mSize;
+        uint64_t mTime;
+        uint32_t mDuration;
+        int32_t mCompositionOffset;
+        bool mIsSync;
+    };
+
+    // A movie fragment holding samples of this track.
+    struct FragmentInfo {
+        off64_t mMoofOffset;
+        off64_t mMoofSize;
+        uint64_t mBaseTime;
+    };
+
+    struct FragmentPosition {
+        size_t mFragment;
+        size_t mSample;
+        uint64_t mTime;
+        uint64_t mCompositionTime;
+    };
+
+    Mutex mLock;
+
+    sp<MPEG4Extractor> mOwner;
+    sp<MetaData> mFormat;
+    sp<DataSource> mDataSource;
+    int32_t mTimescale;
+    sp<SampleTable> mSampleTable;
+    uint32_t mCurrentSampleIndex;
+
+    MPEG4Extractor::PCMInfo mPCM;
+
+    // Uncompressed audio other than G.711 is decoded by WAVDecoder, which
+    // takes its WAVEFORMATEX from the first buffer after start().
+    bool mIsWAV;
+    bool mSendWaveFormat;
+
+    bool mIsAVC;
+    size_t mNALLengthSize;
+
+    bool mStarted;
+
+    MediaBufferGroup *mGroup;
+
+    MediaBuffer *mBuffer;
+
+    bool mWantsNALFragments;
+
+    uint8_t *mSrcBuffer;
+
+    // Movie fragments are indexed as they are reached, the samples of a
+    // single fragment are kept in memory at any time.
+    bool mIsFragmented;
+    uint32_t mTrackID;
+    MPEG4Extractor::TrackExtends mTrackExtends;
+    Vector<FragmentInfo> mFragments;
+    off64_t mNextMoofOffset;
+    uint64_t mNextFragmentTime;
+    bool mReachedLastFragment;
+    ssize_t mLoadedFragment;
+    Vector<FragmentSample> mFragmentSamples;
+    size_t mReadFragment;
+    size_t mReadSample;
+
+    size_t parseNALSize(const uint8_t *data) const;
+
+    status_t getNextSample(
+            off64_t *offset, size_t *size, uint64_t *cts,
+            bool *isSyncSample, uint32_t *numSamples);
+
+    // Moves past the samples just read, which end at "endOffset".
+    void advance(uint32_t numSamples, off64_t endOffset);
+
+    status_t seekToSample(
+            int64_t seekTimeUs, ReadOptions::SeekMode mode,
+            int64_t *targetSampleTimeUs);
+
+    status_t readBoxHeader(
+            off64_t offset, uint32_t *type, off64_t *size,
+            off64_t *headerSize);
+
+    status_t parseMoof(
+            off64_t moofOffset, off64_t moofSize, uint64_t *baseTime,
+            Vector<FragmentSample> *samples);
+
+    status_t parseTraf(
+            off64_t moofOffset, off64_t offset, off64_t stopOffset,
+            uint64_t *baseTime, Vector<FragmentSample> *samples);
+
+    status_t parseTrun(
+            off64_t offset, off64_t size, off64_t *dataOffset,
+            uint64_t *time, uint32_t defaultDuration, uint32_t defaultSize,
+            uint32_t defaultFlags, Vector<FragmentSample> *samples);
+
+    status_t indexNextFragment();
+    status_t loadFragment(size_t index);
+    status_t getNextFragmentSample();
+    status_t nextFragmentSample(FragmentPosition *pos);
+
+    status_t findFragmentSyncSample(
+            const FragmentPosition &from, bool forward,
+            FragmentPosition *sync);
+
+    status_t seekToFragmentSample(
+            uint64_t seekTime, uint32_t findFlags, bool closest,
+            uint64_t *sampleTime);
+
+    void setFragmentPosition(
+            size_t fragment, size_t sample, FragmentPosition *pos) const;
+
+    status_t convertPCM(size_t srcSize, size_t *dstSize);
+    void writeWaveFormat(int64_t timeUs);
+
+    MPEG4Source(const MPEG4Source &);
+    MPEG4Source &operator=(const MPEG4Source &);
+};
+
+// This custom data source wraps an existing one and satisfies requests
+// falling entirely within a cached range from the cache while forwarding
+// all remaining requests to the wrapped datasource.
+// This is used to cache the full sampletable metadata for a single track,
+// possibly wrapping multiple times to cover all tracks, i.e.
+// Each MPEG4DataSource caches the sampletable metadata for a single track.
+
+struct MPEG4DataSource : public DataSource {
+    MPEG4DataSource(const sp<DataSource> &source);
+
+    virtual status_t initCheck() const;
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size);
+    virtual status_t getSize(off64_t *size);
+    virtual uint32_t flags();
+    virtual void updatecache(off64_t offset);
+
+    status_t setCachedRange(off64_t offset, size_t size);
+
+protected:
+    virtual ~MPEG4DataSource();
+
+private:
+    Mutex mLock;
+
+    sp<DataSource> mSource;
+    off64_t mCachedOffset;
+    size_t mCachedSize;
+    uint8_t *mCache;
+
+    void clearCache();
+
+    MPEG4DataSource(const MPEG4DataSource &);
+    MPEG4DataSource &operator=(const MPEG4DataSource &);
+};
+
+MPEG4DataSource::MPEG4DataSource(const sp<DataSource> &source)
+    : mSource(source),
+      mCachedOffset(0),
+      mCachedSize(0),
+      mCache(NULL) {
+}
+
+MPEG4DataSource::~MPEG4DataSource() {
+    clearCache();
+}
+
+void MPEG4DataSource::clearCache() {
+    if (mCache) {
+        free(mCache);
+        mCache = NULL;
+    }
+
+    mCachedOffset = 0;
+    mCachedSize = 0;
+}
+
+status_t MPEG4DataSource::initCheck() const {
+    return mSource->initCheck();
+}
+
+ssize_t MPEG4DataSource::readAt(off64_t offset, void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (offset >= mCachedOffset
+            && offset + size <= mCachedOffset + mCachedSize) {
+        memcpy(data, &mCache[offset - mCachedOffset], size);
+        return size;
+    }
+
+    return mSource->readAt(offset, data, size);
+}
+
+status_t MPEG4DataSource::getSize(off64_t *size) {
+    return mSource->getSize(size);
+}
+
+uint32_t MPEG4DataSource::flags() {
+    return mSource->flags();
+}
+
+void MPEG4DataSource::updatecache(off64_t offset) {
+    mSource->updatecache(offset);
+}
+
+status_t MPEG4DataSource::setCachedRange(off64_t offset, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    clearCache();
+
+    mCache = (uint8_t *)malloc(size);
+
+    if (mCache == NULL) {
+        return -ENOMEM;
+    }
+
+    mCachedOffset = offset;
+    mCachedSize = size;
+
+    ssize_t err = mSource->readAt(mCachedOffset, mCache, mCachedSize);
+
+    if (err < (ssize_t)size) {
+        clearCache();
+
+        return ERROR_IO;
+    }
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void MakeFourCCString(uint32_t x, char *s) {
+    s[0] = x >> 24;
+    s[1] = (x >> 16) & 0xff;
+    s[2] = (x >> 8) & 0xff;
+    s[3] = x & 0xff;
+    s[4] = '\0';
+}
+
+static const char *FourCC2MIME(uint32_t fourcc) {
+    switch (fourcc) {
+        case FOURCC('m', 'p', '4', 'a'):
+            return MEDIA_MIMETYPE_AUDIO_AAC;
+
+        case FOURCC('s', 'a', 'm', 'r'):
+            return MEDIA_MIMETYPE_AUDIO_AMR_NB;
+
+        case FOURCC('s', 'a', 'w', 'b'):
+            return MEDIA_MIMETYPE_AUDIO_AMR_WB;
+
+        case FOURCC('a', 'c', '-', '3'):
+            return MEDIA_MIMETYPE_AUDIO_AC3;
+
+        case FOURCC('.', 'm', 'p', '3'):
+            return MEDIA_MIMETYPE_AUDIO_MPEG;
+
+        case FOURCC('s', 'q', 'c', 'p'):
+            return MEDIA_MIMETYPE_AUDIO_QCELP;
+
+        case FOURCC('t', 'w', 'o', 's'):
+        case FOURCC('s', 'o', 'w', 't'):
+        case FOURCC('r', 'a', 'w', ' '):
+            return MEDIA_MIMETYPE_AUDIO_WAV;
+
+        case FOURCC('a', 'l', 'a', 'w'):
+            return MEDIA_MIMETYPE_AUDIO_G711_ALAW;
+
+        case FOURCC('u', 'l', 'a', 'w'):
+            return MEDIA_MIMETYPE_AUDIO_G711_MLAW;
+
+        case FOURCC('m', 'p', '4', 'v'):
+            return MEDIA_MIMETYPE_VIDEO_MPEG4;
+
+        case FOURCC('s', '2', '6', '3'):
+        case FOURCC('h', '2', '6', '3'):
+        case FOURCC('H', '2', '6', '3'):
+            return MEDIA_MIMETYPE_VIDEO_H263;
+
+        case FOURCC('a', 'v', 'c', '1'):
+            return MEDIA_MIMETYPE_VIDEO_AVC;
+
+        case FOURCC('j', 'p', 'e', 'g'):
+            return MEDIA_MIMETYPE_VIDEO_MJPEG;
+
+        default:
+            CHECK(!"should not be here.");
+            return NULL;
+    }
+}
+
+MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
+    : mDataSource(source),
+      mInitCheck(NO_INIT),
+      mHasVideo(false),
+      mFirstTrack(NULL),
+      mLastTrack(NULL),
+      mFileMetaData(new MetaData),
+      mMovieTimescale(0),
+      mHasMovieExtends(false),
+      mFragmentedDurationUs(0),
+      mFirstMoofOffset(0),
+      mLowestTableOffset(-1),
+      mFirstSINF(NULL),
+      mIsDrm(false) {
+}
+
+MPEG4Extractor::~MPEG4Extractor() {
+    Track *track = mFirstTrack;
+    while (track) {
+        Track *next = track->next;
+
+        delete track;
+        track = next;
+    }
+    mFirstTrack = mLastTrack = NULL;
+
+    SINF *sinf = mFirstSINF;
+    while (sinf) {
+        SINF *next = sinf->next;
+        delete[] sinf->IPMPData;
+        delete sinf;
+        sinf = next;
+    }
+    mFirstSINF = NULL;
+}
+
+sp<MetaData> MPEG4Extractor::getMetaData() {
+    status_t err;
+    if ((err = readMetaData()) != OK) {
+        return new MetaData;
+    }
+
+    return mFileMetaData;
+}
+
+size_t MPEG4Extractor::countTracks() {
+    status_t err;
+    if ((err = readMetaData()) != OK) {
+        return 0;
+    }
+
+    size_t n = 0;
+    Track *track = mFirstTrack;
+    while (track) {
+        ++n;
+        track = track->next;
+    }
+
+    return n;
+}
+
+sp<MetaData> MPEG4Extractor::getTrackMetaData(
+        size_t index, uint32_t flags) {
+    status_t err;
+    if ((err = readMetaData()) != OK) {
+        return NULL;
+    }
+
+    Track *track = mFirstTrack;
+    while (index > 0) {
+        if (track == NULL) {
+            return NULL;
+        }
+
+        track = track->next;
+        --index;
+    }
+
+    if (track == NULL) {
+        return NULL;
+    }
+
+    if (setMaxInputSize(track) != OK) {
+        ALOGW("unable to determine the largest sample of the track.");
+    }
+
+    if ((flags & kIncludeExtensiveMetaData)
+            && !track->includes_expensive_metadata) {
+        track->includes_expensive_metadata = true;
+
+        const char *mime;
+        CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+        if (!strncasecmp("video/", mime, 6)) {
+            uint32_t sampleIndex;
+            uint64_t sampleTime;
+            if (track->sampleTable->findThumbnailSample(&sampleIndex) == OK
+                    && track->sampleTable->getMetaDataForSample(
+                        sampleIndex, NULL /* offset */, NULL /* size */,
+                        &sampleTime) == OK) {
+                track->meta->setInt64(
+                        kKeyThumbnailTime,
+                        ((int64_t)sampleTime * 1000000) / track->timescale);
+            }
+        }
+    }
+
+    return track->meta;
+}
+
+status_t MPEG4Extractor::readMetaData() {
+    if (mInitCheck != NO_INIT) {
+        return mInitCheck;
+    }
+
+    off64_t offset = 0;
+    status_t err;
+    while ((err = parseChunk(&offset, 0)) == OK) {
+    }
+
+    if (mInitCheck == OK) {
+        if (mHasVideo) {
+            mFileMetaData->setCString(
+                    kKeyMIMEType, MEDIA_MIMETYPE_CONTAINER_MPEG4);
+        } else {
+            mFileMetaData->setCString(kKeyMIMEType, "audio/mp4");
+        }
+
+        if (mHasMovieExtends) {
+            for (Track *track = mFirstTrack; track; track = track->next) {
+                int64_t durationUs;
+                if (isFragmented(track)
+                        && (!track->meta->findInt64(kKeyDuration, &durationUs)
+                            || durationUs == 0)) {
+                    track->meta->setInt64(kKeyDuration, mFragmentedDurationUs);
+                }
+            }
+        }
+
+        mInitCheck = OK;
+    } else {
+        mInitCheck = err;
+    }
+
+    CHECK_NE(err, (status_t)NO_INIT);
+    return mInitCheck;
+}
+
+char* MPEG4Extractor::getDrmTrackInfo(size_t trackID, int *len) {
+    if (mFirstSINF == NULL) {
+        return NULL;
+    }
+
+    SINF *sinf = mFirstSINF;
+    while (sinf && (trackID != sinf->trackID)) {
+        sinf = sinf->next;
+    }
+
+    if (sinf == NULL) {
+        return NULL;
+    }
+
+    *len = sinf->len;
+    return sinf->IPMPData;
+}
+
+// Reads an encoded integer 7 bits at a time until it encounters the high bit clear.
+static int32_t readSize(off64_t offset,
+        const sp<DataSource> DataSource, uint8_t *numOfBytes) {
+    uint32_t size = 0;
+    uint8_t data;
+    bool moreData = true;
+    *numOfBytes = 0;
+
+    while (moreData) {
+        if (DataSource->readAt(offset, &data, 1) < 1) {
+            return -1;
+        }
+        offset ++;
+        moreData = (data >= 128) ? true : false;
+        size = (size << 7) | (data & 0x7f); // Take last 7 bits
+        (*numOfBytes) ++;
+    }
+
+    return size;
+}
+
+status_t MPEG4Extractor::parseDrmSINF(off64_t *offset, off64_t data_offset) {
+    uint8_t updateIdTag;
+    if (mDataSource->readAt(data_offset, &updateIdTag, 1) < 1) {
+        return ERROR_IO;
+    }
+    data_offset ++;
+
+    if (0x01/*OBJECT_DESCRIPTOR_UPDATE_ID_TAG*/ != updateIdTag) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t numOfBytes;
+    int32_t size = readSize(data_offset, mDataSource, &numOfBytes);
+    if (size < 0) {
+        return ERROR_IO;
+    }
+    data_offset += numOfBytes;
+
+    while(size >= 11 ) {
+        uint8_t descriptorTag;
+        if (mDataSource->readAt(data_offset, &descriptorTag, 1) < 1) {
+            return ERROR_IO;
+        }
+        data_offset ++;
+
+        if (0x11/*OBJECT_DESCRIPTOR_ID_TAG*/ != descriptorTag) {
+            return ERROR_MALFORMED;
+        }
+
+        uint8_t buffer[8];
+        //ObjectDescriptorID and ObjectDescriptor url flag
+        if (mDataSource->readAt(data_offset, buffer, 2) < 2) {
+            return ERROR_IO;
+        }
+        data_offset += 2;
+
+        if ((buffer[1] >> 5) & 0x0001) { //url flag is set
+            return ERROR_MALFORMED;
+        }
+
+        if (mDataSource->readAt(data_offset, buffer, 8) < 8) {
+            return ERROR_IO;
+        }
+        data_offset += 8;
+
+        if ((0x0F/*ES_ID_REF_TAG*/ != buffer[1])
+                || ( 0x0A/*IPMP_DESCRIPTOR_POINTER_ID_TAG*/ != buffer[5])) {
+            return ERROR_MALFORMED;
+        }
+
+        SINF *sinf = new SINF;
+        sinf->trackID = U16_AT(&buffer[3]);
+        sinf->IPMPDescriptorID = buffer[7];
+        sinf->len = 0;
+        sinf->IPMPData = NULL;
+        sinf->next = mFirstSINF;
+        mFirstSINF = sinf;
+
+        size -= (8 + 2 + 1);
+    }
+
+    if (size != 0) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mDataSource->readAt(data_offset, &updateIdTag, 1) < 1) {
+        return ERROR_IO;
+    }
+    data_offset ++;
+
+    if(0x05/*IPMP_DESCRIPTOR_UPDATE_ID_TAG*/ != updateIdTag) {
+        return ERROR_MALFORMED;
+    }
+
+    size = readSize(data_offset, mDataSource, &numOfBytes);
+    if (size < 0) {
+        return ERROR_IO;
+    }
+    data_offset += numOfBytes;
+
+    while (size > 0) {
+        uint8_t tag;
+        int32_t dataLen;
+        if (mDataSource->readAt(data_offset, &tag, 1) < 1) {
+            return ERROR_IO;
+        }
+        data_offset ++;
+
+        if (0x0B/*IPMP_DESCRIPTOR_ID_TAG*/ != tag) {
+            return ERROR_MALFORMED;
+        }
+
+        uint8_t id;
+        dataLen = readSize(data_offset, mDataSource, &numOfBytes);
+        if (dataLen < 0) {
+            return ERROR_IO;
+        } else if (dataLen < 4) {
+            return ERROR_MALFORMED;
+        }
+        data_offset += numOfBytes;
+
+        if (mDataSource->readAt(data_offset, &id, 1) < 1) {
+            return ERROR_IO;
+        }
+        data_offset ++;
+
+        SINF *sinf = mFirstSINF;
+        while (sinf && (sinf->IPMPDescriptorID != id)) {
+            sinf = sinf->next;
+        }
+        if (sinf == NULL || sinf->IPMPData != NULL) {
+            return ERROR_MALFORMED;
+        }
+        sinf->len = dataLen - 3;
+        sinf->IPMPData = new char[sinf->len];
+
+        if (mDataSource->readAt(data_offset + 2, sinf->IPMPData, sinf->len)
+                < sinf->len) {
+            return ERROR_IO;
+        }
+        data_offset += sinf->len;
+
+        size -= (dataLen + numOfBytes + 1);
+    }
+
+    if (size != 0) {
+        return ERROR_MALFORMED;
+    }
+
+    return UNKNOWN_ERROR;  // Return a dummy error.
+}
+
+struct PathAdder {
+    PathAdder(Vector<uint32_t> *path, uint32_t chunkType)
+        : mPath(path) {
+        mPath->push(chunkType);
+    }
+
+    ~PathAdder() {
+        mPath->pop();
+    }
+
+private:
+    Vector<uint32_t> *mPath;
+
+    PathAdder(const PathAdder &);
+    PathAdder &operator=(const PathAdder &);
+};
+
+static bool underMetaDataPath(const Vector<uint32_t> &path) {
+    return path.size() >= 5
+        && path[0] == FOURCC('m', 'o', 'o', 'v')
+        && path[1] == FOURCC('u', 'd', 't', 'a')
+        && path[2] == FOURCC('m', 'e', 't', 'a')
+        && path[3] == FOURCC('i', 'l', 's', 't');
+}
+
+// Given a time in seconds since Jan 1 1904, produce a human-readable string.
+static void convertTimeToDate(int64_t time_1904, String8 *s) {
+    time_t time_1970 = time_1904 - (((66 * 365 + 17) * 24) * 3600);
+
+    char tmp[32];
+    strftime(tmp, sizeof(tmp), "%Y%m%dT%H%M%S.000Z", gmtime(&time_1970));
+
+    s->setTo(tmp);
+}
+
+// Returns true if the initial object descriptor in "data" references IPMP
+// descriptors, i.e. the streams of the file are protected.
+static bool hasIPMPDescriptors(const uint8_t *data, size_t size) {
+    // version/flags, followed by the descriptor tag.
+    if (size < 5 || (data[4] != 0x10 && data[4] != 0x02)) {
+        return false;
+    }
+
+    size_t offset = 5;
+    size_t length = 0;
+    for (size_t i = 0; i < 4 && offset < size; ++i) {
+        uint8_t x = data[offset++];
+        length = (length << 7) | (x & 0x7f);
+        if (!(x & 0x80)) {
+            break;
+        }
+    }
+
+    if (offset + 2 > size) {
+        return false;
+    }
+
+    bool urlFlag = (data[offset + 1] >> 5) & 1;
+    if (urlFlag) {
+        return false;
+    }
+
+    // ObjectDescriptorID and flags, then five profile level indications.
+    offset += 2 + 5;
+
+    const size_t end = (offset - 7 + length < size) ? offset - 7 + length : size;
+    while (offset < end) {
+        uint8_t tag = data[offset++];
+
+        size_t descriptorLength = 0;
+        for (size_t i = 0; i < 4 && offset < end; ++i) {
+            uint8_t x = data[offset++];
+            descriptorLength = (descriptorLength << 7) | (x & 0x7f);
+            if (!(x & 0x80)) {
+                break;
+            }
+        }
+
+        if (tag == 0x0A /* IPMP_DescrPointer */
+                || tag == 0x0B /* IPMP_Descriptor */) {
+            return true;
+        }
+
+        offset += descriptorLength;
+    }
+
+    return false;
+}
+
+status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
+    ALOGV("entering parseChunk %lld/%d", *offset, depth);
+    uint32_t hdr[2];
+    if (mDataSource->readAt(*offset, hdr, 8) < 8) {
+        return ERROR_IO;
+    }
+    uint64_t chunk_size = ntohl(hdr[0]);
+    uint32_t chunk_type = ntohl(hdr[1]);
+    off64_t data_offset = *offset + 8;
+
+    if (chunk_size == 1) {
+        if (mDataSource->readAt(*offset + 8, &chunk_size, 8) < 8) {
+            return ERROR_IO;
+        }
+        chunk_size = ntoh64(chunk_size);
+        data_offset += 8;
+
+        if (chunk_size < 16) {
+            // The smallest valid chunk is 16 bytes long in this case.
+            return ERROR_MALFORMED;
+        }
+    } else if (chunk_size < 8) {
+        // The smallest valid chunk is 8 bytes long.
+        return ERROR_MALFORMED;
+    }
+
+    char chunk[5];
+    MakeFourCCString(chunk_type, chunk);
+    ALOGV("chunk: %s @ %lld", chunk, *offset);
+
+    PathAdder autoAdder(&mPath, chunk_type);
+
+    off64_t chunk_data_size = *offset + chunk_size - data_offset;
+
+    if (chunk_type != FOURCC('c', 'p', 'r', 't')
+            && chunk_type != FOURCC('c', 'o', 'v', 'r')
+            && mPath.size() == 5 && underMetaDataPath(mPath)) {
+        off64_t stop_offset = *offset + chunk_size;
+        *offset = data_offset;
+        while (*offset < stop_offset) {
+            status_t err = parseChunk(offset, depth + 1);
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        if (*offset != stop_offset) {
+            return ERROR_MALFORMED;
+        }
+
+        return OK;
+    }
+
+    switch(chunk_type) {
+        case FOURCC('m', 'o', 'o', 'v'):
+        case FOURCC('t', 'r', 'a', 'k'):
+        case FOURCC('m', 'd', 'i', 'a'):
+        case FOURCC('m', 'i', 'n', 'f'):
+        case FOURCC('d', 'i', 'n', 'f'):
+        case FOURCC('s', 't', 'b', 'l'):
+        case FOURCC('m', 'v', 'e', 'x'):
+        case FOURCC('u', 'd', 't', 'a'):
+        case FOURCC('i', 'l', 's', 't'):
+        {
+            if (chunk_type == FOURCC('s', 't', 'b', 'l')) {
+                ALOGV("sampleTable chunk is %lld bytes long.", chunk_size);
+
+                if (mLastTrack == NULL) {
+                    return ERROR_MALFORMED;
+                }
+
+                bool cached = false;
+                if ((mDataSource->flags()
+                        & (DataSource::kWantsPrefetching
+                            | DataSource::kIsCachingDataSource))
+                        && chunk_size <= kMaxCachedSampleTableSize) {
+                    sp<MPEG4DataSource> cachedSource =
+                        new MPEG4DataSource(mDataSource);
+
+                    if (cachedSource->setCachedRange(*offset, chunk_size) == OK) {
+                        mDataSource = cachedSource;
+                        cached = true;
+                    }
+                }
+
+                if (!cached && (mLowestTableOffset < 0
+                            || *offset < mLowestTableOffset)) {
+                    // Still read from the source during playback.
+                    mLowestTableOffset = *offset;
+                }
+
+                mLastTrack->sampleTable = new SampleTable(mDataSource);
+            }
+
+            bool isTrack = false;
+            if (chunk_type == FOURCC('t', 'r', 'a', 'k')) {
+                isTrack = true;
+
+                Track *track = new Track;
+                track->next = NULL;
+                if (mLastTrack) {
+                    mLastTrack->next = track;
+                } else {
+                    mFirstTrack = track;
+                }
+                mLastTrack = track;
+
+                track->meta = new MetaData;
+                track->includes_expensive_metadata = false;
+                track->skipTrack = false;
+                track->timescale = 0;
+                track->trackID = 0;
+                track->pcm.mFormat = 0;
+                track->pcm.mBitsPerSample = 0;
+                track->pcm.mBytesPerFrame = 0;
+                track->meta->setCString(kKeyMIMEType, "application/octet-stream");
+            } else if (chunk_type == FOURCC('m', 'v', 'e', 'x')) {
+                mHasMovieExtends = true;
+            }
+
+            off64_t stop_offset = *offset + chunk_size;
+            *offset = data_offset;
+            while (*offset < stop_offset) {
+                status_t err = parseChunk(offset, depth + 1);
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            if (*offset != stop_offset) {
+                return ERROR_MALFORMED;
+            }
+
+            if (isTrack) {
+                if (mLastTrack->skipTrack) {
+                    Track *cur = mFirstTrack;
+
+                    if (cur == mLastTrack) {
+                        delete cur;
+                        mFirstTrack = mLastTrack = NULL;
+                    } else {
+                        while (cur && cur->next != mLastTrack) {
+                            cur = cur->next;
+                        }
+                        cur->next = NULL;
+                        delete mLastTrack;
+                        mLastTrack = cur;
+                    }
+
+                    return OK;
+                }
+
+                status_t err = verifyTrack(mLastTrack);
+
+                if (err != OK) {
+                    return err;
+                }
+            } else if (chunk_type == FOURCC('m', 'o', 'o', 'v')) {
+                mInitCheck = OK;
+
+                // Movie fragments, if any, follow the movie box.
+                mFirstMoofOffset = stop_offset;
+
+                if (!mIsDrm) {
+                    return UNKNOWN_ERROR;  // Return a dummy error.
+                } else {
+                    return OK;
+                }
+            }
+            break;
+        }
+
+        case FOURCC('t', 'k', 'h', 'd'):
+        {
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err;
+            if ((err = parseTrackHeader(data_offset, chunk_data_size)) != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('m', 'd', 'h', 'd'):
+        {
+            if (chunk_data_size < 4 || mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            uint8_t version;
+            if (mDataSource->readAt(
+                        data_offset, &version, sizeof(version))
+                    < (ssize_t)sizeof(version)) {
+                return ERROR_IO;
+            }
+
+            off64_t timescale_offset;
+
+            if (version == 1) {
+                timescale_offset = data_offset + 4 + 16;
+            } else if (version == 0) {
+                timescale_offset = data_offset + 4 + 8;
+            } else {
+                return ERROR_IO;
+            }
+
+            uint32_t timescale;
+            if (mDataSource->readAt(
+                        timescale_offset, &timescale, sizeof(timescale))
+                    < (ssize_t)sizeof(timescale)) {
+                return ERROR_IO;
+            }
+
+            mLastTrack->timescale = ntohl(timescale);
+
+            if (mLastTrack->timescale == 0) {
+                return ERROR_MALFORMED;
+            }
+
+            int64_t duration;
+            if (version == 1) {
+                if (mDataSource->readAt(
+                            timescale_offset + 4, &duration, sizeof(duration))
+                        < (ssize_t)sizeof(duration)) {
+                    return ERROR_IO;
+                }
+                duration = ntoh64(duration);
+            } else {
+                uint32_t duration32;
+                if (mDataSource->readAt(
+                            timescale_offset + 4, &duration32, sizeof(duration32))
+                        < (ssize_t)sizeof(duration32)) {
+                    return ERROR_IO;
+                }
+                duration = ntohl(duration32);
+            }
+            mLastTrack->meta->setInt64(
+                    kKeyDuration, (duration * 1000000) / mLastTrack->timescale);
+
+            uint8_t lang[2];
+            off64_t lang_offset;
+            if (version == 1) {
+                lang_offset = timescale_offset + 4 + 8;
+            } else {
+                lang_offset = timescale_offset + 4 + 4;
+            }
+
+            if (mDataSource->readAt(lang_offset, &lang, sizeof(lang))
+                    < (ssize_t)sizeof(lang)) {
+                return ERROR_IO;
+            }
+
+            // To get the ISO-639-2/T three character language code
+            // 1 bit pad followed by 3 5-bits characters. Each character
+            // is packed as the difference between its ASCII value and 0x60.
+            char lang_code[4];
+            lang_code[0] = ((lang[0] >> 2) & 0x1f) + 0x60;
+            lang_code[1] = ((lang[0] & 0x3) << 3 | (lang[1] >> 5)) + 0x60;
+            lang_code[2] = (lang[1] & 0x1f) + 0x60;
+            lang_code[3] = '\0';
+
+            mLastTrack->meta->setCString(
+                    kKeyMediaLanguage, lang_code);
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('s', 't', 's', 'd'):
+        {
+            if (chunk_data_size < 8 || mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            uint8_t buffer[8];
+            if (mDataSource->readAt(
+                        data_offset, buffer, 8) < 8) {
+                return ERROR_IO;
+            }
+
+            if (U32_AT(buffer) != 0) {
+                // Should be version 0, flags 0.
+                return ERROR_MALFORMED;
+            }
+
+            uint32_t entry_count = U32_AT(&buffer[4]);
+
+            if (entry_count > 1) {
+                // For 3GPP timed text, there could be multiple tx3g boxes contain
+                // multiple text display formats. These formats will be used to
+                // display the timed text.
+                const char *mime;
+                CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
+                if (strcasecmp(mime, MEDIA_MIMETYPE_TEXT_3GPP)) {
+                    // For now we only support a single type of media per track.
+                    mLastTrack->skipTrack = true;
+                    *offset += chunk_size;
+                    break;
+                }
+            }
+
+            off64_t stop_offset = *offset + chunk_size;
+            *offset = data_offset + 8;
+            for (uint32_t i = 0; i < entry_count; ++i) {
+                status_t err = parseChunk(offset, depth + 1);
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            if (*offset != stop_offset) {
+                return ERROR_MALFORMED;
+            }
+            break;
+        }
+
+        case FOURCC('m', 'p', '4', 'a'):
+        case FOURCC('s', 'a', 'm', 'r'):
+        case FOURCC('s', 'a', 'w', 'b'):
+        case FOURCC('a', 'c', '-', '3'):
+        case FOURCC('.', 'm', 'p', '3'):
+        case FOURCC('s', 'q', 'c', 'p'):
+        case FOURCC('t', 'w', 'o', 's'):
+        case FOURCC('s', 'o', 'w', 't'):
+        case FOURCC('r', 'a', 'w', ' '):
+        case FOURCC('a', 'l', 'a', 'w'):
+        case FOURCC('u', 'l', 'a', 'w'):
+        {
+            if (mPath.size() >= 2
+                    && mPath[mPath.size() - 2] == FOURCC('w', 'a', 'v', 'e')) {
+                // QuickTime repeats the format inside the 'wave' extension
+                // as a bare box, the sample entry itself was seen already.
+                *offset += chunk_size;
+                break;
+            }
+
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            return parseAudioSampleEntry(
+                    chunk_type, offset, data_offset, chunk_size, depth);
+        }
+
+        case FOURCC('w', 'a', 'v', 'e'):
+        {
+            off64_t stop_offset = *offset + chunk_size;
+            *offset = data_offset;
+            while (*offset < stop_offset) {
+                uint32_t terminator;
+                if (stop_offset - *offset < 8) {
+                    // Some writers end the list with a 4 byte zero "box".
+                    *offset = stop_offset;
+                    break;
+                }
+
+                if (mDataSource->readAt(*offset, &terminator, 4) < 4) {
+                    return ERROR_IO;
+                }
+
+                if (terminator == 0) {
+                    *offset = stop_offset;
+                    break;
+                }
+
+                status_t err = parseChunk(offset, depth + 1);
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            if (*offset != stop_offset) {
+                return ERROR_MALFORMED;
+            }
+            break;
+        }
+
+        case FOURCC('m', 'p', '4', 'v'):
+        case FOURCC('s', '2', '6', '3'):
+        case FOURCC('H', '2', '6', '3'):
+        case FOURCC('h', '2', '6', '3'):
+        case FOURCC('a', 'v', 'c', '1'):
+        case FOURCC('j', 'p', 'e', 'g'):
+        {
+            mHasVideo = true;
+
+            uint8_t buffer[78];
+            if (chunk_data_size < (ssize_t)sizeof(buffer)
+                    || mLastTrack == NULL) {
+                // Basic VideoSampleEntry size.
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset, buffer, sizeof(buffer)) < (ssize_t)sizeof(buffer)) {
+                return ERROR_IO;
+            }
+
+            uint16_t data_ref_index = U16_AT(&buffer[6]);
+            uint16_t width = U16_AT(&buffer[6 + 18]);
+            uint16_t height = U16_AT(&buffer[6 + 20]);
+
+            // The video sample is not stand-compliant if it has invalid dimension.
+            // Use some default width and height value, and
+            // let the decoder figure out the actual width and height (and thus
+            // be prepared for INFO_FOMRAT_CHANGED event).
+            if (width == 0)  width  = 352;
+            if (height == 0) height = 288;
+
+            // printf("*** coding='%s' width=%d height=%d\n",
+            //        chunk, width, height);
+
+            mLastTrack->meta->setCString(kKeyMIMEType, FourCC2MIME(chunk_type));
+            mLastTrack->meta->setInt32(kKeyWidth, width);
+            mLastTrack->meta->setInt32(kKeyHeight, height);
+
+            off64_t stop_offset = *offset + chunk_size;
+            *offset = data_offset + sizeof(buffer);
+            while (*offset < stop_offset) {
+                status_t err = parseChunk(offset, depth + 1);
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            if (*offset != stop_offset) {
+                return ERROR_MALFORMED;
+            }
+            break;
+        }
+
+        case FOURCC('s', 't', 'c', 'o'):
+        case FOURCC('c', 'o', '6', '4'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setChunkOffsetParams(
+                        chunk_type, data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('s', 't', 's', 'c'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setSampleToChunkParams(
+                        data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('s', 't', 's', 'z'):
+        case FOURCC('s', 't', 'z', '2'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setSampleSizeParams(
+                        chunk_type, data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            if (mLastTrack->pcm.mFormat != 0) {
+                mLastTrack->sampleTable->setPCMFrameSize(
+                        mLastTrack->pcm.mBytesPerFrame);
+            }
+
+            // The largest sample is only looked for once a client asks
+            // for the track, see setMaxInputSize().
+
+            *offset += chunk_size;
+
+            // Calculate average frame rate.
+            const char *mime;
+            CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
+            if (!strncasecmp("video/", mime, 6)) {
+                size_t nSamples = mLastTrack->sampleTable->countSamples();
+                int64_t durationUs;
+                if (mLastTrack->meta->findInt64(kKeyDuration, &durationUs)) {
+                    if (durationUs > 0) {
+                        int32_t frameRate = (nSamples * 1000000LL +
+                                    (durationUs >> 1)) / durationUs;
+                        mLastTrack->meta->setInt32(kKeyFrameRate, frameRate);
+                    }
+                }
+            }
+
+            break;
+        }
+
+        case FOURCC('s', 't', 't', 's'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setTimeToSampleParams(
+                        data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('c', 't', 't', 's'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setCompositionTimeToSampleParams(
+                        data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('s', 't', 's', 's'):
+        {
+            if (mLastTrack == NULL || mLastTrack->sampleTable == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            status_t err =
+                mLastTrack->sampleTable->setSyncSampleParams(
+                        data_offset, chunk_data_size);
+
+            if (err != OK) {
+                return err;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        // @xyz
+        case FOURCC('\xA9', 'x', 'y', 'z'):
+        {
+            // Best case the total data length inside "@xyz" box
+            // would be 8, for instance "@xyz" + "\x00\x04\x15\xc7" + "0+0/",
+            // where "\x00\x04" is the text string length with value = 4,
+            // "\0x15\xc7" is the language code = en, and "0+0" is a
+            // location (string) value with longitude = 0 and latitude = 0.
+            if (chunk_data_size < 8) {
+                return ERROR_MALFORMED;
+            }
+
+            // Worst case the location string length would be 18,
+            // for instance +90.0000-180.0000, without the trailing "/" and
+            // the string length + language code.
+            char buffer[18];
+
+            // Substracting 5 from the data size is because the text string length +
+            // language code takes 4 bytes, and the trailing slash "/" takes 1 byte.
+            off64_t location_length = chunk_data_size - 5;
+            if (location_length >= (off64_t) sizeof(buffer)) {
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset + 4, buffer, location_length) < location_length) {
+                return ERROR_IO;
+            }
+
+            buffer[location_length] = '\0';
+            mFileMetaData->setCString(kKeyLocation, buffer);
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('e', 's', 'd', 's'):
+        {
+            if (chunk_data_size < 4 || mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            uint8_t buffer[256];
+            if (chunk_data_size > (off64_t)sizeof(buffer)) {
+                return ERROR_BUFFER_TOO_SMALL;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset, buffer, chunk_data_size) < chunk_data_size) {
+                return ERROR_IO;
+            }
+
+            if (U32_AT(buffer) != 0) {
+                // Should be version 0, flags 0.
+                return ERROR_MALFORMED;
+            }
+
+            mLastTrack->meta->setData(
+                    kKeyESDS, kTypeESDS, &buffer[4], chunk_data_size - 4);
+
+            // Skip over a 'wave' wrapping the ESDS of QuickTime files.
+            size_t parent = mPath.size() - 2;
+            if (mPath.size() >= 3
+                    && mPath[parent] == FOURCC('w', 'a', 'v', 'e')) {
+                --parent;
+            }
+
+            if (mPath.size() >= 2
+                    && mPath[parent] == FOURCC('m', 'p', '4', 'a')) {
+                // Information from the ESDS must be relied on for proper
+                // setup of sample rate and channel count for MPEG4 Audio.
+                // The generic header appears to only contain generic
+                // information...
+
+                status_t err = updateAudioTrackInfoFromESDS_MPEG4Audio(
+                        &buffer[4], chunk_data_size - 4);
+
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('a', 'v', 'c', 'C'):
+        {
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            char buffer[256];
+            if (chunk_data_size > (off64_t)sizeof(buffer)) {
+                return ERROR_BUFFER_TOO_SMALL;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset, buffer, chunk_data_size) < chunk_data_size) {
+                return ERROR_IO;
+            }
+
+            mLastTrack->meta->setData(
+                    kKeyAVCC, kTypeAVCC, buffer, chunk_data_size);
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('d', '2', '6', '3'):
+        {
+            /*
+             * d263 contains a fixed 7 bytes part:
+             *   vendor - 4 bytes
+             *   version - 1 byte
+             *   level - 1 byte
+             *   profile - 1 byte
+             * optionally, "d263" box itself may contain a 16-byte
+             * bit rate box (bitr)
+             *   average bit rate - 4 bytes
+             *   max bit rate - 4 bytes
+             */
+            char buffer[23];
+            if (chunk_data_size != 7 &&
+                chunk_data_size != 23) {
+                ALOGE("Incorrect D263 box size %lld", chunk_data_size);
+                return ERROR_MALFORMED;
+            }
+
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(
+                    data_offset, buffer, chunk_data_size) < chunk_data_size) {
+                return ERROR_IO;
+            }
+
+            mLastTrack->meta->setData(kKeyD263, kTypeD263, buffer, chunk_data_size);
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('m', 'e', 't', 'a'):
+        {
+            uint8_t buffer[4];
+            if (chunk_data_size < (off64_t)sizeof(buffer)) {
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset, buffer, 4) < 4) {
+                return ERROR_IO;
+            }
+
+            if (U32_AT(buffer) != 0) {
+                // Should be version 0, flags 0.
+
+                // If it's not, let's assume this is one of those
+                // apparently malformed chunks that don't have flags
+                // and completely different semantics than what's
+                // in the MPEG4 specs and skip it.
+                *offset += chunk_size;
+                return OK;
+            }
+
+            off64_t stop_offset = *offset + chunk_size;
+            *offset = data_offset + sizeof(buffer);
+            while (*offset < stop_offset) {
+                status_t err = parseChunk(offset, depth + 1);
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            if (*offset != stop_offset) {
+                return ERROR_MALFORMED;
+            }
+            break;
+        }
+
+        case FOURCC('m', 'e', 'a', 'n'):
+        case FOURCC('n', 'a', 'm', 'e'):
+        case FOURCC('d', 'a', 't', 'a'):
+        {
+            if (mPath.size() == 6 && underMetaDataPath(mPath)) {
+                status_t err = parseMetaData(data_offset, chunk_data_size);
+
+                if (err != OK) {
+                    return err;
+                }
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('m', 'v', 'h', 'd'):
+        {
+            if (chunk_data_size < 20) {
+                return ERROR_MALFORMED;
+            }
+
+            uint8_t header[32];
+            size_t headerSize =
+                chunk_data_size < (off64_t)sizeof(header)
+                    ? chunk_data_size : sizeof(header);
+            if (mDataSource->readAt(
+                        data_offset, header, headerSize)
+                    < (ssize_t)headerSize) {
+                return ERROR_IO;
+            }
+
+            int64_t creationTime;
+            if (header[0] == 1) {
+                if (headerSize < 32) {
+                    return ERROR_MALFORMED;
+                }
+                creationTime = U64_AT(&header[4]);
+                mMovieTimescale = U32_AT(&header[20]);
+            } else if (header[0] != 0) {
+                return ERROR_MALFORMED;
+            } else {
+                creationTime = U32_AT(&header[4]);
+                mMovieTimescale = U32_AT(&header[12]);
+            }
+
+            String8 s;
+            convertTimeToDate(creationTime, &s);
+
+            mFileMetaData->setCString(kKeyDate, s.string());
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('m', 'e', 'h', 'd'):
+        {
+            if (chunk_data_size < 8) {
+                return ERROR_MALFORMED;
+            }
+
+            uint8_t buffer[12];
+            size_t size =
+                chunk_data_size < (off64_t)sizeof(buffer)
+                    ? chunk_data_size : sizeof(buffer);
+            if (mDataSource->readAt(data_offset, buffer, size) < (ssize_t)size) {
+                return ERROR_IO;
+            }
+
+            uint64_t duration;
+            if (buffer[0] == 1) {
+                if (size < 12) {
+                    return ERROR_MALFORMED;
+                }
+                duration = U64_AT(&buffer[4]);
+            } else {
+                duration = U32_AT(&buffer[4]);
+            }
+
+            if (mMovieTimescale > 0) {
+                mFragmentedDurationUs =
+                    (int64_t)(duration * 1000000ll / mMovieTimescale);
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('t', 'r', 'e', 'x'):
+        {
+            uint8_t buffer[24];
+            if (chunk_data_size < (off64_t)sizeof(buffer)) {
+                return ERROR_MALFORMED;
+            }
+
+            if (mDataSource->readAt(
+                        data_offset, buffer, sizeof(buffer)) < (ssize_t)sizeof(buffer)) {
+                return ERROR_IO;
+            }
+
+            TrackExtends trex;
+            trex.mTrackID = U32_AT(&buffer[4]);
+            trex.mSampleDescriptionIndex = U32_AT(&buffer[8]);
+            trex.mSampleDuration = U32_AT(&buffer[12]);
+            trex.mSampleSize = U32_AT(&buffer[16]);
+            trex.mSampleFlags = U32_AT(&buffer[20]);
+            mTrackExtends.push(trex);
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('i', 'o', 'd', 's'):
+        {
+            uint8_t buffer[256];
+            size_t size =
+                chunk_data_size < (off64_t)sizeof(buffer)
+                    ? chunk_data_size : sizeof(buffer);
+            if (mDataSource->readAt(data_offset, buffer, size) < (ssize_t)size) {
+                return ERROR_IO;
+            }
+
+            // The protection info of the tracks is found in the object
+            // descriptor update at the start of the 'mdat' box.
+            if (hasIPMPDescriptors(buffer, size)) {
+                mIsDrm = true;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('m', 'd', 'a', 't'):
+        {
+            if (!mIsDrm) {
+                *offset += chunk_size;
+                break;
+            }
+
+            if (chunk_size < 8) {
+                return ERROR_MALFORMED;
+            }
+
+            return parseDrmSINF(offset, data_offset);
+        }
+
+        case FOURCC('h', 'd', 'l', 'r'):
+        {
+            if (mLastTrack == NULL
+                    || mPath.size() < 2
+                    || mPath[mPath.size() - 2] != FOURCC('m', 'd', 'i', 'a')) {
+                *offset += chunk_size;
+                break;
+            }
+
+            uint32_t buffer;
+            if (mDataSource->readAt(
+                        data_offset + 8, &buffer, 4) < 4) {
+                return ERROR_IO;
+            }
+
+            uint32_t type = ntohl(buffer);
+            // For the 3GPP file format, the handler-type within the 'hdlr' box
+            // shall be 'text'. We also want to support 'sbtl' handler type
+            // for a practical reason as various MPEG4 containers use it.
+            if (type == FOURCC('t', 'e', 'x', 't') || type == FOURCC('s', 'b', 't', 'l')) {
+                mLastTrack->meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_TEXT_3GPP);
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('t', 'x', '3', 'g'):
+        {
+            if (mLastTrack == NULL) {
+                return ERROR_MALFORMED;
+            }
+
+            uint32_t type;
+            const void *data;
+            size_t size = 0;
+            if (!mLastTrack->meta->findData(
+                    kKeyTextFormatData, &type, &data, &size)) {
+                size = 0;
+            }
+
+            uint8_t *buffer = new uint8_t[size + chunk_size];
+
+            if (size > 0) {
+                memcpy(buffer, data, size);
+            }
+
+            if ((size_t)(mDataSource->readAt(*offset, buffer + size, chunk_size))
+                    < chunk_size) {
+                delete[] buffer;
+                buffer = NULL;
+
+                return ERROR_IO;
+            }
+
+            mLastTrack->meta->setData(
+                    kKeyTextFormatData, 0, buffer, size + chunk_size);
+
+            delete[] buffer;
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('c', 'o', 'v', 'r'):
+        {
+            const int kSkipBytesOfDataBox = 16;
+            if (mFileMetaData != NULL && chunk_data_size > kSkipBytesOfDataBox) {
+                ALOGV("chunk_data_size = %lld and data_offset = %lld",
+                        chunk_data_size, data_offset);
+                uint8_t *buffer = new uint8_t[chunk_data_size + 1];
+                if (mDataSource->readAt(
+                    data_offset, buffer, chunk_data_size) != (ssize_t)chunk_data_size) {
+                    delete[] buffer;
+                    buffer = NULL;
+
+                    return ERROR_IO;
+                }
+                mFileMetaData->setData(
+                    kKeyAlbumArt, MetaData::TYPE_NONE,
+                    buffer + kSkipBytesOfDataBox, chunk_data_size - kSkipBytesOfDataBox);
+
+                delete[] buffer;
+            }
+
+            *offset += chunk_size;
+            break;
+        }
+
+        case FOURCC('-', '-', '-', '-'):
+        {
+            mLastCommentMean.clear();
+            mLastCommentName.clear();
+            mLastCommentData.clear();
+            *offset += chunk_size;
+            break;
+        }
+
+        default:
+        {
+            *offset += chunk_size;
+            break;
+        }
+    }
+
+    return OK;
+}
+
+status_t MPEG4Extractor::parseAudioSampleEntry(
+        uint32_t chunk_type, off64_t *offset, off64_t data_offset,
+        off64_t chunk_size, int depth) {
+    off64_t chunk_data_size = *offset + chunk_size - data_offset;
+
+    // The QuickTime sound description extends the basic AudioSampleEntry
+    // by 16 (version 1) or 36 (version 2) bytes.
+    uint8_t buffer[8 + 20 + 36];
+    if (chunk_data_size < 8 + 20) {
+        // Basic AudioSampleEntry size.
+        return ERROR_MALFORMED;
+    }
+
+    if (mDataSource->readAt(data_offset, buffer, 8 + 20) < 8 + 20) {
+        return ERROR_IO;
+    }
+
+    uint16_t version = U16_AT(&buffer[8]);
+    size_t entrySize = 8 + 20;
+    if (version == 1) {
+        entrySize += 16;
+    } else if (version == 2) {
+        entrySize += 36;
+    } else if (version != 0) {
+        ALOGW("unknown sound description version %d", version);
+        mLastTrack->skipTrack = true;
+        *offset += chunk_size;
+        return OK;
+    }
+
+    if (chunk_data_size < (off64_t)entrySize) {
+        return ERROR_MALFORMED;
+    }
+
+    if (entrySize > 8 + 20
+            && mDataSource->readAt(
+                data_offset + 8 + 20, &buffer[8 + 20], entrySize - 8 - 20)
+                    < (ssize_t)(entrySize - 8 - 20)) {
+        return ERROR_IO;
+    }
+
+    uint32_t num_channels = U16_AT(&buffer[16]);
+    uint32_t sample_size = U16_AT(&buffer[18]);
+    uint32_t sample_rate = U32_AT(&buffer[24]) >> 16;
+    uint32_t bytes_per_frame = 0;
+
+    if (version == 1) {
+        bytes_per_frame = U32_AT(&buffer[36]);
+    } else if (version == 2) {
+        uint64_t rate = U64_AT(&buffer[32]);
+        double sampleRate;
+        memcpy(&sampleRate, &rate, sizeof(sampleRate));
+        sample_rate = (uint32_t)sampleRate;
+        num_channels = U32_AT(&buffer[40]);
+        sample_size = U32_AT(&buffer[48]);
+        bytes_per_frame = U32_AT(&buffer[56]);
+    }
+
+    const char *mime = FourCC2MIME(chunk_type);
+
+    if (!strcasecmp(MEDIA_MIMETYPE_AUDIO_AMR_NB, mime)) {
+        // AMR NB audio is always mono, 8kHz
+        num_channels = 1;
+        sample_rate = 8000;
+    } else if (!strcasecmp(MEDIA_MIMETYPE_AUDIO_AMR_WB, mime)) {
+        // AMR WB audio is always mono, 16kHz
+        num_channels = 1;
+        sample_rate = 16000;
+    }
+
+    PCMInfo *pcm = &mLastTrack->pcm;
+    pcm->mFormat = 0;
+
+    if (!strcasecmp(MEDIA_MIMETYPE_AUDIO_WAV, mime)
+            || !strcasecmp(MEDIA_MIMETYPE_AUDIO_G711_ALAW, mime)
+            || !strcasecmp(MEDIA_MIMETYPE_AUDIO_G711_MLAW, mime)) {
+        if (chunk_type == FOURCC('a', 'l', 'a', 'w')
+                || chunk_type == FOURCC('u', 'l', 'a', 'w')
+                || chunk_type == FOURCC('r', 'a', 'w', ' ')) {
+            // The sample size field of these is not reliable.
+            sample_size = 8;
+        }
+
+        if ((sample_size != 8 && sample_size != 16)
+                || num_channels == 0 || num_channels > 8) {
+            ALOGW("unsupported uncompressed audio, %u channels of %u bits",
+                  num_channels, sample_size);
+            mLastTrack->skipTrack = true;
+            *offset += chunk_size;
+            return OK;
+        }
+
+        pcm->mFormat = chunk_type;
+        pcm->mBitsPerSample = sample_size;
+        pcm->mBytesPerFrame = num_channels * sample_size / 8;
+
+        if (bytes_per_frame != 0 && bytes_per_frame != pcm->mBytesPerFrame) {
+            ALOGW("unsupported uncompressed audio, frames of %u bytes",
+                  bytes_per_frame);
+            mLastTrack->skipTrack = true;
+            *offset += chunk_size;
+            return OK;
+        }
+
+        if (!strcasecmp(MEDIA_MIMETYPE_AUDIO_WAV, mime)) {
+            // 8 bit audio is expanded, everything is handed out as
+            // 16 bit little endian.
+            mLastTrack->meta->setInt32(kKeyBitDepth, 16);
+        }
+    }
+
+    mLastTrack->meta->setCString(kKeyMIMEType, mime);
+    mLastTrack->meta->setInt32(kKeyChannelCount, num_channels);
+    mLastTrack->meta->setInt32(kKeySampleRate, sample_rate);
+
+    off64_t stop_offset = *offset + chunk_size;
+    *offset = data_offset + entrySize;
+    while (*offset < stop_offset) {
+        if (stop_offset - *offset < 8) {
+            // Trailing padding after the last extension.
+            *offset = stop_offset;
+            break;
+        }
+
+        status_t err = parseChunk(offset, depth + 1);
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    if (*offset != stop_offset) {
+        return ERROR_MALFORMED;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Extractor::parseTrackHeader(
+        off64_t data_offset, off64_t data_size) {
+    if (data_size < 4) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t version;
+    if (mDataSource->readAt(data_offset, &version, 1) < 1) {
+        return ERROR_IO;
+    }
+
+    size_t dynSize = (version == 1) ? 36 : 24;
+
+    uint8_t buffer[36 + 60];
+
+    if (data_size != (off64_t)dynSize + 60) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mDataSource->readAt(
+                data_offset, buffer, data_size) < (ssize_t)data_size) {
+        return ERROR_IO;
+    }
+
+    uint64_t ctime, mtime, duration;
+    int32_t id;
+
+    if (version == 1) {
+        ctime = U64_AT(&buffer[4]);
+        mtime = U64_AT(&buffer[12]);
+        id = U32_AT(&buffer[20]);
+        duration = U64_AT(&buffer[28]);
+    } else if (version == 0) {
+        ctime = U32_AT(&buffer[4]);
+        mtime = U32_AT(&buffer[8]);
+        id = U32_AT(&buffer[12]);
+        duration = U32_AT(&buffer[20]);
+    } else {
+        return ERROR_MALFORMED;
+    }
+
+    mLastTrack->trackID = id;
+    mLastTrack->meta->setInt32(kKeyTrackID, id);
+
+    size_t matrixOffset = dynSize + 16;
+    int32_t a00 = U32_AT(&buffer[matrixOffset]);
+    int32_t a01 = U32_AT(&buffer[matrixOffset + 4]);
+    int32_t dx = U32_AT(&buffer[matrixOffset + 8]);
+    int32_t a10 = U32_AT(&buffer[matrixOffset + 12]);
+    int32_t a11 = U32_AT(&buffer[matrixOffset + 16]);
+    int32_t dy = U32_AT(&buffer[matrixOffset + 20]);
+
+#if 0
+    ALOGI("x' = %.2f * x + %.2f * y + %.2f",
+         a00 / 65536.0f, a01 / 65536.0f, dx / 65536.0f);
+    ALOGI("y' = %.2f * x + %.2f * y + %.2f",
+         a10 / 65536.0f, a11 / 65536.0f, dy / 65536.0f);
+#endif
+
+    uint32_t rotationDegrees;
+
+    static const int32_t kFixedOne = 0x10000;
+    if (a00 == kFixedOne && a01 == 0 && a10 == 0 && a11 == kFixedOne) {
+        // Identity, no rotation
+        rotationDegrees = 0;
+    } else if (a00 == 0 && a01 == kFixedOne && a10 == -kFixedOne && a11 == 0) {
+        rotationDegrees = 90;
+    } else if (a00 == 0 && a01 == -kFixedOne && a10 == kFixedOne && a11 == 0) {
+        rotationDegrees = 270;
+    } else if (a00 == -kFixedOne && a01 == 0 && a10 == 0 && a11 == -kFixedOne) {
+        rotationDegrees = 180;
+    } else {
+        ALOGW("We only support 0,90,180,270 degree rotation matrices");
+        rotationDegrees = 0;
+    }
+
+    if (rotationDegrees != 0) {
+        mLastTrack->meta->setInt32(kKeyRotation, rotationDegrees);
+    }
+
+    // Handle presentation display size, which could be different
+    // from the image size indicated by kKeyWidth and kKeyHeight.
+    uint32_t width = U32_AT(&buffer[dynSize + 52]);
+    uint32_t height = U32_AT(&buffer[dynSize + 56]);
+    mLastTrack->meta->setInt32(kKeyDisplayWidth, width >> 16);
+    mLastTrack->meta->setInt32(kKeyDisplayHeight, height >> 16);
+
+    return OK;
+}
+
+status_t MPEG4Extractor::parseMetaData(off64_t offset, size_t size) {
+    if (size < 4) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t *buffer = new uint8_t[size + 1];
+    if (mDataSource->readAt(
+                offset, buffer, size) != (ssize_t)size) {
+        delete[] buffer;
+        buffer = NULL;
+
+        return ERROR_IO;
+    }
+
+    uint32_t flags = U32_AT(buffer);
+
+    uint32_t metadataKey = 0;
+    char chunk[5];
+    MakeFourCCString(mPath[4], chunk);
+    ALOGV("meta: %s @ %lld", chunk, offset);
+    switch (mPath[4]) {
+        case FOURCC(0xa9, 'a', 'l', 'b'):
+        {
+            metadataKey = kKeyAlbum;
+            break;
+        }
+        case FOURCC(0xa9, 'A', 'R', 'T'):
+        {
+            metadataKey = kKeyArtist;
+            break;
+        }
+        case FOURCC('a', 'A', 'R', 'T'):
+        {
+            metadataKey = kKeyAlbumArtist;
+            break;
+        }
+        case FOURCC(0xa9, 'd', 'a', 'y'):
+        {
+            metadataKey = kKeyYear;
+            break;
+        }
+        case FOURCC(0xa9, 'n', 'a', 'm'):
+        {
+            metadataKey = kKeyTitle;
+            break;
+        }
+        case FOURCC(0xa9, 'w', 'r', 't'):
+        {
+            metadataKey = kKeyWriter;
+            break;
+        }
+        case FOURCC('c', 'o', 'v', 'r'):
+        {
+            metadataKey = kKeyAlbumArt;
+            break;
+        }
+        case FOURCC('g', 'n', 'r', 'e'):
+        {
+            metadataKey = kKeyGenre;
+            break;
+        }
+        case FOURCC(0xa9, 'g', 'e', 'n'):
+        {
+            metadataKey = kKeyGenre;
+            break;
+        }
+        case FOURCC('c', 'p', 'i', 'l'):
+        {
+            if (size == 9 && flags == 21) {
+                char tmp[16];
+                sprintf(tmp, "%d",
+                        (int)buffer[size - 1]);
+
+                mFileMetaData->setCString(kKeyCompilation, tmp);
+            }
+            break;
+        }
+        case FOURCC('t', 'r', 'k', 'n'):
+        {
+            if (size == 16 && flags == 0) {
+                char tmp[16];
+                sprintf(tmp, "%d/%d",
+                        (int)buffer[size - 5], (int)buffer[size - 3]);
+
+                mFileMetaData->setCString(kKeyCDTrackNumber, tmp);
+            }
+            break;
+        }
+        case FOURCC('d', 'i', 's', 'k'):
+        {
+            if (size == 14 && flags == 0) {
+                char tmp[16];
+                sprintf(tmp, "%d/%d",
+                        (int)buffer[size - 3], (int)buffer[size - 1]);
+
+                mFileMetaData->setCString(kKeyDiscNumber, tmp);
+            }
+            break;
+        }
+        case FOURCC('-', '-', '-', '-'):
+        {
+            buffer[size] = '\0';
+            switch (mPath[5]) {
+                case FOURCC('m', 'e', 'a', 'n'):
+                    mLastCommentMean.setTo((const char *)buffer + 4);
+                    break;
+                case FOURCC('n', 'a', 'm', 'e'):
+                    mLastCommentName.setTo((const char *)buffer + 4);
+                    break;
+                case FOURCC('d', 'a', 't', 'a'):
+                    if (size >= 8) {
+                        mLastCommentData.setTo((const char *)buffer + 8);
+                    }
+                    break;
+            }
+
+            // Once we have a set of mean/name/data info, go ahead and process
+            // it to see if its something we are interested in.  Whether or not
+            // were are interested in the specific tag, make sure to clear out
+            // the set so we can be ready to process another tuple should one
+            // show up later in the file.
+            if ((mLastCommentMean.length() != 0) &&
+                (mLastCommentName.length() != 0) &&
+                (mLastCommentData.length() != 0)) {
+
+                if (mLastCommentMean == "com.apple.iTunes"
+                        && mLastCommentName == "iTunSMPB"
+                        && mLastTrack != NULL) {
+                    int32_t delay, padding;
+                    if (sscanf(mLastCommentData,
+                               " %*x %x %x %*x", &delay, &padding) == 2) {
+                        mLastTrack->meta->setInt32(kKeyEncoderDelay, delay);
+                        mLastTrack->meta->setInt32(kKeyEncoderPadding, padding);
+                    }
+                }
+
+                mLastCommentMean.clear();
+                mLastCommentName.clear();
+                mLastCommentData.clear();
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (size >= 8 && metadataKey) {
+        if (metadataKey == kKeyAlbumArt) {
+            mFileMetaData->setData(
+                    kKeyAlbumArt, MetaData::TYPE_NONE,
+                    buffer + 8, size - 8);
+        } else if (metadataKey == kKeyGenre) {
+            if (flags == 0) {
+                // uint8_t genre code, iTunes genre codes are
+                // the standard id3 codes, except they start
+                // at 1 instead of 0 (e.g. Pop is 14, not 13)
+                // We use standard id3 numbering, so subtract 1.
+                int genrecode = (int)buffer[size - 1];
+                genrecode--;
+                if (genrecode < 0) {
+                    genrecode = 255; // reserved for 'unknown genre'
+                }
+                char genre[10];
+                sprintf(genre, "%d", genrecode);
+
+                mFileMetaData->setCString(metadataKey, genre);
+            } else if (flags == 1) {
+                // custom genre string
+                buffer[size] = '\0';
+
+                mFileMetaData->setCString(
+                        metadataKey, (const char *)buffer + 8);
+            }
+        } else {
+            buffer[size] = '\0';
+
+            mFileMetaData->setCString(
+                    metadataKey, (const char *)buffer + 8);
+        }
+    }
+
+    delete[] buffer;
+    buffer = NULL;
+
+    return OK;
+}
+
+sp<MediaSource> MPEG4Extractor::getTrack(size_t index) {
+    status_t err;
+    if ((err = readMetaData()) != OK) {
+        return NULL;
+    }
+
+    Track *track = mFirstTrack;
+    while (index > 0) {
+        if (track == NULL) {
+            return NULL;
+        }
+
+        track = track->next;
+        --index;
+    }
+
+    if (track == NULL) {
+        return NULL;
+    }
+
+    if ((err = setMaxInputSize(track)) != OK) {
+        ALOGE("unable to determine the largest sample of the track.");
+        return NULL;
+    }
+
+    return new MPEG4Source(
+            this, track->meta, mDataSource, track->timescale, track->sampleTable,
+            track->pcm, isFragmented(track), track->trackID,
+            findTrackExtends(track->trackID), mFirstMoofOffset);
+}
+
+// static
+status_t MPEG4Extractor::verifyTrack(Track *track) {
+    const char *mime;
+    CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+
+    uint32_t type;
+    const void *data;
+    size_t size;
+    if (!strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC)) {
+        if (!track->meta->findData(kKeyAVCC, &type, &data, &size)
+                || type != kTypeAVCC
+                || size < 7
+                || ((const uint8_t *)data)[0] != 1) {
+            return ERROR_MALFORMED;
+        }
+    } else if (!strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_MPEG4)
+            || !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_AAC)) {
+        if (!track->meta->findData(kKeyESDS, &type, &data, &size)
+                || type != kTypeESDS) {
+            return ERROR_MALFORMED;
+        }
+    }
+
+    if (track->sampleTable == NULL || !track->sampleTable->isValid()) {
+        // Make sure we have all the metadata we need.
+        return ERROR_MALFORMED;
+    }
+
+    return OK;
+}
+
+bool MPEG4Extractor::isFragmented(const Track *track) const {
+    return mHasMovieExtends && track->sampleTable->countSamples() == 0;
+}
+
+const MPEG4Extractor::TrackExtends *MPEG4Extractor::findTrackExtends(
+        uint32_t trackID) const {
+    for (size_t i = 0; i < mTrackExtends.size(); ++i) {
+        if (mTrackExtends[i].mTrackID == trackID) {
+            return &mTrackExtends[i];
+        }
+    }
+
+    return NULL;
+}
+
+void MPEG4Extractor::setReadOffset(const MPEG4Source *source, off64_t offset) {
+    Mutex::Autolock autoLock(mReadOffsetLock);
+
+    if (offset < 0) {
+        mReadOffsets.removeItem(source);
+        return;
+    }
+
+    mReadOffsets.add(source, offset);
+
+    off64_t lowest = offset;
+    for (size_t i = 0; i < mReadOffsets.size(); ++i) {
+        if (mReadOffsets.valueAt(i) < lowest) {
+            lowest = mReadOffsets.valueAt(i);
+        }
+    }
+
+    if (mLowestTableOffset >= 0 && mLowestTableOffset < lowest) {
+        lowest = mLowestTableOffset;
+    }
+
+    mDataSource->updatecache(lowest);
+}
+
+status_t MPEG4Extractor::setMaxInputSize(Track *track) {
+    int32_t maxInputSize;
+    if (track->meta->findInt32(kKeyMaxInputSize, &maxInputSize)) {
+        return OK;
+    }
+
+    const char *mime;
+    CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+
+    size_t max_size;
+    if (track->pcm.mFormat != 0) {
+        max_size = kMaxPCMFramesPerBuffer * track->pcm.mBytesPerFrame;
+        if (track->pcm.mBitsPerSample == 8
+                && !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_WAV)) {
+            // Expanded to 16 bits.
+            max_size *= 2;
+        }
+    } else if (isFragmented(track)) {
+        // Samples are described fragment by fragment, there is no way to
+        // tell the largest one short of reading all of them.
+        const TrackExtends *trex = findTrackExtends(track->trackID);
+
+        int32_t width, height;
+        if (!strncasecmp("video/", mime, 6)
+                && track->meta->findInt32(kKeyWidth, &width)
+                && track->meta->findInt32(kKeyHeight, &height)) {
+            max_size = width * height * 3 / 2;
+        } else {
+            max_size = 8192;
+        }
+
+        if (max_size < 64 * 1024) {
+            max_size = 64 * 1024;
+        }
+
+        if (trex != NULL && trex->mSampleSize > max_size) {
+            max_size = trex->mSampleSize;
+        }
+    } else {
+        status_t err = track->sampleTable->getMaxSampleSize(&max_size);
+
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    // Assume that a given buffer only contains at most 10 fragments,
+    // each fragment originally prefixed with a 2 byte length will
+    // have a 4 byte header (0x00 0x00 0x00 0x01) after conversion,
+    // and thus will grow by 2 bytes per fragment.
+    track->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
+
+    return OK;
+}
+
+status_t MPEG4Extractor::updateAudioTrackInfoFromESDS_MPEG4Audio(
+        const void *esds_data, size_t esds_size) {
+    ESDS esds(esds_data, esds_size);
+
+    uint8_t objectTypeIndication;
+    if (esds.getObjectTypeIndication(&objectTypeIndication) != OK) {
+        return ERROR_MALFORMED;
+    }
+
+    if (objectTypeIndication == 0xe1) {
+        // This isn't MPEG4 audio at all, it's QCELP 14k...
+        mLastTrack->meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_QCELP);
+        return OK;
+    }
+
+    if (objectTypeIndication == 0x6b || objectTypeIndication == 0x69) {
+        // MPEG-1 or MPEG-2 audio, the samples are plain MP3 frames.
+        mLastTrack->meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_MPEG);
+        return OK;
+    }
+
+    const uint8_t *csd;
+    size_t csd_size;
+    if (esds.getCodecSpecificInfo(
+                (const void **)&csd, &csd_size) != OK) {
+        return ERROR_MALFORMED;
+    }
+
+#if 0
+    printf("ESD of size %d\n", csd_size);
+    hexdump(csd, csd_size);
+#endif
+
+    if (csd_size == 0) {
+        // There's no further information, i.e. no codec specific data
+        // Let's assume that the information provided in the mpeg4 headers
+        // is accurate and hope for the best.
+
+        return OK;
+    }
+
+    if (csd_size < 2) {
+        return ERROR_MALFORMED;
+    }
+
+    ABitReader br(csd, csd_size);
+    uint32_t objectType = br.getBits(5);
+
+    if (objectType == 31) {  // AAC-ELD => additional 6 bits
+        objectType = 32 + br.getBits(6);
+    }
+
+    const int32_t kSamplingRate[] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+        16000, 12000, 11025, 8000, 7350
+    };
+
+    uint32_t freqIndex = br.getBits(4);
+
+    int32_t sampleRate = 0;
+    int32_t numChannels = 0;
+    if (freqIndex == 15) {
+        if (csd_size < 5) {
+            return ERROR_MALFORMED;
+        }
+
+        sampleRate = br.getBits(24);
+        numChannels = br.getBits(4);
+    } else {
+        numChannels = br.getBits(4);
+        if (objectType == 5) {
+            // SBR specific config per 14496-3 table 1.13
+            freqIndex = br.getBits(4);
+            if (freqIndex == 15) {
+                if (csd_size < 8) {
+                    return ERROR_MALFORMED;
+                }
+                sampleRate = br.getBits(24);
+            }
+        }
+
+        if (sampleRate == 0) {
+            static uint32_t kSamplingRateSize =
+                sizeof(kSamplingRate) / sizeof(kSamplingRate[0]);
+            if (freqIndex >= kSamplingRateSize) {
+                return ERROR_MALFORMED;
+            }
+
+            sampleRate = kSamplingRate[freqIndex];
+        }
+    }
+
+    if (numChannels == 0) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    int32_t prevSampleRate;
+    CHECK(mLastTrack->meta->findInt32(kKeySampleRate, &prevSampleRate));
+
+    if (prevSampleRate != sampleRate) {
+        ALOGV("mpeg4 audio sample rate different from previous setting. "
+             "was: %d, now: %d", prevSampleRate, sampleRate);
+    }
+
+    mLastTrack->meta->setInt32(kKeySampleRate, sampleRate);
+
+    int32_t prevChannelCount;
+    CHECK(mLastTrack->meta->findInt32(kKeyChannelCount, &prevChannelCount));
+
+    if (prevChannelCount != numChannels) {
+        ALOGV("mpeg4 audio channel count different from previous setting. "
+             "was: %d, now: %d", prevChannelCount, numChannels);
+    }
+
+    mLastTrack->meta->setInt32(kKeyChannelCount, numChannels);
+
+    return OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MPEG4Source::MPEG4Source(
+        const sp<MPEG4Extractor> &owner,
+        const sp<MetaData> &format,
+        const sp<DataSource> &dataSource,
+        int32_t timeScale,
+        const sp<SampleTable> &sampleTable,
+        const MPEG4Extractor::PCMInfo &pcm,
+        bool isFragmented,
+        uint32_t trackID,
+        const MPEG4Extractor::TrackExtends *trackExtends,
+        off64_t firstMoofOffset)
+    : mOwner(owner),
+      mFormat(format),
+      mDataSource(dataSource),
+      mTimescale(timeScale),
+      mSampleTable(sampleTable),
+      mCurrentSampleIndex(0),
+      mPCM(pcm),
+      mIsWAV(false),
+      mSendWaveFormat(false),
+      mIsAVC(false),
+      mNALLengthSize(0),
+      mStarted(false),
+      mGroup(NULL),
+      mBuffer(NULL),
+      mWantsNALFragments(false),
+      mSrcBuffer(NULL),
+      mIsFragmented(isFragmented),
+      mTrackID(trackID),
+      mNextMoofOffset(firstMoofOffset),
+      mNextFragmentTime(0),
+      mReachedLastFragment(false),
+      mLoadedFragment(-1),
+      mReadFragment(0),
+      mReadSample(0) {
+    const char *mime;
+    bool success = mFormat->findCString(kKeyMIMEType, &mime);
+    CHECK(success);
+
+    mIsAVC = !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC);
+    mIsWAV = !strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_WAV);
+
+    if (mIsAVC) {
+        uint32_t type;
+        const void *data;
+        size_t size;
+        CHECK(format->findData(kKeyAVCC, &type, &data, &size));
+
+        const uint8_t *ptr = (const uint8_t *)data;
+
+        CHECK(size >= 7);
+        CHECK_EQ((unsigned)ptr[0], 1u);  // configurationVersion == 1
+
+        // The number of bytes used to encode the length of a NAL unit.
+        mNALLengthSize = 1 + (ptr[4] & 3);
+    }
+
+    if (trackExtends != NULL) {
+        mTrackExtends = *trackExtends;
+    } else {
+        memset(&mTrackExtends, 0, sizeof(mTrackExtends));
+        mTrackExtends.mTrackID = trackID;
+    }
+}
+
+MPEG4Source::~MPEG4Source() {
+    if (mStarted) {
+        stop();
+    }
+}
+
+status_t MPEG4Source::start(MetaData *params) {
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK(!mStarted);
+
+    int32_t val;
+    if (params && params->findInt32(kKeyWantsNALFragments, &val)
+        && val != 0) {
+        mWantsNALFragments = true;
+    } else {
+        mWantsNALFragments = false;
+    }
+
+    mGroup = new MediaBufferGroup;
+
+    int32_t max_size;
+    CHECK(mFormat->findInt32(kKeyMaxInputSize, &max_size));
+
+    mGroup->add_buffer(new MediaBuffer(max_size));
+
+    mSrcBuffer = new uint8_t[max_size];
+
+    mSendWaveFormat = mIsWAV;
+    mStarted = true;
+
+    return OK;
+}
+
+status_t MPEG4Source::stop() {
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK(mStarted);
+
+    if (mBuffer != NULL) {
+        mBuffer->release();
+        mBuffer = NULL;
+    }
+
+    delete[] mSrcBuffer;
+    mSrcBuffer = NULL;
+
+    delete mGroup;
+    mGroup = NULL;
+
+    mStarted = false;
+    mCurrentSampleIndex = 0;
+    mReadFragment = 0;
+    mReadSample = 0;
+
+    mOwner->setReadOffset(this, -1);
+
+    return OK;
+}
+
+sp<MetaData> MPEG4Source::getFormat() {
+    Mutex::Autolock autoLock(mLock);
+
+    return mFormat;
+}
+
+size_t MPEG4Source::parseNALSize(const uint8_t *data) const {
+    switch (mNALLengthSize) {
+        case 1:
+            return *data;
+        case 2:
+            return U16_AT(data);
+        case 3:
+            return ((size_t)data[0] << 16) | U16_AT(&data[1]);
+        case 4:
+            return U32_AT(data);
+    }
+
+    // This cannot happen, mNALLengthSize springs to life by adding 1 to
+    // a 2-bit integer.
+    CHECK(!"Should not be here.");
+
+    return 0;
+}
+
+status_t MPEG4Source::readBoxHeader(
+        off64_t offset, uint32_t *type, off64_t *size, off64_t *headerSize) {
+    uint32_t hdr[2];
+    ssize_t n = mDataSource->readAt(offset, hdr, 8);
+    if (n < 8) {
+        return (n < 0) ? ERROR_IO : ERROR_END_OF_STREAM;
+    }
+
+    uint64_t chunk_size = ntohl(hdr[0]);
+    *type = ntohl(hdr[1]);
+    *headerSize = 8;
+
+    if (chunk_size == 1) {
+        if (mDataSource->readAt(offset + 8, &chunk_size, 8) < 8) {
+            return ERROR_IO;
+        }
+        chunk_size = ntoh64(chunk_size);
+        *headerSize = 16;
+    } else if (chunk_size == 0) {
+        // The box extends to the end of the file, nothing follows it.
+        off64_t fileSize;
+        if (mDataSource->getSize(&fileSize) != OK || fileSize <= offset) {
+            return ERROR_END_OF_STREAM;
+        }
+        chunk_size = fileSize - offset;
+    }
+
+    if (chunk_size < (uint64_t)*headerSize || chunk_size > INT64_MAX) {
+        return ERROR_MALFORMED;
+    }
+
+    *size = chunk_size;
+
+    return OK;
+}
+
+status_t MPEG4Source::indexNextFragment() {
+    Vector<FragmentSample> samples;
+
+    while (!mReachedLastFragment) {
+        uint32_t type;
+        off64_t size, headerSize;
+        status_t err = readBoxHeader(mNextMoofOffset, &type, &size, &headerSize);
+
+        if (err == ERROR_END_OF_STREAM) {
+            mReachedLastFragment = true;
+            break;
+        } else if (err != OK) {
+            return err;
+        }
+
+        off64_t moofOffset = mNextMoofOffset;
+        mNextMoofOffset += size;
+
+        if (type == FOURCC('m', 'f', 'r', 'a')) {
+            // The random access box closes the file.
+            mReachedLastFragment = true;
+            break;
+        }
+
+        if (type != FOURCC('m', 'o', 'o', 'f')) {
+            continue;
+        }
+
+        uint64_t baseTime = mNextFragmentTime;
+        err = parseMoof(moofOffset, size, &baseTime, &samples);
+
+        if (err != OK) {
+            return err;
+        }
+
+        if (samples.isEmpty()) {
+            // No samples of this track in this fragment.
+            continue;
+        }
+
+        const FragmentSample &last = samples.itemAt(samples.size() - 1);
+        mNextFragmentTime = last.mTime + last.mDuration;
+
+        FragmentInfo info;
+        info.mMoofOffset = moofOffset;
+        info.mMoofSize = size;
+        info.mBaseTime = baseTime;
+        mFragments.push(info);
+
+        return OK;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::loadFragment(size_t index) {
+    if (mLoadedFragment == (ssize_t)index) {
+        return OK;
+    }
+
+    mLoadedFragment = -1;
+
+    const FragmentInfo &info = mFragments.itemAt(index);
+    uint64_t baseTime = info.mBaseTime;
+    status_t err = parseMoof(
+            info.mMoofOffset, info.mMoofSize, &baseTime, &mFragmentSamples);
+
+    if (err != OK) {
+        return err;
+    }
+
+    if (mFragmentSamples.isEmpty()) {
+        // The same box parsed fine while indexing.
+        return ERROR_IO;
+    }
+
+    mLoadedFragment = index;
+
+    return OK;
+}
+
+status_t MPEG4Source::parseMoof(
+        off64_t moofOffset, off64_t moofSize, uint64_t *baseTime,
+        Vector<FragmentSample> *samples) {
+    samples->clear();
+
+    uint32_t type;
+    off64_t size, headerSize;
+    status_t err = readBoxHeader(moofOffset, &type, &size, &headerSize);
+    if (err != OK) {
+        return (err == ERROR_END_OF_STREAM) ? ERROR_MALFORMED : err;
+    }
+
+    off64_t offset = moofOffset + headerSize;
+    off64_t stopOffset = moofOffset + moofSize;
+
+    while (offset < stopOffset) {
+        err = readBoxHeader(offset, &type, &size, &headerSize);
+        if (err != OK) {
+            return (err == ERROR_END_OF_STREAM) ? ERROR_MALFORMED : err;
+        }
+
+        if (size > stopOffset - offset) {
+            return ERROR_MALFORMED;
+        }
+
+        if (type == FOURCC('t', 'r', 'a', 'f')) {
+            err = parseTraf(
+                    moofOffset, offset + headerSize, offset + size,
+                    baseTime, samples);
+
+            if (err != OK) {
+                return err;
+            }
+        }
+
+        offset += size;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::parseTraf(
+        off64_t moofOffset, off64_t offset, off64_t stopOffset,
+        uint64_t *baseTime, Vector<FragmentSample> *samples) {
+    bool haveHeader = false;
+    uint32_t defaultDuration = mTrackExtends.mSampleDuration;
+    uint32_t defaultSize = mTrackExtends.mSampleSize;
+    uint32_t defaultFlags = mTrackExtends.mSampleFlags;
+
+    // Samples are stored relative to the start of the movie fragment
+    // unless the track fragment header says otherwise.
+    off64_t dataOffset = moofOffset;
+    off64_t baseDataOffset = moofOffset;
+    uint64_t time = *baseTime;
+
+    if (!samples->isEmpty()) {
+        // A second track fragment of the same track continues the first.
+        const FragmentSample &last = samples->itemAt(samples->size() - 1);
+        time = last.mTime + last.mDuration;
+    }
+
+    while (offset < stopOffset) {
+        uint32_t type;
+        off64_t size, headerSize;
+        status_t err = readBoxHeader(offset, &type, &size, &headerSize);
+        if (err != OK) {
+            return (err == ERROR_END_OF_STREAM) ? ERROR_MALFORMED : err;
+        }
+
+        if (size > stopOffset - offset) {
+            return ERROR_MALFORMED;
+        }
+
+        off64_t data_offset = offset + headerSize;
+        off64_t data_size = size - headerSize;
+
+        switch (type) {
+            case FOURCC('t', 'f', 'h', 'd'):
+            {
+                uint8_t buffer[40];
+                if (data_size < 8) {
+                    return ERROR_MALFORMED;
+                }
+
+                size_t n = data_size < (off64_t)sizeof(buffer)
+                    ? data_size : sizeof(buffer);
+                if (mDataSource->readAt(data_offset, buffer, n) < (ssize_t)n) {
+                    return ERROR_IO;
+                }
+
+                if (U32_AT(&buffer[4]) != mTrackID) {
+                    // Somebody else's fragment.
+                    return OK;
+                }
+
+                uint32_t flags = U32_AT(buffer) & 0xffffff;
+
+                size_t needed = 8;
+                if (flags & 0x01) needed += 8;
+                if (flags & 0x02) needed += 4;
+                if (flags & 0x08) needed += 4;
+                if (flags & 0x10) needed += 4;
+                if (flags & 0x20) needed += 4;
+                if (n < needed) {
+                    return ERROR_MALFORMED;
+                }
+
+                size_t pos = 8;
+                if (flags & 0x01) {
+                    // base-data-offset-present
+                    baseDataOffset = U64_AT(&buffer[pos]);
+                    pos += 8;
+                }
+                if (flags & 0x02) {
+                    // sample-description-index-present
+                    pos += 4;
+                }
+                if (flags & 0x08) {
+                    defaultDuration = U32_AT(&buffer[pos]);
+                    pos += 4;
+                }
+                if (flags & 0x10) {
+                    defaultSize = U32_AT(&buffer[pos]);
+                    pos += 4;
+                }
+                if (flags & 0x20) {
+                    defaultFlags = U32_AT(&buffer[pos]);
+                    pos += 4;
+                }
+
+                dataOffset = baseDataOffset;
+                haveHeader = true;
+                break;
+            }
+
+            case FOURCC('t', 'f', 'd', 't'):
+            {
+                if (!haveHeader) {
+                    return ERROR_MALFORMED;
+                }
+
+                uint8_t buffer[12];
+                if (data_size < 8) {
+                    return ERROR_MALFORMED;
+                }
+
+                size_t n = data_size < (off64_t)sizeof(buffer)
+                    ? data_size : sizeof(buffer);
+                if (mDataSource->readAt(data_offset, buffer, n) < (ssize_t)n) {
+                    return ERROR_IO;
+                }
+
+                if (buffer[0] == 1) {
+                    if (n < 12) {
+                        return ERROR_MALFORMED;
+                    }
+                    time = U64_AT(&buffer[4]);
+                } else {
+                    time = U32_AT(&buffer[4]);
+                }
+
+                if (samples->isEmpty()) {
+                    *baseTime = time;
+                }
+                break;
+            }
+
+            case FOURCC('t', 'r', 'u', 'n'):
+            {
+                if (!haveHeader) {
+                    return ERROR_MALFORMED;
+                }
+
+                err = parseTrun(
+                        data_offset, data_size, &dataOffset, &time,
+                        defaultDuration, defaultSize, defaultFlags, samples);
+
+                if (err != OK) {
+                    return err;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        offset += size;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::parseTrun(
+        off64_t offset, off64_t size, off64_t *dataOffset,
+        uint64_t *time, uint32_t defaultDuration, uint32_t defaultSize,
+        uint32_t defaultFlags, Vector<FragmentSample> *samples) {
+    uint8_t header[16];
+    if (size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mDataSource->readAt(offset, header, 8) < 8) {
+        return ERROR_IO;
+    }
+
+    uint32_t flags = U32_AT(header) & 0xffffff;
+    uint32_t sampleCount = U32_AT(&header[4]);
+
+    size_t headerSize = 8;
+    if (flags & 0x01) headerSize += 4;  // data-offset-present
+    if (flags & 0x04) headerSize += 4;  // first-sample-flags-present
+
+    size_t entrySize = 0;
+    if (flags & 0x100) entrySize += 4;  // sample-duration-present
+    if (flags & 0x200) entrySize += 4;  // sample-size-present
+    if (flags & 0x400) entrySize += 4;  // sample-flags-present
+    if (flags & 0x800) entrySize += 4;  // sample-composition-time-offsets-present
+
+    if ((uint64_t)size < headerSize + (uint64_t)sampleCount * entrySize) {
+        return ERROR_MALFORMED;
+    }
+
+    if (headerSize > 8
+            && mDataSource->readAt(offset + 8, &header[8], headerSize - 8)
+                < (ssize_t)(headerSize - 8)) {
+        return ERROR_IO;
+    }
+
+    size_t pos = 8;
+    if (flags & 0x01) {
+        *dataOffset += (int32_t)U32_AT(&header[pos]);
+        pos += 4;
+    }
+
+    uint32_t firstSampleFlags = defaultFlags;
+    if (flags & 0x04) {
+        firstSampleFlags = U32_AT(&header[pos]);
+        pos += 4;
+    }
+
+    uint8_t *entries = NULL;
+    if (entrySize > 0 && sampleCount > 0) {
+        size_t tableSize = sampleCount * entrySize;
+        entries = new uint8_t[tableSize];
+
+        if (mDataSource->readAt(offset + headerSize, entries, tableSize)
+                < (ssize_t)tableSize) {
+            delete[] entries;
+            return ERROR_IO;
+        }
+    }
+
+    status_t err = OK;
+    const uint8_t *entry = entries;
+    for (uint32_t i = 0; i < sampleCount; ++i) {
+        FragmentSample sample;
+        sample.mDuration = defaultDuration;
+        sample.mSize = defaultSize;
+        uint32_t sampleFlags = (i == 0) ? firstSampleFlags : defaultFlags;
+        sample.mCompositionOffset = 0;
+
+        if (flags & 0x100) {
+            sample.mDuration = U32_AT(entry);
+            entry += 4;
+        }
+        if (flags & 0x200) {
+            sample.mSize = U32_AT(entry);
+            entry += 4;
+        }
+        if (flags & 0x400) {
+            sampleFlags = U32_AT(entry);
+            entry += 4;
+        }
+        if (flags & 0x800) {
+            sample.mCompositionOffset = (int32_t)U32_AT(entry);
+            entry += 4;
+        }
+
+        if (sample.mSize == 0) {
+            err = ERROR_MALFORMED;
+            break;
+        }
+
+        sample.mOffset = *dataOffset;
+        sample.mTime = *time;
+        // sample_is_non_sync_sample
+        sample.mIsSync = !(sampleFlags & 0x10000);
+
+        *dataOffset += sample.mSize;
+        *time += sample.mDuration;
+
+        samples->push(sample);
+    }
+
+    delete[] entries;
+    entries = NULL;
+
+    return err;
+}
+
+void MPEG4Source::setFragmentPosition(
+        size_t fragment, size_t sample, FragmentPosition *pos) const {
+    const FragmentSample &s = mFragmentSamples.itemAt(sample);
+
+    pos->mFragment = fragment;
+    pos->mSample = sample;
+    pos->mTime = s.mTime;
+
+    if (s.mCompositionOffset < 0
+            && (uint64_t)-(int64_t)s.mCompositionOffset > s.mTime) {
+        pos->mCompositionTime = 0;
+    } else {
+        pos->mCompositionTime = s.mTime + s.mCompositionOffset;
+    }
+}
+
+status_t MPEG4Source::nextFragmentSample(FragmentPosition *pos) {
+    status_t err = loadFragment(pos->mFragment);
+    if (err != OK) {
+        return err;
+    }
+
+    if (pos->mSample + 1 < mFragmentSamples.size()) {
+        setFragmentPosition(pos->mFragment, pos->mSample + 1, pos);
+        return OK;
+    }
+
+    if (pos->mFragment + 1 >= mFragments.size()) {
+        if ((err = indexNextFragment()) != OK) {
+            return err;
+        }
+
+        if (pos->mFragment + 1 >= mFragments.size()) {
+            return ERROR_OUT_OF_RANGE;
+        }
+    }
+
+    if ((err = loadFragment(pos->mFragment + 1)) != OK) {
+        return err;
+    }
+
+    setFragmentPosition(pos->mFragment + 1, 0, pos);
+
+    return OK;
+}
+
+status_t MPEG4Source::findFragmentSyncSample(
+        const FragmentPosition &from, bool forward, FragmentPosition *sync) {
+    size_t fragment = from.mFragment;
+    size_t sample = from.mSample;
+
+    for (;;) {
+        status_t err = loadFragment(fragment);
+        if (err != OK) {
+            return err;
+        }
+
+        size_t numSamples = mFragmentSamples.size();
+
+        if (forward) {
+            for (; sample < numSamples; ++sample) {
+                if (mFragmentSamples.itemAt(sample).mIsSync) {
+                    setFragmentPosition(fragment, sample, sync);
+                    return OK;
+                }
+            }
+
+            if (fragment + 1 >= mFragments.size()) {
+                if (mReachedLastFragment) {
+                    return ERROR_OUT_OF_RANGE;
+                }
+
+                if ((err = indexNextFragment()) != OK) {
+                    return err;
+                }
+
+                continue;
+            }
+
+            ++fragment;
+            sample = 0;
+        } else {
+            if (sample >= numSamples) {
+                sample = numSamples - 1;
+            }
+
+            for (size_t i = sample + 1; i-- > 0;) {
+                if (mFragmentSamples.itemAt(i).mIsSync) {
+                    setFragmentPosition(fragment, i, sync);
+                    return OK;
+                }
+            }
+
+            if (fragment == 0) {
+                return ERROR_OUT_OF_RANGE;
+            }
+
+            --fragment;
+            sample = SIZE_MAX;
+        }
+    }
+}
+
+status_t MPEG4Source::seekToFragmentSample(
+        uint64_t seekTime, uint32_t findFlags, bool closest,
+        uint64_t *sampleTime) {
+    // Index every fragment starting at or before the requested time.
+    while (!mReachedLastFragment
+            && (mFragments.isEmpty()
+                || mFragments.itemAt(mFragments.size() - 1).mBaseTime <= seekTime)) {
+        status_t err = indexNextFragment();
+        if (err != OK) {
+            return err;
+        }
+    }
+
+    if (mFragments.isEmpty()) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    size_t left = 0;
+    size_t right = mFragments.size();
+    while (right - left > 1) {
+        size_t center = left + (right - left) / 2;
+        if (mFragments.itemAt(center).mBaseTime <= seekTime) {
+            left = center;
+        } else {
+            right = center;
+        }
+    }
+
+    status_t err = loadFragment(left);
+    if (err != OK) {
+        return err;
+    }
+
+    // The last sample at or before the requested time.
+    size_t lo = 0;
+    size_t hi = mFragmentSamples.size();
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mFragmentSamples.itemAt(mid).mTime <= seekTime) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    FragmentPosition target;
+    setFragmentPosition(left, lo, &target);
+
+    if (target.mTime < seekTime
+            && (findFlags == SampleTable::kFlagAfter
+                || findFlags == SampleTable::kFlagClosest)) {
+        FragmentPosition next = target;
+        err = nextFragmentSample(&next);
+
+        if (err == OK) {
+            if (findFlags == SampleTable::kFlagAfter
+                    || next.mTime - seekTime < seekTime - target.mTime) {
+                target = next;
+            }
+        } else if (err != ERROR_OUT_OF_RANGE) {
+            return err;
+        } else if (findFlags == SampleTable::kFlagAfter) {
+            return ERROR_OUT_OF_RANGE;
+        }
+    }
+
+    *sampleTime = target.mCompositionTime;
+
+    if (closest) {
+        // We found the closest sample already, now we want the sync
+        // sample preceding it (or the sample itself of course), even
+        // if the subsequent sync sample is closer.
+        findFlags = SampleTable::kFlagBefore;
+    }
+
+    FragmentPosition sync;
+    switch (findFlags) {
+        case SampleTable::kFlagBefore:
+        {
+            err = findFragmentSyncSample(target, false, &sync);
+            if (err == ERROR_OUT_OF_RANGE) {
+                err = findFragmentSyncSample(target, true, &sync);
+            }
+            break;
+        }
+
+        case SampleTable::kFlagAfter:
+        {
+            err = findFragmentSyncSample(target, true, &sync);
+            break;
+        }
+
+        default:
+        {
+            FragmentPosition before, after;
+            status_t beforeErr = findFragmentSyncSample(target, false, &before);
+            status_t afterErr = findFragmentSyncSample(target, true, &after);
+
+            if (beforeErr != OK && afterErr != OK) {
+                err = (beforeErr == ERROR_OUT_OF_RANGE) ? afterErr : beforeErr;
+            } else if (beforeErr != OK) {
+                sync = after;
+            } else if (afterErr != OK) {
+                sync = before;
+            } else {
+                sync = (after.mTime - target.mTime < target.mTime - before.mTime)
+                    ? after : before;
+            }
+            break;
+        }
+    }
+
+    if (err != OK) {
+        return err;
+    }
+
+    mReadFragment = sync.mFragment;
+    mReadSample = sync.mSample;
+
+    return OK;
+}
+
+status_t MPEG4Source::getNextFragmentSample() {
+    for (;;) {
+        status_t err;
+        if (mReadFragment >= mFragments.size()) {
+            if (mReachedLastFragment) {
+                return ERROR_END_OF_STREAM;
+            }
+
+            if ((err = indexNextFragment()) != OK) {
+                return err;
+            }
+
+            continue;
+        }
+
+        if ((err = loadFragment(mReadFragment)) != OK) {
+            return err;
+        }
+
+        if (mReadSample < mFragmentSamples.size()) {
+            return OK;
+        }
+
+        ++mReadFragment;
+        mReadSample = 0;
+    }
+}
+
+status_t MPEG4Source::getNextSample(
+        off64_t *offset, size_t *size, uint64_t *cts,
+        bool *isSyncSample, uint32_t *numSamples) {
+    status_t err;
+
+    if (mIsFragmented) {
+        if ((err = getNextFragmentSample()) != OK) {
+            return err;
+        }
+
+        FragmentPosition pos;
+        setFragmentPosition(mReadFragment, mReadSample, &pos);
+
+        const FragmentSample &sample = mFragmentSamples.itemAt(mReadSample);
+        *offset = sample.mOffset;
+        *size = sample.mSize;
+        *cts = pos.mCompositionTime;
+        *isSyncSample = sample.mIsSync;
+        *numSamples = 1;
+
+        return OK;
+    }
+
+    err = mSampleTable->getMetaDataForSample(
+            mCurrentSampleIndex, offset, size, cts, isSyncSample);
+
+    if (err != OK) {
+        return err;
+    }
+
+    *numSamples = 1;
+
+    if (mPCM.mFormat != 0 && *size == mPCM.mBytesPerFrame) {
+        // Hand out a run of frames stored back to back at once.
+        err = mSampleTable->countContiguousSamples(
+                mCurrentSampleIndex, kMaxPCMFramesPerBuffer, numSamples);
+
+        if (err != OK) {
+            return err;
+        }
+
+        *size = *numSamples * mPCM.mBytesPerFrame;
+    }
+
+    return OK;
+}
+
+void MPEG4Source::advance(uint32_t numSamples, off64_t endOffset) {
+    if (mIsFragmented) {
+        mReadSample += numSamples;
+    } else {
+        mCurrentSampleIndex += numSamples;
+    }
+
+    mOwner->setReadOffset(this, endOffset);
+}
+
+status_t MPEG4Source::seekToSample(
+        int64_t seekTimeUs, ReadOptions::SeekMode mode,
+        int64_t *targetSampleTimeUs) {
+    uint32_t findFlags = 0;
+    switch (mode) {
+        case ReadOptions::SEEK_PREVIOUS_SYNC:
+            findFlags = SampleTable::kFlagBefore;
+            break;
+        case ReadOptions::SEEK_NEXT_SYNC:
+            findFlags = SampleTable::kFlagAfter;
+            break;
+        case ReadOptions::SEEK_CLOSEST_SYNC:
+        case ReadOptions::SEEK_CLOSEST:
+            findFlags = SampleTable::kFlagClosest;
+            break;
+        default:
+            CHECK(!"Should not be here.");
+            break;
+    }
+
+    if (seekTimeUs < 0) {
+        seekTimeUs = 0;
+    }
+
+    uint64_t seekTime = (uint64_t)seekTimeUs * mTimescale / 1000000;
+
+    status_t err;
+    uint64_t sampleTime;
+
+    if (mIsFragmented) {
+        err = seekToFragmentSample(
+                seekTime, findFlags, mode == ReadOptions::SEEK_CLOSEST,
+                &sampleTime);
+    } else {
+        uint32_t sampleIndex;
+        err = mSampleTable->findSampleAtTime(seekTime, &sampleIndex, findFlags);
+
+        if (mode == ReadOptions::SEEK_CLOSEST) {
+            // We found the closest sample already, now we want the sync
+            // sample preceding it (or the sample itself of course), even
+            // if the subsequent sync sample is closer.
+            findFlags = SampleTable::kFlagBefore;
+        }
+
+        uint32_t syncSampleIndex;
+        if (err == OK) {
+            err = mSampleTable->findSyncSampleNear(
+                    sampleIndex, &syncSampleIndex, findFlags);
+        }
+
+        if (err == OK) {
+            err = mSampleTable->getMetaDataForSample(
+                    sampleIndex, NULL, NULL, &sampleTime);
+        }
+
+        if (err == OK) {
+            mCurrentSampleIndex = syncSampleIndex;
+        }
+    }
+
+    if (err != OK) {
+        if (err == ERROR_OUT_OF_RANGE) {
+            // An attempt to seek past the end of the stream would
+            // normally cause this ERROR_OUT_OF_RANGE error. Propagating
+            // this all the way to the MediaPlayer would cause abnormal
+            // termination. Legacy behaviour appears to be to behave as if
+            // we had seeked to the end of stream, ending normally.
+            err = ERROR_END_OF_STREAM;
+        }
+        return err;
+    }
+
+    if (mode == ReadOptions::SEEK_CLOSEST) {
+        *targetSampleTimeUs = (sampleTime * 1000000ll) / mTimescale;
+    }
+
+    return OK;
+}
+
+status_t MPEG4Source::convertPCM(size_t srcSize, size_t *dstSize) {
+    uint8_t *dst = (uint8_t *)mBuffer->data();
+
+    if (mPCM.mBitsPerSample == 8
+            && (mPCM.mFormat == FOURCC('r', 'a', 'w', ' ')
+                || mPCM.mFormat == FOURCC('t', 'w', 'o', 's')
+                || mPCM.mFormat == FOURCC('s', 'o', 'w', 't'))) {
+        if (srcSize * 2 > mBuffer->size()) {
+            return ERROR_BUFFER_TOO_SMALL;
+        }
+
+        // 'raw ' is unsigned, 'twos' and 'sowt' are signed.
+        uint8_t bias = (mPCM.mFormat == FOURCC('r', 'a', 'w', ' ')) ? 0x80 : 0;
+        int16_t *out = (int16_t *)dst;
+        for (size_t i = 0; i < srcSize; ++i) {
+            out[i] = (int16_t)((int8_t)(mSrcBuffer[i] ^ bias)) << 8;
+        }
+
+        *dstSize = srcSize * 2;
+        return OK;
+    }
+
+    if (srcSize > mBuffer->size()) {
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+
+    if (mPCM.mBitsPerSample == 16 && mPCM.mFormat == FOURCC('t', 'w', 'o', 's')) {
+        // Big endian.
+        for (size_t i = 0; i + 1 < srcSize; i += 2) {
+            dst[i] = mSrcBuffer[i + 1];
+            dst[i + 1] = mSrcBuffer[i];
+        }
+    } else {
+        memcpy(dst, mSrcBuffer, srcSize);
+    }
+
+    *dstSize = srcSize;
+    return OK;
+}
+
+void MPEG4Source::writeWaveFormat(int64_t timeUs) {
+    int32_t numChannels, sampleRate;
+    CHECK(mFormat->findInt32(kKeyChannelCount, &numChannels));
+    CHECK(mFormat->findInt32(kKeySampleRate, &sampleRate));
+
+    // Samples are handed out as 16 bit little endian PCM, see convertPCM().
+    uint32_t blockAlign = numChannels * 2;
+
+    // WAVEFORMATEX as WAVDecoder.h declares it, little endian.
+    uint8_t *dst = (uint8_t *)mBuffer->data();
+    memset(dst, 0, kWaveFormatExSize);
+    dst[0] = 1;                                 // WAVE_FORMAT_PCM
+    dst[2] = numChannels;
+    dst[4] = sampleRate & 0xff;
+    dst[5] = (sampleRate >> 8) & 0xff;
+    dst[6] = (sampleRate >> 16) & 0xff;
+    dst[7] = sampleRate >> 24;
+
+    uint32_t bytesPerSec = sampleRate * blockAlign;
+    dst[8] = bytesPerSec & 0xff;
+    dst[9] = (bytesPerSec >> 8) & 0xff;
+    dst[10] = (bytesPerSec >> 16) & 0xff;
+    dst[11] = bytesPerSec >> 24;
+    dst[12] = blockAlign;
+    dst[14] = 16;                               // bits per sample
+
+    mBuffer->set_range(0, kWaveFormatExSize);
+    mBuffer->meta_data()->clear();
+    mBuffer->meta_data()->setInt64(kKeyTime, timeUs);
+}
+
+status_t MPEG4Source::read(
+        MediaBuffer **out, const ReadOptions *options) {
+    Mutex::Autolock autoLock(mLock);
+
+    CHECK(mStarted);
+
+    *out = NULL;
+
+    int64_t targetSampleTimeUs = -1;
+
+    int64_t seekTimeUs;
+    ReadOptions::SeekMode mode;
+    if (options && options->getSeekTo(&seekTimeUs, &mode)) {
+        status_t err = seekToSample(seekTimeUs, mode, &targetSampleTimeUs);
+
+        if (err != OK) {
+            return err;
+        }
+
+        if (mBuffer != NULL) {
+            mBuffer->release();
+            mBuffer = NULL;
+        }
+
+        // fall through
+    }
+
+    off64_t offset;
+    size_t size;
+    uint64_t cts;
+    bool isSyncSample;
+    uint32_t numSamples;
+    bool newBuffer = false;
+    if (mBuffer == NULL) {
+        newBuffer = true;
+
+        status_t err = getNextSample(
+                &offset, &size, &cts, &isSyncSample, &numSamples);
+
+        if (err != OK) {
+            return err;
+        }
+
+        err = mGroup->acquire_buffer(&mBuffer);
+
+        if (err != OK) {
+            CHECK(mBuffer == NULL);
+            return err;
+        }
+
+        if (size > mBuffer->size()) {
+            ALOGE("sample of %d bytes exceeds the buffer size of %d",
+                  size, mBuffer->size());
+
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return ERROR_BUFFER_TOO_SMALL;
+        }
+    }
+
+    if (mSendWaveFormat) {
+        // WAVDecoder copies the WAVEFORMATEX out of the first buffer and
+        // drops whatever follows it, so it goes out on its own.
+        writeWaveFormat(((int64_t)cts * 1000000) / mTimescale);
+        mSendWaveFormat = false;
+
+        *out = mBuffer;
+        mBuffer = NULL;
+
+        return OK;
+    }
+
+    if (mPCM.mFormat != 0) {
+        ssize_t num_bytes_read =
+            mDataSource->readAt(offset, mSrcBuffer, size);
+
+        if (num_bytes_read < (ssize_t)size) {
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return ERROR_IO;
+        }
+
+        size_t dstSize;
+        status_t err = convertPCM(size, &dstSize);
+
+        if (err != OK) {
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return err;
+        }
+
+        mBuffer->set_range(0, dstSize);
+        mBuffer->meta_data()->clear();
+        mBuffer->meta_data()->setInt64(
+                kKeyTime, ((int64_t)cts * 1000000) / mTimescale);
+
+        if (targetSampleTimeUs >= 0) {
+            mBuffer->meta_data()->setInt64(
+                    kKeyTargetTime, targetSampleTimeUs);
+        }
+
+        advance(numSamples, offset + size);
+
+        *out = mBuffer;
+        mBuffer = NULL;
+
+        return OK;
+    }
+
+    if (!mIsAVC || mWantsNALFragments) {
+        if (newBuffer) {
+            ssize_t num_bytes_read =
+                mDataSource->readAt(offset, (uint8_t *)mBuffer->data(), size);
+
+            if (num_bytes_read < (ssize_t)size) {
+                mBuffer->release();
+                mBuffer = NULL;
+
+                return ERROR_IO;
+            }
+
+            CHECK(mBuffer != NULL);
+            mBuffer->set_range(0, size);
+            mBuffer->meta_data()->clear();
+            mBuffer->meta_data()->setInt64(
+                    kKeyTime, ((int64_t)cts * 1000000) / mTimescale);
+
+            if (targetSampleTimeUs >= 0) {
+                mBuffer->meta_data()->setInt64(
+                        kKeyTargetTime, targetSampleTimeUs);
+            }
+
+            if (isSyncSample) {
+                mBuffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+            }
+
+            advance(numSamples, offset + size);
+        }
+
+        if (!mIsAVC) {
+            *out = mBuffer;
+            mBuffer = NULL;
+
+            return OK;
+        }
+
+        // Each NAL unit is split up into its constituent fragments and
+        // each one of them returned in its own buffer.
+
+        if (mBuffer->range_length() < mNALLengthSize) {
+            ALOGE("incomplete NAL unit.");
+
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return ERROR_MALFORMED;
+        }
+
+        const uint8_t *src =
+            (const uint8_t *)mBuffer->data() + mBuffer->range_offset();
+
+        size_t nal_size = parseNALSize(src);
+        if (mBuffer->range_length() < mNALLengthSize + nal_size) {
+            ALOGE("incomplete NAL unit.");
+
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return ERROR_MALFORMED;
+        }
+
+        MediaBuffer *clone = mBuffer->clone();
+        CHECK(clone != NULL);
+        clone->set_range(mBuffer->range_offset() + mNALLengthSize, nal_size);
+
+        CHECK(mBuffer != NULL);
+        mBuffer->set_range(
+                mBuffer->range_offset() + mNALLengthSize + nal_size,
+                mBuffer->range_length() - mNALLengthSize - nal_size);
+
+        if (mBuffer->range_length() == 0) {
+            mBuffer->release();
+            mBuffer = NULL;
+        }
+
+        *out = clone;
+
+        return OK;
+    } else {
+        // Whole NAL units are returned but each fragment is prefixed by
+        // the start code (0x00 00 00 01).
+        ssize_t num_bytes_read = 0;
+        int32_t drm = 0;
+        bool usesDRM = (mFormat->findInt32(kKeyIsDRM, &drm) && drm != 0);
+        if (usesDRM) {
+            num_bytes_read =
+                mDataSource->readAt(offset, (uint8_t*)mBuffer->data(), size);
+        } else {
+            num_bytes_read = mDataSource->readAt(offset, mSrcBuffer, size);
+        }
+
+        if (num_bytes_read < (ssize_t)size) {
+            mBuffer->release();
+            mBuffer = NULL;
+
+            return ERROR_IO;
+        }
+
+        if (usesDRM) {
+            CHECK(mBuffer != NULL);
+            mBuffer->set_range(0, size);
+
+        } else {
+            uint8_t *dstData = (uint8_t *)mBuffer->data();
+            size_t srcOffset = 0;
+            size_t dstOffset = 0;
+
+            while (srcOffset < size) {
+                bool isMalFormed = (srcOffset + mNALLengthSize > size);
+                size_t nalLength = 0;
+                if (!isMalFormed) {
+                    nalLength = parseNALSize(&mSrcBuffer[srcOffset]);
+                    srcOffset += mNALLengthSize;
+                    isMalFormed = srcOffset + nalLength > size;
+                }
+
+                if (!isMalFormed && dstOffset + 4 + nalLength > mBuffer->size()) {
+                    // More NAL units than accounted for in kKeyMaxInputSize.
+                    isMalFormed = true;
+                }
+
+                if (isMalFormed) {
+                    ALOGE("Video is malformed");
+                    mBuffer->release();
+                    mBuffer = NULL;
+                    return ERROR_MALFORMED;
+                }
+
+                if (nalLength == 0) {
+                    continue;
+                }
+
+                dstData[dstOffset++] = 0;
+                dstData[dstOffset++] = 0;
+                dstData[dstOffset++] = 0;
+                dstData[dstOffset++] = 1;
+                memcpy(&dstData[dstOffset], &mSrcBuffer[srcOffset], nalLength);
+                srcOffset += nalLength;
+                dstOffset += nalLength;
+            }
+            CHECK_EQ(srcOffset, size);
+            CHECK(mBuffer != NULL);
+            mBuffer->set_range(0, dstOffset);
+        }
+
+        mBuffer->meta_data()->clear();
+        mBuffer->meta_data()->setInt64(
+                kKeyTime, ((int64_t)cts * 1000000) / mTimescale);
+
+        if (targetSampleTimeUs >= 0) {
+            mBuffer->meta_data()->setInt64(
+                    kKeyTargetTime, targetSampleTimeUs);
+        }
+
+        if (isSyncSample) {
+            mBuffer->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+        }
+
+        advance(numSamples, offset + size);
+
+        *out = mBuffer;
+        mBuffer = NULL;
+
+        return OK;
+    }
+}
+
+static bool LegacySniffMPEG4(
+        const sp<DataSource> &source, String8 *mimeType, float *confidence) {
+    uint8_t header[8];
+
+    ssize_t n = source->readAt(4, header, sizeof(header));
+    if (n < (ssize_t)sizeof(header)) {
+        return false;
+    }
+
+    if (!memcmp(header, "ftyp3gp", 7) || !memcmp(header, "ftypmp42", 8)
+        || !memcmp(header, "ftyp3gr6", 8) || !memcmp(header, "ftyp3gs6", 8)
+        || !memcmp(header, "ftyp3ge6", 8) || !memcmp(header, "ftyp3gg6", 8)
+        || !memcmp(header, "ftypisom", 8) || !memcmp(header, "ftypM4V ", 8)
+        || !memcmp(header, "ftypM4A ", 8) || !memcmp(header, "ftypf4v ", 8)
+        || !memcmp(header, "ftypkddi", 8) || !memcmp(header, "ftypM4VP", 8)) {
+        *mimeType = MEDIA_MIMETYPE_CONTAINER_MPEG4;
+        *confidence = MPEG4_CONTAINER_CONFIDENCE;
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool isCompatibleBrand(uint32_t fourcc) {
+    static const uint32_t kCompatibleBrands[] = {
+        FOURCC('i', 's', 'o', 'm'),
+        FOURCC('i', 's', 'o', '2'),
+        FOURCC('i', 's', 'o', '5'),
+        FOURCC('i', 's', 'o', '6'),
+        FOURCC('a', 'v', 'c', '1'),
+        FOURCC('3', 'g', 'p', '4'),
+        FOURCC('m', 'p', '4', '1'),
+        FOURCC('m', 'p', '4', '2'),
+        FOURCC('d', 'a', 's', 'h'),
+
+        // Won't promise that the following file types can be played.
+        // Just give these file types a chance.
+        FOURCC('q', 't', ' ', ' '),  // Apple's QuickTime
+        FOURCC('M', 'S', 'N', 'V'),  // Sony's PSP
+
+        FOURCC('3', 'g', '2', 'a'),  // 3GPP2
+        FOURCC('3', 'g', '2', 'b'),
+    };
+
+    for (size_t i = 0;
+         i < sizeof(kCompatibleBrands) / sizeof(kCompatibleBrands[0]);
+         ++i) {
+        if (kCompatibleBrands[i] == fourcc) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Attempt to actually parse the 'ftyp' atom and determine if a suitable
+// compatible brand is present.
+// Also try to identify where this file's metadata ends
+// (end of the 'moov' atom) and report it to the caller as part of
+// the metadata.
+static bool BetterSniffMPEG4(
+        const sp<DataSource> &source, String8 *mimeType, float *confidence,
+        sp<AMessage> *meta) {
+    // We scan up to 128 bytes to identify this file as an MP4.
+    static const off64_t kMaxScanOffset = 128ll;
+
+    off64_t offset = 0ll;
+    bool foundGoodFileType = false;
+    off64_t moovAtomEndOffset = -1ll;
+    bool done = false;
+
+    while (!done && offset < kMaxScanOffset) {
+        uint32_t hdr[2];
+        if (source->readAt(offset, hdr, 8) < 8) {
+            return false;
+        }
+
+        uint64_t chunkSize = ntohl(hdr[0]);
+        uint32_t chunkType = ntohl(hdr[1]);
+        off64_t chunkDataOffset = offset + 8;
+
+        if (chunkSize == 1) {
+            if (source->readAt(offset + 8, &chunkSize, 8) < 8) {
+                return false;
+            }
+
+            chunkSize = ntoh64(chunkSize);
+            chunkDataOffset += 8;
+
+            if (chunkSize < 16) {
+                // The smallest valid chunk is 16 bytes long in this case.
+                return false;
+            }
+        } else if (chunkSize < 8) {
+            // The smallest valid chunk is 8 bytes long.
+            return false;
+        }
+
+        off64_t chunkDataSize = offset + chunkSize - chunkDataOffset;
+
+        char chunkstring[5];
+        MakeFourCCString(chunkType, chunkstring);
+        ALOGV("saw chunk type %s, size %lld @ %lld", chunkstring, chunkSize, offset);
+        switch (chunkType) {
+            case FOURCC('f', 't', 'y', 'p'):
+            {
+                if (chunkDataSize < 8) {
+                    return false;
+                }
+
+                uint32_t numCompatibleBrands = (chunkDataSize - 8) / 4;
+                for (size_t i = 0; i < numCompatibleBrands + 2; ++i) {
+                    if (i == 1) {
+                        // Skip this index, it refers to the minorVersion,
+                        // not a brand.
+                        continue;
+                    }
+
+                    uint32_t brand;
+                    if (source->readAt(
+                                chunkDataOffset + 4 * i, &brand, 4) < 4) {
+                        return false;
+                    }
+
+                    brand = ntohl(brand);
+
+                    if (isCompatibleBrand(brand)) {
+                        foundGoodFileType = true;
+                        break;
+                    }
+                }
+
+                if (!foundGoodFileType) {
+                    return false;
+                }
+
+                break;
+            }
+
+            case FOURCC('m', 'o', 'o', 'v'):
+            {
+                moovAtomEndOffset = offset + chunkSize;
+
+                done = true;
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        offset += chunkSize;
+    }
+
+    if (!foundGoodFileType) {
+        return false;
+    }
+
+    *mimeType = MEDIA_MIMETYPE_CONTAINER_MPEG4;
+    *confidence = MPEG4_CONTAINER_CONFIDENCE;
+
+    if (moovAtomEndOffset >= 0) {
+        *meta = new AMessage;
+        (*meta)->setInt64("meta-data-size", moovAtomEndOffset);
+
+        ALOGV("found metadata size: %lld", moovAtomEndOffset);
+    }
+
+    return true;
+}
+
+bool SniffMPEG4(
+        const sp<DataSource> &source, String8 *mimeType, float *confidence,
+        sp<AMessage> *meta) {
+    if (BetterSniffMPEG4(source, mimeType, confidence, meta)) {
+        return true;
+    }
+
+    if (LegacySniffMPEG4(source, mimeType, confidence)) {
+        ALOGW("Identified supported mpeg4 through LegacySniffMPEG4.");
+        return true;
+    }
+
+    return false;
+}
+
+}  // namespace android
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleIterator"
+#include <utils/Log.h>
+
+#include "include/SampleIterator.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+
+#include "include/SampleTable.h"
+
+namespace android {
+
+SampleIterator::SampleIterator(SampleTable *table)
+    : mTable(table),
+      mInitialized(false),
+      mSampleIndex(0),
+      mCurrentChunkIndex(0),
+      mCurrentChunkFirstSampleIndex(0),
+      mCurrentChunkOffset(0),
+      mChunkDesc(0),
+      mCurrentSampleOffset(0),
+      mCurrentSampleSize(0),
+      mCurrentSampleTime(0) {
+}
+
+status_t SampleIterator::seekTo(uint32_t sampleIndex) {
+    ALOGV("seekTo(%d)", sampleIndex);
+
+    if (sampleIndex >= mTable->mNumSampleSizes) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    if (mTable->mSampleToChunk == NULL
+            || mTable->mChunkOffsets == NULL
+            || mTable->mTimeToSample == NULL) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mInitialized && mSampleIndex == sampleIndex) {
+        return OK;
+    }
+
+    status_t err;
+    if ((err = findChunk(sampleIndex)) != OK) {
+        ALOGE("findChunk failed");
+        mInitialized = false;
+        return err;
+    }
+
+    if ((err = findSampleOffset(sampleIndex)) != OK) {
+        ALOGE("findSampleOffset failed");
+        mInitialized = false;
+        return err;
+    }
+
+    if ((err = SampleTable::findRun_l(
+                    mTable->mTimeToSample, sampleIndex, &mTimeRun)) != OK) {
+        ALOGE("findSampleTime failed");
+        mInitialized = false;
+        return err;
+    }
+
+    mCurrentSampleTime = mTimeRun.mFirstTime
+        + (uint64_t)(sampleIndex - mTimeRun.mFirstSample) * mTimeRun.mValue;
+
+    if (mTable->mCompositionTimeDelta != NULL
+            && SampleTable::findRun_l(
+                mTable->mCompositionTimeDelta, sampleIndex, &mCompositionRun) != OK) {
+        // Samples past the end of the table have no composition offset.
+        mCompositionRun.mValid = false;
+    }
+
+    mSampleIndex = sampleIndex;
+    mInitialized = true;
+
+    return OK;
+}
+
+status_t SampleIterator::findChunk(uint32_t sampleIndex) {
+    if (mInitialized
+            && sampleIndex >= mCurrentChunkFirstSampleIndex
+            && sampleIndex - mCurrentChunkFirstSampleIndex < mChunkRun.mValue) {
+        return OK;
+    }
+
+    status_t err = SampleTable::findRun_l(
+            mTable->mSampleToChunk, sampleIndex, &mChunkRun);
+    if (err != OK) {
+        return err;
+    }
+
+    // The run contains the sample, so it has at least one sample per chunk.
+    uint32_t chunk = (sampleIndex - mChunkRun.mFirstSample) / mChunkRun.mValue;
+
+    mCurrentChunkIndex = mChunkRun.mFirstChunk + chunk;
+    mCurrentChunkFirstSampleIndex = mChunkRun.mFirstSample + chunk * mChunkRun.mValue;
+    mChunkDesc = mChunkRun.mDescIndex;
+
+    // Forces findSampleOffset to start at the beginning of the chunk.
+    mInitialized = false;
+
+    return mTable->getChunkOffset_l(mCurrentChunkIndex, &mCurrentChunkOffset);
+}
+
+status_t SampleIterator::findSampleOffset(uint32_t sampleIndex) {
+    uint32_t index;
+    off64_t offset;
+    if (mInitialized && sampleIndex > mSampleIndex) {
+        // Moving forward within the current chunk.
+        index = mSampleIndex + 1;
+        offset = mCurrentSampleOffset + mCurrentSampleSize;
+    } else {
+        index = mCurrentChunkFirstSampleIndex;
+        offset = mCurrentChunkOffset;
+    }
+
+    status_t err;
+    if (mTable->mDefaultSampleSize > 0) {
+        offset += (off64_t)(sampleIndex - index) * mTable->mDefaultSampleSize;
+    } else {
+        for (; index < sampleIndex; ++index) {
+            size_t size;
+            if ((err = mTable->getSampleSize_l(index, &size)) != OK) {
+                return err;
+            }
+
+            offset += size;
+        }
+    }
+
+    if ((err = mTable->getSampleSize_l(sampleIndex, &mCurrentSampleSize)) != OK) {
+        return err;
+    }
+
+    mCurrentSampleOffset = offset;
+
+    return OK;
+}
+
+uint64_t SampleIterator::getCompositionTime() const {
+    if (!mCompositionRun.contains(mSampleIndex)) {
+        return mCurrentSampleTime;
+    }
+
+    int32_t delta = (int32_t)mCompositionRun.mValue;
+    if (delta < 0 && (uint64_t)-(int64_t)delta > mCurrentSampleTime) {
+        return 0;
+    }
+
+    return mCurrentSampleTime + delta;
+}
+
+uint32_t SampleIterator::getSamplesLeftInChunk() const {
+    uint32_t endOfChunk = mCurrentChunkFirstSampleIndex + mChunkRun.mValue;
+    if (endOfChunk > mTable->mNumSampleSizes) {
+        endOfChunk = mTable->mNumSampleSizes;
+    }
+
+    return endOfChunk - mSampleIndex - 1;
+}
+
+}  // namespace android
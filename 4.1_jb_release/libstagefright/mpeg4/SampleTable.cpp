@@ -0,0 +1,1293 @@
+/*
+ * Copyright (C) 2009 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleTable"
+#include <utils/Log.h>
+
+#include "include/SampleTable.h"
+#include "include/SampleIterator.h"
+
+#include <arpa/inet.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+
+namespace android {
+
+// static
+const uint32_t SampleTable::kChunkOffsetType32 = FOURCC('s', 't', 'c', 'o');
+// static
+const uint32_t SampleTable::kChunkOffsetType64 = FOURCC('c', 'o', '6', '4');
+// static
+const uint32_t SampleTable::kSampleSizeType32 = FOURCC('s', 't', 's', 'z');
+// static
+const uint32_t SampleTable::kSampleSizeTypeCompact = FOURCC('s', 't', 'z', '2');
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Fixed size entries of a table, decoded straight from the data source.
+// Only the most recently used pages of the table are held in memory.
+struct SampleTable::CompactTable {
+    CompactTable(
+            const sp<DataSource> &source, off64_t offset,
+            size_t entrySize, uint32_t numEntries);
+
+    ~CompactTable();
+
+    uint32_t numEntries() const { return mNumEntries; }
+
+    // Returns NULL if the entry could not be read. The data stays valid
+    // until the next call.
+    const uint8_t *entryAt(uint32_t index);
+
+private:
+    enum {
+        kEntriesPerPage = 512,
+        kNumPages       = 2,
+    };
+
+    struct Page {
+        uint32_t mFirstEntry;
+        uint32_t mNumEntries;
+        uint32_t mLastUsed;
+        uint8_t *mData;
+    };
+
+    sp<DataSource> mSource;
+    off64_t mOffset;
+    size_t mEntrySize;
+    uint32_t mNumEntries;
+
+    Page mPages[kNumPages];
+    uint32_t mClock;
+
+    DISALLOW_EVIL_CONSTRUCTORS(CompactTable);
+};
+
+SampleTable::CompactTable::CompactTable(
+        const sp<DataSource> &source, off64_t offset,
+        size_t entrySize, uint32_t numEntries)
+    : mSource(source),
+      mOffset(offset),
+      mEntrySize(entrySize),
+      mNumEntries(numEntries),
+      mClock(0) {
+    for (size_t i = 0; i < kNumPages; ++i) {
+        mPages[i].mFirstEntry = 0;
+        mPages[i].mNumEntries = 0;
+        mPages[i].mLastUsed = 0;
+        mPages[i].mData = NULL;
+    }
+}
+
+SampleTable::CompactTable::~CompactTable() {
+    for (size_t i = 0; i < kNumPages; ++i) {
+        delete[] mPages[i].mData;
+        mPages[i].mData = NULL;
+    }
+}
+
+const uint8_t *SampleTable::CompactTable::entryAt(uint32_t index) {
+    if (index >= mNumEntries) {
+        return NULL;
+    }
+
+    uint32_t firstEntry = index - (index % kEntriesPerPage);
+
+    Page *victim = &mPages[0];
+    for (size_t i = 0; i < kNumPages; ++i) {
+        Page *page = &mPages[i];
+
+        if (page->mNumEntries > 0 && page->mFirstEntry == firstEntry) {
+            page->mLastUsed = ++mClock;
+            return &page->mData[(index - firstEntry) * mEntrySize];
+        }
+
+        if (page->mLastUsed < victim->mLastUsed) {
+            victim = page;
+        }
+    }
+
+    uint32_t numEntries = mNumEntries - firstEntry;
+    if (numEntries > kEntriesPerPage) {
+        numEntries = kEntriesPerPage;
+    }
+
+    if (victim->mData == NULL) {
+        victim->mData = new uint8_t[kEntriesPerPage * mEntrySize];
+    }
+
+    size_t size = numEntries * mEntrySize;
+    if (mSource->readAt(
+                mOffset + (off64_t)firstEntry * mEntrySize,
+                victim->mData, size) < (ssize_t)size) {
+        victim->mNumEntries = 0;
+        victim->mLastUsed = 0;
+        return NULL;
+    }
+
+    victim->mFirstEntry = firstEntry;
+    victim->mNumEntries = numEntries;
+    victim->mLastUsed = ++mClock;
+
+    return &victim->mData[(index - firstEntry) * mEntrySize];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// A run-length coded table. Besides the pages of the table itself only the
+// position of every kCheckpointInterval-th run is remembered, as far as the
+// table has been scanned so far.
+struct SampleTable::RunTable {
+    enum Type {
+        TIME_TO_SAMPLE,
+        COMPOSITION_OFFSET,
+        SAMPLE_TO_CHUNK,
+    };
+
+    RunTable(
+            Type type, const sp<DataSource> &source,
+            off64_t offset, uint32_t numEntries);
+
+    uint32_t numEntries() const { return mTable.numEntries(); }
+
+    // 'stsc' only, the last entry extends up to the last chunk.
+    void setNumChunks(uint32_t numChunks) { mNumChunks = numChunks; }
+
+    // Positions "cursor" on the run containing "sampleIndex". Runs close
+    // ahead of the cursor's current position are reached without a lookup.
+    status_t findSample(uint32_t sampleIndex, RunCursor *cursor);
+
+    // Positions "cursor" on the run containing decode time "time".
+    status_t findTime(uint64_t time, RunCursor *cursor);
+
+private:
+    enum {
+        kCheckpointInterval = 256,
+        kMaxForwardRuns     = 8,
+    };
+
+    struct Checkpoint {
+        uint32_t mFirstSample;
+        uint64_t mFirstTime;
+    };
+
+    Type mType;
+    CompactTable mTable;
+    uint32_t mNumChunks;
+
+    Vector<Checkpoint> mCheckpoints;
+
+    // The first run that has not been scanned yet.
+    uint32_t mScanEntry;
+    uint32_t mScanSample;
+    uint64_t mScanTime;
+
+    status_t readRun(
+            uint32_t entry, uint32_t firstSample, uint64_t firstTime,
+            RunCursor *cursor);
+
+    status_t nextRun(RunCursor *cursor);
+
+    bool scanned(uint32_t sampleIndex, uint64_t time, bool byTime) const;
+    status_t extendCheckpoints(uint32_t sampleIndex, uint64_t time, bool byTime);
+    status_t seekToCheckpoint(
+            uint32_t sampleIndex, uint64_t time, bool byTime,
+            RunCursor *cursor);
+
+    DISALLOW_EVIL_CONSTRUCTORS(RunTable);
+};
+
+SampleTable::RunTable::RunTable(
+        Type type, const sp<DataSource> &source,
+        off64_t offset, uint32_t numEntries)
+    : mType(type),
+      mTable(source, offset, type == SAMPLE_TO_CHUNK ? 12 : 8, numEntries),
+      mNumChunks(0),
+      mScanEntry(0),
+      mScanSample(0),
+      mScanTime(0) {
+}
+
+status_t SampleTable::RunTable::readRun(
+        uint32_t entry, uint32_t firstSample, uint64_t firstTime,
+        RunCursor *cursor) {
+    cursor->mValid = false;
+
+    const uint8_t *data = mTable.entryAt(entry);
+    if (data == NULL) {
+        return entry < mTable.numEntries() ? ERROR_IO : ERROR_OUT_OF_RANGE;
+    }
+
+    uint64_t numSamples;
+    if (mType == SAMPLE_TO_CHUNK) {
+        uint32_t firstChunk = U32_AT(data);
+        uint32_t samplesPerChunk = U32_AT(&data[4]);
+        uint32_t descIndex = U32_AT(&data[8]);
+
+        uint32_t nextFirstChunk = mNumChunks + 1;
+        if (entry + 1 < mTable.numEntries()) {
+            data = mTable.entryAt(entry + 1);
+            if (data == NULL) {
+                return ERROR_IO;
+            }
+            nextFirstChunk = U32_AT(data);
+        }
+
+        if (firstChunk == 0 || nextFirstChunk < firstChunk) {
+            ALOGE("sample to chunk entry %d is invalid", entry);
+            return ERROR_MALFORMED;
+        }
+
+        numSamples = (uint64_t)(nextFirstChunk - firstChunk) * samplesPerChunk;
+
+        cursor->mValue = samplesPerChunk;
+        cursor->mFirstChunk = firstChunk - 1;
+        cursor->mDescIndex = descIndex;
+    } else {
+        numSamples = U32_AT(data);
+        cursor->mValue = U32_AT(&data[4]);
+    }
+
+    if ((uint64_t)firstSample + numSamples > 0xffffffffull) {
+        numSamples = 0xffffffffull - firstSample;
+    }
+
+    cursor->mEntry = entry;
+    cursor->mFirstSample = firstSample;
+    cursor->mNumSamples = numSamples;
+    cursor->mFirstTime = firstTime;
+    cursor->mValid = true;
+
+    return OK;
+}
+
+status_t SampleTable::RunTable::nextRun(RunCursor *cursor) {
+    uint64_t nextTime = cursor->mFirstTime;
+    if (mType == TIME_TO_SAMPLE) {
+        nextTime += (uint64_t)cursor->mNumSamples * cursor->mValue;
+    }
+
+    return readRun(
+            cursor->mEntry + 1, cursor->mFirstSample + cursor->mNumSamples,
+            nextTime, cursor);
+}
+
+bool SampleTable::RunTable::scanned(
+        uint32_t sampleIndex, uint64_t time, bool byTime) const {
+    if (mScanEntry >= mTable.numEntries()) {
+        return true;
+    }
+
+    return byTime ? mScanTime > time : mScanSample > sampleIndex;
+}
+
+status_t SampleTable::RunTable::extendCheckpoints(
+        uint32_t sampleIndex, uint64_t time, bool byTime) {
+    while (!scanned(sampleIndex, time, byTime)) {
+        if ((mScanEntry % kCheckpointInterval) == 0) {
+            Checkpoint checkpoint;
+            checkpoint.mFirstSample = mScanSample;
+            checkpoint.mFirstTime = mScanTime;
+            mCheckpoints.push(checkpoint);
+        }
+
+        RunCursor run;
+        status_t err = readRun(mScanEntry, mScanSample, mScanTime, &run);
+        if (err != OK) {
+            return err;
+        }
+
+        ++mScanEntry;
+        mScanSample = run.mFirstSample + run.mNumSamples;
+        if (mType == TIME_TO_SAMPLE) {
+            mScanTime += (uint64_t)run.mNumSamples * run.mValue;
+        }
+    }
+
+    return OK;
+}
+
+status_t SampleTable::RunTable::seekToCheckpoint(
+        uint32_t sampleIndex, uint64_t time, bool byTime, RunCursor *cursor) {
+    status_t err = extendCheckpoints(sampleIndex, time, byTime);
+    if (err != OK) {
+        return err;
+    }
+
+    if (mCheckpoints.isEmpty()) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    // The last checkpoint at or before the position we're looking for.
+    size_t left = 0;
+    size_t right = mCheckpoints.size();
+    while (right - left > 1) {
+        size_t center = left + (right - left) / 2;
+        const Checkpoint &checkpoint = mCheckpoints.itemAt(center);
+
+        bool before = byTime
+            ? checkpoint.mFirstTime <= time
+            : checkpoint.mFirstSample <= sampleIndex;
+
+        if (before) {
+            left = center;
+        } else {
+            right = center;
+        }
+    }
+
+    const Checkpoint &checkpoint = mCheckpoints.itemAt(left);
+    return readRun(
+            left * kCheckpointInterval,
+            checkpoint.mFirstSample, checkpoint.mFirstTime, cursor);
+}
+
+status_t SampleTable::RunTable::findSample(
+        uint32_t sampleIndex, RunCursor *cursor) {
+    if (cursor->contains(sampleIndex)) {
+        return OK;
+    }
+
+    status_t err;
+
+    if (cursor->mValid && sampleIndex >= cursor->mFirstSample) {
+        for (size_t i = 0; i < kMaxForwardRuns
+                && cursor->mEntry + 1 < mTable.numEntries(); ++i) {
+            if ((err = nextRun(cursor)) != OK) {
+                return err;
+            }
+
+            if (cursor->contains(sampleIndex)) {
+                return OK;
+            }
+        }
+    }
+
+    if ((err = seekToCheckpoint(sampleIndex, 0, false, cursor)) != OK) {
+        return err;
+    }
+
+    while (!cursor->contains(sampleIndex)) {
+        if (cursor->mEntry + 1 >= mTable.numEntries()) {
+            cursor->mValid = false;
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        if ((err = nextRun(cursor)) != OK) {
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+status_t SampleTable::RunTable::findTime(uint64_t time, RunCursor *cursor) {
+    CHECK_EQ((int)mType, (int)TIME_TO_SAMPLE);
+
+    status_t err = seekToCheckpoint(0, time, true, cursor);
+    if (err != OK) {
+        return err;
+    }
+
+    for (;;) {
+        uint64_t duration = (uint64_t)cursor->mNumSamples * cursor->mValue;
+        if (time >= cursor->mFirstTime && time - cursor->mFirstTime < duration) {
+            return OK;
+        }
+
+        if (cursor->mEntry + 1 >= mTable.numEntries()) {
+            cursor->mValid = false;
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        if ((err = nextRun(cursor)) != OK) {
+            return err;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SampleTable::SampleTable(const sp<DataSource> &source)
+    : mDataSource(source),
+      mChunkOffsetOffset(-1),
+      mChunkOffsetType(0),
+      mNumChunkOffsets(0),
+      mChunkOffsets(NULL),
+      mSampleToChunkOffset(-1),
+      mNumSampleToChunkEntries(0),
+      mSampleToChunk(NULL),
+      mSampleSizeOffset(-1),
+      mSampleSizeFieldSize(0),
+      mDefaultSampleSize(0),
+      mNumSampleSizes(0),
+      mSampleSizes(NULL),
+      mTimeToSampleCount(0),
+      mTimeToSample(NULL),
+      mCompositionTimeDelta(NULL),
+      mSyncSampleOffset(-1),
+      mNumSyncSamples(0),
+      mSyncSamples(NULL),
+      mLastSyncSampleEntry(0),
+      mHaveMaxSampleSize(false),
+      mMaxSampleSize(0) {
+    mSampleIterator = new SampleIterator(this);
+}
+
+SampleTable::~SampleTable() {
+    delete mSampleIterator;
+    mSampleIterator = NULL;
+
+    delete mSyncSamples;
+    mSyncSamples = NULL;
+
+    delete mCompositionTimeDelta;
+    mCompositionTimeDelta = NULL;
+
+    delete mTimeToSample;
+    mTimeToSample = NULL;
+
+    delete mSampleSizes;
+    mSampleSizes = NULL;
+
+    delete mSampleToChunk;
+    mSampleToChunk = NULL;
+
+    delete mChunkOffsets;
+    mChunkOffsets = NULL;
+}
+
+bool SampleTable::isValid() const {
+    return mChunkOffsetOffset >= 0
+        && mSampleToChunkOffset >= 0
+        && mSampleSizeOffset >= 0
+        && mTimeToSample != NULL;
+}
+
+status_t SampleTable::setChunkOffsetParams(
+        uint32_t type, off64_t data_offset, size_t data_size) {
+    if (mChunkOffsetOffset >= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    CHECK(type == kChunkOffsetType32 || type == kChunkOffsetType64);
+
+    mChunkOffsetOffset = data_offset;
+    mChunkOffsetType = type;
+
+    if (data_size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t header[8];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    if (U32_AT(header) != 0) {
+        // Expected version = 0, flags = 0.
+        return ERROR_MALFORMED;
+    }
+
+    mNumChunkOffsets = U32_AT(&header[4]);
+
+    size_t entrySize = (mChunkOffsetType == kChunkOffsetType32) ? 4 : 8;
+    if (data_size < 8 + (uint64_t)mNumChunkOffsets * entrySize) {
+        return ERROR_MALFORMED;
+    }
+
+    mChunkOffsets = new CompactTable(
+            mDataSource, data_offset + 8, entrySize, mNumChunkOffsets);
+
+    if (mSampleToChunk != NULL) {
+        mSampleToChunk->setNumChunks(mNumChunkOffsets);
+    }
+
+    return OK;
+}
+
+status_t SampleTable::setSampleToChunkParams(
+        off64_t data_offset, size_t data_size) {
+    if (mSampleToChunkOffset >= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    mSampleToChunkOffset = data_offset;
+
+    if (data_size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t header[8];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    if (U32_AT(header) != 0) {
+        // Expected version = 0, flags = 0.
+        return ERROR_MALFORMED;
+    }
+
+    mNumSampleToChunkEntries = U32_AT(&header[4]);
+
+    if (data_size < 8 + (uint64_t)mNumSampleToChunkEntries * 12) {
+        return ERROR_MALFORMED;
+    }
+
+    if (mNumSampleToChunkEntries > 0) {
+        uint8_t first[4];
+        if (mDataSource->readAt(data_offset + 8, first, 4) < 4) {
+            return ERROR_IO;
+        }
+
+        // The first chunk must be chunk #1.
+        if (U32_AT(first) != 1) {
+            return ERROR_MALFORMED;
+        }
+    }
+
+    mSampleToChunk = new RunTable(
+            RunTable::SAMPLE_TO_CHUNK, mDataSource,
+            data_offset + 8, mNumSampleToChunkEntries);
+
+    mSampleToChunk->setNumChunks(mNumChunkOffsets);
+
+    return OK;
+}
+
+status_t SampleTable::setSampleSizeParams(
+        uint32_t type, off64_t data_offset, size_t data_size) {
+    if (mSampleSizeOffset >= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    CHECK(type == kSampleSizeType32 || type == kSampleSizeTypeCompact);
+
+    mSampleSizeOffset = data_offset;
+
+    if (data_size < 12) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t header[12];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    if (U32_AT(header) != 0) {
+        // Expected version = 0, flags = 0.
+        return ERROR_MALFORMED;
+    }
+
+    mDefaultSampleSize = U32_AT(&header[4]);
+    mNumSampleSizes = U32_AT(&header[8]);
+
+    if (type == kSampleSizeType32) {
+        mSampleSizeFieldSize = 32;
+
+        if (mDefaultSampleSize != 0) {
+            return OK;
+        }
+
+        if (data_size < 12 + (uint64_t)mNumSampleSizes * 4) {
+            return ERROR_MALFORMED;
+        }
+    } else {
+        if ((mDefaultSampleSize & 0xffffff00) != 0) {
+            // The high 24 bits are reserved and must be 0.
+            return ERROR_MALFORMED;
+        }
+
+        mSampleSizeFieldSize = mDefaultSampleSize & 0xff;
+        mDefaultSampleSize = 0;
+
+        if (mSampleSizeFieldSize != 4 && mSampleSizeFieldSize != 8
+            && mSampleSizeFieldSize != 16) {
+            return ERROR_MALFORMED;
+        }
+
+        if (data_size < 12
+                + ((uint64_t)mNumSampleSizes * mSampleSizeFieldSize + 4) / 8) {
+            return ERROR_MALFORMED;
+        }
+    }
+
+    if (mSampleSizeFieldSize == 4) {
+        // Two samples share a byte.
+        mSampleSizes = new CompactTable(
+                mDataSource, data_offset + 12, 1, (mNumSampleSizes + 1) / 2);
+    } else {
+        mSampleSizes = new CompactTable(
+                mDataSource, data_offset + 12,
+                mSampleSizeFieldSize / 8, mNumSampleSizes);
+    }
+
+    return OK;
+}
+
+status_t SampleTable::setTimeToSampleParams(
+        off64_t data_offset, size_t data_size) {
+    if (mTimeToSample != NULL || data_size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t header[8];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    if (U32_AT(header) != 0) {
+        // Expected version = 0, flags = 0.
+        return ERROR_MALFORMED;
+    }
+
+    mTimeToSampleCount = U32_AT(&header[4]);
+
+    if (data_size < 8 + (uint64_t)mTimeToSampleCount * 8) {
+        return ERROR_MALFORMED;
+    }
+
+    mTimeToSample = new RunTable(
+            RunTable::TIME_TO_SAMPLE, mDataSource,
+            data_offset + 8, mTimeToSampleCount);
+
+    return OK;
+}
+
+status_t SampleTable::setCompositionTimeToSampleParams(
+        off64_t data_offset, size_t data_size) {
+    ALOGV("There are reordered frames present.");
+
+    if (mCompositionTimeDelta != NULL || data_size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    uint8_t header[8];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header))
+            < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    // Version 1 only differs in the offsets being signed, which is how
+    // they are interpreted regardless.
+    if ((U32_AT(header) & 0xfeffffff) != 0) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t numEntries = U32_AT(&header[4]);
+
+    if (data_size < 8 + (uint64_t)numEntries * 8) {
+        return ERROR_MALFORMED;
+    }
+
+    mCompositionTimeDelta = new RunTable(
+            RunTable::COMPOSITION_OFFSET, mDataSource,
+            data_offset + 8, numEntries);
+
+    return OK;
+}
+
+status_t SampleTable::setSyncSampleParams(off64_t data_offset, size_t data_size) {
+    if (mSyncSampleOffset >= 0 || data_size < 8) {
+        return ERROR_MALFORMED;
+    }
+
+    mSyncSampleOffset = data_offset;
+
+    uint8_t header[8];
+    if (mDataSource->readAt(
+                data_offset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+        return ERROR_IO;
+    }
+
+    if (U32_AT(header) != 0) {
+        // Expected version = 0, flags = 0.
+        return ERROR_MALFORMED;
+    }
+
+    mNumSyncSamples = U32_AT(&header[4]);
+
+    if (mNumSyncSamples < 2) {
+        ALOGV("Table of sync samples is empty or has only a single entry!");
+    }
+
+    if (data_size < 8 + (uint64_t)mNumSyncSamples * 4) {
+        return ERROR_MALFORMED;
+    }
+
+    mSyncSamples = new CompactTable(
+            mDataSource, data_offset + 8, 4, mNumSyncSamples);
+
+    return OK;
+}
+
+void SampleTable::setPCMFrameSize(size_t frameSize) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mDefaultSampleSize == 1 && frameSize > 1) {
+        mDefaultSampleSize = frameSize;
+        mHaveMaxSampleSize = false;
+    }
+}
+
+uint32_t SampleTable::countChunkOffsets() const {
+    return mNumChunkOffsets;
+}
+
+uint32_t SampleTable::countSamples() const {
+    return mNumSampleSizes;
+}
+
+status_t SampleTable::getChunkOffset_l(uint32_t chunk_index, off64_t *offset) {
+    if (mChunkOffsets == NULL) {
+        return ERROR_MALFORMED;
+    }
+
+    if (chunk_index >= mNumChunkOffsets) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    const uint8_t *data = mChunkOffsets->entryAt(chunk_index);
+    if (data == NULL) {
+        return ERROR_IO;
+    }
+
+    if (mChunkOffsetType == kChunkOffsetType32) {
+        *offset = U32_AT(data);
+    } else {
+        *offset = U64_AT(data);
+    }
+
+    return OK;
+}
+
+status_t SampleTable::getSampleSize_l(
+        uint32_t sample_index, size_t *sample_size) {
+    if (sample_index >= mNumSampleSizes) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    if (mDefaultSampleSize > 0) {
+        *sample_size = mDefaultSampleSize;
+        return OK;
+    }
+
+    const uint8_t *data;
+    if (mSampleSizeFieldSize == 4) {
+        data = mSampleSizes->entryAt(sample_index / 2);
+    } else {
+        data = mSampleSizes->entryAt(sample_index);
+    }
+
+    if (data == NULL) {
+        return ERROR_IO;
+    }
+
+    switch (mSampleSizeFieldSize) {
+        case 32:
+            *sample_size = U32_AT(data);
+            break;
+
+        case 16:
+            *sample_size = U16_AT(data);
+            break;
+
+        case 8:
+            *sample_size = data[0];
+            break;
+
+        default:
+        {
+            CHECK_EQ(mSampleSizeFieldSize, 4u);
+
+            *sample_size = (sample_index & 1) ? (data[0] & 0x0f) : (data[0] >> 4);
+            break;
+        }
+    }
+
+    return OK;
+}
+
+// static
+status_t SampleTable::findRun_l(
+        RunTable *table, uint32_t sample_index, RunCursor *run) {
+    return table->findSample(sample_index, run);
+}
+
+status_t SampleTable::getSampleTime_l(uint32_t sample_index, uint64_t *time) {
+    if (mTimeToSample == NULL) {
+        return ERROR_MALFORMED;
+    }
+
+    RunCursor run;
+    status_t err = mTimeToSample->findSample(sample_index, &run);
+    if (err != OK) {
+        return err;
+    }
+
+    *time = run.mFirstTime
+        + (uint64_t)(sample_index - run.mFirstSample) * run.mValue;
+
+    return OK;
+}
+
+status_t SampleTable::lowerBoundSyncSample_l(
+        uint32_t sample_index, uint32_t *entry) {
+    // Sync sample numbers are 1-based, so this is the first entry that is
+    // > sample_index.
+
+    // Sequential access mostly asks about the last entry found or the
+    // one following it.
+    for (uint32_t i = mLastSyncSampleEntry;
+            i <= mLastSyncSampleEntry + 1 && i <= mNumSyncSamples; ++i) {
+        bool lowerOK = true;
+        if (i > 0) {
+            const uint8_t *data = mSyncSamples->entryAt(i - 1);
+            if (data == NULL) {
+                return ERROR_IO;
+            }
+            lowerOK = U32_AT(data) <= sample_index;
+        }
+
+        bool upperOK = true;
+        if (i < mNumSyncSamples) {
+            const uint8_t *data = mSyncSamples->entryAt(i);
+            if (data == NULL) {
+                return ERROR_IO;
+            }
+            upperOK = U32_AT(data) > sample_index;
+        }
+
+        if (lowerOK && upperOK) {
+            mLastSyncSampleEntry = i;
+            *entry = i;
+            return OK;
+        }
+    }
+
+    uint32_t left = 0;
+    uint32_t right = mNumSyncSamples;
+    while (left < right) {
+        uint32_t center = left + (right - left) / 2;
+
+        const uint8_t *data = mSyncSamples->entryAt(center);
+        if (data == NULL) {
+            return ERROR_IO;
+        }
+
+        if (U32_AT(data) > sample_index) {
+            right = center;
+        } else {
+            left = center + 1;
+        }
+    }
+
+    mLastSyncSampleEntry = left;
+    *entry = left;
+
+    return OK;
+}
+
+status_t SampleTable::syncSampleAt_l(uint32_t entry, uint32_t *sample_index) {
+    const uint8_t *data = mSyncSamples->entryAt(entry);
+    if (data == NULL) {
+        return ERROR_IO;
+    }
+
+    uint32_t x = U32_AT(data);
+    *sample_index = (x > 0) ? x - 1 : 0;
+
+    return OK;
+}
+
+status_t SampleTable::isSyncSample_l(uint32_t sample_index, bool *isSync) {
+    if (mSyncSampleOffset < 0) {
+        // All samples are sync-samples.
+        *isSync = true;
+        return OK;
+    }
+
+    uint32_t entry;
+    status_t err = lowerBoundSyncSample_l(sample_index, &entry);
+    if (err != OK) {
+        return err;
+    }
+
+    *isSync = false;
+    if (entry < mNumSyncSamples) {
+        uint32_t x;
+        if ((err = syncSampleAt_l(entry, &x)) != OK) {
+            return err;
+        }
+
+        *isSync = (x == sample_index);
+    }
+
+    return OK;
+}
+
+status_t SampleTable::scanMaxSampleSize_l(size_t *max_size) {
+    if (mDefaultSampleSize > 0) {
+        *max_size = mDefaultSampleSize;
+        return OK;
+    }
+
+    // Bypasses the page cache, the whole table is read exactly once.
+    static const size_t kBlockSize = 65536;
+
+    size_t bytesPerTable;
+    if (mSampleSizeFieldSize == 4) {
+        bytesPerTable = (mNumSampleSizes + 1) / 2;
+    } else {
+        bytesPerTable = (size_t)mNumSampleSizes * (mSampleSizeFieldSize / 8);
+    }
+
+    uint8_t *block = new uint8_t[kBlockSize];
+
+    size_t maxSize = 0;
+    size_t done = 0;
+    while (done < bytesPerTable) {
+        size_t n = bytesPerTable - done;
+        if (n > kBlockSize) {
+            n = kBlockSize;
+        }
+
+        if (mDataSource->readAt(
+                    mSampleSizeOffset + 12 + done, block, n) < (ssize_t)n) {
+            delete[] block;
+            block = NULL;
+
+            return ERROR_IO;
+        }
+
+        for (size_t i = 0; i < n;) {
+            size_t size;
+            switch (mSampleSizeFieldSize) {
+                case 32:
+                    size = U32_AT(&block[i]);
+                    i += 4;
+                    break;
+
+                case 16:
+                    size = U16_AT(&block[i]);
+                    i += 2;
+                    break;
+
+                case 8:
+                    size = block[i];
+                    i += 1;
+                    break;
+
+                default:
+                {
+                    uint8_t hi = block[i] >> 4;
+                    uint8_t lo = block[i] & 0x0f;
+
+                    // The last sample of an odd count leaves the low
+                    // nibble unused.
+                    bool odd = (done + i) * 2 + 1 >= mNumSampleSizes;
+                    size = (hi > lo || odd) ? hi : lo;
+                    i += 1;
+                    break;
+                }
+            }
+
+            if (size > maxSize) {
+                maxSize = size;
+            }
+        }
+
+        done += n;
+    }
+
+    delete[] block;
+    block = NULL;
+
+    *max_size = maxSize;
+
+    return OK;
+}
+
+status_t SampleTable::getMaxSampleSize(size_t *max_size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (!mHaveMaxSampleSize) {
+        status_t err = scanMaxSampleSize_l(&mMaxSampleSize);
+        if (err != OK) {
+            return err;
+        }
+
+        mHaveMaxSampleSize = true;
+    }
+
+    *max_size = mMaxSampleSize;
+
+    return OK;
+}
+
+status_t SampleTable::findSampleAtTime(
+        uint64_t req_time, uint32_t *sample_index, uint32_t flags) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mTimeToSample == NULL || mNumSampleSizes == 0) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    RunCursor run;
+    status_t err = mTimeToSample->findTime(req_time, &run);
+
+    if (err == ERROR_OUT_OF_RANGE) {
+        // Past the end of the track.
+        if (flags == kFlagAfter) {
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        *sample_index = mNumSampleSizes - 1;
+        return OK;
+    } else if (err != OK) {
+        return err;
+    }
+
+    // A run that contains a time can't have a zero sample delta.
+    uint64_t delta = req_time - run.mFirstTime;
+    uint32_t index = run.mFirstSample + delta / run.mValue;
+    uint64_t remainder = delta % run.mValue;
+
+    switch (flags) {
+        case kFlagBefore:
+            break;
+
+        case kFlagAfter:
+            if (remainder > 0) {
+                ++index;
+            }
+            break;
+
+        default:
+        {
+            CHECK(flags == kFlagClosest);
+
+            if (remainder > run.mValue - remainder) {
+                ++index;
+            }
+            break;
+        }
+    }
+
+    if (index >= mNumSampleSizes) {
+        if (flags == kFlagAfter) {
+            return ERROR_OUT_OF_RANGE;
+        }
+
+        index = mNumSampleSizes - 1;
+    }
+
+    *sample_index = index;
+
+    return OK;
+}
+
+status_t SampleTable::findSyncSampleNear(
+        uint32_t start_sample_index, uint32_t *sample_index, uint32_t flags) {
+    Mutex::Autolock autoLock(mLock);
+
+    *sample_index = 0;
+
+    if (mSyncSampleOffset < 0) {
+        // All samples are sync-samples.
+        *sample_index = start_sample_index;
+        return OK;
+    }
+
+    if (mNumSyncSamples == 0) {
+        *sample_index = 0;
+        return OK;
+    }
+
+    uint32_t entry;
+    status_t err = lowerBoundSyncSample_l(start_sample_index, &entry);
+    if (err != OK) {
+        return err;
+    }
+
+    // "entry" is the first sync sample at or after the start sample,
+    // "entry - 1" the last one before it.
+    uint32_t after = 0;
+    bool haveAfter = entry < mNumSyncSamples;
+    if (haveAfter && (err = syncSampleAt_l(entry, &after)) != OK) {
+        return err;
+    }
+
+    if (haveAfter && after == start_sample_index) {
+        *sample_index = after;
+        return OK;
+    }
+
+    uint32_t before = 0;
+    bool haveBefore = entry > 0;
+    if (haveBefore && (err = syncSampleAt_l(entry - 1, &before)) != OK) {
+        return err;
+    }
+
+    switch (flags) {
+        case kFlagBefore:
+        {
+            *sample_index = haveBefore ? before : after;
+            break;
+        }
+
+        case kFlagAfter:
+        {
+            if (!haveAfter) {
+                ALOGE("tried to find a sync frame after the last one: %d",
+                     entry);
+                return ERROR_OUT_OF_RANGE;
+            }
+
+            *sample_index = after;
+            break;
+        }
+
+        default:
+        {
+            CHECK(flags == kFlagClosest);
+
+            if (!haveBefore || !haveAfter) {
+                *sample_index = haveBefore ? before : after;
+                break;
+            }
+
+            uint64_t startTime, beforeTime, afterTime;
+            if ((err = getSampleTime_l(start_sample_index, &startTime)) != OK
+                    || (err = getSampleTime_l(before, &beforeTime)) != OK
+                    || (err = getSampleTime_l(after, &afterTime)) != OK) {
+                return err;
+            }
+
+            *sample_index = (startTime - beforeTime <= afterTime - startTime)
+                ? before : after;
+            break;
+        }
+    }
+
+    return OK;
+}
+
+status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mSyncSampleOffset < 0) {
+        // All samples are sync-samples.
+        *sample_index = 0;
+        return OK;
+    }
+
+    uint32_t bestSampleIndex = 0;
+    size_t maxSampleSize = 0;
+
+    static const size_t kMaxNumSyncSamplesToScan = 20;
+
+    // Consider the first kMaxNumSyncSamplesToScan sync samples and
+    // pick the one with the largest (compressed) size as the thumbnail.
+
+    size_t numSamplesToScan = mNumSyncSamples;
+    if (numSamplesToScan > kMaxNumSyncSamplesToScan) {
+        numSamplesToScan = kMaxNumSyncSamplesToScan;
+    }
+
+    for (size_t i = 0; i < numSamplesToScan; ++i) {
+        uint32_t x;
+        status_t err = syncSampleAt_l(i, &x);
+        if (err != OK) {
+            return err;
+        }
+
+        // Now x is a sample index.
+        size_t sampleSize;
+        err = getSampleSize_l(x, &sampleSize);
+        if (err != OK) {
+            return err;
+        }
+
+        if (i == 0 || sampleSize > maxSampleSize) {
+            bestSampleIndex = x;
+            maxSampleSize = sampleSize;
+        }
+    }
+
+    *sample_index = bestSampleIndex;
+
+    return OK;
+}
+
+status_t SampleTable::getMetaDataForSample(
+        uint32_t sampleIndex,
+        off64_t *offset,
+        size_t *size,
+        uint64_t *compositionTime,
+        bool *isSyncSample) {
+    Mutex::Autolock autoLock(mLock);
+
+    status_t err;
+    if ((err = mSampleIterator->seekTo(sampleIndex)) != OK) {
+        return err;
+    }
+
+    if (offset) {
+        *offset = mSampleIterator->getSampleOffset();
+    }
+
+    if (size) {
+        *size = mSampleIterator->getSampleSize();
+    }
+
+    if (compositionTime) {
+        *compositionTime = mSampleIterator->getCompositionTime();
+    }
+
+    if (isSyncSample) {
+        if ((err = isSyncSample_l(sampleIndex, isSyncSample)) != OK) {
+            return err;
+        }
+    }
+
+    return OK;
+}
+
+status_t SampleTable::countContiguousSamples(
+        uint32_t sampleIndex, uint32_t maxSamples, uint32_t *count) {
+    Mutex::Autolock autoLock(mLock);
+
+    status_t err;
+    if ((err = mSampleIterator->seekTo(sampleIndex)) != OK) {
+        return err;
+    }
+
+    uint32_t n = mSampleIterator->getSamplesLeftInChunk() + 1;
+    *count = (n < maxSamples) ? n : maxSamples;
+
+    return OK;
+}
+
+}  // namespace android
@@ -0,0 +1,837 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MP4Generator"
+#include <utils/Log.h>
+
+#include "MP4Generator.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/MPEG4Writer.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace android {
+
+static const int32_t kWidth = 176;
+static const int32_t kHeight = 144;
+
+// SPS/PPS for 176x144 baseline, NAL lengths of 4 bytes.
+static const uint8_t kAVCC[] = {
+    0x01, 0x42, 0xc0, 0x0b, 0xff, 0xe1,
+    0x00, 0x0b, 0x67, 0x42, 0xc0, 0x0b, 0xda, 0x0b, 0x13, 0x42,
+    0x00, 0x00, 0x03,
+    0x01, 0x00, 0x04, 0x68, 0xce, 0x3c, 0x80,
+};
+
+// AAC LC, 44.1kHz, stereo.
+static const uint8_t kAACConfig[] = { 0x12, 0x10 };
+
+static const int64_t kAACFrameDurationUs = 1024 * 1000000ll / 44100;
+static const int64_t kAMRFrameDurationUs = 20000;
+
+MP4Generator::Params::Params()
+    : mDurationUs(10000000ll),
+      mHasVideo(true),
+      mFrameDurationUs(40000),
+      mFrameJitterUs(0),
+      mSyncInterval(25),
+      mFrameSize(2000),
+      mAudioType(AUDIO_AAC) {
+}
+
+// static
+int64_t MP4Generator::VideoFrameTimeUs(const Params &params, uint32_t index) {
+    // Pairs of frames are jittered in opposite directions, so every other
+    // frame lands on the nominal grid.
+    int64_t timeUs = index * params.mFrameDurationUs;
+    if (index & 1) {
+        timeUs += params.mFrameJitterUs;
+    }
+
+    return timeUs;
+}
+
+// static
+uint32_t MP4Generator::CountVideoFrames(const Params &params) {
+    return params.mDurationUs / params.mFrameDurationUs;
+}
+
+// static
+void MP4Generator::MakeVideoFrame(
+        const Params &params, uint32_t index, Vector<uint8_t> *out) {
+    out->clear();
+
+    bool isSync = (index % params.mSyncInterval) == 0;
+
+    // Frame sizes vary so that the size table is not trivially constant.
+    size_t size = params.mFrameSize + (index * 37) % 101;
+    if (isSync) {
+        size *= 2;
+    }
+
+    out->insertAt((uint8_t)0, 0, size);
+    uint8_t *data = out->editArray();
+    data[0] = isSync ? 0x65 : 0x41;
+    data[1] = index >> 24;
+    data[2] = (index >> 16) & 0xff;
+    data[3] = (index >> 8) & 0xff;
+    data[4] = index & 0xff;
+}
+
+// static
+size_t MP4Generator::AudioFrameSize(AudioType type, uint32_t index) {
+    if (type == AUDIO_AMR_NB) {
+        // Mode 7 (12.2kbps) frames, including the frame header.
+        return 32;
+    }
+
+    return 300 + (index * 13) % 71;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct SyntheticSource : public MediaSource {
+    SyntheticSource(const MP4Generator::Params &params, bool isVideo);
+
+    virtual status_t start(MetaData *params = NULL);
+    virtual status_t stop();
+    virtual sp<MetaData> getFormat();
+
+    virtual status_t read(
+            MediaBuffer **buffer, const ReadOptions *options = NULL);
+
+protected:
+    virtual ~SyntheticSource() {}
+
+private:
+    MP4Generator::Params mParams;
+    bool mIsVideo;
+    sp<MetaData> mFormat;
+    uint32_t mNumFrames;
+    uint32_t mIndex;
+    bool mSentCodecConfig;
+    Vector<uint8_t> mFrame;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SyntheticSource);
+};
+
+SyntheticSource::SyntheticSource(
+        const MP4Generator::Params &params, bool isVideo)
+    : mParams(params),
+      mIsVideo(isVideo),
+      mFormat(new MetaData),
+      mNumFrames(0),
+      mIndex(0),
+      mSentCodecConfig(false) {
+    if (mIsVideo) {
+        mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+        mFormat->setInt32(kKeyWidth, kWidth);
+        mFormat->setInt32(kKeyHeight, kHeight);
+        mFormat->setData(kKeyAVCC, kTypeAVCC, kAVCC, sizeof(kAVCC));
+        mNumFrames = MP4Generator::CountVideoFrames(params);
+    } else if (params.mAudioType == MP4Generator::AUDIO_AMR_NB) {
+        mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AMR_NB);
+        mFormat->setInt32(kKeyChannelCount, 1);
+        mFormat->setInt32(kKeySampleRate, 8000);
+        mNumFrames = params.mDurationUs / kAMRFrameDurationUs;
+    } else {
+        mFormat->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AAC);
+        mFormat->setInt32(kKeyChannelCount, 2);
+        mFormat->setInt32(kKeySampleRate, 44100);
+        mNumFrames = params.mDurationUs / kAACFrameDurationUs;
+    }
+}
+
+status_t SyntheticSource::start(MetaData *params) {
+    mIndex = 0;
+    mSentCodecConfig = false;
+    return OK;
+}
+
+status_t SyntheticSource::stop() {
+    return OK;
+}
+
+sp<MetaData> SyntheticSource::getFormat() {
+    return mFormat;
+}
+
+status_t SyntheticSource::read(
+        MediaBuffer **buffer, const ReadOptions *options) {
+    *buffer = NULL;
+
+    if (!mIsVideo && mParams.mAudioType == MP4Generator::AUDIO_AAC
+            && !mSentCodecConfig) {
+        mSentCodecConfig = true;
+
+        MediaBuffer *config = new MediaBuffer(sizeof(kAACConfig));
+        memcpy(config->data(), kAACConfig, sizeof(kAACConfig));
+        config->meta_data()->setInt32(kKeyIsCodecConfig, 1);
+        config->meta_data()->setInt64(kKeyTime, 0);
+
+        *buffer = config;
+        return OK;
+    }
+
+    if (mIndex >= mNumFrames) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    MediaBuffer *out;
+    if (mIsVideo) {
+        MP4Generator::MakeVideoFrame(mParams, mIndex, &mFrame);
+
+        out = new MediaBuffer(mFrame.size());
+        memcpy(out->data(), mFrame.array(), mFrame.size());
+
+        int64_t timeUs = MP4Generator::VideoFrameTimeUs(mParams, mIndex);
+        out->meta_data()->setInt64(kKeyTime, timeUs);
+        out->meta_data()->setInt64(kKeyDecodingTime, timeUs);
+        if ((mIndex % mParams.mSyncInterval) == 0) {
+            out->meta_data()->setInt32(kKeyIsSyncFrame, 1);
+        }
+    } else {
+        size_t size = MP4Generator::AudioFrameSize(mParams.mAudioType, mIndex);
+
+        out = new MediaBuffer(size);
+        uint8_t *data = (uint8_t *)out->data();
+        memset(data, 0, size);
+
+        if (mParams.mAudioType == MP4Generator::AUDIO_AMR_NB) {
+            data[0] = 0x3c;
+        }
+        data[1] = mIndex >> 16;
+        data[2] = (mIndex >> 8) & 0xff;
+        data[3] = mIndex & 0xff;
+
+        int64_t frameDurationUs =
+            (mParams.mAudioType == MP4Generator::AUDIO_AMR_NB)
+                ? kAMRFrameDurationUs : kAACFrameDurationUs;
+        out->meta_data()->setInt64(kKeyTime, mIndex * frameDurationUs);
+    }
+
+    ++mIndex;
+
+    *buffer = out;
+    return OK;
+}
+
+// static
+status_t MP4Generator::Record(const char *path, const Params &params) {
+    int fd = open(path, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ALOGE("unable to create %s", path);
+        return ERROR_IO;
+    }
+
+    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+
+    if (params.mHasVideo) {
+        writer->addSource(new SyntheticSource(params, true /* isVideo */));
+    }
+
+    if (params.mAudioType != AUDIO_NONE) {
+        writer->addSource(new SyntheticSource(params, false /* isVideo */));
+    }
+
+    sp<MetaData> meta = new MetaData;
+    meta->setInt32(kKeyNotRealTime, true);
+    meta->setInt64(kKeyTime, 0);
+
+    status_t err = writer->start(meta.get());
+
+    if (err == OK) {
+        while (!writer->reachedEOS()) {
+            usleep(10000);
+        }
+
+        err = writer->stop();
+    }
+
+    writer.clear();
+    close(fd);
+
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Box level helpers, sizes are patched in by endBox().
+struct BoxWriter {
+    BoxWriter(Vector<uint8_t> *out) : mOut(out) {}
+
+    void beginBox(const char *fourcc) {
+        mBoxes.push(mOut->size());
+        writeInt32(0);
+        writeFourcc(fourcc);
+    }
+
+    void beginFullBox(const char *fourcc, uint8_t version, uint32_t flags) {
+        beginBox(fourcc);
+        writeInt32(((uint32_t)version << 24) | flags);
+    }
+
+    void endBox() {
+        size_t offset = mBoxes.itemAt(mBoxes.size() - 1);
+        mBoxes.pop();
+        patchInt32(offset, mOut->size() - offset);
+    }
+
+    void writeInt8(uint8_t x) { mOut->push(x); }
+
+    void writeInt16(uint16_t x) {
+        writeInt8(x >> 8);
+        writeInt8(x & 0xff);
+    }
+
+    void writeInt32(uint32_t x) {
+        writeInt16(x >> 16);
+        writeInt16(x & 0xffff);
+    }
+
+    void writeInt64(uint64_t x) {
+        writeInt32(x >> 32);
+        writeInt32(x & 0xffffffff);
+    }
+
+    void writeFourcc(const char *fourcc) {
+        write(fourcc, 4);
+    }
+
+    void writeZeros(size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            writeInt8(0);
+        }
+    }
+
+    void write(const void *data, size_t size) {
+        mOut->appendArray((const uint8_t *)data, size);
+    }
+
+    void patchInt32(size_t offset, uint32_t x) {
+        uint8_t *data = mOut->editArray() + offset;
+        data[0] = x >> 24;
+        data[1] = (x >> 16) & 0xff;
+        data[2] = (x >> 8) & 0xff;
+        data[3] = x & 0xff;
+    }
+
+    size_t size() const { return mOut->size(); }
+
+private:
+    Vector<uint8_t> *mOut;
+    Vector<size_t> mBoxes;
+};
+
+void writeMatrix(BoxWriter *w) {
+    static const uint32_t kIdentity[9] = {
+        0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000
+    };
+
+    for (size_t i = 0; i < 9; ++i) {
+        w->writeInt32(kIdentity[i]);
+    }
+}
+
+// Opens the boxes of a track down to its 'stbl'.
+void beginTrack(
+        BoxWriter *w, uint32_t trackID, bool isVideo, uint32_t timescale) {
+    w->beginBox("trak");
+
+    w->beginFullBox("tkhd", 0, 7);
+    w->writeInt32(0);          // creation time
+    w->writeInt32(0);          // modification time
+    w->writeInt32(trackID);
+    w->writeInt32(0);          // reserved
+    w->writeInt32(0);          // duration, unknown
+    w->writeZeros(8);          // reserved
+    w->writeInt16(0);          // layer
+    w->writeInt16(0);          // alternate group
+    w->writeInt16(isVideo ? 0 : 0x100);  // volume
+    w->writeInt16(0);          // reserved
+    writeMatrix(w);
+    w->writeInt32(isVideo ? kWidth << 16 : 0);
+    w->writeInt32(isVideo ? kHeight << 16 : 0);
+    w->endBox();
+
+    w->beginBox("mdia");
+
+    w->beginFullBox("mdhd", 0, 0);
+    w->writeInt32(0);
+    w->writeInt32(0);
+    w->writeInt32(timescale);
+    w->writeInt32(0);
+    w->writeInt16(0x55c4);     // "und"
+    w->writeInt16(0);
+    w->endBox();
+
+    w->beginFullBox("hdlr", 0, 0);
+    w->writeInt32(0);
+    w->writeFourcc(isVideo ? "vide" : "soun");
+    w->writeZeros(12);
+    w->writeInt8(0);           // empty name
+    w->endBox();
+
+    w->beginBox("minf");
+    w->beginBox("stbl");
+}
+
+void endTrack(BoxWriter *w) {
+    w->endBox();  // stbl
+    w->endBox();  // minf
+    w->endBox();  // mdia
+    w->endBox();  // trak
+}
+
+void writeAVCSampleEntry(BoxWriter *w) {
+    w->beginBox("avc1");
+    w->writeZeros(6);
+    w->writeInt16(1);      // data reference index
+    w->writeZeros(16);
+    w->writeInt16(kWidth);
+    w->writeInt16(kHeight);
+    w->writeInt32(0x480000);
+    w->writeInt32(0x480000);
+    w->writeInt32(0);
+    w->writeInt16(1);      // frame count
+    w->writeZeros(32);     // compressor name
+    w->writeInt16(0x18);   // depth
+    w->writeInt16(0xffff);
+
+    w->beginBox("avcC");
+    w->write(kAVCC, sizeof(kAVCC));
+    w->endBox();
+
+    w->endBox();
+}
+
+void writeTrack(
+        BoxWriter *w, uint32_t trackID, bool isVideo, uint32_t timescale) {
+    beginTrack(w, trackID, isVideo, timescale);
+
+    w->beginFullBox("stsd", 0, 0);
+    w->writeInt32(1);
+    if (isVideo) {
+        writeAVCSampleEntry(w);
+    } else {
+        w->beginBox("mp4a");
+        w->writeZeros(6);
+        w->writeInt16(1);      // data reference index
+        w->writeZeros(8);
+        w->writeInt16(2);      // channels
+        w->writeInt16(16);     // sample size
+        w->writeInt32(0);
+        w->writeInt32(44100 << 16);
+
+        w->beginFullBox("esds", 0, 0);
+        w->writeInt8(0x03);    // ES_Descriptor
+        w->writeInt8(3 + 2 + 13 + 2 + sizeof(kAACConfig) + 3);
+        w->writeInt16(0);      // ES_ID
+        w->writeInt8(0);
+        w->writeInt8(0x04);    // DecoderConfigDescriptor
+        w->writeInt8(13 + 2 + sizeof(kAACConfig));
+        w->writeInt8(0x40);    // MPEG4 audio
+        w->writeInt8(0x15);
+        w->writeZeros(3 + 4 + 4);
+        w->writeInt8(0x05);    // DecoderSpecificInfo
+        w->writeInt8(sizeof(kAACConfig));
+        w->write(kAACConfig, sizeof(kAACConfig));
+        w->writeInt8(0x06);    // SLConfigDescriptor
+        w->writeInt8(1);
+        w->writeInt8(2);
+        w->endBox();
+
+        w->endBox();
+    }
+    w->endBox();  // stsd
+
+    // All samples are described by the movie fragments.
+    w->beginFullBox("stts", 0, 0);
+    w->writeInt32(0);
+    w->endBox();
+
+    w->beginFullBox("stsc", 0, 0);
+    w->writeInt32(0);
+    w->endBox();
+
+    w->beginFullBox("stsz", 0, 0);
+    w->writeInt32(0);
+    w->writeInt32(0);
+    w->endBox();
+
+    w->beginFullBox("stco", 0, 0);
+    w->writeInt32(0);
+    w->endBox();
+
+    endTrack(w);
+}
+
+}  // namespace
+
+// static
+void MP4Generator::MakeFragmented(
+        uint32_t numFragments, uint32_t framesPerFragment,
+        bool withAudio, Vector<uint8_t> *out) {
+    static const uint32_t kVideoTimescale = 90000;
+    static const uint32_t kFrameDuration = 3600;
+
+    Params params;
+    params.mSyncInterval = framesPerFragment;
+    params.mFrameSize = 500;
+
+    out->clear();
+    BoxWriter w(out);
+
+    w.beginBox("ftyp");
+    w.writeFourcc("iso5");
+    w.writeInt32(0);
+    w.writeFourcc("iso5");
+    w.writeFourcc("dash");
+    w.endBox();
+
+    w.beginBox("moov");
+
+    w.beginFullBox("mvhd", 0, 0);
+    w.writeInt32(0);
+    w.writeInt32(0);
+    w.writeInt32(1000);        // timescale
+    w.writeInt32(0);           // duration
+    w.writeInt32(0x10000);     // rate
+    w.writeInt16(0x100);       // volume
+    w.writeZeros(10);
+    writeMatrix(&w);
+    w.writeZeros(24);
+    w.writeInt32(3);           // next track ID
+    w.endBox();
+
+    w.beginBox("mvex");
+
+    w.beginFullBox("mehd", 0, 0);
+    w.writeInt32(numFragments * framesPerFragment * 40);
+    w.endBox();
+
+    w.beginFullBox("trex", 0, 0);
+    w.writeInt32(1);
+    w.writeInt32(1);
+    w.writeInt32(kFrameDuration);
+    w.writeInt32(0);
+    w.writeInt32(0x10000);     // non-sync unless said otherwise
+    w.endBox();
+
+    if (withAudio) {
+        w.beginFullBox("trex", 0, 0);
+        w.writeInt32(2);
+        w.writeInt32(1);
+        w.writeInt32(1024);
+        w.writeInt32(0);
+        w.writeInt32(0);
+        w.endBox();
+    }
+
+    w.endBox();  // mvex
+
+    writeTrack(&w, 1, true, kVideoTimescale);
+    if (withAudio) {
+        writeTrack(&w, 2, false, 44100);
+    }
+
+    w.endBox();  // moov
+
+    Vector<uint8_t> frame;
+    Vector<uint8_t> mdat;
+    for (uint32_t f = 0; f < numFragments; ++f) {
+        size_t moofOffset = w.size();
+        mdat.clear();
+
+        w.beginBox("moof");
+
+        w.beginFullBox("mfhd", 0, 0);
+        w.writeInt32(f + 1);
+        w.endBox();
+
+        // The video track fragment, sizes only, durations and flags come
+        // from the defaults.
+        w.beginBox("traf");
+
+        w.beginFullBox("tfhd", 0, 0x020000 /* default-base-is-moof */);
+        w.writeInt32(1);
+        w.endBox();
+
+        w.beginFullBox("tfdt", 1, 0);
+        w.writeInt64((uint64_t)f * framesPerFragment * kFrameDuration);
+        w.endBox();
+
+        w.beginFullBox("trun", 0, 0x001 | 0x004 | 0x200);
+        w.writeInt32(framesPerFragment);
+        size_t videoDataOffset = w.size();
+        w.writeInt32(0);
+        w.writeInt32(0x02000000);  // sample_depends_on 2, a sync sample.
+        for (uint32_t i = 0; i < framesPerFragment; ++i) {
+            MakeVideoFrame(params, f * framesPerFragment + i, &frame);
+
+            w.writeInt32(4 + frame.size());
+
+            uint8_t length[4] = {
+                0, 0, (uint8_t)(frame.size() >> 8), (uint8_t)(frame.size() & 0xff)
+            };
+            mdat.appendArray(length, 4);
+            mdat.appendVector(frame);
+        }
+        w.endBox();
+
+        w.endBox();  // traf
+
+        size_t audioDataOffset = 0;
+        size_t videoDataSize = mdat.size();
+        if (withAudio) {
+            // Two runs, the second one continuing where the first ended.
+            w.beginBox("traf");
+
+            w.beginFullBox("tfhd", 0, 0x08);
+            w.writeInt32(2);
+            w.writeInt32(1024);
+            w.endBox();
+
+            uint32_t framesPerRun = framesPerFragment;
+            for (uint32_t run = 0; run < 2; ++run) {
+                w.beginFullBox("trun", 0, (run == 0 ? 0x001 : 0) | 0x200);
+                w.writeInt32(framesPerRun);
+                if (run == 0) {
+                    audioDataOffset = w.size();
+                    w.writeInt32(0);
+                }
+
+                for (uint32_t i = 0; i < framesPerRun; ++i) {
+                    uint32_t index = (f * 2 + run) * framesPerRun + i;
+                    size_t size = AudioFrameSize(AUDIO_AAC, index);
+                    w.writeInt32(size);
+
+                    size_t start = mdat.size();
+                    mdat.insertAt((uint8_t)0, start, size);
+                    mdat.editItemAt(start + 1) = index >> 16;
+                    mdat.editItemAt(start + 2) = (index >> 8) & 0xff;
+                    mdat.editItemAt(start + 3) = index & 0xff;
+                }
+                w.endBox();
+            }
+
+            w.endBox();  // traf
+        }
+
+        w.endBox();  // moof
+
+        size_t moofSize = w.size() - moofOffset;
+        w.patchInt32(videoDataOffset, moofSize + 8);
+        if (withAudio) {
+            w.patchInt32(audioDataOffset, moofSize + 8 + videoDataSize);
+        }
+
+        w.beginBox("mdat");
+        w.write(mdat.array(), mdat.size());
+        w.endBox();
+    }
+
+    w.beginBox("mfra");
+    w.beginFullBox("mfro", 0, 0);
+    w.writeInt32(16);
+    w.endBox();
+    w.endBox();
+}
+
+// static
+uint8_t MP4Generator::PCMByte(size_t index) {
+    return (uint8_t)(index * 37 + 11);
+}
+
+// static
+void MP4Generator::MakeQuickTimePCM(
+        const char *fourcc, uint32_t bitsPerSample, uint32_t numChannels,
+        uint32_t numFrames, bool withVideo, Vector<uint8_t> *out) {
+    static const uint32_t kSampleRate = 8000;
+    static const uint32_t kFramesPerChunk = 400;
+
+    Params params;
+    params.mFrameSize = 500;
+
+    uint32_t bytesPerFrame = numChannels * bitsPerSample / 8;
+    uint32_t numChunks = (numFrames + kFramesPerChunk - 1) / kFramesPerChunk;
+    uint32_t numVideoFrames = withVideo ? numFrames / (kSampleRate / 25) : 0;
+
+    out->clear();
+    BoxWriter w(out);
+
+    w.beginBox("ftyp");
+    w.writeFourcc("qt  ");
+    w.writeInt32(0);
+    w.writeFourcc("qt  ");
+    w.endBox();
+
+    Vector<uint32_t> videoSizes;
+    Vector<uint8_t> frame;
+    for (uint32_t i = 0; i < numVideoFrames; ++i) {
+        MakeVideoFrame(params, i, &frame);
+        videoSizes.push(4 + frame.size());
+    }
+
+    // The chunk offsets are patched in once the 'mdat' is placed.
+    size_t videoOffsetEntry = 0;
+    size_t audioOffsetEntries = 0;
+
+    w.beginBox("moov");
+
+    w.beginFullBox("mvhd", 0, 0);
+    w.writeInt32(0);
+    w.writeInt32(0);
+    w.writeInt32(1000);        // timescale
+    w.writeInt32((uint64_t)numFrames * 1000 / kSampleRate);
+    w.writeInt32(0x10000);     // rate
+    w.writeInt16(0x100);       // volume
+    w.writeZeros(10);
+    writeMatrix(&w);
+    w.writeZeros(24);
+    w.writeInt32(3);           // next track ID
+    w.endBox();
+
+    if (withVideo) {
+        beginTrack(&w, 1, true, 1000);
+
+        w.beginFullBox("stsd", 0, 0);
+        w.writeInt32(1);
+        writeAVCSampleEntry(&w);
+        w.endBox();
+
+        w.beginFullBox("stts", 0, 0);
+        w.writeInt32(1);
+        w.writeInt32(numVideoFrames);
+        w.writeInt32(40);
+        w.endBox();
+
+        // A single chunk.
+        w.beginFullBox("stsc", 0, 0);
+        w.writeInt32(1);
+        w.writeInt32(1);
+        w.writeInt32(numVideoFrames);
+        w.writeInt32(1);
+        w.endBox();
+
+        w.beginFullBox("stsz", 0, 0);
+        w.writeInt32(0);
+        w.writeInt32(numVideoFrames);
+        for (size_t i = 0; i < videoSizes.size(); ++i) {
+            w.writeInt32(videoSizes[i]);
+        }
+        w.endBox();
+
+        w.beginFullBox("stco", 0, 0);
+        w.writeInt32(1);
+        videoOffsetEntry = w.size();
+        w.writeInt32(0);
+        w.endBox();
+
+        endTrack(&w);
+    }
+
+    beginTrack(&w, 2, false, kSampleRate);
+
+    // A version 0 QuickTime sound description.
+    w.beginFullBox("stsd", 0, 0);
+    w.writeInt32(1);
+    w.beginBox(fourcc);
+    w.writeZeros(6);
+    w.writeInt16(1);           // data reference index
+    w.writeInt16(0);           // version
+    w.writeInt16(0);           // revision level
+    w.writeInt32(0);           // vendor
+    w.writeInt16(numChannels);
+    w.writeInt16(bitsPerSample);
+    w.writeInt16(0);           // compression ID
+    w.writeInt16(0);           // packet size
+    w.writeInt32(kSampleRate << 16);
+    w.endBox();
+    w.endBox();
+
+    w.beginFullBox("stts", 0, 0);
+    w.writeInt32(1);
+    w.writeInt32(numFrames);
+    w.writeInt32(1);
+    w.endBox();
+
+    // Full chunks, then the last one if it is shorter.
+    uint32_t lastChunkFrames = numFrames - (numChunks - 1) * kFramesPerChunk;
+    w.beginFullBox("stsc", 0, 0);
+    w.writeInt32(lastChunkFrames == kFramesPerChunk ? 1 : 2);
+    w.writeInt32(1);
+    w.writeInt32(kFramesPerChunk);
+    w.writeInt32(1);
+    if (lastChunkFrames != kFramesPerChunk) {
+        w.writeInt32(numChunks);
+        w.writeInt32(lastChunkFrames);
+        w.writeInt32(1);
+    }
+    w.endBox();
+
+    // QuickTime gives a sample size of 1 for uncompressed audio.
+    w.beginFullBox("stsz", 0, 0);
+    w.writeInt32(1);
+    w.writeInt32(numFrames);
+    w.endBox();
+
+    w.beginFullBox("stco", 0, 0);
+    w.writeInt32(numChunks);
+    audioOffsetEntries = w.size();
+    w.writeZeros(numChunks * 4);
+    w.endBox();
+
+    endTrack(&w);
+
+    w.endBox();  // moov
+
+    // All of the video, then all of the audio.
+    w.beginBox("mdat");
+    if (withVideo) {
+        w.patchInt32(videoOffsetEntry, w.size());
+    }
+
+    for (uint32_t i = 0; i < numVideoFrames; ++i) {
+        MakeVideoFrame(params, i, &frame);
+        w.writeInt32(frame.size());
+        w.write(frame.array(), frame.size());
+    }
+
+    size_t audioOffset = w.size();
+    for (uint32_t i = 0; i < numChunks; ++i) {
+        w.patchInt32(audioOffsetEntries + i * 4,
+                     audioOffset + i * kFramesPerChunk * bytesPerFrame);
+    }
+
+    for (size_t i = 0; i < (size_t)numFrames * bytesPerFrame; ++i) {
+        w.writeInt8(PCMByte(i));
+    }
+    w.endBox();
+}
+
+}  // namespace android
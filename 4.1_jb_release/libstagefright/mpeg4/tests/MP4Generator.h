@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MP4_GENERATOR_H_
+
+#define MP4_GENERATOR_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Produces the MP4 files the extractor tests and benchmark run on. Regular
+// files are recorded through MPEG4Writer from synthetic sources, fragmented
+// files are assembled box by box since the writer does not produce them.
+struct MP4Generator {
+    enum AudioType {
+        AUDIO_NONE,
+        AUDIO_AAC,      // 44.1kHz stereo, 1024 samples per frame.
+        AUDIO_AMR_NB,   // 8kHz mono, 20ms per frame.
+    };
+
+    struct Params {
+        Params();
+
+        int64_t mDurationUs;
+
+        bool mHasVideo;          // 176x144 AVC.
+        int64_t mFrameDurationUs;
+        // Alternates the frame duration by +-mFrameJitterUs, which gives
+        // every video sample its own 'stts' entry.
+        int64_t mFrameJitterUs;
+        uint32_t mSyncInterval;
+        size_t mFrameSize;
+
+        AudioType mAudioType;
+    };
+
+    // Records a file through MPEG4Writer.
+    static status_t Record(const char *path, const Params &params);
+
+    // The payload of video frame or audio frame "index". The first bytes
+    // carry the index so that the tests can tell samples apart.
+    static void MakeVideoFrame(
+            const Params &params, uint32_t index, Vector<uint8_t> *out);
+    static size_t AudioFrameSize(AudioType type, uint32_t index);
+
+    static int64_t VideoFrameTimeUs(const Params &params, uint32_t index);
+    static uint32_t CountVideoFrames(const Params &params);
+
+    // Assembles a fragmented file of a single AVC track (ID 1), the
+    // fragments optionally interleaved with those of an AAC track (ID 2).
+    // Every fragment holds "framesPerFragment" frames of 40ms, the first
+    // one of each fragment being a sync sample.
+    static void MakeFragmented(
+            uint32_t numFragments, uint32_t framesPerFragment,
+            bool withAudio, Vector<uint8_t> *out);
+
+    // Assembles a QuickTime movie of 8kHz uncompressed audio (track ID 2)
+    // in the sample entry "fourcc", stored in chunks of 400 frames. Byte i
+    // of the audio data is PCMByte(i). With "withVideo" an AVC track (ID 1)
+    // of 40ms frames comes first, stored in one block ahead of all of the
+    // audio the way badly interleaving muxers leave it.
+    static void MakeQuickTimePCM(
+            const char *fourcc, uint32_t bitsPerSample, uint32_t numChannels,
+            uint32_t numFrames, bool withVideo, Vector<uint8_t> *out);
+    static uint8_t PCMByte(size_t index);
+};
+
+}  // namespace android
+
+#endif  // MP4_GENERATOR_H_
@@ -0,0 +1,866 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MPEG4Extractor_test"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/MPEG4Extractor.h"
+#include "MP4Generator.h"
+
+namespace android {
+
+static const char *kTestFile = "/sdcard/mpeg4_extractor_test.mp4";
+
+struct Sample {
+    int64_t mTimeUs;
+    size_t mSize;
+    bool mIsSync;
+    uint32_t mIndex;  // As embedded by MP4Generator.
+    int64_t mTargetTimeUs;
+};
+
+// Serves a file held in memory.
+struct BufferSource : public DataSource {
+    BufferSource(const Vector<uint8_t> &data)
+        : mData(data) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset < 0 || offset >= (off64_t)mData.size()) {
+            return 0;
+        }
+
+        if (offset + size > mData.size()) {
+            size = mData.size() - offset;
+        }
+
+        memcpy(data, mData.array() + offset, size);
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mData.size();
+        return OK;
+    }
+
+private:
+    Vector<uint8_t> mData;
+
+    DISALLOW_EVIL_CONSTRUCTORS(BufferSource);
+};
+
+// Serves a file held in memory and remembers what the extractor reported
+// through updatecache() and where it last read.
+struct RecordingSource : public BufferSource {
+    RecordingSource(const Vector<uint8_t> &data)
+        : BufferSource(data),
+          mFlags(0),
+          mLowWater(-1),
+          mLastReadEnd(-1) {
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        mLastReadEnd = offset + size;
+        return BufferSource::readAt(offset, data, size);
+    }
+
+    virtual void updatecache(off64_t offset) {
+        mLowWater = offset;
+    }
+
+    virtual uint32_t flags() {
+        return mFlags;
+    }
+
+    uint32_t mFlags;
+    off64_t mLowWater;
+    off64_t mLastReadEnd;
+};
+
+// Reads the next buffer of "source" as it is.
+static bool readBuffer(
+        const sp<MediaSource> &source, Vector<uint8_t> *data,
+        int64_t *timeUs, const MediaSource::ReadOptions *options = NULL) {
+    MediaBuffer *buffer;
+    if (source->read(&buffer, options) != OK) {
+        return false;
+    }
+
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, timeUs));
+
+    data->clear();
+    data->appendArray(
+            (const uint8_t *)buffer->data() + buffer->range_offset(),
+            buffer->range_length());
+
+    buffer->release();
+    return true;
+}
+
+// The samples MPEG4Extractor hands out for the audio data of
+// MP4Generator::MakeQuickTimePCM(), starting at frame "firstFrame".
+static void expectedPCM(
+        const char *fourcc, uint32_t bitsPerSample, uint32_t numChannels,
+        uint32_t numFrames, uint32_t firstFrame, Vector<uint8_t> *out) {
+    out->clear();
+
+    size_t bytesPerFrame = numChannels * bitsPerSample / 8;
+    for (size_t i = firstFrame * bytesPerFrame;
+            i < numFrames * bytesPerFrame; ++i) {
+        uint8_t x = MP4Generator::PCMByte(i);
+        if (bitsPerSample == 8 && strcmp(fourcc, "alaw")
+                && strcmp(fourcc, "ulaw")) {
+            // Expanded to 16 bits, 'raw ' is unsigned.
+            out->push(0);
+            out->push(strcmp(fourcc, "raw ") ? x : x ^ 0x80);
+        } else if (bitsPerSample == 16 && !strcmp(fourcc, "twos")) {
+            out->push(MP4Generator::PCMByte(i ^ 1));
+        } else {
+            out->push(x);
+        }
+    }
+}
+
+static bool readSample(
+        const sp<MediaSource> &source, Sample *sample,
+        const MediaSource::ReadOptions *options = NULL,
+        bool isAVC = true, status_t *err = NULL) {
+    MediaBuffer *buffer;
+    status_t status = source->read(&buffer, options);
+
+    if (err != NULL) {
+        *err = status;
+    }
+
+    if (status != OK) {
+        return false;
+    }
+
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, &sample->mTimeUs));
+    sample->mSize = buffer->range_length();
+
+    int32_t isSync;
+    sample->mIsSync =
+        buffer->meta_data()->findInt32(kKeyIsSyncFrame, &isSync) && isSync;
+
+    if (!buffer->meta_data()->findInt64(
+                kKeyTargetTime, &sample->mTargetTimeUs)) {
+        sample->mTargetTimeUs = -1;
+    }
+
+    const uint8_t *data =
+        (const uint8_t *)buffer->data() + buffer->range_offset();
+
+    if (isAVC) {
+        // Start code, NAL header, then the index.
+        CHECK_GE(sample->mSize, 9u);
+        CHECK(!memcmp(data, "\x00\x00\x00\x01", 4));
+        sample->mIndex = U32_AT(&data[5]);
+    } else {
+        CHECK_GE(sample->mSize, 4u);
+        sample->mIndex = ((uint32_t)data[1] << 16) | U16_AT(&data[2]);
+    }
+
+    buffer->release();
+    buffer = NULL;
+
+    return true;
+}
+
+static void drainSource(
+        const sp<MediaSource> &source, Vector<Sample> *samples,
+        bool isAVC = true) {
+    samples->clear();
+
+    Sample sample;
+    status_t err;
+    while (readSample(source, &sample, NULL, isAVC, &err)) {
+        samples->push(sample);
+    }
+
+    EXPECT_EQ(ERROR_END_OF_STREAM, err);
+}
+
+static ssize_t findTrack(const sp<MediaExtractor> &extractor, const char *mime) {
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<MetaData> meta = extractor->getTrackMetaData(i);
+        const char *trackMime;
+        if (meta != NULL && meta->findCString(kKeyMIMEType, &trackMime)
+                && !strcasecmp(mime, trackMime)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+class MPEG4ExtractorTest : public ::testing::Test {
+protected:
+    virtual void TearDown() {
+        unlink(kTestFile);
+    }
+
+    sp<MediaExtractor> record(const MP4Generator::Params &params) {
+        mParams = params;
+        CHECK_EQ((status_t)OK, MP4Generator::Record(kTestFile, params));
+
+        sp<DataSource> source = new FileSource(kTestFile);
+        CHECK_EQ((status_t)OK, source->initCheck());
+
+        return new MPEG4Extractor(source);
+    }
+
+    sp<MediaSource> startTrack(
+            const sp<MediaExtractor> &extractor, const char *mime,
+            MetaData *params = NULL) {
+        ssize_t index = findTrack(extractor, mime);
+        CHECK_GE(index, 0);
+
+        sp<MediaSource> source = extractor->getTrack(index);
+        CHECK(source != NULL);
+        CHECK_EQ((status_t)OK, source->start(params));
+
+        return source;
+    }
+
+    // Checks the sample following a seek to "seekTimeUs" and that reading
+    // carries on from there.
+    void expectSeek(
+            const sp<MediaSource> &source, int64_t seekTimeUs,
+            MediaSource::ReadOptions::SeekMode mode, uint32_t expectedIndex) {
+        MediaSource::ReadOptions options;
+        options.setSeekTo(seekTimeUs, mode);
+
+        Sample sample;
+        ASSERT_TRUE(readSample(source, &sample, &options));
+        EXPECT_EQ(expectedIndex, sample.mIndex)
+            << "seek to " << seekTimeUs << " mode " << mode;
+        EXPECT_TRUE(sample.mIsSync);
+        EXPECT_EQ(MP4Generator::VideoFrameTimeUs(mParams, expectedIndex),
+                  sample.mTimeUs);
+
+        if (expectedIndex + 1 < MP4Generator::CountVideoFrames(mParams)) {
+            ASSERT_TRUE(readSample(source, &sample));
+            EXPECT_EQ(expectedIndex + 1, sample.mIndex);
+        }
+    }
+
+    MP4Generator::Params mParams;
+};
+
+TEST_F(MPEG4ExtractorTest, RecordedFileMetaData) {
+    MP4Generator::Params params;
+    sp<MediaExtractor> extractor = record(params);
+
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    const char *mime;
+    ASSERT_TRUE(extractor->getMetaData()->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(MEDIA_MIMETYPE_CONTAINER_MPEG4, mime);
+
+    ssize_t videoIndex = findTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+    ASSERT_GE(videoIndex, 0);
+    sp<MetaData> meta = extractor->getTrackMetaData(videoIndex);
+
+    int32_t width, height, maxInputSize;
+    ASSERT_TRUE(meta->findInt32(kKeyWidth, &width));
+    ASSERT_TRUE(meta->findInt32(kKeyHeight, &height));
+    EXPECT_EQ(176, width);
+    EXPECT_EQ(144, height);
+
+    // Sync frames are the largest ones.
+    ASSERT_TRUE(meta->findInt32(kKeyMaxInputSize, &maxInputSize));
+    EXPECT_GE(maxInputSize, (int32_t)(2 * (params.mFrameSize + 100) + 4));
+
+    int64_t durationUs;
+    ASSERT_TRUE(meta->findInt64(kKeyDuration, &durationUs));
+    EXPECT_NEAR(params.mDurationUs, durationUs, 100000);
+
+    ssize_t audioIndex = findTrack(extractor, MEDIA_MIMETYPE_AUDIO_AAC);
+    ASSERT_GE(audioIndex, 0);
+    meta = extractor->getTrackMetaData(audioIndex);
+
+    int32_t sampleRate, channelCount;
+    ASSERT_TRUE(meta->findInt32(kKeySampleRate, &sampleRate));
+    ASSERT_TRUE(meta->findInt32(kKeyChannelCount, &channelCount));
+    EXPECT_EQ(44100, sampleRate);
+    EXPECT_EQ(2, channelCount);
+
+    uint32_t type;
+    const void *data;
+    size_t size;
+    EXPECT_TRUE(meta->findData(kKeyESDS, &type, &data, &size));
+}
+
+TEST_F(MPEG4ExtractorTest, Sniff) {
+    MP4Generator::Params params;
+    params.mDurationUs = 1000000;
+    record(params);
+
+    sp<DataSource> source = new FileSource(kTestFile);
+    String8 mimeType;
+    float confidence;
+    sp<AMessage> meta;
+    ASSERT_TRUE(SniffMPEG4(source, &mimeType, &confidence, &meta));
+    EXPECT_STREQ(MEDIA_MIMETYPE_CONTAINER_MPEG4, mimeType.string());
+    EXPECT_GT(confidence, 0.0f);
+}
+
+TEST_F(MPEG4ExtractorTest, ReadsEveryVideoSample) {
+    MP4Generator::Params params;
+    sp<MediaExtractor> extractor = record(params);
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+
+    Vector<Sample> samples;
+    drainSource(video, &samples);
+
+    uint32_t numFrames = MP4Generator::CountVideoFrames(params);
+    ASSERT_EQ(numFrames, samples.size());
+
+    Vector<uint8_t> frame;
+    for (uint32_t i = 0; i < numFrames; ++i) {
+        const Sample &sample = samples.itemAt(i);
+        MP4Generator::MakeVideoFrame(params, i, &frame);
+
+        EXPECT_EQ(i, sample.mIndex);
+        EXPECT_EQ(MP4Generator::VideoFrameTimeUs(params, i), sample.mTimeUs);
+        EXPECT_EQ(frame.size() + 4, sample.mSize);
+        EXPECT_EQ((i % params.mSyncInterval) == 0, sample.mIsSync)
+            << "frame " << i;
+    }
+
+    video->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, ReadsEveryAudioSample) {
+    MP4Generator::Params params;
+    sp<MediaExtractor> extractor = record(params);
+
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_AAC);
+
+    Vector<Sample> samples;
+    drainSource(audio, &samples, false /* isAVC */);
+
+    ASSERT_GT(samples.size(), 0u);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample &sample = samples.itemAt(i);
+
+        EXPECT_EQ(i, sample.mIndex);
+        EXPECT_EQ(MP4Generator::AudioFrameSize(
+                    MP4Generator::AUDIO_AAC, i), sample.mSize);
+
+        // Timestamps are stored at the sample rate.
+        EXPECT_NEAR((double)i * (1024 * 1000000ll / 44100),
+                    (double)sample.mTimeUs, 100.0) << "frame " << i;
+    }
+
+    audio->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, NALFragments) {
+    MP4Generator::Params params;
+    params.mDurationUs = 2000000;
+    sp<MediaExtractor> extractor = record(params);
+
+    sp<MetaData> startParams = new MetaData;
+    startParams->setInt32(kKeyWantsNALFragments, true);
+    sp<MediaSource> video = startTrack(
+            extractor, MEDIA_MIMETYPE_VIDEO_AVC, startParams.get());
+
+    Vector<uint8_t> frame;
+    for (uint32_t i = 0; i < MP4Generator::CountVideoFrames(params); ++i) {
+        MediaBuffer *buffer;
+        ASSERT_EQ((status_t)OK, video->read(&buffer));
+
+        MP4Generator::MakeVideoFrame(params, i, &frame);
+        ASSERT_EQ(frame.size(), buffer->range_length());
+        EXPECT_TRUE(!memcmp(frame.array(),
+                            (const uint8_t *)buffer->data()
+                                + buffer->range_offset(),
+                            frame.size()));
+
+        buffer->release();
+    }
+
+    MediaBuffer *buffer;
+    EXPECT_EQ(ERROR_END_OF_STREAM, video->read(&buffer));
+
+    video->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, SeekModes) {
+    MP4Generator::Params params;
+    sp<MediaExtractor> extractor = record(params);
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+
+    typedef MediaSource::ReadOptions Options;
+
+    // Sync frames every second, 40ms per frame.
+    expectSeek(video, 0, Options::SEEK_PREVIOUS_SYNC, 0);
+    expectSeek(video, 2400000, Options::SEEK_PREVIOUS_SYNC, 50);
+    expectSeek(video, 2400000, Options::SEEK_NEXT_SYNC, 75);
+    expectSeek(video, 2400000, Options::SEEK_CLOSEST_SYNC, 50);
+    expectSeek(video, 2600000, Options::SEEK_CLOSEST_SYNC, 75);
+    expectSeek(video, 3000000, Options::SEEK_NEXT_SYNC, 75);
+    expectSeek(video, 9900000, Options::SEEK_PREVIOUS_SYNC, 225);
+
+    // Seeks "closest" land on the preceding sync sample and point at the
+    // requested frame.
+    MediaSource::ReadOptions options;
+    options.setSeekTo(2610000, Options::SEEK_CLOSEST);
+    Sample sample;
+    ASSERT_TRUE(readSample(video, &sample, &options));
+    EXPECT_EQ(50u, sample.mIndex);
+    EXPECT_EQ(2600000, sample.mTargetTimeUs);
+
+    // Nothing beyond the last sync sample.
+    options.setSeekTo(params.mDurationUs + 5000000, Options::SEEK_NEXT_SYNC);
+    status_t err;
+    EXPECT_FALSE(readSample(video, &sample, &options, true, &err));
+    EXPECT_EQ(ERROR_END_OF_STREAM, err);
+
+    video->stop();
+}
+
+// A distinct 'stts' entry per sample puts lookups beyond the first
+// checkpoints of the time-to-sample table.
+TEST_F(MPEG4ExtractorTest, SeeksIntoLongTimeToSampleTable) {
+    MP4Generator::Params params;
+    params.mDurationUs = 120000000;
+    params.mFrameJitterUs = 10000;
+    params.mFrameSize = 50;
+    params.mAudioType = MP4Generator::AUDIO_NONE;
+    sp<MediaExtractor> extractor = record(params);
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+
+    uint32_t numFrames = MP4Generator::CountVideoFrames(params);
+    srand(1);
+
+    for (size_t i = 0; i < 200; ++i) {
+        uint32_t target = rand() % numFrames;
+        int64_t seekTimeUs = MP4Generator::VideoFrameTimeUs(params, target);
+
+        MediaSource::ReadOptions options;
+        options.setSeekTo(
+                seekTimeUs, MediaSource::ReadOptions::SEEK_CLOSEST);
+
+        Sample sample;
+        ASSERT_TRUE(readSample(video, &sample, &options));
+
+        uint32_t expected = target - target % params.mSyncInterval;
+        EXPECT_EQ(expected, sample.mIndex) << "seek to frame " << target;
+        EXPECT_EQ(MP4Generator::VideoFrameTimeUs(params, expected),
+                  sample.mTimeUs);
+        EXPECT_EQ(seekTimeUs, sample.mTargetTimeUs);
+
+        // Read up to the requested frame.
+        for (uint32_t j = expected + 1; j <= target; ++j) {
+            ASSERT_TRUE(readSample(video, &sample));
+            ASSERT_EQ(j, sample.mIndex);
+            ASSERT_EQ(MP4Generator::VideoFrameTimeUs(params, j),
+                      sample.mTimeUs);
+        }
+    }
+
+    video->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, AMRAudioOnly) {
+    MP4Generator::Params params;
+    params.mHasVideo = false;
+    params.mAudioType = MP4Generator::AUDIO_AMR_NB;
+    sp<MediaExtractor> extractor = record(params);
+
+    ASSERT_EQ(1u, extractor->countTracks());
+
+    const char *mime;
+    ASSERT_TRUE(extractor->getMetaData()->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ("audio/mp4", mime);
+
+    sp<MetaData> meta = extractor->getTrackMetaData(0);
+    int32_t sampleRate;
+    ASSERT_TRUE(meta->findInt32(kKeySampleRate, &sampleRate));
+    EXPECT_EQ(8000, sampleRate);
+
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_AMR_NB);
+
+    Vector<Sample> samples;
+    drainSource(audio, &samples, false /* isAVC */);
+
+    ASSERT_EQ((size_t)(params.mDurationUs / 20000), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(i, samples.itemAt(i).mIndex);
+        EXPECT_EQ(32u, samples.itemAt(i).mSize);
+        EXPECT_EQ((int64_t)i * 20000, samples.itemAt(i).mTimeUs);
+    }
+
+    // Every audio sample is a sync sample.
+    MediaSource::ReadOptions options;
+    options.setSeekTo(5010000, MediaSource::ReadOptions::SEEK_CLOSEST_SYNC);
+    Sample sample;
+    ASSERT_TRUE(readSample(audio, &sample, &options, false));
+    EXPECT_EQ(250u, sample.mIndex);
+
+    audio->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, TruncatedFileHasNoTracks) {
+    MP4Generator::Params params;
+    params.mDurationUs = 2000000;
+    record(params);
+
+    FILE *file = fopen(kTestFile, "rb");
+    ASSERT_TRUE(file != NULL);
+
+    Vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.appendArray(buffer, n);
+    }
+    fclose(file);
+
+    // Cut the file short in the middle of the movie box.
+    size_t offset = 0;
+    while (offset + 8 <= data.size()
+            && memcmp(&data.itemAt(offset + 4), "moov", 4)) {
+        offset += U32_AT(&data.itemAt(offset));
+    }
+    ASSERT_LE(offset + 8, data.size());
+
+    data.removeItemsAt(
+            offset + U32_AT(&data.itemAt(offset)) / 2,
+            data.size() - offset - U32_AT(&data.itemAt(offset)) / 2);
+
+    sp<MediaExtractor> extractor = new MPEG4Extractor(new BufferSource(data));
+    EXPECT_EQ(0u, extractor->countTracks());
+}
+
+TEST_F(MPEG4ExtractorTest, QuickTimePCMGoesToWAVDecoder) {
+    static const struct {
+        const char *mFourcc;
+        uint32_t mBitsPerSample;
+        uint32_t mNumChannels;
+    } kFormats[] = {
+        { "sowt", 16, 2 },
+        { "twos", 16, 2 },
+        { "twos", 8, 1 },
+        { "raw ", 8, 2 },
+    };
+    static const uint32_t kNumFrames = 8000 * 3 + 123;
+
+    for (size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); ++f) {
+        const char *fourcc = kFormats[f].mFourcc;
+        uint32_t bits = kFormats[f].mBitsPerSample;
+        uint32_t channels = kFormats[f].mNumChannels;
+        SCOPED_TRACE(fourcc);
+
+        Vector<uint8_t> data;
+        MP4Generator::MakeQuickTimePCM(
+                fourcc, bits, channels, kNumFrames, false /* withVideo */,
+                &data);
+
+        sp<MediaExtractor> extractor =
+            new MPEG4Extractor(new BufferSource(data));
+        ASSERT_EQ(1u, extractor->countTracks());
+
+        sp<MetaData> meta = extractor->getTrackMetaData(0);
+        int32_t numChannels, sampleRate;
+        ASSERT_TRUE(meta->findInt32(kKeyChannelCount, &numChannels));
+        ASSERT_TRUE(meta->findInt32(kKeySampleRate, &sampleRate));
+        EXPECT_EQ((int32_t)channels, numChannels);
+        EXPECT_EQ(8000, sampleRate);
+
+        sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_WAV);
+
+        // WAVDecoder takes a WAVEFORMATEX of 16 bit PCM from the first
+        // buffer, on its own.
+        Vector<uint8_t> buffer;
+        int64_t timeUs;
+        ASSERT_TRUE(readBuffer(audio, &buffer, &timeUs));
+        ASSERT_EQ(20u, buffer.size());
+        EXPECT_EQ(0, timeUs);
+
+        const uint8_t *wfx = buffer.array();
+        EXPECT_EQ(1, wfx[0] | (wfx[1] << 8));
+        EXPECT_EQ(channels, (uint32_t)(wfx[2] | (wfx[3] << 8)));
+        EXPECT_EQ(8000u, (uint32_t)(wfx[4] | (wfx[5] << 8) | (wfx[6] << 16)));
+        EXPECT_EQ(8000u * channels * 2,
+                  (uint32_t)(wfx[8] | (wfx[9] << 8) | (wfx[10] << 16)));
+        EXPECT_EQ(channels * 2, (uint32_t)(wfx[12] | (wfx[13] << 8)));
+        EXPECT_EQ(16, wfx[14] | (wfx[15] << 8));
+
+        Vector<uint8_t> pcm;
+        int64_t nextTimeUs = 0;
+        while (readBuffer(audio, &buffer, &timeUs)) {
+            EXPECT_EQ(nextTimeUs, timeUs);
+            pcm.appendVector(buffer);
+            nextTimeUs = (pcm.size() / (channels * 2)) * 1000000ll / 8000;
+        }
+
+        Vector<uint8_t> expected;
+        expectedPCM(fourcc, bits, channels, kNumFrames, 0, &expected);
+        ASSERT_EQ(expected.size(), pcm.size());
+        EXPECT_EQ(0, memcmp(expected.array(), pcm.array(), pcm.size()));
+
+        audio->stop();
+
+        // Once more after every start, also when it begins with a seek.
+        ASSERT_EQ((status_t)OK, audio->start());
+
+        MediaSource::ReadOptions options;
+        options.setSeekTo(
+                2000000, MediaSource::ReadOptions::SEEK_CLOSEST_SYNC);
+        ASSERT_TRUE(readBuffer(audio, &buffer, &timeUs, &options));
+        EXPECT_EQ(20u, buffer.size());
+        EXPECT_EQ(2000000, timeUs);
+
+        ASSERT_TRUE(readBuffer(audio, &buffer, &timeUs));
+        EXPECT_EQ(2000000, timeUs);
+        expectedPCM(fourcc, bits, channels, kNumFrames, 16000, &expected);
+        ASSERT_LE(buffer.size(), expected.size());
+        EXPECT_EQ(0, memcmp(expected.array(), buffer.array(), buffer.size()));
+
+        audio->stop();
+    }
+}
+
+TEST_F(MPEG4ExtractorTest, QuickTimeG711GoesToG711Decoder) {
+    static const uint32_t kNumFrames = 8000 * 2;
+
+    Vector<uint8_t> data;
+    MP4Generator::MakeQuickTimePCM(
+            "alaw", 8, 1, kNumFrames, false /* withVideo */, &data);
+
+    sp<MediaExtractor> extractor = new MPEG4Extractor(new BufferSource(data));
+    ASSERT_EQ(1u, extractor->countTracks());
+
+    // SoftG711 is handed the samples as stored, nothing ahead of them.
+    sp<MediaSource> audio =
+        startTrack(extractor, MEDIA_MIMETYPE_AUDIO_G711_ALAW);
+
+    Vector<uint8_t> pcm;
+    Vector<uint8_t> buffer;
+    int64_t timeUs;
+    while (readBuffer(audio, &buffer, &timeUs)) {
+        EXPECT_EQ((int64_t)pcm.size() * 1000000 / 8000, timeUs);
+        pcm.appendVector(buffer);
+    }
+
+    Vector<uint8_t> expected;
+    expectedPCM("alaw", 8, 1, kNumFrames, 0, &expected);
+    ASSERT_EQ(expected.size(), pcm.size());
+    EXPECT_EQ(0, memcmp(expected.array(), pcm.array(), pcm.size()));
+
+    audio->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, ReportsReadOffsetOfLaggingTrack) {
+    Vector<uint8_t> data;
+    MP4Generator::MakeQuickTimePCM(
+            "sowt", 16, 2, 8000 * 4, true /* withVideo */, &data);
+
+    // A caching source has the sample tables held in memory.
+    sp<RecordingSource> dataSource = new RecordingSource(data);
+    dataSource->mFlags = DataSource::kIsCachingDataSource;
+
+    sp<MediaExtractor> extractor = new MPEG4Extractor(dataSource);
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_WAV);
+
+    // Read in time order like a player would. All of the video is stored
+    // ahead of the audio, the caching source must keep everything from
+    // where the video continues.
+    Vector<uint8_t> buffer;
+    int64_t audioTimeUs = 0;
+    int64_t videoTimeUs = 0;
+    off64_t videoEnd = -1;
+    bool videoDone = false;
+    bool audioDone = false;
+    size_t numAudioBuffers = 0;
+    while (!videoDone || !audioDone) {
+        if (!videoDone && (audioDone || videoTimeUs <= audioTimeUs)) {
+            int64_t timeUs;
+            if (!readBuffer(video, &buffer, &timeUs)) {
+                videoDone = true;
+                continue;
+            }
+
+            videoTimeUs = timeUs;
+            videoEnd = dataSource->mLastReadEnd;
+            EXPECT_EQ(videoEnd, dataSource->mLowWater);
+        } else {
+            off64_t lowWater = dataSource->mLowWater;
+            if (!readBuffer(audio, &buffer, &audioTimeUs)) {
+                audioDone = true;
+                continue;
+            }
+
+            if (numAudioBuffers++ == 0) {
+                // The WAVEFORMATEX, nothing is read.
+                EXPECT_EQ(lowWater, dataSource->mLowWater);
+            } else if (!videoDone) {
+                EXPECT_EQ(videoEnd, dataSource->mLowWater);
+            }
+        }
+    }
+
+    EXPECT_GT(numAudioBuffers, 1u);
+
+    // Once the video is stopped the audio track is the only one left.
+    video->stop();
+    MediaSource::ReadOptions options;
+    options.setSeekTo(1000000, MediaSource::ReadOptions::SEEK_CLOSEST_SYNC);
+    int64_t timeUs;
+    ASSERT_TRUE(readBuffer(audio, &buffer, &timeUs, &options));
+    EXPECT_EQ(dataSource->mLastReadEnd, dataSource->mLowWater);
+
+    audio->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, KeepsSampleTablesReadDuringPlayback) {
+    Vector<uint8_t> data;
+    MP4Generator::MakeQuickTimePCM(
+            "sowt", 16, 2, 8000 * 4, true /* withVideo */, &data);
+
+    // Without the caching flag the sample tables are read from the source
+    // as samples are looked up. They precede the media data, nothing past
+    // them may be dropped.
+    sp<RecordingSource> dataSource = new RecordingSource(data);
+    sp<MediaExtractor> extractor = new MPEG4Extractor(dataSource);
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_WAV);
+
+    Vector<uint8_t> buffer;
+    int64_t timeUs;
+    ASSERT_TRUE(readBuffer(video, &buffer, &timeUs));
+    off64_t lowWater = dataSource->mLowWater;
+    EXPECT_GE(lowWater, 0);
+    EXPECT_LT(lowWater, dataSource->mLastReadEnd - (off64_t)buffer.size());
+
+    while (readBuffer(audio, &buffer, &timeUs)) {
+        EXPECT_EQ(lowWater, dataSource->mLowWater);
+    }
+
+    while (readBuffer(video, &buffer, &timeUs)) {
+        EXPECT_EQ(lowWater, dataSource->mLowWater);
+    }
+
+    video->stop();
+    audio->stop();
+}
+
+TEST_F(MPEG4ExtractorTest, FragmentedFile) {
+    static const uint32_t kNumFragments = 20;
+    static const uint32_t kFramesPerFragment = 25;
+
+    Vector<uint8_t> data;
+    MP4Generator::MakeFragmented(
+            kNumFragments, kFramesPerFragment, true /* withAudio */, &data);
+
+    sp<DataSource> dataSource = new BufferSource(data);
+
+    String8 mimeType;
+    float confidence;
+    sp<AMessage> meta;
+    ASSERT_TRUE(SniffMPEG4(dataSource, &mimeType, &confidence, &meta));
+
+    sp<MediaExtractor> extractor = new MPEG4Extractor(dataSource);
+    ASSERT_EQ(2u, extractor->countTracks());
+
+    sp<MetaData> trackMeta = extractor->getTrackMetaData(0);
+    int64_t durationUs;
+    ASSERT_TRUE(trackMeta->findInt64(kKeyDuration, &durationUs));
+    EXPECT_EQ(kNumFragments * kFramesPerFragment * 40000ll, durationUs);
+
+    sp<MediaSource> video = startTrack(extractor, MEDIA_MIMETYPE_VIDEO_AVC);
+
+    Vector<Sample> samples;
+    drainSource(video, &samples);
+
+    ASSERT_EQ(kNumFragments * kFramesPerFragment, samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample &sample = samples.itemAt(i);
+        EXPECT_EQ(i, sample.mIndex);
+        EXPECT_EQ((int64_t)i * 40000, sample.mTimeUs);
+        EXPECT_EQ((i % kFramesPerFragment) == 0, sample.mIsSync)
+            << "frame " << i;
+    }
+
+    typedef MediaSource::ReadOptions Options;
+    mParams.mFrameDurationUs = 40000;
+    mParams.mDurationUs = kNumFragments * kFramesPerFragment * 40000ll;
+
+    expectSeek(video, 11 * 1000000ll + 100000, Options::SEEK_PREVIOUS_SYNC, 275);
+    expectSeek(video, 11 * 1000000ll + 100000, Options::SEEK_NEXT_SYNC, 300);
+    expectSeek(video, 11 * 1000000ll + 600000, Options::SEEK_CLOSEST_SYNC, 300);
+    expectSeek(video, 2000000, Options::SEEK_PREVIOUS_SYNC, 50);
+    expectSeek(video, 0, Options::SEEK_NEXT_SYNC, 0);
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(7 * 1000000ll + 520000, Options::SEEK_CLOSEST);
+    Sample sample;
+    ASSERT_TRUE(readSample(video, &sample, &options));
+    EXPECT_EQ(175u, sample.mIndex);
+    EXPECT_EQ(7 * 1000000ll + 520000, sample.mTargetTimeUs);
+
+    video->stop();
+
+    // The audio track fragments carry two runs each.
+    sp<MediaSource> audio = startTrack(extractor, MEDIA_MIMETYPE_AUDIO_AAC);
+    drainSource(audio, &samples, false /* isAVC */);
+
+    ASSERT_EQ(kNumFragments * kFramesPerFragment * 2, samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(i, samples.itemAt(i).mIndex);
+        EXPECT_EQ(MP4Generator::AudioFrameSize(MP4Generator::AUDIO_AAC, i),
+                  samples.itemAt(i).mSize);
+    }
+
+    audio->stop();
+}
+
+}  // namespace android
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Records MP4 files of increasing duration through MPEG4Writer and reports,
+// for each, how long MPEG4Extractor takes to open it, to produce the track
+// formats and to seek, and how much the resident set grows in the process.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "mp4_extractor_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/MPEG4Extractor.h"
+#include "MP4Generator.h"
+
+using namespace android;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+// Resident set size of this process in kBytes, -1 if unknown.
+static long getRSSKb() {
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    long rss = -1;
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!strncmp(line, "VmRSS:", 6)) {
+            rss = atol(&line[6]);
+            break;
+        }
+    }
+
+    fclose(file);
+
+    return rss;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-f path] [-k] durationSecs...\n"
+            "       -f  file to record to (default /sdcard/mp4_bench.mp4)\n"
+            "       -k  keep the last recorded file\n", me);
+    exit(1);
+}
+
+static void runOne(const char *path, int64_t durationSecs) {
+    MP4Generator::Params params;
+    params.mDurationUs = durationSecs * 1000000ll;
+    params.mFrameSize = 1500;
+
+    CHECK_EQ(MP4Generator::Record(path, params), (status_t)OK);
+
+    struct stat st;
+    CHECK_EQ(stat(path, &st), 0);
+
+    long rssBeforeKb = getRSSKb();
+
+    int64_t startUs = getNowUs();
+
+    sp<MediaExtractor> extractor = new MPEG4Extractor(new FileSource(path));
+    size_t numTracks = extractor->countTracks();
+    CHECK_EQ(numTracks, 2u);
+
+    int64_t openUs = getNowUs() - startUs;
+
+    startUs = getNowUs();
+    for (size_t i = 0; i < numTracks; ++i) {
+        CHECK(extractor->getTrackMetaData(i) != NULL);
+    }
+    int64_t formatUs = getNowUs() - startUs;
+
+    sp<MediaSource> video = extractor->getTrack(0);
+    CHECK_EQ(video->start(), (status_t)OK);
+
+    // Seek to a few places spread over the file, the last one near the
+    // end to reach the far ends of all tables.
+    startUs = getNowUs();
+    static const size_t kNumSeeks = 8;
+    for (size_t i = 0; i < kNumSeeks; ++i) {
+        MediaSource::ReadOptions options;
+        options.setSeekTo(
+                params.mDurationUs * ((i * 5) % kNumSeeks + 1) / (kNumSeeks + 1),
+                MediaSource::ReadOptions::SEEK_CLOSEST);
+
+        MediaBuffer *buffer;
+        CHECK_EQ(video->read(&buffer, &options), (status_t)OK);
+        buffer->release();
+    }
+    int64_t seekUs = (getNowUs() - startUs) / kNumSeeks;
+
+    long rssAfterKb = getRSSKb();
+
+    video->stop();
+    video.clear();
+    extractor.clear();
+
+    printf("%8lld %10.1f %10.2f %10.2f %10.2f %10ld\n",
+           durationSecs, st.st_size / 1E6,
+           openUs / 1E3, formatUs / 1E3, seekUs / 1E3,
+           (rssBeforeKb < 0 || rssAfterKb < 0)
+                ? -1 : rssAfterKb - rssBeforeKb);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "/sdcard/mp4_bench.mp4";
+    bool keepFile = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "f:k")) >= 0) {
+        switch (res) {
+            case 'f':
+                path = optarg;
+                break;
+
+            case 'k':
+                keepFile = true;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    static const int64_t kDefaultDurations[] = { 60, 600, 3600, 3 * 3600 };
+
+    Vector<int64_t> durations;
+    if (argc == 0) {
+        durations.appendArray(
+                kDefaultDurations,
+                sizeof(kDefaultDurations) / sizeof(kDefaultDurations[0]));
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            int64_t durationSecs = atoll(argv[i]);
+            if (durationSecs <= 0) {
+                usage(argv[0]);
+            }
+            durations.push(durationSecs);
+        }
+    }
+
+    printf("%8s %10s %10s %10s %10s %10s\n",
+           "secs", "MBytes", "open ms", "format ms", "seek ms", "RSS+ kB");
+
+    for (size_t i = 0; i < durations.size(); ++i) {
+        runOne(path, durations.itemAt(i));
+    }
+
+    if (!keepFile) {
+        unlink(path);
+    }
+
+    return 0;
+}
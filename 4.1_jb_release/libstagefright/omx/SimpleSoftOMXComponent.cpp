@@ -279,6 +279,8 @@ OMX_ERRORTYPE SimpleSoftOMXComponent::freeBuffer(
         if (buffer->mHeader == header) {
             CHECK(!buffer->mOwnedByUs);
 
+            onFreeBuffer(portIndex, header);
+
             if (header->pPlatformPrivate != NULL) {
                 // This buffer's data was allocated by us.
                 CHECK(header->pPlatformPrivate == header->pBuffer);
@@ -630,6 +632,10 @@ void SimpleSoftOMXComponent::onPortEnableCompleted(
         OMX_U32 portIndex, bool enabled) {
 }
 
+void SimpleSoftOMXComponent::onFreeBuffer(
+        OMX_U32 portIndex, OMX_BUFFERHEADERTYPE *header) {
+}
+
 List<SimpleSoftOMXComponent::BufferInfo *> &
 SimpleSoftOMXComponent::getPortQueue(OMX_U32 portIndex) {
     CHECK_LT(portIndex, mPorts.size());
@@ -169,6 +169,12 @@ void ARTPConnection::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatInjectPackets:
+        {
+            onInjectPackets(msg);
+            break;
+        }
+
         default:
         {
             TRESPASS();
@@ -643,6 +649,12 @@ void ARTPConnection::injectPacket(int index, const sp<ABuffer> &buffer) {
     msg->post();
 }
 
+void ARTPConnection::injectPackets(const sp<ARTPPacketBatch> &batch) {
+    sp<AMessage> msg = new AMessage(kWhatInjectPackets, id());
+    msg->setObject("batch", batch);
+    msg->post();
+}
+
 void ARTPConnection::onInjectPacket(const sp<AMessage> &msg) {
     int32_t index;
     CHECK(msg->findInt32("index", &index));
@@ -650,6 +662,27 @@ void ARTPConnection::onInjectPacket(const sp<AMessage> &msg) {
     sp<ABuffer> buffer;
     CHECK(msg->findBuffer("buffer", &buffer));
 
+    processInjectedPacket(index, buffer);
+}
+
+void ARTPConnection::onInjectPackets(const sp<AMessage> &msg) {
+    sp<RefBase> obj;
+    CHECK(msg->findObject("batch", &obj));
+
+    sp<ARTPPacketBatch> batch = static_cast<ARTPPacketBatch *>(obj.get());
+
+    for (size_t i = 0; i < batch->mPackets.size(); ++i) {
+        const sp<ABuffer> &buffer = batch->mPackets.itemAt(i);
+
+        int32_t index;
+        CHECK(buffer->meta()->findInt32("index", &index));
+
+        processInjectedPacket(index, buffer);
+    }
+}
+
+void ARTPConnection::processInjectedPacket(
+        int32_t index, const sp<ABuffer> &buffer) {
     List<StreamInfo>::iterator it = mStreams.begin();
     while (it != mStreams.end()
            && it->mRTPSocket != index && it->mRTCPSocket != index) {
@@ -20,6 +20,7 @@
 
 #include <media/stagefright/foundation/AHandler.h>
 #include <utils/List.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -27,6 +28,12 @@ struct ABuffer;
 struct ARTPSource;
 struct ASessionDescription;
 
+// Packets received interleaved on the RTSP connection, each buffer's meta
+// carries the channel it arrived on as "index".
+struct ARTPPacketBatch : public RefBase {
+    Vector<sp<ABuffer> > mPackets;
+};
+
 struct ARTPConnection : public AHandler {
     enum Flags {
         kRegularlyRequestFIR = 2,
@@ -43,6 +50,7 @@ struct ARTPConnection : public AHandler {
     void removeStream(int rtpSocket, int rtcpSocket);
 
     void injectPacket(int index, const sp<ABuffer> &buffer);
+    void injectPackets(const sp<ARTPPacketBatch> &batch);
 
     // Creates a pair of UDP datagram sockets bound to adjacent ports
     // (the rtpSocket is bound to an even port, the rtcpSocket to the
@@ -60,6 +68,7 @@ private:
         kWhatRemoveStream,
         kWhatPollStreams,
         kWhatInjectPacket,
+        kWhatInjectPackets,
     };
 
     static const int64_t kSelectTimeoutUs;
@@ -76,6 +85,8 @@ private:
     void onRemoveStream(const sp<AMessage> &msg);
     void onPollStreams();
     void onInjectPacket(const sp<AMessage> &msg);
+    void onInjectPackets(const sp<AMessage> &msg);
+    void processInjectedPacket(int32_t index, const sp<ABuffer> &buffer);
     void onSendReceiverReports();
 
     status_t receive(StreamInfo *info, bool receiveRTP);
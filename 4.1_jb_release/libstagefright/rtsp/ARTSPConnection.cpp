@@ -34,6 +34,7 @@
 #include <openssl/md5.h>
 #include <sys/socket.h>
 
+#include "ARTPConnection.h"
 #include "HTTPBase.h"
 
 namespace android {
@@ -41,6 +42,20 @@ namespace android {
 // static
 const int64_t ARTSPConnection::kSelectTimeoutUs = 1000ll;
 
+// An interleaved packet, left in the receive block it arrived in. It keeps
+// the block alive for as long as it is around itself.
+struct ReceivedPacket : public ABuffer {
+    ReceivedPacket(const sp<ABuffer> &block, size_t offset, size_t size)
+        : ABuffer(block->base() + offset, size),
+          mBlock(block) {
+    }
+
+private:
+    sp<ABuffer> mBlock;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ReceivedPacket);
+};
+
 ARTSPConnection::ARTSPConnection(bool uidValid, uid_t uid)
     : mUIDValid(uidValid),
       mUID(uid),
@@ -49,11 +64,20 @@ ARTSPConnection::ARTSPConnection(bool uidValid, uid_t uid)
       mSocket(-1),
       mConnectionID(0),
       mNextCSeq(0),
-      mReceiveResponseEventPending(false) {
+      mReceiveBufferOffset(0),
+      mReceiveBufferSize(0),
+      mReceiveThreadStarted(false),
+      mReceiveThreadExitPending(false),
+      mReceiveSelecting(false),
+      mReceiveSocket(-1) {
+    mReceiveWakePipe[0] = mReceiveWakePipe[1] = -1;
+
     MakeUserAgent(&mUserAgent);
 }
 
 ARTSPConnection::~ARTSPConnection() {
+    stopReceiveThread();
+
     if (mSocket >= 0) {
         ALOGE("Connection is still open, closing the socket.");
         if (mUIDValid) {
@@ -210,6 +234,8 @@ void ARTSPConnection::onConnect(const sp<AMessage> &msg) {
     ++mConnectionID;
 
     if (mState != DISCONNECTED) {
+        disarmReceiveThread();
+
         if (mUIDValid) {
             HTTPBase::UnRegisterSocketUserTag(mSocket);
         }
@@ -248,6 +274,18 @@ void ARTSPConnection::onConnect(const sp<AMessage> &msg) {
         ALOGV("user = '%s', pass = '%s'", mUser.c_str(), mPass.c_str());
     }
 
+    if (!mReceiveThreadStarted) {
+        status_t err = startReceiveThread();
+
+        if (err != OK) {
+            reply->setInt32("result", err);
+            reply->post();
+
+            mState = DISCONNECTED;
+            return;
+        }
+    }
+
     struct hostent *ent = gethostbyname(host.c_str());
     if (ent == NULL) {
         ALOGE("Unknown host %s", host.c_str());
@@ -301,13 +339,16 @@ void ARTSPConnection::onConnect(const sp<AMessage> &msg) {
         mState = CONNECTED;
         mNextCSeq = 1;
 
-        postReceiveReponseEvent();
+        resetReceiveBuffer();
+        armReceiveThread();
     }
 
     reply->post();
 }
 
 void ARTSPConnection::performDisconnect() {
+    disarmReceiveThread();
+
     if (mUIDValid) {
         HTTPBase::UnRegisterSocketUserTag(mSocket);
     }
@@ -315,6 +356,7 @@ void ARTSPConnection::performDisconnect() {
     mSocket = -1;
 
     flushPendingRequests();
+    resetReceiveBuffer();
 
     mUser.clear();
     mPass.clear();
@@ -391,7 +433,8 @@ void ARTSPConnection::onCompleteConnection(const sp<AMessage> &msg) {
         mState = CONNECTED;
         mNextCSeq = 1;
 
-        postReceiveReponseEvent();
+        resetReceiveBuffer();
+        armReceiveThread();
     }
 
     reply->post();
@@ -466,38 +509,28 @@ void ARTSPConnection::onSendRequest(const sp<AMessage> &msg) {
 }
 
 void ARTSPConnection::onReceiveResponse() {
-    mReceiveResponseEventPending = false;
-
     if (mState != CONNECTED) {
         return;
     }
 
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = kSelectTimeoutUs;
-
-    fd_set rs;
-    FD_ZERO(&rs);
-    FD_SET(mSocket, &rs);
-
-    int res = select(mSocket + 1, &rs, NULL, NULL, &tv);
-    CHECK_GE(res, 0);
-
-    if (res == 1) {
-        MakeSocketBlocking(mSocket, true);
-
-        bool success = receiveRTSPReponse();
+    size_t numBytesRead;
+    if (fillReceiveBuffer(&numBytesRead) != OK) {
+        // The connection is gone, fillReceiveBuffer already disconnected.
+        return;
+    }
 
-        MakeSocketBlocking(mSocket, false);
+    if (numBytesRead > 0 && !processReceivedData()) {
+        // Something horrible, irreparable has happened.
+        flushPendingRequests();
+        return;
+    }
 
-        if (!success) {
-            // Something horrible, irreparable has happened.
-            flushPendingRequests();
-            return;
-        }
+    if (mState != CONNECTED) {
+        return;
     }
 
-    postReceiveReponseEvent();
+    // Nothing more to do until the socket becomes readable again.
+    armReceiveThread();
 }
 
 void ARTSPConnection::flushPendingRequests() {
@@ -511,26 +544,246 @@ void ARTSPConnection::flushPendingRequests() {
     mPendingRequests.clear();
 }
 
-void ARTSPConnection::postReceiveReponseEvent() {
-    if (mReceiveResponseEventPending) {
+status_t ARTSPConnection::startReceiveThread() {
+    CHECK(!mReceiveThreadStarted);
+
+    if (pipe(mReceiveWakePipe) < 0) {
+        ALOGE("Unable to create receive wake pipe. (%s)", strerror(errno));
+        return -errno;
+    }
+
+    fcntl(mReceiveWakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(mReceiveWakePipe[1], F_SETFL, O_NONBLOCK);
+
+    mReceiveThreadExitPending = false;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    int err = pthread_create(&mReceiveThread, &attr, ReceiveThreadWrapper, this);
+
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+        ALOGE("Unable to start receive thread. (%s)", strerror(err));
+
+        close(mReceiveWakePipe[0]);
+        close(mReceiveWakePipe[1]);
+        mReceiveWakePipe[0] = mReceiveWakePipe[1] = -1;
+
+        return -err;
+    }
+
+    mReceiveThreadStarted = true;
+
+    return OK;
+}
+
+void ARTSPConnection::stopReceiveThread() {
+    if (!mReceiveThreadStarted) {
         return;
     }
 
-    sp<AMessage> msg = new AMessage(kWhatReceiveResponse, id());
-    msg->post();
+    {
+        Mutex::Autolock autoLock(mReceiveLock);
+        mReceiveThreadExitPending = true;
+        mReceiveSocket = -1;
+
+        if (mReceiveSelecting) {
+            write(mReceiveWakePipe[1], "", 1);
+        }
 
-    mReceiveResponseEventPending = true;
+        mReceiveCondition.broadcast();
+    }
+
+    void *dummy;
+    pthread_join(mReceiveThread, &dummy);
+    mReceiveThreadStarted = false;
+
+    close(mReceiveWakePipe[0]);
+    close(mReceiveWakePipe[1]);
+    mReceiveWakePipe[0] = mReceiveWakePipe[1] = -1;
+}
+
+void ARTSPConnection::armReceiveThread() {
+    Mutex::Autolock autoLock(mReceiveLock);
+    mReceiveSocket = mSocket;
+    mReceiveCondition.broadcast();
+}
+
+void ARTSPConnection::disarmReceiveThread() {
+    if (!mReceiveThreadStarted) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mReceiveLock);
+    mReceiveSocket = -1;
+
+    // The socket is about to be closed, get it out of select() first.
+    if (mReceiveSelecting) {
+        write(mReceiveWakePipe[1], "", 1);
+
+        while (mReceiveSelecting) {
+            mReceiveCondition.wait(mReceiveLock);
+        }
+    }
 }
 
-status_t ARTSPConnection::receive(void *data, size_t size) {
-    size_t offset = 0;
-    while (offset < size) {
-        ssize_t n = recv(mSocket, (uint8_t *)data + offset, size - offset, 0);
+// static
+void *ARTSPConnection::ReceiveThreadWrapper(void *me) {
+    static_cast<ARTSPConnection *>(me)->receiveThread();
+
+    return NULL;
+}
+
+void ARTSPConnection::receiveThread() {
+    Mutex::Autolock autoLock(mReceiveLock);
+
+    for (;;) {
+        while (!mReceiveThreadExitPending && mReceiveSocket < 0) {
+            mReceiveCondition.wait(mReceiveLock);
+        }
+
+        if (mReceiveThreadExitPending) {
+            break;
+        }
+
+        int s = mReceiveSocket;
+        int wakeFd = mReceiveWakePipe[0];
+        mReceiveSelecting = true;
+
+        mReceiveLock.unlock();
+
+        fd_set rs;
+        FD_ZERO(&rs);
+        FD_SET(s, &rs);
+        FD_SET(wakeFd, &rs);
+
+        int res = select((s > wakeFd ? s : wakeFd) + 1, &rs, NULL, NULL, NULL);
+        bool interrupted = (res < 0 && errno == EINTR);
+
+        if (res > 0 && FD_ISSET(wakeFd, &rs)) {
+            char tmp[16];
+            while (read(wakeFd, tmp, sizeof(tmp)) > 0) {
+            }
+        }
+
+        mReceiveLock.lock();
+
+        mReceiveSelecting = false;
+        mReceiveCondition.broadcast();
+
+        if (mReceiveSocket != s || interrupted
+                || (res > 0 && !FD_ISSET(s, &rs))) {
+            continue;
+        }
+
+        // The socket is readable, or select() failed and recv() will tell
+        // why. Either way it's the looper's turn until it re-arms us.
+        mReceiveSocket = -1;
+
+        sp<AMessage> msg = new AMessage(kWhatReceiveResponse, id());
+        msg->post();
+    }
+}
+
+void ARTSPConnection::resetReceiveBuffer() {
+    // Packets handed out may still point into the current block, so it
+    // isn't rewound here, ensureReceiveBufferCapacity takes care of that.
+    mReceiveBufferOffset = mReceiveBufferSize;
+}
+
+bool ARTSPConnection::ensureReceiveBufferCapacity(size_t capacity) {
+    if (mReceiveBlock != NULL
+            && mReceiveBufferOffset + capacity <= mReceiveBlock->capacity()) {
+        return true;
+    }
+
+    size_t pending = mReceiveBufferSize - mReceiveBufferOffset;
+
+    if (mReceiveBlock != NULL && mReceiveBlock->getStrongCount() == 1
+            && capacity <= mReceiveBlock->capacity()) {
+        // Nobody else refers to this block, move whatever partial message
+        // is left to the front.
+        memmove(mReceiveBlock->base(),
+                mReceiveBlock->base() + mReceiveBufferOffset,
+                pending);
+
+        mReceiveBufferOffset = 0;
+        mReceiveBufferSize = pending;
+
+        return true;
+    }
+
+    sp<ABuffer> block;
+    for (size_t i = 0; i < mReceiveBlocks.size(); ++i) {
+        const sp<ABuffer> &candidate = mReceiveBlocks.itemAt(i);
+
+        // Only mReceiveBlocks holds on to a block that's free.
+        if (candidate->getStrongCount() == 1
+                && candidate->capacity() >= capacity) {
+            block = candidate;
+            mReceiveBlocks.removeAt(i);
+            break;
+        }
+    }
+
+    if (block == NULL) {
+        if (capacity < kReceiveBufferSize) {
+            capacity = kReceiveBufferSize;
+        }
+
+        block = new ABuffer(capacity);
+
+        if (block->base() == NULL) {
+            ALOGE("Unable to allocate %zu byte receive buffer.", capacity);
+            return false;
+        }
+    }
+
+    if (mReceiveBlock != NULL) {
+        memcpy(block->base(),
+               mReceiveBlock->base() + mReceiveBufferOffset,
+               pending);
+
+        if (mReceiveBlocks.size() < kMaxReceiveBlocks) {
+            mReceiveBlocks.push(mReceiveBlock);
+        }
+    }
+
+    mReceiveBlock = block;
+    mReceiveBufferOffset = 0;
+    mReceiveBufferSize = pending;
+
+    return true;
+}
+
+status_t ARTSPConnection::fillReceiveBuffer(size_t *numBytesRead) {
+    *numBytesRead = 0;
+
+    if (!ensureReceiveBufferCapacity(
+                mReceiveBufferSize - mReceiveBufferOffset + kMinReceiveSpace)) {
+        performDisconnect();
+        return NO_MEMORY;
+    }
+
+    uint8_t *base = mReceiveBlock->base();
+    size_t capacity = mReceiveBlock->capacity();
+
+    while (mReceiveBufferSize < capacity) {
+        size_t maxBytes = capacity - mReceiveBufferSize;
+
+        ssize_t n = recv(mSocket, base + mReceiveBufferSize, maxBytes, 0);
 
         if (n < 0 && errno == EINTR) {
             continue;
         }
 
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
         if (n <= 0) {
             performDisconnect();
 
@@ -544,99 +797,175 @@ status_t ARTSPConnection::receive(void *data, size_t size) {
             }
         }
 
-        offset += (size_t)n;
+        mReceiveBufferSize += (size_t)n;
+        *numBytesRead += (size_t)n;
+
+        if ((size_t)n < maxBytes) {
+            // The socket has been drained, save ourselves another syscall.
+            break;
+        }
     }
 
     return OK;
 }
 
-bool ARTSPConnection::receiveLine(AString *line) {
-    line->clear();
+bool ARTSPConnection::processReceivedData() {
+    sp<ARTPPacketBatch> batch;
 
-    bool sawCR = false;
-    for (;;) {
-        char c;
-        if (receive(&c, 1) != OK) {
-            return false;
+    bool success = true;
+    while (mState == CONNECTED
+            && mReceiveBufferOffset < mReceiveBufferSize) {
+        const uint8_t *data = mReceiveBlock->base() + mReceiveBufferOffset;
+        size_t size = mReceiveBufferSize - mReceiveBufferOffset;
+
+        if (data[0] == '$') {
+            // Interleaved binary data: '$', channel, 16-bit length, payload.
+
+            if (size < 4) {
+                break;
+            }
+
+            size_t length = (data[2] << 8) | data[3];
+
+            if (size < 4 + length) {
+                if (!ensureReceiveBufferCapacity(4 + length)) {
+                    success = false;
+                }
+                break;
+            }
+
+            sp<ABuffer> buffer = new ReceivedPacket(
+                    mReceiveBlock, mReceiveBufferOffset + 4, length);
+            buffer->meta()->setInt32("index", (int32_t)data[1]);
+
+            if (batch == NULL) {
+                batch = new ARTPPacketBatch;
+            }
+            batch->mPackets.push(buffer);
+
+            mReceiveBufferOffset += 4 + length;
+            continue;
         }
 
-        if (sawCR && c == '\n') {
-            line->erase(line->size() - 1, 1);
-            return true;
+        sp<ARTSPResponse> response;
+        ssize_t n = parseRTSPMessage(data, size, &response);
+
+        if (n < 0) {
+            success = false;
+            break;
+        } else if (n == 0) {
+            break;
         }
 
-        line->append(&c, 1);
+        mReceiveBufferOffset += (size_t)n;
 
-        if (c == '$' && line->size() == 1) {
-            // Special-case for interleaved binary data.
-            return true;
+        // Deliver any binary data that preceded this message first to
+        // preserve the order in which things arrived on the wire.
+        if (batch != NULL) {
+            notifyBinaryData(batch);
+            batch.clear();
         }
 
-        sawCR = (c == '\r');
+        if (!handleRTSPMessage(response)) {
+            success = false;
+            break;
+        }
     }
-}
 
-sp<ABuffer> ARTSPConnection::receiveBinaryData() {
-    uint8_t x[3];
-    if (receive(x, 3) != OK) {
-        return NULL;
+    if (batch != NULL) {
+        notifyBinaryData(batch);
     }
 
-    sp<ABuffer> buffer = new ABuffer((x[1] << 8) | x[2]);
-    if (receive(buffer->data(), buffer->size()) != OK) {
-        return NULL;
+    return success;
+}
+
+void ARTSPConnection::notifyBinaryData(const sp<ARTPPacketBatch> &batch) {
+    if (mObserveBinaryMessage == NULL) {
+        ALOGW("received binary data, but no one cares.");
+        return;
     }
 
-    buffer->meta()->setInt32("index", (int32_t)x[0]);
+    sp<AMessage> notify = mObserveBinaryMessage->dup();
+    notify->setObject("batch", batch);
+    notify->post();
+}
+
+// Returns the offset of the first CRLF in data[0, size) or -1 if there's none.
+static ssize_t FindCRLF(const uint8_t *data, size_t size) {
+    const uint8_t *end = data + size;
+
+    const uint8_t *ptr = data;
+    while (ptr + 1 < end) {
+        const uint8_t *cr =
+            (const uint8_t *)memchr(ptr, '\r', end - ptr - 1);
+
+        if (cr == NULL) {
+            break;
+        }
+
+        if (cr[1] == '\n') {
+            return cr - data;
+        }
+
+        ptr = cr + 1;
+    }
 
-    return buffer;
+    return -1;
 }
 
 static bool IsRTSPVersion(const AString &s) {
     return s == "RTSP/1.0";
 }
 
-bool ARTSPConnection::receiveRTSPReponse() {
-    AString statusLine;
+ssize_t ARTSPConnection::parseRTSPMessage(
+        const uint8_t *data, size_t size, sp<ARTSPResponse> *out) {
+    // Don't bother parsing anything until the complete header is here.
+    size_t headerSize = 0;
+    for (;;) {
+        ssize_t lineLength =
+            FindCRLF(data + headerSize, size - headerSize);
+
+        if (lineLength < 0) {
+            if (size >= kReceiveBufferSize) {
+                ALOGE("RTSP message header exceeds %d bytes.",
+                      kReceiveBufferSize);
+                return -1;
+            }
 
-    if (!receiveLine(&statusLine)) {
-        return false;
-    }
+            return 0;
+        }
 
-    if (statusLine == "$") {
-        sp<ABuffer> buffer = receiveBinaryData();
+        headerSize += lineLength + 2;
 
-        if (buffer == NULL) {
-            return false;
+        if (lineLength == 0 && headerSize > 2) {
+            // The empty line terminating the header.
+            break;
         }
 
-        if (mObserveBinaryMessage != NULL) {
-            sp<AMessage> notify = mObserveBinaryMessage->dup();
-            notify->setBuffer("buffer", buffer);
-            notify->post();
-        } else {
-            ALOGW("received binary data, but no one cares.");
+        if (headerSize == 2) {
+            // An empty status line.
+            return -1;
         }
-
-        return true;
     }
 
+    const char *header = (const char *)data;
+
+    size_t lineLength = FindCRLF(data, headerSize);
+
     sp<ARTSPResponse> response = new ARTSPResponse;
-    response->mStatusLine = statusLine;
+    response->mStatusLine.setTo(header, lineLength);
 
     ALOGI("status: %s", response->mStatusLine.c_str());
 
     ssize_t space1 = response->mStatusLine.find(" ");
     if (space1 < 0) {
-        return false;
+        return -1;
     }
     ssize_t space2 = response->mStatusLine.find(" ", space1 + 1);
     if (space2 < 0) {
-        return false;
+        return -1;
     }
 
-    bool isRequest = false;
-
     if (!IsRTSPVersion(AString(response->mStatusLine, 0, space1))) {
         CHECK(IsRTSPVersion(
                     AString(
@@ -644,8 +973,6 @@ bool ARTSPConnection::receiveRTSPReponse() {
                         space2 + 1,
                         response->mStatusLine.size() - space2 - 1)));
 
-        isRequest = true;
-
         response->mStatusCode = 0;
     } else {
         AString statusCodeStr(
@@ -654,21 +981,24 @@ bool ARTSPConnection::receiveRTSPReponse() {
         if (!ParseSingleUnsignedLong(
                     statusCodeStr.c_str(), &response->mStatusCode)
                 || response->mStatusCode < 100 || response->mStatusCode > 999) {
-            return false;
+            return -1;
         }
     }
 
+    size_t offset = lineLength + 2;
+
     AString line;
     ssize_t lastDictIndex = -1;
     for (;;) {
-        if (!receiveLine(&line)) {
-            break;
-        }
+        lineLength = FindCRLF(data + offset, headerSize - offset);
 
-        if (line.empty()) {
+        if (lineLength == 0) {
             break;
         }
 
+        line.setTo(header + offset, lineLength);
+        offset += lineLength + 2;
+
         ALOGV("line: '%s'", line.c_str());
 
         if (line.c_str()[0] == ' ' || line.c_str()[0] == '\t') {
@@ -676,7 +1006,7 @@ bool ARTSPConnection::receiveRTSPReponse() {
 
             if (lastDictIndex < 0) {
                 // First line cannot be a continuation of the previous one.
-                return false;
+                return -1;
             }
 
             AString &value = response->mHeaders.editValueAt(lastDictIndex);
@@ -688,7 +1018,7 @@ bool ARTSPConnection::receiveRTSPReponse() {
         ssize_t colonPos = line.find(":");
         if (colonPos < 0) {
             // Malformed header line.
-            return false;
+            return -1;
         }
 
         AString key(line, 0, colonPos);
@@ -711,18 +1041,32 @@ bool ARTSPConnection::receiveRTSPReponse() {
     if (i >= 0) {
         AString value = response->mHeaders.valueAt(i);
         if (!ParseSingleUnsignedLong(value.c_str(), &contentLength)) {
-            return false;
+            return -1;
+        }
+    }
+
+    if (size < headerSize + contentLength) {
+        // Make sure the body will fit once it arrives.
+        if (!ensureReceiveBufferCapacity(headerSize + contentLength)) {
+            return -1;
         }
+
+        return 0;
     }
 
     if (contentLength > 0) {
         response->mContent = new ABuffer(contentLength);
-
-        if (receive(response->mContent->data(), contentLength) != OK) {
-            return false;
-        }
+        memcpy(response->mContent->data(), data + headerSize, contentLength);
     }
 
+    *out = response;
+
+    return headerSize + contentLength;
+}
+
+bool ARTSPConnection::handleRTSPMessage(const sp<ARTSPResponse> &response) {
+    bool isRequest = (response->mStatusCode == 0);
+
     if (response->mStatusCode == 401) {
         if (mAuthType == NONE && mUser.size() > 0
                 && parseAuthMethod(response)) {
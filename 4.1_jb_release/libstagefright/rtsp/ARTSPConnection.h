@@ -20,10 +20,15 @@
 
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/foundation/AString.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <pthread.h>
 
 namespace android {
 
 struct ABuffer;
+struct ARTPPacketBatch;
 
 struct ARTSPResponse : public RefBase {
     unsigned long mStatusCode;
@@ -72,6 +77,18 @@ private:
         DIGEST
     };
 
+    enum {
+        // Size of a receive block, a larger one is used if a single
+        // message (i.e. a large response body) doesn't fit.
+        kReceiveBufferSize = 65536,
+
+        // Least amount of free space to read into.
+        kMinReceiveSpace = 16384,
+
+        // Number of blocks kept around for reuse.
+        kMaxReceiveBlocks = 8,
+    };
+
     static const int64_t kSelectTimeoutUs;
 
     bool mUIDValid;
@@ -83,7 +100,30 @@ private:
     int mSocket;
     int32_t mConnectionID;
     int32_t mNextCSeq;
-    bool mReceiveResponseEventPending;
+
+    // Data received from the socket but not yet parsed lives in
+    // mReceiveBlock[mReceiveBufferOffset, mReceiveBufferSize).
+    // Interleaved packets are handed out as slices of the block they
+    // arrived in and keep it alive, so a block is only rewound once
+    // nobody else refers to it. Retired blocks wait in mReceiveBlocks
+    // for their slices to go away.
+    sp<ABuffer> mReceiveBlock;
+    Vector<sp<ABuffer> > mReceiveBlocks;
+    size_t mReceiveBufferOffset;
+    size_t mReceiveBufferSize;
+
+    // The receive thread waits for mReceiveSocket to become readable and
+    // then posts a single kWhatReceiveResponse. It is disarmed (-1) until
+    // that has been handled. mReceiveWakePipe gets it out of select()
+    // when the socket is about to be closed.
+    Mutex mReceiveLock;
+    Condition mReceiveCondition;
+    pthread_t mReceiveThread;
+    bool mReceiveThreadStarted;
+    bool mReceiveThreadExitPending;
+    bool mReceiveSelecting;
+    int mReceiveSocket;
+    int mReceiveWakePipe[2];
 
     KeyedVector<int32_t, sp<AMessage> > mPendingRequests;
 
@@ -100,14 +140,40 @@ private:
     void onReceiveResponse();
 
     void flushPendingRequests();
-    void postReceiveReponseEvent();
 
+    status_t startReceiveThread();
+    void stopReceiveThread();
+    void armReceiveThread();
+    void disarmReceiveThread();
+
+    static void *ReceiveThreadWrapper(void *me);
+    void receiveThread();
+
+    void resetReceiveBuffer();
+
+    // Makes sure the unparsed data can grow to "capacity" bytes without
+    // touching anything that has been handed out.
+    bool ensureReceiveBufferCapacity(size_t capacity);
+
+    // Reads as much as the socket has available without blocking.
+    status_t fillReceiveBuffer(size_t *numBytesRead);
+
+    // Parses and dispatches all complete RTSP messages and interleaved
+    // frames in the receive buffer.
     // Return false iff something went unrecoverably wrong.
-    bool receiveRTSPReponse();
-    status_t receive(void *data, size_t size);
-    bool receiveLine(AString *line);
-    sp<ABuffer> receiveBinaryData();
+    bool processReceivedData();
+
+    // Parses a single RTSP message from the front of "data". Returns the
+    // number of bytes it occupies, 0 if it is incomplete or -1 if it is
+    // malformed.
+    ssize_t parseRTSPMessage(
+            const uint8_t *data, size_t size, sp<ARTSPResponse> *response);
+
+    // Return false iff something went unrecoverably wrong.
+    bool handleRTSPMessage(const sp<ARTSPResponse> &response);
+
     bool notifyResponseListener(const sp<ARTSPResponse> &response);
+    void notifyBinaryData(const sp<ARTPPacketBatch> &batch);
 
     bool parseAuthMethod(const sp<ARTSPResponse> &response);
     void addAuthentication(AString *request);
@@ -1007,13 +1007,11 @@ struct MyHandler : public AHandler {
 
             case 'biny':
             {
-                sp<ABuffer> buffer;
-                CHECK(msg->findBuffer("buffer", &buffer));
+                sp<RefBase> obj;
+                CHECK(msg->findObject("batch", &obj));
 
-                int32_t index;
-                CHECK(buffer->meta()->findInt32("index", &index));
-
-                mRTPConn->injectPacket(index, buffer);
+                mRTPConn->injectPackets(
+                        static_cast<ARTPPacketBatch *>(obj.get()));
                 break;
             }
 
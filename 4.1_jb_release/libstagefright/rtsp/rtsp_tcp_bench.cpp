@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how fast ARTSPConnection can pull RTP packets interleaved on the
+// RTSP control connection ("RTSP over TCP") out of a local stand-in server.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "rtsp_tcp_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <utils/threads.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ARTPConnection.h"
+#include "ARTSPConnection.h"
+
+using namespace android;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+struct StandInServer {
+    int mListenSocket;
+    unsigned mPort;
+    size_t mNumPackets;
+    size_t mMinPacketSize;
+    size_t mMaxPacketSize;
+};
+
+static bool sendAll(int s, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(s, data, size, 0);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return false;
+        }
+
+        data += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+// Answers a single request and then streams the requested number of RTP
+// and RTCP packets on interleaved channels 0 and 1.
+static void *ServerThread(void *cookie) {
+    StandInServer *server = (StandInServer *)cookie;
+
+    int s = accept(server->mListenSocket, NULL, NULL);
+    CHECK_GE(s, 0);
+
+    AString request;
+    while (request.find("\r\n\r\n") < 0) {
+        char tmp[512];
+        ssize_t n = recv(s, tmp, sizeof(tmp), 0);
+        CHECK_GT(n, 0);
+
+        request.append(tmp, n);
+    }
+
+    ssize_t i = request.find("CSeq: ");
+    CHECK_GE(i, 0);
+
+    AString response = "RTSP/1.0 200 OK\r\n";
+    response.append(AString(request, i, request.find("\r\n", i) - i + 2));
+    response.append("Session: 1\r\n\r\n");
+
+    CHECK(sendAll(s, (const uint8_t *)response.c_str(), response.size()));
+
+    // Write packets in large chunks so the server isn't the bottleneck.
+    static const size_t kChunkSize = 256 * 1024;
+    uint8_t *chunk = (uint8_t *)malloc(kChunkSize);
+    CHECK(chunk != NULL);
+
+    size_t chunkSize = 0;
+    for (size_t i = 0; i < server->mNumPackets; ++i) {
+        size_t size = server->mMinPacketSize;
+        if (server->mMaxPacketSize > server->mMinPacketSize) {
+            size += rand() % (server->mMaxPacketSize - size + 1);
+        }
+
+        if (chunkSize + 4 + size > kChunkSize) {
+            CHECK(sendAll(s, chunk, chunkSize));
+            chunkSize = 0;
+        }
+
+        uint8_t *ptr = &chunk[chunkSize];
+        ptr[0] = '$';
+        ptr[1] = (i % 32 == 31) ? 1 : 0;
+        ptr[2] = size >> 8;
+        ptr[3] = size & 0xff;
+        memset(&ptr[4], i & 0xff, size);
+
+        chunkSize += 4 + size;
+    }
+
+    if (chunkSize > 0) {
+        CHECK(sendAll(s, chunk, chunkSize));
+    }
+
+    free(chunk);
+    chunk = NULL;
+
+    close(s);
+    s = -1;
+
+    return NULL;
+}
+
+// Packets are received in place and recycled once released, so hold on to
+// the most recent ones for a while, the way the assemblers do, and make
+// sure they are still intact when they are let go.
+static const size_t kNumHeldPackets = 512;
+
+static void checkPacket(const sp<ABuffer> &buffer) {
+    const uint8_t *data = buffer->data();
+    size_t size = buffer->size();
+
+    CHECK_GT(size, 0u);
+    CHECK_EQ(data[size / 2], data[0]);
+    CHECK_EQ(data[size - 1], data[0]);
+}
+
+struct BenchHandler : public AHandler {
+    BenchHandler(const sp<ARTSPConnection> &conn, const char *url,
+                 size_t numPackets)
+        : mConn(conn),
+          mURL(url),
+          mNumPackets(numPackets),
+          mNumPacketsReceived(0),
+          mNumBytesReceived(0),
+          mNumBatches(0),
+          mStartTimeUs(-1),
+          mEndTimeUs(-1),
+          mDone(false) {
+    }
+
+    void start() {
+        mConn->observeBinaryData(new AMessage('biny', id()));
+        mConn->connect(mURL.c_str(), new AMessage('conn', id()));
+    }
+
+    void waitForCompletion() {
+        Mutex::Autolock autoLock(mLock);
+        while (!mDone) {
+            mCondition.wait(mLock);
+        }
+    }
+
+    void report() const {
+        double elapsedSecs = (mEndTimeUs - mStartTimeUs) / 1E6;
+
+        printf("%d packets, %lld bytes in %.3f secs\n",
+               mNumPacketsReceived, mNumBytesReceived, elapsedSecs);
+
+        printf("%.0f packets/sec, %.2f MBytes/sec, %.1f packets/batch\n",
+               mNumPacketsReceived / elapsedSecs,
+               mNumBytesReceived / elapsedSecs / 1E6,
+               (double)mNumPacketsReceived / mNumBatches);
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        switch (msg->what()) {
+            case 'conn':
+            {
+                int32_t result;
+                CHECK(msg->findInt32("result", &result));
+                CHECK_EQ(result, (status_t)OK);
+
+                AString request = "PLAY ";
+                request.append(mURL);
+                request.append(" RTSP/1.0\r\n\r\n");
+
+                mStartTimeUs = getNowUs();
+                mConn->sendRequest(request.c_str(), new AMessage('play', id()));
+                break;
+            }
+
+            case 'play':
+            {
+                int32_t result;
+                CHECK(msg->findInt32("result", &result));
+                CHECK_EQ(result, (status_t)OK);
+                break;
+            }
+
+            case 'biny':
+            {
+                sp<RefBase> obj;
+                CHECK(msg->findObject("batch", &obj));
+
+                sp<ARTPPacketBatch> batch =
+                    static_cast<ARTPPacketBatch *>(obj.get());
+
+                for (size_t i = 0; i < batch->mPackets.size(); ++i) {
+                    const sp<ABuffer> &buffer = batch->mPackets.itemAt(i);
+                    mNumBytesReceived += buffer->size();
+
+                    sp<ABuffer> &held =
+                        mHeldPackets[(mNumPacketsReceived + i) % kNumHeldPackets];
+
+                    if (held != NULL) {
+                        checkPacket(held);
+                    }
+                    held = buffer;
+                }
+
+                mNumPacketsReceived += batch->mPackets.size();
+                ++mNumBatches;
+
+                if (mNumPacketsReceived == mNumPackets) {
+                    mEndTimeUs = getNowUs();
+
+                    Mutex::Autolock autoLock(mLock);
+                    mDone = true;
+                    mCondition.signal();
+                }
+                break;
+            }
+
+            default:
+                TRESPASS();
+                break;
+        }
+    }
+
+private:
+    sp<ARTSPConnection> mConn;
+    AString mURL;
+    size_t mNumPackets;
+    size_t mNumPacketsReceived;
+    long long mNumBytesReceived;
+    size_t mNumBatches;
+    int64_t mStartTimeUs;
+    int64_t mEndTimeUs;
+
+    sp<ABuffer> mHeldPackets[kNumHeldPackets];
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mDone;
+
+    DISALLOW_EVIL_CONSTRUCTORS(BenchHandler);
+};
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-n numPackets] [-s minSize[:maxSize]]\n", me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    StandInServer server;
+    server.mNumPackets = 200000;
+    server.mMinPacketSize = 1200;
+    server.mMaxPacketSize = 1400;
+
+    int res;
+    while ((res = getopt(argc, argv, "n:s:")) >= 0) {
+        switch (res) {
+            case 'n':
+            {
+                server.mNumPackets = atoi(optarg);
+                break;
+            }
+
+            case 's':
+            {
+                char *end;
+                server.mMinPacketSize = strtoul(optarg, &end, 10);
+                server.mMaxPacketSize =
+                    (*end == ':') ? strtoul(end + 1, NULL, 10)
+                                  : server.mMinPacketSize;
+                break;
+            }
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (server.mNumPackets == 0
+            || server.mMinPacketSize > server.mMaxPacketSize
+            || server.mMaxPacketSize > 65535) {
+        usage(argv[0]);
+    }
+
+    server.mListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_GE(server.mListenSocket, 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    CHECK_EQ(bind(server.mListenSocket,
+                  (const struct sockaddr *)&addr, sizeof(addr)), 0);
+    CHECK_EQ(listen(server.mListenSocket, 1), 0);
+
+    socklen_t addrLen = sizeof(addr);
+    CHECK_EQ(getsockname(server.mListenSocket,
+                         (struct sockaddr *)&addr, &addrLen), 0);
+    server.mPort = ntohs(addr.sin_port);
+
+    pthread_t serverThread;
+    CHECK_EQ(pthread_create(&serverThread, NULL, ServerThread, &server), 0);
+
+    AString url = StringPrintf("rtsp://127.0.0.1:%u/bench", server.mPort);
+
+    sp<ALooper> looper = new ALooper;
+    looper->setName("rtsp_tcp_bench");
+
+    sp<ARTSPConnection> conn = new ARTSPConnection;
+    looper->registerHandler(conn);
+
+    sp<BenchHandler> handler =
+        new BenchHandler(conn, url.c_str(), server.mNumPackets);
+    looper->registerHandler(handler);
+
+    looper->start();
+
+    handler->start();
+    handler->waitForCompletion();
+    handler->report();
+
+    looper->stop();
+
+    pthread_join(serverThread, NULL);
+
+    close(server.mListenSocket);
+    server.mListenSocket = -1;
+
+    return 0;
+}
@@ -43,6 +43,147 @@ include $(BUILD_EXECUTABLE)
 
 endif
 
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        flac_seek_bench.cpp     \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation
+
+LOCAL_STATIC_LIBRARIES := \
+        libFLAC
+
+LOCAL_C_INCLUDES:= \
+	external/flac/include \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= flac_seek_bench
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        aac_open_bench.cpp      \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= aac_open_bench
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        wav_convert_bench.cpp   \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= wav_convert_bench
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        time_stretch_bench.cpp  \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= time_stretch_bench
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        audio_player_bench.cpp  \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libcutils libmedia libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= audio_player_bench
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        audio_source_bench.cpp  \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libmedia libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= audio_source_bench
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        codec_component_bench.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright liblog libutils libbinder libgui libmedia \
+	libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_MODULE_TAGS := debug
+
+LOCAL_MODULE:= codec_component_bench
+
+include $(BUILD_EXECUTABLE)
+
 # Include subdirectory makefiles
 # ============================================================
 
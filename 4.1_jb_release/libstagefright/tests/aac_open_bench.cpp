@@ -0,0 +1,489 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Builds ADTS streams of various lengths, serves them from a stand-in for
+// an HTTP server and reports what opening them with AACExtractor costs, how
+// close the reported duration is, and what random seeks cost and whether
+// they land on the right frame. Once the index is complete the duration
+// has to be exact. With -g there is garbage between some of the frames.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "aac_open_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/threads.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/AACExtractor.h"
+
+using namespace android;
+
+static const unsigned kSampleRate = 44100;
+static const unsigned kSampleRateIndex = 4;
+static const unsigned kNumChannels = 2;
+
+static const size_t kID3v2Size = 1024;
+static const size_t kID3v1Size = 128;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+static uint32_t hash(uint32_t x) {
+    x *= 2654435761u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    return x;
+}
+
+struct MemoryFile {
+    MemoryFile()
+        : mData(NULL),
+          mSize(0),
+          mNumFrames(0) {
+    }
+
+    ~MemoryFile() {
+        free(mData);
+    }
+
+    uint8_t *mData;
+    size_t mSize;
+    uint32_t mNumFrames;
+
+    DISALLOW_EVIL_CONSTRUCTORS(MemoryFile);
+};
+
+static const size_t kMaxGarbageSize = 1200;
+
+// Whether garbage goes in front of the given frame, with -g. There are at
+// least four frames in between: after garbage the index only takes a frame
+// that a few more follow.
+static bool hasGarbage(uint32_t frame) {
+    return frame > 0 && (frame & 3) == 0 && (hash(frame + 0x20000) & 63) == 0;
+}
+
+// Writes a few hundred bytes of noise, like a damaged or spliced stream
+// has, with ADTS syncwords and plausible frame lengths in it. The rest of
+// those headers is noise too. The noise comes first, a header right where
+// a frame ends can't be told from a real one.
+static uint8_t *writeGarbage(uint32_t frame, uint8_t *p) {
+    size_t size = 200 + hash(frame + 0x30000) % (kMaxGarbageSize - 200);
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = hash(frame * 4099 + i);
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        uint8_t *q = p + 1 + hash(frame + i) % (size - 7);
+        size_t frameSize = 7 + hash(frame + i + 0x40000) % 8184;
+        q[0] = 0xff;
+        q[1] = 0xf0 | (q[1] & 0x09);
+        q[3] = (q[3] & 0xfc) | ((frameSize >> 11) & 3);
+        q[4] = (frameSize >> 3) & 0xff;
+        q[5] = ((frameSize & 7) << 5) | 0x1f;
+    }
+    return p + size;
+}
+
+// Frames vary in size around 128 kbps the way AAC frames do, some carry a
+// CRC. Each payload starts with the frame number so that a seek can be
+// checked, the rest is noise. An ID3v2 tag precedes the stream and an
+// ID3v1 tag follows it.
+static void makeStream(int64_t durationSecs, bool garbage, MemoryFile *file) {
+    uint32_t numFrames = durationSecs * kSampleRate / 1024;
+    size_t capacity = kID3v2Size + numFrames * 600 + kID3v1Size;
+    if (garbage) {
+        for (uint32_t i = 0; i < numFrames; ++i) {
+            if (hasGarbage(i)) {
+                capacity += kMaxGarbageSize;
+            }
+        }
+    }
+    file->mData = (uint8_t *)malloc(capacity);
+    CHECK(file->mData != NULL);
+    file->mNumFrames = numFrames;
+
+    uint8_t *p = file->mData;
+    memset(p, 0, kID3v2Size);
+    memcpy(p, "ID3\x03\x00\x00", 6);
+    size_t tagSize = kID3v2Size - 10;
+    p[6] = (tagSize >> 21) & 0x7f;
+    p[7] = (tagSize >> 14) & 0x7f;
+    p[8] = (tagSize >> 7) & 0x7f;
+    p[9] = tagSize & 0x7f;
+    p += kID3v2Size;
+
+    for (uint32_t i = 0; i < numFrames; ++i) {
+        if (garbage && hasGarbage(i)) {
+            p = writeGarbage(i, p);
+        }
+
+        bool crc = (hash(i) & 7) == 0;
+        size_t headerSize = crc ? 9 : 7;
+        size_t frameSize = 250 + hash(i + 0x10000) % 250;
+
+        p[0] = 0xff;
+        p[1] = 0xf0 | (crc ? 0 : 1);
+        p[2] = (1 << 6) | (kSampleRateIndex << 2) | (kNumChannels >> 2);
+        p[3] = ((kNumChannels & 3) << 6) | ((frameSize >> 11) & 3);
+        p[4] = (frameSize >> 3) & 0xff;
+        p[5] = ((frameSize & 7) << 5) | 0x1f;
+        p[6] = 0xfc;
+        if (crc) {
+            p[7] = p[8] = 0;
+        }
+
+        uint8_t *payload = p + headerSize;
+        payload[0] = i >> 24;
+        payload[1] = i >> 16;
+        payload[2] = i >> 8;
+        payload[3] = i;
+        for (size_t j = 4; j < frameSize - headerSize; ++j) {
+            payload[j] = hash(i * 8191 + j);
+        }
+
+        p += frameSize;
+    }
+
+    memset(p, ' ', kID3v1Size);
+    memcpy(p, "TAG", 3);
+    p += kID3v1Size;
+
+    file->mSize = p - file->mData;
+    CHECK_LE(file->mSize, capacity);
+}
+
+// Stands in for a server answering HTTP range requests over a link with
+// the given round trip time and rate: any read that doesn't continue where
+// the last one left off is a new request. Rather than sleeping, the time
+// the link would have taken is added up.
+struct StandInHTTPSource : public DataSource {
+    StandInHTTPSource(
+            const MemoryFile *file, int64_t roundTripUs, int64_t rateKbps,
+            bool caching)
+        : mFile(file),
+          mRoundTripUs(roundTripUs),
+          mRateKbps(rateKbps),
+          mCaching(caching),
+          mNextOffset(-1),
+          mNumReads(0),
+          mNumRequests(0),
+          mNumBytes(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        Mutex::Autolock autoLock(mLock);
+
+        if (offset < 0) {
+            return ERROR_IO;
+        }
+        if ((uint64_t)offset >= mFile->mSize) {
+            return 0;
+        }
+        if (size > mFile->mSize - offset) {
+            size = mFile->mSize - offset;
+        }
+        memcpy(data, mFile->mData + offset, size);
+
+        ++mNumReads;
+        if (offset != mNextOffset) {
+            ++mNumRequests;
+        }
+        mNumBytes += size;
+        mNextOffset = offset + size;
+
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mFile->mSize;
+        return OK;
+    }
+
+    // Passing for a caching source keeps the extractor from scanning.
+    virtual uint32_t flags() {
+        return mCaching ? kIsCachingDataSource | kIsHTTPBasedSource : 0;
+    }
+
+    struct Counters {
+        size_t mNumReads;
+        size_t mNumRequests;
+        int64_t mNumBytes;
+    };
+
+    Counters counters() {
+        Mutex::Autolock autoLock(mLock);
+
+        Counters counters;
+        counters.mNumReads = mNumReads;
+        counters.mNumRequests = mNumRequests;
+        counters.mNumBytes = mNumBytes;
+
+        return counters;
+    }
+
+    int64_t linkTimeUs(size_t numRequests, int64_t numBytes) const {
+        int64_t timeUs = numRequests * mRoundTripUs;
+        if (mRateKbps > 0) {
+            timeUs += numBytes * 8000ll / mRateKbps;
+        }
+        return timeUs;
+    }
+
+private:
+    const MemoryFile *mFile;
+    int64_t mRoundTripUs;
+    int64_t mRateKbps;
+    bool mCaching;
+
+    Mutex mLock;
+    off64_t mNextOffset;
+    size_t mNumReads;
+    size_t mNumRequests;
+    int64_t mNumBytes;
+
+    DISALLOW_EVIL_CONSTRUCTORS(StandInHTTPSource);
+};
+
+struct Options {
+    size_t mNumSeeks;
+    int64_t mRoundTripUs;
+    int64_t mRateKbps;
+    bool mCaching;
+    bool mGarbage;
+};
+
+static int64_t frameDurationUs() {
+    return (1024 * 1000000ll + kSampleRate - 1) / kSampleRate;
+}
+
+// Checks that the buffer holds the payload of the given frame.
+static bool isExact(MediaBuffer *buffer, uint32_t frame) {
+    int64_t timeUs;
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+    if (timeUs != frame * frameDurationUs()) {
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t *)buffer->data() + buffer->range_offset();
+    if (buffer->range_length() < 4) {
+        return false;
+    }
+    uint32_t n = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+
+    return n == frame;
+}
+
+static void runOne(
+        const MemoryFile &file, int64_t durationSecs, const Options &opts) {
+    sp<StandInHTTPSource> source = new StandInHTTPSource(
+            &file, opts.mRoundTripUs, opts.mRateKbps, opts.mCaching);
+
+    int64_t startUs = getNowUs();
+    sp<AACExtractor> extractor = new AACExtractor(source, NULL);
+    CHECK_EQ(extractor->countTracks(), 1u);
+    int64_t openUs = getNowUs() - startUs;
+    StandInHTTPSource::Counters opened = source->counters();
+
+    int64_t durationUs;
+    CHECK(extractor->getTrackMetaData(0, 0)->findInt64(kKeyDuration, &durationUs));
+    int64_t actualUs = file.mNumFrames * frameDurationUs();
+    double durationError = (durationUs - actualUs) * 100.0 / actualUs;
+
+    sp<MediaSource> track = extractor->getTrack(0);
+    CHECK_EQ(track->start(), (status_t)OK);
+
+    uint32_t seed = 1;
+
+    int64_t totalUs = 0, maxUs = 0, totalLinkUs = 0, maxLinkUs = 0;
+    int64_t totalBytes = 0;
+    size_t totalRequests = 0, numExact = 0;
+    for (size_t i = 0; i < opts.mNumSeeks; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t frame = (seed >> 1) % file.mNumFrames;
+
+        MediaSource::ReadOptions options;
+        options.setSeekTo(frame * frameDurationUs() + frameDurationUs() / 2);
+
+        StandInHTTPSource::Counters before = source->counters();
+        int64_t seekStartUs = getNowUs();
+
+        MediaBuffer *buffer;
+        CHECK_EQ(track->read(&buffer, &options), (status_t)OK);
+
+        int64_t seekUs = getNowUs() - seekStartUs;
+        StandInHTTPSource::Counters after = source->counters();
+
+        if (isExact(buffer, frame)) {
+            ++numExact;
+        }
+        buffer->release();
+
+        size_t numRequests = after.mNumRequests - before.mNumRequests;
+        int64_t numBytes = after.mNumBytes - before.mNumBytes;
+        int64_t linkUs = source->linkTimeUs(numRequests, numBytes);
+
+        totalUs += seekUs;
+        totalLinkUs += linkUs;
+        if (seekUs > maxUs) {
+            maxUs = seekUs;
+        }
+        if (linkUs > maxLinkUs) {
+            maxLinkUs = linkUs;
+        }
+        totalBytes += numBytes;
+        totalRequests += numRequests;
+    }
+
+    // The tail of the stream has to play out to its very last frame.
+    uint32_t last = file.mNumFrames - 1;
+    MediaSource::ReadOptions options;
+    options.setSeekTo(last * frameDurationUs());
+    MediaBuffer *buffer;
+    CHECK_EQ(track->read(&buffer, &options), (status_t)OK);
+    bool tailExact = isExact(buffer, last);
+    buffer->release();
+    status_t err = track->read(&buffer, NULL);
+    CHECK_EQ(err, (status_t)ERROR_END_OF_STREAM);
+
+    // Seeking past the end completes the index, if the scan hasn't.
+    options.setSeekTo((last + 1) * frameDurationUs());
+    err = track->read(&buffer, &options);
+    CHECK_EQ(err, (status_t)ERROR_END_OF_STREAM);
+    CHECK(track->getFormat()->findInt64(kKeyDuration, &durationUs));
+    bool durationExact = durationUs == actualUs;
+
+    track->stop();
+    track.clear();
+    extractor.clear();
+
+    double n = opts.mNumSeeks;
+    printf("%6lld %6.1f %8.1f %7.1f %6u %6.2f %7.2f %7.2f %7.1f %7.1f %7.1f %6.1f %3u/%u %-4s %s\n",
+           (long long)durationSecs, file.mSize / 1E6,
+           openUs / 1E3, opened.mNumBytes / 1E3, (unsigned)opened.mNumReads,
+           durationError,
+           totalUs / 1E3 / n, maxUs / 1E3,
+           totalLinkUs / 1E3 / n, maxLinkUs / 1E3,
+           totalBytes / 1E3 / n, totalRequests / n,
+           (unsigned)numExact, (unsigned)opts.mNumSeeks,
+           tailExact ? "yes" : "no", durationExact ? "yes" : "no");
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-n seeks] [-l rttMs] [-r kbps] [-c] [-g] durationSecs...\n"
+            "       -n  number of random seeks per run (default 50)\n"
+            "       -l  round trip time of the simulated link (default 50)\n"
+            "       -r  rate of the simulated link, 0 is unlimited (default 2000)\n"
+            "       -c  source passes for a caching one, so there is no scan\n"
+            "       -g  put garbage with fake frame headers between some frames\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Options opts;
+    opts.mNumSeeks = 50;
+    opts.mRoundTripUs = 50000;
+    opts.mRateKbps = 2000;
+    opts.mCaching = false;
+    opts.mGarbage = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "n:l:r:cg")) >= 0) {
+        switch (res) {
+            case 'n':
+                opts.mNumSeeks = atoi(optarg);
+                break;
+
+            case 'l':
+                opts.mRoundTripUs = atoll(optarg) * 1000ll;
+                break;
+
+            case 'r':
+                opts.mRateKbps = atoll(optarg);
+                break;
+
+            case 'c':
+                opts.mCaching = true;
+                break;
+
+            case 'g':
+                opts.mGarbage = true;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (opts.mNumSeeks == 0) {
+        usage(argv[0]);
+    }
+
+    static const int64_t kDefaultDurations[] = { 60, 600, 3600 };
+
+    Vector<int64_t> durations;
+    if (argc == 0) {
+        durations.appendArray(
+                kDefaultDurations,
+                sizeof(kDefaultDurations) / sizeof(kDefaultDurations[0]));
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            int64_t durationSecs = atoll(argv[i]);
+            if (durationSecs <= 0) {
+                usage(argv[0]);
+            }
+            durations.push(durationSecs);
+        }
+    }
+
+    printf("         size     open    open   open  durat    seek     max"
+           "    link     max   bytes   reqs\n"
+           "  secs   (MB)     (ms)    (KB)  reads  err %%    (ms)    (ms)"
+           "    (ms)    (ms)    (KB)  /seek exact tail dur\n");
+
+    for (size_t i = 0; i < durations.size(); ++i) {
+        MemoryFile file;
+        makeStream(durations[i], opts.mGarbage, &file);
+
+        runOne(file, durations[i], opts);
+    }
+
+    return 0;
+}
@@ -0,0 +1,602 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Plays a synthetic source through AudioPlayer into a fake AudioSink that
+// calls back on its own clock, like the real one, and reports how long the
+// callbacks took and how often they came back late or short of audio. The
+// source stalls every so often, the way a decoder does when it is starved
+// of CPU, and the player is made to seek at regular intervals.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audio_player_bench"
+#include <utils/Log.h>
+
+#include <cutils/atomic.h>
+#include <media/MediaPlayerInterface.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/AudioPlayer.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaBufferGroup.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/threads.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace android;
+
+static const int32_t kSampleRate = 44100;
+static const int32_t kNumChannels = 2;
+static const size_t kFrameSize = kNumChannels * sizeof(int16_t);
+static const size_t kMinSilentRun = 4;
+static const size_t kFramesPerBuffer = 2048;
+
+static int64_t getNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+// A tone that never has a zero sample, so that the silence AudioPlayer
+// fills in for missing data can be told apart from it.
+struct SyntheticSource : public MediaSource {
+    SyntheticSource(int64_t durationUs, int64_t stallUs, size_t stallEvery)
+        : mNumFrames(durationUs * kSampleRate / 1000000),
+          mStallUs(stallUs),
+          mStallEvery(stallEvery),
+          mPosition(0),
+          mNumReads(0),
+          mMaxReadUs(0),
+          mNumSeeksRead(0) {
+        mGroup.add_buffer(new MediaBuffer(kFramesPerBuffer * kFrameSize));
+        mGroup.add_buffer(new MediaBuffer(kFramesPerBuffer * kFrameSize));
+    }
+
+    virtual status_t start(MetaData *params) {
+        return OK;
+    }
+
+    virtual status_t stop() {
+        return OK;
+    }
+
+    virtual sp<MetaData> getFormat() {
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_RAW);
+        meta->setInt32(kKeySampleRate, kSampleRate);
+        meta->setInt32(kKeyChannelCount, kNumChannels);
+        meta->setInt64(kKeyDuration, mNumFrames * 1000000ll / kSampleRate);
+        return meta;
+    }
+
+    virtual status_t read(
+            MediaBuffer **out, const ReadOptions *options) {
+        *out = NULL;
+
+        int64_t startUs = getNowUs();
+
+        int64_t seekTimeUs;
+        ReadOptions::SeekMode mode;
+        bool seeking = false;
+        if (options != NULL && options->getSeekTo(&seekTimeUs, &mode)) {
+            mPosition = seekTimeUs * kSampleRate / 1000000;
+            seeking = true;
+        }
+
+        if (mStallEvery > 0 && (++mNumReads % mStallEvery) == 0) {
+            usleep(mStallUs);
+        }
+
+        if (mPosition >= mNumFrames) {
+            if (seeking) {
+                android_atomic_inc(&mNumSeeksRead);
+            }
+            return ERROR_END_OF_STREAM;
+        }
+
+        MediaBuffer *buffer;
+        CHECK_EQ(mGroup.acquire_buffer(&buffer), (status_t)OK);
+
+        size_t n = kFramesPerBuffer;
+        if ((int64_t)n > mNumFrames - mPosition) {
+            n = mNumFrames - mPosition;
+        }
+
+        int16_t *data = (int16_t *)buffer->data();
+        for (size_t i = 0; i < n; ++i) {
+            int64_t t = mPosition + i;
+            int16_t x = (int16_t)(8000 * sin(2 * M_PI * 440.0 * t / kSampleRate)) | 1;
+            data[2 * i] = x;
+            data[2 * i + 1] = x;
+        }
+
+        buffer->set_range(0, n * kFrameSize);
+        buffer->meta_data()->clear();
+        buffer->meta_data()->setInt64(
+                kKeyTime, mPosition * 1000000ll / kSampleRate);
+
+        mPosition += n;
+
+        int64_t readUs = getNowUs() - startUs;
+        if (readUs > mMaxReadUs) {
+            mMaxReadUs = readUs;
+        }
+
+        *out = buffer;
+
+        if (seeking) {
+            android_atomic_inc(&mNumSeeksRead);
+        }
+        return OK;
+    }
+
+    int64_t maxReadUs() const { return mMaxReadUs; }
+
+    // Number of reads carrying a seek that have returned.
+    int32_t numSeeksRead() {
+        return android_atomic_acquire_load(&mNumSeeksRead);
+    }
+
+protected:
+    virtual ~SyntheticSource() {}
+
+private:
+    MediaBufferGroup mGroup;
+    int64_t mNumFrames;
+    int64_t mStallUs;
+    size_t mStallEvery;
+    int64_t mPosition;
+    size_t mNumReads;
+    int64_t mMaxReadUs;
+    volatile int32_t mNumSeeksRead;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SyntheticSource);
+};
+
+// Pulls a buffer every period from a thread of its own and notes how long
+// each callback took and whether it had to be padded with silence.
+struct FakeAudioSink : public MediaPlayerBase::AudioSink {
+    FakeAudioSink(size_t framesPerCallback, size_t maxCallbacks)
+        : mFramesPerCallback(framesPerCallback),
+          mCallback(NULL),
+          mCookie(NULL),
+          mSampleRate(0),
+          mChannelCount(0),
+          mThreadStarted(false),
+          mRunning(false),
+          mExit(false),
+          mSeekPending(true),
+          mPosition(0),
+          mMaxCallbacks(maxCallbacks),
+          mNumCallbacks(0),
+          mNumUnderruns(0),
+          mNumLateCallbacks(0),
+          mNumSeekGaps(0),
+          mNumSilentFrames(0) {
+        mDurationsUs = new int64_t[maxCallbacks];
+        mBuffer = new int16_t[framesPerCallback * kNumChannels];
+    }
+
+    virtual bool ready() const { return mCallback != NULL; }
+    virtual bool realtime() const { return true; }
+    virtual ssize_t bufferSize() const { return mFramesPerCallback * kFrameSize; }
+    virtual ssize_t frameCount() const { return mFramesPerCallback; }
+    virtual ssize_t channelCount() const { return mChannelCount; }
+    virtual ssize_t frameSize() const { return kFrameSize; }
+
+    virtual uint32_t latency() const {
+        return 2 * mFramesPerCallback * 1000 / mSampleRate;
+    }
+
+    virtual float msecsPerFrame() const { return 1000.0f / mSampleRate; }
+
+    virtual status_t getPosition(uint32_t *position) const {
+        Mutex::Autolock autoLock(mLock);
+        *position = mPosition;
+        return OK;
+    }
+
+    virtual status_t getFramesWritten(uint32_t *framesWritten) const {
+        return getPosition(framesWritten);
+    }
+
+    virtual int getSessionId() const { return 0; }
+
+    virtual status_t open(
+            uint32_t sampleRate, int channelCount,
+            audio_channel_mask_t channelMask, audio_format_t format,
+            int bufferCount, AudioCallback cb, void *cookie,
+            audio_output_flags_t flags) {
+        CHECK(cb != NULL);
+        CHECK_EQ(channelCount, kNumChannels);
+
+        mSampleRate = sampleRate;
+        mChannelCount = channelCount;
+        mCallback = cb;
+        mCookie = cookie;
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        pthread_create(&mThread, &attr, ThreadWrapper, this);
+        pthread_attr_destroy(&attr);
+        mThreadStarted = true;
+
+        return OK;
+    }
+
+    virtual void start() {
+        Mutex::Autolock autoLock(mLock);
+        mRunning = true;
+        mCondition.signal();
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size) {
+        return INVALID_OPERATION;
+    }
+
+    virtual void stop() {
+        Mutex::Autolock autoLock(mLock);
+        mRunning = false;
+    }
+
+    virtual void flush() {
+        Mutex::Autolock autoLock(mLock);
+        mPosition = 0;
+    }
+
+    virtual void pause() {
+        stop();
+    }
+
+    virtual void close() {
+        if (!mThreadStarted) {
+            return;
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mExit = true;
+            mCondition.signal();
+        }
+
+        void *dummy;
+        pthread_join(mThread, &dummy);
+        mThreadStarted = false;
+    }
+
+    // Silence from here to the first callback that has data again is
+    // put down to the seek, as it is after starting.
+    void noteSeek() {
+        Mutex::Autolock autoLock(mLock);
+        mSeekPending = true;
+    }
+
+    void report() {
+        int64_t *sorted = mDurationsUs;
+        size_t n = mNumCallbacks;
+        for (size_t i = 1; i < n; ++i) {
+            int64_t x = sorted[i];
+            size_t j = i;
+            for (; j > 0 && sorted[j - 1] > x; --j) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = x;
+        }
+
+        if (n == 0) {
+            printf("no callbacks\n");
+            return;
+        }
+
+        printf("callbacks           %zu of %zu frames, every %.1f ms\n",
+               n, mFramesPerCallback, mFramesPerCallback * 1E3 / mSampleRate);
+        printf("callback time us    p50 %lld  p90 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+               (long long)sorted[n / 2],
+               (long long)sorted[n * 9 / 10],
+               (long long)sorted[n * 99 / 100],
+               (long long)sorted[n * 999 / 1000],
+               (long long)sorted[n - 1]);
+        printf("underruns           %zu callbacks\n", mNumUnderruns);
+        printf("late callbacks      %zu\n", mNumLateCallbacks);
+        printf("start/seek gaps     %zu callbacks\n", mNumSeekGaps);
+        printf("silent frames       %lld (%.1f ms)\n",
+               (long long)mNumSilentFrames,
+               mNumSilentFrames * 1E3 / mSampleRate);
+    }
+
+    size_t numUnderruns() const { return mNumUnderruns + mNumLateCallbacks; }
+
+protected:
+    virtual ~FakeAudioSink() {
+        close();
+
+        delete[] mBuffer;
+        delete[] mDurationsUs;
+    }
+
+private:
+    size_t mFramesPerCallback;
+    AudioCallback mCallback;
+    void *mCookie;
+    uint32_t mSampleRate;
+    int mChannelCount;
+
+    mutable Mutex mLock;
+    Condition mCondition;
+    pthread_t mThread;
+    bool mThreadStarted;
+    bool mRunning;
+    bool mExit;
+    bool mSeekPending;
+    uint32_t mPosition;
+
+    int16_t *mBuffer;
+    int64_t *mDurationsUs;
+    size_t mMaxCallbacks;
+    size_t mNumCallbacks;
+    size_t mNumUnderruns;
+    size_t mNumLateCallbacks;
+    size_t mNumSeekGaps;
+    int64_t mNumSilentFrames;
+
+    static void *ThreadWrapper(void *me) {
+        static_cast<FakeAudioSink *>(me)->threadFunc();
+        return NULL;
+    }
+
+    // Like the hardware the sink plays out what it was given in real
+    // time and keeps latency() worth of it queued. A callback that
+    // returns after the queue ran dry is late, the device played a gap.
+    void threadFunc() {
+        androidSetThreadPriority(0, ANDROID_PRIORITY_URGENT_AUDIO);
+
+        int64_t latencyUs = latency() * 1000ll;
+        int64_t queuedUntilUs = getNowUs() + latencyUs;
+
+        for (;;) {
+            bool seekPending;
+            {
+                Mutex::Autolock autoLock(mLock);
+                while (!mRunning && !mExit) {
+                    mCondition.wait(mLock);
+                    queuedUntilUs = getNowUs() + latencyUs;
+                }
+                if (mExit) {
+                    break;
+                }
+                seekPending = mSeekPending;
+            }
+
+            size_t size = mFramesPerCallback * kFrameSize;
+            memset(mBuffer, 0x55, size);
+
+            int64_t startUs = getNowUs();
+            size_t n = (*mCallback)(this, mBuffer, size, mCookie);
+            int64_t endUs = getNowUs();
+
+            // The source never produces silence, but stretched audio can
+            // cross zero on a single frame. Padding comes in longer runs.
+            size_t numSilent = 0;
+            size_t run = 0;
+            for (size_t i = 0; i <= n / kFrameSize; ++i) {
+                if (i < n / kFrameSize
+                        && mBuffer[2 * i] == 0 && mBuffer[2 * i + 1] == 0) {
+                    ++run;
+                    continue;
+                }
+                if (run >= kMinSilentRun) {
+                    numSilent += run;
+                }
+                run = 0;
+            }
+
+            bool late = endUs > queuedUntilUs;
+            if (late) {
+                queuedUntilUs = endUs;
+            }
+            queuedUntilUs += mFramesPerCallback * 1000000ll / mSampleRate;
+
+            {
+                Mutex::Autolock autoLock(mLock);
+
+                if (mNumCallbacks < mMaxCallbacks) {
+                    mDurationsUs[mNumCallbacks++] = endUs - startUs;
+                }
+
+                if (late) {
+                    ++mNumLateCallbacks;
+                }
+
+                mNumSilentFrames += numSilent;
+                if (numSilent > 0) {
+                    if (seekPending) {
+                        ++mNumSeekGaps;
+                    } else {
+                        ++mNumUnderruns;
+                    }
+                } else if (n > 0 && mSeekPending == seekPending) {
+                    mSeekPending = false;
+                }
+
+                mPosition += n / kFrameSize;
+            }
+
+            int64_t sleepUs = queuedUntilUs - latencyUs - getNowUs();
+            if (sleepUs > 0) {
+                usleep(sleepUs);
+            }
+        }
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(FakeAudioSink);
+};
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-d seconds] [-c frames] [-s ms] [-n reads] [-k ms] [-r rate]\n"
+            "       -d  how long to play (default 10)\n"
+            "       -c  frames per callback (default 1024)\n"
+            "       -s  how long a decoder stall lasts (default 60)\n"
+            "       -n  stall on every n-th read, 0 never (default 40)\n"
+            "       -k  seek every so often, 0 never (default 2000)\n"
+            "       -r  playback rate in 1/1000 (default 1000)\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int64_t durationUs = 10000000ll;
+    size_t framesPerCallback = 1024;
+    int64_t stallUs = 60000ll;
+    size_t stallEvery = 40;
+    int64_t seekIntervalUs = 2000000ll;
+    int32_t ratePermille = 1000;
+
+    int res;
+    while ((res = getopt(argc, argv, "d:c:s:n:k:r:")) >= 0) {
+        switch (res) {
+            case 'd':
+                durationUs = atoi(optarg) * 1000000ll;
+                break;
+
+            case 'c':
+                framesPerCallback = atoi(optarg);
+                break;
+
+            case 's':
+                stallUs = atoi(optarg) * 1000ll;
+                break;
+
+            case 'n':
+                stallEvery = atoi(optarg);
+                break;
+
+            case 'k':
+                seekIntervalUs = atoi(optarg) * 1000ll;
+                break;
+
+            case 'r':
+                ratePermille = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (durationUs <= 0 || framesPerCallback == 0) {
+        usage(argv[0]);
+    }
+
+    // Room for every callback even at the highest rate, the source is
+    // long enough never to run out.
+    size_t maxCallbacks =
+        durationUs * kSampleRate / 1000000ll / framesPerCallback + 64;
+    int64_t sourceDurationUs = durationUs * 4 + 60000000ll;
+
+    sp<FakeAudioSink> sink = new FakeAudioSink(framesPerCallback, maxCallbacks);
+    sp<SyntheticSource> source =
+        new SyntheticSource(sourceDurationUs, stallUs, stallEvery);
+
+    AudioPlayer *player = new AudioPlayer(sink);
+    player->setSource(source);
+    CHECK_EQ(player->start(), (status_t)OK);
+    CHECK_EQ(player->setPlaybackRatePermille(ratePermille), (status_t)OK);
+
+    // Media time has to keep moving forward between seeks.
+    size_t numBackwards = 0;
+    int64_t maxBackwardsUs = 0;
+    int64_t lastMediaTimeUs = -1;
+    int64_t maxAccessorUs = 0;
+
+    // A seek may only complete once its first read has returned, and the
+    // player coalesces seeks so that read carries the latest of them.
+    bool seekIssued = false;
+    int32_t numSeeksRead = 0;
+    size_t numEarlySeekCompletes = 0;
+
+    int64_t startUs = getNowUs();
+    int64_t nextSeekUs = startUs + seekIntervalUs;
+    unsigned seed = 1;
+    for (;;) {
+        usleep(5000);
+
+        int64_t nowUs = getNowUs();
+        if (nowUs - startUs >= durationUs) {
+            break;
+        }
+
+        if (seekIntervalUs > 0 && nowUs >= nextSeekUs) {
+            seed = seed * 1103515245 + 12345;
+            int64_t seekTimeUs = (seed >> 8) % (sourceDurationUs / 2);
+
+            sink->noteSeek();
+            numSeeksRead = source->numSeeksRead();
+            CHECK_EQ(player->seekTo(seekTimeUs), (status_t)OK);
+            seekIssued = true;
+            lastMediaTimeUs = -1;
+            nextSeekUs += seekIntervalUs;
+            continue;
+        }
+
+        int64_t mediaTimeUs = player->getMediaTimeUs();
+        int64_t accessorUs = getNowUs() - nowUs;
+        if (accessorUs > maxAccessorUs) {
+            maxAccessorUs = accessorUs;
+        }
+
+        if (!player->isSeeking()) {
+            if (seekIssued && source->numSeeksRead() == numSeeksRead) {
+                ++numEarlySeekCompletes;
+            }
+            seekIssued = false;
+
+            if (lastMediaTimeUs >= 0 && mediaTimeUs < lastMediaTimeUs) {
+                ++numBackwards;
+                if (lastMediaTimeUs - mediaTimeUs > maxBackwardsUs) {
+                    maxBackwardsUs = lastMediaTimeUs - mediaTimeUs;
+                }
+            }
+            lastMediaTimeUs = mediaTimeUs;
+        }
+    }
+
+    player->pause();
+
+    sink->report();
+    printf("slowest decode      %lld us\n", (long long)source->maxReadUs());
+    printf("media time          went backwards %zu times by up to %lld us\n",
+           numBackwards, (long long)maxBackwardsUs);
+    printf("slowest getMediaTimeUs %lld us\n", (long long)maxAccessorUs);
+    printf("seeks completed before their read %zu\n", numEarlySeekCompletes);
+
+    size_t numUnderruns = sink->numUnderruns();
+
+    source.clear();
+    delete player;
+    player = NULL;
+
+    return numUnderruns == 0 && numEarlySeekCompletes == 0 ? 0 : 1;
+}
@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the fade-in, peak and copy that AudioSource runs on captured
+// audio against a plain per-sample loop, and times it against the loops
+// AudioSource used to run. It then drives an AudioSource with synthetic
+// AudioRecord callbacks on a real-time clock while an encoder-like thread
+// reads from it and now and then sits on its buffers, and reports how
+// long the callbacks took and whether every frame came through.
+//
+// On a device AudioSource still opens the microphone, whose callbacks
+// come on top of the synthetic ones.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audio_source_bench"
+#include <utils/Log.h>
+
+#include <media/AudioRecord.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/AudioSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/threads.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/PCMCaptureDSP.h"
+
+using namespace android;
+
+// AudioSource never gets more than this from a callback.
+static const size_t kMaxBufferSize = 2048;
+
+static const int32_t kAmplitude = 12000;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+static uint32_t hash(uint32_t x) {
+    x *= 2654435761u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    return x;
+}
+
+static int compareInt64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// A tone with a little noise on each channel.
+static void makeSignal(
+        int16_t *out, size_t numFrames, size_t numChannels,
+        int32_t sampleRate, int64_t startFrame) {
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)(startFrame + i) / sampleRate;
+        for (size_t c = 0; c < numChannels; ++c) {
+            double x = (kAmplitude - 64) * sin(2 * M_PI * (440.0 + 110.0 * c) * t);
+            int32_t noise = (int32_t)(hash((startFrame + i) * 8 + c) & 127) - 64;
+            out[i * numChannels + c] = (int16_t)(lrint(x) + noise);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The documented gain, one sample at a time.
+static int16_t referenceRampAndPeak(
+        int16_t *dst, const int16_t *src,
+        size_t numFrames, size_t numChannels,
+        int64_t rampFrame, int32_t rampDurationFrames) {
+    int32_t peak = 0;
+    for (size_t i = 0; i < numFrames; ++i) {
+        int64_t frame = rampFrame + i;
+        for (size_t c = 0; c < numChannels; ++c) {
+            int32_t x = src[i * numChannels + c];
+            int32_t y;
+            if (frame < 0) {
+                y = 0;
+            } else if (frame >= rampDurationFrames) {
+                y = x;
+            } else {
+                int32_t step = (1 << 30) / rampDurationFrames;
+                int32_t g = ((int32_t)frame * step) >> 16;
+                y = (x * g) >> 14;
+            }
+            dst[i * numChannels + c] = y;
+
+            int32_t magnitude = y < 0 ? -y : y;
+            if (magnitude > 32767) {
+                magnitude = 32767;
+            }
+            if (magnitude > peak) {
+                peak = magnitude;
+            }
+        }
+    }
+    return peak;
+}
+
+static bool checkKernel() {
+    static const size_t kMaxSamples = 4096;
+    int16_t *src = new int16_t[kMaxSamples + 8];
+    int16_t *dst = new int16_t[kMaxSamples + 8];
+    int16_t *expected = new int16_t[kMaxSamples + 8];
+
+    bool ok = true;
+    for (uint32_t i = 0; i < 20000 && ok; ++i) {
+        size_t numChannels = 1 + hash(i * 7) % 8;
+        size_t numFrames = hash(i * 7 + 1) % (kMaxSamples / numChannels + 1);
+        int32_t rampDurationFrames = 1 + hash(i * 7 + 2) % 20000;
+        int64_t rampFrame =
+            (int64_t)(hash(i * 7 + 3) % (3 * rampDurationFrames))
+                - rampDurationFrames;
+        bool inPlace = (i & 1) != 0;
+        size_t offset = hash(i * 7 + 4) % 8;
+        size_t n = numFrames * numChannels;
+
+        for (size_t j = 0; j < n; ++j) {
+            uint32_t x = hash(i * 65536 + j);
+            // Full scale now and then, to hit the saturating abs.
+            src[offset + j] = (x & 0xf0000) == 0 ? -32768 : (int16_t)x;
+        }
+
+        int16_t expectedPeak = referenceRampAndPeak(
+                expected, src + offset, numFrames, numChannels,
+                rampFrame, rampDurationFrames);
+
+        int16_t *out = dst + offset;
+        if (inPlace) {
+            memcpy(out, src + offset, n * sizeof(int16_t));
+        }
+        int16_t peak = CopyPCMWithRampAndPeak(
+                out, inPlace ? out : src + offset, numFrames, numChannels,
+                rampFrame, rampDurationFrames);
+
+        if (peak != expectedPeak
+                || memcmp(out, expected, n * sizeof(int16_t))) {
+            fprintf(stderr,
+                    "differs: %zu frames of %zu channels from %lld of %d%s, "
+                    "peak %d vs %d\n",
+                    numFrames, numChannels, (long long)rampFrame,
+                    rampDurationFrames, inPlace ? " in place" : "",
+                    peak, expectedPeak);
+            ok = false;
+        }
+    }
+
+    delete[] expected;
+    delete[] dst;
+    delete[] src;
+
+    return ok;
+}
+
+// What AudioSource did per buffer before: allocate, copy, fade in two
+// channels or one at a time, then look for the peak.
+static void oldRampVolume(
+        int32_t nChannels, int32_t startFrame, int32_t rampDurationFrames,
+        uint8_t *data, size_t bytes) {
+    const int32_t kShift = 14;
+    int32_t fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
+    int32_t stopFrame = startFrame + bytes / sizeof(int16_t);
+    int16_t *frame = (int16_t *) data;
+    if (stopFrame > rampDurationFrames) {
+        stopFrame = rampDurationFrames;
+    }
+
+    while (startFrame < stopFrame) {
+        if (nChannels == 1) {  // mono
+            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
+            ++frame;
+            ++startFrame;
+        } else {               // stereo
+            frame[0] = (frame[0] * fixedMultiplier) >> kShift;
+            frame[1] = (frame[1] * fixedMultiplier) >> kShift;
+            frame += 2;
+            startFrame += 2;
+        }
+
+        // Update the multiplier every 4 frames
+        if ((startFrame & 3) == 0) {
+            fixedMultiplier = (startFrame << kShift) / rampDurationFrames;
+        }
+    }
+}
+
+static int16_t oldTrackMaxAmplitude(int16_t *data, int nSamples) {
+    int16_t maxAmplitude = 0;
+    for (int i = nSamples; i > 0; --i) {
+        int16_t value = *data++;
+        if (value < 0) {
+            value = -value;
+        }
+        if (maxAmplitude < value) {
+            maxAmplitude = value;
+        }
+    }
+    return maxAmplitude;
+}
+
+static volatile int32_t gSink;
+
+static bool runKernels(size_t iterations) {
+    static const int32_t kSampleRate = 48000;
+    static const int32_t kRampDurationFrames = kSampleRate * 3 / 10;
+
+    int16_t *signal = new int16_t[kMaxBufferSize / sizeof(int16_t)];
+    int16_t *out = new int16_t[kMaxBufferSize / sizeof(int16_t)];
+
+    bool ok = checkKernel();
+    printf("fade, peak and copy match the per-sample loop: %s\n\n",
+           ok ? "yes" : "NO");
+
+    printf("channels  phase    old Msamples/s  new Msamples/s      x\n");
+
+    for (size_t numChannels = 1; numChannels <= 2; ++numChannels) {
+        size_t numFrames = kMaxBufferSize / sizeof(int16_t) / numChannels;
+        size_t n = numFrames * numChannels;
+        makeSignal(signal, numFrames, numChannels, kSampleRate, 0);
+
+        for (int ramping = 1; ramping >= 0; --ramping) {
+            int32_t startFrame = ramping ? kRampDurationFrames / 3 : 0;
+
+            int64_t startUs = getNowUs();
+            for (size_t i = 0; i < iterations; ++i) {
+                MediaBuffer *buffer = new MediaBuffer(n * sizeof(int16_t));
+                memcpy(buffer->data(), signal, n * sizeof(int16_t));
+                buffer->set_range(0, n * sizeof(int16_t));
+                if (ramping) {
+                    oldRampVolume(
+                            numChannels, startFrame, kRampDurationFrames,
+                            (uint8_t *)buffer->data(), buffer->range_length());
+                }
+                gSink += oldTrackMaxAmplitude(
+                        (int16_t *)buffer->data(), buffer->range_length() >> 1);
+                buffer->release();
+            }
+            int64_t oldUs = getNowUs() - startUs;
+
+            startUs = getNowUs();
+            for (size_t i = 0; i < iterations; ++i) {
+                gSink += CopyPCMWithRampAndPeak(
+                        out, signal, numFrames, numChannels,
+                        ramping ? startFrame : kRampDurationFrames,
+                        kRampDurationFrames);
+            }
+            int64_t newUs = getNowUs() - startUs;
+
+            double oldRate = (double)n * iterations / (oldUs > 0 ? oldUs : 1);
+            double newRate = (double)n * iterations / (newUs > 0 ? newUs : 1);
+            printf("%8zu  %-7s  %14.1f  %14.1f  %5.1f\n",
+                   numChannels, ramping ? "ramp" : "steady",
+                   oldRate, newRate, newRate / oldRate);
+        }
+    }
+
+    delete[] out;
+    delete[] signal;
+
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Reads like an encoder: holds on to each buffer for a moment and now and
+// then for a lot longer, as one does when the file system stalls.
+struct Reader {
+    Reader(const sp<AudioSource> &source,
+           int32_t sampleRate, size_t frameSize,
+           int64_t stallUs, size_t stallEvery)
+        : mSource(source),
+          mSampleRate(sampleRate),
+          mFrameSize(frameSize),
+          mStallUs(stallUs),
+          mStallEvery(stallEvery),
+          mNumFramesRead(0),
+          mNumBuffers(0),
+          mNumTimestampErrors(0),
+          mLastTimeUs(-1) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        pthread_create(&mThread, &attr, ThreadWrapper, this);
+        pthread_attr_destroy(&attr);
+    }
+
+    void join() {
+        void *dummy;
+        pthread_join(mThread, &dummy);
+    }
+
+    int64_t numFramesRead() const {
+        Mutex::Autolock autoLock(mLock);
+        return mNumFramesRead;
+    }
+
+    size_t numTimestampErrors() const { return mNumTimestampErrors; }
+
+private:
+    sp<AudioSource> mSource;
+    int32_t mSampleRate;
+    size_t mFrameSize;
+    int64_t mStallUs;
+    size_t mStallEvery;
+
+    pthread_t mThread;
+
+    mutable Mutex mLock;
+    int64_t mNumFramesRead;
+    size_t mNumBuffers;
+    size_t mNumTimestampErrors;
+    int64_t mLastTimeUs;
+
+    static void *ThreadWrapper(void *me) {
+        static_cast<Reader *>(me)->threadFunc();
+        return NULL;
+    }
+
+    void threadFunc() {
+        for (;;) {
+            MediaBuffer *buffer;
+            status_t err = mSource->read(&buffer);
+            if (err != OK || buffer == NULL) {
+                break;
+            }
+
+            // Each buffer follows on from the last one.
+            int64_t timeUs;
+            CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+            if (mLastTimeUs >= 0 && timeUs < mLastTimeUs) {
+                ++mNumTimestampErrors;
+            }
+            size_t numFrames = buffer->range_length() / mFrameSize;
+            mLastTimeUs =
+                timeUs + (1000000ll * numFrames + (mSampleRate >> 1)) / mSampleRate;
+            {
+                Mutex::Autolock autoLock(mLock);
+                mNumFramesRead += numFrames;
+            }
+
+            ++mNumBuffers;
+            if (mStallEvery > 0 && (mNumBuffers % mStallEvery) == 0) {
+                usleep(mStallUs);
+            } else {
+                usleep(200);
+            }
+
+            buffer->release();
+        }
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(Reader);
+};
+
+static bool runSource(
+        int64_t durationUs, int32_t sampleRate, size_t numChannels,
+        int64_t stallUs, size_t stallEvery) {
+    sp<AudioSource> source =
+        new AudioSource(AUDIO_SOURCE_MIC, sampleRate, numChannels);
+    if (source->initCheck() != OK) {
+        fprintf(stderr, "AudioSource failed to initialize\n");
+        return false;
+    }
+    CHECK_EQ(source->start(), (status_t)OK);
+
+    size_t frameSize = numChannels * sizeof(int16_t);
+    size_t framesPerCallback = kMaxBufferSize / frameSize;
+    int64_t periodUs = framesPerCallback * 1000000ll / sampleRate;
+
+    size_t maxCallbacks = durationUs / periodUs + 16;
+    int64_t *durationsUs = new int64_t[maxCallbacks];
+    size_t numCallbacks = 0;
+
+    int16_t *data = new int16_t[framesPerCallback * numChannels];
+
+    Reader *reader =
+        new Reader(source, sampleRate, frameSize, stallUs, stallEvery);
+
+    androidSetThreadPriority(0, ANDROID_PRIORITY_AUDIO);
+
+    // Activates the tracking.
+    source->getMaxAmplitude();
+
+    int64_t numFramesQueued = 0;
+    int32_t lastMaxAmplitude = 0;
+    int64_t startUs = getNowUs();
+    int64_t nextUs = startUs;
+    int64_t nextPollUs = startUs + 100000ll;
+    while (numCallbacks < maxCallbacks) {
+        int64_t nowUs = getNowUs();
+        if (nowUs - startUs >= durationUs) {
+            break;
+        }
+
+        makeSignal(data, framesPerCallback, numChannels,
+                   sampleRate, numFramesQueued);
+
+        AudioRecord::Buffer buffer;
+        buffer.flags = 0;
+        buffer.channelCount = numChannels;
+        buffer.format = AUDIO_FORMAT_PCM_16_BIT;
+        buffer.frameCount = framesPerCallback;
+        buffer.size = framesPerCallback * frameSize;
+        buffer.i16 = data;
+
+        int64_t callbackStartUs = getNowUs();
+        source->dataCallbackTimestamp(buffer, callbackStartUs);
+        durationsUs[numCallbacks++] = getNowUs() - callbackStartUs;
+        numFramesQueued += framesPerCallback;
+
+        // The way MediaRecorder polls it.
+        if (nowUs >= nextPollUs) {
+            lastMaxAmplitude = source->getMaxAmplitude();
+            nextPollUs += 100000ll;
+        }
+
+        nextUs += periodUs;
+        int64_t sleepUs = nextUs - getNowUs();
+        if (sleepUs > 0) {
+            usleep(sleepUs);
+        }
+    }
+
+    // Let the reader catch up before stopping, whatever it hasn't read
+    // by then is dropped.
+    int64_t waitUntilUs = getNowUs() + 3000000ll;
+    while (reader->numFramesRead() < numFramesQueued
+            && getNowUs() < waitUntilUs) {
+        usleep(10000);
+    }
+
+    CHECK_EQ(source->stop(), (status_t)OK);
+    reader->join();
+
+    qsort(durationsUs, numCallbacks, sizeof(int64_t), compareInt64);
+
+    size_t n = numCallbacks;
+    printf("\n%d Hz, %zu channels, reader stalls %lld ms every %zu buffers\n",
+           sampleRate, numChannels, (long long)(stallUs / 1000), stallEvery);
+    if (n > 0) {
+        printf("callbacks           %zu of %zu frames, every %.1f ms\n",
+               n, framesPerCallback, periodUs / 1E3);
+        printf("callback time us    p50 %lld  p90 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+               (long long)durationsUs[n / 2],
+               (long long)durationsUs[n * 9 / 10],
+               (long long)durationsUs[n * 99 / 100],
+               (long long)durationsUs[n * 999 / 1000],
+               (long long)durationsUs[n - 1]);
+    }
+    printf("frames              %lld queued, %lld read\n",
+           (long long)numFramesQueued, (long long)reader->numFramesRead());
+    printf("timestamp errors    %zu\n", reader->numTimestampErrors());
+    printf("max amplitude       %d, last poll\n", lastMaxAmplitude);
+
+    // The tone is well past the fade by the last poll.
+    bool ok = reader->numFramesRead() >= numFramesQueued
+        && reader->numTimestampErrors() == 0
+        && (durationUs < 1000000ll || lastMaxAmplitude > kAmplitude - 256);
+
+    delete reader;
+    reader = NULL;
+
+    delete[] data;
+    delete[] durationsUs;
+
+    return ok;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-i iterations] [-d seconds] [-r rate] [-c channels]"
+            " [-s ms] [-n buffers]\n"
+            "       -i  kernel iterations, 0 skips them (default 100000)\n"
+            "       -d  how long to record, 0 skips it (default 5)\n"
+            "       -r  sample rate (default 48000)\n"
+            "       -c  1 or 2 channels (default 2)\n"
+            "       -s  how long the reader stalls (default 100)\n"
+            "       -n  stall every n-th buffer, 0 never (default 100)\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 100000;
+    int64_t durationUs = 5000000ll;
+    int32_t sampleRate = 48000;
+    size_t numChannels = 2;
+    int64_t stallUs = 100000ll;
+    size_t stallEvery = 100;
+
+    int res;
+    while ((res = getopt(argc, argv, "i:d:r:c:s:n:")) >= 0) {
+        switch (res) {
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+
+            case 'd':
+                durationUs = atoi(optarg) * 1000000ll;
+                break;
+
+            case 'r':
+                sampleRate = atoi(optarg);
+                break;
+
+            case 'c':
+                numChannels = atoi(optarg);
+                break;
+
+            case 's':
+                stallUs = atoi(optarg) * 1000ll;
+                break;
+
+            case 'n':
+                stallEvery = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (sampleRate <= 0 || (numChannels != 1 && numChannels != 2)) {
+        usage(argv[0]);
+    }
+
+    bool ok = true;
+    if (iterations > 0) {
+        ok = runKernels(iterations) && ok;
+    }
+    if (durationUs > 0) {
+        ok = runSource(durationUs, sampleRate, numChannels, stallUs, stallEvery)
+            && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the soft OMX components themselves, through MediaCodec and ACodec as
+// an application would, and reports their throughput. The codec benches
+// under codecs/ time the codec libraries directly; this one also counts
+// the component, the OMX buffer handling and the IPC with mediaserver.
+//
+//   -d file    decodes the first video track of the file, or the first
+//              audio track if there is none, through the OMX.google decoder
+//              for its mime type, and reports frames per second for video
+//              and the realtime factor for audio. "-d file.mp3" runs
+//              SoftMP3 and "-d file.m4a" SoftAAC, the components
+//              mp3dec_bench and aacdec_bench only imitate.
+//   -e aac     encodes a test signal in mono and in stereo at 44.1 kHz
+//              through OMX.google.aac.encoder by default, which is
+//              SoftAACEncoder2 when AAC_LIBRARY is fraunhofer, and reports
+//              the realtime factor. SoftAACEncoder2 runs libFraunhoferAAC,
+//              so the x86 kernels of libstagefright_aacenc only show when
+//              the component is SoftAACEncoder.
+//   -e flac    encodes a stereo test signal at 44.1, 96 and 192 kHz through
+//              OMX.google.flac.encoder, SoftFlacEncoder, once with its
+//              single encoder and once with -t threads, and reports the
+//              realtime factor.
+//   -e amrwb   encodes a mono test signal at 16 kHz in each of the nine
+//              AMR-WB modes through OMX.google.amrwb.encoder,
+//              SoftAMRWBEncoder, and reports how many channels one core
+//              encodes in realtime, the figure amrwbenc_bench gives for the
+//              voAMRWB library on its own.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "codec_component_bench"
+#include <utils/Log.h>
+
+#include <binder/ProcessState.h>
+#include <media/ICrypto.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/NuMediaExtractor.h>
+#include <gui/SurfaceTextureClient.h>
+
+#include <OMX_Audio.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace android;
+
+static const int64_t kTimeoutUs = 10000ll;
+
+static int64_t getNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+// What is fed to the component, one input buffer at a time.
+struct CodecInput {
+    virtual ~CodecInput() {}
+
+    // Fills "buffer" with the next input and its time, returns
+    // ERROR_END_OF_STREAM once there is none left.
+    virtual status_t read(const sp<ABuffer> &buffer, int64_t *timeUs) = 0;
+};
+
+struct ExtractorInput : public CodecInput {
+    ExtractorInput(const sp<NuMediaExtractor> &extractor)
+        : mExtractor(extractor) {
+    }
+
+    virtual status_t read(const sp<ABuffer> &buffer, int64_t *timeUs) {
+        status_t err = mExtractor->readSampleData(buffer);
+        if (err != OK) {
+            return err;
+        }
+
+        CHECK_EQ(mExtractor->getSampleTime(timeUs), (status_t)OK);
+        mExtractor->advance();
+
+        return OK;
+    }
+
+private:
+    sp<NuMediaExtractor> mExtractor;
+};
+
+// A tone with some noise on it, so that the encoders have something to
+// work on, in 16 bit interleaved PCM.
+struct PCMInput : public CodecInput {
+    PCMInput(int32_t sampleRate, int32_t numChannels, int64_t durationUs)
+        : mSampleRate(sampleRate),
+          mNumChannels(numChannels),
+          mNumFrames(durationUs * sampleRate / 1000000ll),
+          mFrameIndex(0) {
+    }
+
+    virtual status_t read(const sp<ABuffer> &buffer, int64_t *timeUs) {
+        if (mFrameIndex >= mNumFrames) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        size_t frameSize = mNumChannels * sizeof(int16_t);
+        size_t numFrames = buffer->capacity() / frameSize;
+        if ((int64_t)numFrames > mNumFrames - mFrameIndex) {
+            numFrames = mNumFrames - mFrameIndex;
+        }
+
+        int16_t *out = (int16_t *)buffer->base();
+        for (size_t i = 0; i < numFrames; ++i) {
+            uint64_t index = mFrameIndex + i;
+            for (int32_t c = 0; c < mNumChannels; ++c) {
+                uint32_t x = (uint32_t)index * 2654435761u ^ c * 0x9e3779b9u;
+                x ^= x >> 15;
+                x *= 0x2c1b3c6du;
+                x ^= x >> 12;
+
+                int32_t noise = (int32_t)(x & 0x3ff) - 0x200;
+                int32_t tone =
+                    ((int32_t)((index * 7 * (c + 1)) & 0xffff) - 0x8000) / 4;
+
+                *out++ = tone + noise;
+            }
+        }
+
+        buffer->setRange(0, numFrames * frameSize);
+        *timeUs = mFrameIndex * 1000000ll / mSampleRate;
+        mFrameIndex += numFrames;
+
+        return OK;
+    }
+
+private:
+    int32_t mSampleRate;
+    int32_t mNumChannels;
+    int64_t mNumFrames;
+    int64_t mFrameIndex;
+};
+
+struct CodecStats {
+    CodecStats()
+        : mNumInputs(0),
+          mNumOutputs(0),
+          mOutputBytes(0),
+          mElapsedUs(0) {
+    }
+
+    size_t mNumInputs;
+    size_t mNumOutputs;
+    size_t mOutputBytes;
+    int64_t mElapsedUs;
+};
+
+// Feeds all of "input" through the component and drains its output, from
+// start() to the output buffer carrying EOS.
+static status_t runCodec(
+        const sp<ALooper> &looper, const char *componentName,
+        const sp<AMessage> &format, bool encoder, CodecInput *input,
+        CodecStats *stats) {
+    sp<MediaCodec> codec =
+        MediaCodec::CreateByComponentName(looper, componentName);
+
+    if (codec == NULL) {
+        fprintf(stderr, "unable to instantiate %s\n", componentName);
+        return UNKNOWN_ERROR;
+    }
+
+    status_t err = codec->configure(
+            format, NULL /* nativeWindow */, NULL /* crypto */,
+            encoder ? MediaCodec::CONFIGURE_FLAG_ENCODE : 0);
+
+    if (err == OK) {
+        err = codec->start();
+    }
+
+    if (err != OK) {
+        fprintf(stderr, "unable to configure %s (%d)\n", componentName, err);
+        codec->release();
+        return err;
+    }
+
+    Vector<sp<ABuffer> > inBuffers;
+    Vector<sp<ABuffer> > outBuffers;
+    CHECK_EQ(codec->getInputBuffers(&inBuffers), (status_t)OK);
+    CHECK_EQ(codec->getOutputBuffers(&outBuffers), (status_t)OK);
+
+    bool sawInputEOS = false;
+    int64_t startUs = getNowUs();
+
+    for (;;) {
+        size_t index;
+        if (!sawInputEOS) {
+            err = codec->dequeueInputBuffer(&index, kTimeoutUs);
+
+            if (err == OK) {
+                const sp<ABuffer> &buffer = inBuffers.itemAt(index);
+
+                int64_t timeUs = 0;
+                err = input->read(buffer, &timeUs);
+
+                if (err == ERROR_END_OF_STREAM) {
+                    sawInputEOS = true;
+                    err = codec->queueInputBuffer(
+                            index, 0, 0, 0ll, MediaCodec::BUFFER_FLAG_EOS);
+                } else {
+                    CHECK_EQ(err, (status_t)OK);
+                    ++stats->mNumInputs;
+                    err = codec->queueInputBuffer(
+                            index, buffer->offset(), buffer->size(), timeUs,
+                            0 /* flags */);
+                }
+
+                CHECK_EQ(err, (status_t)OK);
+            } else {
+                CHECK_EQ(err, -EAGAIN);
+            }
+        }
+
+        size_t offset;
+        size_t size;
+        int64_t timeUs;
+        uint32_t flags;
+        err = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &timeUs, &flags, kTimeoutUs);
+
+        if (err == OK) {
+            if (size > 0 && !(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+                ++stats->mNumOutputs;
+                stats->mOutputBytes += size;
+            }
+
+            CHECK_EQ(codec->releaseOutputBuffer(index), (status_t)OK);
+
+            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+                break;
+            }
+        } else if (err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            CHECK_EQ(codec->getOutputBuffers(&outBuffers), (status_t)OK);
+        } else if (err != INFO_FORMAT_CHANGED) {
+            CHECK_EQ(err, -EAGAIN);
+        }
+    }
+
+    stats->mElapsedUs = getNowUs() - startUs;
+
+    codec->stop();
+    codec->release();
+
+    return OK;
+}
+
+// The component -d runs for a track if -c names none.
+static const struct {
+    const char *mMime;
+    const char *mComponentName;
+} kSoftDecoders[] = {
+    { MEDIA_MIMETYPE_VIDEO_MPEG4, "OMX.google.mpeg4.decoder" },
+    { MEDIA_MIMETYPE_VIDEO_H263, "OMX.google.h263.decoder" },
+    { MEDIA_MIMETYPE_VIDEO_AVC, "OMX.google.h264.decoder" },
+    { MEDIA_MIMETYPE_VIDEO_VPX, "OMX.google.vpx.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_MPEG, "OMX.google.mp3.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AAC, "OMX.google.aac.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AMR_NB, "OMX.google.amrnb.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_AMR_WB, "OMX.google.amrwb.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_VORBIS, "OMX.google.vorbis.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_G711_ALAW, "OMX.google.g711.alaw.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_G711_MLAW, "OMX.google.g711.mlaw.decoder" },
+    { MEDIA_MIMETYPE_AUDIO_RAW, "OMX.google.raw.decoder" },
+};
+
+static const char *findSoftDecoder(const char *mime) {
+    for (size_t i = 0;
+            i < sizeof(kSoftDecoders) / sizeof(kSoftDecoders[0]); ++i) {
+        if (!strcasecmp(mime, kSoftDecoders[i].mMime)) {
+            return kSoftDecoders[i].mComponentName;
+        }
+    }
+
+    return NULL;
+}
+
+static int decode(
+        const sp<ALooper> &looper, const char *componentName,
+        const char *path) {
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(path) != OK) {
+        fprintf(stderr, "unable to open %s\n", path);
+        return 1;
+    }
+
+    sp<AMessage> format;
+    ssize_t trackIndex = -1;
+    for (size_t i = 0; i < extractor->countTracks(); ++i) {
+        sp<AMessage> trackFormat;
+        CHECK_EQ(extractor->getTrackFormat(i, &trackFormat), (status_t)OK);
+
+        AString mime;
+        CHECK(trackFormat->findString("mime", &mime));
+
+        bool isVideo = !strncasecmp(mime.c_str(), "video/", 6);
+        if (isVideo || (trackIndex < 0
+                && !strncasecmp(mime.c_str(), "audio/", 6))) {
+            trackIndex = i;
+            format = trackFormat;
+        }
+
+        if (isVideo) {
+            break;
+        }
+    }
+
+    if (trackIndex < 0) {
+        fprintf(stderr, "no audio or video track in %s\n", path);
+        return 1;
+    }
+
+    AString mime;
+    CHECK(format->findString("mime", &mime));
+
+    if (componentName == NULL) {
+        componentName = findSoftDecoder(mime.c_str());
+
+        if (componentName == NULL) {
+            fprintf(stderr, "no soft decoder for %s, use -c\n", mime.c_str());
+            return 1;
+        }
+    }
+
+    CHECK_EQ(extractor->selectTrack(trackIndex), (status_t)OK);
+
+    ExtractorInput input(extractor);
+    CodecStats stats;
+    if (runCodec(looper, componentName, format, false /* encoder */,
+                &input, &stats) != OK) {
+        return 1;
+    }
+
+    int64_t elapsedUs = stats.mElapsedUs > 0 ? stats.mElapsedUs : 1;
+    int64_t durationUs;
+    if (!strncasecmp(mime.c_str(), "audio/", 6)
+            && format->findInt64("durationUs", &durationUs)) {
+        printf("%s, %s: %d access units, %d buffers in %.2f s, "
+               "%.1fx realtime\n",
+               componentName, mime.c_str(),
+               (int)stats.mNumInputs, (int)stats.mNumOutputs,
+               stats.mElapsedUs / 1E6,
+               (double)durationUs / elapsedUs);
+    } else {
+        printf("%s, %s: %d access units, %d frames in %.2f s, %.2f fps\n",
+               componentName, mime.c_str(),
+               (int)stats.mNumInputs, (int)stats.mNumOutputs,
+               stats.mElapsedUs / 1E6,
+               stats.mNumOutputs * 1E6 / elapsedUs);
+    }
+
+    return 0;
+}
+
+static int encodeAAC(
+        const sp<ALooper> &looper, const char *componentName,
+        int64_t durationUs) {
+    static const int32_t kSampleRate = 44100;
+
+    for (int32_t numChannels = 1; numChannels <= 2; ++numChannels) {
+        sp<AMessage> format = new AMessage;
+        format->setString("mime", MEDIA_MIMETYPE_AUDIO_AAC);
+        format->setInt32("sample-rate", kSampleRate);
+        format->setInt32("channel-count", numChannels);
+        format->setInt32("bitrate", 64000 * numChannels);
+        format->setInt32("aac-profile", OMX_AUDIO_AACObjectLC);
+
+        PCMInput input(kSampleRate, numChannels, durationUs);
+        CodecStats stats;
+        if (runCodec(looper, componentName, format, true /* encoder */,
+                    &input, &stats) != OK) {
+            return 1;
+        }
+
+        printf("%s, %d Hz, %d ch: %d frames, %d bytes in %.2f s, "
+               "%.1fx realtime\n",
+               componentName, kSampleRate, numChannels,
+               (int)stats.mNumOutputs, (int)stats.mOutputBytes,
+               stats.mElapsedUs / 1E6,
+               (double)durationUs
+                    / (stats.mElapsedUs > 0 ? stats.mElapsedUs : 1));
+    }
+
+    return 0;
+}
+
+static int encodeAMRWB(
+        const sp<ALooper> &looper, const char *componentName,
+        int64_t durationUs) {
+    static const int32_t kSampleRate = 16000;
+    static const int32_t kBitRates[] = {
+        6600, 8850, 12650, 14250, 15850, 18250, 19850, 23050, 23850
+    };
+
+    for (size_t i = 0; i < sizeof(kBitRates) / sizeof(kBitRates[0]); ++i) {
+        sp<AMessage> format = new AMessage;
+        format->setString("mime", MEDIA_MIMETYPE_AUDIO_AMR_WB);
+        format->setInt32("sample-rate", kSampleRate);
+        format->setInt32("channel-count", 1);
+        format->setInt32("bitrate", kBitRates[i]);
+
+        PCMInput input(kSampleRate, 1 /* numChannels */, durationUs);
+        CodecStats stats;
+        if (runCodec(looper, componentName, format, true /* encoder */,
+                    &input, &stats) != OK) {
+            return 1;
+        }
+
+        // The component encodes on a single thread, so its realtime
+        // factor is the number of channels one core keeps up with.
+        printf("%s, %d bps: %d frames, %d bytes in %.2f s, "
+               "%.1f channels per core\n",
+               componentName, kBitRates[i],
+               (int)stats.mNumOutputs, (int)stats.mOutputBytes,
+               stats.mElapsedUs / 1E6,
+               (double)durationUs
+                    / (stats.mElapsedUs > 0 ? stats.mElapsedUs : 1));
+    }
+
+    return 0;
+}
+
+static int encodeFLAC(
+        const sp<ALooper> &looper, const char *componentName,
+        int64_t durationUs, int32_t numThreads, int32_t compressionLevel) {
+    static const int32_t kSampleRates[] = { 44100, 96000, 192000 };
+    static const int32_t kNumChannels = 2;
+
+    for (size_t i = 0;
+            i < sizeof(kSampleRates) / sizeof(kSampleRates[0]); ++i) {
+        int32_t threadCounts[] = { 1, numThreads };
+        for (size_t j = 0;
+                j < sizeof(threadCounts) / sizeof(threadCounts[0]); ++j) {
+            if (j > 0 && threadCounts[j] == 1) {
+                break;
+            }
+
+            sp<AMessage> format = new AMessage;
+            format->setString("mime", MEDIA_MIMETYPE_AUDIO_FLAC);
+            format->setInt32("sample-rate", kSampleRates[i]);
+            format->setInt32("channel-count", kNumChannels);
+            format->setInt32("flac-compression-level", compressionLevel);
+            format->setInt32("flac-encoder-threads", threadCounts[j]);
+
+            PCMInput input(kSampleRates[i], kNumChannels, durationUs);
+            CodecStats stats;
+            if (runCodec(looper, componentName, format, true /* encoder */,
+                        &input, &stats) != OK) {
+                return 1;
+            }
+
+            printf("%s, %d Hz, level %d, %d threads: %d bytes in %.2f s, "
+                   "%.1fx realtime\n",
+                   componentName, kSampleRates[i], compressionLevel,
+                   threadCounts[j], (int)stats.mOutputBytes,
+                   stats.mElapsedUs / 1E6,
+                   (double)durationUs
+                        / (stats.mElapsedUs > 0 ? stats.mElapsedUs : 1));
+        }
+    }
+
+    return 0;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-c component] [-s seconds] [-t threads] [-l level]\n"
+            "          -d file | -e aac | -e flac | -e amrwb\n"
+            "       -c  component to run (default the OMX.google decoder for\n"
+            "           the track, OMX.google.aac.encoder,\n"
+            "           OMX.google.flac.encoder or OMX.google.amrwb.encoder)\n"
+            "       -s  length of the test signal to encode (default 30)\n"
+            "       -t  FLAC encoder threads, 0 for one per CPU (default 0)\n"
+            "       -l  FLAC compression level (default 5)\n"
+            "       -d  decode the first video, else audio, track of file\n"
+            "       -e  encode a test signal with the given codec\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *componentName = NULL;
+    const char *decodePath = NULL;
+    const char *encodeCodec = NULL;
+    int64_t durationUs = 30000000ll;
+    int32_t numThreads = 0;
+    int32_t compressionLevel = 5;
+
+    int res;
+    while ((res = getopt(argc, argv, "c:s:t:l:d:e:")) >= 0) {
+        switch (res) {
+            case 'c':
+                componentName = optarg;
+                break;
+
+            case 's':
+                durationUs = atoi(optarg) * 1000000ll;
+                break;
+
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+
+            case 'l':
+                compressionLevel = atoi(optarg);
+                break;
+
+            case 'd':
+                decodePath = optarg;
+                break;
+
+            case 'e':
+                encodeCodec = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if ((decodePath == NULL) == (encodeCodec == NULL) || durationUs <= 0
+            || numThreads < 0
+            || (encodeCodec != NULL && strcmp(encodeCodec, "aac")
+                    && strcmp(encodeCodec, "flac")
+                    && strcmp(encodeCodec, "amrwb"))) {
+        usage(argv[0]);
+    }
+
+    ProcessState::self()->startThreadPool();
+    DataSource::RegisterDefaultSniffers();
+
+    sp<ALooper> looper = new ALooper;
+    looper->setName("codec_component_bench");
+    looper->start();
+
+    if (decodePath != NULL) {
+        return decode(looper, componentName, decodePath);
+    }
+
+    if (!strcmp(encodeCodec, "flac")) {
+        return encodeFLAC(
+                looper,
+                componentName != NULL
+                    ? componentName : "OMX.google.flac.encoder",
+                durationUs, numThreads, compressionLevel);
+    }
+
+    if (!strcmp(encodeCodec, "amrwb")) {
+        return encodeAMRWB(
+                looper,
+                componentName != NULL
+                    ? componentName : "OMX.google.amrwb.encoder",
+                durationUs);
+    }
+
+    return encodeAAC(
+            looper,
+            componentName != NULL ? componentName : "OMX.google.aac.encoder",
+            durationUs);
+}
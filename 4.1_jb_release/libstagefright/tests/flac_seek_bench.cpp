@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Encodes FLAC streams with and without a SEEKTABLE, serves them from a
+// stand-in for an HTTP server and reports, with and without FLACExtractor's
+// seek index, what a random seek costs: how long it takes, how many bytes
+// and requests go over the simulated link, and whether the first buffer
+// starts exactly at the requested sample.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "flac_seek_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <utils/threads.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/FLACExtractor.h"
+#include "FLAC/stream_encoder.h"
+
+using namespace android;
+
+static const unsigned kSampleRate = 44100;
+static const unsigned kNumChannels = 2;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+// A sawtooth with some noise on it, so that frames don't all compress
+// alike. Being a function of the sample index it also tells what a seek
+// should have returned.
+static int16_t pcmSample(uint64_t index, unsigned channel) {
+    uint32_t x = (uint32_t)index * 2654435761u ^ channel * 0x9e3779b9u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+
+    int32_t noise = (int32_t)(x & 0x3ff) - 0x200;
+    int32_t tone = ((int32_t)((index * 7 * (channel + 1)) & 0xffff) - 0x8000) / 4;
+
+    return tone + noise;
+}
+
+struct MemoryFile {
+    MemoryFile()
+        : mData(NULL),
+          mSize(0),
+          mCapacity(0),
+          mPos(0) {
+    }
+
+    ~MemoryFile() {
+        free(mData);
+    }
+
+    uint8_t *mData;
+    size_t mSize;
+    size_t mCapacity;
+    size_t mPos;
+
+    DISALLOW_EVIL_CONSTRUCTORS(MemoryFile);
+};
+
+static FLAC__StreamEncoderWriteStatus writeCallback(
+        const FLAC__StreamEncoder *, const FLAC__byte buffer[],
+        size_t bytes, unsigned, unsigned, void *clientData) {
+    MemoryFile *file = (MemoryFile *)clientData;
+
+    if (file->mPos + bytes > file->mCapacity) {
+        size_t capacity = (file->mPos + bytes) * 2;
+        uint8_t *data = (uint8_t *)realloc(file->mData, capacity);
+        if (data == NULL) {
+            return FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+        }
+        file->mData = data;
+        file->mCapacity = capacity;
+    }
+
+    memcpy(file->mData + file->mPos, buffer, bytes);
+    file->mPos += bytes;
+    if (file->mPos > file->mSize) {
+        file->mSize = file->mPos;
+    }
+
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+static FLAC__StreamEncoderSeekStatus seekCallback(
+        const FLAC__StreamEncoder *, FLAC__uint64 offset, void *clientData) {
+    MemoryFile *file = (MemoryFile *)clientData;
+
+    if (offset > file->mSize) {
+        return FLAC__STREAM_ENCODER_SEEK_STATUS_ERROR;
+    }
+    file->mPos = offset;
+
+    return FLAC__STREAM_ENCODER_SEEK_STATUS_OK;
+}
+
+static FLAC__StreamEncoderTellStatus tellCallback(
+        const FLAC__StreamEncoder *, FLAC__uint64 *offset, void *clientData) {
+    *offset = ((MemoryFile *)clientData)->mPos;
+
+    return FLAC__STREAM_ENCODER_TELL_STATUS_OK;
+}
+
+// With a SEEKTABLE there is a point every 10 seconds, as "flac -S 10s"
+// writes by default.
+static void encode(uint64_t numSamples, bool withSeekTable, MemoryFile *file) {
+    FLAC__StreamEncoder *encoder = FLAC__stream_encoder_new();
+    CHECK(encoder != NULL);
+
+    CHECK(FLAC__stream_encoder_set_channels(encoder, kNumChannels));
+    CHECK(FLAC__stream_encoder_set_sample_rate(encoder, kSampleRate));
+    CHECK(FLAC__stream_encoder_set_bits_per_sample(encoder, 16));
+    CHECK(FLAC__stream_encoder_set_compression_level(encoder, 5));
+    CHECK(FLAC__stream_encoder_set_total_samples_estimate(encoder, numSamples));
+
+    static const uint64_t kSeekPointSpacing = 10 * kSampleRate;
+    size_t numPoints = (numSamples + kSeekPointSpacing - 1) / kSeekPointSpacing;
+
+    FLAC__StreamMetadata_SeekPoint *points = NULL;
+    FLAC__StreamMetadata seekTable;
+    FLAC__StreamMetadata *metadata = &seekTable;
+    if (withSeekTable) {
+        points = new FLAC__StreamMetadata_SeekPoint[numPoints];
+        for (size_t i = 0; i < numPoints; ++i) {
+            // the encoder fills in the rest as it gets there
+            points[i].sample_number = i * kSeekPointSpacing;
+            points[i].stream_offset = 0;
+            points[i].frame_samples = 0;
+        }
+
+        memset(&seekTable, 0, sizeof(seekTable));
+        seekTable.type = FLAC__METADATA_TYPE_SEEKTABLE;
+        seekTable.is_last = true;
+        seekTable.length = numPoints * FLAC__STREAM_METADATA_SEEKPOINT_LENGTH;
+        seekTable.data.seek_table.num_points = numPoints;
+        seekTable.data.seek_table.points = points;
+
+        CHECK(FLAC__stream_encoder_set_metadata(encoder, &metadata, 1));
+    }
+
+    CHECK_EQ(FLAC__stream_encoder_init_stream(
+                encoder, writeCallback, seekCallback, tellCallback, NULL, file),
+             FLAC__STREAM_ENCODER_INIT_STATUS_OK);
+
+    static const size_t kBlockSize = 8192;
+    FLAC__int32 *pcm = new FLAC__int32[kBlockSize * kNumChannels];
+    for (uint64_t first = 0; first < numSamples; first += kBlockSize) {
+        size_t n = numSamples - first < kBlockSize ? numSamples - first : kBlockSize;
+        for (size_t i = 0; i < n; ++i) {
+            for (unsigned c = 0; c < kNumChannels; ++c) {
+                pcm[i * kNumChannels + c] = pcmSample(first + i, c);
+            }
+        }
+        CHECK(FLAC__stream_encoder_process_interleaved(encoder, pcm, n));
+    }
+    delete[] pcm;
+
+    CHECK(FLAC__stream_encoder_finish(encoder));
+    FLAC__stream_encoder_delete(encoder);
+
+    delete[] points;
+}
+
+// Stands in for a server answering HTTP range requests over a link with
+// the given round trip time and rate: any read that doesn't continue where
+// the last one left off is a new request. Rather than sleeping, the time
+// the link would have taken is added up.
+struct StandInHTTPSource : public DataSource {
+    StandInHTTPSource(
+            const MemoryFile *file, int64_t roundTripUs, int64_t rateKbps,
+            bool caching)
+        : mFile(file),
+          mRoundTripUs(roundTripUs),
+          mRateKbps(rateKbps),
+          mCaching(caching),
+          mNextOffset(-1),
+          mNumReads(0),
+          mNumRequests(0),
+          mNumBytes(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        Mutex::Autolock autoLock(mLock);
+
+        if (offset < 0) {
+            return ERROR_IO;
+        }
+        if ((uint64_t)offset >= mFile->mSize) {
+            return 0;
+        }
+        if (size > mFile->mSize - offset) {
+            size = mFile->mSize - offset;
+        }
+        memcpy(data, mFile->mData + offset, size);
+
+        ++mNumReads;
+        if (offset != mNextOffset) {
+            ++mNumRequests;
+        }
+        mNumBytes += size;
+        mNextOffset = offset + size;
+
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mFile->mSize;
+        return OK;
+    }
+
+    // Passing for a caching source keeps the extractor from scanning.
+    virtual uint32_t flags() {
+        return mCaching ? kIsCachingDataSource | kIsHTTPBasedSource : 0;
+    }
+
+    struct Counters {
+        size_t mNumReads;
+        size_t mNumRequests;
+        int64_t mNumBytes;
+    };
+
+    Counters counters() {
+        Mutex::Autolock autoLock(mLock);
+
+        Counters counters;
+        counters.mNumReads = mNumReads;
+        counters.mNumRequests = mNumRequests;
+        counters.mNumBytes = mNumBytes;
+
+        return counters;
+    }
+
+    int64_t linkTimeUs(size_t numRequests, int64_t numBytes) const {
+        int64_t timeUs = numRequests * mRoundTripUs;
+        if (mRateKbps > 0) {
+            timeUs += numBytes * 8000ll / mRateKbps;
+        }
+        return timeUs;
+    }
+
+private:
+    const MemoryFile *mFile;
+    int64_t mRoundTripUs;
+    int64_t mRateKbps;
+    bool mCaching;
+
+    Mutex mLock;
+    off64_t mNextOffset;
+    size_t mNumReads;
+    size_t mNumRequests;
+    int64_t mNumBytes;
+
+    DISALLOW_EVIL_CONSTRUCTORS(StandInHTTPSource);
+};
+
+struct Options {
+    size_t mNumSeeks;
+    int64_t mRoundTripUs;
+    int64_t mRateKbps;
+    bool mCaching;
+};
+
+// Checks that the buffer holds the stream from "sample" on.
+static bool isExact(MediaBuffer *buffer, uint64_t sample) {
+    int64_t timeUs;
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+    if (timeUs != (int64_t)(sample * 1000000ll / kSampleRate)) {
+        return false;
+    }
+
+    const int16_t *data =
+        (const int16_t *)((const uint8_t *)buffer->data() + buffer->range_offset());
+    size_t n = buffer->range_length() / (kNumChannels * sizeof(int16_t));
+    if (n == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        for (unsigned c = 0; c < kNumChannels; ++c) {
+            if (data[i * kNumChannels + c] != pcmSample(sample + i, c)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void runOne(
+        const MemoryFile &file, int64_t durationSecs, bool withSeekTable,
+        bool useIndex, const Options &opts) {
+    sp<StandInHTTPSource> source = new StandInHTTPSource(
+            &file, opts.mRoundTripUs, opts.mRateKbps, opts.mCaching);
+
+    int64_t startUs = getNowUs();
+
+    sp<FLACExtractor> extractor = new FLACExtractor(source, useIndex);
+    CHECK_EQ(extractor->countTracks(), 1u);
+
+    // Let a scan finish first, it would otherwise compete with the seeks.
+    size_t numEntries = extractor->waitForSeekIndex();
+    int64_t openUs = getNowUs() - startUs;
+    StandInHTTPSource::Counters opened = source->counters();
+
+    sp<MediaSource> track = extractor->getTrack(0);
+    CHECK_EQ(track->start(), (status_t)OK);
+
+    uint64_t numSamples = durationSecs * kSampleRate;
+    uint32_t seed = 1;
+
+    int64_t totalUs = 0, maxUs = 0, totalLinkUs = 0, maxLinkUs = 0;
+    int64_t totalBytes = 0;
+    size_t totalReads = 0, totalRequests = 0, numExact = 0;
+    for (size_t i = 0; i < opts.mNumSeeks; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        uint64_t sample = (uint64_t)(seed >> 1) % numSamples;
+        int64_t seekTimeUs = (sample * 1000000ll + kSampleRate - 1) / kSampleRate;
+        // FLACSource rounds the time back down to the sample
+        CHECK_EQ((uint64_t)(seekTimeUs * kSampleRate / 1000000ll), sample);
+
+        MediaSource::ReadOptions options;
+        options.setSeekTo(seekTimeUs);
+
+        StandInHTTPSource::Counters before = source->counters();
+        int64_t seekStartUs = getNowUs();
+
+        MediaBuffer *buffer;
+        CHECK_EQ(track->read(&buffer, &options), (status_t)OK);
+
+        int64_t seekUs = getNowUs() - seekStartUs;
+        StandInHTTPSource::Counters after = source->counters();
+
+        if (isExact(buffer, sample)) {
+            ++numExact;
+        }
+        buffer->release();
+
+        size_t numRequests = after.mNumRequests - before.mNumRequests;
+        int64_t numBytes = after.mNumBytes - before.mNumBytes;
+        int64_t linkUs = source->linkTimeUs(numRequests, numBytes);
+
+        totalUs += seekUs;
+        totalLinkUs += linkUs;
+        if (seekUs > maxUs) {
+            maxUs = seekUs;
+        }
+        if (linkUs > maxLinkUs) {
+            maxLinkUs = linkUs;
+        }
+        totalBytes += numBytes;
+        totalReads += after.mNumReads - before.mNumReads;
+        totalRequests += numRequests;
+    }
+
+    track->stop();
+    track.clear();
+    extractor.clear();
+
+    double n = opts.mNumSeeks;
+    printf("%6lld %5s %5s %7u %6.1f %7.1f %6.2f %7.2f %7.2f %7.1f %7.1f %7.1f %6.1f %6.1f %3u/%u\n",
+           (long long)durationSecs, withSeekTable ? "yes" : "no",
+           useIndex ? "yes" : "no", (unsigned)numEntries, file.mSize / 1E6,
+           openUs / 1E3, opened.mNumBytes / 1E6,
+           totalUs / 1E3 / n, maxUs / 1E3,
+           totalLinkUs / 1E3 / n, maxLinkUs / 1E3,
+           totalBytes / 1E3 / n, totalReads / n, totalRequests / n,
+           (unsigned)numExact, (unsigned)opts.mNumSeeks);
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-n seeks] [-l rttMs] [-r kbps] [-c] durationSecs...\n"
+            "       -n  number of random seeks per run (default 50)\n"
+            "       -l  round trip time of the simulated link (default 50)\n"
+            "       -r  rate of the simulated link, 0 is unlimited (default 2000)\n"
+            "       -c  source passes for a caching one, so there is no scan\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Options opts;
+    opts.mNumSeeks = 50;
+    opts.mRoundTripUs = 50000;
+    opts.mRateKbps = 2000;
+    opts.mCaching = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "n:l:r:c")) >= 0) {
+        switch (res) {
+            case 'n':
+                opts.mNumSeeks = atoi(optarg);
+                break;
+
+            case 'l':
+                opts.mRoundTripUs = atoll(optarg) * 1000ll;
+                break;
+
+            case 'r':
+                opts.mRateKbps = atoll(optarg);
+                break;
+
+            case 'c':
+                opts.mCaching = true;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (opts.mNumSeeks == 0) {
+        usage(argv[0]);
+    }
+
+    static const int64_t kDefaultDurations[] = { 60, 600 };
+
+    Vector<int64_t> durations;
+    if (argc == 0) {
+        durations.appendArray(
+                kDefaultDurations,
+                sizeof(kDefaultDurations) / sizeof(kDefaultDurations[0]));
+    } else {
+        for (int i = 0; i < argc; ++i) {
+            int64_t durationSecs = atoll(argv[i]);
+            if (durationSecs <= 0) {
+                usage(argv[0]);
+            }
+            durations.push(durationSecs);
+        }
+    }
+
+    printf("                          size    open   open    seek     max"
+           "    link     max   bytes  reads   reqs\n"
+           "  secs table index entries   (MB)    (ms)   (MB)    (ms)    (ms)"
+           "    (ms)    (ms)    (KB)  /seek  /seek exact\n");
+
+    for (size_t i = 0; i < durations.size(); ++i) {
+        for (int withSeekTable = 0; withSeekTable < 2; ++withSeekTable) {
+            MemoryFile file;
+            encode(durations[i] * kSampleRate, withSeekTable, &file);
+
+            runOne(file, durations[i], withSeekTable, false, opts);
+            runOne(file, durations[i], withSeekTable, true, opts);
+        }
+    }
+
+    return 0;
+}
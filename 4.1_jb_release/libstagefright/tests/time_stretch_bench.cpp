@@ -0,0 +1,552 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Feeds PCM through TimeStretcher the way AudioPlayer does, decoder sized
+// buffers in and callback sized ones out, and reports at each rate what it
+// costs per second of audio played, how long the longest callback took,
+// whether anything was allocated on the way, and how well tempo and pitch
+// came out. The input is synthetic unless a WAV file is given.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "time_stretch_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/FileSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/TimeStretcher.h"
+#include "include/WAVExtractor.h"
+
+using namespace android;
+
+// Counts what gets allocated while sCountAllocations is set.
+static bool sCountAllocations = false;
+static size_t sNumAllocations = 0;
+
+void *operator new(size_t size) {
+    if (sCountAllocations) {
+        ++sNumAllocations;
+    }
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) throw() {
+    free(p);
+}
+
+void operator delete[](void *p) throw() {
+    free(p);
+}
+
+static int64_t getThreadCpuTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+static uint32_t hash(uint32_t x) {
+    x *= 2654435761u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    return x;
+}
+
+struct Clip {
+    Clip()
+        : mData(NULL),
+          mNumFrames(0),
+          mSampleRate(0),
+          mNumChannels(0),
+          mToneHz(0) {
+    }
+
+    ~Clip() {
+        delete[] mData;
+    }
+
+    const char *mName;
+    int16_t *mData;
+    size_t mNumFrames;
+    int32_t mSampleRate;
+    int32_t mNumChannels;
+
+    // The frequency of a pure tone, 0 for anything else.
+    double mToneHz;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Clip);
+};
+
+static void allocClip(Clip *clip, const char *name, size_t numFrames) {
+    clip->mName = name;
+    clip->mSampleRate = 44100;
+    clip->mNumChannels = 2;
+    clip->mNumFrames = numFrames;
+    clip->mData = new int16_t[numFrames * 2];
+}
+
+static void makeTone(Clip *clip, size_t numFrames) {
+    allocClip(clip, "tone", numFrames);
+    clip->mToneHz = 440.0;
+    for (size_t i = 0; i < numFrames; ++i) {
+        int16_t x = 12000 * sin(2 * M_PI * clip->mToneHz * i / clip->mSampleRate);
+        clip->mData[2 * i] = clip->mData[2 * i + 1] = x;
+    }
+}
+
+// A voice at a steady 140 Hz: harmonics shaped by two formants, syllables
+// at about 4 per second with short pauses, and bursts of noise in between
+// standing in for consonants.
+static void makeSpeech(Clip *clip, size_t numFrames) {
+    allocClip(clip, "speech", numFrames);
+    double f0 = 140.0;
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)i / clip->mSampleRate;
+        double syllable = fmod(t * 4.1, 1.0);
+        double envelope = syllable < 0.75 ? sin(M_PI * syllable / 0.75) : 0.0;
+        double x = 0;
+        for (int k = 1; k * f0 < 4000; ++k) {
+            double f = k * f0;
+            double gain = 1.0 / (1.0 + pow((f - 600.0) / 150.0, 2))
+                + 0.5 / (1.0 + pow((f - 1800.0) / 250.0, 2));
+            x += gain * sin(2 * M_PI * f * t + k);
+        }
+        x *= 4000 * envelope;
+        if (syllable >= 0.78 && syllable < 0.86) {
+            x += 1500.0 * ((int32_t)hash(i) / 2147483648.0);
+        }
+        int16_t y = x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+        clip->mData[2 * i] = y;
+        clip->mData[2 * i + 1] = y / 2;
+    }
+}
+
+static void makeMusic(Clip *clip, size_t numFrames) {
+    allocClip(clip, "music", numFrames);
+    static const double kChord[] = { 220.0, 277.18, 329.63, 440.0 };
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)i / clip->mSampleRate;
+        double beat = fmod(t * 2.0, 1.0);
+        double l = 0, r = 0;
+        for (size_t k = 0; k < 4; ++k) {
+            double x = sin(2 * M_PI * kChord[k] * t) * exp(-3.0 * beat);
+            l += (k & 1) ? 0.6 * x : x;
+            r += (k & 1) ? x : 0.6 * x;
+        }
+        if (beat < 0.02) {
+            double click = 0.8 * ((int32_t)hash(i) / 2147483648.0);
+            l += click;
+            r += click;
+        }
+        clip->mData[2 * i] = 6000 * l;
+        clip->mData[2 * i + 1] = 6000 * r;
+    }
+}
+
+static bool loadWAV(Clip *clip, const char *path) {
+    sp<DataSource> source = new FileSource(path);
+    if (source->initCheck() != OK) {
+        return false;
+    }
+
+    sp<MediaExtractor> extractor = new WAVExtractor(source);
+    if (extractor->countTracks() != 1) {
+        return false;
+    }
+
+    sp<MetaData> meta = extractor->getTrackMetaData(0, 0);
+    int64_t durationUs;
+    CHECK(meta->findInt32(kKeySampleRate, &clip->mSampleRate));
+    CHECK(meta->findInt32(kKeyChannelCount, &clip->mNumChannels));
+    CHECK(meta->findInt64(kKeyDuration, &durationUs));
+    if (clip->mNumChannels > 2) {
+        return false;
+    }
+
+    size_t capacity = durationUs * clip->mSampleRate / 1000000 + 1;
+    clip->mName = "file";
+    clip->mData = new int16_t[capacity * clip->mNumChannels];
+
+    sp<MediaSource> track = extractor->getTrack(0);
+    CHECK_EQ(track->start(), (status_t)OK);
+
+    size_t frameSize = clip->mNumChannels * sizeof(int16_t);
+    MediaBuffer *buffer;
+    while (track->read(&buffer, NULL) == OK) {
+        size_t n = buffer->range_length() / frameSize;
+        if (n > capacity - clip->mNumFrames) {
+            n = capacity - clip->mNumFrames;
+        }
+        memcpy(clip->mData + clip->mNumFrames * clip->mNumChannels,
+               (const uint8_t *)buffer->data() + buffer->range_offset(),
+               n * frameSize);
+        clip->mNumFrames += n;
+        buffer->release();
+    }
+    track->stop();
+
+    return clip->mNumFrames > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void toMono(const int16_t *in, size_t numFrames, int32_t numChannels, float *out) {
+    for (size_t i = 0; i < numFrames; ++i) {
+        float x = 0;
+        for (int32_t ch = 0; ch < numChannels; ++ch) {
+            x += in[i * numChannels + ch];
+        }
+        out[i] = x / numChannels;
+    }
+}
+
+// Median pitch over the voiced blocks, from the first normalized
+// autocorrelation peak between 60 and 600 Hz, 0 if there are none.
+static double estimatePitch(const float *x, size_t n, int32_t sampleRate) {
+    const size_t kBlock = 2048;
+    size_t minLag = sampleRate / 600;
+    size_t maxLag = sampleRate / 60;
+
+    double *pitches = new double[n / kBlock + 1];
+    size_t numPitches = 0;
+
+    for (size_t start = 0; start + kBlock + maxLag + 1 <= n; start += kBlock) {
+        const float *p = x + start;
+        double energy = 0;
+        for (size_t i = 0; i < kBlock; ++i) {
+            energy += (double)p[i] * p[i];
+        }
+        if (energy < kBlock * 1E5) {
+            continue;
+        }
+
+        double r[2048];
+        for (size_t lag = minLag - 1; lag <= maxLag + 1; ++lag) {
+            double c = 0, e = 0;
+            for (size_t i = 0; i < kBlock; ++i) {
+                c += (double)p[i] * p[i + lag];
+                e += (double)p[i + lag] * p[i + lag];
+            }
+            r[lag - minLag + 1] = c / sqrt(energy * e + 1);
+        }
+
+        size_t best = 0;
+        for (size_t lag = minLag; lag <= maxLag; ++lag) {
+            double v = r[lag - minLag + 1];
+            if (v > 0.8 && v >= r[lag - minLag] && v >= r[lag - minLag + 2]) {
+                best = lag;
+                break;
+            }
+        }
+        if (best == 0) {
+            continue;
+        }
+
+        double a = r[best - minLag], b = r[best - minLag + 1], c = r[best - minLag + 2];
+        double shift = (a - c) / (2 * (a - 2 * b + c));
+        pitches[numPitches++] = sampleRate / (best + shift);
+    }
+
+    double pitch = 0;
+    if (numPitches > 0) {
+        for (size_t i = 1; i < numPitches; ++i) {
+            for (size_t j = i; j > 0 && pitches[j - 1] > pitches[j]; --j) {
+                double t = pitches[j];
+                pitches[j] = pitches[j - 1];
+                pitches[j - 1] = t;
+            }
+        }
+        pitch = pitches[numPitches / 2];
+    }
+    delete[] pitches;
+
+    return pitch;
+}
+
+// How far above everything else the tone stands, averaged over Hann
+// windowed blocks. Splices that break the waveform smear it out.
+static double toneToDistortion(
+        const float *x, size_t n, int32_t sampleRate, double toneHz) {
+    const size_t kBlock = 4096;
+    double sum = 0;
+    size_t numBlocks = 0;
+
+    for (size_t start = kBlock; start + 2 * kBlock <= n; start += kBlock) {
+        double total = 0;
+        double w[4096];
+        for (size_t i = 0; i < kBlock; ++i) {
+            w[i] = x[start + i] * (0.5 - 0.5 * cos(2 * M_PI * i / kBlock));
+            total += w[i] * w[i];
+        }
+
+        // Energy within a few bins of the tone, both sides of the spectrum.
+        int32_t center = lrint(toneHz * kBlock / sampleRate);
+        double tone = 0;
+        for (int32_t k = center - 3; k <= center + 3; ++k) {
+            double re = 0, im = 0;
+            for (size_t i = 0; i < kBlock; ++i) {
+                double phase = 2 * M_PI * k * (double)i / kBlock;
+                re += w[i] * cos(phase);
+                im -= w[i] * sin(phase);
+            }
+            tone += 2 * (re * re + im * im) / kBlock;
+        }
+
+        double rest = total - tone;
+        sum += 10 * log10(tone / (rest > 1E-6 * tone ? rest : 1E-6 * tone));
+        ++numBlocks;
+    }
+
+    return numBlocks > 0 ? sum / numBlocks : 0;
+}
+
+static double rms(const int16_t *x, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += (double)x[i] * x[i];
+    }
+    return sqrt(sum / (n ? n : 1));
+}
+
+struct Options {
+    size_t mInputFrames;
+    size_t mCallbackFrames;
+};
+
+static bool runOne(const Clip &clip, int32_t ratePermille, const Options &opts) {
+    int32_t numChannels = clip.mNumChannels;
+    size_t capacity = (size_t)((int64_t)clip.mNumFrames * 1000 / 500) + 4096;
+    int16_t *output = new int16_t[capacity * numChannels];
+
+    TimeStretcher stretcher(clip.mSampleRate, numChannels);
+    stretcher.setRatePermille(ratePermille);
+
+    int64_t totalUs = 0, maxCallbackUs = 0, maxBufferedUs = 0;
+    size_t numOut = 0, numIn = 0, numCallbacks = 0;
+
+    sNumAllocations = 0;
+    sCountAllocations = true;
+
+    // One callback at a time, each taking decoder buffers until it is full.
+    size_t bufferFrames = 0;
+    const int16_t *buffer = NULL;
+    bool done = false;
+    while (!done && numOut + opts.mCallbackFrames <= capacity) {
+        int64_t startUs = getThreadCpuTimeUs();
+
+        int16_t *out = output + numOut * numChannels;
+        size_t size = opts.mCallbackFrames, filled = 0;
+        while (filled < size) {
+            if (bufferFrames == 0) {
+                if (numIn == clip.mNumFrames) {
+                    size_t n = stretcher.flush(
+                            out + filled * numChannels, size - filled);
+                    filled += n;
+                    if (stretcher.isEmpty()) {
+                        done = true;
+                    }
+                    break;
+                }
+
+                buffer = clip.mData + numIn * numChannels;
+                bufferFrames = clip.mNumFrames - numIn;
+                if (bufferFrames > opts.mInputFrames) {
+                    bufferFrames = opts.mInputFrames;
+                }
+                numIn += bufferFrames;
+            }
+
+            size_t taken = bufferFrames;
+            filled += stretcher.process(
+                    out + filled * numChannels, size - filled, buffer, &taken);
+            buffer += taken * numChannels;
+            bufferFrames -= taken;
+        }
+
+        int64_t callbackUs = getThreadCpuTimeUs() - startUs;
+        totalUs += callbackUs;
+        if (callbackUs > maxCallbackUs) {
+            maxCallbackUs = callbackUs;
+        }
+        int64_t bufferedUs = stretcher.getBufferedDurationUs();
+        if (bufferedUs > maxBufferedUs) {
+            maxBufferedUs = bufferedUs;
+        }
+
+        numOut += filled;
+        ++numCallbacks;
+    }
+
+    sCountAllocations = false;
+
+    double expected = (double)clip.mNumFrames * 1000 / ratePermille;
+    double tempoError = (numOut - expected) * 100.0 / expected;
+    double outSecs = (double)numOut / clip.mSampleRate;
+
+    float *monoIn = new float[clip.mNumFrames];
+    float *monoOut = new float[numOut];
+    toMono(clip.mData, clip.mNumFrames, numChannels, monoIn);
+    toMono(output, numOut, numChannels, monoOut);
+
+    double pitchIn = estimatePitch(monoIn, clip.mNumFrames, clip.mSampleRate);
+    double pitchOut = estimatePitch(monoOut, numOut, clip.mSampleRate);
+    double cents = (pitchIn > 0 && pitchOut > 0)
+        ? 1200 * log(pitchOut / pitchIn) / log(2.0) : 0;
+
+    double level = 20 * log10(
+            rms(output, numOut * numChannels)
+                / rms(clip.mData, clip.mNumFrames * numChannels));
+
+    printf("%-6s %5.2f %8.1f %6.2f %8.1f %7.1f %7zu %7.2f %+7.1f",
+           clip.mName, ratePermille / 1000.0,
+           totalUs / outSecs, totalUs * 100.0 / (outSecs * 1E6),
+           maxCallbackUs / 1E3, maxBufferedUs / 1E3,
+           sNumAllocations, tempoError, cents);
+    printf(" %+6.2f", level);
+    if (clip.mToneHz > 0) {
+        printf(" %6.1f",
+               toneToDistortion(monoOut, numOut, clip.mSampleRate, clip.mToneHz));
+    }
+    printf("\n");
+
+    delete[] monoOut;
+    delete[] monoIn;
+    delete[] output;
+
+    // What is still buffered at the end comes out at the normal rate.
+    double tempoTolerance =
+        1.0 + 0.15 * 100 * clip.mSampleRate / clip.mNumFrames;
+
+    return sNumAllocations == 0
+        && fabs(tempoError) < tempoTolerance && fabs(cents) < 10;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-s seconds] [-b frames] [-c frames] [-f file.wav] [rate...]\n"
+            "       -s  length of the synthetic clips (default 20)\n"
+            "       -b  frames per decoder buffer (default 2048)\n"
+            "       -c  frames per audio callback (default 1024)\n"
+            "       -f  stretch the given WAV file instead\n"
+            "       rates in 1/1000, 500 to 3000 (default 500 750 1250 1500 2000 3000)\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Options opts;
+    opts.mInputFrames = 2048;
+    opts.mCallbackFrames = 1024;
+    size_t seconds = 20;
+    const char *path = NULL;
+
+    int res;
+    while ((res = getopt(argc, argv, "s:b:c:f:")) >= 0) {
+        switch (res) {
+            case 's':
+                seconds = atoi(optarg);
+                break;
+
+            case 'b':
+                opts.mInputFrames = atoi(optarg);
+                break;
+
+            case 'c':
+                opts.mCallbackFrames = atoi(optarg);
+                break;
+
+            case 'f':
+                path = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (seconds == 0 || opts.mInputFrames == 0 || opts.mCallbackFrames == 0) {
+        usage(argv[0]);
+    }
+
+    int32_t rates[16];
+    size_t numRates = 0;
+    if (argc == 0) {
+        static const int32_t kDefaultRates[] = { 500, 750, 1250, 1500, 2000, 3000 };
+        for (size_t i = 0; i < 6; ++i) {
+            rates[numRates++] = kDefaultRates[i];
+        }
+    }
+    for (int i = 0; i < argc && numRates < 16; ++i) {
+        rates[numRates] = atoi(argv[i]);
+        if (rates[numRates] < TimeStretcher::kMinRatePermille
+                || rates[numRates] > TimeStretcher::kMaxRatePermille) {
+            usage(argv[0]);
+        }
+        ++numRates;
+    }
+
+    Clip clips[3];
+    size_t numClips = 0;
+    if (path != NULL) {
+        if (!loadWAV(&clips[0], path)) {
+            fprintf(stderr, "can't read %s\n", path);
+            return 1;
+        }
+        numClips = 1;
+    } else {
+        size_t numFrames = seconds * 44100;
+        makeTone(&clips[0], numFrames);
+        makeSpeech(&clips[1], numFrames);
+        makeMusic(&clips[2], numFrames);
+        numClips = 3;
+    }
+
+    printf("clip    rate  cpu us/s  cpu %%  max cb ms  max lat ms  allocs"
+           "  tempo %%  pitch c  level dB  tone dB\n");
+
+    bool ok = true;
+    for (size_t c = 0; c < numClips; ++c) {
+        for (size_t r = 0; r < numRates; ++r) {
+            ok = runOne(clips[c], rates[r], opts) && ok;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1015 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reports the throughput of the sample conversions and ADPCM decoders that
+// WAVExtractor uses, checks the conversions against plain per-sample loops
+// and the decoders against the encoder's own reconstruction, and then reads
+// a WAV file of each kind from memory through WAVExtractor.
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "wav_convert_bench"
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "include/ADPCMDecoder.h"
+#include "include/PCMConversion.h"
+#include "include/WAVExtractor.h"
+
+using namespace android;
+
+static const unsigned kSampleRate = 44100;
+static const unsigned kNumChannels = 2;
+
+static int64_t getNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (int64_t)tv.tv_usec + tv.tv_sec * 1000000ll;
+}
+
+static uint32_t hash(uint32_t x) {
+    x *= 2654435761u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    return x;
+}
+
+// A few partials and some noise, loud enough to clip now and then.
+static void makeSignal(float *out, size_t numFrames) {
+    for (size_t i = 0; i < numFrames; ++i) {
+        double t = (double)i / kSampleRate;
+        for (size_t ch = 0; ch < kNumChannels; ++ch) {
+            double x = 0.45 * sin(2 * M_PI * (220.0 + 110.0 * ch) * t)
+                + 0.3 * sin(2 * M_PI * 1375.0 * t + ch)
+                + 0.2 * sin(2 * M_PI * 5010.0 * t)
+                + 0.08 * ((int32_t)hash(i * kNumChannels + ch) / 2147483648.0);
+            out[i * kNumChannels + ch] = x;
+        }
+    }
+}
+
+static int16_t toS16(float x) {
+    float y = x * 32768.0f;
+    if (!(y < 32767.0f)) {
+        return 32767;
+    }
+    if (y < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(y);
+}
+
+static uint8_t aLawEncode(int16_t x) {
+    int32_t sign = (x >= 0) ? 0x80 : 0;
+    int32_t magnitude = (x >= 0) ? x : -(int32_t)x - 1;
+    int32_t exponent = 0;
+    int32_t mantissa;
+    if (magnitude >= 256) {
+        exponent = 1;
+        while (exponent < 7 && magnitude >= (256 << exponent)) {
+            ++exponent;
+        }
+        mantissa = (magnitude >> (exponent + 3)) & 0x0f;
+    } else {
+        mantissa = magnitude >> 4;
+    }
+    return (sign | exponent << 4 | mantissa) ^ 0x55;
+}
+
+static uint8_t muLawEncode(int16_t x) {
+    int32_t sign = (x < 0) ? 0 : 0x80;
+    int32_t magnitude = (x < 0) ? -(int32_t)x : x;
+    magnitude += 132;
+    if (magnitude > 32767) {
+        magnitude = 32767;
+    }
+    int32_t exponent = 7;
+    while (exponent > 0 && !(magnitude & (0x4000 >> (7 - exponent)))) {
+        --exponent;
+    }
+    int32_t mantissa = (magnitude >> (exponent + 3)) & 0x0f;
+    return ~(0x80 ^ sign | exponent << 4 | mantissa);
+}
+
+// Lays the signal out the way a WAV file stores it in the given format.
+static void encodeSamples(
+        uint8_t *dst, const float *signal, size_t numSamples,
+        PCMSampleFormat format) {
+    for (size_t i = 0; i < numSamples; ++i) {
+        float x = signal[i];
+        double clipped = x > 1.0 ? 1.0 : (x < -1.0 ? -1.0 : x);
+        switch (format) {
+            case kPCMFormatU8:
+                dst[i] = toS16(x) / 256 + 128;
+                break;
+            case kPCMFormatS16:
+            {
+                int16_t y = toS16(x);
+                dst[2 * i] = y;
+                dst[2 * i + 1] = y >> 8;
+                break;
+            }
+            case kPCMFormatS24:
+            {
+                int32_t y = lrint(clipped * 8388607.0);
+                dst[3 * i] = y;
+                dst[3 * i + 1] = y >> 8;
+                dst[3 * i + 2] = y >> 16;
+                break;
+            }
+            case kPCMFormatS32:
+            {
+                int32_t y = lrint(clipped * 2147483647.0);
+                dst[4 * i] = y;
+                dst[4 * i + 1] = y >> 8;
+                dst[4 * i + 2] = y >> 16;
+                dst[4 * i + 3] = y >> 24;
+                break;
+            }
+            case kPCMFormatFloat:
+            {
+                // Float files do go past full scale.
+                float y = x * 1.1f;
+                memcpy(&dst[4 * i], &y, 4);
+                break;
+            }
+            case kPCMFormatALaw:
+                dst[i] = aLawEncode(toS16(x));
+                break;
+            case kPCMFormatMuLaw:
+                dst[i] = muLawEncode(toS16(x));
+                break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// What WAVExtractor and SoftG711 did sample by sample before.
+
+static int16_t referenceALaw(uint8_t x) {
+    int32_t ix = (x ^ 0x55) & 0x7f;
+    int32_t iexp = ix >> 4;
+    int32_t mant = ix & 0x0f;
+    if (iexp > 0) {
+        mant += 16;
+    }
+    mant = (mant << 4) + 8;
+    if (iexp > 1) {
+        mant = mant << (iexp - 1);
+    }
+    return (x > 127) ? mant : -mant;
+}
+
+static int16_t referenceMuLaw(uint8_t x) {
+    int32_t mantissa = ~x;
+    int32_t exponent = (mantissa >> 4) & 7;
+    int32_t segment = exponent + 1;
+    mantissa &= 0x0f;
+    int32_t step = 4 << segment;
+    int32_t abs = (0x80l << exponent) + step * mantissa + step / 2 - 4 * 33;
+    return (x < 0x80) ? -abs : abs;
+}
+
+static void referenceToS16(
+        int16_t *dst, const uint8_t *src, size_t n, PCMSampleFormat format) {
+    for (size_t i = 0; i < n; ++i) {
+        switch (format) {
+            case kPCMFormatU8:
+                dst[i] = ((int16_t)src[i] - 128) * 256;
+                break;
+            case kPCMFormatS16:
+                dst[i] = (int16_t)(src[2 * i + 1] << 8 | src[2 * i]);
+                break;
+            case kPCMFormatS24:
+            {
+                int32_t x = (int32_t)(src[3 * i + 2] << 24
+                        | src[3 * i + 1] << 16 | src[3 * i] << 8) >> 8;
+                dst[i] = (int16_t)(x >> 8);
+                break;
+            }
+            case kPCMFormatS32:
+                dst[i] = (int16_t)(src[4 * i + 3] << 8 | src[4 * i + 2]);
+                break;
+            case kPCMFormatFloat:
+            {
+                float x;
+                memcpy(&x, &src[4 * i], 4);
+                dst[i] = toS16(x);
+                break;
+            }
+            case kPCMFormatALaw:
+                dst[i] = referenceALaw(src[i]);
+                break;
+            case kPCMFormatMuLaw:
+                dst[i] = referenceMuLaw(src[i]);
+                break;
+        }
+    }
+}
+
+static void referenceToFloat(
+        float *dst, const uint8_t *src, size_t n, PCMSampleFormat format) {
+    for (size_t i = 0; i < n; ++i) {
+        switch (format) {
+            case kPCMFormatU8:
+                dst[i] = ((int32_t)src[i] - 128) / 128.0f;
+                break;
+            case kPCMFormatS16:
+                dst[i] = (int16_t)(src[2 * i + 1] << 8 | src[2 * i]) / 32768.0f;
+                break;
+            case kPCMFormatS24:
+            {
+                int32_t x = (int32_t)(src[3 * i + 2] << 24
+                        | src[3 * i + 1] << 16 | src[3 * i] << 8) >> 8;
+                dst[i] = x / 8388608.0f;
+                break;
+            }
+            case kPCMFormatS32:
+            {
+                int32_t x = (int32_t)(src[4 * i + 3] << 24 | src[4 * i + 2] << 16
+                        | src[4 * i + 1] << 8 | src[4 * i]);
+                dst[i] = (float)x * (1.0f / 2147483648.0f);
+                break;
+            }
+            case kPCMFormatFloat:
+                memcpy(&dst[i], &src[4 * i], 4);
+                break;
+            case kPCMFormatALaw:
+                dst[i] = referenceALaw(src[i]) / 32768.0f;
+                break;
+            case kPCMFormatMuLaw:
+                dst[i] = referenceMuLaw(src[i]) / 32768.0f;
+                break;
+        }
+    }
+}
+
+static const struct {
+    PCMSampleFormat mFormat;
+    const char *mName;
+} kFormats[] = {
+    { kPCMFormatU8, "u8" },
+    { kPCMFormatS16, "s16" },
+    { kPCMFormatS24, "s24" },
+    { kPCMFormatS32, "s32" },
+    { kPCMFormatFloat, "float" },
+    { kPCMFormatALaw, "alaw" },
+    { kPCMFormatMuLaw, "mulaw" },
+};
+
+static const size_t kNumFormats = sizeof(kFormats) / sizeof(kFormats[0]);
+
+// Converts the whole clip in buffers the size WAVSource reads, so that
+// the numbers reflect what playback sees.
+static const size_t kChunkSamples = 32768;
+
+template<typename T, typename Convert>
+static double timeConversion(
+        Convert convert, T *dst, const uint8_t *src, size_t numSamples,
+        size_t sampleSize, PCMSampleFormat format, size_t iterations) {
+    int64_t startUs = getNowUs();
+    for (size_t k = 0; k < iterations; ++k) {
+        for (size_t i = 0; i < numSamples; i += kChunkSamples) {
+            size_t n = numSamples - i;
+            if (n > kChunkSamples) {
+                n = kChunkSamples;
+            }
+            convert(dst + i, src + i * sampleSize, n, format);
+        }
+    }
+    int64_t elapsedUs = getNowUs() - startUs;
+
+    return (double)numSamples * iterations / (elapsedUs > 0 ? elapsedUs : 1);
+}
+
+static void libraryToS16(
+        int16_t *dst, const uint8_t *src, size_t n, PCMSampleFormat format) {
+    ConvertPCMToS16(dst, src, format, n);
+}
+
+static void libraryToFloat(
+        float *dst, const uint8_t *src, size_t n, PCMSampleFormat format) {
+    ConvertPCMToFloat(dst, src, format, n);
+}
+
+// Also runs the conversion in place, the way WAVSource does, and from odd
+// offsets and lengths so that the tails get exercised.
+static bool checkS16(
+        const uint8_t *src, size_t numSamples, PCMSampleFormat format) {
+    size_t sampleSize = PCMSampleSize(format);
+    int16_t *expected = new int16_t[numSamples];
+    referenceToS16(expected, src, numSamples, format);
+
+    size_t bufferSize = numSamples * (sampleSize < 2 ? 2 : sampleSize) + 64;
+    uint8_t *buffer = new uint8_t[bufferSize];
+
+    bool ok = true;
+    for (size_t skew = 0; skew < 3 && ok; ++skew) {
+        size_t n = numSamples - 37 * skew;
+        uint8_t *data = buffer + skew;
+        uint8_t *in = (sampleSize < 2) ? data + n : data;
+        memcpy(in, src, n * sampleSize);
+
+        ConvertPCMToS16((int16_t *)data, in, format, n);
+
+        for (size_t i = 0; i < n; ++i) {
+            int16_t x;
+            memcpy(&x, data + 2 * i, 2);
+            if (x != expected[i]) {
+                fprintf(stderr, "%s -> s16 differs at %zu: %d vs %d\n",
+                        kFormats[format].mName, i, x, expected[i]);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    delete[] buffer;
+    delete[] expected;
+
+    return ok;
+}
+
+static bool checkFloat(
+        const uint8_t *src, size_t numSamples, PCMSampleFormat format) {
+    float *expected = new float[numSamples];
+    float *actual = new float[numSamples + 1];
+    referenceToFloat(expected, src, numSamples, format);
+
+    bool ok = true;
+    for (size_t skew = 0; skew < 2 && ok; ++skew) {
+        size_t n = numSamples - 29 * skew;
+        ConvertPCMToFloat(actual + skew, src, format, n);
+        if (memcmp(actual + skew, expected, n * sizeof(float))) {
+            fprintf(stderr, "%s -> float differs\n", kFormats[format].mName);
+            ok = false;
+        }
+    }
+
+    delete[] actual;
+    delete[] expected;
+
+    return ok;
+}
+
+static bool runConversions(const float *signal, size_t numFrames, size_t iterations) {
+    size_t numSamples = numFrames * kNumChannels;
+    uint8_t *src = new uint8_t[numSamples * 4];
+    int16_t *s16 = new int16_t[numSamples];
+    float *f32 = new float[numSamples];
+
+    printf("format  to s16 Msamples/s          to float Msamples/s        exact\n");
+    printf("        per-sample   library  x    per-sample   library  x\n");
+
+    bool ok = true;
+    for (size_t f = 0; f < kNumFormats; ++f) {
+        PCMSampleFormat format = kFormats[f].mFormat;
+        size_t sampleSize = PCMSampleSize(format);
+        encodeSamples(src, signal, numSamples, format);
+
+        double refS16 = timeConversion(
+                referenceToS16, s16, src, numSamples, sampleSize, format, iterations);
+        double libS16 = timeConversion(
+                libraryToS16, s16, src, numSamples, sampleSize, format, iterations);
+        double refFloat = timeConversion(
+                referenceToFloat, f32, src, numSamples, sampleSize, format, iterations);
+        double libFloat = timeConversion(
+                libraryToFloat, f32, src, numSamples, sampleSize, format, iterations);
+
+        bool exact = checkS16(src, numSamples, format)
+            && checkFloat(src, numSamples, format);
+        ok = ok && exact;
+
+        printf("%-6s  %9.1f %9.1f %5.1f  %9.1f %9.1f %5.1f   %s\n",
+               kFormats[f].mName,
+               refS16, libS16, libS16 / refS16,
+               refFloat, libFloat, libFloat / refFloat,
+               exact ? "yes" : "NO");
+    }
+
+    delete[] f32;
+    delete[] s16;
+    delete[] src;
+
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static int16_t clamp16(int32_t x) {
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+static const int32_t kIMAStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int32_t kIMAIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+struct IMAEncoderState {
+    int32_t mPredictor;
+    int32_t mIndex;
+
+    // Returns the nibble for x and moves on to what a decoder makes of it.
+    uint32_t encode(int32_t x, int16_t *decoded) {
+        int32_t step = kIMAStepTable[mIndex];
+        int32_t diff = x - mPredictor;
+        uint32_t nibble = 0;
+        if (diff < 0) {
+            nibble = 8;
+            diff = -diff;
+        }
+        if (diff >= step) {
+            nibble |= 4;
+            diff -= step;
+        }
+        if (diff >= step >> 1) {
+            nibble |= 2;
+            diff -= step >> 1;
+        }
+        if (diff >= step >> 2) {
+            nibble |= 1;
+        }
+
+        int32_t delta = step >> 3;
+        if (nibble & 4) {
+            delta += step;
+        }
+        if (nibble & 2) {
+            delta += step >> 1;
+        }
+        if (nibble & 1) {
+            delta += step >> 2;
+        }
+        mPredictor = clamp16((nibble & 8) ? mPredictor - delta : mPredictor + delta);
+        mIndex += kIMAIndexTable[nibble];
+        mIndex = mIndex < 0 ? 0 : (mIndex > 88 ? 88 : mIndex);
+
+        *decoded = mPredictor;
+        return nibble;
+    }
+};
+
+// Encodes whole blocks only, *decoded receives what a decoder should make
+// of them.
+static size_t encodeIMA(
+        uint8_t *dst, int16_t *decoded, const int16_t *pcm, size_t numFrames,
+        size_t blockAlign, size_t samplesPerBlock) {
+    size_t numBlocks = numFrames / samplesPerBlock;
+    IMAEncoderState state[kNumChannels];
+    for (size_t ch = 0; ch < kNumChannels; ++ch) {
+        state[ch].mIndex = 0;
+    }
+
+    for (size_t b = 0; b < numBlocks; ++b) {
+        uint8_t *p = dst + b * blockAlign;
+        const int16_t *in = pcm + b * samplesPerBlock * kNumChannels;
+        int16_t *out = decoded + b * samplesPerBlock * kNumChannels;
+        memset(p, 0, blockAlign);
+
+        for (size_t ch = 0; ch < kNumChannels; ++ch) {
+            state[ch].mPredictor = in[ch];
+            p[4 * ch] = in[ch];
+            p[4 * ch + 1] = in[ch] >> 8;
+            p[4 * ch + 2] = state[ch].mIndex;
+            out[ch] = in[ch];
+
+            for (size_t i = 1; i < samplesPerBlock; ++i) {
+                size_t group = (i - 1) / 8, k = (i - 1) % 8;
+                uint8_t *q = p + 4 * kNumChannels
+                    + group * 4 * kNumChannels + 4 * ch + k / 2;
+                uint32_t nibble = state[ch].encode(
+                        in[i * kNumChannels + ch], &out[i * kNumChannels + ch]);
+                *q |= (k & 1) ? nibble << 4 : nibble;
+            }
+        }
+    }
+
+    return numBlocks;
+}
+
+static const int32_t kMSCoef1[7] = { 256, 512, 0, 192, 240, 460, 392 };
+static const int32_t kMSCoef2[7] = { 0, -256, 0, 64, 0, -208, -232 };
+static const int32_t kMSAdaptation[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+// Encodes one channel of a block with the given predictor, returns the
+// squared error.
+static double encodeMSChannel(
+        const int16_t *in, int16_t *out, uint8_t *nibbles, size_t n,
+        size_t stride, int32_t predictor, int32_t *initialDelta) {
+    int32_t coef1 = kMSCoef1[predictor], coef2 = kMSCoef2[predictor];
+    int32_t s2 = in[0], s1 = in[stride];
+    int32_t delta = abs((int32_t)in[2 * stride] - ((s1 * coef1 + s2 * coef2) >> 8)) / 4;
+    if (delta < 16) {
+        delta = 16;
+    }
+    *initialDelta = delta;
+    out[0] = s2;
+    out[stride] = s1;
+
+    double error = 0;
+    for (size_t i = 2; i < n; ++i) {
+        int32_t predicted = (s1 * coef1 + s2 * coef2) >> 8;
+        int32_t x = in[i * stride];
+        int32_t e = x - predicted;
+        e = (e >= 0) ? (e + delta / 2) / delta : -((-e + delta / 2) / delta);
+        e = e > 7 ? 7 : (e < -8 ? -8 : e);
+        int32_t sample = clamp16(predicted + e * delta);
+
+        nibbles[i - 2] = e & 0x0f;
+        out[i * stride] = sample;
+        error += (double)(x - sample) * (x - sample);
+
+        delta = (kMSAdaptation[e & 0x0f] * delta) >> 8;
+        if (delta < 16) {
+            delta = 16;
+        }
+        s2 = s1;
+        s1 = sample;
+    }
+
+    return error;
+}
+
+static size_t encodeMS(
+        uint8_t *dst, int16_t *decoded, const int16_t *pcm, size_t numFrames,
+        size_t blockAlign, size_t samplesPerBlock) {
+    size_t numBlocks = numFrames / samplesPerBlock;
+    uint8_t *nibbles = new uint8_t[samplesPerBlock];
+    uint8_t *best = new uint8_t[samplesPerBlock * kNumChannels];
+    int16_t *trial = new int16_t[samplesPerBlock * kNumChannels];
+
+    for (size_t b = 0; b < numBlocks; ++b) {
+        uint8_t *p = dst + b * blockAlign;
+        const int16_t *in = pcm + b * samplesPerBlock * kNumChannels;
+        int16_t *out = decoded + b * samplesPerBlock * kNumChannels;
+        memset(p, 0, blockAlign);
+
+        for (size_t ch = 0; ch < kNumChannels; ++ch) {
+            double bestError = 0;
+            int32_t bestPredictor = -1, bestDelta = 0;
+            for (int32_t predictor = 0; predictor < 7; ++predictor) {
+                int32_t delta;
+                double error = encodeMSChannel(
+                        in + ch, trial + ch, nibbles, samplesPerBlock,
+                        kNumChannels, predictor, &delta);
+                if (bestPredictor < 0 || error < bestError) {
+                    bestError = error;
+                    bestPredictor = predictor;
+                    bestDelta = delta;
+                    for (size_t i = 0; i < samplesPerBlock; ++i) {
+                        out[i * kNumChannels + ch] = trial[i * kNumChannels + ch];
+                    }
+                    memcpy(best + ch * samplesPerBlock, nibbles, samplesPerBlock - 2);
+                }
+            }
+
+            p[ch] = bestPredictor;
+            p[kNumChannels + 2 * ch] = bestDelta;
+            p[kNumChannels + 2 * ch + 1] = bestDelta >> 8;
+            p[3 * kNumChannels + 2 * ch] = out[kNumChannels + ch];
+            p[3 * kNumChannels + 2 * ch + 1] = out[kNumChannels + ch] >> 8;
+            p[5 * kNumChannels + 2 * ch] = out[ch];
+            p[5 * kNumChannels + 2 * ch + 1] = out[ch] >> 8;
+        }
+
+        // Stereo interleaves the channels nibble by nibble, high first.
+        uint8_t *q = p + 7 * kNumChannels;
+        for (size_t i = 0; i < samplesPerBlock - 2; ++i) {
+            *q++ = best[i] << 4 | best[samplesPerBlock + i];
+        }
+    }
+
+    delete[] trial;
+    delete[] best;
+    delete[] nibbles;
+
+    return numBlocks;
+}
+
+static double snr(const int16_t *a, const int16_t *b, size_t n) {
+    double signal = 0, noise = 0;
+    for (size_t i = 0; i < n; ++i) {
+        signal += (double)a[i] * a[i];
+        noise += (double)(a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return 10 * log10(signal / (noise > 0 ? noise : 1));
+}
+
+static bool runADPCM(const float *signal, size_t numFrames, size_t iterations) {
+    size_t numSamples = numFrames * kNumChannels;
+    int16_t *pcm = new int16_t[numSamples];
+    for (size_t i = 0; i < numSamples; ++i) {
+        pcm[i] = toS16(signal[i] * 0.8f);
+    }
+
+    int16_t *expected = new int16_t[numSamples];
+    int16_t *decoded = new int16_t[numSamples];
+    uint8_t *blocks = new uint8_t[numSamples];
+
+    printf("\nadpcm   blockAlign  Msamples/s  realtime  SNR dB  exact\n");
+
+    bool ok = true;
+    for (int ms = 0; ms < 2; ++ms) {
+        static const size_t kBlockAligns[] = { 256, 1024, 2048 };
+        for (size_t a = 0; a < 3; ++a) {
+            size_t blockAlign = kBlockAligns[a];
+            size_t samplesPerBlock = ms
+                ? MSADPCMMaxSamplesPerBlock(blockAlign, kNumChannels)
+                : IMAADPCMMaxSamplesPerBlock(blockAlign, kNumChannels);
+            size_t numBlocks = ms
+                ? encodeMS(blocks, expected, pcm, numFrames, blockAlign, samplesPerBlock)
+                : encodeIMA(blocks, expected, pcm, numFrames, blockAlign, samplesPerBlock);
+            size_t n = numBlocks * samplesPerBlock * kNumChannels;
+
+            // As many blocks per call as WAVSource decodes per buffer.
+            size_t blocksPerCall = 65536 / (samplesPerBlock * kNumChannels * 2);
+            if (blocksPerCall == 0) {
+                blocksPerCall = 1;
+            }
+
+            int64_t startUs = getNowUs();
+            for (size_t k = 0; k < iterations; ++k) {
+                for (size_t b = 0; b < numBlocks; b += blocksPerCall) {
+                    size_t count = numBlocks - b;
+                    if (count > blocksPerCall) {
+                        count = blocksPerCall;
+                    }
+                    int16_t *out = decoded + b * samplesPerBlock * kNumChannels;
+                    const uint8_t *in = blocks + b * blockAlign;
+                    if (ms) {
+                        DecodeMSADPCMBlocks(
+                                out, in, count, blockAlign, samplesPerBlock,
+                                kNumChannels);
+                    } else {
+                        DecodeIMAADPCMBlocks(
+                                out, in, count, blockAlign, samplesPerBlock,
+                                kNumChannels);
+                    }
+                }
+            }
+            int64_t elapsedUs = getNowUs() - startUs;
+            if (elapsedUs <= 0) {
+                elapsedUs = 1;
+            }
+
+            bool exact = !memcmp(decoded, expected, n * sizeof(int16_t));
+            ok = ok && exact;
+
+            double rate = (double)n * iterations / elapsedUs;
+            printf("%-6s  %10zu  %10.1f  %7.0fx  %6.1f  %s\n",
+                   ms ? "ms" : "ima", blockAlign, rate,
+                   rate * 1E6 / (kSampleRate * kNumChannels),
+                   snr(pcm, decoded, n), exact ? "yes" : "NO");
+        }
+    }
+
+    delete[] blocks;
+    delete[] decoded;
+    delete[] expected;
+    delete[] pcm;
+
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct MemorySource : public DataSource {
+    MemorySource(const uint8_t *data, size_t size)
+        : mData(data),
+          mSize(size),
+          mNumReads(0) {
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset < 0) {
+            return ERROR_IO;
+        }
+        ++mNumReads;
+        if ((uint64_t)offset >= mSize) {
+            return 0;
+        }
+        if (size > mSize - offset) {
+            size = mSize - offset;
+        }
+        memcpy(data, mData + offset, size);
+        return size;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mSize;
+        return OK;
+    }
+
+    size_t numReads() const {
+        return mNumReads;
+    }
+
+private:
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mNumReads;
+
+    DISALLOW_EVIL_CONSTRUCTORS(MemorySource);
+};
+
+enum {
+    kWaveFormatPCM = 1,
+    kWaveFormatADPCM = 2,
+    kWaveFormatFloat = 3,
+    kWaveFormatALaw = 6,
+    kWaveFormatMuLaw = 7,
+    kWaveFormatIMAADPCM = 0x11,
+};
+
+static uint8_t *putLE(uint8_t *p, uint32_t x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        *p++ = x >> (8 * i);
+    }
+    return p;
+}
+
+// Writes the RIFF header, a "fmt " chunk for the given format and the
+// header of the "data" chunk, returns the header size.
+static size_t writeHeader(
+        uint8_t *p, uint16_t formatTag, uint16_t bitsPerSample,
+        uint16_t blockAlign, uint16_t samplesPerBlock, size_t dataSize) {
+    size_t fmtSize = 16;
+    if (formatTag == kWaveFormatADPCM) {
+        fmtSize = 50;
+    } else if (formatTag == kWaveFormatIMAADPCM) {
+        fmtSize = 20;
+    }
+    size_t headerSize = 12 + 8 + fmtSize + 8;
+
+    uint32_t byteRate = (formatTag == kWaveFormatADPCM
+            || formatTag == kWaveFormatIMAADPCM)
+        ? (uint64_t)kSampleRate * blockAlign / samplesPerBlock
+        : kSampleRate * blockAlign;
+
+    uint8_t *q = p;
+    memcpy(q, "RIFF", 4);
+    q = putLE(q + 4, headerSize - 8 + dataSize, 4);
+    memcpy(q, "WAVEfmt ", 8);
+    q = putLE(q + 8, fmtSize, 4);
+    q = putLE(q, formatTag, 2);
+    q = putLE(q, kNumChannels, 2);
+    q = putLE(q, kSampleRate, 4);
+    q = putLE(q, byteRate, 4);
+    q = putLE(q, blockAlign, 2);
+    q = putLE(q, bitsPerSample, 2);
+    if (formatTag == kWaveFormatADPCM) {
+        q = putLE(q, 32, 2);
+        q = putLE(q, samplesPerBlock, 2);
+        q = putLE(q, 7, 2);
+        for (size_t i = 0; i < 7; ++i) {
+            q = putLE(q, kMSCoef1[i], 2);
+            q = putLE(q, kMSCoef2[i], 2);
+        }
+    } else if (formatTag == kWaveFormatIMAADPCM) {
+        q = putLE(q, 2, 2);
+        q = putLE(q, samplesPerBlock, 2);
+    }
+    memcpy(q, "data", 4);
+    q = putLE(q + 4, dataSize, 4);
+    CHECK_EQ((size_t)(q - p), headerSize);
+
+    return headerSize;
+}
+
+// Reads the whole file through WAVExtractor, checks every sample and
+// timestamp, then seeks to the middle and checks where it lands.
+static bool runExtractorOne(
+        const char *name, const uint8_t *file, size_t fileSize,
+        const int16_t *expected, size_t numFrames) {
+    sp<MemorySource> source = new MemorySource(file, fileSize);
+
+    int64_t startUs = getNowUs();
+    sp<MediaExtractor> extractor = new WAVExtractor(source);
+    if (extractor->countTracks() != 1) {
+        fprintf(stderr, "%s: not recognized\n", name);
+        return false;
+    }
+
+    int64_t durationUs;
+    CHECK(extractor->getTrackMetaData(0, 0)->findInt64(kKeyDuration, &durationUs));
+
+    sp<MediaSource> track = extractor->getTrack(0);
+    CHECK_EQ(track->start(), (status_t)OK);
+
+    bool ok = durationUs == (int64_t)numFrames * 1000000ll / kSampleRate;
+
+    size_t numBuffers = 0, frame = 0;
+    MediaBuffer *buffer;
+    while (track->read(&buffer, NULL) == OK) {
+        ++numBuffers;
+
+        int64_t timeUs;
+        CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+        if (timeUs != (int64_t)frame * 1000000ll / kSampleRate) {
+            ok = false;
+        }
+
+        size_t n = buffer->range_length() / (2 * kNumChannels);
+        const int16_t *data = (const int16_t *)(
+                (const uint8_t *)buffer->data() + buffer->range_offset());
+        if (frame + n > numFrames
+                || memcmp(data, expected + frame * kNumChannels,
+                          n * kNumChannels * sizeof(int16_t))) {
+            ok = false;
+        }
+        frame += n;
+
+        buffer->release();
+    }
+    ok = ok && frame == numFrames;
+
+    int64_t elapsedUs = getNowUs() - startUs;
+
+    MediaSource::ReadOptions options;
+    options.setSeekTo(durationUs / 2);
+    CHECK_EQ(track->read(&buffer, &options), (status_t)OK);
+    int64_t timeUs;
+    CHECK(buffer->meta_data()->findInt64(kKeyTime, &timeUs));
+    size_t seekFrame = (timeUs * kSampleRate + 999999) / 1000000;
+    if (seekFrame >= numFrames
+            || timeUs != (int64_t)seekFrame * 1000000ll / kSampleRate
+            || memcmp((const uint8_t *)buffer->data() + buffer->range_offset(),
+                      expected + seekFrame * kNumChannels,
+                      kNumChannels * sizeof(int16_t))) {
+        ok = false;
+    }
+    buffer->release();
+
+    track->stop();
+
+    printf("%-8s %8.2f %8zu %8zu %7.0fx  %s\n",
+           name, elapsedUs / 1E3, numBuffers, source->numReads(),
+           (double)durationUs / (elapsedUs > 0 ? elapsedUs : 1),
+           ok ? "yes" : "NO");
+
+    return ok;
+}
+
+static bool runExtractor(const float *signal, size_t numFrames) {
+    size_t numSamples = numFrames * kNumChannels;
+    uint8_t *file = new uint8_t[128 + numSamples * 4];
+    int16_t *expected = new int16_t[numSamples];
+    int16_t *pcm = new int16_t[numSamples];
+    for (size_t i = 0; i < numSamples; ++i) {
+        pcm[i] = toS16(signal[i] * 0.8f);
+    }
+
+    printf("\nfile     read ms  buffers    reads  realtime  exact\n");
+
+    bool ok = true;
+    for (size_t f = 0; f < kNumFormats; ++f) {
+        PCMSampleFormat format = kFormats[f].mFormat;
+        size_t sampleSize = PCMSampleSize(format);
+        uint16_t formatTag = kWaveFormatPCM;
+        if (format == kPCMFormatFloat) {
+            formatTag = kWaveFormatFloat;
+        } else if (format == kPCMFormatALaw) {
+            formatTag = kWaveFormatALaw;
+        } else if (format == kPCMFormatMuLaw) {
+            formatTag = kWaveFormatMuLaw;
+        }
+
+        // An odd number of bytes makes for a partial frame at the end.
+        size_t dataSize = numSamples * sampleSize + 1;
+        size_t headerSize = writeHeader(
+                file, formatTag, sampleSize * 8, kNumChannels * sampleSize, 0,
+                dataSize);
+        encodeSamples(file + headerSize, signal, numSamples, format);
+        file[headerSize + dataSize - 1] = 0;
+        referenceToS16(expected, file + headerSize, numSamples, format);
+
+        ok = runExtractorOne(
+                kFormats[f].mName, file, headerSize + dataSize, expected,
+                numFrames) && ok;
+    }
+
+    for (int ms = 0; ms < 2; ++ms) {
+        size_t blockAlign = 1024;
+        size_t samplesPerBlock = ms
+            ? MSADPCMMaxSamplesPerBlock(blockAlign, kNumChannels)
+            : IMAADPCMMaxSamplesPerBlock(blockAlign, kNumChannels);
+        size_t headerSize = writeHeader(
+                file, ms ? kWaveFormatADPCM : kWaveFormatIMAADPCM, 4,
+                blockAlign, samplesPerBlock, 0);
+        size_t numBlocks = ms
+            ? encodeMS(file + headerSize, expected, pcm, numFrames, blockAlign,
+                       samplesPerBlock)
+            : encodeIMA(file + headerSize, expected, pcm, numFrames, blockAlign,
+                        samplesPerBlock);
+
+        // A truncated block at the end must not be played.
+        size_t dataSize = numBlocks * blockAlign + blockAlign / 2;
+        writeHeader(
+                file, ms ? kWaveFormatADPCM : kWaveFormatIMAADPCM, 4,
+                blockAlign, samplesPerBlock, dataSize);
+
+        ok = runExtractorOne(
+                ms ? "ms" : "ima", file, headerSize + dataSize, expected,
+                numBlocks * samplesPerBlock) && ok;
+    }
+
+    delete[] pcm;
+    delete[] expected;
+    delete[] file;
+
+    return ok;
+}
+
+static void usage(const char *me) {
+    fprintf(stderr,
+            "usage: %s [-s seconds] [-i iterations]\n"
+            "       -s  length of the test clip (default 10)\n"
+            "       -i  times each conversion runs over it (default 5)\n",
+            me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t seconds = 10;
+    size_t iterations = 5;
+
+    int res;
+    while ((res = getopt(argc, argv, "s:i:")) >= 0) {
+        switch (res) {
+            case 's':
+                seconds = atoi(optarg);
+                break;
+
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (seconds == 0 || iterations == 0) {
+        usage(argv[0]);
+    }
+
+    size_t numFrames = seconds * kSampleRate;
+    float *signal = new float[numFrames * kNumChannels];
+    makeSignal(signal, numFrames);
+
+    bool ok = runConversions(signal, numFrames, iterations);
+    ok = runADPCM(signal, numFrames, iterations) && ok;
+    ok = runExtractor(signal, numFrames) && ok;
+
+    delete[] signal;
+
+    return ok ? 0 : 1;
+}
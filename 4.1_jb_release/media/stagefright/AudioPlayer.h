@@ -28,6 +28,8 @@ namespace android {
 class MediaSource;
 class AudioTrack;
 class AwesomePlayer;
+struct PCMRingBuffer;
+struct TimeStretcher;
 
 class AudioPlayer : public TimeSource {
 public:
@@ -65,42 +67,109 @@ public:
     bool isSeeking();
     bool reachedEOS(status_t *finalStatus);
 
+    // Rates from 0.5x to 3x change the tempo but keep the pitch, other
+    // rates are left to the audio sink, which resamples.
     status_t setPlaybackRatePermille(int32_t ratePermille);
 
 private:
     friend class VideoEditorAudioPlayer;
+
+    // The clock as the audio callback last published it.
+    struct TimeMapping {
+        int32_t mSeekEpoch;
+        int32_t mFlushEpoch;
+        int64_t mNumFramesPlayed;
+        int64_t mNumFramesPlayedSysTimeUs;
+        int64_t mMediaFramesPlayedPermille;
+        int64_t mPositionTimeMediaUs;
+        int64_t mPositionTimeRealUs;
+        int64_t mLatencyUs;
+        int64_t mPinnedTimeUs;
+        int32_t mRatePermille;
+        bool mReachedEOS;
+        status_t mFinalStatus;
+    };
+
     sp<MediaSource> mSource;
     AudioTrack *mAudioTrack;
 
-    MediaBuffer *mInputBuffer;
-
     int mSampleRate;
-    int64_t mLatencyUs;
     size_t mFrameSize;
 
     Mutex mLock;
+
+    // Decoded PCM on its way from the decode thread to the audio
+    // callback, which never blocks on the source or on mLock.
+    PCMRingBuffer *mRing;
+
+    // The decode thread's, the buffer it is copying into mRing.
+    MediaBuffer *mInputBuffer;
+    bool mInputBufferTagged;
+    int32_t mDecodeEpoch;
+    bool mDecodeReachedEnd;
+
+    pthread_t mDecodeThread;
+    bool mDecodeThreadStarted;
+    bool mDecodeThreadExit;
+
+    // Counts the wakeups of the decode thread, which waits for a change.
+    Mutex mDecodeWakeLock;
+    Condition mDecodeCondition;
+    int32_t mDecodeWakeups;
+
+    // Bumped by seekTo(), the decode thread then reads from the new
+    // position and the callback drops whatever was decoded before.
+    volatile int32_t mSeekEpoch;
+
+    // Bumped whenever the sink is flushed or stopped, the callback then
+    // counts its frames from 0 again.
+    volatile int32_t mFlushEpoch;
+    int64_t mFlushSysTimeUs;
+
+    int64_t mPausedSysTimeUs;
+
+    // Everything from here to mFinalStatus is only ever used from the
+    // audio callback, or while it isn't running.
+    int32_t mCallbackSeekEpoch;
+    int32_t mCallbackFlushEpoch;
+    bool mCallbackSynced;
+    bool mCallbackAtEnd;
+
+    int64_t mLatencyUs;
     int64_t mNumFramesPlayed;
     int64_t mNumFramesPlayedSysTimeUs;
 
+    // Frames played, each weighted by the time-stretch rate it was played
+    // at, in 1/1000 frames. The clock runs at that rate.
+    int64_t mMediaFramesPlayedPermille;
+
+    TimeStretcher *mTimeStretcher;
+    int32_t mCallbackRatePermille;
+
     int64_t mPositionTimeMediaUs;
     int64_t mPositionTimeRealUs;
+    int64_t mPinnedTimeUs;
 
-    bool mSeeking;
     bool mReachedEOS;
     status_t mFinalStatus;
+
+    // Published by the callback alone, mTimeMappingSeq is odd while it
+    // is being written.
+    volatile int32_t mTimeMappingSeq;
+    TimeMapping mTimeMapping;
+
+    volatile int32_t mTimeStretchRatePermille;
+    int32_t mSinkRatePermille;
+
+    bool mSeeking;
     int64_t mSeekTimeUs;
 
     bool mStarted;
 
-    bool mIsFirstBuffer;
-    status_t mFirstBufferResult;
-    MediaBuffer *mFirstBuffer;
-
     sp<MediaPlayerBase::AudioSink> mAudioSink;
     bool mAllowDeepBuffering;       // allow audio deep audio buffers. Helps with low power audio
                                     // playback but implies high latency
     AwesomePlayer *mObserver;
-    int64_t mPinnedTimeUs;
 
     static void AudioCallback(int event, void *user, void *info);
     void AudioCallback(int event, void *info);
@@ -111,11 +180,21 @@ private:
 
     size_t fillBuffer(void *data, size_t size);
 
-    int64_t getRealTimeUsLocked() const;
+    void publishTimeMapping();
+    void getTimeMappingLocked(TimeMapping *mapping) const;
+    int64_t getRealTimeUsLocked(const TimeMapping &mapping) const;
+
+    static void *DecodeThreadWrapper(void *me);
+    void decodeThread();
+    void stopDecodeThread();
+    void wakeDecodeThread();
+    void queueInputBuffer();
 
     void reset();
 
-    uint32_t getNumFramesPendingPlayout() const;
+    uint32_t getNumFramesPendingPlayout(int64_t numFramesPlayed) const;
+
+    status_t setSinkPlaybackRatePermille(int32_t ratePermille);
 
     AudioPlayer(const AudioPlayer &);
     AudioPlayer &operator=(const AudioPlayer &);
@@ -29,6 +29,7 @@
 namespace android {
 
 class AudioRecord;
+template<typename T> struct LockFreeQueue;
 
 struct AudioSource : public MediaSource, public MediaBufferObserver {
     // Note that the "channels" parameter is _not_ the number of channels,
@@ -66,9 +67,20 @@ private:
         // This is the initial mute duration to suppress
         // the video recording signal tone
         kAutoRampStartUs = 0,
+
+        // The buffers are allocated up front, enough of them to hold
+        // kBufferPoolDurationUs of audio but never fewer than
+        // kMinNumBuffers.
+        kBufferPoolDurationUs = 2000000,
+        kMinNumBuffers = 16,
     };
 
+    // mLock is for read() and the buffers coming back, the AudioRecord
+    // callback only takes mCallbackLock, which start() and reset() take
+    // as well to fence it off. read() waits for the callback on
+    // mFrameAvailableCondition with mCallbackLock.
     Mutex mLock;
+    Mutex mCallbackLock;
     Condition mFrameAvailableCondition;
     Condition mFrameEncodingCompletionCondition;
 
@@ -77,25 +89,31 @@ private:
     bool mStarted;
     int32_t mSampleRate;
 
-    bool mTrackMaxAmplitude;
+    volatile int32_t mTrackMaxAmplitude;
+    volatile int32_t mMaxAmplitude;
+
+    // Owned by the callback once started.
     int64_t mStartTimeUs;
-    int16_t mMaxAmplitude;
     int64_t mPrevSampleTimeUs;
     int64_t mInitialReadTimeUs;
     int64_t mNumFramesReceived;
-    int64_t mNumClientOwnedBuffers;
 
-    List<MediaBuffer * > mBuffersReceived;
+    int64_t mNumClientOwnedBuffers;
 
-    void trackMaxAmplitude(int16_t *data, int nSamples);
+    // Every buffer is either free, received or owned by the client.
+    // The callback pops free buffers and pushes received ones, everybody
+    // else does the opposite under mLock.
+    MediaBuffer **mBuffers;
+    size_t mNumBuffers;
+    LockFreeQueue<MediaBuffer *> *mFreeBuffers;
+    LockFreeQueue<MediaBuffer *> *mBuffersReceived;
 
-    // This is used to raise the volume from mute to the
-    // actual level linearly.
-    void rampVolume(
-        int32_t startFrame, int32_t rampDurationFrames,
-        uint8_t *data,   size_t bytes);
+    // Fills buffers from the pool with "size" bytes of captured audio,
+    // faded in during the auto ramp, or with silence if "data" is NULL.
+    void queueAudio(const int16_t *data, size_t size, int64_t timeUs);
 
-    void queueInputBuffer_l(MediaBuffer *buffer, int64_t timeUs);
+    void queueInputBuffer(MediaBuffer *buffer, size_t size, int64_t timeUs);
+    void recycleBuffer_l(MediaBuffer *buffer);
     void releaseQueuedFrames_l();
     void waitOutstandingEncodingFrames_l();
     status_t reset();
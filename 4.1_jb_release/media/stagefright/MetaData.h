@@ -75,6 +75,7 @@ enum {
 
     kKeyIsDiv3            = 'div3',  // int32_t (bool)
     kKeyIsCodecConfig     = 'conf',  // int32_t (bool)
+    kKeyMultipleNALUnits  = 'mNAL',  // int32_t (bool), NAL units separated by start codes
     kKeyBusAdds           = 'abus',  // uint32_t (pointer)
     kKeyTime              = 'time',  // int64_t (usecs)
     kKeyDecodingTime      = 'decT',  // int64_t (decoding timestamp in usecs)